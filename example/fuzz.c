@@ -18,6 +18,9 @@
  * @file
  *
  * @brief Joulescope driver fuzz tester.
+ *
+ * This tester exercises the public API state machine with real devices.
+ * For the stream-in frame and JSON parsers, see test/parser_fuzz.c.
  */
 
 #include "jsdrv/error_code.h"
@@ -284,9 +287,9 @@ static int32_t t_buffer_req(struct app_s * self) {
     struct jsdrv_buffer_request_s req = {
             .version = 1,
             .time_type = JSDRV_TIME_SAMPLES,
-            .rsv1_u8 = 0,
+            .flags = 0,
             .rsv2_u8 = 0,
-            .rsv3_u32 = 0,
+            .sample_rate = 0,
             .time = {.samples = info->time_range_samples},
             .rsp_topic = {'r', '/', 't', 0},
             .rsp_id = 0,
@@ -16,15 +16,47 @@
 
 #include "jsdrv_prv.h"
 #include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/recorder.h"
 #include "jsdrv/time.h"
 #include "jsdrv/topic.h"
+#include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/log.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/thread.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <inttypes.h>
 
 
+#define DEVICES_MAX         (16U)
+#define SIGNALS_MAX         (16U)
+#define SIGNAL_NAME_MAX     (32U)
+#define OUTPUT_DEFAULT      "capture.jsdrvrec"
+#define STATUS_INTERVAL     (JSDRV_TIME_SECOND)
+
+/// A per-channel sample file exported from the recording.
+struct export_s {
+    const char * signal;    // the signal name, such as "i"
+    const char * filename;  // NULL to skip
+    uint16_t signal_id;     // for the first device
+    FILE * data;
+    FILE * index;           // the filename + ".idx" sidecar
+    uint64_t sample_offset;
+};
+
+struct capture_s {
+    struct jsdrv_recorder_s * recorder;
+    const char * output;
+    uint32_t buffer_size;
+    bool all;
+    uint32_t device_count;
+    struct jsdrv_topic_s devices[DEVICES_MAX];
+    uint32_t signal_count;
+    char signals[SIGNALS_MAX][SIGNAL_NAME_MAX];
+    struct export_s exports[3];
+};
+
 static int32_t publish(struct app_s * self, const char * device, const char * topic, const struct jsdrv_union_s * value, uint32_t timeout_ms) {
     char buf[32];
     struct jsdrv_topic_s t;
@@ -39,106 +71,263 @@ static int32_t publish(struct app_s * self, const char * device, const char * to
     return rc;
 }
 
-static void data_fn(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
-    (void) topic;
-    FILE * f = (FILE *) user_data;
-    if (value->type != JSDRV_UNION_BIN) {
-        printf("data_fn: unsupported type\n");
-        return;
+static uint16_t signal_id(uint32_t device_idx, uint32_t signal_idx) {
+    return (uint16_t) (device_idx * SIGNALS_MAX + signal_idx + 1);
+}
+
+static int32_t signal_add(struct capture_s * c, const char * name, size_t sz) {
+    if ((sz == 0) || (sz >= SIGNAL_NAME_MAX)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
     }
-    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) value->value.bin;
-    if ((JSDRV_DATA_TYPE_FLOAT != s->element_type) || (32 != s->element_size_bits)) {
-        printf("data_fn: unsupported data type\n");
-        return;
+    for (uint32_t i = 0; i < c->signal_count; ++i) {
+        if ((strlen(c->signals[i]) == sz) && (0 == memcmp(c->signals[i], name, sz))) {
+            return 0;  // duplicate
+        }
+    }
+    if (c->signal_count >= SIGNALS_MAX) {
+        return JSDRV_ERROR_FULL;
     }
-    fwrite(s->data, 1, (s->element_count * s->element_size_bits) / 8, f);
+    memcpy(c->signals[c->signal_count], name, sz);
+    c->signals[c->signal_count][sz] = 0;
+    ++c->signal_count;
+    return 0;
 }
 
-static FILE * channel_init(struct app_s * self, const char * device, const char * channel, const char * filename) {
-    int32_t rc;
-    struct jsdrv_topic_s t;
-    if (NULL == filename) {
-        return NULL;
+static int32_t signals_parse(struct capture_s * c, const char * signals) {
+    while (*signals) {
+        size_t sz = strcspn(signals, ",");
+        ROE(signal_add(c, signals, sz));
+        signals += sz;
+        if (*signals) {
+            ++signals;
+        }
     }
-    FILE * f = fopen(filename, "wb");
-    if (NULL == f) {
-        return NULL;
+    return 0;
+}
+
+static int32_t devices_find(struct app_s * self, struct capture_s * c, const char * filter) {
+    ROE(app_scan(self));
+    char * p = self->devices;
+    while (*p && (c->device_count < DEVICES_MAX)) {
+        size_t sz = strcspn(p, ",");
+        char prefix[JSDRV_TOPIC_LENGTH_MAX];
+        jsdrv_cstr_copy(prefix, p, (sz < sizeof(prefix)) ? (sz + 1) : sizeof(prefix));
+        if ((NULL == filter) || jsdrv_cstr_starts_with(prefix, filter)) {
+            bool duplicate = false;
+            for (uint32_t i = 0; i < c->device_count; ++i) {
+                duplicate |= (0 == strcmp(c->devices[i].topic, prefix));
+            }
+            if (!duplicate) {
+                jsdrv_topic_set(&c->devices[c->device_count++], prefix);
+            }
+            if (!c->all) {
+                return 0;
+            }
+        }
+        p += sz;
+        if (*p) {
+            ++p;
+        }
     }
-    jsdrv_topic_set(&t, device);
-    jsdrv_topic_append(&t, "s");
-    jsdrv_topic_append(&t, channel);
+    return c->device_count ? 0 : JSDRV_ERROR_NOT_FOUND;
+}
+
+static int32_t signal_ctrl(struct app_s * self, const char * device, const char * signal, uint32_t enable) {
+    struct jsdrv_topic_s t;
+    jsdrv_topic_set(&t, "s");
+    jsdrv_topic_append(&t, signal);
     jsdrv_topic_append(&t, "ctrl");
-    rc = jsdrv_publish(self->context, t.topic, &jsdrv_union_u32_r(1), 0);
-    if (rc) {
-        fclose(f);
-        return NULL;
+    return publish(self, device, t.topic, &jsdrv_union_u32_r(enable), JSDRV_TIMEOUT_MS_DEFAULT);
+}
+
+static int32_t device_start(struct app_s * self, struct capture_s * c, uint32_t device_idx,
+                            uint32_t frequency, uint32_t filter) {
+    const char * device = c->devices[device_idx].topic;
+    struct jsdrv_topic_s t;
+    ROE(publish(self, device, JSDRV_MSG_OPEN, &jsdrv_union_i32(0), JSDRV_TIMEOUT_MS_DEFAULT));
+    if (jsdrv_cstr_starts_with(device, "u/js220")) {
+        ROE(publish(self, device, "s/i/range/mode", &jsdrv_union_cstr_r("auto"), 0));
+    } else if (jsdrv_cstr_starts_with(device, "u/js110")) {
+        ROE(publish(self, device, "s/i/range/select", &jsdrv_union_cstr_r("auto"), 0));
+    }
+    if (frequency) {
+        if (filter) {
+            ROE(publish(self, device, "h/filter", &jsdrv_union_u32_r(filter), 0));
+        }
+        ROE(publish(self, device, "h/fs", &jsdrv_union_u32_r(frequency), 0));
+    }
+    for (uint32_t i = 0; i < c->signal_count; ++i) {
+        jsdrv_topic_set(&t, device);
+        jsdrv_topic_append(&t, "s");
+        jsdrv_topic_append(&t, c->signals[i]);
+        jsdrv_topic_append(&t, "!data");
+        ROE(jsdrv_recorder_add(c->recorder, signal_id(device_idx, i), t.topic));
+        ROE(signal_ctrl(self, device, c->signals[i], 1));
     }
+    return 0;
+}
 
-    jsdrv_topic_set(&t, device);
-    jsdrv_topic_append(&t, "s");
-    jsdrv_topic_append(&t, channel);
-    jsdrv_topic_append(&t, "!data");
-    rc = jsdrv_subscribe(self->context, t.topic, JSDRV_SFLAG_PUB, data_fn, (void *) f, 0);
-    if (rc) {
-        fclose(f);
-        return NULL;
+static void device_stop(struct app_s * self, struct capture_s * c, uint32_t device_idx) {
+    const char * device = c->devices[device_idx].topic;
+    for (uint32_t i = 0; i < c->signal_count; ++i) {
+        signal_ctrl(self, device, c->signals[i], 0);
     }
-    return f;
+    publish(self, device, JSDRV_MSG_CLOSE, &jsdrv_union_i32(0), JSDRV_TIMEOUT_MS_DEFAULT);
 }
 
-static void channel_finalize(struct app_s * self, const char * device, const char * channel, FILE * f) {
-    int32_t rc;
-    struct jsdrv_topic_s t;
-    if (f == NULL) {
-        return;
+static void status_print(struct capture_s * c, const char * label) {
+    struct jsdrv_recorder_status_s status;
+    jsdrv_recorder_status(c->recorder, &status);
+    printf("%s: %.1f MB, %" PRIu64 " messages, %u drops%s\n", label,
+           (double) status.bytes / (1024.0 * 1024.0), status.messages, (unsigned int) status.drops,
+           status.error ? ", WRITE ERROR" : "");
+}
+
+static int32_t export_open(struct export_s * e) {
+    char path[1024];
+    if (!e->filename) {
+        return 0;
+    }
+    e->data = fopen(e->filename, "wb");
+    snprintf(path, sizeof(path), "%s.idx", e->filename);
+    e->index = fopen(path, "wt");
+    if (!e->data || !e->index) {
+        printf("Could not open %s\n", e->data ? path : e->filename);
+        return JSDRV_ERROR_IO;
     }
+    fprintf(e->index, "sample_id,sample_offset,element_count,decimate_factor,"
+                      "offset_time,offset_counter,counter_rate\n");
+    return 0;
+}
 
-    jsdrv_topic_set(&t, device);
-    jsdrv_topic_append(&t, "s");
-    jsdrv_topic_append(&t, channel);
-    jsdrv_topic_append(&t, "!data");
-    rc = jsdrv_unsubscribe(self->context, t.topic, data_fn, (void *) f, 0);
-    if (rc) {
-        printf("jsdrv_unsubscribe failed with %d\n", rc);
+static void export_close(struct export_s * e) {
+    if (e->data) {
+        fclose(e->data);
+        e->data = NULL;
+    }
+    if (e->index) {
+        fclose(e->index);
+        e->index = NULL;
     }
+}
 
-    jsdrv_topic_set(&t, device);
-    jsdrv_topic_append(&t, "s");
-    jsdrv_topic_append(&t, channel);
-    jsdrv_topic_append(&t, "ctrl");
-    rc = jsdrv_publish(self->context, t.topic, &jsdrv_union_u32_r(0), JSDRV_TIMEOUT_MS_DEFAULT);
-    if (rc) {
-        printf("jsdrv_publish failed with %d\n", rc);
+static void export_record(struct export_s * e, const uint8_t * payload, uint32_t size) {
+    struct jsdrv_stream_signal_s s;
+    if (size < JSDRV_STREAM_HEADER_SIZE) {
+        return;
     }
+    memcpy(&s, payload, JSDRV_STREAM_HEADER_SIZE);
+    uint32_t data_size = (uint32_t) (((uint64_t) s.element_count * s.element_size_bits + 7) / 8);
+    if ((JSDRV_STREAM_HEADER_SIZE + data_size) > size) {
+        return;
+    }
+    fwrite(payload + JSDRV_STREAM_HEADER_SIZE, 1, data_size, e->data);
+    fprintf(e->index, "%" PRIu64 ",%" PRIu64 ",%u,%u,%" PRIi64 ",%" PRIu64 ",%.3f\n",
+            s.sample_id, e->sample_offset, (unsigned int) s.element_count, (unsigned int) s.decimate_factor,
+            s.time_map.offset_time, s.time_map.offset_counter, s.time_map.counter_rate);
+    e->sample_offset += s.element_count;
+}
 
+/*
+ * Export per-channel sample files from the recording after the capture
+ * completes, so that the exports never delay the driver.
+ */
+static int32_t exports_write(struct capture_s * c) {
+    struct jsdrv_recorder_record_header_s hdr;
+    uint32_t export_count = 0;
+    int32_t rc = 0;
+    for (size_t k = 0; k < JSDRV_ARRAY_SIZE(c->exports); ++k) {
+        export_count += c->exports[k].filename ? 1 : 0;
+    }
+    if (!export_count) {
+        return 0;
+    }
+    FILE * f = fopen(c->output, "rb");
+    if (!f) {
+        return JSDRV_ERROR_IO;
+    }
+    uint32_t buffer_size = JSDRV_STREAM_HEADER_SIZE + JSDRV_STREAM_DATA_SIZE;
+    uint8_t * buffer = malloc(buffer_size);
+    for (size_t k = 0; !rc && (k < JSDRV_ARRAY_SIZE(c->exports)); ++k) {
+        rc = export_open(&c->exports[k]);
+    }
+    if (!rc && fseek(f, 64, SEEK_SET)) {  // the recorder file header
+        rc = JSDRV_ERROR_IO;
+    }
+    while (!rc && (1 == fread(&hdr, sizeof(hdr), 1, f))) {
+        uint32_t length = hdr.length - (uint32_t) sizeof(hdr);
+        if (hdr.length < sizeof(hdr)) {
+            break;
+        }
+        struct export_s * e = NULL;
+        for (size_t k = 0; k < JSDRV_ARRAY_SIZE(c->exports); ++k) {
+            if (c->exports[k].filename && (c->exports[k].signal_id == hdr.id)) {
+                e = &c->exports[k];
+            }
+        }
+        if ((hdr.type != JSDRV_RECORDER_TYPE_DATA) || (NULL == e) || (length > buffer_size)) {
+            if (fseek(f, (long) length, SEEK_CUR)) {
+                break;
+            }
+        } else if (1 != fread(buffer, length, 1, f)) {
+            break;  // truncated
+        } else {
+            export_record(e, buffer, hdr.size);
+        }
+    }
+    for (size_t k = 0; k < JSDRV_ARRAY_SIZE(c->exports); ++k) {
+        if (c->exports[k].filename) {
+            printf("Exported %" PRIu64 " samples to %s\n", c->exports[k].sample_offset, c->exports[k].filename);
+        }
+        export_close(&c->exports[k]);
+    }
+    free(buffer);
     fclose(f);
+    return rc;
 }
 
-
 static int usage(void) {
     printf("usage: jsdrv capture [<option> <value>]"
+           "\n"
+           "Capture stream data from one or more devices to a raw recording.\n"
+           "A dedicated writer thread writes large blocks, so slow storage\n"
+           "drops data, reported below, instead of delaying the driver.\n"
+           "The recording includes a sample index and summary pyramid for\n"
+           "random access with jsdrv_recorder_reader_open().\n"
+           "pyjoulescope_driver.record_raw reads and converts the recording.\n"
            "\n"
            "Options:\n"
            "    -d, --duration  The duration in milliseconds.\n"
            "                    0 (default) runs until CTRL-C\n"
            "    -f, --frequency The sampling frequency in Hz.\n"
            "    --filter        Downsample filter type uint32.\n"
-           "    -i, --current   The capture filename for current.\n"
-           "    -v, --voltage   The capture filename for voltage.\n"
-           "    -p, --power     The capture filename for power.\n"
+           "    -o, --output    The recording filename, default " OUTPUT_DEFAULT ".\n"
+           "    --buffer        The in-memory buffer size in MB, default 64.\n"
+           "    --device        The device filter, repeat for multiple devices.\n"
+           "                    Default is the first device.\n"
+           "    --all           Capture from all matching devices.\n"
+           "    -s, --signals   The comma-separated signals, such as i,v,p,i/range,gpi/0.\n"
+           "    -i, --current   Also export the first device's current samples to this file.\n"
+           "    -v, --voltage   Also export the first device's voltage samples to this file.\n"
+           "    -p, --power     Also export the first device's power samples to this file.\n"
+           "\n"
+           "Each export contains the raw samples in the device element format\n"
+           "and has a CSV sidecar, filename.idx, with the sample_id and time map\n"
+           "for each message.\n"
            "\n");
     return 1;
 }
 
 int on_capture(struct app_s * self, int argc, char * argv[]) {
+    struct capture_s c;
     uint32_t frequency = 0;
     uint32_t filter = 0;
-    char * filename_i = NULL;
-    char * filename_v = NULL;
-    char * filename_p = NULL;
-    FILE * file_i = NULL;
-    FILE * file_v = NULL;
-    FILE * file_p = NULL;
+    int32_t rc = 0;
+    memset(&c, 0, sizeof(c));
+    c.output = OUTPUT_DEFAULT;
+    c.exports[0].signal = "i";
+    c.exports[1].signal = "v";
+    c.exports[2].signal = "p";
 
     while (argc) {
         if (argv[0][0] != '-') {
@@ -158,56 +347,110 @@ int on_capture(struct app_s * self, int argc, char * argv[]) {
             ARG_REQUIRE();
             ROE(jsdrv_cstr_to_u32(argv[0], &filter));
             ARG_CONSUME();
+        } else if ((0 == strcmp(argv[0], "-o")) || (0 == strcmp(argv[0], "--output"))) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            c.output = argv[0];
+            ARG_CONSUME();
+        } else if (0 == strcmp(argv[0], "--buffer")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(jsdrv_cstr_to_u32(argv[0], &c.buffer_size));
+            c.buffer_size *= 1024U * 1024U;
+            ARG_CONSUME();
+        } else if (0 == strcmp(argv[0], "--device")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            if (devices_find(self, &c, argv[0])) {
+                printf("No matching device found: %s\n", argv[0]);
+                return 1;
+            }
+            ARG_CONSUME();
+        } else if (0 == strcmp(argv[0], "--all")) {
+            c.all = true;
+            ARG_CONSUME();
+        } else if ((0 == strcmp(argv[0], "-s")) || (0 == strcmp(argv[0], "--signals"))) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(signals_parse(&c, argv[0]));
+            ARG_CONSUME();
         } else if ((0 == strcmp(argv[0], "-i")) || (0 == strcmp(argv[0], "--current"))) {
             ARG_CONSUME();
             ARG_REQUIRE();
-            filename_i = argv[0];
+            c.exports[0].filename = argv[0];
             ARG_CONSUME();
         } else if ((0 == strcmp(argv[0], "-v")) || (0 == strcmp(argv[0], "--voltage"))) {
             ARG_CONSUME();
             ARG_REQUIRE();
-            filename_v = argv[0];
+            c.exports[1].filename = argv[0];
             ARG_CONSUME();
         } else if ((0 == strcmp(argv[0], "-p")) || (0 == strcmp(argv[0], "--power"))) {
             ARG_CONSUME();
             ARG_REQUIRE();
-            filename_p = argv[0];
+            c.exports[2].filename = argv[0];
             ARG_CONSUME();
         } else {
             return usage();
         }
     }
 
-    ROE(app_match(self, NULL));
-    char * device = self->device.topic;
-    ROE(publish(self, device, JSDRV_MSG_OPEN, &jsdrv_union_i32(0), JSDRV_TIMEOUT_MS_DEFAULT));
-    if (jsdrv_cstr_starts_with(device, "u/js220")) {
-        ROE(publish(self, device, "s/i/range/mode", &jsdrv_union_cstr_r("auto"), 0));
-    } else if (jsdrv_cstr_starts_with(device, "u/js110")) {
-        ROE(publish(self, device, "s/i/range/select", &jsdrv_union_cstr_r("auto"), 0));
+    if (!c.device_count && devices_find(self, &c, NULL)) {
+        printf("No devices found\n");
+        return 1;
     }
-    if (frequency) {
-        if (filter) {
-            ROE(publish(self, device, "h/filter", &jsdrv_union_u32_r(filter), 0));
+    for (size_t k = 0; k < JSDRV_ARRAY_SIZE(c.exports); ++k) {
+        if (c.exports[k].filename) {
+            ROE(signal_add(&c, c.exports[k].signal, strlen(c.exports[k].signal)));
+        }
+    }
+    if (!c.signal_count) {
+        ROE(signals_parse(&c, "i,v"));
+    }
+    for (size_t k = 0; k < JSDRV_ARRAY_SIZE(c.exports); ++k) {
+        for (uint32_t i = 0; i < c.signal_count; ++i) {
+            if (0 == strcmp(c.signals[i], c.exports[k].signal)) {
+                c.exports[k].signal_id = signal_id(0, i);
+            }
         }
-        ROE(publish(self, device, "h/fs", &jsdrv_union_u32_r(frequency), 0));
     }
 
-    file_i = channel_init(self, device, "i", filename_i);
-    file_v = channel_init(self, device, "v", filename_v);
-    file_p = channel_init(self, device, "p", filename_p);
+    rc = jsdrv_recorder_open(self->context, c.output, c.buffer_size, &c.recorder);
+    if (rc) {
+        printf("Could not open %s: %d\n", c.output, (int) rc);
+        return rc;
+    }
+    printf("Capture %u signals from %u devices to %s\n",
+           (unsigned int) c.signal_count, (unsigned int) c.device_count, c.output);
+    uint32_t started = 0;
+    for (; !rc && (started < c.device_count); ++started) {
+        rc = device_start(self, &c, started, frequency, filter);
+    }
 
-    int64_t t_end = jsdrv_time_utc() + JSDRV_TIME_MILLISECOND * (int64_t) self->duration_ms;
-    while (!quit_) {
-        jsdrv_thread_sleep_ms(1); // do nothing
-        if (self->duration_ms && (jsdrv_time_utc() >= t_end)) {
+    int64_t t_start = jsdrv_time_utc();
+    int64_t t_end = t_start + JSDRV_TIME_MILLISECOND * (int64_t) self->duration_ms;
+    int64_t t_status = t_start + STATUS_INTERVAL;
+    while (!rc && !quit_) {
+        jsdrv_thread_sleep_ms(10);
+        int64_t t_now = jsdrv_time_utc();
+        if (t_now >= t_status) {
+            char label[32];
+            snprintf(label, sizeof(label), "%8.1f s", JSDRV_TIME_TO_F64(t_now - t_start));
+            status_print(&c, label);
+            t_status += STATUS_INTERVAL;
+        }
+        if (self->duration_ms && (t_now >= t_end)) {
             break;
         }
     }
 
-    channel_finalize(self, device, "i", file_i);
-    channel_finalize(self, device, "v", file_v);
-    channel_finalize(self, device, "p", file_p);
-    ROE(publish(self, device, JSDRV_MSG_CLOSE, &jsdrv_union_i32(0), JSDRV_TIMEOUT_MS_DEFAULT));
-    return 0;
+    for (uint32_t i = 0; i < started; ++i) {
+        device_stop(self, &c, i);
+    }
+    status_print(&c, "total");
+    int32_t rc_close = jsdrv_recorder_close(c.recorder);
+    rc = rc ? rc : rc_close;
+    if (!rc) {
+        rc = exports_write(&c);
+    }
+    return rc;
 }
@@ -44,6 +44,26 @@ struct command_s {
 
 struct app_s app_;
 
+static struct jsdrv_arg_s init_args_[] = {
+    {JSDRV_ARG_EMULATION_DEVICES, {.type = JSDRV_UNION_U32, .value = {.u32 = 0}}},
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --usb-capture
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --replay
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --replay-rate
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --dispatch
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --dispatch, queue statistics
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --isa
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --stats-threads
+    {"", {.type = JSDRV_UNION_NULL}},   // optional --device-hint
+    {"", {.type = JSDRV_UNION_NULL}},
+};
+static uint32_t init_args_count_ = 1;
+
+static void init_arg_add(const char * topic, const struct jsdrv_union_s * value) {
+    init_args_[init_args_count_].topic = topic;
+    init_args_[init_args_count_].value = *value;
+    ++init_args_count_;
+}
+
 // cross-platform handler for CTRL-C to exit program
 static void signal_handler(int signal){
     if ((signal == SIGABRT) || (signal == SIGINT)) {
@@ -72,7 +92,7 @@ static void on_log_recv(void * user_data, struct jsdrv_log_header_s const * head
 int app_initialize(struct app_s * self) {
     memset(self, 0, sizeof(*self));
     jsdrv_topic_clear(&self->topic);
-    int32_t rc = jsdrv_initialize(&self->context, NULL, 1000);
+    int32_t rc = jsdrv_initialize(&self->context, init_args_, 1000);
     if (rc) {
         printf("jsdrv_initialize failed: %d %s %s\n", rc,
                jsdrv_error_code_name(rc),
@@ -130,12 +150,15 @@ const struct command_s COMMANDS[] = {
         {"mem_erase", on_mem_erase, "Erase memory region"},
         {"mem_read", on_mem_read, "Read memory region"},
         {"mem_write", on_mem_write, "Write memory region"},
+        {"pubsub", on_pubsub, "Display per-topic pubsub statistics"},
         {"reset", on_reset, "Reset to target"},
         {"scan", on_scan, "List connected devices"},
         {"set",  on_set,  "Set parameters"},
         {"statistics",  on_statistics,  "Display statistics from all connected devices"},
+        {"stress", on_stress, "Stream from many devices to many subscribers"},
         {"stream_buffer",  on_stream_buffer,  "Demonstrate stream buffer"},
         {"threads", on_threads, "Demonstrate multi-thread access"},
+        {"throughput", on_throughput, "Measure the sustained stream rate and latency"},
         {"version", on_version, "Display version and platform information"},
         {"help", on_help, "Display help"},
         {NULL, NULL, NULL}
@@ -143,10 +166,21 @@ const struct command_s COMMANDS[] = {
 
 static int usage(void) {
     const struct command_s * cmd = COMMANDS;
-    printf("usage: jsdrv_util [--log-level <LEVEL>] <COMMAND> [...args]\n");
+    printf("usage: jsdrv_util [--log-level <LEVEL>] [--emulate <N>] [--usb-capture <PATH>]\n"
+           "                  [--replay <PATH>] [--replay-rate <RATE>] [--dispatch <N>]\n"
+           "                  [--isa <ISA>] [--stats-threads <MS>] [--device-hint <PREFIX>]\n"
+           "                  <COMMAND> [...args]\n");
     printf("\n--log_level: Configure the log level to stdout\n"
            "    off, emergency, alert, critical, [error], warning,\n"
            "    notice, info, debug1, debug2, debug3, all\n");
+    printf("--emulate: Add N emulated JS220 devices for testing without hardware\n");
+    printf("--usb-capture: Capture the raw USB bulk-in transfers to PATH\n");
+    printf("--replay: The emulated devices replay the --usb-capture PATH\n");
+    printf("--replay-rate: 0 replays as fast as possible, default uses the captured timing\n");
+    printf("--dispatch: Use N data callback worker threads and publish queue statistics\n");
+    printf("--isa: Force the SIMD instruction set: scalar, sse2, avx2, or neon\n");
+    printf("--stats-threads: Display the thread CPU and queue depth statistics every MS milliseconds\n");
+    printf("--device-hint: Only add devices whose prefix starts with PREFIX, such as u/js220\n");
     printf("\nAvailable commands:\n");
     while (cmd->command) {
         printf("  %-12s %s\n", cmd->command, cmd->description);
@@ -155,6 +189,12 @@ static int usage(void) {
     return 1;
 }
 
+static void on_stats_threads(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) user_data;
+    (void) topic;
+    printf("%s\n", value->value.str);
+}
+
 int on_help(struct app_s * self, int argc, char * argv[]) {
     (void) self;
     (void) argc;
@@ -209,6 +249,7 @@ int main(int argc, char * argv[]) {
     struct app_s * self = &app_;
     memset(self, 0, sizeof(*self));
     int32_t rc;
+    bool stats_threads = false;
 
     if (argc < 2) {
         return usage();
@@ -227,8 +268,55 @@ int main(int argc, char * argv[]) {
         ARG_CONSUME();
         jsdrv_log_level_set(level);
     }
+    while (argc && (argv[0][0] == '-')) {
+        if (jsdrv_cstr_casecmp("--emulate", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_args_[0].value.value.u32 = (uint32_t) strtoul(argv[0], NULL, 0);
+        } else if (jsdrv_cstr_casecmp("--usb-capture", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_arg_add(JSDRV_ARG_USB_CAPTURE, &jsdrv_union_str(argv[0]));
+        } else if (jsdrv_cstr_casecmp("--replay", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_arg_add(JSDRV_ARG_EMULATION_REPLAY, &jsdrv_union_str(argv[0]));
+            if (0 == init_args_[0].value.value.u32) {
+                init_args_[0].value.value.u32 = 1;
+            }
+        } else if (jsdrv_cstr_casecmp("--replay-rate", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_arg_add(JSDRV_ARG_EMULATION_RATE, &jsdrv_union_u32((uint32_t) strtoul(argv[0], NULL, 0)));
+        } else if (jsdrv_cstr_casecmp("--dispatch", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_arg_add(JSDRV_ARG_DISPATCH_THREADS, &jsdrv_union_u32((uint32_t) strtoul(argv[0], NULL, 0)));
+            init_arg_add(JSDRV_ARG_STATS_MEM_INTERVAL, &jsdrv_union_u32(1000));
+        } else if (jsdrv_cstr_casecmp("--isa", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_arg_add(JSDRV_ARG_CPU_ISA, &jsdrv_union_str(argv[0]));
+        } else if (jsdrv_cstr_casecmp("--stats-threads", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_arg_add(JSDRV_ARG_STATS_THREADS_INTERVAL, &jsdrv_union_u32((uint32_t) strtoul(argv[0], NULL, 0)));
+            stats_threads = true;
+        } else if (jsdrv_cstr_casecmp("--device-hint", argv[0]) == 0) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            init_arg_add(JSDRV_ARG_DEVICE_HINT, &jsdrv_union_str(argv[0]));
+        } else {
+            return usage();
+        }
+        ARG_CONSUME();
+    }
+    ARG_REQUIRE();
 
     ROE(app_initialize(self));
+    if (stats_threads) {
+        jsdrv_subscribe(self->context, JSDRV_MSG_STATS_THREADS, JSDRV_SFLAG_PUB, on_stats_threads, NULL, 0);
+    }
     signal(SIGABRT, signal_handler);
     signal(SIGINT, signal_handler);
 
@@ -85,10 +85,13 @@ int on_info(struct app_s * self, int argc, char * argv[]);
 int on_mem_erase(struct app_s * self, int argc, char * argv[]);
 int on_mem_read(struct app_s * self, int argc, char * argv[]);
 int on_mem_write(struct app_s * self, int argc, char * argv[]);
+int on_pubsub(struct app_s * self, int argc, char * argv[]);
 int on_reset(struct app_s * self, int argc, char * argv[]);
 int on_scan(struct app_s * self, int argc, char * argv[]);
 int on_set(struct app_s * self, int argc, char * argv[]);
 int on_statistics(struct app_s * self, int argc, char * argv[]);
 int on_stream_buffer(struct app_s * self, int argc, char * argv[]);
+int on_stress(struct app_s * self, int argc, char * argv[]);
 int on_threads(struct app_s * self, int argc, char * argv[]);
+int on_throughput(struct app_s * self, int argc, char * argv[]);
 int on_version(struct app_s * self, int argc, char * argv[]);
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv_prv/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int usage(void) {
+    printf("usage: jsdrv_util pubsub [--interval <ms>] [--open <device_filter>]\n"
+           "  Display per-topic pubsub statistics, sorted by the time spent\n"
+           "  in subscriber callbacks.  --open streams statistics from the\n"
+           "  matching JS220 to generate traffic.\n");
+    return 1;
+}
+
+static void on_stats(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) user_data;
+    (void) topic;
+    if (value->type == JSDRV_UNION_JSON) {
+        printf("%s\n", value->value.str);
+    }
+}
+
+static void on_value(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) user_data;
+    (void) topic;
+    (void) value;
+}
+
+int on_pubsub(struct app_s * self, int argc, char * argv[]) {
+    uint32_t interval_ms = 1000;
+    const char * device_filter = NULL;
+    struct jsdrv_topic_s topic;
+    while (argc) {
+        if (argv[0][0] != '-') {
+            return usage();
+        } else if ((0 == strcmp(argv[0], "--interval")) || (0 == strcmp(argv[0], "-i"))) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            if (jsdrv_cstr_to_u32(argv[0], &interval_ms) || !interval_ms) {
+                return usage();
+            }
+            ARG_CONSUME();
+        } else if ((0 == strcmp(argv[0], "--open")) || (0 == strcmp(argv[0], "-o"))) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            device_filter = argv[0];
+            ARG_CONSUME();
+        } else {
+            return usage();
+        }
+    }
+
+    ROE(jsdrv_subscribe(self->context, JSDRV_MSG_STATS_TOPIC, JSDRV_SFLAG_PUB,
+                        on_stats, self, JSDRV_TIMEOUT_MS_DEFAULT));
+    ROE(jsdrv_publish(self->context, JSDRV_MSG_STATS_TOPIC_REQ, &jsdrv_union_u32(1), JSDRV_TIMEOUT_MS_DEFAULT));
+    if (device_filter) {
+        ROE(app_match(self, device_filter));
+        ROE(jsdrv_open(self->context, self->device.topic, JSDRV_DEVICE_OPEN_MODE_DEFAULTS));
+        jsdrv_topic_set(&topic, self->device.topic);
+        jsdrv_topic_append(&topic, "s/stats/value");
+        ROE(jsdrv_subscribe(self->context, topic.topic, JSDRV_SFLAG_PUB, on_value, self, JSDRV_TIMEOUT_MS_DEFAULT));
+        jsdrv_topic_set(&topic, self->device.topic);
+        jsdrv_topic_append(&topic, "s/stats/ctrl");
+        ROE(jsdrv_publish(self->context, topic.topic, &jsdrv_union_u8_r(1), JSDRV_TIMEOUT_MS_DEFAULT));
+    }
+    printf("# Press CTRL-C to exit.\n");
+
+    uint32_t elapsed_ms = 0;
+    while (!quit_) {
+        jsdrv_thread_sleep_ms(10);
+        elapsed_ms += 10;
+        if (elapsed_ms >= interval_ms) {
+            elapsed_ms = 0;
+            jsdrv_publish(self->context, JSDRV_MSG_STATS_TOPIC_REQ, &jsdrv_union_u32(1), 0);
+        }
+    }
+
+    jsdrv_publish(self->context, JSDRV_MSG_STATS_TOPIC_REQ, &jsdrv_union_u32(0), JSDRV_TIMEOUT_MS_DEFAULT);
+    jsdrv_unsubscribe(self->context, JSDRV_MSG_STATS_TOPIC, on_stats, self, JSDRV_TIMEOUT_MS_DEFAULT);
+    if (device_filter) {
+        jsdrv_close(self->context, self->device.topic);
+    }
+    return 0;
+}
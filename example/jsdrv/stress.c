@@ -0,0 +1,424 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+#include "jsdrv/topic.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+
+#define DEVICES_MAX         (32U)
+#define SUBSCRIBERS_MAX     (16U)
+#define THREADS_MAX         (128U)
+#define SIGNALS_DEFAULT     "i,v"
+#define HEALTH_SIZE         (1024U)
+
+struct device_s;
+
+struct subscriber_s {
+    struct device_s * device;
+    volatile uint64_t samples;
+    volatile uint64_t messages;
+};
+
+struct device_s {
+    char prefix[JSDRV_TOPIC_LENGTH_MAX];
+    bool open;
+    struct subscriber_s subscribers[SUBSCRIBERS_MAX];
+    uint64_t samples_prev;
+    char health[HEALTH_SIZE];  // the most recent "h/stream/health" JSON
+};
+
+struct thread_cpu_s {
+    int tid;
+    char name[32];
+    uint64_t ticks;
+};
+
+struct stress_s {
+    struct app_s * app;
+    const char * signals;
+    uint32_t fs;
+    uint32_t subscriber_count;
+    uint32_t cost_us;
+    uint32_t depth;
+    uint32_t device_count;
+    struct device_s devices[DEVICES_MAX];
+    char queue_stats[JSDRV_PAYLOAD_LENGTH_MAX];
+    uint32_t thread_count;
+    struct thread_cpu_s threads[THREADS_MAX];
+};
+
+static struct stress_s stress_;
+
+static int usage(void) {
+    printf("usage: jsdrv_util stress [<option> <value>] ...\n"
+           "\n"
+           "Stream from all devices with many subscribers and report the\n"
+           "per-device throughput, stream health, queue depths, and the\n"
+           "CPU usage for each thread once per second.\n"
+           "Use with --emulate to add emulated devices.\n"
+           "\n"
+           "Options:\n"
+           "    --duration      The duration in milliseconds, default 10000.\n"
+           "                    0 runs until CTRL-C.\n"
+           "    --signals       The comma-separated signals, default " SIGNALS_DEFAULT "\n"
+           "    --fs            The sampling frequency, default leaves the device setting.\n"
+           "    --subscribers   The number of subscribers per device, default 1.\n"
+           "    --cost          The busy time in each callback in microseconds, default 0.\n"
+           "    --depth         The queued subscriber depth, default 0 for direct callbacks.\n"
+           "                    Requires --dispatch.\n"
+           "\n");
+    return 1;
+}
+
+static void busy_wait_us(uint32_t us) {
+    if (us) {
+        int64_t t_end = jsdrv_time_utc() + JSDRV_TIME_MICROSECOND * (int64_t) us;
+        while (jsdrv_time_utc() < t_end) {
+            // spin to emulate callback processing
+        }
+    }
+}
+
+static void on_data(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    struct subscriber_s * s = (struct subscriber_s *) user_data;
+    if ((value->app != JSDRV_PAYLOAD_TYPE_STREAM) || !jsdrv_cstr_ends_with(topic, "/!data")) {
+        return;
+    }
+    const struct jsdrv_stream_signal_s * signal = (const struct jsdrv_stream_signal_s *) value->value.bin;
+    s->samples += signal->element_count;
+    ++s->messages;
+    busy_wait_us(stress_.cost_us);
+}
+
+static void on_health(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) topic;
+    struct device_s * d = (struct device_s *) user_data;
+    if ((value->type == JSDRV_UNION_JSON) || (value->type == JSDRV_UNION_STR)) {
+        jsdrv_cstr_copy(d->health, value->value.str, sizeof(d->health));
+    }
+}
+
+static void on_queue_stats(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) topic;
+    struct stress_s * self = (struct stress_s *) user_data;
+    if ((value->type == JSDRV_UNION_JSON) || (value->type == JSDRV_UNION_STR)) {
+        jsdrv_cstr_copy(self->queue_stats, value->value.str, sizeof(self->queue_stats));
+    }
+}
+
+// Sum all occurrences of the integer field key in a flat JSON string.
+static uint64_t json_sum(const char * json, const char * key) {
+    char pattern[64];
+    uint64_t total = 0;
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    size_t sz = strlen(pattern);
+    for (const char * p = strstr(json, pattern); p; p = strstr(p + sz, pattern)) {
+        total += strtoull(p + sz, NULL, 10);
+    }
+    return total;
+}
+
+static uint64_t json_max(const char * json, const char * key) {
+    char pattern[64];
+    uint64_t result = 0;
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    size_t sz = strlen(pattern);
+    for (const char * p = strstr(json, pattern); p; p = strstr(p + sz, pattern)) {
+        uint64_t v = strtoull(p + sz, NULL, 10);
+        result = (v > result) ? v : result;
+    }
+    return result;
+}
+
+static int32_t device_publish(struct app_s * app, const char * device, const char * topic,
+                              const struct jsdrv_union_s * value) {
+    struct jsdrv_topic_s t;
+    jsdrv_topic_set(&t, device);
+    jsdrv_topic_append(&t, topic);
+    int32_t rc = jsdrv_publish(app->context, t.topic, value, JSDRV_TIMEOUT_MS_DEFAULT);
+    if (rc) {
+        printf("publish %s failed with %d %s\n", t.topic, (int) rc, jsdrv_error_code_name(rc));
+    }
+    return rc;
+}
+
+static int32_t signals_ctrl(struct stress_s * self, struct device_s * d, uint32_t enable) {
+    char buf[64];
+    const char * p = self->signals;
+    while (*p) {
+        size_t sz = strcspn(p, ",");
+        if ((sz == 0) || (sz >= (sizeof(buf) - 8))) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        memcpy(buf, "s/", 2);
+        memcpy(buf + 2, p, sz);
+        memcpy(buf + 2 + sz, "/ctrl", 6);
+        int32_t rc = device_publish(self->app, d->prefix, buf, &jsdrv_union_u32_r(enable));
+        if (rc && enable) {
+            return rc;
+        }
+        p += sz;
+        if (*p) {
+            ++p;
+        }
+    }
+    return 0;
+}
+
+static int32_t device_start(struct stress_s * self, struct device_s * d) {
+    struct jsdrv_context_s * context = self->app->context;
+    struct jsdrv_topic_s t;
+    ROE(jsdrv_open(context, d->prefix, JSDRV_DEVICE_OPEN_MODE_DEFAULTS));
+    d->open = true;
+    for (uint32_t k = 0; k < self->subscriber_count; ++k) {
+        struct subscriber_s * s = &d->subscribers[k];
+        s->device = d;
+        if (self->depth) {
+            ROE(jsdrv_subscribe_queue(context, d->prefix, JSDRV_SFLAG_PUB, on_data, s,
+                                      self->depth, JSDRV_QUEUE_POLICY_DROP_OLDEST, JSDRV_TIMEOUT_MS_DEFAULT));
+        } else {
+            ROE(jsdrv_subscribe(context, d->prefix, JSDRV_SFLAG_PUB, on_data, s, JSDRV_TIMEOUT_MS_DEFAULT));
+        }
+    }
+    jsdrv_topic_set(&t, d->prefix);
+    jsdrv_topic_append(&t, "h/stream/health");
+    ROE(jsdrv_subscribe(context, t.topic, JSDRV_SFLAG_PUB, on_health, d, JSDRV_TIMEOUT_MS_DEFAULT));
+    if (self->fs) {
+        ROE(device_publish(self->app, d->prefix, "h/fs", &jsdrv_union_u32_r(self->fs)));
+    }
+    return signals_ctrl(self, d, 1);
+}
+
+static void device_stop(struct stress_s * self, struct device_s * d) {
+    struct jsdrv_context_s * context = self->app->context;
+    struct jsdrv_topic_s t;
+    if (!d->open) {
+        return;
+    }
+    signals_ctrl(self, d, 0);
+    jsdrv_topic_set(&t, d->prefix);
+    jsdrv_topic_append(&t, "h/stream/health");
+    jsdrv_unsubscribe(context, t.topic, on_health, d, JSDRV_TIMEOUT_MS_DEFAULT);
+    for (uint32_t k = 0; k < self->subscriber_count; ++k) {
+        jsdrv_unsubscribe(context, d->prefix, on_data, &d->subscribers[k], JSDRV_TIMEOUT_MS_DEFAULT);
+    }
+    jsdrv_close(context, d->prefix);
+    d->open = false;
+}
+
+#if defined(__linux__)
+// Update the CPU ticks for each thread in this process from /proc.
+static void threads_sample(struct stress_s * self) {
+    char path[64];
+    char buf[512];
+    DIR * dir = opendir("/proc/self/task");
+    if (!dir) {
+        return;
+    }
+    struct dirent * entry;
+    while (NULL != (entry = readdir(dir))) {
+        int tid = atoi(entry->d_name);
+        if (tid <= 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+        FILE * f = fopen(path, "r");
+        if (!f) {
+            continue;
+        }
+        size_t sz = fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+        buf[sz] = 0;
+        char * name_start = strchr(buf, '(');
+        char * name_end = strrchr(buf, ')');
+        if (!name_start || !name_end) {
+            continue;
+        }
+        // after ")": state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+        unsigned long long utime = 0;
+        unsigned long long stime = 0;
+        if (2 != sscanf(name_end + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                        &utime, &stime)) {
+            continue;
+        }
+        struct thread_cpu_s * t = NULL;
+        for (uint32_t i = 0; i < self->thread_count; ++i) {
+            if (self->threads[i].tid == tid) {
+                t = &self->threads[i];
+                break;
+            }
+        }
+        if (!t) {
+            if (self->thread_count >= THREADS_MAX) {
+                continue;
+            }
+            t = &self->threads[self->thread_count++];
+            t->tid = tid;
+            t->ticks = utime + stime;
+            *name_end = 0;
+            jsdrv_cstr_copy(t->name, name_start + 1, sizeof(t->name));
+        }
+        uint64_t ticks = utime + stime;
+        if (self->app->verbose || (ticks != t->ticks)) {
+            printf("    %-16s %6d %6.1f%%\n", t->name, tid,
+                   100.0 * (double) (ticks - t->ticks) / (double) sysconf(_SC_CLK_TCK));
+        }
+        t->ticks = ticks;
+    }
+    closedir(dir);
+}
+#else
+static void threads_sample(struct stress_s * self) {
+    (void) self;  // per-thread CPU usage only supported on Linux
+}
+#endif
+
+static void report(struct stress_s * self, double dt) {
+    for (uint32_t i = 0; i < self->device_count; ++i) {
+        struct device_s * d = &self->devices[i];
+        uint64_t samples = d->subscribers[0].samples;
+        uint64_t messages_min = UINT64_MAX;
+        for (uint32_t k = 0; k < self->subscriber_count; ++k) {
+            uint64_t m = d->subscribers[k].messages;
+            messages_min = (m < messages_min) ? m : messages_min;
+        }
+        printf("  %-20s %8.3f Msps, messages %" PRIu64 ", skips %" PRIu64 ", dups %" PRIu64
+               ", drops %" PRIu64 ", frames_lost %" PRIu64 "\n",
+               d->prefix, (samples - d->samples_prev) / dt * 1e-6, messages_min,
+               json_sum(d->health, "skips"), json_sum(d->health, "dups"),
+               json_sum(d->health, "drops"), json_sum(d->health, "frames_lost"));
+        d->samples_prev = samples;
+    }
+    if (self->depth) {
+        printf("  queues: pending %" PRIu64 ", peak %" PRIu64 ", drops %" PRIu64 "\n",
+               json_sum(self->queue_stats, "pending"), json_max(self->queue_stats, "peak"),
+               json_sum(self->queue_stats, "drops"));
+    }
+    threads_sample(self);
+}
+
+int on_stress(struct app_s * self, int argc, char * argv[]) {
+    struct stress_s * s = &stress_;
+    uint32_t duration_ms = 10000;
+    memset(s, 0, sizeof(*s));
+    s->app = self;
+    s->signals = SIGNALS_DEFAULT;
+    s->subscriber_count = 1;
+    while (argc) {
+        if (argv[0][0] != '-') {
+            return usage();
+        } else if (0 == strcmp(argv[0], "--duration")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(jsdrv_cstr_to_u32(argv[0], &duration_ms));
+        } else if (0 == strcmp(argv[0], "--signals")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            s->signals = argv[0];
+        } else if (0 == strcmp(argv[0], "--fs")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(jsdrv_cstr_to_u32(argv[0], &s->fs));
+        } else if (0 == strcmp(argv[0], "--subscribers")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(jsdrv_cstr_to_u32(argv[0], &s->subscriber_count));
+            if ((s->subscriber_count < 1) || (s->subscriber_count > SUBSCRIBERS_MAX)) {
+                return usage();
+            }
+        } else if (0 == strcmp(argv[0], "--cost")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(jsdrv_cstr_to_u32(argv[0], &s->cost_us));
+        } else if (0 == strcmp(argv[0], "--depth")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(jsdrv_cstr_to_u32(argv[0], &s->depth));
+        } else if (0 == strcmp(argv[0], "--verbose")) {
+            self->verbose = 1;
+        } else {
+            return usage();
+        }
+        ARG_CONSUME();
+    }
+
+    ROE(app_scan(self));
+    char * p = self->devices;
+    while (*p && (s->device_count < DEVICES_MAX)) {
+        size_t sz = strcspn(p, ",");
+        struct device_s * d = &s->devices[s->device_count++];
+        memcpy(d->prefix, p, (sz < sizeof(d->prefix)) ? sz : (sizeof(d->prefix) - 1));
+        p += sz;
+        if (*p) {
+            ++p;
+        }
+    }
+    if (!s->device_count) {
+        printf("No devices found\n");
+        return 1;
+    }
+    printf("stress: %u devices, signals=%s, subscribers=%u, cost=%u us, depth=%u\n",
+           (unsigned int) s->device_count, s->signals, (unsigned int) s->subscriber_count,
+           (unsigned int) s->cost_us, (unsigned int) s->depth);
+
+    int32_t rc = 0;
+    if (s->depth) {
+        rc = jsdrv_subscribe(self->context, JSDRV_MSG_STATS_QUEUE, JSDRV_SFLAG_PUB, on_queue_stats, s,
+                             JSDRV_TIMEOUT_MS_DEFAULT);
+    }
+    for (uint32_t i = 0; !rc && (i < s->device_count); ++i) {
+        rc = device_start(s, &s->devices[i]);
+    }
+    threads_sample(s);
+
+    int64_t t_start = jsdrv_time_utc();
+    int64_t t_end = duration_ms ? (t_start + JSDRV_TIME_MILLISECOND * (int64_t) duration_ms) : INT64_MAX;
+    int64_t t_report = t_start + JSDRV_TIME_SECOND;
+    while (!rc && !quit_) {
+        jsdrv_thread_sleep_ms(10);
+        int64_t t_now = jsdrv_time_utc();
+        if (t_now >= t_report) {
+            printf("%.1f s\n", JSDRV_TIME_TO_F64(t_now - t_start));
+            report(s, 1.0);
+            t_report += JSDRV_TIME_SECOND;
+        }
+        if (t_now >= t_end) {
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < s->device_count; ++i) {
+        device_stop(s, &s->devices[i]);
+    }
+    if (s->depth) {
+        jsdrv_unsubscribe(self->context, JSDRV_MSG_STATS_QUEUE, on_queue_stats, s, JSDRV_TIMEOUT_MS_DEFAULT);
+    }
+    return rc;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+#include "jsdrv/topic.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+
+#define SIGNALS_DEFAULT     "i,v,p"
+#define IDLE_TIMEOUT        (JSDRV_TIME_SECOND)  // end when data stops, such as a finished replay
+
+struct throughput_s {
+    volatile uint64_t samples;
+    volatile uint64_t messages;
+    volatile int64_t latency_sum;
+    volatile int64_t latency_max;
+    volatile int64_t time_last;
+};
+
+static struct throughput_s throughput_;
+
+static int usage(void) {
+    printf("usage: jsdrv_util throughput [<option> <value>] ... [<device_filter>]\n"
+           "\n"
+           "Stream from a device and report the sustained sample rate\n"
+           "and the latency from USB completion to the subscriber.\n"
+           "Use with --replay to benchmark the driver with captured traffic.\n"
+           "\n"
+           "Options:\n"
+           "    --duration      The maximum duration in milliseconds.\n"
+           "                    0 (default) runs until CTRL-C or the data stops.\n"
+           "    --signals       The comma-separated signals, default " SIGNALS_DEFAULT "\n"
+           "\n");
+    return 1;
+}
+
+static void on_data(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) user_data;
+    if ((value->app != JSDRV_PAYLOAD_TYPE_STREAM) || !jsdrv_cstr_ends_with(topic, "/!data")) {
+        return;
+    }
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) value->value.bin;
+    int64_t t_now = jsdrv_time_utc();
+    throughput_.samples += s->element_count;
+    ++throughput_.messages;
+    if (s->host_time.usb) {
+        int64_t latency = t_now - s->host_time.usb;
+        throughput_.latency_sum += latency;
+        if (latency > throughput_.latency_max) {
+            throughput_.latency_max = latency;
+        }
+    }
+    throughput_.time_last = t_now;
+}
+
+static int32_t signals_ctrl(struct app_s * self, const char * signals, uint32_t enable) {
+    char buf[64];
+    struct jsdrv_topic_s t;
+    const char * p = signals;
+    while (*p) {
+        size_t sz = strcspn(p, ",");
+        if ((sz == 0) || (sz >= (sizeof(buf) - 8))) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        memcpy(buf, p, sz);
+        memcpy(buf + sz, "/ctrl", 6);
+        jsdrv_topic_set(&t, self->device.topic);
+        jsdrv_topic_append(&t, "s");
+        jsdrv_topic_append(&t, buf);
+        int32_t rc = jsdrv_publish(self->context, t.topic, &jsdrv_union_u32_r(enable), JSDRV_TIMEOUT_MS_DEFAULT);
+        if (rc && enable) {
+            printf("publish %s failed with %d\n", t.topic, (int) rc);
+            return rc;
+        }
+        p += sz;
+        if (*p) {
+            ++p;
+        }
+    }
+    return 0;
+}
+
+static void report(const char * label, double duration, uint64_t samples, uint64_t messages,
+                   int64_t latency_sum, int64_t latency_max) {
+    double latency_mean = messages ? (JSDRV_TIME_TO_F64(latency_sum) / (double) messages) : 0.0;
+    printf("%s %8.3f s: %8.3f Msps, %8" PRIu64 " messages, latency mean %.3f ms, max %.3f ms\n",
+           label, duration, (duration > 0.0) ? (samples / duration * 1e-6) : 0.0, messages,
+           latency_mean * 1000.0, JSDRV_TIME_TO_F64(latency_max) * 1000.0);
+}
+
+int on_throughput(struct app_s * self, int argc, char * argv[]) {
+    const char * signals = SIGNALS_DEFAULT;
+    const char * filter = NULL;
+    while (argc) {
+        if (argv[0][0] != '-') {
+            filter = argv[0];
+            ARG_CONSUME();
+        } else if (0 == strcmp(argv[0], "--duration")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            ROE(jsdrv_cstr_to_u32(argv[0], &self->duration_ms));
+            ARG_CONSUME();
+        } else if (0 == strcmp(argv[0], "--signals")) {
+            ARG_CONSUME();
+            ARG_REQUIRE();
+            signals = argv[0];
+            ARG_CONSUME();
+        } else {
+            return usage();
+        }
+    }
+
+    ROE(app_match(self, filter));
+    char * device = self->device.topic;
+    printf("throughput %s signals=%s\n", device, signals);
+    memset(&throughput_, 0, sizeof(throughput_));
+    ROE(jsdrv_open(self->context, device, JSDRV_DEVICE_OPEN_MODE_DEFAULTS));
+    ROE(jsdrv_subscribe(self->context, device, JSDRV_SFLAG_PUB, on_data, self, JSDRV_TIMEOUT_MS_DEFAULT));
+    int32_t rc = signals_ctrl(self, signals, 1);
+
+    int64_t t_start = jsdrv_time_utc();
+    int64_t t_end = self->duration_ms ? (t_start + JSDRV_TIME_MILLISECOND * (int64_t) self->duration_ms) : INT64_MAX;
+    int64_t t_report = t_start + JSDRV_TIME_SECOND;
+    uint64_t samples_prev = 0;
+    uint64_t messages_prev = 0;
+    int64_t latency_sum_prev = 0;
+    while (!rc && !quit_) {
+        jsdrv_thread_sleep_ms(10);
+        int64_t t_now = jsdrv_time_utc();
+        int64_t time_last = throughput_.time_last;
+        if ((t_now >= t_end) || (time_last && ((t_now - time_last) > IDLE_TIMEOUT))) {
+            break;
+        }
+        if (t_now >= t_report) {
+            uint64_t samples = throughput_.samples;
+            uint64_t messages = throughput_.messages;
+            int64_t latency_sum = throughput_.latency_sum;
+            report("  ", JSDRV_TIME_TO_F64(JSDRV_TIME_SECOND), samples - samples_prev,
+                   messages - messages_prev, latency_sum - latency_sum_prev, throughput_.latency_max);
+            samples_prev = samples;
+            messages_prev = messages;
+            latency_sum_prev = latency_sum;
+            t_report += JSDRV_TIME_SECOND;
+        }
+    }
+
+    signals_ctrl(self, signals, 0);
+    jsdrv_unsubscribe(self->context, device, on_data, self, JSDRV_TIMEOUT_MS_DEFAULT);
+    jsdrv_close(self->context, device);
+    int64_t t_stop = throughput_.time_last ? throughput_.time_last : jsdrv_time_utc();
+    report("total", JSDRV_TIME_TO_F64(t_stop - t_start), throughput_.samples, throughput_.messages,
+           throughput_.latency_sum, throughput_.latency_max);
+    return rc;
+}
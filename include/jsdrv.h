@@ -26,6 +26,7 @@
 #include "jsdrv/cmacro_inc.h"
 #include "jsdrv/union.h"
 #include "jsdrv/time.h"
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -125,7 +126,7 @@
 /// The maximum size for normal PubSub messages
 #define JSDRV_PAYLOAD_LENGTH_MAX        (1024U)
 /// The header size of jsdrv_stream_signal_s before the data field.
-#define JSDRV_STREAM_HEADER_SIZE        (48U)
+#define JSDRV_STREAM_HEADER_SIZE        (72U)
 /// The size of data in jsdrv_stream_signal_s.
 #define JSDRV_STREAM_DATA_SIZE          (1024 * 64)    // 64 kB max
 
@@ -182,6 +183,92 @@
 #define JSDRV_MSG_FINALIZE              "@/!final"      // CAUTION: internal use only
 #define JSDRV_MSG_VERSION               "@/version"     ///< Driver version: subscribe only JSDRV version (u32)
 #define JSDRV_MSG_TIMEOUT               "@/timeout"     ///< UnhandledDriver version: subscribe only JSDRV version (u32)
+#define JSDRV_MSG_STATS_MEM             "@/stats/mem"   ///< Message pool statistics: subscribe only JSON, see JSDRV_ARG_STATS_MEM_INTERVAL
+#define JSDRV_MSG_STATS_QUEUE           "@/stats/queue" ///< Subscriber queue statistics: subscribe only JSON, see jsdrv_subscribe_queue()
+#define JSDRV_MSG_STATS_TOPIC           "@/stats/topic" ///< Per-topic pubsub statistics: subscribe only JSON, see JSDRV_MSG_STATS_TOPIC_REQ
+#define JSDRV_MSG_STATS_THREADS         "@/stats/threads" ///< Thread CPU and queue depth statistics: subscribe only JSON, see JSDRV_ARG_STATS_THREADS_INTERVAL
+#define JSDRV_MSG_CPU_ISA               "@/cpu/isa"     ///< Selected SIMD instruction set: subscribe only str, see JSDRV_ARG_CPU_ISA
+/**
+ * @brief Request per-topic pubsub statistics (u32).
+ *
+ * Publish 1 to enable counting.  While enabled, each publish of 1
+ * updates JSDRV_MSG_STATS_TOPIC with the statistics since the
+ * previous request and resets the counters.  Publish 0 to disable.
+ * The JSON list contains up to 16 topics sorted by the time spent
+ * in subscriber callbacks, with "topic", "messages", "bytes", "calls",
+ * "total_us", "avg_us", and "max_us" for each.  Use "messages" and
+ * "bytes" with the request interval to compute rates.
+ */
+#define JSDRV_MSG_STATS_TOPIC_REQ       "@/!stats"
+
+/**
+ * @brief Set a module log level (i32).
+ *
+ * Append the module name, such as "@/log/level/js220".
+ * See jsdrv_log_module_level_set() for the module names.
+ */
+#define JSDRV_MSG_LOG_LEVEL_PREFIX      "@/log/level/"
+
+/**
+ * @brief Start or stop driver tracing (u32).
+ *
+ * Publish 1 to clear any previous events and start recording, or 0 to
+ * stop.  The driver records begin and end events for USB bulk in
+ * completion, device stream processing, pubsub subscriber callbacks,
+ * and buffer ingest, along with an instant event for each backend send.
+ * Each thread records to its own ring of recent events.
+ */
+#define JSDRV_MSG_TRACE_ENABLE          "@/trace/enable"
+
+/**
+ * @brief Export the recorded trace events (str).
+ *
+ * Publish the output file path.  The file uses the Chrome trace event
+ * JSON format, which chrome://tracing and https://ui.perfetto.dev load.
+ */
+#define JSDRV_MSG_TRACE_EXPORT          "@/!trace"
+
+/**
+ * @brief The device group topic prefix.
+ *
+ * A device group sends the same command to several instruments in
+ * one frontend operation, which reduces the skew between them.
+ * Group topics are "@/group/{name}/{subtopic}":
+ * - JSDRV_GROUP_ADD (str): Add a device prefix, creating the group
+ *   as needed.
+ * - JSDRV_GROUP_REMOVE (str): Remove a device prefix, or "" to remove
+ *   the group.
+ * - JSDRV_GROUP_LIST: subscribe only comma-separated member list,
+ *   updated with each add & remove.
+ * - JSDRV_GROUP_START: subscribe only JSON start window, see below.
+ * - All other subtopics publish to "{member}/{subtopic}" for each
+ *   member.  The device threads receive their commands back to back.
+ *   The return code is the first member error once all members respond.
+ *
+ * Enabling a stream, such as "@/group/{name}/s/i/ctrl" = 1, also
+ * requests the start window.  Once each member delivers its first
+ * data for that stream, the driver publishes JSDRV_GROUP_START with
+ * "utc", the time64 from which all members have data, "skew", the
+ * time64 spread between the member first samples, and "devices", which
+ * lists each "device" with its first "sample_id" and the
+ * "sample_id_start" that corresponds to "utc".
+ *
+ * The group also sums the member statistics for multi-rail power
+ * measurements.  When every member has published a statistics block
+ * for the same period, matched by UTC, the driver publishes one
+ * jsdrv_statistics_s to JSDRV_GROUP_STATS.  Current, power, charge,
+ * and energy are the member sums, and voltage combines the members.
+ * Enable the member statistics, such as "@/group/{name}/s/stats/ctrl" = 1,
+ * with the same "s/stats/scnt" for every member.
+ */
+#define JSDRV_MSG_GROUP_PREFIX          "@/group/"
+#define JSDRV_GROUP_ADD                 "!add"          ///< Device group subtopic to add a member (str)
+#define JSDRV_GROUP_REMOVE              "!remove"       ///< Device group subtopic to remove a member (str)
+#define JSDRV_GROUP_LIST                "list"          ///< Device group subtopic for the member list (str)
+#define JSDRV_GROUP_START               "start"         ///< Device group subtopic for the start window (json)
+#define JSDRV_GROUP_STATS_TOPIC         "stats/topic"   ///< Device group subtopic for the member statistics subtopic, default "s/stats/value", "" to disable (str)
+#define JSDRV_GROUP_STATS               "stats/value"   ///< Device group subtopic for the aggregate statistics (jsdrv_statistics_s)
+#define JSDRV_GROUP_MEMBER_MAX          (16U)           ///< The maximum devices in each device group
 
 
 // device-specific commands in format {device}/{command}
@@ -215,6 +302,20 @@ struct jsdrv_context_s;
  */
 typedef void (*jsdrv_subscribe_fn)(void * user_data, const char * topic, const struct jsdrv_union_s * value);
 
+/**
+ * @brief Function called when an asynchronous operation completes.
+ *
+ * @param user_data The arbitrary user data.
+ * @param topic The topic for the completed operation.
+ * @param return_code The operation return code, which is
+ *      #JSDRV_ERROR_TIMED_OUT on timeout and #JSDRV_ERROR_ABORTED
+ *      when the driver finalizes with the operation in progress.
+ *
+ * This function will be called from the Joulescope driver frontend thread
+ * exactly once for each operation.  The function must not block.
+ */
+typedef void (*jsdrv_completion_fn)(void * user_data, const char * topic, int32_t return_code);
+
 /**
  * @brief The payload type for jsdrv_union_s.app.
  */
@@ -225,6 +326,13 @@ enum jsdrv_payload_type_e {
     JSDRV_PAYLOAD_TYPE_BUFFER_INFO  = 3,    // bin with jsdrv_buffer_info_s
     JSDRV_PAYLOAD_TYPE_BUFFER_REQ   = 4,    // bin with jsdrv_buffer_request_s
     JSDRV_PAYLOAD_TYPE_BUFFER_RSP   = 5,    // bin with jsdrv_buffer_response_s
+    JSDRV_PAYLOAD_TYPE_BUFFER_REQ_MULTI = 6,  // bin with jsdrv_buffer_request_multi_s
+    JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI = 7,  // bin with jsdrv_buffer_response_multi_s
+    JSDRV_PAYLOAD_TYPE_BUFFER_SEARCH = 8,     // bin with jsdrv_buffer_search_s
+    JSDRV_PAYLOAD_TYPE_ALIGN        = 9,    // bin with jsdrv_align_block_s
+    JSDRV_PAYLOAD_TYPE_SPECTRUM     = 10,   // bin with jsdrv_spectrum_s
+    JSDRV_PAYLOAD_TYPE_INTERVAL     = 11,   // bin with jsdrv_interval_s
+    JSDRV_PAYLOAD_TYPE_QUANTILES    = 12,   // bin with jsdrv_quantiles_s
 };
 
 /**
@@ -237,6 +345,7 @@ enum jsdrv_element_type_e {
     JSDRV_DATA_TYPE_INT = 2,
     JSDRV_DATA_TYPE_UINT = 3,
     JSDRV_DATA_TYPE_FLOAT = 4,
+    JSDRV_DATA_TYPE_HOLD = 16,  ///< A single jsdrv_stream_hold_s replacing float32 samples.
 };
 
 /**
@@ -249,10 +358,28 @@ enum jsdrv_field_e {
     JSDRV_FIELD_CURRENT   = 1,
     JSDRV_FIELD_VOLTAGE   = 2,
     JSDRV_FIELD_POWER     = 3,
-    JSDRV_FIELD_RANGE     = 4, // 0=current, 1=voltage
+    JSDRV_FIELD_RANGE     = 4, // 0=current, 1=voltage, jsdrv_edge_s events when element_type is undefined
     JSDRV_FIELD_GPI       = 5,
     JSDRV_FIELD_UART      = 6,
     JSDRV_FIELD_RAW       = 7,
+    JSDRV_FIELD_CHARGE    = 8, // host-side cumulative, float64
+    JSDRV_FIELD_ENERGY    = 9, // host-side cumulative, float64
+    JSDRV_FIELD_RMS       = 10, // host-side windowed, 0=current
+    JSDRV_FIELD_SUMMARY   = 11, // host-side windowed jsdrv_summary_entry_s, 0=current, 1=voltage, 2=power
+    JSDRV_FIELD_EDGE      = 12, // host-side jsdrv_edge_s events, index is the GPI index
+};
+
+/**
+ * @brief The host timestamps for a stream message.
+ *
+ * Each value is a jsdrv_time_utc() time, or 0 when unavailable.
+ * The difference between publish and usb is the end-to-end host
+ * latency for the first sample in the message.
+ */
+struct jsdrv_stream_host_time_s {
+    int64_t usb;                            ///< The USB completion time for the first sample.
+    int64_t dispatch;                       ///< The time that the device driver sent the message.
+    int64_t publish;                        ///< The time that the frontend published the message.
 };
 
 /**
@@ -268,9 +395,38 @@ struct jsdrv_stream_signal_s {
     uint32_t sample_rate;                   ///< The frequency for sample_id.
     uint32_t decimate_factor;               ///< The decimation factor from sample_id to data samples.
     struct jsdrv_time_map_s time_map;       ///< The time map between sample_id (before decimate_factor) and UTC.
+    struct jsdrv_stream_host_time_s host_time;  ///< The host timestamps for latency measurement.
     uint8_t data[JSDRV_STREAM_DATA_SIZE];   ///< The channel data.
 };
 
+/**
+ * @brief A constant-signal hold record for a float32 stream.
+ *
+ * When a stream enables deadband suppression, the driver replaces runs of
+ * samples that stay within the tolerance band with hold records.  The
+ * jsdrv_stream_signal_s has element_type #JSDRV_DATA_TYPE_HOLD,
+ * element_size_bits 192, element_count 1, and this structure in data.
+ * The record replaces the sample_count samples starting at the message
+ * sample_id, so the next message starts at
+ * sample_id + sample_count * decimate_factor.
+ *
+ * The driver's own stream consumers expand hold records to sample_count
+ * copies of mean (or use min, max and mean directly): the stream buffer
+ * and its trigger, the recorder and recorder reader, the interval
+ * integrator, the stream ring reader, the aligner, the spectrum analyzer,
+ * and the Python and node.js data callbacks.  The bindings add a "hold"
+ * entry with these fields.  Applications that subscribe to
+ * s/{i,v,p}/!data directly with deadband enabled must handle this
+ * element_type themselves.
+ */
+struct jsdrv_stream_hold_s {
+    uint64_t sample_count;      ///< The number of samples replaced, after decimate_factor.
+    float min;                  ///< The minimum sample value.
+    float max;                  ///< The maximum sample value.
+    float mean;                 ///< The mean sample value.
+    uint32_t rsv_u32;           ///< Reserved, 0.
+};
+
 /**
  * @brief The payload data structure for statistics updates.
  */
@@ -303,6 +459,29 @@ struct jsdrv_statistics_s {
     struct jsdrv_time_map_s time_map;  ///< The time map between sample_id and UTC.
 };
 
+/// The number of quantiles in jsdrv_quantiles_s.
+#define JSDRV_QUANTILES_COUNT (4)
+
+/**
+ * @brief The tail quantiles for one statistics block.
+ *
+ * Each array holds the 50th, 90th, 99th, and 99.9th percentiles.
+ * The estimates come from log-spaced bins with about 1.6% relative
+ * error, and they never exceed the block's minimum or maximum.
+ * NaN samples do not contribute.
+ */
+struct jsdrv_quantiles_s {
+    uint64_t block_sample_id;    ///< First sample in this block, matching jsdrv_statistics_s.
+    uint32_t block_sample_count; ///< Samples used to compute this block, in decimated samples.
+    uint32_t sample_freq;        ///< The samples per second for block_sample_id (undecimated).
+    uint32_t decimate_factor;    ///< The decimate factor from sample_id to calculated samples.
+    uint32_t rsv;                ///< Reserved = 0
+    float i[JSDRV_QUANTILES_COUNT];  ///< The current quantiles in A.
+    float v[JSDRV_QUANTILES_COUNT];  ///< The voltage quantiles in V.
+    float p[JSDRV_QUANTILES_COUNT];  ///< The power quantiles in W.
+    struct jsdrv_time_map_s time_map;  ///< The time map between sample_id and UTC.
+};
+
 /**
  * @brief The time specification type.
  */
@@ -391,25 +570,88 @@ union jsdrv_buffer_request_time_range_u {
  *       sample_id_incr = (sample_id_end - sample_id_start) / (length - 1)
  *
  * The buffer implementation may deduplicate requests using
- * the combination rsp_topic and rsp_id.
+ * the combination rsp_topic and rsp_id.  Publish the rsp_topic to the
+ * buffer's "g/!cancel" to discard its pending requests.
+ *
+ * A single response holds at most one message of data.  Without
+ * JSDRV_BUFFER_REQUEST_FLAG_CHUNKED, the buffer truncates longer sample
+ * requests and rejects longer summary requests.  With the flag, the
+ * buffer responds with a sequence of responses that share rsp_id, and
+ * sets JSDRV_BUFFER_RESPONSE_FLAG_END in the final response.
+ *
+ * For a float32 sample request with sample_rate below the buffer's
+ * sample rate, the buffer filters and decimates the range with the
+ * same flat passband downsampler used for streaming, and responds with
+ * JSDRV_BUFFER_RESPONSE_RESAMPLED.  The filter starts before the
+ * requested range, when the buffer holds those samples, so the
+ * response excludes the filter startup transient.
  */
 struct jsdrv_buffer_request_s {
     uint8_t version;                     ///< The request format version == 1.
     int8_t time_type;                    ///< jsdrv_time_type_e
-    uint8_t rsv1_u8;                     ///< Reserved, set to 0.
+    uint8_t flags;                       ///< jsdrv_buffer_request_flag_e bitmap, 0 for none.
     uint8_t rsv2_u8;                     ///< Reserved, set to 0.
-    uint32_t rsv3_u32;                   ///< Reserved, set to 0.
+    uint32_t sample_rate;                ///< The sample request output rate, 0 for the buffer rate.
     union jsdrv_buffer_request_time_range_u time;
     char rsp_topic[JSDRV_TOPIC_LENGTH_MAX]; ///< The topic for this response.
     int64_t rsp_id;                         ///< The additional identifier to include in the response.
 };
 
+/**
+ * @brief The buffer request flags.
+ */
+enum jsdrv_buffer_request_flag_e {
+    /// Respond with as many responses as needed for the full request.
+    JSDRV_BUFFER_REQUEST_FLAG_CHUNKED = (1 << 0),
+    /// Return 1-bit and 4-bit samples as one uint8 per sample.
+    JSDRV_BUFFER_REQUEST_FLAG_UNPACK = (1 << 1),
+    /**
+     * @brief Snap summary requests to tiles and prefetch the neighbors.
+     *
+     * The response rounds the increment up to a power of two and
+     * aligns the start to the increment, so check
+     * info.time_range_samples for the actual range.  After responding,
+     * the buffer computes the next, previous, parent and child tiles
+     * until another request arrives, so that pans and zooms reuse them.
+     * Only single signal requests prefetch.
+     */
+    JSDRV_BUFFER_REQUEST_FLAG_TILE = (1 << 2),
+    /**
+     * @brief Drop all older requests with the same rsp_topic.
+     *
+     * The buffer discards the pending requests for rsp_topic, for any
+     * signal and rsp_id, and stops their chunked responses before
+     * queueing this request.  Use this flag for views that only
+     * display the newest request, such as while scrolling.
+     */
+    JSDRV_BUFFER_REQUEST_FLAG_SUPERSEDE = (1 << 3),
+    /**
+     * @brief Process after all pending interactive requests.
+     *
+     * Requests without this flag are interactive, and the buffer
+     * processes them before any pending background requests, such as
+     * exports.  Requests with the same priority process in order.
+     */
+    JSDRV_BUFFER_REQUEST_FLAG_BACKGROUND = (1 << 4),
+};
+
+/**
+ * @brief The buffer response flags.
+ */
+enum jsdrv_buffer_response_flag_e {
+    /// The final response for the request.
+    JSDRV_BUFFER_RESPONSE_FLAG_END = (1 << 0),
+};
+
 /**
  * @brief The buffer response type.
  */
 enum jsdrv_buffer_response_type_e {
     JSDRV_BUFFER_RESPONSE_SAMPLES = 1,   ///< Data contains samples.
     JSDRV_BUFFER_RESPONSE_SUMMARY = 2,   ///< Data contains summary statistics.
+    JSDRV_BUFFER_RESPONSE_RESAMPLED = 3, ///< Data contains filtered, decimated float32 samples.
+    JSDRV_BUFFER_RESPONSE_SEARCH = 4,    ///< Data contains uint64 sample_id search hits.
+    JSDRV_BUFFER_RESPONSE_STATISTICS = 5,///< Data contains one jsdrv_statistics_s.
 };
 
 /**
@@ -422,6 +664,18 @@ struct jsdrv_summary_entry_s {
     float max;                  ///< The minimum value over the window.
 };
 
+/**
+ * @brief A single level change event for a general-purpose input
+ *      or the current range.
+ */
+struct jsdrv_edge_s {
+    uint64_t sample_id;         ///< The sample_id of the first sample at the new level.
+    uint8_t level;              ///< The new level, 0 or 1 for GPI, the range for current range.
+    uint8_t rsv1_u8;            ///< Reserved, set to 0.
+    uint16_t rsv2_u16;          ///< Reserved, set to 0.
+    uint32_t rsv3_u32;          ///< Reserved, set to 0.
+};
+
 /**
  * @brief The response to jsdrv_buffer_request_s produced by the memory buffer.
  *
@@ -434,11 +688,25 @@ struct jsdrv_summary_entry_s {
  *
  * For response_type JSDRV_BUFFER_RESPONSE_SAMPLES, the data type depends
  * upon info.element_type and info.element_size_bits.
+ *
+ * For response_type JSDRV_BUFFER_RESPONSE_RESAMPLED, the data is
+ * float[info.time_range_samples.length] evenly spaced from
+ * info.time_range_samples.start to info.time_range_samples.end.
+ *
+ * For response_type JSDRV_BUFFER_RESPONSE_SEARCH, the data is
+ * uint64_t[info.time_range_samples.length] hit sample_ids in increasing
+ * order, and info.time_range_samples.start and end give the searched
+ * samples.
+ *
+ * For response_type JSDRV_BUFFER_RESPONSE_STATISTICS, the data is
+ * one jsdrv_statistics_s over info.time_range_samples.start to end.
+ * info.element_size_bits is 8, and info.time_range_samples.length is
+ * sizeof(jsdrv_statistics_s).
  */
 struct jsdrv_buffer_response_s {
     uint8_t version;                        ///< The response format version == 1.
     uint8_t response_type;                  ///< jsdrv_buffer_response_type_e
-    uint8_t rsv1_u8;                        ///< Reserved, set to 0.
+    uint8_t flags;                          ///< jsdrv_buffer_response_flag_e bitmap.
     uint8_t rsv2_u8;                        ///< Reserved, set to 0.
     uint32_t rsv3_u32;                      ///< Reserved, set to 0.
     int64_t rsp_id;                         ///< The value provided to jsdrv_buffer_request_s.
@@ -462,6 +730,245 @@ struct jsdrv_buffer_response_s {
     uint64_t data[];
 };
 
+/// The maximum number of signals in jsdrv_buffer_request_multi_s.
+#define JSDRV_BUFFER_REQUEST_SIGNALS_MAX (8U)
+
+/**
+ * @brief Request aligned data for multiple signals in one memory buffer.
+ *
+ * Publish to the buffer's "g/!req" topic.  The buffer converts
+ * req.time to sample_id using the first signal, then processes req for
+ * every signal on that same sample_id grid.  Sample requests return the
+ * same sample_id range for every signal, clipped to the samples that all
+ * signals hold.  All signals must share the same sample rate.
+ *
+ * The buffer responds with one jsdrv_buffer_response_multi_s message
+ * to req.rsp_topic.  The combined response holds at most one message
+ * of data, so the buffer truncates longer sample requests and rejects
+ * longer summary requests.  JSDRV_BUFFER_REQUEST_FLAG_CHUNKED is not
+ * supported.
+ *
+ * Publish to the buffer's "g/!stats" topic instead for the statistics
+ * over the req range, clipped to the samples that all signals hold.
+ * The signals must be current, voltage, and/or power, at most one of
+ * each.  The buffer responds with one JSDRV_BUFFER_RESPONSE_STATISTICS
+ * jsdrv_buffer_response_s.  The jsdrv_statistics_s holds NaN for
+ * fields without a signal, and the charge and energy integrate over
+ * the range.  Only the partial summary entries at the range edges read
+ * level 0 samples, so long ranges compute quickly.  Complete entries
+ * contribute their float32 summaries.
+ */
+struct jsdrv_buffer_request_multi_s {
+    struct jsdrv_buffer_request_s req;   ///< The request for every signal.
+    uint8_t signal_count;                ///< The number of signal_ids.
+    uint8_t rsv1_u8;                     ///< Reserved, set to 0.
+    uint16_t rsv2_u16;                   ///< Reserved, set to 0.
+    uint32_t rsv3_u32;                   ///< Reserved, set to 0.
+    uint8_t signal_ids[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];  ///< The buffer signal ids.
+};
+
+/**
+ * @brief The response to jsdrv_buffer_request_multi_s.
+ *
+ * The data holds signal_count jsdrv_buffer_response_s, one for each
+ * requested signal in order.  Each response starts on an 8-byte
+ * boundary and occupies offsetof(jsdrv_buffer_response_s, data) plus
+ * its data size rounded up to a multiple of 8 bytes.
+ */
+struct jsdrv_buffer_response_multi_s {
+    uint8_t version;                        ///< The response format version == 1.
+    uint8_t signal_count;                   ///< The number of responses in data.
+    uint16_t rsv2_u16;                      ///< Reserved, set to 0.
+    uint32_t rsv3_u32;                      ///< Reserved, set to 0.
+    int64_t rsp_id;                         ///< The value provided to jsdrv_buffer_request_s.
+    uint64_t data[];                        ///< The jsdrv_buffer_response_s sequence.
+};
+
+/**
+ * @brief The buffer search operations.
+ */
+enum jsdrv_buffer_search_op_e {
+    /// The samples that rise above the threshold from the previous sample.
+    JSDRV_BUFFER_SEARCH_RISE = 1,
+    /// The samples that fall to or below the threshold from the previous sample.
+    JSDRV_BUFFER_SEARCH_FALL = 2,
+    /// Both JSDRV_BUFFER_SEARCH_RISE and JSDRV_BUFFER_SEARCH_FALL.
+    JSDRV_BUFFER_SEARCH_CROSS = 3,
+    /// The first sample with the maximum value.
+    JSDRV_BUFFER_SEARCH_MAX = 4,
+    /// The first sample with the minimum value.
+    JSDRV_BUFFER_SEARCH_MIN = 5,
+};
+
+/**
+ * @brief Search a float32 signal in the memory buffer.
+ *
+ * Publish to the signal's "s/NNN/!search" topic.  The buffer descends
+ * the summary levels and skips every entry whose minimum and maximum
+ * exclude a hit, so it only reads the samples near each hit.  Set
+ * req.time.*.end and req.time.*.length to 0 to search through the
+ * newest sample.  The buffer ignores req.flags and req.sample_rate.
+ *
+ * The buffer responds with JSDRV_BUFFER_RESPONSE_SEARCH.  When the
+ * search stops at hits_max, info.time_range_samples.end is the last
+ * hit, so the next search can start from the following sample.
+ * Before a level 0 horizon, the search resolves to level 1 entries
+ * using their average.
+ */
+struct jsdrv_buffer_search_s {
+    struct jsdrv_buffer_request_s req;   ///< The time range, rsp_topic, and rsp_id.
+    uint8_t op;                          ///< jsdrv_buffer_search_op_e
+    uint8_t rsv1_u8;                     ///< Reserved, set to 0.
+    uint16_t rsv2_u16;                   ///< Reserved, set to 0.
+    float threshold;                     ///< The threshold for RISE, FALL, and CROSS.
+    uint32_t hits_max;                   ///< The maximum hits, 0 for as many as fit one response.
+    uint32_t rsv3_u32;                   ///< Reserved, set to 0.
+};
+
+/**
+ * @brief The buffer trigger modes.
+ */
+enum jsdrv_buffer_trigger_mode_e {
+    /// Disable the trigger.
+    JSDRV_BUFFER_TRIGGER_MODE_OFF = 0,
+    /// Respond to the next trigger, then turn off.
+    JSDRV_BUFFER_TRIGGER_MODE_SINGLE = 1,
+    /// Respond to every trigger, rearming after each response.
+    JSDRV_BUFFER_TRIGGER_MODE_AUTO = 2,
+};
+
+/**
+ * @brief Configure the memory buffer trigger.
+ *
+ * Publish to the buffer's "g/trigger" topic.  As the buffer ingests
+ * the signal_id samples, it looks for an op edge through threshold,
+ * where RISE, FALL, and CROSS match jsdrv_buffer_search_s.  The new
+ * level must hold for duration samples, including the edge sample.
+ * NaN samples are ignored, and 1-bit and 4-bit signals, such as the
+ * general-purpose inputs, compare as 0, 1, ... against the threshold.
+ *
+ * When the trigger fires, the buffer waits until every window signal
+ * holds post samples after the edge, then responds with one
+ * jsdrv_buffer_response_multi_s to window.req.rsp_topic.  The
+ * response holds pre samples before the edge, the edge sample, and
+ * post samples after the edge, clipped to the samples held by the
+ * buffer.  rsp_id is the edge sample_id in the buffer's sample_id
+ * units, the same as info.time_range_samples, and the buffer ignores
+ * window.req.time.  Like jsdrv_buffer_request_multi_s, the response
+ * holds at most one message of data, so size pre and post for the
+ * window signals.  A trigger does not start a new window while the
+ * previous window waits for its post samples.
+ */
+struct jsdrv_buffer_trigger_s {
+    struct jsdrv_buffer_request_multi_s window;  ///< The response signals, rsp_topic, flags, and sample_rate.
+    uint8_t mode;                        ///< jsdrv_buffer_trigger_mode_e
+    uint8_t signal_id;                   ///< The buffer signal id to monitor.
+    uint8_t op;                          ///< jsdrv_buffer_search_op_e: RISE, FALL, or CROSS.
+    uint8_t rsv1_u8;                     ///< Reserved, set to 0.
+    float threshold;                     ///< The threshold.
+    uint32_t duration;                   ///< The samples the new level must hold, 0 same as 1.
+    uint32_t pre;                        ///< The samples before the edge.
+    uint32_t post;                       ///< The samples after the edge.
+    uint32_t rsv2_u32;                   ///< Reserved, set to 0.
+};
+
+/// The maximum channels in an alignment group.
+#define JSDRV_ALIGN_CHANNEL_COUNT_MAX (16U)
+
+/**
+ * @brief Time-aligned float32 samples from an alignment group.
+ *
+ * An alignment group subscribes to the stream data topics of several
+ * devices and uses each device's time map to resample every channel
+ * onto one common sample grid.  Publish the source data topic to the
+ * group's "c/ZZZ/topic", then subscribe to its "g/!data".  Channels
+ * whose samples are not available at a grid sample contain NaN.
+ */
+struct jsdrv_align_block_s {
+    uint64_t sample_id;                 ///< The first sample on the common grid.
+    uint32_t sample_rate;               ///< The common grid sample rate.
+    uint32_t sample_count;              ///< The samples for each channel.
+    uint32_t channel_count;             ///< The channels, in channel id order.
+    uint32_t channel_mask;              ///< Bit n-1 set for each channel id n in the block.
+    struct jsdrv_time_map_s time_map;   ///< The time map between sample_id and UTC.
+    float data[];                       ///< channel_count * sample_count samples, channel major.
+};
+
+/// The alignment block header size in bytes.
+#define JSDRV_ALIGN_HEADER_SIZE (48U)
+
+/// The spectrum scaling for jsdrv_spectrum_s.scale.
+enum jsdrv_spectrum_scale_e {
+    JSDRV_SPECTRUM_SCALE_DENSITY = 0,   ///< Power spectral density in units^2 / Hz.
+    JSDRV_SPECTRUM_SCALE_POWER = 1,     ///< Power spectrum in RMS units^2 for each bin.
+};
+
+/**
+ * @brief A Welch-averaged one-sided power spectrum.
+ *
+ * A spectrum analyzer subscribes to one float32 stream data topic,
+ * splits the samples into overlapping Hann-windowed segments, and
+ * averages the FFT power of each segment.  Publish the source data
+ * topic to the analyzer's "g/topic", then subscribe to its "g/!data".
+ * Bin k is at frequency k * sample_rate / fft_length.  Take the square
+ * root of JSDRV_SPECTRUM_SCALE_POWER for the RMS magnitude.
+ */
+struct jsdrv_spectrum_s {
+    uint64_t sample_id;                 ///< The first sample_id of the first averaged segment.
+    uint32_t sample_rate;               ///< The data sample rate, which is the stream sample_rate / decimate_factor.
+    uint32_t decimate_factor;           ///< The decimation factor from sample_id to data samples.
+    uint32_t fft_length;                ///< The samples in each segment.
+    uint32_t bin_count;                 ///< The bins in data, which is fft_length / 2 + 1.
+    uint32_t segment_count;             ///< The averaged segments.
+    uint8_t scale;                      ///< jsdrv_spectrum_scale_e
+    uint8_t rsv1_u8;                    ///< Reserved, set to 0.
+    uint16_t rsv2_u16;                  ///< Reserved, set to 0.
+    struct jsdrv_time_map_s time_map;   ///< The time map between sample_id and UTC.
+    float data[];                       ///< The bin_count power values.
+};
+
+/// The spectrum header size in bytes.
+#define JSDRV_SPECTRUM_HEADER_SIZE (56U)
+
+/// The flags for jsdrv_interval_s.flags.
+enum jsdrv_interval_flag_e {
+    /// Some interval samples were missing, NaN, or arrived before their marker.
+    JSDRV_INTERVAL_FLAG_PARTIAL = (1 << 0),
+};
+
+/**
+ * @brief The measurements for one marker-bounded interval.
+ *
+ * An interval integrator subscribes to a device's current and power
+ * streams along with an optional general-purpose input.  Each start
+ * marker, which is the active GPI edge or a software "g/!start", opens
+ * an interval that the next stop marker closes.  The integrator
+ * accumulates each sample as a 2**-31 fixed-point integer into a 128-bit
+ * sum, so the charge and energy are exact regardless of the interval
+ * length.  NaN samples do not contribute.
+ */
+struct jsdrv_interval_s {
+    uint64_t sample_id;                 ///< The first sample_id in the interval.
+    uint64_t sample_id_end;             ///< The sample_id just after the interval.
+    uint32_t interval_id;               ///< The interval counter, which increments for each interval.
+    uint32_t sample_rate;               ///< The frequency for sample_id.
+    uint32_t decimate_factor;           ///< The decimation factor from sample_id to data samples.
+    uint32_t flags;                     ///< The jsdrv_interval_flag_e bits.
+    uint64_t i_count;                   ///< The current samples used.
+    uint64_t p_count;                   ///< The power samples used.
+    double i_avg;                       ///< The average current in A.
+    double i_min;                       ///< The minimum current in A.
+    double i_max;                       ///< The maximum current in A.
+    double p_avg;                       ///< The average power in W.
+    double p_min;                       ///< The minimum power in W.
+    double p_max;                       ///< The peak power in W.
+    double charge_f64;                  ///< The charge in C as a 64-bit float.
+    double energy_f64;                  ///< The energy in J as a 64-bit float.
+    uint64_t charge_i128[2];            ///< The charge as a 128-bit signed integer with 2**-31 scale.
+    uint64_t energy_i128[2];            ///< The energy as a 128-bit signed integer with 2**-31 scale.
+    struct jsdrv_time_map_s time_map;   ///< The time map between sample_id and UTC.
+};
+
 /// The subscriber flags for jsdrv_subscribe().
 enum jsdrv_subscribe_flag_e {
     /// No flags (always 0).
@@ -480,13 +987,42 @@ enum jsdrv_subscribe_flag_e {
     JSDRV_SFLAG_QUERY_RSP = (1 << 5),
     /// Subscribe to receive return code messages like "a/b/c#".
     JSDRV_SFLAG_RETURN_CODE = (1 << 6),
+    /**
+     * @brief Mark a streaming topic like "a/b/!data".
+     *
+     * Combine with JSDRV_SFLAG_PUB.  Once any subscriber sets this flag,
+     * messages to the topic skip retention, metadata validation, and
+     * return codes.  Only applies to topics whose final level starts with '!'.
+     */
+    JSDRV_SFLAG_STREAM = (1 << 7),
+};
+
+/// The full subscriber queue policy for jsdrv_subscribe_queue().
+enum jsdrv_queue_policy_e {
+    /// No queue limit (default).
+    JSDRV_QUEUE_POLICY_NONE = 0,
+    /// Block the driver until space is available, then drop the oldest.
+    JSDRV_QUEUE_POLICY_BLOCK = 1,
+    /// Discard the oldest queued message.
+    JSDRV_QUEUE_POLICY_DROP_OLDEST = 2,
+    /// Discard the new message.
+    JSDRV_QUEUE_POLICY_DROP_NEWEST = 3,
+    /// Keep only the latest message, such as for statistics.  Ignores depth.
+    JSDRV_QUEUE_POLICY_COALESCE = 4,
 };
 
 /// The driver mode for device open.
 enum jsdrv_device_open_mode_e {
     /// Restore the device to its default, power-on state.
     JSDRV_DEVICE_OPEN_MODE_DEFAULTS = 0,
-    /// Update the driver with the device's existing state.
+    /**
+     * @brief Update the driver with the device's existing state.
+     *
+     * The driver remembers each device's firmware versions and values
+     * across close, removal and USB reset.  When a JS220 reopens with
+     * the same firmware, the driver skips the metadata query and logs
+     * how many values changed.
+     */
     JSDRV_DEVICE_OPEN_MODE_RESUME = 1,
     /// Low-level open only, for use by internal tools.
     JSDRV_DEVICE_OPEN_MODE_RAW = 0xFF,
@@ -500,6 +1036,190 @@ struct jsdrv_arg_s {
     struct jsdrv_union_s value;  ///< The argument value.
 };
 
+/**
+ * @brief The jsdrv_initialize() argument topics.
+ *
+ * The message pools default to 0 preallocated messages and no limit.
+ * When a pool reaches its limit, the driver allocates additional
+ * messages from the heap and frees them on release, so that a
+ * temporary backlog does not permanently increase memory usage.
+ * Set JSDRV_ARG_STATS_MEM_INTERVAL to publish JSDRV_MSG_STATS_MEM,
+ * which helps to size the pools for your application.
+ *
+ * Set JSDRV_ARG_STATS_THREADS_INTERVAL to publish JSDRV_MSG_STATS_THREADS,
+ * which helps to locate a bottleneck inside the driver.  The JSON object
+ * contains "threads", a list with the "name", total "cpu_ms", and
+ * "cpu_pct" utilization of one CPU since the previous update for each
+ * internal thread, and "queues", which maps each internal message
+ * queue name to its current depth.
+ *
+ * Set JSDRV_ARG_DISPATCH_THREADS to invoke subscriber callbacks for
+ * data messages, such as streaming samples and statistics, from a pool
+ * of worker threads.  Each device always uses the same worker, so its
+ * data remains in order, but callbacks for different devices may run
+ * concurrently.  All other callbacks remain on the frontend thread.
+ * In this mode, a data callback may still occur shortly after
+ * jsdrv_unsubscribe() returns, so keep user_data valid until
+ * jsdrv_finalize().
+ *
+ * The "@/thread/{role}/affinity" arguments restrict a driver thread role
+ * to a CPU bit mask (u64), where bit 0 is CPU 0.  The
+ * "@/thread/{role}/priority" arguments set a driver thread role priority
+ * (i32) from -2 (lowest) to 2 (highest), or 3 for real-time,
+ * which is SCHED_FIFO on POSIX and THREAD_PRIORITY_TIME_CRITICAL on Windows.
+ * Real-time priority usually requires elevated permissions.
+ * The roles are "frontend", "backend" (USB), "device", "buffer", and
+ * "dispatch".  Devices also support the "h/thread/affinity" and
+ * "h/thread/priority" topics while open.
+ *
+ * With the libusb backend (Linux and macOS), open devices also support
+ * "h/usb/bulk_in/transfers" (u32, default 4) for the outstanding bulk-in
+ * transfers per endpoint, "h/usb/bulk_in/size" (u32, default 32768) for
+ * the transfer size in bytes as a multiple of 512, and
+ * "h/usb/bulk_in/adaptive" (u32) for the maximum outstanding transfers
+ * when the backend increases the depth after latency spikes, or 0 to
+ * keep a fixed depth.
+ *
+ * While streaming, both USB backends publish per-endpoint bulk-in
+ * statistics as JSON to "h/usb/stats" once per second.  Each endpoint
+ * reports total completions, bytes, timeouts, and errors, the achieved
+ * throughput in bytes per second since the previous report, the current
+ * in-flight and upper-layer held transfers, the min/avg/max interval
+ * between completions, and the avg/max buffer residence time before
+ * the upper layer returns it.  Set "h/usb/stats/interval" (u32) to
+ * change the period in milliseconds, or 0 to disable.
+ *
+ * By default, the libusb backend handles USB events for all devices from
+ * a single thread.  Set JSDRV_ARG_USB_DEVICE_THREADS to 1 to give each
+ * device its own libusb context and event thread, which uses the
+ * "backend" thread role.  A slow control transfer or memory operation
+ * on one device then does not delay bulk-in resubmission for others.
+ *
+ * On Windows, each device thread waits on one event per bulk-in
+ * endpoint by default.  Set JSDRV_ARG_USB_IOCP_WORKERS to the number of
+ * worker threads to complete the bulk-in reads for all devices on one
+ * shared IO completion port instead.  Device threads then only wake
+ * for commands and control transfers.  With WinUSB,
+ * "h/usb/bulk_in/transfers" (u32, default 4) sets the outstanding
+ * bulk-in reads per endpoint in both modes, and "h/usb/bulk_in/size"
+ * (u32, default 32768) sets the read size as a multiple of 512 up to
+ * 1 MiB.  Bulk-in pipes use the WinUSB RAW_IO policy by default,
+ * which submits each read directly to the host controller without
+ * gaps, and limits reads to the pipe's MAXIMUM_TRANSFER_SIZE.  Set
+ * "h/usb/bulk_in/raw_io" (u32, default 1) to 0 before the stream opens
+ * to use the buffered WinUSB policy instead.
+ *
+ * For low-latency streaming, reduce "h/usb/bulk_in/size" and the device
+ * "h/stream/flush" (u32, default 50, range 1 to 1000), which is the
+ * maximum sample duration in milliseconds that each "!data" message
+ * collects before the driver sends it.  While streaming, the devices
+ * publish a latency histogram as JSON to "h/stream/latency" once per
+ * second.  The latency starts at the USB completion of the first
+ * sample in each data message and ends when the driver sends it.
+ * The frontend also publishes "h/stream/e2e" once per second,
+ * which ends when the frontend publishes the message to subscribers.
+ * Each data message carries these timestamps in
+ * jsdrv_stream_signal_s.host_time.
+ *
+ * To capture an exact window, set the device "h/stream/gate/start" and
+ * "h/stream/gate/stop" (u64 sample_id, default 0 for none) before
+ * enabling the signals.  The drivers then only deliver samples with
+ * start <= sample_id < stop, and send the message that reaches stop
+ * immediately.  "h/stream/gate/start/utc" and "h/stream/gate/stop/utc"
+ * (i64) set the same gate from UTC times using the device time map.
+ *
+ * For load testing without hardware, set JSDRV_ARG_EMULATION_DEVICES
+ * to add emulated JS220 instruments "z/js220/EMU001", "z/js220/EMU002",
+ * and so on.  Each emulated device runs its own thread that produces
+ * JS220 bulk-in frames for the enabled signals, which the normal JS220
+ * driver then processes.  JSDRV_ARG_EMULATION_RATE sets the sample rate,
+ * and the device drops samples like real hardware when the host falls
+ * behind.  JSDRV_ARG_EMULATION_SKIP and JSDRV_ARG_EMULATION_DUP
+ * induce sample_id gaps and duplicate frames.
+ *
+ * To benchmark the driver with real device traffic, set
+ * JSDRV_ARG_USB_CAPTURE to record every raw bulk-in transfer
+ * with its completion time, see jsdrv_recorder_usb_bulk_in().
+ * Later, set JSDRV_ARG_EMULATION_REPLAY to the capture path so that the
+ * emulated devices replay the first captured JS220 instead of
+ * generating frames.  The replay starts when the stream opens and
+ * only includes the enabled signals.  JSDRV_ARG_EMULATION_RATE 0 replays
+ * as fast as possible and any other value uses the captured timing.
+ *
+ * jsdrv_initialize() detects the CPU features once and selects the
+ * fastest supported instruction set for the sample processing kernels:
+ * "avx2" or "sse2" on x86, "neon" on ARM64, or "scalar".  The retained
+ * JSDRV_MSG_CPU_ISA topic reports the selection.  Set JSDRV_ARG_CPU_ISA
+ * to force a supported level, such as "scalar" to compare results or
+ * performance.  The selection applies to the entire process.
+ *
+ * By default, jsdrv_initialize() waits for every backend to scan for
+ * devices, which can take seconds with many USB devices.  Set
+ * JSDRV_ARG_INIT_LAZY to 1 to return as soon as the driver thread starts,
+ * while the backends scan in the background.  Commands addressed to a
+ * device, such as jsdrv_open(), wait for the device to appear until the
+ * scan completes.  Lazy mode also defers each device's driver thread until
+ * the first command addressed to that device, so the device topics appear
+ * then.  JSDRV_MSG_DEVICE_LIST and JSDRV_MSG_DEVICE_ADD still report every
+ * device as it is found.  Set JSDRV_ARG_DEVICE_HINT to a device prefix,
+ * such as "u/js220/000415", to add only the matching devices.  The USB
+ * backends then skip the devices of other models without opening them.
+ */
+#define JSDRV_ARG_POOL_NORMAL_INIT      "@/pool/normal/init"    ///< Preallocated normal messages (u32)
+#define JSDRV_ARG_POOL_NORMAL_MAX       "@/pool/normal/max"     ///< Maximum pooled normal messages, 0 for no limit (u32)
+#define JSDRV_ARG_POOL_DATA_INIT        "@/pool/data/init"      ///< Preallocated full-size data messages (u32)
+#define JSDRV_ARG_POOL_DATA_MAX         "@/pool/data/max"       ///< Maximum pooled data messages for each size class, 0 for no limit (u32)
+#define JSDRV_ARG_STATS_MEM_INTERVAL    "@/stats/mem/interval"  ///< JSDRV_MSG_STATS_MEM update interval in milliseconds, 0 to disable (u32)
+#define JSDRV_ARG_STATS_THREADS_INTERVAL "@/stats/threads/interval"  ///< JSDRV_MSG_STATS_THREADS update interval in milliseconds, 0 to disable (u32)
+#define JSDRV_ARG_DISPATCH_THREADS      "@/dispatch/threads"    ///< Data callback worker threads, 0 to use the frontend thread (u32)
+#define JSDRV_ARG_THREAD_PREFIX         "@/thread/"             ///< Prefix for "@/thread/{role}/affinity" (u64) and "@/thread/{role}/priority" (i32)
+#define JSDRV_ARG_USB_DEVICE_THREADS    "@/usb/device_threads"  ///< 1 for a libusb event thread for each device, 0 for one shared thread (u32)
+#define JSDRV_ARG_USB_IOCP_WORKERS      "@/usb/iocp_workers"    ///< WinUSB bulk-in completion port worker threads, 0 for per-device events (u32)
+#define JSDRV_ARG_USB_CAPTURE           "@/usb/capture"         ///< Capture raw bulk-in transfers to this file path (str)
+#define JSDRV_ARG_EMULATION_DEVICES    "@/emulation/devices"   ///< Emulated JS220 devices, 0 to disable (u32)
+#define JSDRV_ARG_EMULATION_RATE       "@/emulation/rate"      ///< Emulated sample rate, default 2000000, 0 for as fast as possible (u32)
+#define JSDRV_ARG_EMULATION_SKIP       "@/emulation/skip"      ///< Drop one stream frame in every N, 0 to disable (u32)
+#define JSDRV_ARG_EMULATION_DUP        "@/emulation/dup"       ///< Repeat one stream frame in every N, 0 to disable (u32)
+#define JSDRV_ARG_EMULATION_REPLAY     "@/emulation/replay"    ///< Replay this JSDRV_ARG_USB_CAPTURE file path (str)
+#define JSDRV_ARG_CPU_ISA               "@/cpu/isa/force"       ///< Force the SIMD instruction set: "scalar", "sse2", "avx2", or "neon" (str)
+#define JSDRV_ARG_INIT_LAZY             "@/init/lazy"           ///< 1 to return before the device scan completes and defer device threads (u32)
+#define JSDRV_ARG_DEVICE_HINT           "@/init/device"         ///< Only add devices whose prefix starts with this value (str)
+
+/**
+ * @brief The application-provided memory allocator.
+ *
+ * The driver calls these functions from many threads, so they must be
+ * thread-safe.  Set alloc_aligned to NULL to over-allocate from alloc
+ * instead.
+ */
+struct jsdrv_allocator_s {
+    /// Allocate size_bytes, return NULL on out of memory.
+    void * (*alloc)(void * user_data, size_t size_bytes);
+    /// Free memory from alloc.
+    void (*free)(void * user_data, void * ptr);
+    /// Optional: allocate size_bytes at a power of 2 alignment, return NULL on out of memory.
+    void * (*alloc_aligned)(void * user_data, size_t size_bytes, size_t alignment);
+    /// Free memory from alloc_aligned, required when alloc_aligned is provided.
+    void (*free_aligned)(void * user_data, void * ptr);
+    /// The arbitrary data for each function.
+    void * user_data;
+};
+
+/**
+ * @brief Set the memory allocator for all driver allocations.
+ *
+ * @param allocator The allocator, which the driver copies, or NULL
+ *      to restore the C runtime heap.
+ * @return 0 or error code.  Return JSDRV_ERROR_BUSY while the driver
+ *      holds any memory from the current allocator.
+ *
+ * The allocator applies to the entire process.  Call this function
+ * before jsdrv_log_initialize() and jsdrv_initialize(), or after
+ * jsdrv_finalize() and jsdrv_log_finalize().  The driver allocates sample
+ * data, including buffer memory and data messages, at a 64 byte alignment.
+ */
+JSDRV_API int32_t jsdrv_allocator_set(const struct jsdrv_allocator_s * allocator);
+
 /**
  * @brief Initialize the Joulescope driver (synchronous).
  *
@@ -548,6 +1268,46 @@ JSDRV_API int32_t jsdrv_publish(struct jsdrv_context_s * context,
         const char * topic, const struct jsdrv_union_s * value,
         uint32_t timeout_ms);
 
+/**
+ * @brief Publish a new value and invoke a callback on completion.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The topic to publish.
+ * @param value The new topic value.
+ * @param timeout_ms The operation timeout.  0 uses #JSDRV_TIMEOUT_MS_DEFAULT.
+ * @param cbk_fn The function to call with the return code.
+ *      NULL is equivalent to jsdrv_publish() with timeout_ms 0.
+ * @param cbk_user_data The arbitrary data for cbk_fn.
+ * @return 0 or #JSDRV_ERROR_PARAMETER_INVALID.
+ *
+ * This function never blocks, and it may be called from any thread,
+ * including subscriber and completion callbacks.
+ */
+JSDRV_API int32_t jsdrv_publish_async(struct jsdrv_context_s * context,
+        const char * topic, const struct jsdrv_union_s * value,
+        uint32_t timeout_ms, jsdrv_completion_fn cbk_fn, void * cbk_user_data);
+
+/**
+ * @brief Publish multiple values with a single wait.
+ *
+ * @param context The Joulescope driver context.
+ * @param args The array of topic and value pairs to publish in order.
+ * @param count The number of entries in args.
+ * @param[out] return_codes The optional array of count return codes, one
+ *      for each entry in args.  NULL to ignore the individual return codes.
+ * @param timeout_ms When 0, publish asynchronously without awaiting
+ *      the results.  When nonzero, block awaiting all return code messages,
+ *      which share the same timeout.
+ * @return 0 when all publish operations succeed, or the first error code.
+ *
+ * This function is equivalent to calling jsdrv_publish() for each entry,
+ * but it submits all entries before waiting.  The total duration is
+ * approximately the duration of the slowest operation rather than the sum.
+ */
+JSDRV_API int32_t jsdrv_publish_batch(struct jsdrv_context_s * context,
+        const struct jsdrv_arg_s * args, uint32_t count,
+        int32_t * return_codes, uint32_t timeout_ms);
+
 /**
  * @brief Query a retained value.
  *
@@ -564,6 +1324,12 @@ JSDRV_API int32_t jsdrv_publish(struct jsdrv_context_s * context,
  *      When nonzero, override the default timeout.
  * @return 0 or error code.  All calls may return #JSDRV_ERROR_PARAMETER_INVALID
  *      and #JSDRV_ERROR_TIMED_OUT.
+ *
+ * When no commands from the API are still pending, small retained values
+ * come directly from a lock-free snapshot without waiting for the
+ * driver thread.  Otherwise, and for metadata and large values, the
+ * query waits for the driver thread so that it observes all prior
+ * jsdrv_publish() calls.
  */
 JSDRV_API int32_t jsdrv_query(struct jsdrv_context_s * context,
                               const char * topic, struct jsdrv_union_s * value,
@@ -587,11 +1353,76 @@ JSDRV_API int32_t jsdrv_query(struct jsdrv_context_s * context,
  * Synchronous, blocking subscription is most useful when flags contains
  * #JSDRV_SFLAG_RETAIN.  The operation will not complete until cbk_fn()
  * is called with all retained values.
+ *
+ * The topic may contain wildcard levels.  "+" matches exactly one level,
+ * and "#", which must be the final level, matches any remaining levels.
+ * For example, "u/js220/+/s/+/!data" receives streaming data from all
+ * JS220 devices, but not their other topics.  Unlike normal topics,
+ * wildcard topics only match their children through "#".
+ * Unsubscribe with the identical wildcard topic.
  */
 JSDRV_API int32_t jsdrv_subscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
         jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
         uint32_t timeout_ms);
 
+/**
+ * @brief Subscribe to a topic with a bounded callback queue.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The topic name.
+ * @param flags The #jsdrv_subscribe_flag_e bitmap.
+ * @param cbk_fn The function to call on topic updates.
+ * @param cbk_user_data The arbitrary data provided to cbk_fn.
+ * @param depth The maximum number of messages awaiting cbk_fn.
+ * @param policy The #jsdrv_queue_policy_e when the queue is full.
+ * @param timeout_ms When 0, subscribe asynchronously.  When nonzero, block awaiting
+ *      the subscription operation to complete.
+ * @return 0 or error code.  Returns #JSDRV_ERROR_NOT_SUPPORTED unless
+ *      jsdrv_initialize() received a nonzero JSDRV_ARG_DISPATCH_THREADS.
+ *
+ * This function behaves like jsdrv_subscribe(), except that a dispatch
+ * worker thread invokes cbk_fn for all published values, not just data.
+ * When cbk_fn cannot keep up, the queue fills and the policy decides
+ * which messages to discard, so a slow callback cannot cause unbounded
+ * memory growth.  #JSDRV_QUEUE_POLICY_BLOCK waits up to 1 second for
+ * space to avoid deadlock when cbk_fn calls into the driver.
+ * Retained values delivered on subscribe bypass the queue.
+ *
+ * When JSDRV_ARG_STATS_MEM_INTERVAL is nonzero, the driver publishes
+ * JSDRV_MSG_STATS_QUEUE with the depth, pending, peak, and drop counts
+ * for each queued subscriber.
+ */
+JSDRV_API int32_t jsdrv_subscribe_queue(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+        jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
+        uint32_t depth, uint8_t policy, uint32_t timeout_ms);
+
+/**
+ * @brief Subscribe to a topic with rate-limited, latest-value delivery.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The topic name.
+ * @param flags The #jsdrv_subscribe_flag_e bitmap.
+ * @param cbk_fn The function to call on topic updates.
+ * @param cbk_user_data The arbitrary data provided to cbk_fn.
+ * @param interval_ms The minimum duration between cbk_fn calls
+ *      for published values.  0 behaves like jsdrv_subscribe().
+ * @param timeout_ms When 0, subscribe asynchronously.  When nonzero, block awaiting
+ *      the subscription operation to complete.
+ * @return 0 or error code.
+ *
+ * This function behaves like jsdrv_subscribe(), except that cbk_fn
+ * receives published values at most once per interval_ms.  When
+ * multiple values arrive within an interval, only the newest is
+ * delivered at the end of the interval, and the others are discarded.
+ * Use this option for high-rate parameter and statistics topics
+ * where only the latest value matters, such as to update a display.
+ * Metadata, return codes, and retained values delivered on
+ * subscribe are never coalesced.
+ */
+JSDRV_API int32_t jsdrv_subscribe_coalesce(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+        jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
+        uint32_t interval_ms, uint32_t timeout_ms);
+
 /**
  * @brief Unsubscribe to topic updates.
  *
@@ -635,6 +1466,99 @@ JSDRV_API int32_t jsdrv_unsubscribe_all(struct jsdrv_context_s * context,
                                         jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
                                         uint32_t timeout_ms);
 
+/**
+ * @brief Retain a value delivered to a subscriber callback.
+ *
+ * @param context The Joulescope driver context.
+ * @param value The value provided to the jsdrv_subscribe() callback.
+ * @return 0 or #JSDRV_ERROR_PARAMETER_INVALID.
+ * @see jsdrv_release
+ *
+ * Subscriber values normally only remain valid for the duration of the
+ * callback.  Retaining a value keeps it, and the data it points to,
+ * valid until the matching jsdrv_release() call, without copying.
+ * Multiple subscribers may each retain the same value, such as a
+ * stream data block, and release it from any thread.
+ * Only the pointer types str, json and bin support retain.
+ * Call this function from within the subscriber callback, and release all
+ * retained values before calling jsdrv_finalize().
+ */
+JSDRV_API int32_t jsdrv_retain(struct jsdrv_context_s * context, const struct jsdrv_union_s * value);
+
+/**
+ * @brief Release a value previously retained with jsdrv_retain().
+ *
+ * @param context The Joulescope driver context.
+ * @param value The retained value.
+ * @return 0 or #JSDRV_ERROR_PARAMETER_INVALID.
+ */
+JSDRV_API int32_t jsdrv_release(struct jsdrv_context_s * context, const struct jsdrv_union_s * value);
+
+/**
+ * @brief The function called for each stream block that matches a stage.
+ *
+ * @param user_data The arbitrary user data.
+ * @param topic The full stream topic, such as "u/js220/000415/s/i/!data".
+ * @param block The stream block, including sample_id, time_map, and
+ *      element_count samples of element_type in data.
+ *      The block is only valid for the duration of the call.
+ *
+ * The driver calls stages on the device thread that produced the block,
+ * before the block enters the frontend queue.  Stages must not block.
+ * Stages may call jsdrv_stage_publish(), but no other driver functions.
+ */
+typedef void (*jsdrv_stage_fn)(void * user_data, const char * topic, const struct jsdrv_stream_signal_s * block);
+
+/**
+ * @brief Register a native processing stage.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The stream topic or topic prefix.  The stage receives all
+ *      stream blocks for this topic and its subtopics.
+ * @param fn The stage function.
+ * @param user_data The arbitrary data for fn.
+ * @return 0, JSDRV_ERROR_ALREADY_EXISTS, JSDRV_ERROR_FULL, or error code.
+ * @see jsdrv_stage_unregister
+ *
+ * Unlike jsdrv_subscribe(), stages receive stream data without a
+ * frontend round trip, which allows native code to reduce or transform
+ * the data at the full sample rate.  Stages do not see blocks published
+ * with jsdrv_stage_publish(), which prevents feedback loops.
+ */
+JSDRV_API int32_t jsdrv_stage_register(struct jsdrv_context_s * context,
+                                       const char * topic, jsdrv_stage_fn fn, void * user_data);
+
+/**
+ * @brief Unregister a native processing stage.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The topic provided to jsdrv_stage_register().
+ * @param fn The stage function.
+ * @param user_data The arbitrary data for fn.
+ * @return 0, JSDRV_ERROR_NOT_FOUND, or error code.
+ *
+ * On return, the driver no longer calls fn, and fn is not running.
+ * Do not call this function from within a stage.
+ */
+JSDRV_API int32_t jsdrv_stage_unregister(struct jsdrv_context_s * context,
+                                         const char * topic, jsdrv_stage_fn fn, void * user_data);
+
+/**
+ * @brief Publish a derived stream block.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The derived stream topic, usually ending in "!data".
+ * @param block The stream block.  The driver copies the header and the
+ *      element_count samples, so the caller retains ownership.
+ * @return 0, JSDRV_ERROR_PARAMETER_INVALID, or JSDRV_ERROR_TOO_BIG.
+ *
+ * Subscribers receive the block as a JSDRV_PAYLOAD_TYPE_STREAM value,
+ * the same as the device stream topics.  Safe to call from any thread,
+ * including from within a stage.
+ */
+JSDRV_API int32_t jsdrv_stage_publish(struct jsdrv_context_s * context,
+                                      const char * topic, const struct jsdrv_stream_signal_s * block);
+
 /**
  * @brief Open a device.
  *
@@ -650,6 +1574,43 @@ JSDRV_API int32_t jsdrv_unsubscribe_all(struct jsdrv_context_s * context,
  */
 JSDRV_API int32_t jsdrv_open(struct jsdrv_context_s * context, const char * device_prefix, int32_t mode);
 
+/**
+ * @brief Open a device and invoke a callback on completion.
+ *
+ * @param context The Joulescope driver context.
+ * @param device_prefix The device prefix string.
+ * @param mode The #jsdrv_device_open_mode_e.
+ * @param cbk_fn The function to call with the return code.
+ * @param cbk_user_data The arbitrary data for cbk_fn.
+ * @return 0 or #JSDRV_ERROR_PARAMETER_INVALID.
+ *
+ * This is a convenience function that wraps a single call to
+ * jsdrv_publish_async() with #JSDRV_TIMEOUT_MS_DEFAULT.
+ */
+JSDRV_API int32_t jsdrv_open_async(struct jsdrv_context_s * context, const char * device_prefix, int32_t mode,
+        jsdrv_completion_fn cbk_fn, void * cbk_user_data);
+
+/**
+ * @brief Open multiple devices concurrently.
+ *
+ * @param context The Joulescope driver context.
+ * @param device_prefixes The array of count device prefix strings.
+ * @param count The number of entries in device_prefixes.
+ * @param mode The #jsdrv_device_open_mode_e for all devices.
+ * @param[out] return_codes The optional array of count return codes, one
+ *      for each device.  NULL to ignore the individual return codes.
+ * @param timeout_ms The timeout shared by all devices.
+ *      When 0, use #JSDRV_TIMEOUT_MS_DEFAULT.
+ * @return 0 when all devices open, or the first error code.
+ *
+ * Each device opens on its own driver thread, so this function submits
+ * all open requests before waiting using jsdrv_publish_batch().  The
+ * total duration approaches the slowest single open rather than the sum.
+ */
+JSDRV_API int32_t jsdrv_open_many(struct jsdrv_context_s * context,
+        const char * const * device_prefixes, uint32_t count, int32_t mode,
+        int32_t * return_codes, uint32_t timeout_ms);
+
 /**
  * @brief Close a device.
  *
@@ -664,6 +1625,70 @@ JSDRV_API int32_t jsdrv_open(struct jsdrv_context_s * context, const char * devi
  */
 JSDRV_API int32_t jsdrv_close(struct jsdrv_context_s * context, const char * device_prefix);
 
+/**
+ * @brief Close a device and invoke a callback on completion.
+ *
+ * @param context The Joulescope driver context.
+ * @param device_prefix The device prefix string.
+ * @param cbk_fn The function to call with the return code.
+ * @param cbk_user_data The arbitrary data for cbk_fn.
+ * @return 0 or #JSDRV_ERROR_PARAMETER_INVALID.
+ *
+ * This is a convenience function that wraps a single call to
+ * jsdrv_publish_async() with #JSDRV_TIMEOUT_MS_DEFAULT.
+ */
+JSDRV_API int32_t jsdrv_close_async(struct jsdrv_context_s * context, const char * device_prefix,
+        jsdrv_completion_fn cbk_fn, void * cbk_user_data);
+
+/**
+ * @brief Apply a parameter profile, publishing only the changed values.
+ *
+ * @param context The Joulescope driver context.
+ * @param device_prefix The device prefix string, such as "u/js220/000415".
+ *      NULL or "" when the args topics are complete.
+ * @param args The array of profile entries.  Each topic is relative to
+ *      device_prefix, such as "s/i/range/select".
+ * @param count The number of entries in args.
+ * @param[out] changed The optional number of entries published.
+ * @param timeout_ms The timeout shared by all published entries.
+ *      When 0, use #JSDRV_TIMEOUT_MS_DEFAULT.
+ * @return 0 when all changed entries succeed, or the first error code.
+ *
+ * This function compares each entry to the retained value snapshot
+ * using jsdrv_union_equiv(), then publishes the changed entries in
+ * order with a single jsdrv_publish_batch() wait.  When earlier
+ * commands from the API are still pending, the snapshot may be stale,
+ * so this function first waits for one query round trip that follows
+ * them.  Applying a profile therefore costs at most one round trip for
+ * the comparison, plus one wait when any entries changed.
+ *
+ * Entries missing from the snapshot, such as values that are not
+ * retained or exceed 64 bytes, count as changed.  When called from a
+ * jsdrv callback, or if the round trip fails, every entry counts as
+ * changed.  Pubsub drops published values that match the retained
+ * value, so these entries complete without reaching the device.
+ */
+JSDRV_API int32_t jsdrv_profile_apply(struct jsdrv_context_s * context, const char * device_prefix,
+        const struct jsdrv_arg_s * args, uint32_t count,
+        uint32_t * changed, uint32_t timeout_ms);
+
+/**
+ * @brief Apply a JSON parameter profile, publishing only the changed values.
+ *
+ * @param context The Joulescope driver context.
+ * @param device_prefix The device prefix string, see jsdrv_profile_apply().
+ * @param profile The JSON object that maps topics to values.  Nested
+ *      objects join their keys with "/", so {"s": {"i": {"ctrl": 1}}}
+ *      is equivalent to {"s/i/ctrl": 1}.  Values may be strings,
+ *      numbers, true, or false.
+ * @param[out] changed The optional number of entries published.
+ * @param timeout_ms The timeout, see jsdrv_profile_apply().
+ * @return 0, #JSDRV_ERROR_PARAMETER_INVALID for a malformed profile, or
+ *      the first publish error code.
+ */
+JSDRV_API int32_t jsdrv_profile_apply_json(struct jsdrv_context_s * context, const char * device_prefix,
+        const char * profile, uint32_t * changed, uint32_t timeout_ms);
+
 /**
  * @brief Compute the calibration hash.
  *
@@ -0,0 +1,495 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Joulescope host driver C++17 wrapper.
+ */
+
+#ifndef JSDRV_INCLUDE_HPP_
+#define JSDRV_INCLUDE_HPP_
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"   // C flexible array members
+#endif
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if (__cplusplus < 201703L) && (!defined(_MSVC_LANG) || (_MSVC_LANG < 201703L))
+#error "jsdrv.hpp requires C++17"
+#endif
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_cpp C++ API
+ *
+ * @brief Header-only C++17 wrapper for the Joulescope driver API.
+ *
+ * This wrapper adds RAII ownership for the driver context, subscriptions,
+ * and retained messages.  Stream payloads are exposed as views over the
+ * driver's memory without copying.  The element type is a template
+ * parameter, so the u1, u4 and f32 dispatch resolves at compile time.
+ *
+ * Destroy all Subscription and Message instances before their Driver.
+ * Subscriber callbacks run on a driver thread and must not throw.
+ *
+ * @{
+ */
+
+namespace jsdrv {
+
+/// The exception for a nonzero jsdrv error code.
+class Error : public std::runtime_error {
+public:
+    explicit Error(int32_t code) : std::runtime_error(jsdrv_error_code_name(code)), code_(code) {}
+
+    /// The jsdrv_error_code_e value.
+    int32_t code() const noexcept { return code_; }
+
+private:
+    int32_t code_;
+};
+
+/// Throw Error when rc is nonzero.
+inline void check(int32_t rc) {
+    if (rc) {
+        throw Error(rc);
+    }
+}
+
+/// A contiguous, read-only view, like std::span<const T>.
+template <typename T>
+class Span {
+public:
+    constexpr Span() noexcept = default;
+    constexpr Span(const T * data, size_t size) noexcept : data_(data), size_(size) {}
+
+    constexpr const T * data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return 0 == size_; }
+    constexpr const T * begin() const noexcept { return data_; }
+    constexpr const T * end() const noexcept { return data_ + size_; }
+    constexpr const T & operator[](size_t idx) const noexcept { return data_[idx]; }
+
+private:
+    const T * data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/// The tag type for packed unsigned elements smaller than one byte.
+template <unsigned BITS>
+struct Packed {
+    static_assert((BITS == 1) || (BITS == 2) || (BITS == 4), "unsupported packed size");
+};
+
+using u1 = Packed<1>;   ///< Packed 1-bit elements, such as GPI and range signals.
+using u4 = Packed<4>;   ///< Packed 4-bit elements, such as the current range.
+
+/// A read-only view over packed elements, least significant bits first.
+template <unsigned BITS>
+class PackedSpan {
+public:
+    static constexpr unsigned PER_BYTE = 8 / BITS;
+    static constexpr uint8_t MASK = (uint8_t) ((1U << BITS) - 1);
+
+    constexpr PackedSpan() noexcept = default;
+    constexpr PackedSpan(const uint8_t * data, size_t size) noexcept : data_(data), size_(size) {}
+
+    /// The packed bytes.
+    constexpr const uint8_t * data() const noexcept { return data_; }
+    /// The number of elements, not bytes.
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return 0 == size_; }
+    constexpr uint8_t operator[](size_t idx) const noexcept {
+        return (uint8_t) ((data_[idx / PER_BYTE] >> ((idx % PER_BYTE) * BITS)) & MASK);
+    }
+
+private:
+    const uint8_t * data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief The compile-time element traits for stream payloads.
+ *
+ * Each specialization provides the jsdrv_element_type_e, the size in
+ * bits, the view type, and make() to construct the view.
+ */
+template <typename T>
+struct ElementTraits;
+
+#define JSDRV_CPP_ELEMENT_(type_, element_type_)                                \
+template <>                                                                     \
+struct ElementTraits<type_> {                                                   \
+    static constexpr uint8_t element_type = element_type_;                      \
+    static constexpr uint8_t element_size_bits = sizeof(type_) * 8;             \
+    using view_type = Span<type_>;                                              \
+    static view_type make(const uint8_t * data, size_t count) noexcept {        \
+        return view_type(reinterpret_cast<const type_ *>(data), count);         \
+    }                                                                           \
+};
+
+JSDRV_CPP_ELEMENT_(float, JSDRV_DATA_TYPE_FLOAT)
+JSDRV_CPP_ELEMENT_(double, JSDRV_DATA_TYPE_FLOAT)
+JSDRV_CPP_ELEMENT_(int8_t, JSDRV_DATA_TYPE_INT)
+JSDRV_CPP_ELEMENT_(int16_t, JSDRV_DATA_TYPE_INT)
+JSDRV_CPP_ELEMENT_(int32_t, JSDRV_DATA_TYPE_INT)
+JSDRV_CPP_ELEMENT_(int64_t, JSDRV_DATA_TYPE_INT)
+JSDRV_CPP_ELEMENT_(uint8_t, JSDRV_DATA_TYPE_UINT)
+JSDRV_CPP_ELEMENT_(uint16_t, JSDRV_DATA_TYPE_UINT)
+JSDRV_CPP_ELEMENT_(uint32_t, JSDRV_DATA_TYPE_UINT)
+JSDRV_CPP_ELEMENT_(uint64_t, JSDRV_DATA_TYPE_UINT)
+
+#undef JSDRV_CPP_ELEMENT_
+
+template <unsigned BITS>
+struct ElementTraits<Packed<BITS>> {
+    static constexpr uint8_t element_type = JSDRV_DATA_TYPE_UINT;
+    static constexpr uint8_t element_size_bits = BITS;
+    using view_type = PackedSpan<BITS>;
+    static view_type make(const uint8_t * data, size_t count) noexcept {
+        return view_type(data, count);
+    }
+};
+
+/// The view type for stream elements of type T.
+template <typename T>
+using view_t = typename ElementTraits<T>::view_type;
+
+/// Check if a stream contains elements of type T.
+template <typename T>
+inline bool is(const jsdrv_stream_signal_s & s) noexcept {
+    return (s.element_type == ElementTraits<T>::element_type)
+        && (s.element_size_bits == ElementTraits<T>::element_size_bits);
+}
+
+/// Get the typed view over the stream data, which is empty when the type does not match.
+template <typename T>
+inline view_t<T> view(const jsdrv_stream_signal_s & s) noexcept {
+    if (!is<T>(s)) {
+        return view_t<T>();
+    }
+    return ElementTraits<T>::make(s.data, s.element_count);
+}
+
+/// Get the stream payload from a subscriber value, or nullptr.
+inline const jsdrv_stream_signal_s * stream(const jsdrv_union_s & value) noexcept {
+    if ((value.type != JSDRV_UNION_BIN) || (value.app != JSDRV_PAYLOAD_TYPE_STREAM)) {
+        return nullptr;
+    }
+    return reinterpret_cast<const jsdrv_stream_signal_s *>(value.value.bin);
+}
+
+/**
+ * @brief A move-only handle that retains a subscriber value.
+ *
+ * Construct from within a subscriber callback to keep the value and its
+ * payload valid, without copying, until the handle is destroyed.
+ * @see jsdrv_retain
+ */
+class Message {
+public:
+    Message() noexcept = default;
+
+    Message(jsdrv_context_s * context, const jsdrv_union_s & value) : context_(context), value_(&value) {
+        check(jsdrv_retain(context_, value_));
+    }
+
+    Message(const Message &) = delete;
+    Message & operator=(const Message &) = delete;
+
+    Message(Message && other) noexcept
+            : context_(std::exchange(other.context_, nullptr)), value_(std::exchange(other.value_, nullptr)) {}
+
+    Message & operator=(Message && other) noexcept {
+        if (this != &other) {
+            reset();
+            context_ = std::exchange(other.context_, nullptr);
+            value_ = std::exchange(other.value_, nullptr);
+        }
+        return *this;
+    }
+
+    ~Message() { reset(); }
+
+    /// Release the retained value.
+    void reset() noexcept {
+        if (value_) {
+            jsdrv_release(context_, value_);
+            value_ = nullptr;
+        }
+        context_ = nullptr;
+    }
+
+    explicit operator bool() const noexcept { return nullptr != value_; }
+    const jsdrv_union_s & value() const noexcept { return *value_; }
+
+    /// The stream payload, or nullptr.
+    const jsdrv_stream_signal_s * stream() const noexcept {
+        return value_ ? jsdrv::stream(*value_) : nullptr;
+    }
+
+private:
+    jsdrv_context_s * context_ = nullptr;
+    const jsdrv_union_s * value_ = nullptr;
+};
+
+/**
+ * @brief A move-only subscription that unsubscribes on destruction.
+ *
+ * The callback is stored inline with its concrete type, so each call is a
+ * single indirect call from the driver without std::function overhead.
+ */
+class Subscription {
+public:
+    Subscription() noexcept = default;
+
+    /**
+     * @brief Subscribe to a topic.
+     *
+     * @param context The driver context.
+     * @param topic The topic, which may include wildcards.
+     * @param flags The jsdrv_subscribe_flag_e bitmap.
+     * @param fn The callable with the signature
+     *      void(const char * topic, const jsdrv_union_s & value).
+     * @param timeout_ms The subscribe and unsubscribe timeout.
+     * @throw Error on failure.
+     */
+    template <typename Fn>
+    Subscription(jsdrv_context_s * context, std::string topic, uint8_t flags, Fn && fn,
+                 uint32_t timeout_ms = JSDRV_TIMEOUT_MS_DEFAULT)
+            : context_(context),
+              topic_(std::move(topic)),
+              timeout_ms_(timeout_ms),
+              fn_(&trampoline<std::decay_t<Fn>>),
+              user_data_(new std::decay_t<Fn>(std::forward<Fn>(fn)), &destroy<std::decay_t<Fn>>) {
+        int32_t rc = jsdrv_subscribe(context_, topic_.c_str(), flags, fn_, user_data_.get(), timeout_ms_);
+        if (rc) {
+            context_ = nullptr;
+            throw Error(rc);
+        }
+    }
+
+    Subscription(const Subscription &) = delete;
+    Subscription & operator=(const Subscription &) = delete;
+
+    Subscription(Subscription && other) noexcept
+            : context_(std::exchange(other.context_, nullptr)),
+              topic_(std::move(other.topic_)),
+              timeout_ms_(other.timeout_ms_),
+              fn_(other.fn_),
+              user_data_(std::move(other.user_data_)) {}
+
+    Subscription & operator=(Subscription && other) noexcept {
+        if (this != &other) {
+            unsubscribe();
+            context_ = std::exchange(other.context_, nullptr);
+            topic_ = std::move(other.topic_);
+            timeout_ms_ = other.timeout_ms_;
+            fn_ = other.fn_;
+            user_data_ = std::move(other.user_data_);
+        }
+        return *this;
+    }
+
+    ~Subscription() { unsubscribe(); }
+
+    /**
+     * @brief Unsubscribe.
+     *
+     * @return 0 or error code.  When the unsubscribe is asynchronous or
+     *      fails, the callback is intentionally leaked since the driver
+     *      may still call it.
+     */
+    int32_t unsubscribe() noexcept {
+        int32_t rc = 0;
+        if (context_) {
+            rc = jsdrv_unsubscribe(context_, topic_.c_str(), fn_, user_data_.get(), timeout_ms_);
+            if (rc || !timeout_ms_) {
+                user_data_.release();
+            }
+            context_ = nullptr;
+        }
+        user_data_.reset();
+        return rc;
+    }
+
+    explicit operator bool() const noexcept { return nullptr != context_; }
+    const std::string & topic() const noexcept { return topic_; }
+
+private:
+    template <typename Fn>
+    static void trampoline(void * user_data, const char * topic, const jsdrv_union_s * value) {
+        try {
+            (*static_cast<Fn *>(user_data))(topic, *value);
+        } catch (...) {
+            // exceptions must not unwind through the driver's C frames
+        }
+    }
+
+    template <typename Fn>
+    static void destroy(void * user_data) {
+        delete static_cast<Fn *>(user_data);
+    }
+
+    jsdrv_context_s * context_ = nullptr;
+    std::string topic_;
+    uint32_t timeout_ms_ = JSDRV_TIMEOUT_MS_DEFAULT;
+    jsdrv_subscribe_fn fn_ = nullptr;
+    std::unique_ptr<void, void (*)(void *)> user_data_{nullptr, nullptr};
+};
+
+/// Construct a jsdrv_union_s for publish.
+inline jsdrv_union_s to_union(bool v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_U8; u.value.u8 = v ? 1 : 0; return u; }
+inline jsdrv_union_s to_union(uint8_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_U8; u.value.u8 = v; return u; }
+inline jsdrv_union_s to_union(uint16_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_U16; u.value.u16 = v; return u; }
+inline jsdrv_union_s to_union(uint32_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_U32; u.value.u32 = v; return u; }
+inline jsdrv_union_s to_union(uint64_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_U64; u.value.u64 = v; return u; }
+inline jsdrv_union_s to_union(int8_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_I8; u.value.i8 = v; return u; }
+inline jsdrv_union_s to_union(int16_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_I16; u.value.i16 = v; return u; }
+inline jsdrv_union_s to_union(int32_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_I32; u.value.i32 = v; return u; }
+inline jsdrv_union_s to_union(int64_t v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_I64; u.value.i64 = v; return u; }
+inline jsdrv_union_s to_union(float v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_F32; u.value.f32 = v; return u; }
+inline jsdrv_union_s to_union(double v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_F64; u.value.f64 = v; return u; }
+inline jsdrv_union_s to_union(const char * v) noexcept { jsdrv_union_s u{}; u.type = JSDRV_UNION_STR; u.value.str = v; return u; }
+inline jsdrv_union_s to_union(const std::string & v) noexcept { return to_union(v.c_str()); }
+
+/**
+ * @brief The move-only owner of a driver context.
+ *
+ * The constructor calls jsdrv_initialize() and the destructor calls
+ * jsdrv_finalize().  Do not destroy a Driver from a subscriber callback.
+ */
+class Driver {
+public:
+    /**
+     * @brief Initialize the driver.
+     *
+     * @param args The jsdrv_initialize() arguments or nullptr.
+     * @param timeout_ms The initialize and finalize timeout, 0 for the default.
+     * @throw Error on failure.
+     */
+    explicit Driver(const jsdrv_arg_s * args = nullptr, uint32_t timeout_ms = 0) : timeout_ms_(timeout_ms) {
+        check(jsdrv_initialize(&context_, args, timeout_ms_));
+    }
+
+    Driver(const Driver &) = delete;
+    Driver & operator=(const Driver &) = delete;
+
+    Driver(Driver && other) noexcept
+            : context_(std::exchange(other.context_, nullptr)), timeout_ms_(other.timeout_ms_) {}
+
+    Driver & operator=(Driver && other) noexcept {
+        if (this != &other) {
+            finalize();
+            context_ = std::exchange(other.context_, nullptr);
+            timeout_ms_ = other.timeout_ms_;
+        }
+        return *this;
+    }
+
+    ~Driver() { finalize(); }
+
+    /// Finalize the driver, which the destructor calls automatically.
+    void finalize() noexcept {
+        if (context_) {
+            jsdrv_finalize(context_, timeout_ms_);
+            context_ = nullptr;
+        }
+    }
+
+    /// The context for direct use of the C API.
+    jsdrv_context_s * context() const noexcept { return context_; }
+
+    /// Publish a value and throw Error on failure.
+    void publish(const char * topic, const jsdrv_union_s & value, uint32_t timeout_ms = JSDRV_TIMEOUT_MS_DEFAULT) const {
+        check(jsdrv_publish(context_, topic, &value, timeout_ms));
+    }
+
+    /// Publish a C++ value and throw Error on failure.
+    template <typename T, typename = decltype(to_union(std::declval<T>()))>
+    void publish(const char * topic, T && value, uint32_t timeout_ms = JSDRV_TIMEOUT_MS_DEFAULT) const {
+        publish(topic, to_union(std::forward<T>(value)), timeout_ms);
+    }
+
+    /// Open a device.
+    void open(const char * device_prefix, int32_t mode = JSDRV_DEVICE_OPEN_MODE_DEFAULTS) const {
+        check(jsdrv_open(context_, device_prefix, mode));
+    }
+
+    /// Close a device.
+    void close(const char * device_prefix) const {
+        check(jsdrv_close(context_, device_prefix));
+    }
+
+    /// Subscribe to a topic with fn(const char * topic, const jsdrv_union_s & value).
+    template <typename Fn>
+    Subscription subscribe(std::string topic, uint8_t flags, Fn && fn,
+                           uint32_t timeout_ms = JSDRV_TIMEOUT_MS_DEFAULT) const {
+        return Subscription(context_, std::move(topic), flags, std::forward<Fn>(fn), timeout_ms);
+    }
+
+    /**
+     * @brief Subscribe to stream data with elements of type T.
+     *
+     * @param topic The stream topic, such as "u/js220/000415/s/i/!data".
+     * @param fn The callable with the signature
+     *      void(const jsdrv_stream_signal_s & stream, view_t<T> data).
+     * @param timeout_ms The subscribe and unsubscribe timeout.
+     * @return The subscription.
+     *
+     * Stream messages with a different element type are skipped.
+     */
+    template <typename T, typename Fn>
+    Subscription subscribe_stream(std::string topic, Fn && fn,
+                                  uint32_t timeout_ms = JSDRV_TIMEOUT_MS_DEFAULT) const {
+        return subscribe(std::move(topic), JSDRV_SFLAG_PUB,
+            [fn = std::forward<Fn>(fn)](const char * topic, const jsdrv_union_s & value) mutable {
+                (void) topic;
+                const jsdrv_stream_signal_s * s = jsdrv::stream(value);
+                if (s && is<T>(*s)) {
+                    fn(*s, ElementTraits<T>::make(s->data, s->element_count));
+                }
+            }, timeout_ms);
+    }
+
+    /// Retain a subscriber value.  Call only from within the subscriber callback.
+    Message retain(const jsdrv_union_s & value) const {
+        return Message(context_, value);
+    }
+
+private:
+    jsdrv_context_s * context_ = nullptr;
+    uint32_t timeout_ms_ = 0;
+};
+
+}  // namespace jsdrv
+
+/** @} */
+
+#endif  /* JSDRV_INCLUDE_HPP_ */
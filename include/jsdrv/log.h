@@ -97,6 +97,52 @@ struct jsdrv_log_header_s {
     int64_t timestamp;
 };
 
+/// The binary log file magic identifier, without a null terminator.
+#define JSDRV_LOG_BINARY_MAGIC "jsdrvlog"
+/// The binary log file format version.
+#define JSDRV_LOG_BINARY_VERSION  (1)
+/// The binary log record flag for padding to the end of the ring.
+#define JSDRV_LOG_BINARY_FLAG_PAD  (0x01)
+
+/**
+ * @brief The binary log file header.
+ *
+ * The file contains this header followed by data_size bytes of ring
+ * data.  head and tail are the total bytes written when the newest
+ * record ended and when the oldest remaining record started, so each
+ * record lives at (offset % data_size) in the ring data.  Multi-byte
+ * values are little-endian.
+ */
+struct jsdrv_log_binary_header_s {
+    char magic[8];          ///< JSDRV_LOG_BINARY_MAGIC
+    uint32_t version;       ///< JSDRV_LOG_BINARY_VERSION
+    uint32_t header_size;   ///< The size of this header in bytes.
+    uint64_t data_size;     ///< The ring data size in bytes, a multiple of 8.
+    uint64_t head;          ///< The end offset of the newest record.
+    uint64_t tail;          ///< The start offset of the oldest record.
+    uint64_t rsv[3];        ///< Reserved, written as 0.
+};
+
+/**
+ * @brief The binary log record header.
+ *
+ * The filename and message bytes follow without null terminators.
+ * size includes this header, the strings and the padding to
+ * a multiple of 8 bytes.  Records never wrap.  A record with
+ * JSDRV_LOG_BINARY_FLAG_PAD fills the ring end instead, and only
+ * its size and flags fields are valid.
+ */
+struct jsdrv_log_binary_record_s {
+    uint32_t size;          ///< The total record size in bytes.
+    uint8_t level;          ///< The jsdrv_log_level_e.
+    uint8_t flags;          ///< The JSDRV_LOG_BINARY_FLAG_* bits.
+    uint16_t filename_size; ///< The filename size in bytes.
+    uint32_t line;          ///< The originating file line number.
+    uint16_t message_size;  ///< The message size in bytes.
+    uint16_t rsv;           ///< Reserved, written as 0.
+    int64_t timestamp;      ///< The Joulescope driver UTC time.
+};
+
 /**
  * @brief Receive a log message.
  *
@@ -168,6 +214,56 @@ JSDRV_API void jsdrv_log_level_set(int8_t level);
  */
 JSDRV_API int8_t jsdrv_log_level_get();
 
+/**
+ * @brief Set the maximum log level for one driver module.
+ *
+ * @param module The module name: "default", "frontend", "pubsub",
+ *      "usb", "js110", "js220", or "buffer".
+ * @param level The maximum jsdrv_log_level_e for the module.
+ * @return 0 or JSDRV_ERROR_NOT_FOUND.
+ *
+ * Each module initializes to JSDRV_LOG_LEVEL_ALL.  A message is
+ * processed only when its level passes both the module level and
+ * jsdrv_log_level_set().  Messages filtered by either level cost
+ * only a comparison in the calling thread.  You may also publish
+ * an i32 level to JSDRV_MSG_LOG_LEVEL_PREFIX "{module}".
+ */
+JSDRV_API int32_t jsdrv_log_module_level_set(const char * module, int8_t level);
+
+/**
+ * @brief Get the maximum log level for one driver module.
+ *
+ * @param module The module name.
+ * @return The module jsdrv_log_level_e, or JSDRV_LOG_LEVEL_OFF if not found.
+ */
+JSDRV_API int8_t jsdrv_log_module_level_get(const char * module);
+
+/**
+ * @brief Write all dispatched log messages to a binary ring file.
+ *
+ * @param path The file path.  Any existing file is overwritten.
+ * @param size The total file size in bytes, at least 4096.
+ * @return 0 or error code.
+ *
+ * The log thread writes each message as a jsdrv_log_binary_record_s
+ * into the memory-mapped file.  Once the ring is full, new records
+ * overwrite the oldest.  The operating system persists the file
+ * contents even if the process exits unexpectedly.  Use
+ * "python -m pyjoulescope_driver log_decode {path}" to decode.
+ *
+ * Since writing needs no callbacks, you can leave DEBUG logging
+ * enabled at high rates and decode the file offline.
+ * Call jsdrv_log_initialize() first.
+ */
+JSDRV_API int32_t jsdrv_log_binary_open(const char * path, uint64_t size);
+
+/**
+ * @brief Stop writing the binary log file.
+ *
+ * finalize also closes the file.
+ */
+JSDRV_API void jsdrv_log_binary_close();
+
 /**
  * @brief Initialize the singleton log handler.
  *
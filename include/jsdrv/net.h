@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief TCP server that exports pubsub topics to remote subscribers.
+ */
+
+#ifndef JSDRV_NET_H__
+#define JSDRV_NET_H__
+
+#include "jsdrv.h"
+#include "jsdrv/stream_codec.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_net Network server
+ *
+ * @brief Export pubsub topics to remote subscribers over TCP.
+ *
+ * Clients connect and send newline-terminated text requests:
+ * - "+{topic}\n" subscribes to a topic, which may contain '+' and '#'
+ *   wildcards.  The server forwards retained values immediately.
+ * - "-{topic}\n" unsubscribes from a topic.
+ * - "*{codec}\n" selects the jsdrv_stream_codec_e for stream data,
+ *   such as "*1\n" for JSDRV_STREAM_CODEC_F32.  The default is 0, none.
+ *
+ * The server sends a stream of binary frames, each starting with
+ * jsdrv_net_frame_header_s, in little-endian byte order.  The frame
+ * contains:
+ * - the header
+ * - the null-terminated topic, padded to a multiple of 8 bytes
+ * - the value payload for string, JSON, and binary types, padded to
+ *   a multiple of 8 bytes.  For "!data" topics, the payload is the
+ *   used portion of jsdrv_stream_signal_s.  When the frame codec is
+ *   not zero, decode the payload with jsdrv_stream_codec_decode().
+ *   The server sends stream data uncompressed when the codec does not
+ *   apply or does not reduce the size.  For "s/stats/value",
+ *   the payload is jsdrv_statistics_s.
+ *
+ * The server batches all frames waiting for a client into each send.
+ * When a client cannot keep up and its send buffer fills, the
+ * server discards new frames for that client rather than delaying
+ * the driver.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The default TCP port.
+#define JSDRV_NET_PORT_DEFAULT (8818U)
+
+/// The maximum number of simultaneous clients.
+#define JSDRV_NET_CLIENTS_MAX (8U)
+
+/// The frame header.
+struct jsdrv_net_frame_header_s {
+    uint32_t length;        ///< The total frame size in bytes, a multiple of 8.
+    uint8_t type;           ///< The jsdrv_union_s type.
+    uint8_t flags;          ///< The jsdrv_union_s flags.
+    uint8_t op;             ///< The jsdrv_union_s op.
+    uint8_t app;            ///< The jsdrv_union_s app.
+    uint32_t size;          ///< The payload size in bytes, 0 for non-pointer types.
+    uint8_t topic_length;   ///< The topic length in bytes, including the null terminator.
+    uint8_t codec;          ///< The jsdrv_stream_codec_e for the payload.
+    uint8_t rsv[2];         ///< Reserved, 0.
+    uint64_t value;         ///< The value for non-pointer types.
+};
+
+/// The opaque server instance.
+struct jsdrv_net_server_s;
+
+/**
+ * @brief Start a server.
+ *
+ * @param context The Joulescope driver context.
+ * @param address The IPv4 address to bind, such as "127.0.0.1",
+ *      or NULL for all interfaces.
+ * @param port The TCP port, or 0 to select any available port.
+ * @param buffer_size The send buffer size for each client in bytes,
+ *      or 0 for the 4 MB default.
+ * @param[out] server The new server instance.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_net_server_open(struct jsdrv_context_s * context, const char * address, uint16_t port,
+        uint32_t buffer_size, struct jsdrv_net_server_s ** server);
+
+/**
+ * @brief Get the bound TCP port.
+ *
+ * @param server The server instance.
+ * @return The port, which is useful when jsdrv_net_server_open() port is 0.
+ */
+JSDRV_API uint16_t jsdrv_net_server_port(struct jsdrv_net_server_s * server);
+
+/**
+ * @brief Stop the server, disconnect all clients, and free all resources.
+ *
+ * @param server The server instance.
+ */
+JSDRV_API void jsdrv_net_server_close(struct jsdrv_net_server_s * server);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_NET_H__ */
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Host-side calibration for raw ADC samples.
+ */
+
+#ifndef JSDRV_RAW_CAL_H__
+#define JSDRV_RAW_CAL_H__
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_raw_cal Raw calibration
+ *
+ * @brief Convert raw i16 ADC samples to calibrated float32.
+ *
+ * The JS220 raw ADC signals, s/adc/{N}/!data, carry one i16 sample per
+ * sample time, which is half the size of the calibrated f32 signals.
+ * Streaming or recording the raw signals with the u4 current range,
+ * s/i/range/!data, defers calibration until a consumer needs float32.
+ * These functions then apply a per-range offset and gain, using the
+ * vectorized conversion for each run of samples with the same range.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The number of ranges selectable by a u4 range sample.
+#define JSDRV_RAW_CAL_RANGE_COUNT (16U)
+
+/// The calibration coefficients for one raw ADC signal.
+struct jsdrv_raw_cal_s {
+    float offset[JSDRV_RAW_CAL_RANGE_COUNT];  ///< Added to the ADC code for each range.
+    float gain[JSDRV_RAW_CAL_RANGE_COUNT];    ///< Scales the offset code for each range, 0 for NaN.
+};
+
+/**
+ * @brief Calibrate raw ADC samples.
+ *
+ * @param cal The calibration coefficients.
+ * @param[out] y The calibrated samples, y[i] = (adc[i] + offset[r]) * gain[r],
+ *      where r is the range for sample i.  Samples whose range has a
+ *      gain of 0, such as the current range off, are NaN.
+ * @param adc The raw ADC samples.
+ * @param range The packed u4 range samples, 2 per byte, least significant
+ *      nibble first, aligned with adc.  NULL uses range 0 for all samples.
+ * @param range_offset The index of the range sample for adc[0].
+ * @param length The number of samples.
+ */
+JSDRV_API void jsdrv_raw_cal_apply(const struct jsdrv_raw_cal_s * cal, float * y, const int16_t * adc,
+        const uint8_t * range, uint32_t range_offset, uint32_t length);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_RAW_CAL_H__ */
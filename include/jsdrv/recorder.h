@@ -0,0 +1,381 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Record stream data topics to a file and read them back.
+ */
+
+#ifndef JSDRV_RECORDER_H__
+#define JSDRV_RECORDER_H__
+
+#include "jsdrv.h"
+#include "jsdrv/raw_cal.h"
+#include "jsdrv/stream_codec.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_recorder Stream recorder
+ *
+ * @brief Record stream data topics to a raw chunked file.
+ *
+ * The recorder subscribes to stream data topics and appends each
+ * message to a large in-memory block on the frontend thread.
+ * A dedicated writer thread writes full blocks to the file with
+ * large sequential writes.  When the file system cannot keep up and
+ * all blocks are full, the recorder drops new messages and counts them.
+ *
+ * The file contains a 64-byte header followed by records in
+ * little-endian byte order.  The header is:
+ * - u8[8] magic: "jsdrvrec"
+ * - u32 version: 1
+ * - u32 header_size: 64
+ * - reserved, 0
+ *
+ * Each record starts with jsdrv_recorder_record_header_s and is padded
+ * to a multiple of 8 bytes.  The record types are:
+ * - JSDRV_RECORDER_TYPE_SIGNAL: id is the signal_id and the payload
+ *   is the null-terminated data topic.
+ * - JSDRV_RECORDER_TYPE_DATA: id is the signal_id and the payload is the
+ *   used portion of jsdrv_stream_signal_s, with packed data.  When the
+ *   record header codec is not zero, decode the payload with
+ *   jsdrv_stream_codec_decode().  See jsdrv_recorder_codec().
+ * - JSDRV_RECORDER_TYPE_USER_DATA: id is the application chunk_meta and
+ *   the payload is the application data.
+ * - JSDRV_RECORDER_TYPE_USB_DEVICE: id is the capture device_id and the
+ *   payload is the null-terminated device prefix.
+ * - JSDRV_RECORDER_TYPE_USB_BULK_IN: id is the capture device_id and the
+ *   payload is jsdrv_recorder_usb_s followed by the raw bulk-in transfer.
+ * - JSDRV_RECORDER_TYPE_INDEX: id is the signal_id and the payload is
+ *   jsdrv_recorder_index_s[] for the preceding data records.
+ * - JSDRV_RECORDER_TYPE_SUMMARY: id is the signal_id and the payload is
+ *   jsdrv_recorder_summary_s followed by jsdrv_summary_entry_s[].
+ * - JSDRV_RECORDER_TYPE_TOC: id is 0 and the payload is the u64 file
+ *   offsets for every signal, index, and summary record.
+ * - JSDRV_RECORDER_TYPE_END: id is 0 and the payload is the u64 file
+ *   offset of the TOC record.  This 24-byte record ends a closed file.
+ *
+ * The writer thread adds the index and summary records after each block,
+ * so the frontend thread never computes them.  Index records list the
+ * sample_id and file offset of every data record.  Float32 signals also
+ * get a summary pyramid: each level 1 entry covers
+ * JSDRV_RECORDER_SUMMARY_R0 samples, and each higher level entry covers
+ * JSDRV_RECORDER_SUMMARY_R lower entries.  Summary entries only exist
+ * for complete windows, and missing samples do not contribute.
+ *
+ * jsdrv_recorder_reader_open() uses the TOC to load the index without
+ * scanning the data.  Files without an END record, such as after a crash,
+ * fall back to a sequential scan of the record headers.
+ *
+ * The driver writes the USB record types when jsdrv_initialize()
+ * receives JSDRV_ARG_USB_CAPTURE.  The emulated JS220 devices replay
+ * these captures with JSDRV_ARG_EMULATION_REPLAY.
+ *
+ * pyjoulescope_driver.record_raw decodes these files.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The record types.
+enum jsdrv_recorder_type_e {
+    JSDRV_RECORDER_TYPE_SIGNAL = 1,
+    JSDRV_RECORDER_TYPE_DATA = 2,
+    JSDRV_RECORDER_TYPE_USER_DATA = 3,
+    JSDRV_RECORDER_TYPE_USB_DEVICE = 4,
+    JSDRV_RECORDER_TYPE_USB_BULK_IN = 5,
+    JSDRV_RECORDER_TYPE_INDEX = 6,
+    JSDRV_RECORDER_TYPE_SUMMARY = 7,
+    JSDRV_RECORDER_TYPE_TOC = 8,
+    JSDRV_RECORDER_TYPE_END = 9,
+};
+
+/// The number of samples for each level 1 summary entry.
+#define JSDRV_RECORDER_SUMMARY_R0       (1024U)
+/// The number of lower level entries for each higher level summary entry.
+#define JSDRV_RECORDER_SUMMARY_R        (16U)
+/// The number of summary levels, which covers 1024 * 16^4 samples per top entry.
+#define JSDRV_RECORDER_SUMMARY_LEVELS   (5U)
+
+/// The header for each record in the file.
+struct jsdrv_recorder_record_header_s {
+    uint32_t length;        ///< The total record length in bytes, including this header and padding.
+    uint8_t type;           ///< jsdrv_recorder_type_e
+    uint8_t codec;          ///< The jsdrv_stream_codec_e for DATA records, otherwise 0.
+    uint16_t id;            ///< The signal_id or chunk_meta.
+    uint32_t size;          ///< The payload size in bytes, excluding padding.
+    uint32_t rsv2_u32;      ///< Reserved, 0
+};
+
+/// The payload header for JSDRV_RECORDER_TYPE_USB_BULK_IN records.
+struct jsdrv_recorder_usb_s {
+    int64_t time;           ///< The transfer completion time, in i64 34Q30 UTC.
+    uint8_t endpoint;       ///< The USB endpoint address.
+    uint8_t rsv1_u8[7];     ///< Reserved, 0
+};
+
+/// An entry in JSDRV_RECORDER_TYPE_INDEX records.
+struct jsdrv_recorder_index_s {
+    uint64_t sample_id;     ///< The sample_id of the data record's first sample.
+    uint64_t offset;        ///< The file offset of the data record header.
+};
+
+/// The payload header for JSDRV_RECORDER_TYPE_SUMMARY records.
+struct jsdrv_recorder_summary_s {
+    uint64_t sample_id;         ///< The sample_id of the first sample for the first entry.
+    uint32_t samples_per_entry; ///< The number of samples for each entry.
+    uint8_t level;              ///< The summary level, 1 to JSDRV_RECORDER_SUMMARY_LEVELS.
+    uint8_t rsv1_u8[3];         ///< Reserved, 0
+};
+
+/// The signal information from jsdrv_recorder_reader_info().
+struct jsdrv_recorder_signal_info_s {
+    uint16_t signal_id;         ///< The signal identifier.
+    uint8_t element_type;       ///< jsdrv_data_type_e
+    uint8_t element_size_bits;  ///< The element size in bits.
+    uint32_t sample_rate;       ///< The sample rate for sample_id.
+    uint32_t decimate_factor;   ///< The sample_id increment for each sample.
+    uint8_t summary_levels;     ///< The number of available summary levels, 0 for none.
+    uint8_t rsv1_u8[3];         ///< Reserved, 0
+    uint64_t sample_id_start;   ///< The first sample_id.
+    uint64_t sample_id_end;     ///< The sample_id after the last sample.
+    struct jsdrv_time_map_s time_map;   ///< The time map from the first data record.
+    char topic[JSDRV_TOPIC_LENGTH_MAX]; ///< The data topic, or "" if unknown.
+};
+
+/// The recorder status.
+struct jsdrv_recorder_status_s {
+    uint64_t bytes;         ///< The total bytes written to the file.
+    uint64_t messages;      ///< The total stream messages recorded.
+    uint32_t drops;         ///< The total stream messages dropped.
+    int32_t error;          ///< The first write error, or 0.
+};
+
+/// The opaque recorder instance.
+struct jsdrv_recorder_s;
+
+/**
+ * @brief Create a recorder.
+ *
+ * @param context The Joulescope driver context.  NULL only records
+ *      application data from jsdrv_recorder_user_data().
+ * @param path The file path, which is overwritten.
+ * @param buffer_size The total in-memory buffer size in bytes.
+ *      0 uses the default of 64 MB.
+ * @param[out] recorder The new recorder instance.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_recorder_open(struct jsdrv_context_s * context, const char * path,
+        uint32_t buffer_size, struct jsdrv_recorder_s ** recorder);
+
+/**
+ * @brief Record a stream data topic.
+ *
+ * @param recorder The recorder instance.
+ * @param signal_id The signal identifier for this topic, 1 to 65535.
+ * @param topic The stream data topic, such as "u/js220/000415/s/i/!data".
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_recorder_add(struct jsdrv_recorder_s * recorder, uint16_t signal_id, const char * topic);
+
+/**
+ * @brief Add application data to the recording.
+ *
+ * @param recorder The recorder instance.
+ * @param chunk_meta The application-defined metadata.
+ * @param data The data.
+ * @param size The size of data in bytes.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_recorder_user_data(struct jsdrv_recorder_s * recorder, uint16_t chunk_meta,
+        const void * data, uint32_t size);
+
+/**
+ * @brief Add a USB capture device to the recording.
+ *
+ * @param recorder The recorder instance.
+ * @param device_id The capture device identifier, 1 to 65535.
+ * @param prefix The device prefix, such as "u/js220/000415".
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_recorder_usb_device(struct jsdrv_recorder_s * recorder, uint16_t device_id,
+        const char * prefix);
+
+/**
+ * @brief Add a raw USB bulk-in transfer to the recording.
+ *
+ * @param recorder The recorder instance.
+ * @param device_id The capture device identifier from jsdrv_recorder_usb_device().
+ * @param endpoint The USB endpoint address.
+ * @param time The transfer completion time, in i64 34Q30 UTC.
+ * @param data The transfer data.
+ * @param size The size of data in bytes.
+ * @return 0 or error code.  Like stream data, full buffers count as drops.
+ */
+JSDRV_API int32_t jsdrv_recorder_usb_bulk_in(struct jsdrv_recorder_s * recorder, uint16_t device_id,
+        uint8_t endpoint, int64_t time, const void * data, uint32_t size);
+
+/**
+ * @brief Add stream data to the recording.
+ *
+ * @param recorder The recorder instance.
+ * @param signal_id The signal identifier, 1 to 65535.
+ * @param data The jsdrv_stream_signal_s header followed by packed data.
+ * @param size The size of data in bytes.
+ * @return 0 or error code.  Like subscribed topics, full buffers count as drops.
+ *
+ * Use this function to record data that does not come from a
+ * jsdrv_recorder_add() topic, such as processed or generated data.
+ */
+JSDRV_API int32_t jsdrv_recorder_stream(struct jsdrv_recorder_s * recorder, uint16_t signal_id,
+        const void * data, uint32_t size);
+
+/**
+ * @brief Select the compression for subsequent stream data.
+ *
+ * @param recorder The recorder instance.
+ * @param codec The jsdrv_stream_codec_e.  The default is
+ *      JSDRV_STREAM_CODEC_NONE.
+ * @return 0 or JSDRV_ERROR_NOT_SUPPORTED.
+ *
+ * The writer thread encodes the data records after computing their
+ * index and summary, so compression does not delay the frontend thread.
+ * Records that do not get smaller remain uncompressed.
+ */
+JSDRV_API int32_t jsdrv_recorder_codec(struct jsdrv_recorder_s * recorder, uint8_t codec);
+
+/**
+ * @brief Get the recorder status.
+ *
+ * @param recorder The recorder instance.
+ * @param[out] status The status.
+ */
+JSDRV_API void jsdrv_recorder_status(struct jsdrv_recorder_s * recorder, struct jsdrv_recorder_status_s * status);
+
+/**
+ * @brief Stop recording, write all buffered data, and close the file.
+ *
+ * @param recorder The recorder instance.
+ * @return 0 or the first write error.
+ */
+JSDRV_API int32_t jsdrv_recorder_close(struct jsdrv_recorder_s * recorder);
+
+/// The opaque recording reader instance.
+struct jsdrv_recorder_reader_s;
+
+/**
+ * @brief Open a recording for random access.
+ *
+ * @param path The recording file path.
+ * @param[out] reader The new reader instance.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_recorder_reader_open(const char * path, struct jsdrv_recorder_reader_s ** reader);
+
+/**
+ * @brief Close a reader.
+ *
+ * @param reader The reader instance.
+ */
+JSDRV_API void jsdrv_recorder_reader_close(struct jsdrv_recorder_reader_s * reader);
+
+/**
+ * @brief List the signals with data.
+ *
+ * @param reader The reader instance.
+ * @param[out] signal_ids The signal identifiers.
+ * @param length The maximum number of signal_ids.
+ * @return The total number of signals, which may exceed length.
+ */
+JSDRV_API uint32_t jsdrv_recorder_reader_signals(struct jsdrv_recorder_reader_s * reader,
+        uint16_t * signal_ids, uint32_t length);
+
+/**
+ * @brief Get the signal information.
+ *
+ * @param reader The reader instance.
+ * @param signal_id The signal identifier.
+ * @param[out] info The signal information.
+ * @return 0 or JSDRV_ERROR_NOT_FOUND.
+ */
+JSDRV_API int32_t jsdrv_recorder_reader_info(struct jsdrv_recorder_reader_s * reader, uint16_t signal_id,
+        struct jsdrv_recorder_signal_info_s * info);
+
+/**
+ * @brief Read samples.
+ *
+ * @param reader The reader instance.
+ * @param signal_id The signal identifier.
+ * @param sample_id The first sample_id.
+ * @param length The number of samples.
+ * @param[out] data The samples in the signal's element format, packed.
+ *      Missing samples are NaN for float32 and 0 otherwise.
+ * @return 0 or error code.
+ *
+ * This function finds the first data record with a binary search of the
+ * index, then reads only the data records that overlap the request.
+ */
+JSDRV_API int32_t jsdrv_recorder_reader_samples(struct jsdrv_recorder_reader_s * reader, uint16_t signal_id,
+        uint64_t sample_id, uint32_t length, void * data);
+
+/**
+ * @brief Read raw ADC samples and calibrate them.
+ *
+ * @param reader The reader instance.
+ * @param adc_signal_id The i16 raw ADC signal identifier.
+ * @param range_signal_id The u4 range signal identifier,
+ *      or 0 to use range 0 for all samples.
+ * @param cal The calibration coefficients.
+ * @param sample_id The first sample_id.
+ * @param length The number of samples.
+ * @param[out] data The calibrated float32 samples.
+ * @return 0 or error code.
+ * @see jsdrv_raw_cal_apply
+ *
+ * This function applies calibration to raw signals recorded at full rate,
+ * which use half the file size of the calibrated float32 signals.
+ * The range signal must have the same decimate_factor as the ADC signal.
+ */
+JSDRV_API int32_t jsdrv_recorder_reader_raw_cal(struct jsdrv_recorder_reader_s * reader,
+        uint16_t adc_signal_id, uint16_t range_signal_id, const struct jsdrv_raw_cal_s * cal,
+        uint64_t sample_id, uint32_t length, float * data);
+
+/**
+ * @brief Read summary statistics for a float32 signal.
+ *
+ * @param reader The reader instance.
+ * @param signal_id The signal identifier.
+ * @param sample_id The first sample_id.
+ * @param increment The sample_id increment for each entry.
+ * @param[out] entries The summary entries.  Entries without samples are NaN.
+ * @param length The number of entries.
+ * @return 0 or error code.
+ *
+ * Each entry combines the largest summary entries that fit within its
+ * window, and only reads samples for the unaligned window edges.  The
+ * cost for each entry is therefore independent of the increment.
+ */
+JSDRV_API int32_t jsdrv_recorder_reader_summary(struct jsdrv_recorder_reader_s * reader, uint16_t signal_id,
+        uint64_t sample_id, uint64_t increment, struct jsdrv_summary_entry_s * entries, uint32_t length);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_RECORDER_H__ */
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Shared-memory pubsub bridge for other processes.
+ */
+
+#ifndef JSDRV_SHM_H__
+#define JSDRV_SHM_H__
+
+#include "jsdrv.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_shm Shared-memory bridge
+ *
+ * @brief Mirror pubsub topics into a shared-memory ring for other processes.
+ *
+ * The driver process opens a bridge and adds the topics to mirror,
+ * such as "u/js220/+/s/i/!data" or "u/js220/+/s/stats/value".
+ * Each published value is copied once into a named shared-memory
+ * ring.  Any number of reader processes open the same name without
+ * calling jsdrv_initialize(), and each reader receives every
+ * message through a pointer directly into the shared memory.
+ *
+ * The writer never waits for readers.  A reader that falls more than
+ * one ring size behind skips ahead to the newest data and counts
+ * the drop.  Since the writer may overwrite a message while a slow reader
+ * is still using it, call jsdrv_shm_reader_check() after processing
+ * a message when the result must be intact.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The opaque writer instance in the driver process.
+struct jsdrv_shm_bridge_s;
+
+/// The opaque reader instance in another process.
+struct jsdrv_shm_reader_s;
+
+/**
+ * @brief Create a shared-memory bridge.
+ *
+ * @param context The Joulescope driver context, or NULL to only use
+ *      jsdrv_shm_bridge_write().
+ * @param name The shared-memory name, which must be unique on this host.
+ * @param size The ring size in bytes, which must be a power of 2
+ *      from 64 kB to 1 GB.
+ * @param[out] bridge The new bridge instance.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_shm_bridge_open(struct jsdrv_context_s * context, const char * name, uint32_t size,
+        struct jsdrv_shm_bridge_s ** bridge);
+
+/**
+ * @brief Mirror a topic into the bridge.
+ *
+ * @param bridge The bridge instance.
+ * @param topic The topic to mirror, which may contain '+' and '#' wildcards.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_shm_bridge_add(struct jsdrv_shm_bridge_s * bridge, const char * topic);
+
+/**
+ * @brief Stop mirroring a topic.
+ *
+ * @param bridge The bridge instance.
+ * @param topic The topic previously provided to jsdrv_shm_bridge_add().
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_shm_bridge_remove(struct jsdrv_shm_bridge_s * bridge, const char * topic);
+
+/**
+ * @brief Write a message to the bridge.
+ *
+ * @param bridge The bridge instance.
+ * @param topic The message topic.
+ * @param value The message value.
+ * @return 0 or error code.  Returns #JSDRV_ERROR_TOO_BIG
+ *      for values larger than 1/4 of the ring.
+ *
+ * The bridge mirrors added topics automatically.  This function
+ * also allows the application to add its own messages.
+ */
+JSDRV_API int32_t jsdrv_shm_bridge_write(struct jsdrv_shm_bridge_s * bridge,
+        const char * topic, const struct jsdrv_union_s * value);
+
+/**
+ * @brief Close the bridge and free all resources.
+ *
+ * @param bridge The bridge instance.
+ *
+ * Readers that still have the ring open drain the remaining messages,
+ * then receive #JSDRV_ERROR_CLOSED.
+ */
+JSDRV_API void jsdrv_shm_bridge_close(struct jsdrv_shm_bridge_s * bridge);
+
+/**
+ * @brief Open an existing bridge for reading.
+ *
+ * @param name The shared-memory name provided to jsdrv_shm_bridge_open().
+ * @param[out] reader The new reader instance, which starts
+ *      with the next message written.
+ * @return 0, #JSDRV_ERROR_NOT_FOUND, or error code.
+ */
+JSDRV_API int32_t jsdrv_shm_reader_open(const char * name, struct jsdrv_shm_reader_s ** reader);
+
+/**
+ * @brief Get the next message.
+ *
+ * @param reader The reader instance.
+ * @param[out] topic The message topic.
+ * @param[out] value The message value.  Pointer values reference
+ *      the shared memory directly.
+ * @param timeout_ms The maximum time to wait for a message.
+ * @return 0, #JSDRV_ERROR_TIMED_OUT, #JSDRV_ERROR_CLOSED, or error code.
+ *
+ * The topic and value remain valid until the next call to this function,
+ * unless the writer overwrites them first.  See jsdrv_shm_reader_check().
+ */
+JSDRV_API int32_t jsdrv_shm_reader_next(struct jsdrv_shm_reader_s * reader,
+        const char ** topic, struct jsdrv_union_s * value, uint32_t timeout_ms);
+
+/**
+ * @brief Check that the writer did not overwrite the current message.
+ *
+ * @param reader The reader instance.
+ * @return 0 if the message from jsdrv_shm_reader_next() is still intact,
+ *      or #JSDRV_ERROR_ABORTED if the reader must discard it.
+ */
+JSDRV_API int32_t jsdrv_shm_reader_check(struct jsdrv_shm_reader_s * reader);
+
+/**
+ * @brief Get the number of times this reader fell behind and skipped messages.
+ *
+ * @param reader The reader instance.
+ * @return The total drop event count.
+ */
+JSDRV_API uint32_t jsdrv_shm_reader_drops(struct jsdrv_shm_reader_s * reader);
+
+/**
+ * @brief Close the reader and free all resources.
+ *
+ * @param reader The reader instance.
+ */
+JSDRV_API void jsdrv_shm_reader_close(struct jsdrv_shm_reader_s * reader);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_SHM_H__ */
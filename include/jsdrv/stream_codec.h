@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Lossless compression for stream data messages.
+ */
+
+#ifndef JSDRV_STREAM_CODEC_H__
+#define JSDRV_STREAM_CODEC_H__
+
+#include "jsdrv.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_stream_codec Stream codec
+ *
+ * @brief Losslessly compress jsdrv_stream_signal_s payloads for transport.
+ *
+ * An encoded message contains the unmodified jsdrv_stream_signal_s
+ * header, JSDRV_STREAM_HEADER_SIZE bytes, followed by the encoded
+ * samples.  The transport identifies the codec, such as the
+ * jsdrv_net_frame_header_s codec field or the
+ * jsdrv_recorder_record_header_s codec field.
+ *
+ * JSDRV_STREAM_CODEC_F32 applies to float32 samples.  It stores the
+ * first sample, then bit-packs each group of 32 zigzag encoded
+ * differences between consecutive sample bit patterns with the width
+ * of the largest difference.  Each group is one width byte followed
+ * by the packed bits, least significant bit first.  Slowly changing
+ * signals share their sign and exponent between samples, so each
+ * sample typically needs 1 to 2 bytes instead of 4.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The stream codecs.
+enum jsdrv_stream_codec_e {
+    JSDRV_STREAM_CODEC_NONE = 0,    ///< Uncompressed.
+    JSDRV_STREAM_CODEC_F32 = 1,     ///< float32 difference bit-packing.
+};
+
+/**
+ * @brief Encode a stream data message.
+ *
+ * @param codec The jsdrv_stream_codec_e.
+ * @param dst The output encoded message.
+ * @param dst_size The size of dst in bytes.
+ * @param src The stream data message.
+ * @return The encoded message size in bytes, or 0 when the codec does
+ *      not apply to src or the encoded message is not smaller than src.
+ *      On 0, send src uncompressed.
+ */
+JSDRV_API uint32_t jsdrv_stream_codec_encode(uint8_t codec, void * dst, uint32_t dst_size,
+        const struct jsdrv_stream_signal_s * src);
+
+/**
+ * @brief Decode a stream data message.
+ *
+ * @param codec The jsdrv_stream_codec_e from the transport.
+ * @param dst The output stream data message.
+ * @param dst_size The size of dst in bytes.
+ * @param src The encoded message.
+ * @param src_size The size of src in bytes.
+ * @return 0 or error code.  Invalid and truncated src return
+ *      JSDRV_ERROR_PARAMETER_INVALID without reading past src_size.
+ */
+JSDRV_API int32_t jsdrv_stream_codec_decode(uint8_t codec, struct jsdrv_stream_signal_s * dst, uint32_t dst_size,
+        const void * src, uint32_t src_size);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_STREAM_CODEC_H__ */
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Pull-based stream reader.
+ */
+
+#ifndef JSDRV_STREAM_READER_H__
+#define JSDRV_STREAM_READER_H__
+
+#include "jsdrv.h"
+#include "jsdrv/stream_ring.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_stream_reader Stream reader
+ *
+ * @brief Poll stream data without subscriber callbacks.
+ *
+ * A stream reader owns a subscription and a jsdrv_stream_ring_s.
+ * The frontend thread only copies each stream message into the ring,
+ * so a slow consumer never stalls the driver.  The consumer calls
+ * jsdrv_stream_read() from any one thread at a time.  When the
+ * consumer falls behind and the ring fills, new messages are dropped
+ * and reported in jsdrv_stream_ring_info_s.drops.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The default ring capacity in bytes for jsdrv_stream_reader_open().
+#define JSDRV_STREAM_READER_CAPACITY_DEFAULT (1U << 25)
+
+/// The opaque reader instance.
+struct jsdrv_stream_reader_s;
+
+/**
+ * @brief Open a stream reader.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The stream topic, such as "u/js220/000415/s/i/!data".
+ * @param capacity The ring capacity in bytes, which is rounded up to a
+ *      power of 2 from 256 kB to 1 GB.  0 uses
+ *      #JSDRV_STREAM_READER_CAPACITY_DEFAULT.
+ * @param[out] reader The new reader instance.
+ * @return 0 or error code.
+ *
+ * This function subscribes to topic, so do not call it from a
+ * subscriber callback.  Enable the stream using its "ctrl" topic
+ * separately.
+ */
+JSDRV_API int32_t jsdrv_stream_reader_open(struct jsdrv_context_s * context, const char * topic,
+        uint32_t capacity, struct jsdrv_stream_reader_s ** reader);
+
+/**
+ * @brief Close a stream reader.
+ *
+ * @param reader The reader instance, which is invalid when this function returns.
+ * @return 0 or error code.
+ *
+ * This function unsubscribes, then frees the ring with any unread data.
+ */
+JSDRV_API int32_t jsdrv_stream_reader_close(struct jsdrv_stream_reader_s * reader);
+
+/**
+ * @brief Read contiguous samples.
+ *
+ * @param reader The reader instance.
+ * @param buffer The destination buffer, which must hold max_samples
+ *      elements.  1 and 4 bit data use one uint8 per sample.
+ * @param max_samples The maximum number of samples to read.
+ * @param[out] info The description of the samples written to buffer.
+ * @param timeout_ms The maximum time to wait for the first sample.
+ * @return 0, #JSDRV_ERROR_TIMED_OUT, or error code.
+ *
+ * Reads stop early at a gap or at a change in the stream format.
+ * See jsdrv_stream_ring_read().
+ */
+JSDRV_API int32_t jsdrv_stream_read(struct jsdrv_stream_reader_s * reader, void * buffer, uint32_t max_samples,
+        struct jsdrv_stream_ring_info_s * info, uint32_t timeout_ms);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_STREAM_READER_H__ */
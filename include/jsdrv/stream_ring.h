@@ -0,0 +1,132 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Native stream ring for language bindings.
+ */
+
+#ifndef JSDRV_STREAM_RING_H__
+#define JSDRV_STREAM_RING_H__
+
+#include "jsdrv.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_stream_ring Stream ring
+ *
+ * @brief Buffer stream data for a consumer thread that reads in bulk.
+ *
+ * Subscribe jsdrv_stream_ring_on_publish() with the ring as the
+ * user data.  The frontend thread copies each stream message into the
+ * ring and returns immediately, so a busy consumer, such as a Python
+ * thread waiting for the GIL, never stalls the driver.
+ * The consumer calls jsdrv_stream_ring_read() to drain many messages
+ * into one caller-provided buffer.
+ *
+ * The ring has exactly one producer (the subscription) and one consumer.
+ * When the ring is full, the producer drops the new message and counts
+ * the drop.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The opaque ring instance.
+struct jsdrv_stream_ring_s;
+
+/// The description of the samples from jsdrv_stream_ring_read().
+struct jsdrv_stream_ring_info_s {
+    uint64_t sample_id;                     ///< The sample_id for the first sample.
+    uint8_t field_id;                       ///< jsdrv_field_e
+    uint8_t index;                          ///< The channel index within the field.
+    uint8_t element_type;                   ///< jsdrv_element_type_e, float for deadband hold records.
+    uint8_t element_size_bits;              ///< The element size in bits, 8 for unpacked 1 and 4 bit data.
+    uint32_t element_count;                 ///< The number of elements written to the buffer.
+    uint32_t sample_rate;                   ///< The frequency for sample_id.
+    uint32_t decimate_factor;               ///< The decimation factor from sample_id to data samples.
+    struct jsdrv_time_map_s time_map;       ///< The most recent time map.
+    uint32_t message_count;                 ///< The number of stream messages read, including partial.
+    uint32_t drops;                         ///< The messages dropped since the previous read.
+};
+
+/**
+ * @brief Allocate a new stream ring.
+ *
+ * @param size The ring size in bytes, which must be a power of 2
+ *      from 256 kB to 1 GB.
+ * @return The new ring instance or NULL.
+ */
+JSDRV_API struct jsdrv_stream_ring_s * jsdrv_stream_ring_alloc(uint32_t size);
+
+/**
+ * @brief Free a stream ring.
+ *
+ * @param self The ring instance.  The caller must unsubscribe first.
+ */
+JSDRV_API void jsdrv_stream_ring_free(struct jsdrv_stream_ring_s * self);
+
+/**
+ * @brief The jsdrv_subscribe_fn that adds stream messages to the ring.
+ *
+ * @param user_data The ring instance.
+ * @param topic The topic, which is ignored.
+ * @param value The value.  Only JSDRV_PAYLOAD_TYPE_STREAM values are added.
+ */
+JSDRV_API void jsdrv_stream_ring_on_publish(void * user_data, const char * topic, const struct jsdrv_union_s * value);
+
+/**
+ * @brief Read contiguous samples from the ring.
+ *
+ * @param self The ring instance.
+ * @param buffer The destination buffer for the sample data.
+ * @param buffer_size The size of buffer in bytes, which should hold
+ *      at least one element.
+ * @param[out] info The description of the samples written to buffer.
+ * @param timeout_ms The maximum time to wait for the first message.
+ * @return 0, #JSDRV_ERROR_TIMED_OUT, or error code.
+ *
+ * This function copies messages until the buffer is full, the ring is
+ * empty, or the next message is not contiguous with the previous one.
+ * Messages that do not fit continue on the next read.
+ * 1 and 4 bit data is unpacked to one uint8 per sample.
+ */
+JSDRV_API int32_t jsdrv_stream_ring_read(struct jsdrv_stream_ring_s * self, void * buffer, uint32_t buffer_size,
+        struct jsdrv_stream_ring_info_s * info, uint32_t timeout_ms);
+
+/**
+ * @brief Describe the next unread samples without reading them.
+ *
+ * @param self The ring instance.
+ * @param[out] info The description of the next message.  element_count
+ *      is the number of unread elements in this message, and
+ *      message_count is 1.
+ * @param timeout_ms The maximum time to wait for a message.
+ * @return 0, #JSDRV_ERROR_TIMED_OUT, or error code.
+ *
+ * This function does not change drops.
+ */
+JSDRV_API int32_t jsdrv_stream_ring_peek(struct jsdrv_stream_ring_s * self,
+        struct jsdrv_stream_ring_info_s * info, uint32_t timeout_ms);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_STREAM_RING_H__ */
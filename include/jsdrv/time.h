@@ -436,6 +436,49 @@ JSDRV_API int64_t jsdrv_time_from_counter(const struct jsdrv_time_map_s * self,
  */
 JSDRV_API uint64_t jsdrv_time_to_counter(const struct jsdrv_time_map_s * self, int64_t time64);
 
+/**
+ * @brief Convert an array of counter values to JSDRV time.
+ *
+ * @param self The time mapping instance.
+ * @param counter The counter values.
+ * @param[out] time64 The JSDRV times, which may not alias counter.
+ * @param length The number of values.
+ *
+ * Each result matches jsdrv_time_from_counter().
+ */
+JSDRV_API void jsdrv_time_from_counter_array(const struct jsdrv_time_map_s * self,
+        const uint64_t * counter, int64_t * time64, size_t length);
+
+/**
+ * @brief Convert an array of JSDRV times to counter values.
+ *
+ * @param self The time mapping instance.
+ * @param time64 The JSDRV times.
+ * @param[out] counter The counter values, which may not alias time64.
+ * @param length The number of values.
+ *
+ * Each result matches jsdrv_time_to_counter().
+ */
+JSDRV_API void jsdrv_time_to_counter_array(const struct jsdrv_time_map_s * self,
+        const int64_t * time64, uint64_t * counter, size_t length);
+
+/**
+ * @brief Compute the JSDRV times for evenly spaced counter values.
+ *
+ * @param self The time mapping instance.
+ * @param counter_start The first counter value.
+ * @param counter_step The counter increment between values, such as
+ *      the stream decimate_factor.
+ * @param[out] time64 The JSDRV times.
+ * @param length The number of values.
+ *
+ * Entry i matches jsdrv_time_from_counter() for
+ * counter_start + i * counter_step, which builds the x-axis for a
+ * block of samples without a counter array.
+ */
+JSDRV_API void jsdrv_time_from_counter_range(const struct jsdrv_time_map_s * self,
+        uint64_t counter_start, uint64_t counter_step, int64_t * time64, size_t length);
+
 JSDRV_CPP_GUARD_END
 
 /** @} */
@@ -74,6 +74,19 @@ enum jsdrv_union_flag_e {
     /// The value points to a const that will remain valid indefinitely.
     JSDRV_UNION_FLAG_CONST = (1 << 1),
 
+    /**
+     * @brief The value points to immutable memory that outlives the driver.
+     *
+     * The driver passes the pointer through without copying, even for
+     * values larger than the message payload.  Use for static tables and
+     * for large buffers, such as firmware images, that the application
+     * keeps until jsdrv_finalize().
+     */
+    JSDRV_UNION_FLAG_STATIC = (1 << 2),
+
+    /// The value uses reference-counted heap memory shared between messages (driver internal).
+    JSDRV_UNION_FLAG_SHARED_MEMORY = (1 << 6),
+
     /// The value uses dynamically allocated heap memory that must be freed.
     JSDRV_UNION_FLAG_HEAP_MEMORY = (1 << 7),
 };
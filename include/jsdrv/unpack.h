@@ -0,0 +1,69 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Unpack 1-bit and 4-bit sample data.
+ */
+
+#ifndef JSDRV_UNPACK_H__
+#define JSDRV_UNPACK_H__
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv
+ * @defgroup jsdrv_unpack Unpack
+ *
+ * @brief Expand packed sample data to one uint8 per sample.
+ *
+ * Stream and buffer data for current range (u4) and general-purpose
+ * inputs (u1) pack multiple samples into each byte, starting with the
+ * least significant bits.  These functions use SSE2 on x86-64 and
+ * NEON on ARM64, with a portable fallback.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/**
+ * @brief Unpack 4-bit samples.
+ *
+ * @param y The output samples, one per byte.
+ * @param x The packed input samples, 2 per byte.
+ * @param offset The index of the first sample in x to unpack.
+ * @param length The number of samples to unpack.
+ */
+JSDRV_API void jsdrv_u4_unpack(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length);
+
+/**
+ * @brief Unpack 1-bit samples.
+ *
+ * @param y The output samples, one per byte, each 0 or 1.
+ * @param x The packed input samples, 8 per byte.
+ * @param offset The index of the first sample in x to unpack.
+ * @param length The number of samples to unpack.
+ */
+JSDRV_API void jsdrv_u1_unpack(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_UNPACK_H__ */
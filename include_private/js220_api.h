@@ -336,7 +336,7 @@ struct js220_port3_msg_s {
 };
 
 typedef union js220_i128_u {
-#if defined(__clang__) || defined(__GNUC__)
+#if defined(__SIZEOF_INT128__)
     __extension__ __int128 i128;
 #endif
     int64_t i64[2];
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Cross-device sample alignment groups.
+ */
+
+#ifndef JSDRV_PRV_ALIGN_H_
+#define JSDRV_PRV_ALIGN_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+// Forward declarations from "jsdrv.h"
+struct jsdrv_context_s;
+
+#ifndef JSDRV_ALIGN_COUNT_MAX
+#define JSDRV_ALIGN_COUNT_MAX                         8
+#endif
+
+#ifndef JSDRV_ALIGN_HISTORY
+#define JSDRV_ALIGN_HISTORY                           (1U << 21)  // samples for each channel
+#endif
+
+// topics for the alignment manager: add/remove groups
+#define JSDRV_ALIGN_MGR_MSG_ACTION_ADD                "a/@/!add"      // u8: 1 <= id <= JSDRV_ALIGN_COUNT_MAX
+#define JSDRV_ALIGN_MGR_MSG_ACTION_REMOVE             "a/@/!remove"   // u8 id
+#define JSDRV_ALIGN_MGR_MSG_ACTION_LIST               "a/@/list"      // bin ro: u8[N] ids
+
+// topics per group: prefix is "a/GGG/" where GGG is the group id
+#define JSDRV_ALIGN_MSG_CLEAR                         "g/!clear"      // Restart the common grid
+#define JSDRV_ALIGN_MSG_RATE                          "g/rate"        // u32 grid sample rate, 0 for the slowest channel (default)
+#define JSDRV_ALIGN_MSG_BLOCK                         "g/block"       // u32 samples per channel in each block, 0 for one full message (default)
+#define JSDRV_ALIGN_MSG_DATA                          "g/!data"       // ro: jsdrv_align_block_s
+#define JSDRV_ALIGN_MSG_CHANNEL_TOPIC                 "c/ZZZ/topic"   // str: float32 source data topic, "" to remove, 1 <= ZZZ <= 16
+
+JSDRV_CPP_GUARD_START
+
+/**
+ * @brief Initialize the singleton alignment manager.
+ *
+ * @return 0 or error code.
+ */
+int32_t jsdrv_align_initialize(struct jsdrv_context_s * context);
+
+/**
+ * @brief Finalize the singleton alignment manager.
+ */
+void jsdrv_align_finalize(void);
+
+JSDRV_CPP_GUARD_END
+
+#endif  /* JSDRV_PRV_ALIGN_H_ */
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Align multiple sample streams onto a common sample grid.
+ */
+
+#ifndef JSDRV_PRV_ALIGNER_H_
+#define JSDRV_PRV_ALIGNER_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Forward declarations from "jsdrv.h"
+struct jsdrv_stream_signal_s;
+struct jsdrv_align_block_s;
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_aligner Sample stream aligner
+ *
+ * @brief Resample float32 streams from independent devices onto one grid.
+ *
+ * Each channel keeps a ring of recent samples along with the time map
+ * from its most recent stream message.  The common grid starts at the
+ * latest first sample over all channels.  For each grid sample, the
+ * aligner maps the grid time through the channel's time map to a
+ * fractional sample index, then linearly interpolates between the
+ * neighbouring samples.  This fractional delay corrects both the
+ * offset and the rate difference between devices.
+ *
+ * A block is ready once every channel holds the samples for the whole
+ * block.  When a channel falls behind by half its ring, the block is
+ * ready anyway and the missing samples are NaN, so one stalled device
+ * cannot stall the group.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The opaque aligner instance.
+struct jsdrv_aligner_s;
+
+/**
+ * @brief Allocate a new aligner.
+ *
+ * @param history The ring size in samples for each channel, rounded up
+ *      to a power of 2.
+ * @return The new instance, or NULL.
+ */
+struct jsdrv_aligner_s * jsdrv_aligner_new(uint32_t history);
+
+/**
+ * @brief Free an aligner.
+ *
+ * @param self The instance, which may be NULL.
+ */
+void jsdrv_aligner_free(struct jsdrv_aligner_s * self);
+
+/**
+ * @brief Discard all samples and restart the common grid.
+ *
+ * @param self The instance.
+ */
+void jsdrv_aligner_clear(struct jsdrv_aligner_s * self);
+
+/**
+ * @brief Configure the common grid.
+ *
+ * @param self The instance.
+ * @param sample_rate The grid sample rate, 0 for the slowest channel.
+ * @param block_samples The samples for each channel in each block.
+ *
+ * This function clears the aligner.
+ */
+void jsdrv_aligner_configure(struct jsdrv_aligner_s * self, uint32_t sample_rate, uint32_t block_samples);
+
+/**
+ * @brief Enable or disable a channel.
+ *
+ * @param self The instance.
+ * @param channel The channel index, less than JSDRV_ALIGN_CHANNEL_COUNT_MAX.
+ * @param enable True to allocate the channel ring, false to free it.
+ * @return 0 or error code.
+ *
+ * This function clears the aligner.
+ */
+int32_t jsdrv_aligner_channel(struct jsdrv_aligner_s * self, uint32_t channel, bool enable);
+
+/**
+ * @brief Add stream samples to a channel.
+ *
+ * @param self The instance.
+ * @param channel The enabled channel index.
+ * @param s The float32 stream samples or a deadband hold record.
+ * @return 0 or error code.  Gaps in sample_id become NaN.
+ */
+int32_t jsdrv_aligner_add(struct jsdrv_aligner_s * self, uint32_t channel, const struct jsdrv_stream_signal_s * s);
+
+/**
+ * @brief The size of the next block.
+ *
+ * @param self The instance.
+ * @return The block size in bytes, or 0 when no block is ready.
+ */
+uint32_t jsdrv_aligner_ready(struct jsdrv_aligner_s * self);
+
+/**
+ * @brief Produce the next block.
+ *
+ * @param self The instance.
+ * @param block The block with at least jsdrv_aligner_ready() bytes.
+ * @return 0 or JSDRV_ERROR_UNAVAILABLE when no block is ready.
+ */
+int32_t jsdrv_aligner_next(struct jsdrv_aligner_s * self, struct jsdrv_align_block_s * block);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_ALIGNER_H_ */
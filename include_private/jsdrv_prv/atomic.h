@@ -0,0 +1,113 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Minimal portable atomic operations.
+ */
+
+#ifndef JSDRV_PRV_ATOMIC_H_
+#define JSDRV_PRV_ATOMIC_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_atomic Atomic operations
+ *
+ * @brief Minimal 32-bit atomic operations for lock-free data structures.
+ *
+ * All operations are sequentially consistent on MSVC, which uses
+ * the Interlocked family.  GCC and clang use the __atomic builtins
+ * with the memory order noted for each function.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+#if defined(_MSC_VER)
+
+JSDRV_INLINE_FN uint32_t jsdrv_atomic_load_u32(volatile uint32_t * p) {
+    return (uint32_t) InterlockedOr((volatile LONG *) p, 0);
+}
+
+JSDRV_INLINE_FN void jsdrv_atomic_store_u32(volatile uint32_t * p, uint32_t value) {
+    InterlockedExchange((volatile LONG *) p, (LONG) value);
+}
+
+JSDRV_INLINE_FN uint32_t jsdrv_atomic_exchange_u32(volatile uint32_t * p, uint32_t value) {
+    return (uint32_t) InterlockedExchange((volatile LONG *) p, (LONG) value);
+}
+
+JSDRV_INLINE_FN uint32_t jsdrv_atomic_add_u32(volatile uint32_t * p, uint32_t value) {
+    return (uint32_t) InterlockedExchangeAdd((volatile LONG *) p, (LONG) value) + value;
+}
+
+JSDRV_INLINE_FN bool jsdrv_atomic_cas_u32(volatile uint32_t * p, uint32_t expected, uint32_t desired) {
+    return ((uint32_t) InterlockedCompareExchange((volatile LONG *) p, (LONG) desired, (LONG) expected)) == expected;
+}
+
+JSDRV_INLINE_FN void jsdrv_atomic_fence(void) {
+    MemoryBarrier();
+}
+
+#else  /* GCC, clang */
+
+/// Load with acquire semantics.
+JSDRV_INLINE_FN uint32_t jsdrv_atomic_load_u32(volatile uint32_t * p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+/// Store with release semantics.
+JSDRV_INLINE_FN void jsdrv_atomic_store_u32(volatile uint32_t * p, uint32_t value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+/// Exchange with sequentially consistent semantics, return the previous value.
+JSDRV_INLINE_FN uint32_t jsdrv_atomic_exchange_u32(volatile uint32_t * p, uint32_t value) {
+    return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+/// Add with sequentially consistent semantics, return the new value.
+JSDRV_INLINE_FN uint32_t jsdrv_atomic_add_u32(volatile uint32_t * p, uint32_t value) {
+    return __atomic_add_fetch(p, value, __ATOMIC_SEQ_CST);
+}
+
+/// Compare and swap with sequentially consistent semantics, return true on success.
+JSDRV_INLINE_FN bool jsdrv_atomic_cas_u32(volatile uint32_t * p, uint32_t expected, uint32_t desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/// Full memory barrier.
+JSDRV_INLINE_FN void jsdrv_atomic_fence(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_ATOMIC_H_ */
@@ -32,6 +32,13 @@
 #define JSDRV_USBBK_MSG_BULK_IN_STREAM_OPEN     "bulk/in/s/!open"
 #define JSDRV_USBBK_MSG_BULK_IN_STREAM_CLOSE    "bulk/in/s/!close"
 #define JSDRV_USBBK_MSG_BULK_OUT_DATA           "bulk/out/!data"
+#define JSDRV_USBBK_MSG_CONFIG_PREFIX           "h/usb/"            // device thread forwards, ll responds with i32 return code
+#define JSDRV_USBBK_MSG_BULK_IN_TRANSFERS       "h/usb/bulk_in/transfers"   // u32 outstanding transfers per endpoint
+#define JSDRV_USBBK_MSG_BULK_IN_SIZE            "h/usb/bulk_in/size"        // u32 transfer size in bytes, multiple of 512
+#define JSDRV_USBBK_MSG_BULK_IN_ADAPTIVE        "h/usb/bulk_in/adaptive"    // u32 maximum outstanding transfers, 0 for fixed
+#define JSDRV_USBBK_MSG_BULK_IN_RAW_IO          "h/usb/bulk_in/raw_io"      // u32 1 (default) for WinUSB RAW_IO on streams opened later
+#define JSDRV_USBBK_MSG_STATS_INTERVAL          "h/usb/stats/interval"      // u32 statistics period in milliseconds, 0 for off
+#define JSDRV_USBBK_MSG_STATS                   "h/usb/stats"       // produced by ll, JSON jsdrv_usb_stats_json()
 
 JSDRV_CPP_GUARD_START
 
@@ -24,6 +24,7 @@
 #define JSDRV_PRV_BUFFER_H_
 
 #include "jsdrv/cmacro_inc.h"
+#include "jsdrv_prv/msg_queue.h"
 #include <stdint.h>
 
 // Forward declarations from "jsdrv.h"
@@ -46,13 +47,33 @@ struct jsdrv_context_s;
 #define JSDRV_BUFFER_MSG_ACTION_SIGNAL_ADD            "a/!add"          // u8 id, 1 <= id <= JSDRV_BUFSIG_COUNT_MAX
 #define JSDRV_BUFFER_MSG_ACTION_SIGNAL_REMOVE         "a/!remove"       // u8 id
 #define JSDRV_BUFFER_MSG_ACTION_CLEAR                 "g/!clear"        // Clear the buffer
+#define JSDRV_BUFFER_MSG_SNAPSHOT                     "g/!snapshot"     // u8 target buffer id: move the samples into the target, keep ingesting
+#define JSDRV_BUFFER_MSG_SAVE                         "g/!save"         // str directory: save each signal to jsdrv_signal_ZZZ.bin
+#define JSDRV_BUFFER_MSG_LOAD                         "g/!load"         // str directory: replace the signals with read-only saved signals
 #define JSDRV_BUFFER_MSG_LIST                         "g/list"          // bin ro: u8[N] ids
 #define JSDRV_BUFFER_MSG_SIZE                         "g/size"          // u64 size in bytes
 #define JSDRV_BUFFER_MSG_HOLD                         "g/hold"          // u8: 0=run (default), 1=hold, clear on 1->0
+#define JSDRV_BUFFER_MSG_PATH                         "g/path"          // str: directory for file-backed samples, "" for RAM (default)
 #define JSDRV_BUFFER_MSG_MODE                         "g/mode"          // 0:continuous, 1:fill & hold
+#define JSDRV_BUFFER_MSG_LATENCY                      "g/latency"       // u32 target summary request latency in us, 0 for fixed reductions (default)
+#define JSDRV_BUFFER_MSG_COMPRESS                     "g/compress"      // u8 expected float32 level 0 compression ratio, 0 for raw (default), up to 8
+#define JSDRV_BUFFER_MSG_HORIZON                      "g/horizon"       // u32 seconds of samples, older data keeps summaries only, 0 for all (default)
+#define JSDRV_BUFFER_MSG_REBALANCE                    "g/rebalance"     // u8: 0=signal add/remove keeps other signals (default), 1=reallocate all
+#define JSDRV_BUFFER_MSG_PAGES                        "g/pages"         // u8 jsdrv_page_mode_e: 0=heap (default), 1=transparent huge pages, 2=reserved huge pages
+#define JSDRV_BUFFER_MSG_NUMA                         "g/numa"          // u32 NUMA node + 1 for the sample memory, 0 for the buffer thread's node (default)
+#define JSDRV_BUFFER_MSG_SOURCE                       "g/source"        // u8 buffer id whose samples this buffer views, 0 to store samples (default)
+#define JSDRV_BUFFER_MSG_VIEW                         "g/view"          // u32 milliseconds of newest samples for a view, 0 for all (default)
+#define JSDRV_BUFFER_MSG_SAMPLE_REQ                   "g/!req"          // jsdrv_buffer_request_multi_s
+#define JSDRV_BUFFER_MSG_STATS_REQ                    "g/!stats"        // jsdrv_buffer_request_multi_s
+#define JSDRV_BUFFER_MSG_CANCEL                       "g/!cancel"       // str rsp_topic: discard its pending requests and stop its chunked responses
+#define JSDRV_BUFFER_MSG_TRIGGER                     "g/trigger"       // jsdrv_buffer_trigger_s
 #define JSDRV_BUFFER_MSG_SIGNAL_TOPIC                 "s/ZZZ/topic"     // str: source data topic
 #define JSDRV_BUFFER_MSG_SIGNAL_INFO                  "s/ZZZ/info"      // ro: jsdrv_buffer_info_s
 #define JSDRV_BUFFER_MSG_SIGNAL_SAMPLE_REQ            "s/ZZZ/!req"      // jsdrv_buffer_request_s
+#define JSDRV_BUFFER_MSG_SIGNAL_SEARCH                "s/ZZZ/!search"   // jsdrv_buffer_search_s
+#define JSDRV_BUFFER_MSG_SIGNAL_R0                    "s/ZZZ/r0"        // u32 samples in the first reduction, power of 2, 0 for automatic (default)
+#define JSDRV_BUFFER_MSG_SIGNAL_RN                    "s/ZZZ/rN"        // u32 entries in subsequent reductions, power of 2, 0 for automatic (default)
+#define JSDRV_BUFFER_MSG_SIGNAL_LEVELS                "s/ZZZ/levels"    // ro bin: u64[] bytes for the samples, then for each reduction level
 
 JSDRV_CPP_GUARD_START
 
@@ -68,6 +89,16 @@ int32_t jsdrv_buffer_initialize(struct jsdrv_context_s * context);
  */
 void jsdrv_buffer_finalize(void);
 
+/**
+ * @brief Report the depth of each buffer's command and request queues.
+ *
+ * @param fn The function called with "buffer/{id}/cmd_q" and
+ *      "buffer/{id}/req_q" for each active buffer.
+ * @param user_data The arbitrary data for fn.
+ * @note Only call from the frontend thread, which adds and removes buffers.
+ */
+void jsdrv_buffer_queue_depths(msg_queue_depth_fn fn, void * user_data);
+
 
 
 JSDRV_CPP_GUARD_END
@@ -26,14 +26,24 @@
 #include "jsdrv/cmacro_inc.h"
 #include "jsdrv.h"
 #include "jsdrv_prv/list.h"
+#include "jsdrv_prv/file_map.h"
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/statistics.h"
 #include <stdint.h>
 
 
 #define JSDRV_BUFSIG_LEVELS_MAX 32
+#define JSDRV_BUFSIG_PATH_LENGTH_MAX 256
+#define JSDRV_BUFSIG_PACK_R0_MAX 1024     // the maximum r0 for packed level 0
+#define JSDRV_BUFSIG_PACK_RATIO_MAX 8
+#define JSDRV_BUFSIG_TILE_NEIGHBORS 4    // see jsdrv_bufsig_tile_neighbor()
+#define JSDRV_BUFSIG_BULK_THREADS_MAX 16 // see jsdrv_bufsig_recv_bulk()
 
 
 struct buffer_s;
+struct bufsig_file_header_s;
+struct bufsig_pack_s;
+struct bufsig_summary_cache_s;
 
 struct bufsig_stream_header_s {
     uint64_t sample_id;                     ///< the starting sample id, which increments by decimate_factor.
@@ -51,6 +61,18 @@ struct bufsig_level_s {
     uint64_t r;                             ///< reduction from previous layer (0=r0, rN otherwise)
     uint64_t samples_per_entry;
     struct jsdrv_summary_entry_s * data;
+    struct jsdrv_statistics_accum_s accum;  ///< The partial entry from the lower level.
+    uint64_t accum_count;                   ///< The lower level entries in accum.
+    uint64_t accum_next;                    ///< The next expected lower level index, UINT64_MAX to resync.
+};
+
+/// The level 0 state published by the ingest thread for concurrent readers.
+struct bufsig_snapshot_s {
+    uint64_t level0_head;
+    uint64_t level0_size;
+    uint64_t sample_id_head;
+    struct jsdrv_time_map_s time_map;
+    uint64_t epoch;                         ///< Increments each time level 0 restarts.
 };
 
 struct bufsig_s {
@@ -65,6 +87,8 @@ struct bufsig_s {
     int64_t size_in_utc;    // size in UTC time
     uint64_t r0;
     uint64_t rN;
+    uint32_t r0_cfg;        // requested r0, 0 for automatic
+    uint32_t rN_cfg;        // requested rN, 0 for automatic
     uint64_t k;
     uint8_t level_count;
 
@@ -75,7 +99,31 @@ struct bufsig_s {
     uint64_t level0_head;     // next insert point (also tail when full)
     uint64_t level0_size;     // the number of valid entries
     uint64_t sample_id_head;  // the next expected sample id (last valid + 1)
-    void * level0_data;       // the data
+    void * level0_data;       // the data, or the newest raw blocks when packed
+    uint64_t level0_horizon;  // set before jsdrv_bufsig_alloc: samples to store, 0 for N
+    uint64_t level0_N;        // samples stored in level0_data, which divides N
+
+    // optional file-backed level 0
+    char level0_path[JSDRV_BUFSIG_PATH_LENGTH_MAX];  // set before jsdrv_bufsig_alloc, "" for RAM
+    struct jsdrv_file_map_s * level0_map;            // NULL for RAM
+    struct bufsig_file_header_s * level0_file_hdr;   // the persisted level 0 state
+    bool level0_restored;     // restored from the file and no data received yet
+    bool level0_loaded;       // level 0 and the levels map a jsdrv_bufsig_load() file, read only
+
+    // optional packed float32 level 0
+    uint8_t level0_ratio;               // set before jsdrv_bufsig_alloc: expected compression, 0 or 1 for raw
+    struct bufsig_pack_s * level0_pack; // NULL for raw
+
+    // RAM allocation options, set before jsdrv_bufsig_alloc
+    uint8_t page_mode;      // jsdrv_page_mode_e
+    uint32_t numa_node;     // the NUMA node + 1, 0 for any
+
+    struct bufsig_summary_cache_s * summary_cache;  // recent summary responses
+
+    // reader snapshot, seqlock
+    volatile uint32_t snapshot_seq;    // odd while the ingest thread updates snapshot
+    struct bufsig_snapshot_s snapshot;
+    uint64_t epoch;
 };
 
 /**
@@ -85,22 +133,155 @@ struct bufsig_s {
  * @param N The total number of samples to store.
  * @param r0 The number of samples in the first reduction.
  * @param rN The number of samples in subsequent reductions.
+ *
+ * When self->level0_path is not empty, level 0 lives in a memory-mapped
+ * ring file at that path while the reductions stay in RAM.  When the
+ * file already holds samples for the same N and stream format, this
+ * function restores them and rebuilds the reductions.  If the file
+ * cannot be mapped, level 0 falls back to RAM.
+ *
+ * When self->level0_ratio is greater than 1 for a float32 signal in RAM
+ * with r0 <= JSDRV_BUFSIG_PACK_R0_MAX, level 0 stores each block of r0
+ * samples losslessly compressed with jsdrv_f32_codec_encode() in
+ * N * 4 / level0_ratio bytes.  When the blocks compress less than
+ * level0_ratio, ingestion drops the oldest blocks, so the buffer holds
+ * fewer than N samples.  Requests only decode the blocks they read.
+ *
+ * When self->level0_horizon is less than N for a raw signal in RAM,
+ * level 0 only stores the newest samples, at least level0_horizon,
+ * while the reductions still cover N samples.  Sample requests return
+ * the stored samples.  Summary requests estimate older partial
+ * reduction entries from the level 1 entries.
+ *
+ * The RAM for level 0 and the reductions comes from jsdrv_page_alloc()
+ * with self->page_mode and self->numa_node.
  */
 void jsdrv_bufsig_alloc(struct bufsig_s * self, uint64_t N, uint64_t r0, uint64_t rN);
 
 void jsdrv_bufsig_free(struct bufsig_s * self);
 
+/**
+ * @brief Save the samples and reductions to a file.
+ *
+ * @param self The allocated signal instance.
+ * @param path The file path, which is replaced.
+ * @return 0 or error code.
+ *
+ * The file holds the stream header, time map, and level state followed by
+ * level 0 and each reduction level in one sequential write, in the
+ * native format of this build.  Packed level 0 is not supported.
+ */
+int32_t jsdrv_bufsig_save(struct bufsig_s * self, const char * path);
+
+/**
+ * @brief Load a file from jsdrv_bufsig_save().
+ *
+ * @param self The unallocated signal instance.
+ * @param path The file path.
+ * @return 0 or error code.
+ *
+ * Level 0 and the reductions map the file copy-on-write rather than
+ * reading it, so requests start immediately and the operating system
+ * pages in only what they read.  The signal ignores received data
+ * until jsdrv_bufsig_free(), and the file never changes.
+ */
+int32_t jsdrv_bufsig_load(struct bufsig_s * self, const char * path);
+
+/**
+ * @brief Move the allocation and samples to another signal.
+ *
+ * @param dst The unallocated destination signal, which keeps its idx,
+ *      parent, active, topic, and configuration.
+ * @param src The source signal, which becomes unallocated as if by
+ *      jsdrv_bufsig_free() without copying or freeing any memory.
+ *
+ * The caller must prevent concurrent readers of both signals.
+ */
+void jsdrv_bufsig_move(struct bufsig_s * dst, struct bufsig_s * src);
+
+/**
+ * @brief Get the level 0 memory.
+ *
+ * @param self The buffer instance.
+ * @return The level 0 size in bytes, including the packed block index.
+ */
+uint64_t jsdrv_bufsig_level0_bytes(struct bufsig_s * self);
+
 void jsdrv_bufsig_clear(struct bufsig_s * self);
 
 void jsdrv_bufsig_recv_data(struct bufsig_s * self, struct jsdrv_stream_signal_s * s);
 
+/**
+ * @brief Ingest many contiguous samples, such as from a file or a replayed capture.
+ *
+ * @param self The signal instance.
+ * @param s The stream header for the first sample.  Its data and
+ *      element_count are ignored.
+ * @param data The samples in the s element format.
+ * @param length The number of samples in data, which may exceed the
+ *      stream message size.  Only the newest samples are kept when
+ *      length exceeds the signal size.
+ * @param threads The threads for the summary levels, up to
+ *      JSDRV_BUFSIG_BULK_THREADS_MAX.  0 or 1 uses only the caller.
+ *
+ * This function copies level 0 once, then computes each summary level
+ * with its entries split across threads, rather than summarizing each
+ * message as jsdrv_bufsig_recv_data() does.  The result matches
+ * jsdrv_bufsig_recv_data() with the same samples.  When s does not
+ * continue the existing samples, the signal starts over.  Packed
+ * level 0 and level 0 horizons summarize on the calling thread.
+ */
+void jsdrv_bufsig_recv_bulk(struct bufsig_s * self, const struct jsdrv_stream_signal_s * s,
+                            const uint8_t * data, uint64_t length, uint32_t threads);
+
 bool jsdrv_bufsig_info(struct bufsig_s * self, struct jsdrv_buffer_info_s * info);
 
+/**
+ * @brief Copy a signal for a concurrent reader.
+ *
+ * @param self The signal instance, which the ingest thread may update
+ *      with jsdrv_bufsig_recv_data() during this call.
+ * @param[out] copy The copy with a consistent level 0 state, which
+ *      jsdrv_bufsig_process_request() can use without blocking ingestion.
+ *
+ * The caller must prevent jsdrv_bufsig_alloc(), jsdrv_bufsig_free(),
+ * and jsdrv_bufsig_clear() until it is done with copy.
+ */
+void jsdrv_bufsig_snapshot(struct bufsig_s * self, struct bufsig_s * copy);
+
+/**
+ * @brief Limit a copy to the newest samples.
+ *
+ * @param copy The copy from jsdrv_bufsig_snapshot().
+ * @param length The number of newest samples to keep, 0 for all.
+ *
+ * Requests on the copy treat older samples as not present, which gives
+ * a shorter view over the same level 0 and reductions.
+ */
+void jsdrv_bufsig_view(struct bufsig_s * copy, uint64_t length);
+
+/**
+ * @brief Check that ingestion did not overwrite a response.
+ *
+ * @param self The signal instance.
+ * @param copy The copy from jsdrv_bufsig_snapshot() used for the request.
+ * @param rsp The response from jsdrv_bufsig_process_request() on copy.
+ * @return True when the response is valid.  False when ingestion
+ *      restarted level 0 or overwrote samples near the start of the
+ *      response, so the caller should retry with a new copy.
+ */
+bool jsdrv_bufsig_snapshot_valid(struct bufsig_s * self, const struct bufsig_s * copy,
+                                 const struct jsdrv_buffer_response_s * rsp);
+
 /**
  * @brief Process a request.
  *
  * @param self The buffer instance.
- * @param req The request to process.
+ * @param req The request to process, which this function converts to
+ *      JSDRV_TIME_SAMPLES.  For JSDRV_BUFFER_REQUEST_FLAG_CHUNKED
+ *      requests, when rsp does not have JSDRV_BUFFER_RESPONSE_FLAG_END,
+ *      this function updates req to the remainder.  Call again with
+ *      req for the next response.
  * @param rsp The response to populate which is mostly populated by the caller.
  *      This function simply needs to add the data and update
  *      rsp->info fields size_in_utc, time_range_utc,
@@ -112,6 +293,81 @@ int32_t jsdrv_bufsig_process_request(
         struct jsdrv_buffer_request_s * req,
         struct jsdrv_buffer_response_s * rsp);
 
+/**
+ * @brief Get a tile adjacent to a summary response.
+ *
+ * @param r The summary response range.
+ * @param idx The neighbor index: 0 for the next tile, 1 for the
+ *      previous tile, 2 for the parent tile with twice the increment
+ *      and 3 for the child tile with half the increment, both centered
+ *      on r.
+ * @param neighbor The neighbor range, with the same length as r and a
+ *      start aligned to its increment.
+ * @return True when neighbor is valid, false when idx does not exist.
+ */
+bool jsdrv_bufsig_tile_neighbor(const struct jsdrv_time_range_samples_s * r, uint32_t idx,
+                                struct jsdrv_time_range_samples_s * neighbor);
+
+/**
+ * @brief Compute a summary tile into the summary cache.
+ *
+ * @param self The buffer instance that continues to ingest.
+ * @param copy The storage for the snapshot of self.
+ * @param r The tile range, normally from jsdrv_bufsig_tile_neighbor().
+ *
+ * A later summary request that overlaps the tile with the same
+ * increment copies its complete entries.  This function does nothing
+ * when the cache already holds the tile or when the tile has no
+ * entries that the cache could reuse.
+ */
+void jsdrv_bufsig_summary_prefetch(struct bufsig_s * self, struct bufsig_s * copy,
+                                   const struct jsdrv_time_range_samples_s * r);
+
+/**
+ * @brief Search a float32 signal.
+ *
+ * @param self The buffer instance.
+ * @param search The search.
+ * @param rsp The JSDRV_BUFFER_RESPONSE_SEARCH response to populate.
+ * @return 0 or error code.
+ */
+int32_t jsdrv_bufsig_search(
+        struct bufsig_s * self,
+        const struct jsdrv_buffer_search_s * search,
+        struct jsdrv_buffer_response_s * rsp);
+
+/**
+ * @brief Compute the statistics over a sample range.
+ *
+ * @param signals The current, voltage, and/or power signal copies from
+ *      jsdrv_bufsig_snapshot(), at most one for each field.
+ * @param count The number of signals.
+ * @param req The request, which uses the time map of signals[0].
+ * @param rsp The JSDRV_BUFFER_RESPONSE_STATISTICS response to populate.
+ * @return 0 or error code.
+ */
+int32_t jsdrv_bufsig_statistics(struct bufsig_s * const * signals, uint32_t count,
+                                const struct jsdrv_buffer_request_s * req,
+                                struct jsdrv_buffer_response_s * rsp);
+
+/**
+ * @brief Align a request for multiple signals to one sample_id grid.
+ *
+ * @param signals The signal copies from jsdrv_bufsig_snapshot().
+ * @param count The number of signals.
+ * @param req The request, which this function converts to
+ *      JSDRV_TIME_SAMPLES with the time map of signals[0].  For sample
+ *      requests, this function clips the range to the samples that all
+ *      signals hold, and truncates it so that the sample data for all
+ *      signals fits size_max.  Call jsdrv_bufsig_process_request() with
+ *      a copy of req for each signal.
+ * @param size_max The maximum total response data in bytes.
+ * @return 0 or error code.  JSDRV_ERROR_TOO_BIG when the summary data
+ *      for all signals exceeds size_max.
+ */
+int32_t jsdrv_bufsig_request_align(struct bufsig_s * const * signals, uint32_t count,
+                                   struct jsdrv_buffer_request_s * req, uint64_t size_max);
+
 JSDRV_CPP_GUARD_END
 
 #endif  /* JSDRV_PRV_BUFFER_SIGNAL_H_ */
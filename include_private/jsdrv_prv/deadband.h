@@ -0,0 +1,162 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Constant-signal suppression for float32 streams.
+ */
+
+#ifndef JSDRV_PRV_DEADBAND_H_
+#define JSDRV_PRV_DEADBAND_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_deadband Deadband suppression
+ *
+ * @brief Replace constant runs of samples with jsdrv_stream_hold_s records.
+ *
+ * Long captures often spend most of their time with an essentially
+ * constant signal, such as a device in deep sleep.  The deadband
+ * combines consecutive stream messages whose samples all stay within
+ * a band of width tolerance into a single hold record with the sample
+ * count, min, max and mean.  Decisions are per message, so the hold
+ * always covers whole messages and sample_id accounting stays exact:
+ * the message that leaves the band starts exactly where the hold ends.
+ *
+ * Each hold covers at most JSDRV_DEADBAND_DURATION_MAX seconds so that
+ * subscribers see regular progress during long constant runs.
+ *
+ * The device drivers call jsdrv_deadband_process() for each outgoing
+ * message.  When it returns #JSDRV_DEADBAND_EMIT, they send the
+ * completed hold from jsdrv_deadband_emit() before the message.
+ * When it returns #JSDRV_DEADBAND_ABSORB, they drop the message.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The maximum hold duration in seconds of sample_id.
+#define JSDRV_DEADBAND_DURATION_MAX     (1U)
+
+/// jsdrv_deadband_process() flag: send jsdrv_deadband_emit() before this message.
+#define JSDRV_DEADBAND_EMIT             (0x01U)
+/// jsdrv_deadband_process() flag: the hold absorbed this message, so drop it.
+#define JSDRV_DEADBAND_ABSORB           (0x02U)
+
+/// A run of samples within the band.
+struct jsdrv_deadband_run_s {
+    uint64_t sample_id;             ///< The first sample_id.
+    uint64_t count;                 ///< The number of samples, 0 when empty.
+    float min;                      ///< The minimum sample.
+    float max;                      ///< The maximum sample.
+    double sum;                     ///< The sum of all samples.
+    uint8_t field_id;               ///< The source jsdrv_field_e.
+    uint8_t index;                  ///< The source channel index.
+    uint32_t sample_rate;           ///< The source sample rate.
+    uint32_t decimate_factor;       ///< The source decimate factor.
+    struct jsdrv_time_map_s time_map;  ///< The source time map for the first message.
+};
+
+/// The deadband state for one stream.
+struct jsdrv_deadband_s {
+    float tolerance;                ///< The band width max - min, 0 to disable.
+    struct jsdrv_deadband_run_s run;    ///< The run in progress.
+    struct jsdrv_deadband_run_s done;   ///< The completed run awaiting jsdrv_deadband_emit().
+};
+
+/**
+ * @brief Initialize the deadband.
+ *
+ * @param self The deadband instance.
+ * @param tolerance The band width, 0 to pass all messages.
+ */
+void jsdrv_deadband_initialize(struct jsdrv_deadband_s * self, float tolerance);
+
+/**
+ * @brief Process an outgoing stream message.
+ *
+ * @param self The deadband instance.
+ * @param s The stream message, which is not modified.
+ * @return The #JSDRV_DEADBAND_EMIT and #JSDRV_DEADBAND_ABSORB flags.
+ *
+ * Messages that are not float32, contain NaN, or arrive while disabled
+ * end the run in progress and pass unchanged.
+ */
+uint32_t jsdrv_deadband_process(struct jsdrv_deadband_s * self, const struct jsdrv_stream_signal_s * s);
+
+/**
+ * @brief End the run in progress, such as when the stream stops.
+ *
+ * @param self The deadband instance.
+ * @return True when a hold awaits jsdrv_deadband_emit().
+ */
+bool jsdrv_deadband_flush(struct jsdrv_deadband_s * self);
+
+/**
+ * @brief Write the completed hold record.
+ *
+ * @param self The deadband instance.
+ * @param[out] s The stream message to populate.
+ * @return The message size in bytes, including the header.
+ */
+uint32_t jsdrv_deadband_emit(struct jsdrv_deadband_s * self, struct jsdrv_stream_signal_s * s);
+
+/**
+ * @brief Get the hold record from a stream message.
+ *
+ * @param s The stream message.
+ * @return The hold, or NULL when s contains samples.
+ */
+const struct jsdrv_stream_hold_s * jsdrv_deadband_hold(const struct jsdrv_stream_signal_s * s);
+
+/**
+ * @brief Get the number of samples that a stream message covers.
+ *
+ * @param s The stream message.
+ * @return The hold sample_count for hold records, otherwise element_count.
+ */
+uint64_t jsdrv_deadband_sample_count(const struct jsdrv_stream_signal_s * s);
+
+/**
+ * @brief Expand part of a hold record into float32 samples.
+ *
+ * @param s The hold record.
+ * @param offset The first hold sample to expand.
+ * @param[out] dst The float32 stream message, distinct from s, to
+ *      populate with copies of the hold mean, up to the
+ *      JSDRV_STREAM_DATA_SIZE capacity.
+ * @return The number of samples in dst, 0 when s is not a hold or
+ *      offset reaches the hold sample_count.
+ *
+ * Consumers that need sample arrays call this function repeatedly,
+ * advancing offset by the return value each time.
+ */
+uint32_t jsdrv_deadband_expand(const struct jsdrv_stream_signal_s * s, uint64_t offset,
+                               struct jsdrv_stream_signal_s * dst);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_DEADBAND_H_ */
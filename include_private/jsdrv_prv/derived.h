@@ -0,0 +1,216 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Host-side derived signals: charge, energy, RMS current, and summaries.
+ */
+
+#ifndef JSDRV_PRV_DERIVED_H_
+#define JSDRV_PRV_DERIVED_H_
+
+#include "jsdrv.h"
+#include "jsdrv_prv/statistics.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_derived Derived signals
+ *
+ * @brief Compute derived stream blocks from float32 stream blocks.
+ *
+ * The device drivers compute derived signals from each outgoing
+ * current or power stream block, so the derived blocks use the same
+ * sample_id, sample_rate, and time_map as their source:
+ * - The integral produces one cumulative float64 sample for each
+ *   source sample, such as charge from current and energy from power.
+ *   NaN source samples do not contribute.
+ * - The RMS produces one float32 sample for each window of source
+ *   samples with decimate_factor multiplied by the window.  A gap in
+ *   the source sample_id restarts the window.
+ * - The summary produces one jsdrv_summary_entry_s for each window of
+ *   source samples, sized for a requested output rate, so a slow
+ *   consumer still sees the min and max of every transient.  NaN
+ *   source samples do not contribute, and a window with only NaN
+ *   samples produces NaN.  Gaps restart the window like the RMS.
+ * - The edge produces one jsdrv_edge_s for each level change of a
+ *   1-bit general-purpose input or a 4-bit current range, so slowly
+ *   changing inputs need only a few bytes per second.  The first event after a clear or a gap in
+ *   the source sample_id reports the starting level.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The maximum jsdrv_derived_integral() samples for each output block.
+#define JSDRV_DERIVED_INTEGRAL_LENGTH_MAX (JSDRV_STREAM_DATA_SIZE / sizeof(double))
+
+/// The default RMS window in samples.
+#define JSDRV_DERIVED_RMS_WINDOW_DEFAULT (1000U)
+
+/// The maximum RMS window in samples.
+#define JSDRV_DERIVED_RMS_WINDOW_MAX (1000000U)
+
+/// The default summary output sample rate in Hz.
+#define JSDRV_DERIVED_SUMMARY_FS_DEFAULT (100U)
+
+/// The minimum summary window in source samples.
+#define JSDRV_DERIVED_SUMMARY_WINDOW_MIN (8U)
+
+/// The maximum jsdrv_derived_edge() events for each output block.
+#define JSDRV_DERIVED_EDGE_LENGTH_MAX (256U)
+
+/// The integral state.
+struct jsdrv_derived_integral_s {
+    double value;                   ///< The accumulated integral in units * seconds.
+};
+
+/// The RMS state.
+struct jsdrv_derived_rms_s {
+    uint32_t window;                ///< The window length in source samples.
+    uint32_t count;                 ///< The source samples in the current window.
+    uint32_t valid;                 ///< The source samples in the current window that are not NaN.
+    double sum_sq;                  ///< The sum of squares for the current window.
+    uint64_t sample_id;             ///< The sample_id for the current window start.
+    uint64_t sample_id_next;        ///< The expected next source sample_id, 0 for none.
+    uint32_t decimate_factor;       ///< The source decimate factor.
+};
+
+/// The summary state.
+struct jsdrv_derived_summary_s {
+    uint32_t fs;                    ///< The requested output sample rate in Hz.
+    uint32_t count;                 ///< The source samples in the current window.
+    struct jsdrv_statistics_accum_s accum;  ///< The current window statistics.
+    uint64_t sample_id;             ///< The sample_id for the current window start.
+    uint64_t sample_id_next;        ///< The expected next source sample_id, 0 for none.
+    uint32_t decimate_factor;       ///< The source decimate factor.
+};
+
+/// The edge state.
+struct jsdrv_derived_edge_s {
+    int8_t level;                   ///< The current level, -1 for unknown.
+    uint64_t sample_id_next;        ///< The expected next source sample_id, 0 for none.
+};
+
+/**
+ * @brief Reset the integral to zero.
+ *
+ * @param self The integral instance.
+ */
+void jsdrv_derived_integral_clear(struct jsdrv_derived_integral_s * self);
+
+/**
+ * @brief Integrate a float32 source block.
+ *
+ * @param self The integral instance.
+ * @param src The float32 source block.
+ * @param offset The index of the first src sample to process.
+ * @param[out] dst The float64 output block.  This function sets all header
+ *      fields except field_id and index.
+ * @return The number of samples processed and written to dst, up to
+ *      JSDRV_DERIVED_INTEGRAL_LENGTH_MAX.  Call again with offset
+ *      increased by the return value until all src samples are processed.
+ */
+uint32_t jsdrv_derived_integral(struct jsdrv_derived_integral_s * self, const struct jsdrv_stream_signal_s * src,
+                                uint32_t offset, struct jsdrv_stream_signal_s * dst);
+
+/**
+ * @brief Reset the RMS state.
+ *
+ * @param self The RMS instance.
+ * @param window The window length in source samples, which is clamped to
+ *      1 through JSDRV_DERIVED_RMS_WINDOW_MAX.
+ */
+void jsdrv_derived_rms_clear(struct jsdrv_derived_rms_s * self, uint32_t window);
+
+/**
+ * @brief Compute the windowed RMS for a float32 source block.
+ *
+ * @param self The RMS instance.
+ * @param src The float32 source block.
+ * @param[out] dst The float32 output block for the windows that complete
+ *      in src.  This function sets all header fields except field_id and index.
+ * @return The number of samples written to dst.
+ */
+uint32_t jsdrv_derived_rms(struct jsdrv_derived_rms_s * self, const struct jsdrv_stream_signal_s * src,
+                           struct jsdrv_stream_signal_s * dst);
+
+/**
+ * @brief Reset the summary state.
+ *
+ * @param self The summary instance.
+ * @param fs The output sample rate in Hz, at least 1.
+ */
+void jsdrv_derived_summary_clear(struct jsdrv_derived_summary_s * self, uint32_t fs);
+
+/**
+ * @brief Get the summary window for a source block.
+ *
+ * @param self The summary instance.
+ * @param src The float32 source block.
+ * @return The window in source samples, which is the source rate
+ *      divided by the output rate, and at least JSDRV_DERIVED_SUMMARY_WINDOW_MIN.
+ */
+uint32_t jsdrv_derived_summary_window(const struct jsdrv_derived_summary_s * self,
+                                      const struct jsdrv_stream_signal_s * src);
+
+/**
+ * @brief Compute the windowed summary for a float32 source block.
+ *
+ * @param self The summary instance.
+ * @param src The float32 source block.
+ * @param[out] dst The jsdrv_summary_entry_s output block for the windows
+ *      that complete in src, which must hold at least
+ *      src->element_count / JSDRV_DERIVED_SUMMARY_WINDOW_MIN + 1 entries.
+ *      The element_type is JSDRV_DATA_TYPE_UNDEFINED with
+ *      element_size_bits of sizeof(struct jsdrv_summary_entry_s) * 8.
+ *      This function sets all header fields except field_id and index.
+ * @return The number of entries written to dst.
+ */
+uint32_t jsdrv_derived_summary(struct jsdrv_derived_summary_s * self, const struct jsdrv_stream_signal_s * src,
+                               struct jsdrv_stream_signal_s * dst);
+
+/**
+ * @brief Reset the edge state.
+ *
+ * @param self The edge instance.
+ */
+void jsdrv_derived_edge_clear(struct jsdrv_derived_edge_s * self);
+
+/**
+ * @brief Find the level changes in a 1-bit or 4-bit source block.
+ *
+ * @param self The edge instance.
+ * @param src The 1-bit or 4-bit unsigned source block.
+ * @param offset The index of the first src sample to process.
+ * @param[out] dst The jsdrv_edge_s output block, which must hold
+ *      JSDRV_DERIVED_EDGE_LENGTH_MAX events.  The element_type is
+ *      JSDRV_DATA_TYPE_UNDEFINED with element_size_bits of
+ *      sizeof(struct jsdrv_edge_s) * 8.  This function sets all header
+ *      fields except field_id and index.
+ * @return The number of src samples processed.  Call again with offset
+ *      increased by the return value until all src samples are processed.
+ */
+uint32_t jsdrv_derived_edge(struct jsdrv_derived_edge_s * self, const struct jsdrv_stream_signal_s * src,
+                            uint32_t offset, struct jsdrv_stream_signal_s * dst);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_DERIVED_H_ */
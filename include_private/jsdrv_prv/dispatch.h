@@ -0,0 +1,136 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Data message dispatch worker threads.
+ */
+
+#ifndef JSDRV_PRV_DISPATCH_H_
+#define JSDRV_PRV_DISPATCH_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_dispatch Data dispatch
+ *
+ * @brief Invoke external data subscribers from worker threads.
+ *
+ * By default, the frontend thread invokes all subscriber callbacks,
+ * so one slow data callback delays every device.  When enabled, the
+ * frontend still performs the pubsub topic lookup, but it submits each
+ * data message for external subscribers to a worker thread.  Each device
+ * prefix maps to a single worker, so each device's data remains in order.
+ * Control, metadata, and return code messages remain on the frontend thread.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+// Forward declarations
+struct jsdrvp_msg_s;
+struct jsdrv_context_s;
+
+/// The opaque instance.
+struct jsdrv_dispatch_s;
+
+/**
+ * @brief Start the dispatch worker threads.
+ *
+ * @param context The driver context.
+ * @param thread_count The number of worker threads.
+ * @return The new instance, or NULL if thread_count is 0 or on error.
+ */
+struct jsdrv_dispatch_s * jsdrv_dispatch_initialize(struct jsdrv_context_s * context, uint32_t thread_count);
+
+/**
+ * @brief Stop the worker threads and free the instance.
+ *
+ * @param self The instance, which may be NULL.
+ *
+ * The worker threads complete all submitted callbacks before exiting.
+ */
+void jsdrv_dispatch_finalize(struct jsdrv_dispatch_s * self);
+
+/**
+ * @brief Invoke a subscriber callback from the worker thread for this topic.
+ *
+ * @param self The instance.
+ * @param fn The external subscriber callback.
+ * @param user_data The arbitrary data for fn.
+ * @param msg The data message.  The caller retains ownership.  This
+ *      function adds a reference that the worker releases after fn returns.
+ */
+void jsdrv_dispatch_submit(struct jsdrv_dispatch_s * self, jsdrv_subscribe_fn fn, void * user_data,
+                           struct jsdrvp_msg_s * msg);
+
+/// The opaque bounded subscriber queue.
+struct jsdrv_dispatch_queue_s;
+
+/**
+ * @brief Allocate a bounded queue for one external subscriber.
+ *
+ * @param self The instance.
+ * @param topic The subscription topic, which selects the worker thread
+ *      and identifies the queue in jsdrv_dispatch_queue_stats().
+ * @param fn The external subscriber callback.
+ * @param user_data The arbitrary data for fn.
+ * @param depth The maximum number of pending messages.
+ * @param policy The jsdrv_queue_policy_e when full.
+ * @return The new queue or NULL on error.
+ */
+struct jsdrv_dispatch_queue_s * jsdrv_dispatch_queue_alloc(struct jsdrv_dispatch_s * self, const char * topic,
+        jsdrv_subscribe_fn fn, void * user_data, uint32_t depth, uint8_t policy);
+
+/**
+ * @brief Close a queue and discard any pending messages.
+ *
+ * @param queue The queue from jsdrv_dispatch_queue_alloc(), which the
+ *      caller must not use again.  The worker may still be running fn,
+ *      and frees the queue when done.
+ */
+void jsdrv_dispatch_queue_close(struct jsdrv_dispatch_queue_s * queue);
+
+/**
+ * @brief Add a message to a queue, applying its policy when full.
+ *
+ * @param queue The queue.
+ * @param msg The message.  The caller retains ownership.  This
+ *      function adds a reference that the worker releases after fn returns.
+ */
+void jsdrv_dispatch_queue_submit(struct jsdrv_dispatch_queue_s * queue, struct jsdrvp_msg_s * msg);
+
+/**
+ * @brief Format the queue statistics.
+ *
+ * @param self The instance, which may be NULL.
+ * @param buf The output buffer for a JSON list of objects with
+ *      "topic", "depth", "pending", "peak", and "drops".
+ * @param size The size of buf in bytes.
+ * @return The number of queues.
+ */
+uint32_t jsdrv_dispatch_queue_stats(struct jsdrv_dispatch_s * self, char * buf, uint32_t size);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_DISPATCH_H_ */
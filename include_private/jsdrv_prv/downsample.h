@@ -42,18 +42,109 @@ JSDRV_CPP_GUARD_START
 enum jsdrv_downsample_mode_e {
     JSDRV_DOWNSAMPLE_MODE_AVERAGE = 0,
     JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND = 1,
+    /// The FLAT_PASSBAND response filtered in float32 with SIMD kernels.
+    JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32 = 2,
+    /// The FLAT_PASSBAND response filtered in float64.
+    JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64 = 3,
 };
 
 /// Opaque object
 struct jsdrv_downsample_s;
 
+/**
+ * @brief Allocate a downsampler.
+ *
+ * @param sample_rate_in The input sample rate.
+ * @param sample_rate_out The output sample rate, at most sample_rate_in.
+ * @param mode The jsdrv_downsample_mode_e.
+ * @return The instance or NULL.
+ *
+ * The FLAT_PASSBAND modes decimate with a cascade of 2x and 5x stages.
+ * When sample_rate_in / sample_rate_out is not a product of these stages,
+ * the cascade decimates as far as it can while staying at or above
+ * sample_rate_out, and a polyphase L / M rational resampler stage
+ * produces the exact output rate, such as 48 kHz or 44.1 kHz from 2 MHz.
+ * The rational stage supports L up to 1024 and M / L up to 8.
+ * JSDRV_DOWNSAMPLE_MODE_AVERAGE requires an integer ratio.
+ */
 struct jsdrv_downsample_s * jsdrv_downsample_alloc(uint32_t sample_rate_in, uint32_t sample_rate_out, int mode);
 void jsdrv_downsample_free(struct jsdrv_downsample_s * self);
 void jsdrv_downsample_clear(struct jsdrv_downsample_s * self);
+
+/**
+ * @brief Get the decimate factor.
+ *
+ * @param self The downsample instance.  NULL returns 1.
+ * @return The integer ratio sample_rate_in / sample_rate_out.  With the
+ *      rational stage, the 2x and 5x cascade factor, which still sizes
+ *      the output buffers for jsdrv_downsample_add_f32_block().
+ */
 uint32_t jsdrv_downsample_decimate_factor(struct jsdrv_downsample_s * self);
 bool jsdrv_downsample_add_f32(struct jsdrv_downsample_s * self, uint64_t sample_id, float x_in, float * x_out);
+
+/**
+ * @brief Downsample a block of samples.
+ *
+ * @param self The downsample instance.  NULL copies x to y.
+ * @param sample_id The sample id for x[0].
+ * @param x The input samples.
+ * @param n The number of input samples.
+ * @param y The output samples, which must hold at least
+ *      n / jsdrv_downsample_decimate_factor() + 1 samples.
+ * @param[out] n_out The number of output samples.
+ * @return The index into x of the input sample that produced y[0],
+ *      or n when n_out is 0.
+ *
+ * Equivalent to calling jsdrv_downsample_add_f32() for each sample,
+ * but runs each filter stage over the block.
+ */
+uint32_t jsdrv_downsample_add_f32_block(struct jsdrv_downsample_s * self, uint64_t sample_id,
+                                        const float * x, uint32_t n, float * y, uint32_t * n_out);
+
 bool jsdrv_downsample_add_u8(struct jsdrv_downsample_s * self, uint64_t sample_id, uint8_t x_in, uint8_t * x_out);
 
+/// The maximum number of channels for a multi-channel downsampler.
+#define JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX (4U)
+
+/// Opaque multi-channel downsampler.
+struct jsdrv_downsample_mc_s;
+
+/**
+ * @brief Allocate a downsampler for channels that share a sample_id sequence.
+ *
+ * @param sample_rate_in The input sample rate.
+ * @param sample_rate_out The output sample rate.
+ * @param mode The jsdrv_downsample_mode_e.
+ * @param channels The number of channels, up to #JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX.
+ * @return The instance or NULL.
+ *
+ * #JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32 filters all channels in lockstep
+ * with one state machine and channel-interleaved buffers.  The other
+ * modes filter each channel independently.
+ */
+struct jsdrv_downsample_mc_s * jsdrv_downsample_mc_alloc(uint32_t sample_rate_in, uint32_t sample_rate_out,
+                                                         int mode, uint32_t channels);
+void jsdrv_downsample_mc_free(struct jsdrv_downsample_mc_s * self);
+void jsdrv_downsample_mc_clear(struct jsdrv_downsample_mc_s * self);
+uint32_t jsdrv_downsample_mc_decimate_factor(struct jsdrv_downsample_mc_s * self);
+
+/**
+ * @brief Downsample a block of samples for every channel.
+ *
+ * @param self The multi-channel downsample instance.
+ * @param sample_id The sample id for x[c][0].
+ * @param x The input samples for each channel.
+ * @param n The number of input samples per channel.
+ * @param y The output samples for each channel, sized as for
+ *      jsdrv_downsample_add_f32_block().
+ * @param[out] n_out The number of output samples per channel.
+ * @return The index into x[c] of the input sample that produced y[c][0],
+ *      or n when n_out is 0.
+ */
+uint32_t jsdrv_downsample_mc_add_f32_block(struct jsdrv_downsample_mc_s * self, uint64_t sample_id,
+                                           const float * const * x, uint32_t n,
+                                           float * const * y, uint32_t * n_out);
+
 JSDRV_CPP_GUARD_END
 
 #endif // JSDRV_DOWNSAMPLE_H__
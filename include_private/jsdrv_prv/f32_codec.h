@@ -0,0 +1,93 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Lossless float32 block compression.
+ */
+
+#ifndef JSDRV_PRV_F32_CODEC_H_
+#define JSDRV_PRV_F32_CODEC_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_f32_codec Float32 block codec
+ *
+ * @brief Losslessly compress blocks of float32 samples.
+ *
+ * The encoder stores the first sample, then takes the difference
+ * between the bit patterns of consecutive samples, zigzag encodes it,
+ * and bit-packs each group of JSDRV_F32_CODEC_GROUP differences with
+ * the width of the largest one.  Each group stores one width byte
+ * followed by the packed bits.  Slowly changing signals share their
+ * sign and exponent between samples, so their differences only need
+ * the noisy mantissa bits.  NaN and infinite samples round trip
+ * exactly.
+ *
+ * Each block decodes independently of the others.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The samples for each bit width.
+#define JSDRV_F32_CODEC_GROUP (32U)
+
+/// The maximum encoded bytes for n samples.
+#define JSDRV_F32_CODEC_SIZE_MAX(n) (4U + (((n) + JSDRV_F32_CODEC_GROUP - 1) / JSDRV_F32_CODEC_GROUP) + (n) * 4U)
+
+/**
+ * @brief Encode a block.
+ *
+ * @param dst The output, with at least JSDRV_F32_CODEC_SIZE_MAX(n) bytes.
+ * @param src The samples.
+ * @param n The number of samples.
+ * @return The number of bytes written to dst.
+ */
+uint32_t jsdrv_f32_codec_encode(uint8_t * dst, const float * src, uint32_t n);
+
+/**
+ * @brief Decode a block.
+ *
+ * @param dst The n output samples.
+ * @param src The block from jsdrv_f32_codec_encode().
+ * @param n The number of samples, which must match the encoded block.
+ * @return The number of bytes read from src.
+ */
+uint32_t jsdrv_f32_codec_decode(float * dst, const uint8_t * src, uint32_t n);
+
+/**
+ * @brief Check that an untrusted block is complete.
+ *
+ * @param src The block from jsdrv_f32_codec_encode().
+ * @param size The available src size in bytes.
+ * @param n The number of samples.
+ * @return True if jsdrv_f32_codec_decode() reads at most size bytes
+ *      and every group width is valid.
+ */
+bool jsdrv_f32_codec_check(const uint8_t * src, uint32_t size, uint32_t n);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_F32_CODEC_H_ */
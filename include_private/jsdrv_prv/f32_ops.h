@@ -0,0 +1,212 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Vectorized float32 sample kernels.
+ */
+
+#ifndef JSDRV_PRV_F32_OPS_H_
+#define JSDRV_PRV_F32_OPS_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_f32_ops Float32 kernels
+ *
+ * @brief Scale, multiply, and reduce float32 sample arrays.
+ *
+ * The stream path uses these kernels to scale current and voltage
+ * samples, to compute power, and to compute derived channels.
+ * The implementation selects the widest instruction set that the
+ * CPU supports on first use: AVX2 or SSE2 on x86 and NEON on ARM64,
+ * with a portable scalar fallback.  The arrays need not be aligned.
+ * The element-wise kernels match the scalar implementation exactly.
+ * The summation order of the reductions depends upon the
+ * instruction set, so their results may differ in the final bits.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The instruction set options.
+enum jsdrv_f32_ops_isa_e {
+    JSDRV_F32_OPS_ISA_SCALAR = 0,   ///< Portable C.
+    JSDRV_F32_OPS_ISA_SSE2 = 1,     ///< x86 SSE2, 4 floats.
+    JSDRV_F32_OPS_ISA_AVX2 = 2,     ///< x86 AVX2, 8 floats.
+    JSDRV_F32_OPS_ISA_NEON = 3,     ///< ARM64 NEON, 4 floats.
+};
+
+/**
+ * @brief Get the active instruction set.
+ *
+ * @return The jsdrv_f32_ops_isa_e.
+ */
+int32_t jsdrv_f32_ops_isa(void);
+
+/**
+ * @brief Select the instruction set.
+ *
+ * @param isa The requested jsdrv_f32_ops_isa_e, which is mostly
+ *      useful for testing the fallback implementations.
+ * @return 0 or JSDRV_ERROR_NOT_SUPPORTED when this CPU does not support isa.
+ */
+int32_t jsdrv_f32_ops_isa_set(int32_t isa);
+
+/**
+ * @brief Get the instruction set name.
+ *
+ * @param isa The jsdrv_f32_ops_isa_e.
+ * @return The name, such as "avx2", or NULL when unknown.
+ */
+const char * jsdrv_f32_ops_isa_to_str(int32_t isa);
+
+/**
+ * @brief Get the instruction set by name.
+ *
+ * @param name The case-insensitive name: "scalar", "sse2", "avx2", or "neon".
+ * @return The jsdrv_f32_ops_isa_e or -1 when unknown.
+ */
+int32_t jsdrv_f32_ops_isa_from_str(const char * name);
+
+/**
+ * @brief Scale an array in place.
+ *
+ * @param x The samples, which are modified as x[i] *= scale.
+ * @param scale The scale factor.
+ * @param length The number of samples in x.
+ */
+void jsdrv_f32_scale(float * x, float scale, uint32_t length);
+
+/**
+ * @brief Scale and copy an array.
+ *
+ * @param y The output samples, y[i] = x[i] * scale.
+ * @param x The input samples which must not overlap y.
+ * @param scale The scale factor.
+ * @param length The number of samples.
+ */
+void jsdrv_f32_scale_copy(float * y, const float * x, float scale, uint32_t length);
+
+/**
+ * @brief Scale an array into two outputs with a single read.
+ *
+ * @param y1 The first output samples, y1[i] = x[i] * scale.
+ *      y1 may equal x to scale in place.
+ * @param y2 The second output samples, y2[i] = x[i] * scale,
+ *      which must not overlap x or y1.
+ * @param x The input samples.
+ * @param scale The scale factor.
+ * @param length The number of samples.
+ */
+void jsdrv_f32_scale_copy2(float * y1, float * y2, const float * x, float scale, uint32_t length);
+
+/**
+ * @brief Multiply two arrays element by element.
+ *
+ * @param y The output samples, y[i] = a[i] * b[i].
+ * @param a The first input samples.
+ * @param b The second input samples.
+ * @param length The number of samples.
+ */
+void jsdrv_f32_mult(float * y, const float * a, const float * b, uint32_t length);
+
+/**
+ * @brief Convert signed 16-bit integers to float with offset and gain.
+ *
+ * @param y The output samples, y[i] = (x[i] + offset) * gain.
+ * @param x The input samples.
+ * @param offset The offset added to each sample before the gain.
+ * @param gain The gain.
+ * @param length The number of samples.
+ */
+void jsdrv_f32_from_i16(float * y, const int16_t * x, float offset, float gain, uint32_t length);
+
+/**
+ * @brief Convert to float64 and scale, replacing NaN with 0.
+ *
+ * @param y The output samples, y[i] = x[i] * scale, or 0 when x[i] is NaN.
+ * @param x The input samples.
+ * @param scale The scale factor.
+ * @param length The number of samples.
+ */
+void jsdrv_f32_scale_f64(double * y, const float * x, double scale, uint32_t length);
+
+/**
+ * @brief Compute the sum of squares, ignoring NaN.
+ *
+ * @param x The input samples.
+ * @param length The number of samples.
+ * @param[out] valid The number of samples in x that are not NaN.
+ * @return The sum of x[i] * x[i] in float64 over the samples that are not NaN.
+ */
+double jsdrv_f32_sum_sq(const float * x, uint32_t length, uint32_t * valid);
+
+/**
+ * @brief Compute the sum, minimum, and maximum, ignoring NaN.
+ *
+ * @param x The input samples.
+ * @param length The number of samples.
+ * @param[out] valid The number of samples in x that are not NaN.
+ * @param[inout] min The minimum, which the caller initializes,
+ *      usually to INFINITY, and this function reduces over x.
+ * @param[inout] max The maximum, which the caller initializes,
+ *      usually to -INFINITY, and this function increases over x.
+ * @return The sum of x[i] in float64 over the samples that are not NaN.
+ */
+double jsdrv_f32_sum_min_max(const float * x, uint32_t length, uint32_t * valid, float * min, float * max);
+
+/**
+ * @brief Compute the sum of squared deviations, ignoring NaN.
+ *
+ * @param x The input samples.
+ * @param length The number of samples.
+ * @param mean The mean to subtract from each sample.
+ * @return The sum of (x[i] - mean)^2 in float64 over the samples that are not NaN.
+ */
+double jsdrv_f32_sum_sq_dev(const float * x, uint32_t length, double mean);
+
+/**
+ * @brief Find the first sample above a threshold.
+ *
+ * @param x The input samples.
+ * @param length The number of samples.
+ * @param threshold The threshold.
+ * @return The index of the first x[i] > threshold or length if none.
+ *      NaN samples never match.
+ */
+uint32_t jsdrv_f32_find_gt(const float * x, uint32_t length, float threshold);
+
+/**
+ * @brief Find the first sample at or below a threshold.
+ *
+ * @param x The input samples.
+ * @param length The number of samples.
+ * @param threshold The threshold.
+ * @return The index of the first x[i] <= threshold or length if none.
+ *      NaN samples never match.
+ */
+uint32_t jsdrv_f32_find_le(const float * x, uint32_t length, float threshold);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_F32_OPS_H_ */
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Read-write memory-mapped files.
+ */
+
+#ifndef JSDRV_PRV_FILE_MAP_H_
+#define JSDRV_PRV_FILE_MAP_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_file_map Memory-mapped files
+ *
+ * @brief Map a fixed-size file into memory for reading and writing.
+ *
+ * The operating system pages the file contents in and out on demand,
+ * so the mapping can be much larger than the available RAM.  Writes
+ * persist in the file after jsdrv_file_map_close().
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The opaque memory-mapped file instance.
+struct jsdrv_file_map_s;
+
+/**
+ * @brief Open or create a memory-mapped file.
+ *
+ * @param path The file path.
+ * @param size The file size in bytes.  An existing file with a
+ *      different size is resized, which discards its contents.
+ * @param[out] map The memory-mapped file instance.
+ * @param[out] ptr The mapped memory of size bytes.
+ * @param[out] existed True when the file already existed with size bytes,
+ *      so ptr holds its previous contents.  False for a new or resized file.
+ * @return 0 or error code.
+ */
+int32_t jsdrv_file_map_open(const char * path, uint64_t size,
+                            struct jsdrv_file_map_s ** map, void ** ptr, bool * existed);
+
+/**
+ * @brief Map an existing file copy-on-write.
+ *
+ * @param path The file path.
+ * @param[out] map The memory-mapped file instance.
+ * @param[out] ptr The mapped memory of size bytes.  Writes to this memory
+ *      stay private to this process and never modify the file.
+ * @param[out] size The file size in bytes.
+ * @return 0 or error code.  JSDRV_ERROR_NOT_FOUND when the file does
+ *      not exist.
+ */
+int32_t jsdrv_file_map_open_existing(const char * path, struct jsdrv_file_map_s ** map,
+                                     void ** ptr, uint64_t * size);
+
+/**
+ * @brief Unmap and close a memory-mapped file.
+ *
+ * @param map The memory-mapped file instance, which may be NULL.
+ */
+void jsdrv_file_map_close(struct jsdrv_file_map_s * map);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_FILE_MAP_H_ */
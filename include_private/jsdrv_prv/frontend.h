@@ -15,6 +15,7 @@
 */
 
 #include "jsdrv.h"
+#include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/event.h"
 #include "jsdrv_prv/list.h"
 #include "jsdrv_prv/usb_spec.h"
@@ -35,6 +36,7 @@ enum jsdrvp_payload_type_e {     // for jsdrv_union_s.app
     JSDRV_PAYLOAD_TYPE_DEVICE,              // jsdrvp_device_s
     JSDRV_PAYLOAD_TYPE_USB_CTRL,
     JSDRV_PAYLOAD_TYPE_USB_BULK,
+    JSDRV_PAYLOAD_TYPE_WATCH,               // u32 subscriber count, see JSDRV_PUBSUB_WATCH
 };
 
 // enum jsdrvp_msg_type_e
@@ -60,26 +62,79 @@ struct jsdrvp_ll_device_s {
 
 struct jsdrvp_ul_device_s {
     struct msg_queue_s * cmd_q;
+    struct msg_queue_s * rsp_q;  // the lower-level responses, for statistics only
     void (*join)(struct jsdrvp_ul_device_s *);
 };
 
 // create and bind to ll
 int32_t jsdrvp_ul_js110_usb_factory(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll);
 int32_t jsdrvp_ul_js220_usb_factory(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll);
-int32_t jsdrvp_ul_emu_factory(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll);
+
+#ifndef JSDRV_FUZZ
+#define JSDRV_FUZZ 0
+#endif
+
+#if JSDRV_FUZZ
+/*
+ * Parser hooks for the test/parser_fuzz.c harness.  Each device starts
+ * open with every stream port enabled, but has no thread or USB backend.
+ * Process calls the stream-in parser with raw bulk-in data in msg.
+ */
+struct jsdrvp_ul_device_s * jsdrvp_ul_js110_usb_fuzz_alloc(struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll);
+void jsdrvp_ul_js110_usb_fuzz_process(struct jsdrvp_ul_device_s * device, struct jsdrvp_msg_s * msg);
+void jsdrvp_ul_js110_usb_fuzz_free(struct jsdrvp_ul_device_s * device);
+struct jsdrvp_ul_device_s * jsdrvp_ul_js220_usb_fuzz_alloc(struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll);
+void jsdrvp_ul_js220_usb_fuzz_process(struct jsdrvp_ul_device_s * device, struct jsdrvp_msg_s * msg);
+void jsdrvp_ul_js220_usb_fuzz_free(struct jsdrvp_ul_device_s * device);
+#endif
 
 
 struct jsdrvp_msg_extra_frontend_s {
     struct jsdrv_pubsub_subscriber_s subscriber;    // allow for deduplication
 };
 
+struct jsdrvp_msg_s;
+struct jsdrv_param_cache_device_s;
+
+/**
+ * @brief The upper-level completion callback for a control transfer.
+ *
+ * @param user_data The arbitrary user data.
+ * @param msg The completed control message with a successful status.
+ *      For control IN, msg->value holds the received data.  msg remains
+ *      owned by the caller.
+ * @return 0 or error code.
+ */
+typedef int32_t (*jsdrvp_usb_ctrl_fn)(void * user_data, struct jsdrvp_msg_s * msg);
+
 struct jsdrvp_msg_extra_backend_usb_control_s {
     usb_setup_t setup;
     int32_t status;
+    jsdrvp_usb_ctrl_fn cbk_fn;      // upper-level only, low-level must preserve
+    void * cbk_user_data;
 };
 
 struct jsdrvp_msg_extra_backend_usb_stream_s {
     uint8_t endpoint;
+    uint8_t batch;          // 1 when payload.usb_stream is valid
+    void * ll_transfer;     // low-level private, upper-level must not modify
+    int64_t time;           // jsdrv_time_utc() at USB completion, 0 if unknown
+};
+
+#define JSDRVP_USB_STREAM_BATCH_MAX     (16U)
+#define JSDRVP_USB_STREAM_BATCH_SEALED  (0x80000000U)
+
+struct jsdrvp_usb_stream_entry_s {
+    const uint8_t * buffer;
+    uint32_t size;
+    void * ll_transfer;     // low-level private
+    int64_t time;           // jsdrv_time_utc() at USB completion
+};
+
+// Consecutive stream completions, appended by the low-level until sealed.
+struct jsdrvp_payload_usb_stream_s {
+    volatile uint32_t state;  // entry count | JSDRVP_USB_STREAM_BATCH_SEALED
+    struct jsdrvp_usb_stream_entry_s entries[JSDRVP_USB_STREAM_BATCH_MAX];
 };
 
 union jsdrvp_msg_extra_s {
@@ -94,30 +149,63 @@ union jsdrvp_payload_u {
     struct jsdrvp_payload_subscribe_s sub;
     struct jsdrvp_payload_query_s query;
     struct jsdrvp_ll_device_s device;           // for @/add from backend
+    struct jsdrvp_payload_usb_stream_s usb_stream;  // batched JSDRV_USBBK_MSG_STREAM_IN_DATA
+    struct jsdrvp_msg_s * dispatch;             // retained data message for jsdrv_dispatch and the buffer
+    struct jsdrv_dispatch_queue_s * dispatch_queue;  // queue to drain for jsdrv_dispatch (u32_a=1)
 };
 
+struct jsdrvp_api_batch_s;  // jsdrv_publish_batch() shared state, see jsdrv.c
+
 struct jsdrvp_api_timeout_s {
     struct jsdrv_list_s item;                   // for putting into list
     char topic[JSDRV_TOPIC_LENGTH_MAX];  // to match
     int64_t timeout;                            // timeout time as fbp_time_utc()
+    uint32_t hash;                              // topic hash, internal to jsdrv_timeouts
+    uint32_t heap_index;                        // deadline heap index, internal to jsdrv_timeouts
+    uint32_t seq;                               // insertion order, internal to jsdrv_timeouts
     jsdrv_os_event_t ev;                        // The event to signal upon completion or timeout
     volatile int32_t return_code;               // The return code for the operation.
+    struct jsdrvp_api_batch_s * batch;          // NULL or shared batch, signal ev when last completes
+    jsdrv_completion_fn completion_fn;          // NULL or async callback, replaces ev, frees self
+    void * completion_user_data;                // The arbitrary data for completion_fn
 };
 
+/**
+ * @brief The message shared by all threads.
+ *
+ * Fields are grouped by access frequency.  Queue and pubsub routing
+ * only read the header through value, which fits in the first
+ * 64-byte cache line.  The topic string occupies the next line and
+ * is only read when topic_id is 0 or for logging.  The remaining
+ * fields are cold and the payload follows them.  Size classes
+ * allocate only the payload capacity that they need.
+ */
 struct jsdrvp_msg_s {
+    // hot: first cache line
     struct jsdrv_list_s item;                   // queue support (internal use) - MUST BE FIRST
     uint32_t inner_msg_type;                    // jsdrvp_msg_type_e (internal use, do not edit)
+    uint32_t msg_class;                         // size class (internal use, do not edit)
+    volatile uint32_t refcnt;                   // additional owners from jsdrv_retain (internal use, do not edit)
+    uint32_t topic_id;                          // 0 or the interned topic ID, see jsdrvp_topic_intern()
+    struct jsdrv_union_s value;                 // the value as a union type
+    uint32_t pool;                              // 1=owned by the context pool, 0=heap (internal use, do not edit)
+    uint32_t payload_size;                      // payload capacity in bytes (read only)
     uint32_t source;                            // 0=backend/frontend/internal, 1=api
     uint32_t u32_a;                             // temporary storage variable, available for message processing
+
+    // warm: second cache line
+    char topic[JSDRV_TOPIC_LENGTH_MAX];         // the topic name or device identifier
+
+    // cold
     uint32_t u32_b;                             // temporary storage variable, available for message processing
-    char topic[JSDRV_TOPIC_LENGTH_MAX];    // the topic name or device identifier
-    struct jsdrv_union_s value;                 // the value as a union type
-    union jsdrvp_msg_extra_s extra;
     struct jsdrvp_api_timeout_s * timeout;
+    union jsdrvp_msg_extra_s extra;
     union jsdrvp_payload_u payload;             // must be last
     // do not place any fields after payload!
 };
 
+JSDRV_STATIC_ASSERT(offsetof(struct jsdrvp_msg_s, topic) <= 64, jsdrvp_msg_hot_fits_cache_line);
+
 // Define parameter metadata.
 struct jsdrvp_param_s {
     const char * topic;
@@ -140,11 +228,24 @@ struct jsdrvp_msg_s * jsdrvp_msg_alloc(struct jsdrv_context_s * context);
  * @param topic The topic for the message.
  * @return The message.  Using pointer msg->value.value.bin to fill data
  *      and set msg->value.size.  The maximum payload size is
- *      JSDRVP_MSG_DATA_PAYLOAD_SIZE_MAX.
+ *      sizeof(struct jsdrv_stream_signal_s).
  * @throw assert on out of memory
  */
 struct jsdrvp_msg_s * jsdrvp_msg_alloc_data(struct jsdrv_context_s * context, const char * topic);
 
+/**
+ * @brief Allocate a binary data message sized for the payload.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The topic for the message.
+ * @param size The required payload size in bytes, up to
+ *      sizeof(struct jsdrv_stream_signal_s).
+ * @return The message from the smallest size class that holds size bytes.
+ *      msg->payload_size contains the actual payload capacity.
+ * @throw assert on out of memory
+ */
+struct jsdrvp_msg_s * jsdrvp_msg_alloc_data_sz(struct jsdrv_context_s * context, const char * topic, uint32_t size);
+
 /**
  * @brief Allocation a new message and populate with same contents as another message.
  *
@@ -166,6 +267,22 @@ struct jsdrvp_msg_s * jsdrvp_msg_clone(struct jsdrv_context_s * context, const s
  */
 struct jsdrvp_msg_s * jsdrvp_msg_alloc_value(struct jsdrv_context_s * context, const char * topic, const struct jsdrv_union_s * value);
 
+/**
+ * @brief Allocate a message that retains another message by reference.
+ *
+ * @param context The Joulescope driver context.
+ * @param msg The message to retain, usually a stream data message.
+ *      This function increments its reference count.
+ * @param u32_a The value for the new message u32_a, which identifies
+ *      the retained source to the receiving service.
+ * @return The new message with an empty topic and payload.dispatch = msg.
+ *      The receiver must jsdrvp_msg_free() both payload.dispatch and
+ *      this message.  Services use this to forward stream messages to
+ *      their worker threads rather than copying the data.
+ * @throw assert on out of memory
+ */
+struct jsdrvp_msg_s * jsdrvp_msg_dispatch_ref(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg, uint32_t u32_a);
+
 /**
  * @brief Free a message to the free list.
  *
@@ -173,6 +290,146 @@ struct jsdrvp_msg_s * jsdrvp_msg_alloc_value(struct jsdrv_context_s * context, c
  */
 void jsdrvp_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg);
 
+/**
+ * @brief Attach a message cache to the calling thread.
+ *
+ * @param context The Joulescope driver context.
+ *
+ * The per-thread cache holds a small magazine of free normal and data
+ * messages.  jsdrvp_msg_alloc*() and jsdrvp_msg_free() on this thread
+ * then use the magazine and only access the shared free queues in
+ * batches.  Each driver thread that allocates or frees messages at high
+ * rate should call this function on start and call
+ * jsdrvp_msg_cache_detach() before it exits.
+ */
+void jsdrvp_msg_cache_attach(struct jsdrv_context_s * context);
+
+/**
+ * @brief Detach the message cache from the calling thread.
+ *
+ * @param context The Joulescope driver context.
+ *
+ * Return all cached messages to the shared free queues.
+ */
+void jsdrvp_msg_cache_detach(struct jsdrv_context_s * context);
+
+/// The driver thread roles for jsdrvp_thread_configure().
+enum jsdrvp_thread_e {
+    JSDRVP_THREAD_FRONTEND,
+    JSDRVP_THREAD_BACKEND,
+    JSDRVP_THREAD_DEVICE,
+    JSDRVP_THREAD_BUFFER,
+    JSDRVP_THREAD_DISPATCH,
+    JSDRVP_THREAD_COUNT,
+};
+
+/**
+ * @brief Configure the calling thread.
+ *
+ * @param context The Joulescope driver context.
+ * @param thread The thread role.
+ * @param name The thread name.
+ *
+ * Set the thread name, and apply any CPU affinity and priority
+ * from the jsdrv_initialize() "@/thread/..." arguments for this role.
+ * Each driver thread should call this function on start.
+ */
+void jsdrvp_thread_configure(struct jsdrv_context_s * context, enum jsdrvp_thread_e thread, const char * name);
+
+/**
+ * @brief Claim a stream data message from the low-level backend.
+ *
+ * @param msg The JSDRV_USBBK_MSG_STREAM_IN_DATA message.
+ * @return The number of buffers in the message.
+ *
+ * When the upper level falls behind, the low-level may append
+ * further completions to a message that is still queued.  Call this
+ * function once after receiving the message to stop further appends,
+ * then call jsdrvp_usb_stream_select() for each buffer.
+ */
+uint32_t jsdrvp_usb_stream_seal(struct jsdrvp_msg_s * msg);
+
+/**
+ * @brief Select a stream data buffer.
+ *
+ * @param msg The JSDRV_USBBK_MSG_STREAM_IN_DATA message.
+ * @param index The buffer index less than jsdrvp_usb_stream_seal().
+ *
+ * Set msg->value to the selected buffer.
+ */
+void jsdrvp_usb_stream_select(struct jsdrvp_msg_s * msg, uint32_t index);
+
+/**
+ * @brief Add a device to the JSDRV_ARG_USB_CAPTURE file.
+ *
+ * @param context The Joulescope driver context.
+ * @param prefix The device prefix.
+ * @return The capture device_id for jsdrvp_usb_capture(), or 0 when
+ *      capture is disabled.
+ */
+uint16_t jsdrvp_usb_capture_device(struct jsdrv_context_s * context, const char * prefix);
+
+/**
+ * @brief Get the parameter cache entry for a device.
+ *
+ * @param context The Joulescope driver context.
+ * @param prefix The device prefix.
+ * @return The cache entry, which persists until jsdrv_finalize().
+ *      The device thread is the only user of the returned entry.
+ */
+struct jsdrv_param_cache_device_s * jsdrvp_param_cache(struct jsdrv_context_s * context, const char * prefix);
+
+/**
+ * @brief Capture a bulk-in transfer to the JSDRV_ARG_USB_CAPTURE file.
+ *
+ * @param context The Joulescope driver context.
+ * @param device_id The capture device_id from jsdrvp_usb_capture_device().
+ *      0 does nothing.
+ * @param msg The JSDRV_USBBK_MSG_STREAM_IN_DATA message after
+ *      jsdrvp_usb_stream_select().
+ */
+void jsdrvp_usb_capture(struct jsdrv_context_s * context, uint16_t device_id, const struct jsdrvp_msg_s * msg);
+
+/**
+ * @brief Get a jsdrv_initialize() argument.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The argument topic.
+ * @param[out] value The argument value.
+ * @return 0 or JSDRV_ERROR_NOT_FOUND.
+ *
+ * The arguments are only available during jsdrv_initialize(),
+ * such as from a backend factory.
+ */
+int32_t jsdrvp_arg_get(struct jsdrv_context_s * context, const char * topic, struct jsdrv_union_s * value);
+
+/**
+ * @brief Handle a device "h/thread/..." topic on the calling thread.
+ *
+ * @param topic The device topic with the device prefix removed.
+ * @param value The topic value.
+ * @return 0, error code, or JSDRV_ERROR_NOT_FOUND if topic is not
+ *      a supported thread topic.
+ *
+ * Supports "h/thread/affinity" (u64 CPU mask) and
+ * "h/thread/priority" (i32), which apply to the device thread.
+ */
+int32_t jsdrvp_thread_topic(const char * topic, const struct jsdrv_union_s * value);
+
+/**
+ * @brief Resolve a topic name to a numeric topic ID.
+ *
+ * @param context The Joulescope driver context.
+ * @param topic The full topic name, such as "u/js220/000415/s/i/!data".
+ * @return The nonzero topic ID or 0 on failure.
+ *
+ * Backend and device threads may send messages with topic_id set and
+ * an empty topic string.  The frontend restores the topic string from
+ * the ID and pubsub delivers directly to the topic without parsing.
+ * Resolve the ID once, such as on stream enable, not per message.
+ */
+uint32_t jsdrvp_topic_intern(struct jsdrv_context_s * context, const char * topic);
+
 /**
  * @brief Send an async message from the backend to the frontend.
  *
@@ -183,6 +440,17 @@ void jsdrvp_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg
  */
 void jsdrvp_backend_send(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg);
 
+/**
+ * @brief Get the number of backend messages waiting for the frontend.
+ *
+ * @param context The Joulescope driver context.
+ * @return The approximate message count, which device drivers use
+ *      to detect a frontend that is falling behind.
+ *
+ * Note: implemented by the front-end.
+ */
+uint32_t jsdrvp_backend_queue_depth(struct jsdrv_context_s * context);
+
 /**
  * @brief Send a finalize message to a queue.
  *
@@ -214,5 +482,20 @@ void jsdrvp_device_subscribe(struct jsdrv_context_s * context, const char * dev_
 void jsdrvp_device_unsubscribe(struct jsdrv_context_s * context, const char * dev_topic,
                                const char * topic, uint8_t flags);
 
+/**
+ * @brief Watch the subscriber count for a device topic.
+ *
+ * @param context The Joulescope driver context.
+ * @param dev_topic The device prefix topic.
+ * @param topic The full topic to watch.
+ * @param enable True to watch, false to stop watching.
+ *
+ * The device receives a message for topic with the u32 count of other
+ * subscribers and app JSDRV_PAYLOAD_TYPE_WATCH on each change.
+ * @see JSDRV_PUBSUB_WATCH
+ */
+void jsdrvp_device_watch(struct jsdrv_context_s * context, const char * dev_topic,
+                         const char * topic, bool enable);
+
 
 #endif  /* JSDRV_PRV_FRONTEND_H_ */
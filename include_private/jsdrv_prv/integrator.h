@@ -0,0 +1,138 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Marker-bounded charge and energy integration.
+ */
+
+#ifndef JSDRV_PRV_INTEGRATOR_H_
+#define JSDRV_PRV_INTEGRATOR_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Forward declarations from "jsdrv.h"
+struct jsdrv_stream_signal_s;
+struct jsdrv_interval_s;
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_integrator Interval integrator
+ *
+ * @brief Integrate current and power between start and stop markers.
+ *
+ * The integrator keeps a short list of pending intervals in sample_id
+ * order.  A start marker appends an open interval, and a stop marker
+ * closes the most recent one.  Each float32 current or power block
+ * adds its samples to every pending interval that it overlaps, so the
+ * two signals may arrive independently.  Samples accumulate as 2**-31
+ * fixed-point integers, in int64 for each run of samples and then into
+ * a 128-bit sum, which makes the result exact and independent of the
+ * block boundaries.
+ *
+ * An interval completes once both signals have passed its stop marker.
+ * Samples that arrive before their start marker are not included, and
+ * the interval reports JSDRV_INTERVAL_FLAG_PARTIAL.  Callers that
+ * receive markers late should hold the sample blocks until the marker
+ * source has passed them.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The maximum pending intervals.
+#define JSDRV_INTEGRATOR_PENDING_MAX (32U)
+
+/// The integrator signals.
+enum jsdrv_integrator_signal_e {
+    JSDRV_INTEGRATOR_CURRENT = 0,
+    JSDRV_INTEGRATOR_POWER = 1,
+};
+
+/// The opaque integrator instance.
+struct jsdrv_integrator_s;
+
+/**
+ * @brief Allocate a new integrator.
+ *
+ * @return The new instance, or NULL.
+ */
+struct jsdrv_integrator_s * jsdrv_integrator_new(void);
+
+/**
+ * @brief Free an integrator.
+ *
+ * @param self The instance, which may be NULL.
+ */
+void jsdrv_integrator_free(struct jsdrv_integrator_s * self);
+
+/**
+ * @brief Discard all pending intervals and the signal state.
+ *
+ * @param self The instance.
+ */
+void jsdrv_integrator_clear(struct jsdrv_integrator_s * self);
+
+/**
+ * @brief Add a marker.
+ *
+ * @param self The instance.
+ * @param sample_id The marker sample_id.  The interval includes the start
+ *      marker sample and excludes the stop marker sample.
+ * @param start True to start an interval, false to stop it.  A start while
+ *      an interval is open and a stop while none is open are ignored.
+ * @return 0, JSDRV_ERROR_SEQUENCE when sample_id is before the most
+ *      recent marker, or JSDRV_ERROR_FULL when too many intervals are pending.
+ */
+int32_t jsdrv_integrator_marker(struct jsdrv_integrator_s * self, uint64_t sample_id, bool start);
+
+/**
+ * @brief Add samples.
+ *
+ * @param self The instance.
+ * @param signal The jsdrv_integrator_signal_e.
+ * @param s The float32 stream samples or a deadband hold record, which
+ *      contributes its mean for each sample and its min and max.
+ * @return 0 or error code.
+ */
+int32_t jsdrv_integrator_add(struct jsdrv_integrator_s * self, uint8_t signal, const struct jsdrv_stream_signal_s * s);
+
+/**
+ * @brief The sample_id after the most recent sample from any signal.
+ *
+ * @param self The instance.
+ * @return The sample_id, or 0 before the first samples.
+ */
+uint64_t jsdrv_integrator_position(struct jsdrv_integrator_s * self);
+
+/**
+ * @brief Produce the next completed interval.
+ *
+ * @param self The instance.
+ * @param[out] interval The completed interval.
+ * @return 0 or JSDRV_ERROR_UNAVAILABLE when no interval is complete.
+ */
+int32_t jsdrv_integrator_next(struct jsdrv_integrator_s * self, struct jsdrv_interval_s * interval);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_INTEGRATOR_H_ */
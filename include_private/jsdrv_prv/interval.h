@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Marker-bounded interval integration service.
+ */
+
+#ifndef JSDRV_PRV_INTERVAL_H_
+#define JSDRV_PRV_INTERVAL_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+// Forward declarations from "jsdrv.h"
+struct jsdrv_context_s;
+
+#ifndef JSDRV_INTERVAL_COUNT_MAX
+#define JSDRV_INTERVAL_COUNT_MAX                      8
+#endif
+
+#ifndef JSDRV_INTERVAL_HOLD_MAX
+#define JSDRV_INTERVAL_HOLD_MAX                       32      // stream messages held for each signal awaiting markers
+#endif
+
+// topics for the interval manager: add/remove integrators
+#define JSDRV_INTERVAL_MGR_MSG_ACTION_ADD             "e/@/!add"      // u8: 1 <= id <= JSDRV_INTERVAL_COUNT_MAX
+#define JSDRV_INTERVAL_MGR_MSG_ACTION_REMOVE          "e/@/!remove"   // u8 id
+#define JSDRV_INTERVAL_MGR_MSG_ACTION_LIST            "e/@/list"      // bin ro: u8[N] ids
+
+// topics per integrator: prefix is "e/GGG/" where GGG is the integrator id
+#define JSDRV_INTERVAL_MSG_DEVICE                     "g/device"      // str: device prefix for s/i/!data and s/p/!data, "" to stop
+#define JSDRV_INTERVAL_MSG_MARKER                     "g/marker"      // str: u1 marker signal like "gpi/0", "" for software markers only (default)
+#define JSDRV_INTERVAL_MSG_POLARITY                   "g/polarity"    // u32: 0 high level is inside (default), 1 low level is inside
+#define JSDRV_INTERVAL_MSG_START                      "g/!start"      // u64: start sample_id, 0 for the next sample, at most JSDRV_INTERVAL_HOLD_MAX blocks old
+#define JSDRV_INTERVAL_MSG_STOP                       "g/!stop"       // u64: stop sample_id, 0 for the next sample, at most JSDRV_INTERVAL_HOLD_MAX blocks old
+#define JSDRV_INTERVAL_MSG_CLEAR                      "g/!clear"      // Discard pending intervals
+#define JSDRV_INTERVAL_MSG_DATA                       "g/!data"       // ro: jsdrv_interval_s
+
+JSDRV_CPP_GUARD_START
+
+/**
+ * @brief Initialize the singleton interval manager.
+ *
+ * @return 0 or error code.
+ */
+int32_t jsdrv_interval_initialize(struct jsdrv_context_s * context);
+
+/**
+ * @brief Finalize the singleton interval manager.
+ */
+void jsdrv_interval_finalize(void);
+
+JSDRV_CPP_GUARD_END
+
+#endif  /* JSDRV_PRV_INTERVAL_H_ */
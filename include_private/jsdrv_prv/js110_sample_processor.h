@@ -33,6 +33,11 @@ JSDRV_CPP_GUARD_START
 #define JS110_SUPPRESS_SAMPLES_MAX 64U  // must be power of 2
 #define JS110_I_RANGE_OFF 7U
 #define JS110_I_RANGE_MISSING 8U
+#define JS110_SP_LAZY_HISTORY 8U   // samples before a range switch, at least the maximum pre
+#define JS110_SP_LAZY_DELAY 40U    // at least the maximum manual window plus the maximum post
+#define JS110_SP_LAZY_LENGTH (JS110_SP_LAZY_HISTORY + JS110_SP_LAZY_DELAY)
+#define JS110_SP_LUT_CODES 16384U  // the 14-bit current and voltage codes
+#define JS110_SP_LUT_SIZE ((8U + 2U) * JS110_SP_LUT_CODES)  // 8 current and 2 voltage ranges
 
 enum js110_supress_mode_e {
     JS110_SUPPRESS_MODE_OFF       = 0,    // disabled, force zero delay
@@ -57,8 +62,30 @@ struct js110_sample_s {
     uint8_t reserved_u8;
 };
 
+// The single-precision calibration for one voltage range, indexed by the 3-bit current range.
+struct js110_sp_cal_f32_s {
+    float i_offset[8];
+    float i_gain[8];
+    float v_offset;
+    float v_gain;
+};
+
+// The lazy suppression state: history samples already output, then pending samples.
+struct js110_sp_lazy_s {
+    float i[JS110_SP_LAZY_LENGTH];
+    float v[JS110_SP_LAZY_LENGTH];
+    float p[JS110_SP_LAZY_LENGTH];
+    uint8_t i_range[JS110_SP_LAZY_LENGTH];        // the raw range for transition detection
+    uint8_t current_range[JS110_SP_LAZY_LENGTH];
+    uint8_t gpi0[JS110_SP_LAZY_LENGTH];
+    uint8_t gpi1[JS110_SP_LAZY_LENGTH];
+    uint32_t suppressed;  // pending samples already covered by a suppression window
+};
+
 struct js110_sp_s {
     double cal[2][2][9];  // current/voltage, offset/gain
+    struct js110_sp_cal_f32_s _cal_f32[2];  // from cal by js110_sp_cal_update(), per voltage range
+    float * _lut;         // optional from cal by js110_sp_cal_update(), JS110_SP_LUT_SIZE entries
 
     struct js110_sample_s samples[JS110_SUPPRESS_SAMPLES_MAX];
     uint8_t head;
@@ -83,6 +110,9 @@ struct js110_sp_s {
     int32_t _suppress_samples_counter;
     uint8_t _suppress_mode;
 
+    uint8_t _suppress_lazy;
+    struct js110_sp_lazy_s _lazy;
+
     uint16_t sample_toggle_last;
     uint16_t sample_toggle_mask;
     uint8_t _voltage_range;
@@ -91,12 +121,99 @@ struct js110_sp_s {
 
 void js110_sp_initialize(struct js110_sp_s * self);
 
+/**
+ * @brief Free the sample processor resources.
+ *
+ * @param self The sample processor.
+ */
+void js110_sp_finalize(struct js110_sp_s * self);
+
 void js110_sp_reset(struct js110_sp_s * self);
 
 struct js110_sample_s js110_sp_process(struct js110_sp_s * self, uint32_t sample_u32, uint8_t v_range);
 
+/**
+ * @brief Process a block of raw samples.
+ *
+ * @param self The sample processor.
+ * @param raw The raw samples.
+ * @param n The number of samples in raw and in each output array.
+ * @param v_range The voltage range for the block.
+ * @param i The output current.
+ * @param v The output voltage.
+ * @param p The output power.
+ * @param current_range The output current range.
+ * @param gpi0 The output general-purpose input 0.
+ * @param gpi1 The output general-purpose input 1.
+ *
+ * Equivalent to calling js110_sp_process() for each sample, but
+ * decodes and calibrates the block in single precision using the
+ * jsdrv_f32_ops_isa() instruction set.  Blocks with a constant current
+ * range, which is the common case, skip the per-sample calibration
+ * table lookup.  The range-switch suppression remains scalar.
+ */
+void js110_sp_process_block(struct js110_sp_s * self, const uint32_t * raw, uint32_t n, uint8_t v_range,
+                            float * i, float * v, float * p,
+                            uint8_t * current_range, uint8_t * gpi0, uint8_t * gpi1);
+
 int32_t js110_sp_suppress_win(struct js110_sp_s * self, uint8_t window);
 
+/**
+ * @brief Update the precomputed calibration tables.
+ *
+ * @param self The sample processor.
+ *
+ * Call after each change to cal.  js110_sp_process_block() only uses
+ * the precomputed tables, while js110_sp_process() uses cal directly.
+ */
+void js110_sp_cal_update(struct js110_sp_s * self);
+
+/**
+ * @brief Enable the fused calibration lookup table.
+ *
+ * @param self The sample processor.
+ * @param enable 0 to calibrate with the jsdrv_f32_ops_isa() arithmetic,
+ *      1 to use the lookup table.
+ * @return 0 or JSDRV_ERROR_NOT_ENOUGH_MEMORY.
+ *
+ * The table maps each 14-bit code to its calibrated float value for
+ * each current and voltage range, so js110_sp_process_block()
+ * calibrates each sample with two table lookups.  The table computes
+ * each entry in double precision, so the current and voltage match
+ * js110_sp_process() exactly.  The table uses 640 kB.
+ */
+int32_t js110_sp_cal_lut(struct js110_sp_s * self, uint8_t enable);
+
+/**
+ * @brief Account for missing samples without processing them.
+ *
+ * @param self The sample processor.
+ * @param n The number of missing samples.
+ *
+ * Equivalent to processing n missing (0xffffffff) samples once the
+ * suppression delay holds only missing samples, which is true after
+ * processing at least #JS110_SUPPRESS_SAMPLES_MAX missing samples.
+ * The outputs for these n samples are all missing.
+ */
+void js110_sp_skip(struct js110_sp_s * self, uint64_t n);
+
+/**
+ * @brief Enable lazy range-switch suppression for js110_sp_process_block().
+ *
+ * @param self The sample processor.
+ * @param enable 0 to use the suppression ring, 1 for lazy suppression.
+ *
+ * Lazy suppression delays samples by #JS110_SP_LAZY_DELAY rather than
+ * #JS110_SUPPRESS_SAMPLES_MAX.  Each block scans for current range
+ * transitions and passes blocks without transitions straight through.
+ * It only applies the suppression mode to the window following each
+ * transition: NAN replaces the window, MEAN uses the mean of the pre
+ * and post samples, and INTERP ramps linearly from the pre mean to the
+ * post mean.  Changing the mode discards pending samples, so change
+ * it while not streaming.  js110_sp_process() always uses the ring.
+ */
+void js110_sp_suppress_lazy(struct js110_sp_s * self, uint8_t enable);
+
 JSDRV_CPP_GUARD_END
 
 /** @} */
@@ -34,6 +34,9 @@
  *
  * @brief Compute JS110 statistics on the host and convert on-instrument statistics.
  *
+ * The JS220 driver also uses this module for its host-side statistics,
+ * s/stats/host/value, over aligned current, voltage, and power.
+ *
  * @{
  */
 
@@ -95,6 +98,26 @@ void js110_stats_sample_count_set(struct js110_stats_s * self, uint32_t sample_c
  */
 struct jsdrv_statistics_s * js110_stats_compute(struct js110_stats_s * self, float i, float v, float p);
 
+/**
+ * @brief Compute statistics over a block of samples.
+ *
+ * @param self[in] The stats instance.
+ * @param i The current samples in A.
+ * @param v The voltage samples in V.
+ * @param p The power samples in W.
+ * @param n The number of samples in i, v, and p.
+ * @param stats[out] NULL or the statistics structure for the completed
+ *      stats block which remains valid until the next call with self.
+ * @return The number of samples consumed, which stops at the end of
+ *      each stats block.  Call again with the remaining samples.
+ *
+ * The result is bit-identical to calling js110_stats_compute() for
+ * each sample.  The min, max, and sums of squares use the SIMD
+ * instruction set selected by jsdrv_f32_ops_isa().
+ */
+uint32_t js110_stats_compute_block(struct js110_stats_s * self, const float * i, const float * v, const float * p,
+                                   uint32_t n, struct jsdrv_statistics_s ** stats);
+
 
 JSDRV_CPP_GUARD_END
 
@@ -34,25 +34,140 @@
  *
  * @brief Perform i128 math.
  *
+ * The statistics accumulate with add and square_i64 for every sample,
+ * so these are inline with a compile-time implementation:
+ * - native __int128 on GCC and Clang for 64-bit targets,
+ * - _addcarry_u64 and _umul128 intrinsics on MSVC x64,
+ * - portable u64 halves otherwise.
+ *
+ * Define JS220_I128_PORTABLE to force the portable implementation.
+ *
  * @{
  */
 
+#if defined(JS220_I128_PORTABLE)
+#elif defined(__SIZEOF_INT128__)
+#define JS220_I128_NATIVE 1
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define JS220_I128_MSVC 1
+#include <intrin.h>
+#endif
+
 
 JSDRV_CPP_GUARD_START
 
-js220_i128 js220_i128_init_i64(int64_t a);
-js220_i128 js220_i128_add(js220_i128 a, js220_i128 b);
-js220_i128 js220_i128_sub(js220_i128 a, js220_i128 b);
-js220_i128 js220_i128_square_i64(int64_t a);
-js220_i128 js220_i128_neg(js220_i128 x);
+JSDRV_INLINE_FN js220_i128 js220_i128_init_i64(int64_t a) {
+    js220_i128 r;
+    r.i64[0] = a;
+    r.i64[1] = (a >= 0) ? 0 : -1;
+    return r;
+}
+
+#if JS220_I128_NATIVE
+
+__extension__ typedef __int128 js220_i128_native;
+__extension__ typedef unsigned __int128 js220_u128_native;
+
+JSDRV_INLINE_FN js220_i128 js220_i128_add(js220_i128 a, js220_i128 b) {
+    a.i128 = a.i128 + b.i128;
+    return a;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_sub(js220_i128 a, js220_i128 b) {
+    a.i128 = a.i128 - b.i128;
+    return a;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_square_i64(int64_t a) {
+    js220_i128 r;
+    r.i128 = a;
+    r.i128 = r.i128 * r.i128;
+    return r;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_neg(js220_i128 x) {
+    x.i128 = -x.i128;
+    return x;
+}
+
+#elif JS220_I128_MSVC
+
+JSDRV_INLINE_FN js220_i128 js220_i128_add(js220_i128 a, js220_i128 b) {
+    js220_i128 r;
+    uint8_t c = _addcarry_u64(0, a.u64[0], b.u64[0], &r.u64[0]);
+    _addcarry_u64(c, a.u64[1], b.u64[1], &r.u64[1]);
+    return r;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_sub(js220_i128 a, js220_i128 b) {
+    js220_i128 r;
+    uint8_t c = _subborrow_u64(0, a.u64[0], b.u64[0], &r.u64[0]);
+    _subborrow_u64(c, a.u64[1], b.u64[1], &r.u64[1]);
+    return r;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_square_i64(int64_t a) {
+    js220_i128 r;
+    uint64_t u = (a < 0) ? (0 - (uint64_t) a) : (uint64_t) a;
+    r.u64[0] = _umul128(u, u, &r.u64[1]);
+    return r;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_neg(js220_i128 x) {
+    js220_i128 zero = {.u64 = {0, 0}};
+    return js220_i128_sub(zero, x);
+}
+
+#else
+
+JSDRV_INLINE_FN js220_i128 js220_i128_add(js220_i128 a, js220_i128 b) {
+    js220_i128 r;
+    r.u64[0] = a.u64[0] + b.u64[0];
+    r.u64[1] = a.u64[1] + b.u64[1] + ((r.u64[0] < a.u64[0]) ? 1 : 0);
+    return r;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_sub(js220_i128 a, js220_i128 b) {
+    js220_i128 r;
+    r.u64[0] = a.u64[0] - b.u64[0];
+    r.u64[1] = a.u64[1] - b.u64[1] - ((a.u64[0] < b.u64[0]) ? 1 : 0);
+    return r;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_square_i64(int64_t a) {
+    js220_i128 r;
+    uint64_t u = (a < 0) ? (0 - (uint64_t) a) : (uint64_t) a;
+    uint64_t hi = u >> 32;
+    uint64_t lo = u & 0xffffffffU;
+    uint64_t ll = lo * lo;
+    uint64_t hl = hi * lo;
+    uint64_t mid1 = hl + (ll >> 32);            // cannot overflow
+    uint64_t mid2 = hl + (mid1 & 0xffffffffU);  // cannot overflow
+    r.u64[0] = (mid2 << 32) | (ll & 0xffffffffU);
+    r.u64[1] = hi * hi + (mid1 >> 32) + (mid2 >> 32);
+    return r;
+}
+
+JSDRV_INLINE_FN js220_i128 js220_i128_neg(js220_i128 x) {
+    js220_i128 zero = {.u64 = {0, 0}};
+    return js220_i128_sub(zero, x);
+}
+
+#endif
+
+JSDRV_INLINE_FN bool js220_i128_is_neg(js220_i128 x) {
+    return x.i64[1] < 0;
+}
+
 js220_i128 js220_i128_udiv(js220_i128 dividend, uint64_t divisor, uint64_t * remainder);
 js220_i128 js220_i128_lshift(js220_i128 x, int32_t shift);
 js220_i128 js220_i128_rshift(js220_i128 x, int32_t shift);
 double js220_i128_to_f64(js220_i128 x, uint32_t q);
-bool js220_i128_is_neg(js220_i128 x);
 double js220_i128_compute_std(int64_t x1, js220_i128 x2, uint64_t n, uint32_t q);
 js220_i128 js220_i128_compute_integral(js220_i128 x, uint64_t n);
 
 JSDRV_CPP_GUARD_END
 
+/** @} */
+
 #endif // JSDRV_JS220_I128_MATH_H__
\ No newline at end of file
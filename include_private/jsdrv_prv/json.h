@@ -64,7 +64,7 @@ JSDRV_CPP_GUARD_START
  * @brief The token types emitted by the parser.
  */
 enum jsdrv_json_token_e {
-    JSDRV_JSON_VALUE,         // dtype: string, i32, f32, null
+    JSDRV_JSON_VALUE,         // dtype: string, i32, i64 when out of i32 range, f64, null
     JSDRV_JSON_KEY,           // dtype: string
     JSDRV_JSON_OBJ_START,     // dtype: null
     JSDRV_JSON_OBJ_END,       // dtype: null
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Stream delivery latency histogram for the device drivers.
+ */
+
+#ifndef JSDRV_PRV_LATENCY_HIST_H_
+#define JSDRV_PRV_LATENCY_HIST_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_latency_hist Latency histogram
+ *
+ * @brief Logarithmic latency histogram.
+ *
+ * The device drivers record the latency from the USB completion of the
+ * first sample in each stream data message until the driver sends the
+ * message, then periodically format the histogram as JSON for the
+ * device "h/stream/latency" topic.
+ *
+ * Bin 0 holds latencies below #JSDRV_LATENCY_HIST_BIN0_US.  Each
+ * following bin doubles the upper edge, and the last bin holds
+ * all larger latencies.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The upper edge of the first bin in microseconds.
+#define JSDRV_LATENCY_HIST_BIN0_US (125U)
+
+/// The number of bins, which covers up to 512 ms.
+#define JSDRV_LATENCY_HIST_BINS (14U)
+
+/// The latency histogram.
+struct jsdrv_latency_hist_s {
+    uint32_t count;                             ///< The number of samples.
+    uint32_t max_us;                            ///< The maximum latency.
+    uint64_t sum_us;                            ///< The latency total.
+    uint32_t bins[JSDRV_LATENCY_HIST_BINS];     ///< The sample count for each bin.
+};
+
+/**
+ * @brief Clear the histogram.
+ *
+ * @param self The histogram instance.
+ */
+void jsdrv_latency_hist_clear(struct jsdrv_latency_hist_s * self);
+
+/**
+ * @brief Add a latency sample.
+ *
+ * @param self The histogram instance.
+ * @param latency The latency in jsdrv time units.  Negative values,
+ *      from clock steps, count as 0.
+ */
+void jsdrv_latency_hist_add(struct jsdrv_latency_hist_s * self, int64_t latency);
+
+/**
+ * @brief Format the histogram as a JSON object and clear it.
+ *
+ * @param self The histogram instance.
+ * @param buf The output buffer.
+ * @param size The size of buf in bytes.
+ * @return The number of samples written, which is 0 when empty
+ *      or when buf is too small.
+ *
+ * The format is {"count": 3, "avg_us": 200, "max_us": 400,
+ * "edges_us": [125, 250, ...], "counts": [0, 2, 1, ...]}.  The
+ * edges_us array contains the upper edge of each bin except the last.
+ */
+uint32_t jsdrv_latency_hist_json(struct jsdrv_latency_hist_s * self, char * buf, uint32_t size);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_LATENCY_HIST_H_ */
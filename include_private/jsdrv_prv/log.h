@@ -44,6 +44,8 @@ JSDRV_CPP_GUARD_START
  *
  * The maximum level to compile regardless of the individual module level.
  * This value should be defined in the project CMake (makefile).
+ * The JSDRV_LOG_DEBUG=OFF CMake option sets this to JSDRV_LOG_LEVEL_INFO,
+ * which compiles out all DEBUG messages.
  */
 #ifndef JSDRV_LOG_GLOBAL_LEVEL
 #define JSDRV_LOG_GLOBAL_LEVEL JSDRV_LOG_LEVEL_ALL
@@ -63,6 +65,41 @@ JSDRV_CPP_GUARD_START
 #define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_INFO
 #endif
 
+/// The modules with independent runtime log levels.
+enum jsdrv_log_module_e {
+    JSDRV_LOG_MODULE_DEFAULT,
+    JSDRV_LOG_MODULE_FRONTEND,
+    JSDRV_LOG_MODULE_PUBSUB,
+    JSDRV_LOG_MODULE_USB,
+    JSDRV_LOG_MODULE_JS110,
+    JSDRV_LOG_MODULE_JS220,
+    JSDRV_LOG_MODULE_BUFFER,
+    JSDRV_LOG_MODULE_COUNT,
+};
+
+/**
+ * @def JSDRV_LOG_MODULE
+ *
+ * @brief The module for runtime level filtering.
+ *
+ * Define before including this file, like JSDRV_LOG_LEVEL:
+ *
+ *      #define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_JS220
+ *      #include "log.h"
+ */
+#ifndef JSDRV_LOG_MODULE
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_DEFAULT
+#endif
+
+/**
+ * @brief The runtime level threshold for each module.
+ *
+ * Each entry is the lesser of the module level and the global level
+ * from jsdrv_log_level_set(), so the JSDRV_LOG macros reject filtered
+ * messages without calling jsdrv_log_publish().
+ */
+extern volatile int8_t jsdrv_log_module_threshold[JSDRV_LOG_MODULE_COUNT];
+
 /**
  * @def \_\_FILENAME\_\_
  *
@@ -92,6 +129,50 @@ JSDRV_CPP_GUARD_START
  */
 void jsdrv_log_publish(uint8_t level, const char * filename, uint32_t line, const char * format, ...);
 
+#ifndef JSDRV_LOG_RATE_INTERVAL_MS
+/// The minimum interval between messages from each rate-limited call site.
+#define JSDRV_LOG_RATE_INTERVAL_MS (1000U)
+#endif
+
+#ifndef JSDRV_LOG_RATE_SITES_MAX
+/// The maximum rate-limited call sites with deferred suppression summaries.
+#define JSDRV_LOG_RATE_SITES_MAX (64U)
+#endif
+
+/**
+ * @brief The state for a rate-limited call site.
+ *
+ * The JSDRV_LOG_RATE macros define one static instance at each call site.
+ */
+struct jsdrv_log_rate_s {
+    volatile uint32_t registered;  // 0 until first use
+    volatile uint32_t t_next_ms;   // next permitted message time, jsdrv_time_ms_u32()
+    volatile uint32_t suppressed;  // messages suppressed since the last one published
+    uint8_t level;
+    uint32_t line;
+    const char * filename;
+};
+
+/**
+ * @brief Publish a rate-limited log message.
+ *
+ * @param rate The call site state.
+ * @param level The fbp_log_level_e.
+ * @param filename The source filename, which must have static storage.
+ * @param line The source line in filename.
+ * @param format The printf-compatible format specification.
+ * @param ... The formatting arguments.
+ *
+ * Publishes at most one message per JSDRV_LOG_RATE_INTERVAL_MS
+ * for each call site and counts the rest.  The next published message
+ * from the call site follows a "suppressed N identical messages"
+ * summary.  When the call site goes quiet, the log thread publishes
+ * the summary once the interval elapses, or on finalize.  Suppression
+ * costs an atomic increment and a time read with no formatting.
+ */
+void jsdrv_log_publish_rate(struct jsdrv_log_rate_s * rate, uint8_t level, const char * filename, uint32_t line,
+                            const char * format, ...);
+
 /**
  * @brief The printf-style variadic arguments define to handle log messages.
  *
@@ -124,6 +205,14 @@ extern char const jsdrv_log_level_char[JSDRV_LOG_LEVEL_ALL + 1];
  */
 #define JSDRV_LOG_CHECK_STATIC(level) ((level <= JSDRV_LOG_GLOBAL_LEVEL) && (level <= JSDRV_LOG_LEVEL) && (level >= 0))
 
+/**
+ * @brief Check the level against this module's runtime threshold.
+ *
+ * @param level The level to query.
+ * @return True if logging at level is currently enabled.
+ */
+#define JSDRV_LOG_CHECK_RUNTIME(level) (level <= jsdrv_log_module_threshold[JSDRV_LOG_MODULE])
+
 /**
  * @brief Check a log level against a configured level.
  *
@@ -141,12 +230,26 @@ extern char const jsdrv_log_level_char[JSDRV_LOG_LEVEL_ALL + 1];
  * \param ... The arguments to the formatting string.
  */
 #define JSDRV_LOG(level, format, ...) do {            \
-    if (JSDRV_LOG_CHECK_STATIC(level)) {              \
+    if (JSDRV_LOG_CHECK_STATIC(level) && JSDRV_LOG_CHECK_RUNTIME(level)) { \
         JSDRV_LOG_PRINTF(level, format, __VA_ARGS__); \
     }                                               \
 } while (0)
 
 
+/*!
+ * \brief Macro to log a rate-limited printf-compatible formatted string.
+ *
+ * \param level The jsdrv_log_level_e.
+ * \param format The printf-compatible formatting string.
+ * \param ... The arguments to the formatting string.
+ */
+#define JSDRV_LOG_RATE(level, format, ...) do {       \
+    static struct jsdrv_log_rate_s jsdrv_log_rate_;   \
+    if (JSDRV_LOG_CHECK_STATIC(level) && JSDRV_LOG_CHECK_RUNTIME(level)) { \
+        jsdrv_log_publish_rate(&jsdrv_log_rate_, level, __FILENAME__, __LINE__, format, __VA_ARGS__); \
+    }                                               \
+} while (0)
+
 #ifdef _MSC_VER
 /* Microsoft Visual Studio compiler support */
 /** Log a emergency using printf-style arguments. */
@@ -169,6 +272,14 @@ extern char const jsdrv_log_level_char[JSDRV_LOG_LEVEL_ALL + 1];
 #define JSDRV_LOG_DEBUG2(format, ...)    JSDRV_LOG(JSDRV_LOG_LEVEL_DEBUG2,  format, __VA_ARGS__)
 /** Log an insanely detailed debug message using printf-style arguments. */
 #define JSDRV_LOG_DEBUG3(format, ...)    JSDRV_LOG(JSDRV_LOG_LEVEL_DEBUG3,  format, __VA_ARGS__)
+/** Log a rate-limited error using printf-style arguments. */
+#define JSDRV_LOGE_RATE(format, ...)     JSDRV_LOG_RATE(JSDRV_LOG_LEVEL_ERROR, format, __VA_ARGS__)
+/** Log a rate-limited warning using printf-style arguments. */
+#define JSDRV_LOGW_RATE(format, ...)     JSDRV_LOG_RATE(JSDRV_LOG_LEVEL_WARNING, format, __VA_ARGS__)
+/** Log a rate-limited informative message using printf-style arguments. */
+#define JSDRV_LOGI_RATE(format, ...)     JSDRV_LOG_RATE(JSDRV_LOG_LEVEL_INFO, format, __VA_ARGS__)
+/** Log a rate-limited detailed debug message using printf-style arguments. */
+#define JSDRV_LOGD1_RATE(format, ...)    JSDRV_LOG_RATE(JSDRV_LOG_LEVEL_DEBUG1, format, __VA_ARGS__)
 
 #else
 /* GCC compiler support */
@@ -179,6 +290,9 @@ extern char const jsdrv_log_level_char[JSDRV_LOG_LEVEL_ALL + 1];
 #define _JSDRV_LOG_1(level, message) JSDRV_LOG(level, "%s", message)
 #define _JSDRV_LOG_N(level, format, ...) JSDRV_LOG(level, format, __VA_ARGS__)
 #define _JSDRV_LOG_DISPATCH(level, ...)  _JSDRV_LOG_SELECT(_JSDRV_LOG, __VA_ARGS__, N, N, N, N, N, N, N, N, N, N, 1, 0)(level, __VA_ARGS__)
+#define _JSDRV_LOG_RATE_1(level, message) JSDRV_LOG_RATE(level, "%s", message)
+#define _JSDRV_LOG_RATE_N(level, format, ...) JSDRV_LOG_RATE(level, format, __VA_ARGS__)
+#define _JSDRV_LOG_RATE_DISPATCH(level, ...)  _JSDRV_LOG_SELECT(_JSDRV_LOG_RATE, __VA_ARGS__, N, N, N, N, N, N, N, N, N, N, 1, 0)(level, __VA_ARGS__)
 
 /** Log a emergency using printf-style arguments. */
 #define JSDRV_LOG_EMERGENCY(...)  _JSDRV_LOG_DISPATCH(JSDRV_LOG_LEVEL_EMERGENCY, __VA_ARGS__)
@@ -200,6 +314,14 @@ extern char const jsdrv_log_level_char[JSDRV_LOG_LEVEL_ALL + 1];
 #define JSDRV_LOG_DEBUG2(...)    _JSDRV_LOG_DISPATCH(JSDRV_LOG_LEVEL_DEBUG2,  __VA_ARGS__)
 /** Log an insanely detailed debug message using printf-style arguments. */
 #define JSDRV_LOG_DEBUG3(...)    _JSDRV_LOG_DISPATCH(JSDRV_LOG_LEVEL_DEBUG3,  __VA_ARGS__)
+/** Log a rate-limited error using printf-style arguments. */
+#define JSDRV_LOGE_RATE(...)     _JSDRV_LOG_RATE_DISPATCH(JSDRV_LOG_LEVEL_ERROR, __VA_ARGS__)
+/** Log a rate-limited warning using printf-style arguments. */
+#define JSDRV_LOGW_RATE(...)     _JSDRV_LOG_RATE_DISPATCH(JSDRV_LOG_LEVEL_WARNING, __VA_ARGS__)
+/** Log a rate-limited informative message using printf-style arguments. */
+#define JSDRV_LOGI_RATE(...)     _JSDRV_LOG_RATE_DISPATCH(JSDRV_LOG_LEVEL_INFO, __VA_ARGS__)
+/** Log a rate-limited detailed debug message using printf-style arguments. */
+#define JSDRV_LOGD1_RATE(...)    _JSDRV_LOG_RATE_DISPATCH(JSDRV_LOG_LEVEL_DEBUG1, __VA_ARGS__)
 #endif
 
 /** Log an error using printf-style arguments.  Alias for JSDRV_LOG_ERROR. */
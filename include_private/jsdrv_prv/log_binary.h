@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Binary log ring file writer.
+ */
+
+#ifndef JSDRV_PRV_LOG_BINARY_H_
+#define JSDRV_PRV_LOG_BINARY_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+// Forward declarations from "jsdrv/log.h"
+struct jsdrv_log_header_s;
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_log_binary Binary log ring file
+ *
+ * @brief Write log records into a memory-mapped ring file.
+ *
+ * See jsdrv_log_binary_header_s and jsdrv_log_binary_record_s for
+ * the file format.  The writer is not thread-safe.  The log thread
+ * is the only writer.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The opaque binary log file instance.
+struct jsdrv_log_binary_s;
+
+/**
+ * @brief Create a binary log ring file.
+ *
+ * @param path The file path, which is overwritten.
+ * @param size The total file size in bytes, at least 4096.
+ * @param[out] self The new instance.
+ * @return 0 or error code.
+ */
+int32_t jsdrv_log_binary_file_open(const char * path, uint64_t size, struct jsdrv_log_binary_s ** self);
+
+/**
+ * @brief Write a log record, overwriting the oldest records as needed.
+ *
+ * @param self The instance.
+ * @param header The log record header.
+ * @param filename The log record filename.
+ * @param message The log message, truncated to fit a quarter of the ring.
+ */
+void jsdrv_log_binary_file_write(struct jsdrv_log_binary_s * self, struct jsdrv_log_header_s const * header,
+                                 const char * filename, const char * message);
+
+/**
+ * @brief Close a binary log ring file.
+ *
+ * @param self The instance, which may be NULL.
+ */
+void jsdrv_log_binary_file_close(struct jsdrv_log_binary_s * self);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_LOG_BINARY_H_ */
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Compiled metadata validation.
+ */
+
+#ifndef JSDRV_PRV_META_H_
+#define JSDRV_PRV_META_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv/union.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_meta Compiled metadata
+ *
+ * @brief Validate values without parsing the metadata JSON each time.
+ *
+ * jsdrv_meta_value() parses the whole metadata JSON string for every
+ * value.  PubSub instead compiles the metadata once when it is
+ * published.  The compiled validator holds the dtype and a flat
+ * options table with copies of each option's values, names, and
+ * aliases, so validation only converts and compares the value.
+ * Validation matches jsdrv_meta_value() for the same metadata.
+ *
+ * Static parameter tables use JSDRV_META() to produce the JSON
+ * metadata together with a binary default value from the same
+ * dtype and default tokens at compile time, so device drivers
+ * initialize their parameters without parsing the JSON.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+#define JSDRV_META_DTYPE_bool   JSDRV_UNION_U8
+#define JSDRV_META_DTYPE_u8     JSDRV_UNION_U8
+#define JSDRV_META_DTYPE_u16    JSDRV_UNION_U16
+#define JSDRV_META_DTYPE_u32    JSDRV_UNION_U32
+#define JSDRV_META_DTYPE_u64    JSDRV_UNION_U64
+#define JSDRV_META_DTYPE_i8     JSDRV_UNION_I8
+#define JSDRV_META_DTYPE_i16    JSDRV_UNION_I16
+#define JSDRV_META_DTYPE_i32    JSDRV_UNION_I32
+#define JSDRV_META_DTYPE_i64    JSDRV_UNION_I64
+
+#define JSDRV_META_FIELD_bool   u8
+#define JSDRV_META_FIELD_u8     u8
+#define JSDRV_META_FIELD_u16    u16
+#define JSDRV_META_FIELD_u32    u32
+#define JSDRV_META_FIELD_u64    u64
+#define JSDRV_META_FIELD_i8     i8
+#define JSDRV_META_FIELD_i16    i16
+#define JSDRV_META_FIELD_i32    i32
+#define JSDRV_META_FIELD_i64    i64
+
+/**
+ * @brief Define static metadata with its default value.
+ *
+ * @param dtype_ The bare dtype token: bool, u8, u16, u32, u64, i8, i16, i32, or i64.
+ * @param default_ The default value as an integer literal.
+ * @param fields_ The remaining JSON object fields as a string literal,
+ *      such as brief and options, without the braces.
+ *
+ * Expands to two initializers: the JSON metadata string, which starts
+ * with the dtype and default fields, then the jsdrv_union_s default
+ * value with JSDRV_UNION_FLAG_RETAIN, which matches
+ * jsdrv_meta_default() for that string.
+ */
+#define JSDRV_META(dtype_, default_, fields_)                                       \
+    "{\"dtype\": \"" #dtype_ "\", \"default\": " #default_ ", " fields_ "}",         \
+    {.type = JSDRV_META_DTYPE_##dtype_, .op = 0, .flags = JSDRV_UNION_FLAG_RETAIN,    \
+     .app = 0, .value = {.JSDRV_META_FIELD_##dtype_ = (default_)}, .size = 0}
+
+/// The opaque compiled validator.
+struct jsdrv_meta_validator_s;
+
+/**
+ * @brief Compile metadata into a validator.
+ *
+ * @param meta The JSON metadata.
+ * @return The new validator, or NULL if meta is NULL.  When the
+ *      metadata is invalid, the validator rejects all values with
+ *      the compile error code.
+ */
+struct jsdrv_meta_validator_s * jsdrv_meta_validator_compile(const char * meta);
+
+/**
+ * @brief Free a validator.
+ *
+ * @param self The validator, which may be NULL.
+ */
+void jsdrv_meta_validator_free(struct jsdrv_meta_validator_s * self);
+
+/**
+ * @brief Validate a parameter value.
+ *
+ * @param self The validator.
+ * @param[inout] value The value, which is modified in place.
+ * @return 0 or error code.
+ */
+int32_t jsdrv_meta_validator_value(const struct jsdrv_meta_validator_s * self, struct jsdrv_union_s * value);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_META_H_ */
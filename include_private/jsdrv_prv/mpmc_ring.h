@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Bounded, lock-free multiple-producer multiple-consumer pointer ring.
+ */
+
+#ifndef JSDRV_PRV_MPMC_RING_H_
+#define JSDRV_PRV_MPMC_RING_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_mpmc_ring Lock-free pointer ring
+ *
+ * @brief Bounded, lock-free multiple-producer multiple-consumer pointer ring.
+ *
+ * This ring uses the per-cell sequence number algorithm by Dmitry Vyukov.
+ * Producers and consumers each claim a cell with a single compare-and-swap,
+ * so the ring never blocks.  The same implementation serves
+ * single-producer and single-consumer use without modification.
+ * Push fails when the ring is full, and the caller is responsible
+ * for any overflow handling.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The opaque ring instance.
+struct jsdrv_mpmc_ring_s;
+
+/**
+ * @brief Allocate a new ring.
+ *
+ * @param capacity The maximum number of pointers, which must be a power of 2.
+ * @return The new ring instance or NULL.
+ */
+struct jsdrv_mpmc_ring_s * jsdrv_mpmc_ring_alloc(uint32_t capacity);
+
+/**
+ * @brief Free a ring.
+ *
+ * @param self The ring instance.  The caller must empty the ring first.
+ */
+void jsdrv_mpmc_ring_free(struct jsdrv_mpmc_ring_s * self);
+
+/**
+ * @brief Add a pointer to the ring tail.
+ *
+ * @param self The ring instance.
+ * @param ptr The pointer to add.
+ * @return true on success, false if full.
+ */
+bool jsdrv_mpmc_ring_push(struct jsdrv_mpmc_ring_s * self, void * ptr);
+
+/**
+ * @brief Remove a pointer from the ring head.
+ *
+ * @param self The ring instance.
+ * @return The pointer or NULL if empty.
+ */
+void * jsdrv_mpmc_ring_pop(struct jsdrv_mpmc_ring_s * self);
+
+/**
+ * @brief Check for an empty ring.
+ *
+ * @param self The ring instance.
+ * @return true if empty at the instant of the call.
+ */
+bool jsdrv_mpmc_ring_is_empty(struct jsdrv_mpmc_ring_s * self);
+
+/**
+ * @brief Get the approximate number of pointers in the ring.
+ *
+ * @param self The ring instance.
+ * @return The number of claimed cells at the instant of the call, which
+ *      may include pushes and pops still in progress.
+ */
+uint32_t jsdrv_mpmc_ring_count(struct jsdrv_mpmc_ring_s * self);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_MPMC_RING_H_ */
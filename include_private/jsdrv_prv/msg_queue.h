@@ -36,22 +36,66 @@
 
 JSDRV_CPP_GUARD_START
 
+/// The msg_queue_pop() timeout_ms that waits until a message arrives.
+#define MSG_QUEUE_TIMEOUT_FOREVER (UINT32_MAX)
+
+/// The recommended msg_queue_pop_n() batch size for consumer threads.
+#define MSG_QUEUE_BATCH_SIZE (64U)
+
 // opaque handle
 struct msg_queue_s;
 
 // forward declaration for "jsdrv/frontend.h"
 struct jsdrvp_msg_s;
 
+// forward declaration for "jsdrv_prv/list.h"
+struct jsdrv_list_s;
+
+/**
+ * @brief The function called to report the depth of one queue.
+ *
+ * @param user_data The arbitrary user data.
+ * @param name The queue name.
+ * @param depth The number of messages in the queue.
+ */
+typedef void (*msg_queue_depth_fn)(void * user_data, const char * name, uint32_t depth);
+
 struct msg_queue_s * msg_queue_init(void);
 
 void msg_queue_finalize(struct msg_queue_s * queue);
 
 bool msg_queue_is_empty(struct msg_queue_s* queue);
 
+uint32_t msg_queue_depth(struct msg_queue_s* queue);
+
 void msg_queue_push(struct msg_queue_s * queue, struct jsdrvp_msg_s * msg);
 
 struct jsdrvp_msg_s * msg_queue_pop_immediate(struct msg_queue_s* queue);
 
+/**
+ * @brief Pop up to n messages without waiting.
+ *
+ * @param queue The queue instance.
+ * @param[out] msgs The array for the popped messages in FIFO order.
+ * @param n The maximum number of messages to pop.
+ * @return The number of messages written to msgs.
+ *
+ * Overflow messages are removed with a single lock acquisition, and the
+ * event is only rearmed when the queue is drained.  Like
+ * msg_queue_pop_immediate(), call until this function returns 0.
+ */
+uint32_t msg_queue_pop_n(struct msg_queue_s * queue, struct jsdrvp_msg_s ** msgs, uint32_t n);
+
+/**
+ * @brief Pop all pending messages without waiting.
+ *
+ * @param queue The queue instance.
+ * @param list The list that receives the messages at its tail in FIFO
+ *      order using jsdrvp_msg_s.item.
+ * @return The number of messages added to list.
+ */
+uint32_t msg_queue_pop_all(struct msg_queue_s * queue, struct jsdrv_list_s * list);
+
 int32_t msg_queue_pop(struct msg_queue_s* queue, struct jsdrvp_msg_s ** msg, uint32_t timeout_ms);
 
 msg_handle msg_queue_handle_get(struct msg_queue_s* queue);
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Pack u8 sample values into u4 and u1 stream data.
+ */
+
+#ifndef JSDRV_PRV_PACK_H_
+#define JSDRV_PRV_PACK_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_pack Sample packing
+ *
+ * @brief Pack one value per byte into the stream data u4 and u1 formats.
+ *
+ * The stream data formats store the first sample in the least
+ * significant bits of each byte.  The packers use the SIMD instruction
+ * set selected by jsdrv_f32_ops_isa().
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/**
+ * @brief Pack values into 4-bit nibbles.
+ *
+ * @param dst The output, which starts on a byte boundary.
+ * @param src The values.  Only the lower 4 bits are used.
+ * @param n The number of values.  When odd, the last byte has its
+ *      upper nibble cleared.
+ */
+void jsdrv_pack_u4(uint8_t * dst, const uint8_t * src, uint32_t n);
+
+/**
+ * @brief Pack values into bits.
+ *
+ * @param dst The output, which starts on a byte boundary.
+ * @param src The values.  Only the least significant bit is used.
+ * @param n The number of values.  The unused upper bits of the last
+ *      byte are cleared.
+ */
+void jsdrv_pack_u1(uint8_t * dst, const uint8_t * src, uint32_t n);
+
+/**
+ * @brief Select every Nth value.
+ *
+ * @param dst The output with (n + stride - 1) / stride values.
+ * @param src The values.
+ * @param n The number of values in src.
+ * @param stride The selection stride, which must be at least 1.
+ * @return The number of values written to dst.
+ */
+uint32_t jsdrv_pack_select_u8(uint8_t * dst, const uint8_t * src, uint32_t n, uint32_t stride);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_PACK_H_ */
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Large page and NUMA aware allocation.
+ */
+
+#ifndef JSDRV_PRV_PAGE_ALLOC_H_
+#define JSDRV_PRV_PAGE_ALLOC_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_page_alloc Page allocation
+ *
+ * @brief Allocate large buffers directly from the operating system.
+ *
+ * Multi-gigabyte buffers on small pages spend much of their access time
+ * on TLB misses.  These functions allocate from the operating system
+ * with optional huge pages and an optional NUMA node.  Any option the
+ * operating system rejects falls back to the next best allocation, so
+ * allocation only fails when memory is exhausted.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The allocation page modes.
+enum jsdrv_page_mode_e {
+    /// The default heap, like jsdrv_alloc().
+    JSDRV_PAGE_MODE_DEFAULT = 0,
+    /// Transparent huge pages when available (Linux MADV_HUGEPAGE).
+    JSDRV_PAGE_MODE_HUGE = 1,
+    /// Reserved huge pages (Linux MAP_HUGETLB, Windows MEM_LARGE_PAGES),
+    /// falling back to JSDRV_PAGE_MODE_HUGE.
+    JSDRV_PAGE_MODE_LARGE = 2,
+};
+
+/// No NUMA node binding, so pages land on the node of the first writer.
+#define JSDRV_PAGE_NUMA_NODE_ANY (-1)
+
+/**
+ * @brief Allocate memory.
+ *
+ * @param size_bytes The number of bytes to allocate.
+ * @param mode The jsdrv_page_mode_e.
+ * @param numa_node The preferred NUMA node or JSDRV_PAGE_NUMA_NODE_ANY.
+ * @return The memory, aligned like jsdrv_alloc(), which the caller
+ *      must release with jsdrv_page_free().  This function
+ *      calls JSDRV_FATAL when out of memory.
+ */
+void * jsdrv_page_alloc(uint64_t size_bytes, uint8_t mode, int32_t numa_node);
+
+/**
+ * @brief Free memory from jsdrv_page_alloc().
+ *
+ * @param ptr The memory, which may be NULL.
+ */
+void jsdrv_page_free(void * ptr);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_PAGE_ALLOC_H_ */
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Cached device parameter state for fast reopen.
+ */
+
+#ifndef JSDRV_PRV_PARAM_CACHE_H_
+#define JSDRV_PRV_PARAM_CACHE_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_param_cache Device parameter cache
+ *
+ * @brief Remember each device's parameter state across reopen.
+ *
+ * A USB reset removes and adds the device, which frees the device
+ * driver instance.  Reopening then re-queries all metadata and values
+ * from the instrument, which takes hundreds of milliseconds.  The
+ * frontend owns one cache for the driver context with an entry for
+ * each device prefix that persists until the context finalizes.
+ *
+ * The device driver keys the entry to its firmware version with
+ * jsdrv_param_cache_resume().  When the version matches a previously
+ * completed open, the metadata retained in pubsub is still valid, so
+ * the driver skips the metadata query.  The driver records the
+ * instrument values with jsdrv_param_cache_update(), which reports
+ * the values that changed since the previous open.  The
+ * order-independent jsdrv_param_cache_hash() verifies the complete
+ * state in a single comparison.
+ *
+ * jsdrv_param_cache_device() is thread-safe.  Each entry must only be
+ * used by one device thread at a time.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+struct jsdrv_union_s;
+
+/// The opaque cache for all devices.
+struct jsdrv_param_cache_s;
+
+/// The opaque cache entry for a single device.
+struct jsdrv_param_cache_device_s;
+
+/**
+ * @brief Allocate a new cache.
+ *
+ * @return The new cache instance.
+ */
+struct jsdrv_param_cache_s * jsdrv_param_cache_new(void);
+
+/**
+ * @brief Free a cache and all of its device entries.
+ *
+ * @param self The cache instance.
+ */
+void jsdrv_param_cache_free(struct jsdrv_param_cache_s * self);
+
+/**
+ * @brief Get the entry for a device, allocating it when needed.
+ *
+ * @param self The cache instance.
+ * @param prefix The device prefix, such as "u/js220/000415".
+ * @return The device entry, which remains valid until
+ *      jsdrv_param_cache_free().
+ */
+struct jsdrv_param_cache_device_s * jsdrv_param_cache_device(struct jsdrv_param_cache_s * self, const char * prefix);
+
+/**
+ * @brief Start a reopen.
+ *
+ * @param self The device entry.
+ * @param version The device version key, such as the firmware and
+ *      FPGA versions.
+ * @return True when a previous open with the same version completed,
+ *      so the cached state is valid.  False when the entry was cleared
+ *      and now tracks version.
+ */
+bool jsdrv_param_cache_resume(struct jsdrv_param_cache_device_s * self, uint64_t version);
+
+/**
+ * @brief Mark the cached state as valid after a completed open.
+ *
+ * @param self The device entry.
+ */
+void jsdrv_param_cache_commit(struct jsdrv_param_cache_device_s * self);
+
+/**
+ * @brief Invalidate the cached state, such as for a firmware update.
+ *
+ * @param self The device entry.
+ */
+void jsdrv_param_cache_invalidate(struct jsdrv_param_cache_device_s * self);
+
+/**
+ * @brief Record a parameter value.
+ *
+ * @param self The device entry.
+ * @param topic The device subtopic, such as "s/i/range/select".
+ * @param value The value.  String, JSON and binary values are copied.
+ * @return True when the topic is new or its value changed.
+ */
+bool jsdrv_param_cache_update(struct jsdrv_param_cache_device_s * self, const char * topic,
+                              const struct jsdrv_union_s * value);
+
+/**
+ * @brief Get the order-independent hash of all cached values.
+ *
+ * @param self The device entry.
+ * @return The hash, which is 0 when empty.
+ */
+uint64_t jsdrv_param_cache_hash(const struct jsdrv_param_cache_device_s * self);
+
+/**
+ * @brief Get the number of cached values.
+ *
+ * @param self The device entry.
+ * @return The number of topics with cached values.
+ */
+uint32_t jsdrv_param_cache_size(const struct jsdrv_param_cache_device_s * self);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_PARAM_CACHE_H_ */
@@ -95,7 +95,8 @@ JSDRV_INLINE_FN void jsdrv_memcpy(void * destination, void const * source, size_
 }
 
 /**
- * \brief Function to deallocate memory provided by jsdrv_alloc() or jsdrv_alloc_clr().
+ * \brief Function to deallocate memory provided by jsdrv_alloc(), jsdrv_alloc_clr(),
+ *      or jsdrv_alloc_aligned().
  *
  * \param ptr The pointer to the memory to free.
  */
@@ -113,6 +114,22 @@ void jsdrv_free(void * ptr);
  */
 JSDRV_COMPILER_ALLOC(jsdrv_free) void * jsdrv_alloc(size_t size_bytes);
 
+/// The alignment for sample data, which suits cache lines and SIMD loads.
+#define JSDRV_ALLOC_ALIGNMENT (64U)
+
+/**
+ * @brief Allocate aligned memory from the heap.
+ *
+ * @param size_bytes The number of total_bytes to allocate.
+ * @param alignment The power of 2 alignment in bytes, such as
+ *      JSDRV_ALLOC_ALIGNMENT.
+ * @return The pointer to the allocated memory.
+ *
+ * This function will assert on out of memory conditions.
+ * Use jsdrv_free() to return the memory to the heap.
+ */
+JSDRV_COMPILER_ALLOC(jsdrv_free) void * jsdrv_alloc_aligned(size_t size_bytes, size_t alignment);
+
 /**
  * @brief Allocate memory from the heap and clear to 0.
  *
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Host-side power computation from current and voltage blocks.
+ */
+
+#ifndef JSDRV_PRV_POWER_F32_H_
+#define JSDRV_PRV_POWER_F32_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_power_f32 Host-side power
+ *
+ * @brief Pair current and voltage samples by sample_id to compute power.
+ *
+ * Current and voltage arrive as separate blocks, usually interleaved.
+ * Each side holds its samples that are still waiting for the other
+ * side in a linear buffer.  The caller writes each new block directly
+ * into the buffer using jsdrv_power_f32_reserve() and
+ * jsdrv_power_f32_commit(), then computes all aligned power samples
+ * into its output block using jsdrv_power_f32_mult().
+ *
+ * A gap between blocks on one side is filled with NaN, so the
+ * power samples over the gap are also NaN.  Samples on one side that
+ * precede the first sample on the other side are discarded.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The maximum number of samples held for each side, which holds one side of a 32 kB batch.
+#define JSDRV_POWER_F32_LENGTH (8192U)
+
+/// The jsdrv_power_f32_reserve() side for current.
+#define JSDRV_POWER_F32_CURRENT (0U)
+/// The jsdrv_power_f32_reserve() side for voltage.
+#define JSDRV_POWER_F32_VOLTAGE (1U)
+
+/// The samples for one side.
+struct jsdrv_power_f32_side_s {
+    uint64_t sample_id;     ///< The sample_id for data[offset], UINT64_MAX when unsynchronized.
+    uint32_t offset;        ///< The index of the oldest sample.
+    uint32_t length;        ///< The number of samples.
+    float data[JSDRV_POWER_F32_LENGTH];
+};
+
+/// The power instance.
+struct jsdrv_power_f32_s {
+    uint32_t sample_id_decimate;            ///< The sample_id increment per sample.
+    struct jsdrv_power_f32_side_s side[2];  ///< Indexed by JSDRV_POWER_F32_CURRENT or VOLTAGE.
+};
+
+/**
+ * @brief Clear the instance.
+ *
+ * @param self The instance.
+ * @param sample_id_decimate The sample_id increment per sample.
+ */
+void jsdrv_power_f32_clear(struct jsdrv_power_f32_s * self, uint32_t sample_id_decimate);
+
+/**
+ * @brief Reserve space for a new block.
+ *
+ * @param self The instance.
+ * @param side The JSDRV_POWER_F32_CURRENT or JSDRV_POWER_F32_VOLTAGE side.
+ * @param sample_id The sample_id for the first sample in the block.
+ * @param length The number of samples in the block.
+ * @return The location for the caller to write length samples,
+ *      or NULL if length exceeds JSDRV_POWER_F32_LENGTH.
+ *
+ * This function fills any gap from the previous block with NaN and
+ * discards the oldest unpaired samples as needed to make space.
+ * Call jsdrv_power_f32_commit() after writing the samples.
+ */
+float * jsdrv_power_f32_reserve(struct jsdrv_power_f32_s * self, uint8_t side, uint64_t sample_id, uint32_t length);
+
+/**
+ * @brief Commit samples written to jsdrv_power_f32_reserve().
+ *
+ * @param self The instance.
+ * @param side The JSDRV_POWER_F32_CURRENT or JSDRV_POWER_F32_VOLTAGE side.
+ * @param length The number of samples written, which must not exceed
+ *      the reserved length.
+ */
+void jsdrv_power_f32_commit(struct jsdrv_power_f32_s * self, uint8_t side, uint32_t length);
+
+/**
+ * @brief Add a block by copy.
+ *
+ * @param self The instance.
+ * @param side The JSDRV_POWER_F32_CURRENT or JSDRV_POWER_F32_VOLTAGE side.
+ * @param sample_id The sample_id for data[0].
+ * @param data The samples.
+ * @param length The number of samples.
+ */
+void jsdrv_power_f32_add(struct jsdrv_power_f32_s * self, uint8_t side, uint64_t sample_id,
+                         const float * data, uint32_t length);
+
+/**
+ * @brief Get the power samples available.
+ *
+ * @param self The instance.
+ * @param[out] sample_id The sample_id for the first available power sample.
+ * @return The number of available aligned power samples.
+ */
+uint32_t jsdrv_power_f32_available(struct jsdrv_power_f32_s * self, uint64_t * sample_id);
+
+/**
+ * @brief Get the aligned samples for one side.
+ *
+ * @param self The instance.
+ * @param side The JSDRV_POWER_F32_CURRENT or JSDRV_POWER_F32_VOLTAGE side.
+ * @return The samples starting at the jsdrv_power_f32_available()
+ *      sample_id.  The samples remain valid through the next
+ *      jsdrv_power_f32_mult(), so callers can process the current,
+ *      voltage, and power together, until the next reserve or add.
+ */
+const float * jsdrv_power_f32_peek(struct jsdrv_power_f32_s * self, uint8_t side);
+
+/**
+ * @brief Compute and consume power samples.
+ *
+ * @param self The instance.
+ * @param[out] p The output power samples, p[k] = i[k] * v[k],
+ *      starting at the jsdrv_power_f32_available() sample_id.
+ * @param length The maximum number of samples to write to p.
+ * @return The number of samples written to p.
+ */
+uint32_t jsdrv_power_f32_mult(struct jsdrv_power_f32_s * self, float * p, uint32_t length);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_POWER_F32_H_ */
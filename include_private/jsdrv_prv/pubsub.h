@@ -57,12 +57,32 @@ JSDRV_CPP_GUARD_START
 #define JSDRV_PUBSUB_UNSUBSCRIBE_ALL  "_/!unsub+"
 #define JSDRV_PUBSUB_QUERY            "_/!query"
 
+/**
+ * @brief Watch the subscriber count for a topic.
+ *
+ * The message payload is jsdrvp_payload_subscribe_s with an internal
+ * subscriber, the watcher.  Whenever the number of other subscribers that
+ * receive values published to the topic changes, including subscribers to
+ * parent topics and matching wildcards, pubsub calls the watcher with a
+ * message for the watched topic.  The message value is the u32 count with
+ * app JSDRV_PAYLOAD_TYPE_WATCH.  The first report follows the watch.
+ * Unsubscribing the watcher from a topic also removes its watches at and
+ * below that topic.
+ */
+#define JSDRV_PUBSUB_WATCH            "_/!watch"
+#define JSDRV_PUBSUB_UNWATCH          "_/!unwatch"
+
 /// The opaque PubSub instance.
 struct jsdrv_pubsub_s;
 
 // Forward declarations from "jsdrv.h"
 struct jsdrvp_msg_s;
 struct jsdrv_context_s;
+struct jsdrv_dispatch_s;
+struct jsdrv_dispatch_queue_s;
+
+/// The opaque coalesced subscriber state.
+struct jsdrv_pubsub_coalesce_s;
 
 /**
  * @brief Function called on topic updates.
@@ -94,6 +114,11 @@ struct jsdrv_pubsub_subscriber_s {
     void * user_data;
     uint8_t is_internal;
     uint8_t flags;          ///< jsdrv_subscribe_flag_e
+    uint8_t queue_policy;   ///< jsdrv_queue_policy_e for external subscribers
+    uint32_t queue_depth;   ///< The queue_policy limit
+    struct jsdrv_dispatch_queue_s * queue;  ///< Owned by pubsub, created on subscribe
+    uint32_t coalesce_ms;   ///< Minimum interval between published values, 0 to disable
+    struct jsdrv_pubsub_coalesce_s * coalesce;  ///< Owned by pubsub, created on subscribe
 };
 
 struct jsdrv_pubsub_subscriber_internal_s {
@@ -115,6 +140,55 @@ struct jsdrv_pubsub_s * jsdrv_pubsub_initialize(struct jsdrv_context_s * context
  */
 void jsdrv_pubsub_finalize(struct jsdrv_pubsub_s * self);
 
+/**
+ * @brief Set the data dispatch workers.
+ *
+ * @param self The PubSub instance.
+ * @param dispatch The dispatch instance for data messages to external
+ *      subscribers, or NULL to invoke all subscribers directly.
+ */
+void jsdrv_pubsub_dispatch_set(struct jsdrv_pubsub_s * self, struct jsdrv_dispatch_s * dispatch);
+
+/**
+ * @brief Resolve a topic name to a numeric topic ID.
+ *
+ * @param self The PubSub instance.
+ * @param topic The full topic name.
+ * @return The nonzero topic ID or 0 on failure.
+ *
+ * Interning the same topic always returns the same ID.  IDs remain
+ * valid until jsdrv_pubsub_finalize().  This function is thread-safe
+ * so that device threads can resolve streaming topics once, then
+ * send messages with jsdrvp_msg_s.topic_id instead of formatting
+ * the topic string for each message.
+ */
+uint32_t jsdrv_pubsub_topic_intern(struct jsdrv_pubsub_s * self, const char * topic);
+
+/**
+ * @brief Get the topic name for a topic ID.
+ *
+ * @param self The PubSub instance.
+ * @param topic_id The topic ID from jsdrv_pubsub_topic_intern().
+ * @return The full topic name or NULL if invalid.
+ *
+ * This function is thread-safe.
+ */
+const char * jsdrv_pubsub_topic_name(struct jsdrv_pubsub_s * self, uint32_t topic_id);
+
+/**
+ * @brief Query a retained value without the pubsub thread.
+ *
+ * @param self The PubSub instance.
+ * @param topic The full topic name.
+ * @param[inout] value The value, with the same buffer semantics as jsdrv_query().
+ * @return 0 or error code.  JSDRV_ERROR_NOT_FOUND means the value is not
+ *      available without the pubsub thread, not that the topic does not exist.
+ *
+ * This function is thread-safe.  It reflects all messages that
+ * jsdrv_pubsub_process() has completed.
+ */
+int32_t jsdrv_pubsub_query_snapshot(struct jsdrv_pubsub_s * self, const char * topic, struct jsdrv_union_s * value);
+
 /**
  * @brief Publish to a topic.
  *
@@ -136,6 +210,36 @@ int32_t jsdrv_pubsub_publish(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s *
  */
 void jsdrv_pubsub_process(struct jsdrv_pubsub_s * self);
 
+/**
+ * @brief Get the duration until the next coalesced value is due.
+ *
+ * @param self The PubSub instance.
+ * @return The milliseconds until jsdrv_pubsub_process() must run again
+ *      to deliver pending coalesced values, or UINT32_MAX if none are pending.
+ */
+uint32_t jsdrv_pubsub_timeout_ms(struct jsdrv_pubsub_s * self);
+
+/**
+ * @brief Enable or disable per-topic statistics.
+ *
+ * @param self The PubSub instance.
+ * @param enable True to count messages, bytes, and the time spent
+ *      delivering to subscribers for each topic.  Enabling resets
+ *      all counters.
+ */
+void jsdrv_pubsub_stats_enable(struct jsdrv_pubsub_s * self, bool enable);
+
+/**
+ * @brief Format and reset the per-topic statistics.
+ *
+ * @param self The PubSub instance.
+ * @param buf The output buffer for the JSON list, sorted by
+ *      total subscriber delivery time, most time first.
+ * @param size The size of buf in bytes.
+ * @return The number of topics in buf.
+ */
+uint32_t jsdrv_pubsub_stats(struct jsdrv_pubsub_s * self, char * buf, uint32_t size);
+
 JSDRV_CPP_GUARD_END
 
 /** @} */
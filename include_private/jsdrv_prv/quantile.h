@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Mergeable quantile sketch.
+ */
+
+#ifndef JSDRV_PRV_QUANTILE_H_
+#define JSDRV_PRV_QUANTILE_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_quantile Quantile sketch
+ *
+ * @brief Estimate quantiles with fixed log-spaced bins.
+ *
+ * Each bin covers 1 / 2**#JSDRV_QUANTILE_MANTISSA_BITS of an octave.
+ * The bin index comes directly from the float32 exponent and leading
+ * mantissa bits, so adding a sample needs no logarithm.  Estimates
+ * are within 2**-(#JSDRV_QUANTILE_MANTISSA_BITS + 1) relative error
+ * for magnitudes from 2**#JSDRV_QUANTILE_EXP_MIN to
+ * 2**#JSDRV_QUANTILE_EXP_MAX.  Smaller magnitudes count as 0, and
+ * larger magnitudes count in the outermost bins.
+ *
+ * Sketches with the same bins merge exactly by adding counts, so
+ * sketches for short windows combine into longer windows or across
+ * devices without revisiting samples.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The mantissa bits for each bin, which sets the relative error.
+#define JSDRV_QUANTILE_MANTISSA_BITS (5)
+/// The smallest nonzero magnitude exponent, 2**-40 is about 1e-12.
+#define JSDRV_QUANTILE_EXP_MIN (-40)
+/// The largest magnitude exponent, exclusive.
+#define JSDRV_QUANTILE_EXP_MAX (16)
+/// The number of bins for each sign.
+#define JSDRV_QUANTILE_BINS_PER_SIGN ((JSDRV_QUANTILE_EXP_MAX - JSDRV_QUANTILE_EXP_MIN) << JSDRV_QUANTILE_MANTISSA_BITS)
+/// The total bins: negative magnitudes descending, zero, positive magnitudes ascending.
+#define JSDRV_QUANTILE_BINS (2 * JSDRV_QUANTILE_BINS_PER_SIGN + 1)
+
+/// The quantile sketch.
+struct jsdrv_quantile_s {
+    uint64_t count;                         ///< The number of samples, excluding NaN.
+    float min;                              ///< The minimum sample.
+    float max;                              ///< The maximum sample.
+    uint32_t bins[JSDRV_QUANTILE_BINS];     ///< The sample count for each bin.
+};
+
+/**
+ * @brief Clear a sketch.
+ *
+ * @param self The sketch.
+ */
+void jsdrv_quantile_clear(struct jsdrv_quantile_s * self);
+
+/**
+ * @brief Add a block of samples.
+ *
+ * @param self The sketch.
+ * @param x The samples.  NaN samples are skipped.
+ * @param n The number of samples in x.
+ */
+void jsdrv_quantile_add_f32(struct jsdrv_quantile_s * self, const float * x, uint32_t n);
+
+/**
+ * @brief Merge a sketch into another.
+ *
+ * @param self The sketch to update.
+ * @param other The sketch to add to self.
+ */
+void jsdrv_quantile_merge(struct jsdrv_quantile_s * self, const struct jsdrv_quantile_s * other);
+
+/**
+ * @brief Estimate a quantile.
+ *
+ * @param self The sketch.
+ * @param q The quantile from 0 to 1, such as 0.99.
+ * @return The estimate, clamped to the sample range, or NaN when
+ *      the sketch is empty.
+ */
+float jsdrv_quantile_value(const struct jsdrv_quantile_s * self, double q);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_QUANTILE_H_ */
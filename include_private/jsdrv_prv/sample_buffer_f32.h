@@ -75,6 +75,48 @@ uint64_t sbuf_tail_sample_id(struct sbuf_f32_s * self);
  */
 void sbuf_f32_add(struct sbuf_f32_s * self, uint64_t sample_id, float * data, uint32_t length);
 
+/**
+ * @brief Scale data into an output array and add it to the buffer.
+ *
+ * @param self The buffer instance, or NULL to only scale into dst.
+ * @param sample_id The starting sample id for data.
+ * @param dst The output samples, dst[i] = data[i] * scale.  dst may
+ *      equal data to scale in place.
+ * @param data The input data samples.
+ * @param scale The scale factor.
+ * @param length The number of data samples.
+ *
+ * This function reads data once to write both dst and the buffer.
+ * The buffer receives the same samples as sbuf_f32_add() on dst.
+ */
+void sbuf_f32_add_scale_copy(struct sbuf_f32_s * self, uint64_t sample_id,
+                             float * dst, const float * data, float scale, uint32_t length);
+
+/// Up to two contiguous regions that hold the buffer samples, oldest first.
+struct sbuf_f32_span_s {
+    const float * data[2];
+    uint32_t length[2];     ///< length[1] is 0 unless the samples wrap.
+};
+
+/**
+ * @brief Get the buffer samples as contiguous regions.
+ *
+ * @param self The buffer instance.
+ * @param[out] span The regions from tail to head, which remain valid
+ *      until the next buffer modification.
+ * @return The total number of samples, sbuf_f32_length().
+ */
+uint32_t sbuf_f32_span(struct sbuf_f32_s * self, struct sbuf_f32_span_s * span);
+
+/**
+ * @brief Copy the buffer samples, oldest first.
+ *
+ * @param self The buffer instance.
+ * @param dst The output, which must hold sbuf_f32_length() samples.
+ * @return The number of samples copied.
+ */
+uint32_t sbuf_f32_copy(struct sbuf_f32_s * self, float * dst);
+
 /**
  * @brief Advance buffer tail to the given sample id.
  *
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Lock-free snapshot of retained topic values.
+ */
+
+#ifndef JSDRV_PRV_SNAPSHOT_H_
+#define JSDRV_PRV_SNAPSHOT_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv/union.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_snapshot Retained value snapshot
+ *
+ * @brief Read retained values from any thread without the frontend.
+ *
+ * The pubsub instance is the only writer.  It mirrors each retained
+ * value into a fixed-capacity, open-addressed table whose entries
+ * never move, so readers on any thread find entries without locks.
+ * Each entry is a sequence lock: the writer makes the sequence odd,
+ * updates the value, then makes it even again.  Readers copy the
+ * value and retry when the sequence changed underneath them.
+ *
+ * Values that do not fit #JSDRV_SNAPSHOT_DATA_SIZE, such as metadata
+ * JSON, are marked absent.  Readers then fall back to the frontend
+ * query, which remains the authoritative path.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The maximum inline size for str, json, and bin values.
+#define JSDRV_SNAPSHOT_DATA_SIZE (64U)
+
+/// The opaque snapshot instance.
+struct jsdrv_snapshot_s;
+
+/**
+ * @brief Allocate a new snapshot.
+ *
+ * @param capacity The maximum number of topics, rounded up to a power of 2.
+ * @return The new instance.
+ */
+struct jsdrv_snapshot_s * jsdrv_snapshot_alloc(uint32_t capacity);
+
+/**
+ * @brief Free a snapshot.
+ *
+ * @param self The instance, which may be NULL.  No readers may remain.
+ */
+void jsdrv_snapshot_free(struct jsdrv_snapshot_s * self);
+
+/**
+ * @brief Set a topic value.
+ *
+ * @param self The instance.
+ * @param topic The full topic name.
+ * @param value The retained value, or NULL to mark the topic absent
+ *      so that readers use the frontend.
+ *
+ * Only a single thread may call this function.  When the table is full,
+ * new topics are silently not tracked, and readers use the frontend.
+ */
+void jsdrv_snapshot_set(struct jsdrv_snapshot_s * self, const char * topic, const struct jsdrv_union_s * value);
+
+/**
+ * @brief Get a topic value from any thread.
+ *
+ * @param self The instance.
+ * @param topic The full topic name.
+ * @param[inout] value The value.  For str, json, and bin values,
+ *      the caller provides the buffer in value->value.bin and its
+ *      size in value->size, same as jsdrv_query().
+ * @return 0, JSDRV_ERROR_NOT_FOUND when not available in the snapshot,
+ *      JSDRV_ERROR_TOO_SMALL, JSDRV_ERROR_SYNTAX_ERROR when the caller
+ *      did not provide a buffer for a pointer value, or
+ *      JSDRV_ERROR_BUSY when the writer kept changing the value.
+ */
+int32_t jsdrv_snapshot_get(struct jsdrv_snapshot_s * self, const char * topic, struct jsdrv_union_s * value);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_SNAPSHOT_H_ */
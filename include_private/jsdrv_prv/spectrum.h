@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Streaming spectrum analyzers.
+ */
+
+#ifndef JSDRV_PRV_SPECTRUM_H_
+#define JSDRV_PRV_SPECTRUM_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+// Forward declarations from "jsdrv.h"
+struct jsdrv_context_s;
+
+#ifndef JSDRV_SPECTRUM_COUNT_MAX
+#define JSDRV_SPECTRUM_COUNT_MAX                      8
+#endif
+
+// topics for the spectrum manager: add/remove analyzers
+#define JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD             "f/@/!add"      // u8: 1 <= id <= JSDRV_SPECTRUM_COUNT_MAX
+#define JSDRV_SPECTRUM_MGR_MSG_ACTION_REMOVE          "f/@/!remove"   // u8 id
+#define JSDRV_SPECTRUM_MGR_MSG_ACTION_LIST            "f/@/list"      // bin ro: u8[N] ids
+
+// topics per analyzer: prefix is "f/GGG/" where GGG is the analyzer id
+#define JSDRV_SPECTRUM_MSG_TOPIC                      "g/topic"       // str: float32 source data topic, "" to stop
+#define JSDRV_SPECTRUM_MSG_LENGTH                     "g/length"      // u32 FFT length, power of 2, default 1024
+#define JSDRV_SPECTRUM_MSG_OVERLAP                    "g/overlap"     // u32 segment overlap in percent, default 50
+#define JSDRV_SPECTRUM_MSG_PERIOD                     "g/period"      // u32 data milliseconds for each spectrum, default 100
+#define JSDRV_SPECTRUM_MSG_SCALE                      "g/scale"       // u32 jsdrv_spectrum_scale_e, default density
+#define JSDRV_SPECTRUM_MSG_CLEAR                      "g/!clear"      // Discard the average in progress
+#define JSDRV_SPECTRUM_MSG_DATA                       "g/!data"       // ro: jsdrv_spectrum_s
+
+JSDRV_CPP_GUARD_START
+
+/**
+ * @brief Initialize the singleton spectrum manager.
+ *
+ * @return 0 or error code.
+ */
+int32_t jsdrv_spectrum_initialize(struct jsdrv_context_s * context);
+
+/**
+ * @brief Finalize the singleton spectrum manager.
+ */
+void jsdrv_spectrum_finalize(void);
+
+JSDRV_CPP_GUARD_END
+
+#endif  /* JSDRV_PRV_SPECTRUM_H_ */
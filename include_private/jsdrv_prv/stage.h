@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ *
+ * @brief Native processing stages for stream data.
+ */
+
+#ifndef JSDRV_PRV_STAGE_H_
+#define JSDRV_PRV_STAGE_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_stage Processing stages
+ *
+ * @brief Invoke registered stages on stream blocks at the source.
+ *
+ * Device threads call jsdrv_stage_registry_process() for each stream
+ * data message before it enters the frontend queue.  Each stage whose
+ * topic matches receives the block in place, without a copy, on the
+ * device thread.  Registration is rare and protected by a mutex, but
+ * the stages run outside the mutex.  Each entry counts the calls in
+ * progress so that removal can wait until the stage is no longer in use.
+ * When no stages are registered, processing costs a single atomic load.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The maximum number of registered stages.
+#define JSDRV_STAGE_COUNT_MAX (16U)
+
+/// The opaque registry instance.
+struct jsdrv_stage_registry_s;
+
+/**
+ * @brief Allocate a new stage registry.
+ *
+ * @return The new instance.
+ */
+struct jsdrv_stage_registry_s * jsdrv_stage_registry_alloc(void);
+
+/**
+ * @brief Free a stage registry.
+ *
+ * @param self The instance, which may be NULL.  No calls to
+ *      jsdrv_stage_registry_process() may remain.
+ */
+void jsdrv_stage_registry_free(struct jsdrv_stage_registry_s * self);
+
+/**
+ * @brief Add a stage.
+ *
+ * @param self The instance.
+ * @param topic The topic or topic prefix.  The stage receives blocks for
+ *      this topic and all of its subtopics.  "" matches all topics.
+ * @param fn The stage function.
+ * @param user_data The arbitrary data for fn.
+ * @return 0, JSDRV_ERROR_PARAMETER_INVALID, JSDRV_ERROR_ALREADY_EXISTS,
+ *      or JSDRV_ERROR_FULL.
+ */
+int32_t jsdrv_stage_registry_add(struct jsdrv_stage_registry_s * self,
+        const char * topic, jsdrv_stage_fn fn, void * user_data);
+
+/**
+ * @brief Remove a stage.
+ *
+ * @param self The instance.
+ * @param topic The topic provided to jsdrv_stage_registry_add().
+ * @param fn The stage function.
+ * @param user_data The arbitrary data for fn.
+ * @return 0 or JSDRV_ERROR_NOT_FOUND.
+ *
+ * Blocks until all calls to the stage complete.  Do not call from
+ * within a stage function.
+ */
+int32_t jsdrv_stage_registry_remove(struct jsdrv_stage_registry_s * self,
+        const char * topic, jsdrv_stage_fn fn, void * user_data);
+
+/**
+ * @brief Invoke the matching stages for a stream block.
+ *
+ * @param self The instance.
+ * @param topic The full topic for the block.
+ * @param block The stream block.
+ * @return The number of stages invoked.
+ *
+ * Safe to call from any thread.
+ */
+uint32_t jsdrv_stage_registry_process(struct jsdrv_stage_registry_s * self,
+        const char * topic, const struct jsdrv_stream_signal_s * block);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_STAGE_H_ */
@@ -74,10 +74,24 @@ void jsdrv_statistics_adjust_k(struct jsdrv_statistics_accum_s * s, uint64_t k);
  * @param length The number of elements in x.
  *
  * Use the "traditional" two pass method.  Compute mean in first pass,
- * then variance in second pass.
+ * then variance in second pass.  Both passes use the jsdrv_f32_ops
+ * kernels.  Any NaN sample makes mean and variance NaN, but min and
+ * max ignore NaN samples.
  */
 void jsdrv_statistics_compute_f32(struct jsdrv_statistics_accum_s * s, const float * x, uint64_t length);
 
+/**
+ * @brief Compute the statistics over an array, ignoring NaN samples.
+ *
+ * @param s The statistics instance.
+ * @param x The value array.
+ * @param length The number of elements in x.
+ *
+ * Like jsdrv_statistics_compute_f32(), but k counts only the samples
+ * that are not NaN.  When all samples are NaN, s is reset.
+ */
+void jsdrv_statistics_compute_f32_skip_nan(struct jsdrv_statistics_accum_s * s, const float * x, uint64_t length);
+
 /**
  * @brief Compute the statistics over an array.
  *
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Combine statistics blocks across devices.
+ */
+
+#ifndef JSDRV_PRV_STATS_GROUP_H_
+#define JSDRV_PRV_STATS_GROUP_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_stats_group Statistics groups
+ *
+ * @brief Combine the concurrent statistics blocks from several devices.
+ *
+ * Each device computes jsdrv_statistics_s blocks on its own sample
+ * clock.  This module pairs the blocks whose start times, mapped to UTC
+ * with each block's time_map, fall within half a block of each other.
+ * Once every member has a block for the same period, it produces one
+ * aggregate block for the multi-rail total:
+ *
+ * - current and power: the sum of the member averages, the standard
+ *   deviation for independent members, and the sum of the member
+ *   minimums and maximums, which bound the total.
+ * - voltage: the member blocks combined with jsdrv_statistics_combine().
+ * - charge and energy: the sum of the member integrals, with exact
+ *   i128 sums.
+ * - sample_id and time_map fields: from the first member.
+ *
+ * A member block with no match from the other members is discarded.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The maximum members.
+#define JSDRV_STATS_GROUP_MEMBER_MAX (16U)
+
+/// The statistics group state.
+struct jsdrv_stats_group_s {
+    uint32_t member_count;          ///< The number of members.
+    uint32_t pending;               ///< The bit mask of members with a block.
+    int64_t utc[JSDRV_STATS_GROUP_MEMBER_MAX];  ///< The start time for each pending block.
+    struct jsdrv_statistics_s blocks[JSDRV_STATS_GROUP_MEMBER_MAX];  ///< The pending blocks.
+    struct jsdrv_statistics_s value;  ///< The most recent aggregate.
+};
+
+/**
+ * @brief Initialize with no pending blocks.
+ *
+ * @param self The instance.
+ * @param member_count The number of members, up to #JSDRV_STATS_GROUP_MEMBER_MAX.
+ */
+void jsdrv_stats_group_initialize(struct jsdrv_stats_group_s * self, uint32_t member_count);
+
+/**
+ * @brief Add a member statistics block.
+ *
+ * @param self The instance.
+ * @param member The member index less than member_count.
+ * @param block The member statistics block.
+ * @return The aggregate block when this block completes a period,
+ *      which remains valid until the next call, or NULL.
+ */
+const struct jsdrv_statistics_s * jsdrv_stats_group_add(struct jsdrv_stats_group_s * self, uint32_t member,
+                                                        const struct jsdrv_statistics_s * block);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_STATS_GROUP_H_ */
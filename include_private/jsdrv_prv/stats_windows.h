@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Combine statistics blocks into longer windows.
+ */
+
+#ifndef JSDRV_PRV_STATS_WINDOWS_H_
+#define JSDRV_PRV_STATS_WINDOWS_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv_prv/statistics.h"
+#include "jsdrv.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_stats_windows Statistics windows
+ *
+ * @brief Compute several statistics windows from one block stream.
+ *
+ * The device computes the shortest window, "s/stats/scnt", as its
+ * normal jsdrv_statistics_s blocks.  Each window slot combines those
+ * blocks with jsdrv_statistics_combine().  When a shorter slot evenly
+ * divides a longer slot, the longer slot combines the shorter slot's
+ * completed windows instead of the device blocks.  The device topics
+ * configure the slots:
+ *
+ * - "h/stats/win/{slot}/scnt": the slot window in the same samples as
+ *   "s/stats/scnt", or 0 for off.  The window must be a multiple of
+ *   "s/stats/scnt".
+ * - "s/stats/win/{slot}/value": the slot jsdrv_statistics_s output.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The number of window slots.
+#define JSDRV_STATS_WINDOWS_COUNT (2U)
+
+/// The state for one window slot.
+struct jsdrv_stats_window_s {
+    uint32_t scnt;          ///< The configured window in samples, 0 for off.
+    uint32_t ratio;         ///< The device blocks per window, 0 for off.
+    int32_t source;         ///< The source slot or -1 for the device blocks.
+    uint32_t step;          ///< The source windows per window.
+    uint32_t count;         ///< The source windows combined so far.
+    struct jsdrv_statistics_accum_s accum[3];  ///< The current, voltage, and power.
+    struct jsdrv_statistics_s value;           ///< The completed window.
+};
+
+/// The statistics windows state.
+struct jsdrv_stats_windows_s {
+    uint32_t block_sample_count;    ///< The device block size for the current plan.
+    uint8_t order[JSDRV_STATS_WINDOWS_COUNT];  ///< The slots from shortest to longest.
+    struct jsdrv_stats_window_s windows[JSDRV_STATS_WINDOWS_COUNT];
+};
+
+/**
+ * @brief Initialize with all slots off.
+ *
+ * @param self The instance.
+ */
+void jsdrv_stats_windows_initialize(struct jsdrv_stats_windows_s * self);
+
+/**
+ * @brief Discard all partial windows.
+ *
+ * @param self The instance.
+ */
+void jsdrv_stats_windows_clear(struct jsdrv_stats_windows_s * self);
+
+/**
+ * @brief Configure a slot window.
+ *
+ * @param self The instance.
+ * @param slot The slot index less than #JSDRV_STATS_WINDOWS_COUNT.
+ * @param scnt The window in samples or 0 for off.
+ * @return 0 or JSDRV_ERROR_PARAMETER_INVALID.
+ *
+ * Changing any slot discards all partial windows.
+ */
+int32_t jsdrv_stats_windows_scnt_set(struct jsdrv_stats_windows_s * self, uint8_t slot, uint32_t scnt);
+
+/**
+ * @brief Add a device statistics block.
+ *
+ * @param self The instance.
+ * @param block The device statistics block.
+ * @return The bit mask of slots with a completed window.  Get each
+ *      window with jsdrv_stats_windows_value().
+ */
+uint32_t jsdrv_stats_windows_add(struct jsdrv_stats_windows_s * self, const struct jsdrv_statistics_s * block);
+
+/**
+ * @brief Get the most recently completed window for a slot.
+ *
+ * @param self The instance.
+ * @param slot The slot index less than #JSDRV_STATS_WINDOWS_COUNT.
+ * @return The window, which remains valid until the next call to
+ *      jsdrv_stats_windows_add().
+ */
+const struct jsdrv_statistics_s * jsdrv_stats_windows_value(struct jsdrv_stats_windows_s * self, uint8_t slot);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_STATS_WINDOWS_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Stream data message flush policy for the device drivers.
+ */
+
+#ifndef JSDRV_PRV_STREAM_FLUSH_H_
+#define JSDRV_PRV_STREAM_FLUSH_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_stream_flush Stream flush policy
+ *
+ * @brief Decide how many samples each outgoing stream data message holds.
+ *
+ * The device drivers batch samples into data messages and send each
+ * message when it reaches the element count from
+ * jsdrv_stream_flush_element_count_max() or fills its payload.  The
+ * device topics configure the policy:
+ *
+ * - "h/stream/flush": the maximum sample duration in milliseconds.
+ * - "h/stream/flush/bytes": the maximum sample payload in bytes,
+ *   or 0 for the message capacity.
+ * - "h/stream/flush/mode": #JSDRV_STREAM_FLUSH_MODE_FIXED always uses
+ *   the configured duration.  #JSDRV_STREAM_FLUSH_MODE_ADAPTIVE uses
+ *   the configured duration when the frontend keeps up, doubles the
+ *   duration each time the drivers send into a deep frontend queue,
+ *   and halves it back when the queue drains.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The default sample duration for each data message in milliseconds.
+#define JSDRV_STREAM_FLUSH_MS_DEFAULT (50U)
+
+/// The maximum sample duration for each data message in milliseconds.
+#define JSDRV_STREAM_FLUSH_MS_MAX (1000U)
+
+/// Grow adaptive messages when the frontend queue holds at least this many messages.
+#define JSDRV_STREAM_FLUSH_DEPTH_HIGH (64U)
+
+/// Shrink adaptive messages when the frontend queue holds at most this many messages.
+#define JSDRV_STREAM_FLUSH_DEPTH_LOW (4U)
+
+/// The flush policy modes.
+enum jsdrv_stream_flush_mode_e {
+    JSDRV_STREAM_FLUSH_MODE_FIXED = 0,      ///< Flush at the configured duration.
+    JSDRV_STREAM_FLUSH_MODE_ADAPTIVE = 1,   ///< Grow the duration with frontend queue depth.
+};
+
+/// The flush policy state.
+struct jsdrv_stream_flush_s {
+    uint32_t mode;      ///< The jsdrv_stream_flush_mode_e.
+    uint32_t ms;        ///< The configured duration, which is the adaptive minimum.
+    uint32_t bytes;     ///< The maximum sample payload in bytes or 0 for no limit.
+    uint32_t ms_now;    ///< The current duration.
+};
+
+/**
+ * @brief Initialize the policy to the defaults.
+ *
+ * @param self The policy instance.
+ */
+void jsdrv_stream_flush_initialize(struct jsdrv_stream_flush_s * self);
+
+/**
+ * @brief Set the policy mode.
+ *
+ * @param self The policy instance.
+ * @param mode The jsdrv_stream_flush_mode_e.
+ * @return 0 or JSDRV_ERROR_PARAMETER_INVALID.
+ */
+int32_t jsdrv_stream_flush_mode_set(struct jsdrv_stream_flush_s * self, uint32_t mode);
+
+/**
+ * @brief Set the configured sample duration.
+ *
+ * @param self The policy instance.
+ * @param ms The duration in milliseconds from 1 to #JSDRV_STREAM_FLUSH_MS_MAX.
+ * @return 0 or JSDRV_ERROR_PARAMETER_INVALID.
+ */
+int32_t jsdrv_stream_flush_ms_set(struct jsdrv_stream_flush_s * self, uint32_t ms);
+
+/**
+ * @brief Set the maximum sample payload size.
+ *
+ * @param self The policy instance.
+ * @param bytes The maximum size in bytes or 0 for no limit.
+ */
+void jsdrv_stream_flush_bytes_set(struct jsdrv_stream_flush_s * self, uint32_t bytes);
+
+/**
+ * @brief Update the adaptive duration on each sent message.
+ *
+ * @param self The policy instance.
+ * @param queue_depth The frontend queue depth from jsdrvp_backend_queue_depth().
+ */
+void jsdrv_stream_flush_update(struct jsdrv_stream_flush_s * self, uint32_t queue_depth);
+
+/**
+ * @brief Get the maximum number of elements for the next data message.
+ *
+ * @param self The policy instance.
+ * @param sample_rate The message sample rate in Hz after all decimation.
+ * @param element_size_bits The element size in bits.
+ * @return The element count, which is always at least 1.
+ */
+uint32_t jsdrv_stream_flush_element_count_max(const struct jsdrv_stream_flush_s * self,
+                                              uint32_t sample_rate, uint32_t element_size_bits);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_STREAM_FLUSH_H_ */
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Sample-accurate stream delivery gate for the device drivers.
+ */
+
+#ifndef JSDRV_PRV_STREAM_GATE_H_
+#define JSDRV_PRV_STREAM_GATE_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_stream_gate Stream delivery gate
+ *
+ * @brief Deliver stream data only within a scheduled sample_id window.
+ *
+ * Host arrival time only brackets a capture to within the USB and
+ * message latency, so callers must otherwise stream extra data on
+ * both sides.  The gate instead trims each outgoing stream data
+ * message to the samples with start <= sample_id < stop.  The device
+ * drivers apply it to every enabled stream and configure it with
+ * their host-side topics:
+ *
+ * - "h/stream/gate/start": the first sample_id to deliver, 0 for none.
+ * - "h/stream/gate/stop": the first sample_id to no longer deliver,
+ *   0 for none.
+ * - "h/stream/gate/start/utc", "h/stream/gate/stop/utc": the same
+ *   as UTC i64 times, which the driver converts to sample_id using
+ *   its current time map.
+ *
+ * The drivers also send the message that reaches the stop sample_id
+ * immediately, rather than waiting for the flush policy, so the
+ * capture completes promptly.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+struct jsdrv_stream_signal_s;
+struct jsdrv_time_map_s;
+
+/// The gate state.
+struct jsdrv_stream_gate_s {
+    uint64_t start;     ///< The first sample_id to deliver, 0 for no start gate.
+    uint64_t stop;      ///< The first sample_id to no longer deliver, 0 for no stop gate.
+};
+
+/**
+ * @brief Initialize the gate to deliver all samples.
+ *
+ * @param self The gate instance.
+ */
+void jsdrv_stream_gate_initialize(struct jsdrv_stream_gate_s * self);
+
+/**
+ * @brief Convert a UTC time to the nearest sample_id.
+ *
+ * @param time_map The device time map.
+ * @param utc The UTC time.
+ * @param[out] sample_id The sample_id, which is at least 1.
+ * @return 0 or JSDRV_ERROR_UNAVAILABLE when the time map is not yet valid.
+ */
+int32_t jsdrv_stream_gate_utc_to_sample_id(const struct jsdrv_time_map_s * time_map, int64_t utc,
+                                           uint64_t * sample_id);
+
+/**
+ * @brief Check if a message reached the stop sample_id.
+ *
+ * @param self The gate instance.
+ * @param s The stream data message in progress.
+ * @return True when s holds the last sample before stop and should
+ *      be sent now.
+ */
+bool jsdrv_stream_gate_flush(const struct jsdrv_stream_gate_s * self, const struct jsdrv_stream_signal_s * s);
+
+/**
+ * @brief Trim a stream data message to the gate window.
+ *
+ * @param self The gate instance.
+ * @param[inout] s The stream data message, which is modified in place.
+ *      The sample_id, element_count and data reflect only the samples
+ *      within the window.
+ * @return The remaining element count.  The caller should drop the
+ *      message when 0.
+ */
+uint32_t jsdrv_stream_gate_apply(const struct jsdrv_stream_gate_s * self, struct jsdrv_stream_signal_s * s);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_STREAM_GATE_H_ */
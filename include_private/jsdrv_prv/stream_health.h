@@ -0,0 +1,101 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Stream input health counters.
+ */
+
+#ifndef JSDRV_PRV_STREAM_HEALTH_H_
+#define JSDRV_PRV_STREAM_HEALTH_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_stream_health Stream health
+ *
+ * @brief Count stream input frames and data loss.
+ *
+ * The device drivers update these counters from their stream input
+ * path, then periodically format them as JSON for the device
+ * "h/stream/health" topic.  All counters accumulate since the device
+ * opened, so a monitor can compare successive values to detect
+ * data loss without parsing logs.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The number of stream ports.
+#define JSDRV_STREAM_HEALTH_PORTS (16U)
+
+/// The counters for one stream port.
+struct jsdrv_stream_health_port_s {
+    uint64_t frames;                ///< The received frames.
+    uint64_t samples;               ///< The received samples, before duplicate removal.
+    uint64_t skip_samples;          ///< The missing sample_id count.
+    uint64_t dup_samples;           ///< The duplicate sample_id count.
+    uint32_t skips;                 ///< The number of skip events.
+    uint32_t dups;                  ///< The number of duplicate or overlap events.
+    uint32_t resyncs;               ///< The number of resynchronizations after lost sync.
+    uint32_t drops;                 ///< The frames discarded without new samples.
+};
+
+/// The stream health counters.
+struct jsdrv_stream_health_s {
+    uint64_t frames;                ///< The total received frames.
+    uint64_t bytes;                 ///< The total received frame payload bytes.
+    uint32_t frame_id_mismatch;     ///< The number of frame_id discontinuities.
+    uint64_t frames_lost;           ///< The frames missing according to frame_id.
+    uint64_t inactive;              ///< The frames received for disabled ports.
+    uint64_t discard;               ///< The stream frames discarded while not open.
+    struct jsdrv_stream_health_port_s port[JSDRV_STREAM_HEALTH_PORTS];
+};
+
+/**
+ * @brief Clear the counters.
+ *
+ * @param self The instance.
+ */
+void jsdrv_stream_health_clear(struct jsdrv_stream_health_s * self);
+
+/**
+ * @brief Format the counters as a JSON object.
+ *
+ * @param self The instance.
+ * @param buf The output buffer.
+ * @param size The size of buf in bytes.
+ * @return The number of bytes written excluding the terminator,
+ *      or 0 when buf is too small.
+ *
+ * The format is {"frames": 0, "bytes": 0, "frame_id_mismatch": 0,
+ * "frames_lost": 0, "inactive": 0, "discard": 0, "ports": [{"port": 5,
+ * "frames": 0, "samples": 0, "skips": 0, "skip_samples": 0, "dups": 0,
+ * "dup_samples": 0, "resyncs": 0, "drops": 0}, ...]}.
+ * The ports list only contains ports that received frames, and
+ * "port" is the index into jsdrv_stream_health_s.port.
+ */
+uint32_t jsdrv_stream_health_json(const struct jsdrv_stream_health_s * self, char * buf, uint32_t size);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_STREAM_HEALTH_H_ */
@@ -31,6 +31,7 @@
 #include <pthread.h>
 #endif
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @ingroup jsdrv_prv
@@ -44,6 +45,12 @@
 
 JSDRV_CPP_GUARD_START
 
+#if defined(_MSC_VER)
+#define JSDRV_THREAD_LOCAL __declspec(thread)
+#else
+#define JSDRV_THREAD_LOCAL __thread
+#endif
+
 #if _WIN32
 #define THREAD_RETURN_TYPE DWORD WINAPI
 #define THREAD_ARG_TYPE LPVOID
@@ -72,6 +79,7 @@ typedef pthread_t jsdrv_thread_t;
  * @param priority The thread priority.
  *      0 is default. 1 is above normal, 2 is highest.
  *      -1 is below normal, -2 is lowest.
+ *      See jsdrv_thread_priority_set() for real-time priority.
  * @return
  */
 
@@ -83,6 +91,81 @@ JSDRV_API int32_t jsdrv_thread_join(jsdrv_thread_t * thread, uint32_t timeout_ms
 JSDRV_API bool jsdrv_thread_is_current(jsdrv_thread_t const * thread);
 JSDRV_API void jsdrv_thread_sleep_ms(uint32_t duration_ms);
 
+/// The jsdrv_thread_priority_set() real-time priority.
+#define JSDRV_THREAD_PRIORITY_REALTIME (3)
+
+/**
+ * @brief Set the name of the calling thread for debuggers and profilers.
+ *
+ * @param name The thread name.  Linux truncates names to 15 characters.
+ * @return 0 or error code.
+ *
+ * This function also registers the thread with jsdrv_thread_stats_register()
+ * using the full name.
+ */
+JSDRV_API int32_t jsdrv_thread_name_set(const char * name);
+
+/**
+ * @brief Restrict the calling thread to a set of CPUs.
+ *
+ * @param mask The bit mask of allowed CPUs, where bit 0 is CPU 0.
+ * @return 0 or error code.  Platforms without affinity support
+ *      return JSDRV_ERROR_NOT_SUPPORTED.
+ */
+JSDRV_API int32_t jsdrv_thread_affinity_set(uint64_t mask);
+
+/**
+ * @brief Get the number of online CPUs.
+ *
+ * @return The CPU count, which is at least 1.
+ */
+JSDRV_API uint32_t jsdrv_thread_cpu_count(void);
+
+/**
+ * @brief Set the calling thread's priority.
+ *
+ * @param priority The priority using the same values as
+ *      jsdrv_thread_create(), or JSDRV_THREAD_PRIORITY_REALTIME.
+ *      Real-time is THREAD_PRIORITY_TIME_CRITICAL on Windows and
+ *      SCHED_FIFO on POSIX, which usually requires elevated permissions.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_thread_priority_set(int priority);
+
+/**
+ * @brief The opaque handle for reading a thread's CPU time.
+ *
+ * This is a clockid_t on Linux, a mach_port_t on macOS, and a
+ * duplicated thread HANDLE on Windows.
+ */
+typedef uint64_t jsdrv_thread_cpu_t;
+
+/**
+ * @brief Open the CPU time handle for the calling thread.
+ *
+ * @param[out] cpu The handle, which any thread may then pass to
+ *      jsdrv_thread_cpu_time().  Call jsdrv_thread_cpu_close() when done.
+ * @return 0 or error code.
+ */
+JSDRV_API int32_t jsdrv_thread_cpu_open(jsdrv_thread_cpu_t * cpu);
+
+/**
+ * @brief Get the total CPU time consumed by a thread.
+ *
+ * @param cpu The handle from jsdrv_thread_cpu_open().
+ * @param[out] time_ns The user + system CPU time in nanoseconds.
+ * @return 0 or error code.  Once the thread exits, return
+ *      JSDRV_ERROR_CLOSED or another nonzero error.
+ */
+JSDRV_API int32_t jsdrv_thread_cpu_time(jsdrv_thread_cpu_t cpu, uint64_t * time_ns);
+
+/**
+ * @brief Close a handle from jsdrv_thread_cpu_open().
+ *
+ * @param cpu The handle.
+ */
+JSDRV_API void jsdrv_thread_cpu_close(jsdrv_thread_cpu_t cpu);
+
 JSDRV_CPP_GUARD_END
 
 /** @} */
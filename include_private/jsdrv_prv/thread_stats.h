@@ -0,0 +1,80 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Per-thread CPU time statistics.
+ */
+
+#ifndef JSDRV_PRV_THREAD_STATS_H_
+#define JSDRV_PRV_THREAD_STATS_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_thread_stats Thread statistics
+ *
+ * @brief Track the CPU time of the driver's internal threads.
+ *
+ * Each thread registers itself once, which jsdrv_thread_name_set()
+ * does automatically.  Any thread may then sample the CPU time of all
+ * registered threads.  Sampling drops threads that have exited.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+#ifndef JSDRV_THREAD_STATS_MAX
+#define JSDRV_THREAD_STATS_MAX        (64U)
+#endif
+
+#define JSDRV_THREAD_STATS_NAME_SIZE  (32U)
+
+/// The CPU time sample for one thread.
+struct jsdrv_thread_stats_s {
+    uint32_t id;                                ///< The unique registration id, starting at 1.
+    char name[JSDRV_THREAD_STATS_NAME_SIZE];    ///< The thread name.
+    uint64_t cpu_ns;                            ///< The total CPU time in nanoseconds.
+};
+
+/**
+ * @brief Register the calling thread.
+ *
+ * @param name The thread name.  Registering the same thread again
+ *      only updates the name.
+ * @return 0 or error code.
+ */
+int32_t jsdrv_thread_stats_register(const char * name);
+
+/**
+ * @brief Sample the CPU time for all registered threads.
+ *
+ * @param[out] stats The samples, in registration order.
+ * @param count The maximum number of stats entries.
+ * @return The number of stats entries populated.
+ */
+uint32_t jsdrv_thread_stats_sample(struct jsdrv_thread_stats_s * stats, uint32_t count);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_THREAD_STATS_H_ */
@@ -25,6 +25,7 @@
 #define JSDRV_TIME_MAP_FILTER_H__
 
 #include "jsdrv/time.h"
+#include <stdbool.h>
 
 /**
  * @ingroup jsdrv_prv
@@ -65,6 +66,23 @@ void jsdrv_tmf_free(struct jsdrv_tmf_s * self);
  */
 void jsdrv_tmf_clear(struct jsdrv_tmf_s * self);
 
+/**
+ * @brief Enable the least-squares counter rate estimate.
+ *
+ * @param self The instance.
+ * @param enable True to fit counter_rate to the saved points each time
+ *      they all turn over, false to use the nominal counter rate (default).
+ *
+ * The min filter rejects latency but assumes the nominal counter rate,
+ * so crystal drift skews its estimate across the points.  The fit tracks
+ * the drift, and rejects estimates more than 1% from the nominal rate.
+ * A scalar Kalman filter weights each fit by its residual variance, so
+ * the rate estimate keeps improving over long captures while still
+ * following slow temperature drift.  Each fit costs O(points) once per
+ * points added.  This function clears the filter.
+ */
+void jsdrv_tmf_rate_estimate(struct jsdrv_tmf_s * self, bool enable);
+
 /**
  * @brief Add a new entry.
  *
@@ -74,6 +92,10 @@ void jsdrv_tmf_clear(struct jsdrv_tmf_s * self);
  *
  * Note: the entry will only be added if the interval provided to "new"
  * has elapsed.  Otherwise, this entry will be ignored.
+ *
+ * The time map offset is the minimum over the saved points of the UTC
+ * time less the elapsed counter time, which a monotonic deque updates
+ * in O(1) amortized time.
  */
 void jsdrv_tmf_add(struct jsdrv_tmf_s * self, uint64_t counter, int64_t utc);
 
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Pending API command timeouts.
+ */
+
+#ifndef JSDRV_PRV_TIMEOUTS_H_
+#define JSDRV_PRV_TIMEOUTS_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include "jsdrv_prv/frontend.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_timeouts Pending command timeouts
+ *
+ * @brief Track pending API commands by deadline and by topic.
+ *
+ * The frontend tracks each API command awaiting a return code.
+ * This module stores the pending commands in a binary min-heap ordered
+ * by deadline for O(log n) expiration and in a hash table indexed by
+ * topic for O(1) expected completion lookup.  Commands with the same
+ * topic complete in insertion order.  Commands with the same deadline
+ * expire in insertion order.
+ *
+ * This module is not thread-safe.  Only the frontend thread may use it.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The opaque instance.
+struct jsdrv_timeouts_s;
+
+/**
+ * @brief Allocate a new instance.
+ *
+ * @return The new instance.
+ */
+struct jsdrv_timeouts_s * jsdrv_timeouts_alloc(void);
+
+/**
+ * @brief Free an instance.
+ *
+ * @param self The instance.  The caller must remove all entries first.
+ */
+void jsdrv_timeouts_free(struct jsdrv_timeouts_s * self);
+
+/**
+ * @brief Get the number of pending entries.
+ *
+ * @param self The instance.
+ * @return The number of pending entries.
+ */
+uint32_t jsdrv_timeouts_size(struct jsdrv_timeouts_s * self);
+
+/**
+ * @brief Add a pending entry.
+ *
+ * @param self The instance.
+ * @param timeout The entry with topic and timeout populated.  The
+ *      instance uses the entry's item, hash, heap_index, and seq fields
+ *      until the entry is removed.
+ */
+void jsdrv_timeouts_add(struct jsdrv_timeouts_s * self, struct jsdrvp_api_timeout_s * timeout);
+
+/**
+ * @brief Get the entry with the earliest deadline.
+ *
+ * @param self The instance.
+ * @return The entry, which remains pending, or NULL if empty.
+ */
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_peek(struct jsdrv_timeouts_s * self);
+
+/**
+ * @brief Remove the earliest entry if expired.
+ *
+ * @param self The instance.
+ * @param t_now The current time as jsdrv_time_utc().
+ * @return The removed entry or NULL if no entries have expired.
+ */
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_pop_expired(struct jsdrv_timeouts_s * self, int64_t t_now);
+
+/**
+ * @brief Remove the oldest entry matching a topic.
+ *
+ * @param self The instance.
+ * @param topic The topic to match.
+ * @return The removed entry or NULL if not found.
+ */
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_remove_topic(struct jsdrv_timeouts_s * self, const char * topic);
+
+/**
+ * @brief Remove the entry with the earliest deadline.
+ *
+ * @param self The instance.
+ * @return The removed entry or NULL if empty.
+ */
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_pop(struct jsdrv_timeouts_s * self);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_TIMEOUTS_H_ */
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Lightweight driver-wide tracing.
+ */
+
+#ifndef JSDRV_PRV_TRACE_H_
+#define JSDRV_PRV_TRACE_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_trace Tracing
+ *
+ * @brief Record begin, end and instant events from any thread.
+ *
+ * Each thread records into its own ring, allocated on its first event,
+ * so recording needs no lock.  Once a ring is full, new events
+ * overwrite the oldest.  Tracing is off by default.  When off, each
+ * trace point costs one load and compare.  Export writes the Chrome
+ * trace event JSON format, which chrome://tracing and the Perfetto UI
+ * both load.
+ *
+ * Set JSDRV_TRACE_ENABLE to 0 to compile out all trace points.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+#ifndef JSDRV_TRACE_ENABLE
+#define JSDRV_TRACE_ENABLE            (1)
+#endif
+
+#ifndef JSDRV_TRACE_RING_SIZE
+#define JSDRV_TRACE_RING_SIZE         (8192U)  // events for each thread, power of 2
+#endif
+
+#ifndef JSDRV_TRACE_THREADS_MAX
+#define JSDRV_TRACE_THREADS_MAX       (64U)
+#endif
+
+#define JSDRV_TRACE_DETAIL_SIZE       (24U)
+
+/// The trace event phases, which match the Chrome trace event "ph" values.
+enum jsdrv_trace_phase_e {
+    JSDRV_TRACE_PHASE_BEGIN = 'B',
+    JSDRV_TRACE_PHASE_END = 'E',
+    JSDRV_TRACE_PHASE_INSTANT = 'i',
+};
+
+/// Nonzero while tracing.  Use the JSDRV_TRACE macros rather than this variable.
+extern volatile uint32_t jsdrv_trace_active;
+
+/**
+ * @brief Start or stop recording.
+ *
+ * @param enable True to record events, false to stop.
+ */
+void jsdrv_trace_enable(bool enable);
+
+/**
+ * @brief Discard all recorded events.
+ */
+void jsdrv_trace_clear(void);
+
+/**
+ * @brief Record an event for the calling thread.
+ *
+ * @param phase The jsdrv_trace_phase_e.
+ * @param name The event name, which must have static storage.
+ * @param detail The optional detail string, such as a topic, or NULL.
+ *      The event copies up to JSDRV_TRACE_DETAIL_SIZE - 1 characters.
+ * @param id The optional numeric argument, such as a size.
+ */
+void jsdrv_trace_record(uint8_t phase, const char * name, const char * detail, uint32_t id);
+
+/**
+ * @brief Export the recorded events as Chrome trace event JSON.
+ *
+ * @param path The output file path.
+ * @return 0 or error code.
+ *
+ * Recording pauses during the export.
+ */
+int32_t jsdrv_trace_export(const char * path);
+
+#if JSDRV_TRACE_ENABLE
+#define JSDRV_TRACE(phase, name, detail, id) do {                  \
+    if (jsdrv_trace_active) {                                      \
+        jsdrv_trace_record((phase), (name), (detail), (id));       \
+    }                                                              \
+} while (0)
+#else
+#define JSDRV_TRACE(phase, name, detail, id) do { } while (0)
+#endif
+
+/// Begin a duration event.
+#define JSDRV_TRACE_BEGIN(name, detail, id) JSDRV_TRACE(JSDRV_TRACE_PHASE_BEGIN, name, detail, id)
+/// End the most recent duration event with the same name on this thread.
+#define JSDRV_TRACE_END(name) JSDRV_TRACE(JSDRV_TRACE_PHASE_END, name, NULL, 0)
+/// Record an instant event.
+#define JSDRV_TRACE_INSTANT(name, detail, id) JSDRV_TRACE(JSDRV_TRACE_PHASE_INSTANT, name, detail, id)
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_TRACE_H_ */
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Threshold and edge trigger detection over stream blocks.
+ */
+
+#ifndef JSDRV_PRV_TRIGGER_H_
+#define JSDRV_PRV_TRIGGER_H_
+
+#include "jsdrv.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_trigger Trigger
+ *
+ * @brief Find the first threshold crossing that holds for a duration.
+ *
+ * The trigger scans consecutive stream blocks for a
+ * jsdrv_buffer_search_op_e edge: RISE above the threshold, FALL to or
+ * below the threshold, or CROSS for either.  The new level must then
+ * hold for the duration in samples, including the edge sample, so
+ * "current > 200 mA for 10 us" is RISE with duration 10 at 1 Msps.
+ * A sample on the other side of the threshold first cancels the
+ * candidate edge.  NaN samples are ignored.
+ *
+ * The trigger needs one valid sample to learn the starting level, so
+ * a block that starts above the threshold is not a RISE.  A gap in the
+ * source sample_id forgets the level, as does a fire, so the next fire
+ * needs a new edge.  The trigger accepts float32 blocks and 1-, 4-,
+ * and 8-bit unsigned blocks, such as general-purpose inputs, which
+ * compare as 0, 1, ... against the threshold.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The trigger state.
+struct jsdrv_trigger_s {
+    uint8_t op;                     ///< jsdrv_buffer_search_op_e: RISE, FALL, or CROSS.
+    int8_t side;                    ///< 1 above threshold, 0 at or below, -1 unknown.
+    float threshold;                ///< The threshold.
+    uint64_t duration;              ///< The samples the new level must hold, at least 1.
+    uint64_t held;                  ///< The samples held since the candidate edge, 0 for none.
+    uint64_t edge;                  ///< The candidate edge sample_id.
+    uint64_t sample_id_next;        ///< The expected next source sample_id, 0 for none.
+};
+
+/**
+ * @brief Reset the trigger state.
+ *
+ * @param self The trigger instance.
+ * @param op The jsdrv_buffer_search_op_e: RISE, FALL, or CROSS.
+ * @param threshold The threshold.
+ * @param duration The samples the new level must hold, which is
+ *      clamped to at least 1.
+ */
+void jsdrv_trigger_clear(struct jsdrv_trigger_s * self, uint8_t op, float threshold, uint64_t duration);
+
+/**
+ * @brief Scan a source block for the trigger.
+ *
+ * @param self The trigger instance.
+ * @param src The source block.
+ * @param[out] fire The edge sample_id when the trigger fires.
+ * @return True when the trigger fires.  The trigger ignores the rest
+ *      of src, so call jsdrv_trigger_clear() to rearm.
+ */
+bool jsdrv_trigger_process(struct jsdrv_trigger_s * self, const struct jsdrv_stream_signal_s * src, uint64_t * fire);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_TRIGGER_H_ */
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief USB bulk-in endpoint statistics for the backends.
+ */
+
+#ifndef JSDRV_PRV_USB_STATS_H_
+#define JSDRV_PRV_USB_STATS_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_usb_stats USB endpoint statistics
+ *
+ * @brief Per-endpoint bulk-in transfer statistics.
+ *
+ * The backend updates these statistics from its USB event thread,
+ * then periodically formats them as JSON for the device
+ * "h/usb/stats" topic.  The completions, bytes, timeouts,
+ * and errors accumulate since the endpoint opened.  The interval and
+ * residence statistics cover the time since the previous report.
+ *
+ * The completion interval is the time between consecutive completions.
+ * The throughput is the bytes received over the completion intervals
+ * in this report.
+ * The residence time is the time that the upper level holds a
+ * completed buffer before returning it.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The bulk-in endpoint statistics.
+struct jsdrv_usb_stats_s {
+    uint8_t endpoint;               ///< The endpoint address, 0 when unused.
+    uint32_t in_flight;             ///< The transfers currently submitted, set by the backend.
+    uint32_t loaned;                ///< The transfers held by the upper level, set by the backend.
+    uint64_t completions;           ///< The total successful completions.
+    uint64_t bytes;                 ///< The total bytes received.
+    uint32_t timeouts;              ///< The total timed out transfers.
+    uint32_t errors;                ///< The total failed transfers.
+
+    int64_t t_prev;                 ///< The previous completion time, 0 for none.
+    uint32_t interval_count;        ///< The number of intervals in this report.
+    uint32_t interval_min_us;       ///< The minimum interval in this report.
+    uint32_t interval_max_us;       ///< The maximum interval in this report.
+    uint64_t interval_sum_us;       ///< The interval total in this report.
+    uint64_t interval_bytes;        ///< The bytes received over the intervals in this report.
+    uint32_t residence_count;       ///< The number of returned buffers in this report.
+    uint32_t residence_max_us;      ///< The maximum residence in this report.
+    uint64_t residence_sum_us;      ///< The residence total in this report.
+};
+
+/**
+ * @brief Reset the statistics when an endpoint opens.
+ *
+ * @param self The statistics instance.
+ * @param endpoint The endpoint address.
+ */
+void jsdrv_usb_stats_open(struct jsdrv_usb_stats_s * self, uint8_t endpoint);
+
+/**
+ * @brief Record a successful completion.
+ *
+ * @param self The statistics instance.
+ * @param t_now The completion time as jsdrv_time_utc().
+ * @param size The received size in bytes.
+ */
+void jsdrv_usb_stats_complete(struct jsdrv_usb_stats_s * self, int64_t t_now, uint32_t size);
+
+/**
+ * @brief Record a returned buffer.
+ *
+ * @param self The statistics instance.
+ * @param t_complete The completion time as jsdrv_time_utc().
+ * @param t_now The return time as jsdrv_time_utc().
+ */
+void jsdrv_usb_stats_residence(struct jsdrv_usb_stats_s * self, int64_t t_complete, int64_t t_now);
+
+/**
+ * @brief Format statistics as a JSON object and start a new report.
+ *
+ * @param stats The statistics array.
+ * @param count The number of entries in stats.  Entries with
+ *      endpoint 0 are skipped.
+ * @param buf The output buffer.
+ * @param size The size of buf in bytes.
+ * @return The number of endpoints written.
+ *
+ * The format is {"endpoints": [{"endpoint": 130, "completions": 0,
+ * "bytes": 0, "bytes_per_s": 0, "timeouts": 0, "errors": 0, "in_flight": 0, "loaned": 0,
+ * "interval_us": {"min": 0, "avg": 0, "max": 0},
+ * "residence_us": {"avg": 0, "max": 0}}, ...]}.
+ */
+uint32_t jsdrv_usb_stats_json(struct jsdrv_usb_stats_s * stats, uint32_t count, char * buf, uint32_t size);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_USB_STATS_H_ */
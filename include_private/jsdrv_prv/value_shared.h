@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Reference-counted message value memory.
+ */
+
+#ifndef JSDRV_PRV_VALUE_SHARED_H_
+#define JSDRV_PRV_VALUE_SHARED_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_value_shared Shared values
+ *
+ * @brief Pass large immutable values between messages without copying.
+ *
+ * A jsdrv_union_s with JSDRV_UNION_FLAG_SHARED_MEMORY points to memory
+ * from jsdrv_value_shared_alloc().  Cloning the message adds a reference
+ * and freeing the message releases it, so large values such as
+ * firmware images and metadata are copied at most once, when they
+ * first enter the driver.  The memory must not change after it is
+ * shared.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/**
+ * @brief Allocate shared value memory.
+ *
+ * @param size The size in bytes.
+ * @return The memory with a reference count of 1.
+ * @throw assert on out of memory
+ */
+void * jsdrv_value_shared_alloc(uint32_t size);
+
+/**
+ * @brief Add a reference to shared value memory.
+ *
+ * @param ptr The memory from jsdrv_value_shared_alloc().
+ */
+void jsdrv_value_shared_retain(const void * ptr);
+
+/**
+ * @brief Release a reference to shared value memory.
+ *
+ * @param ptr The memory from jsdrv_value_shared_alloc(), which may be NULL.
+ *      The last release frees the memory.
+ */
+void jsdrv_value_shared_release(const void * ptr);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_VALUE_SHARED_H_ */
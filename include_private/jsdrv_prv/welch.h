@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Welch-averaged power spectrum estimation.
+ */
+
+#ifndef JSDRV_PRV_WELCH_H_
+#define JSDRV_PRV_WELCH_H_
+
+#include "jsdrv/cmacro_inc.h"
+#include <stdint.h>
+
+// Forward declarations from "jsdrv.h"
+struct jsdrv_spectrum_s;
+
+/**
+ * @ingroup jsdrv_prv
+ * @defgroup jsdrv_prv_welch Welch spectrum estimator
+ *
+ * @brief Average the FFT power of overlapping windowed segments.
+ *
+ * The estimator collects samples into segments of fft_length samples
+ * that start every fft_length * (100 - overlap) / 100 samples.  Each
+ * segment is multiplied by a periodic Hann window, transformed with
+ * a radix-2 real FFT computed as a half-length complex FFT, and its
+ * power added to a double-precision accumulator.  A spectrum is ready
+ * once the averaged segments span at least period_ms of samples.
+ *
+ * A gap in sample_id discards the partial segment, as does a segment
+ * containing NaN, so missing samples never reach the average.
+ *
+ * @{
+ */
+
+JSDRV_CPP_GUARD_START
+
+/// The minimum FFT length.
+#define JSDRV_WELCH_LENGTH_MIN      (16U)
+/// The maximum FFT length, which fits the spectrum in one data message.
+#define JSDRV_WELCH_LENGTH_MAX      (16384U)
+/// The default FFT length.
+#define JSDRV_WELCH_LENGTH_DEFAULT  (1024U)
+
+/// The estimator configuration.
+struct jsdrv_welch_config_s {
+    uint32_t sample_rate;   ///< The data sample rate in Hz.
+    uint32_t fft_length;    ///< The segment length, a power of 2.
+    uint32_t overlap;       ///< The segment overlap in percent, less than 100.
+    uint32_t period_ms;     ///< The data duration for each spectrum, 0 for every segment.
+    uint8_t scale;          ///< jsdrv_spectrum_scale_e
+};
+
+/// The opaque estimator instance.
+struct jsdrv_welch_s;
+
+/**
+ * @brief Allocate a new estimator.
+ *
+ * @return The new instance, or NULL.
+ *
+ * Call jsdrv_welch_configure() before adding samples.
+ */
+struct jsdrv_welch_s * jsdrv_welch_new(void);
+
+/**
+ * @brief Free an estimator.
+ *
+ * @param self The instance, which may be NULL.
+ */
+void jsdrv_welch_free(struct jsdrv_welch_s * self);
+
+/**
+ * @brief Configure the estimator.
+ *
+ * @param self The instance.
+ * @param config The configuration.
+ * @return 0 or JSDRV_ERROR_PARAMETER_INVALID.
+ *
+ * This function clears the estimator.
+ */
+int32_t jsdrv_welch_configure(struct jsdrv_welch_s * self, const struct jsdrv_welch_config_s * config);
+
+/**
+ * @brief Discard the partial segment and the average.
+ *
+ * @param self The instance.
+ */
+void jsdrv_welch_clear(struct jsdrv_welch_s * self);
+
+/**
+ * @brief Add samples.
+ *
+ * @param self The instance.
+ * @param sample_id The index of x[0] in data samples.
+ * @param x The samples.
+ * @param count The number of samples in x.
+ * @return 0 or JSDRV_ERROR_UNAVAILABLE when not configured.
+ */
+int32_t jsdrv_welch_add(struct jsdrv_welch_s * self, uint64_t sample_id, const float * x, uint32_t count);
+
+/**
+ * @brief The size of the next spectrum.
+ *
+ * @param self The instance.
+ * @return The spectrum size in bytes, or 0 when no spectrum is ready.
+ */
+uint32_t jsdrv_welch_ready(struct jsdrv_welch_s * self);
+
+/**
+ * @brief Produce the next spectrum and restart the average.
+ *
+ * @param self The instance.
+ * @param spectrum The spectrum with at least jsdrv_welch_ready() bytes.
+ *      This function populates every field except decimate_factor and
+ *      time_map, and sample_id is in data samples.
+ * @return 0 or JSDRV_ERROR_UNAVAILABLE when no spectrum is ready.
+ */
+int32_t jsdrv_welch_next(struct jsdrv_welch_s * self, struct jsdrv_spectrum_s * spectrum);
+
+JSDRV_CPP_GUARD_END
+
+/** @} */
+
+#endif  /* JSDRV_PRV_WELCH_H_ */
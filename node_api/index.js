@@ -15,13 +15,29 @@
  */
 
 const addon = require('node-gyp-build')(__dirname);
+const EventEmitter = require('events');
 
 
-class JoulescopeDriver {
+/**
+ * The Joulescope driver.
+ *
+ * Emits "status" events with {topic, drops, drops_total} when a
+ * subscription discards messages because the JavaScript event loop
+ * fell behind.
+ */
+class JoulescopeDriver extends EventEmitter {
     constructor() {
+        super();
         this.jsdrv = new addon.JoulescopeDriver()
     }
 
+    _subscribe_options(options, batch) {
+        return Object.assign({
+            batch: batch,
+            status: (status) => this.emit('status', status),
+        }, options);
+    }
+
     /**
      * Publish a value to a topic.
      *
@@ -89,10 +105,36 @@ class JoulescopeDriver {
      * @param flags
      * @param fn
      * @param timeout
+     * @param options The optional subscription options:
+     *      - queue_size: The maximum number of messages waiting for
+     *        the JavaScript thread.  Defaults to 4096.
+     *      - overflow: "drop_newest" or "drop_oldest" when the queue is
+     *        full.  Defaults to "drop_newest" for "!data" topics, which
+     *        keeps the stream contiguous, and "drop_oldest" otherwise,
+     *        which keeps the latest values like statistics.
+     * @returns Callable to unsubscribe.
+     */
+    subscribe(topic, flags, fn, timeout=-1, options={}) {
+        return this.jsdrv.subscribe(topic, flags, fn, timeout, this._subscribe_options(options, false));
+    }
+
+    /**
+     * Subscribe to a topic with batched delivery.
+     *
+     * Messages that arrive while the JavaScript thread is busy are
+     * delivered together in a single call to fn(topics, values),
+     * where topics and values are arrays of the same length.
+     * Use for full-rate stream data.
+     *
+     * @param topic
+     * @param flags
+     * @param fn
+     * @param timeout
+     * @param options The optional subscription options, see subscribe().
      * @returns Callable to unsubscribe.
      */
-    subscribe(topic, flags, fn, timeout=-1) {
-        return this.jsdrv.subscribe(topic, flags, fn, timeout);
+    subscribe_batch(topic, flags, fn, timeout=-1, options={}) {
+        return this.jsdrv.subscribe(topic, flags, fn, timeout, this._subscribe_options(options, true));
     }
 }
 
@@ -16,11 +16,15 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <cstddef>  // offsetof
 #include <cstring>  // memset
+#include <deque>
+#include <mutex>
 #include "joulescope_driver.h"
 
 static const uint32_t _TIMEOUT_MS_INIT = 5000;
 static const uint32_t _TIMEOUT_MS = 2000;
+static const uint32_t _SUBSCRIBE_QUEUE_SIZE = 4096;  // default messages awaiting each JavaScript callback
 
 
 Napi::Object JoulescopeDriver::Init(Napi::Env env, Napi::Object exports) {
@@ -146,7 +150,38 @@ static double time64_to_ms(int64_t t) {
     return (double) t_ms;
 }
 
-static Napi::Value stream_to_js(Napi::Env env, const struct jsdrv_union_s * value) {
+static void free_owner(Napi::Env env, void * data, struct jsdrv_union_s * owner) {
+    (void) env;
+    (void) data;
+    free(owner);
+}
+
+template <typename T, typename A>
+static A stream_data(Napi::Env env, const struct jsdrv_stream_signal_s * s, struct jsdrv_union_s ** owner) {
+    size_t byte_length = s->element_count * sizeof(T);
+    if (owner && *owner) {
+        // wrap the subscriber's copy of the message, freed when the ArrayBuffer is collected
+        Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(
+                env, (void *) (*owner)->value.bin, (*owner)->size, free_owner, *owner);
+        *owner = NULL;
+        return A::New(env, s->element_count, buffer, offsetof(struct jsdrv_stream_signal_s, data));
+    }
+    A data = A::New(env, s->element_count);
+    memcpy(data.Data(), s->data, byte_length);
+    return data;
+}
+
+/**
+ * @brief Convert a stream message to a JavaScript object.
+ *
+ * @param env The Node-API environment.
+ * @param value The stream message value.
+ * @param owner The optional pointer to the malloc'd message copy.  When the
+ *      data type allows, the returned typed array wraps the copy directly
+ *      and this function clears *owner.  Otherwise, the caller keeps
+ *      ownership and must free *owner.
+ */
+static Napi::Value stream_to_js(Napi::Env env, const struct jsdrv_union_s * value, struct jsdrv_union_s ** owner) {
     const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) value->value.bin;
     Napi::Object obj = Napi::Object::New(env);
     obj.Set("sample_id", s->sample_id);
@@ -156,21 +191,26 @@ static Napi::Value stream_to_js(Napi::Env env, const struct jsdrv_union_s * valu
     obj.Set("sample_rate", s->sample_rate);
     obj.Set("decimate_factor", s->decimate_factor);
     obj.Set("time_map", obj_time_map(env, &s->time_map));
-    if (JSDRV_DATA_TYPE_FLOAT == s->element_type) {
+    if ((JSDRV_DATA_TYPE_HOLD == s->element_type) && (8 * sizeof(struct jsdrv_stream_hold_s) == s->element_size_bits)
+            && (1 == s->element_count)) {
+        // deadband hold record, expand to float32 like the stream samples it replaces
+        const struct jsdrv_stream_hold_s * hold = (const struct jsdrv_stream_hold_s *) s->data;
+        Napi::Object h = Napi::Object::New(env);
+        h.Set("sample_count", (double) hold->sample_count);
+        h.Set("min", hold->min);
+        h.Set("max", hold->max);
+        h.Set("mean", hold->mean);
+        obj.Set("hold", h);
+        Napi::Float32Array data = Napi::Float32Array::New(env, (size_t) hold->sample_count);
+        for (size_t idx = 0; idx < data.ElementLength(); ++idx) {
+            data[idx] = hold->mean;
+        }
+        obj.Set("data", data);
+    } else if (JSDRV_DATA_TYPE_FLOAT == s->element_type) {
         if (32 == s->element_size_bits) {
-            Napi::Float32Array data = Napi::Float32Array::New(env, s->element_count);
-            float * data_src = (float *) s->data;
-            for (size_t idx = 0; idx < s->element_count; ++idx) {
-                data[idx] = data_src[idx];
-            }
-            obj.Set("data", data);
+            obj.Set("data", stream_data<float, Napi::Float32Array>(env, s, owner));
         } else if (64 == s->element_size_bits) {
-            Napi::Float64Array data = Napi::Float64Array::New(env, s->element_count);
-            double * data_src = (double *) s->data;
-            for (size_t idx = 0; idx < s->element_count; ++idx) {
-                data[idx] = data_src[idx];
-            }
-            obj.Set("data", data);
+            obj.Set("data", stream_data<double, Napi::Float64Array>(env, s, owner));
         }
     } else if (JSDRV_DATA_TYPE_UINT == s->element_type) {
         if (1 == s->element_size_bits) {
@@ -188,21 +228,11 @@ static Napi::Value stream_to_js(Napi::Env env, const struct jsdrv_union_s * valu
             }
             obj.Set("data", data);
         } else if (8 == s->element_size_bits) {
-            Napi::Uint8Array data = Napi::Uint8Array::New(env, s->element_count);
-            uint8_t * data_src = (uint8_t *) s->data;
-            for (size_t idx = 0; idx < s->element_count; ++idx) {
-                data[idx] = data_src[idx];
-            }
-            obj.Set("data", data);
+            obj.Set("data", stream_data<uint8_t, Napi::Uint8Array>(env, s, owner));
         }
     } else if (JSDRV_DATA_TYPE_INT == s->element_type) {
         if (16 == s->element_size_bits) {
-            Napi::Int16Array data = Napi::Int16Array::New(env, s->element_count);
-            int16_t * data_src = (int16_t *) s->data;
-            for (size_t idx = 0; idx < s->element_count; ++idx) {
-                data[idx] = data_src[idx];
-            }
-            obj.Set("data", data);
+            obj.Set("data", stream_data<int16_t, Napi::Int16Array>(env, s, owner));
         }
     }
     return obj;
@@ -279,9 +309,9 @@ static Napi::Value buffer_rsp_to_js(Napi::Env env, const struct jsdrv_union_s *
     return env.Undefined(); // todo
 }
 
-static Napi::Value bin_to_js(Napi::Env env, const struct jsdrv_union_s * value) {
+static Napi::Value bin_to_js(Napi::Env env, const struct jsdrv_union_s * value, struct jsdrv_union_s ** owner) {
     switch (value->app) {
-        case JSDRV_PAYLOAD_TYPE_STREAM: return stream_to_js(env, value);
+        case JSDRV_PAYLOAD_TYPE_STREAM: return stream_to_js(env, value, owner);
         case JSDRV_PAYLOAD_TYPE_STATISTICS: return stats_to_js(env, value);
         case JSDRV_PAYLOAD_TYPE_BUFFER_INFO: return buffer_info_to_js(env, value);
         case JSDRV_PAYLOAD_TYPE_BUFFER_RSP: return buffer_rsp_to_js(env, value);
@@ -291,7 +321,8 @@ static Napi::Value bin_to_js(Napi::Env env, const struct jsdrv_union_s * value)
 }
 
 
-static Napi::Value union_to_js(Napi::Env env, const struct jsdrv_union_s * value) {
+static Napi::Value union_to_js(Napi::Env env, const struct jsdrv_union_s * value,
+                               struct jsdrv_union_s ** owner = NULL) {
     // https://github.com/nodejs/node-addon-api/blob/main/doc/value.md
     // printf("union_to_js type=%d\n", value->type);
     switch (value->type) {
@@ -303,7 +334,7 @@ static Napi::Value union_to_js(Napi::Env env, const struct jsdrv_union_s * value
             Napi::Function parse = json.Get("parse").As<Napi::Function>();
             return parse.Call(json, { json_string }).As<Napi::Object>();
         }
-        case JSDRV_UNION_BIN: return bin_to_js(env, value);
+        case JSDRV_UNION_BIN: return bin_to_js(env, value, owner);
         case JSDRV_UNION_F32: return Napi::Number::New(env, static_cast<double>(value->value.f32));
         case JSDRV_UNION_F64: return Napi::Number::New(env, static_cast<double>(value->value.f64));
         case JSDRV_UNION_U8:  return Napi::Number::New(env, static_cast<double>(value->value.u8));
@@ -341,17 +372,82 @@ Napi::Value JoulescopeDriver::query(const Napi::CallbackInfo& info) {
     return union_to_js(env, &v);
 }
 
+struct subscribe_message {
+    std::string topic;
+    struct jsdrv_union_s * value;  // malloc'd copy with the payload appended
+};
+
+enum subscribe_overflow_e {
+    SUBSCRIBE_OVERFLOW_DROP_NEWEST,     // keep the contiguous history, such as stream data
+    SUBSCRIBE_OVERFLOW_DROP_OLDEST,     // keep the latest values, such as statistics
+};
+
 struct subscribe_context {
     public:
     subscribe_context() {}
+    ~subscribe_context() {
+        for (auto & msg: pending) {
+            free(msg.value);
+        }
+    }
     std::string topic;
     uint8_t flags;
+    bool batch = false;
+    uint32_t queue_size = _SUBSCRIBE_QUEUE_SIZE;
+    enum subscribe_overflow_e overflow = SUBSCRIBE_OVERFLOW_DROP_NEWEST;
     Napi::ThreadSafeFunction fn;
+    Napi::FunctionReference status_fn;              // optional, JavaScript thread only
+    uint64_t drops_reported = 0;                    // JavaScript thread only
+    std::mutex mutex;                               // protects the members below
+    std::deque<struct subscribe_message> pending;   // awaiting the JavaScript thread
+    bool scheduled = false;                         // a NonBlockingCall is queued
+    uint64_t drops = 0;                             // total messages discarded on overflow
 };
 
+static Napi::Value message_to_js(Napi::Env env, struct subscribe_message & msg) {
+    Napi::Value v = union_to_js(env, msg.value, &msg.value);
+    free(msg.value);  // NULL when an ArrayBuffer took ownership
+    msg.value = NULL;
+    return v;
+}
+
+static void _subscribe_deliver(Napi::Env env, Napi::Function jsCallback, struct subscribe_context * context) {
+    std::deque<struct subscribe_message> messages;
+    uint64_t drops;
+    {
+        std::lock_guard<std::mutex> lock(context->mutex);
+        messages.swap(context->pending);
+        context->scheduled = false;
+        drops = context->drops;
+    }
+    if ((drops != context->drops_reported) && !context->status_fn.IsEmpty()) {
+        Napi::Object status = Napi::Object::New(env);
+        status.Set("topic", context->topic);
+        status.Set("drops", static_cast<double>(drops - context->drops_reported));
+        status.Set("drops_total", static_cast<double>(drops));
+        context->drops_reported = drops;
+        context->status_fn.Call({status});
+    }
+    if (context->batch) {
+        Napi::Array topics = Napi::Array::New(env, messages.size());
+        Napi::Array values = Napi::Array::New(env, messages.size());
+        for (size_t idx = 0; idx < messages.size(); ++idx) {
+            topics[(uint32_t) idx] = Napi::String::New(env, messages[idx].topic);
+            values[(uint32_t) idx] = message_to_js(env, messages[idx]);
+        }
+        jsCallback.Call({topics, values});
+    } else {
+        for (auto & msg: messages) {
+            jsCallback.Call({Napi::String::New(env, msg.topic), message_to_js(env, msg)});
+        }
+    }
+    for (auto & msg: messages) {
+        free(msg.value);  // remaining after a JavaScript exception
+    }
+}
+
 void _subscribe_fn(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
     struct subscribe_context * context = (struct subscribe_context *) user_data;
-    std::string topic_str = topic;
     struct jsdrv_union_s * value_cpy = (struct jsdrv_union_s *) malloc(sizeof(*value) + value->size);
     if (NULL == value_cpy) {
         return;
@@ -364,20 +460,82 @@ void _subscribe_fn(void * user_data, const char * topic, const struct jsdrv_unio
         memcpy(ptr, value->value.bin, value->size);
     }
 
-    auto callback = [topic_str]( Napi::Env env, Napi::Function jsCallback, const struct jsdrv_union_s * value) {
-        jsCallback.Call( {Napi::String::New(env, topic_str), union_to_js(env, value)} );
-        free((void *) value);
-    };
+    // Coalesce messages that arrive while the JavaScript thread is busy
+    // into a single call, rather than one NonBlockingCall per message.
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(context->mutex);
+        if (context->pending.size() >= context->queue_size) {
+            ++context->drops;  // JavaScript is too far behind
+            if (SUBSCRIBE_OVERFLOW_DROP_NEWEST == context->overflow) {
+                free(value_cpy);
+                return;
+            }
+            free(context->pending.front().value);
+            context->pending.pop_front();
+        }
+        context->pending.push_back({topic, value_cpy});
+        if (!context->scheduled) {
+            context->scheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule && (napi_ok != context->fn.NonBlockingCall(context, _subscribe_deliver))) {
+        // closing, keep the messages pending for the destructor and retry on the next message
+        std::lock_guard<std::mutex> lock(context->mutex);
+        context->scheduled = false;
+    }
+}
+
+static bool subscribe_options_parse(Napi::Value value, struct subscribe_context * context) {
+    if (value.IsBoolean()) {
+        context->batch = value.As<Napi::Boolean>().Value();
+        return true;
+    } else if (!value.IsObject()) {
+        return value.IsUndefined() || value.IsNull();
+    }
+    Napi::Object options = value.As<Napi::Object>();
+    if (options.Has("batch")) {
+        context->batch = options.Get("batch").ToBoolean().Value();
+    }
+    if (options.Has("queue_size")) {
+        Napi::Value v = options.Get("queue_size");
+        if (!v.IsNumber() || (v.As<Napi::Number>().Int64Value() < 1)) {
+            return false;
+        }
+        context->queue_size = v.As<Napi::Number>().Uint32Value();
+    }
+    if (options.Has("overflow")) {
+        std::string overflow = options.Get("overflow").ToString();
+        if (overflow == "drop_newest") {
+            context->overflow = SUBSCRIBE_OVERFLOW_DROP_NEWEST;
+        } else if (overflow == "drop_oldest") {
+            context->overflow = SUBSCRIBE_OVERFLOW_DROP_OLDEST;
+        } else {
+            return false;
+        }
+    }
+    if (options.Has("status")) {
+        Napi::Value v = options.Get("status");
+        if (!v.IsFunction()) {
+            return false;
+        }
+        context->status_fn = Napi::Persistent(v.As<Napi::Function>());
+    }
+    return true;
+}
 
-    context->fn.NonBlockingCall(value_cpy, callback);
+static void _subscribe_finalize(Napi::Env env, struct subscribe_context * context) {
+    (void) env;
+    delete context;
 }
 
-Napi::Value JoulescopeDriver::subscribe(const Napi::CallbackInfo& info) {  // topic, flags, fn, timeout
+Napi::Value JoulescopeDriver::subscribe(const Napi::CallbackInfo& info) {  // topic, flags, fn, timeout, [options]
     // JSDRV_API int32_t jsdrv_subscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
     //        jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
     //        uint32_t timeout_ms);
     Napi::Env env = info.Env();
-    if (info.Length() != 4) {
+    if ((info.Length() < 4) || (info.Length() > 5)) {
         Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
         return env.Undefined();
     }
@@ -386,11 +544,21 @@ Napi::Value JoulescopeDriver::subscribe(const Napi::CallbackInfo& info) {  // to
     context->flags = (uint8_t) (info[1].As<Napi::Number>().Uint32Value());
     Napi::Function fn = info[2].As<Napi::Function>();
     uint32_t timeout_ms = parse_timeout(env, info[3]);
-    context->fn = Napi::ThreadSafeFunction::New(env, fn, "jsdrv_subscribe_fn", 0, 1);
+    // Stream data keeps contiguous history, other topics keep the latest values.
+    size_t topic_len = context->topic.size();
+    if ((topic_len < 5) || (context->topic.compare(topic_len - 5, 5, "!data") != 0)) {
+        context->overflow = SUBSCRIBE_OVERFLOW_DROP_OLDEST;
+    }
+    if ((info.Length() > 4) && !subscribe_options_parse(info[4], context)) {
+        delete context;
+        Napi::TypeError::New(env, "invalid subscribe options").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    context->fn = Napi::ThreadSafeFunction::New(env, fn, "jsdrv_subscribe_fn", 0, 1, context, _subscribe_finalize);
     int32_t status = jsdrv_subscribe(this->context_, context->topic.c_str(), context->flags,
                                      _subscribe_fn, context, timeout_ms);
     if (status) {
-        delete context;
+        context->fn.Release();  // finalizer deletes context
         napi_throw_error(env, NULL, "jsdrv_subscribe failed");
         return env.Undefined();
     }
@@ -398,8 +566,7 @@ Napi::Value JoulescopeDriver::subscribe(const Napi::CallbackInfo& info) {  // to
 
     auto unsub_fn = [env, jsdrv_context, context, timeout_ms](const Napi::CallbackInfo& info) -> Napi::Value {
         jsdrv_unsubscribe(jsdrv_context, context->topic.c_str(), _subscribe_fn, context, timeout_ms);
-        context->fn.Release();
-        delete context;
+        context->fn.Release();  // finalizer deletes context after queued calls complete
         return env.Undefined();
     };
     return Napi::Function::New(env, unsub_fn);
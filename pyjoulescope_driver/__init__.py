@@ -17,7 +17,8 @@ from . import time64
 from .record import Record
 
 try:
-    from .binding import Driver, ElementType, Field, ErrorCode, LogLevel, SubscribeFlags, calibration_hash
+    from .binding import Driver, ElementType, Field, ErrorCode, LogLevel, SubscribeFlags, calibration_hash, \
+        SharedStreamBridge, SharedStreamReader, time_from_counter, time_to_counter, time_from_counter_range, log_binary_open, log_binary_close
 except (ModuleNotFoundError, ImportError):
     print('Could not import cython binding')
 
@@ -26,6 +27,8 @@ __all__ = [
     'Driver', 'Record',
     'ElementType', 'Field', 'ErrorCode', 'LogLevel', 'SubscribeFlags',
     'calibration_hash',
+    'time_from_counter', 'time_to_counter', 'time_from_counter_range',
+    'log_binary_open', 'log_binary_close',
     'time64',
     '__version__', '__title__', '__description__', '__url__',
     '__author__', '__author_email__', '__license__',
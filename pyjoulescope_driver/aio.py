@@ -0,0 +1,291 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Use the Joulescope driver from an asyncio event loop.
+
+Publish, open, and close use the driver's asynchronous completion
+callbacks, so awaiting them never blocks the event loop or occupies
+a thread.  Subscriptions deliver values through bounded queues
+that the driver thread fills using loop.call_soon_threadsafe().
+"""
+
+from .binding import Driver, _handle_rc
+import asyncio
+import logging
+
+
+_QUEUE_SIZE_DEFAULT = 1000
+_STREAM_POLL_INTERVAL_DEFAULT = 0.01
+
+
+def _future_complete(future, topic, return_code):
+    if future.done():  # cancelled
+        return
+    try:
+        _handle_rc(return_code, 'publish', topic)
+        future.set_result(None)
+    except Exception as ex:
+        future.set_exception(ex)
+
+
+class Subscription:
+    """An asynchronous iterator over topic updates.
+
+    Use :meth:`AsyncDriver.subscribe` or :meth:`AsyncDriver.statistics`
+    to create instances.  Each item is the (topic, value) tuple.
+    When the consumer falls behind, the subscription discards the
+    oldest values and increments :attr:`drops`.
+    """
+
+    def __init__(self, loop, maxsize, unsubscribe_fn):
+        self._loop = loop
+        self._queue = asyncio.Queue(maxsize)
+        self._unsubscribe_fn = unsubscribe_fn
+        self.drops = 0
+
+    def _on_value(self, topic, value):
+        # called from the driver thread
+        self._loop.call_soon_threadsafe(self._put, topic, value)
+
+    def _put(self, topic, value):
+        if self._queue.full():
+            self._queue.get_nowait()
+            self.drops += 1
+        self._queue.put_nowait((topic, value))
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        if self._unsubscribe_fn is None and self._queue.empty():
+            raise StopAsyncIteration
+        return await self._queue.get()
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, exc_type, exc_value, traceback):
+        await self.close()
+
+    async def get(self, timeout=None):
+        """Get the next (topic, value) update.
+
+        :param timeout: The timeout in seconds.  None waits forever.
+        :raise TimeoutError: On timeout.
+        """
+        try:
+            return await asyncio.wait_for(self._queue.get(), timeout)
+        except asyncio.TimeoutError:
+            raise TimeoutError('subscription get timed out')
+
+    async def close(self):
+        """Unsubscribe."""
+        fn, self._unsubscribe_fn = self._unsubscribe_fn, None
+        if fn is not None:
+            await self._loop.run_in_executor(None, fn)
+
+
+class StreamIterator:
+    """An asynchronous iterator over contiguous stream data.
+
+    Use :meth:`AsyncDriver.stream` to create instances.  Each item
+    is the dict returned by :meth:`pyjoulescope_driver.binding.StreamRing.read`.
+    The driver fills a native ring without the GIL, and this iterator
+    polls the ring from the event loop.
+    """
+
+    def __init__(self, ring, poll_interval):
+        self._ring = ring
+        self._poll_interval = poll_interval
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        while self._ring is not None:
+            v = self._ring.read(timeout=0)
+            if v is not None:
+                return v
+            await asyncio.sleep(self._poll_interval)
+        raise StopAsyncIteration
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, exc_type, exc_value, traceback):
+        await self.close()
+
+    async def close(self):
+        """Unsubscribe and free the ring."""
+        ring, self._ring = self._ring, None
+        if ring is not None:
+            await asyncio.get_running_loop().run_in_executor(None, ring.close)
+
+
+class AsyncDriver:
+    """The asyncio interface to the Joulescope driver.
+
+    :param driver: The :class:`Driver` instance.  None (default)
+        creates a new instance which :meth:`finalize` also finalizes.
+
+    Use "async with AsyncDriver() as d:" to finalize automatically.
+    All methods must be called from the event loop thread.
+    """
+
+    def __init__(self, driver=None):
+        self._log = logging.getLogger(__name__)
+        self._owner = driver is None
+        self._driver = Driver() if driver is None else driver
+
+    @property
+    def driver(self):
+        """The underlying :class:`Driver` instance."""
+        return self._driver
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, exc_type, exc_value, traceback):
+        await self.finalize()
+
+    async def finalize(self):
+        """Finalize the driver, if owned."""
+        if self._owner and self._driver is not None:
+            driver, self._driver = self._driver, None
+            await asyncio.get_running_loop().run_in_executor(None, driver.finalize)
+
+    def _completion(self):
+        loop = asyncio.get_running_loop()
+        future = loop.create_future()
+
+        def on_complete(topic, return_code):
+            loop.call_soon_threadsafe(_future_complete, future, topic, return_code)
+
+        return future, on_complete
+
+    async def publish(self, topic, value, timeout=None):
+        """Publish a value to a topic.
+
+        :param topic: The topic string.
+        :param value: The value, see :meth:`Driver.publish`.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :raise: On error.
+        """
+        future, on_complete = self._completion()
+        self._driver.publish_async(topic, value, on_complete, timeout)
+        await future
+
+    async def open(self, device_prefix, mode=None, timeout=None):
+        """Open an attached device.
+
+        :param device_prefix: The prefix name for the device.
+        :param mode: The open mode, see :meth:`Driver.open`.
+        :param timeout: The timeout in seconds.  None uses the default timeout.
+        :raise: On error.
+        """
+        future, on_complete = self._completion()
+        self._driver.open_async(device_prefix, on_complete, mode, timeout)
+        await future
+
+    async def close(self, device_prefix, timeout=None):
+        """Close an attached device.
+
+        :param device_prefix: The prefix name for the device.
+        :param timeout: The timeout in seconds.  None uses the default timeout.
+        :raise: On error.
+        """
+        future, on_complete = self._completion()
+        self._driver.close_async(device_prefix, on_complete, timeout)
+        await future
+
+    async def query(self, topic, timeout=None):
+        """Query the value for a topic.
+
+        :param topic: The topic name.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :return: The value for the topic.
+
+        The driver only supports blocking queries, so this method
+        runs the query in the default executor.
+        """
+        return await asyncio.get_running_loop().run_in_executor(None, self._driver.query, topic, timeout)
+
+    async def device_paths(self, timeout=None):
+        """List the currently connected devices.
+
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :return: The list of device path strings.
+        """
+        return await asyncio.get_running_loop().run_in_executor(None, self._driver.device_paths, timeout)
+
+    async def subscribe(self, topic, flags=None, maxsize=None, timeout=None):
+        """Subscribe to topic updates.
+
+        :param topic: The topic string.
+        :param flags: The subscribe flags, see :meth:`Driver.subscribe`.
+            None (default) is ['pub'].
+        :param maxsize: The maximum number of queued updates.
+            None (default) is 1000.
+        :param timeout: The subscribe timeout in seconds.
+        :return: The :class:`Subscription` asynchronous iterator.
+        """
+        loop = asyncio.get_running_loop()
+        flags = ['pub'] if flags is None else flags
+        s = Subscription(loop, _QUEUE_SIZE_DEFAULT if maxsize is None else int(maxsize), None)
+        fn = s._on_value  # bind once for unsubscribe
+        await loop.run_in_executor(None, self._driver.subscribe, topic, flags, fn, timeout)
+        s._unsubscribe_fn = lambda: self._driver.unsubscribe(topic, fn, timeout)
+        return s
+
+    async def statistics(self, topic, batch=None, maxsize=None, timeout=None):
+        """Subscribe to statistics updates as numpy structured arrays.
+
+        :param topic: The statistics topic, such as "u/js220/000415/s/stats/value".
+        :param batch: The number of updates in each array, see
+            :meth:`Driver.statistics_subscribe`.
+        :param maxsize: The maximum number of queued arrays.
+            None (default) is 1000.
+        :param timeout: The subscribe timeout in seconds.
+        :return: The :class:`Subscription` asynchronous iterator.
+            Each value is a copy, so consumers may retain it.
+        """
+        loop = asyncio.get_running_loop()
+        s = Subscription(loop, _QUEUE_SIZE_DEFAULT if maxsize is None else int(maxsize), None)
+
+        def fn(t, data):
+            s._on_value(t, data.copy())
+
+        await loop.run_in_executor(None, self._driver.statistics_subscribe, topic, fn, batch, timeout)
+        s._unsubscribe_fn = lambda: self._driver.statistics_unsubscribe(topic, fn, timeout)
+        return s
+
+    async def stream(self, topic, size=None, read_size=None, poll_interval=None, timeout=None):
+        """Iterate over stream data.
+
+        :param topic: The stream data topic, such as "u/js220/000415/s/i/!data".
+        :param size: The ring size in bytes, see :meth:`Driver.stream_ring`.
+        :param read_size: The maximum bytes for each item.
+        :param poll_interval: The ring poll interval in seconds when empty.
+            None (default) is 0.01.
+        :param timeout: The subscribe timeout in seconds.
+        :return: The :class:`StreamIterator` asynchronous iterator.
+        """
+        poll_interval = _STREAM_POLL_INTERVAL_DEFAULT if poll_interval is None else float(poll_interval)
+        ring = await asyncio.get_running_loop().run_in_executor(
+            None, self._driver.stream_ring, topic, size, read_size, timeout)
+        return StreamIterator(ring, poll_interval)
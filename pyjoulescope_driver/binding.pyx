@@ -25,7 +25,8 @@ Python binding for the native Joulescope driver implementation.
 from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t, int8_t, int16_t, int32_t, int64_t
 from libc.float cimport DBL_MAX
 from libc.math cimport isfinite, NAN
-from libc.string cimport memset, strcpy
+from libc.string cimport memcpy, memset, strcpy
+from cpython.ref cimport Py_INCREF, Py_DECREF
 
 from collections.abc import Mapping
 import json
@@ -37,7 +38,8 @@ cimport numpy as np
 from . cimport c_jsdrv
 
 
-__all__ = ['Driver', 'calibration_hash']
+__all__ = ['Driver', 'Recorder', 'SharedStreamBridge', 'SharedStreamReader', 'StreamReader', 'StreamRing',
+           'Topic', 'calibration_hash', 'raw_cal_apply', 'statistics_dtype', 'u1_unpack', 'u4_unpack']
 np.import_array()                           # initialize numpy before use
 _log_c_name = 'jsdrv'
 _log_c = logging.getLogger(_log_c_name)
@@ -49,6 +51,7 @@ class ElementType:
     INT = 2             #: signed integer
     UINT = 3            #: unsigned integer
     FLOAT = 4           #: floating point
+    HOLD = 16           #: jsdrv_stream_hold_s deadband hold record
 
 
 class Field:
@@ -61,6 +64,11 @@ class Field:
     GPI       = 5       #: general purpose input
     UART      = 6       #: UART
     RAW       = 7       #: raw ADC data
+    CHARGE    = 8       #: host-side cumulative charge
+    ENERGY    = 9       #: host-side cumulative energy
+    RMS       = 10      #: host-side windowed RMS current
+    SUMMARY   = 11      #: host-side windowed summary: 0=current, 1=voltage, 2=power
+    EDGE      = 12      #: host-side general purpose input edge events
 
 
 _element_type_to_prefix = {
@@ -79,9 +87,49 @@ _field_to_meta = {
     Field.GPI:     ['gpi',           '',    None,  True],
     Field.UART:    ['uart',          'u',   None,  True],
     Field.RAW:     ['raw',           'z',   None,  True],
+    Field.CHARGE:  ['charge',        'q',   'C',   False],
+    Field.ENERGY:  ['energy',        'e',   'J',   False],
+    Field.RMS:     ['current_rms',   'irms', 'A',   False],
+    Field.SUMMARY: ['summary',       's',   None,  True],
+    Field.EDGE:    ['gpi_edge',      'edge', None, True],
 }
 
 
+_summary_dtype = np.dtype([('avg', np.float32), ('std', np.float32), ('min', np.float32), ('max', np.float32)])
+_edge_dtype = np.dtype([('sample_id', np.uint64), ('level', np.uint8), ('rsv', np.uint8, (7,))])
+
+statistics_dtype = np.dtype([
+    ('version', np.uint8),
+    ('rsv1_u8', np.uint8),
+    ('rsv2_u8', np.uint8),
+    ('decimate_factor', np.uint8),
+    ('block_sample_count', np.uint32),
+    ('sample_freq', np.uint32),
+    ('rsv3_u8', np.uint32),
+    ('block_sample_id', np.uint64),
+    ('accum_sample_id', np.uint64),
+    ('i_avg', np.float64),
+    ('i_std', np.float64),
+    ('i_min', np.float64),
+    ('i_max', np.float64),
+    ('v_avg', np.float64),
+    ('v_std', np.float64),
+    ('v_min', np.float64),
+    ('v_max', np.float64),
+    ('p_avg', np.float64),
+    ('p_std', np.float64),
+    ('p_min', np.float64),
+    ('p_max', np.float64),
+    ('charge_f64', np.float64),
+    ('energy_f64', np.float64),
+    ('charge_i128', np.uint64, (2,)),
+    ('energy_i128', np.uint64, (2,)),
+    ('time_map', [('offset_time', np.int64), ('offset_counter', np.uint64), ('counter_rate', np.float64)]),
+])  #: The numpy dtype for jsdrv_statistics_s, see :meth:`Driver.statistics_subscribe`.
+
+if statistics_dtype.itemsize != sizeof(c_jsdrv.jsdrv_statistics_s):
+    raise ImportError('statistics_dtype does not match jsdrv_statistics_s')
+
 cdef object _i128_to_int(uint64_t high, uint64_t low):
     i = int(high) << 64
     i |= int(low)
@@ -90,6 +138,80 @@ cdef object _i128_to_int(uint64_t high, uint64_t low):
     return i
 
 
+cdef object _parse_statistics(c_jsdrv.jsdrv_statistics_s * stats, source):
+    sample_freq = stats[0].sample_freq
+    samples_full_rate = stats[0].block_sample_count * stats[0].decimate_factor
+    sample_id_start = stats[0].block_sample_id
+    sample_id_end = stats[0].block_sample_id + samples_full_rate
+    t_start = sample_id_start / sample_freq
+    t_delta = samples_full_rate / sample_freq
+    charge = _i128_to_int(stats[0].charge_i128[1], stats[0].charge_i128[0])
+    energy = _i128_to_int(stats[0].energy_i128[1], stats[0].energy_i128[0])
+    return {
+        'time': {
+            'samples': {'value': [sample_id_start, sample_id_end], 'units': 'samples'},
+            'utc': {
+                'value': [
+                    c_jsdrv.jsdrv_time_from_counter(&stats[0].time_map, sample_id_start),
+                    c_jsdrv.jsdrv_time_from_counter(&stats[0].time_map, sample_id_end),
+                ],
+                'units': 'time64',
+            },
+            'sample_freq': {'value': sample_freq, 'units': 'Hz'},
+            'range': {'value': [t_start, t_start + t_delta], 'units': 's'},
+            'delta': {'value': t_delta, 'units': 's'},
+            'decimate_factor': {'value': stats[0].decimate_factor, 'units': 'samples'},
+            'decimate_sample_count': {'value': stats[0].block_sample_count, 'units': 'samples'},
+            'accum_samples': {'value': [stats[0].accum_sample_id, sample_id_end], 'units': 'samples'},
+            'time_map': {
+                'offset_time': stats[0].time_map.offset_time,
+                'offset_counter': stats[0].time_map.offset_counter,
+                'counter_rate': stats[0].time_map.counter_rate,
+            }
+        },
+        'signals': {
+            'current': {
+                'avg': {'value': stats[0].i_avg, 'units': 'A'},
+                'std': {'value': stats[0].i_std, 'units': 'A'},
+                'min': {'value': stats[0].i_min, 'units': 'A'},
+                'max': {'value': stats[0].i_max, 'units': 'A'},
+                'p2p': {'value': stats[0].i_max - stats[0].i_min, 'units': 'A'},
+                'integral': {'value': stats[0].i_avg * t_delta, 'units': 'C'},
+            },
+            'voltage': {
+                'avg': {'value': stats[0].v_avg, 'units': 'V'},
+                'std': {'value': stats[0].v_std, 'units': 'V'},
+                'min': {'value': stats[0].v_min, 'units': 'V'},
+                'max': {'value': stats[0].v_max, 'units': 'V'},
+                'p2p': {'value': stats[0].v_max - stats[0].v_min, 'units': 'V'},
+            },
+            'power': {
+                'avg': {'value': stats[0].p_avg, 'units': 'W'},
+                'std': {'value': stats[0].p_std, 'units': 'W'},
+                'min': {'value': stats[0].p_min, 'units': 'W'},
+                'max': {'value': stats[0].p_max, 'units': 'W'},
+                'p2p': {'value': stats[0].p_max - stats[0].p_min, 'units': 'W'},
+                'integral': {'value': stats[0].p_avg * t_delta, 'units': 'J'},
+            },
+        },
+        'accumulators': {
+            'charge': {
+                'value': stats[0].charge_f64,
+                'int_value': charge,
+                'int_scale': 2 ** -31,
+                'units': 'C',
+            },
+            'energy': {
+                'value': stats[0].energy_f64,
+                'int_value': energy,
+                'int_scale': 2 ** -27,
+                'units': 'J',
+            },
+        },
+        'source': source,
+    }
+
+
 cdef object _parse_buffer_info(c_jsdrv.jsdrv_buffer_info_s * info):
     element_prefix = _element_type_to_prefix[info[0].element_type]
     name, field_name, units, use_index = _field_to_meta[info[0].field_id]
@@ -132,11 +254,98 @@ cdef object _parse_buffer_info(c_jsdrv.jsdrv_buffer_info_s * info):
     return v
 
 
-cdef object _parse_buffer_rsp(c_jsdrv.jsdrv_buffer_response_s * r):
+cdef object _data_array(int nd, np.npy_intp * shape, int typenum, void * data, object owner):
+    ndarray = np.PyArray_SimpleNewFromData(nd, shape, typenum, data)
+    if owner is None:
+        return ndarray.copy()
+    np.set_array_base(ndarray, owner)  # owner keeps the driver message alive
+    ndarray.flags.writeable = False    # other subscribers may share the message
+    return ndarray
+
+
+cdef object _parse_spectrum(c_jsdrv.jsdrv_spectrum_s * s, object owner=None):
+    cdef np.npy_intp shape[1]
+    shape[0] = <np.npy_intp> s[0].bin_count
+    return {
+        'sample_id': s[0].sample_id,
+        'utc': c_jsdrv.jsdrv_time_from_counter(&s[0].time_map, s[0].sample_id),
+        'sample_rate': s[0].sample_rate,
+        'decimate_factor': s[0].decimate_factor,
+        'fft_length': s[0].fft_length,
+        'segment_count': s[0].segment_count,
+        'scale': 'power' if s[0].scale == c_jsdrv.JSDRV_SPECTRUM_SCALE_POWER else 'density',
+        'frequency_step': s[0].sample_rate / s[0].fft_length,
+        'time_map': {
+            'offset_time': s[0].time_map.offset_time,
+            'offset_counter': s[0].time_map.offset_counter,
+            'counter_rate': s[0].time_map.counter_rate,
+        },
+        'data': _data_array(1, shape, np.NPY_FLOAT32, <void *> &s[0].data[0], owner),
+    }
+
+
+cdef object _parse_interval(c_jsdrv.jsdrv_interval_s * x):
+    return {
+        'interval_id': x[0].interval_id,
+        'sample_id': [x[0].sample_id, x[0].sample_id_end],
+        'utc': [
+            c_jsdrv.jsdrv_time_from_counter(&x[0].time_map, x[0].sample_id),
+            c_jsdrv.jsdrv_time_from_counter(&x[0].time_map, x[0].sample_id_end),
+        ],
+        'sample_rate': x[0].sample_rate,
+        'decimate_factor': x[0].decimate_factor,
+        'partial': bool(x[0].flags & c_jsdrv.JSDRV_INTERVAL_FLAG_PARTIAL),
+        'current': {
+            'count': x[0].i_count,
+            'avg': {'value': x[0].i_avg, 'units': 'A'},
+            'min': {'value': x[0].i_min, 'units': 'A'},
+            'max': {'value': x[0].i_max, 'units': 'A'},
+        },
+        'power': {
+            'count': x[0].p_count,
+            'avg': {'value': x[0].p_avg, 'units': 'W'},
+            'min': {'value': x[0].p_min, 'units': 'W'},
+            'max': {'value': x[0].p_max, 'units': 'W'},
+        },
+        'charge': {
+            'value': x[0].charge_f64,
+            'int_value': _i128_to_int(x[0].charge_i128[1], x[0].charge_i128[0]),
+            'int_scale': 2 ** -31,
+            'units': 'C',
+        },
+        'energy': {
+            'value': x[0].energy_f64,
+            'int_value': _i128_to_int(x[0].energy_i128[1], x[0].energy_i128[0]),
+            'int_scale': 2 ** -31,
+            'units': 'J',
+        },
+    }
+
+
+cdef object _parse_quantiles(c_jsdrv.jsdrv_quantiles_s * x):
+    t0 = x[0].block_sample_id
+    t1 = t0 + x[0].block_sample_count * x[0].decimate_factor
+    q = ['p50', 'p90', 'p99', 'p99_9']
+    return {
+        'sample_id': [t0, t1],
+        'utc': [
+            c_jsdrv.jsdrv_time_from_counter(&x[0].time_map, t0),
+            c_jsdrv.jsdrv_time_from_counter(&x[0].time_map, t1),
+        ],
+        'sample_freq': x[0].sample_freq,
+        'decimate_factor': x[0].decimate_factor,
+        'current': dict([(q[k], {'value': x[0].i[k], 'units': 'A'}) for k in range(4)]),
+        'voltage': dict([(q[k], {'value': x[0].v[k], 'units': 'V'}) for k in range(4)]),
+        'power': dict([(q[k], {'value': x[0].p[k], 'units': 'W'}) for k in range(4)]),
+    }
+
+
+cdef object _parse_buffer_rsp(c_jsdrv.jsdrv_buffer_response_s * r, object owner=None):
     cdef np.npy_intp shape[2]
     v = {
         'version': r[0].version,
         'rsp_id': r[0].rsp_id,
+        'end': bool(r[0].flags & c_jsdrv.JSDRV_BUFFER_RESPONSE_FLAG_END),
         'info': _parse_buffer_info(&r[0].info),
     }
     length = v['info']['time_range_samples']['length']
@@ -146,29 +355,107 @@ cdef object _parse_buffer_rsp(c_jsdrv.jsdrv_buffer_response_s * r):
         element_type = info['element_type']
         if element_type == 'f32':
             shape[0] = <np.npy_intp> length
-            ndarray = np.PyArray_SimpleNewFromData(1, shape, np.NPY_FLOAT32, <void *> &r[0].data[0])
+            ndarray = _data_array(1, shape, np.NPY_FLOAT32, <void *> &r[0].data[0], owner)
+        elif element_type == 'u8':
+            shape[0] = <np.npy_intp> length
+            ndarray = _data_array(1, shape, np.NPY_UINT8, <void *> &r[0].data[0], owner)
         elif element_type == 'u1':
             shape[0] = <np.npy_intp> ((length + 7) // 8)
-            ndarray = np.PyArray_SimpleNewFromData(1, shape, np.NPY_UINT8, <void *> &r[0].data[0])
+            ndarray = _data_array(1, shape, np.NPY_UINT8, <void *> &r[0].data[0], owner)
         elif element_type == 'u4':
             shape[0] = <np.npy_intp> ((length + 1) // 2)
-            ndarray = np.PyArray_SimpleNewFromData(1, shape, np.NPY_UINT8, <void *> &r[0].data[0])
+            ndarray = _data_array(1, shape, np.NPY_UINT8, <void *> &r[0].data[0], owner)
         else:
             _log_c.error('unsupported sample format')
             return
         v['data_type'] = info['element_type']
-        v['data'] = ndarray.copy()
+        v['data'] = ndarray
+    elif r[0].response_type == c_jsdrv.JSDRV_BUFFER_RESPONSE_RESAMPLED:
+        v['response_type'] = 'resampled'
+        shape[0] = <np.npy_intp> length
+        ndarray = _data_array(1, shape, np.NPY_FLOAT32, <void *> &r[0].data[0], owner)
+        v['data_type'] = 'f32'
+        v['data'] = ndarray
+    elif r[0].response_type == c_jsdrv.JSDRV_BUFFER_RESPONSE_SEARCH:
+        v['response_type'] = 'search'
+        shape[0] = <np.npy_intp> length
+        ndarray = _data_array(1, shape, np.NPY_UINT64, <void *> &r[0].data[0], owner)
+        v['data_type'] = 'u64'
+        v['data'] = ndarray
+    elif r[0].response_type == c_jsdrv.JSDRV_BUFFER_RESPONSE_STATISTICS:
+        v['response_type'] = 'statistics'
+        if length:
+            v['data'] = _parse_statistics(<c_jsdrv.jsdrv_statistics_s *> &r[0].data[0], 'buffer')
+        else:
+            v['data'] = None
     elif r[0].response_type == c_jsdrv.JSDRV_BUFFER_RESPONSE_SUMMARY:
         v['response_type'] = 'summary'
         shape[0] = <np.npy_intp> length
         shape[1] = <np.npy_intp> 4
-        ndarray = np.PyArray_SimpleNewFromData(2, shape, np.NPY_FLOAT32, <void *> &r[0].data[0])
-        v['data'] = ndarray.copy()
+        ndarray = _data_array(2, shape, np.NPY_FLOAT32, <void *> &r[0].data[0], owner)
+        v['data'] = ndarray
     else:
         _log_c.error(f'unsupported response_type {r[0].response_type}')
     return v
 
 
+cdef object _parse_buffer_rsp_multi(c_jsdrv.jsdrv_buffer_response_multi_s * r, object owner=None):
+    cdef uint8_t * u8_ptr = <uint8_t *> &r[0].data[0]
+    cdef c_jsdrv.jsdrv_buffer_response_s * rsp
+    signals = []
+    for idx in range(r[0].signal_count):
+        rsp = <c_jsdrv.jsdrv_buffer_response_s *> u8_ptr
+        signals.append(_parse_buffer_rsp(rsp, owner))
+        sz = (rsp[0].info.time_range_samples.length * rsp[0].info.element_size_bits + 7) // 8
+        u8_ptr += (sizeof(c_jsdrv.jsdrv_buffer_response_s) + sz + 7) & ~7
+    return {
+        'version': r[0].version,
+        'rsp_id': r[0].rsp_id,
+        'signals': signals,
+    }
+
+
+cdef object _pack_buffer_req_multi(r):
+    cdef c_jsdrv.jsdrv_buffer_request_multi_s s
+    cdef const uint8_t[:] req_str = _pack_buffer_req(r)
+    cdef uint8_t * u8_ptr
+    signal_ids = r['signal_ids']
+    if not 0 < len(signal_ids) <= sizeof(s.signal_ids):
+        raise ValueError(f'invalid signal_ids: {signal_ids}')
+    memset(&s, 0, sizeof(s))
+    memcpy(&s.req, &req_str[0], sizeof(s.req))
+    s.signal_count = len(signal_ids)
+    for idx, signal_id in enumerate(signal_ids):
+        s.signal_ids[idx] = signal_id
+    u8_ptr = <uint8_t *> &s;
+    return bytes(u8_ptr[:sizeof(s)])
+
+
+_BUFFER_SEARCH_OPS = {
+    'rise': c_jsdrv.JSDRV_BUFFER_SEARCH_RISE,
+    'fall': c_jsdrv.JSDRV_BUFFER_SEARCH_FALL,
+    'cross': c_jsdrv.JSDRV_BUFFER_SEARCH_CROSS,
+    'max': c_jsdrv.JSDRV_BUFFER_SEARCH_MAX,
+    'min': c_jsdrv.JSDRV_BUFFER_SEARCH_MIN,
+}
+
+
+cdef object _pack_buffer_search(r):
+    cdef c_jsdrv.jsdrv_buffer_search_s s
+    cdef const uint8_t[:] req_str = _pack_buffer_req(r)
+    cdef uint8_t * u8_ptr
+    op = r['op'].lower()
+    if op not in _BUFFER_SEARCH_OPS:
+        raise ValueError(f'invalid search op: {op}')
+    memset(&s, 0, sizeof(s))
+    memcpy(&s.req, &req_str[0], sizeof(s.req))
+    s.op = _BUFFER_SEARCH_OPS[op]
+    s.threshold = float(r.get('threshold', 0.0))
+    s.hits_max = int(r.get('hits_max', 0))
+    u8_ptr = <uint8_t *> &s;
+    return bytes(u8_ptr[:sizeof(s)])
+
+
 cdef object _pack_buffer_req(r):
     cdef const uint8_t[:] rsp_topic_str = r['rsp_topic'].encode('utf-8')
     cdef c_jsdrv.jsdrv_buffer_request_s s
@@ -188,9 +475,19 @@ cdef object _pack_buffer_req(r):
         s.time.samples.length = r.get('length', 0)
     else:
         raise ValueError(f'invalid time type: {time_type}')
-    s.rsv1_u8 = 0
+    s.flags = 0
+    if r.get('chunked', False):
+        s.flags |= c_jsdrv.JSDRV_BUFFER_REQUEST_FLAG_CHUNKED
+    if r.get('unpack', False):
+        s.flags |= c_jsdrv.JSDRV_BUFFER_REQUEST_FLAG_UNPACK
+    if r.get('tile', False):
+        s.flags |= c_jsdrv.JSDRV_BUFFER_REQUEST_FLAG_TILE
+    if r.get('supersede', False):
+        s.flags |= c_jsdrv.JSDRV_BUFFER_REQUEST_FLAG_SUPERSEDE
+    if r.get('background', False):
+        s.flags |= c_jsdrv.JSDRV_BUFFER_REQUEST_FLAG_BACKGROUND
     s.rsv2_u8 = 0
-    s.rsv3_u32 = 0
+    s.sample_rate = int(r.get('sample_rate', 0))
     strcpy(s.rsp_topic, <const char *> &rsp_topic_str[0])
     s.rsp_id = int(r['rsp_id'])
 
@@ -199,11 +496,11 @@ cdef object _pack_buffer_req(r):
 
 
 
-cdef object _jsdrv_union_to_py(const c_jsdrv.jsdrv_union_s * value):
+cdef object _jsdrv_union_to_py(const c_jsdrv.jsdrv_union_s * value, bint packed=False, object owner=None):
     cdef c_jsdrv.jsdrv_stream_signal_s * stream;
+    cdef c_jsdrv.jsdrv_stream_hold_s * hold
     cdef np.npy_intp shape[1]
-    cdef uint8_t[:] u8_mem
-    cdef int32_t idx
+    cdef uint8_t[::1] u8_mem
     t = value[0].type
     try:
         if t == c_jsdrv.JSDRV_UNION_STR:
@@ -229,113 +526,71 @@ cdef object _jsdrv_union_to_py(const c_jsdrv.jsdrv_union_s * value):
                         'offset_time': stream[0].time_map.offset_time,
                         'offset_counter': stream[0].time_map.offset_counter,
                         'counter_rate': stream[0].time_map.counter_rate,
-                    }
+                    },
+                    'host_time': {
+                        'usb': stream[0].host_time.usb,
+                        'dispatch': stream[0].host_time.dispatch,
+                        'publish': stream[0].host_time.publish,
+                    },
                 }
-                if el == (c_jsdrv.JSDRV_DATA_TYPE_FLOAT, 32):  # float32
+                if el == (c_jsdrv.JSDRV_DATA_TYPE_HOLD, 192):  # jsdrv_stream_hold_s, expand to float32
+                    hold = <c_jsdrv.jsdrv_stream_hold_s *> stream[0].data
+                    v['hold'] = {
+                        'sample_count': hold[0].sample_count,
+                        'min': hold[0].min,
+                        'max': hold[0].max,
+                        'mean': hold[0].mean,
+                    }
+                    v['data'] = np.full(hold[0].sample_count, hold[0].mean, dtype=np.float32)
+                elif el == (c_jsdrv.JSDRV_DATA_TYPE_FLOAT, 32):  # float32
+                    shape[0] = <np.npy_intp> stream[0].element_count
+                    v['data'] = _data_array(1, shape, np.NPY_FLOAT32, <void *> stream[0].data, owner)
+                elif el == (c_jsdrv.JSDRV_DATA_TYPE_FLOAT, 64):  # float64
                     shape[0] = <np.npy_intp> stream[0].element_count
-                    ndarray = np.PyArray_SimpleNewFromData(1, shape, np.NPY_FLOAT32, <void *> stream[0].data)
-                    v['data'] = ndarray.copy()
+                    v['data'] = _data_array(1, shape, np.NPY_FLOAT64, <void *> stream[0].data, owner)
+                elif stream[0].field_id == c_jsdrv.JSDRV_FIELD_EDGE or (
+                        stream[0].field_id == c_jsdrv.JSDRV_FIELD_RANGE and el == (c_jsdrv.JSDRV_DATA_TYPE_UNDEFINED, 128)):  # jsdrv_edge_s
+                    shape[0] = <np.npy_intp> (stream[0].element_count * 16)
+                    v['data'] = _data_array(1, shape, np.NPY_UINT8, <void *> stream[0].data, owner).view(_edge_dtype)
+                elif el == (c_jsdrv.JSDRV_DATA_TYPE_UNDEFINED, 128):  # jsdrv_summary_entry_s
+                    shape[0] = <np.npy_intp> (stream[0].element_count * 4)
+                    v['data'] = _data_array(1, shape, np.NPY_FLOAT32, <void *> stream[0].data, owner).view(_summary_dtype)
                 elif el == (c_jsdrv.JSDRV_DATA_TYPE_UINT, 1):  # uint1, 8 per uint8
                     shape[0] = <np.npy_intp> ((stream[0].element_count + 7) / 8)
-                    ndarray = np.PyArray_SimpleNewFromData(1, shape, np.NPY_UINT8, <void *> stream[0].data)
-                    v['data'] = ndarray.copy()
+                    v['data'] = _data_array(1, shape, np.NPY_UINT8, <void *> stream[0].data, owner)
                 elif el == (c_jsdrv.JSDRV_DATA_TYPE_INT, 16):  # int16
                     shape[0] = <np.npy_intp> stream[0].element_count
-                    ndarray = np.PyArray_SimpleNewFromData(1, shape, np.NPY_INT16, <void *> stream[0].data)
-                    v['data'] = ndarray.copy()
+                    v['data'] = _data_array(1, shape, np.NPY_INT16, <void *> stream[0].data, owner)
                 elif el == (c_jsdrv.JSDRV_DATA_TYPE_UINT, 8):  # uint8
                     shape[0] = <np.npy_intp> stream[0].element_count
-                    ndarray = np.PyArray_SimpleNewFromData(1, shape, np.NPY_UINT8, <void *> stream[0].data)
-                    v['data'] = ndarray.copy()
+                    v['data'] = _data_array(1, shape, np.NPY_UINT8, <void *> stream[0].data, owner)
+                elif el == (c_jsdrv.JSDRV_DATA_TYPE_UINT, 4) and packed:  # uint4, 2 per uint8
+                    shape[0] = <np.npy_intp> ((stream[0].element_count + 1) / 2)
+                    v['data'] = _data_array(1, shape, np.NPY_UINT8, <void *> stream[0].data, owner)
                 elif el == (c_jsdrv.JSDRV_DATA_TYPE_UINT, 4):  # uint4 -> uint8
                     # unpack to make i/range support easy
-                    # future uses may want to leave packed, so may need to check JSDRV_FIELD_RANGE
                     ndarray = np.empty(stream[0].element_count, dtype=np.uint8)
-                    u8_mem = ndarray
-                    for idx in range(0, stream[0].element_count >> 1):
-                        u8_mem[2 * idx] = stream[0].data[idx] & 0x0f
-                        u8_mem[2 * idx + 1] = (stream[0].data[idx] >> 4) & 0x0f
+                    if stream[0].element_count:
+                        u8_mem = ndarray
+                        c_jsdrv.jsdrv_u4_unpack(&u8_mem[0], stream[0].data, 0, stream[0].element_count)
                     v['data'] = ndarray
                 else:
                     print('jsdrv._jsdrv_union_to_py: unsupported data type')
                     v['data'] = None
             elif value[0].app == c_jsdrv.JSDRV_PAYLOAD_TYPE_STATISTICS:
-                stats = <c_jsdrv.jsdrv_statistics_s *> &(value[0].value.bin[0])
-                sample_freq = stats[0].sample_freq
-                samples_full_rate = stats[0].block_sample_count * stats[0].decimate_factor
-                sample_id_start = stats[0].block_sample_id
-                sample_id_end = stats[0].block_sample_id + samples_full_rate
-                t_start = sample_id_start / sample_freq
-                t_delta = samples_full_rate / sample_freq
-                charge = _i128_to_int(stats[0].charge_i128[1], stats[0].charge_i128[0])
-                energy = _i128_to_int(stats[0].energy_i128[1], stats[0].energy_i128[0])
-                v = {
-                    'time': {
-                        'samples': {'value': [sample_id_start, sample_id_end], 'units': 'samples'},
-                        'utc': {
-                            'value': [
-                                c_jsdrv.jsdrv_time_from_counter(&stats[0].time_map, sample_id_start),
-                                c_jsdrv.jsdrv_time_from_counter(&stats[0].time_map, sample_id_end),
-                            ],
-                            'units': 'time64',
-                        },
-                        'sample_freq': {'value': sample_freq, 'units': 'Hz'},
-                        'range': {'value': [t_start, t_start + t_delta], 'units': 's'},
-                        'delta': {'value': t_delta, 'units': 's'},
-                        'decimate_factor': {'value': stats[0].decimate_factor, 'units': 'samples'},
-                        'decimate_sample_count': {'value': stats[0].block_sample_count, 'units': 'samples'},
-                        'accum_samples': {'value': [stats[0].accum_sample_id, sample_id_end], 'units': 'samples'},
-                        'time_map': {
-                            'offset_time': stats[0].time_map.offset_time,
-                            'offset_counter': stats[0].time_map.offset_counter,
-                            'counter_rate': stats[0].time_map.counter_rate,
-                        }
-                    },
-                    'signals': {
-                        'current': {
-                            'avg': {'value': stats[0].i_avg, 'units': 'A'},
-                            'std': {'value': stats[0].i_std, 'units': 'A'},
-                            'min': {'value': stats[0].i_min, 'units': 'A'},
-                            'max': {'value': stats[0].i_max, 'units': 'A'},
-                            'p2p': {'value': stats[0].i_max - stats[0].i_min, 'units': 'A'},
-                            'integral': {'value': stats[0].i_avg * t_delta, 'units': 'C'},
-                        },
-                        'voltage': {
-                            'avg': {'value': stats[0].v_avg, 'units': 'V'},
-                            'std': {'value': stats[0].v_std, 'units': 'V'},
-                            'min': {'value': stats[0].v_min, 'units': 'V'},
-                            'max': {'value': stats[0].v_max, 'units': 'V'},
-                            'p2p': {'value': stats[0].v_max - stats[0].v_min, 'units': 'V'},
-                        },
-                        'power': {
-                            'avg': {'value': stats[0].p_avg, 'units': 'W'},
-                            'std': {'value': stats[0].p_std, 'units': 'W'},
-                            'min': {'value': stats[0].p_min, 'units': 'W'},
-                            'max': {'value': stats[0].p_max, 'units': 'W'},
-                            'p2p': {'value': stats[0].p_max - stats[0].p_min, 'units': 'W'},
-                            'integral': {'value': stats[0].p_avg * t_delta, 'units': 'J'},
-                        },
-                    },
-                    'accumulators': {
-                        'charge': {
-                            'value': stats[0].charge_f64,
-                            'int_value': charge,
-                            'int_scale': 2 ** -31,
-                            'units': 'C',
-                        },
-                        'energy': {
-                            'value': stats[0].energy_f64,
-                            'int_value': energy,
-                            'int_scale': 2 ** -27,
-                            'units': 'J',
-                        },
-                    },
-                    'source': 'sensor',
-                }
+                v = _parse_statistics(<c_jsdrv.jsdrv_statistics_s *> &(value[0].value.bin[0]), 'sensor')
             elif value[0].app == c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_INFO:
                 v = _parse_buffer_info(<c_jsdrv.jsdrv_buffer_info_s *> &(value[0].value.bin[0]))
             elif value[0].app == c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_RSP:
-                v = _parse_buffer_rsp(<c_jsdrv.jsdrv_buffer_response_s *> &(value[0].value.bin[0]))
+                v = _parse_buffer_rsp(<c_jsdrv.jsdrv_buffer_response_s *> &(value[0].value.bin[0]), owner)
+            elif value[0].app == c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI:
+                v = _parse_buffer_rsp_multi(<c_jsdrv.jsdrv_buffer_response_multi_s *> &(value[0].value.bin[0]), owner)
+            elif value[0].app == c_jsdrv.JSDRV_PAYLOAD_TYPE_SPECTRUM:
+                v = _parse_spectrum(<c_jsdrv.jsdrv_spectrum_s *> &(value[0].value.bin[0]), owner)
+            elif value[0].app == c_jsdrv.JSDRV_PAYLOAD_TYPE_INTERVAL:
+                v = _parse_interval(<c_jsdrv.jsdrv_interval_s *> &(value[0].value.bin[0]))
+            elif value[0].app == c_jsdrv.JSDRV_PAYLOAD_TYPE_QUANTILES:
+                v = _parse_quantiles(<c_jsdrv.jsdrv_quantiles_s *> &(value[0].value.bin[0]))
             else:
                 v = value[0].value.bin[:value[0].size]
         elif t == c_jsdrv.JSDRV_UNION_F32:
@@ -541,6 +796,7 @@ class SubscribeFlags:
     QUERY_REQ = (1 << 4)    #: Subscribe to receive query requests like "&", "a/b/&", and "a/b/c&".
     QUERY_RSP = (1 << 5)    #: Subscribe to receive query responses like "a/b/c?".
     RETURN_CODE = (1 << 6)  #: Subscribe to receive return code messages like "a/b/c#".
+    STREAM = (1 << 7)       #: Mark a streaming topic like "a/b/!data" for the fast path.
 
 
 _SUBSCRIBE_FLAG_LOOKUP = {
@@ -554,6 +810,7 @@ _SUBSCRIBE_FLAG_LOOKUP = {
     'query_req': SubscribeFlags.QUERY_REQ,
     'query_rsp': SubscribeFlags.QUERY_RSP,
     'return_code': SubscribeFlags.RETURN_CODE,
+    'stream': SubscribeFlags.PUB | SubscribeFlags.STREAM,
 }
 
 
@@ -595,6 +852,68 @@ def _handle_rc(rc, src, cause=None):
             raise RuntimeError(f'{src} failed {rc} {name} | {description}{cause}')
 
 
+cdef object _py_to_jsdrv_union(topic, value, c_jsdrv.jsdrv_union_s * v):
+    """Convert a Python value to a publish value.
+
+    :return: The Python object that owns the string or binary data,
+        which must remain alive while v is in use.
+    """
+    cdef char * byte_str
+    memset(v, 0, sizeof(v[0]))
+    if isinstance(value, str):
+        value = value.encode('utf-8')
+        byte_str = value
+        v[0].type = c_jsdrv.JSDRV_UNION_STR
+        v[0].value.str = &byte_str[0]
+    elif isinstance(value, int):
+        if (value >= 0) and (value < 4294967296LL):
+            v[0].type = c_jsdrv.JSDRV_UNION_U32
+            v[0].value.u64 = value
+        elif value >= 0:
+            v[0].type = c_jsdrv.JSDRV_UNION_U64
+            v[0].value.u64 = value
+        elif value >= -2147483648LL:
+            v[0].type = c_jsdrv.JSDRV_UNION_I32
+            v[0].value.i64 = value
+        else:
+            v[0].type = c_jsdrv.JSDRV_UNION_I64
+            v[0].value.i64 = value
+    elif topic.startswith('m/') and (topic.endswith('/g/!req') or topic.endswith('/g/!stats')):
+        value = _pack_buffer_req_multi(value)
+        byte_str = value
+        v[0].type = c_jsdrv.JSDRV_UNION_BIN
+        v[0].value.bin = <const uint8_t *> byte_str
+        v[0].app = c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_REQ_MULTI
+        v[0].size = <uint32_t> len(value)
+    elif topic.startswith('m/') and topic.endswith('/!search'):
+        value = _pack_buffer_search(value)
+        byte_str = value
+        v[0].type = c_jsdrv.JSDRV_UNION_BIN
+        v[0].value.bin = <const uint8_t *> byte_str
+        v[0].app = c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_SEARCH
+        v[0].size = <uint32_t> len(value)
+    elif topic.startswith('m/') and topic.endswith('/!req'):
+        value = _pack_buffer_req(value)
+        byte_str = value
+        v[0].type = c_jsdrv.JSDRV_UNION_BIN
+        v[0].value.bin = <const uint8_t *> byte_str
+        v[0].app = c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_REQ
+        v[0].size = <uint32_t> len(value)
+    elif isinstance(value, bytes):
+        byte_str = value
+        v[0].type = c_jsdrv.JSDRV_UNION_BIN
+        v[0].value.bin = <const uint8_t *> byte_str
+        v[0].size = <uint32_t> len(value)
+    elif isinstance(value, float):
+        v[0].type = c_jsdrv.JSDRV_UNION_F64
+        v[0].value.f64 = value
+    else:
+        raise ValueError(f'Unsupported value type: {type(value)}')
+    if '!' not in topic:
+        v[0].flags = c_jsdrv.JSDRV_UNION_FLAG_RETAIN
+    return value
+
+
 cdef class Driver:
     """The Joulescope driver class.
 
@@ -603,6 +922,11 @@ cdef class Driver:
     """
     cdef c_jsdrv.jsdrv_context_s * _context
     cdef object _subscribers
+    cdef object _rings
+    cdef object _recorders
+    cdef object _bridges
+    cdef object _statistics_subscribers
+    cdef object _zero_copy_subscribers
 
     def __init__(self, timeout=None):
         global _driver_count
@@ -612,7 +936,12 @@ cdef class Driver:
         with nogil:
             rc = c_jsdrv.jsdrv_initialize(&self._context, NULL, timeout_ms)
         _handle_rc(rc, 'jsdrv_initialize')
-        self._subscribers = set()  # (topic, fn)
+        self._subscribers = set()  # (topic, fn, packed)
+        self._rings = set()
+        self._recorders = set()
+        self._bridges = set()
+        self._statistics_subscribers = {}  # (topic, fn): _StatisticsBatch
+        self._zero_copy_subscribers = {}  # (topic, fn): _ZeroCopySubscriber
         if _driver_count == 0:
             c_jsdrv.jsdrv_log_initialize()
             c_jsdrv.jsdrv_log_register(_on_log_recv, NULL)
@@ -651,9 +980,20 @@ cdef class Driver:
         global _driver_count
         cdef c_jsdrv.jsdrv_context_s * context = self._context
         timeout_ms = _timeout_validate(timeout)
+        for recorder in list(self._recorders):
+            try:
+                recorder.close()  # needs the context to unsubscribe
+            except Exception:
+                _log_c.exception('recorder close failed')
+        for bridge in list(self._bridges):
+            bridge.close()  # needs the context to unsubscribe
         with nogil:
             c_jsdrv.jsdrv_finalize(context, timeout_ms)
             c_jsdrv.jsdrv_log_finalize()
+        self._context = NULL  # zero-copy arrays must not release after finalize
+        for ring in list(self._rings):
+            ring._free()  # no more callbacks after finalize
+        self._rings.clear()
         _driver_count -= 1
 
     def publish(self, topic: str, value, timeout=None):
@@ -666,52 +1006,88 @@ cdef class Driver:
         :raise: On error.
         """
         cdef c_jsdrv.jsdrv_union_s v
-        cdef char * byte_str
         cdef const uint8_t[:] topic_str = topic.encode('utf-8')
         cdef int32_t timeout_ms = _timeout_validate(timeout)
 
-        memset(&v, 0, sizeof(v))
-        if isinstance(value, str):
-            py_byte_str = value.encode('utf-8')
-            byte_str = py_byte_str
-            v.type = c_jsdrv.JSDRV_UNION_STR
-            v.value.str = &byte_str[0]
-        elif isinstance(value, int):
-            if (value >= 0) and (value < 4294967296LL):
-                v.type = c_jsdrv.JSDRV_UNION_U32
-                v.value.u64 = value
-            elif value >= 0:
-                v.type = c_jsdrv.JSDRV_UNION_U64
-                v.value.u64 = value
-            elif value >= -2147483648LL:
-                v.type = c_jsdrv.JSDRV_UNION_I32
-                v.value.i64 = value
-            else:
-                v.type = c_jsdrv.JSDRV_UNION_I64
-                v.value.i64 = value
-        elif topic.startswith('m/') and topic.endswith('/!req'):
-            value = _pack_buffer_req(value)
-            byte_str = value
-            v.type = c_jsdrv.JSDRV_UNION_BIN
-            v.value.bin = <const uint8_t *> byte_str
-            v.app = c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_REQ
-            v.size = <uint32_t> len(value)
-        elif isinstance(value, bytes):
-            byte_str = value
-            v.type = c_jsdrv.JSDRV_UNION_BIN
-            v.value.bin = <const uint8_t *> byte_str
-            v.size = <uint32_t> len(value)
-        elif isinstance(value, float):
-            v.type = c_jsdrv.JSDRV_UNION_F64
-            v.value.f64 = value
-        else:
-            raise ValueError(f'Unsupported value type: {type(value)}')
-        if '!' not in topic:
-            v.flags = c_jsdrv.JSDRV_UNION_FLAG_RETAIN
+        value = _py_to_jsdrv_union(topic, value, &v)
         with nogil:
             rc = c_jsdrv.jsdrv_publish(self._context, <char *> &topic_str[0], &v, timeout_ms)
         _handle_rc(rc, 'jsdrv_publish', topic)
 
+    def publish_async(self, topic: str, value, callback, timeout=None):
+        """Publish a value to a topic without blocking.
+
+        :param topic: The topic string.
+        :param value: The value, see :meth:`publish`.
+        :param callback: The function(topic, return_code) called exactly
+            once when the operation completes.  return_code is 0 on success,
+            :attr:`ErrorCode.TIMED_OUT` on timeout, or another error code.
+            The driver calls this function from its own thread,
+            so it must not block.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :raise: On error.
+        """
+        cdef c_jsdrv.jsdrv_union_s v
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        cdef void * cbk_ptr = <void *> callback
+        value = _py_to_jsdrv_union(topic, value, &v)
+        Py_INCREF(callback)  # released by _on_completion_cbk
+        with nogil:
+            rc = c_jsdrv.jsdrv_publish_async(self._context, <char *> &topic_str[0], &v, timeout_ms,
+                                             _on_completion_cbk, cbk_ptr)
+        if rc:
+            Py_DECREF(callback)
+        _handle_rc(rc, 'jsdrv_publish_async', topic)
+
+    def open_async(self, device_prefix, callback, mode=None, timeout=None):
+        """Open an attached device without blocking.
+
+        :param device_prefix: The prefix name for the device.
+        :param callback: The function(topic, return_code), see :meth:`publish_async`.
+        :param mode: The open mode, see :meth:`open`.
+        :param timeout: The timeout in seconds.  None uses the default timeout.
+        """
+        if isinstance(mode, str):
+            mode = mode.lower()
+        device_prefix = device_prefix.rstrip('/')
+        self.publish_async(device_prefix + '/@/!open', _DEVICE_OPEN_MODES[mode], callback, timeout)
+
+    def close_async(self, device_prefix, callback, timeout=None):
+        """Close an attached device without blocking.
+
+        :param device_prefix: The prefix name for the device.
+        :param callback: The function(topic, return_code), see :meth:`publish_async`.
+        :param timeout: The timeout in seconds.  None uses the default timeout.
+        """
+        device_prefix = device_prefix.rstrip('/')
+        self.publish_async(device_prefix + '/@/!close', 0, callback, timeout)
+
+    def profile_apply(self, device_prefix, profile, timeout=None):
+        """Apply a parameter profile, publishing only the changed values.
+
+        :param device_prefix: The prefix name for the device.
+        :param profile: The map of topics, relative to device_prefix,
+            to values.  Provide either a dict, which may nest, or
+            the equivalent JSON string.
+        :param timeout: The timeout in seconds shared by all changed
+            values.  None (default) uses the default timeout.
+        :return: The number of values published.
+        :raise: On error.
+        """
+        cdef uint32_t changed = 0
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        if not isinstance(profile, str):
+            profile = json.dumps(profile)
+        cdef const uint8_t[:] prefix_str = device_prefix.rstrip('/').encode('utf-8')
+        cdef const uint8_t[:] profile_str = profile.encode('utf-8')
+        with nogil:
+            rc = c_jsdrv.jsdrv_profile_apply_json(self._context, <char *> &prefix_str[0], <char *> &profile_str[0],
+                                                  &changed, timeout_ms)
+        _handle_rc(rc, 'jsdrv_profile_apply_json', device_prefix)
+        return changed
+
     def query(self, topic: str, timeout=None):
         """Query the value for a topic.
 
@@ -734,6 +1110,21 @@ cdef class Driver:
         _handle_rc(rc, 'jsdrv_query', topic)
         return _jsdrv_union_to_py(&v)
 
+    def topic(self, name: str, timeout=None):
+        """Prepare a topic for repeated publish and query.
+
+        :param name: The topic name.
+        :param timeout: The timeout in seconds for the metadata query.
+            None (default) uses the default timeout.
+        :return: The :class:`Topic` instance.
+        :raise ValueError: On an invalid topic name.
+
+        The topic name is encoded and validated once, and the metadata
+        dtype is queried once, so loops that publish to the same topic
+        avoid the per-call conversion of :meth:`publish`.
+        """
+        return Topic(self, name, timeout)
+
     def device_paths(self, timeout=None):
         """List the currently connected devices.
 
@@ -746,7 +1137,7 @@ cdef class Driver:
             return []
         return sorted(s.split(','))
 
-    def subscribe(self, topic: str, flags, fn, timeout=None):
+    def subscribe(self, topic: str, flags, fn, timeout=None, packed=False, zero_copy=False):
         """Subscribe to receive topic updates.
 
         :param self: The driver instance.
@@ -774,12 +1165,24 @@ cdef class Driver:
         :param timeout: The timeout in float seconds to wait for this operation
             to complete.  None waits the default amount.
             0 does not wait and subscription will occur asynchronously.
+        :param packed: False (default) unpacks 4-bit stream data to one
+            uint8 per sample.  True delivers 4-bit stream data packed
+            2 samples per byte, such as for pass-through to a file writer.
+            1-bit stream data is always packed.  See :func:`u4_unpack`
+            and :func:`u1_unpack`.
+        :param zero_copy: False (default) copies stream and buffer response
+            data into new numpy arrays.  True delivers read-only numpy arrays
+            that reference the driver message directly, which remains
+            allocated until all arrays that reference it are deleted.
+            Delete these arrays before :meth:`finalize` to avoid leaking
+            the message memory.
         :raise RuntimeError: on subscribe failure.
         """
         cdef const uint8_t[:] topic_str = topic.encode('utf-8')
         cdef int32_t timeout_ms = _timeout_validate(timeout)
         cdef int32_t c_flags = 0
         cdef void * fn_ptr = <void *> fn
+        cdef c_jsdrv.jsdrv_subscribe_fn cbk_fn = _on_cmd_publish_packed_cbk if packed else _on_cmd_publish_cbk
 
         if isinstance(flags, str):
             c_flags = _SUBSCRIBE_FLAG_LOOKUP[flags.lower()]
@@ -788,9 +1191,17 @@ cdef class Driver:
                 c_flags |= _SUBSCRIBE_FLAG_LOOKUP[f.lower()]
         else:
             c_flags = <int32_t> int(flags)
-        self._subscribers.add((topic, fn))
+        if zero_copy:
+            if (topic, fn) in self._zero_copy_subscribers:
+                raise ValueError(f'Already subscribed with zero_copy: {topic}')
+            s = _ZeroCopySubscriber(self, fn, packed)
+            self._zero_copy_subscribers[(topic, fn)] = s
+            fn_ptr = <void *> s
+            cbk_fn = _on_cmd_publish_zero_copy_cbk
+        else:
+            self._subscribers.add((topic, fn, bool(packed)))
         with nogil:
-            rc = c_jsdrv.jsdrv_subscribe(self._context, <char *> &topic_str[0], c_flags, _on_cmd_publish_cbk, fn_ptr, timeout_ms)
+            rc = c_jsdrv.jsdrv_subscribe(self._context, <char *> &topic_str[0], c_flags, cbk_fn, fn_ptr, timeout_ms)
         _handle_rc(rc, 'jsdrv_subscribe', topic)
 
     def unsubscribe(self, topic, fn, timeout=None):
@@ -805,10 +1216,24 @@ cdef class Driver:
         cdef const uint8_t[:] topic_str = topic.encode('utf-8')
         cdef int32_t timeout_ms = _timeout_validate(timeout)
         cdef void * fn_ptr = <void *> fn
-
-        with nogil:
-            rc = c_jsdrv.jsdrv_unsubscribe(self._context, <char *> &topic_str[0], _on_cmd_publish_cbk, fn_ptr, timeout_ms)
-        self._subscribers.discard((topic, fn))
+        cdef c_jsdrv.jsdrv_subscribe_fn cbk_fn
+        cdef int32_t rc = 0
+        cdef int32_t rc_next
+
+        s = self._zero_copy_subscribers.get((topic, fn))
+        if s is not None:
+            with nogil:
+                rc = c_jsdrv.jsdrv_unsubscribe(self._context, <char *> &topic_str[0],
+                                               _on_cmd_publish_zero_copy_cbk, <void *> s, timeout_ms)
+            if rc == 0:
+                del self._zero_copy_subscribers[(topic, fn)]  # otherwise keep alive for callbacks
+        packed_list = [p for p in (False, True) if (topic, fn, p) in self._subscribers]
+        for packed in (packed_list or ([] if s is not None else [False])):
+            cbk_fn = _on_cmd_publish_packed_cbk if packed else _on_cmd_publish_cbk
+            with nogil:
+                rc_next = c_jsdrv.jsdrv_unsubscribe(self._context, <char *> &topic_str[0], cbk_fn, fn_ptr, timeout_ms)
+            rc = rc if rc else rc_next
+            self._subscribers.discard((topic, fn, packed))
         _handle_rc(rc, 'jsdrv_unsubscribe', topic)
 
     def unsubscribe_all(self, fn, timeout=None):
@@ -821,13 +1246,170 @@ cdef class Driver:
         """
         cdef int32_t timeout_ms = _timeout_validate(timeout)
 
+        cdef void * fn_ptr = <void *> fn
+        cdef int32_t rc
+        cdef int32_t rc_packed
+
         with nogil:
-            rc = c_jsdrv.jsdrv_unsubscribe_all(self._context, _on_cmd_publish_cbk, <void *> fn, timeout_ms)
-        remove_list = [(t, f) for t, f in self._subscribers if f == fn]
+            rc = c_jsdrv.jsdrv_unsubscribe_all(self._context, _on_cmd_publish_cbk, fn_ptr, timeout_ms)
+            rc_packed = c_jsdrv.jsdrv_unsubscribe_all(self._context, _on_cmd_publish_packed_cbk, fn_ptr, timeout_ms)
+        rc = rc if rc else rc_packed
+        remove_list = [(t, f, p) for t, f, p in self._subscribers if f == fn]
         for item in remove_list:
             self._subscribers.discard(item)
+        for t, f in [k for k in self._zero_copy_subscribers.keys() if k[1] == fn]:
+            try:
+                self.unsubscribe(t, f, timeout)
+            except Exception:
+                rc = rc if rc else ErrorCode.UNSPECIFIED
         _handle_rc(rc, 'jsdrv_unsubscribe_all')
 
+    def statistics_subscribe(self, topic: str, fn, batch=None, timeout=None):
+        """Subscribe to receive statistics as numpy structured arrays.
+
+        :param topic: The statistics topic, such as "u/js220/000415/s/stats/value".
+        :param fn: The function(topic, data) to call with each batch.
+            data is a numpy array with dtype :data:`statistics_dtype`
+            and batch entries.
+        :param batch: The number of statistics updates for each call to fn.
+            None (default) is 1.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :raise: On error.
+
+        Unlike :meth:`subscribe`, which constructs a nested dict for
+        each update, this method copies each update into a preallocated
+        array in place.  fn receives the same array on every call,
+        so copy the data to keep it beyond the call.
+        """
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        key = (topic, fn)
+        if key in self._statistics_subscribers:
+            raise ValueError(f'Already subscribed: {topic}')
+        b = _StatisticsBatch(fn, 1 if batch is None else int(batch))
+        self._statistics_subscribers[key] = b
+        with nogil:
+            rc = c_jsdrv.jsdrv_subscribe(self._context, <char *> &topic_str[0], c_jsdrv.JSDRV_SFLAG_PUB,
+                                         _on_statistics_cbk, <void *> b, timeout_ms)
+        if rc:
+            self._statistics_subscribers.pop(key, None)
+        _handle_rc(rc, 'jsdrv_subscribe', topic)
+
+    def statistics_unsubscribe(self, topic: str, fn, timeout=None):
+        """Unsubscribe from :meth:`statistics_subscribe`.
+
+        :param topic: The statistics topic.
+        :param fn: The function previously provided to :meth:`statistics_subscribe`.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :raise: On error.
+
+        Any partial batch is discarded.
+        """
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        b = self._statistics_subscribers.get((topic, fn))
+        if b is None:
+            return
+        with nogil:
+            rc = c_jsdrv.jsdrv_unsubscribe(self._context, <char *> &topic_str[0],
+                                           _on_statistics_cbk, <void *> b, timeout_ms)
+        if rc == 0:
+            del self._statistics_subscribers[(topic, fn)]  # otherwise keep alive for callbacks
+        _handle_rc(rc, 'jsdrv_unsubscribe', topic)
+
+    def stream_ring(self, topic: str, size=None, read_size=None, timeout=None):
+        """Subscribe a native ring buffer to a stream data topic.
+
+        :param topic: The stream data topic, such as "u/js220/000415/s/i/!data".
+        :param size: The ring size in bytes, which must be a power of 2.
+            None (default) uses 32 MB.
+        :param read_size: The default buffer size in bytes for
+            :meth:`StreamRing.read`.  None (default) uses 1 MB.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :return: The :class:`StreamRing` instance.  Call
+            :meth:`StreamRing.close` when done.
+        :raise: On error.
+
+        Unlike :meth:`subscribe`, the driver copies each stream message into
+        the ring without acquiring the GIL or creating Python objects.
+        Call :meth:`StreamRing.read` from any Python thread to receive
+        many messages at once.
+        """
+        ring = StreamRing(self, topic, size, read_size, timeout)
+        self._rings.add(ring)
+        return ring
+
+    def stream_reader(self, topic: str, n_samples=None, duration=None, size=None, timeout=None):
+        """Read a stream data topic in fixed-size chunks.
+
+        :param topic: The stream data topic, such as "u/js220/000415/s/i/!data".
+        :param n_samples: The number of samples in each chunk.
+        :param duration: The chunk duration in seconds, as an alternative
+            to n_samples.
+        :param size: The ring size in bytes.  See :meth:`stream_ring`.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :return: The :class:`StreamReader` instance.  Call
+            :meth:`StreamReader.close` when done.
+        :raise: On error.
+
+        The reader copies stream messages into one contiguous numpy
+        array for each chunk without holding the GIL, so each chunk
+        costs one Python call rather than one callback per message.
+        """
+        reader = StreamReader(self, topic, n_samples, duration, size, timeout)
+        self._rings.add(reader.ring)
+        return reader
+
+    def recorder(self, path, buffer_size=None):
+        """Record stream data topics to a raw file.
+
+        :param path: The file path, which is overwritten.
+        :param buffer_size: The in-memory buffer size in bytes.
+            None (default) uses 64 MB.
+        :return: The :class:`Recorder` instance.  Call :meth:`Recorder.add`
+            for each stream data topic and :meth:`Recorder.close` when done.
+        :raise: On error.
+
+        The driver appends stream messages to large in-memory blocks
+        without acquiring the GIL, and a native thread writes the blocks
+        to the file.  Use :func:`pyjoulescope_driver.record_raw.to_jls`
+        to convert the file to JLS.
+        """
+        recorder = Recorder(self, path, buffer_size)
+        self._recorders.add(recorder)
+        return recorder
+
+    def shm_bridge(self, name, size=None, topics=None):
+        """Mirror topics into shared memory for other processes.
+
+        :param name: The shared-memory name, which must be unique on this host.
+        :param size: The ring size in bytes, which must be a power of 2.
+            None (default) uses 64 MB.
+        :param topics: The optional list of topics to mirror, which may
+            contain '+' and '#' wildcards.  Call
+            :meth:`SharedStreamBridge.add` to mirror more topics later.
+        :return: The :class:`SharedStreamBridge` instance.  Call
+            :meth:`SharedStreamBridge.close` when done.
+        :raise: On error.
+
+        The driver copies each mirrored message into the shared-memory
+        ring without acquiring the GIL.  Other processes attach with
+        :class:`SharedStreamReader` using the same name.
+        """
+        bridge = SharedStreamBridge(name, size, self)
+        self._bridges.add(bridge)
+        try:
+            for topic in ([] if topics is None else topics):
+                bridge.add(topic)
+        except Exception:
+            bridge.close()
+            raise
+        return bridge
+
     def open(self, device_prefix, mode=None, timeout=None):
         """Open an attached device.
 
@@ -882,8 +1464,917 @@ cdef class Driver:
         _handle_rc(rc, 'jsdrv_close', device_prefix)
 
 
-cdef void _on_cmd_publish_cbk(void * user_data, const char * topic,
-                              const c_jsdrv.jsdrv_union_s * value) noexcept with gil:
+_TOPIC_LENGTH_MAX = 64  # JSDRV_TOPIC_LENGTH_MAX, including the null terminator
+_TOPIC_DTYPES = {
+    'u8': (c_jsdrv.JSDRV_UNION_U8, 0, 0xff),
+    'u16': (c_jsdrv.JSDRV_UNION_U16, 0, 0xffff),
+    'u32': (c_jsdrv.JSDRV_UNION_U32, 0, 0xffffffff),
+    'u64': (c_jsdrv.JSDRV_UNION_U64, 0, 0xffffffffffffffff),
+    'i8': (c_jsdrv.JSDRV_UNION_I8, -0x80, 0x7f),
+    'i16': (c_jsdrv.JSDRV_UNION_I16, -0x8000, 0x7fff),
+    'i32': (c_jsdrv.JSDRV_UNION_I32, -0x80000000, 0x7fffffff),
+    'i64': (c_jsdrv.JSDRV_UNION_I64, -0x8000000000000000, 0x7fffffffffffffff),
+    'bool': (c_jsdrv.JSDRV_UNION_U8, 0, 1),
+    'f32': (c_jsdrv.JSDRV_UNION_F32, None, None),
+    'f64': (c_jsdrv.JSDRV_UNION_F64, None, None),
+}
+
+
+cdef class Topic:
+    """A prepared topic for repeated publish and query.
+
+    Use :meth:`Driver.topic` to create instances.
+
+    The topic is encoded and validated once.  When the topic has
+    metadata, :meth:`publish` converts numeric values directly to the
+    metadata dtype.  Other values, such as option names, use the same
+    conversion as :meth:`Driver.publish`.
+    """
+    cdef Driver _driver
+    cdef object _name
+    cdef bytes _name_bytes
+    cdef object _dtype
+    cdef uint8_t _union_type
+    cdef object _min
+    cdef object _max
+    cdef uint8_t _flags
+
+    def __init__(self, Driver driver, name, timeout=None):
+        name_bytes = name.encode('utf-8')
+        if not len(name_bytes) or len(name_bytes) >= _TOPIC_LENGTH_MAX:
+            raise ValueError(f'Invalid topic length: {name}')
+        if any(c.isspace() for c in name) or name[-1] in '/?$#%&':
+            raise ValueError(f'Invalid topic: {name}')
+        self._driver = driver
+        self._name = name
+        self._name_bytes = name_bytes
+        self._dtype = None
+        self._union_type = 0
+        self._min = None
+        self._max = None
+        self._flags = 0 if '!' in name else c_jsdrv.JSDRV_UNION_FLAG_RETAIN
+        if (len(name_bytes) + 1) < _TOPIC_LENGTH_MAX:
+            try:
+                meta = driver.query(name + '$', timeout)
+            except Exception:
+                meta = None  # no metadata, use the generic conversion
+            if isinstance(meta, Mapping):
+                self._dtype = meta.get('dtype')
+        if self._dtype in _TOPIC_DTYPES:
+            self._union_type, self._min, self._max = _TOPIC_DTYPES[self._dtype]
+
+    def __str__(self):
+        return self._name
+
+    def __repr__(self):
+        return f'Topic({self._name!r}, dtype={self._dtype!r})'
+
+    @property
+    def name(self):
+        """The topic name."""
+        return self._name
+
+    @property
+    def dtype(self):
+        """The metadata dtype, such as 'u32', or None when unknown."""
+        return self._dtype
+
+    cdef object _pack(self, value, c_jsdrv.jsdrv_union_s * v):
+        cdef uint8_t t = self._union_type
+        if (t == 0) or isinstance(value, str) or not isinstance(value, (int, float)):
+            return _py_to_jsdrv_union(self._name, value, v)
+        if t == c_jsdrv.JSDRV_UNION_F32 or t == c_jsdrv.JSDRV_UNION_F64:
+            memset(v, 0, sizeof(v[0]))
+            v[0].type = t
+            if t == c_jsdrv.JSDRV_UNION_F32:
+                v[0].value.f32 = float(value)
+            else:
+                v[0].value.f64 = float(value)
+        else:
+            if isinstance(value, float):
+                if not value.is_integer():
+                    return _py_to_jsdrv_union(self._name, value, v)
+                value = int(value)
+            if value < self._min or value > self._max:
+                return _py_to_jsdrv_union(self._name, value, v)  # let the validator report the error
+            memset(v, 0, sizeof(v[0]))
+            v[0].type = t
+            if t == c_jsdrv.JSDRV_UNION_U8:
+                v[0].value.u8 = value
+            elif t == c_jsdrv.JSDRV_UNION_U16:
+                v[0].value.u16 = value
+            elif t == c_jsdrv.JSDRV_UNION_U32:
+                v[0].value.u32 = value
+            elif t == c_jsdrv.JSDRV_UNION_U64:
+                v[0].value.u64 = value
+            elif t == c_jsdrv.JSDRV_UNION_I8:
+                v[0].value.i8 = value
+            elif t == c_jsdrv.JSDRV_UNION_I16:
+                v[0].value.i16 = value
+            elif t == c_jsdrv.JSDRV_UNION_I32:
+                v[0].value.i32 = value
+            else:
+                v[0].value.i64 = value
+        v[0].flags = self._flags
+        return value
+
+    def publish(self, value, timeout=None):
+        """Publish a value to this topic.
+
+        :param value: The value, see :meth:`Driver.publish`.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :raise: On error.
+        """
+        cdef c_jsdrv.jsdrv_union_s v
+        cdef const char * topic_ptr = self._name_bytes
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        value = self._pack(value, &v)
+        with nogil:
+            rc = c_jsdrv.jsdrv_publish(self._driver._context, topic_ptr, &v, timeout_ms)
+        _handle_rc(rc, 'jsdrv_publish', self._name)
+
+    def publish_async(self, value, callback, timeout=None):
+        """Publish a value to this topic without blocking.
+
+        :param value: The value, see :meth:`Driver.publish`.
+        :param callback: The function(topic, return_code), see
+            :meth:`Driver.publish_async`.
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :raise: On error.
+        """
+        cdef c_jsdrv.jsdrv_union_s v
+        cdef const char * topic_ptr = self._name_bytes
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        cdef void * cbk_ptr = <void *> callback
+        value = self._pack(value, &v)
+        Py_INCREF(callback)  # released by _on_completion_cbk
+        with nogil:
+            rc = c_jsdrv.jsdrv_publish_async(self._driver._context, topic_ptr, &v, timeout_ms,
+                                             _on_completion_cbk, cbk_ptr)
+        if rc:
+            Py_DECREF(callback)
+        _handle_rc(rc, 'jsdrv_publish_async', self._name)
+
+    def query(self, timeout=None):
+        """Query the value for this topic.
+
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        :return: The value for the topic.
+        :raise: On error.
+        """
+        cdef c_jsdrv.jsdrv_union_s v
+        cdef char byte_str[1024]
+        cdef const char * topic_ptr = self._name_bytes
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        v.type = c_jsdrv.JSDRV_UNION_BIN
+        v.size = 1024
+        v.value.str = byte_str
+        with nogil:
+            rc = c_jsdrv.jsdrv_query(self._driver._context, topic_ptr, &v, timeout_ms)
+        _handle_rc(rc, 'jsdrv_query', self._name)
+        return _jsdrv_union_to_py(&v)
+
+    def subscribe(self, flags, fn, timeout=None, **kwargs):
+        """Subscribe to this topic, see :meth:`Driver.subscribe`."""
+        return self._driver.subscribe(self._name, flags, fn, timeout, **kwargs)
+
+    def unsubscribe(self, fn, timeout=None):
+        """Unsubscribe from this topic, see :meth:`Driver.unsubscribe`."""
+        return self._driver.unsubscribe(self._name, fn, timeout)
+
+
+_STREAM_RING_SIZE_DEFAULT = 32 * 1024 * 1024
+_STREAM_RING_READ_SIZE_DEFAULT = 1024 * 1024
+
+
+def _stream_dtype(element_type, element_size_bits):
+    if (element_type, element_size_bits) == (c_jsdrv.JSDRV_DATA_TYPE_UNDEFINED, 128):
+        return _summary_dtype
+    prefix = _element_type_to_prefix.get(element_type)
+    if prefix is None:
+        return np.uint8
+    return np.dtype(f'<{prefix}{element_size_bits // 8}')
+
+
+cdef class StreamRing:
+    """A native ring buffer that receives stream data without the GIL.
+
+    Use :meth:`Driver.stream_ring` to create instances.
+    """
+    cdef c_jsdrv.jsdrv_stream_ring_s * _ring
+    cdef Driver _driver
+    cdef object _topic
+    cdef object _read_size
+
+    def __init__(self, Driver driver, topic, size=None, read_size=None, timeout=None):
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        cdef uint32_t sz = _STREAM_RING_SIZE_DEFAULT if size is None else int(size)
+        self._driver = driver
+        self._topic = topic
+        self._read_size = _STREAM_RING_READ_SIZE_DEFAULT if read_size is None else int(read_size)
+        self._ring = c_jsdrv.jsdrv_stream_ring_alloc(sz)
+        if self._ring == NULL:
+            raise ValueError(f'Invalid stream ring size: {sz}')
+        with nogil:
+            rc = c_jsdrv.jsdrv_subscribe(driver._context, <char *> &topic_str[0], c_jsdrv.JSDRV_SFLAG_PUB,
+                                         c_jsdrv.jsdrv_stream_ring_on_publish, <void *> self._ring, timeout_ms)
+        if rc:
+            self._free()
+        _handle_rc(rc, 'jsdrv_subscribe', topic)
+
+    def __dealloc__(self):
+        self._free()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    def __iter__(self):
+        """Iterate over :meth:`read` results until closed."""
+        while self._ring != NULL:
+            v = self.read(timeout=0.1)
+            if v is not None:
+                yield v
+
+    @property
+    def topic(self):
+        """The subscribed topic."""
+        return self._topic
+
+    def _free(self):
+        if self._ring != NULL:
+            c_jsdrv.jsdrv_stream_ring_free(self._ring)
+            self._ring = NULL
+
+    def close(self, timeout=None):
+        """Unsubscribe and free the ring.
+
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        """
+        cdef const uint8_t[:] topic_str = self._topic.encode('utf-8')
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        if self._ring == NULL:
+            return
+        with nogil:
+            rc = c_jsdrv.jsdrv_unsubscribe(self._driver._context, <char *> &topic_str[0],
+                                           c_jsdrv.jsdrv_stream_ring_on_publish, <void *> self._ring, timeout_ms)
+        self._driver._rings.discard(self)
+        if rc == 0:
+            self._free()  # otherwise leak rather than risk a callback into freed memory
+        _handle_rc(rc, 'jsdrv_unsubscribe', self._topic)
+
+    def read(self, out=None, timeout=None):
+        """Read contiguous samples from the ring.
+
+        :param out: The optional preallocated, C-contiguous numpy array
+            that receives the sample data.  Reuse the same array to
+            avoid allocation.  None (default) allocates a new
+            buffer of read_size bytes.
+        :param timeout: The maximum time in seconds to wait for data.
+            None (default) uses the default timeout.  0 does not wait.
+        :return: None on timeout.  Otherwise, the stream dict with the same
+            keys as :meth:`Driver.subscribe` stream data, plus
+            "message_count" and "drops".  The "data" value is a view
+            into out.  4-bit and 1-bit data is unpacked to one
+            uint8 per sample.
+
+        Each call drains as many contiguous messages as fit into out.
+        The result stops early at a sample_id skip or a format change,
+        and the next call continues from there.
+        """
+        cdef c_jsdrv.jsdrv_stream_ring_info_s info
+        cdef uint8_t[::1] buf
+        cdef uint32_t buf_size
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        cdef int32_t rc
+        if self._ring == NULL:
+            raise RuntimeError('StreamRing closed')
+        if out is None:
+            out = np.empty(self._read_size, dtype=np.uint8)
+        elif not out.flags.c_contiguous:
+            raise ValueError('out must be C-contiguous')
+        buf = out.reshape(-1).view(np.uint8)
+        buf_size = <uint32_t> buf.shape[0]
+        with nogil:
+            rc = c_jsdrv.jsdrv_stream_ring_read(self._ring, &buf[0], buf_size, &info, timeout_ms)
+        if rc == ErrorCode.TIMED_OUT:
+            return None
+        _handle_rc(rc, 'jsdrv_stream_ring_read', self._topic)
+
+        nbytes = info.element_count * (info.element_size_bits // 8)
+        data = out.reshape(-1).view(np.uint8)[:nbytes]
+        data = data.view(_stream_dtype(info.element_type, info.element_size_bits))
+        return {
+            'sample_id': info.sample_id,
+            'utc': c_jsdrv.jsdrv_time_from_counter(&info.time_map, info.sample_id),
+            'field_id': info.field_id,
+            'index': info.index,
+            'sample_rate': info.sample_rate,
+            'decimate_factor': info.decimate_factor,
+            'time_map': {
+                'offset_time': info.time_map.offset_time,
+                'offset_counter': info.time_map.offset_counter,
+                'counter_rate': info.time_map.counter_rate,
+            },
+            'message_count': info.message_count,
+            'drops': info.drops,
+            'data': data,
+        }
+
+
+cdef class StreamReader:
+    """Read fixed-size chunks of stream samples.
+
+    Use :meth:`Driver.stream_reader` to create instances.
+    """
+    cdef StreamRing _ring
+    cdef object _n_samples      # None until resolved from duration
+    cdef object _duration
+    cdef object _format         # (field_id, index, element_type, element_size_bits, sample_rate, decimate_factor)
+    cdef object _buf            # the uint8 chunk buffer, None between chunks
+    cdef object _gaps
+    cdef uint32_t _offset       # samples in the chunk
+    cdef uint32_t _drops
+    cdef uint64_t _sample_id    # the first chunk sample_id
+    cdef uint64_t _expected     # the next sample_id, valid when _format is not None
+    cdef c_jsdrv.jsdrv_time_map_s _time_map
+
+    def __init__(self, Driver driver, topic, n_samples=None, duration=None, size=None, timeout=None):
+        if (n_samples is None) == (duration is None):
+            raise ValueError('Specify exactly one of n_samples or duration')
+        self._n_samples = None if n_samples is None else int(n_samples)
+        self._duration = duration
+        self._format = None
+        self._buf = None
+        self._ring = StreamRing(driver, topic, size, None, timeout)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    def __iter__(self):
+        """Iterate over :meth:`read` chunks until closed."""
+        while self._ring._ring != NULL:
+            v = self.read(timeout=0.1)
+            if v is not None:
+                yield v
+
+    @property
+    def ring(self):
+        """The underlying :class:`StreamRing`."""
+        return self._ring
+
+    def close(self, timeout=None):
+        """Unsubscribe and free all resources.
+
+        :param timeout: The timeout in seconds.  None (default) uses
+            the default timeout.
+        """
+        self._ring.close(timeout)
+
+    cdef _chunk_start(self, c_jsdrv.jsdrv_stream_ring_info_s * info):
+        fmt = (info.field_id, info.index, info.element_type, info.element_size_bits,
+               info.sample_rate, info.decimate_factor)
+        if fmt != self._format or info.sample_id < self._expected:
+            self._format = fmt
+            self._expected = info.sample_id  # new stream, otherwise continue across chunks
+        if self._duration is not None:
+            self._n_samples = max(1, int(round(self._duration * info.sample_rate / info.decimate_factor)))
+        self._buf = np.empty(self._n_samples * (info.element_size_bits // 8), dtype=np.uint8)
+        self._gaps = []
+        self._offset = 0
+        self._drops = 0
+        self._sample_id = self._expected
+
+    def _chunk_finish(self):
+        field_id, index, element_type, element_size_bits, sample_rate, decimate_factor = self._format
+        nbytes = self._offset * (element_size_bits // 8)
+        rv = {
+            'sample_id': self._sample_id,
+            'utc': c_jsdrv.jsdrv_time_from_counter(&self._time_map, self._sample_id),
+            'field_id': field_id,
+            'index': index,
+            'sample_rate': sample_rate,
+            'decimate_factor': decimate_factor,
+            'time_map': {
+                'offset_time': self._time_map.offset_time,
+                'offset_counter': self._time_map.offset_counter,
+                'counter_rate': self._time_map.counter_rate,
+            },
+            'gaps': self._gaps,
+            'drops': self._drops,
+            'data': self._buf[:nbytes].view(_stream_dtype(element_type, element_size_bits)),
+        }
+        self._buf = None
+        return rv
+
+    def read(self, timeout=None):
+        """Read the next chunk.
+
+        :param timeout: The maximum time in seconds to wait for the
+            chunk to complete.  None (default) uses the default timeout.
+        :return: None on timeout, and the partial chunk continues on the
+            next call.  Otherwise, the chunk dict with the same keys as
+            :meth:`StreamRing.read`, except "message_count", plus
+            "gaps" with the list of (offset, length) sample ranges
+            missing from the stream.  Missing floating-point samples are
+            NaN, and other missing samples are 0.
+
+        Each chunk normally contains exactly n_samples samples.
+        A stream restart or format change ends the current chunk early.
+        """
+        cdef StreamRing ring = self._ring
+        cdef c_jsdrv.jsdrv_stream_ring_info_s info
+        cdef uint8_t[::1] buf
+        cdef uint32_t element_size
+        cdef uint32_t size
+        cdef int32_t timeout_ms
+        cdef int32_t rc
+        cdef uint64_t gap
+        if ring._ring == NULL:
+            raise RuntimeError('StreamReader closed')
+        t_end = time.monotonic() + _timeout_validate(timeout) / 1000.0
+        while True:
+            timeout_ms = <int32_t> max(0.0, (t_end - time.monotonic()) * 1000.0)
+            with nogil:
+                rc = c_jsdrv.jsdrv_stream_ring_peek(ring._ring, &info, timeout_ms)
+            if rc == ErrorCode.TIMED_OUT:
+                return None
+            _handle_rc(rc, 'jsdrv_stream_ring_peek', ring._topic)
+            fmt = (info.field_id, info.index, info.element_type, info.element_size_bits,
+                   info.sample_rate, info.decimate_factor)
+            if self._buf is None:
+                self._chunk_start(&info)
+            elif fmt != self._format or info.sample_id < self._expected:
+                return self._chunk_finish()  # stream restarted
+            element_size = info.element_size_bits // 8
+            self._time_map = info.time_map
+            if info.sample_id >= (self._expected + info.decimate_factor):
+                gap = min((info.sample_id - self._expected) // info.decimate_factor,
+                          self._n_samples - self._offset)
+                fill = np.nan if info.element_type == c_jsdrv.JSDRV_DATA_TYPE_FLOAT else 0
+                self._buf[self._offset * element_size:(self._offset + gap) * element_size].view(
+                    _stream_dtype(info.element_type, info.element_size_bits))[:] = fill
+                self._gaps.append((self._offset, gap))
+                self._offset += gap
+                self._expected += gap * info.decimate_factor
+            else:
+                buf = self._buf
+                size = (self._n_samples - self._offset) * element_size
+                with nogil:
+                    rc = c_jsdrv.jsdrv_stream_ring_read(ring._ring, &buf[self._offset * element_size], size, &info, 0)
+                _handle_rc(rc, 'jsdrv_stream_ring_read', ring._topic)
+                self._offset += info.element_count
+                self._expected = info.sample_id + info.element_count * info.decimate_factor
+                self._drops += info.drops
+                self._time_map = info.time_map
+            if self._offset >= self._n_samples:
+                return self._chunk_finish()
+
+
+cdef class Recorder:
+    """Record stream data topics to a raw file without the GIL.
+
+    Use :meth:`Driver.recorder` to create instances.
+    """
+    cdef c_jsdrv.jsdrv_recorder_s * _recorder
+    cdef Driver _driver
+    cdef object _path
+
+    def __init__(self, Driver driver, path, buffer_size=None):
+        cdef int32_t rc
+        cdef uint32_t sz = 0 if buffer_size is None else int(buffer_size)
+        cdef const char * path_c
+        path_b = str(path).encode('utf-8')
+        path_c = path_b
+        self._driver = driver
+        self._path = path
+        with nogil:
+            rc = c_jsdrv.jsdrv_recorder_open(driver._context, path_c, sz, &self._recorder)
+        _handle_rc(rc, 'jsdrv_recorder_open', str(path))
+
+    def __dealloc__(self):
+        if self._recorder != NULL:
+            with nogil:
+                c_jsdrv.jsdrv_recorder_close(self._recorder)
+            self._recorder = NULL
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    @property
+    def path(self):
+        """The recording file path."""
+        return self._path
+
+    def add(self, signal_id, topic):
+        """Record a stream data topic.
+
+        :param signal_id: The signal identifier, 1 to 65535.
+        :param topic: The stream data topic, such as "u/js220/000415/s/i/!data".
+        :raise: On error.
+        """
+        cdef int32_t rc
+        cdef uint16_t sid = int(signal_id)
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        if self._recorder == NULL:
+            raise RuntimeError('recorder closed')
+        with nogil:
+            rc = c_jsdrv.jsdrv_recorder_add(self._recorder, sid, <char *> &topic_str[0])
+        _handle_rc(rc, 'jsdrv_recorder_add', topic)
+
+    def user_data(self, chunk_meta, data):
+        """Add application data to the recording.
+
+        :param chunk_meta: The application-defined metadata, 0 to 65535.
+        :param data: The str or bytes data.
+        :raise: On error.
+        """
+        cdef int32_t rc
+        cdef const char * data_c
+        if self._recorder == NULL:
+            raise RuntimeError('recorder closed')
+        if isinstance(data, str):
+            data = data.encode('utf-8')
+        data = bytes(data)
+        data_c = data
+        rc = c_jsdrv.jsdrv_recorder_user_data(self._recorder, int(chunk_meta), data_c, len(data))
+        _handle_rc(rc, 'jsdrv_recorder_user_data')
+
+    def codec(self, codec):
+        """Select the compression for subsequent stream data.
+
+        :param codec: 0 (default) for none or 1 for lossless float32
+            compression, which typically halves the float32 data size.
+        :raise: On error.
+
+        :func:`pyjoulescope_driver.record_raw.decode` decodes the
+        compressed data.
+        """
+        cdef int32_t rc
+        if self._recorder == NULL:
+            raise RuntimeError('recorder closed')
+        rc = c_jsdrv.jsdrv_recorder_codec(self._recorder, int(codec))
+        _handle_rc(rc, 'jsdrv_recorder_codec')
+
+    def status(self):
+        """Get the recorder status.
+
+        :return: The dict with bytes, messages, drops, and error.
+        """
+        cdef c_jsdrv.jsdrv_recorder_status_s s
+        c_jsdrv.jsdrv_recorder_status(self._recorder, &s)
+        return {
+            'bytes': s.bytes,
+            'messages': s.messages,
+            'drops': s.drops,
+            'error': s.error,
+        }
+
+    def close(self):
+        """Stop recording, write all buffered data, and close the file.
+
+        :raise: On write error.
+        """
+        cdef int32_t rc
+        cdef c_jsdrv.jsdrv_recorder_s * r = self._recorder
+        if r == NULL:
+            return
+        self._recorder = NULL
+        self._driver._recorders.discard(self)
+        with nogil:
+            rc = c_jsdrv.jsdrv_recorder_close(r)
+        _handle_rc(rc, 'jsdrv_recorder_close', str(self._path))
+
+
+_SHM_SIZE_DEFAULT = 64 * 1024 * 1024
+
+
+cdef class SharedStreamBridge:
+    """Mirror pubsub topics into a named shared-memory ring.
+
+    :param name: The shared-memory name, which must be unique on this host.
+    :param size: The ring size in bytes, which must be a power of 2
+        from 64 kB to 1 GB.  None (default) uses 64 MB.
+    :param driver: The :class:`Driver` instance used to mirror topics.
+        None only allows :meth:`write`.
+
+    Use :meth:`Driver.shm_bridge` to mirror driver topics.
+    """
+    cdef c_jsdrv.jsdrv_shm_bridge_s * _bridge
+    cdef Driver _driver
+    cdef object _name
+
+    def __init__(self, name, size=None, Driver driver=None):
+        cdef int32_t rc
+        cdef uint32_t sz = _SHM_SIZE_DEFAULT if size is None else int(size)
+        cdef c_jsdrv.jsdrv_context_s * context = NULL if driver is None else driver._context
+        cdef const char * name_c
+        name_b = str(name).encode('utf-8')
+        name_c = name_b
+        self._driver = driver
+        self._name = str(name)
+        with nogil:
+            rc = c_jsdrv.jsdrv_shm_bridge_open(context, name_c, sz, &self._bridge)
+        _handle_rc(rc, 'jsdrv_shm_bridge_open', self._name)
+
+    def __dealloc__(self):
+        if self._bridge != NULL:
+            with nogil:
+                c_jsdrv.jsdrv_shm_bridge_close(self._bridge)
+            self._bridge = NULL
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    @property
+    def name(self):
+        """The shared-memory name."""
+        return self._name
+
+    def add(self, topic):
+        """Mirror a topic.
+
+        :param topic: The topic, which may contain '+' and '#' wildcards.
+        :raise: On error.
+        """
+        cdef int32_t rc
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        if self._bridge == NULL:
+            raise RuntimeError('bridge closed')
+        with nogil:
+            rc = c_jsdrv.jsdrv_shm_bridge_add(self._bridge, <char *> &topic_str[0])
+        _handle_rc(rc, 'jsdrv_shm_bridge_add', topic)
+
+    def remove(self, topic):
+        """Stop mirroring a topic.
+
+        :param topic: The topic previously provided to :meth:`add`.
+        :raise: On error.
+        """
+        cdef int32_t rc
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        if self._bridge == NULL:
+            raise RuntimeError('bridge closed')
+        with nogil:
+            rc = c_jsdrv.jsdrv_shm_bridge_remove(self._bridge, <char *> &topic_str[0])
+        _handle_rc(rc, 'jsdrv_shm_bridge_remove', topic)
+
+    def write(self, topic, value):
+        """Write an application message to the bridge.
+
+        :param topic: The topic string.
+        :param value: The value, see :meth:`Driver.publish`.  bytes values
+            for "!data" topics must contain the stream header and samples.
+        :raise: On error.
+        """
+        cdef int32_t rc
+        cdef c_jsdrv.jsdrv_union_s v
+        cdef const uint8_t[:] topic_str = topic.encode('utf-8')
+        if self._bridge == NULL:
+            raise RuntimeError('bridge closed')
+        keep_alive = _py_to_jsdrv_union(topic, value, &v)
+        if v.type == c_jsdrv.JSDRV_UNION_BIN and v.app == 0 and topic.endswith('!data'):
+            v.app = c_jsdrv.JSDRV_PAYLOAD_TYPE_STREAM
+        with nogil:
+            rc = c_jsdrv.jsdrv_shm_bridge_write(self._bridge, <char *> &topic_str[0], &v)
+        _handle_rc(rc, 'jsdrv_shm_bridge_write', topic)
+
+    def close(self):
+        """Stop mirroring and close the bridge.
+
+        Attached readers receive the remaining messages and then stop.
+        """
+        cdef c_jsdrv.jsdrv_shm_bridge_s * b = self._bridge
+        if b == NULL:
+            return
+        self._bridge = NULL
+        if self._driver is not None:
+            self._driver._bridges.discard(self)
+        with nogil:
+            c_jsdrv.jsdrv_shm_bridge_close(b)
+
+
+cdef class SharedStreamReader:
+    """Read messages from a :class:`SharedStreamBridge` in another process.
+
+    :param name: The shared-memory name provided to the bridge.
+    :param copy: When False (default), stream "data" values are read-only
+        numpy views directly into the shared memory, which remain valid
+        until the next :meth:`read`.  Call :meth:`check` after processing
+        to confirm that the writer did not overwrite them.
+        When True, copy the data so that callers may keep it.
+    :raise: On error, including when no bridge with this name exists.
+
+    This class does not need a :class:`Driver`, so
+    multiprocessing workers can attach by name.
+    """
+    cdef c_jsdrv.jsdrv_shm_reader_s * _reader
+    cdef object _name
+    cdef bint _copy
+    cdef bint _closed
+
+    def __init__(self, name, copy=False):
+        cdef int32_t rc
+        cdef const char * name_c
+        name_b = str(name).encode('utf-8')
+        name_c = name_b
+        self._name = str(name)
+        self._copy = bool(copy)
+        with nogil:
+            rc = c_jsdrv.jsdrv_shm_reader_open(name_c, &self._reader)
+        _handle_rc(rc, 'jsdrv_shm_reader_open', self._name)
+
+    def __dealloc__(self):
+        if self._reader != NULL:
+            c_jsdrv.jsdrv_shm_reader_close(self._reader)
+            self._reader = NULL
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    def __iter__(self):
+        """Iterate over (topic, value) messages until the bridge closes."""
+        while not self._closed:
+            v = self.read(timeout=0.1)
+            if v is not None:
+                yield v
+
+    @property
+    def name(self):
+        """The shared-memory name."""
+        return self._name
+
+    @property
+    def closed(self):
+        """True after :meth:`close` or when the bridge closed."""
+        return bool(self._closed)
+
+    @property
+    def drops(self):
+        """The number of times this reader fell behind and skipped messages."""
+        if self._reader == NULL:
+            return 0
+        return c_jsdrv.jsdrv_shm_reader_drops(self._reader)
+
+    def read(self, timeout=None):
+        """Read the next message.
+
+        :param timeout: The maximum time in seconds to wait.
+            None (default) uses the default timeout.  0 does not wait.
+        :return: The (topic, value) tuple, or None on timeout or
+            when the bridge closed.  With copy=True, also None when
+            the writer overwrote the message during the copy.
+            Values have the same format as :meth:`Driver.subscribe`.
+        :raise: On error.
+        """
+        cdef int32_t rc
+        cdef const char * topic
+        cdef c_jsdrv.jsdrv_union_s v
+        cdef int32_t timeout_ms = _timeout_validate(timeout)
+        if self._closed:
+            return None
+        with nogil:
+            rc = c_jsdrv.jsdrv_shm_reader_next(self._reader, &topic, &v, timeout_ms)
+        if rc == ErrorCode.TIMED_OUT:
+            return None
+        if rc == ErrorCode.CLOSED:
+            self._closed = True
+            return None
+        _handle_rc(rc, 'jsdrv_shm_reader_next', self._name)
+        topic_str = topic.decode('utf-8')
+        value = _jsdrv_union_to_py(&v, False, None if self._copy else self)
+        if self._copy and c_jsdrv.jsdrv_shm_reader_check(self._reader):
+            return None  # overwritten while copying, the next read skips ahead
+        return topic_str, value
+
+    def check(self):
+        """Check that the writer did not overwrite the most recent message.
+
+        :return: True if the views from the most recent :meth:`read` are intact.
+        """
+        if self._reader == NULL:
+            return False
+        return 0 == c_jsdrv.jsdrv_shm_reader_check(self._reader)
+
+    def close(self):
+        """Detach from the shared memory.
+
+        With copy=False, numpy views keep the mapping alive, so the
+        reader detaches when the last view is released.
+        """
+        self._closed = True
+        if self._copy and self._reader != NULL:
+            c_jsdrv.jsdrv_shm_reader_close(self._reader)
+            self._reader = NULL
+
+
+cdef void _on_completion_cbk(void * user_data, const char * topic, int32_t return_code) noexcept with gil:
+    cdef object fn = <object> user_data
+    try:
+        fn(topic.decode('utf-8'), return_code)
+    except Exception:
+        _log_c.exception('_on_completion_cbk')
+    finally:
+        Py_DECREF(fn)
+
+
+cdef class _RetainedValue:
+    """Keep a retained driver message alive for numpy arrays that reference it."""
+    cdef Driver _driver
+    cdef const c_jsdrv.jsdrv_union_s * _value
+
+    def __dealloc__(self):
+        if self._value != NULL and self._driver is not None and self._driver._context != NULL:
+            c_jsdrv.jsdrv_release(self._driver._context, self._value)
+        self._value = NULL
+
+
+cdef class _ZeroCopySubscriber:
+    cdef Driver _driver
+    cdef object _fn
+    cdef bint _packed
+
+    def __init__(self, Driver driver, fn, packed):
+        self._driver = driver
+        self._fn = fn
+        self._packed = bool(packed)
+
+
+cdef void _on_cmd_publish_zero_copy_cbk(void * user_data, const char * topic,
+                                        const c_jsdrv.jsdrv_union_s * value) noexcept with gil:
+    cdef _ZeroCopySubscriber s = <_ZeroCopySubscriber> user_data
+    cdef _RetainedValue owner = None
+    try:
+        topic_str = topic.decode('utf-8')
+        if (value[0].type == c_jsdrv.JSDRV_UNION_BIN
+                and value[0].app in (c_jsdrv.JSDRV_PAYLOAD_TYPE_STREAM, c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_RSP,
+                                     c_jsdrv.JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI)
+                and 0 == c_jsdrv.jsdrv_retain(s._driver._context, value)):
+            owner = _RetainedValue.__new__(_RetainedValue)
+            owner._driver = s._driver
+            owner._value = value
+        v = _jsdrv_union_to_py(value, s._packed, owner)
+        s._fn(topic_str, v)
+    except Exception:
+        _log_c.exception('_on_cmd_publish_zero_copy_cbk')
+
+
+cdef class _StatisticsBatch:
+    cdef object _fn
+    cdef object _data
+    cdef uint8_t[::1] _u8
+    cdef uint32_t _batch
+    cdef uint32_t _count
+
+    def __init__(self, fn, batch):
+        if batch < 1:
+            raise ValueError(f'Invalid batch: {batch}')
+        self._fn = fn
+        self._batch = batch
+        self._count = 0
+        self._data = np.zeros(batch, dtype=statistics_dtype)
+        self._u8 = self._data.view(np.uint8)
+
+
+cdef void _on_statistics_cbk(void * user_data, const char * topic,
+                             const c_jsdrv.jsdrv_union_s * value) noexcept with gil:
+    cdef _StatisticsBatch b = <_StatisticsBatch> user_data
+    cdef size_t sz = sizeof(c_jsdrv.jsdrv_statistics_s)
+    if (value[0].type != c_jsdrv.JSDRV_UNION_BIN or value[0].app != c_jsdrv.JSDRV_PAYLOAD_TYPE_STATISTICS
+            or value[0].size < sz):
+        return
+    memcpy(&b._u8[b._count * sz], value[0].value.bin, sz)
+    b._count += 1
+    if b._count < b._batch:
+        return
+    b._count = 0
+    try:
+        b._fn(topic.decode('utf-8'), b._data)
+    except Exception:
+        _log_c.exception('_on_statistics_cbk')
+
+
+cdef void _on_cmd_publish(void * user_data, const char * topic,
+                          const c_jsdrv.jsdrv_union_s * value, bint packed) noexcept with gil:
     cdef object fn = <object> user_data
     try:
         topic_str = topic.decode('utf-8')
@@ -891,13 +2382,23 @@ cdef void _on_cmd_publish_cbk(void * user_data, const char * topic,
         _log_c.exception('_on_cmd_publish_cbk could not convert topic to utf-8')
         return
     try:
-        v = _jsdrv_union_to_py(value)
+        v = _jsdrv_union_to_py(value, packed)
         # print(f'{topic_str} = {v}')
         fn(topic_str, v)
     except:
         _log_c.exception(f'_on_cmd_publish_cbk({topic_str})')
 
 
+cdef void _on_cmd_publish_cbk(void * user_data, const char * topic,
+                              const c_jsdrv.jsdrv_union_s * value) noexcept nogil:
+    _on_cmd_publish(user_data, topic, value, False)
+
+
+cdef void _on_cmd_publish_packed_cbk(void * user_data, const char * topic,
+                                     const c_jsdrv.jsdrv_union_s * value) noexcept nogil:
+    _on_cmd_publish(user_data, topic, value, True)
+
+
 cdef void _on_log_recv(void * user_data, const c_jsdrv.jsdrv_log_header_s * header,
                        const char * filename, const char * message) noexcept with gil:
     lvl = _log_level_c_to_py[header[0].level]
@@ -908,6 +2409,122 @@ cdef void _on_log_recv(void * user_data, const c_jsdrv.jsdrv_log_header_s * head
         _log_c.handle(record)
 
 
+def log_binary_open(path, size=None):
+    """Write native log messages to a binary ring file.
+
+    :param path: The file path, which is overwritten.
+    :param size: The file size in bytes.  None (default) uses 64 MB.
+    :raise RuntimeError: On error.
+
+    Create a Driver instance first.  Use
+    "python -m pyjoulescope_driver log_decode {path}" or
+    :func:`pyjoulescope_driver.log_binary.decode` to decode the file.
+    """
+    cdef int32_t rc
+    size = 64 * 1024 * 1024 if size is None else int(size)
+    path_b = str(path).encode('utf-8')
+    rc = c_jsdrv.jsdrv_log_binary_open(path_b, size)
+    _handle_rc(rc, 'log_binary_open')
+
+
+def log_binary_close():
+    """Stop writing the binary log ring file."""
+    c_jsdrv.jsdrv_log_binary_close()
+
+
+def _unpack_args(data, length, samples_per_byte):
+    x = np.ascontiguousarray(np.frombuffer(data, dtype=np.uint8) if isinstance(data, bytes) else data, dtype=np.uint8)
+    x = x.reshape(-1)
+    length = len(x) * samples_per_byte if length is None else int(length)
+    if length > len(x) * samples_per_byte:
+        raise ValueError(f'length {length} exceeds data')
+    return x, length
+
+
+def u4_unpack(data, length=None):
+    """Unpack 4-bit samples, such as current range, to one uint8 per sample.
+
+    :param data: The packed bytes or np.uint8 array with 2 samples per byte,
+        least significant nibble first.
+    :param length: The number of samples.  None (default) unpacks all.
+    :return: The np.uint8 array of samples.
+    """
+    cdef const uint8_t[::1] x_u8
+    cdef uint8_t[::1] y_u8
+    cdef uint32_t n
+    x, n = _unpack_args(data, length, 2)
+    y = np.empty(n, dtype=np.uint8)
+    if n:
+        x_u8 = x
+        y_u8 = y
+        with nogil:
+            c_jsdrv.jsdrv_u4_unpack(&y_u8[0], &x_u8[0], 0, n)
+    return y
+
+
+def u1_unpack(data, length=None):
+    """Unpack 1-bit samples, such as general-purpose inputs, to one uint8 per sample.
+
+    :param data: The packed bytes or np.uint8 array with 8 samples per byte,
+        least significant bit first.
+    :param length: The number of samples.  None (default) unpacks all.
+    :return: The np.uint8 array of 0 and 1 samples.
+    """
+    cdef const uint8_t[::1] x_u8
+    cdef uint8_t[::1] y_u8
+    cdef uint32_t n
+    x, n = _unpack_args(data, length, 8)
+    y = np.empty(n, dtype=np.uint8)
+    if n:
+        x_u8 = x
+        y_u8 = y
+        with nogil:
+            c_jsdrv.jsdrv_u1_unpack(&y_u8[0], &x_u8[0], 0, n)
+    return y
+
+
+def raw_cal_apply(adc, offset, gain, i_range=None):
+    """Calibrate raw i16 ADC samples to float32.
+
+    :param adc: The np.int16 raw ADC samples, such as from s/adc/{N}/!data.
+    :param offset: The offset added to the ADC code for each range,
+        up to 16 values.
+    :param gain: The gain for each range, up to 16 values.  Ranges with
+        a gain of 0 produce NaN.
+    :param i_range: The packed u4 range samples aligned with adc, such
+        as from s/i/range/!data.  None (default) uses range 0.
+    :return: The np.float32 array of calibrated samples.
+    """
+    cdef c_jsdrv.jsdrv_raw_cal_s cal
+    cdef const int16_t[::1] x_i16
+    cdef const uint8_t[::1] r_u8
+    cdef const uint8_t * r_ptr = NULL
+    cdef float[::1] y_f32
+    cdef uint32_t n
+    cdef uint32_t idx
+    offset = np.asarray(offset, dtype=np.float32).reshape(-1)
+    gain = np.asarray(gain, dtype=np.float32).reshape(-1)
+    if len(offset) > c_jsdrv.JSDRV_RAW_CAL_RANGE_COUNT or len(gain) > c_jsdrv.JSDRV_RAW_CAL_RANGE_COUNT:
+        raise ValueError('too many ranges')
+    for idx in range(c_jsdrv.JSDRV_RAW_CAL_RANGE_COUNT):
+        cal.offset[idx] = offset[idx] if idx < len(offset) else 0.0
+        cal.gain[idx] = gain[idx] if idx < len(gain) else 0.0
+    x = np.ascontiguousarray(adc, dtype=np.int16).reshape(-1)
+    n = len(x)
+    y = np.empty(n, dtype=np.float32)
+    if i_range is not None:
+        r, _ = _unpack_args(i_range, n, 2)
+    if n:
+        x_i16 = x
+        y_f32 = y
+        if i_range is not None:
+            r_u8 = r
+            r_ptr = &r_u8[0]
+        with nogil:
+            c_jsdrv.jsdrv_raw_cal_apply(&cal, &y_f32[0], &x_i16[0], r_ptr, 0, n)
+    return y
+
+
 def calibration_hash(msg):
     cdef const uint32_t[:] msg_u32
     cdef uint32_t[:] hash_u32
@@ -923,3 +2540,74 @@ def calibration_hash(msg):
     hash_u32 = hash
     c_jsdrv.jsdrv_calibration_hash(&msg_u32[0], len(msg), &hash_u32[0])
     return hash
+
+
+cdef void _time_map_from_py(time_map, c_jsdrv.jsdrv_time_map_s * tm):
+    tm[0].offset_time = time_map['offset_time']
+    tm[0].offset_counter = time_map['offset_counter']
+    tm[0].counter_rate = time_map['counter_rate']
+
+
+def time_from_counter(time_map, counter):
+    """Convert counter values to i64 UTC times.
+
+    :param time_map: The time_map dict with offset_time, offset_counter,
+        and counter_rate, such as from a stream message.
+    :param counter: The array-like counter values, usually sample_id.
+    :return: The np.int64 array of i64 UTC times.
+    """
+    cdef c_jsdrv.jsdrv_time_map_s tm
+    cdef const uint64_t[::1] counter_u64
+    cdef int64_t[::1] time_i64
+    _time_map_from_py(time_map, &tm)
+    counter_np = np.ascontiguousarray(counter, dtype=np.uint64)
+    result = np.empty(counter_np.shape, dtype=np.int64)
+    if counter_np.size:
+        counter_u64 = counter_np.reshape(-1)
+        time_i64 = result.reshape(-1)
+        with nogil:
+            c_jsdrv.jsdrv_time_from_counter_array(&tm, &counter_u64[0], &time_i64[0], counter_u64.shape[0])
+    return result
+
+
+def time_to_counter(time_map, utc):
+    """Convert i64 UTC times to counter values.
+
+    :param time_map: The time_map dict.
+    :param utc: The array-like i64 UTC times.
+    :return: The np.uint64 array of counter values.
+    """
+    cdef c_jsdrv.jsdrv_time_map_s tm
+    cdef const int64_t[::1] time_i64
+    cdef uint64_t[::1] counter_u64
+    _time_map_from_py(time_map, &tm)
+    utc_np = np.ascontiguousarray(utc, dtype=np.int64)
+    result = np.empty(utc_np.shape, dtype=np.uint64)
+    if utc_np.size:
+        time_i64 = utc_np.reshape(-1)
+        counter_u64 = result.reshape(-1)
+        with nogil:
+            c_jsdrv.jsdrv_time_to_counter_array(&tm, &time_i64[0], &counter_u64[0], time_i64.shape[0])
+    return result
+
+
+def time_from_counter_range(time_map, counter_start, counter_step, length):
+    """Compute the i64 UTC times for evenly spaced counter values.
+
+    :param time_map: The time_map dict.
+    :param counter_start: The first counter value, such as the stream sample_id.
+    :param counter_step: The counter increment, such as the stream decimate_factor.
+    :param length: The number of values.
+    :return: The np.int64 array of i64 UTC times for the x-axis.
+    """
+    cdef c_jsdrv.jsdrv_time_map_s tm
+    cdef int64_t[::1] time_i64
+    cdef uint64_t start = counter_start
+    cdef uint64_t step = counter_step
+    _time_map_from_py(time_map, &tm)
+    result = np.empty(int(length), dtype=np.int64)
+    if len(result):
+        time_i64 = result
+        with nogil:
+            c_jsdrv.jsdrv_time_from_counter_range(&tm, start, step, &time_i64[0], time_i64.shape[0])
+    return result
@@ -17,6 +17,7 @@ from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t, \
 
 
 DEF JSDRV_TOPIC_LENGTH_MAX = 64
+DEF JSDRV_BUFFER_REQUEST_SIGNALS_MAX = 8
 DEF JSDRV_PAYLOAD_LENGTH_MAX    = (1024U)
 DEF JSDRV_STREAM_DATA_SIZE      = (1024 * 64)
 DEF JSDRV_STREAM_PAYLOAD_LENGTH_MAX = (JSDRV_STREAM_DATA_SIZE - 16)
@@ -34,6 +35,12 @@ cdef extern from "jsdrv/time.h":
         double counter_rate
     int64_t jsdrv_time_from_counter(jsdrv_time_map_s * self, uint64_t counter)
     uint64_t jsdrv_time_to_counter(jsdrv_time_map_s * self, int64_t time64)
+    void jsdrv_time_from_counter_array(const jsdrv_time_map_s * self,
+        const uint64_t * counter, int64_t * time64, size_t length) nogil
+    void jsdrv_time_to_counter_array(const jsdrv_time_map_s * self,
+        const int64_t * time64, uint64_t * counter, size_t length) nogil
+    void jsdrv_time_from_counter_range(const jsdrv_time_map_s * self,
+        uint64_t counter_start, uint64_t counter_step, int64_t * time64, size_t length) nogil
 
 
 cdef extern from "jsdrv/union.h":
@@ -59,6 +66,7 @@ cdef extern from "jsdrv/union.h":
         JSDRV_UNION_FLAG_NONE = 0
         JSDRV_UNION_FLAG_RETAIN = (1 << 0)
         JSDRV_UNION_FLAG_CONST = (1 << 1)
+        JSDRV_UNION_FLAG_STATIC = (1 << 2)
 
     union jsdrv_union_inner_u:
         const char * str      # JSDRV_UNION_STR, JSDRV_UNION_JSON
@@ -87,6 +95,7 @@ cdef extern from "jsdrv.h":
 
     struct jsdrv_context_s
     ctypedef void (*jsdrv_subscribe_fn)(void * user_data, const char * topic, const jsdrv_union_s * value) nogil
+    ctypedef void (*jsdrv_completion_fn)(void * user_data, const char * topic, int32_t return_code) nogil
     enum jsdrv_payload_type_e:
         JSDRV_PAYLOAD_TYPE_UNION  = 0
         JSDRV_PAYLOAD_TYPE_STREAM = 1
@@ -94,11 +103,19 @@ cdef extern from "jsdrv.h":
         JSDRV_PAYLOAD_TYPE_BUFFER_INFO = 3
         JSDRV_PAYLOAD_TYPE_BUFFER_REQ = 4
         JSDRV_PAYLOAD_TYPE_BUFFER_RSP = 5
+        JSDRV_PAYLOAD_TYPE_BUFFER_REQ_MULTI = 6
+        JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI = 7
+        JSDRV_PAYLOAD_TYPE_BUFFER_SEARCH = 8
+        JSDRV_PAYLOAD_TYPE_ALIGN = 9
+        JSDRV_PAYLOAD_TYPE_SPECTRUM = 10
+        JSDRV_PAYLOAD_TYPE_INTERVAL = 11
+        JSDRV_PAYLOAD_TYPE_QUANTILES = 12
     enum jsdrv_element_type_e:
         JSDRV_DATA_TYPE_UNDEFINED = 0
         JSDRV_DATA_TYPE_INT = 2
         JSDRV_DATA_TYPE_UINT = 3
         JSDRV_DATA_TYPE_FLOAT = 4
+        JSDRV_DATA_TYPE_HOLD = 16
     enum jsdrv_field_e:
         JSDRV_FIELD_UNDEFINED = 0
         JSDRV_FIELD_CURRENT = 1
@@ -108,6 +125,15 @@ cdef extern from "jsdrv.h":
         JSDRV_FIELD_GPI = 5
         JSDRV_FIELD_UART = 6
         JSDRV_FIELD_RAW = 7
+        JSDRV_FIELD_CHARGE = 8
+        JSDRV_FIELD_ENERGY = 9
+        JSDRV_FIELD_RMS = 10
+        JSDRV_FIELD_SUMMARY = 11
+        JSDRV_FIELD_EDGE = 12
+    struct jsdrv_stream_host_time_s:
+        int64_t usb
+        int64_t dispatch
+        int64_t publish
     struct jsdrv_stream_signal_s:
         uint64_t sample_id
         uint8_t field_id
@@ -118,7 +144,14 @@ cdef extern from "jsdrv.h":
         uint32_t sample_rate
         uint32_t decimate_factor
         jsdrv_time_map_s time_map
+        jsdrv_stream_host_time_s host_time
         uint8_t data[JSDRV_STREAM_PAYLOAD_LENGTH_MAX]
+    struct jsdrv_stream_hold_s:
+        uint64_t sample_count
+        float min
+        float max
+        float mean
+        uint32_t rsv_u32
     struct jsdrv_statistics_s:
         uint8_t version
         uint8_t rsv1_u8
@@ -146,6 +179,53 @@ cdef extern from "jsdrv.h":
         uint64_t charge_i128[2]
         uint64_t energy_i128[2]
         jsdrv_time_map_s time_map
+    struct jsdrv_quantiles_s:
+        uint64_t block_sample_id
+        uint32_t block_sample_count
+        uint32_t sample_freq
+        uint32_t decimate_factor
+        uint32_t rsv
+        float i[4]
+        float v[4]
+        float p[4]
+        jsdrv_time_map_s time_map
+    enum jsdrv_spectrum_scale_e:
+        JSDRV_SPECTRUM_SCALE_DENSITY = 0
+        JSDRV_SPECTRUM_SCALE_POWER = 1
+    struct jsdrv_spectrum_s:
+        uint64_t sample_id
+        uint32_t sample_rate
+        uint32_t decimate_factor
+        uint32_t fft_length
+        uint32_t bin_count
+        uint32_t segment_count
+        uint8_t scale
+        uint8_t rsv1_u8
+        uint16_t rsv2_u16
+        jsdrv_time_map_s time_map
+        float data[0]
+    enum jsdrv_interval_flag_e:
+        JSDRV_INTERVAL_FLAG_PARTIAL = (1 << 0)
+    struct jsdrv_interval_s:
+        uint64_t sample_id
+        uint64_t sample_id_end
+        uint32_t interval_id
+        uint32_t sample_rate
+        uint32_t decimate_factor
+        uint32_t flags
+        uint64_t i_count
+        uint64_t p_count
+        double i_avg
+        double i_min
+        double i_max
+        double p_avg
+        double p_min
+        double p_max
+        double charge_f64
+        double energy_f64
+        uint64_t charge_i128[2]
+        uint64_t energy_i128[2]
+        jsdrv_time_map_s time_map
     enum jsdrv_time_type_e:
         JSDRV_TIME_UTC = 0
         JSDRV_TIME_SAMPLES = 1
@@ -178,15 +258,26 @@ cdef extern from "jsdrv.h":
     struct jsdrv_buffer_request_s:
         uint8_t version
         int8_t time_type
-        uint8_t rsv1_u8
+        uint8_t flags
         uint8_t rsv2_u8
-        uint32_t rsv3_u32
+        uint32_t sample_rate
         jsdrv_buffer_request_time_range_u time
         char rsp_topic[JSDRV_TOPIC_LENGTH_MAX]
         int64_t rsp_id
+    enum jsdrv_buffer_request_flag_e:
+        JSDRV_BUFFER_REQUEST_FLAG_CHUNKED = (1 << 0)
+        JSDRV_BUFFER_REQUEST_FLAG_UNPACK = (1 << 1)
+        JSDRV_BUFFER_REQUEST_FLAG_TILE = (1 << 2)
+        JSDRV_BUFFER_REQUEST_FLAG_SUPERSEDE = (1 << 3)
+        JSDRV_BUFFER_REQUEST_FLAG_BACKGROUND = (1 << 4)
+    enum jsdrv_buffer_response_flag_e:
+        JSDRV_BUFFER_RESPONSE_FLAG_END = (1 << 0)
     enum jsdrv_buffer_response_type_e:
         JSDRV_BUFFER_RESPONSE_SAMPLES = 1
         JSDRV_BUFFER_RESPONSE_SUMMARY = 2
+        JSDRV_BUFFER_RESPONSE_RESAMPLED = 3
+        JSDRV_BUFFER_RESPONSE_SEARCH = 4
+        JSDRV_BUFFER_RESPONSE_STATISTICS = 5
     struct jsdrv_summary_entry_s:
         float avg
         float std
@@ -195,12 +286,40 @@ cdef extern from "jsdrv.h":
     struct jsdrv_buffer_response_s:
         uint8_t version
         uint8_t response_type
-        uint8_t rsv1_u8
+        uint8_t flags
         uint8_t rsv2_u8
         uint32_t rsv3_u32
         int64_t rsp_id
         jsdrv_buffer_info_s info
         uint64_t data[0]
+    struct jsdrv_buffer_request_multi_s:
+        jsdrv_buffer_request_s req
+        uint8_t signal_count
+        uint8_t rsv1_u8
+        uint16_t rsv2_u16
+        uint32_t rsv3_u32
+        uint8_t signal_ids[JSDRV_BUFFER_REQUEST_SIGNALS_MAX]
+    struct jsdrv_buffer_response_multi_s:
+        uint8_t version
+        uint8_t signal_count
+        uint16_t rsv2_u16
+        uint32_t rsv3_u32
+        int64_t rsp_id
+        uint64_t data[0]
+    enum jsdrv_buffer_search_op_e:
+        JSDRV_BUFFER_SEARCH_RISE = 1
+        JSDRV_BUFFER_SEARCH_FALL = 2
+        JSDRV_BUFFER_SEARCH_CROSS = 3
+        JSDRV_BUFFER_SEARCH_MAX = 4
+        JSDRV_BUFFER_SEARCH_MIN = 5
+    struct jsdrv_buffer_search_s:
+        jsdrv_buffer_request_s req
+        uint8_t op
+        uint8_t rsv1_u8
+        uint16_t rsv2_u16
+        float threshold
+        uint32_t hits_max
+        uint32_t rsv3_u32
     enum jsdrv_subscribe_flag_e:
         JSDRV_SFLAG_NONE = 0                    # No flags (always 0).
         JSDRV_SFLAG_RETAIN = (1 << 0)           # Immediately forward retained PUB and/or METADATA, depending upon JSDRV_PUBSUB_SFLAG_PUB and JSDRV_PUBSUB_SFLAG_METADATA_RSP.
@@ -210,6 +329,13 @@ cdef extern from "jsdrv.h":
         JSDRV_SFLAG_QUERY_REQ = (1 << 4)        # Subscribe to receive query requests like "?" and "a/b/?".
         JSDRV_SFLAG_QUERY_RSP = (1 << 5)        # Subscribe to receive query responses like "a/b/c?".
         JSDRV_SFLAG_RETURN_CODE = (1 << 6)      # Subscribe to receive return code messages like "a/b/c#".
+        JSDRV_SFLAG_STREAM = (1 << 7)           # Mark a streaming topic like "a/b/!data" for the fast path.
+    enum jsdrv_queue_policy_e:
+        JSDRV_QUEUE_POLICY_NONE = 0
+        JSDRV_QUEUE_POLICY_BLOCK = 1
+        JSDRV_QUEUE_POLICY_DROP_OLDEST = 2
+        JSDRV_QUEUE_POLICY_DROP_NEWEST = 3
+        JSDRV_QUEUE_POLICY_COALESCE = 4
     enum jsdrv_device_open_mode_e:
         JSDRV_DEVICE_OPEN_MODE_DEFAULTS = 0
         JSDRV_DEVICE_OPEN_MODE_RESUME = 1
@@ -220,10 +346,17 @@ cdef extern from "jsdrv.h":
     int32_t jsdrv_initialize(jsdrv_context_s ** context, const jsdrv_arg_s * args, uint32_t timeout_ms) nogil
     void jsdrv_finalize(jsdrv_context_s * context, uint32_t timeout_ms) nogil
     int32_t jsdrv_publish(jsdrv_context_s * context, const char * topic, const jsdrv_union_s * value, uint32_t timeout_ms) nogil
+    int32_t jsdrv_publish_async(jsdrv_context_s * context, const char * topic, const jsdrv_union_s * value, uint32_t timeout_ms, jsdrv_completion_fn cbk_fn, void * cbk_user_data) nogil
+    int32_t jsdrv_publish_batch(jsdrv_context_s * context, const jsdrv_arg_s * args, uint32_t count, int32_t * return_codes, uint32_t timeout_ms) nogil
     int32_t jsdrv_query(jsdrv_context_s * context, const char * topic, jsdrv_union_s * value, uint32_t timeout_ms) nogil
     int32_t jsdrv_subscribe(jsdrv_context_s * context, const char * topic, uint8_t flags, jsdrv_subscribe_fn cbk_fn, void * cbk_user_data, uint32_t timeout_ms) nogil
+    int32_t jsdrv_subscribe_queue(jsdrv_context_s * context, const char * topic, uint8_t flags, jsdrv_subscribe_fn cbk_fn, void * cbk_user_data, uint32_t depth, uint8_t policy, uint32_t timeout_ms) nogil
+    int32_t jsdrv_subscribe_coalesce(jsdrv_context_s * context, const char * topic, uint8_t flags, jsdrv_subscribe_fn cbk_fn, void * cbk_user_data, uint32_t interval_ms, uint32_t timeout_ms) nogil
     int32_t jsdrv_unsubscribe(jsdrv_context_s * context, const char * topic, jsdrv_subscribe_fn cbk_fn, void * cbk_user_data, uint32_t timeout_ms) nogil
     int32_t jsdrv_unsubscribe_all(jsdrv_context_s * context, jsdrv_subscribe_fn cbk_fn, void * cbk_user_data, uint32_t timeout_ms) nogil
+    int32_t jsdrv_retain(jsdrv_context_s * context, const jsdrv_union_s * value) nogil
+    int32_t jsdrv_release(jsdrv_context_s * context, const jsdrv_union_s * value) nogil
+    int32_t jsdrv_profile_apply_json(jsdrv_context_s * context, const char * device_prefix, const char * profile, uint32_t * changed, uint32_t timeout_ms) nogil
     void jsdrv_calibration_hash(const uint32_t * msg, uint32_t length, uint32_t * hash) nogil
 
 
@@ -245,3 +378,81 @@ cdef extern from "jsdrv/log.h":
     int8_t jsdrv_log_level_get() nogil
     void jsdrv_log_initialize() nogil
     void jsdrv_log_finalize() nogil
+    int32_t jsdrv_log_binary_open(const char * path, uint64_t size) nogil
+    void jsdrv_log_binary_close() nogil
+
+
+cdef extern from "jsdrv/shm.h":
+    struct jsdrv_shm_bridge_s
+    struct jsdrv_shm_reader_s
+    int32_t jsdrv_shm_bridge_open(jsdrv_context_s * context, const char * name, uint32_t size, jsdrv_shm_bridge_s ** bridge) nogil
+    int32_t jsdrv_shm_bridge_add(jsdrv_shm_bridge_s * bridge, const char * topic) nogil
+    int32_t jsdrv_shm_bridge_remove(jsdrv_shm_bridge_s * bridge, const char * topic) nogil
+    int32_t jsdrv_shm_bridge_write(jsdrv_shm_bridge_s * bridge, const char * topic, const jsdrv_union_s * value) nogil
+    void jsdrv_shm_bridge_close(jsdrv_shm_bridge_s * bridge) nogil
+    int32_t jsdrv_shm_reader_open(const char * name, jsdrv_shm_reader_s ** reader) nogil
+    int32_t jsdrv_shm_reader_next(jsdrv_shm_reader_s * reader, const char ** topic, jsdrv_union_s * value, uint32_t timeout_ms) nogil
+    int32_t jsdrv_shm_reader_check(jsdrv_shm_reader_s * reader) nogil
+    uint32_t jsdrv_shm_reader_drops(jsdrv_shm_reader_s * reader) nogil
+    void jsdrv_shm_reader_close(jsdrv_shm_reader_s * reader) nogil
+
+
+cdef extern from "jsdrv/net.h":
+    struct jsdrv_net_server_s
+    int32_t jsdrv_net_server_open(jsdrv_context_s * context, const char * address, uint16_t port, uint32_t buffer_size, jsdrv_net_server_s ** server) nogil
+    uint16_t jsdrv_net_server_port(jsdrv_net_server_s * server) nogil
+    void jsdrv_net_server_close(jsdrv_net_server_s * server) nogil
+
+
+cdef extern from "jsdrv/stream_ring.h":
+    struct jsdrv_stream_ring_s
+    struct jsdrv_stream_ring_info_s:
+        uint64_t sample_id
+        uint8_t field_id
+        uint8_t index
+        uint8_t element_type
+        uint8_t element_size_bits
+        uint32_t element_count
+        uint32_t sample_rate
+        uint32_t decimate_factor
+        jsdrv_time_map_s time_map
+        uint32_t message_count
+        uint32_t drops
+    jsdrv_stream_ring_s * jsdrv_stream_ring_alloc(uint32_t size) nogil
+    void jsdrv_stream_ring_free(jsdrv_stream_ring_s * self) nogil
+    void jsdrv_stream_ring_on_publish(void * user_data, const char * topic, const jsdrv_union_s * value) nogil
+    int32_t jsdrv_stream_ring_read(jsdrv_stream_ring_s * self, void * buffer, uint32_t buffer_size,
+        jsdrv_stream_ring_info_s * info, uint32_t timeout_ms) nogil
+    int32_t jsdrv_stream_ring_peek(jsdrv_stream_ring_s * self, jsdrv_stream_ring_info_s * info, uint32_t timeout_ms) nogil
+
+
+cdef extern from "jsdrv/recorder.h":
+    struct jsdrv_recorder_s
+    struct jsdrv_recorder_status_s:
+        uint64_t bytes
+        uint64_t messages
+        uint32_t drops
+        int32_t error
+    int32_t jsdrv_recorder_open(jsdrv_context_s * context, const char * path,
+        uint32_t buffer_size, jsdrv_recorder_s ** recorder) nogil
+    int32_t jsdrv_recorder_add(jsdrv_recorder_s * recorder, uint16_t signal_id, const char * topic) nogil
+    int32_t jsdrv_recorder_user_data(jsdrv_recorder_s * recorder, uint16_t chunk_meta,
+        const void * data, uint32_t size) nogil
+    int32_t jsdrv_recorder_codec(jsdrv_recorder_s * recorder, uint8_t codec) nogil
+    void jsdrv_recorder_status(jsdrv_recorder_s * recorder, jsdrv_recorder_status_s * status) nogil
+    int32_t jsdrv_recorder_close(jsdrv_recorder_s * recorder) nogil
+
+
+cdef extern from "jsdrv/raw_cal.h":
+    enum:
+        JSDRV_RAW_CAL_RANGE_COUNT
+    struct jsdrv_raw_cal_s:
+        float offset[16]
+        float gain[16]
+    void jsdrv_raw_cal_apply(const jsdrv_raw_cal_s * cal, float * y, const int16_t * adc,
+        const uint8_t * range, uint32_t range_offset, uint32_t length) nogil
+
+
+cdef extern from "jsdrv/unpack.h":
+    void jsdrv_u4_unpack(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length) nogil
+    void jsdrv_u1_unpack(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length) nogil
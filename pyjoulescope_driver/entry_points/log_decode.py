@@ -0,0 +1,37 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from pyjoulescope_driver.log_binary import decode, format_record
+
+
+def parser_config(p):
+    """Decode a native binary log file.
+
+    For example:
+        python -m pyjoulescope_driver log_decode jsdrv_log.bin
+    """
+    p.add_argument('path',
+                   help='The binary log file path from jsdrv_log_binary_open().')
+    p.add_argument('--level',
+                   type=int,
+                   default=10,
+                   help='The maximum jsdrv log level to display, 0 (emergency) to 10 (all).')
+    return on_cmd
+
+
+def on_cmd(args):
+    for record in decode(args.path):
+        if record['level'] <= args.level:
+            print(format_record(record))
+    return 0
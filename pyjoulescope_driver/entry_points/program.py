@@ -13,9 +13,10 @@
 # limitations under the License.
 
 from pyjoulescope_driver import Driver
-from pyjoulescope_driver.program import release_program
+from pyjoulescope_driver.program import release_program, release_program_parallel
 from pyjoulescope_driver.release import release_get
 import sys
+import threading
 
 
 def parser_config(p):
@@ -24,7 +25,15 @@ def parser_config(p):
                    default='stable',
                    help='Maturity target to program which is one of alpha, beta, stable.')
     p.add_argument('--device-path',
-                   help='The target device for this command.')
+                   action='append',
+                   help='The target device for this command.  '
+                        'Specify multiple times to program devices in parallel.')
+    p.add_argument('--all',
+                   action='store_true',
+                   help='Program all connected devices in parallel.')
+    p.add_argument('--jobs', '-j',
+                   type=int,
+                   help='The maximum number of devices to program at once with multiple devices.')
     p.add_argument('--force-download',
                    action='store_true',
                    help='Force release download.')
@@ -65,21 +74,65 @@ def _on_progress(fract, message):
     sys.stdout.flush()
 
 
+def _print_versions(rv):
+    versions_before = dict(rv[0])
+    for key, value in rv[1]:
+        v = versions_before.get(key, '?.?.?')
+        print(f'    {key:10s}  {v} => {value}')
+
+
+def _on_cmd_parallel(d, args, device_paths):
+    lock = threading.Lock()
+    messages = {}
+
+    def on_progress(device_path, fract, message):
+        with lock:
+            if messages.get(device_path) != message:  # print each step once
+                messages[device_path] = message
+                percents = int(round(100.0 * min(max(float(fract), 0.0), 1.0)))
+                print(f'{device_path:24s} {percents:3d}% {message}', flush=True)
+
+    image = release_get(args.maturity, force_download=args.force_download)
+    results = release_program_parallel(d, device_paths, image,
+                                       force_program=args.force_program,
+                                       progress=on_progress,
+                                       max_workers=args.jobs)
+    rc = 0
+    print('\nProgramming completed:')
+    for device_path, rv in results.items():
+        if isinstance(rv, Exception):
+            print(f'{device_path}: FAILED {rv}')
+            rc = 1
+        else:
+            print(f'{device_path}:')
+            _print_versions(rv)
+    return rc
+
+
 def on_cmd(args):
     with Driver() as d:
         d.log_level = args.jsdrv_log_level
         device_paths = d.device_paths()
-        if args.device_path is not None:
-            if args.device_path not in device_paths:
-                print('Device {args.device_path} not found in {device_paths}')
+        if args.all:
+            if not len(device_paths):
+                print('No device found')
                 return 1
-            device_path = args.device_path
+            return _on_cmd_parallel(d, args, device_paths)
+        elif args.device_path is not None:
+            for device_path in args.device_path:
+                if device_path not in device_paths:
+                    print(f'Device {device_path} not found in {device_paths}')
+                    return 1
+            if len(args.device_path) > 1:
+                return _on_cmd_parallel(d, args, args.device_path)
+            device_path = args.device_path[0]
         elif len(device_paths) == 0:
             print('No device found')
             return 1
         elif len(device_paths) > 1:
             print('Multiple devices found.  Use "--device-path" to specify the desired device from:')
             print(f'{device_paths}')
+            print('or use "--all" to program all devices in parallel.')
             return 1
         else:
             device_path = device_paths[0]
@@ -88,9 +141,6 @@ def on_cmd(args):
         rv = release_program(d, device_path, image,
                              force_program=args.force_program,
                              progress=_on_progress)
-        versions_before = dict(rv[0])
         print('\nProgramming completed:')
-        for key, value in rv[1]:
-            v = versions_before.get(key, '?.?.?')
-            print(f'    {key:10s}  {v} => {value}')
+        _print_versions(rv)
     return 0
@@ -47,6 +47,9 @@ def parser_config(p):
     p.add_argument('--note',
                    help='Add an arbitrary note to the JLS file. '
                         + 'Provide a quoted string to handle spaces.')
+    p.add_argument('--native',
+                   action='store_true',
+                   help='Record using the native driver recorder, then convert to JLS on close.')
     p.add_argument('filename',
                    nargs='?',
                    default=time64.filename(),
@@ -92,7 +95,7 @@ def on_cmd(args):
                     else:
                         print(f'Unsupported device {device_path}')
 
-            wr = Record(d, device_paths, args.signals)
+            wr = Record(d, device_paths, args.signals, native=args.native)
             if args.verbose:
                 print(f'Record to file: {args.filename}')
             print('Start recording.  Press CTRL-C to stop.')
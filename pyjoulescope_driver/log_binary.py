@@ -0,0 +1,88 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Decode binary log ring files written by jsdrv_log_binary_open()."""
+
+from . import time64
+import struct
+
+
+MAGIC = b'jsdrvlog'
+VERSION = 1
+FLAG_PAD = 0x01
+LEVEL_CHAR = '!ACEWNIDDD.'
+_HEADER = struct.Struct('<8sIIQQQ24x')
+_RECORD = struct.Struct('<IBBHIHHq')
+
+
+def decode_bytes(b):
+    """Decode binary log file contents.
+
+    :param b: The file contents as bytes.
+    :return: The generator of record dicts, oldest first, with
+        timestamp (i64 UTC time), level, filename, line, and message.
+    :raise ValueError: If b is not a binary log file.
+    """
+    if len(b) < _HEADER.size:
+        raise ValueError('too short')
+    magic, version, header_size, data_size, head, tail = _HEADER.unpack_from(b, 0)
+    if magic != MAGIC:
+        raise ValueError('invalid magic')
+    if version != VERSION:
+        raise ValueError(f'unsupported version {version}')
+    if len(b) < header_size + data_size or (head - tail) > data_size:
+        raise ValueError('truncated')
+    offset = tail
+    while offset < head:
+        pos = header_size + (offset % data_size)
+        size, level, flags, filename_size, line, message_size, _, timestamp = _RECORD.unpack_from(b, pos)
+        if size < 8:
+            raise ValueError(f'invalid record size {size} at {offset}')
+        offset += size
+        if flags & FLAG_PAD:
+            continue
+        pos += _RECORD.size
+        filename = b[pos:pos + filename_size].decode('utf-8', errors='replace')
+        pos += filename_size
+        message = b[pos:pos + message_size].decode('utf-8', errors='replace')
+        yield {
+            'timestamp': timestamp,
+            'level': level,
+            'filename': filename,
+            'line': line,
+            'message': message,
+        }
+
+
+def decode(path):
+    """Decode a binary log file.
+
+    :param path: The file path.
+    :return: The generator of record dicts, see decode_bytes().
+    """
+    with open(path, 'rb') as f:
+        b = f.read()
+    return decode_bytes(b)
+
+
+def format_record(record):
+    """Format a decoded record like the native log callback.
+
+    :param record: The record dict from decode().
+    :return: The formatted string.
+    """
+    level = record['level']
+    c = LEVEL_CHAR[level] if level < len(LEVEL_CHAR) else '?'
+    t = time64.as_datetime(record['timestamp']).isoformat()
+    return f"{t} {c} {record['filename']}:{record['line']} {record['message']}"
@@ -28,6 +28,7 @@ from pyjoulescope_driver.release import release_to_segments, \
     SUBTYPE_CTRL_APP, SUBTYPE_CTRL_UPDATER2, \
     SUBTYPE_CTRL_UPDATER1, SUBTYPE_SENSOR_FPGA, \
     TARGETS
+from concurrent.futures import ThreadPoolExecutor
 import logging
 import time
 
@@ -94,6 +95,7 @@ class Programmer:
                     msg = f'timeout waiting for {self._path} removal'
                     _log.warning(msg)
                     raise TimeoutError(msg)
+                time.sleep(0.02)
             else:
                 break
 
@@ -252,3 +254,49 @@ def release_program(driver: Driver, device_path: str, image: bytes,
     _log.info('Updated to versions: %s', v)
     progress(1.0, 'Complete')
     return versions_before, versions_after
+
+
+def release_program_parallel(driver: Driver, device_paths, image: bytes,
+                             force_program=None, progress=None, max_workers=None):
+    """Program multiple devices with an official release concurrently.
+
+    :param driver: The driver instance.
+    :param device_paths: The list of device path strings for the target devices.
+    :param image: The binary release image to program.  See
+        :func:`pyjoulescope_driver.release.release_get`.
+    :param force_program: Force device programming for all segments.
+    :param progress: An optional callable(device_path: str, completion: float, msg: str)
+        callback.  This function is called from the programming threads.
+    :param max_workers: The maximum number of devices to program at once.
+        None (default) programs all devices at once.
+    :return: The map of device_path to either the (versions_before, versions_after)
+        tuple returned by :func:`release_program` or the exception that
+        stopped programming for that device.
+
+    Each device programs in its own thread using :func:`release_program`.
+    The driver processes USB transfers for each device in its own device
+    thread, so the total duration approaches the duration for the slowest
+    device.  A failure on one device does not stop the others.
+    """
+    device_paths = list(device_paths)
+    if not len(device_paths):
+        return {}
+    if progress is None:
+        progress = lambda path, x, y: None
+
+    def program_one(device_path):
+        def device_progress(fract, msg):
+            progress(device_path, fract, msg)
+        try:
+            driver.open(device_path)
+            return release_program(driver, device_path, image,
+                                   force_program=force_program,
+                                   progress=device_progress)
+        except Exception as ex:
+            _log.warning('%s programming failed: %s', device_path, ex)
+            return ex
+
+    max_workers = len(device_paths) if max_workers is None else int(max_workers)
+    with ThreadPoolExecutor(max_workers=max_workers, thread_name_prefix='jsdrv_program') as executor:
+        results = executor.map(program_one, device_paths)
+        return dict(zip(device_paths, results))
@@ -19,8 +19,9 @@ Record streaming sample data to a JLS v2 file.
 
 import copy
 import numpy as np
-from pyjoulescope_driver import time64
+from pyjoulescope_driver import time64, record_raw
 import logging
+import os
 
 
 _PYJLS_VERSION_MIN = (0, 9, 5)  # inclusive
@@ -132,19 +133,28 @@ class Record:
         * signal_enable
         * signal_disable
         None (default) is equivalent to ['signal_enable', 'signal_disable']
+    :param native: When True, record using the native driver recorder
+        which writes the stream data without Python callbacks.
+        See :meth:`open`.  False (default) records each stream
+        message through Python.
 
     Call :meth:`open` to start recording and :meth:`close` to stop.
     """
 
-    def __init__(self, driver, device_path, signals=None, auto=None):
-        if Writer is None:
+    def __init__(self, driver, device_path, signals=None, auto=None, native=False):
+        self._native = bool(native)
+        self._recorder = None
+        self._raw_filename = None
+        self._jls_filename = None
+        if Writer is not None:
+            pyjls_version = tuple([int(x) for x in __version__.split('.')])
+            if pyjls_version < _PYJLS_VERSION_MIN or pyjls_version >= _PYJLS_VERSION_MAX:
+                raise ImportError(f'Unsupported pyjls version {__version__}\n' +
+                                  f'  Require {_PYJLS_VERSION_MIN} <= pyjls version < {_PYJLS_VERSION_MAX}\n' +
+                                  '  pip3 install -U pyjls')
+        elif not self._native:  # native raw recordings do not need pyjls
             raise RuntimeError('pyjls package not found.  Install using:\n' +
                                '  pip3 install -U pyjls')
-        pyjls_version = tuple([int(x) for x in __version__.split('.')])
-        if pyjls_version < _PYJLS_VERSION_MIN or pyjls_version >= _PYJLS_VERSION_MAX:
-            raise ImportError(f'Unsupported pyjls version {__version__}\n' +
-                              f'  Require {_PYJLS_VERSION_MIN} <= pyjls version < {_PYJLS_VERSION_MAX}\n' +
-                              '  pip3 install -U pyjls')
         self._utc_interval = time64.MINUTE
         self._log = logging.getLogger(__name__)
         self._wr = None
@@ -173,7 +183,7 @@ class Record:
                 signal['name'] = signal_name
                 signal['source_id'] = idx + 1
                 signal['signal_id'] = signal_id
-                signal['signal_type'] = _DTYPE_MAP[signal['signal_type']]
+                signal['signal_type'] = _DTYPE_MAP.get(signal['signal_type'])
                 signal['ctrl_topic_abs'] = f"{device_path}/{signal['ctrl_topic']}"
                 signal['data_topic_abs'] = f"{device_path}/{signal['data_topic']}"
                 signal['utc_next'] = None
@@ -190,9 +200,16 @@ class Record:
             Use chunk_meta 0 and a data string for notes
             that display in the Joulescope UI.
         :return: self.
+
+        In native mode, the driver records to a raw file.  When filename
+        ends with ".jls", the recording goes to filename + ".jsdrvrec"
+        and :meth:`close` converts it to filename.  Otherwise, filename
+        is the raw recording, see :mod:`pyjoulescope_driver.record_raw`.
         """
-        if self._wr is not None:
+        if self._wr is not None or self._recorder is not None:
             self.close()
+        if self._native:
+            return self._open_native(filename, user_data)
         self._data_map.clear()
         self._wr = Writer(filename)
         if user_data is not None:
@@ -222,8 +239,59 @@ class Record:
 
         return self
 
+    def _open_native(self, filename, user_data):
+        filename = str(filename)
+        if filename.lower().endswith('.jls'):
+            self._jls_filename = filename
+            self._raw_filename = filename + '.jsdrvrec'
+        else:
+            self._jls_filename = None
+            self._raw_filename = filename
+        self._recorder = self._driver.recorder(self._raw_filename)
+        try:
+            if user_data is not None:
+                for chunk_meta, data in user_data:
+                    self._recorder.user_data(chunk_meta, data)
+            for signal in self._signals.values():
+                self._recorder.add(signal['signal_id'], signal['data_topic_abs'])
+        except Exception:
+            self._recorder.close()
+            self._recorder = None
+            raise
+        if 'signal_enable' in self._auto:
+            for signal in self._signals.values():
+                self._driver.publish(signal['ctrl_topic_abs'], 1, timeout=0)
+        return self
+
+    def _close_native(self):
+        recorder, self._recorder = self._recorder, None
+        try:
+            status = recorder.status()
+            recorder.close()
+            if status['drops']:
+                self._log.warning('Recording dropped %d messages', status['drops'])
+            self._signals_disable()
+        finally:
+            if self._jls_filename is not None:
+                record_raw.to_jls(self._raw_filename, self._jls_filename, self._utc_interval)
+                os.remove(self._raw_filename)
+
+    def _signals_disable(self):
+        if 'signal_disable' not in self._auto:
+            return
+        for signal in self._signals.values():
+            ctrl_topic = signal['ctrl_topic_abs']
+            try:
+                self._driver.publish(ctrl_topic, 0, timeout=0.25)
+            except TimeoutError:
+                self._log.warning('Timed out in publish: %s <= 0', ctrl_topic)
+            except Exception:
+                self._log.exception('Exception in publish: %s <= 0', ctrl_topic)
+
     def close(self):
         """Close the recording and release all resources."""
+        if self._recorder is not None:
+            return self._close_native()
         try:
             for signal in self._signals.values():
                 self._driver.unsubscribe(signal['data_topic_abs'], self._on_data_fn)
@@ -0,0 +1,294 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Decode raw stream recordings written by jsdrv_recorder_open()."""
+
+from . import time64
+import numpy as np
+import struct
+
+
+MAGIC = b'jsdrvrec'
+VERSION = 1
+TYPE_SIGNAL = 1
+TYPE_DATA = 2
+TYPE_USER_DATA = 3
+TYPE_USB_DEVICE = 4
+TYPE_USB_BULK_IN = 5
+TYPE_INDEX = 6
+TYPE_SUMMARY = 7
+TYPE_TOC = 8
+TYPE_END = 9
+CODEC_NONE = 0
+CODEC_F32 = 1
+_HEADER = struct.Struct('<8sII48x')
+_RECORD = struct.Struct('<IBBHII')
+_STREAM = struct.Struct('<QBBBBIIIqQdqqq')
+_USB = struct.Struct('<qB7x')
+_SUMMARY = struct.Struct('<QIB3x')
+_HOLD = struct.Struct('<QfffI')
+_INDEX_DTYPE = np.dtype([('sample_id', '<u8'), ('offset', '<u8')])
+_SUMMARY_DTYPE = np.dtype([('avg', '<f4'), ('std', '<f4'), ('min', '<f4'), ('max', '<f4')])
+_ELEMENT_TYPE_PREFIX = {2: 'i', 3: 'u', 4: 'f'}
+ELEMENT_TYPE_HOLD = 16
+
+
+def _utc(time_map, counter):
+    offset_time, offset_counter, counter_rate = time_map
+    if counter_rate <= 0:
+        return 0
+    return offset_time + int(round((counter - offset_counter) * time64.SECOND / counter_rate))
+
+
+def _f32_decode(b, n):
+    """Decode a jsdrv_stream_codec_encode() JSDRV_STREAM_CODEC_F32 block.
+
+    :param b: The encoded samples after the stream header.
+    :param n: The number of samples.
+    :return: The float32 samples.
+    :raise ValueError: If b is truncated or invalid.
+    """
+    if n == 0:
+        return np.zeros(0, dtype='<f4')
+    b = np.frombuffer(b, dtype=np.uint8)
+    if len(b) < 4:
+        raise ValueError('truncated f32 block')
+    first = b[:4].view('<u4')[0]
+    z = np.empty(n, dtype=np.uint32)
+    pos = 4
+    for i in range(0, n, 32):
+        count = min(32, n - i)
+        if pos >= len(b) or b[pos] > 32:
+            raise ValueError('invalid f32 block')
+        width = int(b[pos])
+        pos += 1
+        sz = (count * width + 7) // 8
+        if pos + sz > len(b):
+            raise ValueError('truncated f32 block')
+        if width == 0:
+            z[i:i + count] = 0
+        else:
+            bits = np.unpackbits(b[pos:pos + sz], bitorder='little')[:count * width].reshape((count, width))
+            z[i:i + count] = bits.astype(np.uint64) @ (np.uint64(1) << np.arange(width, dtype=np.uint64))
+        pos += sz
+    d = (z >> np.uint32(1)) ^ (np.uint32(0) - (z & np.uint32(1)))  # unzigzag
+    return (np.cumsum(d, dtype=np.uint32) + first).view('<f4')
+
+
+def _data_decode(signal_id, b, codec=CODEC_NONE):
+    (sample_id, field_id, index, element_type, element_size_bits, element_count,
+     sample_rate, decimate_factor, offset_time, offset_counter, counter_rate,
+     _, _, _) = _STREAM.unpack_from(b, 0)
+    time_map = (offset_time, offset_counter, counter_rate)
+    prefix = _ELEMENT_TYPE_PREFIX.get(element_type)
+    data = np.frombuffer(b, dtype=np.uint8, offset=_STREAM.size)
+    hold = None
+    if codec == CODEC_NONE and (element_type, element_size_bits) == (ELEMENT_TYPE_HOLD, _HOLD.size * 8):
+        sample_count, v_min, v_max, v_mean, _ = _HOLD.unpack_from(b, _STREAM.size)
+        hold = {'sample_count': sample_count, 'min': v_min, 'max': v_max, 'mean': v_mean}
+        data = np.full(sample_count, v_mean, dtype='<f4')
+    elif codec == CODEC_F32 and (element_type, element_size_bits) == (4, 32):
+        data = _f32_decode(data, element_count)
+    elif codec != CODEC_NONE:
+        raise ValueError(f'unsupported codec {codec}')
+    elif prefix is not None and element_size_bits >= 8:
+        dtype = np.dtype(f'<{prefix}{element_size_bits // 8}')
+        data = data[:element_count * dtype.itemsize].view(dtype)
+    else:  # packed u1 or u4, or undefined
+        data = data[:(element_count * element_size_bits + 7) // 8]
+    r = {
+        'type': 'data',
+        'signal_id': signal_id,
+        'sample_id': sample_id,
+        'utc': _utc(time_map, sample_id),
+        'field_id': field_id,
+        'index': index,
+        'element_type': element_type,
+        'element_size_bits': element_size_bits,
+        'element_count': element_count,
+        'sample_rate': sample_rate,
+        'decimate_factor': decimate_factor,
+        'time_map': {
+            'offset_time': offset_time,
+            'offset_counter': offset_counter,
+            'counter_rate': counter_rate,
+        },
+        'data': data,
+    }
+    if hold is not None:
+        r['hold'] = hold
+    return r
+
+
+def decode_bytes(b):
+    """Decode raw recording file contents.
+
+    :param b: The file contents as bytes.
+    :return: The generator of record dicts in file order.  Each dict
+        has a 'type' key which is one of:
+        * 'signal': with signal_id and topic.
+        * 'data': with signal_id, sample_id, utc, the stream fields, and
+          data.  u1 and u4 data remain packed as uint8.  Compressed
+          float32 data is decoded.  Deadband hold records also have
+          hold with sample_count, min, max, and mean, and their data
+          expands to sample_count float32 copies of mean.
+        * 'user_data': with chunk_meta and data bytes.
+        * 'usb_device': with device_id and prefix from a USB capture.
+        * 'usb_bulk_in': with device_id, time, endpoint, and the raw
+          transfer data bytes from a USB capture.
+        * 'index': with signal_id and entries, a structured array of
+          the sample_id and file offset for data records.
+        * 'summary': with signal_id, level, sample_id, samples_per_entry,
+          and entries, a structured array of avg, std, min, and max.
+
+    The table of contents and end records are not returned.
+    :raise ValueError: If b is not a raw recording file.
+
+    A recording that ended abnormally may end with a partial record,
+    which this function ignores.
+    """
+    if len(b) < _HEADER.size:
+        raise ValueError('too short')
+    magic, version, header_size = _HEADER.unpack_from(b, 0)
+    if magic != MAGIC:
+        raise ValueError('invalid magic')
+    if version != VERSION:
+        raise ValueError(f'unsupported version {version}')
+    b = memoryview(b)
+    pos = header_size
+    while pos + _RECORD.size <= len(b):
+        length, record_type, codec, record_id, size, _ = _RECORD.unpack_from(b, pos)
+        if length < _RECORD.size + size or (length & 7):
+            raise ValueError(f'invalid record length {length} at {pos}')
+        if pos + length > len(b):
+            break
+        payload = b[pos + _RECORD.size:pos + _RECORD.size + size]
+        pos += length
+        if record_type == TYPE_SIGNAL:
+            topic = bytes(payload).split(b'\x00', 1)[0].decode('utf-8')
+            yield {'type': 'signal', 'signal_id': record_id, 'topic': topic}
+        elif record_type == TYPE_DATA:
+            if size >= _STREAM.size:
+                yield _data_decode(record_id, payload, codec)
+        elif record_type == TYPE_USER_DATA:
+            yield {'type': 'user_data', 'chunk_meta': record_id, 'data': bytes(payload)}
+        elif record_type == TYPE_USB_DEVICE:
+            prefix = bytes(payload).split(b'\x00', 1)[0].decode('utf-8')
+            yield {'type': 'usb_device', 'device_id': record_id, 'prefix': prefix}
+        elif record_type == TYPE_USB_BULK_IN:
+            if size >= _USB.size:
+                time, endpoint = _USB.unpack_from(payload, 0)
+                yield {'type': 'usb_bulk_in', 'device_id': record_id, 'time': time, 'endpoint': endpoint,
+                       'data': bytes(payload[_USB.size:])}
+        elif record_type == TYPE_INDEX:
+            entries = np.frombuffer(payload, dtype=_INDEX_DTYPE, count=size // _INDEX_DTYPE.itemsize)
+            yield {'type': 'index', 'signal_id': record_id, 'entries': entries}
+        elif record_type == TYPE_SUMMARY:
+            if size >= _SUMMARY.size:
+                sample_id, samples_per_entry, level = _SUMMARY.unpack_from(payload, 0)
+                count = (size - _SUMMARY.size) // _SUMMARY_DTYPE.itemsize
+                entries = np.frombuffer(payload, dtype=_SUMMARY_DTYPE, count=count, offset=_SUMMARY.size)
+                yield {'type': 'summary', 'signal_id': record_id, 'level': level, 'sample_id': sample_id,
+                       'samples_per_entry': samples_per_entry, 'entries': entries}
+
+
+def decode(path):
+    """Decode a raw recording file.
+
+    :param path: The file path.
+    :return: The generator of record dicts, see decode_bytes().
+    """
+    with open(path, 'rb') as f:
+        b = f.read()
+    return decode_bytes(b)
+
+
+def to_jls(src, dst, utc_interval=None):
+    """Convert a raw recording file to a JLS v2 file.
+
+    :param src: The raw recording file path.
+    :param dst: The JLS output file path.
+    :param utc_interval: The interval between UTC entries in time64.
+        None (default) uses 1 minute.
+    :raise RuntimeError: If the pyjls package is not available.
+    """
+    from .record import Writer, SignalType, DataType, _SIGNALS
+    if Writer is None:
+        raise RuntimeError('pyjls package not found.  Install using:\n' +
+                           '  pip3 install -U pyjls')
+    utc_interval = time64.MINUTE if utc_interval is None else int(utc_interval)
+    data_types = {(4, 32): DataType.F32, (3, 8): DataType.U8, (3, 4): DataType.U4, (3, 1): DataType.U1,
+                  (ELEMENT_TYPE_HOLD, _HOLD.size * 8): DataType.F32}
+    suffix_map = dict([(s['data_topic'], (name, s['units'])) for name, s in _SIGNALS.items()])
+    sources = {}
+    signals = {}
+    wr = Writer(dst)
+    try:
+        for r in decode(src):
+            if r['type'] == 'user_data':
+                data = r['data']
+                if r['chunk_meta'] == 0:
+                    data = data.decode('utf-8')
+                wr.user_data(r['chunk_meta'], data)
+            elif r['type'] == 'signal':
+                parts = r['topic'].split('/')
+                device_path = '/'.join(parts[:3])
+                suffix = '/'.join(parts[3:])
+                if device_path not in sources:
+                    source_id = len(sources) + 1
+                    sources[device_path] = source_id
+                    model, serial_number = parts[1].upper(), parts[2]
+                    wr.source_def(source_id=source_id, name=f'{model}-{serial_number}', vendor='Jetperch',
+                                  model=model, version='', serial_number=serial_number)
+                name, units = suffix_map.get(suffix, (suffix, ''))
+                signals[r['signal_id']] = {
+                    'source_id': sources[device_path],
+                    'name': name,
+                    'units': units,
+                    'utc_next': None,
+                    'utc': None,
+                }
+            elif r['type'] == 'data':
+                signal_id = r['signal_id']
+                signal = signals.get(signal_id)
+                data_type = data_types.get((r['element_type'], r['element_size_bits']))
+                if signal is None or data_type is None:
+                    continue
+                decimate_factor = r['decimate_factor']
+                sample_id = r['sample_id'] // decimate_factor
+                if signal['utc_next'] is None:
+                    wr.signal_def(
+                        signal_id=signal_id,
+                        source_id=signal['source_id'],
+                        signal_type=SignalType.FSR,
+                        data_type=data_type,
+                        sample_rate=r['sample_rate'] // decimate_factor,
+                        name=signal['name'],
+                        units=signal['units'],
+                    )
+                    wr.utc(signal_id, sample_id, r['utc'])
+                    signal['utc_next'] = r['utc'] + utc_interval
+                if r['utc'] >= signal['utc_next']:
+                    wr.utc(signal_id, sample_id, r['utc'])
+                    signal['utc_next'] += utc_interval
+                    signal['utc'] = None
+                elif sample_id:
+                    signal['utc'] = (sample_id, r['utc'])
+                if r['element_count']:
+                    wr.fsr_f32(signal_id, sample_id, np.ascontiguousarray(r['data']))
+        for signal_id, signal in signals.items():
+            if signal['utc'] is not None:
+                wr.utc(signal_id, *signal['utc'])
+    finally:
+        wr.close()
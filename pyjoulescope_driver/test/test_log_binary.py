@@ -0,0 +1,70 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import struct
+import unittest
+from pyjoulescope_driver.log_binary import decode_bytes, format_record, FLAG_PAD
+
+
+DATA_SIZE = 256
+
+
+def _record(level, filename, line, message, timestamp):
+    fn = filename.encode('utf-8')
+    msg = message.encode('utf-8')
+    size = (24 + len(fn) + len(msg) + 7) & ~7
+    r = struct.pack('<IBBHIHHq', size, level, 0, len(fn), line, len(msg), 0, timestamp) + fn + msg
+    return r + bytes(size - len(r))
+
+
+def _file(data, head, tail):
+    hdr = struct.pack('<8sIIQQQ24x', b'jsdrvlog', 1, 64, DATA_SIZE, head, tail)
+    return hdr + bytes(data)
+
+
+class TestLogBinary(unittest.TestCase):
+
+    def test_empty(self):
+        self.assertEqual([], list(decode_bytes(_file(bytes(DATA_SIZE), 0, 0))))
+
+    def test_records(self):
+        r1 = _record(6, 'a.c', 10, 'hello', 1 << 30)
+        r2 = _record(3, 'bb.c', 20, 'world!', 2 << 30)
+        data = bytearray(DATA_SIZE)
+        data[:len(r1) + len(r2)] = r1 + r2
+        records = list(decode_bytes(_file(data, len(r1) + len(r2), 0)))
+        self.assertEqual(2, len(records))
+        self.assertEqual({'timestamp': 1 << 30, 'level': 6, 'filename': 'a.c', 'line': 10, 'message': 'hello'},
+                         records[0])
+        self.assertEqual('world!', records[1]['message'])
+        self.assertIn(' E bb.c:20 world!', format_record(records[1]))
+
+    def test_wrap(self):
+        r1 = _record(6, 'a.c', 1, 'first', 0)
+        r2 = _record(6, 'a.c', 2, 'second', 0)
+        data = bytearray(DATA_SIZE)
+        pos = 200
+        data[pos:pos + len(r1)] = r1
+        pos += len(r1)
+        pad_size = DATA_SIZE - pos
+        data[pos:pos + 8] = struct.pack('<IBBH', pad_size, 0, FLAG_PAD, 0)
+        data[0:len(r2)] = r2
+        tail = 3 * DATA_SIZE + 200
+        head = tail + len(r1) + pad_size + len(r2)
+        records = list(decode_bytes(_file(data, head, tail)))
+        self.assertEqual([1, 2], [r['line'] for r in records])
+
+    def test_invalid(self):
+        with self.assertRaises(ValueError):
+            list(decode_bytes(b'not a log file' * 8))
@@ -0,0 +1,141 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import numpy as np
+import struct
+import unittest
+from pyjoulescope_driver import time64
+from pyjoulescope_driver.record_raw import decode_bytes, TYPE_SIGNAL, TYPE_DATA, TYPE_USER_DATA, \
+    TYPE_USB_DEVICE, TYPE_USB_BULK_IN, TYPE_INDEX, TYPE_SUMMARY, TYPE_TOC, TYPE_END
+
+
+def _record(record_type, record_id, payload, codec=0):
+    length = (16 + len(payload) + 7) & ~7
+    r = struct.pack('<IBBHII', length, record_type, codec, record_id, len(payload), 0) + payload
+    return r + bytes(length - len(r))
+
+
+def _stream(sample_id, data, element_type=4, element_size_bits=32, element_count=None):
+    if element_count is None:
+        element_count = len(data) * 8 // element_size_bits
+    hdr = struct.pack('<QBBBBIIIqQdqqq', sample_id, 1, 0, element_type, element_size_bits, element_count,
+                      1000000, 2, time64.SECOND * 10, 0, 1000000.0, 0, 0, 0)
+    return hdr + data
+
+
+def _file(*records):
+    return struct.pack('<8sII48x', b'jsdrvrec', 1, 64) + b''.join(records)
+
+
+class TestRecordRaw(unittest.TestCase):
+
+    def test_invalid(self):
+        with self.assertRaises(ValueError):
+            list(decode_bytes(b'jsdrvrec'))
+        with self.assertRaises(ValueError):
+            list(decode_bytes(struct.pack('<8sII48x', b'jsdrvlog', 1, 64)))
+
+    def test_empty(self):
+        self.assertEqual([], list(decode_bytes(_file())))
+
+    def test_records(self):
+        x = np.arange(10, dtype=np.float32)
+        b = _file(
+            _record(TYPE_USER_DATA, 0, b'hello'),
+            _record(TYPE_SIGNAL, 1, b'u/js220/000415/s/i/!data\x00'),
+            _record(TYPE_SIGNAL, 2, b'u/js220/000415/s/i/range/!data\x00'),
+            _record(TYPE_DATA, 1, _stream(2000000, x.tobytes())),
+            _record(TYPE_DATA, 2, _stream(2000000, b'\x21\x43\x05', 3, 4, 5)),
+        )
+        records = list(decode_bytes(b))
+        self.assertEqual(5, len(records))
+        self.assertEqual({'type': 'user_data', 'chunk_meta': 0, 'data': b'hello'}, records[0])
+        self.assertEqual({'type': 'signal', 'signal_id': 1, 'topic': 'u/js220/000415/s/i/!data'}, records[1])
+        r = records[3]
+        self.assertEqual('data', r['type'])
+        self.assertEqual(1, r['signal_id'])
+        self.assertEqual(2000000, r['sample_id'])
+        self.assertEqual(2, r['decimate_factor'])
+        self.assertEqual(time64.SECOND * 12, r['utc'])
+        np.testing.assert_equal(x, r['data'])
+        r = records[4]
+        self.assertEqual(5, r['element_count'])
+        self.assertEqual(b'\x21\x43\x05', r['data'].tobytes())
+
+    def test_codec_f32(self):
+        x = np.array([1.0, 1.0, 2.0], dtype=np.float32)
+        x[1] = np.frombuffer(struct.pack('<I', 0x3f800001), dtype=np.float32)[0]
+        # first sample, width 24, zigzag differences 0, 2, 0xfffffe
+        z = (2 << 24) | (0xfffffe << 48)
+        encoded = struct.pack('<I', 0x3f800000) + b'\x18' + z.to_bytes(9, 'little')
+        b = _file(
+            _record(TYPE_DATA, 1, _stream(1000, encoded, element_count=3), codec=1),
+            _record(TYPE_DATA, 1, _stream(1006, struct.pack('<I', 0x40000000) + b'\x00', element_count=4), codec=1),
+        )
+        records = list(decode_bytes(b))
+        self.assertEqual(2, len(records))
+        np.testing.assert_equal(x.view(np.uint32), records[0]['data'].view(np.uint32))
+        np.testing.assert_equal(np.full(4, 2.0, dtype=np.float32), records[1]['data'])
+
+    def test_codec_invalid(self):
+        b = _file(_record(TYPE_DATA, 1, _stream(1000, struct.pack('<I', 0) + b'\x21', element_count=3), codec=1))
+        with self.assertRaises(ValueError):
+            list(decode_bytes(b))
+
+    def test_hold(self):
+        hold = struct.pack('<QfffI', 5, 1.5, 2.5, 2.0, 0)
+        b = _file(_record(TYPE_DATA, 1, _stream(1000, hold, 16, 192, 1)))
+        records = list(decode_bytes(b))
+        self.assertEqual(1, len(records))
+        r = records[0]
+        self.assertEqual({'sample_count': 5, 'min': 1.5, 'max': 2.5, 'mean': 2.0}, r['hold'])
+        np.testing.assert_equal(np.full(5, 2.0, dtype=np.float32), r['data'])
+
+    def test_usb(self):
+        b = _file(
+            _record(TYPE_USB_DEVICE, 1, b'u/js220/000415\x00'),
+            _record(TYPE_USB_BULK_IN, 1, struct.pack('<qB7x', 12345, 0x82) + b'\x01\x02\x03'),
+        )
+        records = list(decode_bytes(b))
+        self.assertEqual({'type': 'usb_device', 'device_id': 1, 'prefix': 'u/js220/000415'}, records[0])
+        self.assertEqual({'type': 'usb_bulk_in', 'device_id': 1, 'time': 12345, 'endpoint': 0x82,
+                          'data': b'\x01\x02\x03'}, records[1])
+
+    def test_index_summary(self):
+        b = _file(
+            _record(TYPE_INDEX, 1, struct.pack('<QQQQ', 1000, 64, 3000, 4096)),
+            _record(TYPE_SUMMARY, 1, struct.pack('<QIB3x', 1000, 1024, 1) + struct.pack('<4f', 1, 2, 0, 3)),
+        )
+        toc_offset = len(b)
+        b += _record(TYPE_TOC, 0, struct.pack('<QQ', 64, 64 + 48))
+        b += _record(TYPE_END, 0, struct.pack('<Q', toc_offset))
+        records = list(decode_bytes(b))
+        self.assertEqual(2, len(records))
+        r = records[0]
+        self.assertEqual('index', r['type'])
+        self.assertEqual([1000, 3000], r['entries']['sample_id'].tolist())
+        self.assertEqual([64, 4096], r['entries']['offset'].tolist())
+        r = records[1]
+        self.assertEqual('summary', r['type'])
+        self.assertEqual(1, r['level'])
+        self.assertEqual(1000, r['sample_id'])
+        self.assertEqual(1024, r['samples_per_entry'])
+        self.assertEqual([1.0], r['entries']['avg'].tolist())
+        self.assertEqual([3.0], r['entries']['max'].tolist())
+
+    def test_truncated(self):
+        b = _file(_record(TYPE_USER_DATA, 1, b'first'), _record(TYPE_USER_DATA, 2, b'second'))
+        records = list(decode_bytes(b[:-4]))
+        self.assertEqual(1, len(records))
+        self.assertEqual(b'first', records[0]['data'])
@@ -0,0 +1,77 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import numpy as np
+import os
+import struct
+import unittest
+from pyjoulescope_driver import SharedStreamBridge, SharedStreamReader
+
+
+SIZE = 1 << 20
+
+
+def _stream(sample_id, x):
+    hdr = struct.pack('<QBBBBIIIqQdqqq', sample_id, 1, 0, 4, 32, len(x),
+                      1000000, 1, 0, 0, 1000000.0, 0, 0, 0)
+    return hdr + x.tobytes()
+
+
+class TestShm(unittest.TestCase):
+
+    def setUp(self):
+        self.name = f'jsdrv_test_{os.getpid()}'
+
+    def test_not_found(self):
+        with self.assertRaises(Exception):
+            SharedStreamReader(self.name)
+
+    def test_values(self):
+        with SharedStreamBridge(self.name, SIZE) as b:
+            with SharedStreamReader(self.name) as r:
+                self.assertIsNone(r.read(timeout=0))
+                b.write('a/b/c', 42)
+                b.write('a/b/d', 'hello')
+                self.assertEqual(('a/b/c', 42), r.read(timeout=1))
+                self.assertEqual(('a/b/d', 'hello'), r.read(timeout=1))
+
+    def test_stream_view(self):
+        x = np.arange(1000, dtype=np.float32)
+        with SharedStreamBridge(self.name, SIZE) as b:
+            with SharedStreamReader(self.name) as r:
+                b.write('u/js220/0123/s/i/!data', _stream(1000, x))
+                topic, v = r.read(timeout=1)
+                self.assertEqual('u/js220/0123/s/i/!data', topic)
+                self.assertEqual(1000, v['sample_id'])
+                self.assertFalse(v['data'].flags.writeable)
+                np.testing.assert_equal(x, v['data'])
+                self.assertTrue(r.check())
+
+    def test_stream_copy(self):
+        x = np.arange(1000, dtype=np.float32)
+        with SharedStreamBridge(self.name, SIZE) as b:
+            with SharedStreamReader(self.name, copy=True) as r:
+                b.write('u/js220/0123/s/i/!data', _stream(1000, x))
+                _, v = r.read(timeout=1)
+                self.assertTrue(v['data'].flags.writeable)
+                np.testing.assert_equal(x, v['data'])
+
+    def test_close(self):
+        b = SharedStreamBridge(self.name, SIZE)
+        r = SharedStreamReader(self.name)
+        b.write('a/b/c', 1)
+        b.close()
+        self.assertEqual([('a/b/c', 1)], list(r))
+        self.assertTrue(r.closed)
+        r.close()
@@ -0,0 +1,41 @@
+# Copyright 2024 Jetperch LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+from pyjoulescope_driver import time_from_counter, time_to_counter, time_from_counter_range, time64
+import numpy as np
+
+
+TIME_MAP = {
+    'offset_time': time64.HOUR,
+    'offset_counter': 2200000,
+    'counter_rate': 1000.0,
+}
+
+
+class TestTimeMap(unittest.TestCase):
+
+    def test_from_counter(self):
+        counter = np.array([2200000 - 1000, 2200000, 2200000 + 1000], dtype=np.uint64)
+        expect = np.array([time64.HOUR - time64.SECOND, time64.HOUR, time64.HOUR + time64.SECOND], dtype=np.int64)
+        np.testing.assert_equal(expect, time_from_counter(TIME_MAP, counter))
+        np.testing.assert_equal(counter, time_to_counter(TIME_MAP, expect))
+
+    def test_range(self):
+        utc = time_from_counter_range(TIME_MAP, 2200000, 2, 5)
+        np.testing.assert_equal(time_from_counter(TIME_MAP, 2200000 + 2 * np.arange(5)), utc)
+
+    def test_empty(self):
+        self.assertEqual(0, len(time_from_counter(TIME_MAP, [])))
+        self.assertEqual(0, len(time_from_counter_range(TIME_MAP, 0, 1, 0)))
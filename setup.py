@@ -78,7 +78,7 @@ if platform.system() == 'Windows':
         'src/backend/winusb/msg_queue.c',
         'src/backend/windows.c',
     ]
-    libraries = ['Setupapi', 'Winusb', 'user32', 'winmm']
+    libraries = ['Setupapi', 'Winusb', 'user32', 'winmm', 'ws2_32']
     extra_compile_args = []
 elif 'armv7' in platform.machine():
     sources = posix_sources
@@ -116,22 +116,32 @@ elif platform.system() == 'Linux':
         os.path.join(MYPATH, 'third-party/libusb/libusb'),
         os.path.join(MYPATH, 'third-party/libusb/include/linux'),
     ])
-    libraries += ['udev']
+    libraries += ['udev', 'rt']  # rt for shm_open
 
 ext = '.pyx' if USE_CYTHON else '.c'
 extensions = [
     setuptools.Extension('pyjoulescope_driver.binding',
                          sources=[
                                      'pyjoulescope_driver/binding' + ext,
+                                     'src/align.c',
+                                     'src/alloc.c',
+                                     'src/aligner.c',
                                      'src/buffer.c',
                                      'src/buffer_signal.c',
                                      'src/calibration_hash.c',
                                      'src/cstr.c',
+                                     'src/deadband.c',
+                                     'src/derived.c',
                                      'src/devices.c',
+                                     'src/dispatch.c',
                                      'src/downsample.c',
-                                     #'src/emu.c',
-                                     #'src/emulated.c',
+                                     'src/emulated.c',
                                      'src/error_code.c',
+                                     'src/f32_codec.c',
+                                     'src/f32_ops.c',
+                                     'src/file_map.c',
+                                     'src/integrator.c',
+                                     'src/interval.c',
                                      'src/js110_cal.c',
                                      'src/js110_sample_processor.c',
                                      'src/js110_stats.c',
@@ -142,16 +152,48 @@ extensions = [
                                      'src/js220_stats.c',
                                      'src/jsdrv.c',
                                      'src/json.c',
+                                     'src/latency_hist.c',
                                      'src/log.c',
+                                     'src/log_binary.c',
+                                     'src/net.c',
+                                     'src/pack.c',
+                                     'src/page_alloc.c',
+                                     'src/param_cache.c',
+                                     'src/power_f32.c',
                                      'src/pubsub.c',
+                                     'src/quantile.c',
+                                     'src/raw_cal.c',
+                                     'src/recorder.c',
+                                     'src/recorder_reader.c',
                                      'src/meta.c',
+                                     'src/mpmc_ring.c',
                                      'src/sample_buffer_f32.c',
+                                     'src/shm.c',
+                                     'src/snapshot.c',
+                                     'src/spectrum.c',
+                                     'src/stage.c',
                                      'src/statistics.c',
+                                     'src/stats_group.c',
+                                     'src/stats_windows.c',
+                                     'src/stream_flush.c',
+                                     'src/stream_gate.c',
+                                     'src/stream_health.c',
+                                     'src/stream_codec.c',
+                                     'src/stream_reader.c',
+                                     'src/stream_ring.c',
+                                     'src/thread_stats.c',
                                      'src/time.c',
                                      'src/time_map_filter.c',
+                                     'src/timeouts.c',
                                      'src/topic.c',
+                                     'src/trace.c',
+                                     'src/trigger.c',
                                      'src/union.c',
+                                     'src/unpack.c',
+                                     'src/usb_stats.c',
+                                     'src/value_shared.c',
                                      'src/version.c',
+                                     'src/welch.c',
                                      'third-party/tinyprintf/tinyprintf.c',
                                      ] + sources,
                          include_dirs=C_INCS,
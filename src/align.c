@@ -0,0 +1,423 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/align.h"
+#include "jsdrv_prv/aligner.h"
+#include "jsdrv_prv/dbc.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/topic.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/thread.h"
+#include "jsdrv.h"
+#include "tinyprintf.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+
+#define ALIGN_BLOCK_MAX_BYTES   (JSDRV_STREAM_DATA_SIZE)
+
+
+static const char * action_add_meta = "{"
+    "\"dtype\": \"u32\","
+    "\"brief\": \"Add an alignment group.\""
+"}";
+
+static const char * action_remove_meta = "{"
+    "\"dtype\": \"u32\","
+    "\"brief\": \"Remove an alignment group.\""
+"}";
+
+static const char * action_list_meta = "{"
+    "\"brief\": \"The list of available alignment groups, 0 terminated.\""
+"}";
+
+struct group_s {
+    uint8_t idx;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    struct jsdrv_context_s * context;
+    uint32_t sample_rate;   // 0 for the slowest channel
+    uint32_t block_samples; // 0 for one full message
+    struct jsdrv_aligner_s * aligner;
+    char channel_topics[JSDRV_ALIGN_CHANNEL_COUNT_MAX][JSDRV_TOPIC_LENGTH_MAX];
+    struct msg_queue_s * cmd_q;
+    jsdrv_thread_t thread;
+    volatile uint8_t do_exit;
+};
+
+struct align_mgr_s {
+    struct jsdrv_context_s * context;
+    struct group_s groups[JSDRV_ALIGN_COUNT_MAX];
+};
+
+
+static struct align_mgr_s instance_ = {.context = NULL};
+
+static uint8_t _align_recv(void * user_data, struct jsdrvp_msg_s * msg);
+static uint8_t _align_recv_data(void * user_data, struct jsdrvp_msg_s * msg);
+
+static bool is_group_idx_valid(uint64_t group_idx) {
+    return ((group_idx >= 1) && (group_idx <= JSDRV_ALIGN_COUNT_MAX));
+}
+
+static void send_to_frontend(struct align_mgr_s * self, const char * topic, const struct jsdrv_union_s * value) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, topic, value);
+    jsdrvp_backend_send(self->context, m);
+}
+
+static int32_t subscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+                         jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_SUBSCRIBE, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, topic, sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = cbk_fn;
+    m->payload.sub.subscriber.user_data = cbk_user_data;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = flags;
+    jsdrvp_backend_send(context, m);
+    return 0;
+}
+
+static int32_t unsubscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+                           jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_UNSUBSCRIBE, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, topic, sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = cbk_fn;
+    m->payload.sub.subscriber.user_data = cbk_user_data;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = flags;
+    jsdrvp_backend_send(context, m);
+    return 0;
+}
+
+static int32_t send_return_code_to_frontend(struct jsdrv_context_s * context, const char * topic, int32_t rc,
+        jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m;
+    m = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_i32(rc));
+    tfp_snprintf(m->topic, sizeof(m->topic), "%s%c", topic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+    m->extra.frontend.subscriber.internal_fn = cbk_fn;
+    m->extra.frontend.subscriber.user_data = cbk_user_data;
+    m->extra.frontend.subscriber.is_internal = 1;
+    jsdrvp_backend_send(context, m);
+    return rc;
+}
+
+static int32_t group_recv_complete(struct group_s * self, const char * subtopic, int32_t rc) {
+    if (rc >= 0) {
+        struct jsdrvp_msg_s * m;
+        m = jsdrvp_msg_alloc_value(self->context, "", &jsdrv_union_i32(rc));
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s%c", self->topic,
+                     subtopic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+        m->extra.frontend.subscriber.internal_fn = _align_recv;
+        m->extra.frontend.subscriber.user_data = NULL;
+        m->extra.frontend.subscriber.is_internal = 1;
+        jsdrvp_backend_send(self->context, m);
+    }
+    return rc;
+}
+
+static void channel_unsub(struct group_s * self, uint32_t channel) {
+    char * topic = self->channel_topics[channel];
+    if (topic[0]) {
+        intptr_t v = ((((intptr_t) channel) & 0xffff) << 16) | (self->idx & 0xffff);
+        unsubscribe(self->context, topic, JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM, _align_recv_data, (void *) v);
+        topic[0] = 0;
+    }
+}
+
+static void channel_sub(struct group_s * self, uint32_t channel, const char * topic) {
+    channel_unsub(self, channel);
+    jsdrv_cstr_copy(self->channel_topics[channel], topic, sizeof(self->channel_topics[channel]));
+    intptr_t v = ((((intptr_t) channel) & 0xffff) << 16) | (self->idx & 0xffff);
+    subscribe(self->context, topic, JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM, _align_recv_data, (void *) v);
+}
+
+// Use one full message for each block unless configured smaller.
+static void group_configure(struct group_s * self) {
+    uint32_t channel_count = 0;
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        channel_count += self->channel_topics[idx][0] ? 1 : 0;
+    }
+    uint32_t block_max = ALIGN_BLOCK_MAX_BYTES / (sizeof(float) * (channel_count ? channel_count : 1));
+    uint32_t block_samples = self->block_samples;
+    if ((0 == block_samples) || (block_samples > block_max)) {
+        block_samples = block_max;
+    }
+    jsdrv_aligner_configure(self->aligner, self->sample_rate, block_samples);
+}
+
+static void blocks_publish(struct group_s * self) {
+    uint32_t size;
+    while (0 != (size = jsdrv_aligner_ready(self->aligner))) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(self->context, "", size);
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", self->topic, JSDRV_ALIGN_MSG_DATA);
+        jsdrv_aligner_next(self->aligner, (struct jsdrv_align_block_s *) m->value.value.bin);
+        m->value.size = size;
+        m->value.app = JSDRV_PAYLOAD_TYPE_ALIGN;
+        m->extra.frontend.subscriber.internal_fn = _align_recv;  // skip our own subscription
+        m->extra.frontend.subscriber.user_data = self;
+        m->extra.frontend.subscriber.is_internal = 1;
+        jsdrvp_backend_send(self->context, m);
+    }
+}
+
+static void cmd_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
+    if (msg->u32_a) {
+        jsdrvp_msg_free(context, msg->payload.dispatch);  // release reference
+    }
+    jsdrvp_msg_free(context, msg);
+}
+
+static void handle_cmd(struct group_s * self, struct jsdrvp_msg_s * msg) {
+    int32_t rc = -1;  // ignored
+    const char * s = msg->topic;
+    if ((msg->u32_a > 0) && (msg->u32_a <= JSDRV_ALIGN_CHANNEL_COUNT_MAX)) {
+        struct jsdrv_stream_signal_s * signal = (struct jsdrv_stream_signal_s *) msg->payload.dispatch->value.value.bin;
+        int32_t add_rc = jsdrv_aligner_add(self->aligner, msg->u32_a - 1, signal);
+        if (add_rc && (JSDRV_ERROR_UNAVAILABLE != add_rc)) {
+            JSDRV_LOGW("align %u channel %u: add failed %d", (unsigned int) self->idx,
+                       (unsigned int) msg->u32_a, (int) add_rc);
+        }
+        blocks_publish(self);
+    } else if ((s[0] == 'c') && (s[1] == '/')) {
+        uint32_t idx = 0;
+        for (s += 2; (*s >= '0') && (*s <= '9'); ++s) {
+            idx = idx * 10 + (*s - '0');
+        }
+        if ((idx < 1) || (idx > JSDRV_ALIGN_CHANNEL_COUNT_MAX) || (*s != '/')) {
+            JSDRV_LOGW("Invalid channel: %s", msg->topic);
+            rc = JSDRV_ERROR_NOT_FOUND;
+        } else if (0 == strcmp(s + 1, "topic")) {
+            const char * topic = (msg->value.type == JSDRV_UNION_STR) ? msg->value.value.str : "";
+            JSDRV_LOGI("align %u channel %u topic %s", (unsigned int) self->idx, (unsigned int) idx, topic);
+            if (topic[0]) {
+                channel_sub(self, idx - 1, topic);
+            } else {
+                channel_unsub(self, idx - 1);
+            }
+            jsdrv_aligner_channel(self->aligner, idx - 1, topic[0] != 0);
+            group_configure(self);
+            rc = 0;
+        } else {
+            rc = JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    } else if ((s[0] == 'g') && (s[1] == '/')) {
+        s += 2;
+        struct jsdrv_union_s v = msg->value;
+        jsdrv_union_widen(&v);
+        if (0 == strcmp(s, "rate")) {
+            self->sample_rate = v.value.u32;
+            group_configure(self);
+            rc = 0;
+        } else if (0 == strcmp(s, "block")) {
+            self->block_samples = v.value.u32;
+            group_configure(self);
+            rc = 0;
+        } else if (0 == strcmp(s, "!clear")) {
+            jsdrv_aligner_clear(self->aligner);
+            rc = 0;
+        } else {
+            JSDRV_LOGW("align global unsupported: %s", s);
+            rc = JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    } else if (0 == strcmp(s, JSDRV_MSG_FINALIZE)) {
+        self->do_exit = 1;
+        rc = 0;
+    } else {
+        JSDRV_LOGW("ignore %s", msg->topic);
+        rc = JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    group_recv_complete(self, msg->topic, rc);
+    cmd_msg_free(self->context, msg);
+}
+
+static THREAD_RETURN_TYPE group_thread(THREAD_ARG_TYPE lpParam) {
+    struct group_s * self = (struct group_s *) lpParam;
+    JSDRV_LOGI("align thread started: %s", self->topic);
+    jsdrvp_thread_configure(self->context, JSDRVP_THREAD_BUFFER, "jsdrv_align");
+    jsdrvp_msg_cache_attach(self->context);
+
+    while (!self->do_exit) {
+        struct jsdrvp_msg_s * msg;
+        if (0 == msg_queue_pop(self->cmd_q, &msg, MSG_QUEUE_TIMEOUT_FOREVER)) {
+            handle_cmd(self, msg);
+        }
+    }
+
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        channel_unsub(self, idx);
+    }
+    jsdrvp_msg_cache_detach(self->context);
+    JSDRV_LOGI("align thread done: %s", self->topic);
+    THREAD_RETURN();
+}
+
+static void _send_group_list(struct align_mgr_s * self) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_LIST, &jsdrv_union_cbin_r(NULL, 0));
+    for (uint8_t group_idx = 1; group_idx <= JSDRV_ALIGN_COUNT_MAX; ++group_idx) {
+        if (NULL != self->groups[group_idx - 1].cmd_q) {
+            m->payload.bin[m->value.size++] = group_idx;
+        }
+    }
+    m->payload.bin[m->value.size++] = 0;
+    jsdrvp_backend_send(self->context, m);
+}
+
+static uint8_t _align_recv(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct group_s * g = (struct group_s *) user_data;
+    if (jsdrv_cstr_ends_with(msg->topic, JSDRV_ALIGN_MSG_DATA)) {
+        return 0;  // our own output
+    }
+    size_t prefix_len = strlen(g->topic);
+    if (!jsdrv_cstr_starts_with(msg->topic, g->topic) || (msg->topic[prefix_len] != '/')) {
+        JSDRV_LOGE("unexpected topic %s to %s", msg->topic, g->topic);
+        return 1;
+    }
+    if (NULL != g->cmd_q) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_clone(g->context, msg);
+        jsdrv_cstr_copy(m->topic, msg->topic + prefix_len + 1, sizeof(m->topic));
+        m->u32_a = 0;  // command
+        msg_queue_push(g->cmd_q, m);
+    }
+    return 0;
+}
+
+static uint8_t _align_recv_data(void * user_data, struct jsdrvp_msg_s * msg) {
+    intptr_t v = (intptr_t) user_data;
+    uint32_t group_idx = v & 0xffff;
+    uint32_t channel = (v >> 16) & 0xffff;
+    if (!is_group_idx_valid(group_idx) || (channel >= JSDRV_ALIGN_CHANNEL_COUNT_MAX)) {
+        JSDRV_LOGE("align data invalid: %s", msg->topic);
+        return 1;
+    }
+    struct group_s * g = &instance_.groups[group_idx - 1];
+    struct jsdrv_stream_signal_s * signal = (struct jsdrv_stream_signal_s *) msg->value.value.bin;
+    if ((NULL != g->cmd_q) && signal->element_count) {
+        msg_queue_push(g->cmd_q, jsdrvp_msg_dispatch_ref(g->context, msg, channel + 1));
+    }
+    return 0;
+}
+
+static uint8_t _align_add(void * user_data, struct jsdrvp_msg_s * msg) {
+    (void) user_data;
+    struct align_mgr_s * self = &instance_;
+    struct jsdrv_union_s v = msg->value;
+    jsdrv_union_widen(&v);
+    uint64_t group_id_u64 = v.value.u64;
+    if (!is_group_idx_valid(group_id_u64)) {
+        JSDRV_LOGE("align group %llu invalid", group_id_u64);
+        return send_return_code_to_frontend(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_ADD, JSDRV_ERROR_PARAMETER_INVALID, _align_add, NULL);
+    }
+    uint8_t group_id = (uint8_t) group_id_u64;
+    struct group_s * g = &self->groups[group_id - 1];
+    if (NULL != g->cmd_q) {
+        JSDRV_LOGE("align group %u already exists", group_id);
+        return send_return_code_to_frontend(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_ADD, JSDRV_ERROR_ALREADY_EXISTS, _align_add, NULL);
+    }
+    JSDRV_LOGI("align group %u add", group_id);
+    memset(g, 0, sizeof(*g));
+    g->idx = group_id;
+    tfp_snprintf(g->topic, sizeof(g->topic), "a/%03u", group_id);
+    g->context = self->context;
+    g->aligner = jsdrv_aligner_new(JSDRV_ALIGN_HISTORY);
+    group_configure(g);
+    g->cmd_q = msg_queue_init();
+    subscribe(g->context, g->topic, JSDRV_SFLAG_PUB, _align_recv, g);
+    if (jsdrv_thread_create(&g->thread, group_thread, g, -1)) {
+        JSDRV_LOGE("align group %u thread create failed", group_id);
+        return send_return_code_to_frontend(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_ADD, JSDRV_ERROR_UNSPECIFIED, _align_add, NULL);
+    }
+    _send_group_list(self);
+    return send_return_code_to_frontend(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_ADD, 0, _align_add, NULL);
+}
+
+static void _align_remove_inner(struct align_mgr_s * self, uint8_t group_id) {
+    struct group_s * g = &self->groups[group_id - 1];
+    if (NULL == g->cmd_q) {
+        JSDRV_LOGE("align group %u does not exist", group_id);
+        return;
+    }
+    JSDRV_LOGI("align group %u remove", group_id);
+    unsubscribe(g->context, g->topic, JSDRV_SFLAG_PUB, _align_recv, g);
+    msg_queue_push(g->cmd_q, jsdrvp_msg_alloc_value(self->context, JSDRV_MSG_FINALIZE, &jsdrv_union_u8(0)));
+    jsdrv_thread_join(&g->thread, 1000);
+    struct jsdrvp_msg_s * m;
+    while (NULL != (m = msg_queue_pop_immediate(g->cmd_q))) {
+        cmd_msg_free(self->context, m);
+    }
+    msg_queue_finalize(g->cmd_q);
+    g->cmd_q = NULL;
+    jsdrv_aligner_free(g->aligner);
+    g->aligner = NULL;
+    _send_group_list(self);
+}
+
+static uint8_t _align_remove(void * user_data, struct jsdrvp_msg_s * msg) {
+    (void) user_data;
+    struct align_mgr_s * self = &instance_;
+    struct jsdrv_union_s v = msg->value;
+    jsdrv_union_widen(&v);
+    uint64_t group_id_u64 = v.value.u64;
+    if (!is_group_idx_valid(group_id_u64)) {
+        JSDRV_LOGE("invalid align group: %llu", group_id_u64);
+        return send_return_code_to_frontend(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_REMOVE, JSDRV_ERROR_NOT_FOUND, _align_remove, NULL);
+    }
+    _align_remove_inner(self, (uint8_t) group_id_u64);
+    return send_return_code_to_frontend(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_REMOVE, 0, _align_remove, NULL);
+}
+
+int32_t jsdrv_align_initialize(struct jsdrv_context_s * context) {
+    JSDRV_DBC_NOT_NULL(context);
+    struct align_mgr_s * self = &instance_;
+    if (NULL != self->context) {
+        JSDRV_LOGE("jsdrv_align_initialize but context not NULL");
+        return JSDRV_ERROR_IN_USE;
+    }
+    memset(self, 0, sizeof(*self));
+    self->context = context;
+
+    send_to_frontend(self, JSDRV_ALIGN_MGR_MSG_ACTION_ADD "$", &jsdrv_union_cjson_r(action_add_meta));
+    send_to_frontend(self, JSDRV_ALIGN_MGR_MSG_ACTION_REMOVE "$", &jsdrv_union_cjson_r(action_remove_meta));
+    send_to_frontend(self, JSDRV_ALIGN_MGR_MSG_ACTION_LIST "$", &jsdrv_union_cjson_r(action_list_meta));
+
+    subscribe(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_ADD, JSDRV_SFLAG_PUB, _align_add, NULL);
+    subscribe(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_REMOVE, JSDRV_SFLAG_PUB, _align_remove, NULL);
+    _send_group_list(self);
+    return 0;
+}
+
+void jsdrv_align_finalize(void) {
+    struct align_mgr_s * self = &instance_;
+    if (self->context) {
+        unsubscribe(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_ADD, JSDRV_SFLAG_PUB, _align_add, NULL);
+        unsubscribe(self->context, JSDRV_ALIGN_MGR_MSG_ACTION_REMOVE, JSDRV_SFLAG_PUB, _align_remove, NULL);
+        for (uint32_t group_idx = 1; group_idx <= JSDRV_ALIGN_COUNT_MAX; ++group_idx) {
+            if (NULL != self->groups[group_idx - 1].cmd_q) {
+                _align_remove_inner(self, (uint8_t) group_idx);
+            }
+        }
+        self->context = NULL;
+    }
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/aligner.h"
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/platform.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+
+JSDRV_STATIC_ASSERT(JSDRV_ALIGN_HEADER_SIZE == offsetof(struct jsdrv_align_block_s, data), align_header_size);
+
+struct channel_s {
+    float * ring;               // history samples, NULL when disabled
+    bool valid;                 // received samples since clear
+    uint32_t decimate_factor;
+    uint32_t sample_rate;       // the sample_id rate
+    struct jsdrv_time_map_s time_map;
+    int64_t n_tail;             // the oldest sample index, sample_id / decimate_factor
+    int64_t n_head;             // the next sample index
+};
+
+struct jsdrv_aligner_s {
+    uint32_t history;
+    uint32_t mask;
+    uint32_t sample_rate_cfg;   // 0 for the slowest channel
+    uint32_t block_samples;
+    bool started;
+    uint32_t sample_rate;       // the grid sample rate
+    int64_t t0;                 // the UTC time for grid sample 0
+    uint64_t k;                 // the next grid sample
+    struct channel_s channels[JSDRV_ALIGN_CHANNEL_COUNT_MAX];
+};
+
+
+struct jsdrv_aligner_s * jsdrv_aligner_new(uint32_t history) {
+    if ((history < 2) || (history > (1U << 31))) {
+        return NULL;
+    }
+    uint32_t sz = 2;
+    while (sz < history) {
+        sz <<= 1;
+    }
+    struct jsdrv_aligner_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_aligner_s));
+    self->history = sz;
+    self->mask = sz - 1;
+    self->block_samples = 1;
+    return self;
+}
+
+void jsdrv_aligner_free(struct jsdrv_aligner_s * self) {
+    if (NULL == self) {
+        return;
+    }
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        jsdrv_aligner_channel(self, idx, false);
+    }
+    jsdrv_free(self);
+}
+
+void jsdrv_aligner_clear(struct jsdrv_aligner_s * self) {
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        struct channel_s * ch = &self->channels[idx];
+        ch->valid = false;
+        ch->n_tail = 0;
+        ch->n_head = 0;
+    }
+    self->started = false;
+    self->k = 0;
+}
+
+void jsdrv_aligner_configure(struct jsdrv_aligner_s * self, uint32_t sample_rate, uint32_t block_samples) {
+    self->sample_rate_cfg = sample_rate;
+    self->block_samples = block_samples ? block_samples : 1;
+    jsdrv_aligner_clear(self);
+}
+
+int32_t jsdrv_aligner_channel(struct jsdrv_aligner_s * self, uint32_t channel, bool enable) {
+    if (channel >= JSDRV_ALIGN_CHANNEL_COUNT_MAX) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct channel_s * ch = &self->channels[channel];
+    if (enable && (NULL == ch->ring)) {
+        ch->ring = jsdrv_alloc_aligned(self->history * sizeof(float), JSDRV_ALLOC_ALIGNMENT);
+    } else if (!enable && (NULL != ch->ring)) {
+        jsdrv_free(ch->ring);
+        ch->ring = NULL;
+    }
+    jsdrv_aligner_clear(self);
+    return 0;
+}
+
+// Write count samples at the head, from data or the constant value when data is NULL.
+static void ring_write(struct jsdrv_aligner_s * self, struct channel_s * ch, const float * data, float value, uint32_t count) {
+    uint32_t idx = (uint32_t) (ch->n_head & self->mask);
+    uint32_t sz = self->history - idx;
+    if (sz > count) {
+        sz = count;
+    }
+    if (NULL != data) {
+        memcpy(ch->ring + idx, data, sz * sizeof(float));
+        memcpy(ch->ring, data + sz, (count - sz) * sizeof(float));
+    } else {
+        for (uint32_t i = 0; i < sz; ++i) {
+            ch->ring[idx + i] = value;
+        }
+        for (uint32_t i = 0; i < (count - sz); ++i) {
+            ch->ring[i] = value;
+        }
+    }
+    ch->n_head += count;
+}
+
+int32_t jsdrv_aligner_add(struct jsdrv_aligner_s * self, uint32_t channel, const struct jsdrv_stream_signal_s * s) {
+    if ((channel >= JSDRV_ALIGN_CHANNEL_COUNT_MAX) || (NULL == self->channels[channel].ring)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(s);
+    if ((NULL == hold) && ((s->element_type != JSDRV_DATA_TYPE_FLOAT) || (s->element_size_bits != 32))) {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    if (!(s->time_map.counter_rate > 0.0)) {
+        return JSDRV_ERROR_UNAVAILABLE;  // no time map yet
+    }
+    struct channel_s * ch = &self->channels[channel];
+    uint32_t decimate_factor = s->decimate_factor ? s->decimate_factor : 1;
+    int64_t n0 = (int64_t) (s->sample_id / decimate_factor);
+    const float * data = hold ? NULL : (const float *) s->data;  // NULL fills with the hold mean
+    float value = hold ? hold->mean : NAN;
+    int64_t count = (int64_t) jsdrv_deadband_sample_count(s);
+
+    if (!ch->valid || (ch->decimate_factor != decimate_factor) || (ch->sample_rate != s->sample_rate)
+            || (n0 >= (ch->n_head + self->history)) || (n0 <= (ch->n_head - self->history))) {
+        ch->valid = true;  // first samples, new configuration, or restart
+        ch->decimate_factor = decimate_factor;
+        ch->sample_rate = s->sample_rate;
+        ch->n_tail = n0;
+        ch->n_head = n0;
+    }
+    ch->time_map = s->time_map;
+
+    if (n0 < ch->n_head) {  // duplicate
+        int64_t skip = ch->n_head - n0;
+        if (skip >= count) {
+            return 0;
+        }
+        if (data) {
+            data += skip;
+        }
+        count -= skip;
+    }
+    for (; ch->n_head < n0; ++ch->n_head) {  // skip
+        ch->ring[ch->n_head & self->mask] = NAN;
+    }
+    if (count > self->history) {
+        if (data) {
+            data += count - self->history;
+        }
+        ch->n_head += count - self->history;
+        count = self->history;
+    }
+    ring_write(self, ch, data, value, (uint32_t) count);
+    if ((ch->n_head - ch->n_tail) > self->history) {
+        ch->n_tail = ch->n_head - self->history;
+    }
+    return 0;
+}
+
+// The fractional sample index for grid sample k.
+static double channel_position(struct jsdrv_aligner_s * self, struct channel_s * ch, uint64_t k) {
+    const struct jsdrv_time_map_s * tm = &ch->time_map;
+    double dt = ((double) (self->t0 - tm->offset_time)) / JSDRV_TIME_SECOND + ((double) k) / self->sample_rate;
+    return ((double) tm->offset_counter + dt * tm->counter_rate) / ch->decimate_factor;
+}
+
+static bool start(struct jsdrv_aligner_s * self) {
+    uint32_t sample_rate = 0;
+    int64_t t0 = INT64_MIN;
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        struct channel_s * ch = &self->channels[idx];
+        if (NULL == ch->ring) {
+            continue;
+        } else if (!ch->valid || (ch->n_head == ch->n_tail)) {
+            return false;
+        }
+        uint32_t fs = ch->sample_rate / ch->decimate_factor;
+        if ((0 == sample_rate) || (fs < sample_rate)) {
+            sample_rate = fs;
+        }
+        const struct jsdrv_time_map_s * tm = &ch->time_map;
+        double counter = (double) ch->n_tail * ch->decimate_factor - (double) tm->offset_counter;
+        int64_t t = tm->offset_time + (int64_t) (counter / tm->counter_rate * JSDRV_TIME_SECOND);
+        if (t > t0) {
+            t0 = t;
+        }
+    }
+    if (0 == sample_rate) {
+        return false;  // no channels
+    }
+    self->sample_rate = self->sample_rate_cfg ? self->sample_rate_cfg : sample_rate;
+    self->t0 = t0;
+    self->k = 0;
+    self->started = true;
+    return true;
+}
+
+static uint32_t block_size(struct jsdrv_aligner_s * self, uint32_t * channel_count) {
+    uint32_t count = 0;
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        count += (NULL != self->channels[idx].ring) ? 1 : 0;
+    }
+    if (channel_count) {
+        *channel_count = count;
+    }
+    return JSDRV_ALIGN_HEADER_SIZE + count * self->block_samples * sizeof(float);
+}
+
+uint32_t jsdrv_aligner_ready(struct jsdrv_aligner_s * self) {
+    if (!self->started && !start(self)) {
+        return 0;
+    }
+    bool covered = true;
+    bool behind = false;
+    uint64_t k_last = self->k + self->block_samples - 1;
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        struct channel_s * ch = &self->channels[idx];
+        if (NULL == ch->ring) {
+            continue;
+        }
+        double x = channel_position(self, ch, k_last);
+        if ((floor(x) + 1.0) >= (double) ch->n_head) {
+            covered = false;
+        }
+        if ((ch->n_head - ch->n_tail) > (self->history / 2)) {
+            behind = true;  // another channel stalls this one
+        }
+    }
+    return (covered || behind) ? block_size(self, NULL) : 0;
+}
+
+static float sample_at(struct jsdrv_aligner_s * self, struct channel_s * ch, double x) {
+    double i0_f = floor(x);
+    if ((i0_f < (double) ch->n_tail) || (i0_f >= (double) ch->n_head)) {
+        return NAN;
+    }
+    int64_t i0 = (int64_t) i0_f;
+    float f = (float) (x - i0_f);
+    float y0 = ch->ring[i0 & self->mask];
+    if (0.0f == f) {
+        return y0;
+    } else if ((i0 + 1) >= ch->n_head) {
+        return NAN;
+    }
+    float y1 = ch->ring[(i0 + 1) & self->mask];
+    return y0 + f * (y1 - y0);
+}
+
+int32_t jsdrv_aligner_next(struct jsdrv_aligner_s * self, struct jsdrv_align_block_s * block) {
+    if (!jsdrv_aligner_ready(self)) {
+        return JSDRV_ERROR_UNAVAILABLE;
+    }
+    uint32_t channel_count = 0;
+    block_size(self, &channel_count);
+    block->sample_id = self->k;
+    block->sample_rate = self->sample_rate;
+    block->sample_count = self->block_samples;
+    block->channel_count = channel_count;
+    block->channel_mask = 0;
+    block->time_map.offset_time = self->t0;
+    block->time_map.offset_counter = 0;
+    block->time_map.counter_rate = self->sample_rate;
+
+    float * y = block->data;
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        struct channel_s * ch = &self->channels[idx];
+        if (NULL == ch->ring) {
+            continue;
+        }
+        block->channel_mask |= 1U << idx;
+        double x0 = channel_position(self, ch, self->k);
+        double step = ch->time_map.counter_rate / ((double) self->sample_rate * ch->decimate_factor);
+        for (uint32_t i = 0; i < self->block_samples; ++i) {
+            *y++ = sample_at(self, ch, x0 + i * step);
+        }
+    }
+
+    self->k += self->block_samples;
+    for (uint32_t idx = 0; idx < JSDRV_ALIGN_CHANNEL_COUNT_MAX; ++idx) {
+        struct channel_s * ch = &self->channels[idx];
+        if (NULL == ch->ring) {
+            continue;
+        }
+        double x = floor(channel_position(self, ch, self->k));
+        if (x > (double) ch->n_head) {
+            ch->n_tail = ch->n_head;
+        } else if (x > (double) ch->n_tail) {
+            ch->n_tail = (int64_t) x;  // keep the sample at or before the next grid sample
+        }
+    }
+    return 0;
+}
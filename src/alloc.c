@@ -0,0 +1,158 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ *
+ * @brief Heap allocation with application-provided allocator hooks.
+ */
+
+#include "jsdrv.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/assert.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv/error_code.h"
+#include <stdlib.h>
+#if _WIN32
+#include <malloc.h>
+#endif
+
+
+// Stored in the HEADER_SIZE bytes before each allocation, so that
+// jsdrv_free() handles jsdrv_alloc() and jsdrv_alloc_aligned() alike.
+struct header_s {
+    void * base;        // the pointer from the allocator
+    uint32_t aligned;   // 1 when base is from alloc_aligned
+};
+
+#define HEADER_SIZE (16U)  // preserves the allocator's 16 byte alignment
+
+static void * default_alloc(void * user_data, size_t size_bytes) {
+    (void) user_data;
+    return malloc(size_bytes);
+}
+
+static void default_free(void * user_data, void * ptr) {
+    (void) user_data;
+    free(ptr);
+}
+
+static void * default_alloc_aligned(void * user_data, size_t size_bytes, size_t alignment) {
+    (void) user_data;
+#if _WIN32
+    return _aligned_malloc(size_bytes, alignment);
+#else
+    void * ptr = NULL;
+    return posix_memalign(&ptr, alignment, size_bytes) ? NULL : ptr;
+#endif
+}
+
+static void default_free_aligned(void * user_data, void * ptr) {
+    (void) user_data;
+#if _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static const struct jsdrv_allocator_s ALLOCATOR_DEFAULT = {
+    .alloc = default_alloc,
+    .free = default_free,
+    .alloc_aligned = default_alloc_aligned,
+    .free_aligned = default_free_aligned,
+    .user_data = NULL,
+};
+
+static struct jsdrv_allocator_s allocator_ = {
+    .alloc = default_alloc,
+    .free = default_free,
+    .alloc_aligned = default_alloc_aligned,
+    .free_aligned = default_free_aligned,
+    .user_data = NULL,
+};
+static volatile uint32_t outstanding_ = 0;  // allocations from allocator_
+
+int32_t jsdrv_allocator_set(const struct jsdrv_allocator_s * allocator) {
+    if (NULL == allocator) {
+        allocator = &ALLOCATOR_DEFAULT;
+    }
+    if (!allocator->alloc || !allocator->free || (allocator->alloc_aligned && !allocator->free_aligned)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (jsdrv_atomic_load_u32(&outstanding_)) {
+        return JSDRV_ERROR_BUSY;
+    }
+    allocator_ = *allocator;
+    return 0;
+}
+
+static void * finish(void * base, uint8_t * ptr, uint32_t aligned) {
+    struct header_s * hdr = (struct header_s *) (ptr - HEADER_SIZE);
+    hdr->base = base;
+    hdr->aligned = aligned;
+    jsdrv_atomic_add_u32(&outstanding_, 1);
+    return ptr;
+}
+
+void * jsdrv_alloc(size_t size_bytes) {
+    if (size_bytes > (SIZE_MAX - HEADER_SIZE)) {
+        JSDRV_FATAL("out of memory");
+    }
+    uint8_t * base = allocator_.alloc(allocator_.user_data, size_bytes + HEADER_SIZE);
+    if (!base) {
+        JSDRV_FATAL("out of memory");
+    }
+    return finish(base, base + HEADER_SIZE, 0);
+}
+
+void * jsdrv_alloc_aligned(size_t size_bytes, size_t alignment) {
+    if (alignment <= HEADER_SIZE) {
+        return jsdrv_alloc(size_bytes);
+    }
+    JSDRV_ASSERT(0 == (alignment & (alignment - 1)));
+    if (size_bytes > (SIZE_MAX - 2 * alignment)) {
+        JSDRV_FATAL("out of memory");
+    }
+    if (allocator_.alloc_aligned) {
+        // the header occupies the entire first alignment block
+        uint8_t * base = allocator_.alloc_aligned(allocator_.user_data, size_bytes + alignment, alignment);
+        if (!base) {
+            JSDRV_FATAL("out of memory");
+        }
+        return finish(base, base + alignment, 1);
+    }
+    uint8_t * base = allocator_.alloc(allocator_.user_data, size_bytes + alignment + HEADER_SIZE);
+    if (!base) {
+        JSDRV_FATAL("out of memory");
+    }
+    uintptr_t p = ((uintptr_t) (base + HEADER_SIZE) + (alignment - 1)) & ~((uintptr_t) (alignment - 1));
+    return finish(base, (uint8_t *) p, 0);
+}
+
+void jsdrv_free(void * ptr) {
+    if (NULL == ptr) {
+        return;
+    }
+    struct header_s * hdr = (struct header_s *) (((uint8_t *) ptr) - HEADER_SIZE);
+    jsdrv_atomic_add_u32(&outstanding_, (uint32_t) -1);
+    if (hdr->aligned) {
+        allocator_.free_aligned(allocator_.user_data, hdr->base);
+    } else {
+        allocator_.free(allocator_.user_data, hdr->base);
+    }
+}
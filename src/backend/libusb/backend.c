@@ -21,18 +21,23 @@
  */
 
 #define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_USB
 #include "jsdrv.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/assert.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv_prv/backend.h"
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/devices.h"
 #include "jsdrv_prv/frontend.h"
 #include "jsdrv_prv/list.h"
 #include "jsdrv_prv/log.h"
+#include "jsdrv_prv/trace.h"
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/usb_stats.h"
 #include "jsdrv/error_code.h"
 #include "jsdrv/cstr.h"
+#include "jsdrv/time.h"
 #include "tinyprintf.h"
 #include <stdio.h>
 #include <inttypes.h>
@@ -46,8 +51,22 @@
 #define BULK_IN_TIMEOUT_MS              (0U)    // no timeout
 #define BULK_IN_FRAME_LENGTH            (512U)
 #define BULK_IN_TRANSFER_SIZE           (64U * BULK_IN_FRAME_LENGTH)
+#define BULK_IN_TRANSFER_SIZE_MAX       (2048U * BULK_IN_FRAME_LENGTH)
 #define BULK_IN_TRANSFER_OUTSTANDING    (4U)
+#define BULK_IN_TRANSFER_OUTSTANDING_MAX (64U)
+#define BULK_IN_ENDPOINT_COUNT          (16U)
+#define CTRL_BUFFER_SIZE                (8U + 4096U)  // setup + data
 #define ENDPOINT_COUNT                  (256U)
+#define CLOSE_LOAN_TIMEOUT_MS           (1000U)
+#define DEVICE_THREAD_FDS_MAX           (64U)
+#define STATS_INTERVAL_MS               (1000U)
+#define STATS_JSON_SIZE                 (2048U)
+
+#if defined(__linux__) && defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+#define BULK_IN_DEV_MEM                 (1)     // usbfs kernel-mapped buffers, zero copy
+#else
+#define BULK_IN_DEV_MEM                 (0)
+#endif
 
 
 enum device_mark_e {
@@ -74,10 +93,27 @@ struct backend_s;
 
 struct transfer_s {
     struct libusb_transfer * transfer;      // user_data points to the transfer_s instance
-    struct jsdrvp_msg_s * msg;              // not for BULK IN
+    struct jsdrvp_msg_s * msg;              // BULK IN owns its message for reuse
     struct dev_s * device;
-    uint8_t buffer[BULK_IN_TRANSFER_SIZE];  // OUT uses msg->value.value.bin
     struct jsdrv_list_s item;
+    uint8_t * buffer;                       // data or dev_mem.  OUT uses msg->value.value.bin
+    uint32_t buffer_size;
+    bool dev_mem;                           // buffer from libusb_dev_mem_alloc()
+    int64_t t_complete;                     // BULK IN completion time, for residence
+    uint8_t data[];
+};
+
+struct bulk_in_s {
+    struct jsdrv_list_s ring;               // idle transfers, already filled for this endpoint
+    uint32_t ring_size;                     // total transfers owned by this endpoint
+    uint32_t loaned;                        // transfers held by the upper layer
+    struct jsdrvp_msg_s * batch;            // last message sent, accepts appends until sealed
+    uint32_t pending;                       // submitted transfers
+    uint32_t depth;                         // target outstanding transfers
+    int64_t t_last;                         // previous completion time, for adaptive
+    uint32_t interval_us;                   // filtered interval between full completions
+    bool full_last;                         // previous completion used the entire buffer
+    struct jsdrv_usb_stats_s * stats;       // in dev_s.stats
 };
 
 struct dev_s {
@@ -91,10 +127,24 @@ struct dev_s {
     uint8_t mode;  // device_mode_e
     uint8_t mark;
     uint8_t endpoint_mode[ENDPOINT_COUNT];
+    uint32_t close_time_ms;
+
+    uint32_t bulk_in_transfers;             // configured outstanding transfers
+    uint32_t bulk_in_size;                  // configured transfer size in bytes
+    uint32_t bulk_in_adaptive_max;          // maximum outstanding transfers, 0 for fixed
+    struct bulk_in_s bulk_in[BULK_IN_ENDPOINT_COUNT];
+    struct jsdrv_usb_stats_s stats[BULK_IN_ENDPOINT_COUNT];
+    uint32_t stats_interval_ms;             // JSDRV_USBBK_MSG_STATS period, 0 for off
+    uint32_t stats_time_ms;                 // previous JSDRV_USBBK_MSG_STATS time
 
     struct jsdrv_list_s transfers_pending;
     struct jsdrv_list_s transfers_free;
 
+    libusb_context * ctx;                   // device event thread only
+    libusb_device * ctx_device;             // usb_device in ctx
+    pthread_t thread_id;                    // device event thread, 0 for backend thread
+    volatile bool thread_exit;
+
     struct jsdrv_list_s item;
 };
 
@@ -110,19 +160,32 @@ struct backend_s {
     struct jsdrv_list_s devices_active;
 
     jsdrv_os_event_t hotplug_event;
+    bool device_threads;                    // JSDRV_ARG_USB_DEVICE_THREADS
+    char device_hint[JSDRV_TOPIC_LENGTH_MAX];  // JSDRV_ARG_DEVICE_HINT or empty
     volatile bool do_exit;
     pthread_t thread_id;
 };
 
-static struct transfer_s * transfer_alloc(struct dev_s * d) {
-    struct transfer_s * t;
-    struct jsdrv_list_s * item = jsdrv_list_remove_head(&d->transfers_free);
-    if (NULL != item) {
-        t = JSDRV_CONTAINER_OF(item, struct transfer_s, item);
-    } else {
-        t = jsdrv_alloc_clr(sizeof(struct transfer_s));
+static struct transfer_s * transfer_alloc(struct dev_s * d, uint32_t buffer_size) {
+    struct transfer_s * t = NULL;
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&d->transfers_free, item) {
+        struct transfer_s * f = JSDRV_CONTAINER_OF(item, struct transfer_s, item);
+        if (f->buffer_size >= buffer_size) {
+            jsdrv_list_remove(item);
+            t = f;
+            break;
+        }
+    }
+    if (NULL == t) {
+        if (buffer_size < CTRL_BUFFER_SIZE) {
+            buffer_size = CTRL_BUFFER_SIZE;
+        }
+        t = jsdrv_alloc_clr(sizeof(struct transfer_s) + buffer_size);
         jsdrv_list_initialize(&t->item);
         t->transfer = libusb_alloc_transfer(0);
+        t->buffer = t->data;
+        t->buffer_size = buffer_size;
     }
     t->device = d;
     jsdrv_list_add_tail(&d->transfers_pending, &t->item);
@@ -147,8 +210,21 @@ static void transfer_free(struct transfer_s * t) {
     }
 }
 
+static const struct device_type_s * device_type_find(const struct libusb_device_descriptor * descriptor) {
+    for (const struct device_type_s * dt = device_types; dt->device_type; ++dt) {
+        if ((dt->vendor_id == descriptor->idVendor) && (dt->product_id == descriptor->idProduct)) {
+            return dt;
+        }
+    }
+    return NULL;
+}
+
 static int on_hotplug(libusb_context *ctx, libusb_device *device, libusb_hotplug_event event, void *user_data) {
     (void) ctx;
+    struct libusb_device_descriptor descriptor;
+    if ((0 == libusb_get_device_descriptor(device, &descriptor)) && !device_type_find(&descriptor)) {
+        return 0;  // unrelated device, such as a hub reset, so skip the rescan
+    }
     JSDRV_LOGI("hotplug %p: inserted=%d, remove=%d",
                device,
                (event & LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) ? 1 : 0,
@@ -194,6 +270,7 @@ static void device_close(struct dev_s * d) {
         for (uint32_t endpoint = 0; endpoint < ENDPOINT_COUNT; ++endpoint) {
             d->endpoint_mode[endpoint] = EP_MODE_OFF;
         }
+        d->close_time_ms = jsdrv_time_ms_u32();
         // cannot call libusb_close from event callbacks
         // post to guarantee handling outside of libusb_handle_events*
         d->mode = DEVICE_MODE_CLOSING;
@@ -204,7 +281,9 @@ static int32_t device_open(struct dev_s * d) {
     int rc;
     device_close(d);
     JSDRV_LOGI("device_open(%s)", d->ll_device.prefix);
-    rc = libusb_open(d->usb_device, &d->handle);
+    memset(d->stats, 0, sizeof(d->stats));
+    d->stats_time_ms = jsdrv_time_ms_u32();
+    rc = libusb_open(d->ctx_device ? d->ctx_device : d->usb_device, &d->handle);
     if (rc) {
         if (rc == LIBUSB_ERROR_ACCESS) {
             JSDRV_LOGE("libusb_open - insufficient permissions");
@@ -246,7 +325,7 @@ static const char * transfer_status_to_str(int32_t status) {
     }
 }
 
-static void submit_transfer(struct transfer_s * t) {
+static int submit_transfer(struct transfer_s * t) {
     int rc = libusb_submit_transfer(t->transfer);
     if (rc) {
         JSDRV_LOGW("libusb_submit_transfer returned %d", rc);
@@ -261,6 +340,7 @@ static void submit_transfer(struct transfer_s * t) {
         }
         transfer_free(t);
     }
+    return rc;
 }
 
 static void device_rsp(struct dev_s * d, struct jsdrvp_msg_s * msg) {
@@ -292,7 +372,7 @@ static void on_bulk_out_done(struct libusb_transfer * transfer) {
 }
 
 static void bulk_out_send(struct dev_s * d, struct jsdrvp_msg_s * msg) {
-    struct transfer_s * t = transfer_alloc(d);
+    struct transfer_s * t = transfer_alloc(d, 0);
     t->msg = msg;
     JSDRV_LOGI("bulk_out_send(%s) %d bytes", d->ll_device.prefix, (int) msg->value.size);
     uint8_t ep = msg->extra.bkusb_stream.endpoint;
@@ -321,7 +401,7 @@ static void on_ctrl_in_done(struct libusb_transfer * transfer) {
 }
 
 static void ctrl_in_start(struct dev_s * d, struct jsdrvp_msg_s * msg) {
-    struct transfer_s * t = transfer_alloc(d);
+    struct transfer_s * t = transfer_alloc(d, CTRL_BUFFER_SIZE);
     t->msg = msg;
     JSDRV_LOGD3("ctrl_in_start(%s)", d->ll_device.prefix);
     uint64_t * setup = (uint64_t * ) t->buffer;
@@ -347,7 +427,7 @@ static void on_ctrl_out_done(struct libusb_transfer * transfer) {
 }
 
 static void ctrl_out_start(struct dev_s * d, struct jsdrvp_msg_s * msg) {
-    struct transfer_s * t = transfer_alloc(d);
+    struct transfer_s * t = transfer_alloc(d, CTRL_BUFFER_SIZE);
     t->msg = msg;
     JSDRV_LOGD3("ctrl_out_start(%s) %d bytes", d->ll_device.prefix, (int) msg->value.size);
     uint64_t * setup = (uint64_t * ) t->buffer;
@@ -357,6 +437,7 @@ static void ctrl_out_start(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     if (msg->value.size > 4096) {
         JSDRV_LOGW("ctrl_out_start size too big: %lu", (int) msg->value.size);
         msg->value = jsdrv_union_i32(JSDRV_ERROR_TOO_BIG);
+        msg->extra.bkusb_ctrl.status = JSDRV_ERROR_TOO_BIG;
         device_rsp(d, msg);
     } else {
         memcpy(&setup[1], msg->value.value.bin, msg->value.size);
@@ -364,60 +445,249 @@ static void ctrl_out_start(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     }
 }
 
-static void bulk_in_start(struct dev_s * d, uint8_t pipe_id);
+static inline struct bulk_in_s * bulk_in_get(struct dev_s * d, uint8_t pipe_id) {
+    return &d->bulk_in[pipe_id & (BULK_IN_ENDPOINT_COUNT - 1)];
+}
+
+static void on_bulk_in_done(struct libusb_transfer * transfer);
+
+static struct transfer_s * bulk_in_transfer_alloc(struct dev_s * d, uint8_t pipe_id) {
+    struct transfer_s * t;
+    uint32_t size = d->bulk_in_size;
+    uint8_t * dev_mem = NULL;
+#if BULK_IN_DEV_MEM
+    dev_mem = libusb_dev_mem_alloc(d->handle, size);
+#endif
+    if (dev_mem) {
+        t = jsdrv_alloc_clr(sizeof(struct transfer_s));
+        t->buffer = dev_mem;
+        t->dev_mem = true;
+    } else {
+        t = jsdrv_alloc_clr(sizeof(struct transfer_s) + size);
+        t->buffer = t->data;
+    }
+    t->buffer_size = size;
+    t->device = d;
+    jsdrv_list_initialize(&t->item);
+    t->transfer = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(t->transfer, d->handle, pipe_id, t->buffer, (int) size,
+                              on_bulk_in_done, t, BULK_IN_TIMEOUT_MS);
+    t->msg = jsdrvp_msg_alloc(d->backend->context);
+    jsdrv_cstr_copy(t->msg->topic, JSDRV_USBBK_MSG_STREAM_IN_DATA, sizeof(t->msg->topic));
+    t->msg->extra.bkusb_stream.endpoint = pipe_id;
+    t->msg->extra.bkusb_stream.ll_transfer = t;
+    t->msg->extra.bkusb_stream.batch = 1;
+    ++bulk_in_get(d, pipe_id)->ring_size;
+    JSDRV_LOGD1("bulk_in_transfer_alloc(%s, 0x%02x) size=%u, dev_mem=%d", d->ll_device.prefix,
+                (int) pipe_id, (unsigned int) size, dev_mem ? 1 : 0);
+    return t;
+}
+
+static void bulk_in_transfer_free(struct transfer_s * t) {
+    struct dev_s * d = t->device;
+    struct bulk_in_s * b = bulk_in_get(d, t->transfer->endpoint);
+    --b->ring_size;
+    if (b->batch == t->msg) {
+        b->batch = NULL;
+    }
+    jsdrv_list_remove(&t->item);
+    jsdrvp_msg_free(d->backend->context, t->msg);
+    t->msg = NULL;
+    if (t->dev_mem) {
+#if BULK_IN_DEV_MEM
+        if (d->handle) {
+            libusb_dev_mem_free(d->handle, t->buffer, t->buffer_size);
+        } else {
+            JSDRV_LOGW("bulk_in_transfer_free after close, leak dev_mem");
+        }
+#endif
+    }
+    libusb_free_transfer(t->transfer);
+    jsdrv_free(t);
+}
+
+// Return a transfer to its endpoint ring for reuse.
+static void bulk_in_idle(struct transfer_s * t) {
+    struct dev_s * d = t->device;
+    jsdrv_list_remove(&t->item);
+    if ((NULL != d->handle) && (d->mode == DEVICE_MODE_OPEN) && (t->buffer_size == d->bulk_in_size)) {
+        jsdrv_list_add_tail(&bulk_in_get(d, t->transfer->endpoint)->ring, &t->item);
+    } else {
+        bulk_in_transfer_free(t);
+    }
+}
+
+static void bulk_in_ring_free(struct dev_s * d) {
+    struct jsdrv_list_s * item;
+    for (uint32_t i = 0; i < BULK_IN_ENDPOINT_COUNT; ++i) {
+        while (NULL != (item = jsdrv_list_remove_head(&d->bulk_in[i].ring))) {
+            bulk_in_transfer_free(JSDRV_CONTAINER_OF(item, struct transfer_s, item));
+        }
+    }
+}
+
+static uint32_t bulk_in_loaned(struct dev_s * d) {
+    uint32_t loaned = 0;
+    for (uint32_t i = 0; i < BULK_IN_ENDPOINT_COUNT; ++i) {
+        loaned += d->bulk_in[i].loaned;
+    }
+    return loaned;
+}
+
+static void bulk_in_fill(struct dev_s * d, uint8_t pipe_id) {
+    struct bulk_in_s * b = bulk_in_get(d, pipe_id);
+    while ((d->mode == DEVICE_MODE_OPEN) && (d->endpoint_mode[pipe_id] == EP_MODE_BULK_IN)
+            && (b->pending < b->depth)) {
+        struct transfer_s * t;
+        struct jsdrv_list_s * item = jsdrv_list_remove_head(&b->ring);
+        if (NULL == item) {
+            t = bulk_in_transfer_alloc(d, pipe_id);
+        } else {
+            t = JSDRV_CONTAINER_OF(item, struct transfer_s, item);
+        }
+        jsdrv_list_add_tail(&d->transfers_pending, &t->item);
+        int rc = libusb_submit_transfer(t->transfer);
+        if (rc) {
+            JSDRV_LOGW("bulk_in libusb_submit_transfer returned %d", rc);
+            jsdrv_list_remove(&t->item);
+            jsdrv_list_add_tail(&b->ring, &t->item);
+            break;
+        }
+        ++b->pending;
+    }
+}
+
+static void bulk_in_adapt(struct dev_s * d, struct bulk_in_s * b, struct libusb_transfer * transfer, int64_t t_now) {
+    bool full = transfer->actual_length == transfer->length;
+    if (d->bulk_in_adaptive_max && full && b->full_last) {
+        // Back-to-back full transfers mean the device had data waiting.
+        // A gap that consumes half the queued transfers is a latency spike.
+        uint32_t dt_us = (uint32_t) ((t_now - b->t_last) / JSDRV_TIME_MICROSECOND);
+        if (b->interval_us && (dt_us > ((b->interval_us * b->depth) / 2))) {
+            if (b->depth < d->bulk_in_adaptive_max) {
+                ++b->depth;
+                JSDRV_LOGI("bulk_in(%s) latency %u us, increase depth to %u",
+                           d->ll_device.prefix, (unsigned int) dt_us, (unsigned int) b->depth);
+            }
+        } else {
+            b->interval_us = b->interval_us ? ((b->interval_us * 7 + dt_us) / 8) : dt_us;
+        }
+    }
+    b->full_last = full;
+    b->t_last = t_now;
+}
+
+// Append to the previous message when the upper layer has not claimed it yet.
+static bool bulk_in_batch_append(struct bulk_in_s * b, struct transfer_s * t) {
+    struct jsdrvp_msg_s * m = b->batch;
+    if (NULL == m) {
+        return false;
+    }
+    struct jsdrvp_payload_usb_stream_s * p = &m->payload.usb_stream;
+    uint32_t n = jsdrv_atomic_load_u32(&p->state);
+    if ((n & JSDRVP_USB_STREAM_BATCH_SEALED) || (n >= JSDRVP_USB_STREAM_BATCH_MAX)) {
+        return false;
+    }
+    p->entries[n].buffer = t->buffer;
+    p->entries[n].size = (uint32_t) t->transfer->actual_length;
+    p->entries[n].ll_transfer = t;
+    p->entries[n].time = t->t_complete;
+    jsdrv_atomic_fence();  // entry before count
+    return jsdrv_atomic_cas_u32(&p->state, n, n + 1);
+}
+
+static void bulk_in_send(struct dev_s * d, struct bulk_in_s * b, struct transfer_s * t) {
+    ++b->loaned;  // temporary loan of buffer and message to upper layer
+    if (bulk_in_batch_append(b, t)) {
+        return;  // upper layer is behind, no additional message or wakeup
+    }
+    struct jsdrvp_msg_s * m = t->msg;
+    struct jsdrvp_payload_usb_stream_s * p = &m->payload.usb_stream;
+    m->value = jsdrv_union_bin(t->buffer, t->transfer->actual_length);
+    m->extra.bkusb_stream.endpoint = t->transfer->endpoint;
+    m->extra.bkusb_stream.time = t->t_complete;
+    p->entries[0].buffer = t->buffer;
+    p->entries[0].size = (uint32_t) t->transfer->actual_length;
+    p->entries[0].ll_transfer = t;
+    p->entries[0].time = t->t_complete;
+    jsdrv_atomic_store_u32(&p->state, 1);
+    b->batch = m;
+    msg_queue_push(d->ll_device.rsp_q, m);
+}
 
 static void on_bulk_in_done(struct libusb_transfer * transfer) {
     struct transfer_s *t = (struct transfer_s *) transfer->user_data;
     struct dev_s * d = t->device;
     uint8_t pipe_id = transfer->endpoint;
-    struct jsdrvp_msg_s * m;
+    struct bulk_in_s * b = bulk_in_get(d, pipe_id);
     JSDRV_LOGD3("bulk_in_done(%s) status=%d, length=%d",
-                d->ll_device.prefix, transfer->status, t->transfer->actual_length);
+                d->ll_device.prefix, transfer->status, transfer->actual_length);
+    JSDRV_TRACE_BEGIN("bulk_in_done", d->ll_device.prefix, (uint32_t) transfer->actual_length);
+    jsdrv_list_remove(&t->item);
+    if (b->pending) {
+        --b->pending;
+    }
     switch (transfer->status) {
         case LIBUSB_TRANSFER_COMPLETED:
-            bulk_in_start(t->device, pipe_id);
-            if (0 == t->transfer->actual_length) {
+            t->t_complete = jsdrv_time_utc();
+            jsdrv_usb_stats_complete(b->stats, t->t_complete, (uint32_t) transfer->actual_length);
+            bulk_in_adapt(d, b, transfer, t->t_complete);
+            bulk_in_fill(d, pipe_id);
+            if (0 == transfer->actual_length) {
                 JSDRV_LOGW("zero length bulk in transfer");
-                transfer_free(t);
+                bulk_in_idle(t);
             } else {
-                jsdrv_list_remove(&t->item); // not pending or free, temporary loan to upper layer
-                m = jsdrvp_msg_alloc(t->device->backend->context);
-                jsdrv_cstr_copy(m->topic, JSDRV_USBBK_MSG_STREAM_IN_DATA, sizeof(m->topic));
-                m->value = jsdrv_union_bin(t->buffer, t->transfer->actual_length);
-                m->extra.bkusb_stream.endpoint = t->transfer->endpoint;
-                device_rsp(d, m);
+                bulk_in_send(d, b, t);
             }
             break;
         case LIBUSB_TRANSFER_TIMED_OUT:
-            bulk_in_start(t->device, pipe_id);
-            transfer_free(t);
+            ++b->stats->timeouts;
+            bulk_in_idle(t);
+            bulk_in_fill(d, pipe_id);
             break;
         case LIBUSB_TRANSFER_CANCELLED:
-            transfer_free(t);
+            bulk_in_idle(t);
             break;
         case LIBUSB_TRANSFER_NO_DEVICE:
-            t->device->mode = DEVICE_MODE_UNASSIGNED;
-            transfer_free(t);
+            ++b->stats->errors;
+            d->mode = DEVICE_MODE_UNASSIGNED;
+            bulk_in_idle(t);
             break;
         default:
             JSDRV_LOGW("bulk_in error %d", transfer->status);
-            transfer_free(t);
+            ++b->stats->errors;
+            bulk_in_idle(t);
             break;
     }
+    JSDRV_TRACE_END("bulk_in_done");
 }
 
-static void bulk_in_start(struct dev_s * d, uint8_t pipe_id) {
-    if (d->mode != DEVICE_MODE_OPEN) {
-        return;
+static void bulk_in_return(struct dev_s * d, struct jsdrvp_msg_s * msg) {
+    struct transfer_s * t = (struct transfer_s *) msg->extra.bkusb_stream.ll_transfer;
+    struct transfer_s * transfers[JSDRVP_USB_STREAM_BATCH_MAX];
+    uint8_t pipe_id = t->transfer->endpoint;
+    struct bulk_in_s * b = bulk_in_get(d, pipe_id);
+    uint32_t count = jsdrvp_usb_stream_seal(msg);  // normally sealed by upper layer
+    int64_t t_now = jsdrv_time_utc();
+    if (b->batch == msg) {
+        b->batch = NULL;
     }
-    if (d->endpoint_mode[pipe_id] != EP_MODE_BULK_IN) {
-        return;
+    for (uint32_t i = 0; i < count; ++i) {
+        transfers[i] = (struct transfer_s *) msg->payload.usb_stream.entries[i].ll_transfer;
     }
-    struct transfer_s * t = transfer_alloc(d);
-    libusb_fill_bulk_transfer(t->transfer, d->handle,
-                              pipe_id, t->buffer, sizeof(t->buffer),
-                              on_bulk_in_done, t, BULK_IN_TIMEOUT_MS);
-    submit_transfer(t);
+    for (uint32_t i = 0; i < count; ++i) {  // msg may be freed with its transfer
+        t = transfers[i];
+        jsdrv_usb_stats_residence(b->stats, t->t_complete, t_now);
+        if (b->loaned) {
+            --b->loaned;
+        }
+        if (NULL == d->handle) {
+            bulk_in_transfer_free(t);  // device closed while loaned
+        } else {
+            bulk_in_idle(t);
+        }
+    }
+    bulk_in_fill(d, pipe_id);
 }
 
 static void bulk_in_open(struct dev_s * d, struct jsdrvp_msg_s * msg) {
@@ -429,9 +699,12 @@ static void bulk_in_open(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     if (rv) {
         JSDRV_LOGW("bulk_in_open clear_halt failed with %d", rv);
     }
-    for (uint32_t i = 0; i < BULK_IN_TRANSFER_OUTSTANDING; ++i) {
-        bulk_in_start(d, pipe_id);
-    }
+    struct bulk_in_s * b = bulk_in_get(d, pipe_id);
+    b->depth = d->bulk_in_transfers;
+    b->interval_us = 0;
+    b->full_last = false;
+    jsdrv_usb_stats_open(b->stats, pipe_id);
+    bulk_in_fill(d, pipe_id);
     msg->value = jsdrv_union_i32(0);  // return code
     device_rsp(d, msg);
 }
@@ -452,6 +725,68 @@ static void bulk_in_close(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     device_rsp(d, msg);
 }
 
+static void stats_publish(struct dev_s * d) {
+    char buf[STATS_JSON_SIZE];
+    if (!d->stats_interval_ms || (d->mode != DEVICE_MODE_OPEN)) {
+        return;
+    }
+    uint32_t t_now = jsdrv_time_ms_u32();
+    if ((t_now - d->stats_time_ms) < d->stats_interval_ms) {
+        return;
+    }
+    d->stats_time_ms = t_now;
+    for (uint32_t i = 0; i < BULK_IN_ENDPOINT_COUNT; ++i) {
+        d->stats[i].in_flight = d->bulk_in[i].pending;
+        d->stats[i].loaned = d->bulk_in[i].loaned;
+    }
+    if (jsdrv_usb_stats_json(d->stats, BULK_IN_ENDPOINT_COUNT, buf, sizeof(buf))) {
+        msg_queue_push(d->ll_device.rsp_q,
+                       jsdrvp_msg_alloc_value(d->backend->context, JSDRV_USBBK_MSG_STATS, &jsdrv_union_json(buf)));
+    }
+}
+
+static int32_t bulk_in_config(struct dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint32_t x = v.value.u32;
+    if (0 == strcmp(JSDRV_USBBK_MSG_STATS_INTERVAL, topic)) {
+        d->stats_interval_ms = x;
+        return 0;
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_TRANSFERS, topic)) {
+        if ((x < 1) || (x > BULK_IN_TRANSFER_OUTSTANDING_MAX)) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        d->bulk_in_transfers = x;
+        d->bulk_in_adaptive_max = 0;
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_SIZE, topic)) {
+        if ((x < BULK_IN_FRAME_LENGTH) || (x > BULK_IN_TRANSFER_SIZE_MAX) || (x % BULK_IN_FRAME_LENGTH)) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        d->bulk_in_size = x;  // ring transfers resize as they return
+        return 0;
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_ADAPTIVE, topic)) {
+        if (x > BULK_IN_TRANSFER_OUTSTANDING_MAX) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        d->bulk_in_adaptive_max = x;
+        if (x && (d->bulk_in_transfers > x)) {
+            d->bulk_in_transfers = x;
+        }
+    } else {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    JSDRV_LOGI("bulk_in_config(%s) transfers=%u, adaptive_max=%u", d->ll_device.prefix,
+               (unsigned int) d->bulk_in_transfers, (unsigned int) d->bulk_in_adaptive_max);
+    for (uint32_t i = 0; i < BULK_IN_ENDPOINT_COUNT; ++i) {
+        d->bulk_in[i].depth = d->bulk_in_transfers;  // excess transfers retire on completion
+        d->bulk_in[i].interval_us = 0;
+        bulk_in_fill(d, (uint8_t) (0x80 | i));
+    }
+    return 0;
+}
+
 static bool device_handle_msg(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     if (NULL == msg) {
         return false;
@@ -461,10 +796,7 @@ static bool device_handle_msg(struct dev_s * d, struct jsdrvp_msg_s * msg) {
         JSDRV_LOGD3("device_handle_msg %s", msg->topic);
     }
     if (0 == strcmp(JSDRV_USBBK_MSG_STREAM_IN_DATA, msg->topic)) {
-        struct transfer_s * t;
-        t = JSDRV_CONTAINER_OF(msg->value.value.bin, struct transfer_s, buffer);
-        transfer_free(t);
-        jsdrvp_msg_free(d->backend->context, msg);
+        bulk_in_return(d, msg);
     } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_OUT_DATA, msg->topic)) {
         bulk_out_send(d, msg);
     } else if (msg->topic[0] == JSDRV_MSG_COMMAND_PREFIX_CHAR) {
@@ -495,6 +827,9 @@ static bool device_handle_msg(struct dev_s * d, struct jsdrvp_msg_s * msg) {
         bulk_in_open(d, msg);
     } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_STREAM_CLOSE, msg->topic)) {
         bulk_in_close(d, msg);
+    } else if (jsdrv_cstr_starts_with(msg->topic, JSDRV_USBBK_MSG_CONFIG_PREFIX)) {
+        msg->value = jsdrv_union_i32(bulk_in_config(d, msg->topic, &msg->value));
+        device_rsp(d, msg);
     } else {
         JSDRV_LOGW("unsupported topic %s", msg->topic);
         msg->value = jsdrv_union_i32(JSDRV_ERROR_PARAMETER_INVALID);
@@ -509,10 +844,14 @@ static void process_devices(struct backend_s * s) {
     struct jsdrvp_msg_s * msg = NULL;
     jsdrv_list_foreach(&s->devices_active, item) {
         d = JSDRV_CONTAINER_OF(item, struct dev_s, item);
+        if (d->thread_id) {
+            continue;  // device event thread handles its own messages
+        }
         do {
             msg = msg_queue_pop_immediate(d->ll_device.cmd_q);
             device_handle_msg(d, msg);
         } while (NULL != msg);
+        stats_publish(d);
     }
     jsdrv_list_foreach(&s->devices_free, item) {
         d = JSDRV_CONTAINER_OF(item, struct dev_s, item);
@@ -529,9 +868,138 @@ static void process_devices(struct backend_s * s) {
 
 }
 
+static void device_close_complete(struct dev_s * d, bool force) {
+    if ((d->mode != DEVICE_MODE_CLOSING) || !jsdrv_list_is_empty(&d->transfers_pending)) {
+        return;
+    }
+    uint32_t loaned = bulk_in_loaned(d);
+    if (loaned && !force && ((jsdrv_time_ms_u32() - d->close_time_ms) < CLOSE_LOAN_TIMEOUT_MS)) {
+        return;  // wait for the upper layer to return buffers
+    } else if (loaned) {
+        JSDRV_LOGW("device_close(%s) with %u loaned transfers", d->ll_device.prefix, (unsigned int) loaned);
+    }
+    bulk_in_ring_free(d);
+    if (d->handle) {
+        libusb_close(d->handle);
+        d->handle = NULL;
+    }
+    d->mode = DEVICE_MODE_CLOSED;
+}
+
+static void * device_thread(void * arg) {
+    struct dev_s * d = (struct dev_s *) arg;
+    struct pollfd fds[DEVICE_THREAD_FDS_MAX];
+    nfds_t nfds;
+    struct timeval libusb_timeout_tv = {.tv_sec=0, .tv_usec=0};
+    struct jsdrvp_msg_s * msg;
+    jsdrvp_thread_configure(d->backend->context, JSDRVP_THREAD_BACKEND, "jsdrv_usb_dev");
+    jsdrvp_msg_cache_attach(d->backend->context);
+    JSDRV_LOGI("device_thread(%s) start", d->ll_device.prefix);
+
+    while (!d->thread_exit) {
+        nfds = 0;
+        fds[nfds].fd = msg_queue_handle_get(d->ll_device.cmd_q);
+        fds[nfds].events = POLLIN;
+        fds[nfds++].revents = 0;
+        const struct libusb_pollfd ** libusb_fds = libusb_get_pollfds(d->ctx);
+        for (int i = 0; libusb_fds[i] && (nfds < DEVICE_THREAD_FDS_MAX); ++i) {
+            fds[nfds].fd = libusb_fds[i]->fd;
+            fds[nfds].events = libusb_fds[i]->events;
+            fds[nfds++].revents = 0;
+        }
+        libusb_free_pollfds(libusb_fds);
+
+        poll(fds, nfds, STATS_INTERVAL_MS);
+        libusb_handle_events_timeout_completed(d->ctx, &libusb_timeout_tv, NULL);
+        while (NULL != (msg = msg_queue_pop_immediate(d->ll_device.cmd_q))) {
+            device_handle_msg(d, msg);
+        }
+        stats_publish(d);
+        device_close_complete(d, false);
+    }
+
+    device_close(d);
+    libusb_timeout_tv.tv_usec = 100000;
+    for (int i = 0; (i < 20) && !jsdrv_list_is_empty(&d->transfers_pending); ++i) {
+        libusb_handle_events_timeout_completed(d->ctx, &libusb_timeout_tv, NULL);
+    }
+    device_close_complete(d, true);
+    jsdrvp_msg_cache_detach(d->backend->context);
+    JSDRV_LOGI("device_thread(%s) exit", d->ll_device.prefix);
+    return NULL;
+}
+
+static void device_thread_stop(struct dev_s * d) {
+    if (d->thread_id) {
+        d->thread_exit = true;
+        libusb_interrupt_event_handler(d->ctx);
+        int rv = pthread_join(d->thread_id, NULL);
+        if (rv) {
+            JSDRV_LOGW("device_thread(%s) pthread_join returned %d", d->ll_device.prefix, rv);
+        }
+        d->thread_id = 0;
+    }
+    if (d->ctx_device) {
+        libusb_unref_device(d->ctx_device);
+        d->ctx_device = NULL;
+    }
+    if (d->ctx) {
+        libusb_exit(d->ctx);
+        d->ctx = NULL;
+    }
+}
+
+static int32_t device_thread_start(struct dev_s * d) {
+    libusb_device ** device_list;
+    uint8_t bus = libusb_get_bus_number(d->usb_device);
+    uint8_t address = libusb_get_device_address(d->usb_device);
+    d->thread_exit = false;
+    if (libusb_init(&d->ctx)) {
+        d->ctx = NULL;
+        return JSDRV_ERROR_IO;
+    }
+    // Find the same device in the new context to keep its events separate.
+    ssize_t n = libusb_get_device_list(d->ctx, &device_list);
+    for (ssize_t i = 0; i < n; ++i) {
+        if ((libusb_get_bus_number(device_list[i]) == bus) && (libusb_get_device_address(device_list[i]) == address)) {
+            d->ctx_device = libusb_ref_device(device_list[i]);
+            break;
+        }
+    }
+    if (n >= 0) {
+        libusb_free_device_list(device_list, 1);
+    }
+    if (!d->ctx_device) {
+        device_thread_stop(d);
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    if (pthread_create(&d->thread_id, NULL, device_thread, d)) {
+        d->thread_id = 0;
+        device_thread_stop(d);
+        return JSDRV_ERROR_UNSPECIFIED;
+    }
+    return 0;
+}
+
+// Match a full or partial device prefix against JSDRV_ARG_DEVICE_HINT.
+static bool device_hint_match(struct backend_s * s, const char * prefix) {
+    size_t prefix_len = strlen(prefix);
+    size_t hint_len = strlen(s->device_hint);
+    return 0 == strncmp(prefix, s->device_hint, (prefix_len < hint_len) ? prefix_len : hint_len);
+}
+
 static int32_t device_add(struct backend_s * s, libusb_device * usb_device, struct libusb_device_descriptor * descriptor) {
     struct dev_s * d;
     struct jsdrv_list_s * item;
+    char model_prefix[JSDRV_TOPIC_LENGTH_MAX];
+    const struct device_type_s * dt = device_type_find(descriptor);
+    if (!dt) {
+        return 1;
+    }
+    tfp_snprintf(model_prefix, sizeof(model_prefix), "%c/%s", s->backend.prefix, dt->model);
+    if (!device_hint_match(s, model_prefix)) {
+        return 1;  // skip without reading the serial number
+    }
     item = jsdrv_list_remove_head(&s->devices_free);
     if (!item) {
         JSDRV_LOGW("device_add but too many devices");
@@ -540,35 +1008,43 @@ static int32_t device_add(struct backend_s * s, libusb_device * usb_device, stru
     d = JSDRV_CONTAINER_OF(item, struct dev_s, item);
     jsdrv_list_initialize(&d->item);
 
-    const struct device_type_s * dt = device_types;
-    while (dt->device_type) {
-        if ((dt->vendor_id == descriptor->idVendor) && (dt->product_id == descriptor->idProduct)) {
-            // device matches device_type
-            d->mark = DEVICE_MARK_ADDED;
-            d->device_type = dt;
-            d->usb_device = usb_device;
-            d->device_descriptor = *descriptor;
-            int rc = libusb_get_serial_string_descriptor_ascii(d->usb_device, (uint8_t *) d->serial_number, sizeof(d->serial_number));
-            if (rc < 0) {
-                JSDRV_LOGW("Could not get serial number string");
-                tfp_snprintf(d->serial_number, sizeof(d->serial_number), "unknown");
-            } else {
-                unsigned long slen = strlen(d->serial_number);
-                while (slen && (d->serial_number[slen - 1] == '\n')) {
-                    d->serial_number[--slen] = 0;
-                }
-            }
-            tfp_snprintf(d->ll_device.prefix, sizeof(d->ll_device.prefix), "%c/%s/%s",
-                         s->backend.prefix, d->device_type->model, d->serial_number);
-            jsdrv_list_add_tail(&s->devices_active, &d->item);
-            d->mode = DEVICE_MODE_CLOSED;
-            device_add_announce(s, d);
-            return 0;
+    d->mark = DEVICE_MARK_ADDED;
+    d->device_type = dt;
+    d->usb_device = usb_device;
+    d->device_descriptor = *descriptor;
+    d->bulk_in_transfers = BULK_IN_TRANSFER_OUTSTANDING;
+    d->bulk_in_size = BULK_IN_TRANSFER_SIZE;
+    d->bulk_in_adaptive_max = 0;
+    int rc = libusb_get_serial_string_descriptor_ascii(d->usb_device, (uint8_t *) d->serial_number, sizeof(d->serial_number));
+    if (rc < 0) {
+        JSDRV_LOGW("Could not get serial number string");
+        tfp_snprintf(d->serial_number, sizeof(d->serial_number), "unknown");
+    } else {
+        unsigned long slen = strlen(d->serial_number);
+        while (slen && (d->serial_number[slen - 1] == '\n')) {
+            d->serial_number[--slen] = 0;
         }
-        ++dt;
     }
-    jsdrv_list_add_tail(&s->devices_free, &d->item);
-    return 1;
+    tfp_snprintf(d->ll_device.prefix, sizeof(d->ll_device.prefix), "%c/%s/%s",
+                 s->backend.prefix, d->device_type->model, d->serial_number);
+    if (!device_hint_match(s, d->ll_device.prefix)) {
+        JSDRV_LOGI("device_add(%s) skipped by hint %s", d->ll_device.prefix, s->device_hint);
+        d->usb_device = NULL;
+        d->mode = DEVICE_MODE_UNASSIGNED;
+        jsdrv_list_add_tail(&s->devices_free, &d->item);
+        return 1;
+    }
+    jsdrv_list_add_tail(&s->devices_active, &d->item);
+    d->mode = DEVICE_MODE_CLOSED;
+    if (s->device_threads) {
+        int32_t thread_rc = device_thread_start(d);
+        if (thread_rc) {
+            JSDRV_LOGW("device_thread_start(%s) failed %d, use backend thread",
+                       d->ll_device.prefix, (int) thread_rc);
+        }
+    }
+    device_add_announce(s, d);
+    return 0;
 }
 
 static void device_remove_announce(struct backend_s * s, struct dev_s * d) {
@@ -583,6 +1059,7 @@ static void device_remove_announce(struct backend_s * s, struct dev_s * d) {
 static void device_remove(struct backend_s * s, struct dev_s * d) {
     JSDRV_LOGI("device_remove(%s)", d->ll_device.prefix);
     jsdrv_list_remove(&d->item);
+    device_thread_stop(d);  // closes the device when it has its own thread
     if (d->handle) {
         JSDRV_LOGI("release interface device %s", d->serial_number);
         libusb_release_interface(d->handle, 0);
@@ -668,18 +1145,17 @@ static void handle_device_close(struct backend_s * s) {
     struct dev_s * d;
     jsdrv_list_foreach(&s->devices_active, item) {
         d = JSDRV_CONTAINER_OF(item, struct dev_s, item);
-        if ((d->mode == DEVICE_MODE_CLOSING) && (jsdrv_list_is_empty(&d->transfers_pending))) {
-            if (d->handle) {
-                libusb_close(d->handle);
-                d->handle = NULL;
-            }
-            d->mode = DEVICE_MODE_CLOSED;
+        if (!d->thread_id) {
+            device_close_complete(d, false);
         }
     }
 }
 
 static void device_close_all(struct backend_s * s) {
     struct timeval libusb_timeout_tv = {.tv_sec=1, .tv_usec=20000};
+    for (uint32_t i = 0; i < DEVICES_MAX; ++i) {
+        device_thread_stop(&s->devices[i]);
+    }
     for (uint32_t i = 0; i < DEVICES_MAX; ++i) {
         struct dev_s *d = &s->devices[i];
         if (d->handle) {
@@ -693,6 +1169,7 @@ static void device_close_all(struct backend_s * s) {
     }
     for (uint32_t i = 0; i < DEVICES_MAX; ++i) {
         struct dev_s *d = &s->devices[i];
+        bulk_in_ring_free(d);
         if (NULL != d->handle) {
             JSDRV_LOGI("closing idle device %s", d->serial_number);
             libusb_close(d->handle);
@@ -717,6 +1194,8 @@ void * backend_thread(void * arg) {
         backend_init_done(s, JSDRV_ERROR_IO);
         return NULL;
     }
+    jsdrvp_thread_configure(s->context, JSDRVP_THREAD_BACKEND, "jsdrv_usb");
+    jsdrvp_msg_cache_attach(s->context);
 
     rc = libusb_hotplug_register_callback(
             s->ctx,
@@ -761,6 +1240,9 @@ void * backend_thread(void * arg) {
 
         // Add file descriptors for each device command queue.
         for (size_t i = 0; i < JSDRV_ARRAY_SIZE(s->devices); ++i) {
+            if (s->devices[i].thread_id) {
+                continue;
+            }
             fds[nfds].fd = msg_queue_handle_get(s->devices[i].ll_device.cmd_q);
             fds[nfds].events = POLLIN;
             fds[nfds++].revents = 0;
@@ -770,7 +1252,7 @@ void * backend_thread(void * arg) {
             JSDRV_LOG_CRITICAL("nfds too large");
         }
 
-        rc = poll(fds, nfds, 5000);
+        rc = poll(fds, nfds, STATS_INTERVAL_MS);
         rc = libusb_handle_events_timeout_completed(s->ctx, &libusb_timeout_tv, NULL);
         while (handle_msg(s, msg_queue_pop_immediate(s->backend.cmd_q))) {
             ; //
@@ -786,6 +1268,7 @@ exit:
     libusb_hotplug_deregister_callback(s->ctx, s->hotplug_callback_handle);
     device_close_all(s);
     libusb_exit(s->ctx);
+    jsdrvp_msg_cache_detach(s->context);
     JSDRV_LOGI("jsdrv_usb_backend_thread exit");
     return NULL;
 }
@@ -837,6 +1320,11 @@ int32_t jsdrv_usb_backend_factory(struct jsdrv_context_s * context, struct jsdrv
         d->ll_device.rsp_q = msg_queue_init();
         jsdrv_list_initialize(&d->transfers_pending);
         jsdrv_list_initialize(&d->transfers_free);
+        for (uint32_t k = 0; k < BULK_IN_ENDPOINT_COUNT; ++k) {
+            jsdrv_list_initialize(&d->bulk_in[k].ring);
+            d->bulk_in[k].stats = &d->stats[k];
+        }
+        d->stats_interval_ms = STATS_INTERVAL_MS;
         jsdrv_list_initialize(&d->item);
         jsdrv_list_add_tail(&s->devices_free, &d->item);
     }
@@ -846,6 +1334,17 @@ int32_t jsdrv_usb_backend_factory(struct jsdrv_context_s * context, struct jsdrv
         return JSDRV_ERROR_UNAVAILABLE;
     }
 
+    struct jsdrv_union_s v;
+    if ((0 == jsdrvp_arg_get(context, JSDRV_ARG_USB_DEVICE_THREADS, &v))
+            && (0 == jsdrv_union_as_type(&v, JSDRV_UNION_U32))) {
+        s->device_threads = v.value.u32 ? true : false;
+        JSDRV_LOGI("libusb device threads: %d", (int) s->device_threads);
+    }
+    if ((0 == jsdrvp_arg_get(context, JSDRV_ARG_DEVICE_HINT, &v)) && (v.type == JSDRV_UNION_STR) && v.value.str) {
+        jsdrv_cstr_copy(s->device_hint, v.value.str, sizeof(s->device_hint));
+        JSDRV_LOGI("libusb device hint: %s", s->device_hint);
+    }
+
     s->hotplug_event = jsdrv_os_event_alloc();
 
     int rc = pthread_create(&s->thread_id, NULL, backend_thread, s);
@@ -18,12 +18,20 @@
  * @file
  *
  * @brief Thread-safe message queue.
+ *
+ * The queue holds messages in a lock-free ring.  When the ring is full,
+ * messages spill into a mutex-protected overflow list, which preserves
+ * per-producer FIFO order.  The event only signals on the transition
+ * from drained to pending, so steady-state traffic to a busy consumer
+ * performs no system calls.
  */
 
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/event.h"
 #include "jsdrv_prv/log.h"
+#include "jsdrv_prv/mpmc_ring.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/list.h"
 #include "jsdrv_prv/frontend.h"
@@ -35,14 +43,19 @@
 #include <errno.h>
 
 
+#define MSG_QUEUE_RING_SIZE     (256U)  // must be power of 2
+
 
 // ----------------------------------------------------------------------------
 // Message queue implementation
 // ----------------------------------------------------------------------------
 
 struct msg_queue_s {
+    struct jsdrv_mpmc_ring_s * ring;
+    volatile uint32_t overflow_count;   // number of items in overflow
+    volatile uint32_t signaled;         // 1 when event signaled and consumer has not yet drained
     jsdrv_os_event_t event;
-    struct jsdrv_list_s items;
+    struct jsdrv_list_s overflow;       // protected by mutex
     pthread_mutex_t mutex;
 };
 
@@ -52,67 +65,170 @@ struct msg_queue_s * msg_queue_init(void) {
         jsdrv_free(q);
         return NULL;
     }
+    q->ring = jsdrv_mpmc_ring_alloc(MSG_QUEUE_RING_SIZE);
+    if (NULL == q->ring) {
+        pthread_mutex_destroy(&q->mutex);
+        jsdrv_free(q);
+        return NULL;
+    }
     q->event = jsdrv_os_event_alloc();
     if (NULL == q->event) {
+        jsdrv_mpmc_ring_free(q->ring);
+        pthread_mutex_destroy(&q->mutex);
         jsdrv_free(q);
         return NULL;
     }
     //JSDRV_LOGI("msg_queue_init %p %p", q, q->available_event);
-    jsdrv_list_initialize(&q->items);
+    jsdrv_list_initialize(&q->overflow);
     return q;
 }
 
+static struct jsdrvp_msg_s * pop_any(struct msg_queue_s * queue) {
+    struct jsdrv_list_s * item;
+    struct jsdrvp_msg_s * msg = jsdrv_mpmc_ring_pop(queue->ring);
+    if ((NULL == msg) && jsdrv_atomic_load_u32(&queue->overflow_count)) {
+        pthread_mutex_lock(&queue->mutex);
+        item = jsdrv_list_remove_head(&queue->overflow);
+        if (item) {
+            msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+            jsdrv_atomic_add_u32(&queue->overflow_count, (uint32_t) -1);
+        }
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    return msg;
+}
+
 void msg_queue_finalize(struct msg_queue_s * queue) {
     struct jsdrvp_msg_s * msg;
     if (queue) {
-        pthread_mutex_lock(&queue->mutex);
         while (1) {
             // return items in the queue.
-            struct jsdrv_list_s * item = jsdrv_list_remove_tail(&queue->items);
-            if (item) {
-                msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+            msg = pop_any(queue);
+            if (msg) {
                 jsdrv_free(msg);  // presumes heap allocated
             } else {
                 break;
             }
         }
-        pthread_mutex_unlock(&queue->mutex);
         pthread_mutex_destroy(&queue->mutex);
+        jsdrv_mpmc_ring_free(queue->ring);
         jsdrv_os_event_free(queue->event);
         jsdrv_free(queue);
     }
 }
 
 bool msg_queue_is_empty(struct msg_queue_s* queue) {
-    bool rv;
-    pthread_mutex_lock(&queue->mutex);
-    rv = jsdrv_list_is_empty(&queue->items);
-    pthread_mutex_unlock(&queue->mutex);
-    return rv;
+    return jsdrv_mpmc_ring_is_empty(queue->ring) && (0 == jsdrv_atomic_load_u32(&queue->overflow_count));
+}
+
+uint32_t msg_queue_depth(struct msg_queue_s* queue) {
+    return jsdrv_mpmc_ring_count(queue->ring) + jsdrv_atomic_load_u32(&queue->overflow_count);
+}
+
+static inline void wake(struct msg_queue_s * queue) {
+    if (0 == jsdrv_atomic_exchange_u32(&queue->signaled, 1)) {
+        jsdrv_os_event_signal(queue->event);
+    }
 }
 
 void msg_queue_push(struct msg_queue_s * queue, struct jsdrvp_msg_s * msg) {
     JSDRV_DBC_NOT_NULL(msg);
     jsdrv_list_remove(&msg->item);  // remove from any existing list
-    pthread_mutex_lock(&queue->mutex);
-    jsdrv_list_add_tail(&queue->items, &msg->item);
-    pthread_mutex_unlock(&queue->mutex);
-    jsdrv_os_event_signal(queue->event);
+    if (jsdrv_atomic_load_u32(&queue->overflow_count) || !jsdrv_mpmc_ring_push(queue->ring, msg)) {
+        pthread_mutex_lock(&queue->mutex);
+        jsdrv_list_add_tail(&queue->overflow, &msg->item);
+        jsdrv_atomic_add_u32(&queue->overflow_count, 1);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    wake(queue);
 }
 
 struct jsdrvp_msg_s * msg_queue_pop_immediate(struct msg_queue_s* queue) {
-    struct jsdrv_list_s * item;
-    struct jsdrvp_msg_s * msg = NULL;
-    pthread_mutex_lock(&queue->mutex);
-    jsdrv_os_event_reset(queue->event);
-    item = jsdrv_list_remove_head(&queue->items);
-    if (item) {
-        msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+    struct jsdrvp_msg_s * msg = pop_any(queue);
+    if (NULL == msg) {
+        // drained: rearm the event, then recheck to close the race with push.
+        jsdrv_atomic_store_u32(&queue->signaled, 0);
+        jsdrv_os_event_reset(queue->event);
+        msg = pop_any(queue);
+        if (msg) {
+            wake(queue);  // more may remain, keep the consumer awake
+        }
     }
-    pthread_mutex_unlock(&queue->mutex);
     return msg;
 }
 
+static uint32_t pop_batch(struct msg_queue_s * queue, struct jsdrvp_msg_s ** msgs, uint32_t n) {
+    uint32_t count = 0;
+    while (count < n) {
+        struct jsdrvp_msg_s * msg = jsdrv_mpmc_ring_pop(queue->ring);
+        if (NULL == msg) {
+            break;
+        }
+        msgs[count++] = msg;
+    }
+    if ((count < n) && jsdrv_atomic_load_u32(&queue->overflow_count)) {
+        uint32_t removed = 0;
+        pthread_mutex_lock(&queue->mutex);
+        while (count < n) {
+            struct jsdrv_list_s * item = jsdrv_list_remove_head(&queue->overflow);
+            if (NULL == item) {
+                break;
+            }
+            msgs[count++] = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+            ++removed;
+        }
+        jsdrv_atomic_add_u32(&queue->overflow_count, (uint32_t) -(int32_t) removed);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    return count;
+}
+
+uint32_t msg_queue_pop_n(struct msg_queue_s * queue, struct jsdrvp_msg_s ** msgs, uint32_t n) {
+    uint32_t count = pop_batch(queue, msgs, n);
+    if ((0 == count) && n) {
+        // drained: rearm the event, then recheck to close the race with push.
+        jsdrv_atomic_store_u32(&queue->signaled, 0);
+        jsdrv_os_event_reset(queue->event);
+        count = pop_batch(queue, msgs, n);
+        if (count) {
+            wake(queue);  // more may remain, keep the consumer awake
+        }
+    }
+    return count;
+}
+
+static uint32_t pop_list(struct msg_queue_s * queue, struct jsdrv_list_s * list) {
+    uint32_t count = 0;
+    struct jsdrvp_msg_s * msg;
+    while (NULL != (msg = jsdrv_mpmc_ring_pop(queue->ring))) {
+        jsdrv_list_add_tail(list, &msg->item);
+        ++count;
+    }
+    if (jsdrv_atomic_load_u32(&queue->overflow_count)) {
+        pthread_mutex_lock(&queue->mutex);
+        uint32_t overflow_count = queue->overflow_count;
+        jsdrv_list_append(list, &queue->overflow);
+        jsdrv_atomic_add_u32(&queue->overflow_count, (uint32_t) -(int32_t) overflow_count);
+        pthread_mutex_unlock(&queue->mutex);
+        count += overflow_count;
+    }
+    return count;
+}
+
+uint32_t msg_queue_pop_all(struct msg_queue_s * queue, struct jsdrv_list_s * list) {
+    uint32_t count = pop_list(queue, list);
+    if (0 == count) {
+        // drained: rearm the event, then recheck to close the race with push.
+        jsdrv_atomic_store_u32(&queue->signaled, 0);
+        jsdrv_os_event_reset(queue->event);
+        count = pop_list(queue, list);
+        if (count) {
+            wake(queue);  // more may remain, keep the consumer awake
+        }
+    }
+    return count;
+}
+
 int32_t msg_queue_pop(struct msg_queue_s* queue, struct jsdrvp_msg_s ** msg, uint32_t timeout_ms) {
     JSDRV_DBC_NOT_NULL(msg);
     *msg = msg_queue_pop_immediate(queue);
@@ -14,6 +14,10 @@
 * limitations under the License.
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  // pthread_setname_np, pthread_setaffinity_np
+#endif
+
 #include "jsdrv_prv/assert.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
@@ -21,17 +25,23 @@
 #include "jsdrv_prv/event.h"
 #include "jsdrv_prv/mutex.h"
 #include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/thread_stats.h"
 #include "jsdrv/time.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <poll.h>
 #include <time.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
 
 int64_t jsdrv_time_utc(void) {
     struct timespec ts;
@@ -171,26 +181,119 @@ void jsdrv_thread_sleep_ms(uint32_t duration_ms) {
     nanosleep(&ts, NULL);
 }
 
-static jsdrv_os_mutex_t heap_mutex = NULL;
+int32_t jsdrv_thread_name_set(const char * name) {
+    if (!name) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrv_thread_stats_register(name);
+#if defined(__APPLE__)
+    int rc = pthread_setname_np(name);
+#elif defined(__linux__)
+    char buf[16];  // 15 characters + null terminator
+    jsdrv_cstr_copy(buf, name, sizeof(buf));
+    int rc = pthread_setname_np(pthread_self(), buf);
+#else
+    int rc = 0;
+#endif
+    if (rc) {
+        JSDRV_LOGW("pthread_setname_np(%s) failed: %d", name, rc);
+        return JSDRV_ERROR_UNSPECIFIED;
+    }
+    return 0;
+}
 
-void jsdrv_free(void * ptr) {
-    jsdrv_os_mutex_lock(heap_mutex);
-    free(ptr);
-    jsdrv_os_mutex_unlock(heap_mutex);
+int32_t jsdrv_thread_affinity_set(uint64_t mask) {
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu = 0; cpu < 64; ++cpu) {
+        if (mask & (1ULL << cpu)) {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (rc) {
+        JSDRV_LOGW("pthread_setaffinity_np(0x%llx) failed: %d", (unsigned long long) mask, rc);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return 0;
+#else
+    (void) mask;
+    JSDRV_LOGW("thread affinity not supported on this platform");
+    return JSDRV_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t jsdrv_thread_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (uint32_t) count : 1;
 }
 
-void * jsdrv_alloc(size_t size_bytes) {
-    jsdrv_os_mutex_lock(heap_mutex);
-    void * ptr = malloc(size_bytes);
-    if (!ptr) {
-        JSDRV_FATAL("out of memory");
+int32_t jsdrv_thread_priority_set(int priority) {
+    struct sched_param param;
+    int policy;
+    memset(&param, 0, sizeof(param));
+    if (priority >= JSDRV_THREAD_PRIORITY_REALTIME) {
+        policy = SCHED_FIFO;
+        param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    } else {
+        // SCHED_OTHER only supports the default static priority
+        policy = SCHED_OTHER;
+        param.sched_priority = 0;
+    }
+    int rc = pthread_setschedparam(pthread_self(), policy, &param);
+    if (rc == EPERM) {
+        JSDRV_LOGW("pthread_setschedparam(%d) insufficient permissions", priority);
+        return JSDRV_ERROR_PERMISSIONS;
+    } else if (rc) {
+        JSDRV_LOGW("pthread_setschedparam(%d) failed: %d", priority, rc);
+        return JSDRV_ERROR_UNSPECIFIED;
     }
-    jsdrv_os_mutex_unlock(heap_mutex);
-    return ptr;
+    return 0;
+}
+
+int32_t jsdrv_thread_cpu_open(jsdrv_thread_cpu_t * cpu) {
+#if defined(__APPLE__)
+    *cpu = (jsdrv_thread_cpu_t) pthread_mach_thread_np(pthread_self());
+    return 0;
+#else
+    clockid_t clock_id;
+    int rc = pthread_getcpuclockid(pthread_self(), &clock_id);
+    if (rc) {
+        JSDRV_LOGW("pthread_getcpuclockid failed: %d", rc);
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    *cpu = (jsdrv_thread_cpu_t) (int64_t) clock_id;
+    return 0;
+#endif
+}
+
+int32_t jsdrv_thread_cpu_time(jsdrv_thread_cpu_t cpu, uint64_t * time_ns) {
+#if defined(__APPLE__)
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+    if (KERN_SUCCESS != thread_info((mach_port_t) cpu, THREAD_BASIC_INFO, (thread_info_t) &info, &count)) {
+        return JSDRV_ERROR_CLOSED;
+    }
+    *time_ns = ((uint64_t) info.user_time.seconds + (uint64_t) info.system_time.seconds) * 1000000000ULL
+            + ((uint64_t) info.user_time.microseconds + (uint64_t) info.system_time.microseconds) * 1000ULL;
+    return 0;
+#else
+    // The kernel rejects the clock once the thread exits.
+    struct timespec ts;
+    if (clock_gettime((clockid_t) (int64_t) cpu, &ts)) {
+        return JSDRV_ERROR_CLOSED;
+    }
+    *time_ns = (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+    return 0;
+#endif
+}
+
+void jsdrv_thread_cpu_close(jsdrv_thread_cpu_t cpu) {
+    (void) cpu;  // nothing to release
 }
 
 int32_t jsdrv_platform_initialize(void) {
-    heap_mutex = jsdrv_os_mutex_alloc("heap");
     struct rlimit limit = {
         .rlim_cur = 0,
         .rlim_max = 0,
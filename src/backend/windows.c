@@ -21,6 +21,7 @@
 #include "jsdrv_prv/event.h"
 #include "jsdrv_prv/mutex.h"
 #include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/thread_stats.h"
 #include "jsdrv/time.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -148,6 +149,23 @@ void jsdrv_os_event_reset(jsdrv_os_event_t ev) {
     ResetEvent(ev);
 }
 
+static int thread_priority_map(int priority) {
+    if (priority > JSDRV_THREAD_PRIORITY_REALTIME) {
+        priority = JSDRV_THREAD_PRIORITY_REALTIME;
+    } else if (priority < -2) {
+        priority = -2;
+    }
+    switch (priority) {
+        case -2: return THREAD_PRIORITY_LOWEST;
+        case -1: return THREAD_PRIORITY_BELOW_NORMAL;
+        case 0: return THREAD_PRIORITY_NORMAL;
+        case 1: return THREAD_PRIORITY_ABOVE_NORMAL;
+        case 2: return THREAD_PRIORITY_HIGHEST;
+        case JSDRV_THREAD_PRIORITY_REALTIME: return THREAD_PRIORITY_TIME_CRITICAL;
+        default: return THREAD_PRIORITY_NORMAL;
+    }
+}
+
 int32_t jsdrv_thread_create(jsdrv_thread_t * thread, jsdrv_thread_fn fn, THREAD_ARG_TYPE fn_arg, int priority) {
     thread->thread = CreateThread(
             NULL,                   // default security attributes
@@ -162,18 +180,8 @@ int32_t jsdrv_thread_create(jsdrv_thread_t * thread, jsdrv_thread_fn fn, THREAD_
     }
     if (priority > 2) {
         priority = 2;
-    } else if (priority < -2) {
-        priority = -2;
     }
-    switch (priority) {
-        case -2: priority = THREAD_PRIORITY_LOWEST; break;
-        case -1: priority = THREAD_PRIORITY_BELOW_NORMAL; break;
-        case 0: priority = THREAD_PRIORITY_NORMAL; break;
-        case 1: priority = THREAD_PRIORITY_ABOVE_NORMAL; break;
-        case 2: priority = THREAD_PRIORITY_HIGHEST; break;
-        default: priority = 0;
-    }
-    if (!SetThreadPriority(thread->thread, priority)) {
+    if (!SetThreadPriority(thread->thread, thread_priority_map(priority))) {
         WINDOWS_LOGE("%s", "SetThreadPriority");
     }
     return 0;
@@ -199,27 +207,88 @@ void jsdrv_thread_sleep_ms(uint32_t duration_ms) {
     Sleep(duration_ms);
 }
 
-static jsdrv_os_mutex_t heap_mutex = NULL;
+typedef HRESULT (WINAPI *set_thread_description_fn)(HANDLE, PCWSTR);
 
-void jsdrv_free(void * ptr) {
-    jsdrv_os_mutex_lock(heap_mutex);
-    free(ptr);
-    jsdrv_os_mutex_unlock(heap_mutex);
+int32_t jsdrv_thread_name_set(const char * name) {
+    wchar_t name_w[64];
+    if (!name) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrv_thread_stats_register(name);
+    // SetThreadDescription requires Windows 10 1607, so resolve at runtime.
+    set_thread_description_fn fn = (set_thread_description_fn) (void (*)(void)) GetProcAddress(
+            GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription");
+    if (!fn) {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    if (!MultiByteToWideChar(CP_UTF8, 0, name, -1, name_w, (int) (sizeof(name_w) / sizeof(name_w[0])))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (FAILED(fn(GetCurrentThread(), name_w))) {
+        WINDOWS_LOGE("%s", "SetThreadDescription");
+        return JSDRV_ERROR_UNSPECIFIED;
+    }
+    return 0;
 }
 
-void * jsdrv_alloc(size_t size_bytes) {
-    jsdrv_os_mutex_lock(heap_mutex);
-    void * ptr = malloc(size_bytes);
-    if (!ptr) {
-        JSDRV_FATAL("out of memory");
+int32_t jsdrv_thread_cpu_open(jsdrv_thread_cpu_t * cpu) {
+    HANDLE h = NULL;
+    if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &h,
+                         THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0)) {
+        WINDOWS_LOGE("%s", "DuplicateHandle");
+        return JSDRV_ERROR_UNSPECIFIED;
     }
-    jsdrv_os_mutex_unlock(heap_mutex);
-    return ptr;
+    *cpu = (jsdrv_thread_cpu_t) (uintptr_t) h;
+    return 0;
 }
 
-int32_t jsdrv_platform_initialize(void) {
-    heap_mutex = jsdrv_os_mutex_alloc("heap");
+int32_t jsdrv_thread_cpu_time(jsdrv_thread_cpu_t cpu, uint64_t * time_ns) {
+    HANDLE h = (HANDLE) (uintptr_t) cpu;
+    DWORD exit_code = 0;
+    FILETIME t_create;
+    FILETIME t_exit;
+    FILETIME t_kernel;
+    FILETIME t_user;
+    // GetThreadTimes still succeeds after exit, so check explicitly.
+    if (!GetExitCodeThread(h, &exit_code) || (exit_code != STILL_ACTIVE)) {
+        return JSDRV_ERROR_CLOSED;
+    }
+    if (!GetThreadTimes(h, &t_create, &t_exit, &t_kernel, &t_user)) {
+        return JSDRV_ERROR_UNSPECIFIED;
+    }
+    uint64_t k = ((uint64_t) t_kernel.dwHighDateTime << 32) | t_kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t) t_user.dwHighDateTime << 32) | t_user.dwLowDateTime;
+    *time_ns = (k + u) * 100ULL;  // 100 ns units
+    return 0;
+}
 
+void jsdrv_thread_cpu_close(jsdrv_thread_cpu_t cpu) {
+    CloseHandle((HANDLE) (uintptr_t) cpu);
+}
+
+int32_t jsdrv_thread_affinity_set(uint64_t mask) {
+    if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) mask)) {
+        WINDOWS_LOGE("SetThreadAffinityMask 0x%llx", (unsigned long long) mask);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return 0;
+}
+
+uint32_t jsdrv_thread_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (uint32_t) info.dwNumberOfProcessors : 1;
+}
+
+int32_t jsdrv_thread_priority_set(int priority) {
+    if (!SetThreadPriority(GetCurrentThread(), thread_priority_map(priority))) {
+        WINDOWS_LOGE("SetThreadPriority %d", priority);
+        return JSDRV_ERROR_UNSPECIFIED;
+    }
+    return 0;
+}
+
+int32_t jsdrv_platform_initialize(void) {
     if (!SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS)) {
         WINDOWS_LOGE("Could not raise process priority using %s", "SetPriorityClass");
     }
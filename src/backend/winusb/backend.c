@@ -21,6 +21,7 @@
  */
 
 #define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_INFO
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_USB
 #include "jsdrv.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/assert.h"
@@ -30,9 +31,12 @@
 #include "jsdrv_prv/frontend.h"
 #include "jsdrv_prv/windows.h"
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/trace.h"
+#include "jsdrv_prv/usb_stats.h"
 #include "device_change_notifier.h"
 #include "jsdrv/error_code.h"
 #include "jsdrv/cstr.h"
+#include "jsdrv/time.h"
 #include "tinyprintf.h"
 #include <windows.h>
 #include <winusb.h>
@@ -47,7 +51,14 @@
 #define CONTROL_TIMEOUT_MS              (1000)
 #define BULK_IN_FRAME_LENGTH            (512)
 #define BULK_IN_TRANSFER_SIZE           (64 * BULK_IN_FRAME_LENGTH)
+#define BULK_IN_TRANSFER_SIZE_MAX       (2048U * BULK_IN_FRAME_LENGTH)
 #define BULK_IN_TRANSFER_OUTSTANDING    (4)
+#define BULK_IN_TRANSFER_OUTSTANDING_MAX (64U)
+#define BULK_IN_CLOSE_TIMEOUT_MS        (1000U)
+#define IOCP_WORKERS_MAX                (16U)
+#define BULK_IN_ENDPOINT_COUNT          (16U)
+#define STATS_INTERVAL_MS               (1000U)
+#define STATS_JSON_SIZE                 (2048U)
 
 enum device_mark_e {        // for scan add/remove mark & sweep
     DEVICE_MARK_NONE = 0,
@@ -77,13 +88,23 @@ struct bulk_in_transfer_s {
     struct bulk_in_s * bulk;
     OVERLAPPED overlapped;
     struct jsdrv_list_s item;
-    uint8_t buffer[BULK_IN_TRANSFER_SIZE];
+    int64_t t_complete;
+    DWORD status;       // 0 or GetLastError() on completion
+    ULONG size;         // received bytes on completion
+    bool done;
+    uint32_t capacity;  // buffer size in bytes
+    uint8_t buffer[];   // must be last
 };
 
 struct bulk_in_s {
     struct endpoint_s ep;
     struct jsdrv_list_s transfers_pending;
     struct jsdrv_list_s transfers_free;
+    uint32_t loaned;
+    bool closing;
+    bool raw_io;                    // RAW_IO pipe policy is active
+    uint32_t max_transfer_size;     // MAXIMUM_TRANSFER_SIZE pipe policy, 0 if unknown
+    struct jsdrv_usb_stats_s * stats;  // in dev_s.stats
 };
 
 struct bulk_out_s {
@@ -115,26 +136,50 @@ struct dev_s {
     struct endpoint_s * endpoints[256];
     struct jsdrv_list_s endpoints_active;  // struct endpoint_s
 
+    struct jsdrv_usb_stats_s stats[BULK_IN_ENDPOINT_COUNT];
+    uint32_t stats_interval_ms;         // JSDRV_USBBK_MSG_STATS period, 0 for off
+    uint32_t stats_time_ms;
+
+    HANDLE iocp;                        // shared completion port, NULL for event mode
+    CRITICAL_SECTION bulk_lock;         // bulk in state shared with the IOCP workers
+    uint32_t bulk_in_transfers;         // outstanding transfers per endpoint
+    uint32_t bulk_in_size;              // transfer size in bytes, up to BULK_IN_TRANSFER_SIZE_MAX
+    bool bulk_in_raw_io;                // RAW_IO pipe policy for bulk in endpoints opened later
+
     struct jsdrv_list_s item;     // manage devices: free and allocated lists
 };
 
+// Set the low bit to prevent a completion packet, see GetQueuedCompletionStatus.
+static inline HANDLE overlapped_event(struct dev_s * d, HANDLE event) {
+    return d->iocp ? (HANDLE) (((ULONG_PTR) event) | 1) : event;
+}
+
 
 //#############################################################################
 //# BULK IN STREAMING ENDPOINT                                                #
 //#############################################################################
 
-static struct bulk_in_transfer_s * bulk_in_transfer_alloc(struct bulk_in_s * b) {
+static struct bulk_in_transfer_s * bulk_in_transfer_alloc(struct bulk_in_s * b, uint32_t size) {
     struct jsdrv_list_s * item = jsdrv_list_remove_head(&b->transfers_free);
-    struct bulk_in_transfer_s * t;
+    struct bulk_in_transfer_s * t = NULL;
     if (item) {
         t = JSDRV_CONTAINER_OF(item, struct bulk_in_transfer_s, item);
-    } else {
-        t = jsdrv_alloc_clr(sizeof(struct bulk_in_transfer_s));
+        if (t->capacity < size) {
+            jsdrv_free(t);  // bulk_in_size increased
+            t = NULL;
+        }
+    }
+    if (!t) {
+        t = jsdrv_alloc_clr(sizeof(struct bulk_in_transfer_s) + size);
+        t->capacity = size;
         jsdrv_list_initialize(&t->item);
     }
     t->bulk = b;
+    t->done = false;
+    t->status = 0;
+    t->size = 0;
     memset(&t->overlapped, 0, sizeof(t->overlapped));
-    t->overlapped.hEvent = b->ep.event;
+    t->overlapped.hEvent = b->ep.event;  // NULL for IOCP
     JSDRV_LOGD3("bulk_in_transfer_alloc %p", &t->overlapped);
     return t;
 }
@@ -146,13 +191,40 @@ static void bulk_in_transfer_free(struct bulk_in_transfer_s * t) {
 
 static void bulk_in_finalize(struct endpoint_s * ep) {
     struct bulk_in_s * b = (struct bulk_in_s *) ep;
+    struct dev_s * d = b->ep.dev;
     JSDRV_LOGI("bulk_in_finalize ep=0x%02x", b->ep.pipe_id);
-    WinUsb_AbortPipe(b->ep.dev->winusb, b->ep.pipe_id);
+    EnterCriticalSection(&d->bulk_lock);
+    b->closing = true;
+    LeaveCriticalSection(&d->bulk_lock);
+    WinUsb_AbortPipe(d->winusb, b->ep.pipe_id);
+
+    if (d->iocp) {
+        // The IOCP workers retire the aborted transfers.
+        bool empty = false;
+        uint32_t t_start = jsdrv_time_ms_u32();
+        while (1) {
+            EnterCriticalSection(&d->bulk_lock);
+            empty = jsdrv_list_is_empty(&b->transfers_pending);
+            LeaveCriticalSection(&d->bulk_lock);
+            if (empty || ((jsdrv_time_ms_u32() - t_start) > BULK_IN_CLOSE_TIMEOUT_MS)) {
+                break;
+            }
+            Sleep(1);
+        }
+        EnterCriticalSection(&d->bulk_lock);
+        d->endpoints[b->ep.pipe_id] = NULL;  // workers ignore further packets
+        LeaveCriticalSection(&d->bulk_lock);
+        if (!empty) {
+            JSDRV_LOGW("bulk_in_finalize ep=0x%02x with pending transfers, leak", b->ep.pipe_id);
+            return;  // WinUSB may still write to the buffers
+        }
+    }
+
     while (!jsdrv_list_is_empty(&b->transfers_pending)) {
         struct jsdrv_list_s * item = jsdrv_list_remove_head(&b->transfers_pending);
         struct bulk_in_transfer_s * t = JSDRV_CONTAINER_OF(item, struct bulk_in_transfer_s, item);
         ULONG sz = 0;
-        WinUsb_GetOverlappedResult(b->ep.dev->winusb, &t->overlapped, &sz, TRUE);
+        WinUsb_GetOverlappedResult(d->winusb, &t->overlapped, &sz, TRUE);
         jsdrv_list_add_tail(&b->transfers_free, &t->item);
     }
 
@@ -169,60 +241,103 @@ static void bulk_in_finalize(struct endpoint_s * ep) {
     jsdrv_free(b);
 }
 
+/*
+ * With RAW_IO, WinUSB passes each read directly to the host controller
+ * without splitting or buffering, which removes the gaps between reads.
+ * The read size must then be a multiple of the maximum packet size and
+ * at most the pipe's MAXIMUM_TRANSFER_SIZE.
+ */
+static uint32_t bulk_in_read_size(struct bulk_in_s * b) {
+    uint32_t size = b->ep.dev->bulk_in_size;
+    if (b->raw_io && b->max_transfer_size && (size > b->max_transfer_size)) {
+        size = b->max_transfer_size - (b->max_transfer_size % BULK_IN_FRAME_LENGTH);
+        if (size < BULK_IN_FRAME_LENGTH) {
+            size = BULK_IN_FRAME_LENGTH;
+        }
+    }
+    return size;
+}
+
+// Caller holds bulk_lock.
 static int32_t bulk_in_pend(struct bulk_in_s * b) {
     JSDRV_LOGD2("bulk_in_pend");
+    if (b->closing) {
+        return 0;
+    }
     // Pend read operations
+    uint32_t size = bulk_in_read_size(b);
     size_t pending = jsdrv_list_length(&b->transfers_pending);
-    for (size_t idx = pending; idx < BULK_IN_TRANSFER_OUTSTANDING; ++idx) {
-        struct bulk_in_transfer_s * t = bulk_in_transfer_alloc(b);
-        if (!WinUsb_ReadPipe(b->ep.dev->winusb, b->ep.pipe_id, t->buffer, BULK_IN_TRANSFER_SIZE, NULL, &t->overlapped)) {
+    for (size_t idx = pending; idx < b->ep.dev->bulk_in_transfers; ++idx) {
+        struct bulk_in_transfer_s * t = bulk_in_transfer_alloc(b, size);
+        jsdrv_list_add_tail(&b->transfers_pending, &t->item);  // before IOCP packet
+        if (!WinUsb_ReadPipe(b->ep.dev->winusb, b->ep.pipe_id, t->buffer, size, NULL, &t->overlapped)) {
             DWORD ec = GetLastError();
             if (ec != ERROR_IO_PENDING) {
                 WINDOWS_LOGE("%s", "bulk_in_pend WinUsb_ReadPipe error");
+                jsdrv_list_remove(&t->item);
                 bulk_in_transfer_free(t);
                 return 1;
             }
         }
         JSDRV_LOGD3("bulk_in_pend WinUsb_ReadPipe %p", &t->overlapped);
-        jsdrv_list_add_tail(&b->transfers_pending, &t->item);
     }
     return 0;
 }
 
-static int32_t bulk_in_process(struct endpoint_s * ep) {
-    JSDRV_LOGD2("bulk_in_process");
-    struct bulk_in_s * b = (struct bulk_in_s *) ep;
-    ResetEvent(b->ep.event);
-    int32_t rc = 0;
+static bool bulk_in_transfer_done(struct bulk_in_s * b, struct bulk_in_transfer_s * t) {
+    if (t->done || b->ep.dev->iocp) {
+        return t->done;  // IOCP workers set done
+    }
+    ULONG sz = 0;
+    if (WinUsb_GetOverlappedResult(b->ep.dev->winusb, &t->overlapped, &sz, FALSE)) {
+        t->size = sz;
+        t->status = 0;
+    } else {
+        t->status = GetLastError();
+        if ((t->status == ERROR_IO_INCOMPLETE) || (t->status == ERROR_IO_PENDING)) {
+            return false;  // ok, not done yet
+        }
+    }
+    t->done = true;
+    return true;
+}
 
-    // Handle completed read operations
+// Forward completed transfers in submission order.  Caller holds bulk_lock.
+static int32_t bulk_in_complete(struct bulk_in_s * b) {
+    int32_t rc = 0;
     while (1) {
         struct jsdrv_list_s * item = jsdrv_list_peek_head(&b->transfers_pending);
         if (!item) {
             break;
         }
         struct bulk_in_transfer_s * t = JSDRV_CONTAINER_OF(item, struct bulk_in_transfer_s, item);
-        ULONG sz = 0;
-        if (WinUsb_GetOverlappedResult(b->ep.dev->winusb, &t->overlapped, &sz, FALSE)) {
-            JSDRV_LOGD3("bulk_in_process %p ready, %zu bytes",  &t->overlapped, sz);
-            jsdrv_list_remove_head(&b->transfers_pending);
+        if (!bulk_in_transfer_done(b, t)) {
+            break;
+        }
+        jsdrv_list_remove_head(&b->transfers_pending);
+        if (b->closing) {
+            bulk_in_transfer_free(t);
+        } else if (0 == t->status) {
+            JSDRV_LOGD3("bulk_in_complete %p ready, %lu bytes",  &t->overlapped, t->size);
+            JSDRV_TRACE_INSTANT("bulk_in_done", b->ep.dev->device.prefix, (uint32_t) t->size);
+            t->t_complete = jsdrv_time_utc();
+            jsdrv_usb_stats_complete(b->stats, t->t_complete, (uint32_t) t->size);
+            ++b->loaned;
             struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(b->ep.dev->context);
             jsdrv_cstr_copy(m->topic, JSDRV_USBBK_MSG_STREAM_IN_DATA, sizeof(m->topic));
-            m->value = jsdrv_union_bin(t->buffer, sz);
+            m->value = jsdrv_union_bin(t->buffer, t->size);
             m->extra.bkusb_stream.endpoint = b->ep.pipe_id;
+            m->extra.bkusb_stream.time = t->t_complete;
             msg_queue_push(b->ep.dev->device.rsp_q, m);
+        } else if (t->status == ERROR_SEM_TIMEOUT) {
+            JSDRV_LOGD1("bulk_in_complete timeout");
+            ++b->stats->timeouts;
+            bulk_in_transfer_free(t);  // timeout ok
         } else {
-            DWORD ec = GetLastError();
-            if ((ec == ERROR_IO_INCOMPLETE) || (ec == ERROR_IO_PENDING)) {
-                break;  // ok, not done yet
-            } else if (ec == ERROR_SEM_TIMEOUT) {
-                JSDRV_LOGD1("bulk_in_process timeout");
-                bulk_in_transfer_free(t);  // timeout ok
-            } else {
-                WINDOWS_LOG(JSDRV_LOGW, "%s", "bulk_in_process WinUsb_GetOverlappedResult error");
-                bulk_in_transfer_free(t);
-                rc = 1;
-            }
+            JSDRV_LOGW("bulk_in_complete ep=0x%02x error %lu", b->ep.pipe_id, t->status);
+            ++b->stats->errors;
+            bulk_in_transfer_free(t);
+            rc = 1;
         }
     }
 
@@ -233,6 +348,35 @@ static int32_t bulk_in_process(struct endpoint_s * ep) {
     }
 }
 
+static int32_t bulk_in_process(struct endpoint_s * ep) {
+    JSDRV_LOGD2("bulk_in_process");
+    struct bulk_in_s * b = (struct bulk_in_s *) ep;
+    ResetEvent(b->ep.event);
+    EnterCriticalSection(&b->ep.dev->bulk_lock);
+    int32_t rc = bulk_in_complete(b);
+    LeaveCriticalSection(&b->ep.dev->bulk_lock);
+    return rc;
+}
+
+// Find the bulk in transfer for a completion packet.  Caller holds bulk_lock.
+static struct bulk_in_transfer_s * iocp_transfer_find(struct dev_s * d, OVERLAPPED * overlapped) {
+    struct jsdrv_list_s * item;
+    for (uint32_t i = 0; i < BULK_IN_ENDPOINT_COUNT; ++i) {
+        struct endpoint_s * ep = d->endpoints[0x80 | i];
+        if (!ep || (ep->finalize != bulk_in_finalize)) {
+            continue;
+        }
+        struct bulk_in_s * b = (struct bulk_in_s *) ep;
+        jsdrv_list_foreach(&b->transfers_pending, item) {
+            struct bulk_in_transfer_s * t = JSDRV_CONTAINER_OF(item, struct bulk_in_transfer_s, item);
+            if (&t->overlapped == overlapped) {
+                return t;
+            }
+        }
+    }
+    return NULL;
+}
+
 static struct bulk_in_s * bulk_in_initialize(struct dev_s * dev, uint8_t pipe_id) {
     pipe_id |= 0x80;  // force IN
     JSDRV_LOGI("bulk_in_initialize pipe_id=0x%02x", pipe_id);
@@ -241,16 +385,20 @@ static struct bulk_in_s * bulk_in_initialize(struct dev_s * dev, uint8_t pipe_id
     b->ep.pipe_id = pipe_id;
     b->ep.process = bulk_in_process;
     b->ep.finalize = bulk_in_finalize;
-    b->ep.event = CreateEvent(
-            NULL,  // default security attributes
-            TRUE,  // manual reset event
-            TRUE,  // start signalled to pend initial transactions
-            NULL   // no name
-    );
-    if (!b->ep.event) {
-        JSDRV_LOGE("CreateEvent failed");
-        free(b);
-        return NULL;
+    b->stats = &dev->stats[pipe_id & (BULK_IN_ENDPOINT_COUNT - 1)];
+    jsdrv_usb_stats_open(b->stats, pipe_id);
+    if (!dev->iocp) {
+        b->ep.event = CreateEvent(
+                NULL,  // default security attributes
+                TRUE,  // manual reset event
+                TRUE,  // start signalled to pend initial transactions
+                NULL   // no name
+        );
+        if (!b->ep.event) {
+            JSDRV_LOGE("CreateEvent failed");
+            jsdrv_free(b);
+            return NULL;
+        }
     }
     jsdrv_list_initialize(&b->ep.item);
     jsdrv_list_initialize(&b->transfers_pending);
@@ -263,6 +411,7 @@ static struct bulk_in_s * bulk_in_initialize(struct dev_s * dev, uint8_t pipe_id
         WINDOWS_LOGE("%s", "WinUsb_GetPipePolicy MAXIMUM_TRANSFER_SIZE");
     } else {
         JSDRV_LOGI("MAXIMUM_TRANSFER_SIZE pipe_id=0x%02x bytes=%d", pipe_id, (int) value);
+        b->max_transfer_size = value;
     }
 
     //value = TRUE;
@@ -270,10 +419,14 @@ static struct bulk_in_s * bulk_in_initialize(struct dev_s * dev, uint8_t pipe_id
     //    WINDOWS_LOGE("%s", "WinUsb_SetPipePolicy AUTO_CLEAR_STALL");
     //}
 
-    value = TRUE;
+    value = dev->bulk_in_raw_io ? TRUE : FALSE;
     if (!WinUsb_SetPipePolicy(dev->winusb, pipe_id, RAW_IO, sizeof(value), &value)) {
         WINDOWS_LOGE("%s", "WinUsb_SetPipePolicy RAW_IO");
+    } else {
+        b->raw_io = dev->bulk_in_raw_io;
     }
+    JSDRV_LOGI("bulk_in_initialize pipe_id=0x%02x raw_io=%d read_size=%u", pipe_id,
+               (int) b->raw_io, (unsigned int) bulk_in_read_size(b));
 
     //value = 100;
     //if (!WinUsb_SetPipePolicy(dev->winusb, pipe_id, PIPE_TRANSFER_TIMEOUT, sizeof(value), &value)) {
@@ -337,7 +490,7 @@ static int32_t bulk_out_send_next(struct bulk_out_s * b) {
         struct jsdrv_list_s * item = jsdrv_list_peek_head(&b->msg_pending);
         struct jsdrvp_msg_s * m = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
         memset(&b->overlapped, 0, sizeof(b->overlapped));
-        b->overlapped.hEvent = b->ep.event;
+        b->overlapped.hEvent = overlapped_event(b->ep.dev, b->ep.event);
         if (!WinUsb_WritePipe(b->ep.dev->winusb, b->ep.pipe_id, (uint8_t *) m->value.value.bin, m->value.size, NULL, &b->overlapped)) {
             DWORD ec = GetLastError();
             if (ec != ERROR_IO_PENDING) {
@@ -431,8 +584,18 @@ static int32_t device_open(struct dev_s * d) {
     if (!WinUsb_SetPipePolicy(d->winusb, 0, PIPE_TRANSFER_TIMEOUT, sizeof(ctrl_timeout), &ctrl_timeout)) {
         JSDRV_LOGW("WinUsb_SetPipePolicy failed");
     }
+    if (d->iocp && !CreateIoCompletionPort(d->file, d->iocp, (ULONG_PTR) d, 0)) {
+        WINDOWS_LOGE("CreateIoCompletionPort %s", d->device.prefix);
+        WinUsb_Free(d->winusb);
+        d->winusb = INVALID_HANDLE_VALUE;
+        CloseHandle(d->file);
+        d->file = INVALID_HANDLE_VALUE;
+        return 1;
+    }
 
     jsdrv_list_initialize(&d->ctrl_list); // jsdrvp_msg_s
+    memset(d->stats, 0, sizeof(d->stats));
+    d->stats_time_ms = jsdrv_time_ms_u32();
     return 0;
 }
 
@@ -480,7 +643,7 @@ static void ctrl_start_next(struct dev_s * d) {
     struct jsdrvp_msg_s * msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
 
     memset(&d->ctrl_overlapped, 0, sizeof(d->ctrl_overlapped));
-    d->ctrl_overlapped.hEvent = d->ctrl_event;
+    d->ctrl_overlapped.hEvent = overlapped_event(d, d->ctrl_event);
     ULONG buf_sz = msg->extra.bkusb_ctrl.setup.s.wLength;
     ULONG sz = 0;
     WINUSB_SETUP_PACKET setup = *((WINUSB_SETUP_PACKET *) &msg->extra.bkusb_ctrl.setup.u64);
@@ -541,7 +704,16 @@ static bool device_handle_msg(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     }
     if (0 == strcmp(JSDRV_USBBK_MSG_STREAM_IN_DATA, msg->topic)) {
         struct bulk_in_transfer_s * t = JSDRV_CONTAINER_OF(msg->value.value.bin, struct bulk_in_transfer_s, buffer);
+        EnterCriticalSection(&d->bulk_lock);
+        jsdrv_usb_stats_residence(t->bulk->stats, t->t_complete, jsdrv_time_utc());
+        if (t->bulk->loaned) {
+            --t->bulk->loaned;
+        }
         bulk_in_transfer_free(t);
+        if (d->iocp) {
+            bulk_in_pend(t->bulk);  // recover from earlier pend failures
+        }
+        LeaveCriticalSection(&d->bulk_lock);
         jsdrvp_msg_free(d->context, msg);
     } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_OUT_DATA, msg->topic)) {
         bulk_out_send(d, msg);
@@ -568,22 +740,84 @@ static bool device_handle_msg(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     } else if (0 == strcmp(JSDRV_USBBK_MSG_CTRL_OUT, msg->topic)) {
         ctrl_add(d, msg);
     } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_STREAM_OPEN, msg->topic)) {
-        uint8_t ep = msg->extra.bkusb_stream.endpoint;
+        uint8_t ep = msg->extra.bkusb_stream.endpoint | 0x80;
+        int32_t rc = 0;
         JSDRV_LOGI("bulk_in_stream_open %d", (int) ep);
         ep_finalize_by_id(d, ep);
         struct bulk_in_s * b = bulk_in_initialize(d, ep);
-        d->endpoints[ep] = &b->ep;
-        jsdrv_list_add_tail(&d->endpoints_active, &b->ep.item);
-        d->update_handles = true;
-        msg->value = jsdrv_union_i32(0);  // return code
+        if (!b) {
+            rc = JSDRV_ERROR_UNSPECIFIED;
+        } else {
+            EnterCriticalSection(&d->bulk_lock);
+            d->endpoints[ep] = &b->ep;
+            if (d->iocp) {
+                bulk_in_pend(b);  // no event, start now
+            }
+            LeaveCriticalSection(&d->bulk_lock);
+            jsdrv_list_add_tail(&d->endpoints_active, &b->ep.item);
+            d->update_handles = true;
+        }
+        msg->value = jsdrv_union_i32(rc);  // return code
         msg_queue_push(d->device.rsp_q, msg);
     } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_STREAM_CLOSE, msg->topic)) {
-        uint8_t ep = msg->extra.bkusb_stream.endpoint;
+        uint8_t ep = msg->extra.bkusb_stream.endpoint | 0x80;
         JSDRV_LOGI("bulk_in_stream_close %d", (int) ep);
         ep_finalize_by_id(d, ep);
         d->update_handles = true;
         msg->value = jsdrv_union_i32(0);  // return code
         msg_queue_push(d->device.rsp_q, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_STATS_INTERVAL, msg->topic)) {
+        int32_t rc = jsdrv_union_as_type(&msg->value, JSDRV_UNION_U32);
+        if (0 == rc) {
+            d->stats_interval_ms = msg->value.value.u32;
+        }
+        msg->value = jsdrv_union_i32(rc ? JSDRV_ERROR_PARAMETER_INVALID : 0);
+        msg_queue_push(d->device.rsp_q, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_TRANSFERS, msg->topic)) {
+        int32_t rc = jsdrv_union_as_type(&msg->value, JSDRV_UNION_U32);
+        uint32_t x = msg->value.value.u32;
+        if (rc || (x < 1) || (x > BULK_IN_TRANSFER_OUTSTANDING_MAX)) {
+            rc = JSDRV_ERROR_PARAMETER_INVALID;
+        } else {
+            JSDRV_LOGI("bulk_in_transfers(%s) %u", d->device.prefix, (unsigned int) x);
+            EnterCriticalSection(&d->bulk_lock);
+            d->bulk_in_transfers = x;  // excess transfers retire on completion
+            if (d->iocp) {
+                for (uint32_t i = 0; i < BULK_IN_ENDPOINT_COUNT; ++i) {
+                    struct endpoint_s * ep = d->endpoints[0x80 | i];
+                    if (ep && (ep->finalize == bulk_in_finalize)) {
+                        bulk_in_pend((struct bulk_in_s *) ep);
+                    }
+                }
+            }
+            LeaveCriticalSection(&d->bulk_lock);
+        }
+        msg->value = jsdrv_union_i32(rc);
+        msg_queue_push(d->device.rsp_q, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_SIZE, msg->topic)) {
+        int32_t rc = jsdrv_union_as_type(&msg->value, JSDRV_UNION_U32);
+        uint32_t x = msg->value.value.u32;
+        if (rc || (x < BULK_IN_FRAME_LENGTH) || (x > BULK_IN_TRANSFER_SIZE_MAX) || (x % BULK_IN_FRAME_LENGTH)) {
+            rc = JSDRV_ERROR_PARAMETER_INVALID;
+        } else {
+            JSDRV_LOGI("bulk_in_size(%s) %u", d->device.prefix, (unsigned int) x);
+            d->bulk_in_size = x;  // applies to transfers as they are pended
+        }
+        msg->value = jsdrv_union_i32(rc);
+        msg_queue_push(d->device.rsp_q, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_RAW_IO, msg->topic)) {
+        int32_t rc = jsdrv_union_as_type(&msg->value, JSDRV_UNION_U32);
+        if (rc || (msg->value.value.u32 > 1)) {
+            rc = JSDRV_ERROR_PARAMETER_INVALID;
+        } else {
+            JSDRV_LOGI("bulk_in_raw_io(%s) %u", d->device.prefix, (unsigned int) msg->value.value.u32);
+            d->bulk_in_raw_io = (0 != msg->value.value.u32);  // applies to streams opened later
+        }
+        msg->value = jsdrv_union_i32(rc);
+        msg_queue_push(d->device.rsp_q, msg);
+    } else if (jsdrv_cstr_starts_with(msg->topic, JSDRV_USBBK_MSG_CONFIG_PREFIX)) {
+        msg->value = jsdrv_union_i32(JSDRV_ERROR_NOT_SUPPORTED);  // fixed transfer configuration
+        msg_queue_push(d->device.rsp_q, msg);
     } else {
         JSDRV_LOGW("unsupported topic %s", msg->topic);
         msg->value = jsdrv_union_i32(JSDRV_ERROR_PARAMETER_INVALID);
@@ -592,9 +826,39 @@ static bool device_handle_msg(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     return true;
 }
 
+static void stats_publish(struct dev_s * d) {
+    char buf[STATS_JSON_SIZE];
+    struct jsdrv_list_s * item;
+    if (!d->stats_interval_ms || (INVALID_HANDLE_VALUE == d->winusb)) {
+        return;
+    }
+    uint32_t t_now = jsdrv_time_ms_u32();
+    if ((t_now - d->stats_time_ms) < d->stats_interval_ms) {
+        return;
+    }
+    d->stats_time_ms = t_now;
+    EnterCriticalSection(&d->bulk_lock);
+    jsdrv_list_foreach(&d->endpoints_active, item) {
+        struct endpoint_s * ep = JSDRV_CONTAINER_OF(item, struct endpoint_s, item);
+        if (ep->finalize == bulk_in_finalize) {
+            struct bulk_in_s * b = (struct bulk_in_s *) ep;
+            b->stats->in_flight = (uint32_t) jsdrv_list_length(&b->transfers_pending);
+            b->stats->loaned = b->loaned;
+        }
+    }
+    uint32_t count = jsdrv_usb_stats_json(d->stats, BULK_IN_ENDPOINT_COUNT, buf, sizeof(buf));
+    LeaveCriticalSection(&d->bulk_lock);
+    if (count) {
+        msg_queue_push(d->device.rsp_q,
+                       jsdrvp_msg_alloc_value(d->context, JSDRV_USBBK_MSG_STATS, &jsdrv_union_json(buf)));
+    }
+}
+
 static DWORD WINAPI device_thread(LPVOID lpParam) {
     struct dev_s *d = (struct dev_s *) lpParam;
     JSDRV_LOGI("USB device_thread started %s", d->device.prefix);
+    jsdrvp_thread_configure(d->context, JSDRVP_THREAD_BACKEND, "jsdrv_usb_dev");
+    jsdrvp_msg_cache_attach(d->context);
     d->update_handles = true;
     struct jsdrv_list_s * item;
     struct endpoint_s * ep;
@@ -614,7 +878,7 @@ static DWORD WINAPI device_thread(LPVOID lpParam) {
             }
             JSDRV_LOGD2("device_thread handle_count=%d", (int) handle_count);
         }
-        WaitForMultipleObjects(handle_count, handles, false, 5000);
+        WaitForMultipleObjects(handle_count, handles, false, STATS_INTERVAL_MS);
         //JSDRV_LOGD3("winusb ll thread %s", d->device.prefix);
         if (WAIT_OBJECT_0 == WaitForSingleObject(handles[0], 0)) {
             // note: ResetEvent handled automatically by msg_queue_pop_immediate
@@ -628,15 +892,17 @@ static DWORD WINAPI device_thread(LPVOID lpParam) {
         }
         jsdrv_list_foreach(&d->endpoints_active, item) {
             ep = JSDRV_CONTAINER_OF(item, struct endpoint_s, item);
-            if (WAIT_OBJECT_0 == WaitForSingleObject(ep->event, 0)) {
+            if (ep->event && (WAIT_OBJECT_0 == WaitForSingleObject(ep->event, 0))) {
                 ep->process(ep);
             }
         }
+        stats_publish(d);
     }
 
     JSDRV_LOGI("USB device_thread closing %s", d->device.prefix);
     device_close(d);
     jsdrvp_send_finalize_msg(d->context, d->device.rsp_q, d->device.prefix);
+    jsdrvp_msg_cache_detach(d->context);
     JSDRV_LOGI("USB device_thread closed %s", d->device.prefix);
     return 0;
 }
@@ -657,8 +923,83 @@ struct backend_s {
     bool do_exit;
     HANDLE thread;
     DWORD thread_id;
+
+    HANDLE iocp;                            // JSDRV_ARG_USB_IOCP_WORKERS
+    HANDLE iocp_workers[IOCP_WORKERS_MAX];
+    uint32_t iocp_worker_count;
+    char device_hint[JSDRV_TOPIC_LENGTH_MAX];  // JSDRV_ARG_DEVICE_HINT or empty
 };
 
+static DWORD WINAPI iocp_worker(LPVOID lpParam) {
+    struct backend_s * s = (struct backend_s *) lpParam;
+    jsdrvp_thread_configure(s->context, JSDRVP_THREAD_BACKEND, "jsdrv_usb_iocp");
+    jsdrvp_msg_cache_attach(s->context);
+    while (1) {
+        DWORD sz = 0;
+        ULONG_PTR key = 0;
+        OVERLAPPED * overlapped = NULL;
+        BOOL ok = GetQueuedCompletionStatus(s->iocp, &sz, &key, &overlapped, INFINITE);
+        DWORD ec = ok ? 0 : GetLastError();
+        if (!overlapped) {
+            break;  // exit request or port closed
+        }
+        struct dev_s * d = (struct dev_s *) key;
+        EnterCriticalSection(&d->bulk_lock);
+        struct bulk_in_transfer_s * t = iocp_transfer_find(d, overlapped);
+        if (!t) {
+            JSDRV_LOGD1("iocp_worker ignore %p", overlapped);  // not a bulk in transfer
+        } else {
+            t->size = sz;
+            t->status = ec;
+            t->done = true;
+            bulk_in_complete(t->bulk);
+        }
+        LeaveCriticalSection(&d->bulk_lock);
+    }
+    jsdrvp_msg_cache_detach(s->context);
+    return 0;
+}
+
+static void iocp_finalize(struct backend_s * s) {
+    for (uint32_t i = 0; i < s->iocp_worker_count; ++i) {
+        PostQueuedCompletionStatus(s->iocp, 0, 0, NULL);
+    }
+    for (uint32_t i = 0; i < s->iocp_worker_count; ++i) {
+        if (WAIT_OBJECT_0 != WaitForSingleObject(s->iocp_workers[i], 1000)) {
+            JSDRV_LOGW("iocp worker %u not closed cleanly.", (unsigned int) i);
+        }
+        CloseHandle(s->iocp_workers[i]);
+        s->iocp_workers[i] = NULL;
+    }
+    s->iocp_worker_count = 0;
+    if (s->iocp) {
+        CloseHandle(s->iocp);
+        s->iocp = NULL;
+    }
+}
+
+static int32_t iocp_initialize(struct backend_s * s, uint32_t workers) {
+    if (workers > IOCP_WORKERS_MAX) {
+        workers = IOCP_WORKERS_MAX;
+    }
+    s->iocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, workers);
+    if (!s->iocp) {
+        WINDOWS_LOGE("%s", "CreateIoCompletionPort");
+        return JSDRV_ERROR_UNSPECIFIED;
+    }
+    for (uint32_t i = 0; i < workers; ++i) {
+        s->iocp_workers[i] = CreateThread(NULL, 0, iocp_worker, s, 0, NULL);
+        if (!s->iocp_workers[i]) {
+            WINDOWS_LOGE("%s", "iocp worker CreateThread");
+            iocp_finalize(s);
+            return JSDRV_ERROR_UNSPECIFIED;
+        }
+        ++s->iocp_worker_count;
+    }
+    JSDRV_LOGI("winusb IOCP mode with %u workers", (unsigned int) workers);
+    return 0;
+}
+
 static void on_device_change(void* cookie) {
     struct backend_s * s = (struct backend_s *) cookie;
     JSDRV_LOGD1("on_device_change");
@@ -715,11 +1056,26 @@ static int32_t device_thread_start(struct dev_s * d) {
     return 0;
 }
 
+// Match a device prefix against JSDRV_ARG_DEVICE_HINT.
+static bool device_hint_match(struct backend_s * s, const char * prefix) {
+    size_t prefix_len = strlen(prefix);
+    size_t hint_len = strlen(s->device_hint);
+    return 0 == strncmp(prefix, s->device_hint, (prefix_len < hint_len) ? prefix_len : hint_len);
+}
+
 static int32_t device_add(struct backend_s * s, const struct device_type_s * device_type, const char * device_path) {
     int32_t rc = 0;
     char serial_number[JSDRV_TOPIC_LENGTH_MAX];
+    char prefix[JSDRV_TOPIC_LENGTH_MAX];
     struct jsdrvp_msg_s * msg;
 
+    device_path_to_serial_number(device_path, serial_number);
+    tfp_snprintf(prefix, sizeof(prefix), "%c/%s/%s", s->backend.prefix, device_type->model, serial_number);
+    if (!device_hint_match(s, prefix)) {
+        JSDRV_LOGD1("device_add_msg %s skipped by hint %s", prefix, s->device_hint);
+        return 0;  // the path is unknown on the next discovery, so skip again then
+    }
+
     struct jsdrv_list_s * item = jsdrv_list_remove_head(&s->devices_free);
     if (!item) {
         JSDRV_LOGE("device_add_msg %s but too many devices", device_path);
@@ -731,9 +1087,7 @@ static int32_t device_add(struct backend_s * s, const struct device_type_s * dev
     device->do_exit = false;
     device->device_type = device_type;
     jsdrv_cstr_copy(device->device_path, device_path, sizeof(device->device_path));
-    device_path_to_serial_number(device_path, serial_number);
-    tfp_snprintf(device->device.prefix, sizeof(device->device.prefix), "%c/%s/%s",
-                 s->backend.prefix, device_type->model, serial_number);
+    jsdrv_cstr_copy(device->device.prefix, prefix, sizeof(device->device.prefix));
     JSDRV_LOGI("device_add_msg %s : %s", device->device.prefix, device_path);
     jsdrv_list_initialize(&device->endpoints_active);
     jsdrv_list_add_tail(&s->devices_active, &device->item);
@@ -901,6 +1255,8 @@ static DWORD WINAPI backend_thread(LPVOID lpParam) {
     handles[0] = s->discovery;
     handles[1] = msg_queue_handle_get(s->backend.cmd_q);
     handle_count = 2;
+    jsdrvp_thread_configure(s->context, JSDRVP_THREAD_BACKEND, "jsdrv_usb");
+    jsdrvp_msg_cache_attach(s->context);
 
     device_scan(s);
     backend_ready(s);
@@ -919,6 +1275,7 @@ static DWORD WINAPI backend_thread(LPVOID lpParam) {
         }
     }
 
+    jsdrvp_msg_cache_detach(s->context);
     JSDRV_LOGI("USB backend_thread done");
     return 0;
 }
@@ -952,6 +1309,10 @@ static void finalize(struct jsdrvbk_s * backend) {
             struct dev_s * d = &s->devices[i];
             device_free(s, d);
         }
+        iocp_finalize(s);  // after all devices close
+        for (uint16_t i = 0; i < DEVICES_MAX; ++i) {
+            DeleteCriticalSection(&s->devices[i].bulk_lock);
+        }
 
         jsdrv_free(s);
     }
@@ -972,6 +1333,11 @@ int32_t jsdrv_usb_backend_factory(struct jsdrv_context_s * context, struct jsdrv
         d->winusb = INVALID_HANDLE_VALUE;
         d->file = INVALID_HANDLE_VALUE;
         d->context = context;
+        d->stats_interval_ms = STATS_INTERVAL_MS;
+        d->bulk_in_transfers = BULK_IN_TRANSFER_OUTSTANDING;
+        d->bulk_in_size = BULK_IN_TRANSFER_SIZE;
+        d->bulk_in_raw_io = true;
+        InitializeCriticalSection(&d->bulk_lock);
         d->device.cmd_q = msg_queue_init();
         d->device.rsp_q = msg_queue_init();
         d->ctrl_event = CreateEvent(
@@ -986,6 +1352,22 @@ int32_t jsdrv_usb_backend_factory(struct jsdrv_context_s * context, struct jsdrv
         jsdrv_list_initialize(&d->ctrl_list);
     }
 
+    struct jsdrv_union_s v;
+    if ((0 == jsdrvp_arg_get(context, JSDRV_ARG_USB_IOCP_WORKERS, &v))
+            && (0 == jsdrv_union_as_type(&v, JSDRV_UNION_U32)) && v.value.u32) {
+        if (iocp_initialize(s, v.value.u32)) {
+            finalize(&s->backend);
+            return JSDRV_ERROR_UNSPECIFIED;
+        }
+        for (uint16_t i = 0; i < DEVICES_MAX; ++i) {
+            s->devices[i].iocp = s->iocp;
+        }
+    }
+    if ((0 == jsdrvp_arg_get(context, JSDRV_ARG_DEVICE_HINT, &v)) && (v.type == JSDRV_UNION_STR) && v.value.str) {
+        jsdrv_cstr_copy(s->device_hint, v.value.str, sizeof(s->device_hint));
+        JSDRV_LOGI("winusb device hint: %s", s->device_hint);
+    }
+
     s->discovery = CreateEvent(
             NULL,  // default security attributes
             TRUE,  // manual reset event
@@ -15,6 +15,7 @@
  */
 
 #include "device_change_notifier.h"
+#include "jsdrv_prv/devices.h"
 #include "jsdrv_prv/log.h"
 #include <Windows.h>
 #include <setupapi.h>
@@ -34,6 +35,15 @@ static const DWORD THREAD_JOIN_DELAY = 2000; // in milliseconds
 static const DWORD THREAD_START_DELAY = 2000; // in milliseconds
 
 
+static bool device_type_match(const GUID * guid) {
+    for (const struct device_type_s * dt = device_types; dt->device_type; ++dt) {
+        if (IsEqualGUID(&dt->guid, guid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static LRESULT CALLBACK window_callback(HWND hwnd, UINT nMsg, WPARAM wParam, LPARAM lParam) {
     switch (nMsg) {
         case WM_CLOSE: {
@@ -57,15 +67,20 @@ static LRESULT CALLBACK window_callback(HWND hwnd, UINT nMsg, WPARAM wParam, LPA
         }
 
         case WM_DEVICECHANGE: {
-            // Should start with DEV_BROADCAST_HDR and validate.
-            //DEV_BROADCAST_DEVICEINTERFACE* hdr;
-            //hdr = (DEV_BROADCAST_DEVICEINTERFACE*) lParam;
-
             // Only handle all devices arrived or all devices removed.
             if ((LOWORD(wParam) != DBT_DEVICEARRIVAL) &&
                 (LOWORD(wParam) != DBT_DEVICEREMOVECOMPLETE)) {
                 return TRUE;
             }
+            // Ignore other interface classes, such as hubs, which would
+            // otherwise rescan all devices on every unrelated change.
+            DEV_BROADCAST_HDR * hdr = (DEV_BROADCAST_HDR *) lParam;
+            if ((NULL == hdr) || (hdr->dbch_devicetype != DBT_DEVTYP_DEVICEINTERFACE)) {
+                return TRUE;
+            }
+            if (!device_type_match(&((DEV_BROADCAST_DEVICEINTERFACE_W *) hdr)->dbcc_classguid)) {
+                return TRUE;
+            }
             JSDRV_LOGD1("WM_DEVICECHANGE (filtered)");
 
             if (!SetTimer(window_, IDT_TIMER, TIMER_DELAY, 0)) {
@@ -21,6 +21,8 @@
  * This module starts a private thread and a Window which then registers for
  * the WM_DEVICECHANGE message:
  * http://msdn.microsoft.com/en-us/library/windows/desktop/aa363480(v=vs.85).aspx
+ * The window ignores changes to interface classes other than the
+ * jsdrv device_types, such as hubs and unrelated devices.
  * Upon receipt of the message, the window with start a timer.  When the timer
  * expires, it calls the registered callback.
  */
@@ -18,11 +18,19 @@
  * @file
  *
  * @brief Thread-safe message queue.
+ *
+ * The queue holds messages in a lock-free ring.  When the ring is full,
+ * messages spill into a critical-section-protected overflow list, which
+ * preserves per-producer FIFO order.  The event only signals on the
+ * transition from drained to pending, so steady-state traffic to a busy
+ * consumer performs no system calls.
  */
 
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/log.h"
+#include "jsdrv_prv/mpmc_ring.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/list.h"
 #include "jsdrv_prv/frontend.h"
@@ -31,18 +39,29 @@
 #include <windows.h>
 
 
+#define MSG_QUEUE_RING_SIZE     (256U)  // must be power of 2
+
+
 // ----------------------------------------------------------------------------
 // Message queue implementation
 // ----------------------------------------------------------------------------
 
 struct msg_queue_s {
-    HANDLE available_event;           // event
-    struct jsdrv_list_s items;
+    struct jsdrv_mpmc_ring_s * ring;
+    volatile uint32_t overflow_count;   // number of items in overflow
+    volatile uint32_t signaled;         // 1 when event signaled and consumer has not yet drained
+    HANDLE available_event;             // event
+    struct jsdrv_list_s overflow;       // protected by critical_section
     CRITICAL_SECTION critical_section;
 };
 
 struct msg_queue_s * msg_queue_init() {
     struct msg_queue_s * q = jsdrv_alloc_clr(sizeof(struct msg_queue_s));
+    q->ring = jsdrv_mpmc_ring_alloc(MSG_QUEUE_RING_SIZE);
+    if (!q->ring) {
+        jsdrv_free(q);
+        return NULL;
+    }
     InitializeCriticalSection(&q->critical_section);
     q->available_event = CreateEvent(
             NULL,  // default security attributes
@@ -51,77 +70,181 @@ struct msg_queue_s * msg_queue_init() {
             NULL   // no name
     );
     if (!q->available_event) {
+        DeleteCriticalSection(&q->critical_section);
+        jsdrv_mpmc_ring_free(q->ring);
+        jsdrv_free(q);
         return NULL;
     }
     //JSDRV_LOGI("msg_queue alloc %p %p", q, q->available_event);
-    jsdrv_list_initialize(&q->items);
+    jsdrv_list_initialize(&q->overflow);
     return q;
 }
 
+static struct jsdrvp_msg_s * pop_any(struct msg_queue_s * queue) {
+    struct jsdrv_list_s * item;
+    struct jsdrvp_msg_s * msg = jsdrv_mpmc_ring_pop(queue->ring);
+    if ((NULL == msg) && jsdrv_atomic_load_u32(&queue->overflow_count)) {
+        EnterCriticalSection(&queue->critical_section);
+        item = jsdrv_list_remove_head(&queue->overflow);
+        if (item) {
+            msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+            jsdrv_atomic_add_u32(&queue->overflow_count, (uint32_t) -1);
+        }
+        LeaveCriticalSection(&queue->critical_section);
+    }
+    return msg;
+}
+
 void msg_queue_finalize(struct msg_queue_s * queue) {
     struct jsdrvp_msg_s * msg;
     if (NULL != queue) {
         //JSDRV_LOGI("msg_queue free %p %p", queue, queue->available_event);
-        EnterCriticalSection(&queue->critical_section);
         while (1) {
             // return items in the queue.
-            struct jsdrv_list_s * item = jsdrv_list_remove_tail(&queue->items);
-            if (item) {
-                msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+            msg = pop_any(queue);
+            if (msg) {
                 jsdrv_free(msg);
             } else {
                 break;
             }
         }
-        LeaveCriticalSection(&queue->critical_section);
         DeleteCriticalSection(&queue->critical_section);
         CloseHandle(queue->available_event);
         queue->available_event = 0;
+        jsdrv_mpmc_ring_free(queue->ring);
         jsdrv_free(queue);
     }
 }
 
 bool msg_queue_is_empty(struct msg_queue_s* queue) {
-    bool rv;
     if (NULL == queue) {
         return true;
     }
-    EnterCriticalSection(&queue->critical_section);
-    rv = jsdrv_list_is_empty(&queue->items);
-    LeaveCriticalSection(&queue->critical_section);
-    return rv;
+    return jsdrv_mpmc_ring_is_empty(queue->ring) && (0 == jsdrv_atomic_load_u32(&queue->overflow_count));
+}
+
+uint32_t msg_queue_depth(struct msg_queue_s* queue) {
+    if (NULL == queue) {
+        return 0;
+    }
+    return jsdrv_mpmc_ring_count(queue->ring) + jsdrv_atomic_load_u32(&queue->overflow_count);
+}
+
+static inline void wake(struct msg_queue_s * queue) {
+    if (0 == jsdrv_atomic_exchange_u32(&queue->signaled, 1)) {
+        SetEvent(queue->available_event);
+    }
 }
 
 void msg_queue_push(struct msg_queue_s * queue, struct jsdrvp_msg_s * msg) {
     JSDRV_DBC_NOT_NULL(queue);
     JSDRV_DBC_NOT_NULL(msg);
-    EnterCriticalSection(&queue->critical_section);
     jsdrv_list_remove(&msg->item);  // remove from any existing list
-    jsdrv_list_add_tail(&queue->items, &msg->item);
-    SetEvent(queue->available_event);
-    LeaveCriticalSection(&queue->critical_section);
+    if (jsdrv_atomic_load_u32(&queue->overflow_count) || !jsdrv_mpmc_ring_push(queue->ring, msg)) {
+        EnterCriticalSection(&queue->critical_section);
+        jsdrv_list_add_tail(&queue->overflow, &msg->item);
+        jsdrv_atomic_add_u32(&queue->overflow_count, 1);
+        LeaveCriticalSection(&queue->critical_section);
+    }
+    wake(queue);
 }
 
 struct jsdrvp_msg_s * msg_queue_pop_immediate(struct msg_queue_s* queue) {
-    struct jsdrv_list_s * item;
-    struct jsdrvp_msg_s * msg = NULL;
+    struct jsdrvp_msg_s * msg;
     if (NULL == queue) {
         return NULL;
     }
-    EnterCriticalSection(&queue->critical_section);
-    item = jsdrv_list_remove_head(&queue->items);
-    if (item) {
-        msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
-        if (jsdrv_list_is_empty(&queue->items)) {
-            ResetEvent(queue->available_event);
-        }
-    } else {
+    msg = pop_any(queue);
+    if (NULL == msg) {
+        // drained: rearm the event, then recheck to close the race with push.
+        jsdrv_atomic_store_u32(&queue->signaled, 0);
         ResetEvent(queue->available_event);
+        msg = pop_any(queue);
+        if (msg) {
+            wake(queue);  // more may remain, keep the consumer awake
+        }
     }
-    LeaveCriticalSection(&queue->critical_section);
     return msg;
 }
 
+static uint32_t pop_batch(struct msg_queue_s * queue, struct jsdrvp_msg_s ** msgs, uint32_t n) {
+    uint32_t count = 0;
+    while (count < n) {
+        struct jsdrvp_msg_s * msg = jsdrv_mpmc_ring_pop(queue->ring);
+        if (NULL == msg) {
+            break;
+        }
+        msgs[count++] = msg;
+    }
+    if ((count < n) && jsdrv_atomic_load_u32(&queue->overflow_count)) {
+        uint32_t removed = 0;
+        EnterCriticalSection(&queue->critical_section);
+        while (count < n) {
+            struct jsdrv_list_s * item = jsdrv_list_remove_head(&queue->overflow);
+            if (NULL == item) {
+                break;
+            }
+            msgs[count++] = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+            ++removed;
+        }
+        jsdrv_atomic_add_u32(&queue->overflow_count, (uint32_t) -(int32_t) removed);
+        LeaveCriticalSection(&queue->critical_section);
+    }
+    return count;
+}
+
+uint32_t msg_queue_pop_n(struct msg_queue_s * queue, struct jsdrvp_msg_s ** msgs, uint32_t n) {
+    if (NULL == queue) {
+        return 0;
+    }
+    uint32_t count = pop_batch(queue, msgs, n);
+    if ((0 == count) && n) {
+        // drained: rearm the event, then recheck to close the race with push.
+        jsdrv_atomic_store_u32(&queue->signaled, 0);
+        ResetEvent(queue->available_event);
+        count = pop_batch(queue, msgs, n);
+        if (count) {
+            wake(queue);  // more may remain, keep the consumer awake
+        }
+    }
+    return count;
+}
+
+static uint32_t pop_list(struct msg_queue_s * queue, struct jsdrv_list_s * list) {
+    uint32_t count = 0;
+    struct jsdrvp_msg_s * msg;
+    while (NULL != (msg = jsdrv_mpmc_ring_pop(queue->ring))) {
+        jsdrv_list_add_tail(list, &msg->item);
+        ++count;
+    }
+    if (jsdrv_atomic_load_u32(&queue->overflow_count)) {
+        EnterCriticalSection(&queue->critical_section);
+        uint32_t overflow_count = queue->overflow_count;
+        jsdrv_list_append(list, &queue->overflow);
+        jsdrv_atomic_add_u32(&queue->overflow_count, (uint32_t) -(int32_t) overflow_count);
+        LeaveCriticalSection(&queue->critical_section);
+        count += overflow_count;
+    }
+    return count;
+}
+
+uint32_t msg_queue_pop_all(struct msg_queue_s * queue, struct jsdrv_list_s * list) {
+    if (NULL == queue) {
+        return 0;
+    }
+    uint32_t count = pop_list(queue, list);
+    if (0 == count) {
+        // drained: rearm the event, then recheck to close the race with push.
+        jsdrv_atomic_store_u32(&queue->signaled, 0);
+        ResetEvent(queue->available_event);
+        count = pop_list(queue, list);
+        if (count) {
+            wake(queue);  // more may remain, keep the consumer awake
+        }
+    }
+    return count;
+}
+
 int32_t msg_queue_pop(struct msg_queue_s* queue, struct jsdrvp_msg_s ** msg, uint32_t timeout_ms) {
     JSDRV_DBC_NOT_NULL(msg);
     if (NULL == queue) {
@@ -14,8 +14,12 @@
 * limitations under the License.
 */
 
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_BUFFER
+
 #include "jsdrv_prv/buffer.h"
 #include "jsdrv_prv/buffer_signal.h"
+#include "jsdrv_prv/assert.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/dbc.h"
 #include "jsdrv/cstr.h"
@@ -26,14 +30,38 @@
 #include "jsdrv_prv/list.h"
 #include "jsdrv_prv/log.h"
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/page_alloc.h"
 #include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/trace.h"
+#include "jsdrv_prv/trigger.h"
 #include "jsdrv.h"
 #include "tinyprintf.h"
 #include <math.h>
 #include <inttypes.h>
-
-
-#define BUFFER_THREAD_WAIT_TIMEOUT_MS  (50)
+#include <stddef.h>
+#include <stdio.h>
+
+
+#define BUFFER_READER_COUNT            (2)  // concurrent request workers for each buffer
+#define BUFFER_POOL_THREADS_MAX        (8)  // shared worker threads for all buffers
+#define BUFFER_REQ_BATCH               (4)  // requests for one work item before yielding the worker
+#define BUFFER_WORK_CMD                (1)  // work_q u32_a: drain the buffer's cmd_q
+#define BUFFER_WORK_REQ                (2)  // work_q u32_a: service the buffer's pending requests
+#define BUFFER_GATE_PAUSED             (1)  // readers_gate while the buffer reallocates signals
+#define BUFFER_GATE_CLOSED             (2)  // readers_gate once the buffer is removed
+#define BUFFER_CMD_SNAPSHOT            (0x100)  // cmd_q u32_a for a snapshot_s, above the signal ids
+#define BUFFER_R0_F32                  (128)    // default samples in the first reduction
+#define BUFFER_R0_UINT                 (1024)
+#define BUFFER_RN                      (32)     // default entries in subsequent reductions
+#define BUFFER_R_MAX                   (65536)
+#define BUFFER_LEVELS_COST             (8)      // reduction levels in the memory estimate
+
+// Summary request cost model for g/latency, in nanoseconds.
+#define BUFFER_COST_SAMPLE_F32_NS      (1.0)    // level 0 samples at each request edge
+#define BUFFER_COST_SAMPLE_UINT_NS     (0.1)    // histograms process whole words
+#define BUFFER_COST_ENTRY_NS           (10.0)   // combine one summary entry
+#define BUFFER_COST_LENGTH             (1000)   // typical summary request length, one display width
 JSDRV_STATIC_ASSERT(16 == sizeof(struct jsdrv_summary_entry_s), entry_size_one);
 JSDRV_STATIC_ASSERT(32 == sizeof(struct jsdrv_summary_entry_s[2]), entry_size_two);
 JSDRV_STATIC_ASSERT(JSDRV_BUFSIG_COUNT_MAX <= 256, bufsig_fits_in_u8); // assumed for add/remove/list operations
@@ -72,11 +100,35 @@ enum buffer_state_s {
 };
 
 struct req_s {
-    uint32_t signal_id;
+    uint32_t signal_id;  // 0 for signal_ids
     struct jsdrv_buffer_request_s req;
+    uint8_t signal_count;
+    uint8_t signal_ids[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];
+    bool stats;          // range statistics for signal_ids
+    uint8_t search_op;   // jsdrv_buffer_search_op_e, 0 for data requests
+    float threshold;
+    uint32_t hits_max;
     struct jsdrv_list_s item;
 };
 
+// The signals moved out of one buffer for installation into another.
+struct snapshot_s {
+    double duration;
+    uint32_t count;
+    struct bufsig_s signals[];
+};
+
+struct buffer_s;
+
+struct reader_s {
+    struct buffer_s * parent;
+    uint32_t index;
+    bool busy;                               // claimed by a worker, under req_mutex
+    char rsp_topic[JSDRV_TOPIC_LENGTH_MAX];  // the current request, under req_mutex
+    volatile uint32_t cancel;                // stop the current chunked response
+    struct bufsig_s snapshots[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];  // consistent copies for the current request
+};
+
 struct buffer_s {
     uint8_t idx;
     uint8_t hold;
@@ -84,10 +136,30 @@ struct buffer_s {
     char topic[JSDRV_TOPIC_LENGTH_MAX];
     struct jsdrv_context_s * context;
     uint64_t size;
-    struct msg_queue_s * cmd_q;
+    uint32_t latency_us;                      // target summary request latency, 0 for default reductions
+    uint8_t compress;                         // expected float32 level 0 compression ratio, 0 for raw
+    uint32_t horizon_s;                       // level 0 duration with older summaries only, 0 for all
+    uint8_t rebalance;                        // 1 to reallocate all signals on signal add and remove
+    uint8_t page_mode;                        // jsdrv_page_mode_e for the sample memory
+    uint32_t numa_node;                       // NUMA node + 1 for the sample memory, 0 for any
+    uint8_t source;                           // view the samples of this buffer id, 0 to store samples
+    uint32_t view_ms;                         // view duration, 0 for the full source duration
+    double duration;                          // the allocated duration in seconds, 0 when not allocated
+    bool horizon;                             // the allocation keeps level 0 for horizon_s only
+    char path[JSDRV_BUFSIG_PATH_LENGTH_MAX];  // directory for file-backed level 0, "" for RAM
+    struct msg_queue_s * cmd_q;     // processed serially by one worker at a time
+    volatile uint32_t cmd_scheduled;  // 1 while a BUFFER_WORK_CMD item is queued or running
     struct jsdrv_list_s req_pending;
     struct jsdrv_list_s req_free;
-    jsdrv_thread_t thread;
+    jsdrv_os_mutex_t req_mutex;     // req_pending, req_free, req_workers, and reader busy
+    uint32_t req_workers;           // BUFFER_WORK_REQ items queued or running
+    volatile uint32_t readers_gate;    // BUFFER_GATE_PAUSED or BUFFER_GATE_CLOSED, 0 when open
+    volatile uint32_t readers_active;  // readers processing a request
+    struct jsdrv_buffer_trigger_s trigger;    // the trigger configuration, mode 0 for off
+    struct jsdrv_trigger_s trigger_state;
+    bool trigger_fired;                       // waiting for the post samples
+    uint64_t trigger_sample_id;               // the fired edge sample_id
+    struct reader_s readers[BUFFER_READER_COUNT];
     volatile uint8_t do_exit;
     struct bufsig_s signals[JSDRV_BUFSIG_COUNT_MAX];  // 0 is reserved
 };
@@ -95,6 +167,10 @@ struct buffer_s {
 struct buffer_mgr_s {
     struct jsdrv_context_s * context;
     struct buffer_s buffers[JSDRV_BUFFER_COUNT_MAX];
+    volatile uint32_t views_active[JSDRV_BUFFER_COUNT_MAX];  // view readers of each buffer, kept across remove
+    struct msg_queue_s * work_q;    // work items for the shared workers, started with the first buffer
+    uint32_t worker_count;
+    jsdrv_thread_t workers[BUFFER_POOL_THREADS_MAX];
 };
 
 
@@ -103,6 +179,24 @@ static struct buffer_mgr_s instance_ = {.context = NULL};
 static uint8_t _buffer_recv(void * user_data, struct jsdrvp_msg_s * msg);
 static uint8_t _buffer_recv_data(void * user_data, struct jsdrvp_msg_s * msg);
 
+static void work_push(struct buffer_s * self, uint32_t kind) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, "", &jsdrv_union_u32(self->idx));
+    m->u32_a = kind;
+    msg_queue_push(instance_.work_q, m);
+}
+
+// Queue the buffer's cmd_q for a worker unless already queued or running.
+static void cmd_schedule(struct buffer_s * self) {
+    if (jsdrv_atomic_cas_u32(&self->cmd_scheduled, 0, 1)) {
+        work_push(self, BUFFER_WORK_CMD);
+    }
+}
+
+static void cmd_push(struct buffer_s * self, struct jsdrvp_msg_s * msg) {
+    msg_queue_push(self->cmd_q, msg);
+    cmd_schedule(self);
+}
+
 static bool is_buffer_idx_valid(uint64_t buffer_idx) {
     return ((buffer_idx >= 1) && (buffer_idx <= JSDRV_BUFFER_COUNT_MAX));
 }
@@ -148,10 +242,21 @@ static int32_t unsubscribe(struct jsdrv_context_s * context, const char * topic,
     return 0;
 }
 
+// Subscribe to the source data topic, which views never do.
+static void bufsig_data_sub(struct bufsig_s * b, bool enable) {
+    intptr_t v = ((((intptr_t) (b->idx)) & 0xffff) << 16) | (b->parent->idx & 0xffff);
+    if (enable) {
+        subscribe(b->parent->context, b->topic, JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM, _buffer_recv_data, (void *) v);
+    } else {
+        unsubscribe(b->parent->context, b->topic, JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM, _buffer_recv_data, (void *) v);
+    }
+}
+
 static void bufsig_unsub(struct bufsig_s * b) {
     if (b->topic[0]) {
-        intptr_t v = ((((intptr_t) (b->idx)) & 0xffff) << 16) | (b->parent->idx & 0xffff);
-        unsubscribe(b->parent->context, b->topic, JSDRV_SFLAG_PUB, _buffer_recv_data, (void *) v);
+        if (!b->parent->source) {
+            bufsig_data_sub(b, false);
+        }
         b->topic[0] = 0;
     }
 }
@@ -159,8 +264,9 @@ static void bufsig_unsub(struct bufsig_s * b) {
 static void bufsig_sub(struct bufsig_s * b, const char * topic) {
     bufsig_unsub(b);
     jsdrv_cstr_copy(b->topic, topic, sizeof(b->topic));
-    intptr_t v = ((((intptr_t) (b->idx)) & 0xffff) << 16) | (b->parent->idx & 0xffff);
-    subscribe(b->parent->context, b->topic, JSDRV_SFLAG_PUB, _buffer_recv_data, (void *) v);
+    if (!b->parent->source) {
+        bufsig_data_sub(b, true);
+    }
 }
 
 static void buf_publish_signal_list(struct buffer_s * self) {
@@ -199,89 +305,267 @@ static void bufsig_publish_info(struct bufsig_s * self) {
     }
 }
 
+static void bufsig_publish_levels(struct bufsig_s * self) {
+    struct jsdrv_context_s * context = self->parent->context;
+    uint64_t sizes[JSDRV_BUFSIG_LEVELS_MAX + 1];
+    uint32_t count = 0;
+    sizes[count++] = jsdrv_bufsig_level0_bytes(self);
+    for (uint32_t i = 0; (i < JSDRV_BUFSIG_LEVELS_MAX) && self->levels[i].data; ++i) {
+        sizes[count++] = self->levels[i].k * sizeof(struct jsdrv_summary_entry_s);
+    }
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(context, "",
+            &jsdrv_union_cbin_r((uint8_t *) sizes, count * sizeof(uint64_t)));
+    tfp_snprintf(m->topic, sizeof(m->topic), "m/%03d/s/%03d/levels", self->parent->idx, self->idx);
+    jsdrvp_backend_send(context, m);
+}
+
+static bool bufsig_is_f32(struct bufsig_s * b) {
+    return (b->hdr.element_type == JSDRV_DATA_TYPE_FLOAT) && (b->hdr.element_size_bits == 32);
+}
+
+// The packed level 0 ratio for a signal, 0 for raw.
+static uint8_t level0_ratio(struct buffer_s * self, struct bufsig_s * b, uint64_t r0) {
+    if ((self->compress > 1) && bufsig_is_f32(b) && !self->path[0] && (r0 <= JSDRV_BUFSIG_PACK_R0_MAX)) {
+        return self->compress;
+    }
+    return 0;
+}
+
+// Summary bytes for each level 0 sample.
+static double summary_bytes_per_sample(uint64_t r0, uint64_t rN) {
+    double rv = 0.0;
+    double r = (double) r0;
+    for (uint32_t lvl = 1; lvl < BUFFER_LEVELS_COST; ++lvl) {
+        rv += sizeof(struct jsdrv_summary_entry_s) / r;
+        r *= (double) rN;
+    }
+    return rv;
+}
+
+/*
+ * Select the reductions for a signal.
+ *
+ * Summary requests read level 0 samples at their edges and combine up to
+ * rN entries for each response entry.  Larger reductions use less memory
+ * but cost more for each request.  With g/latency, select the smallest
+ * summary memory whose estimated request cost meets the target.
+ */
+static void reductions_select(struct buffer_s * self, struct bufsig_s * b, uint64_t * r0, uint64_t * rN) {
+    bool f32 = bufsig_is_f32(b);
+    *r0 = f32 ? BUFFER_R0_F32 : BUFFER_R0_UINT;
+    *rN = BUFFER_RN;
+    if (self->latency_us && (!b->r0_cfg || !b->rN_cfg)) {
+        double cost_sample = f32 ? BUFFER_COST_SAMPLE_F32_NS : BUFFER_COST_SAMPLE_UINT_NS;
+        double cost_max = self->latency_us * 1000.0;
+        double best_bytes = INFINITY;
+        double best_cost = INFINITY;
+        bool best_fits = false;
+        for (uint64_t r0_c = 16; r0_c <= BUFFER_R_MAX; r0_c *= 2) {
+            if (b->r0_cfg && (r0_c != b->r0_cfg)) {
+                continue;
+            }
+            for (uint64_t rN_c = 4; rN_c <= 256; rN_c *= 2) {
+                if (b->rN_cfg && (rN_c != b->rN_cfg)) {
+                    continue;
+                }
+                double cost = 2.0 * r0_c * cost_sample + BUFFER_COST_LENGTH * rN_c * BUFFER_COST_ENTRY_NS;
+                double bytes = summary_bytes_per_sample(r0_c, rN_c);
+                bool fits = cost <= cost_max;
+                if (fits ? (!best_fits || (bytes < best_bytes) || ((bytes == best_bytes) && (rN_c > *rN)))
+                         : (!best_fits && (cost < best_cost))) {
+                    best_fits = fits;
+                    best_bytes = bytes;
+                    best_cost = cost;
+                    *r0 = r0_c;
+                    *rN = rN_c;
+                }
+            }
+        }
+    }
+    if (b->r0_cfg) {
+        *r0 = b->r0_cfg;
+    }
+    if (b->rN_cfg) {
+        *rN = b->rN_cfg;
+    }
+}
+
+// Round a requested reduction up to a power of 2, 0 for automatic.
+static uint32_t reduction_cfg(uint32_t r, uint32_t r_min) {
+    if (0 == r) {
+        return 0;
+    }
+    uint32_t rv = r_min;
+    while ((rv < r) && (rv < BUFFER_R_MAX)) {
+        rv *= 2;
+    }
+    return rv;
+}
+
+// Allocate one signal for duration seconds.
+static void bufsig_alloc(struct buffer_s * self, struct bufsig_s * b, uint64_t r0, uint64_t rN) {
+    uint32_t sample_rate = b->hdr.sample_rate / b->hdr.decimate_factor;
+    b->level0_horizon = self->horizon ? ((uint64_t) self->horizon_s * sample_rate) : 0;
+    double N = self->duration * sample_rate;
+    int64_t level = (int64_t) (ceil(log2(N / (double) (r0 * (rN * rN - 1))) / log2((double) rN) + 1.0));
+    if (level < 1) {
+        level = 1;
+    }
+    uint64_t rZ = r0;
+    for (int i = 1; i <= level; ++i) {
+        rZ *= rN;
+    }
+    uint64_t k = (uint64_t) (round(N / rZ));
+    if (k == 0) {
+        k = 1;
+    }
+    uint64_t Np = k * rZ;
+    b->page_mode = self->page_mode;
+    b->numa_node = self->numa_node;
+    if (self->path[0]) {
+        tfp_snprintf(b->level0_path, sizeof(b->level0_path), "%s/jsdrv_buffer_%03u_%03u.bin",
+                     self->path, (unsigned int) self->idx, (unsigned int) b->idx);
+    } else {
+        b->level0_path[0] = 0;
+    }
+    jsdrv_bufsig_alloc(b, Np, r0, rN);
+    bufsig_publish_info(b);
+    bufsig_publish_levels(b);
+}
+
 static void buffer_alloc(struct buffer_s * self) {
-    double coef_f32 = sizeof(float);
-    double coef_u = 0.0;
+    uint64_t r0[JSDRV_BUFSIG_COUNT_MAX];
+    uint64_t rN[JSDRV_BUFSIG_COUNT_MAX];
     JSDRV_LOGI("buffer_alloc %" PRIu64, self->size);
-    size_t summary_entry_sz = sizeof(struct jsdrv_summary_entry_s);
-    for (uint32_t lvl = 1; lvl < 8; ++lvl) {
-        double pow_lvl = pow(32.0, lvl - 1);
-        coef_f32 += summary_entry_sz / (128 * pow_lvl);
-        coef_u += summary_entry_sz / (1024 * pow_lvl);
-    }
 
-    // determine size in bytes per second
+    // determine size in bytes per second, with and without the level 0 horizon
     double sz_per_s = 0.0;
+    double sz_horizon_per_s = 0.0;   // signals with a horizon only keep summaries for the full duration
+    double sz_horizon = 0.0;         // level 0 bytes for the horizon
     for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
         struct bufsig_s *b = &self->signals[idx];
         if (!b->active) {
             continue;
         }
+        reductions_select(self, b, &r0[idx], &rN[idx]);
+        b->level0_ratio = level0_ratio(self, b, r0[idx]);
         uint32_t sample_rate = b->hdr.sample_rate / b->hdr.decimate_factor;
-        if ((b->hdr.element_type == JSDRV_DATA_TYPE_FLOAT) && (b->hdr.element_size_bits == 32)) {
-            sz_per_s +=sample_rate * coef_f32;
+        double level0_bytes = b->hdr.element_size_bits / 8.0;
+        if (b->level0_ratio) {
+            level0_bytes = level0_bytes / b->level0_ratio + sizeof(uint64_t) / (double) r0[idx];  // with block index
+        }
+        double summary_bytes = summary_bytes_per_sample(r0[idx], rN[idx]);
+        sz_per_s += sample_rate * (level0_bytes + summary_bytes);
+        if (self->horizon_s && !b->level0_ratio && !self->path[0]) {
+            sz_horizon += sample_rate * level0_bytes * (double) self->horizon_s;
+            sz_horizon_per_s += sample_rate * summary_bytes;
         } else {
-            sz_per_s += sample_rate * ((b->hdr.element_size_bits / 8.0) + coef_u);
+            sz_horizon_per_s += sample_rate * (level0_bytes + summary_bytes);
         }
     }
     // determine sample count for each signal, allocate, and publish duration
-    double duration = self->size / sz_per_s;
-    JSDRV_LOGI("%d B/s -> %d seconds", (int) sz_per_s, (int) duration);
+    self->duration = (sz_per_s > 0.0) ? (self->size / sz_per_s) : 0.0;
+    self->horizon = false;
+    if (self->horizon_s && (sz_horizon < self->size)) {
+        double duration_horizon = (self->size - sz_horizon) / sz_horizon_per_s;
+        if (duration_horizon > self->duration) {
+            self->duration = duration_horizon;
+            self->horizon = true;
+        }
+    }
+    JSDRV_LOGI("%d B/s -> %d seconds", (int) sz_per_s, (int) self->duration);
     for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
         struct bufsig_s *b = &self->signals[idx];
-        if (!b->active) {
-            continue;
-        }
-        uint32_t sample_rate = b->hdr.sample_rate / b->hdr.decimate_factor;
-        double N = duration * sample_rate;
-        uint64_t r0;        // power of 2
-        uint64_t rN = 32;   // power of 2
-        if ((b->hdr.element_type == JSDRV_DATA_TYPE_FLOAT) && (b->hdr.element_size_bits == 32)) {
-            r0 = 128;
-        } else {
-            r0 = 1024;
-        }
-        int64_t level = (int64_t) (ceil(log2(N / (double) (r0 * (rN * rN - 1))) / log2((double) rN) + 1.0));
-        if (level < 1) {
-            level = 1;
-        }
-        uint64_t rZ = r0;
-        for (int i = 1; i <= level; ++i) {
-            rZ *= rN;
-        }
-        uint64_t k = (uint64_t) (round(N / rZ));
-        if (k == 0) {
-            k = 1;
+        if (b->active) {
+            bufsig_alloc(self, b, r0[idx], rN[idx]);
         }
-        uint64_t Np = k * rZ;
-        jsdrv_bufsig_alloc(b, Np, r0, rN);
-        bufsig_publish_info(b);
     }
 }
 
+/*
+ * Allocate a signal added to, or moved out of, an allocated buffer.
+ *
+ * The signal keeps the same duration as the other signals, whose
+ * allocations and samples remain, so the buffer may exceed its size
+ * until the next full reallocation.
+ */
+static void bufsig_alloc_added(struct buffer_s * self, struct bufsig_s * b) {
+    uint64_t r0;
+    uint64_t rN;
+    JSDRV_LOGI("bufsig_alloc_added %d: %d seconds", (int) b->idx, (int) self->duration);
+    reductions_select(self, b, &r0, &rN);
+    b->level0_ratio = level0_ratio(self, b, r0);
+    bufsig_alloc(self, b, r0, rN);
+}
+
+static void bufsig_free(struct bufsig_s * b) {
+    jsdrv_bufsig_clear(b);
+    bufsig_publish_info(b);
+    jsdrv_bufsig_free(b);
+}
+
 static void buffer_free(struct buffer_s * self) {
     if (self->state == ST_ACTIVE) {
         self->state = ST_AWAIT;
     }
+    self->duration = 0.0;
     for (uint32_t idx = 0; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
-        struct bufsig_s *b = &self->signals[idx];
-        jsdrv_bufsig_clear(b);
-        bufsig_publish_info(b);
-        jsdrv_bufsig_free(b);
+        bufsig_free(&self->signals[idx]);
+    }
+}
+
+// True to change a single signal while the other signals keep their samples.
+static bool signal_incremental(struct buffer_s * self) {
+    return !self->rebalance && (self->state == ST_ACTIVE) && (self->duration > 0.0);
+}
+
+// Copy a request, except for its list item.
+static void req_copy(struct req_s * dst, const struct req_s * src) {
+    struct jsdrv_list_s item = dst->item;
+    *dst = *src;
+    dst->item = item;
+}
+
+// Discard the pending requests for rsp_topic and stop its responses in progress, with req_mutex held.
+static uint32_t req_cancel_locked(struct buffer_s * self, const char * rsp_topic) {
+    struct jsdrv_list_s * item;
+    uint32_t count = 0;
+    jsdrv_list_foreach(&self->req_pending, item) {
+        struct req_s * r = JSDRV_CONTAINER_OF(item, struct req_s, item);
+        if (0 == strcmp(r->req.rsp_topic, rsp_topic)) {
+            jsdrv_list_remove(item);
+            jsdrv_list_add_tail(&self->req_free, item);
+            ++count;
+        }
+    }
+    for (uint32_t idx = 0; idx < BUFFER_READER_COUNT; ++idx) {
+        struct reader_s * reader = &self->readers[idx];
+        if (0 == strcmp(reader->rsp_topic, rsp_topic)) {
+            jsdrv_atomic_store_u32(&reader->cancel, 1);
+        }
     }
+    return count;
 }
 
-static void req_post(struct buffer_s * self, uint32_t bufsig_idx, struct jsdrv_buffer_request_s * req) {
+static void req_post(struct buffer_s * self, const struct req_s * req) {
     struct jsdrv_list_s * item;
     struct req_s * r;
 
+    jsdrv_os_mutex_lock(self->req_mutex);
+    if (req->req.flags & JSDRV_BUFFER_REQUEST_FLAG_SUPERSEDE) {
+        uint32_t count = req_cancel_locked(self, req->req.rsp_topic);
+        JSDRV_LOGD1("supersede %u requests for %s", (unsigned int) count, req->req.rsp_topic);
+    }
+
     // Search for existing request
     jsdrv_list_foreach(&self->req_pending, item) {
         r = JSDRV_CONTAINER_OF(item, struct req_s, item);
-        if ((r->signal_id == bufsig_idx) && (r->req.rsp_id == req->rsp_id) && (0 == strcmp(r->req.rsp_topic, req->rsp_topic))) {
-            JSDRV_LOGD1("dedup rsp_id %lld", req->rsp_id);
+        if ((r->signal_id == req->signal_id) && (r->req.rsp_id == req->req.rsp_id)
+                && (0 == strcmp(r->req.rsp_topic, req->req.rsp_topic))) {
+            JSDRV_LOGD1("dedup rsp_id %lld", req->req.rsp_id);
             // found existing request still pending; update request.
-            r->req = *req;
+            req_copy(r, req);
+            jsdrv_os_mutex_unlock(self->req_mutex);
             return;
         }
     }
@@ -295,33 +579,414 @@ static void req_post(struct buffer_s * self, uint32_t bufsig_idx, struct jsdrv_b
         r = jsdrv_alloc_clr(sizeof(struct req_s));
         jsdrv_list_initialize(&r->item);
     }
-    r->signal_id = bufsig_idx;
-    r->req = *req;
-    jsdrv_list_add_tail(&self->req_pending, &r->item);
+    req_copy(r, req);
+    struct jsdrv_list_s * position = &self->req_pending;  // the tail
+    if (!(req->req.flags & JSDRV_BUFFER_REQUEST_FLAG_BACKGROUND)) {
+        // interactive requests go before the first background request
+        jsdrv_list_foreach(&self->req_pending, item) {
+            if (JSDRV_CONTAINER_OF(item, struct req_s, item)->req.flags & JSDRV_BUFFER_REQUEST_FLAG_BACKGROUND) {
+                position = item;
+                break;
+            }
+        }
+    }
+    jsdrv_list_insert_before(position, &r->item);
+    bool schedule = self->req_workers < BUFFER_READER_COUNT;
+    if (schedule) {
+        ++self->req_workers;
+    }
+    jsdrv_os_mutex_unlock(self->req_mutex);
+    if (schedule) {
+        work_push(self, BUFFER_WORK_REQ);
+    }
 }
 
-static bool req_handle_one(struct buffer_s * self) {
-    struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->req_pending);
-    if (NULL == item) {
-        return false;
+static void req_release(struct buffer_s * self, struct jsdrv_list_s * item) {
+    jsdrv_os_mutex_lock(self->req_mutex);
+    jsdrv_list_add_tail(&self->req_free, item);
+    jsdrv_os_mutex_unlock(self->req_mutex);
+}
+
+static void rsp_send(struct buffer_s * self, struct jsdrvp_msg_s * msg) {
+    if ((msg->value.size * 4) <= msg->payload_size) {
+        // move small responses into a proportionate message
+        struct jsdrvp_msg_s * m = jsdrvp_msg_clone(self->context, msg);
+        jsdrvp_msg_free(self->context, msg);
+        msg = m;
+    }
+    jsdrvp_backend_send(self->context, msg);
+}
+
+static uint32_t rsp_size(const struct jsdrv_buffer_response_s * rsp) {
+    return (uint32_t) (offsetof(struct jsdrv_buffer_response_s, data)
+            + (rsp->info.time_range_samples.length * rsp->info.element_size_bits + 7) / 8);
+}
+
+/*
+ * Get the signal that stores the samples for a request.
+ *
+ * A view resolves its signal to the active source buffer signal with the
+ * same topic.  When none exists, it returns the view's own signal, which
+ * has no samples.  The caller must hold the source readers, see view_enter().
+ */
+static struct bufsig_s * signal_storage(struct buffer_s * self, uint32_t signal_id) {
+    struct bufsig_s * b = &self->signals[signal_id];
+    if (!self->source || !b->active || !b->topic[0]) {
+        return b;
     }
-    struct req_s * req = JSDRV_CONTAINER_OF(item, struct req_s, item);
-    struct bufsig_s * b = &self->signals[req->signal_id];
-    if (!b->active) {
+    struct buffer_s * source = &instance_.buffers[self->source - 1];
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        struct bufsig_s * s = &source->signals[idx];
+        if (s->active && (0 == strcmp(s->topic, b->topic))) {
+            return s;
+        }
+    }
+    return b;
+}
+
+// Copy a signal for a request, limited to the view duration.
+static void signal_snapshot(struct buffer_s * self, struct bufsig_s * b, struct bufsig_s * copy) {
+    jsdrv_bufsig_snapshot(b, copy);
+    if (self->source && self->view_ms && copy->hdr.decimate_factor) {
+        uint64_t sample_rate = copy->hdr.sample_rate / copy->hdr.decimate_factor;
+        jsdrv_bufsig_view(copy, (sample_rate * self->view_ms + 999) / 1000);
+    }
+}
+
+// Respond to all signals in one message using the same sample_id grid.
+static bool req_handle_multi(struct reader_s * reader, struct jsdrv_buffer_request_s * req,
+                             const uint8_t * signal_ids, uint8_t signal_count) {
+    struct buffer_s * self = reader->parent;
+    struct bufsig_s * signals[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];
+    struct bufsig_s * copies[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];
+    uint32_t offsets[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];
+    for (uint32_t k = 0; k < signal_count; ++k) {
+        signals[k] = signal_storage(self, signal_ids[k]);
+        if (!signals[k]->active) {
+            JSDRV_LOGW("multi request signal %u inactive", (unsigned int) signal_ids[k]);
+            return false;
+        }
+        copies[k] = &reader->snapshots[k];
+    }
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_data(self->context, req->rsp_topic);
+    uint8_t * bin = (uint8_t *) msg->value.value.bin;
+    struct jsdrv_buffer_response_multi_s * rsp = (struct jsdrv_buffer_response_multi_s *) bin;
+    uint32_t hdr_size = (uint32_t) (offsetof(struct jsdrv_buffer_response_multi_s, data));
+    uint32_t rsp_hdr_size = (uint32_t) (offsetof(struct jsdrv_buffer_response_s, data));
+    uint64_t size_max = sizeof(struct jsdrv_stream_signal_s) - hdr_size - signal_count * (rsp_hdr_size + 16);
+    uint32_t size = 0;
+    int32_t rc;
+    for (int attempt = 0; ; ++attempt) {
+        struct jsdrv_buffer_request_s req_align = *req;
+        req_align.flags &= ~JSDRV_BUFFER_REQUEST_FLAG_CHUNKED;
+        for (uint32_t k = 0; k < signal_count; ++k) {
+            signal_snapshot(self, signals[k], copies[k]);
+        }
+        rc = jsdrv_bufsig_request_align(copies, signal_count, &req_align, size_max);
+        size = hdr_size;
+        for (uint32_t k = 0; !rc && (k < signal_count); ++k) {
+            struct jsdrv_buffer_request_s req_copy = req_align;
+            struct jsdrv_buffer_response_s * r = (struct jsdrv_buffer_response_s *) (bin + size);
+            rc = jsdrv_bufsig_process_request(copies[k], &req_copy, r);
+            offsets[k] = size;
+            size += (rsp_size(r) + 7) & ~7U;
+        }
+        bool valid = true;
+        for (uint32_t k = 0; !rc && valid && (k < signal_count); ++k) {
+            struct jsdrv_buffer_response_s * r = (struct jsdrv_buffer_response_s *) (bin + offsets[k]);
+            valid = jsdrv_bufsig_snapshot_valid(signals[k], copies[k], r);
+        }
+        if (rc || (attempt >= 2) || valid) {
+            break;
+        }
+        JSDRV_LOGD1("multi request overwritten during processing, retry");
+    }
+    if (rc) {
+        jsdrvp_msg_free(self->context, msg);
         return false;
     }
+    rsp->version = 1;
+    rsp->signal_count = signal_count;
+    rsp->rsv2_u16 = 0;
+    rsp->rsv3_u32 = 0;
+    rsp->rsp_id = req->rsp_id;
+    msg->value.app = JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI;
+    msg->value.size = size;
+    rsp_send(self, msg);
+    return true;
+}
+
+static bool req_handle_stats(struct reader_s * reader, const struct req_s * req) {
+    struct buffer_s * self = reader->parent;
+    struct bufsig_s * signals[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];
+    struct bufsig_s * copies[JSDRV_BUFFER_REQUEST_SIGNALS_MAX];
+    for (uint32_t k = 0; k < req->signal_count; ++k) {
+        signals[k] = signal_storage(self, req->signal_ids[k]);
+        if (!signals[k]->active) {
+            JSDRV_LOGW("stats request signal %u inactive", (unsigned int) req->signal_ids[k]);
+            return false;
+        }
+        copies[k] = &reader->snapshots[k];
+    }
     struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_data(self->context, req->req.rsp_topic);
     struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) msg->value.value.bin;
-    if (jsdrv_bufsig_process_request(b, &req->req, rsp)) {
+    int32_t rc;
+    for (int attempt = 0; ; ++attempt) {
+        for (uint32_t k = 0; k < req->signal_count; ++k) {
+            signal_snapshot(self, signals[k], copies[k]);
+        }
+        rc = jsdrv_bufsig_statistics(copies, req->signal_count, &req->req, rsp);
+        bool valid = true;
+        for (uint32_t k = 0; !rc && valid && (k < req->signal_count); ++k) {
+            valid = jsdrv_bufsig_snapshot_valid(signals[k], copies[k], rsp);
+        }
+        if (rc || (attempt >= 2) || valid) {
+            break;
+        }
+        JSDRV_LOGD1("stats request overwritten during processing, retry");
+    }
+    if (rc) {
         jsdrvp_msg_free(self->context, msg);
-    } else {
+        return false;
+    }
+    msg->value.app = JSDRV_PAYLOAD_TYPE_BUFFER_RSP;
+    msg->value.size = rsp_size(rsp);
+    rsp_send(self, msg);
+    return true;
+}
+
+static bool req_handle_search(struct reader_s * reader, const struct req_s * req) {
+    struct buffer_s * self = reader->parent;
+    struct bufsig_s * b = signal_storage(self, req->signal_id);
+    struct jsdrv_buffer_search_s search;
+    memset(&search, 0, sizeof(search));
+    search.req = req->req;
+    search.op = req->search_op;
+    search.threshold = req->threshold;
+    search.hits_max = req->hits_max;
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_data(self->context, search.req.rsp_topic);
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) msg->value.value.bin;
+    int32_t rc;
+    for (int attempt = 0; ; ++attempt) {
+        signal_snapshot(self, b, &reader->snapshots[0]);
+        rc = jsdrv_bufsig_search(&reader->snapshots[0], &search, rsp);
+        if (rc || (attempt >= 2) || jsdrv_bufsig_snapshot_valid(b, &reader->snapshots[0], rsp)) {
+            break;
+        }
+        JSDRV_LOGD1("search overwritten during processing, retry");
+    }
+    if (rc) {
+        jsdrvp_msg_free(self->context, msg);
+        return false;
+    }
+    msg->value.app = JSDRV_PAYLOAD_TYPE_BUFFER_RSP;
+    msg->value.size = rsp_size(rsp);
+    rsp_send(self, msg);
+    return true;
+}
+
+// Compute the tiles around a tile response, until the next request arrives.
+static void tile_prefetch(struct reader_s * reader, struct bufsig_s * b, const struct jsdrv_time_range_samples_s * r) {
+    struct buffer_s * self = reader->parent;
+    struct jsdrv_time_range_samples_s neighbor;
+    for (uint32_t idx = 0; idx < JSDRV_BUFSIG_TILE_NEIGHBORS; ++idx) {
+        jsdrv_os_mutex_lock(self->req_mutex);
+        bool pending = !jsdrv_list_is_empty(&self->req_pending);
+        jsdrv_os_mutex_unlock(self->req_mutex);
+        if (pending || jsdrv_atomic_load_u32(&self->readers_gate)) {
+            break;  // new requests and reallocation take priority
+        }
+        if (jsdrv_bufsig_tile_neighbor(r, idx, &neighbor)) {
+            jsdrv_bufsig_summary_prefetch(b, &reader->snapshots[0], &neighbor);
+        }
+    }
+}
+
+static bool req_handle_one(struct reader_s * reader) {
+    struct buffer_s * self = reader->parent;
+    jsdrv_os_mutex_lock(self->req_mutex);
+    struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->req_pending);
+    if (NULL != item) {
+        jsdrv_cstr_copy(reader->rsp_topic, JSDRV_CONTAINER_OF(item, struct req_s, item)->req.rsp_topic,
+                        sizeof(reader->rsp_topic));
+        jsdrv_atomic_store_u32(&reader->cancel, 0);
+    }
+    jsdrv_os_mutex_unlock(self->req_mutex);
+    if (NULL == item) {
+        return false;  // request coalesced or cancelled
+    }
+    struct req_s req;
+    req_copy(&req, JSDRV_CONTAINER_OF(item, struct req_s, item));
+    req_release(self, item);
+    struct bufsig_s * b = signal_storage(self, req.signal_id);
+    struct jsdrv_buffer_request_s req_next = req.req;
+    if (req.stats) {
+        return req_handle_stats(reader, &req);
+    } else if (req.signal_count) {
+        return req_handle_multi(reader, &req_next, req.signal_ids, req.signal_count);
+    } else if (!b->active) {
+        return false;
+    } else if (req.search_op) {
+        return req_handle_search(reader, &req);
+    }
+    bool end = false;
+    bool prefetch = false;
+    struct jsdrv_time_range_samples_s tile;
+    while (!end) {  // chunked requests respond with a message sequence
+        if (jsdrv_atomic_load_u32(&reader->cancel)) {
+            JSDRV_LOGD1("cancel %s", req_next.rsp_topic);
+            return true;
+        }
+        struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_data(self->context, req_next.rsp_topic);
+        struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) msg->value.value.bin;
+        struct jsdrv_buffer_request_s req_copy;
+        int32_t rc;
+        for (int attempt = 0; ; ++attempt) {
+            // process against a consistent copy while the buffer thread keeps ingesting
+            req_copy = req_next;
+            signal_snapshot(self, b, &reader->snapshots[0]);
+            rc = jsdrv_bufsig_process_request(&reader->snapshots[0], &req_copy, rsp);
+            if (rc || (attempt >= 2) || jsdrv_bufsig_snapshot_valid(b, &reader->snapshots[0], rsp)) {
+                break;
+            }
+            JSDRV_LOGD1("request overwritten during processing, retry");
+        }
+        if (rc) {
+            jsdrvp_msg_free(self->context, msg);
+            break;
+        }
+        end = 0 != (rsp->flags & JSDRV_BUFFER_RESPONSE_FLAG_END);
+        if ((req.req.flags & JSDRV_BUFFER_REQUEST_FLAG_TILE) && (JSDRV_BUFFER_RESPONSE_SUMMARY == rsp->response_type)) {
+            prefetch = true;
+            tile = rsp->info.time_range_samples;
+        }
+        req_next = req_copy;
         msg->value.app = JSDRV_PAYLOAD_TYPE_BUFFER_RSP;
-        jsdrvp_backend_send(self->context, msg);
-        jsdrv_list_add_tail(&self->req_free, item);
+        msg->value.size = rsp_size(rsp);
+        rsp_send(self, msg);
+    }
+    if (prefetch) {
+        tile_prefetch(reader, b, &tile);
+    }
+    return true;
+}
+
+// Block the readers, including view readers, while the buffer reallocates or resubscribes signals.
+static void readers_gate_set(struct buffer_s * self, uint32_t gate) {
+    volatile uint32_t * views_active = &instance_.views_active[self->idx - 1];
+    jsdrv_atomic_store_u32(&self->readers_gate, gate);
+    jsdrv_atomic_fence();
+    while (jsdrv_atomic_load_u32(&self->readers_active) || jsdrv_atomic_load_u32(views_active)) {
+        jsdrv_thread_sleep_ms(1);
+    }
+}
+
+static void readers_pause(struct buffer_s * self) {
+    readers_gate_set(self, BUFFER_GATE_PAUSED);
+}
+
+static void readers_resume(struct buffer_s * self) {
+    jsdrv_atomic_store_u32(&self->readers_gate, 0);
+}
+
+/*
+ * Wait until the readers may proceed, then count the caller as active.
+ *
+ * Returns false without waiting when the gate is closed, so that a
+ * shared worker never waits on a removed buffer.
+ */
+static bool readers_enter(volatile uint32_t * active, volatile uint32_t * gate) {
+    while (1) {
+        jsdrv_atomic_add_u32(active, 1);
+        uint32_t g = jsdrv_atomic_load_u32(gate);
+        if (!g) {
+            return true;
+        }
+        jsdrv_atomic_add_u32(active, (uint32_t) -1);
+        if (BUFFER_GATE_CLOSED == g) {
+            return false;
+        }
+        jsdrv_thread_sleep_ms(1);
+    }
+}
+
+/*
+ * Hold the source buffer signals for a view request.
+ *
+ * The count lives in the buffer manager rather than the source buffer_s,
+ * which is cleared when the source is removed and added again.
+ * Returns false when the source buffer was removed.
+ */
+static bool view_enter(struct buffer_s * self, uint8_t * source) {
+    *source = self->source;
+    if (*source) {
+        return readers_enter(&instance_.views_active[*source - 1], &instance_.buffers[*source - 1].readers_gate);
     }
     return true;
 }
 
+static void view_exit(uint8_t source) {
+    if (source) {
+        jsdrv_atomic_add_u32(&instance_.views_active[source - 1], (uint32_t) -1);
+    }
+}
+
+// Discard the next pending request, for views whose source buffer was removed.
+static void req_discard_one(struct buffer_s * self) {
+    jsdrv_os_mutex_lock(self->req_mutex);
+    struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->req_pending);
+    if (NULL != item) {
+        jsdrv_list_add_tail(&self->req_free, item);
+    }
+    jsdrv_os_mutex_unlock(self->req_mutex);
+}
+
+/*
+ * Service pending requests on a shared worker for a BUFFER_WORK_REQ item.
+ *
+ * req_post() queues at most BUFFER_READER_COUNT items for each buffer, so
+ * a reader is always free.  After BUFFER_REQ_BATCH requests, the item
+ * goes to the back of work_q so that other buffers get the worker.
+ */
+static void req_work(struct buffer_s * self) {
+    struct reader_s * reader = NULL;
+    jsdrv_os_mutex_lock(self->req_mutex);
+    for (uint32_t idx = 0; idx < BUFFER_READER_COUNT; ++idx) {
+        if (!self->readers[idx].busy) {
+            reader = &self->readers[idx];
+            reader->busy = true;
+            break;
+        }
+    }
+    jsdrv_os_mutex_unlock(self->req_mutex);
+    JSDRV_ASSERT(NULL != reader);
+
+    for (uint32_t count = 0; ; ++count) {
+        jsdrv_os_mutex_lock(self->req_mutex);
+        if (jsdrv_list_is_empty(&self->req_pending)) {
+            reader->busy = false;
+            --self->req_workers;
+            jsdrv_os_mutex_unlock(self->req_mutex);
+            return;
+        } else if (count >= BUFFER_REQ_BATCH) {
+            reader->busy = false;
+            jsdrv_os_mutex_unlock(self->req_mutex);
+            work_push(self, BUFFER_WORK_REQ);
+            return;
+        }
+        jsdrv_os_mutex_unlock(self->req_mutex);
+        uint8_t source = 0;
+        readers_enter(&self->readers_active, &self->readers_gate);  // never closed while req_workers
+        if (view_enter(self, &source)) {
+            req_handle_one(reader);
+            view_exit(source);
+        } else {
+            req_discard_one(self);
+        }
+        jsdrv_atomic_add_u32(&self->readers_active, (uint32_t) -1);
+    }
+}
+
 static void req_list_free(struct jsdrv_list_s * list) {
     while (1) {
         struct jsdrv_list_s * item = jsdrv_list_remove_head(list);
@@ -359,31 +1024,305 @@ static int32_t buffer_recv_complete(struct buffer_s * self, const char * subtopi
     return rc;
 }
 
-static bool handle_cmd_q(struct buffer_s * self) {
-    bool rv = true;
+static int32_t trigger_config(struct buffer_s * self, const struct jsdrv_union_s * value) {
+    const struct jsdrv_buffer_trigger_s * t = (const struct jsdrv_buffer_trigger_s *) value->value.bin;
+    if ((value->type != JSDRV_UNION_BIN) || (value->size < sizeof(*t))
+            || (t->mode > JSDRV_BUFFER_TRIGGER_MODE_AUTO)) {
+        JSDRV_LOGW("invalid buffer trigger");
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (t->mode != JSDRV_BUFFER_TRIGGER_MODE_OFF) {
+        if ((t->op < JSDRV_BUFFER_SEARCH_RISE) || (t->op > JSDRV_BUFFER_SEARCH_CROSS)
+                || (0 == t->window.signal_count) || (t->window.signal_count > JSDRV_BUFFER_REQUEST_SIGNALS_MAX)) {
+            JSDRV_LOGW("invalid buffer trigger op %u or signal count %u",
+                       (unsigned int) t->op, (unsigned int) t->window.signal_count);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        if ((0 == t->signal_id) || (t->signal_id >= JSDRV_BUFSIG_COUNT_MAX)) {
+            return JSDRV_ERROR_NOT_FOUND;
+        }
+        for (uint32_t k = 0; k < t->window.signal_count; ++k) {
+            if ((0 == t->window.signal_ids[k]) || (t->window.signal_ids[k] >= JSDRV_BUFSIG_COUNT_MAX)) {
+                JSDRV_LOGW("invalid buffer trigger signal %u", (unsigned int) t->window.signal_ids[k]);
+                return JSDRV_ERROR_NOT_FOUND;
+            }
+        }
+    }
+    JSDRV_LOGI("buffer set trigger mode %u, signal %u, op %u, threshold %g",
+               (unsigned int) t->mode, (unsigned int) t->signal_id, (unsigned int) t->op, (double) t->threshold);
+    self->trigger = *t;
+    self->trigger_fired = false;
+    jsdrv_trigger_clear(&self->trigger_state, t->op, t->threshold, t->duration);
+    return 0;
+}
+
+// Request the window once every window signal holds the post samples.
+static void trigger_window(struct buffer_s * self) {
+    const struct jsdrv_buffer_trigger_s * t = &self->trigger;
+    uint64_t fire = self->trigger_sample_id;
+    uint64_t pre = t->pre;
+    uint64_t end = fire + t->post;
+    for (uint32_t k = 0; k < t->window.signal_count; ++k) {
+        struct bufsig_s * b = &self->signals[t->window.signal_ids[k]];
+        if (!b->active) {
+            JSDRV_LOGW("trigger window signal %u inactive", (unsigned int) t->window.signal_ids[k]);
+            self->trigger_fired = false;
+            return;
+        } else if (b->sample_id_head <= end) {
+            return;  // wait for more samples
+        }
+    }
+
+    struct req_s req = {.signal_id = 0};
+    req.req = t->window.req;
+    req.req.time_type = JSDRV_TIME_SAMPLES;
+    req.req.flags &= ~JSDRV_BUFFER_REQUEST_FLAG_CHUNKED;
+    req.req.time.samples.start = fire - ((pre < fire) ? pre : fire);
+    req.req.time.samples.end = end;
+    req.req.time.samples.length = 0;
+    req.req.rsp_id = (int64_t) fire;  // unique, so windows do not dedup
+    req.signal_count = t->window.signal_count;
+    memcpy(req.signal_ids, t->window.signal_ids, t->window.signal_count);
+    JSDRV_LOGI("trigger window %" PRIu64 " to %" PRIu64, req.req.time.samples.start, end);
+    req_post(self, &req);
+
+    self->trigger_fired = false;
+    if (t->mode == JSDRV_BUFFER_TRIGGER_MODE_AUTO) {
+        jsdrv_trigger_clear(&self->trigger_state, t->op, t->threshold, t->duration);
+    } else {
+        self->trigger.mode = JSDRV_BUFFER_TRIGGER_MODE_OFF;
+    }
+}
+
+static void trigger_process(struct buffer_s * self, uint32_t signal_id, const struct jsdrv_stream_signal_s * signal) {
+    if (self->trigger.mode == JSDRV_BUFFER_TRIGGER_MODE_OFF) {
+        return;
+    } else if (!self->trigger_fired) {
+        if (signal_id != self->trigger.signal_id) {
+            return;
+        }
+        JSDRV_TRACE_BEGIN("buffer_trigger", self->signals[signal_id].topic, signal->element_count);
+        self->trigger_fired = jsdrv_trigger_process(&self->trigger_state, signal, &self->trigger_sample_id);
+        JSDRV_TRACE_END("buffer_trigger");
+        if (!self->trigger_fired) {
+            return;
+        }
+        uint32_t decimate_factor = signal->decimate_factor ? signal->decimate_factor : 1;
+        self->trigger_sample_id /= decimate_factor;  // the buffer sample_id
+        JSDRV_LOGI("trigger at sample_id %" PRIu64, self->trigger_sample_id);
+    }
+    trigger_window(self);
+}
+
+static void snapshot_free(struct snapshot_s * snapshot) {
+    for (uint32_t k = 0; k < snapshot->count; ++k) {
+        jsdrv_bufsig_free(&snapshot->signals[k]);
+    }
+    jsdrv_free(snapshot);
+}
+
+// Free and unsubscribe all signals, then set the active signals for installation.
+static void signals_replace(struct buffer_s * self, const bool * active) {
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        struct bufsig_s * b = &self->signals[idx];
+        if (b->active || active[idx]) {
+            bufsig_unsub(b);
+            jsdrv_bufsig_clear(b);
+            bufsig_publish_info(b);
+            jsdrv_bufsig_free(b);
+            b->active = active[idx];
+        }
+    }
+}
+
+static void save_path(char * path, size_t path_size, const char * dir, uint32_t signal_idx) {
+    tfp_snprintf(path, path_size, "%s/jsdrv_signal_%03u.bin", dir, (unsigned int) signal_idx);
+}
+
+// Save each allocated signal to a file in dir.
+static int32_t buffer_save(struct buffer_s * self, const char * dir) {
+    char path[JSDRV_BUFSIG_PATH_LENGTH_MAX + 32];
+    int32_t rc = JSDRV_ERROR_UNAVAILABLE;
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        struct bufsig_s * b = &self->signals[idx];
+        if (b->active && b->level0_data) {
+            save_path(path, sizeof(path), dir, idx);
+            rc = jsdrv_bufsig_save(b, path);
+            if (rc) {
+                break;
+            }
+        }
+    }
+    return rc;
+}
+
+// Replace all signals with the signals saved in dir by buffer_save().
+static int32_t buffer_load(struct buffer_s * self, const char * dir) {
+    char path[JSDRV_BUFSIG_PATH_LENGTH_MAX + 32];
+    bool found[JSDRV_BUFSIG_COUNT_MAX];
+    bool any = false;
+    if (self->source) {
+        JSDRV_LOGW("buffer load: not supported for views");
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    memset(found, 0, sizeof(found));
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        save_path(path, sizeof(path), dir, idx);
+        FILE * f = fopen(path, "rb");
+        if (f) {
+            fclose(f);
+            found[idx] = true;
+            any = true;
+        }
+    }
+    if (!any) {
+        JSDRV_LOGW("buffer load: no signals in %s", dir);
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    readers_pause(self);
+    signals_replace(self, found);
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        if (found[idx]) {
+            save_path(path, sizeof(path), dir, idx);
+            if (jsdrv_bufsig_load(&self->signals[idx], path)) {
+                self->signals[idx].active = false;
+            }
+        }
+    }
+    self->duration = 0.0;  // loaded signals do not reallocate
+    self->state = ST_ACTIVE;
+    readers_resume(self);
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        struct bufsig_s * b = &self->signals[idx];
+        if (b->active) {
+            bufsig_publish_info(b);
+            bufsig_publish_levels(b);
+        }
+    }
+    buf_publish_signal_list(self);
+    return 0;
+}
+
+static void cmd_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
+    if (BUFFER_CMD_SNAPSHOT == msg->u32_a) {
+        snapshot_free((struct snapshot_s *) msg->value.value.bin);  // never installed
+    } else if (msg->u32_a) {
+        jsdrvp_msg_free(context, msg->payload.dispatch);  // release reference
+    }
+    jsdrvp_msg_free(context, msg);
+}
+
+/*
+ * Freeze the current samples into another buffer.
+ *
+ * The signals move their memory into a snapshot_s without copying, and
+ * the target buffer installs it.  This buffer keeps its subscriptions
+ * and reallocates each signal on its next data, so ingestion continues
+ * while the target serves requests for the frozen samples.  Fresh
+ * allocations only consume physical memory as the samples arrive.
+ */
+static int32_t buffer_snapshot(struct buffer_s * self, uint32_t target_id) {
+    if (!is_buffer_idx_valid(target_id) || (target_id == self->idx)
+            || (NULL == instance_.buffers[target_id - 1].cmd_q)) {
+        JSDRV_LOGW("snapshot target buffer invalid: %u", (unsigned int) target_id);
+        return JSDRV_ERROR_NOT_FOUND;
+    } else if (self->state != ST_ACTIVE) {
+        JSDRV_LOGW("snapshot but buffer not active");
+        return JSDRV_ERROR_UNAVAILABLE;
+    } else if (self->path[0]) {
+        JSDRV_LOGW("snapshot not supported for file-backed buffers");
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    uint32_t count = 0;
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        if (self->signals[idx].active && self->signals[idx].level0_data) {
+            ++count;
+        }
+    }
+    struct snapshot_s * snapshot = jsdrv_alloc_clr(sizeof(struct snapshot_s) + count * sizeof(struct bufsig_s));
+    snapshot->duration = self->duration;
+    JSDRV_LOGI("snapshot %u signals to buffer %u", (unsigned int) count, (unsigned int) target_id);
+    readers_pause(self);
+    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+        struct bufsig_s * b = &self->signals[idx];
+        if (b->active && b->level0_data) {
+            struct bufsig_s * dst = &snapshot->signals[snapshot->count++];
+            dst->idx = idx;
+            jsdrv_bufsig_move(dst, b);
+        }
+    }
+    readers_resume(self);
+
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(self->context);
+    jsdrv_cstr_copy(m->topic, "", sizeof(m->topic));
+    m->value = jsdrv_union_cbin_r((uint8_t *) snapshot, sizeof(*snapshot));  // reference, not a copy
+    m->u32_a = BUFFER_CMD_SNAPSHOT;
+    cmd_push(&instance_.buffers[target_id - 1], m);
+    return 0;
+}
+
+// Replace all signals with the frozen signals from buffer_snapshot().
+static void snapshot_install(struct buffer_s * self, struct snapshot_s * snapshot) {
+    bool frozen[JSDRV_BUFSIG_COUNT_MAX];
+    if (self->source) {
+        JSDRV_LOGW("snapshot install: not supported for views");
+        snapshot_free(snapshot);
+        return;
+    }
+    memset(frozen, 0, sizeof(frozen));
+    for (uint32_t k = 0; k < snapshot->count; ++k) {
+        frozen[snapshot->signals[k].idx] = true;
+    }
+    readers_pause(self);
+    signals_replace(self, frozen);
+    for (uint32_t k = 0; k < snapshot->count; ++k) {
+        jsdrv_bufsig_move(&self->signals[snapshot->signals[k].idx], &snapshot->signals[k]);
+    }
+    self->duration = snapshot->duration;
+    self->state = ST_ACTIVE;
+    readers_resume(self);
+    for (uint32_t k = 0; k < snapshot->count; ++k) {
+        struct bufsig_s * b = &self->signals[snapshot->signals[k].idx];
+        bufsig_publish_info(b);
+        bufsig_publish_levels(b);
+    }
+    buf_publish_signal_list(self);
+    jsdrv_free(snapshot);
+}
+
+static void handle_cmd(struct buffer_s * self, struct jsdrvp_msg_s * msg) {
     int32_t rc = -1;  // ignored
-    struct jsdrvp_msg_s * msg = msg_queue_pop_immediate(self->cmd_q);
     char idx_str[JSDRV_TOPIC_LENGTH_MAX];
-    // note: ResetEvent handled automatically by msg_queue_pop_immediate
-    if (NULL == msg) {
-        return false;
-    }
 
     const char * s = msg->topic;
     if ((msg->u32_a > 0) && (msg->u32_a < JSDRV_BUFSIG_COUNT_MAX)) {
-        if ((self->state == ST_ACTIVE) || (self->state == ST_AWAIT)) {
+        if (self->source) {
+            // views do not store samples, ignore data queued before g/source
+        } else if ((self->state == ST_ACTIVE) || (self->state == ST_AWAIT)) {
             struct bufsig_s *b = &self->signals[msg->u32_a];
-            struct jsdrv_stream_signal_s * signal = (struct jsdrv_stream_signal_s *) msg->value.value.bin;
+            struct jsdrv_stream_signal_s * signal = (struct jsdrv_stream_signal_s *) msg->payload.dispatch->value.value.bin;
+            JSDRV_TRACE_BEGIN("buffer_ingest", b->topic, signal->element_count);
             jsdrv_bufsig_recv_data(b, signal);
+            JSDRV_TRACE_END("buffer_ingest");
             if (self->state == ST_AWAIT) {
                 if (await_check(self)) {
+                    readers_pause(self);
                     buffer_alloc(self);
+                    readers_resume(self);
                     self->state = ST_ACTIVE;
                 }
+            } else if (b->active && (NULL == b->level0_data)) {
+                readers_pause(self);
+                bufsig_alloc_added(self, b);
+                readers_resume(self);
             } else {
                 bufsig_publish_info(b);
+                trigger_process(self, msg->u32_a, signal);
             }
         }
+    } else if (BUFFER_CMD_SNAPSHOT == msg->u32_a) {
+        snapshot_install(self, (struct snapshot_s *) msg->value.value.bin);
+        msg->u32_a = 0;  // installed
     } else if (msg->u32_a != 0) {
         JSDRV_LOGW("Invalid buffer index: %s", msg->u32_a);
         rc = JSDRV_ERROR_NOT_FOUND;
@@ -402,17 +1341,31 @@ static bool handle_cmd_q(struct buffer_s * self) {
                 JSDRV_LOGW("signal already active: %u", idx);
                 rc = JSDRV_ERROR_BUSY;
             } else {
-                JSDRV_LOGI("signal add %d", (int) msg->u32_a);
-                buffer_free(self);
+                JSDRV_LOGI("signal add %d", (int) idx);
+                readers_pause(self);
+                if (signal_incremental(self)) {
+                    bufsig_free(b);  // allocate on the first data
+                } else {
+                    buffer_free(self);
+                }
                 b->active = true;
+                readers_resume(self);
                 buf_publish_signal_list(self);
                 rc = 0;
             }
         } else if (0 == strcmp(s, "!remove")) {
-            JSDRV_LOGI("signal remove %d", (int) msg->u32_a);
+            JSDRV_LOGI("signal remove %d", (int) idx);
+            readers_pause(self);
             bufsig_unsub(b);
             b->active = false;
-            buffer_free(self);
+            b->r0_cfg = 0;
+            b->rN_cfg = 0;
+            if (signal_incremental(self)) {
+                bufsig_free(b);
+            } else {
+                buffer_free(self);
+            }
+            readers_resume(self);
             buf_publish_signal_list(self);
             rc = 0;
         } else {
@@ -441,13 +1394,50 @@ static bool handle_cmd_q(struct buffer_s * self) {
                 if (msg->value.app != JSDRV_PAYLOAD_TYPE_BUFFER_REQ) {
                     JSDRV_LOGI("buffer request but app field is %d", (int) msg->value.app);
                 }
-                req_post(self, idx, (struct jsdrv_buffer_request_s *) msg->value.value.bin);
+                struct req_s req = {.signal_id = idx};
+                req.req = *((const struct jsdrv_buffer_request_s *) msg->value.value.bin);
+                req_post(self, &req);
                 rc = 0;
+            } else if (0 == strcmp(s, "!search")) {
+                const struct jsdrv_buffer_search_s * search = (const struct jsdrv_buffer_search_s *) msg->value.value.bin;
+                if ((msg->value.type != JSDRV_UNION_BIN) || (msg->value.size < sizeof(*search))) {
+                    JSDRV_LOGW("invalid buffer search");
+                    rc = JSDRV_ERROR_PARAMETER_INVALID;
+                } else {
+                    struct req_s req = {.signal_id = idx};
+                    req.req = search->req;
+                    req.search_op = search->op;
+                    req.threshold = search->threshold;
+                    req.hits_max = search->hits_max;
+                    req_post(self, &req);
+                    rc = 0;
+                }
             } else if (0 == strcmp(s, "topic")) {
                 JSDRV_LOGI("buffer %d set topic %s", idx, msg->value.value.str);
+                readers_pause(self);
                 bufsig_sub(b, msg->value.value.str);
+                readers_resume(self);
+                rc = 0;
+            } else if ((0 == strcmp(s, "r0")) || (0 == strcmp(s, "rN"))) {
+                struct jsdrv_union_s v = msg->value;
+                jsdrv_union_widen(&v);
+                bool is_r0 = ('0' == s[1]);
+                uint32_t r = reduction_cfg(v.value.u32, is_r0 ? 8 : 2);
+                JSDRV_LOGI("buffer %d set %s %u", idx, s, (unsigned int) r);
+                readers_pause(self);
+                if (signal_incremental(self)) {
+                    bufsig_free(b);  // reallocate on the next data
+                } else {
+                    buffer_free(self);
+                }
+                if (is_r0) {
+                    b->r0_cfg = r;
+                } else {
+                    b->rN_cfg = r;
+                }
+                readers_resume(self);
                 rc = 0;
-            } else if (0 == strcmp(s, "info")) {
+            } else if ((0 == strcmp(s, "info")) || (0 == strcmp(s, "levels"))) {
                 // published by us, ignore
             } else {
                 JSDRV_LOGW("ignore %s", msg->topic);
@@ -461,11 +1451,138 @@ static bool handle_cmd_q(struct buffer_s * self) {
             jsdrv_union_widen(&v);
             uint64_t sz = v.value.u64;
             JSDRV_LOGI("buffer set size start: %" PRIu64, sz);
+            readers_pause(self);
             buffer_free(self);
+            readers_resume(self);
             self->size = sz;
             self->state = (0 == self->size) ? ST_IDLE : ST_AWAIT;
             JSDRV_LOGI("buffer set size done %d: %" PRIu64, self->state, sz);
             rc = 0;
+        } else if (0 == strcmp(s, "path")) {
+            const char * path = (msg->value.type == JSDRV_UNION_STR) ? msg->value.value.str : "";
+            JSDRV_LOGI("buffer set path: %s", path);
+            readers_pause(self);
+            buffer_free(self);
+            readers_resume(self);
+            jsdrv_cstr_copy(self->path, path, sizeof(self->path));
+            rc = 0;
+        } else if (0 == strcmp(s, "latency")) {
+            struct jsdrv_union_s v = msg->value;
+            jsdrv_union_widen(&v);
+            JSDRV_LOGI("buffer set latency: %u us", (unsigned int) v.value.u32);
+            readers_pause(self);
+            buffer_free(self);
+            readers_resume(self);
+            self->latency_us = v.value.u32;
+            rc = 0;
+        } else if (0 == strcmp(s, "horizon")) {
+            struct jsdrv_union_s v = msg->value;
+            jsdrv_union_widen(&v);
+            JSDRV_LOGI("buffer set horizon: %u s", (unsigned int) v.value.u32);
+            readers_pause(self);
+            buffer_free(self);
+            readers_resume(self);
+            self->horizon_s = v.value.u32;
+            rc = 0;
+        } else if (0 == strcmp(s, "rebalance")) {
+            bool bool_v = false;
+            jsdrv_union_to_bool(&msg->value, &bool_v);
+            self->rebalance = bool_v ? 1 : 0;
+            JSDRV_LOGI("buffer set rebalance: %u", (unsigned int) self->rebalance);
+            rc = 0;
+        } else if (0 == strcmp(s, "compress")) {
+            struct jsdrv_union_s v = msg->value;
+            jsdrv_union_widen(&v);
+            uint32_t ratio = v.value.u32;
+            if (ratio > JSDRV_BUFSIG_PACK_RATIO_MAX) {
+                ratio = JSDRV_BUFSIG_PACK_RATIO_MAX;
+            }
+            JSDRV_LOGI("buffer set compress: %u", (unsigned int) ratio);
+            readers_pause(self);
+            buffer_free(self);
+            readers_resume(self);
+            self->compress = (uint8_t) ratio;
+            rc = 0;
+        } else if ((0 == strcmp(s, "pages")) || (0 == strcmp(s, "numa"))) {
+            struct jsdrv_union_s v = msg->value;
+            jsdrv_union_widen(&v);
+            JSDRV_LOGI("buffer set %s: %u", s, (unsigned int) v.value.u32);
+            readers_pause(self);
+            buffer_free(self);
+            readers_resume(self);
+            if (s[0] == 'p') {
+                self->page_mode = (v.value.u32 > JSDRV_PAGE_MODE_LARGE) ? JSDRV_PAGE_MODE_LARGE : (uint8_t) v.value.u32;
+            } else {
+                self->numa_node = v.value.u32;
+            }
+            rc = 0;
+        } else if (0 == strcmp(s, "source")) {
+            struct jsdrv_union_s v = msg->value;
+            jsdrv_union_widen(&v);
+            uint32_t source = v.value.u32;
+            if (source && (!is_buffer_idx_valid(source) || (source == self->idx))) {
+                JSDRV_LOGW("buffer set source invalid: %u", (unsigned int) source);
+                rc = JSDRV_ERROR_PARAMETER_INVALID;
+            } else {
+                JSDRV_LOGI("buffer set source: %u", (unsigned int) source);
+                readers_pause(self);
+                if (!source != !self->source) {
+                    // views keep their topics without subscribing to the data
+                    for (uint32_t idx = 1; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
+                        if (self->signals[idx].topic[0]) {
+                            bufsig_data_sub(&self->signals[idx], !source);
+                        }
+                    }
+                }
+                buffer_free(self);
+                self->source = (uint8_t) source;
+                self->state = (0 == self->size) ? ST_IDLE : ST_AWAIT;
+                readers_resume(self);
+                rc = 0;
+            }
+        } else if (0 == strcmp(s, "view")) {
+            struct jsdrv_union_s v = msg->value;
+            jsdrv_union_widen(&v);
+            JSDRV_LOGI("buffer set view: %u ms", (unsigned int) v.value.u32);
+            readers_pause(self);
+            self->view_ms = v.value.u32;
+            readers_resume(self);
+            rc = 0;
+        } else if ((0 == strcmp(s, "!req")) || (0 == strcmp(s, "!stats"))) {
+            const struct jsdrv_buffer_request_multi_s * m = (const struct jsdrv_buffer_request_multi_s *) msg->value.value.bin;
+            rc = 0;
+            if ((msg->value.type != JSDRV_UNION_BIN) || (msg->value.size < sizeof(*m))
+                    || (0 == m->signal_count) || (m->signal_count > JSDRV_BUFFER_REQUEST_SIGNALS_MAX)) {
+                JSDRV_LOGW("invalid multi-signal buffer request");
+                rc = JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            for (uint32_t k = 0; !rc && (k < m->signal_count); ++k) {
+                if ((0 == m->signal_ids[k]) || (m->signal_ids[k] >= JSDRV_BUFSIG_COUNT_MAX)) {
+                    JSDRV_LOGW("invalid multi-signal buffer request signal %u", (unsigned int) m->signal_ids[k]);
+                    rc = JSDRV_ERROR_NOT_FOUND;
+                }
+            }
+            if (!rc) {
+                struct req_s req = {.signal_id = 0};
+                req.req = m->req;
+                req.signal_count = m->signal_count;
+                memcpy(req.signal_ids, m->signal_ids, m->signal_count);
+                req.stats = (0 == strcmp(s, "!stats"));
+                req_post(self, &req);
+            }
+        } else if (0 == strcmp(s, "!cancel")) {
+            const char * rsp_topic = (msg->value.type == JSDRV_UNION_STR) ? msg->value.value.str : "";
+            if (!rsp_topic[0]) {
+                rc = JSDRV_ERROR_PARAMETER_INVALID;
+            } else {
+                jsdrv_os_mutex_lock(self->req_mutex);
+                uint32_t count = req_cancel_locked(self, rsp_topic);
+                jsdrv_os_mutex_unlock(self->req_mutex);
+                JSDRV_LOGI("cancel %u requests for %s", (unsigned int) count, rsp_topic);
+                rc = 0;
+            }
+        } else if (0 == strcmp(s, "trigger")) {
+            rc = trigger_config(self, &msg->value);
         } else if (0 == strcmp(s, "list")) {
             // published by us, ignore
         } else if (0 == strcmp(s, "hold")) {
@@ -474,9 +1591,25 @@ static bool handle_cmd_q(struct buffer_s * self) {
             self->hold = bool_v ? 1 : 0;
             JSDRV_LOGI("hold %s", self->hold ? "on" : "off");
             rc = 0;
+        } else if ((0 == strcmp(s, "!save")) || (0 == strcmp(s, "!load"))) {
+            const char * dir = (msg->value.type == JSDRV_UNION_STR) ? msg->value.value.str : "";
+            JSDRV_LOGI("buffer %s: %s", s, dir);
+            if (!dir[0]) {
+                rc = JSDRV_ERROR_PARAMETER_INVALID;
+            } else if (s[1] == 's') {
+                rc = buffer_save(self, dir);
+            } else {
+                rc = buffer_load(self, dir);
+            }
+        } else if (0 == strcmp(s, "!snapshot")) {
+            struct jsdrv_union_s v = msg->value;
+            jsdrv_union_widen(&v);
+            rc = buffer_snapshot(self, v.value.u32);
         } else if (0 == strcmp(s, "!clear")) {
             JSDRV_LOGI("clear");
+            readers_pause(self);
             buffer_free(self);
+            readers_resume(self);
             rc = 0;
         } else {
             // todo mode circular or single capture
@@ -485,62 +1618,120 @@ static bool handle_cmd_q(struct buffer_s * self) {
         }
     } else if (0 == strcmp(s, JSDRV_MSG_FINALIZE)) {
         self->do_exit = 1;
-        rv = false;
         rc = 0;
     } else {
         JSDRV_LOGW("ignore %s", msg->topic);
         rc = JSDRV_ERROR_PARAMETER_INVALID;
     }
     buffer_recv_complete(self, msg->topic, rc);
-    jsdrvp_msg_free(self->context, msg);
-    return rv;
+    cmd_msg_free(self->context, msg);
 }
 
-static THREAD_RETURN_TYPE buffer_thread(THREAD_ARG_TYPE lpParam) {
-    struct buffer_s * self = (struct buffer_s *) lpParam;
-    JSDRV_LOGI("buffer thread started: %s", self->topic);
-
-#if _WIN32
-    HANDLE handles[1];
-    DWORD handle_count;
-    handles[0] = msg_queue_handle_get(self->cmd_q);
-    handle_count = 1;
-#else
-    struct pollfd fds[1];
-    fds[0].fd = msg_queue_handle_get(self->cmd_q);
-    fds[0].events = POLLIN;
-#endif
-
-    while (!self->do_exit) {
-#if _WIN32
-        WaitForMultipleObjects(handle_count, handles, false, BUFFER_THREAD_WAIT_TIMEOUT_MS);
-#else
-        poll(fds, 1, BUFFER_THREAD_WAIT_TIMEOUT_MS);
-#endif
-        JSDRV_LOGD2("buffer thread tick");
-        do {
-            while (handle_cmd_q(self)) { ;
+/*
+ * Drain the buffer's cmd_q on a shared worker for a BUFFER_WORK_CMD item.
+ *
+ * cmd_scheduled admits one item per buffer, so commands and data for a
+ * buffer remain serial even though any worker may run them.
+ */
+static void cmd_work(struct buffer_s * self) {
+    struct jsdrvp_msg_s * batch[MSG_QUEUE_BATCH_SIZE];
+    if (!self->do_exit && (NULL != self->cmd_q)) {
+        uint32_t count = msg_queue_pop_n(self->cmd_q, batch, MSG_QUEUE_BATCH_SIZE);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (self->do_exit) {
+                cmd_msg_free(self->context, batch[i]);  // _buffer_remove_inner drains the rest
+            } else {
+                handle_cmd(self, batch[i]);
             }
-            req_handle_one(self);
-        } while (!self->do_exit && !jsdrv_list_is_empty(&self->req_pending));
+        }
     }
+    jsdrv_atomic_store_u32(&self->cmd_scheduled, 0);
+    jsdrv_atomic_fence();
+    if (!self->do_exit && msg_queue_depth(self->cmd_q)) {
+        cmd_schedule(self);  // more arrived, or more than one batch
+    }
+}
 
-    // Clear all signals.
+// Clear all signals, leaving the gate closed to views of this buffer.
+static void buffer_teardown(struct buffer_s * self) {
+    readers_gate_set(self, BUFFER_GATE_CLOSED);
     for (uint32_t idx = 0; idx < JSDRV_BUFSIG_COUNT_MAX; ++idx) {
         struct bufsig_s * s = &self->signals[idx];
-        if (s->topic[0]) {
-            bufsig_unsub(s);
-            jsdrv_bufsig_clear(s);
-            jsdrv_bufsig_free(s);
-        }
+        bufsig_unsub(s);
+        jsdrv_bufsig_clear(s);
+        jsdrv_bufsig_free(s);  // including frozen signals without a topic
     }
-
     req_list_free(&self->req_pending);
     req_list_free(&self->req_free);
-    JSDRV_LOGI("buffer thread done: %s", self->topic);
+}
+
+static THREAD_RETURN_TYPE worker_thread(THREAD_ARG_TYPE lpParam) {
+    struct buffer_mgr_s * self = (struct buffer_mgr_s *) lpParam;
+    struct jsdrvp_msg_s * msg;
+    JSDRV_LOGI("buffer worker started");
+    jsdrvp_thread_configure(self->context, JSDRVP_THREAD_BUFFER, "jsdrv_buffer");
+    jsdrvp_msg_cache_attach(self->context);
+    while (1) {
+        if (msg_queue_pop(self->work_q, &msg, MSG_QUEUE_TIMEOUT_FOREVER)) {
+            continue;
+        }
+        bool finalize = (0 == strcmp(JSDRV_MSG_FINALIZE, msg->topic));
+        uint32_t buffer_idx = msg->value.value.u32;
+        uint32_t kind = msg->u32_a;
+        jsdrvp_msg_free(self->context, msg);
+        if (finalize) {
+            break;
+        }
+        struct buffer_s * b = &self->buffers[buffer_idx - 1];
+        if (BUFFER_WORK_CMD == kind) {
+            cmd_work(b);
+        } else if (BUFFER_WORK_REQ == kind) {
+            req_work(b);
+        }
+    }
+    jsdrvp_msg_cache_detach(self->context);
+    JSDRV_LOGI("buffer worker done");
     THREAD_RETURN();
 }
 
+// Start the shared workers, sized to the host, with the first buffer.
+static int32_t workers_start(struct buffer_mgr_s * self) {
+    if (NULL != self->work_q) {
+        return 0;
+    }
+    uint32_t count = jsdrv_thread_cpu_count();
+    count = (count < 2) ? 2 : count;
+    count = (count > BUFFER_POOL_THREADS_MAX) ? BUFFER_POOL_THREADS_MAX : count;
+    self->work_q = msg_queue_init();
+    for (self->worker_count = 0; self->worker_count < count; ++self->worker_count) {
+        if (jsdrv_thread_create(&self->workers[self->worker_count], worker_thread, self, -1)) {
+            JSDRV_LOGE("buffer worker %u thread create failed", (unsigned int) self->worker_count);
+            break;
+        }
+    }
+    JSDRV_LOGI("buffer workers: %u", (unsigned int) self->worker_count);
+    return self->worker_count ? 0 : JSDRV_ERROR_UNSPECIFIED;
+}
+
+static void workers_stop(struct buffer_mgr_s * self) {
+    if (NULL == self->work_q) {
+        return;
+    }
+    for (uint32_t idx = 0; idx < self->worker_count; ++idx) {
+        msg_queue_push(self->work_q, jsdrvp_msg_alloc_value(self->context, JSDRV_MSG_FINALIZE, &jsdrv_union_u8(0)));
+    }
+    for (uint32_t idx = 0; idx < self->worker_count; ++idx) {
+        jsdrv_thread_join(&self->workers[idx], 1000);
+    }
+    self->worker_count = 0;
+    struct jsdrvp_msg_s * m;
+    while (NULL != (m = msg_queue_pop_immediate(self->work_q))) {
+        jsdrvp_msg_free(self->context, m);
+    }
+    msg_queue_finalize(self->work_q);
+    self->work_q = NULL;
+}
+
 static void _send_buffer_list(struct buffer_mgr_s * self) {
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, JSDRV_BUFFER_MGR_MSG_ACTION_LIST, &jsdrv_union_cbin_r(NULL, 0));
     for (uint8_t buffer_idx = 1; buffer_idx <= JSDRV_BUFFER_COUNT_MAX; ++buffer_idx) {
@@ -589,7 +1780,7 @@ static uint8_t _buffer_recv(void * user_data, struct jsdrvp_msg_s * msg) {
         struct jsdrvp_msg_s * m = jsdrvp_msg_clone(b->context, msg);
         jsdrv_cstr_copy(m->topic, msg->topic + 6, sizeof(m->topic));
         m->u32_a = 0;  // signal_id=0 (invalid), for main processing
-        msg_queue_push(b->cmd_q, m);
+        cmd_push(b, m);
     }
     return 0;
 }
@@ -615,9 +1806,7 @@ static uint8_t _buffer_recv_data(void * user_data, struct jsdrvp_msg_s * msg) {
     } else if (NULL == b->parent->cmd_q) {
         // discard
     } else if (0 == b->parent->hold) {
-        struct jsdrvp_msg_s * m = jsdrvp_msg_clone(b->parent->context, msg);
-        m->u32_a = b->idx;  // signal_id=0 (invalid), for main processing
-        msg_queue_push(b->parent->cmd_q, m);
+        cmd_push(b->parent, jsdrvp_msg_dispatch_ref(b->parent->context, msg, b->idx));
     }
     return 0;
 }
@@ -639,6 +1828,9 @@ static uint8_t _buffer_add(void * user_data, struct jsdrvp_msg_s * msg) {
         JSDRV_LOGE("buffer_id %u already exists", buffer_id);
         return send_return_code_to_frontend(self->context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, JSDRV_ERROR_ALREADY_EXISTS, _buffer_add, NULL);
     }
+    if (workers_start(self)) {
+        return send_return_code_to_frontend(self->context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, JSDRV_ERROR_UNSPECIFIED, _buffer_add, NULL);
+    }
     JSDRV_LOGI("buffer_id %u add", buffer_id);
     memset(b, 0, sizeof(*b));
     b->idx = buffer_id;
@@ -647,6 +1839,7 @@ static uint8_t _buffer_add(void * user_data, struct jsdrvp_msg_s * msg) {
     tfp_snprintf(b->topic, sizeof(b->topic), "m/%03u", buffer_id);
     b->context = self->context;
     b->cmd_q = msg_queue_init();
+    b->req_mutex = jsdrv_os_mutex_alloc("buffer_req");
     subscribe(b->context, b->topic, JSDRV_SFLAG_PUB, _buffer_recv, b);
     jsdrv_list_initialize(&b->req_pending);
     jsdrv_list_initialize(&b->req_free);
@@ -657,10 +1850,9 @@ static uint8_t _buffer_add(void * user_data, struct jsdrvp_msg_s * msg) {
         s->active = false;
         s->topic[0] = 0;
     }
-
-    if (jsdrv_thread_create(&b->thread, buffer_thread, b, -1)) {
-        JSDRV_LOGE("buffer_id %u thread create failed", buffer_id);
-        return send_return_code_to_frontend(self->context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, JSDRV_ERROR_UNSPECIFIED, _buffer_add, NULL);
+    for (uint32_t idx = 0; idx < BUFFER_READER_COUNT; ++idx) {
+        b->readers[idx].parent = b;
+        b->readers[idx].index = idx;
     }
 
     _send_buffer_list(self);
@@ -676,10 +1868,38 @@ static void _buffer_remove_inner(struct buffer_mgr_s * self, uint8_t buffer_id)
     JSDRV_LOGI("buffer_id %u remove", buffer_id);
 
     unsubscribe(b->context, b->topic, JSDRV_SFLAG_PUB, _buffer_recv, b);
-    msg_queue_push(b->cmd_q, jsdrvp_msg_alloc_value(self->context, JSDRV_MSG_FINALIZE, &jsdrv_union_u8(0)));
-    jsdrv_thread_join(&b->thread, 1000);
+    cmd_push(b, jsdrvp_msg_alloc_value(self->context, JSDRV_MSG_FINALIZE, &jsdrv_union_u8(0)));
+    while (!b->do_exit || jsdrv_atomic_load_u32(&b->cmd_scheduled)) {
+        jsdrv_thread_sleep_ms(1);
+    }
+
+    // cancel in-flight requests and wait for their workers to finish
+    while (1) {
+        jsdrv_os_mutex_lock(b->req_mutex);
+        uint32_t workers = b->req_workers;
+        struct jsdrv_list_s * item;
+        while (NULL != (item = jsdrv_list_remove_head(&b->req_pending))) {
+            jsdrv_list_add_tail(&b->req_free, item);
+        }
+        for (uint32_t idx = 0; idx < BUFFER_READER_COUNT; ++idx) {
+            jsdrv_atomic_store_u32(&b->readers[idx].cancel, 1);
+        }
+        jsdrv_os_mutex_unlock(b->req_mutex);
+        if (!workers) {
+            break;
+        }
+        jsdrv_thread_sleep_ms(1);
+    }
+
+    struct jsdrvp_msg_s * m;
+    while (NULL != (m = msg_queue_pop_immediate(b->cmd_q))) {
+        cmd_msg_free(self->context, m);
+    }
     msg_queue_finalize(b->cmd_q);
     b->cmd_q = NULL;
+    buffer_teardown(b);
+    jsdrv_os_mutex_free(b->req_mutex);
+    b->req_mutex = NULL;
     _send_buffer_list(self);
 }
 
@@ -718,6 +1938,21 @@ int32_t jsdrv_buffer_initialize(struct jsdrv_context_s * context) {
     return 0;
 }
 
+void jsdrv_buffer_queue_depths(msg_queue_depth_fn fn, void * user_data) {
+    char name[32];
+    for (uint32_t buffer_idx = 1; buffer_idx < JSDRV_BUFFER_COUNT_MAX; ++buffer_idx) {
+        struct buffer_s * b = &instance_.buffers[buffer_idx - 1];
+        if (NULL == b->cmd_q) {
+            continue;
+        }
+        tfp_snprintf(name, sizeof(name), "buffer/%u/cmd_q", (unsigned int) buffer_idx);
+        fn(user_data, name, msg_queue_depth(b->cmd_q));
+    }
+    if (NULL != instance_.work_q) {
+        fn(user_data, "buffer/work_q", msg_queue_depth(instance_.work_q));
+    }
+}
+
 void jsdrv_buffer_finalize(void) {
     struct buffer_mgr_s * self = &instance_;
     if (self->context) {
@@ -730,6 +1965,7 @@ void jsdrv_buffer_finalize(void) {
                 _buffer_remove_inner(self, buffer_idx);
             }
         }
+        workers_stop(self);
         self->context = NULL;
     }
 }
@@ -16,23 +16,133 @@
 
 #include "jsdrv_prv/buffer_signal.h"
 #include "jsdrv_prv/assert.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/downsample.h"
+#include "jsdrv_prv/f32_codec.h"
 #include "jsdrv_prv/frontend.h"
 #include "jsdrv_prv/log.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/page_alloc.h"
+#include "jsdrv_prv/platform.h"
 #include "jsdrv/time.h"
-#include "jsdrv_prv/js220_i128.h"
 #include "jsdrv_prv/statistics.h"
+#include "jsdrv_prv/thread.h"
 #include <inttypes.h>
 #include <math.h>
 #include <float.h>
+#include <stdio.h>
 
 #define DATA_SIZE_MAX (sizeof(struct jsdrv_stream_signal_s) \
                        - sizeof(struct jsdrv_buffer_response_s) \
                        - sizeof(uint64_t) * 8)  // extra space for shift and overrun
 const uint64_t SUMMARY_LENGTH_MAX = DATA_SIZE_MAX / sizeof(struct jsdrv_summary_entry_s);
+#define RESAMPLE_CHUNK (1024U)    // input samples per level 0 read
+#define RESAMPLE_SETTLE (64U)     // output periods of filter startup before a resample request
+#define SEARCH_CHUNK (1024U)      // samples per level 0 read
+#define SEARCH_OP_STATS (0x80U)   // internal search for the range minimum and maximum
+#define BULK_CHUNK_MIN (4096U)    // summary entries per bulk worker thread
+#define BULK_RESTORE_THREADS (4U) // summary threads when restoring a file-backed level 0
+
+#define BUFSIG_FILE_MAGIC       (0x3046554253445A4AULL)  // "JZDSBUF0" little endian
+#define BUFSIG_FILE_VERSION     (1U)
+#define BUFSIG_FILE_HEADER_SIZE (4096U)  // keeps level 0 page aligned
+
+// The level 0 state persisted at the start of the file-backed ring.
+struct bufsig_file_header_s {
+    uint64_t magic;
+    uint32_t version;
+    uint8_t element_type;
+    uint8_t element_size_bits;
+    uint8_t field_id;
+    uint8_t index;
+    uint64_t N;
+    uint32_t sample_rate;
+    uint32_t decimate_factor;
+    uint64_t level0_head;
+    uint64_t level0_size;
+    uint64_t sample_id_head;
+    struct jsdrv_time_map_s time_map;
+};
+JSDRV_STATIC_ASSERT(sizeof(struct bufsig_file_header_s) <= BUFSIG_FILE_HEADER_SIZE, bufsig_file_header_size);
+
+#define BUFSIG_SAVE_MAGIC       (0x3056415353445A4AULL)  // "JZDSSAV0" little endian
+#define BUFSIG_SAVE_VERSION     (1U)
+#define BUFSIG_SAVE_HEADER_SIZE (8192U)  // keeps level 0 page aligned
+#define BUFSIG_SAVE_ALIGN       (64U)
+
+// The signal state at the start of a jsdrv_bufsig_save() file, in the native format.
+struct bufsig_save_header_s {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t level_size;  // sizeof(struct bufsig_level_s)
+    struct bufsig_stream_header_s hdr;
+    struct jsdrv_time_map_s time_map;
+    int64_t size_in_utc;
+    uint64_t N;
+    uint64_t r0;
+    uint64_t rN;
+    uint64_t k;
+    uint64_t level0_N;
+    uint64_t level0_head;
+    uint64_t level0_size;
+    uint64_t sample_id_head;
+    uint64_t level0_horizon;
+    uint64_t level0_bytes;
+    uint64_t level_offset[JSDRV_BUFSIG_LEVELS_MAX];  // file offset for each level's entries, 0 for none
+    struct bufsig_level_s levels[JSDRV_BUFSIG_LEVELS_MAX];  // with data NULL
+    uint8_t level_count;
+};
+JSDRV_STATIC_ASSERT(sizeof(struct bufsig_save_header_s) <= BUFSIG_SAVE_HEADER_SIZE, bufsig_save_header_size);
+
+#define SUMMARY_CACHE_SLOTS (8U)  // the live window, its prefetched tiles, and others
+
+// A previous summary response, reusable for the same window or a later window with the same incr.
+struct summary_cache_slot_s {
+    uint64_t epoch;
+    uint64_t sample_id_head;                    // when computed, later entries were incomplete
+    uint64_t start;
+    uint64_t incr;
+    uint64_t length;
+    uint64_t use;                               // least recently used replacement
+    struct jsdrv_summary_entry_s * entries;     // SUMMARY_LENGTH_MAX, allocated on first use
+};
+
+// Shared by the concurrent readers of one signal.
+struct bufsig_summary_cache_s {
+    jsdrv_os_mutex_t mutex;
+    uint64_t use;
+    struct summary_cache_slot_s slots[SUMMARY_CACHE_SLOTS];
+};
+
+#define PACK_HOT_SAMPLES (65536U)
+#define PACK_HOT_BLOCKS_MIN (8U)
+#define PACK_BLOCK_SIZE_MAX JSDRV_F32_CODEC_SIZE_MAX(JSDRV_BUFSIG_PACK_R0_MAX)
+
+/*
+ * Packed float32 level 0.
+ *
+ * Each completed block of r0 samples is encoded and appended to a byte
+ * ring.  level0_data holds the newest blocks raw, which the ingest
+ * thread fills before encoding and summarizing them.  Readers decode
+ * older blocks from the ring.
+ */
+struct bufsig_pack_s {
+    uint64_t size;              // ring bytes
+    uint64_t head;              // total bytes written, the next block position
+    uint8_t * data;             // size bytes, then PACK_BLOCK_SIZE_MAX for decoding overwritten blocks
+    uint64_t * block_pos;       // for each level 0 block, the ring position in head units
+    uint64_t hot_blocks;        // the raw blocks in level0_data
+};
 
 static uint64_t summary_level0_get_by_idx(struct bufsig_s * self, uint64_t index, uint64_t incr, struct jsdrv_summary_entry_s * y);
+static void summarize(struct bufsig_s * self, uint64_t start_idx, uint64_t length);
+static void summarize_bulk(struct bufsig_s * self, uint64_t start_idx, uint64_t length, uint32_t threads);
+static bool bulk_supported(struct bufsig_s * self);
+static void level0_write(struct bufsig_s * self, const uint8_t * f_src, uint64_t length, bool summary);
 
 static void entry_clear(struct jsdrv_summary_entry_s * y) {
     y->avg = NAN;
@@ -52,6 +162,250 @@ static struct jsdrv_summary_entry_s * level_entry(struct bufsig_s * self, uint8_
     return &lvl->data[idx];
 }
 
+static void snapshot_publish(struct bufsig_s * self) {
+    jsdrv_atomic_add_u32(&self->snapshot_seq, 1);  // odd: update in progress
+    self->snapshot.level0_head = self->level0_head;
+    self->snapshot.level0_size = self->level0_size;
+    self->snapshot.sample_id_head = self->sample_id_head;
+    self->snapshot.time_map = self->time_map;
+    self->snapshot.epoch = self->epoch;
+    jsdrv_atomic_add_u32(&self->snapshot_seq, 1);  // even: consistent
+}
+
+static void snapshot_read(struct bufsig_s * self, struct bufsig_snapshot_s * snapshot) {
+    while (1) {
+        uint32_t seq = jsdrv_atomic_load_u32(&self->snapshot_seq);
+        if (seq & 1) {
+            continue;
+        }
+        *snapshot = self->snapshot;
+        jsdrv_atomic_fence();
+        if (seq == jsdrv_atomic_load_u32(&self->snapshot_seq)) {
+            return;
+        }
+    }
+}
+
+static void summary_accum_reset(struct bufsig_s * self) {
+    for (int i = 0; i < JSDRV_BUFSIG_LEVELS_MAX; ++i) {
+        struct bufsig_level_s * lvl = &self->levels[i];
+        jsdrv_statistics_reset(&lvl->accum);
+        lvl->accum_count = 0;
+        lvl->accum_next = UINT64_MAX;
+    }
+}
+
+static uint64_t level0_tail(struct bufsig_s * self) {
+    return (self->level0_head + self->N - self->level0_size) % self->N;
+}
+
+// The level0_data index for a level 0 index.
+static inline uint64_t level0_phys(struct bufsig_s * self, uint64_t idx) {
+    return idx % self->level0_N;
+}
+
+// The number of newest samples in level0_data.
+static uint64_t level0_stored(struct bufsig_s * self) {
+    return (self->level0_size < self->level0_N) ? self->level0_size : self->level0_N;
+}
+
+static bool level0_file_matches(struct bufsig_s * self) {
+    struct bufsig_file_header_s * h = self->level0_file_hdr;
+    return (h->magic == BUFSIG_FILE_MAGIC)
+        && (h->version == BUFSIG_FILE_VERSION)
+        && (h->element_type == self->hdr.element_type)
+        && (h->element_size_bits == self->hdr.element_size_bits)
+        && (h->N == self->N)
+        && (h->sample_rate == self->hdr.sample_rate)
+        && (h->decimate_factor == self->hdr.decimate_factor)
+        && (h->level0_head < self->N)
+        && (h->level0_size <= self->N);
+}
+
+// Map level 0 to the file, and return true when restoring its samples.
+static bool level0_file_open(struct bufsig_s * self, uint64_t level0_bytes) {
+    void * ptr = NULL;
+    bool existed = false;
+    int32_t rc = jsdrv_file_map_open(self->level0_path, BUFSIG_FILE_HEADER_SIZE + level0_bytes,
+                                     &self->level0_map, &ptr, &existed);
+    if (rc) {
+        JSDRV_LOGW("bufsig %d: could not map %s, use RAM", (int) self->idx, self->level0_path);
+        return false;
+    }
+    self->level0_file_hdr = (struct bufsig_file_header_s *) ptr;
+    self->level0_data = ((uint8_t *) ptr) + BUFSIG_FILE_HEADER_SIZE;
+    struct bufsig_file_header_s * h = self->level0_file_hdr;
+    if (existed && level0_file_matches(self) && h->level0_size) {
+        JSDRV_LOGI("bufsig %d: restore %" PRIu64 " samples from %s",
+                   (int) self->idx, h->level0_size, self->level0_path);
+        self->level0_head = h->level0_head;
+        self->level0_size = h->level0_size;
+        self->sample_id_head = h->sample_id_head;
+        self->time_map = h->time_map;
+        self->level0_restored = true;
+        return true;
+    }
+    memset(h, 0, sizeof(*h));
+    h->magic = BUFSIG_FILE_MAGIC;
+    h->version = BUFSIG_FILE_VERSION;
+    h->element_type = self->hdr.element_type;
+    h->element_size_bits = self->hdr.element_size_bits;
+    h->field_id = self->hdr.field_id;
+    h->index = self->hdr.index;
+    h->N = self->N;
+    h->sample_rate = self->hdr.sample_rate;
+    h->decimate_factor = self->hdr.decimate_factor;
+    return false;
+}
+
+static void level0_file_update(struct bufsig_s * self) {
+    struct bufsig_file_header_s * h = self->level0_file_hdr;
+    if (h) {
+        h->level0_head = self->level0_head;
+        h->level0_size = self->level0_size;
+        h->sample_id_head = self->sample_id_head;
+        h->time_map = self->time_map;
+    }
+}
+
+static void level0_advance(struct bufsig_s * self, uint64_t k) {
+    uint64_t size_max = self->N;
+    self->level0_head = (self->level0_head + k) % self->N;
+    if (self->level0_pack) {
+        size_max -= self->r0 - (self->level0_head % self->r0);  // the head block replaces its previous samples
+    }
+    self->level0_size += k;
+    if (self->level0_size > size_max) {
+        self->level0_size = size_max;
+    }
+}
+
+static int32_t page_numa_node(struct bufsig_s * self) {
+    return self->numa_node ? ((int32_t) self->numa_node - 1) : JSDRV_PAGE_NUMA_NODE_ANY;
+}
+
+static void pack_alloc(struct bufsig_s * self) {
+    struct bufsig_pack_s * p = jsdrv_alloc_clr(sizeof(struct bufsig_pack_s));
+    p->size = (self->N * sizeof(float)) / self->level0_ratio;
+    if (p->size < (4 * PACK_BLOCK_SIZE_MAX)) {
+        p->size = 4 * PACK_BLOCK_SIZE_MAX;
+    }
+    p->data = jsdrv_page_alloc(p->size + PACK_BLOCK_SIZE_MAX, self->page_mode, page_numa_node(self));
+    p->block_pos = jsdrv_alloc_clr((self->N / self->r0) * sizeof(uint64_t));
+    p->hot_blocks = PACK_HOT_SAMPLES / self->r0;
+    if (p->hot_blocks < PACK_HOT_BLOCKS_MIN) {
+        p->hot_blocks = PACK_HOT_BLOCKS_MIN;
+    }
+    self->level0_data = jsdrv_page_alloc(p->hot_blocks * self->r0 * sizeof(float), self->page_mode, page_numa_node(self));
+    self->level0_pack = p;
+}
+
+static void pack_free(struct bufsig_s * self) {
+    struct bufsig_pack_s * p = self->level0_pack;
+    if (p) {
+        jsdrv_page_free(p->data);
+        jsdrv_free(p->block_pos);
+        jsdrv_free(p);
+        self->level0_pack = NULL;
+    }
+}
+
+static float * pack_hot(struct bufsig_s * self, uint64_t idx) {
+    uint64_t block = idx / self->r0;
+    return ((float *) self->level0_data) + (block % self->level0_pack->hot_blocks) * self->r0 + (idx % self->r0);
+}
+
+// Drop the oldest blocks that overlap the ring bytes before end.
+static void pack_evict(struct bufsig_s * self, uint64_t end) {
+    struct bufsig_pack_s * p = self->level0_pack;
+    while (self->level0_size > (self->level0_head % self->r0)) {  // the head block is not packed yet
+        uint64_t tail = level0_tail(self);
+        if ((p->block_pos[tail / self->r0] + p->size) >= end) {
+            break;
+        }
+        self->level0_size -= self->r0 - (tail % self->r0);
+    }
+}
+
+static void pack_block(struct bufsig_s * self, uint64_t block) {
+    struct bufsig_pack_s * p = self->level0_pack;
+    uint8_t buf[PACK_BLOCK_SIZE_MAX];
+    const float * src = ((const float *) self->level0_data) + (block % p->hot_blocks) * self->r0;
+    uint32_t sz = jsdrv_f32_codec_encode(buf, src, (uint32_t) self->r0);
+    uint64_t pos = p->head;
+    uint64_t offset = pos % p->size;
+    if ((offset + sz) > p->size) {
+        pos += p->size - offset;  // keep each block contiguous
+    }
+    pack_evict(self, pos + sz);
+    snapshot_publish(self);  // before overwriting, so readers detect dropped blocks
+    memcpy(p->data + (pos % p->size), buf, sz);
+    p->block_pos[block] = pos;
+    p->head = pos + sz;
+}
+
+// Write k samples, or NaN for NULL src, within the block at idx.
+static void pack_write(struct bufsig_s * self, uint64_t idx, const uint8_t * src, uint64_t k) {
+    float * dst = pack_hot(self, idx);
+    if (src) {
+        memcpy(dst, src, k * sizeof(float));
+    } else {
+        for (uint64_t i = 0; i < k; ++i) {
+            dst[i] = NAN;
+        }
+    }
+    if (0 == ((idx + k) % self->r0)) {
+        pack_block(self, idx / self->r0);
+    }
+}
+
+// Fill skipped samples with NaN, one block at a time to summarize from the raw blocks.
+static void pack_skip(struct bufsig_s * self, uint64_t k) {
+    while (k) {
+        uint64_t head = self->level0_head;
+        uint64_t n = self->r0 - (head % self->r0);
+        if (n > k) {
+            n = k;
+        }
+        pack_write(self, head, NULL, n);
+        level0_advance(self, n);
+        self->sample_id_head += n;
+        k -= n;
+        summarize(self, head, n);
+    }
+}
+
+// Read samples [idx, idx + length) that do not wrap, decoding only the blocks they touch.
+static void pack_read(struct bufsig_s * self, uint64_t idx, uint64_t length, float * dst) {
+    struct bufsig_pack_s * p = self->level0_pack;
+    uint64_t block_count = self->N / self->r0;
+    uint64_t head_block = self->level0_head / self->r0;
+    float block_buf[JSDRV_BUFSIG_PACK_R0_MAX];
+    while (length) {
+        uint64_t block = idx / self->r0;
+        uint64_t offset = idx % self->r0;
+        uint64_t k = self->r0 - offset;
+        if (k > length) {
+            k = length;
+        }
+        if (((head_block + block_count - block) % block_count) < 2) {
+            // the head block and the newest packed block, see jsdrv_bufsig_snapshot_valid()
+            memcpy(dst, pack_hot(self, idx), k * sizeof(float));
+        } else {
+            const uint8_t * src = p->data + (p->block_pos[block] % p->size);
+            if (k == self->r0) {
+                jsdrv_f32_codec_decode(dst, src, (uint32_t) self->r0);
+            } else {
+                jsdrv_f32_codec_decode(block_buf, src, (uint32_t) self->r0);
+                memcpy(dst, block_buf + offset, k * sizeof(float));
+            }
+        }
+        dst += k;
+        idx += k;
+        length -= k;
+    }
+}
+
 void jsdrv_bufsig_alloc(struct bufsig_s * self, uint64_t N, uint64_t r0, uint64_t rN) {
     JSDRV_LOGI("jsdrv_bufsig_alloc %d N=%" PRIu64 ", r0=%" PRIu64", rN=%" PRIu64,
                (int) self->idx, N, r0, rN);
@@ -74,20 +428,42 @@ void jsdrv_bufsig_alloc(struct bufsig_s * self, uint64_t N, uint64_t r0, uint64_
 
     if (JSDRV_DATA_TYPE_FLOAT == self->hdr.element_type) {
         JSDRV_ASSERT(self->hdr.element_size_bits == 32);
-        self->level0_data = jsdrv_alloc(self->N * sizeof(float));
     } else if (JSDRV_DATA_TYPE_UINT == self->hdr.element_type) {
-        if (1 == self->hdr.element_size_bits) {
-            self->level0_data = jsdrv_alloc((self->N * self->hdr.element_size_bits + 7) / 8);
-        } else if (4 == self->hdr.element_size_bits) {
-            self->level0_data = jsdrv_alloc((self->N * self->hdr.element_size_bits + 1) / 2);
-        } else {
-            JSDRV_ASSERT(false);
-        }
+        JSDRV_ASSERT((1 == self->hdr.element_size_bits) || (4 == self->hdr.element_size_bits));
     } else {
         JSDRV_ASSERT(false);
     }
-    self->level0_head = 0;
-    self->level0_size = 0;
+    self->level0_N = N;
+    if (self->level0_horizon && (self->level0_horizon < N) && (self->level0_ratio <= 1)
+            && !self->level0_path[0] && (0 == (N % r0))) {
+        // the smallest whole number of r0 blocks that divides N, so level 0 indices map directly
+        uint64_t blocks = N / r0;
+        uint64_t d = (self->level0_horizon + r0 - 1) / r0;
+        while (blocks % d) {
+            ++d;
+        }
+        self->level0_N = d * r0;
+        JSDRV_LOGI("bufsig %d: level 0 horizon %" PRIu64 " samples", (int) self->idx, self->level0_N);
+    }
+    uint64_t level0_bytes = (self->level0_N * self->hdr.element_size_bits + 7) / 8;
+    bool restore = false;
+    if (self->level0_ratio > 1) {
+        if ((JSDRV_DATA_TYPE_FLOAT == self->hdr.element_type) && !self->level0_path[0]
+                && (r0 <= JSDRV_BUFSIG_PACK_R0_MAX) && (0 == (N % r0))) {
+            pack_alloc(self);
+        } else {
+            JSDRV_LOGW("bufsig %d: packed level 0 not supported, use raw", (int) self->idx);
+        }
+    } else if (self->level0_path[0]) {
+        restore = level0_file_open(self, level0_bytes);
+    }
+    if (NULL == self->level0_data) {
+        self->level0_data = jsdrv_page_alloc(level0_bytes, self->page_mode, page_numa_node(self));
+    }
+    if (!restore) {
+        self->level0_head = 0;
+        self->level0_size = 0;
+    }
 
     uint64_t samples_per_entry = 1;
     for (int i = 0; i < JSDRV_BUFSIG_LEVELS_MAX; ++i) {
@@ -102,22 +478,23 @@ void jsdrv_bufsig_alloc(struct bufsig_s * self, uint64_t N, uint64_t r0, uint64_
         lvl->r = r;
         lvl->samples_per_entry = samples_per_entry;
         JSDRV_LOGD3("alloc lvl=%d %" PRIu64, i + 1, k);
-        lvl->data = jsdrv_alloc(k * sizeof(struct jsdrv_summary_entry_s));
+        lvl->data = jsdrv_page_alloc(k * sizeof(struct jsdrv_summary_entry_s), self->page_mode, page_numa_node(self));
     }
-}
-
-void jsdrv_bufsig_free(struct bufsig_s * self) {
-    for (int i = 0; i < JSDRV_BUFSIG_LEVELS_MAX; ++i) {
-        if (NULL != self->levels[i].data) {
-            jsdrv_free(self->levels[i].data);
-            self->levels[i].data = NULL;
+    summary_accum_reset(self);
+    self->summary_cache = jsdrv_alloc_clr(sizeof(struct bufsig_summary_cache_s));
+    self->summary_cache->mutex = jsdrv_os_mutex_alloc("bufsig_summary_cache");
+    if (restore) {
+        if (bulk_supported(self)) {
+            summarize_bulk(self, level0_tail(self), self->level0_size, BULK_RESTORE_THREADS);
+        } else {
+            summarize(self, level0_tail(self), self->level0_size);
         }
     }
-    if (self->level0_data) {
-        JSDRV_LOGI("jsdrv_bufsig_free %d", (int) self->idx);
-        jsdrv_free(self->level0_data);
-        self->level0_data = NULL;
-    }
+    snapshot_publish(self);
+}
+
+// Reset the stream state after releasing the memory.
+static void reset(struct bufsig_s * self) {
     memset(&self->hdr, 0, sizeof(self->hdr));
     self->N = 0;
     self->level_count = 0;
@@ -125,6 +502,215 @@ void jsdrv_bufsig_free(struct bufsig_s * self) {
     self->time_map.offset_time = 0;
     self->time_map.offset_counter = 0;
     self->time_map.counter_rate = 0.0;
+    snapshot_publish(self);
+}
+
+void jsdrv_bufsig_free(struct bufsig_s * self) {
+    struct bufsig_summary_cache_s * cache = self->summary_cache;
+    if (NULL != cache) {
+        for (uint32_t i = 0; i < SUMMARY_CACHE_SLOTS; ++i) {
+            if (cache->slots[i].entries) {
+                jsdrv_free(cache->slots[i].entries);
+            }
+        }
+        jsdrv_os_mutex_free(cache->mutex);
+        jsdrv_free(cache);
+        self->summary_cache = NULL;
+    }
+    for (int i = 0; i < JSDRV_BUFSIG_LEVELS_MAX; ++i) {
+        if ((NULL != self->levels[i].data) && !self->level0_loaded) {
+            jsdrv_page_free(self->levels[i].data);
+        }
+        self->levels[i].data = NULL;
+    }
+    self->level0_loaded = false;
+    if (self->level0_map) {
+        JSDRV_LOGI("jsdrv_bufsig_free %d: close %s", (int) self->idx, self->level0_path);
+        jsdrv_file_map_close(self->level0_map);
+        self->level0_map = NULL;
+        self->level0_file_hdr = NULL;
+        self->level0_data = NULL;
+        self->level0_restored = false;
+    } else if (self->level0_data) {
+        JSDRV_LOGI("jsdrv_bufsig_free %d", (int) self->idx);
+        jsdrv_page_free(self->level0_data);
+        self->level0_data = NULL;
+    }
+    pack_free(self);
+    reset(self);
+}
+
+void jsdrv_bufsig_move(struct bufsig_s * dst, struct bufsig_s * src) {
+    struct bufsig_s keep = *dst;
+    *dst = *src;
+    dst->idx = keep.idx;
+    dst->active = keep.active;
+    jsdrv_cstr_copy(dst->topic, keep.topic, sizeof(dst->topic));
+    dst->parent = keep.parent;
+    dst->r0_cfg = keep.r0_cfg;
+    dst->rN_cfg = keep.rN_cfg;
+    jsdrv_cstr_copy(dst->level0_path, keep.level0_path, sizeof(dst->level0_path));
+    dst->snapshot_seq = keep.snapshot_seq;
+    snapshot_publish(dst);
+
+    // src no longer owns the memory
+    memset(src->levels, 0, sizeof(src->levels));
+    src->level0_data = NULL;
+    src->level0_map = NULL;
+    src->level0_file_hdr = NULL;
+    src->level0_restored = false;
+    src->level0_loaded = false;
+    src->level0_pack = NULL;
+    src->summary_cache = NULL;
+    src->level0_head = 0;
+    src->level0_size = 0;
+    ++src->epoch;
+    reset(src);
+}
+
+static uint64_t save_align(uint64_t x) {
+    return ((x + BUFSIG_SAVE_ALIGN - 1) / BUFSIG_SAVE_ALIGN) * BUFSIG_SAVE_ALIGN;
+}
+
+static bool save_write(FILE * f, const void * data, uint64_t size) {
+    static const uint8_t zeros[BUFSIG_SAVE_ALIGN] = {0};
+    uint64_t pad = save_align(size) - size;
+    return (fwrite(data, 1, (size_t) size, f) == (size_t) size)
+        && (fwrite(zeros, 1, (size_t) pad, f) == (size_t) pad);
+}
+
+int32_t jsdrv_bufsig_save(struct bufsig_s * self, const char * path) {
+    if (NULL == self->level0_data) {
+        return JSDRV_ERROR_UNAVAILABLE;
+    } else if (self->level0_pack) {
+        JSDRV_LOGW("bufsig %d: save not supported for packed level 0", (int) self->idx);
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    uint8_t * header = jsdrv_alloc_clr(BUFSIG_SAVE_HEADER_SIZE);
+    struct bufsig_save_header_s * h = (struct bufsig_save_header_s *) header;
+    h->magic = BUFSIG_SAVE_MAGIC;
+    h->version = BUFSIG_SAVE_VERSION;
+    h->level_size = sizeof(struct bufsig_level_s);
+    h->hdr = self->hdr;
+    h->time_map = self->time_map;
+    h->size_in_utc = self->size_in_utc;
+    h->N = self->N;
+    h->r0 = self->r0;
+    h->rN = self->rN;
+    h->k = self->k;
+    h->level0_N = self->level0_N;
+    h->level0_head = self->level0_head;
+    h->level0_size = self->level0_size;
+    h->sample_id_head = self->sample_id_head;
+    h->level0_horizon = self->level0_horizon;
+    h->level0_bytes = jsdrv_bufsig_level0_bytes(self);
+    h->level_count = self->level_count;
+    uint64_t offset = BUFSIG_SAVE_HEADER_SIZE + save_align(h->level0_bytes);
+    for (int i = 0; (i < JSDRV_BUFSIG_LEVELS_MAX) && self->levels[i].data; ++i) {
+        h->levels[i] = self->levels[i];
+        h->levels[i].data = NULL;
+        h->level_offset[i] = offset;
+        offset += save_align(self->levels[i].k * sizeof(struct jsdrv_summary_entry_s));
+    }
+
+    int32_t rc = 0;
+    FILE * f = fopen(path, "wb");
+    if (NULL == f) {
+        JSDRV_LOGW("bufsig %d: could not open %s", (int) self->idx, path);
+        rc = JSDRV_ERROR_IO;
+    } else {
+        bool ok = save_write(f, header, BUFSIG_SAVE_HEADER_SIZE)
+            && save_write(f, self->level0_data, h->level0_bytes);
+        for (int i = 0; ok && (i < JSDRV_BUFSIG_LEVELS_MAX) && self->levels[i].data; ++i) {
+            ok = save_write(f, self->levels[i].data, self->levels[i].k * sizeof(struct jsdrv_summary_entry_s));
+        }
+        if (fclose(f) || !ok) {
+            JSDRV_LOGW("bufsig %d: could not write %s", (int) self->idx, path);
+            rc = JSDRV_ERROR_IO;
+        } else {
+            JSDRV_LOGI("bufsig %d: saved %" PRIu64 " bytes to %s", (int) self->idx, offset, path);
+        }
+    }
+    jsdrv_free(header);
+    return rc;
+}
+
+static bool load_header_valid(const struct bufsig_save_header_s * h, uint64_t size) {
+    if ((h->magic != BUFSIG_SAVE_MAGIC) || (h->version != BUFSIG_SAVE_VERSION)
+            || (h->level_size != sizeof(struct bufsig_level_s))
+            || (0 == h->N) || (0 == h->r0) || (0 == h->level0_N) || (h->level0_N > h->N)
+            || (h->level0_head >= h->N) || (h->level0_size > h->N)
+            || (0 == h->hdr.sample_rate) || (0 == h->hdr.decimate_factor)
+            || (h->level_count > JSDRV_BUFSIG_LEVELS_MAX)) {
+        return false;
+    }
+    if (JSDRV_DATA_TYPE_FLOAT == h->hdr.element_type) {
+        if (h->hdr.element_size_bits != 32) {
+            return false;
+        }
+    } else if (JSDRV_DATA_TYPE_UINT == h->hdr.element_type) {
+        if ((h->hdr.element_size_bits != 1) && (h->hdr.element_size_bits != 4)) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    if ((h->level0_bytes != ((h->level0_N * h->hdr.element_size_bits + 7) / 8))
+            || ((BUFSIG_SAVE_HEADER_SIZE + h->level0_bytes) > size)) {
+        return false;
+    }
+    for (int i = 0; (i < JSDRV_BUFSIG_LEVELS_MAX) && h->level_offset[i]; ++i) {
+        uint64_t bytes = h->levels[i].k * sizeof(struct jsdrv_summary_entry_s);
+        if ((0 == h->levels[i].k) || (h->level_offset[i] > size) || (bytes > (size - h->level_offset[i]))
+                || (h->level_offset[i] % BUFSIG_SAVE_ALIGN)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int32_t jsdrv_bufsig_load(struct bufsig_s * self, const char * path) {
+    struct jsdrv_file_map_s * map = NULL;
+    void * ptr = NULL;
+    uint64_t size = 0;
+    int32_t rc = jsdrv_file_map_open_existing(path, &map, &ptr, &size);
+    if (rc) {
+        return rc;
+    }
+    uint8_t * base = (uint8_t *) ptr;
+    const struct bufsig_save_header_s * h = (const struct bufsig_save_header_s *) base;
+    if ((size < BUFSIG_SAVE_HEADER_SIZE) || !load_header_valid(h, size)) {
+        JSDRV_LOGW("bufsig %d: invalid file %s", (int) self->idx, path);
+        jsdrv_file_map_close(map);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    self->hdr = h->hdr;
+    self->time_map = h->time_map;
+    self->size_in_utc = h->size_in_utc;
+    self->N = h->N;
+    self->r0 = h->r0;
+    self->rN = h->rN;
+    self->k = h->k;
+    self->level_count = h->level_count;
+    self->level0_N = h->level0_N;
+    self->level0_head = h->level0_head;
+    self->level0_size = h->level0_size;
+    self->sample_id_head = h->sample_id_head;
+    self->level0_horizon = h->level0_horizon;
+    self->level0_ratio = 0;
+    for (int i = 0; i < JSDRV_BUFSIG_LEVELS_MAX; ++i) {
+        self->levels[i] = h->levels[i];
+        self->levels[i].data = h->level_offset[i] ? (struct jsdrv_summary_entry_s *) (base + h->level_offset[i]) : NULL;
+    }
+    self->level0_data = base + BUFSIG_SAVE_HEADER_SIZE;
+    self->level0_map = map;
+    self->level0_loaded = true;
+    self->summary_cache = jsdrv_alloc_clr(sizeof(struct bufsig_summary_cache_s));
+    self->summary_cache->mutex = jsdrv_os_mutex_alloc("bufsig_summary_cache");
+    ++self->epoch;
+    snapshot_publish(self);
+    JSDRV_LOGI("bufsig %d: loaded %" PRIu64 " samples from %s", (int) self->idx, self->level0_size, path);
+    return 0;
 }
 
 static void samples_to_utc(struct bufsig_s * self,
@@ -185,36 +771,49 @@ bool jsdrv_bufsig_info(struct bufsig_s * self, struct jsdrv_buffer_info_s * info
     return true;
 }
 
-static void summarizeN(struct bufsig_s * self, uint8_t level, uint64_t start_idx, uint64_t length) {
-    struct bufsig_level_s * lvl_dn = &self->levels[level - 1];
-    struct bufsig_level_s * lvl_up = &self->levels[level];
-    if (NULL == lvl_up->data) {
-        return;
-    }
-
-    uint64_t length_orig = length;
-    uint64_t lvl_up_idx = start_idx / lvl_up->samples_per_entry;
-    uint64_t level0_idx = lvl_up_idx * lvl_up->samples_per_entry;
-    uint64_t lvl_dn_idx = level0_idx / lvl_dn->samples_per_entry;
-    length += start_idx - level0_idx;
-    struct jsdrv_summary_entry_s * src;
-    struct jsdrv_summary_entry_s * dst;
-    struct jsdrv_statistics_accum_s s_accum;
+/*
+ * Propagate a new level 1 entry up the summary pyramid.
+ *
+ * Each upper level keeps a running accumulator for its partial entry,
+ * so each lower entry is combined exactly once.  A level only writes
+ * and propagates when its entry completes, which makes the cost
+ * O(1) amortized per level 1 entry, independent of the level count.
+ */
+static void summarizeN(struct bufsig_s * self, uint64_t level1_idx) {
     struct jsdrv_statistics_accum_s s_tmp;
-    while (length >= lvl_up->samples_per_entry) {
-        jsdrv_statistics_reset(&s_accum);
-        for (uint64_t i = 0; i < lvl_up->r; ++i) {
-            src = level_entry(self, level, lvl_dn_idx + i);
-            jsdrv_statistics_from_entry(&s_tmp, src, 1);  // unweighted, all entries equal
-            jsdrv_statistics_combine(&s_accum, &s_accum, &s_tmp);
+    uint64_t idx = level1_idx;
+    for (uint8_t level = 1; level < JSDRV_BUFSIG_LEVELS_MAX; ++level) {
+        struct bufsig_level_s * lvl_dn = &self->levels[level - 1];
+        struct bufsig_level_s * lvl_up = &self->levels[level];
+        if (NULL == lvl_up->data) {
+            return;
+        }
+        if ((idx != lvl_up->accum_next) || (0 == idx)) {
+            // out of sequence or wrapped: restart from the stored lower entries
+            jsdrv_statistics_reset(&lvl_up->accum);
+            lvl_up->accum_count = idx % lvl_up->r;
+            for (uint64_t i = idx - lvl_up->accum_count; i < idx; ++i) {
+                jsdrv_statistics_from_entry(&s_tmp, &lvl_dn->data[i], lvl_dn->samples_per_entry);
+                jsdrv_statistics_combine(&lvl_up->accum, &lvl_up->accum, &s_tmp);
+            }
+        }
+        jsdrv_statistics_from_entry(&s_tmp, &lvl_dn->data[idx], lvl_dn->samples_per_entry);  // weighted, so std is the population std
+        jsdrv_statistics_combine(&lvl_up->accum, &lvl_up->accum, &s_tmp);
+        lvl_up->accum_next = idx + 1;
+        if (++lvl_up->accum_count < lvl_up->r) {
+            return;
+        }
+        idx /= lvl_up->r;
+        bool valid = idx < lvl_up->k;  // false for the partial entry past the end of the level
+        if (valid) {
+            jsdrv_statistics_to_entry(&lvl_up->accum, &lvl_up->data[idx]);
+        }
+        jsdrv_statistics_reset(&lvl_up->accum);
+        lvl_up->accum_count = 0;
+        if (!valid) {
+            return;
         }
-        dst = level_entry(self, level + 1, lvl_up_idx);
-        jsdrv_statistics_to_entry(&s_accum, dst);
-        lvl_up_idx = (lvl_up_idx + 1) % lvl_up->k;
-        lvl_dn_idx = (lvl_dn_idx + lvl_up->r) % lvl_dn->k;
-        length -= lvl_up->samples_per_entry;
     }
-    summarizeN(self, level + 1, start_idx, length_orig);
 }
 
 static void summarize(struct bufsig_s * self, uint64_t start_idx, uint64_t length) {
@@ -222,35 +821,193 @@ static void summarize(struct bufsig_s * self, uint64_t start_idx, uint64_t lengt
     if (NULL == lvl1->data) {
         return;
     }
-    uint64_t length_orig = length;
-    uint64_t level1_idx_init = start_idx / self->r0;
-    uint64_t level1_idx = level1_idx_init;
+    uint64_t level1_idx = start_idx / self->r0;
     uint64_t level0_idx = level1_idx * self->r0;
     length += (start_idx - level0_idx);
     while (length >= self->r0) {
         struct jsdrv_summary_entry_s * y = level_entry(self, 1, level1_idx);
         summary_level0_get_by_idx(self, level0_idx, self->r0, y);
+        summarizeN(self, level1_idx);
         length -= self->r0;
-        level1_idx = (level1_idx + 1) % lvl1->k;
-        level0_idx = (level0_idx + self->r0) % self->N;
+        if (++level1_idx >= lvl1->k) {
+            level1_idx = 0;
+        }
+        level0_idx += self->r0;
+        if (level0_idx >= self->N) {
+            level0_idx -= self->N;
+        }
+    }
+}
+
+// One worker's contiguous summary entries for summarize_bulk().
+struct bulk_job_s {
+    struct bufsig_s * self;
+    uint8_t level;          // the levels index to write, 0 reduces level 0
+    uint64_t start;
+    uint64_t end;
+    jsdrv_thread_t thread;
+};
+
+static void bulk_job_run(struct bulk_job_s * job) {
+    struct bufsig_s * self = job->self;
+    struct bufsig_level_s * lvl_up = &self->levels[job->level];
+    struct jsdrv_statistics_accum_s s_accum;
+    struct jsdrv_statistics_accum_s s_tmp;
+    for (uint64_t j = job->start; j < job->end; ++j) {
+        if (0 == job->level) {
+            summary_level0_get_by_idx(self, j * self->r0, self->r0, &lvl_up->data[j]);
+            continue;
+        }
+        // the same combination order as summarizeN(), so the entries match
+        struct bufsig_level_s * lvl_dn = &self->levels[job->level - 1];
+        jsdrv_statistics_reset(&s_accum);
+        for (uint64_t i = j * lvl_up->r; i < (j + 1) * lvl_up->r; ++i) {
+            jsdrv_statistics_from_entry(&s_tmp, &lvl_dn->data[i], lvl_dn->samples_per_entry);
+            jsdrv_statistics_combine(&s_accum, &s_accum, &s_tmp);
+        }
+        jsdrv_statistics_to_entry(&s_accum, &lvl_up->data[j]);
+    }
+}
+
+static THREAD_RETURN_TYPE bulk_thread(THREAD_ARG_TYPE lpParam) {
+    bulk_job_run((struct bulk_job_s *) lpParam);
+    THREAD_RETURN();
+}
+
+// Compute the entries [start, end) of one level, split across threads.
+static void bulk_level(struct bufsig_s * self, uint8_t level, uint64_t start, uint64_t end, uint32_t threads) {
+    struct bulk_job_s jobs[JSDRV_BUFSIG_BULK_THREADS_MAX];
+    uint64_t count = end - start;
+    uint64_t n = count / BULK_CHUNK_MIN;
+    if (n > threads) {
+        n = threads;
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    uint64_t chunk = (count + n - 1) / n;
+    for (uint64_t i = 0; i < n; ++i) {
+        struct bulk_job_s * job = &jobs[i];
+        job->self = self;
+        job->level = level;
+        job->start = start + i * chunk;
+        job->end = (job->start + chunk < end) ? (job->start + chunk) : end;
+    }
+    uint64_t created = 0;
+    for (uint64_t i = 1; i < n; ++i) {
+        if (jsdrv_thread_create(&jobs[i].thread, bulk_thread, &jobs[i], 0)) {
+            JSDRV_LOGW("bufsig bulk thread create failed");
+            break;
+        }
+        ++created;
+    }
+    bulk_job_run(&jobs[0]);
+    for (uint64_t i = 1 + created; i < n; ++i) {
+        bulk_job_run(&jobs[i]);  // the threads that failed to start
+    }
+    for (uint64_t i = 1; i <= created; ++i) {
+        jsdrv_thread_join(&jobs[i].thread, UINT32_MAX);
+    }
+}
+
+/*
+ * Summarize length level 0 samples from start_idx, like summarize().
+ *
+ * Entries within a level are independent, so this computes each level
+ * in turn with its new entries split across threads.  The levels
+ * restart their accumulators from the stored entries on the next
+ * summarize().  Requires a raw level 0 with level0_N == N and r0
+ * dividing N.
+ */
+static void summarize_bulk(struct bufsig_s * self, uint64_t start_idx, uint64_t length, uint32_t threads) {
+    uint64_t seg[2][2];  // the [start, end) ring index segments of the current level
+    uint32_t seg_count = 1;
+    if (threads > JSDRV_BUFSIG_BULK_THREADS_MAX) {
+        threads = JSDRV_BUFSIG_BULK_THREADS_MAX;
+    }
+    if (NULL == self->levels[0].data) {
+        return;
+    }
+    uint64_t start = start_idx / self->r0;
+    uint64_t count = ((start_idx % self->r0) + length) / self->r0;
+    for (uint8_t level = 0; (level < JSDRV_BUFSIG_LEVELS_MAX) && self->levels[level].data; ++level) {
+        struct bufsig_level_s * lvl = &self->levels[level];
+        if (level) {
+            // the upper entries completed by each lower segment
+            for (uint32_t i = 0; i < seg_count; ++i) {
+                seg[i][0] /= lvl->r;
+                seg[i][1] /= lvl->r;
+                if (seg[i][1] > lvl->k) {
+                    seg[i][1] = lvl->k;
+                }
+            }
+        } else if (count >= lvl->k) {
+            seg[0][0] = 0;
+            seg[0][1] = lvl->k;
+        } else if ((start + count) > lvl->k) {
+            seg[0][0] = start;
+            seg[0][1] = lvl->k;
+            seg[1][0] = 0;
+            seg[1][1] = start + count - lvl->k;
+            seg_count = 2;
+        } else {
+            seg[0][0] = start;
+            seg[0][1] = start + count;
+        }
+        for (uint32_t i = 0; i < seg_count; ++i) {
+            if (seg[i][1] > seg[i][0]) {
+                bulk_level(self, level, seg[i][0], seg[i][1], threads);
+            }
+        }
     }
+    summary_accum_reset(self);
+}
 
-    summarizeN(self, 1, start_idx, length_orig);
+static bool bulk_supported(struct bufsig_s * self) {
+    return (NULL == self->level0_pack) && (self->level0_N == self->N) && (0 == (self->N % self->r0));
 }
 
 static void clear(struct bufsig_s * self, uint64_t sample_id) {
+    summary_accum_reset(self);
     self->level0_head = 0;
     self->level0_size = 0;
     self->sample_id_head = sample_id;
     self->time_map.offset_counter = sample_id;
     self->time_map.offset_time = jsdrv_time_utc();
+    ++self->epoch;
+    snapshot_publish(self);
 }
 
 void jsdrv_bufsig_clear(struct bufsig_s * self) {
     clear(self, 0);
 }
 
+uint64_t jsdrv_bufsig_level0_bytes(struct bufsig_s * self) {
+    struct bufsig_pack_s * p = self->level0_pack;
+    if (p) {
+        return p->size + p->hot_blocks * self->r0 * sizeof(float) + (self->N / self->r0) * sizeof(uint64_t);
+    }
+    return (self->level0_N * self->hdr.element_size_bits + 7) / 8;
+}
+
+// Expand a deadband hold record into its mean value so that sample_id accounting remains exact.
+static void recv_hold(struct bufsig_s * self, const struct jsdrv_stream_signal_s * s) {
+    struct jsdrv_stream_signal_s * x = jsdrv_alloc(sizeof(struct jsdrv_stream_signal_s));
+    uint32_t count;
+    for (uint64_t offset = 0; (count = jsdrv_deadband_expand(s, offset, x)) != 0; offset += count) {
+        jsdrv_bufsig_recv_data(self, x);
+    }
+    jsdrv_free(x);
+}
+
 void jsdrv_bufsig_recv_data(struct bufsig_s * self, struct jsdrv_stream_signal_s * s) {
+    if (self->level0_loaded) {
+        return;  // read only
+    }
+    if (jsdrv_deadband_hold(s)) {
+        recv_hold(self, s);
+        return;
+    }
     self->hdr.sample_id = s->sample_id;
     self->hdr.field_id = s->field_id;
     self->hdr.index = s->index;
@@ -270,6 +1027,13 @@ void jsdrv_bufsig_recv_data(struct bufsig_s * self, struct jsdrv_stream_signal_s
     uint64_t sample_id = s->sample_id / self->hdr.decimate_factor;
     uint64_t sample_id_end = sample_id + length - 1;
     uint64_t sample_id_expect = self->sample_id_head;
+    if (self->level0_restored) {
+        self->level0_restored = false;
+        if (sample_id < sample_id_expect) {
+            JSDRV_LOGI("bufsig_recv_data %s: restored samples are newer, clear", self->topic);
+            self->sample_id_head = 0;
+        }
+    }
     if (self->sample_id_head == 0) {
         JSDRV_LOGI("received initial sample, ignore skips, "
                    "sample_id=%" PRIu64 " | %" PRIu64
@@ -277,53 +1041,51 @@ void jsdrv_bufsig_recv_data(struct bufsig_s * self, struct jsdrv_stream_signal_s
                    s->sample_id, sample_id, s->sample_rate, s->decimate_factor);
         clear(self, sample_id);
     } else if (sample_id_end < sample_id_expect) {
-        JSDRV_LOGI("bufsig_recv_data %s: duplicate rcv=[%" PRIu64 ", %" PRIu64 "] expect=%" PRIu64,
-                   self->topic, sample_id, sample_id_end, sample_id_expect);
+        JSDRV_LOGI_RATE("bufsig_recv_data %s: duplicate rcv=[%" PRIu64 ", %" PRIu64 "] expect=%" PRIu64,
+                        self->topic, sample_id, sample_id_end, sample_id_expect);
         if ((sample_id_expect - sample_id_end) < self->N) {
             clear(self, sample_id);
         }
         return;
     } else if (sample_id < sample_id_expect) {
-        JSDRV_LOGI("bufsig_recv_data %s: overlap rcv=[%" PRIu64 ", %" PRIu64 "] expect=%" PRIu64,
-                   self->topic, sample_id, sample_id_end, sample_id_expect);
+        JSDRV_LOGI_RATE("bufsig_recv_data %s: overlap rcv=[%" PRIu64 ", %" PRIu64 "] expect=%" PRIu64,
+                        self->topic, sample_id, sample_id_end, sample_id_expect);
         return;
     } else if (sample_id > sample_id_expect) {
-        JSDRV_LOGI("bufsig_recv_data %s: skip rcv=[%" PRIu64 ", %" PRIu64 "] expect=%" PRIu64,
-                   self->topic, sample_id, sample_id_end, sample_id_expect);
+        JSDRV_LOGI_RATE("bufsig_recv_data %s: skip rcv=[%" PRIu64 ", %" PRIu64 "] expect=%" PRIu64,
+                        self->topic, sample_id, sample_id_end, sample_id_expect);
         uint64_t k = sample_id - sample_id_expect;
         if (k > self->N) {
             clear(self, sample_id);
+        } else if (self->level0_pack) {
+            pack_skip(self, k);
         } else {
+            uint64_t fill = (k < self->level0_N) ? k : self->level0_N;  // older samples are overwritten
             if (s->element_type == JSDRV_DATA_TYPE_FLOAT) {
                 if (s->element_size_bits == 32) {
                     // fill float32 with NaN
                     uint64_t idx = self->level0_head;
                     float *f32 = (float *) self->level0_data;
-                    for (uint64_t i = 0; i < k; ++i) {
-                        if (idx >= self->N) {
-                            idx = idx % self->N;
-                        }
-                        f32[idx] = NAN;
+                    for (uint64_t i = 0; i < fill; ++i) {
+                        f32[level0_phys(self, idx)] = NAN;
                         ++idx;
                     }
                 } else if (s->element_size_bits == 64) {
                     // fill float64 with NaN
                     uint64_t idx = self->level0_head;
                     double *f64 = (double *) self->level0_data;
-                    for (uint64_t i = 0; i < k; ++i) {
-                        if (idx >= self->N) {
-                            idx = idx % self->N;
-                        }
-                        f64[idx] = NAN;
+                    for (uint64_t i = 0; i < fill; ++i) {
+                        f64[level0_phys(self, idx)] = NAN;
                         ++idx;
                     }
                 }
             } else {
                 // fill integer types with zeros
-                uint64_t size = (k * s->element_size_bits + 7) / 8;
-                uint64_t head = (self->level0_head * self->hdr.element_size_bits) / 8;
-                if ((self->level0_head + size) > self->N) {
-                    uint64_t size1 = (self->N * s->element_size_bits) / 8 - head;
+                uint64_t size = (fill * s->element_size_bits + 7) / 8;
+                uint64_t head = (level0_phys(self, self->level0_head) * self->hdr.element_size_bits) / 8;
+                uint64_t ring_size = (self->level0_N * s->element_size_bits) / 8;
+                if ((head + size) > ring_size) {
+                    uint64_t size1 = ring_size - head;
                     uint64_t size2 = size - size1;
                     memset(&f_dst[head], 0, size1);
                     memset(&f_dst[0], 0, size2);
@@ -332,11 +1094,7 @@ void jsdrv_bufsig_recv_data(struct bufsig_s * self, struct jsdrv_stream_signal_s
                 }
             }
             uint64_t start_idx = self->level0_head;
-            self->level0_size += k;
-            if (self->level0_size > self->N) {
-                self->level0_size = self->N;
-            }
-            self->level0_head = (self->level0_head + k) % self->N;
+            level0_advance(self, k);
             summarize(self, start_idx, k);
         }
     } else {
@@ -350,34 +1108,82 @@ void jsdrv_bufsig_recv_data(struct bufsig_s * self, struct jsdrv_stream_signal_s
 
     // JSDRV_LOGI("bufsig_recv_data: sample_id=%" PRIu64 " length=%" PRIu64, s->sample_id, length);
     self->sample_id_head = sample_id;
+    level0_write(self, f_src, length, true);
+    level0_file_update(self);
+    snapshot_publish(self);
+}
+
+void jsdrv_bufsig_recv_bulk(struct bufsig_s * self, const struct jsdrv_stream_signal_s * s,
+                            const uint8_t * data, uint64_t length, uint32_t threads) {
+    if (self->level0_loaded || (NULL == self->level0_data) || !length) {
+        return;
+    }
+    uint64_t sample_id = s->sample_id / s->decimate_factor;
+    self->level0_restored = false;
+    if ((0 == self->sample_id_head) || (sample_id != self->sample_id_head)) {
+        clear(self, sample_id);  // not contiguous, start over from these samples
+    }
+    self->hdr.sample_id = s->sample_id;
+    self->hdr.field_id = s->field_id;
+    self->hdr.index = s->index;
+    self->hdr.element_type = s->element_type;
+    self->hdr.element_size_bits = s->element_size_bits;
+    self->hdr.element_count = s->element_count;
+    self->hdr.sample_rate = s->sample_rate;
+    self->hdr.decimate_factor = s->decimate_factor;
+    self->time_map.offset_time = s->time_map.offset_time;
+    self->time_map.offset_counter = s->time_map.offset_counter / s->decimate_factor;
+    self->time_map.counter_rate = s->time_map.counter_rate / s->decimate_factor;
+
+    if (!bulk_supported(self)) {
+        level0_write(self, data, length, true);
+    } else {
+        if (length > self->N) {
+            // only the newest samples remain, whole bytes for 1 and 4 bit samples
+            uint64_t skip = (length - self->N) & ~((uint64_t) 7);
+            level0_advance(self, skip);
+            self->sample_id_head += skip;
+            data += (skip * self->hdr.element_size_bits) / 8;
+            length -= skip;
+        }
+        uint64_t head = self->level0_head;
+        level0_write(self, data, length, false);
+        summarize_bulk(self, head, length, threads);
+    }
+    level0_file_update(self);
+    snapshot_publish(self);
+}
+
+/*
+ * Copy length samples to the level 0 head.
+ *
+ * Summarize each copy when summary is true, otherwise the caller must
+ * summarize the samples.
+ */
+static void level0_write(struct bufsig_s * self, const uint8_t * f_src, uint64_t length, bool summary) {
+    uint8_t * f_dst = (uint8_t *) self->level0_data;
     while (length) {
         uint64_t head = self->level0_head;
-        uint64_t k = length;
-        uint64_t head_next = head + length;
-        if (head_next > self->N) {
-            k = self->N - head;
-            head_next = 0;
+        uint64_t k = self->level0_N - level0_phys(self, head);
+        if (self->level0_pack) {
+            k = self->r0 - (head % self->r0);  // summarize each block from the raw blocks
+        }
+        if (k > length) {
+            k = length;
         }
         uint64_t copy_size = (k * self->hdr.element_size_bits + 7) / 8;
-        memcpy(&f_dst[(head * self->hdr.element_size_bits) / 8], f_src, copy_size);
-        self->level0_size += k;
-        if (self->level0_size > self->N) {
-            self->level0_size = self->N;
+        if (self->level0_pack) {
+            pack_write(self, head, f_src, k);
+        } else {
+            memcpy(&f_dst[(level0_phys(self, head) * self->hdr.element_size_bits) / 8], f_src, copy_size);
         }
+        level0_advance(self, k);
         f_src += copy_size;
         length -= k;
-        self->level0_head = head_next;
         self->sample_id_head += k;
-        sample_id += k;
-        summarize(self, head, k);
-    }
-}
-
-static uint64_t level0_tail(struct bufsig_s * self) {
-    if (self->level0_size != self->N) {
-        return 0;
-    } else {
-        return self->level0_head;
+        if (summary) {
+            summarize(self, head, k);
+        }
     }
 }
 
@@ -390,12 +1196,112 @@ static void rsp_empty(struct jsdrv_buffer_response_s * rsp) {
     rsp->info.time_range_utc.length = 0;
 }
 
-static void samples_get(struct bufsig_s * self, struct jsdrv_buffer_response_s * rsp) {
+/*
+ * Copy bit_count bits from a ring of src_bits bits, starting at src_bit,
+ * to dst starting at bit 0.  Extracts shifted 64-bit words directly, so
+ * unaligned 1-bit and 4-bit requests take a single pass.
+ */
+static void ring_bits_copy(const uint8_t * src, uint64_t src_bits, uint64_t src_bit, uint64_t bit_count,
+                           uint8_t * dst) {
+    while (bit_count) {
+        uint64_t n = (bit_count < 64) ? bit_count : 64;
+        uint64_t byte = src_bit >> 3;
+        uint8_t shift = (uint8_t) (src_bit & 7);
+        uint64_t w;
+        if (!shift && ((src_bit + bit_count) <= src_bits)) {
+            memcpy(dst, src + byte, (bit_count + 7) / 8);  // byte aligned without wrap
+            return;
+        } else if ((src_bit + 72) <= src_bits) {
+            memcpy(&w, src + byte, sizeof(w));
+            w >>= shift;
+            if (shift) {
+                w |= ((uint64_t) src[byte + 8]) << (64 - shift);
+            }
+        } else {
+            w = 0;  // near the ring end
+            for (uint64_t i = 0; i < n; ++i) {
+                uint64_t bit = (src_bit + i) % src_bits;
+                w |= ((uint64_t) ((src[bit >> 3] >> (bit & 7)) & 1)) << i;
+            }
+        }
+        if (n < 64) {
+            w &= (1ULL << n) - 1;
+        }
+        memcpy(dst, &w, (n + 7) / 8);
+        dst += 8;
+        src_bit = (src_bit + n) % src_bits;
+        bit_count -= n;
+    }
+}
+
+// Copy 1-bit or 4-bit samples from the ring to one uint8 per sample.
+static void ring_unpack(const uint8_t * src, uint64_t N, uint64_t idx, uint64_t length, uint8_t bits,
+                        uint8_t * dst) {
+    while (length) {
+        uint64_t k = N - idx;
+        if (k > length) {
+            k = length;
+        }
+        length -= k;
+        if (1 == bits) {
+            for (; k && (idx & 7); --k, ++idx) {
+                *dst++ = (src[idx >> 3] >> (idx & 7)) & 1;
+            }
+            for (; k >= 8; k -= 8, idx += 8, dst += 8) {
+                uint8_t b = src[idx >> 3];
+                for (int j = 0; j < 8; ++j) {
+                    dst[j] = (b >> j) & 1;
+                }
+            }
+            for (; k; --k, ++idx) {
+                *dst++ = (src[idx >> 3] >> (idx & 7)) & 1;
+            }
+        } else {
+            for (; k; --k, ++idx) {
+                *dst++ = (src[idx >> 1] >> ((idx & 1) << 2)) & 0x0f;
+            }
+        }
+        idx = 0;
+    }
+}
+
+// Copy stored float32 samples [sample_id, sample_id + length) to dst.
+static void level0_read_f32(struct bufsig_s * self, uint64_t sample_id, uint64_t length, float * dst) {
+    uint64_t idx = (self->level0_head + self->N - (self->sample_id_head - sample_id)) % self->N;
+    if (self->level0_pack) {
+        uint64_t k = self->N - idx;
+        if (k > length) {
+            k = length;
+        }
+        pack_read(self, idx, k, dst);
+        if (length > k) {
+            pack_read(self, 0, length - k, dst + k);
+        }
+        return;
+    }
+    const float * data = (const float *) self->level0_data;
+    idx = level0_phys(self, idx);
+    uint64_t k = self->level0_N - idx;
+    if (k > length) {
+        k = length;
+    }
+    memcpy(dst, data + idx, k * sizeof(float));
+    if (length > k) {
+        memcpy(dst + k, data, (length - k) * sizeof(float));
+    }
+}
+
+static void samples_get(struct bufsig_s * self, struct jsdrv_buffer_response_s * rsp, bool unpack) {
     rsp->response_type = JSDRV_BUFFER_RESPONSE_SAMPLES;
     uint64_t sample_id = rsp->info.time_range_samples.start;
     uint64_t length = rsp->info.time_range_samples.length;
-    uint64_t sample_id_tail = self->sample_id_head - self->level0_size;
-    uint64_t length_max = (DATA_SIZE_MAX * 8) / self->hdr.element_size_bits;
+    uint64_t sample_id_tail = self->sample_id_head - level0_stored(self);
+    uint8_t element_size_bits = self->hdr.element_size_bits;
+    unpack = unpack && (element_size_bits < 8);
+    if (unpack) {
+        rsp->info.element_size_bits = 8;
+    }
+    uint64_t length_max = (DATA_SIZE_MAX * 8) / rsp->info.element_size_bits;
 
     if (self->level0_size == 0) {
         rsp_empty(rsp);
@@ -421,6 +1327,7 @@ static void samples_get(struct bufsig_s * self, struct jsdrv_buffer_response_s *
     if (sample_id_end >= self->sample_id_head) {
         JSDRV_LOGW("sample req too late: %" PRIu64 " -> %" PRIu64, sample_id + length, self->sample_id_head - 1);
         length = self->sample_id_head - sample_id;
+        rsp->info.time_range_samples.length = length;
         rsp->info.time_range_samples.end = self->sample_id_head - 1;
     }
     if (length > length_max) {
@@ -430,50 +1337,99 @@ static void samples_get(struct bufsig_s * self, struct jsdrv_buffer_response_s *
         rsp->info.time_range_samples.end = sample_id + length - 1;
     }
 
-    uint8_t * data_rsp = (uint8_t *) rsp->data;
     uint8_t * data_buf = (uint8_t *) self->level0_data;
-    uint64_t idx = (sample_id - sample_id_tail + level0_tail(self)) % self->N;
-
-    uint8_t shift = 0;
-    if (1 == self->hdr.element_size_bits) {
-        shift = idx & 7;
-    } else if (4 == self->hdr.element_size_bits) {
-        shift = (idx & 1) << 2;
+    uint64_t idx = (self->level0_head + self->N - (self->sample_id_head - sample_id)) % self->N;
+    if (self->level0_pack) {
+        level0_read_f32(self, sample_id, length, (float *) rsp->data);
+    } else if (element_size_bits >= 8) {
+        idx = level0_phys(self, idx);
+        uint64_t k = self->level0_N - idx;
+        if (k > length) {
+            k = length;
+        }
+        uint64_t element_size = element_size_bits / 8;
+        memcpy(rsp->data, &data_buf[idx * element_size], k * element_size);
+        if (length > k) {
+            memcpy((uint8_t *) rsp->data + k * element_size, data_buf, (length - k) * element_size);
+        }
+    } else if (unpack) {
+        ring_unpack(data_buf, self->level0_N, level0_phys(self, idx), length, element_size_bits, (uint8_t *) rsp->data);
+    } else {
+        ring_bits_copy(data_buf, self->level0_N * element_size_bits, level0_phys(self, idx) * element_size_bits,
+                       length * element_size_bits, (uint8_t *) rsp->data);
     }
 
-    while (length) {
-        uint64_t idx_next = idx + length;
-        uint64_t k = length;
-        if (idx_next >= self->N) {
-            k = self->N - idx;
-            idx_next = 0;
-        }
-        uint64_t copy_size = (k * self->hdr.element_size_bits + shift + 7) / 8;
-        memcpy(data_rsp, &data_buf[(idx * self->hdr.element_size_bits) / 8], copy_size);
-        data_rsp += copy_size;
-        length -= k;
-        idx = idx_next;
+    samples_to_utc(self, &rsp->info.time_range_samples, &rsp->info.time_range_utc);
+}
+
+static uint64_t popcount_u64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+}
+
+// Count the 1-bit values in src[index, index + length) without wrapping.
+static void histogram_u1(const uint8_t * src, uint64_t index, uint64_t length, uint64_t * hist) {
+    uint64_t ones = 0;
+    uint64_t k = length;
+    while (k && (index & 7)) {
+        ones += (src[index >> 3] >> (index & 7)) & 1;
+        ++index;
+        --k;
+    }
+    const uint8_t * p = src + (index >> 3);
+    for (; k >= 64; k -= 64, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        ones += popcount_u64(w);
     }
+    for (; k >= 8; k -= 8, ++p) {
+        ones += popcount_u64(*p);
+    }
+    if (k) {
+        ones += popcount_u64(*p & ((1U << k) - 1));
+    }
+    hist[1] += ones;
+    hist[0] += length - ones;
+}
 
-    if (shift) {
-        uint64_t u64_length = (rsp->info.time_range_samples.length * self->hdr.element_size_bits + shift + 63) / 64;
-        uint8_t shift_left = 64 - shift;
-        uint64_t * p = (uint64_t *) rsp->data;
-        uint64_t fwd = p[0];
-        for (uint64_t i = 1; i < u64_length; ++i) {
-            uint64_t z = p[i];
-            p[i - 1] = (fwd >> shift) | (z << shift_left);
-            fwd = z;
+// Count the 4-bit values in src[index, index + length) without wrapping.
+static void histogram_u4(const uint8_t * src, uint64_t index, uint64_t length, uint64_t * hist) {
+    uint32_t h_lo[16];
+    uint32_t h_hi[16];
+    memset(h_lo, 0, sizeof(h_lo));
+    memset(h_hi, 0, sizeof(h_hi));
+    if (length && (index & 1)) {
+        ++hist[src[index >> 1] >> 4];
+        ++index;
+        --length;
+    }
+    // separate low and high nibble counts avoid back-to-back increments of one counter
+    const uint8_t * p = src + (index >> 1);
+    const uint8_t * p_end = p + (length >> 1);
+    while (p < p_end) {
+        uint64_t n = p_end - p;
+        if (n > UINT32_MAX) {
+            n = UINT32_MAX;
+        }
+        for (const uint8_t * end = p + n; p < end; ++p) {
+            ++h_lo[*p & 0x0f];
+            ++h_hi[*p >> 4];
+        }
+        for (int i = 0; i < 16; ++i) {
+            hist[i] += (uint64_t) h_lo[i] + h_hi[i];
+            h_lo[i] = 0;
+            h_hi[i] = 0;
         }
-        p[u64_length - 1] = fwd >> shift;
     }
-
-    samples_to_utc(self, &rsp->info.time_range_samples, &rsp->info.time_range_utc);
+    if (length & 1) {
+        ++hist[*p & 0x0f];
+    }
 }
 
 static uint64_t summary_level0_get_by_idx(struct bufsig_s * self, uint64_t index, uint64_t incr, struct jsdrv_summary_entry_s * y) {
     uint64_t sample_count = 0;
-    const uint32_t Q = 30;
     JSDRV_ASSERT(index < self->N);
     JSDRV_ASSERT(incr <= self->N);
 
@@ -483,85 +1439,136 @@ static uint64_t summary_level0_get_by_idx(struct bufsig_s * self, uint64_t index
     }
 
     if (JSDRV_DATA_TYPE_FLOAT == self->hdr.element_type) {
-        float y_min = FLT_MAX;
-        float y_max = -FLT_MAX;
-
-        js220_i128 x2;
-        x2.u64[0] = 0;
-        x2.u64[1] = 0;
-        float *src_f32 = (float *) self->level0_data;
-        int64_t x1 = 0;
-
-        for (uint64_t k = 0; k < incr; ++k) {
-            if (index >= self->N) {
-                index %= self->N;
-            }
-            float f = src_f32[index++];
-            if (isnan(f)) {
-                continue;
-            }
-            int64_t x_i64 = (int64_t) (f * (1 << Q));
-            x1 += x_i64;
-            x2 = js220_i128_add(x2, js220_i128_square_i64(x_i64));
-            ++sample_count;
-            if (f < y_min) {
-                y_min = f;
+        // Contiguous spans: index to the end, then the wrap, or one block at a time when packed.
+        const float * src_f32 = (const float *) self->level0_data;
+        float block_buf[JSDRV_BUFSIG_PACK_R0_MAX];
+        struct jsdrv_statistics_accum_s s_accum;
+        struct jsdrv_statistics_accum_s s_span;
+        jsdrv_statistics_reset(&s_accum);
+        while (incr) {
+            uint64_t k = self->level0_N - level0_phys(self, index);
+            if (k > incr) {
+                k = incr;
             }
-            if (f > y_max) {
-                y_max = f;
+            const float * src = src_f32 + level0_phys(self, index);
+            if (self->level0_pack) {
+                if (k > self->r0) {
+                    k = self->r0;
+                }
+                pack_read(self, index, k, block_buf);
+                src = block_buf;
             }
+            jsdrv_statistics_compute_f32_skip_nan(&s_span, src, k);
+            jsdrv_statistics_combine(&s_accum, &s_accum, &s_span);
+            incr -= k;
+            index = (index + k) % self->N;
         }
+        sample_count = s_accum.k;
         if (sample_count) {
-            y->avg = (float) (((double) x1) / ((double) sample_count * (double) (1 << Q)));
-            y->std = (float) js220_i128_compute_std(x1, x2, sample_count, Q);
-            y->min = y_min;
-            y->max = y_max;
+            y->avg = (float) s_accum.mean;
+            y->std = (float) sqrt(s_accum.s / (double) sample_count);  // population
+            y->min = (float) s_accum.min;
+            y->max = (float) s_accum.max;
         } else {
             entry_clear(y);
         }
     } else {
-        uint8_t * src_u8 = (uint8_t *) self->level0_data;
-        uint8_t x_u8;
-        uint8_t y_min = (uint8_t) ((1 << self->hdr.element_size_bits) - 1);
-        uint8_t y_max = 0x00;
-        uint64_t x1 = 0;
-        js220_i128 x2;
-        x2.u64[0] = 0;
-        x2.u64[1] = 0;
-        for (uint64_t k = 0; k < incr; ++k) {
-            if (index >= self->N) {
-                index = index % self->N;
+        // Histogram the 1-bit or 4-bit values over at most two contiguous spans.
+        const uint8_t * src_u8 = (const uint8_t *) self->level0_data;
+        uint64_t hist[16];
+        memset(hist, 0, sizeof(hist));
+        uint64_t length = incr;
+        index = level0_phys(self, index);
+        while (length) {
+            uint64_t k = self->level0_N - index;
+            if (k > length) {
+                k = length;
             }
             if (1 == self->hdr.element_size_bits) {
-                x_u8 = (src_u8[index >> 3] >> (index & 7)) & 1;
+                histogram_u1(src_u8, index, k, hist);
             } else if (4 == self->hdr.element_size_bits) {
-                x_u8 = src_u8[index >> 1];
-                if (index & 1) {
-                    x_u8 = (x_u8 >> 4);
-                }
-                x_u8 &= 0x0f;
+                histogram_u4(src_u8, index, k, hist);
             } else {
-                // should never get here, only 1 & 4 bits supported
-                x_u8 = 0;
-            }
-            x1 += x_u8;
-            x2 = js220_i128_add(x2, js220_i128_square_i64(x_u8));
-            if (x_u8 < y_min) {
-                y_min = x_u8;
+                hist[0] += k;  // should never get here, only 1 & 4 bits supported
             }
-            if (x_u8 > y_max) {
-                y_max = x_u8;
+            length -= k;
+            index = 0;
+        }
+        uint64_t x1 = 0;
+        uint64_t x2 = 0;
+        uint8_t y_min = 0xff;
+        uint8_t y_max = 0x00;
+        for (uint8_t v = 0; v < 16; ++v) {
+            if (hist[v]) {
+                x1 += v * hist[v];
+                x2 += (uint64_t) (v * v) * hist[v];
+                if (v < y_min) {
+                    y_min = v;
+                }
+                y_max = v;
             }
-            ++index;
         }
-        y->avg = (float) (((double) x1) / (double) incr);
-        y->std = (float) js220_i128_compute_std(x1, x2, incr, 0);
+        // x1 and x2 are exact integers well within double precision
+        double mean = ((double) x1) / (double) incr;
+        double var = ((double) x2 - (double) x1 * mean) / (double) incr;  // population
+        y->avg = (float) mean;
+        y->std = (float) sqrt((var > 0.0) ? var : 0.0);
         y->min = y_min;
         y->max = y_max;
     }
     return sample_count;
 }
 
+/*
+ * Summarize samples that start before the level 0 horizon.
+ *
+ * Level 0 no longer stores the samples before stored_tail, so weight
+ * each overlapping level 1 entry by its overlapping samples.  Samples
+ * from stored_tail are exact.
+ */
+static uint64_t summary_level1_estimate(struct bufsig_s * self, uint64_t sample_id, uint64_t incr,
+                                        uint64_t stored_tail, struct jsdrv_summary_entry_s * y) {
+    struct jsdrv_statistics_accum_s s_accum;
+    struct jsdrv_statistics_accum_s s_tmp;
+    struct jsdrv_summary_entry_s entry_tmp;
+    jsdrv_statistics_reset(&s_accum);
+    uint64_t sample_id_end = sample_id + incr;
+    uint64_t sample_count = 0;
+    while (sample_id < sample_id_end) {
+        uint64_t idx = (self->level0_head + self->N - (self->sample_id_head - sample_id)) % self->N;
+        uint64_t k = sample_id_end - sample_id;
+        if (sample_id >= stored_tail) {
+            sample_count += summary_level0_get_by_idx(self, idx, k, &entry_tmp);
+        } else {
+            uint64_t k_lvl1 = self->r0 - (idx % self->r0);
+            if (k > k_lvl1) {
+                k = k_lvl1;
+            }
+            if ((sample_id + k) > stored_tail) {
+                k = stored_tail - sample_id;
+            }
+            struct jsdrv_summary_entry_s * e = level_entry(self, 1, idx / self->r0);
+            if ((NULL == e) || (NULL == self->levels[0].data)) {
+                entry_clear(&entry_tmp);
+            } else {
+                entry_tmp = *e;
+                sample_count += k;
+            }
+        }
+        if (!isnan(entry_tmp.avg)) {
+            jsdrv_statistics_from_entry(&s_tmp, &entry_tmp, k);
+            jsdrv_statistics_combine(&s_accum, &s_accum, &s_tmp);
+        }
+        sample_id += k;
+    }
+    if (s_accum.k) {
+        jsdrv_statistics_to_entry(&s_accum, y);
+    } else {
+        entry_clear(y);
+    }
+    return sample_count;
+}
+
 static uint64_t summary_level0_get(struct bufsig_s * self, uint64_t sample_id, uint64_t incr, struct jsdrv_summary_entry_s * y) {
     uint64_t src_idx;
     uint64_t tail = level0_tail(self);
@@ -587,6 +1594,10 @@ static uint64_t summary_level0_get(struct bufsig_s * self, uint64_t sample_id, u
 
     JSDRV_ASSERT(sample_id >= sample_id_tail);
     JSDRV_ASSERT((sample_id + incr) <= self->sample_id_head);
+    uint64_t stored_tail = self->sample_id_head - level0_stored(self);
+    if (sample_id < stored_tail) {
+        return summary_level1_estimate(self, sample_id, incr, stored_tail, y);
+    }
     src_idx = tail + (sample_id - sample_id_tail);
     src_idx = src_idx % self->N;
     return summary_level0_get_by_idx(self, src_idx, incr, y);
@@ -601,35 +1612,9 @@ static void rsp_clear(struct jsdrv_buffer_response_s * rsp) {
     rsp->info.time_range_utc.length = 0;
 }
 
-static void summary_get(struct bufsig_s * self, struct jsdrv_buffer_response_s * rsp) {
-    rsp->response_type = JSDRV_BUFFER_RESPONSE_SUMMARY;
+static void summary_entries(struct bufsig_s * self, uint64_t sample_id_start, uint64_t incr,
+                            uint64_t entries_length, struct jsdrv_summary_entry_s * entries) {
     uint64_t sample_id_tail = self->sample_id_head - self->level0_size;
-    uint64_t sample_id_start = rsp->info.time_range_samples.start;
-    uint64_t sample_id_end = rsp->info.time_range_samples.end;
-    uint64_t entries_length = rsp->info.time_range_samples.length;
-
-    uint64_t range_req = sample_id_end + 1 - sample_id_start;
-    uint64_t incr = range_req / entries_length;
-    entries_length = range_req / incr;
-    rsp->info.time_range_samples.length = entries_length;
-    rsp->info.time_range_samples.end = sample_id_start + incr * entries_length;
-
-    if (self->level0_size == 0) {
-        JSDRV_LOGI("summary request: buffer empty");
-        rsp_clear(rsp);
-        return;
-    } else if (entries_length == 0) {
-        JSDRV_LOGI("summary request: length == 0");
-        rsp_clear(rsp);
-        return;
-    } else if (entries_length > SUMMARY_LENGTH_MAX) {
-        JSDRV_LOGI("summary request: length too long: %" PRIu64 " > %" PRIu64,
-                   entries_length, SUMMARY_LENGTH_MAX);
-        rsp_clear(rsp);
-        return;
-    }
-
-    struct jsdrv_summary_entry_s * entries = (struct jsdrv_summary_entry_s *) rsp->data;
     struct jsdrv_summary_entry_s * src;
     uint64_t sample_id = sample_id_start;
 
@@ -650,6 +1635,7 @@ static void summary_get(struct bufsig_s * self, struct jsdrv_buffer_response_s *
 
     uint64_t remaining = incr;
     uint64_t idx;
+    uint64_t lvl_idx = 0;
     uint64_t valid_count = 0;
 
     for (uint64_t entry_idx = 0; entry_idx < entries_length; ++entry_idx) {
@@ -720,7 +1706,9 @@ static void summary_get(struct bufsig_s * self, struct jsdrv_buffer_response_s *
 
         uint64_t lvl_k = self->levels[level - 1].k;
         uint64_t lvl_step = self->levels[level - 1].samples_per_entry;
-        uint64_t lvl_idx = idx / lvl_step;
+        if (1 == valid_count) {
+            lvl_idx = idx / lvl_step;
+        }  // else continue after the entry shared with the previous entry
         while (remaining >= lvl_step) {
             src = level_entry(self, level, lvl_idx);
             jsdrv_statistics_from_entry(&s_tmp, src, lvl_step);
@@ -761,9 +1749,11 @@ static void summary_get(struct bufsig_s * self, struct jsdrv_buffer_response_s *
             src = level_entry(self, level, lvl_idx);
 
             // complete this entry
-            jsdrv_statistics_from_entry(&s_tmp, src, lvl_step);
-            jsdrv_statistics_adjust_k(&s_tmp, remaining);
-            jsdrv_statistics_combine(&s_accum, &s_accum, &s_tmp);
+            if (remaining) {
+                jsdrv_statistics_from_entry(&s_tmp, src, lvl_step);
+                jsdrv_statistics_adjust_k(&s_tmp, remaining);
+                jsdrv_statistics_combine(&s_accum, &s_accum, &s_tmp);
+            }
             jsdrv_statistics_to_entry(&s_accum, dst);
 
             // and start the next entry
@@ -772,19 +1762,423 @@ static void summary_get(struct bufsig_s * self, struct jsdrv_buffer_response_s *
             jsdrv_statistics_copy(&s_accum, &s_tmp);
             JSDRV_ASSERT(incr >= s_tmp.k);
             remaining = incr - s_tmp.k;
+            lvl_idx = (lvl_idx + 1) % lvl_k;
+        }
+    }
+
+}
+
+/*
+ * Copy the leading entries of a request from a cached response.
+ *
+ * UIs request the same window, or the same window advanced by whole
+ * entries, every frame.  Cached entries that were complete when computed
+ * still hold, so only the entries past the cached sample_id_head need
+ * computing.  Returns the number of entries copied.
+ */
+static uint64_t summary_cache_get(struct bufsig_s * self, uint64_t start, uint64_t incr, uint64_t length,
+                                  struct jsdrv_summary_entry_s * entries) {
+    struct bufsig_summary_cache_s * cache = self->summary_cache;
+    uint64_t tail = self->sample_id_head - self->level0_size;
+    if ((NULL == cache) || (start < (tail + incr))) {  // entries near the tail may be overwritten
+        return 0;
+    }
+    struct summary_cache_slot_s * best = NULL;
+    uint64_t best_shift = 0;
+    uint64_t reused = 0;
+    jsdrv_os_mutex_lock(cache->mutex);
+    for (uint32_t i = 0; i < SUMMARY_CACHE_SLOTS; ++i) {
+        struct summary_cache_slot_s * slot = &cache->slots[i];
+        if (!slot->length || (slot->epoch != self->epoch) || (slot->incr != incr)
+                || (start < slot->start) || ((start - slot->start) % incr)) {
+            continue;
+        }
+        uint64_t shift = (start - slot->start) / incr;
+        uint64_t complete = (slot->sample_id_head > slot->start) ? ((slot->sample_id_head - slot->start) / incr) : 0;
+        if (complete > slot->length) {
+            complete = slot->length;
+        }
+        if (complete <= shift) {
+            continue;
         }
+        uint64_t n = complete - shift;
+        if (n > length) {
+            n = length;
+        }
+        if (n > reused) {
+            best = slot;
+            best_shift = shift;
+            reused = n;
+        }
+    }
+    if (best) {
+        memcpy(entries, best->entries + best_shift, reused * sizeof(struct jsdrv_summary_entry_s));
+        best->use = ++cache->use;
+    }
+    jsdrv_os_mutex_unlock(cache->mutex);
+    return reused;
+}
+
+// True when the cache holds the window with every entry that is complete now.
+static bool summary_cache_has(struct bufsig_s * self, uint64_t start, uint64_t incr, uint64_t length) {
+    struct bufsig_summary_cache_s * cache = self->summary_cache;
+    bool rv = false;
+    uint64_t end = start + incr * length;
+    if (end > self->sample_id_head) {
+        end = self->sample_id_head;
+    }
+    jsdrv_os_mutex_lock(cache->mutex);
+    for (uint32_t i = 0; i < SUMMARY_CACHE_SLOTS; ++i) {
+        struct summary_cache_slot_s * slot = &cache->slots[i];
+        if (slot->length && (slot->epoch == self->epoch) && (slot->start == start) && (slot->incr == incr)
+                && (slot->length == length) && (slot->sample_id_head >= end)) {
+            rv = true;
+            break;
+        }
+    }
+    jsdrv_os_mutex_unlock(cache->mutex);
+    return rv;
+}
+
+/*
+ * Store a summary response.
+ *
+ * A live window replaces the previous frame of the same window.  Tiles
+ * share the increment and length with their neighbors, so they only
+ * replace the same tile or the least recently used slot.
+ */
+static void summary_cache_put(struct bufsig_s * self, uint64_t start, uint64_t incr, uint64_t length,
+                              const struct jsdrv_summary_entry_s * entries, bool tile) {
+    struct bufsig_summary_cache_s * cache = self->summary_cache;
+    if (NULL == cache) {
+        return;
+    }
+    jsdrv_os_mutex_lock(cache->mutex);
+    struct summary_cache_slot_s * slot = &cache->slots[0];
+    for (uint32_t i = 0; i < SUMMARY_CACHE_SLOTS; ++i) {
+        struct summary_cache_slot_s * s = &cache->slots[i];
+        if ((s->incr == incr) && (s->length == length) && (!tile || (s->start == start))) {
+            slot = s;  // replace the previous frame of this window
+            break;
+        } else if (s->use < slot->use) {
+            slot = s;
+        }
+    }
+    if (NULL == slot->entries) {
+        slot->entries = jsdrv_alloc(SUMMARY_LENGTH_MAX * sizeof(struct jsdrv_summary_entry_s));
+    }
+    memcpy(slot->entries, entries, length * sizeof(struct jsdrv_summary_entry_s));
+    slot->epoch = self->epoch;
+    slot->sample_id_head = self->sample_id_head;
+    slot->start = start;
+    slot->incr = incr;
+    slot->length = length;
+    slot->use = ++cache->use;
+    jsdrv_os_mutex_unlock(cache->mutex);
+}
+
+static void summary_get(struct bufsig_s * self, struct jsdrv_buffer_response_s * rsp, bool tile) {
+    rsp->response_type = JSDRV_BUFFER_RESPONSE_SUMMARY;
+    uint64_t sample_id_start = rsp->info.time_range_samples.start;
+    uint64_t sample_id_end = rsp->info.time_range_samples.end;
+    uint64_t entries_length = rsp->info.time_range_samples.length;
+
+    uint64_t range_req = sample_id_end + 1 - sample_id_start;
+    uint64_t incr = range_req / entries_length;
+    entries_length = range_req / incr;
+    rsp->info.time_range_samples.length = entries_length;
+    rsp->info.time_range_samples.end = sample_id_start + incr * entries_length;
+
+    if (self->level0_size == 0) {
+        JSDRV_LOGI("summary request: buffer empty");
+        rsp_clear(rsp);
+        return;
+    } else if (entries_length == 0) {
+        JSDRV_LOGI("summary request: length == 0");
+        rsp_clear(rsp);
+        return;
+    } else if (entries_length > SUMMARY_LENGTH_MAX) {
+        JSDRV_LOGI("summary request: length too long: %" PRIu64 " > %" PRIu64,
+                   entries_length, SUMMARY_LENGTH_MAX);
+        rsp_clear(rsp);
+        return;
     }
 
+    struct jsdrv_summary_entry_s * entries = (struct jsdrv_summary_entry_s *) rsp->data;
+    uint64_t reused = 0;
+    while (reused < entries_length) {  // a pan spans adjacent tiles
+        uint64_t n = summary_cache_get(self, sample_id_start + reused * incr, incr,
+                                       entries_length - reused, entries + reused);
+        if (0 == n) {
+            break;
+        }
+        reused += n;
+    }
+    summary_entries(self, sample_id_start + reused * incr, incr, entries_length - reused, entries + reused);
+    summary_cache_put(self, sample_id_start, incr, entries_length, entries, tile);
     samples_to_utc(self, &rsp->info.time_range_samples, &rsp->info.time_range_utc);
 }
 
+// Snap a summary window to a power-of-two increment and a start aligned to the increment.
+static void tile_snap(struct jsdrv_time_range_samples_s * r) {
+    uint64_t interval = r->end + 1 - r->start;
+    uint64_t incr = 1;
+    while ((incr * r->length) < interval) {
+        incr <<= 1;
+    }
+    uint64_t start = r->start - (r->start % incr);
+    r->length = (r->end + incr - start) / incr;
+    r->start = start;
+    r->end = start + r->length * incr - 1;
+}
+
+bool jsdrv_bufsig_tile_neighbor(const struct jsdrv_time_range_samples_s * r, uint32_t idx,
+                                struct jsdrv_time_range_samples_s * neighbor) {
+    if (0 == r->length) {
+        return false;
+    }
+    uint64_t incr = (r->end + 1 - r->start) / r->length;
+    uint64_t span = incr * r->length;
+    uint64_t center = r->start + span / 2;
+    uint64_t start;
+    switch (idx) {
+        case 0:  // next
+            start = r->start + span;
+            break;
+        case 1:  // previous
+            if (r->start < span) {
+                return false;
+            }
+            start = r->start - span;
+            break;
+        case 2:  // parent, zoom out
+            incr *= 2;
+            start = (center > span) ? (center - span) : 0;
+            break;
+        case 3:  // child, zoom in
+            if (incr < 4) {
+                return false;  // a smaller increment is a sample request
+            }
+            incr /= 2;
+            start = center - span / 4;
+            break;
+        default:
+            return false;
+    }
+    neighbor->start = start - (start % incr);
+    neighbor->length = r->length;
+    neighbor->end = neighbor->start + incr * r->length - 1;
+    return true;
+}
+
+void jsdrv_bufsig_summary_prefetch(struct bufsig_s * self, struct bufsig_s * copy,
+                                   const struct jsdrv_time_range_samples_s * r) {
+    jsdrv_bufsig_snapshot(self, copy);
+    if ((NULL == copy->summary_cache) || (0 == copy->level0_size) || (0 == r->length)
+            || (r->length > SUMMARY_LENGTH_MAX)) {
+        return;
+    }
+    uint64_t incr = (r->end + 1 - r->start) / r->length;
+    uint64_t tail = copy->sample_id_head - copy->level0_size;
+    if ((r->start < (tail + incr)) || ((r->start + incr) > copy->sample_id_head)) {
+        return;  // summary_cache_get() will not use any entry
+    }
+    if (summary_cache_has(copy, r->start, incr, r->length)) {
+        return;
+    }
+    struct jsdrv_summary_entry_s * entries = jsdrv_alloc(r->length * sizeof(struct jsdrv_summary_entry_s));
+    summary_entries(copy, r->start, incr, r->length, entries);
+    struct jsdrv_buffer_response_s rsp;
+    rsp.response_type = JSDRV_BUFFER_RESPONSE_SUMMARY;
+    rsp.info.time_range_samples = *r;
+    if (jsdrv_bufsig_snapshot_valid(self, copy, &rsp)) {
+        summary_cache_put(copy, r->start, incr, r->length, entries, true);
+    }
+    jsdrv_free(entries);
+}
+
+/*
+ * Filter and decimate float32 samples to rate_out.
+ *
+ * The filter starts RESAMPLE_SETTLE output periods before the requested
+ * range, when stored, and the response omits those outputs.  The
+ * outputs fall on the downsampler's sample_id grid, so a chunked
+ * request continues seamlessly from the sample after the response end.
+ */
+static int32_t resample_get(struct bufsig_s * self, struct jsdrv_buffer_response_s * rsp, uint32_t rate_out) {
+    rsp->response_type = JSDRV_BUFFER_RESPONSE_RESAMPLED;
+    if ((JSDRV_DATA_TYPE_FLOAT != self->hdr.element_type) || (32 != self->hdr.element_size_bits)) {
+        JSDRV_LOGW("resample request: float32 only");
+        rsp_clear(rsp);
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    struct jsdrv_time_range_samples_s * r = &rsp->info.time_range_samples;
+    uint64_t start = r->start;
+    uint64_t end = r->end;  // inclusive
+    uint64_t tail = self->sample_id_head - level0_stored(self);
+    if ((0 == self->level0_size) || (start >= self->sample_id_head) || (end < tail)) {
+        rsp_clear(rsp);
+        return 0;
+    }
+    if (end >= self->sample_id_head) {
+        end = self->sample_id_head - 1;
+    }
+    uint32_t rate_in = self->hdr.sample_rate / self->hdr.decimate_factor;
+    struct jsdrv_downsample_s * ds = jsdrv_downsample_alloc(rate_in, rate_out, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32);
+    if (NULL == ds) {
+        JSDRV_LOGW("resample request: unsupported rate %u -> %u", (unsigned int) rate_in, (unsigned int) rate_out);
+        rsp_clear(rsp);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+
+    float x[RESAMPLE_CHUNK];
+    float * y = (float *) rsp->data;
+    uint64_t settle = RESAMPLE_SETTLE * (((uint64_t) rate_in + rate_out - 1) / rate_out);
+    uint64_t sample_id = (start > (tail + settle)) ? (start - settle) : tail;
+    uint64_t length_max = DATA_SIZE_MAX / sizeof(float);
+    uint64_t length = 0;
+    while ((sample_id <= end) && (length < length_max)) {
+        uint64_t k = end + 1 - sample_id;
+        if (k > RESAMPLE_CHUNK) {
+            k = RESAMPLE_CHUNK;
+        }
+        level0_read_f32(self, sample_id, k, x);
+        for (uint64_t i = 0; (i < k) && (length < length_max); ++i) {
+            float v;
+            if (jsdrv_downsample_add_f32(ds, sample_id + i, x[i], &v) && ((sample_id + i) >= start)) {
+                if (0 == length) {
+                    r->start = sample_id + i;
+                }
+                r->end = sample_id + i;
+                y[length++] = v;
+            }
+        }
+        sample_id += k;
+    }
+    jsdrv_downsample_free(ds);
+    if (0 == length) {
+        rsp_clear(rsp);
+        return 0;
+    }
+    r->length = length;
+    samples_to_utc(self, r, &rsp->info.time_range_utc);
+    return 0;
+}
+
+// Return samples at the buffer rate, or resampled to a lower rate_out.
+static int32_t samples_or_resample(struct bufsig_s * self, struct jsdrv_buffer_response_s * rsp,
+                                   bool unpack, uint32_t rate_out) {
+    uint32_t rate_in = self->hdr.sample_rate / self->hdr.decimate_factor;
+    if (rate_out && (rate_out < rate_in)) {
+        return resample_get(self, rsp, rate_out);
+    }
+    samples_get(self, rsp, unpack);
+    return 0;
+}
+
+void jsdrv_bufsig_snapshot(struct bufsig_s * self, struct bufsig_s * copy) {
+    struct bufsig_snapshot_s snapshot;
+    memcpy(copy, self, sizeof(*copy));
+    snapshot_read(self, &snapshot);
+    copy->level0_head = snapshot.level0_head;
+    copy->level0_size = snapshot.level0_size;
+    copy->sample_id_head = snapshot.sample_id_head;
+    copy->time_map = snapshot.time_map;
+    copy->epoch = snapshot.epoch;
+}
+
+void jsdrv_bufsig_view(struct bufsig_s * copy, uint64_t length) {
+    if (length && (copy->level0_size > length)) {
+        copy->level0_size = length;
+    }
+}
+
+bool jsdrv_bufsig_snapshot_valid(struct bufsig_s * self, const struct bufsig_s * copy,
+                                 const struct jsdrv_buffer_response_s * rsp) {
+    struct bufsig_snapshot_s now;
+    snapshot_read(self, &now);
+    if (now.epoch != copy->epoch) {
+        return false;
+    }
+    const struct jsdrv_time_range_samples_s * r = &rsp->info.time_range_samples;
+    if ((copy->level0_N < copy->N) && r->length) {
+        // Level 0 overwrote [stored_copy, stored_now), which summaries read for partial entries.
+        uint64_t stored_copy = copy->sample_id_head - ((copy->level0_size < copy->level0_N) ? copy->level0_size : copy->level0_N);
+        uint64_t stored_now = now.sample_id_head - ((now.level0_size < copy->level0_N) ? now.level0_size : copy->level0_N);
+        uint64_t end = r->end;
+        if ((JSDRV_BUFFER_RESPONSE_SUMMARY == rsp->response_type) && (((r->end - r->start) / r->length) >= copy->r0)) {
+            end = r->start + copy->r0;  // only the first entry reads level 0 before the newest samples
+        }
+        if ((stored_now != stored_copy) && (end >= stored_copy) && (r->start < stored_now)) {
+            return false;
+        }
+    }
+    if (copy->level0_pack && r->length) {
+        // Packed reads take the two newest blocks from the raw blocks, which ingestion reuses.
+        uint64_t hot = copy->sample_id_head - (copy->level0_head % copy->r0);
+        hot = (hot > copy->r0) ? (hot - copy->r0) : 0;
+        if ((r->end >= hot) && (now.sample_id_head >= (hot + (copy->level0_pack->hot_blocks - 1) * copy->r0))) {
+            return false;
+        }
+    }
+    uint64_t tail_copy = copy->sample_id_head - copy->level0_size;
+    uint64_t tail_now = now.sample_id_head - now.level0_size;
+    if (tail_now == tail_copy) {
+        return true;  // nothing overwritten
+    }
+    // Summaries read whole reduction entries, so allow one response entry before the start.
+    uint64_t margin = 0;
+    if ((JSDRV_BUFFER_RESPONSE_SUMMARY == rsp->response_type) && r->length) {
+        margin = (r->end - r->start) / r->length + 1;
+    }
+    return r->start >= (tail_now + margin);
+}
+
+/*
+ * Update a chunked request to the remainder after rsp.
+ *
+ * Sample responses continue from the last returned sample, up to the
+ * newest sample.  Summary responses continue from the last returned
+ * entry with the same increment.
+ */
+static void request_next(struct bufsig_s * self, struct jsdrv_buffer_request_s * req, uint64_t incr,
+                         struct jsdrv_buffer_response_s * rsp) {
+    struct jsdrv_time_range_samples_s * r = &req->time.samples;
+    uint64_t length = rsp->info.time_range_samples.length;
+    if (0 == length) {
+        return;
+    }
+    if (JSDRV_BUFFER_RESPONSE_SUMMARY == rsp->response_type) {
+        uint64_t length_req = (r->end - r->start + 1) / incr;
+        if (length >= length_req) {
+            return;
+        }
+        r->start = rsp->info.time_range_samples.start + length * incr;
+        r->length = length_req - length;
+        r->end = r->start + r->length * incr - 1;
+    } else {
+        uint64_t end = r->end ? r->end : (r->start + r->length - 1);
+        uint64_t start = rsp->info.time_range_samples.start + length;
+        if (JSDRV_BUFFER_RESPONSE_RESAMPLED == rsp->response_type) {
+            start = rsp->info.time_range_samples.end + 1;
+        }
+        if ((start > end) || (start >= self->sample_id_head)) {
+            return;
+        }
+        r->start = start;
+        r->end = end;
+        r->length = 0;
+    }
+    rsp->flags &= ~JSDRV_BUFFER_RESPONSE_FLAG_END;
+}
+
 int32_t jsdrv_bufsig_process_request(
         struct bufsig_s * self,
         struct jsdrv_buffer_request_s * req,
         struct jsdrv_buffer_response_s * rsp) {
     rsp->version = 1;
     rsp->response_type = 0;
-    rsp->rsv1_u8 = 0;
+    rsp->flags = JSDRV_BUFFER_RESPONSE_FLAG_END;
     rsp->rsv2_u8 = 0;
     rsp->rsv3_u32 = 0;
     rsp->rsp_id = req->rsp_id;
@@ -815,26 +2209,592 @@ int32_t jsdrv_bufsig_process_request(
             return JSDRV_ERROR_PARAMETER_INVALID;
         }
         utc_to_samples(self, &req->time.utc, &req->time.samples);
+        req->time_type = JSDRV_TIME_SAMPLES;
     } else {
         JSDRV_LOGW("invalid time_type: %d", (int) req->time_type);
         return JSDRV_ERROR_PARAMETER_INVALID;
     }
+    bool chunked = 0 != (req->flags & JSDRV_BUFFER_REQUEST_FLAG_CHUNKED);
+    bool unpack = 0 != (req->flags & JSDRV_BUFFER_REQUEST_FLAG_UNPACK);
+    bool tile = 0 != (req->flags & JSDRV_BUFFER_REQUEST_FLAG_TILE);
     rsp->info.time_range_samples = req->time.samples;
     struct jsdrv_time_range_samples_s * r = &rsp->info.time_range_samples;
     uint64_t interval = r->end - r->start + 1;
+    uint64_t incr = 0;
+    int32_t rc = 0;
     if (r->length && r->end) {
         if ((r->length * 2) > interval) {
             r->length = interval;
-            samples_get(self, rsp);
+            rc = samples_or_resample(self, rsp, unpack, req->sample_rate);
         } else {
-            summary_get(self, rsp);
+            if (tile) {
+                tile_snap(r);
+                req->time.samples = *r;
+            }
+            incr = (r->end - r->start + 1) / r->length;
+            if (chunked && (r->length > SUMMARY_LENGTH_MAX)) {
+                r->length = SUMMARY_LENGTH_MAX;
+                r->end = r->start + incr * r->length - 1;
+            }
+            summary_get(self, rsp, tile);
         }
     } else if (req->time.samples.length) {
         r->end = r->start + r->length - 1;
-        samples_get(self, rsp);
+        rc = samples_or_resample(self, rsp, unpack, req->sample_rate);
     } else {
         r->length = interval;
-        samples_get(self, rsp);
+        rc = samples_or_resample(self, rsp, unpack, req->sample_rate);
+    }
+    if (chunked && !rc) {
+        request_next(self, req, incr, rsp);
+    }
+    return rc;
+}
+
+// The level 0 index for a sample_id, which also locates its level entries.
+static inline uint64_t sample_idx(struct bufsig_s * self, uint64_t sample_id) {
+    return (self->level0_head + self->N - ((self->sample_id_head - sample_id) % self->N)) % self->N;
+}
+
+// The samples in the level entry that starts at sample_id s, which ends early at the level 0 ring end.
+static inline uint64_t entry_span(struct bufsig_s * self, uint8_t level, uint64_t s) {
+    uint64_t spe = self->levels[level - 1].samples_per_entry;
+    uint64_t remaining = self->N - sample_idx(self, s);
+    return (remaining < spe) ? remaining : spe;
+}
+
+// The number of summary levels.
+static uint8_t level_top(struct bufsig_s * self) {
+    uint8_t top = 0;
+    while ((top < JSDRV_BUFSIG_LEVELS_MAX) && self->levels[top].k) {
+        ++top;
+    }
+    return top;
+}
+
+// The complete level entry that starts at sample_id s, or NULL.
+static const struct jsdrv_summary_entry_s * entry_complete(struct bufsig_s * self, uint8_t level,
+                                                           uint64_t s, uint64_t tail) {
+    uint64_t spe = self->levels[level - 1].samples_per_entry;
+    if ((entry_span(self, level, s) != spe) || (s < tail) || ((s + spe) > self->sample_id_head)) {
+        return NULL;
+    }
+    return level_entry(self, level, sample_idx(self, s) / spe);
+}
+
+struct search_s {
+    struct bufsig_s * self;
+    uint8_t op;               // jsdrv_buffer_search_op_e or SEARCH_OP_STATS
+    float threshold;
+    int8_t side;              // -1 before the first sample, 0 at or below threshold, 1 above
+    float min;                // SEARCH_OP_STATS result
+    float max;                // SEARCH_OP_STATS result
+    uint64_t start;           // inclusive
+    uint64_t end;             // exclusive
+    uint64_t tail;            // the oldest sample with summaries
+    uint64_t stored_tail;     // the oldest sample in level 0
+    uint64_t * hits;
+    uint64_t hits_max;
+    uint64_t hit_count;
+    uint64_t searched;        // exclusive end of the searched samples
+};
+
+static inline bool search_full(struct search_s * ctx) {
+    return ctx->hit_count >= ctx->hits_max;
+}
+
+// Apply samples from sample_id that are all on one side of the threshold.
+static void search_side(struct search_s * ctx, uint64_t sample_id, int8_t side) {
+    if ((ctx->side >= 0) && (side != ctx->side)) {
+        uint8_t op = side ? JSDRV_BUFFER_SEARCH_RISE : JSDRV_BUFFER_SEARCH_FALL;
+        if ((ctx->op & op) && !search_full(ctx)) {
+            ctx->hits[ctx->hit_count++] = sample_id;
+            if (search_full(ctx)) {
+                ctx->searched = sample_id + 1;
+            }
+        }
+    }
+    ctx->side = side;
+}
+
+// Apply samples from sample_id with min and max.  Return false to search them individually.
+static bool search_range(struct search_s * ctx, uint64_t sample_id, float min, float max) {
+    if (isnan(min) || isnan(max)) {
+        return true;  // no data
+    }
+    if (SEARCH_OP_STATS == ctx->op) {
+        ctx->min = (min < ctx->min) ? min : ctx->min;
+        ctx->max = (max > ctx->max) ? max : ctx->max;
+        return true;
+    } else if (min > ctx->threshold) {
+        search_side(ctx, sample_id, 1);
+        return true;
+    } else if (max <= ctx->threshold) {
+        search_side(ctx, sample_id, 0);
+        return true;
+    }
+    return false;
+}
+
+static void search_samples(struct search_s * ctx, uint64_t start, uint64_t end) {
+    float x[SEARCH_CHUNK];
+    while ((start < end) && !search_full(ctx)) {
+        uint64_t k = end - start;
+        if (k > SEARCH_CHUNK) {
+            k = SEARCH_CHUNK;
+        }
+        level0_read_f32(ctx->self, start, k, x);
+        for (uint64_t i = 0; (i < k) && !search_full(ctx); ++i) {
+            search_range(ctx, start + i, x[i], x[i]);
+        }
+        start += k;
+    }
+}
+
+// Search the level entry that starts at sample_id s, descending only when it may hold a hit.
+static void search_entry(struct search_s * ctx, uint8_t level, uint64_t s) {
+    struct bufsig_s * self = ctx->self;
+    uint64_t spe = self->levels[level - 1].samples_per_entry;
+    uint64_t span = entry_span(self, level, s);
+    uint64_t a = (s > ctx->start) ? s : ctx->start;
+    uint64_t b = ((s + span) < ctx->end) ? (s + span) : ctx->end;
+    if ((a >= b) || search_full(ctx)) {
+        return;
+    }
+    const struct jsdrv_summary_entry_s * entry = entry_complete(self, level, s, ctx->tail);
+    if (entry && (a == s) && (b == (s + spe)) && search_range(ctx, s, entry->min, entry->max)) {
+        return;
+    }
+    if (level > 1) {
+        for (uint64_t c = s; (c < b) && !search_full(ctx); c += entry_span(self, level - 1, c)) {
+            search_entry(ctx, level - 1, c);
+        }
+        return;
+    }
+    if (a < ctx->stored_tail) {
+        if (entry) {
+            search_range(ctx, s, entry->avg, entry->avg);  // summaries only before the level 0 horizon
+        }
+        a = ctx->stored_tail;
+    }
+    search_samples(ctx, a, b);
+}
+
+static void search_walk(struct search_s * ctx) {
+    struct bufsig_s * self = ctx->self;
+    uint8_t top = level_top(self);
+    if (0 == top) {
+        search_samples(ctx, ctx->start, ctx->end);
+        return;
+    }
+    uint64_t spe = self->levels[top - 1].samples_per_entry;
+    uint64_t s = ctx->start - (sample_idx(self, ctx->start) % spe);
+    for (; (s < ctx->end) && !search_full(ctx); s += entry_span(self, top, s)) {
+        search_entry(ctx, top, s);
+    }
+}
+
+int32_t jsdrv_bufsig_search(
+        struct bufsig_s * self,
+        const struct jsdrv_buffer_search_s * search,
+        struct jsdrv_buffer_response_s * rsp) {
+    rsp->version = 1;
+    rsp->response_type = JSDRV_BUFFER_RESPONSE_SEARCH;
+    rsp->flags = JSDRV_BUFFER_RESPONSE_FLAG_END;
+    rsp->rsv2_u8 = 0;
+    rsp->rsv3_u32 = 0;
+    rsp->rsp_id = search->req.rsp_id;
+    jsdrv_bufsig_info(self, &rsp->info);
+    rsp->info.element_type = JSDRV_DATA_TYPE_UINT;
+    rsp->info.element_size_bits = 64;
+    rsp_clear(rsp);
+
+    if (!self->active || (NULL == self->level0_data)) {
+        JSDRV_LOGW("jsdrv_bufsig_search unavailable");
+        return JSDRV_ERROR_UNAVAILABLE;
+    }
+    if ((JSDRV_DATA_TYPE_FLOAT != self->hdr.element_type) || (32 != self->hdr.element_size_bits)) {
+        JSDRV_LOGW("jsdrv_bufsig_search: float32 only");
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    if ((search->op < JSDRV_BUFFER_SEARCH_RISE) || (search->op > JSDRV_BUFFER_SEARCH_MIN)) {
+        JSDRV_LOGW("jsdrv_bufsig_search: invalid op %d", (int) search->op);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct jsdrv_time_range_samples_s r = search->req.time.samples;
+    if (JSDRV_TIME_UTC == search->req.time_type) {
+        utc_to_samples(self, &search->req.time.utc, &r);
+    } else if (JSDRV_TIME_SAMPLES != search->req.time_type) {
+        JSDRV_LOGW("invalid time_type: %d", (int) search->req.time_type);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+
+    struct search_s ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.self = self;
+    ctx.tail = self->sample_id_head - self->level0_size;
+    ctx.stored_tail = self->sample_id_head - level0_stored(self);
+    ctx.start = (r.start > ctx.tail) ? r.start : ctx.tail;
+    ctx.end = self->sample_id_head;
+    if (r.end) {
+        ctx.end = r.end + 1;
+    } else if (r.length) {
+        ctx.end = r.start + r.length;
+    }
+    if (ctx.end > self->sample_id_head) {
+        ctx.end = self->sample_id_head;
+    }
+    if ((0 == self->level0_size) || (ctx.start >= ctx.end)) {
+        return 0;
+    }
+    ctx.hits = (uint64_t *) rsp->data;
+    ctx.hits_max = DATA_SIZE_MAX / sizeof(uint64_t);
+    if (search->hits_max && (search->hits_max < ctx.hits_max)) {
+        ctx.hits_max = search->hits_max;
+    }
+    ctx.searched = ctx.end;
+
+    if ((JSDRV_BUFFER_SEARCH_MAX == search->op) || (JSDRV_BUFFER_SEARCH_MIN == search->op)) {
+        // find the extreme value, then the first sample that reaches it
+        ctx.op = SEARCH_OP_STATS;
+        ctx.min = INFINITY;
+        ctx.max = -INFINITY;
+        search_walk(&ctx);
+        if (ctx.min > ctx.max) {
+            return 0;  // no data
+        }
+        ctx.hits_max = 1;
+        if (JSDRV_BUFFER_SEARCH_MAX == search->op) {
+            ctx.op = JSDRV_BUFFER_SEARCH_RISE;
+            ctx.threshold = nextafterf(ctx.max, -INFINITY);
+            ctx.side = 0;
+        } else {
+            ctx.op = JSDRV_BUFFER_SEARCH_FALL;
+            ctx.threshold = ctx.min;
+            ctx.side = 1;
+        }
+    } else {
+        ctx.op = search->op;
+        ctx.threshold = search->threshold;
+        ctx.side = -1;
+    }
+    search_walk(&ctx);
+
+    struct jsdrv_time_range_samples_s * t = &rsp->info.time_range_samples;
+    t->start = ctx.start;
+    t->end = ctx.searched - 1;
+    t->length = ctx.hit_count;
+    samples_to_utc(self, t, &rsp->info.time_range_utc);
+    return 0;
+}
+
+struct range_stats_s {
+    struct bufsig_s * self;
+    uint64_t start;           // inclusive
+    uint64_t end;             // exclusive
+    uint64_t tail;            // the oldest sample with summaries
+    uint64_t stored_tail;     // the oldest sample in level 0
+    struct jsdrv_statistics_accum_s accum;
+};
+
+static void range_stats_entry_add(struct range_stats_s * ctx, const struct jsdrv_summary_entry_s * e, uint64_t k) {
+    struct jsdrv_statistics_accum_s s;
+    if (isnan(e->avg) || !k) {
+        return;  // no data
+    }
+    jsdrv_statistics_from_entry(&s, e, k);
+    jsdrv_statistics_combine(&ctx->accum, &ctx->accum, &s);
+}
+
+static void range_stats_samples(struct range_stats_s * ctx, uint64_t start, uint64_t end) {
+    float x[SEARCH_CHUNK];
+    struct jsdrv_statistics_accum_s s;
+    while (start < end) {
+        uint64_t k = end - start;
+        if (k > SEARCH_CHUNK) {
+            k = SEARCH_CHUNK;
+        }
+        level0_read_f32(ctx->self, start, k, x);
+        jsdrv_statistics_compute_f32_skip_nan(&s, x, k);
+        jsdrv_statistics_combine(&ctx->accum, &ctx->accum, &s);
+        start += k;
+    }
+}
+
+// Combine the level entry that starts at sample_id s, descending only for the range edges.
+static void range_stats_entry(struct range_stats_s * ctx, uint8_t level, uint64_t s) {
+    struct bufsig_s * self = ctx->self;
+    uint64_t spe = self->levels[level - 1].samples_per_entry;
+    uint64_t span = entry_span(self, level, s);
+    uint64_t a = (s > ctx->start) ? s : ctx->start;
+    uint64_t b = ((s + span) < ctx->end) ? (s + span) : ctx->end;
+    if (a >= b) {
+        return;
+    }
+    const struct jsdrv_summary_entry_s * entry = entry_complete(self, level, s, ctx->tail);
+    if (entry && (a == s) && (b == (s + spe))) {
+        range_stats_entry_add(ctx, entry, spe);
+        return;
+    }
+    if (level > 1) {
+        for (uint64_t c = s; c < b; c += entry_span(self, level - 1, c)) {
+            range_stats_entry(ctx, level - 1, c);
+        }
+        return;
+    }
+    if (a < ctx->stored_tail) {
+        uint64_t k = ((b < ctx->stored_tail) ? b : ctx->stored_tail) - a;
+        if (entry) {
+            range_stats_entry_add(ctx, entry, k);  // summaries only before the level 0 horizon
+        }
+        a = ctx->stored_tail;
+    }
+    range_stats_samples(ctx, a, b);
+}
+
+static void range_stats_walk(struct range_stats_s * ctx) {
+    struct bufsig_s * self = ctx->self;
+    uint8_t top = level_top(self);
+    if (0 == top) {
+        range_stats_samples(ctx, ctx->start, ctx->end);
+        return;
+    }
+    uint64_t spe = self->levels[top - 1].samples_per_entry;
+    uint64_t s = ctx->start - (sample_idx(self, ctx->start) % spe);
+    for (; s < ctx->end; s += entry_span(self, top, s)) {
+        range_stats_entry(ctx, top, s);
+    }
+}
+
+// Store x as a 128-bit signed integer with 2**-31 scale.
+static void f64_to_i128_q31(double x, uint64_t * dst) {
+    const double u64_scale = 18446744073709551616.0;  // 2**64
+    x = ldexp(x, 31);
+    double hi = floor(x / u64_scale);
+    double lo = x - hi * u64_scale;
+    dst[0] = (lo >= u64_scale) ? UINT64_MAX : (uint64_t) lo;
+    dst[1] = (uint64_t) (int64_t) hi;
+}
+
+static void range_stats_field(struct jsdrv_statistics_accum_s const * a,
+                              double * avg, double * std, double * v_min, double * v_max) {
+    if (0 == a->k) {
+        *avg = NAN;
+        *std = NAN;
+        *v_min = NAN;
+        *v_max = NAN;
+        return;
+    }
+    *avg = a->mean;
+    *std = sqrt(a->s / (double) a->k);  // population, like the device
+    *v_min = a->min;
+    *v_max = a->max;
+}
+
+int32_t jsdrv_bufsig_statistics(struct bufsig_s * const * signals, uint32_t count,
+                                const struct jsdrv_buffer_request_s * req,
+                                struct jsdrv_buffer_response_s * rsp) {
+    if ((0 == count) || (count > 3)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct bufsig_s * s0 = signals[0];
+    rsp->version = 1;
+    rsp->response_type = JSDRV_BUFFER_RESPONSE_STATISTICS;
+    rsp->flags = JSDRV_BUFFER_RESPONSE_FLAG_END;
+    rsp->rsv2_u8 = 0;
+    rsp->rsv3_u32 = 0;
+    rsp->rsp_id = req->rsp_id;
+    jsdrv_bufsig_info(s0, &rsp->info);
+    rsp->info.element_type = JSDRV_DATA_TYPE_UNDEFINED;
+    rsp->info.element_size_bits = 8;  // length counts the jsdrv_statistics_s bytes
+    rsp_clear(rsp);
+
+    uint8_t fields = 0;
+    uint64_t tail = 0;
+    uint64_t head = UINT64_MAX;
+    for (uint32_t k = 0; k < count; ++k) {
+        struct bufsig_s * b = signals[k];
+        if (!b->active || (NULL == b->level0_data)) {
+            JSDRV_LOGW("jsdrv_bufsig_statistics unavailable");
+            return JSDRV_ERROR_UNAVAILABLE;
+        }
+        if ((JSDRV_DATA_TYPE_FLOAT != b->hdr.element_type) || (32 != b->hdr.element_size_bits)) {
+            JSDRV_LOGW("jsdrv_bufsig_statistics: float32 only");
+            return JSDRV_ERROR_NOT_SUPPORTED;
+        }
+        if ((b->hdr.sample_rate != s0->hdr.sample_rate) || (b->hdr.decimate_factor != s0->hdr.decimate_factor)) {
+            JSDRV_LOGW("jsdrv_bufsig_statistics: sample rate mismatch");
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        uint8_t field = b->hdr.field_id;
+        if ((field < JSDRV_FIELD_CURRENT) || (field > JSDRV_FIELD_POWER) || (fields & (1U << field))) {
+            JSDRV_LOGW("jsdrv_bufsig_statistics: invalid field %d", (int) field);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        fields |= (uint8_t) (1U << field);
+        uint64_t b_tail = b->sample_id_head - b->level0_size;
+        tail = (b_tail > tail) ? b_tail : tail;
+        head = (b->sample_id_head < head) ? b->sample_id_head : head;
+    }
+    struct jsdrv_time_range_samples_s r = req->time.samples;
+    if (JSDRV_TIME_UTC == req->time_type) {
+        utc_to_samples(s0, &req->time.utc, &r);
+    } else if (JSDRV_TIME_SAMPLES != req->time_type) {
+        JSDRV_LOGW("invalid time_type: %d", (int) req->time_type);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint64_t start = (r.start > tail) ? r.start : tail;
+    uint64_t end = head;
+    if (r.end) {
+        end = r.end + 1;
+    } else if (r.length) {
+        end = r.start + r.length;
+    }
+    end = (end < head) ? end : head;
+    if (start >= end) {
+        return 0;
+    }
+
+    struct jsdrv_statistics_s * y = (struct jsdrv_statistics_s *) rsp->data;
+    memset(y, 0, sizeof(*y));
+    uint32_t decimate_factor = s0->hdr.decimate_factor ? s0->hdr.decimate_factor : 1;
+    y->version = 1;
+    y->decimate_factor = (uint8_t) decimate_factor;
+    y->block_sample_count = ((end - start) > UINT32_MAX) ? UINT32_MAX : (uint32_t) (end - start);
+    y->sample_freq = s0->hdr.sample_rate;
+    y->block_sample_id = start * decimate_factor;
+    y->accum_sample_id = y->block_sample_id;
+    y->time_map = s0->time_map;
+    y->charge_f64 = NAN;
+    y->energy_f64 = NAN;
+    double fs = ((double) s0->hdr.sample_rate) / decimate_factor;
+
+    struct jsdrv_statistics_accum_s accum[3];  // current, voltage, power
+    for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(accum); ++idx) {
+        jsdrv_statistics_reset(&accum[idx]);
+    }
+    for (uint32_t k = 0; k < count; ++k) {
+        struct bufsig_s * b = signals[k];
+        struct range_stats_s ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.self = b;
+        ctx.start = start;
+        ctx.end = end;
+        ctx.tail = b->sample_id_head - b->level0_size;
+        ctx.stored_tail = b->sample_id_head - level0_stored(b);
+        jsdrv_statistics_reset(&ctx.accum);
+        range_stats_walk(&ctx);
+        accum[b->hdr.field_id - JSDRV_FIELD_CURRENT] = ctx.accum;
+        double integral = ctx.accum.k ? (ctx.accum.mean * (double) ctx.accum.k / fs) : 0.0;
+        if (JSDRV_FIELD_CURRENT == b->hdr.field_id) {
+            y->charge_f64 = integral;
+            f64_to_i128_q31(integral, y->charge_i128);
+        } else if (JSDRV_FIELD_POWER == b->hdr.field_id) {
+            y->energy_f64 = integral;
+            f64_to_i128_q31(integral, y->energy_i128);
+        }
+    }
+    range_stats_field(&accum[0], &y->i_avg, &y->i_std, &y->i_min, &y->i_max);
+    range_stats_field(&accum[1], &y->v_avg, &y->v_std, &y->v_min, &y->v_max);
+    range_stats_field(&accum[2], &y->p_avg, &y->p_std, &y->p_min, &y->p_max);
+
+    struct jsdrv_time_range_samples_s * t = &rsp->info.time_range_samples;
+    t->start = start;
+    t->end = end - 1;
+    t->length = sizeof(struct jsdrv_statistics_s);
+    samples_to_utc(s0, t, &rsp->info.time_range_utc);
+    return 0;
+}
+
+int32_t jsdrv_bufsig_request_align(struct bufsig_s * const * signals, uint32_t count,
+                                   struct jsdrv_buffer_request_s * req, uint64_t size_max) {
+    if (0 == count) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct bufsig_s * s0 = signals[0];
+    bool unpack = 0 != (req->flags & JSDRV_BUFFER_REQUEST_FLAG_UNPACK);
+    uint64_t bits = 0;
+    uint64_t head_min = UINT64_MAX;
+    uint64_t head_max = 0;
+    uint64_t tail_max = 0;
+    for (uint32_t k = 0; k < count; ++k) {
+        struct bufsig_s * b = signals[k];
+        if (!b->active || (NULL == b->level0_data)) {
+            JSDRV_LOGW("jsdrv_bufsig_request_align signal %u unavailable", (unsigned int) b->idx);
+            return JSDRV_ERROR_UNAVAILABLE;
+        }
+        if ((b->hdr.sample_rate != s0->hdr.sample_rate) || (b->hdr.decimate_factor != s0->hdr.decimate_factor)) {
+            JSDRV_LOGW("jsdrv_bufsig_request_align signal %u sample rate mismatch", (unsigned int) b->idx);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        bits += (unpack && (b->hdr.element_size_bits < 8)) ? 8 : b->hdr.element_size_bits;
+        uint64_t head = b->sample_id_head;
+        uint64_t tail = head - level0_stored(b);
+        head_min = (head < head_min) ? head : head_min;
+        head_max = (head > head_max) ? head : head_max;
+        tail_max = (tail > tail_max) ? tail : tail_max;
+        if (0 == b->level0_size) {
+            head_min = 0;  // no common samples
+        }
+    }
+
+    if (JSDRV_TIME_SAMPLES == req->time_type) {
+        if (req->time.samples.end && (req->time.samples.end < req->time.samples.start)) {
+            JSDRV_LOGW("invalid time samples: %" PRIu64 ", %" PRIu64,
+                       req->time.samples.start, req->time.samples.end);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    } else if (JSDRV_TIME_UTC == req->time_type) {
+        if (req->time.utc.end && (req->time.utc.end < req->time.utc.start)) {
+            JSDRV_LOGW("invalid time utc: %" PRIi64 ", %" PRIi64,
+                       req->time.utc.start, req->time.utc.end);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        utc_to_samples(s0, &req->time.utc, &req->time.samples);
+        req->time_type = JSDRV_TIME_SAMPLES;
+    } else {
+        JSDRV_LOGW("invalid time_type: %d", (int) req->time_type);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+
+    // Summaries already share the grid, and return NaN entries outside each signal's data.
+    struct jsdrv_time_range_samples_s * r = &req->time.samples;
+    if (r->length && r->end) {
+        uint64_t interval = r->end - r->start + 1;
+        if ((r->length * 2) <= interval) {
+            uint64_t incr = interval / r->length;
+            uint64_t entries_length = interval / incr;
+            if ((entries_length * sizeof(struct jsdrv_summary_entry_s) * count) > size_max) {
+                JSDRV_LOGI("summary request: length too long: %" PRIu64 " x %u", entries_length, (unsigned int) count);
+                return JSDRV_ERROR_TOO_BIG;
+            }
+            return 0;
+        }
+    }
+
+    // Samples clip to the range that all signals hold.
+    uint64_t start = r->start;
+    uint64_t end = (r->length && !r->end) ? (start + r->length - 1) : r->end;
+    if (start < tail_max) {
+        start = tail_max;
+    }
+    if (head_min && (end >= head_min)) {
+        end = head_min - 1;
+    }
+    if (!head_min || (start > end)) {
+        // empty for every signal
+        r->start = head_max;
+        r->end = head_max;
+        r->length = 1;
+        return 0;
+    }
+    uint64_t length_max = (size_max * 8) / bits;
+    if ((end - start + 1) > length_max) {
+        JSDRV_LOGD3("sample req too long, truncate %" PRIu64 " -> %" PRIu64, end - start + 1, length_max);
+        end = start + length_max - 1;
     }
+    r->start = start;
+    r->end = end;
+    r->length = end - start + 1;
     return 0;
 }
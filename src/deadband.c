@@ -0,0 +1,160 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/f32_ops.h"
+#include <math.h>
+#include <string.h>
+
+
+static inline uint32_t decimate_factor(const struct jsdrv_stream_signal_s * s) {
+    return s->decimate_factor ? s->decimate_factor : 1;
+}
+
+static inline bool is_f32(const struct jsdrv_stream_signal_s * s) {
+    return (s->element_type == JSDRV_DATA_TYPE_FLOAT) && (s->element_size_bits == 32);
+}
+
+void jsdrv_deadband_initialize(struct jsdrv_deadband_s * self, float tolerance) {
+    memset(self, 0, sizeof(*self));
+    self->tolerance = (tolerance > 0.0f) ? tolerance : 0.0f;
+}
+
+static void run_start(struct jsdrv_deadband_run_s * r, const struct jsdrv_stream_signal_s * s,
+                      float min, float max, double sum) {
+    r->sample_id = s->sample_id;
+    r->count = s->element_count;
+    r->min = min;
+    r->max = max;
+    r->sum = sum;
+    r->field_id = s->field_id;
+    r->index = s->index;
+    r->sample_rate = s->sample_rate;
+    r->decimate_factor = decimate_factor(s);
+    r->time_map = s->time_map;
+}
+
+// Check if s continues run r without a gap or a change in format.
+static bool run_is_next(const struct jsdrv_deadband_run_s * r, const struct jsdrv_stream_signal_s * s) {
+    uint64_t count = r->count + s->element_count;
+    uint64_t count_max = r->sample_rate ? ((uint64_t) r->sample_rate * JSDRV_DEADBAND_DURATION_MAX) : UINT64_MAX;
+    return (s->sample_id == (r->sample_id + r->count * r->decimate_factor))
+        && (decimate_factor(s) == r->decimate_factor)
+        && (s->field_id == r->field_id) && (s->index == r->index)
+        && (s->sample_rate == r->sample_rate)
+        && ((count * r->decimate_factor) <= count_max);
+}
+
+uint32_t jsdrv_deadband_process(struct jsdrv_deadband_s * self, const struct jsdrv_stream_signal_s * s) {
+    if (!s->element_count) {
+        return 0;
+    }
+    if ((self->tolerance <= 0.0f) || !is_f32(s)) {
+        return jsdrv_deadband_flush(self) ? JSDRV_DEADBAND_EMIT : 0;
+    }
+    uint32_t valid = 0;
+    float min = INFINITY;
+    float max = -INFINITY;
+    double sum = jsdrv_f32_sum_min_max((const float *) s->data, s->element_count, &valid, &min, &max);
+    if (valid != s->element_count) {
+        return jsdrv_deadband_flush(self) ? JSDRV_DEADBAND_EMIT : 0;  // NaN
+    }
+
+    uint32_t rv = 0;
+    struct jsdrv_deadband_run_s * r = &self->run;
+    if (r->count) {
+        float run_min = (min < r->min) ? min : r->min;
+        float run_max = (max > r->max) ? max : r->max;
+        if (run_is_next(r, s) && ((run_max - run_min) <= self->tolerance)) {
+            r->count += s->element_count;
+            r->min = run_min;
+            r->max = run_max;
+            r->sum += sum;
+            return JSDRV_DEADBAND_ABSORB;
+        }
+        rv |= jsdrv_deadband_flush(self) ? JSDRV_DEADBAND_EMIT : 0;
+    }
+    if ((max - min) <= self->tolerance) {
+        run_start(r, s, min, max, sum);
+        rv |= JSDRV_DEADBAND_ABSORB;
+    }
+    return rv;
+}
+
+bool jsdrv_deadband_flush(struct jsdrv_deadband_s * self) {
+    if (self->run.count) {
+        self->done = self->run;
+        self->run.count = 0;
+    }
+    return 0 != self->done.count;
+}
+
+uint32_t jsdrv_deadband_emit(struct jsdrv_deadband_s * self, struct jsdrv_stream_signal_s * s) {
+    struct jsdrv_deadband_run_s * r = &self->done;
+    struct jsdrv_stream_hold_s * hold = (struct jsdrv_stream_hold_s *) s->data;
+    s->sample_id = r->sample_id;
+    s->field_id = r->field_id;
+    s->index = r->index;
+    s->element_type = JSDRV_DATA_TYPE_HOLD;
+    s->element_size_bits = sizeof(struct jsdrv_stream_hold_s) * 8;
+    s->element_count = 1;
+    s->sample_rate = r->sample_rate;
+    s->decimate_factor = r->decimate_factor;
+    s->time_map = r->time_map;
+    memset(&s->host_time, 0, sizeof(s->host_time));
+    hold->sample_count = r->count;
+    hold->min = r->min;
+    hold->max = r->max;
+    hold->mean = r->count ? (float) (r->sum / (double) r->count) : NAN;
+    hold->rsv_u32 = 0;
+    r->count = 0;
+    return JSDRV_STREAM_HEADER_SIZE + sizeof(struct jsdrv_stream_hold_s);
+}
+
+const struct jsdrv_stream_hold_s * jsdrv_deadband_hold(const struct jsdrv_stream_signal_s * s) {
+    if ((s->element_type != JSDRV_DATA_TYPE_HOLD) || (s->element_count != 1)
+            || (s->element_size_bits != (sizeof(struct jsdrv_stream_hold_s) * 8))) {
+        return NULL;
+    }
+    return (const struct jsdrv_stream_hold_s *) s->data;
+}
+
+uint64_t jsdrv_deadband_sample_count(const struct jsdrv_stream_signal_s * s) {
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(s);
+    return hold ? hold->sample_count : s->element_count;
+}
+
+uint32_t jsdrv_deadband_expand(const struct jsdrv_stream_signal_s * s, uint64_t offset,
+                               struct jsdrv_stream_signal_s * dst) {
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(s);
+    if (!hold || (offset >= hold->sample_count)) {
+        return 0;
+    }
+    const uint32_t count_max = JSDRV_STREAM_DATA_SIZE / sizeof(float);
+    uint64_t k = hold->sample_count - offset;
+    uint32_t count = (k < count_max) ? (uint32_t) k : count_max;
+    memcpy(dst, s, JSDRV_STREAM_HEADER_SIZE);
+    dst->sample_id = s->sample_id + offset * decimate_factor(s);
+    dst->element_type = JSDRV_DATA_TYPE_FLOAT;
+    dst->element_size_bits = 32;
+    dst->element_count = count;
+    float * f32 = (float *) dst->data;
+    for (uint32_t i = 0; i < count; ++i) {
+        f32[i] = hold->mean;
+    }
+    return count;
+}
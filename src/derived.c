@@ -0,0 +1,300 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/derived.h"
+#include "jsdrv_prv/f32_ops.h"
+#include <math.h>
+#include <string.h>
+
+
+static void header_copy(struct jsdrv_stream_signal_s * dst, const struct jsdrv_stream_signal_s * src,
+                        uint64_t sample_id, uint32_t decimate_factor, uint8_t element_size_bits) {
+    dst->sample_id = sample_id;
+    dst->field_id = src->field_id;
+    dst->index = src->index;
+    dst->element_type = JSDRV_DATA_TYPE_FLOAT;
+    dst->element_size_bits = element_size_bits;
+    dst->element_count = 0;
+    dst->sample_rate = src->sample_rate;
+    dst->decimate_factor = decimate_factor;
+    dst->time_map = src->time_map;
+    dst->host_time = src->host_time;
+}
+
+void jsdrv_derived_integral_clear(struct jsdrv_derived_integral_s * self) {
+    self->value = 0.0;
+}
+
+uint32_t jsdrv_derived_integral(struct jsdrv_derived_integral_s * self, const struct jsdrv_stream_signal_s * src,
+                                uint32_t offset, struct jsdrv_stream_signal_s * dst) {
+    if ((offset >= src->element_count) || (0 == src->sample_rate)) {
+        return 0;
+    }
+    uint32_t length = src->element_count - offset;
+    if (length > JSDRV_DERIVED_INTEGRAL_LENGTH_MAX) {
+        length = JSDRV_DERIVED_INTEGRAL_LENGTH_MAX;
+    }
+    header_copy(dst, src, src->sample_id + offset * (uint64_t) src->decimate_factor, src->decimate_factor, 64);
+    double dt = (double) src->decimate_factor / (double) src->sample_rate;
+    double * y = (double *) dst->data;
+    jsdrv_f32_scale_f64(y, ((const float *) src->data) + offset, dt, length);
+    double value = self->value;
+    for (uint32_t i = 0; i < length; ++i) {
+        value += y[i];
+        y[i] = value;
+    }
+    self->value = value;
+    dst->element_count = length;
+    return length;
+}
+
+void jsdrv_derived_rms_clear(struct jsdrv_derived_rms_s * self, uint32_t window) {
+    if (window < 1) {
+        window = 1;
+    } else if (window > JSDRV_DERIVED_RMS_WINDOW_MAX) {
+        window = JSDRV_DERIVED_RMS_WINDOW_MAX;
+    }
+    self->window = window;
+    self->count = 0;
+    self->valid = 0;
+    self->sum_sq = 0.0;
+    self->sample_id = 0;
+    self->sample_id_next = 0;
+    self->decimate_factor = 0;
+}
+
+uint32_t jsdrv_derived_rms(struct jsdrv_derived_rms_s * self, const struct jsdrv_stream_signal_s * src,
+                           struct jsdrv_stream_signal_s * dst) {
+    uint32_t decimate_factor = src->decimate_factor ? src->decimate_factor : 1;
+    uint32_t window = self->window;
+    if (((uint64_t) window * decimate_factor) > UINT32_MAX) {
+        window = UINT32_MAX / decimate_factor;  // keep the output decimate_factor in range
+    }
+    if ((src->sample_id != self->sample_id_next) || (decimate_factor != self->decimate_factor)) {
+        self->count = 0;  // restart window on gap or rate change
+    }
+    if (0 == self->count) {
+        self->valid = 0;
+        self->sum_sq = 0.0;
+        self->sample_id = src->sample_id;
+    }
+    self->decimate_factor = decimate_factor;
+    self->sample_id_next = src->sample_id + src->element_count * (uint64_t) decimate_factor;
+
+    header_copy(dst, src, self->sample_id, window * decimate_factor, 32);
+    const float * x = (const float *) src->data;
+    float * y = (float *) dst->data;
+    uint32_t length = src->element_count;
+    uint32_t n = 0;
+    while (length) {
+        uint32_t k = window - self->count;
+        if (k > length) {
+            k = length;
+        }
+        uint32_t valid = 0;
+        self->sum_sq += jsdrv_f32_sum_sq(x, k, &valid);
+        self->valid += valid;
+        self->count += k;
+        x += k;
+        length -= k;
+        if (self->count >= window) {
+            y[n++] = self->valid ? (float) sqrt(self->sum_sq / self->valid) : NAN;
+            self->sample_id += window * (uint64_t) decimate_factor;
+            self->count = 0;
+            self->valid = 0;
+            self->sum_sq = 0.0;
+        }
+    }
+    dst->element_count = n;
+    return n;
+}
+
+void jsdrv_derived_summary_clear(struct jsdrv_derived_summary_s * self, uint32_t fs) {
+    self->fs = fs ? fs : 1;
+    self->count = 0;
+    jsdrv_statistics_reset(&self->accum);
+    self->sample_id = 0;
+    self->sample_id_next = 0;
+    self->decimate_factor = 0;
+}
+
+uint32_t jsdrv_derived_summary_window(const struct jsdrv_derived_summary_s * self,
+                                      const struct jsdrv_stream_signal_s * src) {
+    uint32_t decimate_factor = src->decimate_factor ? src->decimate_factor : 1;
+    uint32_t window = (src->sample_rate / decimate_factor) / self->fs;
+    if (window < JSDRV_DERIVED_SUMMARY_WINDOW_MIN) {
+        window = JSDRV_DERIVED_SUMMARY_WINDOW_MIN;
+    }
+    if (((uint64_t) window * decimate_factor) > UINT32_MAX) {
+        window = UINT32_MAX / decimate_factor;  // keep the output decimate_factor in range
+    }
+    return window;
+}
+
+static void summary_entry(const struct jsdrv_statistics_accum_s * s, struct jsdrv_summary_entry_s * e) {
+    if (s->k) {
+        jsdrv_statistics_to_entry(s, e);
+    } else {
+        e->avg = NAN;
+        e->std = NAN;
+        e->min = NAN;
+        e->max = NAN;
+    }
+}
+
+uint32_t jsdrv_derived_summary(struct jsdrv_derived_summary_s * self, const struct jsdrv_stream_signal_s * src,
+                               struct jsdrv_stream_signal_s * dst) {
+    uint32_t decimate_factor = src->decimate_factor ? src->decimate_factor : 1;
+    uint32_t window = jsdrv_derived_summary_window(self, src);
+    if ((src->sample_id != self->sample_id_next) || (decimate_factor != self->decimate_factor)) {
+        self->count = 0;  // restart window on gap or rate change
+    }
+    if (0 == self->count) {
+        jsdrv_statistics_reset(&self->accum);
+        self->sample_id = src->sample_id;
+    }
+    self->decimate_factor = decimate_factor;
+    self->sample_id_next = src->sample_id + src->element_count * (uint64_t) decimate_factor;
+
+    header_copy(dst, src, self->sample_id, window * decimate_factor, sizeof(struct jsdrv_summary_entry_s) * 8);
+    dst->element_type = JSDRV_DATA_TYPE_UNDEFINED;
+    const float * x = (const float *) src->data;
+    struct jsdrv_summary_entry_s * y = (struct jsdrv_summary_entry_s *) dst->data;
+    struct jsdrv_statistics_accum_s chunk;
+    uint32_t length = src->element_count;
+    uint32_t n = 0;
+    while (length) {
+        uint32_t k = window - self->count;
+        if (k > length) {
+            k = length;
+        }
+        jsdrv_statistics_compute_f32_skip_nan(&chunk, x, k);
+        jsdrv_statistics_combine(&self->accum, &self->accum, &chunk);
+        self->count += k;
+        x += k;
+        length -= k;
+        if (self->count >= window) {
+            summary_entry(&self->accum, &y[n++]);
+            self->sample_id += window * (uint64_t) decimate_factor;
+            self->count = 0;
+            jsdrv_statistics_reset(&self->accum);
+        }
+    }
+    dst->element_count = n;
+    return n;
+}
+
+// Count trailing zeros, x != 0.
+static inline uint32_t ctz_u64(uint64_t x) {
+#if defined(__clang__) || defined(__GNUC__)
+    return (uint32_t) __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanForward64(&idx, x);
+    return (uint32_t) idx;
+#else
+    uint32_t n = 0;
+    while (0 == (x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Load up to 64 bits starting at bit pos from the packed data.
+static uint64_t bits_load(const uint8_t * x, uint32_t pos, uint32_t length) {
+    uint32_t byte = pos >> 3;
+    uint32_t shift = pos & 7;
+    uint32_t bytes = (shift + length + 7) >> 3;  // at most 9
+    uint8_t b[16] = {0};
+    memcpy(b, x + byte, bytes);
+    uint64_t lo;
+    memcpy(&lo, b, sizeof(lo));  // little endian
+    uint64_t w = lo >> shift;
+    if (shift) {
+        w |= ((uint64_t) b[8]) << (64 - shift);
+    }
+    return (length < 64) ? (w & ((1ULL << length) - 1)) : w;
+}
+
+void jsdrv_derived_edge_clear(struct jsdrv_derived_edge_s * self) {
+    self->level = -1;
+    self->sample_id_next = 0;
+}
+
+uint32_t jsdrv_derived_edge(struct jsdrv_derived_edge_s * self, const struct jsdrv_stream_signal_s * src,
+                            uint32_t offset, struct jsdrv_stream_signal_s * dst) {
+    uint32_t decimate_factor = src->decimate_factor ? src->decimate_factor : 1;
+    header_copy(dst, src, src->sample_id + offset * (uint64_t) decimate_factor, decimate_factor,
+                sizeof(struct jsdrv_edge_s) * 8);
+    dst->element_type = JSDRV_DATA_TYPE_UNDEFINED;
+    uint32_t bits = src->element_size_bits;
+    if ((offset >= src->element_count) || ((bits != 1) && (bits != 4))) {
+        return 0;
+    }
+    if ((0 == offset) && (src->sample_id != self->sample_id_next)) {
+        self->level = -1;  // gap
+    }
+    self->sample_id_next = src->sample_id + src->element_count * (uint64_t) decimate_factor;
+
+    const uint64_t level_mask = (1ULL << bits) - 1;
+    const uint32_t samples_per_word = 64 / bits;
+    struct jsdrv_edge_s * y = (struct jsdrv_edge_s *) dst->data;
+    uint32_t n = 0;
+    uint32_t pos = offset;
+    if (self->level < 0) {
+        // report the starting level
+        self->level = (int8_t) (bits_load(src->data, pos * bits, bits));
+        memset(&y[n], 0, sizeof(y[n]));
+        y[n].sample_id = src->sample_id + pos * (uint64_t) decimate_factor;
+        y[n].level = (uint8_t) self->level;
+        ++n;
+    }
+    while (pos < src->element_count) {
+        uint32_t length = src->element_count - pos;
+        length = (length > samples_per_word) ? samples_per_word : length;
+        uint32_t length_bits = length * bits;
+        uint64_t w = bits_load(src->data, pos * bits, length_bits);
+        uint64_t w_prev = (w << bits) | (uint64_t) self->level;
+        // set bits where each sample differs from the one before
+        uint64_t d = w ^ w_prev;
+        if (length_bits < 64) {
+            d &= (1ULL << length_bits) - 1;
+        }
+        if (4 == bits) {
+            // fold each changed nibble into its lowest bit
+            d = (d | (d >> 1) | (d >> 2) | (d >> 3)) & 0x1111111111111111ULL;
+        }
+        while (d) {
+            uint32_t k = ctz_u64(d);
+            if (n >= JSDRV_DERIVED_EDGE_LENGTH_MAX) {
+                self->level = (int8_t) ((w_prev >> k) & level_mask);  // resume at this edge
+                dst->element_count = n;
+                return pos + k / bits - offset;
+            }
+            memset(&y[n], 0, sizeof(y[n]));
+            y[n].sample_id = src->sample_id + (pos + k / bits) * (uint64_t) decimate_factor;
+            y[n].level = (uint8_t) ((w >> k) & level_mask);
+            ++n;
+            d &= d - 1;
+        }
+        self->level = (int8_t) ((w >> (length_bits - bits)) & level_mask);
+        pos += length;
+    }
+    dst->element_count = n;
+    return pos - offset;
+}
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#include "jsdrv_prv/dispatch.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/list.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include "jsdrv/cstr.h"
+#include "tinyprintf.h"
+#include <string.h>
+
+
+#define DISPATCH_THREADS_MAX (64U)
+#define DISPATCH_JOIN_TIMEOUT_MS (1000U)
+#define DISPATCH_PREFIX_LEVELS (3U)   // device prefix, such as "u/js220/000415"
+#define QUEUE_BLOCK_TIMEOUT_MS (1000U)
+#define QUEUE_BLOCK_POLL_MS (1U)
+
+struct worker_s {
+    struct jsdrv_dispatch_s * parent;
+    uint32_t index;
+    struct msg_queue_s * q;
+    jsdrv_thread_t thread;
+};
+
+struct jsdrv_dispatch_queue_s {
+    struct jsdrv_list_s item;                 // parent->queues
+    struct jsdrv_dispatch_s * parent;         // NULL after jsdrv_dispatch_finalize()
+    struct jsdrv_context_s * context;
+    struct worker_s * worker;
+    jsdrv_os_mutex_t mutex;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    jsdrv_subscribe_fn fn;
+    void * user_data;
+    uint32_t refcnt;                          // owner + scheduled worker envelope
+    uint32_t depth;
+    uint8_t policy;
+    uint8_t closed;
+    uint8_t scheduled;                        // worker envelope pending
+    uint32_t head;
+    uint32_t pending;
+    uint32_t peak;
+    uint32_t drops;
+    struct jsdrvp_msg_s ** msgs;              // ring buffer of depth entries
+};
+
+struct jsdrv_dispatch_s {
+    struct jsdrv_context_s * context;
+    jsdrv_os_mutex_t mutex;                   // protects queues
+    struct jsdrv_list_s queues;               // of jsdrv_dispatch_queue_s
+    uint32_t count;
+    struct worker_s workers[];
+};
+
+static uint32_t prefix_hash(const char * topic) {
+    uint32_t h = 2166136261U;  // FNV-1a
+    uint32_t levels = 0;
+    for (; *topic; ++topic) {
+        if ((*topic == '/') && (++levels >= DISPATCH_PREFIX_LEVELS)) {
+            break;
+        }
+        h ^= (uint8_t) *topic;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static void queue_release(struct jsdrv_dispatch_queue_s * q) {
+    jsdrv_os_mutex_lock(q->mutex);
+    uint32_t refcnt = --q->refcnt;
+    jsdrv_os_mutex_unlock(q->mutex);
+    if (refcnt) {
+        return;
+    }
+    struct jsdrv_dispatch_s * parent = q->parent;
+    if (parent) {
+        jsdrv_os_mutex_lock(parent->mutex);
+        jsdrv_list_remove(&q->item);
+        jsdrv_os_mutex_unlock(parent->mutex);
+    }
+    jsdrv_os_mutex_free(q->mutex);
+    jsdrv_free(q->msgs);
+    jsdrv_free(q);
+}
+
+static void queue_drain(struct jsdrv_context_s * context, struct jsdrv_dispatch_queue_s * q) {
+    struct jsdrvp_msg_s * msg;
+    while (1) {
+        jsdrv_os_mutex_lock(q->mutex);
+        if (q->closed || !q->pending) {
+            q->scheduled = 0;
+            jsdrv_os_mutex_unlock(q->mutex);
+            break;
+        }
+        msg = q->msgs[q->head];
+        q->msgs[q->head] = NULL;
+        q->head = (q->head + 1) % q->depth;
+        --q->pending;
+        jsdrv_os_mutex_unlock(q->mutex);
+        q->fn(q->user_data, msg->topic, &msg->value);
+        jsdrvp_msg_free(context, msg);  // release reference
+    }
+    queue_release(q);  // scheduled envelope reference
+}
+
+static THREAD_RETURN_TYPE worker_thread(THREAD_ARG_TYPE lpParam) {
+    struct worker_s * self = (struct worker_s *) lpParam;
+    struct jsdrv_context_s * context = self->parent->context;
+    struct jsdrvp_msg_s * msg;
+    JSDRV_LOGI("dispatch thread %u start", (unsigned int) self->index);
+    jsdrvp_thread_configure(context, JSDRVP_THREAD_DISPATCH, "jsdrv_dispatch");
+    jsdrvp_msg_cache_attach(context);
+    while (1) {
+        if (msg_queue_pop(self->q, &msg, 1000)) {
+            continue;
+        }
+        if (0 == strcmp(JSDRV_MSG_FINALIZE, msg->topic)) {
+            jsdrvp_msg_free(context, msg);
+            break;
+        }
+        if (msg->u32_a) {
+            queue_drain(context, msg->payload.dispatch_queue);
+            jsdrvp_msg_free(context, msg);
+            continue;
+        }
+        struct jsdrvp_msg_s * data = msg->payload.dispatch;
+        msg->extra.frontend.subscriber.external_fn(msg->extra.frontend.subscriber.user_data,
+                                                   data->topic, &data->value);
+        jsdrvp_msg_free(context, data);  // release reference
+        jsdrvp_msg_free(context, msg);
+    }
+    jsdrvp_msg_cache_detach(context);
+    JSDRV_LOGI("dispatch thread %u done", (unsigned int) self->index);
+    THREAD_RETURN();
+}
+
+struct jsdrv_dispatch_s * jsdrv_dispatch_initialize(struct jsdrv_context_s * context, uint32_t thread_count) {
+    if (!thread_count) {
+        return NULL;
+    }
+    if (thread_count > DISPATCH_THREADS_MAX) {
+        JSDRV_LOGW("dispatch thread_count %u too large, use %u",
+                   (unsigned int) thread_count, (unsigned int) DISPATCH_THREADS_MAX);
+        thread_count = DISPATCH_THREADS_MAX;
+    }
+    struct jsdrv_dispatch_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_dispatch_s)
+            + thread_count * sizeof(struct worker_s));
+    self->context = context;
+    self->mutex = jsdrv_os_mutex_alloc("dispatch");
+    jsdrv_list_initialize(&self->queues);
+    for (uint32_t idx = 0; idx < thread_count; ++idx) {
+        struct worker_s * w = &self->workers[idx];
+        w->parent = self;
+        w->index = idx;
+        w->q = msg_queue_init();
+        if (jsdrv_thread_create(&w->thread, worker_thread, w, 1)) {
+            JSDRV_LOGE("dispatch thread %u create failed", (unsigned int) idx);
+            msg_queue_finalize(w->q);
+            w->q = NULL;
+            break;
+        }
+        self->count = idx + 1;
+    }
+    if (!self->count) {
+        jsdrv_os_mutex_free(self->mutex);
+        jsdrv_free(self);
+        return NULL;
+    }
+    return self;
+}
+
+void jsdrv_dispatch_finalize(struct jsdrv_dispatch_s * self) {
+    if (!self) {
+        return;
+    }
+    for (uint32_t idx = 0; idx < self->count; ++idx) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(self->context);
+        jsdrv_cstr_copy(m->topic, JSDRV_MSG_FINALIZE, sizeof(m->topic));
+        msg_queue_push(self->workers[idx].q, m);
+    }
+    for (uint32_t idx = 0; idx < self->count; ++idx) {
+        struct worker_s * w = &self->workers[idx];
+        jsdrv_thread_join(&w->thread, DISPATCH_JOIN_TIMEOUT_MS);
+        msg_queue_finalize(w->q);
+        w->q = NULL;
+    }
+    // Remaining queues belong to pubsub subscribers, which close them later.
+    struct jsdrv_list_s * item;
+    jsdrv_os_mutex_lock(self->mutex);
+    jsdrv_list_foreach(&self->queues, item) {
+        struct jsdrv_dispatch_queue_s * q = JSDRV_CONTAINER_OF(item, struct jsdrv_dispatch_queue_s, item);
+        jsdrv_list_remove(item);
+        q->parent = NULL;
+        q->worker = NULL;
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    jsdrv_os_mutex_free(self->mutex);
+    jsdrv_free(self);
+}
+
+void jsdrv_dispatch_submit(struct jsdrv_dispatch_s * self, jsdrv_subscribe_fn fn, void * user_data,
+                           struct jsdrvp_msg_s * msg) {
+    struct worker_s * w = &self->workers[prefix_hash(msg->topic) % self->count];
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(self->context);
+    jsdrv_cstr_copy(m->topic, "", sizeof(m->topic));
+    m->extra.frontend.subscriber.external_fn = fn;
+    m->extra.frontend.subscriber.user_data = user_data;
+    m->extra.frontend.subscriber.is_internal = 0;
+    jsdrv_atomic_add_u32(&msg->refcnt, 1);
+    m->payload.dispatch = msg;
+    msg_queue_push(w->q, m);
+}
+
+struct jsdrv_dispatch_queue_s * jsdrv_dispatch_queue_alloc(struct jsdrv_dispatch_s * self, const char * topic,
+        jsdrv_subscribe_fn fn, void * user_data, uint32_t depth, uint8_t policy) {
+    if (!self || !fn) {
+        return NULL;
+    }
+    switch (policy) {
+        case JSDRV_QUEUE_POLICY_BLOCK:        /* intentional fall-through */
+        case JSDRV_QUEUE_POLICY_DROP_OLDEST:  /* intentional fall-through */
+        case JSDRV_QUEUE_POLICY_DROP_NEWEST:  break;
+        case JSDRV_QUEUE_POLICY_COALESCE:     depth = 1; break;
+        default: return NULL;
+    }
+    if (!depth) {
+        return NULL;
+    }
+    struct jsdrv_dispatch_queue_s * q = jsdrv_alloc_clr(sizeof(struct jsdrv_dispatch_queue_s));
+    jsdrv_list_initialize(&q->item);
+    q->parent = self;
+    q->context = self->context;
+    q->worker = &self->workers[prefix_hash(topic) % self->count];
+    q->mutex = jsdrv_os_mutex_alloc("dispatch_queue");
+    jsdrv_cstr_copy(q->topic, topic, sizeof(q->topic));
+    q->fn = fn;
+    q->user_data = user_data;
+    q->refcnt = 1;
+    q->depth = depth;
+    q->policy = policy;
+    q->msgs = jsdrv_alloc_clr(depth * sizeof(struct jsdrvp_msg_s *));
+    jsdrv_os_mutex_lock(self->mutex);
+    jsdrv_list_add_tail(&self->queues, &q->item);
+    jsdrv_os_mutex_unlock(self->mutex);
+    return q;
+}
+
+static struct jsdrvp_msg_s * queue_pop_oldest(struct jsdrv_dispatch_queue_s * q) {
+    struct jsdrvp_msg_s * msg = q->msgs[q->head];
+    q->msgs[q->head] = NULL;
+    q->head = (q->head + 1) % q->depth;
+    --q->pending;
+    return msg;
+}
+
+void jsdrv_dispatch_queue_close(struct jsdrv_dispatch_queue_s * queue) {
+    if (!queue) {
+        return;
+    }
+    jsdrv_os_mutex_lock(queue->mutex);
+    queue->closed = 1;
+    while (queue->pending) {
+        struct jsdrvp_msg_s * msg = queue_pop_oldest(queue);
+        jsdrvp_msg_free(queue->context, msg);
+    }
+    jsdrv_os_mutex_unlock(queue->mutex);
+    queue_release(queue);  // owner reference
+}
+
+void jsdrv_dispatch_queue_submit(struct jsdrv_dispatch_queue_s * queue, struct jsdrvp_msg_s * msg) {
+    struct jsdrv_context_s * context;
+    struct jsdrvp_msg_s * drop = NULL;
+    uint32_t t_start = 0;
+    bool schedule = false;
+    if (!queue->worker) {
+        return;  // dispatch finalized
+    }
+    context = queue->context;
+    jsdrv_os_mutex_lock(queue->mutex);
+    while (!queue->closed && (queue->pending >= queue->depth)) {
+        if (queue->policy == JSDRV_QUEUE_POLICY_DROP_NEWEST) {
+            ++queue->drops;
+            jsdrv_os_mutex_unlock(queue->mutex);
+            return;
+        } else if (queue->policy == JSDRV_QUEUE_POLICY_BLOCK) {
+            if (!t_start) {
+                t_start = jsdrv_time_ms_u32() | 1;
+            }
+            if ((jsdrv_time_ms_u32() - t_start) < QUEUE_BLOCK_TIMEOUT_MS) {
+                jsdrv_os_mutex_unlock(queue->mutex);
+                jsdrv_thread_sleep_ms(QUEUE_BLOCK_POLL_MS);
+                jsdrv_os_mutex_lock(queue->mutex);
+                continue;
+            }
+        }
+        drop = queue_pop_oldest(queue);  // DROP_OLDEST, COALESCE, or BLOCK timeout
+        ++queue->drops;
+        break;
+    }
+    if (queue->closed) {
+        jsdrv_os_mutex_unlock(queue->mutex);
+        return;
+    }
+    jsdrv_atomic_add_u32(&msg->refcnt, 1);
+    queue->msgs[(queue->head + queue->pending) % queue->depth] = msg;
+    ++queue->pending;
+    if (queue->pending > queue->peak) {
+        queue->peak = queue->pending;
+    }
+    if (!queue->scheduled) {
+        queue->scheduled = 1;
+        ++queue->refcnt;
+        schedule = true;
+    }
+    jsdrv_os_mutex_unlock(queue->mutex);
+    if (drop) {
+        jsdrvp_msg_free(context, drop);
+    }
+    if (schedule) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+        jsdrv_cstr_copy(m->topic, "", sizeof(m->topic));
+        m->u32_a = 1;
+        m->payload.dispatch_queue = queue;
+        msg_queue_push(queue->worker->q, m);
+    }
+}
+
+uint32_t jsdrv_dispatch_queue_stats(struct jsdrv_dispatch_s * self, char * buf, uint32_t size) {
+    struct jsdrv_list_s * item;
+    uint32_t count = 0;
+    char * p = buf;
+    char * p_end = buf + size;
+    if (!buf || (size < 3)) {
+        return 0;
+    }
+    *p++ = '[';
+    if (self) {
+        jsdrv_os_mutex_lock(self->mutex);
+        jsdrv_list_foreach(&self->queues, item) {
+            struct jsdrv_dispatch_queue_s * q = JSDRV_CONTAINER_OF(item, struct jsdrv_dispatch_queue_s, item);
+            jsdrv_os_mutex_lock(q->mutex);
+            int n = tfp_snprintf(p, p_end - p - 1,
+                                 "%s{\"topic\": \"%s\", \"depth\": %u, \"pending\": %u, \"peak\": %u, \"drops\": %u}",
+                                 count ? ", " : "", q->topic,
+                                 (unsigned int) q->depth, (unsigned int) q->pending, (unsigned int) q->peak,
+                                 (unsigned int) q->drops);
+            jsdrv_os_mutex_unlock(q->mutex);
+            if ((n < 0) || (n >= (p_end - p - 1))) {
+                *p = 0;
+                break;  // truncate
+            }
+            p += n;
+            ++count;
+        }
+        jsdrv_os_mutex_unlock(self->mutex);
+    }
+    *p++ = ']';
+    *p = 0;
+    return count;
+}
@@ -22,19 +22,42 @@
 
 #include "jsdrv_prv/downsample.h"
 #include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/f32_ops.h"
 #include "jsdrv_prv/log.h"
 #include "jsdrv_prv/platform.h"
 #include <math.h>
 #include <limits.h>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define DS_TARGET(isa_)
+#else
+#define DS_TARGET(isa_) __attribute__((target(isa_)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DS_NEON 1
+#include <arm_neon.h>
+#endif
+
 #define BUFFER_SIZE (128U)              // must be power of 2, <= 256
 #define BUFFER_MASK (BUFFER_SIZE - 1U)
+#define BLOCK_SIZE (256U)               // samples per jsdrv_downsample_add_f32_block() stage pass
+#define FILTER_COUNT (14U)              // enough to go from 2 Msps to 1 sps
+#define MC_LANES (JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX)
 
 #define COEF_2_SIZE (39U)
 #define COEF_2_CENTER (COEF_2_SIZE >> 1)  // index
 #define COEF_5_SIZE (89U)
 #define COEF_5_CENTER (COEF_5_SIZE >> 1)  // index
 
+#define RESAMPLE_UP_MAX (1024U)         // the maximum rational stage interpolation factor L
+#define RESAMPLE_TAPS_BASE (32U)        // taps per phase for each M / L
+#define RESAMPLE_TAPS_MAX (256U)        // the maximum taps per phase, which limits M / L to 8
+#define RESAMPLE_KAISER_BETA (8.0)      // about 80 dB stopband attenuation
+#define RESAMPLE_PI (3.14159265358979323846)
+
 
 static const int32_t coef_2[COEF_2_SIZE] = {
         754, -593, -5030, -1156, 14685, 11700, -28090, -40657,
@@ -61,6 +84,7 @@ static const int32_t coef_5[COEF_5_SIZE] = {
 
 static const float f_scale_in = 0x1p30f;
 static const float f_scale_out = 0x1p-30f;
+static const float f_scale_taps = 0x1p-23f;  // the Q23 taps
 
 struct filter_s {
     const int32_t * taps;
@@ -70,6 +94,28 @@ struct filter_s {
     int64_t buffer[BUFFER_SIZE];
     uint32_t downsample_factor;
     uint32_t downsample_count;
+    float taps_f32[COEF_5_SIZE];        // JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32 only
+    float history_f32[COEF_5_SIZE - 1]; // the most recent taps_length - 1 inputs, oldest first
+    double taps_f64[COEF_5_SIZE];       // JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64 only
+    double history_f64[COEF_5_SIZE - 1];
+};
+
+/*
+ * The rational L / M polyphase resampler appended to the cascade when
+ * sample_rate_in / sample_rate_out is not a product of 2 and 5 stages.
+ * Phase p holds the prototype taps h[p + j * L], reversed for the
+ * oldest-first history windows.
+ */
+struct resample_s {
+    uint32_t up;                        // L
+    uint32_t down;                      // M >= L
+    uint32_t taps_length;               // taps per phase
+    uint32_t phase;                     // the phase for the next output
+    uint32_t wait;                      // the inputs to skip before the next output
+    float * taps_f32;                   // [up][taps_length]
+    double * taps_f64;                  // [up][taps_length]
+    float history_f32[RESAMPLE_TAPS_MAX - 1];
+    double history_f64[RESAMPLE_TAPS_MAX - 1];
 };
 
 
@@ -79,11 +125,126 @@ struct jsdrv_downsample_s {
     uint32_t sample_rate_out;
     uint32_t decimate_factor;
     uint32_t sample_delay;
-    struct filter_s filters[14];  // enough to go from 2 Msps to 1 sps
+    struct filter_s filters[FILTER_COUNT];
+    struct resample_s * resample;       // NULL for integer decimate factors
     uint64_t sample_count;
     int64_t avg;
 };
 
+static uint32_t gcd_u32(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        double q = x / (2.0 * k);
+        term *= q * q;
+        sum += term;
+        if (term < (1e-12 * sum)) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/*
+ * Find the largest 2 and 5 stage cascade factor that divides
+ * sample_rate_in and keeps the cascade output at or above sample_rate_out.
+ */
+static uint32_t cascade_factor(uint32_t sample_rate_in, uint32_t sample_rate_out) {
+    uint32_t best = 1;
+    uint64_t d5 = 1;
+    for (uint32_t b = 0; b < FILTER_COUNT; ++b, d5 *= 5) {
+        uint64_t d = d5;
+        for (uint32_t a = 0; (a + b) < FILTER_COUNT; ++a, d *= 2) {
+            if ((d > sample_rate_in) || (sample_rate_in % d) || ((sample_rate_in / d) < sample_rate_out)) {
+                break;
+            }
+            if (d > best) {
+                best = (uint32_t) d;
+            }
+        }
+    }
+    return best;
+}
+
+/*
+ * Design the Kaiser-windowed sinc prototype at the L * rate_in rate with
+ * its stopband starting at rate_out / 2, then split it into phases.
+ */
+static struct resample_s * resample_alloc(uint32_t rate_in, uint32_t rate_out) {
+    uint32_t g = gcd_u32(rate_in, rate_out);
+    uint32_t up = rate_out / g;
+    uint32_t down = rate_in / g;
+    uint32_t taps_length = (RESAMPLE_TAPS_BASE * down + up - 1) / up;
+    if ((up > RESAMPLE_UP_MAX) || (taps_length > RESAMPLE_TAPS_MAX)) {
+        JSDRV_LOGE("Cannot resample %lu to %lu: ratio %lu / %lu too complex", rate_in, rate_out, up, down);
+        return NULL;
+    }
+    uint32_t n = up * taps_length;
+    struct resample_s * r = jsdrv_alloc_clr(sizeof(struct resample_s) + n * (sizeof(float) + sizeof(double)));
+    if (NULL == r) {
+        return NULL;
+    }
+    r->up = up;
+    r->down = down;
+    r->taps_length = taps_length;
+    r->taps_f64 = (double *) (r + 1);
+    r->taps_f32 = (float *) (r->taps_f64 + n);
+
+    // transition width from the Kaiser design formula for A = 80 dB
+    double transition = 5.0 / (double) taps_length;             // normalized to rate_in
+    double fc = (0.5 * rate_out / rate_in - 0.5 * transition);   // normalized to rate_in
+    if (fc < (0.1 * rate_out / rate_in)) {
+        fc = 0.1 * rate_out / rate_in;
+    }
+    fc /= up;                                                    // normalized to the L * rate_in rate
+    double center = 0.5 * (n - 1);
+    double i0_beta = bessel_i0(RESAMPLE_KAISER_BETA);
+    double sum = 0.0;
+    for (uint32_t k = 0; k < n; ++k) {
+        double t = k - center;
+        double h = 2.0 * fc;
+        if (t != 0.0) {
+            h = sin(2.0 * RESAMPLE_PI * fc * t) / (RESAMPLE_PI * t);
+        }
+        double w = 2.0 * t / (n - 1);
+        h *= bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - w * w)) / i0_beta;
+        r->taps_f64[(k % up) * taps_length + (taps_length - 1 - k / up)] = h;
+        sum += h;
+    }
+    double gain = up / sum;  // unity DC gain for every phase on average
+    for (uint32_t k = 0; k < n; ++k) {
+        r->taps_f64[k] *= gain;
+        r->taps_f32[k] = (float) r->taps_f64[k];
+    }
+    return r;
+}
+
+static void resample_seed(struct resample_s * r, double x) {
+    for (uint32_t k = 0; k < (r->taps_length - 1); ++k) {
+        r->history_f32[k] = (float) x;
+        r->history_f64[k] = x;
+    }
+    r->phase = 0;
+    r->wait = 0;
+}
+
+// Advance to the next output, and return the input index step.
+static inline uint32_t resample_advance(struct resample_s * r) {
+    r->phase += r->down;
+    uint32_t step = r->phase / r->up;
+    r->phase -= step * r->up;
+    return step;
+}
+
 
 struct jsdrv_downsample_s * jsdrv_downsample_alloc(uint32_t sample_rate_in, uint32_t sample_rate_out, int mode) {
     if (sample_rate_in < sample_rate_out) {
@@ -97,9 +258,15 @@ struct jsdrv_downsample_s * jsdrv_downsample_alloc(uint32_t sample_rate_in, uint
     }
 
     uint32_t decimate_factor = sample_rate_in / sample_rate_out;
-    if ((sample_rate_out * decimate_factor) != sample_rate_in) {
-        JSDRV_LOGE("Cannot downsample: sample_rate_out * M != sample_rate_in");
-        return NULL;
+    bool rational = false;
+    if (mode == JSDRV_DOWNSAMPLE_MODE_AVERAGE) {
+        if ((sample_rate_out * decimate_factor) != sample_rate_in) {
+            JSDRV_LOGE("Cannot downsample: sample_rate_out * M != sample_rate_in");
+            return NULL;
+        }
+    } else {
+        decimate_factor = cascade_factor(sample_rate_in, sample_rate_out);
+        rational = (sample_rate_out * decimate_factor) != sample_rate_in;
     }
 
     struct jsdrv_downsample_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_downsample_s));
@@ -116,8 +283,17 @@ struct jsdrv_downsample_s * jsdrv_downsample_alloc(uint32_t sample_rate_in, uint
             self->mode = JSDRV_DOWNSAMPLE_MODE_AVERAGE;
             self->sample_delay = self->decimate_factor / 2;
             return self;
-        case JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND:
-            self->mode = JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND;
+        case JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND:  // intentional fall-through
+        case JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32:  // intentional fall-through
+        case JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64:
+            self->mode = (enum jsdrv_downsample_mode_e) mode;
+            if (rational) {
+                self->resample = resample_alloc(sample_rate_in / decimate_factor, sample_rate_out);
+                if (NULL == self->resample) {
+                    jsdrv_free(self);
+                    return NULL;
+                }
+            }
             break;
         default:
             jsdrv_free(self);
@@ -147,6 +323,10 @@ struct jsdrv_downsample_s * jsdrv_downsample_alloc(uint32_t sample_rate_in, uint
             f->downsample_factor = 5;
             decimate_factor = d;
         }
+        for (uint32_t k = 0; k < f->taps_length; ++k) {
+            f->taps_f32[k] = (float) f->taps[k] * f_scale_taps;
+            f->taps_f64[k] = (double) f->taps[k] * f_scale_taps;
+        }
         self->sample_delay += f->taps_center;
         ++idx;
         if (idx >= JSDRV_ARRAY_SIZE(self->filters)) {
@@ -173,6 +353,7 @@ void jsdrv_downsample_clear(struct jsdrv_downsample_s * self) {
 
 void jsdrv_downsample_free(struct jsdrv_downsample_s * self) {
     if (NULL != self) {
+        jsdrv_free(self->resample);
         jsdrv_free(self);
     }
 }
@@ -185,6 +366,247 @@ uint32_t jsdrv_downsample_decimate_factor(struct jsdrv_downsample_s * self) {
     }
 }
 
+static inline int64_t f32_to_i64q30(float x) {
+    return isnan(x) ? INT64_MIN : (int64_t) (x * f_scale_in);
+}
+
+static inline float i64q30_to_f32(int64_t x) {
+    return (x == INT64_MIN) ? NAN : (((float) x) * f_scale_out);
+}
+
+static int64_t filter_compute(const struct filter_s * f, uint8_t buffer_idx) {
+    uint32_t fwd_idx = (buffer_idx - f->taps_center) & BUFFER_MASK;
+    uint32_t bwd_idx = fwd_idx;
+    int64_t x_feed;
+    int64_t x_sum;
+    if (f->buffer[fwd_idx] == INT64_MIN) {  // NaN
+        return INT64_MIN;
+    }
+    x_feed = f->taps[f->taps_center] * f->buffer[fwd_idx];
+    for (uint8_t tap_idx = f->taps_center + 1; tap_idx < f->taps_length; ++tap_idx) {
+        fwd_idx = (fwd_idx + 1) & BUFFER_MASK;
+        bwd_idx = (bwd_idx - 1) & BUFFER_MASK;
+        if ((f->buffer[fwd_idx] == INT64_MIN) || (f->buffer[bwd_idx] == INT64_MIN)) {  // NaN
+            return INT64_MIN;
+        }
+        x_sum = f->buffer[fwd_idx] + f->buffer[bwd_idx];
+        x_feed += x_sum * f->taps[tap_idx];
+    }
+    return x_feed >> 23;
+}
+
+static float dot_f32_scalar(const float * taps, const float * x, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t k = 0; k < n; ++k) {
+        sum += taps[k] * x[k];
+    }
+    return sum;
+}
+
+#if DS_X86
+
+DS_TARGET("avx2")
+static float dot_f32_avx2(const float * taps, const float * x, uint32_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    uint32_t k = 0;
+    for (; (k + 8) <= n; k += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(taps + k), _mm256_loadu_ps(x + k)));
+    }
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s) + dot_f32_scalar(taps + k, x + k, n - k);
+}
+
+#elif DS_NEON
+
+static float dot_f32_neon(const float * taps, const float * x, uint32_t n) {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    uint32_t k = 0;
+    for (; (k + 4) <= n; k += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(taps + k), vld1q_f32(x + k));
+    }
+    return vaddvq_f32(acc) + dot_f32_scalar(taps + k, x + k, n - k);
+}
+
+#endif
+
+typedef float (*dot_f32_fn)(const float * taps, const float * x, uint32_t n);
+
+static dot_f32_fn dot_f32_select(void) {
+    switch (jsdrv_f32_ops_isa()) {
+#if DS_X86
+        case JSDRV_F32_OPS_ISA_AVX2: return dot_f32_avx2;
+#elif DS_NEON
+        case JSDRV_F32_OPS_ISA_NEON: return dot_f32_neon;
+#endif
+        default: return dot_f32_scalar;
+    }
+}
+
+/*
+ * Run one float32 stage over x in place as a polyphase decimator that
+ * only computes the retained outputs.  NaN inputs propagate through the
+ * arithmetic to every output whose window contains them, which matches
+ * the INT64_MIN handling of the fixed-point stages.
+ */
+static uint32_t stage_f32(struct filter_s * f, dot_f32_fn dot, float * x, uint16_t * src, uint32_t n) {
+    float w[COEF_5_SIZE - 1 + BLOCK_SIZE];
+    uint32_t h = f->taps_length - 1U;
+    uint32_t n_out = 0;
+    jsdrv_memcpy(w, f->history_f32, h * sizeof(float));
+    jsdrv_memcpy(w + h, x, n * sizeof(float));
+    uint32_t k = f->downsample_count - 1U;  // the next input that completes an output
+    for (; k < n; k += f->downsample_factor) {
+        x[n_out] = dot(f->taps_f32, w + k, f->taps_length);  // window ends at input k
+        src[n_out++] = src[k];
+    }
+    f->downsample_count = k - n + 1U;
+    jsdrv_memcpy(f->history_f32, w + n, h * sizeof(float));
+    return n_out;
+}
+
+/*
+ * Run the rational resampler over x in place.  M >= L, so each input
+ * produces at most one output.
+ */
+static uint32_t resample_f32(struct resample_s * r, dot_f32_fn dot, float * x, uint16_t * src, uint32_t n) {
+    float w[RESAMPLE_TAPS_MAX - 1 + BLOCK_SIZE];
+    uint32_t h = r->taps_length - 1U;
+    uint32_t n_out = 0;
+    jsdrv_memcpy(w, r->history_f32, h * sizeof(float));
+    jsdrv_memcpy(w + h, x, n * sizeof(float));
+    uint32_t k = r->wait;
+    while (k < n) {
+        x[n_out] = dot(r->taps_f32 + r->phase * r->taps_length, w + k, r->taps_length);
+        src[n_out++] = src[k];
+        k += resample_advance(r);
+    }
+    r->wait = k - n;
+    jsdrv_memcpy(r->history_f32, w + n, h * sizeof(float));
+    return n_out;
+}
+
+static uint32_t add_f32_stages(struct jsdrv_downsample_s * self, float * x, uint16_t * src, uint32_t n) {
+    dot_f32_fn dot = dot_f32_select();
+    self->sample_count += n;
+    for (size_t filter_idx = 0; filter_idx < JSDRV_ARRAY_SIZE(self->filters); ++filter_idx) {
+        struct filter_s * f = &self->filters[filter_idx];
+        if ((0 == f->taps_length) || (0 == n)) {
+            break;
+        }
+        n = stage_f32(f, dot, x, src, n);
+    }
+    if (self->resample && n) {
+        n = resample_f32(self->resample, dot, x, src, n);
+    }
+    return n;
+}
+
+// Run the rational resampler on one float sample in place.
+static bool resample_f32_one(struct jsdrv_downsample_s * self, float * x) {
+    uint16_t src = 0;
+    return 0 != resample_f32(self->resample, dot_f32_select(), x, &src, 1);
+}
+
+/*
+ * Run one float64 stage over x in place, like stage_f32().
+ */
+static uint32_t stage_f64(struct filter_s * f, double * x, uint16_t * src, uint32_t n) {
+    double w[COEF_5_SIZE - 1 + BLOCK_SIZE];
+    uint32_t h = f->taps_length - 1U;
+    uint32_t n_out = 0;
+    jsdrv_memcpy(w, f->history_f64, h * sizeof(double));
+    jsdrv_memcpy(w + h, x, n * sizeof(double));
+    uint32_t k = f->downsample_count - 1U;
+    for (; k < n; k += f->downsample_factor) {
+        const double * wk = w + k;
+        double sum = 0.0;
+        for (uint32_t j = 0; j < f->taps_length; ++j) {
+            sum += f->taps_f64[j] * wk[j];
+        }
+        x[n_out] = sum;
+        src[n_out++] = src[k];
+    }
+    f->downsample_count = k - n + 1U;
+    jsdrv_memcpy(f->history_f64, w + n, h * sizeof(double));
+    return n_out;
+}
+
+// Run the rational resampler over x in place, like resample_f32().
+static uint32_t resample_f64(struct resample_s * r, double * x, uint16_t * src, uint32_t n) {
+    double w[RESAMPLE_TAPS_MAX - 1 + BLOCK_SIZE];
+    uint32_t h = r->taps_length - 1U;
+    uint32_t n_out = 0;
+    jsdrv_memcpy(w, r->history_f64, h * sizeof(double));
+    jsdrv_memcpy(w + h, x, n * sizeof(double));
+    uint32_t k = r->wait;
+    while (k < n) {
+        const double * taps = r->taps_f64 + r->phase * r->taps_length;
+        const double * wk = w + k;
+        double sum = 0.0;
+        for (uint32_t j = 0; j < r->taps_length; ++j) {
+            sum += taps[j] * wk[j];
+        }
+        x[n_out] = sum;
+        src[n_out++] = src[k];
+        k += resample_advance(r);
+    }
+    r->wait = k - n;
+    jsdrv_memcpy(r->history_f64, w + n, h * sizeof(double));
+    return n_out;
+}
+
+static uint32_t add_f64_stages(struct jsdrv_downsample_s * self, double * x, uint16_t * src, uint32_t n) {
+    self->sample_count += n;
+    for (size_t filter_idx = 0; filter_idx < JSDRV_ARRAY_SIZE(self->filters); ++filter_idx) {
+        struct filter_s * f = &self->filters[filter_idx];
+        if ((0 == f->taps_length) || (0 == n)) {
+            break;
+        }
+        n = stage_f64(f, x, src, n);
+    }
+    if (self->resample && n) {
+        n = resample_f64(self->resample, x, src, n);
+    }
+    return n;
+}
+
+static bool add_f32_mode_float(struct jsdrv_downsample_s * self, uint64_t sample_id, float x_in, float * x_out) {
+    uint16_t src = 0;
+    if (self->sample_count == 0) {
+        if (0 != (sample_id % self->decimate_factor)) {
+            return false;  // discard until aligned
+        }
+        // seed all histories with this value
+        for (size_t i = 0; i < JSDRV_ARRAY_SIZE(self->filters); ++i) {
+            struct filter_s * f = &self->filters[i];
+            if (0 == f->taps_length) {
+                break;
+            }
+            for (size_t k = 0; k < (COEF_5_SIZE - 1U); ++k) {
+                f->history_f32[k] = x_in;
+                f->history_f64[k] = x_in;
+            }
+            f->downsample_count = f->downsample_factor;
+        }
+        if (self->resample) {
+            resample_seed(self->resample, x_in);
+        }
+    }
+    if (self->mode == JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64) {
+        double x64 = x_in;
+        if (add_f64_stages(self, &x64, &src, 1)) {
+            *x_out = (float) x64;
+            return true;
+        }
+    } else if (add_f32_stages(self, &x_in, &src, 1)) {
+        *x_out = x_in;
+        return true;
+    }
+    return false;
+}
+
 static bool jsdrv_downsample_add_i64q30(struct jsdrv_downsample_s * self, uint64_t sample_id, int64_t x_in, int64_t * x_out) {
     struct filter_s * f;
     if (self->mode == JSDRV_DOWNSAMPLE_MODE_AVERAGE) {
@@ -228,13 +650,13 @@ static bool jsdrv_downsample_add_i64q30(struct jsdrv_downsample_s * self, uint64
             }
             f->downsample_count = f->downsample_factor;
         }
+        if (self->resample) {
+            resample_seed(self->resample, (x_in == INT64_MIN) ? NAN : (x_in * (double) f_scale_out));
+        }
     }
     ++self->sample_count;
 
     int64_t x_feed = x_in;
-    int64_t x_sum;
-    uint32_t fwd_idx;
-    uint32_t bwd_idx;
 
     for (size_t filter_idx = 0; filter_idx < JSDRV_ARRAY_SIZE(self->filters); ++filter_idx) {
         f = &self->filters[filter_idx];
@@ -248,26 +670,7 @@ static bool jsdrv_downsample_add_i64q30(struct jsdrv_downsample_s * self, uint64
         f->buffer_idx = (f->buffer_idx + 1) & BUFFER_MASK;
         --f->downsample_count;
         if (0 == f->downsample_count) { // compute filter sample
-            fwd_idx = (buffer_idx - f->taps_center) & BUFFER_MASK;
-            bwd_idx = fwd_idx;
-            if (f->buffer[fwd_idx] == INT64_MIN) {  // NaN
-                x_feed = INT64_MIN;
-            } else {
-                x_feed = f->taps[f->taps_center] * f->buffer[fwd_idx];
-                for (uint8_t tap_idx = f->taps_center + 1; tap_idx < f->taps_length; ++tap_idx) {
-                    fwd_idx = (fwd_idx + 1) & BUFFER_MASK;
-                    bwd_idx = (bwd_idx - 1) & BUFFER_MASK;
-                    if ((f->buffer[fwd_idx] == INT64_MIN) || (f->buffer[bwd_idx] == INT64_MIN)) {  // NaN
-                        x_feed = INT64_MIN;
-                        break;
-                    }
-                    x_sum = f->buffer[fwd_idx] + f->buffer[bwd_idx];
-                    x_feed += x_sum * f->taps[tap_idx];
-                }
-            }
-            if (x_feed != INT64_MIN) {
-                x_feed >>= 23;
-            }
+            x_feed = filter_compute(f, buffer_idx);
             f->downsample_count = f->downsample_factor;
         } else {
             break;
@@ -282,28 +685,422 @@ bool jsdrv_downsample_add_f32(struct jsdrv_downsample_s * self, uint64_t sample_
         *x_out = x_in;
         return true;
     }
-    if (isnan(x_in)) {
-        x64 = INT64_MIN;
-    } else {
-        x64 = (int64_t) (x_in * f_scale_in);
+    if ((self->mode == JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32)
+            || (self->mode == JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64)) {
+        return add_f32_mode_float(self, sample_id, x_in, x_out);
     }
+    x64 = f32_to_i64q30(x_in);
     bool rv = jsdrv_downsample_add_i64q30(self, sample_id, x64, &x64);
     if (rv) {
-        if (x64 == INT64_MIN) {
-            *x_out = NAN;
-        } else {
-            *x_out = ((float) (x64)) * f_scale_out;
+        float y = i64q30_to_f32(x64);
+        if (self->resample && !resample_f32_one(self, &y)) {
+            return false;
         }
+        *x_out = y;
     }
     return rv;
 }
 
+/*
+ * Process an aligned block in place, stage by stage.
+ * x holds the input and then the output samples.  src holds the input
+ * index that produced each sample.  Returns the output sample count.
+ */
+static uint32_t add_i64q30_block(struct jsdrv_downsample_s * self, int64_t * x, uint16_t * src, uint32_t n) {
+    uint32_t n_out = 0;
+    self->sample_count += n;
+    if (self->mode == JSDRV_DOWNSAMPLE_MODE_AVERAGE) {
+        uint64_t count = self->sample_count - n;
+        for (uint32_t k = 0; k < n; ++k) {
+            if (INT64_MIN != self->avg) {
+                self->avg = (INT64_MIN == x[k]) ? INT64_MIN : (self->avg + x[k]);
+            }
+            if (++count >= self->decimate_factor) {
+                x[n_out] = (INT64_MIN == self->avg) ? INT64_MIN : (self->avg / (int64_t) count);
+                src[n_out++] = src[k];
+                count = 0;
+                self->avg = 0;
+            }
+        }
+        self->sample_count = count;
+        return n_out;
+    }
+
+    for (size_t filter_idx = 0; filter_idx < JSDRV_ARRAY_SIZE(self->filters); ++filter_idx) {
+        struct filter_s * f = &self->filters[filter_idx];
+        if ((0 == f->taps_length) || (0 == n)) {
+            break;
+        }
+        n_out = 0;
+        for (uint32_t k = 0; k < n; ++k) {
+            uint8_t buffer_idx = f->buffer_idx;
+            f->buffer[buffer_idx] = x[k];
+            f->buffer_idx = (buffer_idx + 1) & BUFFER_MASK;
+            if (0 == --f->downsample_count) {
+                x[n_out] = filter_compute(f, buffer_idx);
+                src[n_out++] = src[k];
+                f->downsample_count = f->downsample_factor;
+            }
+        }
+        n = n_out;
+    }
+    return n;
+}
+
+uint32_t jsdrv_downsample_add_f32_block(struct jsdrv_downsample_s * self, uint64_t sample_id,
+                                        const float * x, uint32_t n, float * y, uint32_t * n_out) {
+    int64_t buf[BLOCK_SIZE];
+    float buf_f32[BLOCK_SIZE];
+    double buf_f64[BLOCK_SIZE];
+    uint16_t src[BLOCK_SIZE];
+    uint32_t first = n;
+    uint32_t count = 0;
+    uint32_t k = 0;
+    if (NULL == self) {
+        jsdrv_memcpy(y, x, n * sizeof(float));
+        *n_out = n;
+        return 0;
+    }
+
+    // align and seed with the per-sample path
+    while ((k < n) && (0 == self->sample_count)) {
+        if (jsdrv_downsample_add_f32(self, sample_id + k, x[k], y + count)) {
+            if (0 == count) {
+                first = k;
+            }
+            ++count;
+        }
+        ++k;
+    }
+
+    while ((k < n) && (self->mode == JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32)) {
+        uint32_t m = n - k;
+        if (m > BLOCK_SIZE) {
+            m = BLOCK_SIZE;
+        }
+        jsdrv_memcpy(buf_f32, x + k, m * sizeof(float));
+        for (uint32_t j = 0; j < m; ++j) {
+            src[j] = (uint16_t) j;
+        }
+        uint32_t m_out = add_f32_stages(self, buf_f32, src, m);
+        if (m_out && (0 == count)) {
+            first = k + src[0];
+        }
+        jsdrv_memcpy(y + count, buf_f32, m_out * sizeof(float));
+        count += m_out;
+        k += m;
+    }
+
+    while ((k < n) && (self->mode == JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64)) {
+        uint32_t m = n - k;
+        if (m > BLOCK_SIZE) {
+            m = BLOCK_SIZE;
+        }
+        for (uint32_t j = 0; j < m; ++j) {
+            buf_f64[j] = x[k + j];
+            src[j] = (uint16_t) j;
+        }
+        uint32_t m_out = add_f64_stages(self, buf_f64, src, m);
+        if (m_out && (0 == count)) {
+            first = k + src[0];
+        }
+        for (uint32_t j = 0; j < m_out; ++j) {
+            y[count + j] = (float) buf_f64[j];
+        }
+        count += m_out;
+        k += m;
+    }
+
+    while (k < n) {
+        uint32_t m = n - k;
+        if (m > BLOCK_SIZE) {
+            m = BLOCK_SIZE;
+        }
+        for (uint32_t j = 0; j < m; ++j) {
+            buf[j] = f32_to_i64q30(x[k + j]);
+            src[j] = (uint16_t) j;
+        }
+        uint32_t m_out = add_i64q30_block(self, buf, src, m);
+        for (uint32_t j = 0; j < m_out; ++j) {
+            y[count + j] = i64q30_to_f32(buf[j]);
+        }
+        if (self->resample && m_out) {
+            m_out = resample_f32(self->resample, dot_f32_select(), y + count, src, m_out);
+        }
+        if (m_out && (0 == count)) {
+            first = k + src[0];
+        }
+        count += m_out;
+        k += m;
+    }
+    *n_out = count;
+    return first;
+}
+
 bool jsdrv_downsample_add_u8(struct jsdrv_downsample_s * self, uint64_t sample_id, uint8_t x_in, uint8_t * x_out) {
     int64_t x64 = ((int64_t) x_in) << 30;
     bool rv = jsdrv_downsample_add_i64q30(self, sample_id, x64, &x64);
+    if (rv && self->resample) {
+        float y = i64q30_to_f32(x64);
+        rv = resample_f32_one(self, &y);
+        x64 = f32_to_i64q30(y);
+    }
     if (rv) {
         x64 += (1 << 29);  // add 0.5 to so truncation rounds to nearest integer
         *x_out = (x64 < 0) ? 0 : ((uint8_t) (x64 >> 30));
     }
     return rv;
 }
+
+/*
+ * Multi-channel lockstep filtering.  The channels share one state machine,
+ * the filter stages of ch[0], and interleave their samples MC_LANES wide
+ * so that a single vector multiply-add covers one tap for every channel.
+ */
+
+struct filter_mc_s {
+    float taps[COEF_5_SIZE * MC_LANES];             // each tap repeated for every lane
+    float history[(COEF_5_SIZE - 1) * MC_LANES];    // interleaved by channel, oldest first
+};
+
+struct jsdrv_downsample_mc_s {
+    uint32_t channels;
+    bool lockstep;
+    struct jsdrv_downsample_s * ch[JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX];  // only ch[0] in lockstep
+    struct filter_mc_s filters[FILTER_COUNT];                          // lockstep only
+};
+
+static void dot_mc_scalar(const float * taps, const float * w, uint32_t taps_length, float * y) {
+    float acc[MC_LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (uint32_t k = 0; k < (taps_length * MC_LANES); k += MC_LANES) {
+        for (uint32_t lane = 0; lane < MC_LANES; ++lane) {
+            acc[lane] += taps[k + lane] * w[k + lane];
+        }
+    }
+    jsdrv_memcpy(y, acc, sizeof(acc));
+}
+
+#if DS_X86
+
+DS_TARGET("sse2")
+static void dot_mc_sse2(const float * taps, const float * w, uint32_t taps_length, float * y) {
+    __m128 acc = _mm_setzero_ps();
+    for (uint32_t k = 0; k < (taps_length * MC_LANES); k += MC_LANES) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(taps + k), _mm_loadu_ps(w + k)));
+    }
+    _mm_storeu_ps(y, acc);
+}
+
+DS_TARGET("avx2")
+static void dot_mc_avx2(const float * taps, const float * w, uint32_t taps_length, float * y) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();  // second accumulator shortens the add dependency chain
+    uint32_t n = taps_length * MC_LANES;
+    uint32_t k = 0;
+    for (; (k + 16) <= n; k += 16) {  // two taps per vector
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(taps + k), _mm256_loadu_ps(w + k)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(taps + k + 8), _mm256_loadu_ps(w + k + 8)));
+    }
+    if ((k + 8) <= n) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(taps + k), _mm256_loadu_ps(w + k)));
+        k += 8;
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    if (k < n) {
+        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(taps + k), _mm_loadu_ps(w + k)));
+    }
+    _mm_storeu_ps(y, s);
+}
+
+#elif DS_NEON
+
+static void dot_mc_neon(const float * taps, const float * w, uint32_t taps_length, float * y) {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (uint32_t k = 0; k < (taps_length * MC_LANES); k += MC_LANES) {
+        acc = vmlaq_f32(acc, vld1q_f32(taps + k), vld1q_f32(w + k));
+    }
+    vst1q_f32(y, acc);
+}
+
+#endif
+
+typedef void (*dot_mc_fn)(const float * taps, const float * w, uint32_t taps_length, float * y);
+
+static dot_mc_fn dot_mc_select(void) {
+    switch (jsdrv_f32_ops_isa()) {
+#if DS_X86
+        case JSDRV_F32_OPS_ISA_SSE2: return dot_mc_sse2;
+        case JSDRV_F32_OPS_ISA_AVX2: return dot_mc_avx2;
+#elif DS_NEON
+        case JSDRV_F32_OPS_ISA_NEON: return dot_mc_neon;
+#endif
+        default: return dot_mc_scalar;
+    }
+}
+
+static inline bool mc_is_lockstep(const struct jsdrv_downsample_mc_s * self) {
+    return self->lockstep;
+}
+
+struct jsdrv_downsample_mc_s * jsdrv_downsample_mc_alloc(uint32_t sample_rate_in, uint32_t sample_rate_out,
+                                                         int mode, uint32_t channels) {
+    if ((channels < 1) || (channels > JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX)) {
+        JSDRV_LOGE("Unsupported channel count: %lu", channels);
+        return NULL;
+    }
+    struct jsdrv_downsample_mc_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_downsample_mc_s));
+    if (NULL == self) {
+        return NULL;
+    }
+    self->channels = channels;
+    for (uint32_t c = 0; c < channels; ++c) {
+        self->ch[c] = jsdrv_downsample_alloc(sample_rate_in, sample_rate_out, mode);
+        if (NULL == self->ch[c]) {
+            jsdrv_downsample_mc_free(self);
+            return NULL;
+        }
+        if ((0 == c) && (mode == JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32) && (NULL == self->ch[0]->resample)) {
+            self->lockstep = true;  // rational resamplers run per channel
+            break;
+        }
+    }
+    if (mc_is_lockstep(self)) {
+        for (uint32_t i = 0; i < FILTER_COUNT; ++i) {
+            const struct filter_s * f = &self->ch[0]->filters[i];
+            for (uint32_t k = 0; k < f->taps_length; ++k) {
+                for (uint32_t lane = 0; lane < MC_LANES; ++lane) {
+                    self->filters[i].taps[k * MC_LANES + lane] = f->taps_f32[k];
+                }
+            }
+        }
+    }
+    return self;
+}
+
+void jsdrv_downsample_mc_free(struct jsdrv_downsample_mc_s * self) {
+    if (NULL != self) {
+        for (uint32_t c = 0; c < JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX; ++c) {
+            jsdrv_downsample_free(self->ch[c]);
+        }
+        jsdrv_free(self);
+    }
+}
+
+void jsdrv_downsample_mc_clear(struct jsdrv_downsample_mc_s * self) {
+    if (NULL != self) {
+        for (uint32_t c = 0; c < JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX; ++c) {
+            jsdrv_downsample_clear(self->ch[c]);
+        }
+    }
+}
+
+uint32_t jsdrv_downsample_mc_decimate_factor(struct jsdrv_downsample_mc_s * self) {
+    return (NULL == self) ? 1 : jsdrv_downsample_decimate_factor(self->ch[0]);
+}
+
+// Run one interleaved stage over x in place, like stage_f32().
+static uint32_t stage_mc(struct filter_s * f, struct filter_mc_s * fm, dot_mc_fn dot,
+                         float * x, uint16_t * src, uint32_t n) {
+    float w[(COEF_5_SIZE - 1 + BLOCK_SIZE) * MC_LANES];
+    uint32_t h = f->taps_length - 1U;
+    uint32_t n_out = 0;
+    jsdrv_memcpy(w, fm->history, h * MC_LANES * sizeof(float));
+    jsdrv_memcpy(w + h * MC_LANES, x, n * MC_LANES * sizeof(float));
+    uint32_t k = f->downsample_count - 1U;
+    for (; k < n; k += f->downsample_factor) {
+        dot(fm->taps, w + k * MC_LANES, f->taps_length, x + n_out * MC_LANES);
+        src[n_out++] = src[k];
+    }
+    f->downsample_count = k - n + 1U;
+    jsdrv_memcpy(fm->history, w + n * MC_LANES, h * MC_LANES * sizeof(float));
+    return n_out;
+}
+
+static uint32_t add_mc_stages(struct jsdrv_downsample_mc_s * self, float * x, uint16_t * src, uint32_t n) {
+    struct jsdrv_downsample_s * ds = self->ch[0];
+    dot_mc_fn dot = dot_mc_select();
+    ds->sample_count += n;
+    for (size_t filter_idx = 0; filter_idx < FILTER_COUNT; ++filter_idx) {
+        struct filter_s * f = &ds->filters[filter_idx];
+        if ((0 == f->taps_length) || (0 == n)) {
+            break;
+        }
+        n = stage_mc(f, &self->filters[filter_idx], dot, x, src, n);
+    }
+    return n;
+}
+
+static void mc_seed(struct jsdrv_downsample_mc_s * self, const float * frame) {
+    for (size_t i = 0; i < FILTER_COUNT; ++i) {
+        struct filter_s * f = &self->ch[0]->filters[i];
+        if (0 == f->taps_length) {
+            break;
+        }
+        for (size_t k = 0; k < (COEF_5_SIZE - 1U); ++k) {
+            jsdrv_memcpy(&self->filters[i].history[k * MC_LANES], frame, MC_LANES * sizeof(float));
+        }
+        f->downsample_count = f->downsample_factor;
+    }
+}
+
+uint32_t jsdrv_downsample_mc_add_f32_block(struct jsdrv_downsample_mc_s * self, uint64_t sample_id,
+                                           const float * const * x, uint32_t n,
+                                           float * const * y, uint32_t * n_out) {
+    float buf[BLOCK_SIZE * MC_LANES];
+    uint16_t src[BLOCK_SIZE];
+    uint32_t channels = self->channels;
+    uint32_t decimate_factor = self->ch[0]->decimate_factor;
+    uint32_t first = n;
+    uint32_t count = 0;
+    uint32_t k = 0;
+
+    if (!mc_is_lockstep(self)) {
+        for (uint32_t c = 0; c < channels; ++c) {
+            first = jsdrv_downsample_add_f32_block(self->ch[c], sample_id, x[c], n, y[c], n_out);
+        }
+        return first;
+    }
+
+    jsdrv_memset(buf, 0, sizeof(buf));  // unused lanes stay finite
+    while (k < n) {
+        uint32_t m;
+        if (0 == self->ch[0]->sample_count) {
+            if (0 != ((sample_id + k) % decimate_factor)) {
+                ++k;  // discard until aligned
+                continue;
+            }
+            for (uint32_t c = 0; c < channels; ++c) {
+                buf[c] = x[c][k];
+            }
+            mc_seed(self, buf);
+            m = 1;
+        } else {
+            m = n - k;
+            if (m > BLOCK_SIZE) {
+                m = BLOCK_SIZE;
+            }
+            for (uint32_t j = 0; j < m; ++j) {
+                for (uint32_t c = 0; c < channels; ++c) {
+                    buf[j * MC_LANES + c] = x[c][k + j];
+                }
+            }
+        }
+        for (uint32_t j = 0; j < m; ++j) {
+            src[j] = (uint16_t) j;
+        }
+        uint32_t m_out = add_mc_stages(self, buf, src, m);
+        if (m_out && (0 == count)) {
+            first = k + src[0];
+        }
+        for (uint32_t j = 0; j < m_out; ++j) {
+            for (uint32_t c = 0; c < channels; ++c) {
+                y[c][count + j] = buf[j * MC_LANES + c];
+            }
+        }
+        count += m_out;
+        k += m;
+    }
+    *n_out = count;
+    return first;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright 2022 Jetperch LLC
+ * Copyright 2022-2024 Jetperch LLC
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -14,127 +14,645 @@
  * limitations under the License.
  */
 
+/**
+ * @file
+ *
+ * @brief Emulated JS220 backend for load testing without hardware.
+ *
+ * Each emulated device is a low-level device with its own thread that
+ * speaks the JS220 USB protocol: control requests, bulk-out publish
+ * and memory frames, and bulk-in frames.  The upper-level device is the
+ * normal js220_usb.c, so the emulated sample stream exercises the same
+ * parsing, downsampling, buffering, and dispatch as real hardware.
+ */
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_INFO
 #include "jsdrv.h"
-#include "jsdrv_prv/cdef.h"
-#include "jsdrv/log.h"
-#include "jsdrv_prv/log.h"
 #include "jsdrv_prv/backend.h"
-#include "jsdrv_prv/assert.h"
-#include "js220_api.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/file_map.h"
 #include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/log.h"
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
-#include "jsdrv_prv/windows.h"
+#include "jsdrv/recorder.h"
+#include "jsdrv/time.h"
+#include "js220_api.h"
+#include "tinyprintf.h"
+#include <inttypes.h>
+#include <string.h>
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#endif
+
+
+#define DEVICES_MAX             (99U)
+#define RATE_DEFAULT            (2000000U)      // sample_id counter ticks per second
+#define FRAME_SIZE_U32          (JS220_USB_FRAME_LENGTH / sizeof(uint32_t))
+#define STREAM_DATA_SIZE        (JS220_PAYLOAD_SIZE_MAX - sizeof(uint32_t))  // after u32 sample_id
+#define TRANSFER_FRAMES         (32U)           // frames in each bulk-in message
+#define TRANSFERS_MAX           (8U)            // bulk-in messages held by the upper level
+#define INTERVAL_MS             (1U)
+#define TIMEMAP_INTERVAL        (JSDRV_TIME_SECOND)
+#define EMU_FW_VERSION          JSDRV_VERSION_ENCODE_U32(1, 2, 0)  // host-side downsampling
+#define EMU_HW_VERSION          JSDRV_VERSION_ENCODE_U32(1, 0, 0)
+#define EMU_FPGA_VERSION        JSDRV_VERSION_ENCODE_U32(1, 2, 0)
+#define REPLAY_HEADER_SIZE      (64U)           // see jsdrv_recorder_open()
+
+struct port_def_s {
+    const char * ctrl_topic;
+    uint8_t port_id;
+    uint32_t sample_id_per_frame;   // samples * decimate_factor
+};
 
-struct device_s {
-    struct jsdrv_list_s item;
+// The generated stream ports, see PORT_MAP in js220_usb.c.
+static const struct port_def_s PORTS[] = {
+    {"s/i/range/ctrl",  16 + 4,  (STREAM_DATA_SIZE * 2) * 1},   // u4
+    {"s/i/ctrl",        16 + 5,  (STREAM_DATA_SIZE / 4) * 2},   // f32, decimate 2
+    {"s/v/ctrl",        16 + 6,  (STREAM_DATA_SIZE / 4) * 2},
+    {"s/p/ctrl",        16 + 7,  (STREAM_DATA_SIZE / 4) * 2},
+    {"s/gpi/0/ctrl",    16 + 8,  (STREAM_DATA_SIZE * 8) * 1},   // u1
+    {"s/gpi/1/ctrl",    16 + 9,  (STREAM_DATA_SIZE * 8) * 1},
+    {"s/gpi/2/ctrl",    16 + 10, (STREAM_DATA_SIZE * 8) * 1},
+    {"s/gpi/3/ctrl",    16 + 11, (STREAM_DATA_SIZE * 8) * 1},
+    {"s/gpi/7/ctrl",    16 + 12, (STREAM_DATA_SIZE * 8) * 1},
 };
 
-#define DEVICES_MAX                     (256U)
+#define PORT_COUNT JSDRV_ARRAY_SIZE(PORTS)
+
+struct backend_s;
+
+struct dev_s {
+    struct jsdrvp_ll_device_s ll;
+    struct backend_s * backend;
+    jsdrv_thread_t thread;
+    bool thread_valid;
+    bool do_exit;
+    bool stream_open;
+    bool connected;
+    uint16_t frame_id;
+    uint32_t port_enable;               // bit for each PORTS index
+    uint64_t sample_id[PORT_COUNT];     // the next sample_id for each port
+    int64_t t0;                         // UTC time for sample_id 0
+    int64_t timemap_next;
+    struct jsdrvp_msg_s * msg;          // the bulk-in message being filled
+    uint32_t transfers;                 // bulk-in messages held by the upper level
+    uint64_t stream_frames;             // for induced skips and duplicates
+    uint64_t overflows;
+    uint64_t replay_offset;             // the next capture record
+    uint32_t replay_frame;              // the next frame in the capture record
+    int64_t replay_t0;                  // UTC time when the replay started, 0 before
+    int64_t replay_capture_t0;          // the capture time of the first replayed transfer
+    uint64_t replay_frames;
+    bool replay_done;
+};
 
 struct backend_s {
     struct jsdrvbk_s backend;
     struct jsdrv_context_s * context;
-    bool do_exit;
-    HANDLE thread;
-    DWORD thread_id;
+    uint32_t rate;      // 0 for as fast as possible
+    uint32_t skip;      // drop every N stream frames, 0 to disable
+    uint32_t dup;       // repeat every N stream frames, 0 to disable
+    uint32_t device_count;
+    struct dev_s * devices;
+    struct jsdrv_file_map_s * replay_map;   // NULL unless JSDRV_ARG_EMULATION_REPLAY
+    const uint8_t * replay;                 // the capture file contents
+    uint64_t replay_size;
+    uint16_t replay_device_id;              // the replayed capture device
+    uint8_t data[PORT_COUNT][STREAM_DATA_SIZE];
 };
 
-static bool backend_handle_msg(struct backend_s * s, struct jsdrvp_msg_s * msg) {
-    bool rv = true;
-    if (!msg) {
-        return false;
+static uint32_t arg_u32(struct jsdrv_context_s * context, const char * topic, uint32_t default_value) {
+    struct jsdrv_union_s v;
+    if ((0 == jsdrvp_arg_get(context, topic, &v)) && (0 == jsdrv_union_as_type(&v, JSDRV_UNION_U32))) {
+        return v.value.u32;
     }
-    if (0 == strcmp(JSDRV_MSG_FINALIZE, msg->topic)) {
-        JSDRV_LOGI("winusb backend finalize");
-        s->do_exit = true;
-        rv = false;
-    } else {
-        // todo add device
-        // todo remove device
-        JSDRV_LOGE("backend_handle_msg unsupported %s", msg->topic);
+    return default_value;
+}
+
+static void data_initialize(struct backend_s * s) {
+    for (uint32_t idx = 0; idx < PORT_COUNT; ++idx) {
+        uint8_t * p = s->data[idx];
+        float f;
+        switch (PORTS[idx].port_id - 16) {
+            case 4: memset(p, 0x33, STREAM_DATA_SIZE); continue;  // range 3
+            case 5: f = 0.001f; break;
+            case 6: f = 3.3f; break;
+            case 7: f = 0.0033f; break;
+            default: memset(p, 0x0f, STREAM_DATA_SIZE); continue;  // square wave
+        }
+        for (uint32_t k = 0; k < STREAM_DATA_SIZE; k += sizeof(float)) {
+            memcpy(p + k, &f, sizeof(float));
+        }
     }
-    jsdrvp_msg_free(s->context, msg);
-    return rv;
 }
 
-static void backend_ready(struct backend_s * s) {
-    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(s->context, JSDRV_MSG_INITIALIZE, &jsdrv_union_i32(0));
-    msg->payload.str[0] = s->backend.prefix;
-    jsdrvp_backend_send(s->context, msg);
+static void transfer_send(struct dev_s * d) {
+    if (d->msg) {
+        d->msg->extra.bkusb_stream.time = jsdrv_time_utc();
+        msg_queue_push(d->ll.rsp_q, d->msg);
+        d->msg = NULL;
+        ++d->transfers;
+    }
+}
+
+// Get the next bulk-in frame and fill in its header.
+static uint32_t * frame_alloc(struct dev_s * d, uint8_t port_id, uint16_t length) {
+    if (d->msg && (d->msg->value.size >= (TRANSFER_FRAMES * JS220_USB_FRAME_LENGTH))) {
+        transfer_send(d);
+    }
+    struct jsdrvp_msg_s * m = d->msg;
+    if (NULL == m) {
+        m = jsdrvp_msg_alloc_data_sz(d->backend->context, JSDRV_USBBK_MSG_STREAM_IN_DATA,
+                                     TRANSFER_FRAMES * JS220_USB_FRAME_LENGTH);
+        m->extra.bkusb_stream.endpoint = JS220_USB_EP_BULK_IN;
+        d->msg = m;
+    }
+    uint32_t * p_u32 = (uint32_t *) (m->payload.bin + m->value.size);
+    p_u32[0] = js220_frame_hdr_pack(d->frame_id++, length, port_id);
+    m->value.size += JS220_USB_FRAME_LENGTH;
+    return p_u32;
+}
+
+static void send_connect(struct dev_s * d) {
+    struct js220_port0_msg_s * m = (struct js220_port0_msg_s *) frame_alloc(d, 0, JS220_PORT0_CONNECT_LENGTH);
+    m->port0_hdr.op = JS220_PORT0_OP_CONNECT;
+    m->port0_hdr.status = 0;
+    m->port0_hdr.arg = 0;
+    m->payload.connect.protocol_version = JS220_PROTOCOL_VERSION_U32;
+    m->payload.connect.app_id = 0;
+    m->payload.connect.fw_version = EMU_FW_VERSION;
+    m->payload.connect.hw_version = EMU_HW_VERSION;
+    m->payload.connect.fpga_version = EMU_FPGA_VERSION;
 }
 
-static DWORD WINAPI backend_thread(LPVOID lpParam) {
-    struct backend_s * s = (struct backend_s *) lpParam;
-    JSDRV_LOGI("emulated backend_thread started");
+static void send_timemap(struct dev_s * d, int64_t t_now) {
+    d->timemap_next = t_now + TIMEMAP_INTERVAL;
+    if (d->backend->replay) {
+        return;  // replay the captured time map
+    }
+    uint32_t rate = d->backend->rate ? d->backend->rate : RATE_DEFAULT;
+    struct js220_port0_msg_s * m = (struct js220_port0_msg_s *) frame_alloc(d, 0, JS220_PORT0_TIMEMAP_LENGTH);
+    m->port0_hdr.op = JS220_PORT0_OP_TIMEMAP;
+    m->port0_hdr.status = 0;
+    m->port0_hdr.arg = 0;
+    m->payload.timemap.rsv0_u64 = 0;
+    m->payload.timemap.utc = t_now;
+    m->payload.timemap.counter = (uint64_t) (JSDRV_TIME_TO_F64(t_now - d->t0) * rate);
+    m->payload.timemap.counter_rate = ((uint64_t) rate) << 32;
+}
 
-    HANDLE handles[1];
-    handles[0] = msg_queue_handle_get(s->backend.cmd_q);
-    backend_ready(s);
+static void send_publish_u32(struct dev_s * d, const char * topic, uint8_t type, uint32_t value) {
+    uint16_t length = (uint16_t) (sizeof(struct js220_publish_s) + sizeof(uint64_t));
+    struct js220_publish_s * p = (struct js220_publish_s *) (frame_alloc(d, 1, length) + 1);
+    memset(p, 0, length);
+    jsdrv_cstr_copy(p->topic, topic, sizeof(p->topic));
+    p->type = type;
+    memcpy(p->data, &value, sizeof(value));
+}
 
-    while (!s->do_exit) {
-        WaitForMultipleObjects(1, handles, false, 5000);
-        if (WAIT_OBJECT_0 == WaitForSingleObject(handles[0], 0)) {
-            ResetEvent(handles[0]);
-            while (1) {
-                struct jsdrvp_msg_s * msg = msg_queue_pop_immediate(s->backend.cmd_q);
-                if (!backend_handle_msg(s, msg)) {
-                    break;
+static void port_enable(struct dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
+    bool enable = false;
+    jsdrv_union_to_bool(value, &enable);
+    for (uint32_t idx = 0; idx < PORT_COUNT; ++idx) {
+        if (0 == strcmp(PORTS[idx].ctrl_topic, topic)) {
+            uint32_t mask = 1U << idx;
+            if (enable && !(d->port_enable & mask)) {
+                // start now, aligned to the frame
+                uint64_t sample_id = 0;
+                if (d->backend->rate) {
+                    sample_id = (uint64_t) (JSDRV_TIME_TO_F64(jsdrv_time_utc() - d->t0) * d->backend->rate);
+                } else {
+                    for (uint32_t k = 0; k < PORT_COUNT; ++k) {
+                        if (d->sample_id[k] > sample_id) {
+                            sample_id = d->sample_id[k];
+                        }
+                    }
                 }
+                d->sample_id[idx] = sample_id - (sample_id % PORTS[idx].sample_id_per_frame);
+                d->port_enable |= mask;
+            } else if (!enable) {
+                d->port_enable &= ~mask;
             }
+            return;
+        }
+    }
+}
+
+static void handle_publish(struct dev_s * d, const struct js220_publish_s * p, uint16_t length) {
+    char topic[JS220_TOPIC_LENGTH + 1];
+    struct jsdrv_union_s value = jsdrv_union_null();
+    if (length < sizeof(struct js220_publish_s)) {
+        return;
+    }
+    jsdrv_cstr_copy(topic, p->topic, sizeof(topic));
+    if ((length >= (sizeof(struct js220_publish_s) + sizeof(uint64_t)))
+            && (p->type != JSDRV_UNION_STR) && (p->type != JSDRV_UNION_JSON) && (p->type != JSDRV_UNION_BIN)) {
+        value.type = p->type;
+        memcpy(&value.value.u64, p->data, sizeof(uint64_t));
+    }
+    JSDRV_LOGD1("%s publish %s", d->ll.prefix, topic);
+    if (0 == strcmp(JS220_TOPIC_PING, topic)) {
+        send_publish_u32(d, JS220_TOPIC_PONG, JSDRV_UNION_U32, value.value.u32);
+    } else if ((0 == strcmp("$", topic)) || (0 == strcmp("?", topic))) {
+        // no metadata or retained values
+    } else {
+        if (jsdrv_cstr_ends_with(topic, "/ctrl")) {
+            port_enable(d, topic, &value);
+        }
+        size_t sz = strlen(topic);
+        if (sz < (JS220_TOPIC_LENGTH - 1)) {
+            topic[sz++] = JSDRV_TOPIC_SUFFIX_RETURN_CODE;
+            topic[sz] = 0;
+            send_publish_u32(d, topic, JSDRV_UNION_I32, 0);
+        }
+    }
+}
+
+static void handle_mem(struct dev_s * d, const struct js220_port3_msg_s * m) {
+    struct js220_port3_msg_s * r = (struct js220_port3_msg_s *) frame_alloc(d, 3, sizeof(struct js220_port3_header_s));
+    memset(&r->hdr, 0, sizeof(r->hdr));
+    r->hdr.op = JS220_PORT3_OP_ACK;
+    r->hdr.region = m->hdr.region;
+    r->hdr.arg = m->hdr.op;
+    r->hdr.status = JSDRV_ERROR_NOT_SUPPORTED;
+}
 
+static void handle_bulk_out(struct dev_s * d, struct jsdrvp_msg_s * msg) {
+    uint32_t frames = msg->value.size / JS220_USB_FRAME_LENGTH;
+    uint32_t * p_u32 = (uint32_t *) msg->value.value.bin;
+    if (msg->value.size % JS220_USB_FRAME_LENGTH) {
+        ++frames;  // the final frame may be short
+    }
+    for (uint32_t i = 0; i < frames; ++i, p_u32 += FRAME_SIZE_U32) {
+        uint16_t length = js220_frame_hdr_extract_length(p_u32[0]);
+        switch (js220_frame_hdr_extract_port_id(p_u32[0])) {
+            case 0: break;  // timesync response, ignore
+            case 1: handle_publish(d, (const struct js220_publish_s *) (p_u32 + 1), length); break;
+            case 3: handle_mem(d, (const struct js220_port3_msg_s *) p_u32); break;
+            default: break;
         }
     }
+    msg_queue_push(d->ll.rsp_q, msg);
+}
 
-    JSDRV_LOGI("emulated backend_thread done");
-    return 0;
+static void ctrl_in(struct dev_s * d, struct jsdrvp_msg_s * msg) {
+    uint8_t op = msg->extra.bkusb_ctrl.setup.s.bRequest;
+    msg->payload.bin[0] = 0;
+    msg->value = jsdrv_union_bin(msg->payload.bin, 1);
+    msg->extra.bkusb_ctrl.status = 0;
+    msg_queue_push(d->ll.rsp_q, msg);
+    if (JS220_CTRL_OP_CONNECT == op) {
+        int64_t t_now = jsdrv_time_utc();
+        d->connected = true;
+        d->frame_id = 0;
+        d->port_enable = 0;
+        memset(d->sample_id, 0, sizeof(d->sample_id));
+        d->t0 = t_now;
+        d->replay_offset = REPLAY_HEADER_SIZE;
+        d->replay_frame = 0;
+        d->replay_t0 = 0;
+        d->replay_frames = 0;
+        d->replay_done = false;
+        send_connect(d);
+        send_timemap(d, t_now);
+    } else if (JS220_CTRL_OP_DISCONNECT == op) {
+        d->connected = false;
+        d->port_enable = 0;
+    }
 }
 
-static void backend_finalize(struct jsdrvbk_s * backend) {
-    if (backend) {
-        struct backend_s * s = (struct backend_s *) backend;
-        JSDRV_LOGI("finalize emulated backend");
-        if (s->thread) {
-            jsdrvp_send_finalize_msg(s->context, s->backend.cmd_q, JSDRV_MSG_FINALIZE);
-            // and wait for thread to exit.
-            if (WAIT_OBJECT_0 != WaitForSingleObject(s->thread, 1000)) {
-                JSDRV_LOGE("emulated thread not closed cleanly.");
+// Skip ahead by whole frames when the upper level falls behind, like a device overflow.
+static void stream_overflow(struct dev_s * d, uint64_t sample_id) {
+    for (uint32_t idx = 0; idx < PORT_COUNT; ++idx) {
+        uint32_t inc = PORTS[idx].sample_id_per_frame;
+        if ((d->port_enable & (1U << idx)) && (d->sample_id[idx] < sample_id)) {
+            d->sample_id[idx] += ((sample_id - d->sample_id[idx] + inc - 1) / inc) * inc;
+        }
+    }
+    ++d->overflows;
+    JSDRV_LOGD1("%s overflow %" PRIu64, d->ll.prefix, d->overflows);
+}
+
+static void stream_frame(struct dev_s * d, uint32_t idx) {
+    struct backend_s * s = d->backend;
+    ++d->stream_frames;
+    if (s->skip && (0 == (d->stream_frames % s->skip))) {
+        d->sample_id[idx] += PORTS[idx].sample_id_per_frame;  // sample_id gap, frame_id contiguous
+        return;
+    }
+    uint32_t repeat = (s->dup && (0 == (d->stream_frames % s->dup))) ? 2 : 1;
+    for (uint32_t k = 0; k < repeat; ++k) {
+        uint32_t * p_u32 = frame_alloc(d, PORTS[idx].port_id, JS220_PAYLOAD_SIZE_MAX);
+        p_u32[1] = (uint32_t) d->sample_id[idx];
+        memcpy(p_u32 + 2, s->data[idx], STREAM_DATA_SIZE);
+    }
+    d->sample_id[idx] += PORTS[idx].sample_id_per_frame;
+}
+
+static bool transfers_full(struct dev_s * d) {
+    return ((NULL == d->msg) || (d->msg->value.size >= (TRANSFER_FRAMES * JS220_USB_FRAME_LENGTH)))
+        && (d->transfers >= TRANSFERS_MAX);
+}
+
+// Copy a captured frame for an enabled port, along with captured time maps.
+static void replay_frame(struct dev_s * d, const uint32_t * frame) {
+    uint8_t port_id = js220_frame_hdr_extract_port_id(frame[0]);
+    uint16_t length = js220_frame_hdr_extract_length(frame[0]);
+    if (0 == port_id) {
+        const struct js220_port0_msg_s * m = (const struct js220_port0_msg_s *) frame;
+        if (m->port0_hdr.op != JS220_PORT0_OP_TIMEMAP) {
+            return;
+        }
+    } else {
+        uint32_t idx = 0;
+        while ((idx < PORT_COUNT) && (PORTS[idx].port_id != port_id)) {
+            ++idx;
+        }
+        if ((idx >= PORT_COUNT) || !(d->port_enable & (1U << idx))) {
+            return;
+        }
+    }
+    uint32_t * p_u32 = frame_alloc(d, port_id, length);  // renumber frame_id
+    memcpy(p_u32 + 1, frame + 1, JS220_USB_FRAME_LENGTH - sizeof(uint32_t));
+    ++d->replay_frames;
+}
+
+// Replay captured bulk-in transfers, see JSDRV_ARG_EMULATION_REPLAY.
+static void replay_process(struct dev_s * d, int64_t t_now) {
+    struct backend_s * s = d->backend;
+    while (!d->replay_done) {
+        const struct jsdrv_recorder_record_header_s * hdr =
+            (const struct jsdrv_recorder_record_header_s *) (s->replay + d->replay_offset);
+        if (((d->replay_offset + sizeof(*hdr)) > s->replay_size) || (hdr->length < (sizeof(*hdr) + hdr->size))
+                || (hdr->length & 7) || ((d->replay_offset + hdr->length) > s->replay_size)) {
+            double dt = d->replay_t0 ? JSDRV_TIME_TO_F64(t_now - d->replay_t0) : 0.0;
+            JSDRV_LOGI("%s replay done: %" PRIu64 " frames in %.3f s", d->ll.prefix, d->replay_frames, dt);
+            d->replay_done = true;
+            break;
+        }
+        const struct jsdrv_recorder_usb_s * usb = (const struct jsdrv_recorder_usb_s *) (hdr + 1);
+        if ((hdr->type == JSDRV_RECORDER_TYPE_USB_BULK_IN) && (hdr->id == s->replay_device_id)
+                && (hdr->size >= sizeof(*usb))) {
+            const uint32_t * p_u32 = (const uint32_t *) (usb + 1);
+            uint32_t frames = (uint32_t) ((hdr->size - sizeof(*usb)) / JS220_USB_FRAME_LENGTH);
+            if (0 == d->replay_t0) {
+                d->replay_t0 = t_now;
+                d->replay_capture_t0 = usb->time;
+            } else if (s->rate && ((usb->time - d->replay_capture_t0) > (t_now - d->replay_t0))) {
+                break;  // captured pace
+            }
+            for (; d->replay_frame < frames; ++d->replay_frame) {
+                if (transfers_full(d)) {
+                    return;  // wait for the upper level
+                }
+                replay_frame(d, p_u32 + d->replay_frame * FRAME_SIZE_U32);
+            }
+        }
+        d->replay_offset += hdr->length;
+        d->replay_frame = 0;
+    }
+}
+
+static void stream_process(struct dev_s * d) {
+    struct backend_s * s = d->backend;
+    if (!d->stream_open || !d->connected) {
+        return;
+    }
+    int64_t t_now = jsdrv_time_utc();
+    if (t_now >= d->timemap_next) {
+        send_timemap(d, t_now);
+    }
+    if (s->replay) {
+        if (d->port_enable) {
+            replay_process(d, t_now);
+        }
+        transfer_send(d);
+        return;
+    }
+    uint64_t target = UINT64_MAX;
+    if (s->rate) {
+        target = (uint64_t) (JSDRV_TIME_TO_F64(t_now - d->t0) * s->rate);
+    }
+    while (d->port_enable) {
+        // emit frames in sample_id order over all enabled ports
+        uint32_t idx = PORT_COUNT;
+        for (uint32_t k = 0; k < PORT_COUNT; ++k) {
+            if ((d->port_enable & (1U << k)) && ((idx == PORT_COUNT) || (d->sample_id[k] < d->sample_id[idx]))) {
+                idx = k;
             }
-            CloseHandle(s->thread);
-            s->thread = NULL;
         }
-        if (s->backend.cmd_q) {
-            msg_queue_finalize(s->backend.cmd_q);
-            s->backend.cmd_q = NULL;
+        if (d->sample_id[idx] >= target) {
+            break;
+        } else if (transfers_full(d)) {
+            if (s->rate) {
+                stream_overflow(d, target);
+            }
+            break;
         }
-        jsdrv_free(s);
+        stream_frame(d, idx);
     }
+    transfer_send(d);
+}
+
+static void device_handle_msg(struct dev_s * d, struct jsdrvp_msg_s * msg) {
+    struct jsdrv_context_s * context = d->backend->context;
+    if (0 == strcmp(JSDRV_USBBK_MSG_STREAM_IN_DATA, msg->topic)) {
+        --d->transfers;  // returned by the upper level
+        jsdrvp_msg_free(context, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_OUT_DATA, msg->topic)) {
+        handle_bulk_out(d, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_CTRL_IN, msg->topic)) {
+        ctrl_in(d, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_CTRL_OUT, msg->topic)) {
+        msg->extra.bkusb_ctrl.status = 0;
+        msg_queue_push(d->ll.rsp_q, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_STREAM_OPEN, msg->topic)) {
+        d->stream_open = true;
+        msg->value = jsdrv_union_i32(0);
+        msg_queue_push(d->ll.rsp_q, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_IN_STREAM_CLOSE, msg->topic)) {
+        d->stream_open = false;
+        msg->value = jsdrv_union_i32(0);
+        msg_queue_push(d->ll.rsp_q, msg);
+    } else if (0 == strcmp(JSDRV_MSG_FINALIZE, msg->topic)) {
+        d->do_exit = true;
+        jsdrvp_msg_free(context, msg);
+    } else if ((0 == strcmp(JSDRV_MSG_OPEN, msg->topic)) || (0 == strcmp(JSDRV_MSG_CLOSE, msg->topic))) {
+        JSDRV_LOGI("%s %s", d->ll.prefix, msg->topic);
+        d->stream_open = false;
+        d->connected = false;
+        d->port_enable = 0;
+        msg->value = jsdrv_union_i32(0);
+        msg_queue_push(d->ll.rsp_q, msg);
+    } else if (jsdrv_cstr_starts_with(msg->topic, JSDRV_USBBK_MSG_CONFIG_PREFIX)) {
+        msg->value = jsdrv_union_i32(0);  // accept and ignore
+        msg_queue_push(d->ll.rsp_q, msg);
+    } else {
+        JSDRV_LOGW("%s unsupported topic %s", d->ll.prefix, msg->topic);
+        msg->value = jsdrv_union_i32(JSDRV_ERROR_PARAMETER_INVALID);
+        msg_queue_push(d->ll.rsp_q, msg);
+    }
+}
+
+static THREAD_RETURN_TYPE device_thread(THREAD_ARG_TYPE lpParam) {
+    struct dev_s * d = (struct dev_s *) lpParam;
+    struct jsdrv_context_s * context = d->backend->context;
+    struct jsdrvp_msg_s * msg;
+    JSDRV_LOGI("emulated device thread start %s", d->ll.prefix);
+#if _WIN32
+    HANDLE handle = msg_queue_handle_get(d->ll.cmd_q);
+#else
+    struct pollfd fds;
+    fds.fd = msg_queue_handle_get(d->ll.cmd_q);
+    fds.events = POLLIN;
+#endif
+    jsdrvp_thread_configure(context, JSDRVP_THREAD_BACKEND, "jsdrv_emulated");
+    jsdrvp_msg_cache_attach(context);
+    while (!d->do_exit) {
+        bool streaming = d->stream_open && d->connected && d->port_enable && !d->replay_done;
+        uint32_t timeout_ms = (streaming && (d->backend->rate || (d->transfers < TRANSFERS_MAX))) ? INTERVAL_MS : 100;
+#if _WIN32
+        WaitForSingleObject(handle, timeout_ms);
+#else
+        poll(&fds, 1, (int) timeout_ms);
+#endif
+        while (!d->do_exit && (NULL != (msg = msg_queue_pop_immediate(d->ll.cmd_q)))) {
+            device_handle_msg(d, msg);
+        }
+        if (!d->do_exit) {
+            stream_process(d);
+            transfer_send(d);  // control responses
+        }
+    }
+    if (d->msg) {
+        jsdrvp_msg_free(context, d->msg);
+        d->msg = NULL;
+    }
+    jsdrvp_msg_cache_detach(context);
+    JSDRV_LOGI("emulated device thread exit %s", d->ll.prefix);
+    THREAD_RETURN();
+}
+
+static void device_add_announce(struct backend_s * s, struct dev_s * d) {
+    JSDRV_LOGI("device_add_announce %s", d->ll.prefix);
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc(s->context);
+    jsdrv_cstr_copy(msg->topic, JSDRV_MSG_DEVICE_ADD, sizeof(msg->topic));
+    msg->value.type = JSDRV_UNION_BIN;
+    msg->value.app = JSDRV_PAYLOAD_TYPE_DEVICE;
+    msg->value.value.bin = (const uint8_t *) &msg->payload.device;
+    msg->payload.device = d->ll;
+    jsdrvp_backend_send(s->context, msg);
+}
+
+static void finalize(struct jsdrvbk_s * backend) {
+    struct backend_s * s = (struct backend_s *) backend;
+    JSDRV_LOGI("emulated backend finalize");
+    for (uint32_t i = 0; i < s->device_count; ++i) {
+        struct dev_s * d = &s->devices[i];
+        if (d->thread_valid) {
+            jsdrvp_send_finalize_msg(s->context, d->ll.cmd_q, "");
+            jsdrv_thread_join(&d->thread, 1000);
+            d->thread_valid = false;
+        }
+        msg_queue_finalize(d->ll.cmd_q);
+        msg_queue_finalize(d->ll.rsp_q);
+    }
+    msg_queue_finalize(s->backend.cmd_q);
+    jsdrv_file_map_close(s->replay_map);
+    jsdrv_free(s->devices);
+    jsdrv_free(s);
+}
+
+// Find the first captured JS220 in the JSDRV_ARG_EMULATION_REPLAY file.
+static int32_t replay_open(struct backend_s * s) {
+    struct jsdrv_union_s v;
+    void * ptr = NULL;
+    if (jsdrvp_arg_get(s->context, JSDRV_ARG_EMULATION_REPLAY, &v)) {
+        return 0;
+    }
+    if (v.type != JSDRV_UNION_STR) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    int32_t rc = jsdrv_file_map_open_existing(v.value.str, &s->replay_map, &ptr, &s->replay_size);
+    if (rc) {
+        JSDRV_LOGE("replay: could not open %s", v.value.str);
+        return rc;
+    }
+    const uint8_t * p = (const uint8_t *) ptr;
+    if ((s->replay_size < REPLAY_HEADER_SIZE) || (0 != memcmp(p, "jsdrvrec", 8))) {
+        JSDRV_LOGE("replay: invalid file %s", v.value.str);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint64_t offset = REPLAY_HEADER_SIZE;
+    while ((offset + sizeof(struct jsdrv_recorder_record_header_s)) <= s->replay_size) {
+        const struct jsdrv_recorder_record_header_s * hdr = (const struct jsdrv_recorder_record_header_s *) (p + offset);
+        if ((hdr->length < (sizeof(*hdr) + hdr->size)) || (hdr->length & 7)
+                || ((offset + hdr->length) > s->replay_size)) {
+            break;
+        }
+        if ((hdr->type == JSDRV_RECORDER_TYPE_USB_DEVICE) && hdr->size
+                && (NULL != memchr(hdr + 1, 0, hdr->size)) && (NULL != strstr((const char *) (hdr + 1), "/js220/"))) {
+            JSDRV_LOGI("replay: %s from %s", (const char *) (hdr + 1), v.value.str);
+            s->replay = p;
+            s->replay_device_id = hdr->id;
+            return 0;
+        }
+        offset += hdr->length;
+    }
+    JSDRV_LOGE("replay: no JS220 capture in %s", v.value.str);
+    return JSDRV_ERROR_NOT_FOUND;
 }
 
 int32_t jsdrv_emulation_backend_factory(struct jsdrv_context_s * context, struct jsdrvbk_s ** backend) {
-    struct backend_s * self = jsdrv_alloc_clr(sizeof(struct backend_s));
-    self->context = context;
-    self->backend.prefix = 'z';
-    self->backend.finalize = backend_finalize;
-    self->backend.cmd_q = msg_queue_init();
-
-    self->thread = CreateThread(
-            NULL,                   // default security attributes
-            0,                      // use default stack size
-            backend_thread,         // thread function name
-            self,                   // argument to thread function
-            0,                      // use default creation flags
-            &self->thread_id);      // returns the thread identifier
-    if (self->thread == NULL) {
-        JSDRV_LOGE("CreateThread failed");
-        backend_finalize(&self->backend);
-        return JSDRV_ERROR_UNSPECIFIED;
-    }
-    if (!SetThreadPriority(self->thread, THREAD_PRIORITY_ABOVE_NORMAL)) {
-        WINDOWS_LOGE("%s", "SetThreadPriority");
-    }
-
-    *backend = &self->backend;
+    struct backend_s * s = jsdrv_alloc_clr(sizeof(struct backend_s));
+    s->context = context;
+    s->backend.prefix = 'z';
+    s->backend.finalize = finalize;
+    s->backend.cmd_q = msg_queue_init();
+    s->rate = arg_u32(context, JSDRV_ARG_EMULATION_RATE, RATE_DEFAULT);
+    s->skip = arg_u32(context, JSDRV_ARG_EMULATION_SKIP, 0);
+    s->dup = arg_u32(context, JSDRV_ARG_EMULATION_DUP, 0);
+    s->device_count = arg_u32(context, JSDRV_ARG_EMULATION_DEVICES, 0);
+    if (s->device_count > DEVICES_MAX) {
+        JSDRV_LOGW("emulated devices %u limited to %u", (unsigned int) s->device_count, DEVICES_MAX);
+        s->device_count = DEVICES_MAX;
+    }
+    JSDRV_LOGI("jsdrv_emulation_backend_factory devices=%u, rate=%u, skip=%u, dup=%u",
+               (unsigned int) s->device_count, (unsigned int) s->rate,
+               (unsigned int) s->skip, (unsigned int) s->dup);
+    data_initialize(s);
+    s->devices = jsdrv_alloc_clr((s->device_count ? s->device_count : 1) * sizeof(struct dev_s));
+    int32_t rc = replay_open(s);
+    if (rc) {
+        finalize(&s->backend);
+        return rc;
+    }
+
+    for (uint32_t i = 0; i < s->device_count; ++i) {
+        struct dev_s * d = &s->devices[i];
+        d->backend = s;
+        tfp_snprintf(d->ll.prefix, sizeof(d->ll.prefix), "%c/js220/EMU%03u", s->backend.prefix, (unsigned int) (i + 1));
+        d->ll.cmd_q = msg_queue_init();
+        d->ll.rsp_q = msg_queue_init();
+        if (jsdrv_thread_create(&d->thread, device_thread, d, 1)) {
+            JSDRV_LOGE("emulated device thread create failed");
+            finalize(&s->backend);
+            return JSDRV_ERROR_UNSPECIFIED;
+        }
+        d->thread_valid = true;
+        device_add_announce(s, d);
+    }
+
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(context, JSDRV_MSG_INITIALIZE, &jsdrv_union_i32(0));
+    msg->payload.str[0] = s->backend.prefix;
+    jsdrvp_backend_send(context, msg);
+    *backend = &s->backend;
     return 0;
-}
\ No newline at end of file
+}
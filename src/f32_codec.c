@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/f32_codec.h"
+#include <string.h>
+
+
+static inline uint32_t zigzag(uint32_t d) {
+    return (d << 1) ^ (0U - (d >> 31));
+}
+
+static inline uint32_t unzigzag(uint32_t z) {
+    return (z >> 1) ^ (0U - (z & 1));
+}
+
+static inline uint8_t width_u32(uint32_t x) {
+    uint8_t w = 0;
+    for (; (w < 32) && (x >> w); ++w) {
+        // count
+    }
+    return w;
+}
+
+uint32_t jsdrv_f32_codec_encode(uint8_t * dst, const float * src, uint32_t n) {
+    uint32_t z[JSDRV_F32_CODEC_GROUP];
+    uint8_t * p = dst;
+    uint32_t prev = 0;
+    if (n) {
+        memcpy(&prev, src, sizeof(prev));  // the first sample starts the differences
+        memcpy(p, &prev, sizeof(prev));
+        p += sizeof(prev);
+    }
+    for (uint32_t i = 0; i < n; i += JSDRV_F32_CODEC_GROUP) {
+        uint32_t count = n - i;
+        if (count > JSDRV_F32_CODEC_GROUP) {
+            count = JSDRV_F32_CODEC_GROUP;
+        }
+        uint32_t any = 0;
+        for (uint32_t j = 0; j < count; ++j) {
+            uint32_t x;
+            memcpy(&x, src + i + j, sizeof(x));
+            z[j] = zigzag(x - prev);
+            any |= z[j];
+            prev = x;
+        }
+        uint8_t width = width_u32(any);
+        *p++ = width;
+        uint64_t acc = 0;
+        uint32_t bits = 0;
+        for (uint32_t j = 0; width && (j < count); ++j) {
+            acc |= ((uint64_t) z[j]) << bits;
+            bits += width;
+            while (bits >= 8) {
+                *p++ = (uint8_t) acc;
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits) {
+            *p++ = (uint8_t) acc;
+        }
+    }
+    return (uint32_t) (p - dst);
+}
+
+uint32_t jsdrv_f32_codec_decode(float * dst, const uint8_t * src, uint32_t n) {
+    const uint8_t * p = src;
+    uint32_t prev = 0;
+    if (n) {
+        memcpy(&prev, p, sizeof(prev));
+        p += sizeof(prev);
+    }
+    for (uint32_t i = 0; i < n; i += JSDRV_F32_CODEC_GROUP) {
+        uint32_t count = n - i;
+        if (count > JSDRV_F32_CODEC_GROUP) {
+            count = JSDRV_F32_CODEC_GROUP;
+        }
+        uint8_t width = *p++;
+        if (width > 32) {
+            width = 32;  // corrupt
+        }
+        uint32_t mask = (width >= 32) ? 0xffffffffU : ((1U << width) - 1);
+        uint64_t acc = 0;
+        uint32_t bits = 0;
+        for (uint32_t j = 0; j < count; ++j) {
+            while (bits < width) {
+                acc |= ((uint64_t) *p++) << bits;
+                bits += 8;
+            }
+            uint32_t x = prev + unzigzag(((uint32_t) acc) & mask);
+            acc >>= width;
+            bits -= width;
+            memcpy(dst + i + j, &x, sizeof(x));
+            prev = x;
+        }
+    }
+    return (uint32_t) (p - src);
+}
+
+bool jsdrv_f32_codec_check(const uint8_t * src, uint32_t size, uint32_t n) {
+    uint64_t offset = n ? sizeof(uint32_t) : 0;
+    for (uint32_t i = 0; i < n; i += JSDRV_F32_CODEC_GROUP) {
+        uint32_t count = n - i;
+        if (count > JSDRV_F32_CODEC_GROUP) {
+            count = JSDRV_F32_CODEC_GROUP;
+        }
+        if (offset >= size) {
+            return false;
+        }
+        uint8_t width = src[offset++];
+        if (width > 32) {
+            return false;
+        }
+        offset += (count * width + 7) / 8;
+    }
+    return offset <= size;
+}
@@ -0,0 +1,839 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define F32_OPS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define F32_OPS_TARGET(isa_)
+#else
+#define F32_OPS_TARGET(isa_) __attribute__((target(isa_)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define F32_OPS_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+struct ops_s {
+    int32_t isa;
+    void (*scale)(float * x, float scale, uint32_t length);
+    void (*scale_copy)(float * y, const float * x, float scale, uint32_t length);
+    void (*scale_copy2)(float * y1, float * y2, const float * x, float scale, uint32_t length);
+    void (*mult)(float * y, const float * a, const float * b, uint32_t length);
+    void (*from_i16)(float * y, const int16_t * x, float offset, float gain, uint32_t length);
+    void (*scale_f64)(double * y, const float * x, double scale, uint32_t length);
+    double (*sum_sq)(const float * x, uint32_t length, uint32_t * valid);
+    double (*sum_min_max)(const float * x, uint32_t length, uint32_t * valid, float * min, float * max);
+    double (*sum_sq_dev)(const float * x, uint32_t length, double mean);
+    uint32_t (*find_gt)(const float * x, uint32_t length, float threshold);
+    uint32_t (*find_le)(const float * x, uint32_t length, float threshold);
+};
+
+// A single pointer so that concurrent first use resolves consistently.
+static const struct ops_s * volatile ops_ = NULL;
+
+
+static void scale_scalar(float * x, float scale, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        x[i] *= scale;
+    }
+}
+
+static void scale_copy_scalar(float * y, const float * x, float scale, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        y[i] = x[i] * scale;
+    }
+}
+
+static void scale_copy2_scalar(float * y1, float * y2, const float * x, float scale, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        float v = x[i] * scale;
+        y1[i] = v;
+        y2[i] = v;
+    }
+}
+
+static void mult_scalar(float * y, const float * a, const float * b, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        y[i] = a[i] * b[i];
+    }
+}
+
+static void from_i16_scalar(float * y, const int16_t * x, float offset, float gain, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        y[i] = ((float) x[i] + offset) * gain;
+    }
+}
+
+static void scale_f64_scalar(double * y, const float * x, double scale, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        double v = (x[i] == x[i]) ? (double) x[i] : 0.0;  // NaN != NaN
+        y[i] = v * scale;
+    }
+}
+
+static double sum_sq_scalar(const float * x, uint32_t length, uint32_t * valid) {
+    double sum = 0.0;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < length; ++i) {
+        if (x[i] == x[i]) {
+            double v = (double) x[i];
+            sum += v * v;
+            ++count;
+        }
+    }
+    *valid = count;
+    return sum;
+}
+
+static double sum_min_max_scalar(const float * x, uint32_t length, uint32_t * valid, float * min, float * max) {
+    double sum = 0.0;
+    uint32_t count = 0;
+    float v_min = *min;
+    float v_max = *max;
+    for (uint32_t i = 0; i < length; ++i) {
+        float v = x[i];
+        if (v == v) {
+            sum += (double) v;
+            ++count;
+            v_min = (v < v_min) ? v : v_min;
+            v_max = (v > v_max) ? v : v_max;
+        }
+    }
+    *valid = count;
+    *min = v_min;
+    *max = v_max;
+    return sum;
+}
+
+static double sum_sq_dev_scalar(const float * x, uint32_t length, double mean) {
+    double sum = 0.0;
+    for (uint32_t i = 0; i < length; ++i) {
+        if (x[i] == x[i]) {
+            double m = (double) x[i] - mean;
+            sum += m * m;
+        }
+    }
+    return sum;
+}
+
+static uint32_t find_gt_scalar(const float * x, uint32_t length, float threshold) {
+    uint32_t i = 0;
+    for (; (i < length) && !(x[i] > threshold); ++i) {
+    }
+    return i;
+}
+
+static uint32_t find_le_scalar(const float * x, uint32_t length, float threshold) {
+    uint32_t i = 0;
+    for (; (i < length) && !(x[i] <= threshold); ++i) {
+    }
+    return i;
+}
+
+static const struct ops_s ops_scalar_ = {
+    JSDRV_F32_OPS_ISA_SCALAR, scale_scalar, scale_copy_scalar, scale_copy2_scalar, mult_scalar, from_i16_scalar,
+    scale_f64_scalar, sum_sq_scalar, sum_min_max_scalar, sum_sq_dev_scalar,
+    find_gt_scalar, find_le_scalar
+};
+
+#if F32_OPS_X86
+
+F32_OPS_TARGET("sse2")
+static void scale_copy_sse2(float * y, const float * x, float scale, uint32_t length) {
+    __m128 s = _mm_set1_ps(scale);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(x + i), s));
+    }
+    scale_copy_scalar(y + i, x + i, scale, length - i);
+}
+
+F32_OPS_TARGET("sse2")
+static void scale_sse2(float * x, float scale, uint32_t length) {
+    scale_copy_sse2(x, x, scale, length);
+}
+
+F32_OPS_TARGET("sse2")
+static void scale_copy2_sse2(float * y1, float * y2, const float * x, float scale, uint32_t length) {
+    __m128 s = _mm_set1_ps(scale);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(x + i), s);
+        _mm_storeu_ps(y1 + i, v);
+        _mm_storeu_ps(y2 + i, v);
+    }
+    scale_copy2_scalar(y1 + i, y2 + i, x + i, scale, length - i);
+}
+
+F32_OPS_TARGET("sse2")
+static void mult_sse2(float * y, const float * a, const float * b, uint32_t length) {
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    mult_scalar(y + i, a + i, b + i, length - i);
+}
+
+F32_OPS_TARGET("sse2")
+static void from_i16_sse2(float * y, const int16_t * x, float offset, float gain, uint32_t length) {
+    __m128 o = _mm_set1_ps(offset);
+    __m128 g = _mm_set1_ps(gain);
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (x + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);  // sign extend
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(lo), o), g));
+        _mm_storeu_ps(y + i + 4, _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(hi), o), g));
+    }
+    from_i16_scalar(y + i, x + i, offset, gain, length - i);
+}
+
+F32_OPS_TARGET("sse2")
+static void scale_f64_sse2(double * y, const float * x, double scale, uint32_t length) {
+    __m128d s = _mm_set1_pd(scale);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128d lo = _mm_cvtps_pd(v);
+        __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+        lo = _mm_and_pd(lo, _mm_cmpord_pd(lo, lo));
+        hi = _mm_and_pd(hi, _mm_cmpord_pd(hi, hi));
+        _mm_storeu_pd(y + i, _mm_mul_pd(lo, s));
+        _mm_storeu_pd(y + i + 2, _mm_mul_pd(hi, s));
+    }
+    scale_f64_scalar(y + i, x + i, scale, length - i);
+}
+
+static const uint8_t POPCOUNT4[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+F32_OPS_TARGET("sse2")
+static double sum_sq_sse2(const float * x, uint32_t length, uint32_t * valid) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    uint32_t count = 0;
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128d lo = _mm_cvtps_pd(v);
+        __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+        __m128d lo_ok = _mm_cmpord_pd(lo, lo);
+        __m128d hi_ok = _mm_cmpord_pd(hi, hi);
+        lo = _mm_and_pd(lo, lo_ok);
+        hi = _mm_and_pd(hi, hi_ok);
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, lo));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, hi));
+        count += POPCOUNT4[_mm_movemask_pd(lo_ok) | (_mm_movemask_pd(hi_ok) << 2)];
+    }
+    double sum[2];
+    _mm_storeu_pd(sum, _mm_add_pd(acc0, acc1));
+    uint32_t tail_count = 0;
+    double tail = sum_sq_scalar(x + i, length - i, &tail_count);
+    *valid = count + tail_count;
+    return sum[0] + sum[1] + tail;
+}
+
+// _mm_min_ps() and _mm_max_ps() return the second operand when either is NaN.
+F32_OPS_TARGET("sse2")
+static double sum_min_max_sse2(const float * x, uint32_t length, uint32_t * valid, float * min, float * max) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    __m128 v_min = _mm_set1_ps(*min);
+    __m128 v_max = _mm_set1_ps(*max);
+    uint32_t count = 0;
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128 ok = _mm_cmpord_ps(v, v);
+        __m128 vz = _mm_and_ps(v, ok);
+        acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(vz));
+        acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(vz, vz)));
+        v_min = _mm_min_ps(v, v_min);
+        v_max = _mm_max_ps(v, v_max);
+        count += POPCOUNT4[_mm_movemask_ps(ok)];
+    }
+    double sum[2];
+    float mn[4];
+    float mx[4];
+    _mm_storeu_pd(sum, _mm_add_pd(acc0, acc1));
+    _mm_storeu_ps(mn, v_min);
+    _mm_storeu_ps(mx, v_max);
+    for (int k = 0; k < 4; ++k) {
+        *min = (mn[k] < *min) ? mn[k] : *min;
+        *max = (mx[k] > *max) ? mx[k] : *max;
+    }
+    uint32_t tail_count = 0;
+    double tail = sum_min_max_scalar(x + i, length - i, &tail_count, min, max);
+    *valid = count + tail_count;
+    return sum[0] + sum[1] + tail;
+}
+
+F32_OPS_TARGET("sse2")
+static double sum_sq_dev_sse2(const float * x, uint32_t length, double mean) {
+    __m128d m = _mm_set1_pd(mean);
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128d lo = _mm_sub_pd(_mm_cvtps_pd(v), m);
+        __m128d hi = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), m);
+        lo = _mm_and_pd(lo, _mm_cmpord_pd(lo, lo));
+        hi = _mm_and_pd(hi, _mm_cmpord_pd(hi, hi));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, lo));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, hi));
+    }
+    double sum[2];
+    _mm_storeu_pd(sum, _mm_add_pd(acc0, acc1));
+    return sum[0] + sum[1] + sum_sq_dev_scalar(x + i, length - i, mean);
+}
+
+// The vector scans only locate the first block with a match, and the scalar
+// scan then resolves the index within that block.
+F32_OPS_TARGET("sse2")
+static uint32_t find_gt_sse2(const float * x, uint32_t length, float threshold) {
+    __m128 t = _mm_set1_ps(threshold);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(x + i), t))) {
+            break;
+        }
+    }
+    return i + find_gt_scalar(x + i, length - i, threshold);
+}
+
+F32_OPS_TARGET("sse2")
+static uint32_t find_le_sse2(const float * x, uint32_t length, float threshold) {
+    __m128 t = _mm_set1_ps(threshold);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(x + i), t))) {
+            break;
+        }
+    }
+    return i + find_le_scalar(x + i, length - i, threshold);
+}
+
+F32_OPS_TARGET("avx2")
+static void scale_copy_avx2(float * y, const float * x, float scale, uint32_t length) {
+    __m256 s = _mm256_set1_ps(scale);
+    uint32_t i = 0;
+    for (; (i + 16) <= length; i += 16) {
+        __m256 x0 = _mm256_loadu_ps(x + i);
+        __m256 x1 = _mm256_loadu_ps(x + i + 8);
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(x0, s));
+        _mm256_storeu_ps(y + i + 8, _mm256_mul_ps(x1, s));
+    }
+    for (; (i + 8) <= length; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), s));
+    }
+    scale_copy_scalar(y + i, x + i, scale, length - i);
+}
+
+F32_OPS_TARGET("avx2")
+static void scale_avx2(float * x, float scale, uint32_t length) {
+    scale_copy_avx2(x, x, scale, length);
+}
+
+F32_OPS_TARGET("avx2")
+static void scale_copy2_avx2(float * y1, float * y2, const float * x, float scale, uint32_t length) {
+    __m256 s = _mm256_set1_ps(scale);
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x + i), s);
+        _mm256_storeu_ps(y1 + i, v);
+        _mm256_storeu_ps(y2 + i, v);
+    }
+    scale_copy2_scalar(y1 + i, y2 + i, x + i, scale, length - i);
+}
+
+F32_OPS_TARGET("avx2")
+static void mult_avx2(float * y, const float * a, const float * b, uint32_t length) {
+    uint32_t i = 0;
+    for (; (i + 16) <= length; i += 16) {
+        __m256 a0 = _mm256_loadu_ps(a + i);
+        __m256 a1 = _mm256_loadu_ps(a + i + 8);
+        __m256 b0 = _mm256_loadu_ps(b + i);
+        __m256 b1 = _mm256_loadu_ps(b + i + 8);
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(a0, b0));
+        _mm256_storeu_ps(y + i + 8, _mm256_mul_ps(a1, b1));
+    }
+    for (; (i + 8) <= length; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    mult_scalar(y + i, a + i, b + i, length - i);
+}
+
+F32_OPS_TARGET("avx2")
+static void from_i16_avx2(float * y, const int16_t * x, float offset, float gain, uint32_t length) {
+    __m256 o = _mm256_set1_ps(offset);
+    __m256 g = _mm256_set1_ps(gain);
+    uint32_t i = 0;
+    for (; (i + 16) <= length; i += 16) {
+        __m256i v0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (x + i)));
+        __m256i v1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (x + i + 8)));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(v0), o), g));
+        _mm256_storeu_ps(y + i + 8, _mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(v1), o), g));
+    }
+    from_i16_scalar(y + i, x + i, offset, gain, length - i);
+}
+
+F32_OPS_TARGET("avx2")
+static void scale_f64_avx2(double * y, const float * x, double scale, uint32_t length) {
+    __m256d s = _mm256_set1_pd(scale);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+        v = _mm256_and_pd(v, _mm256_cmp_pd(v, v, _CMP_ORD_Q));
+        _mm256_storeu_pd(y + i, _mm256_mul_pd(v, s));
+    }
+    scale_f64_scalar(y + i, x + i, scale, length - i);
+}
+
+F32_OPS_TARGET("avx2")
+static double sum_sq_avx2(const float * x, uint32_t length, uint32_t * valid) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    uint32_t count = 0;
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        __m256d v0 = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+        __m256d v1 = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4));
+        __m256d ok0 = _mm256_cmp_pd(v0, v0, _CMP_ORD_Q);
+        __m256d ok1 = _mm256_cmp_pd(v1, v1, _CMP_ORD_Q);
+        v0 = _mm256_and_pd(v0, ok0);
+        v1 = _mm256_and_pd(v1, ok1);
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(v0, v0));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(v1, v1));
+        count += POPCOUNT4[_mm256_movemask_pd(ok0)] + POPCOUNT4[_mm256_movemask_pd(ok1)];
+    }
+    double sum[4];
+    _mm256_storeu_pd(sum, _mm256_add_pd(acc0, acc1));
+    uint32_t tail_count = 0;
+    double tail = sum_sq_scalar(x + i, length - i, &tail_count);
+    *valid = count + tail_count;
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]) + tail;
+}
+
+F32_OPS_TARGET("avx2")
+static double sum_min_max_avx2(const float * x, uint32_t length, uint32_t * valid, float * min, float * max) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256 v_min = _mm256_set1_ps(*min);
+    __m256 v_max = _mm256_set1_ps(*max);
+    uint32_t count = 0;
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        __m256 ok = _mm256_cmp_ps(v, v, _CMP_ORD_Q);
+        __m256 vz = _mm256_and_ps(v, ok);
+        acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(vz)));
+        acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(vz, 1)));
+        v_min = _mm256_min_ps(v, v_min);
+        v_max = _mm256_max_ps(v, v_max);
+        int mask = _mm256_movemask_ps(ok);
+        count += POPCOUNT4[mask & 0xf] + POPCOUNT4[mask >> 4];
+    }
+    double sum[4];
+    float mn[8];
+    float mx[8];
+    _mm256_storeu_pd(sum, _mm256_add_pd(acc0, acc1));
+    _mm256_storeu_ps(mn, v_min);
+    _mm256_storeu_ps(mx, v_max);
+    for (int k = 0; k < 8; ++k) {
+        *min = (mn[k] < *min) ? mn[k] : *min;
+        *max = (mx[k] > *max) ? mx[k] : *max;
+    }
+    uint32_t tail_count = 0;
+    double tail = sum_min_max_scalar(x + i, length - i, &tail_count, min, max);
+    *valid = count + tail_count;
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]) + tail;
+}
+
+F32_OPS_TARGET("avx2")
+static double sum_sq_dev_avx2(const float * x, uint32_t length, double mean) {
+    __m256d m = _mm256_set1_pd(mean);
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        __m256d v0 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)), m);
+        __m256d v1 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)), m);
+        v0 = _mm256_and_pd(v0, _mm256_cmp_pd(v0, v0, _CMP_ORD_Q));
+        v1 = _mm256_and_pd(v1, _mm256_cmp_pd(v1, v1, _CMP_ORD_Q));
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(v0, v0));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(v1, v1));
+    }
+    double sum[4];
+    _mm256_storeu_pd(sum, _mm256_add_pd(acc0, acc1));
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]) + sum_sq_dev_scalar(x + i, length - i, mean);
+}
+
+F32_OPS_TARGET("avx2")
+static uint32_t find_gt_avx2(const float * x, uint32_t length, float threshold) {
+    __m256 t = _mm256_set1_ps(threshold);
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + i), t, _CMP_GT_OQ))) {
+            break;
+        }
+    }
+    return i + find_gt_scalar(x + i, length - i, threshold);
+}
+
+F32_OPS_TARGET("avx2")
+static uint32_t find_le_avx2(const float * x, uint32_t length, float threshold) {
+    __m256 t = _mm256_set1_ps(threshold);
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + i), t, _CMP_LE_OQ))) {
+            break;
+        }
+    }
+    return i + find_le_scalar(x + i, length - i, threshold);
+}
+
+static const struct ops_s ops_sse2_ = {
+    JSDRV_F32_OPS_ISA_SSE2, scale_sse2, scale_copy_sse2, scale_copy2_sse2, mult_sse2, from_i16_sse2,
+    scale_f64_sse2, sum_sq_sse2, sum_min_max_sse2, sum_sq_dev_sse2,
+    find_gt_sse2, find_le_sse2
+};
+
+static const struct ops_s ops_avx2_ = {
+    JSDRV_F32_OPS_ISA_AVX2, scale_avx2, scale_copy_avx2, scale_copy2_avx2, mult_avx2, from_i16_avx2,
+    scale_f64_avx2, sum_sq_avx2, sum_min_max_avx2, sum_sq_dev_avx2,
+    find_gt_avx2, find_le_avx2
+};
+
+static int cpu_supports(int32_t isa) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int leaf_max = info[0];
+    __cpuid(info, 1);
+    int sse2 = (info[3] >> 26) & 1;
+    int avx = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1);  // OSXSAVE and AVX
+    if (avx) {
+        avx = (_xgetbv(0) & 6) == 6;  // OS saves XMM and YMM state
+    }
+    int avx2 = 0;
+    if (avx && (leaf_max >= 7)) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] >> 5) & 1;
+    }
+#else
+    __builtin_cpu_init();
+    int sse2 = __builtin_cpu_supports("sse2");
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
+    switch (isa) {
+        case JSDRV_F32_OPS_ISA_SSE2: return sse2;
+        case JSDRV_F32_OPS_ISA_AVX2: return avx2;
+        default: return 0;
+    }
+}
+
+#elif F32_OPS_NEON
+
+static void scale_copy_neon(float * y, const float * x, float scale, uint32_t length) {
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        float32x4_t x0 = vld1q_f32(x + i);
+        float32x4_t x1 = vld1q_f32(x + i + 4);
+        vst1q_f32(y + i, vmulq_n_f32(x0, scale));
+        vst1q_f32(y + i + 4, vmulq_n_f32(x1, scale));
+    }
+    for (; (i + 4) <= length; i += 4) {
+        vst1q_f32(y + i, vmulq_n_f32(vld1q_f32(x + i), scale));
+    }
+    scale_copy_scalar(y + i, x + i, scale, length - i);
+}
+
+static void scale_neon(float * x, float scale, uint32_t length) {
+    scale_copy_neon(x, x, scale, length);
+}
+
+static void scale_copy2_neon(float * y1, float * y2, const float * x, float scale, uint32_t length) {
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        float32x4_t v = vmulq_n_f32(vld1q_f32(x + i), scale);
+        vst1q_f32(y1 + i, v);
+        vst1q_f32(y2 + i, v);
+    }
+    scale_copy2_scalar(y1 + i, y2 + i, x + i, scale, length - i);
+}
+
+static void mult_neon(float * y, const float * a, const float * b, uint32_t length) {
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        vst1q_f32(y + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    mult_scalar(y + i, a + i, b + i, length - i);
+}
+
+static void from_i16_neon(float * y, const int16_t * x, float offset, float gain, uint32_t length) {
+    float32x4_t o = vdupq_n_f32(offset);
+    uint32_t i = 0;
+    for (; (i + 8) <= length; i += 8) {
+        int16x8_t v = vld1q_s16(x + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_high_s16(v));
+        vst1q_f32(y + i, vmulq_n_f32(vaddq_f32(lo, o), gain));
+        vst1q_f32(y + i + 4, vmulq_n_f32(vaddq_f32(hi, o), gain));
+    }
+    from_i16_scalar(y + i, x + i, offset, gain, length - i);
+}
+
+static float64x2_t nan_to_zero_neon(float64x2_t v) {
+    return vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(v), vceqq_f64(v, v)));
+}
+
+static void scale_f64_neon(double * y, const float * x, double scale, uint32_t length) {
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        float32x4_t v = vld1q_f32(x + i);
+        float64x2_t lo = nan_to_zero_neon(vcvt_f64_f32(vget_low_f32(v)));
+        float64x2_t hi = nan_to_zero_neon(vcvt_high_f64_f32(v));
+        vst1q_f64(y + i, vmulq_n_f64(lo, scale));
+        vst1q_f64(y + i + 2, vmulq_n_f64(hi, scale));
+    }
+    scale_f64_scalar(y + i, x + i, scale, length - i);
+}
+
+static double sum_sq_neon(const float * x, uint32_t length, uint32_t * valid) {
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    uint64x2_t count = vdupq_n_u64(0);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        float32x4_t v = vld1q_f32(x + i);
+        float64x2_t lo = vcvt_f64_f32(vget_low_f32(v));
+        float64x2_t hi = vcvt_high_f64_f32(v);
+        uint64x2_t lo_ok = vceqq_f64(lo, lo);
+        uint64x2_t hi_ok = vceqq_f64(hi, hi);
+        lo = vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(lo), lo_ok));
+        hi = vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(hi), hi_ok));
+        acc0 = vaddq_f64(acc0, vmulq_f64(lo, lo));
+        acc1 = vaddq_f64(acc1, vmulq_f64(hi, hi));
+        count = vaddq_u64(count, vaddq_u64(vshrq_n_u64(lo_ok, 63), vshrq_n_u64(hi_ok, 63)));
+    }
+    uint32_t tail_count = 0;
+    double tail = sum_sq_scalar(x + i, length - i, &tail_count);
+    *valid = (uint32_t) vaddvq_u64(count) + tail_count;
+    return vaddvq_f64(vaddq_f64(acc0, acc1)) + tail;
+}
+
+// vminnmq_f32() and vmaxnmq_f32() return the other operand when one is NaN.
+static double sum_min_max_neon(const float * x, uint32_t length, uint32_t * valid, float * min, float * max) {
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    float32x4_t v_min = vdupq_n_f32(*min);
+    float32x4_t v_max = vdupq_n_f32(*max);
+    uint32x4_t count = vdupq_n_u32(0);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        float32x4_t v = vld1q_f32(x + i);
+        uint32x4_t ok = vceqq_f32(v, v);
+        float32x4_t vz = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(v), ok));
+        acc0 = vaddq_f64(acc0, vcvt_f64_f32(vget_low_f32(vz)));
+        acc1 = vaddq_f64(acc1, vcvt_high_f64_f32(vz));
+        v_min = vminnmq_f32(v_min, v);
+        v_max = vmaxnmq_f32(v_max, v);
+        count = vaddq_u32(count, vshrq_n_u32(ok, 31));
+    }
+    float mn = vminvq_f32(v_min);
+    float mx = vmaxvq_f32(v_max);
+    *min = (mn < *min) ? mn : *min;
+    *max = (mx > *max) ? mx : *max;
+    uint32_t tail_count = 0;
+    double tail = sum_min_max_scalar(x + i, length - i, &tail_count, min, max);
+    *valid = vaddvq_u32(count) + tail_count;
+    return vaddvq_f64(vaddq_f64(acc0, acc1)) + tail;
+}
+
+static double sum_sq_dev_neon(const float * x, uint32_t length, double mean) {
+    float64x2_t m = vdupq_n_f64(mean);
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        float32x4_t v = vld1q_f32(x + i);
+        float64x2_t lo = nan_to_zero_neon(vsubq_f64(vcvt_f64_f32(vget_low_f32(v)), m));
+        float64x2_t hi = nan_to_zero_neon(vsubq_f64(vcvt_high_f64_f32(v), m));
+        acc0 = vaddq_f64(acc0, vmulq_f64(lo, lo));
+        acc1 = vaddq_f64(acc1, vmulq_f64(hi, hi));
+    }
+    return vaddvq_f64(vaddq_f64(acc0, acc1)) + sum_sq_dev_scalar(x + i, length - i, mean);
+}
+
+static uint32_t find_gt_neon(const float * x, uint32_t length, float threshold) {
+    float32x4_t t = vdupq_n_f32(threshold);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        if (vmaxvq_u32(vcgtq_f32(vld1q_f32(x + i), t))) {
+            break;
+        }
+    }
+    return i + find_gt_scalar(x + i, length - i, threshold);
+}
+
+static uint32_t find_le_neon(const float * x, uint32_t length, float threshold) {
+    float32x4_t t = vdupq_n_f32(threshold);
+    uint32_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        if (vmaxvq_u32(vcleq_f32(vld1q_f32(x + i), t))) {
+            break;
+        }
+    }
+    return i + find_le_scalar(x + i, length - i, threshold);
+}
+
+static const struct ops_s ops_neon_ = {
+    JSDRV_F32_OPS_ISA_NEON, scale_neon, scale_copy_neon, scale_copy2_neon, mult_neon, from_i16_neon,
+    scale_f64_neon, sum_sq_neon, sum_min_max_neon, sum_sq_dev_neon,
+    find_gt_neon, find_le_neon
+};
+
+static int cpu_supports(int32_t isa) {
+    return (isa == JSDRV_F32_OPS_ISA_NEON) ? 1 : 0;  // ARM64 baseline
+}
+
+#else
+
+static int cpu_supports(int32_t isa) {
+    (void) isa;
+    return 0;
+}
+
+#endif
+
+static const struct ops_s * ops_lookup(int32_t isa) {
+    if ((isa != JSDRV_F32_OPS_ISA_SCALAR) && !cpu_supports(isa)) {
+        return NULL;
+    }
+    switch (isa) {
+        case JSDRV_F32_OPS_ISA_SCALAR: return &ops_scalar_;
+#if F32_OPS_X86
+        case JSDRV_F32_OPS_ISA_SSE2: return &ops_sse2_;
+        case JSDRV_F32_OPS_ISA_AVX2: return &ops_avx2_;
+#elif F32_OPS_NEON
+        case JSDRV_F32_OPS_ISA_NEON: return &ops_neon_;
+#endif
+        default: return NULL;
+    }
+}
+
+static const struct ops_s * ops_get(void) {
+    const struct ops_s * ops = ops_;
+    if (NULL == ops) {
+        static const int32_t preference[] = {
+            JSDRV_F32_OPS_ISA_AVX2, JSDRV_F32_OPS_ISA_SSE2, JSDRV_F32_OPS_ISA_NEON,
+        };
+        ops = &ops_scalar_;
+        for (size_t i = 0; i < (sizeof(preference) / sizeof(preference[0])); ++i) {
+            const struct ops_s * p = ops_lookup(preference[i]);
+            if (NULL != p) {
+                ops = p;
+                break;
+            }
+        }
+        ops_ = ops;
+    }
+    return ops;
+}
+
+int32_t jsdrv_f32_ops_isa(void) {
+    return ops_get()->isa;
+}
+
+int32_t jsdrv_f32_ops_isa_set(int32_t isa) {
+    const struct ops_s * ops = ops_lookup(isa);
+    if (NULL == ops) {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    ops_ = ops;
+    return 0;
+}
+
+static const char * const ISA_NAMES[] = {"scalar", "sse2", "avx2", "neon"};
+
+const char * jsdrv_f32_ops_isa_to_str(int32_t isa) {
+    if ((isa < 0) || (isa >= (int32_t) (sizeof(ISA_NAMES) / sizeof(ISA_NAMES[0])))) {
+        return NULL;
+    }
+    return ISA_NAMES[isa];
+}
+
+int32_t jsdrv_f32_ops_isa_from_str(const char * name) {
+    for (int32_t isa = 0; name && (isa < (int32_t) (sizeof(ISA_NAMES) / sizeof(ISA_NAMES[0]))); ++isa) {
+        if (0 == jsdrv_cstr_casecmp(ISA_NAMES[isa], name)) {
+            return isa;
+        }
+    }
+    return -1;
+}
+
+void jsdrv_f32_scale(float * x, float scale, uint32_t length) {
+    ops_get()->scale(x, scale, length);
+}
+
+void jsdrv_f32_scale_copy(float * y, const float * x, float scale, uint32_t length) {
+    ops_get()->scale_copy(y, x, scale, length);
+}
+
+void jsdrv_f32_scale_copy2(float * y1, float * y2, const float * x, float scale, uint32_t length) {
+    ops_get()->scale_copy2(y1, y2, x, scale, length);
+}
+
+void jsdrv_f32_mult(float * y, const float * a, const float * b, uint32_t length) {
+    ops_get()->mult(y, a, b, length);
+}
+
+void jsdrv_f32_from_i16(float * y, const int16_t * x, float offset, float gain, uint32_t length) {
+    ops_get()->from_i16(y, x, offset, gain, length);
+}
+
+void jsdrv_f32_scale_f64(double * y, const float * x, double scale, uint32_t length) {
+    ops_get()->scale_f64(y, x, scale, length);
+}
+
+double jsdrv_f32_sum_sq(const float * x, uint32_t length, uint32_t * valid) {
+    return ops_get()->sum_sq(x, length, valid);
+}
+
+double jsdrv_f32_sum_min_max(const float * x, uint32_t length, uint32_t * valid, float * min, float * max) {
+    return ops_get()->sum_min_max(x, length, valid, min, max);
+}
+
+double jsdrv_f32_sum_sq_dev(const float * x, uint32_t length, double mean) {
+    return ops_get()->sum_sq_dev(x, length, mean);
+}
+
+uint32_t jsdrv_f32_find_gt(const float * x, uint32_t length, float threshold) {
+    return ops_get()->find_gt(x, length, threshold);
+}
+
+uint32_t jsdrv_f32_find_le(const float * x, uint32_t length, float threshold) {
+    return ops_get()->find_le(x, length, threshold);
+}
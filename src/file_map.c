@@ -0,0 +1,191 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _FILE_OFFSET_BITS 64
+#include "jsdrv_prv/file_map.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/platform.h"
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+struct jsdrv_file_map_s {
+#if _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    uint64_t size;
+    void * ptr;
+    bool copy_on_write;
+};
+
+void jsdrv_file_map_close(struct jsdrv_file_map_s * self) {
+    if (NULL == self) {
+        return;
+    }
+#if _WIN32
+    if (self->ptr && !self->copy_on_write) {
+        FlushViewOfFile(self->ptr, 0);
+    }
+    if (self->ptr) {
+        UnmapViewOfFile(self->ptr);
+    }
+    if (self->mapping) {
+        CloseHandle(self->mapping);
+    }
+    if (self->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(self->file);
+    }
+#else
+    if (self->ptr) {
+        munmap(self->ptr, (size_t) self->size);
+    }
+    if (self->fd >= 0) {
+        close(self->fd);
+    }
+#endif
+    jsdrv_free(self);
+}
+
+int32_t jsdrv_file_map_open(const char * path, uint64_t size,
+                            struct jsdrv_file_map_s ** map, void ** ptr, bool * existed) {
+    *map = NULL;
+    *ptr = NULL;
+    *existed = false;
+    if ((NULL == path) || !path[0] || !size || (size > SIZE_MAX)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct jsdrv_file_map_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_file_map_s));
+    self->size = size;
+#if _WIN32
+    self->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (self->file == INVALID_HANDLE_VALUE) {
+        JSDRV_LOGW("file_map %s: open failed %lu", path, (unsigned long) GetLastError());
+        jsdrv_free(self);
+        return JSDRV_ERROR_IO;
+    }
+    LARGE_INTEGER sz;
+    if (GetFileSizeEx(self->file, &sz) && ((uint64_t) sz.QuadPart == size)) {
+        *existed = true;
+    } else {
+        sz.QuadPart = 0;  // discard mismatched contents
+        SetFilePointerEx(self->file, sz, NULL, FILE_BEGIN);
+        SetEndOfFile(self->file);
+    }
+    self->mapping = CreateFileMappingA(self->file, NULL, PAGE_READWRITE,
+                                       (DWORD) (size >> 32), (DWORD) size, NULL);
+    if (!self->mapping) {
+        JSDRV_LOGW("file_map %s: mapping failed %lu", path, (unsigned long) GetLastError());
+        jsdrv_file_map_close(self);
+        return JSDRV_ERROR_NOT_ENOUGH_MEMORY;
+    }
+    self->ptr = MapViewOfFile(self->mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T) size);
+#else
+    self->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (self->fd < 0) {
+        JSDRV_LOGW("file_map %s: open failed", path);
+        jsdrv_free(self);
+        return JSDRV_ERROR_IO;
+    }
+    struct stat st;
+    if ((0 == fstat(self->fd, &st)) && ((uint64_t) st.st_size == size)) {
+        *existed = true;
+    } else if (ftruncate(self->fd, 0) || ftruncate(self->fd, (off_t) size)) {  // discard mismatched contents
+        JSDRV_LOGW("file_map %s: resize failed", path);
+        jsdrv_file_map_close(self);
+        return JSDRV_ERROR_NOT_ENOUGH_MEMORY;
+    }
+    self->ptr = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+    if (self->ptr == MAP_FAILED) {
+        self->ptr = NULL;
+    }
+#endif
+    if (NULL == self->ptr) {
+        JSDRV_LOGW("file_map %s: map failed", path);
+        jsdrv_file_map_close(self);
+        return JSDRV_ERROR_IO;
+    }
+    *map = self;
+    *ptr = self->ptr;
+    return 0;
+}
+
+int32_t jsdrv_file_map_open_existing(const char * path, struct jsdrv_file_map_s ** map,
+                                     void ** ptr, uint64_t * size) {
+    *map = NULL;
+    *ptr = NULL;
+    *size = 0;
+    if ((NULL == path) || !path[0]) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct jsdrv_file_map_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_file_map_s));
+    self->copy_on_write = true;
+#if _WIN32
+    self->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (self->file == INVALID_HANDLE_VALUE) {
+        jsdrv_free(self);
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(self->file, &sz) || (0 == sz.QuadPart)) {
+        jsdrv_file_map_close(self);
+        return JSDRV_ERROR_IO;
+    }
+    self->size = (uint64_t) sz.QuadPart;
+    self->mapping = CreateFileMappingA(self->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!self->mapping) {
+        JSDRV_LOGW("file_map %s: mapping failed %lu", path, (unsigned long) GetLastError());
+        jsdrv_file_map_close(self);
+        return JSDRV_ERROR_NOT_ENOUGH_MEMORY;
+    }
+    self->ptr = MapViewOfFile(self->mapping, FILE_MAP_COPY, 0, 0, 0);
+#else
+    self->fd = open(path, O_RDONLY);
+    if (self->fd < 0) {
+        jsdrv_free(self);
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    struct stat st;
+    if (fstat(self->fd, &st) || (st.st_size <= 0) || ((uint64_t) st.st_size > SIZE_MAX)) {
+        jsdrv_file_map_close(self);
+        return JSDRV_ERROR_IO;
+    }
+    self->size = (uint64_t) st.st_size;
+    self->ptr = mmap(NULL, (size_t) self->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, self->fd, 0);
+    if (self->ptr == MAP_FAILED) {
+        self->ptr = NULL;
+    }
+#endif
+    if (NULL == self->ptr) {
+        JSDRV_LOGW("file_map %s: map failed", path);
+        jsdrv_file_map_close(self);
+        return JSDRV_ERROR_IO;
+    }
+    *map = self;
+    *ptr = self->ptr;
+    *size = self->size;
+    return 0;
+}
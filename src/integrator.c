@@ -0,0 +1,265 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/integrator.h"
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/js220_i128.h"
+#include "jsdrv_prv/platform.h"
+#include <math.h>
+#include <string.h>
+
+
+#define Q31_SCALE       (2147483648.0)
+#define RUN_LENGTH_MAX  (1024U)     // int64 headroom for |x| up to 4e6
+#define SIGNAL_COUNT    (2U)
+
+struct accum_s {
+    js220_i128 sum;             // Q31 samples
+    uint64_t count;             // samples that are not NaN
+    float min;
+    float max;
+};
+
+struct interval_s {
+    uint64_t start;
+    uint64_t end;               // UINT64_MAX while open
+    uint32_t id;
+    struct accum_s accum[SIGNAL_COUNT];
+};
+
+struct signal_s {
+    bool valid;
+    uint64_t sample_id_next;
+    uint32_t sample_rate;
+    uint32_t decimate_factor;
+    struct jsdrv_time_map_s time_map;
+};
+
+struct jsdrv_integrator_s {
+    struct signal_s signals[SIGNAL_COUNT];
+    struct interval_s intervals[JSDRV_INTEGRATOR_PENDING_MAX];
+    uint32_t head;              // the oldest pending interval
+    uint32_t count;             // the pending intervals
+    uint32_t interval_id;       // the id for the next interval
+    uint64_t marker_last;       // the most recent marker sample_id
+};
+
+
+struct jsdrv_integrator_s * jsdrv_integrator_new(void) {
+    return jsdrv_alloc_clr(sizeof(struct jsdrv_integrator_s));
+}
+
+void jsdrv_integrator_free(struct jsdrv_integrator_s * self) {
+    if (NULL != self) {
+        jsdrv_free(self);
+    }
+}
+
+void jsdrv_integrator_clear(struct jsdrv_integrator_s * self) {
+    uint32_t interval_id = self->interval_id;
+    memset(self, 0, sizeof(*self));
+    self->interval_id = interval_id;
+}
+
+static struct interval_s * interval_get(struct jsdrv_integrator_s * self, uint32_t idx) {
+    return &self->intervals[(self->head + idx) % JSDRV_INTEGRATOR_PENDING_MAX];
+}
+
+int32_t jsdrv_integrator_marker(struct jsdrv_integrator_s * self, uint64_t sample_id, bool start) {
+    if (sample_id < self->marker_last) {
+        return JSDRV_ERROR_SEQUENCE;
+    }
+    struct interval_s * last = self->count ? interval_get(self, self->count - 1) : NULL;
+    bool is_open = (NULL != last) && (UINT64_MAX == last->end);
+    if (start) {
+        if (is_open) {
+            return 0;
+        }
+        if (self->count >= JSDRV_INTEGRATOR_PENDING_MAX) {
+            return JSDRV_ERROR_FULL;
+        }
+        struct interval_s * x = interval_get(self, self->count++);
+        memset(x, 0, sizeof(*x));
+        x->start = sample_id;
+        x->end = UINT64_MAX;
+        x->id = self->interval_id++;
+        for (uint32_t idx = 0; idx < SIGNAL_COUNT; ++idx) {
+            x->accum[idx].min = INFINITY;
+            x->accum[idx].max = -INFINITY;
+        }
+    } else if (!is_open) {
+        return 0;
+    } else if (sample_id == last->start) {
+        --self->count;  // empty
+        --self->interval_id;
+    } else {
+        last->end = sample_id;
+    }
+    self->marker_last = sample_id;
+    return 0;
+}
+
+static void accumulate(struct accum_s * a, const float * x, uint32_t length) {
+    float v_min = a->min;
+    float v_max = a->max;
+    uint64_t count = 0;
+    while (length) {
+        uint32_t run = (length > RUN_LENGTH_MAX) ? RUN_LENGTH_MAX : length;
+        int64_t sum = 0;
+        for (uint32_t i = 0; i < run; ++i) {
+            float v = x[i];
+            if (isnan(v)) {
+                continue;
+            }
+            sum += (int64_t) ((double) v * Q31_SCALE);
+            v_min = (v < v_min) ? v : v_min;
+            v_max = (v > v_max) ? v : v_max;
+            ++count;
+        }
+        a->sum = js220_i128_add(a->sum, js220_i128_init_i64(sum));
+        x += run;
+        length -= run;
+    }
+    a->count += count;
+    a->min = v_min;
+    a->max = v_max;
+}
+
+// Accumulate length copies of a deadband hold mean, same as the expanded samples.
+static void accumulate_hold(struct accum_s * a, const struct jsdrv_stream_hold_s * hold, uint64_t length) {
+    if (isnan(hold->mean)) {
+        return;
+    }
+    int64_t q = (int64_t) ((double) hold->mean * Q31_SCALE);
+    a->count += length;
+    while (length) {
+        uint32_t run = (length > RUN_LENGTH_MAX) ? RUN_LENGTH_MAX : (uint32_t) length;
+        a->sum = js220_i128_add(a->sum, js220_i128_init_i64(q * (int64_t) run));
+        length -= run;
+    }
+    a->min = (hold->min < a->min) ? hold->min : a->min;
+    a->max = (hold->max > a->max) ? hold->max : a->max;
+}
+
+int32_t jsdrv_integrator_add(struct jsdrv_integrator_s * self, uint8_t signal, const struct jsdrv_stream_signal_s * s) {
+    if (signal >= SIGNAL_COUNT) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(s);
+    if (!hold && ((s->element_type != JSDRV_DATA_TYPE_FLOAT) || (s->element_size_bits != 32))) {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    struct signal_s * sig = &self->signals[signal];
+    uint64_t decimate_factor = s->decimate_factor ? s->decimate_factor : 1;
+    uint64_t s0 = s->sample_id;
+    uint64_t s1 = s0 + jsdrv_deadband_sample_count(s) * decimate_factor;
+    sig->valid = true;
+    sig->sample_id_next = s1;
+    sig->sample_rate = s->sample_rate;
+    sig->decimate_factor = (uint32_t) decimate_factor;
+    sig->time_map = s->time_map;
+
+    const float * x = (const float *) s->data;
+    for (uint32_t idx = 0; idx < self->count; ++idx) {
+        struct interval_s * v = interval_get(self, idx);
+        uint64_t a = (v->start > s0) ? v->start : s0;
+        uint64_t b = (v->end < s1) ? v->end : s1;
+        if (a >= b) {
+            continue;
+        }
+        uint64_t i0 = (a - s0 + decimate_factor - 1) / decimate_factor;
+        uint64_t i1 = (b - s0 + decimate_factor - 1) / decimate_factor;
+        if (hold) {
+            accumulate_hold(&v->accum[signal], hold, i1 - i0);
+        } else {
+            accumulate(&v->accum[signal], x + i0, (uint32_t) (i1 - i0));
+        }
+    }
+    return 0;
+}
+
+uint64_t jsdrv_integrator_position(struct jsdrv_integrator_s * self) {
+    uint64_t position = 0;
+    for (uint32_t idx = 0; idx < SIGNAL_COUNT; ++idx) {
+        if (self->signals[idx].sample_id_next > position) {
+            position = self->signals[idx].sample_id_next;
+        }
+    }
+    return position;
+}
+
+static void accum_to_f64(const struct accum_s * a, double * avg, double * v_min, double * v_max) {
+    if (a->count) {
+        *avg = js220_i128_to_f64(a->sum, 31) / (double) a->count;
+        *v_min = a->min;
+        *v_max = a->max;
+    } else {
+        *avg = NAN;
+        *v_min = NAN;
+        *v_max = NAN;
+    }
+}
+
+int32_t jsdrv_integrator_next(struct jsdrv_integrator_s * self, struct jsdrv_interval_s * interval) {
+    if (0 == self->count) {
+        return JSDRV_ERROR_UNAVAILABLE;
+    }
+    struct interval_s * v = interval_get(self, 0);
+    for (uint32_t idx = 0; idx < SIGNAL_COUNT; ++idx) {
+        if (!self->signals[idx].valid || (self->signals[idx].sample_id_next < v->end)) {
+            return JSDRV_ERROR_UNAVAILABLE;  // also while open
+        }
+    }
+    const struct signal_s * sig = &self->signals[JSDRV_INTEGRATOR_CURRENT];
+    uint64_t decimate_factor = sig->decimate_factor;
+    uint64_t expected = (v->end - v->start + decimate_factor - 1) / decimate_factor;
+    uint32_t fs = sig->sample_rate / sig->decimate_factor;
+
+    memset(interval, 0, sizeof(*interval));
+    interval->sample_id = v->start;
+    interval->sample_id_end = v->end;
+    interval->interval_id = v->id;
+    interval->sample_rate = sig->sample_rate;
+    interval->decimate_factor = sig->decimate_factor;
+    for (uint32_t idx = 0; idx < SIGNAL_COUNT; ++idx) {
+        if (v->accum[idx].count < expected) {
+            interval->flags |= JSDRV_INTERVAL_FLAG_PARTIAL;
+        }
+    }
+    const struct accum_s * i = &v->accum[JSDRV_INTEGRATOR_CURRENT];
+    const struct accum_s * p = &v->accum[JSDRV_INTEGRATOR_POWER];
+    interval->i_count = i->count;
+    interval->p_count = p->count;
+    accum_to_f64(i, &interval->i_avg, &interval->i_min, &interval->i_max);
+    accum_to_f64(p, &interval->p_avg, &interval->p_min, &interval->p_max);
+    if (fs) {
+        interval->charge_f64 = js220_i128_to_f64(i->sum, 31) / fs;
+        interval->energy_f64 = js220_i128_to_f64(p->sum, 31) / fs;
+        js220_i128 charge = js220_i128_compute_integral(i->sum, fs);
+        js220_i128 energy = js220_i128_compute_integral(p->sum, fs);
+        interval->charge_i128[0] = charge.u64[0];
+        interval->charge_i128[1] = charge.u64[1];
+        interval->energy_i128[0] = energy.u64[0];
+        interval->energy_i128[1] = energy.u64[1];
+    }
+    interval->time_map = sig->time_map;
+
+    self->head = (self->head + 1) % JSDRV_INTEGRATOR_PENDING_MAX;
+    --self->count;
+    return 0;
+}
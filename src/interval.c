@@ -0,0 +1,532 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/interval.h"
+#include "jsdrv_prv/dbc.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/derived.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/topic.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/integrator.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include "jsdrv.h"
+#include "tinyprintf.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+
+#define SIGNAL_MARKER (2U)    // after JSDRV_INTEGRATOR_CURRENT and JSDRV_INTEGRATOR_POWER
+#define SIGNAL_COUNT (3U)
+
+static const char * action_add_meta = "{"
+    "\"dtype\": \"u32\","
+    "\"brief\": \"Add an interval integrator.\""
+"}";
+
+static const char * action_remove_meta = "{"
+    "\"dtype\": \"u32\","
+    "\"brief\": \"Remove an interval integrator.\""
+"}";
+
+static const char * action_list_meta = "{"
+    "\"brief\": \"The list of available interval integrators, 0 terminated.\""
+"}";
+
+struct hold_s {
+    struct jsdrvp_msg_s * msgs[JSDRV_INTERVAL_HOLD_MAX];
+    uint32_t head;
+    uint32_t count;
+};
+
+struct integrator_s {
+    uint8_t idx;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    struct jsdrv_context_s * context;
+    struct jsdrv_integrator_s * integrator;
+    char source_topics[SIGNAL_COUNT][JSDRV_TOPIC_LENGTH_MAX];
+    char device[JSDRV_TOPIC_LENGTH_MAX];
+    char marker[JSDRV_TOPIC_LENGTH_MAX];
+    uint8_t polarity;
+    struct hold_s hold[JSDRV_INTEGRATOR_POWER + 1];
+    uint64_t received_next;             // the sample_id after the most recent current or power sample
+    uint64_t marker_next;               // the sample_id after the most recent marker sample
+    bool software_open;                 // a software start without its stop
+    struct jsdrv_derived_edge_s edge;
+    struct jsdrv_stream_signal_s * edges;
+    struct msg_queue_s * cmd_q;
+    jsdrv_thread_t thread;
+    volatile uint8_t do_exit;
+};
+
+struct interval_mgr_s {
+    struct jsdrv_context_s * context;
+    struct integrator_s integrators[JSDRV_INTERVAL_COUNT_MAX];
+};
+
+
+static struct interval_mgr_s instance_ = {.context = NULL};
+
+static uint8_t _interval_recv(void * user_data, struct jsdrvp_msg_s * msg);
+static uint8_t _interval_recv_data(void * user_data, struct jsdrvp_msg_s * msg);
+
+static bool is_integrator_idx_valid(uint64_t integrator_idx) {
+    return ((integrator_idx >= 1) && (integrator_idx <= JSDRV_INTERVAL_COUNT_MAX));
+}
+
+static void send_to_frontend(struct interval_mgr_s * self, const char * topic, const struct jsdrv_union_s * value) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, topic, value);
+    jsdrvp_backend_send(self->context, m);
+}
+
+static int32_t subscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+                         jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_SUBSCRIBE, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, topic, sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = cbk_fn;
+    m->payload.sub.subscriber.user_data = cbk_user_data;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = flags;
+    jsdrvp_backend_send(context, m);
+    return 0;
+}
+
+static int32_t unsubscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+                           jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_UNSUBSCRIBE, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, topic, sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = cbk_fn;
+    m->payload.sub.subscriber.user_data = cbk_user_data;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = flags;
+    jsdrvp_backend_send(context, m);
+    return 0;
+}
+
+static int32_t send_return_code_to_frontend(struct jsdrv_context_s * context, const char * topic, int32_t rc,
+        jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m;
+    m = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_i32(rc));
+    tfp_snprintf(m->topic, sizeof(m->topic), "%s%c", topic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+    m->extra.frontend.subscriber.internal_fn = cbk_fn;
+    m->extra.frontend.subscriber.user_data = cbk_user_data;
+    m->extra.frontend.subscriber.is_internal = 1;
+    jsdrvp_backend_send(context, m);
+    return rc;
+}
+
+static int32_t integrator_recv_complete(struct integrator_s * self, const char * subtopic, int32_t rc) {
+    if (rc >= 0) {
+        struct jsdrvp_msg_s * m;
+        m = jsdrvp_msg_alloc_value(self->context, "", &jsdrv_union_i32(rc));
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s%c", self->topic,
+                     subtopic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+        m->extra.frontend.subscriber.internal_fn = _interval_recv;
+        m->extra.frontend.subscriber.user_data = NULL;
+        m->extra.frontend.subscriber.is_internal = 1;
+        jsdrvp_backend_send(self->context, m);
+    }
+    return rc;
+}
+
+static void source_unsub(struct integrator_s * self, uint32_t signal) {
+    char * topic = self->source_topics[signal];
+    if (topic[0]) {
+        intptr_t v = ((((intptr_t) signal) & 0xffff) << 16) | (self->idx & 0xffff);
+        unsubscribe(self->context, topic, JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM, _interval_recv_data, (void *) v);
+        topic[0] = 0;
+    }
+}
+
+static void source_sub(struct integrator_s * self, uint32_t signal, const char * subtopic) {
+    source_unsub(self, signal);
+    if (!self->device[0] || !subtopic[0]) {
+        return;
+    }
+    tfp_snprintf(self->source_topics[signal], sizeof(self->source_topics[signal]),
+                 "%s/s/%s/!data", self->device, subtopic);
+    intptr_t v = ((((intptr_t) signal) & 0xffff) << 16) | (self->idx & 0xffff);
+    subscribe(self->context, self->source_topics[signal], JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM,
+              _interval_recv_data, (void *) v);
+}
+
+static void cmd_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
+    if (msg->u32_a) {
+        jsdrvp_msg_free(context, msg->payload.dispatch);  // release reference
+    }
+    jsdrvp_msg_free(context, msg);
+}
+
+static void hold_clear(struct integrator_s * self) {
+    for (uint32_t signal = 0; signal <= JSDRV_INTEGRATOR_POWER; ++signal) {
+        struct hold_s * h = &self->hold[signal];
+        while (h->count) {
+            jsdrvp_msg_free(self->context, h->msgs[h->head]);
+            h->head = (h->head + 1) % JSDRV_INTERVAL_HOLD_MAX;
+            --h->count;
+        }
+        h->head = 0;
+    }
+}
+
+static void integrator_clear(struct integrator_s * self) {
+    hold_clear(self);
+    jsdrv_integrator_clear(self->integrator);
+    jsdrv_derived_edge_clear(&self->edge);
+    self->received_next = 0;
+    self->marker_next = 0;
+    self->software_open = false;
+}
+
+static void intervals_publish(struct integrator_s * self) {
+    while (1) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(self->context, "", sizeof(struct jsdrv_interval_s));
+        struct jsdrv_interval_s * interval = (struct jsdrv_interval_s *) m->value.value.bin;
+        if (jsdrv_integrator_next(self->integrator, interval)) {
+            jsdrvp_msg_free(self->context, m);
+            return;
+        }
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", self->topic, JSDRV_INTERVAL_MSG_DATA);
+        m->value.size = sizeof(struct jsdrv_interval_s);
+        m->value.app = JSDRV_PAYLOAD_TYPE_INTERVAL;
+        m->extra.frontend.subscriber.internal_fn = _interval_recv;  // skip our own subscription
+        m->extra.frontend.subscriber.user_data = self;
+        m->extra.frontend.subscriber.is_internal = 1;
+        jsdrvp_backend_send(self->context, m);
+    }
+}
+
+// Process held samples once the markers have passed them.
+// Software markers may arrive after their samples, so blocks beyond the
+// last software marker wait, except for the block that spans a stop.
+static void hold_process(struct integrator_s * self, bool force) {
+    for (uint32_t signal = 0; signal <= JSDRV_INTEGRATOR_POWER; ++signal) {
+        struct hold_s * h = &self->hold[signal];
+        while (h->count) {
+            struct jsdrvp_msg_s * msg = h->msgs[h->head];
+            const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) msg->value.value.bin;
+            uint64_t end = s->sample_id + jsdrv_deadband_sample_count(s) * (s->decimate_factor ? s->decimate_factor : 1);
+            if (!force && (end > self->marker_next)) {
+                if (self->marker[0] || self->software_open || (s->sample_id >= self->marker_next)) {
+                    break;
+                }
+            }
+            int32_t rc = jsdrv_integrator_add(self->integrator, (uint8_t) signal, s);
+            if (rc) {
+                JSDRV_LOGW("interval %u: signal %u add failed %d", (unsigned int) self->idx, (unsigned int) signal, (int) rc);
+            }
+            jsdrvp_msg_free(self->context, msg);
+            h->head = (h->head + 1) % JSDRV_INTERVAL_HOLD_MAX;
+            --h->count;
+        }
+    }
+    intervals_publish(self);
+}
+
+static void handle_marker(struct integrator_s * self, const struct jsdrv_stream_signal_s * s) {
+    uint8_t active = self->polarity ? 0 : 1;
+    uint32_t offset = 0;
+    while (offset < s->element_count) {
+        bool level_known = self->edge.level >= 0;
+        uint32_t sz = jsdrv_derived_edge(&self->edge, s, offset, self->edges);
+        if (!sz) {
+            break;  // not a 1-bit signal
+        }
+        offset += sz;
+        const struct jsdrv_edge_s * e = (const struct jsdrv_edge_s *) self->edges->data;
+        for (uint32_t k = 0; k < self->edges->element_count; ++k) {
+            if ((0 == k) && !level_known) {
+                continue;  // starting level, not an edge
+            }
+            int32_t rc = jsdrv_integrator_marker(self->integrator, e[k].sample_id, e[k].level == active);
+            if (rc) {
+                JSDRV_LOGW("interval %u: marker failed %d", (unsigned int) self->idx, (int) rc);
+            }
+        }
+    }
+    self->marker_next = s->sample_id + s->element_count * (uint64_t) (s->decimate_factor ? s->decimate_factor : 1);
+}
+
+static void handle_data(struct integrator_s * self, uint32_t signal, struct jsdrvp_msg_s * msg) {
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) msg->value.value.bin;
+    if (SIGNAL_MARKER == signal) {
+        handle_marker(self, s);
+        jsdrvp_msg_free(self->context, msg);
+        hold_process(self, false);
+        return;
+    }
+    uint64_t end = s->sample_id + jsdrv_deadband_sample_count(s) * (s->decimate_factor ? s->decimate_factor : 1);
+    if (end > self->received_next) {
+        self->received_next = end;
+    }
+    struct hold_s * h = &self->hold[signal];
+    if (h->count >= JSDRV_INTERVAL_HOLD_MAX) {
+        hold_process(self, true);  // the markers stalled
+    }
+    h->msgs[(h->head + h->count) % JSDRV_INTERVAL_HOLD_MAX] = msg;  // keep the reference
+    ++h->count;
+    hold_process(self, false);
+}
+
+static int32_t software_marker(struct integrator_s * self, const struct jsdrv_union_s * value, bool start) {
+    struct jsdrv_union_s v = *value;
+    jsdrv_union_widen(&v);
+    uint64_t sample_id = v.value.u64 ? v.value.u64 : self->received_next;
+    int32_t rc = jsdrv_integrator_marker(self->integrator, sample_id, start);
+    if (!rc && !self->marker[0]) {
+        self->software_open = start;
+        if (sample_id > self->marker_next) {
+            self->marker_next = sample_id;
+        }
+    }
+    hold_process(self, false);
+    return rc;
+}
+
+static void handle_cmd(struct integrator_s * self, struct jsdrvp_msg_s * msg) {
+    int32_t rc = -1;  // ignored
+    const char * s = msg->topic;
+    if ((msg->u32_a > 0) && (msg->u32_a <= SIGNAL_COUNT)) {
+        handle_data(self, msg->u32_a - 1, msg->payload.dispatch);
+        msg->u32_a = 0;  // handle_data owns the reference
+    } else if ((s[0] == 'g') && (s[1] == '/')) {
+        s += 2;
+        struct jsdrv_union_s v = msg->value;
+        jsdrv_union_widen(&v);
+        if (0 == strcmp(s, "device")) {
+            const char * device = (msg->value.type == JSDRV_UNION_STR) ? msg->value.value.str : "";
+            JSDRV_LOGI("interval %u device %s", (unsigned int) self->idx, device);
+            jsdrv_cstr_copy(self->device, device, sizeof(self->device));
+            integrator_clear(self);
+            source_sub(self, JSDRV_INTEGRATOR_CURRENT, "i");
+            source_sub(self, JSDRV_INTEGRATOR_POWER, "p");
+            source_sub(self, SIGNAL_MARKER, self->marker);
+            rc = 0;
+        } else if (0 == strcmp(s, "marker")) {
+            const char * marker = (msg->value.type == JSDRV_UNION_STR) ? msg->value.value.str : "";
+            jsdrv_cstr_copy(self->marker, marker, sizeof(self->marker));
+            integrator_clear(self);
+            source_sub(self, SIGNAL_MARKER, self->marker);
+            rc = 0;
+        } else if (0 == strcmp(s, "polarity")) {
+            self->polarity = v.value.u32 ? 1 : 0;
+            rc = 0;
+        } else if (0 == strcmp(s, "!start")) {
+            rc = software_marker(self, &msg->value, true);
+        } else if (0 == strcmp(s, "!stop")) {
+            rc = software_marker(self, &msg->value, false);
+        } else if (0 == strcmp(s, "!clear")) {
+            integrator_clear(self);
+            rc = 0;
+        } else {
+            JSDRV_LOGW("interval global unsupported: %s", s);
+            rc = JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    } else if (0 == strcmp(s, JSDRV_MSG_FINALIZE)) {
+        self->do_exit = 1;
+        rc = 0;
+    } else {
+        JSDRV_LOGW("ignore %s", msg->topic);
+        rc = JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    integrator_recv_complete(self, msg->topic, rc);
+    cmd_msg_free(self->context, msg);
+}
+
+static THREAD_RETURN_TYPE integrator_thread(THREAD_ARG_TYPE lpParam) {
+    struct integrator_s * self = (struct integrator_s *) lpParam;
+    JSDRV_LOGI("interval thread started: %s", self->topic);
+    jsdrvp_thread_configure(self->context, JSDRVP_THREAD_BUFFER, "jsdrv_interval");
+    jsdrvp_msg_cache_attach(self->context);
+
+    while (!self->do_exit) {
+        struct jsdrvp_msg_s * msg;
+        if (0 == msg_queue_pop(self->cmd_q, &msg, MSG_QUEUE_TIMEOUT_FOREVER)) {
+            handle_cmd(self, msg);
+        }
+    }
+
+    for (uint32_t signal = 0; signal < SIGNAL_COUNT; ++signal) {
+        source_unsub(self, signal);
+    }
+    hold_clear(self);
+    jsdrvp_msg_cache_detach(self->context);
+    JSDRV_LOGI("interval thread done: %s", self->topic);
+    THREAD_RETURN();
+}
+
+static void _send_integrator_list(struct interval_mgr_s * self) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_LIST, &jsdrv_union_cbin_r(NULL, 0));
+    for (uint8_t integrator_idx = 1; integrator_idx <= JSDRV_INTERVAL_COUNT_MAX; ++integrator_idx) {
+        if (NULL != self->integrators[integrator_idx - 1].cmd_q) {
+            m->payload.bin[m->value.size++] = integrator_idx;
+        }
+    }
+    m->payload.bin[m->value.size++] = 0;
+    jsdrvp_backend_send(self->context, m);
+}
+
+static uint8_t _interval_recv(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct integrator_s * g = (struct integrator_s *) user_data;
+    if (jsdrv_cstr_ends_with(msg->topic, JSDRV_INTERVAL_MSG_DATA)) {
+        return 0;  // our own output
+    }
+    size_t prefix_len = strlen(g->topic);
+    if (!jsdrv_cstr_starts_with(msg->topic, g->topic) || (msg->topic[prefix_len] != '/')) {
+        JSDRV_LOGE("unexpected topic %s to %s", msg->topic, g->topic);
+        return 1;
+    }
+    if (NULL != g->cmd_q) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_clone(g->context, msg);
+        jsdrv_cstr_copy(m->topic, msg->topic + prefix_len + 1, sizeof(m->topic));
+        m->u32_a = 0;  // command
+        msg_queue_push(g->cmd_q, m);
+    }
+    return 0;
+}
+
+static uint8_t _interval_recv_data(void * user_data, struct jsdrvp_msg_s * msg) {
+    intptr_t v = (intptr_t) user_data;
+    uint32_t integrator_idx = v & 0xffff;
+    uint32_t signal = (v >> 16) & 0xffff;
+    if (!is_integrator_idx_valid(integrator_idx) || (signal >= SIGNAL_COUNT)) {
+        JSDRV_LOGE("interval data invalid: %s", msg->topic);
+        return 1;
+    }
+    struct integrator_s * g = &instance_.integrators[integrator_idx - 1];
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) msg->value.value.bin;
+    if ((NULL != g->cmd_q) && (msg->value.app == JSDRV_PAYLOAD_TYPE_STREAM) && s->element_count) {
+        msg_queue_push(g->cmd_q, jsdrvp_msg_dispatch_ref(g->context, msg, signal + 1));
+    }
+    return 0;
+}
+
+static uint8_t _interval_add(void * user_data, struct jsdrvp_msg_s * msg) {
+    (void) user_data;
+    struct interval_mgr_s * self = &instance_;
+    struct jsdrv_union_s v = msg->value;
+    jsdrv_union_widen(&v);
+    uint64_t integrator_id_u64 = v.value.u64;
+    if (!is_integrator_idx_valid(integrator_id_u64)) {
+        JSDRV_LOGE("interval integrator %llu invalid", integrator_id_u64);
+        return send_return_code_to_frontend(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_ADD, JSDRV_ERROR_PARAMETER_INVALID, _interval_add, NULL);
+    }
+    uint8_t integrator_id = (uint8_t) integrator_id_u64;
+    struct integrator_s * g = &self->integrators[integrator_id - 1];
+    if (NULL != g->cmd_q) {
+        JSDRV_LOGE("interval integrator %u already exists", integrator_id);
+        return send_return_code_to_frontend(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_ADD, JSDRV_ERROR_ALREADY_EXISTS, _interval_add, NULL);
+    }
+    JSDRV_LOGI("interval integrator %u add", integrator_id);
+    memset(g, 0, sizeof(*g));
+    g->idx = integrator_id;
+    tfp_snprintf(g->topic, sizeof(g->topic), "e/%03u", integrator_id);
+    g->context = self->context;
+    g->integrator = jsdrv_integrator_new();
+    g->edges = jsdrv_alloc(sizeof(struct jsdrv_stream_signal_s));
+    jsdrv_derived_edge_clear(&g->edge);
+    g->cmd_q = msg_queue_init();
+    subscribe(g->context, g->topic, JSDRV_SFLAG_PUB, _interval_recv, g);
+    if (jsdrv_thread_create(&g->thread, integrator_thread, g, -1)) {
+        JSDRV_LOGE("interval integrator %u thread create failed", integrator_id);
+        return send_return_code_to_frontend(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_ADD, JSDRV_ERROR_UNSPECIFIED, _interval_add, NULL);
+    }
+    _send_integrator_list(self);
+    return send_return_code_to_frontend(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_ADD, 0, _interval_add, NULL);
+}
+
+static void _interval_remove_inner(struct interval_mgr_s * self, uint8_t integrator_id) {
+    struct integrator_s * g = &self->integrators[integrator_id - 1];
+    if (NULL == g->cmd_q) {
+        JSDRV_LOGE("interval integrator %u does not exist", integrator_id);
+        return;
+    }
+    JSDRV_LOGI("interval integrator %u remove", integrator_id);
+    unsubscribe(g->context, g->topic, JSDRV_SFLAG_PUB, _interval_recv, g);
+    msg_queue_push(g->cmd_q, jsdrvp_msg_alloc_value(self->context, JSDRV_MSG_FINALIZE, &jsdrv_union_u8(0)));
+    jsdrv_thread_join(&g->thread, 1000);
+    struct jsdrvp_msg_s * m;
+    while (NULL != (m = msg_queue_pop_immediate(g->cmd_q))) {
+        cmd_msg_free(self->context, m);
+    }
+    msg_queue_finalize(g->cmd_q);
+    g->cmd_q = NULL;
+    jsdrv_integrator_free(g->integrator);
+    g->integrator = NULL;
+    jsdrv_free(g->edges);
+    g->edges = NULL;
+    _send_integrator_list(self);
+}
+
+static uint8_t _interval_remove(void * user_data, struct jsdrvp_msg_s * msg) {
+    (void) user_data;
+    struct interval_mgr_s * self = &instance_;
+    struct jsdrv_union_s v = msg->value;
+    jsdrv_union_widen(&v);
+    uint64_t integrator_id_u64 = v.value.u64;
+    if (!is_integrator_idx_valid(integrator_id_u64)) {
+        JSDRV_LOGE("invalid interval integrator: %llu", integrator_id_u64);
+        return send_return_code_to_frontend(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_REMOVE, JSDRV_ERROR_NOT_FOUND, _interval_remove, NULL);
+    }
+    _interval_remove_inner(self, (uint8_t) integrator_id_u64);
+    return send_return_code_to_frontend(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_REMOVE, 0, _interval_remove, NULL);
+}
+
+int32_t jsdrv_interval_initialize(struct jsdrv_context_s * context) {
+    JSDRV_DBC_NOT_NULL(context);
+    struct interval_mgr_s * self = &instance_;
+    if (NULL != self->context) {
+        JSDRV_LOGE("jsdrv_interval_initialize but context not NULL");
+        return JSDRV_ERROR_IN_USE;
+    }
+    memset(self, 0, sizeof(*self));
+    self->context = context;
+
+    send_to_frontend(self, JSDRV_INTERVAL_MGR_MSG_ACTION_ADD "$", &jsdrv_union_cjson_r(action_add_meta));
+    send_to_frontend(self, JSDRV_INTERVAL_MGR_MSG_ACTION_REMOVE "$", &jsdrv_union_cjson_r(action_remove_meta));
+    send_to_frontend(self, JSDRV_INTERVAL_MGR_MSG_ACTION_LIST "$", &jsdrv_union_cjson_r(action_list_meta));
+
+    subscribe(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_ADD, JSDRV_SFLAG_PUB, _interval_add, NULL);
+    subscribe(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_REMOVE, JSDRV_SFLAG_PUB, _interval_remove, NULL);
+    _send_integrator_list(self);
+    return 0;
+}
+
+void jsdrv_interval_finalize(void) {
+    struct interval_mgr_s * self = &instance_;
+    if (self->context) {
+        unsubscribe(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_ADD, JSDRV_SFLAG_PUB, _interval_add, NULL);
+        unsubscribe(self->context, JSDRV_INTERVAL_MGR_MSG_ACTION_REMOVE, JSDRV_SFLAG_PUB, _interval_remove, NULL);
+        for (uint32_t integrator_idx = 1; integrator_idx <= JSDRV_INTERVAL_COUNT_MAX; ++integrator_idx) {
+            if (NULL != self->integrators[integrator_idx - 1].cmd_q) {
+                _interval_remove_inner(self, (uint8_t) integrator_idx);
+            }
+        }
+        self->context = NULL;
+    }
+}
@@ -15,15 +15,38 @@
  */
 
 #include "jsdrv_prv/js110_sample_processor.h"
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/platform.h"
 #include "jsdrv/error_code.h"
 #include <string.h>
 #include <float.h>
 #include <math.h>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define SP_TARGET(isa_)
+#else
+#define SP_TARGET(isa_) __attribute__((target(isa_)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SP_NEON 1
+#include <arm_neon.h>
+#endif
+
 #define _SUPPRESS_SAMPLES_MASK (JS110_SUPPRESS_SAMPLES_MAX - 1)
 #define SUPPRESS_WINDOW_MAX 12
 #define SUPPRESS_PRE_MAX 8
 #define SUPPRESS_POST_MAX 8
+#define SUPPRESS_WIN_SZ_MAX 31
+#define LAZY_H JS110_SP_LAZY_HISTORY
+#define LAZY_LENGTH JS110_SP_LAZY_LENGTH
+#define LAZY_CHUNK 128U
+
+JSDRV_STATIC_ASSERT(JS110_SP_LAZY_HISTORY >= SUPPRESS_PRE_MAX, lazy_history_too_short);
+JSDRV_STATIC_ASSERT(JS110_SP_LAZY_DELAY >= (SUPPRESS_WIN_SZ_MAX + SUPPRESS_POST_MAX), lazy_delay_too_short);
 
 
 static inline uint8_t ptr_incr(uint8_t idx) {
@@ -78,6 +101,20 @@ static const uint8_t SUPPRESS_MATRIX_N[9][9] = {   // [to][from]
     {0, 0, 0, 0, 0, 0, 0, 0, 0},  // to 8 (missing)
 };
 
+static void lazy_reset(struct js110_sp_s * self) {
+    struct js110_sp_lazy_s * z = &self->_lazy;
+    for (uint32_t k = 0; k < LAZY_LENGTH; ++k) {
+        z->i[k] = NAN;
+        z->v[k] = NAN;
+        z->p[k] = NAN;
+        z->i_range[k] = JS110_I_RANGE_OFF;
+        z->current_range[k] = JS110_I_RANGE_MISSING;
+        z->gpi0[k] = 0;
+        z->gpi1[k] = 0;
+    }
+    z->suppressed = 0;
+}
+
 void js110_sp_initialize(struct js110_sp_s * self) {
     memset(self, 0, sizeof(*self));
     self->_suppress_samples_pre = 1;
@@ -88,9 +125,14 @@ void js110_sp_initialize(struct js110_sp_s * self) {
     SAMPLE_MISSING.i = NAN;
     SAMPLE_MISSING.v = NAN;
     SAMPLE_MISSING.p = NAN;
+    js110_sp_cal_update(self);
     js110_sp_reset(self);
 }
 
+void js110_sp_finalize(struct js110_sp_s * self) {
+    js110_sp_cal_lut(self, 0);
+}
+
 void js110_sp_reset(struct js110_sp_s * self) {
     self->sample_missing_count = 0;
     self->is_skipping = 1;
@@ -110,44 +152,38 @@ void js110_sp_reset(struct js110_sp_s * self) {
     for (uint32_t idx = 0; idx < JS110_SUPPRESS_SAMPLES_MAX; ++idx) {
         self->samples[idx] = SAMPLE_MISSING;
     }
+    lazy_reset(self);
 }
 
-struct js110_sample_s js110_sp_process(struct js110_sp_s * self, uint32_t sample_u32, uint8_t v_range) {
-    struct js110_sample_s s;
-    ++self->sample_count;
+static inline uint8_t sample_i_range(uint32_t sample_u32) {
+    return (sample_u32 & 3) | (((sample_u32 >> 16) & 1) << 2);
+}
 
-    // interpret sample_u32 and apply calibration
-    uint8_t i_range = (sample_u32 & 3) | (((sample_u32 >> 16) & 1) << 2);
-    if ((i_range > 7) || (sample_u32 == 0xffffffffLU)) {
+static inline bool sample_track(struct js110_sp_s * self, uint32_t sample_u32) {
+    if (sample_u32 == 0xffffffffLU) {
         ++self->sample_missing_count;
         self->contiguous_count = 0;
         if (self->is_skipping == 0) {
             ++self->skip_count;
             self->is_skipping = 1;
         }
-        s = SAMPLE_MISSING;
-    } else {
-        ++self->contiguous_count;
-        self->is_skipping = 0;
-        double i = (double) ((sample_u32 >> 2) & 0x3fff);
-        double v = (double) ((sample_u32 >> 18) & 0x3fff);
-        i = (i + self->cal[0][0][i_range]) * self->cal[0][1][i_range];
-        v = (v + self->cal[1][0][v_range]) * self->cal[1][1][v_range];
-        s.i = (float) i;
-        s.v = (float) v;
-        s.p = (float) (i * v);
-        s.current_range = i_range;
-        s.gpi0 = (sample_u32 >> 2) & 1;
-        s.gpi1 = (sample_u32 >> 18) & 1;
+        return false;
     }
+    ++self->contiguous_count;
+    self->is_skipping = 0;
+    return true;
+}
 
+static inline uint8_t suppress_window_get(struct js110_sp_s * self, uint8_t i_range_to, uint8_t i_range_from) {
+    if (self->_suppress_matrix != NULL) {
+        return self->_suppress_matrix[0][i_range_to][i_range_from];
+    }
+    return (uint8_t) self->_suppress_samples_window;
+}
+
+static inline struct js110_sample_s sample_delay(struct js110_sp_s * self, struct js110_sample_s s, uint8_t i_range) {
     if ((self->_i_range_last != i_range) && (self->_i_range_last != JS110_I_RANGE_MISSING)) {
-        uint8_t suppress_window;
-        if (self->_suppress_matrix != NULL) {
-            suppress_window = self->_suppress_matrix[0][i_range][self->_i_range_last];
-        } else {
-            suppress_window = self->_suppress_samples_window;
-        }
+        uint8_t suppress_window = suppress_window_get(self, i_range, self->_i_range_last);
         self->_suppress_samples_counter = suppress_window;
         if (suppress_window) {
             if (0 == self->_suppress_samples_remaining) {
@@ -239,6 +275,430 @@ struct js110_sample_s js110_sp_process(struct js110_sp_s * self, uint32_t sample
     return self->samples[self->head];
 }
 
+struct js110_sample_s js110_sp_process(struct js110_sp_s * self, uint32_t sample_u32, uint8_t v_range) {
+    struct js110_sample_s s;
+    ++self->sample_count;
+
+    // interpret sample_u32 and apply calibration
+    uint8_t i_range = sample_i_range(sample_u32);
+    if (!sample_track(self, sample_u32)) {
+        s = SAMPLE_MISSING;
+    } else {
+        double i = (double) ((sample_u32 >> 2) & 0x3fff);
+        double v = (double) ((sample_u32 >> 18) & 0x3fff);
+        i = (i + self->cal[0][0][i_range]) * self->cal[0][1][i_range];
+        v = (v + self->cal[1][0][v_range]) * self->cal[1][1][v_range];
+        s.i = (float) i;
+        s.v = (float) v;
+        s.p = (float) (i * v);
+        s.current_range = i_range;
+        s.gpi0 = (sample_u32 >> 2) & 1;
+        s.gpi1 = (sample_u32 >> 18) & 1;
+    }
+    return sample_delay(self, s, i_range);
+}
+
+static void decode_f32_scalar(const struct js110_sp_cal_f32_s * cal, const uint32_t * raw, uint32_t n,
+                              float * i, float * v, float * p, int32_t i_range) {
+    for (uint32_t k = 0; k < n; ++k) {
+        uint32_t x = raw[k];
+        uint8_t r = (i_range < 0) ? sample_i_range(x) : (uint8_t) i_range;
+        float i_k = ((float) ((x >> 2) & 0x3fff) + cal->i_offset[r]) * cal->i_gain[r];
+        float v_k = ((float) ((x >> 18) & 0x3fff) + cal->v_offset) * cal->v_gain;
+        i[k] = i_k;
+        v[k] = v_k;
+        p[k] = i_k * v_k;
+    }
+}
+
+#if SP_X86
+
+SP_TARGET("avx2")
+static void decode_f32_avx2(const struct js110_sp_cal_f32_s * cal, const uint32_t * raw, uint32_t n,
+                            float * i, float * v, float * p, int32_t i_range) {
+    const __m256i mask = _mm256_set1_epi32(0x3fff);
+    const __m256 v_offset = _mm256_set1_ps(cal->v_offset);
+    const __m256 v_gain = _mm256_set1_ps(cal->v_gain);
+    const __m256 i_offset_table = _mm256_loadu_ps(cal->i_offset);
+    const __m256 i_gain_table = _mm256_loadu_ps(cal->i_gain);
+    __m256 i_offset = _mm256_set1_ps(cal->i_offset[(i_range < 0) ? 0 : i_range]);
+    __m256 i_gain = _mm256_set1_ps(cal->i_gain[(i_range < 0) ? 0 : i_range]);
+    uint32_t k = 0;
+    for (; (k + 8) <= n; k += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (raw + k));
+        if (i_range < 0) {  // the 8 entry tables fit in one register
+            __m256i r = _mm256_or_si256(_mm256_and_si256(x, _mm256_set1_epi32(3)),
+                                        _mm256_and_si256(_mm256_srli_epi32(x, 14), _mm256_set1_epi32(4)));
+            i_offset = _mm256_permutevar8x32_ps(i_offset_table, r);
+            i_gain = _mm256_permutevar8x32_ps(i_gain_table, r);
+        }
+        __m256 i_k = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(x, 2), mask));
+        __m256 v_k = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(x, 18), mask));
+        i_k = _mm256_mul_ps(_mm256_add_ps(i_k, i_offset), i_gain);
+        v_k = _mm256_mul_ps(_mm256_add_ps(v_k, v_offset), v_gain);
+        _mm256_storeu_ps(i + k, i_k);
+        _mm256_storeu_ps(v + k, v_k);
+        _mm256_storeu_ps(p + k, _mm256_mul_ps(i_k, v_k));
+    }
+    decode_f32_scalar(cal, raw + k, n - k, i + k, v + k, p + k, i_range);
+}
+
+#elif SP_NEON
+
+static float32x4_t table_lookup_neon(const uint8x16x2_t * table, uint32x4_t r) {
+    // byte indices r * 4 + {0, 1, 2, 3} for each 32-bit lane
+    uint32x4_t idx = vmlaq_n_u32(vdupq_n_u32(0x03020100U), r, 0x04040404U);
+    return vreinterpretq_f32_u8(vqtbl2q_u8(*table, vreinterpretq_u8_u32(idx)));
+}
+
+static void decode_f32_neon(const struct js110_sp_cal_f32_s * cal, const uint32_t * raw, uint32_t n,
+                            float * i, float * v, float * p, int32_t i_range) {
+    const uint32x4_t mask = vdupq_n_u32(0x3fff);
+    const float32x4_t v_offset = vdupq_n_f32(cal->v_offset);
+    const float32x4_t v_gain = vdupq_n_f32(cal->v_gain);
+    uint8x16x2_t i_offset_table;
+    uint8x16x2_t i_gain_table;
+    i_offset_table.val[0] = vreinterpretq_u8_f32(vld1q_f32(cal->i_offset));
+    i_offset_table.val[1] = vreinterpretq_u8_f32(vld1q_f32(cal->i_offset + 4));
+    i_gain_table.val[0] = vreinterpretq_u8_f32(vld1q_f32(cal->i_gain));
+    i_gain_table.val[1] = vreinterpretq_u8_f32(vld1q_f32(cal->i_gain + 4));
+    float32x4_t i_offset = vdupq_n_f32(cal->i_offset[(i_range < 0) ? 0 : i_range]);
+    float32x4_t i_gain = vdupq_n_f32(cal->i_gain[(i_range < 0) ? 0 : i_range]);
+    uint32_t k = 0;
+    for (; (k + 4) <= n; k += 4) {
+        uint32x4_t x = vld1q_u32(raw + k);
+        if (i_range < 0) {
+            uint32x4_t r = vorrq_u32(vandq_u32(x, vdupq_n_u32(3)),
+                                     vandq_u32(vshrq_n_u32(x, 14), vdupq_n_u32(4)));
+            i_offset = table_lookup_neon(&i_offset_table, r);
+            i_gain = table_lookup_neon(&i_gain_table, r);
+        }
+        float32x4_t i_k = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(x, 2), mask));
+        float32x4_t v_k = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(x, 18), mask));
+        i_k = vmulq_f32(vaddq_f32(i_k, i_offset), i_gain);
+        v_k = vmulq_f32(vaddq_f32(v_k, v_offset), v_gain);
+        vst1q_f32(i + k, i_k);
+        vst1q_f32(v + k, v_k);
+        vst1q_f32(p + k, vmulq_f32(i_k, v_k));
+    }
+    decode_f32_scalar(cal, raw + k, n - k, i + k, v + k, p + k, i_range);
+}
+
+#endif
+
+static void decode_lut(const float * lut, const uint32_t * raw, uint32_t n, uint8_t v_range,
+                       float * i, float * v, float * p) {
+    const float * v_lut = lut + (8U + v_range) * JS110_SP_LUT_CODES;
+    for (uint32_t k = 0; k < n; ++k) {
+        uint32_t x = raw[k];
+        float i_k = lut[((uint32_t) sample_i_range(x) << 14) | ((x >> 2) & 0x3fff)];
+        float v_k = v_lut[(x >> 18) & 0x3fff];
+        i[k] = i_k;
+        v[k] = v_k;
+        p[k] = i_k * v_k;
+    }
+}
+
+static void decode_f32(const struct js110_sp_cal_f32_s * cal, const uint32_t * raw, uint32_t n,
+                       float * i, float * v, float * p, int32_t i_range) {
+    switch (jsdrv_f32_ops_isa()) {
+#if SP_X86
+        case JSDRV_F32_OPS_ISA_AVX2: decode_f32_avx2(cal, raw, n, i, v, p, i_range); break;
+#elif SP_NEON
+        case JSDRV_F32_OPS_ISA_NEON: decode_f32_neon(cal, raw, n, i, v, p, i_range); break;
+#endif
+        default: decode_f32_scalar(cal, raw, n, i, v, p, i_range); break;
+    }
+}
+
+// the lazy state followed by the new samples
+struct lazy_work_s {
+    float i[LAZY_LENGTH + LAZY_CHUNK];
+    float v[LAZY_LENGTH + LAZY_CHUNK];
+    float p[LAZY_LENGTH + LAZY_CHUNK];
+    uint8_t i_range[LAZY_LENGTH + LAZY_CHUNK];
+    uint8_t current_range[LAZY_LENGTH + LAZY_CHUNK];
+    uint8_t gpi0[LAZY_LENGTH + LAZY_CHUNK];
+    uint8_t gpi1[LAZY_LENGTH + LAZY_CHUNK];
+};
+
+static void lazy_suppress(struct js110_sp_s * self, struct lazy_work_s * w, uint32_t start, uint32_t end, uint32_t length) {
+    if (self->_suppress_mode == JS110_SUPPRESS_MODE_NAN) {
+        for (uint32_t k = start; k < end; ++k) {
+            w->i[k] = NAN;
+            w->v[k] = NAN;
+            w->p[k] = NAN;
+        }
+        return;
+    } else if ((self->_suppress_mode != JS110_SUPPRESS_MODE_MEAN) && (self->_suppress_mode != JS110_SUPPRESS_MODE_INTERP)) {
+        return;
+    }
+
+    uint32_t pre_count = (uint32_t) self->_suppress_samples_pre;
+    uint32_t post_count = (uint32_t) self->_suppress_samples_post;
+    if (w->i_range[start - 1] >= JS110_I_RANGE_OFF) {
+        pre_count = 0;  // the samples before the switch are off or missing
+    } else if (pre_count > start) {
+        pre_count = start;
+    }
+    if (post_count > (length - end)) {
+        post_count = length - end;
+    }
+    double pre = 0.0;
+    double post = 0.0;
+    for (uint32_t k = 0; k < pre_count; ++k) {
+        pre += w->i[start - 1 - k];
+    }
+    for (uint32_t k = 0; k < post_count; ++k) {
+        post += w->i[end + k];
+    }
+
+    if (self->_suppress_mode == JS110_SUPPRESS_MODE_MEAN) {
+        if (0 == (pre_count + post_count)) {
+            return;
+        }
+        float mean = (float) ((pre + post) / (pre_count + post_count));
+        for (uint32_t k = start; k < end; ++k) {
+            w->i[k] = mean;
+            w->p[k] = mean * w->v[k];
+        }
+    } else {
+        if (pre_count) {
+            pre /= pre_count;
+        }
+        if (post_count) {
+            post /= post_count;
+        }
+        if (!pre_count) {
+            pre = post;
+        } else if (!post_count) {
+            post = pre;
+        }
+        double step = (post - pre) / (end - start + 1);
+        for (uint32_t k = start; k < end; ++k) {
+            w->i[k] = (float) (pre + step * (k - start + 1));
+            w->p[k] = w->i[k] * w->v[k];
+        }
+    }
+}
+
+static void lazy_transitions(struct js110_sp_s * self, struct lazy_work_s * w, uint32_t scan_start, uint32_t scan_end,
+                             uint32_t length) {
+    uint32_t post_count = (uint32_t) self->_suppress_samples_post;
+    uint32_t t = scan_start;
+    while (t < scan_end) {
+        uint8_t window = 0;
+        if (w->i_range[t] != w->i_range[t - 1]) {
+            window = suppress_window_get(self, w->i_range[t], w->i_range[t - 1]);
+        }
+        if (!window) {
+            ++t;
+            continue;
+        }
+        // a switch within the window or its post samples extends the window
+        uint32_t end = t + window;
+        for (uint32_t j = t + 1; (j < (end + post_count)) && (j < length); ++j) {
+            if (w->i_range[j] != w->i_range[j - 1]) {
+                uint32_t end_j = j + suppress_window_get(self, w->i_range[j], w->i_range[j - 1]);
+                if (end_j > end) {
+                    end = end_j;
+                }
+            }
+        }
+        if (end > length) {
+            end = length;
+        }
+        lazy_suppress(self, w, t, end, length);
+        t = end;
+    }
+    self->_lazy.suppressed = (t > scan_end) ? (t - scan_end) : 0;
+}
+
+static void process_block_lazy(struct js110_sp_s * self, const uint32_t * raw, uint32_t n,
+                               float * i, float * v, float * p,
+                               uint8_t * current_range, uint8_t * gpi0, uint8_t * gpi1) {
+    struct js110_sp_lazy_s * z = &self->_lazy;
+    struct lazy_work_s w;
+    for (uint32_t offset = 0; offset < n; offset += LAZY_CHUNK) {
+        uint32_t m = n - offset;
+        if (m > LAZY_CHUNK) {
+            m = LAZY_CHUNK;
+        }
+        uint32_t length = LAZY_LENGTH + m;
+        memcpy(w.i, z->i, sizeof(z->i));
+        memcpy(w.v, z->v, sizeof(z->v));
+        memcpy(w.p, z->p, sizeof(z->p));
+        memcpy(w.i_range, z->i_range, sizeof(z->i_range));
+        memcpy(w.current_range, z->current_range, sizeof(z->current_range));
+        memcpy(w.gpi0, z->gpi0, sizeof(z->gpi0));
+        memcpy(w.gpi1, z->gpi1, sizeof(z->gpi1));
+        memcpy(w.i + LAZY_LENGTH, i + offset, m * sizeof(float));
+        memcpy(w.v + LAZY_LENGTH, v + offset, m * sizeof(float));
+        memcpy(w.p + LAZY_LENGTH, p + offset, m * sizeof(float));
+        memcpy(w.i_range + LAZY_LENGTH, current_range + offset, m);
+        memcpy(w.current_range + LAZY_LENGTH, current_range + offset, m);
+        memcpy(w.gpi0 + LAZY_LENGTH, gpi0 + offset, m);
+        memcpy(w.gpi1 + LAZY_LENGTH, gpi1 + offset, m);
+
+        uint8_t range_diff = 0;
+        for (uint32_t k = 0; k < m; ++k) {
+            uint32_t idx = LAZY_LENGTH + k;
+            if (!sample_track(self, raw[offset + k])) {
+                w.i[idx] = NAN;
+                w.v[idx] = NAN;
+                w.p[idx] = NAN;
+                w.current_range[idx] = JS110_I_RANGE_MISSING;
+                w.gpi0[idx] = 0;
+                w.gpi1[idx] = 0;
+            }
+        }
+
+        // cheap scan: only run suppression when the output samples contain a range switch
+        uint32_t scan_start = LAZY_H + z->suppressed;
+        uint32_t scan_end = LAZY_H + m;
+        for (uint32_t k = scan_start; k < scan_end; ++k) {
+            range_diff |= w.i_range[k] ^ w.i_range[k - 1];
+        }
+        if (range_diff) {
+            lazy_transitions(self, &w, scan_start, scan_end, length);
+        } else {
+            z->suppressed = (z->suppressed > m) ? (z->suppressed - m) : 0;
+        }
+
+        memcpy(i + offset, w.i + LAZY_H, m * sizeof(float));
+        memcpy(v + offset, w.v + LAZY_H, m * sizeof(float));
+        memcpy(p + offset, w.p + LAZY_H, m * sizeof(float));
+        memcpy(current_range + offset, w.current_range + LAZY_H, m);
+        memcpy(gpi0 + offset, w.gpi0 + LAZY_H, m);
+        memcpy(gpi1 + offset, w.gpi1 + LAZY_H, m);
+
+        memcpy(z->i, w.i + m, sizeof(z->i));
+        memcpy(z->v, w.v + m, sizeof(z->v));
+        memcpy(z->p, w.p + m, sizeof(z->p));
+        memcpy(z->i_range, w.i_range + m, sizeof(z->i_range));
+        memcpy(z->current_range, w.current_range + m, sizeof(z->current_range));
+        memcpy(z->gpi0, w.gpi0 + m, sizeof(z->gpi0));
+        memcpy(z->gpi1, w.gpi1 + m, sizeof(z->gpi1));
+    }
+}
+
+void js110_sp_process_block(struct js110_sp_s * self, const uint32_t * raw, uint32_t n, uint8_t v_range,
+                            float * i, float * v, float * p,
+                            uint8_t * current_range, uint8_t * gpi0, uint8_t * gpi1) {
+    uint32_t range_diff = 0;
+    if (!n) {
+        return;
+    }
+    self->sample_count += n;
+    v_range &= 1;
+
+    // decode the integer fields and detect a constant current range
+    for (uint32_t k = 0; k < n; ++k) {
+        uint32_t x = raw[k];
+        range_diff |= x ^ raw[0];
+        current_range[k] = sample_i_range(x);
+        gpi0[k] = (x >> 2) & 1;
+        gpi1[k] = (x >> 18) & 1;
+    }
+    if (NULL != self->_lut) {
+        decode_lut(self->_lut, raw, n, v_range, i, v, p);
+    } else {
+        int32_t i_range = (range_diff & 0x00010003U) ? -1 : (int32_t) current_range[0];
+        decode_f32(&self->_cal_f32[v_range], raw, n, i, v, p, i_range);
+    }
+    if (self->_suppress_lazy) {
+        process_block_lazy(self, raw, n, i, v, p, current_range, gpi0, gpi1);
+        return;
+    }
+
+    // delay through the suppression ring, in place
+    for (uint32_t k = 0; k < n; ++k) {
+        struct js110_sample_s s;
+        uint8_t r = current_range[k];
+        if (!sample_track(self, raw[k])) {
+            s = SAMPLE_MISSING;
+        } else {
+            s.i = i[k];
+            s.v = v[k];
+            s.p = p[k];
+            s.current_range = r;
+            s.gpi0 = gpi0[k];
+            s.gpi1 = gpi1[k];
+            s.reserved_u8 = 0;
+        }
+        s = sample_delay(self, s, r);
+        i[k] = s.i;
+        v[k] = s.v;
+        p[k] = s.p;
+        current_range[k] = s.current_range;
+        gpi0[k] = s.gpi0;
+        gpi1[k] = s.gpi1;
+    }
+}
+
+void js110_sp_skip(struct js110_sp_s * self, uint64_t n) {
+    if (!n) {
+        return;
+    }
+    self->sample_count += n;
+    self->sample_missing_count += n;
+    self->contiguous_count = 0;
+    if (self->is_skipping == 0) {
+        ++self->skip_count;
+        self->is_skipping = 1;
+    }
+}
+
+static void lut_fill(float * lut, const double * offset, const double * gain) {
+    for (uint32_t code = 0; code < JS110_SP_LUT_CODES; ++code) {
+        lut[code] = (float) ((code + *offset) * *gain);
+    }
+}
+
+void js110_sp_cal_update(struct js110_sp_s * self) {
+    for (uint32_t v_range = 0; v_range < 2; ++v_range) {
+        struct js110_sp_cal_f32_s * c = &self->_cal_f32[v_range];
+        for (uint32_t r = 0; r < 8; ++r) {
+            c->i_offset[r] = (float) self->cal[0][0][r];
+            c->i_gain[r] = (float) self->cal[0][1][r];
+        }
+        c->v_offset = (float) self->cal[1][0][v_range];
+        c->v_gain = (float) self->cal[1][1][v_range];
+    }
+    if (NULL != self->_lut) {
+        for (uint32_t r = 0; r < 8; ++r) {
+            lut_fill(self->_lut + r * JS110_SP_LUT_CODES, &self->cal[0][0][r], &self->cal[0][1][r]);
+        }
+        for (uint32_t v_range = 0; v_range < 2; ++v_range) {
+            lut_fill(self->_lut + (8U + v_range) * JS110_SP_LUT_CODES,
+                     &self->cal[1][0][v_range], &self->cal[1][1][v_range]);
+        }
+    }
+}
+
+int32_t js110_sp_cal_lut(struct js110_sp_s * self, uint8_t enable) {
+    if (!enable) {
+        if (NULL != self->_lut) {
+            jsdrv_free(self->_lut);
+            self->_lut = NULL;
+        }
+        return 0;
+    }
+    if (NULL == self->_lut) {
+        self->_lut = jsdrv_alloc(JS110_SP_LUT_SIZE * sizeof(float));
+        if (NULL == self->_lut) {
+            return JSDRV_ERROR_NOT_ENOUGH_MEMORY;
+        }
+        js110_sp_cal_update(self);
+    }
+    return 0;
+}
+
+void js110_sp_suppress_lazy(struct js110_sp_s * self, uint8_t enable) {
+    self->_suppress_lazy = enable ? 1 : 0;
+    lazy_reset(self);
+}
+
 int32_t js110_sp_suppress_win(struct js110_sp_s * self, uint8_t window) {
     switch (window) {
         case 0: self->_suppress_matrix = NULL; break;
@@ -16,10 +16,35 @@
 
 #include "jsdrv_prv/js110_stats.h"
 #include "jsdrv_prv/js220_i128.h"
+#include "jsdrv_prv/f32_ops.h"
 #include "jsdrv_prv/platform.h"
 #include <float.h>
 #include <math.h>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define STATS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define STATS_TARGET(isa_)
+#else
+#define STATS_TARGET(isa_) __attribute__((target(isa_)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define STATS_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*
+ * The SIMD kernels split each |x * 2^31| into exact 28-bit limbs,
+ * hi * 2^28 + lo, and accumulate the signed limbs for x1 and the limb
+ * products for x2 in 64-bit lanes.  Each limb product is below 2^56, so
+ * the lanes fold into the 128-bit sums every FOLD_COUNT vectors.  Values
+ * at or above LIMB_LIMIT fall back to the scalar path.
+ */
+#define LIMB_BITS (28)
+#define LIMB_LIMIT (36028797018963968.0f)  // 2^55
+#define FOLD_COUNT (64U)
+
 
 static void clear(struct js110_stats_s * self) {
     for (int i = 0; i < 3; ++i) {
@@ -64,8 +89,7 @@ void js110_stats_sample_count_set(struct js110_stats_s * self, uint32_t sample_c
     s->block_sample_count = sample_count;
 }
 
-static void update(struct js110_stats_field_s * f, float x) {
-    f->avg += x;
+static void update_accum(struct js110_stats_field_s * f, float x) {
     if (x < f->min) {
         f->min = x;
     }
@@ -78,6 +102,378 @@ static void update(struct js110_stats_field_s * f, float x) {
     f->x2 = js220_i128_add(f->x2, r);
 }
 
+static void update(struct js110_stats_field_s * f, float x) {
+    f->avg += x;
+    update_accum(f, x);
+}
+
+static inline bool is_valid(float i, float v, float p) {
+    return !isnan(i) && !isnan(v) && !isnan(p);
+}
+
+#if STATS_X86 || STATS_NEON
+
+static void min_max_scalar(struct js110_stats_field_s * f, const float * x,
+                           const float * i, const float * v, const float * p, uint32_t n) {
+    for (uint32_t k = 0; k < n; ++k) {
+        if (is_valid(i[k], v[k], p[k])) {
+            if (x[k] < f->min) {
+                f->min = x[k];
+            }
+            if (x[k] > f->max) {
+                f->max = x[k];
+            }
+        }
+    }
+}
+
+static void fold(struct js110_stats_field_s * f, int64_t x1_hi, int64_t x1_lo,
+                 const uint64_t * aa, const uint64_t * ab, const uint64_t * bb, uint32_t lanes) {
+    uint64_t x1 = ((uint64_t) x1_hi << LIMB_BITS) + (uint64_t) x1_lo;
+    f->x1 = (int64_t) ((uint64_t) f->x1 + x1);
+    for (uint32_t k = 0; k < lanes; ++k) {
+        // (hi * 2^28 + lo)^2 = hi^2 * 2^56 + hi * lo * 2^29 + lo^2
+        f->x2 = js220_i128_add(f->x2, js220_i128_lshift(js220_i128_init_i64((int64_t) aa[k]), 2 * LIMB_BITS));
+        f->x2 = js220_i128_add(f->x2, js220_i128_lshift(js220_i128_init_i64((int64_t) ab[k]), LIMB_BITS + 1));
+        f->x2 = js220_i128_add(f->x2, js220_i128_init_i64((int64_t) bb[k]));
+    }
+}
+
+#endif
+
+#if STATS_X86
+
+struct accum_avx2_s {
+    __m256 min;
+    __m256 max;
+    __m256i x1_hi[2];
+    __m256i x1_lo[2];
+    __m256i aa[2];
+    __m256i ab[2];
+    __m256i bb[2];
+};
+
+STATS_TARGET("avx2")
+static inline void accum_avx2_clear(struct accum_avx2_s * a) {
+    for (int k = 0; k < 2; ++k) {
+        a->x1_hi[k] = _mm256_setzero_si256();
+        a->x1_lo[k] = _mm256_setzero_si256();
+        a->aa[k] = _mm256_setzero_si256();
+        a->ab[k] = _mm256_setzero_si256();
+        a->bb[k] = _mm256_setzero_si256();
+    }
+}
+
+STATS_TARGET("avx2")
+static inline void accum_avx2_fold(struct accum_avx2_s * a, struct js110_stats_field_s * f) {
+    int64_t x1_hi[8];
+    int64_t x1_lo[8];
+    uint64_t aa[8];
+    uint64_t ab[8];
+    uint64_t bb[8];
+    for (int k = 0; k < 2; ++k) {
+        _mm256_storeu_si256((__m256i *) (x1_hi + 4 * k), a->x1_hi[k]);
+        _mm256_storeu_si256((__m256i *) (x1_lo + 4 * k), a->x1_lo[k]);
+        _mm256_storeu_si256((__m256i *) (aa + 4 * k), a->aa[k]);
+        _mm256_storeu_si256((__m256i *) (ab + 4 * k), a->ab[k]);
+        _mm256_storeu_si256((__m256i *) (bb + 4 * k), a->bb[k]);
+    }
+    int64_t hi = 0;
+    int64_t lo = 0;
+    for (int k = 0; k < 8; ++k) {
+        hi += x1_hi[k];
+        lo += x1_lo[k];
+    }
+    fold(f, hi, lo, aa, ab, bb, 8);
+    accum_avx2_clear(a);
+}
+
+STATS_TARGET("avx2")
+static inline __m256 accum_avx2_update(struct accum_avx2_s * a, __m256 x, __m256 valid) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 q31 = _mm256_set1_ps(2147483648.0f);
+    const __m256 limb = _mm256_set1_ps((float) (1 << LIMB_BITS));
+    const __m256 limb_inv = _mm256_set1_ps(1.0f / (float) (1 << LIMB_BITS));
+    a->min = _mm256_min_ps(_mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), x, valid), a->min);
+    a->max = _mm256_max_ps(_mm256_blendv_ps(_mm256_set1_ps(-FLT_MAX), x, valid), a->max);
+
+    __m256 y = _mm256_and_ps(_mm256_mul_ps(_mm256_andnot_ps(sign, x), q31), valid);
+    __m256 range = _mm256_cmp_ps(y, _mm256_set1_ps(LIMB_LIMIT), _CMP_GE_OQ);
+    __m256 t = _mm256_round_ps(y, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 hi = _mm256_floor_ps(_mm256_mul_ps(t, limb_inv));
+    __m256 lo = _mm256_sub_ps(t, _mm256_mul_ps(hi, limb));
+    __m256i hi_u32 = _mm256_cvttps_epi32(hi);
+    __m256i lo_u32 = _mm256_cvttps_epi32(lo);
+    __m256i hi_s32 = _mm256_sign_epi32(hi_u32, _mm256_castps_si256(x));
+    __m256i lo_s32 = _mm256_sign_epi32(lo_u32, _mm256_castps_si256(x));
+
+    for (int k = 0; k < 2; ++k) {
+        __m128i hi_128 = k ? _mm256_extracti128_si256(hi_u32, 1) : _mm256_castsi256_si128(hi_u32);
+        __m128i lo_128 = k ? _mm256_extracti128_si256(lo_u32, 1) : _mm256_castsi256_si128(lo_u32);
+        __m128i hi_s128 = k ? _mm256_extracti128_si256(hi_s32, 1) : _mm256_castsi256_si128(hi_s32);
+        __m128i lo_s128 = k ? _mm256_extracti128_si256(lo_s32, 1) : _mm256_castsi256_si128(lo_s32);
+        __m256i hi_u64 = _mm256_cvtepu32_epi64(hi_128);
+        __m256i lo_u64 = _mm256_cvtepu32_epi64(lo_128);
+        a->x1_hi[k] = _mm256_add_epi64(a->x1_hi[k], _mm256_cvtepi32_epi64(hi_s128));
+        a->x1_lo[k] = _mm256_add_epi64(a->x1_lo[k], _mm256_cvtepi32_epi64(lo_s128));
+        a->aa[k] = _mm256_add_epi64(a->aa[k], _mm256_mul_epu32(hi_u64, hi_u64));
+        a->ab[k] = _mm256_add_epi64(a->ab[k], _mm256_mul_epu32(hi_u64, lo_u64));
+        a->bb[k] = _mm256_add_epi64(a->bb[k], _mm256_mul_epu32(lo_u64, lo_u64));
+    }
+    return range;
+}
+
+STATS_TARGET("avx2")
+static float hmin_avx2(__m256 x, float m) {
+    float z[8];
+    _mm256_storeu_ps(z, x);
+    for (int k = 0; k < 8; ++k) {
+        if (z[k] < m) {
+            m = z[k];
+        }
+    }
+    return m;
+}
+
+STATS_TARGET("avx2")
+static float hmax_avx2(__m256 x, float m) {
+    float z[8];
+    _mm256_storeu_ps(z, x);
+    for (int k = 0; k < 8; ++k) {
+        if (z[k] > m) {
+            m = z[k];
+        }
+    }
+    return m;
+}
+
+STATS_TARGET("avx2")
+static bool accum_avx2(struct js110_stats_field_s * fields, const float * i, const float * v, const float * p, uint32_t n) {
+    struct accum_avx2_s a[3];
+    const float * x[3] = {i, v, p};
+    __m256 range = _mm256_setzero_ps();
+    for (int idx = 0; idx < 3; ++idx) {
+        a[idx].min = _mm256_set1_ps((float) fields[idx].min);
+        a[idx].max = _mm256_set1_ps((float) fields[idx].max);
+        accum_avx2_clear(&a[idx]);
+    }
+    uint32_t fold_count = 0;
+    for (uint32_t k = 0; k < n; k += 8) {
+        __m256 xi = _mm256_loadu_ps(i + k);
+        __m256 xv = _mm256_loadu_ps(v + k);
+        __m256 xp = _mm256_loadu_ps(p + k);
+        __m256 valid = _mm256_and_ps(_mm256_and_ps(
+                _mm256_cmp_ps(xi, xi, _CMP_ORD_Q),
+                _mm256_cmp_ps(xv, xv, _CMP_ORD_Q)),
+                _mm256_cmp_ps(xp, xp, _CMP_ORD_Q));
+        range = _mm256_or_ps(range, accum_avx2_update(&a[0], xi, valid));
+        range = _mm256_or_ps(range, accum_avx2_update(&a[1], xv, valid));
+        range = _mm256_or_ps(range, accum_avx2_update(&a[2], xp, valid));
+        if (++fold_count >= FOLD_COUNT) {
+            if (_mm256_movemask_ps(range)) {
+                return false;
+            }
+            for (int idx = 0; idx < 3; ++idx) {
+                accum_avx2_fold(&a[idx], &fields[idx]);
+            }
+            fold_count = 0;
+        }
+    }
+    if (_mm256_movemask_ps(range)) {
+        return false;
+    }
+    for (int idx = 0; idx < 3; ++idx) {
+        struct js110_stats_field_s * f = &fields[idx];
+        accum_avx2_fold(&a[idx], f);
+        float f_min = hmin_avx2(a[idx].min, (float) f->min);
+        float f_max = hmax_avx2(a[idx].max, (float) f->max);
+        if ((f_min == 0.0f) || (f_max == 0.0f)) {
+            min_max_scalar(f, x[idx], i, v, p, n);  // keep the first signed zero
+        } else {
+            f->min = f_min;
+            f->max = f_max;
+        }
+    }
+    return true;
+}
+
+#elif STATS_NEON
+
+struct accum_neon_s {
+    float32x4_t min;
+    float32x4_t max;
+    int64x2_t x1_hi[2];
+    int64x2_t x1_lo[2];
+    uint64x2_t aa[2];
+    uint64x2_t ab[2];
+    uint64x2_t bb[2];
+};
+
+static inline void accum_neon_clear(struct accum_neon_s * a) {
+    for (int k = 0; k < 2; ++k) {
+        a->x1_hi[k] = vdupq_n_s64(0);
+        a->x1_lo[k] = vdupq_n_s64(0);
+        a->aa[k] = vdupq_n_u64(0);
+        a->ab[k] = vdupq_n_u64(0);
+        a->bb[k] = vdupq_n_u64(0);
+    }
+}
+
+static inline void accum_neon_fold(struct accum_neon_s * a, struct js110_stats_field_s * f) {
+    uint64_t aa[4];
+    uint64_t ab[4];
+    uint64_t bb[4];
+    int64_t hi = vaddvq_s64(vaddq_s64(a->x1_hi[0], a->x1_hi[1]));
+    int64_t lo = vaddvq_s64(vaddq_s64(a->x1_lo[0], a->x1_lo[1]));
+    for (int k = 0; k < 2; ++k) {
+        vst1q_u64(aa + 2 * k, a->aa[k]);
+        vst1q_u64(ab + 2 * k, a->ab[k]);
+        vst1q_u64(bb + 2 * k, a->bb[k]);
+    }
+    fold(f, hi, lo, aa, ab, bb, 4);
+    accum_neon_clear(a);
+}
+
+static inline uint32x4_t accum_neon_update(struct accum_neon_s * a, float32x4_t x, uint32x4_t valid) {
+    const float32x4_t limb = vdupq_n_f32((float) (1 << LIMB_BITS));
+    const float32x4_t limb_inv = vdupq_n_f32(1.0f / (float) (1 << LIMB_BITS));
+    float32x4_t x_min = vbslq_f32(valid, x, vdupq_n_f32(FLT_MAX));
+    float32x4_t x_max = vbslq_f32(valid, x, vdupq_n_f32(-FLT_MAX));
+    a->min = vbslq_f32(vcltq_f32(x_min, a->min), x_min, a->min);
+    a->max = vbslq_f32(vcgtq_f32(x_max, a->max), x_max, a->max);
+
+    float32x4_t y = vmulq_f32(vabsq_f32(x), vdupq_n_f32(2147483648.0f));
+    y = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(y), valid));
+    uint32x4_t range = vcgeq_f32(y, vdupq_n_f32(LIMB_LIMIT));
+    float32x4_t t = vrndq_f32(y);
+    float32x4_t hi = vrndmq_f32(vmulq_f32(t, limb_inv));
+    float32x4_t lo = vsubq_f32(t, vmulq_f32(hi, limb));
+    uint32x4_t hi_u32 = vcvtq_u32_f32(hi);
+    uint32x4_t lo_u32 = vcvtq_u32_f32(lo);
+    uint32x4_t neg = vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_f32(x), 31));
+    int32x4_t hi_s32 = vreinterpretq_s32_u32(vsubq_u32(veorq_u32(hi_u32, neg), neg));
+    int32x4_t lo_s32 = vreinterpretq_s32_u32(vsubq_u32(veorq_u32(lo_u32, neg), neg));
+
+    a->x1_hi[0] = vaddw_s32(a->x1_hi[0], vget_low_s32(hi_s32));
+    a->x1_hi[1] = vaddw_high_s32(a->x1_hi[1], hi_s32);
+    a->x1_lo[0] = vaddw_s32(a->x1_lo[0], vget_low_s32(lo_s32));
+    a->x1_lo[1] = vaddw_high_s32(a->x1_lo[1], lo_s32);
+    a->aa[0] = vmlal_u32(a->aa[0], vget_low_u32(hi_u32), vget_low_u32(hi_u32));
+    a->aa[1] = vmlal_high_u32(a->aa[1], hi_u32, hi_u32);
+    a->ab[0] = vmlal_u32(a->ab[0], vget_low_u32(hi_u32), vget_low_u32(lo_u32));
+    a->ab[1] = vmlal_high_u32(a->ab[1], hi_u32, lo_u32);
+    a->bb[0] = vmlal_u32(a->bb[0], vget_low_u32(lo_u32), vget_low_u32(lo_u32));
+    a->bb[1] = vmlal_high_u32(a->bb[1], lo_u32, lo_u32);
+    return range;
+}
+
+static bool accum_neon(struct js110_stats_field_s * fields, const float * i, const float * v, const float * p, uint32_t n) {
+    struct accum_neon_s a[3];
+    const float * x[3] = {i, v, p};
+    uint32x4_t range = vdupq_n_u32(0);
+    for (int idx = 0; idx < 3; ++idx) {
+        a[idx].min = vdupq_n_f32((float) fields[idx].min);
+        a[idx].max = vdupq_n_f32((float) fields[idx].max);
+        accum_neon_clear(&a[idx]);
+    }
+    uint32_t fold_count = 0;
+    for (uint32_t k = 0; k < n; k += 4) {
+        float32x4_t xi = vld1q_f32(i + k);
+        float32x4_t xv = vld1q_f32(v + k);
+        float32x4_t xp = vld1q_f32(p + k);
+        uint32x4_t valid = vandq_u32(vandq_u32(vceqq_f32(xi, xi), vceqq_f32(xv, xv)), vceqq_f32(xp, xp));
+        range = vorrq_u32(range, accum_neon_update(&a[0], xi, valid));
+        range = vorrq_u32(range, accum_neon_update(&a[1], xv, valid));
+        range = vorrq_u32(range, accum_neon_update(&a[2], xp, valid));
+        if (++fold_count >= FOLD_COUNT) {
+            if (vmaxvq_u32(range)) {
+                return false;
+            }
+            for (int idx = 0; idx < 3; ++idx) {
+                accum_neon_fold(&a[idx], &fields[idx]);
+            }
+            fold_count = 0;
+        }
+    }
+    if (vmaxvq_u32(range)) {
+        return false;
+    }
+    for (int idx = 0; idx < 3; ++idx) {
+        struct js110_stats_field_s * f = &fields[idx];
+        accum_neon_fold(&a[idx], f);
+        float z_min[4];
+        float z_max[4];
+        float f_min = (float) f->min;
+        float f_max = (float) f->max;
+        vst1q_f32(z_min, a[idx].min);
+        vst1q_f32(z_max, a[idx].max);
+        for (int k = 0; k < 4; ++k) {
+            if (z_min[k] < f_min) {
+                f_min = z_min[k];
+            }
+            if (z_max[k] > f_max) {
+                f_max = z_max[k];
+            }
+        }
+        if ((f_min == 0.0f) || (f_max == 0.0f)) {
+            min_max_scalar(f, x[idx], i, v, p, n);  // keep the first signed zero
+        } else {
+            f->min = f_min;
+            f->max = f_max;
+        }
+    }
+    return true;
+}
+
+#endif
+
+static void accum_block(struct js110_stats_s * self, const float * i, const float * v, const float * p, uint32_t n) {
+    uint32_t k = 0;
+    for (uint32_t idx = 0; idx < n; ++idx) {
+        // sum in order to match js110_stats_compute() exactly
+        if (is_valid(i[idx], v[idx], p[idx])) {
+            ++self->valid_count;
+            self->fields[0].avg += i[idx];
+            self->fields[1].avg += v[idx];
+            self->fields[2].avg += p[idx];
+        }
+    }
+
+    struct js110_stats_field_s fields[3];
+    for (int idx = 0; idx < 3; ++idx) {
+        fields[idx] = self->fields[idx];
+    }
+    switch (jsdrv_f32_ops_isa()) {
+#if STATS_X86
+        case JSDRV_F32_OPS_ISA_AVX2:
+            if (accum_avx2(fields, i, v, p, n & ~7U)) {
+                k = n & ~7U;
+            }
+            break;
+#elif STATS_NEON
+        case JSDRV_F32_OPS_ISA_NEON:
+            if (accum_neon(fields, i, v, p, n & ~3U)) {
+                k = n & ~3U;
+            }
+            break;
+#endif
+        default: break;
+    }
+    if (k) {
+        for (int idx = 0; idx < 3; ++idx) {
+            self->fields[idx] = fields[idx];
+        }
+    }
+
+    for (; k < n; ++k) {
+        if (is_valid(i[k], v[k], p[k])) {
+            update_accum(&self->fields[0], i[k]);
+            update_accum(&self->fields[1], v[k]);
+            update_accum(&self->fields[2], p[k]);
+        }
+    }
+}
+
 static void finalize(struct js110_stats_field_s * f, uint32_t sample_count) {
     f->avg /= sample_count;
     f->std = js220_i128_compute_std(f->x1, f->x2, sample_count, 31);
@@ -89,13 +485,49 @@ static void finalize(struct js110_stats_field_s * f, uint32_t sample_count) {
     s->_field##_min = self->fields[_idx].min; \
     s->_field##_max = self->fields[_idx].max
 
+static struct jsdrv_statistics_s * block_finalize(struct js110_stats_s * self) {
+    struct jsdrv_statistics_s * s = &self->statistics;
+    js220_i128 a;
+    js220_i128 i_128;
+    js220_i128 p_128;
+    i_128.u64[0] = self->fields[0].x1;
+    i_128.i64[1] = (self->fields[0].x1 < 0) ? -1LL : 0;
+    self->charge = js220_i128_add(self->charge, i_128);
+
+    p_128.u64[0] = self->fields[2].x1;
+    p_128.i64[1] = (self->fields[2].x1 < 0) ? -1LL : 0;
+    self->energy = js220_i128_add(self->energy, p_128);
+
+    finalize(&self->fields[0], self->valid_count);
+    finalize(&self->fields[1], self->valid_count);
+    finalize(&self->fields[2], self->valid_count);
+    self->sample_count = 0;
+    self->valid_count = 0;
+
+    uint32_t sampling_freq = s->sample_freq / s->decimate_factor;
+    a = js220_i128_compute_integral(self->charge, sampling_freq);
+    s->charge_i128[0] = a.u64[0];
+    s->charge_i128[1] = a.u64[1];
+    s->charge_f64 = js220_i128_to_f64(a, 31);
+    a = js220_i128_compute_integral(self->energy, sampling_freq);
+    s->energy_i128[0] = a.u64[0];
+    s->energy_i128[1] = a.u64[1];
+    s->energy_f64 = js220_i128_to_f64(a, 31);
+
+    FIELD_COPY(0, i);
+    FIELD_COPY(1, v);
+    FIELD_COPY(2, p);
+
+    return s;
+}
+
 struct jsdrv_statistics_s * js110_stats_compute(struct js110_stats_s * self, float i, float v, float p) {
     struct jsdrv_statistics_s * s = &self->statistics;
     if (0 == self->sample_count) {
         clear(self);
     }
     ++self->sample_count;
-    if (!isnan(i) && !isnan(v) && !isnan(p)) {
+    if (is_valid(i, v, p)) {
         ++self->valid_count;
         update(&self->fields[0], i);
         update(&self->fields[1], v);
@@ -103,39 +535,27 @@ struct jsdrv_statistics_s * js110_stats_compute(struct js110_stats_s * self, flo
     }
 
     if (self->sample_count == s->block_sample_count) {
-        js220_i128 a;
-        js220_i128 i_128;
-        js220_i128 p_128;
-        i_128.u64[0] = self->fields[0].x1;
-        i_128.i64[1] = (self->fields[0].x1 < 0) ? -1LL : 0;
-        self->charge = js220_i128_add(self->charge, i_128);
-
-        p_128.u64[0] = self->fields[2].x1;
-        p_128.i64[1] = (self->fields[2].x1 < 0) ? -1LL : 0;
-        self->energy = js220_i128_add(self->energy, p_128);
-
-        finalize(&self->fields[0], self->valid_count);
-        finalize(&self->fields[1], self->valid_count);
-        finalize(&self->fields[2], self->valid_count);
-        self->sample_count = 0;
-        self->valid_count = 0;
-
-        uint32_t sampling_freq = s->sample_freq / s->decimate_factor;
-        a = js220_i128_compute_integral(self->charge, sampling_freq);
-        s->charge_i128[0] = a.u64[0];
-        s->charge_i128[1] = a.u64[1];
-        s->charge_f64 = js220_i128_to_f64(a, 31);
-        a = js220_i128_compute_integral(self->energy, sampling_freq);
-        s->energy_i128[0] = a.u64[0];
-        s->energy_i128[1] = a.u64[1];
-        s->energy_f64 = js220_i128_to_f64(a, 31);
-
-        FIELD_COPY(0, i);
-        FIELD_COPY(1, v);
-        FIELD_COPY(2, p);
-
-        return s;
+        return block_finalize(self);
     } else {
         return 0;
     }
 }
+
+uint32_t js110_stats_compute_block(struct js110_stats_s * self, const float * i, const float * v, const float * p,
+                                   uint32_t n, struct jsdrv_statistics_s ** stats) {
+    struct jsdrv_statistics_s * s = &self->statistics;
+    *stats = NULL;
+    if (0 == self->sample_count) {
+        clear(self);
+    }
+    uint32_t remaining = s->block_sample_count - self->sample_count;
+    if (n > remaining) {
+        n = remaining;
+    }
+    accum_block(self, i, v, p, n);
+    self->sample_count += n;
+    if (self->sample_count == s->block_sample_count) {
+        *stats = block_finalize(self);
+    }
+    return n;
+}
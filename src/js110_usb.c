@@ -14,9 +14,12 @@
 * limitations under the License.
 */
 
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_JS110
+
 #include "jsdrv.h"
 #include "js110_api.h"
 #include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/derived.h"
 #include "jsdrv_prv/downsample.h"
 #include "jsdrv_prv/log.h"
 #include "jsdrv_prv/backend.h"
@@ -25,14 +28,22 @@
 #include "jsdrv_prv/js110_sample_processor.h"
 #include "jsdrv_prv/js110_stats.h"
 #include "jsdrv_prv/js220_i128.h"
+#include "jsdrv_prv/latency_hist.h"
+#include "jsdrv_prv/meta.h"
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/pack.h"
+#include "jsdrv_prv/stats_windows.h"
+#include "jsdrv_prv/stream_flush.h"
+#include "jsdrv_prv/stream_gate.h"
 #include "jsdrv_prv/usb_spec.h"
 #include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/thread_stats.h"
 #include "jsdrv_prv/time_map_filter.h"
+#include "jsdrv_prv/trace.h"
 #include "jsdrv_prv/pubsub.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
-#include "jsdrv/meta.h"
 #include "jsdrv/topic.h"
 #include "jsdrv_prv/dbc.h"
 #include "jsdrv_prv/platform.h"
@@ -44,9 +55,15 @@
 #define INTERVAL_MS                 (100U)
 #define SENSOR_COMMAND_TIMEOUT_MS   (3000U)
 #define FRAME_SIZE_BYTES            (512U)
+#define SAMPLES_PER_FRAME           (FRAME_SIZE_BYTES / 4 - 2)
+#define PACKET_SKIP_FILL_MAX        (4096U)  // frames, larger skips resync
 #define ROE JSDRV_RETURN_ON_ERROR
 #define SAMPLING_FREQUENCY          (2000000U)
-#define STREAM_PAYLOAD_FULL         (JSDRV_STREAM_DATA_SIZE - JSDRV_STREAM_HEADER_SIZE - JS220_USB_FRAME_LENGTH)
+#define LATENCY_INTERVAL_MS         (1000U)
+#define STREAM_PAYLOAD_FULL(m_)     ((m_)->payload_size - JSDRV_STREAM_HEADER_SIZE - JS220_USB_FRAME_LENGTH)
+
+JSDRV_STATIC_ASSERT(SAMPLES_PER_FRAME >= JS110_SUPPRESS_SAMPLES_MAX, skip_flush_suppress);
+JSDRV_STATIC_ASSERT(SAMPLES_PER_FRAME >= JS110_SP_LAZY_LENGTH, skip_flush_lazy);
 
 struct js110_dev_s;  // forward declaration, see below
 
@@ -64,6 +81,7 @@ typedef void (*param_fn)(struct js110_dev_s * d, const struct jsdrv_union_s * va
 struct param_s {
     const char * topic;
     const char * meta;
+    struct jsdrv_union_s default_value;  // from JSDRV_META, matches meta
     param_fn fn;
 };
 
@@ -80,8 +98,11 @@ static void on_i_range_pre(struct js110_dev_s * d, const struct jsdrv_union_s *
 static void on_i_range_win(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 static void on_i_range_win_sz(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 static void on_i_range_post(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_i_range_lazy(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_cal_lut(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 
 static void on_sampling_frequency(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_filter_arith(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 
 static void on_current_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 static void on_voltage_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
@@ -92,6 +113,27 @@ static void on_gpi_1_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * v
 static void on_stats_scnt(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 static void on_stats_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 static void on_sstats_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stats_win0_scnt(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stats_win1_scnt(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_flush(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_flush_bytes(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_flush_mode(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_gate_start(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_gate_stop(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_gate_start_utc(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_gate_stop_utc(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_stream_pipeline(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_q_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_e_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_i_rms_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_i_rms_window(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_i_summary_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_v_summary_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_p_summary_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_summary_fs(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_gpi_0_edge_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_gpi_1_edge_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
+static void on_i_range_edge_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value);
 
 enum param_e {  // CAREFUL! This must match the order in PARAMS exactly!
     PARAM_I_RANGE_SELECT,
@@ -106,7 +148,10 @@ enum param_e {  // CAREFUL! This must match the order in PARAMS exactly!
     PARAM_I_RANGE_WIN,
     PARAM_I_RANGE_WIN_SZ,
     PARAM_I_RANGE_POST,
+    PARAM_I_RANGE_LAZY,
+    PARAM_CAL_LUT,
     PARAM_SAMPLE_FREQUENCY,
+    PARAM_FILTER_ARITH,
     PARAM_I_CTRL,
     PARAM_V_CTRL,
     PARAM_P_CTRL,
@@ -116,6 +161,27 @@ enum param_e {  // CAREFUL! This must match the order in PARAMS exactly!
     PARAM_STATS_SCNT,
     PARAM_STATS_CTRL,
     PARAM_SSTATS_CTRL,
+    PARAM_STATS_WIN0_SCNT,
+    PARAM_STATS_WIN1_SCNT,
+    PARAM_STREAM_FLUSH_MS,
+    PARAM_STREAM_FLUSH_BYTES,
+    PARAM_STREAM_FLUSH_MODE,
+    PARAM_STREAM_GATE_START,
+    PARAM_STREAM_GATE_STOP,
+    PARAM_STREAM_GATE_START_UTC,
+    PARAM_STREAM_GATE_STOP_UTC,
+    PARAM_STREAM_PIPELINE,
+    PARAM_Q_CTRL,
+    PARAM_E_CTRL,
+    PARAM_I_RMS_CTRL,
+    PARAM_I_RMS_WINDOW,
+    PARAM_I_SUMMARY_CTRL,
+    PARAM_V_SUMMARY_CTRL,
+    PARAM_P_SUMMARY_CTRL,
+    PARAM_SUMMARY_FS,
+    PARAM_GPI_0_EDGE_CTRL,
+    PARAM_GPI_1_EDGE_CTRL,
+    PARAM_I_RANGE_EDGE_CTRL,
     PARAM__COUNT,  // must be last
 };
 
@@ -129,13 +195,20 @@ static const usb_setup_t STATUS_SETUP = { .s = {
 }};
 
 
+static const usb_setup_t EXTIO_GPI_SETUP = { .s = {
+        .bmRequestType = USB_REQUEST_TYPE(IN, VENDOR, DEVICE),
+        .bRequest = JS110_HOST_USB_REQUEST_EXTIO,
+        .wValue = 0,
+        .wIndex = 0,
+        .wLength = sizeof(struct js110_host_packet_s),
+}};
+
+
 static const struct param_s PARAMS[] = {
     {
         "s/i/range/select",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 128,
             "\"brief\": \"The current range selection.\","
-            "\"default\": 128,"
             "\"options\": ["
                 "[128, \"auto\"],"
                 "[1, \"10 A\"],"
@@ -147,28 +220,24 @@ static const struct param_s PARAMS[] = {
                 "[64, \"18 µA\"],"
                 "[0, \"off\"]"
             "]"
-        "}",
+        ),
         on_i_range_select,
     },
     {
         "s/v/range/select",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 0,
             "\"brief\": \"The voltage range selection.\","
-            "\"default\": 0,"
             "\"options\": ["
                 "[0, \"15 V\"],"
                 "[1, \"5 V\"]"
             "]"
-        "}",
+        ),
         on_v_range_select,
     },
     {
         "s/extio/voltage",
-        "{"
-            "\"dtype\": \"u32\","
+        JSDRV_META(u32, 3300,
             "\"brief\": \"The external IO voltage.\","
-            "\"default\": 3300,"
             "\"options\": ["
                 "[0, \"0V\", \"off\"],"
                 "[1800, \"1.8V\"],"
@@ -180,128 +249,132 @@ static const struct param_s PARAMS[] = {
                 "[3600, \"3.6V\"],"
                 "[5000, \"5.0V\"]"
             "]"
-        "}",
+        ),
         on_extio_voltage,
     },
     {
         "s/gpo/0/value",
-        "{"
-            "\"dtype\": \"bool\","
+        JSDRV_META(bool, 0,
             "\"brief\": \"The general-purpose output 0 value.\","
-            "\"default\": 0,"
             "\"options\": ["
                 "[0, \"off\"],"
                 "[1, \"on\"]"
             "]"
-        "}",
+        ),
         on_gpo0_value,
     },
     {
         "s/gpo/1/value",
-        "{"
-            "\"dtype\": \"bool\","
+        JSDRV_META(bool, 0,
             "\"brief\": \"The general-purpose output 1 value.\","
-            "\"default\": 0,"
             "\"options\": ["
                 "[0, \"off\"],"
                 "[1, \"on\"]"
             "]"
-        "}",
+        ),
         on_gpo1_value,
     },
     {
         "s/i/lsb_src",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 0,
             "\"brief\": \"The current signal least-significant bit mapping.\","
-            "\"default\": 0,"
             "\"options\": ["
                 "[0, \"normal\"],"
                 "[2, \"gpi0\"],"
                 "[3, \"gpi1\"]"
             "]"
-        "}",
+        ),
         on_current_lsb_source,
     },
     {
         "s/v/lsb_src",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 0,
             "\"brief\": \"The voltage signal least-significant bit mapping.\","
-            "\"default\": 0,"
             "\"options\": ["
                 "[0, \"normal\"],"
                 "[2, \"gpi0\"],"
                 "[3, \"gpi1\"]"
             "]"
-        "}",
+        ),
         on_voltage_lsb_source
     },
     {
         "s/i/range/mode",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 2,
             "\"brief\": \"The current range suppression mode.\","
-            "\"default\": 2,"
             "\"options\": ["
                 "[0, \"off\"],"
                 "[1, \"mean\"],"
                 "[2, \"interp\", \"interpolate\"],"
                 "[3, \"nan\"]"
             "]"
-        "}",
+        ),
         on_i_range_mode,
     },
     {
         "s/i/range/pre",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 1,
             "\"brief\": \"The number of samples before the range switch to include.\","
-            "\"default\": 1,"
             "\"range\": [0, 8]"
-        "}",
+        ),
         on_i_range_pre,
     },
     {
         "s/i/range/win",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 2,
             "\"brief\": \"The window type.\","
-            "\"default\": 2,"
             "\"options\": ["
                 "[0, \"manual\"],"
                 "[1, \"m\"],"
                 "[2, \"n\"]"
             "]"
-        "}",
+        ),
         on_i_range_win,
     },
     {
         "s/i/range/win_sz",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 10,
             "\"brief\": \"The manual window size.\","
-            "\"default\": 10,"
             "\"range\": [0, 31]"
-        "}",
+        ),
         on_i_range_win_sz,
     },
     {
         "s/i/range/post",
-        "{"
-            "\"dtype\": \"u8\","
+        JSDRV_META(u8, 1,
             "\"brief\": \"The number of samples after the range switch to include.\","
-            "\"default\": 1,"
             "\"range\": [0, 8]"
-        "}",
+        ),
         on_i_range_post,
     },
+    {
+        "s/i/range/lazy",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Only suppress the samples around current range switches.\","
+            "\"detail\": \"Pass samples away from range switches straight through.  The output delay is 40 samples.\","
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"]"
+            "]"
+        ),
+        on_i_range_lazy,
+    },
+    {
+        "h/cal/lut",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Calibrate samples using a lookup table.\","
+            "\"detail\": \"Map each 14-bit code directly to its calibrated value.  Uses 640 kB.\","
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"]"
+            "]"
+        ),
+        on_cal_lut,
+    },
     {
         "h/fs",
-        "{"
-            "\"dtype\": \"u32\","
+        JSDRV_META(u32, 2000000,
             "\"brief\": \"The sampling frequency.\","
-            "\"default\": 2000000,"
             "\"options\": ["
                 "[2000000, \"2 MHz\"],"
                 "[1000000, \"1 MHz\"],"
@@ -324,97 +397,301 @@ static const struct param_s PARAMS[] = {
                 "[2, \"2 Hz\"],"
                 "[1, \"1 Hz\"]"
             "]"
-        "}",
+        ),
         on_sampling_frequency,
     },
+    {
+        "h/filter/arith",
+        JSDRV_META(u32, 0,
+            "\"brief\": \"The host-side downsampling filter arithmetic.\","
+            "\"detail\": \"i64q30 converts each sample to 64-bit fixed point. f32 and f64 filter the float samples directly.\","
+            "\"options\": ["
+                "[0, \"i64q30\"],"
+                "[1, \"f32\"],"
+                "[2, \"f64\"]"
+            "]"
+        ),
+        on_filter_arith,
+    },
     {
         "s/i/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable data stream for float32 current.\","
-            "\"default\": 0"
-        "}",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable data stream for float32 current.\""
+        ),
         on_current_ctrl,
     },
     {
         "s/v/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable data stream for float32 voltage.\","
-            "\"default\": 0"
-        "}",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable data stream for float32 voltage.\""
+        ),
         on_voltage_ctrl,
     },
     {
         "s/p/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable data stream for float32 power.\","
-            "\"default\": 0"
-        "}",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable data stream for float32 power.\""
+        ),
         on_power_ctrl,
     },
     {
         "s/i/range/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable current range input data stream (u4).\","
-            "\"default\": 0"
-        "}",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable current range input data stream (u4).\""
+        ),
         on_current_range_ctrl,
     },
     {
         "s/gpi/0/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable general purpose input 0 data stream (u1).\","
-            "\"default\": 0"
-        "}",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable general purpose input 0 data stream (u1).\""
+        ),
         on_gpi_0_ctrl,
     },
     {
         "s/gpi/1/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable general purpose input 1 data stream (u1).\","
-            "\"default\": 0"
-        "}",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable general purpose input 1 data stream (u1).\""
+        ),
         on_gpi_1_ctrl,
     },
     {
         "s/stats/scnt",
-        "{"
-            "\"dtype\": \"u32\","
+        JSDRV_META(u32, 1000000,
             "\"brief\": \"Number of 2 Msps samples per block.\","
-            "\"default\": 1000000,"
             "\"range\": [0, 2000000]"
-        "}",
+        ),
         on_stats_scnt,
     },
     {
         "s/stats/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable host-side stats input data stream (u8).\","
-            "\"default\": 0"
-        "}",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable host-side stats input data stream (u8).\""
+        ),
         on_stats_ctrl,
     },
     {
         "s/sstats/ctrl",
-        "{"
-            "\"dtype\": \"bool\","
-            "\"brief\": \"Enable on-instrument stats input data stream (u8).\","
-            "\"default\": 1"
-        "}",
+        JSDRV_META(bool, 1,
+            "\"brief\": \"Enable on-instrument stats input data stream (u8).\""
+        ),
         on_sstats_ctrl,
     },
-    {NULL, NULL, NULL},  // MUST BE LAST
+    {
+        "h/stats/win/0/scnt",
+        JSDRV_META(u32, 0,
+            "\"brief\": \"Number of 2 Msps samples per statistics window 0.\","
+            "\"detail\": \"Combine s/stats/value blocks into s/stats/win/0/value. Must be a multiple of s/stats/scnt. 0 is off.\","
+            "\"range\": [0, 4000000000]"
+        ),
+        on_stats_win0_scnt,
+    },
+    {
+        "h/stats/win/1/scnt",
+        JSDRV_META(u32, 0,
+            "\"brief\": \"Number of 2 Msps samples per statistics window 1.\","
+            "\"detail\": \"Combine s/stats/value blocks into s/stats/win/1/value. Must be a multiple of s/stats/scnt. 0 is off.\","
+            "\"range\": [0, 4000000000]"
+        ),
+        on_stats_win1_scnt,
+    },
+    {
+        "h/stream/flush",
+        JSDRV_META(u32, 50,
+            "\"brief\": \"The maximum sample duration for each data message.\","
+            "\"detail\": \"Reduce for lower latency at the cost of more messages.\","
+            "\"range\": [1, 1000]"
+        ),
+        on_stream_flush,
+    },
+    {
+        "h/stream/flush/bytes",
+        JSDRV_META(u32, 0,
+            "\"brief\": \"The maximum sample payload size for each data message.\","
+            "\"detail\": \"Messages flush at the first of this size or h/stream/flush. 0 uses the message capacity.\""
+        ),
+        on_stream_flush_bytes,
+    },
+    {
+        "h/stream/flush/mode",
+        JSDRV_META(u32, 0,
+            "\"brief\": \"The data message flush policy.\","
+            "\"detail\": \"adaptive starts at h/stream/flush, grows the duration while the host falls behind, and shrinks it when idle.\","
+            "\"options\": ["
+                "[0, \"fixed\"],"
+                "[1, \"adaptive\"]"
+            "]"
+        ),
+        on_stream_flush_mode,
+    },
+    {
+        "h/stream/gate/start",
+        JSDRV_META(u64, 0,
+            "\"brief\": \"The first sample_id to deliver.\","
+            "\"detail\": \"Stream data messages only include samples from this sample_id. 0 delivers from the stream start.\""
+        ),
+        on_stream_gate_start,
+    },
+    {
+        "h/stream/gate/stop",
+        JSDRV_META(u64, 0,
+            "\"brief\": \"The first sample_id to no longer deliver.\","
+            "\"detail\": \"Stream data messages end before this sample_id, and the final message flushes immediately. 0 delivers until the stream stops.\""
+        ),
+        on_stream_gate_stop,
+    },
+    {
+        "h/stream/gate/start/utc",
+        JSDRV_META(i64, 0,
+            "\"brief\": \"Set h/stream/gate/start from a UTC time.\","
+            "\"detail\": \"Converted to sample_id using the current time map. 0 clears the start.\""
+        ),
+        on_stream_gate_start_utc,
+    },
+    {
+        "h/stream/gate/stop/utc",
+        JSDRV_META(i64, 0,
+            "\"brief\": \"Set h/stream/gate/stop from a UTC time.\","
+            "\"detail\": \"Converted to sample_id using the current time map. 0 clears the stop.\""
+        ),
+        on_stream_gate_stop_utc,
+    },
+    {
+        "h/stream/pipeline",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Process samples on a dedicated thread.\","
+            "\"detail\": \"The device thread forwards the USB stream data to a processing thread, so sample processing does not delay control transfers.\","
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"]"
+            "]"
+        ),
+        on_stream_pipeline,
+    },
+    {
+        "h/q/ctrl",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable the host-side charge stream s/q/!data.\","
+            "\"detail\": \"The cumulative float64 charge in coulombs, computed from s/i/!data which must also be enabled. Enabling restarts at 0.\""
+        ),
+        on_q_ctrl,
+    },
+    {
+        "h/e/ctrl",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable the host-side energy stream s/e/!data.\","
+            "\"detail\": \"The cumulative float64 energy in joules, computed from s/p/!data which must also be enabled. Enabling restarts at 0.\""
+        ),
+        on_e_ctrl,
+    },
+    {
+        "h/i/rms/ctrl",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable the host-side RMS current stream s/i/rms/!data.\","
+            "\"detail\": \"Computed from s/i/!data which must also be enabled.\""
+        ),
+        on_i_rms_ctrl,
+    },
+    {
+        "h/i/rms/window",
+        JSDRV_META(u32, 1000,
+            "\"brief\": \"The RMS current window in s/i/!data samples.\","
+            "\"range\": [1, 1000000]"
+        ),
+        on_i_rms_window,
+    },
+    {
+        "h/i/summary/ctrl",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable the host-side current summary stream s/i/summary/!data.\","
+            "\"detail\": \"Each sample holds the mean, standard deviation, min, and max over its window. Computed from s/i/!data which must also be enabled.\""
+        ),
+        on_i_summary_ctrl,
+    },
+    {
+        "h/v/summary/ctrl",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable the host-side voltage summary stream s/v/summary/!data.\","
+            "\"detail\": \"Each sample holds the mean, standard deviation, min, and max over its window. Computed from s/v/!data which must also be enabled.\""
+        ),
+        on_v_summary_ctrl,
+    },
+    {
+        "h/p/summary/ctrl",
+        JSDRV_META(bool, 0,
+            "\"brief\": \"Enable the host-side power summary stream s/p/summary/!data.\","
+            "\"detail\": \"Each sample holds the mean, standard deviation, min, and max over its window. Computed from s/p/!data which must also be enabled.\""
+        ),
+        on_p_summary_ctrl,
+    },
+    {
+        "h/summary/fs",
+        JSDRV_META(u32, 100,
+            "\"brief\": \"The summary stream output sample rate in Hz.\","
+            "\"detail\": \"Each summary window holds at least 8 source samples.\","
+            "\"range\": [1, 1000000]"
+        ),
+        on_summary_fs,
+    },
+    {
+        "h/gpi/0/edge/ctrl",
+        JSDRV_META(u8, 0,
+            "\"brief\": \"Enable the host-side GPI 0 edge stream s/gpi/0/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new level. Computed from s/gpi/0/!data which must also be enabled. Edges only does not publish s/gpi/0/!data.\","
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]"
+            "]"
+        ),
+        on_gpi_0_edge_ctrl,
+    },
+    {
+        "h/gpi/1/edge/ctrl",
+        JSDRV_META(u8, 0,
+            "\"brief\": \"Enable the host-side GPI 1 edge stream s/gpi/1/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new level. Computed from s/gpi/1/!data which must also be enabled. Edges only does not publish s/gpi/1/!data.\","
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]"
+            "]"
+        ),
+        on_gpi_1_edge_ctrl,
+    },
+    {
+        "h/i/range/edge/ctrl",
+        JSDRV_META(u8, 0,
+            "\"brief\": \"Enable the host-side current range change stream s/i/range/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new current range. Computed from s/i/range/!data which must also be enabled. Edges only does not publish s/i/range/!data.\","
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]"
+            "]"
+        ),
+        on_i_range_edge_ctrl,
+    },
+    {NULL, NULL, {0}, NULL},  // MUST BE LAST
 };
 
 
 JSDRV_STATIC_ASSERT((PARAM__COUNT + 1) == JSDRV_ARRAY_SIZE(PARAMS), param_length_mismatch);
 
+static const char * latency_meta = "{"
+    "\"dtype\": \"json\","
+    "\"brief\": \"The data message latency histogram.\","
+    "\"detail\": \"Published each second while streaming.\","
+    "\"flags\": [\"ro\"]"
+"}";
+
+static const char * latency_e2e_meta = "{"
+    "\"dtype\": \"json\","
+    "\"brief\": \"The end-to-end host latency histogram.\","
+    "\"detail\": \"From USB completion until the frontend publishes each data message, published each second while streaming.\","
+    "\"flags\": [\"ro\"]"
+"}";
+
 
 struct field_def_s {
     const char * data_topic;
@@ -446,35 +723,99 @@ const struct field_def_s FIELDS[] = {
         FIELD("s/gpi/1/!data",   GPI,         1, UINT,   1, 1, PARAM_GPI_1_CTRL),
 };
 
+enum derived_e {
+    DERIVED_CHARGE = 0,     // from current
+    DERIVED_ENERGY = 1,     // from power
+    DERIVED_I_RMS = 2,      // from current
+    DERIVED_I_SUMMARY = 3,  // from current
+    DERIVED_V_SUMMARY = 4,  // from voltage
+    DERIVED_P_SUMMARY = 5,  // from power
+    DERIVED_GPI_0_EDGE = 6, // from gpi 0
+    DERIVED_GPI_1_EDGE = 7, // from gpi 1
+    DERIVED_I_RANGE_EDGE = 8, // from current range
+    DERIVED_COUNT,
+};
+
+struct derived_def_s {
+    const char * data_topic;
+    uint8_t field_id;
+    uint8_t index;
+};
+
+static const struct derived_def_s DERIVED_MAP[] = {
+        {"s/q/!data",         JSDRV_FIELD_CHARGE,  0},
+        {"s/e/!data",         JSDRV_FIELD_ENERGY,  0},
+        {"s/i/rms/!data",     JSDRV_FIELD_RMS,     0},
+        {"s/i/summary/!data", JSDRV_FIELD_SUMMARY, 0},
+        {"s/v/summary/!data", JSDRV_FIELD_SUMMARY, 1},
+        {"s/p/summary/!data", JSDRV_FIELD_SUMMARY, 2},
+        {"s/gpi/0/edge/!data", JSDRV_FIELD_EDGE,   0},
+        {"s/gpi/1/edge/!data", JSDRV_FIELD_EDGE,   1},
+        {"s/i/range/edge/!data", JSDRV_FIELD_RANGE, 0},
+};
+
+JSDRV_STATIC_ASSERT(DERIVED_COUNT == JSDRV_ARRAY_SIZE(DERIVED_MAP), derived_length);
+
 struct port_s {
     struct jsdrvp_msg_s * msg;
-    struct jsdrv_downsample_s * downsample;
+    int64_t msg_time;        // USB completion time for the first msg sample
+    uint32_t data_topic_id;  // 0 or interned data topic
 };
 
 struct js110_dev_s {
     struct jsdrvp_ul_device_s ul;
     struct jsdrvp_ll_device_s ll;
     struct jsdrv_context_s * context;
+    uint16_t capture_id;        // JSDRV_ARG_USB_CAPTURE device_id, 0 to disable
     uint8_t state; // state_e
 
     struct jsdrv_union_s param_values[JSDRV_ARRAY_SIZE(PARAMS)];
     uint64_t packet_index;
     struct js110_sp_s sample_processor;
     struct js110_stats_s stats;
+    struct jsdrv_stats_windows_s stats_windows;
     uint64_t sample_id;
     struct jsdrv_tmf_s * time_map_filter;
     struct jsdrvp_msg_s * status_msg;
+    uint32_t ctrl_pending;      // outstanding jsdrvb_ctrl_async() transfers
+    uint32_t ctrl_abandon;      // outstanding transfers from a timed out flush
+    int32_t ctrl_status;        // first error since the last flush
+    int64_t stream_time;        // USB completion time of the stream message in process
+    struct jsdrv_stream_flush_s stream_flush;
+    struct jsdrv_stream_gate_s stream_gate;
+    struct jsdrv_latency_hist_s latency;
+    uint32_t latency_time_ms;
+    bool meta_published;        // metadata sent, once per device instance
+    struct js110_cal_header_s cal_hdr;  // of the parsed calibration, valid when cal_valid
+    bool cal_valid;
 
     int64_t sstats_samples_total_prev;
     struct jsdrv_tmf_s * sstats_time_map_filter;
 
     struct port_s ports[JSDRV_ARRAY_SIZE(FIELDS)];
+    struct jsdrv_downsample_mc_s * downsample;  // i, v, p in lockstep, NULL for 2 MHz
+
+    // host-side derived signals, computed from outgoing stream messages
+    uint32_t derived_topic_id[DERIVED_COUNT];
+    struct jsdrv_derived_integral_s charge;
+    struct jsdrv_derived_integral_s energy;
+    struct jsdrv_derived_rms_s i_rms;
+    struct jsdrv_derived_summary_s summary[3];  // i, v, p
+    struct jsdrv_derived_edge_s edge[3];  // gpi 0, gpi 1, current range
 
     volatile bool do_exit;
     jsdrv_thread_t thread;
+
+    // optional stream processing thread, see "h/stream/pipeline"
+    struct msg_queue_s * proc_q;    // stream data messages, NULL when processing on the device thread
+    jsdrv_thread_t proc_thread;
+    jsdrv_os_mutex_t proc_mutex;    // guards the device state between the two threads
+    bool proc_locked;               // the device thread holds proc_mutex
 };
 
 static bool handle_rsp(struct js110_dev_s * d, struct jsdrvp_msg_s * msg);
+static void pipeline_start(struct js110_dev_s * d);
+static void pipeline_stop(struct js110_dev_s * d);
 
 static const char * prefix_match_and_strip(const char * prefix, const char * topic) {
     while (*prefix) {
@@ -488,11 +829,15 @@ static const char * prefix_match_and_strip(const char * prefix, const char * top
     return topic;
 }
 
+// Await msg, or when msg is NULL, all pending control transfers.
 static struct jsdrvp_msg_s * ll_await_msg(struct js110_dev_s * d, struct jsdrvp_msg_s * msg, uint32_t timeout_ms) {
     uint32_t t_now = jsdrv_time_ms_u32();
     uint32_t t_end = t_now + timeout_ms;
 
     while (1) {
+        if ((NULL == msg) && (0 == d->ctrl_pending)) {
+            return NULL;
+        }
 #if _WIN32
         HANDLE h = msg_queue_handle_get(d->ll.rsp_q);
         WaitForSingleObject(h, timeout_ms);
@@ -527,59 +872,135 @@ static void send_to_frontend(struct js110_dev_s * d, const char * subtopic, cons
     jsdrvp_backend_send(d->context, m);
 }
 
-static int32_t jsdrvb_ctrl_out(struct js110_dev_s * d, usb_setup_t setup, const void * buffer) {
-    JSDRV_LOGI("jsdrvb_ctrl_out start");
+/**
+ * @brief Start a control transfer without waiting for completion.
+ *
+ * @param d The device instance.
+ * @param setup The USB setup packet, which also selects IN or OUT.
+ * @param buffer The OUT data with setup.s.wLength bytes, ignored for IN.
+ * @param cbk_fn The function called from handle_rsp() on success.
+ * @param cbk_user_data The arbitrary data for cbk_fn.
+ * @return 0 or error code.
+ *
+ * Control transfers complete in order.  Use jsdrvb_ctrl_flush() to
+ * wait for all pending transfers and get the first error.
+ */
+static int32_t jsdrvb_ctrl_async(struct js110_dev_s * d, usb_setup_t setup, const void * buffer,
+                                 jsdrvp_usb_ctrl_fn cbk_fn, void * cbk_user_data) {
+    bool is_in = (setup.s.bmRequestType & 0x80) ? true : false;
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
-    jsdrv_cstr_copy(m->topic, JSDRV_USBBK_MSG_CTRL_OUT, sizeof(m->topic));
+    jsdrv_cstr_copy(m->topic, is_in ? JSDRV_USBBK_MSG_CTRL_IN : JSDRV_USBBK_MSG_CTRL_OUT, sizeof(m->topic));
     m->value.type = JSDRV_UNION_BIN;
     m->value.value.bin = m->payload.bin;
     m->value.app = JSDRV_PAYLOAD_TYPE_USB_CTRL;
     m->extra.bkusb_ctrl.setup = setup;
-    if (setup.s.wLength > sizeof(m->payload.bin)) {
-        JSDRV_LOGE("ctrl_out too big: %d", (int) setup.s.wLength);
-        jsdrvp_msg_free(d->context, m);
-        return JSDRV_ERROR_PARAMETER_INVALID;
+    m->extra.bkusb_ctrl.cbk_fn = cbk_fn;
+    m->extra.bkusb_ctrl.cbk_user_data = cbk_user_data;
+    if (!is_in) {
+        if (setup.s.wLength > sizeof(m->payload.bin)) {
+            JSDRV_LOGE("ctrl_out too big: %d", (int) setup.s.wLength);
+            jsdrvp_msg_free(d->context, m);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        memcpy(m->payload.bin, buffer, setup.s.wLength);
+        m->value.size = setup.s.wLength;
     }
-    memcpy(m->payload.bin, buffer, setup.s.wLength);
-    m->value.size = setup.s.wLength;
-
+    ++d->ctrl_pending;
     msg_queue_push(d->ll.cmd_q, m);
-    m = ll_await_msg(d, m, TIMEOUT_MS);
-    if (!m) {
-        JSDRV_LOGW("ctrl_out timed out");
+    return 0;
+}
+
+static void ctrl_complete(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
+    struct jsdrvp_msg_extra_backend_usb_control_s * c = &msg->extra.bkusb_ctrl;
+    int32_t rc = 0;
+    if (d->ctrl_abandon) {
+        --d->ctrl_abandon;  // caller no longer waiting, skip callback
+        return;
+    }
+    if (d->ctrl_pending) {
+        --d->ctrl_pending;
+    }
+    if (c->status) {
+        JSDRV_LOGW("ctrl request %d failed %d", (int) c->setup.s.bRequest, (int) c->status);
+        rc = JSDRV_ERROR_IO;
+    } else if ((c->setup.s.bmRequestType & 0x80) && (msg->value.size > c->setup.s.wLength)) {
+        JSDRV_LOGW("ctrl_in returned too much data");
+        rc = JSDRV_ERROR_TOO_BIG;
+    } else {
+        rc = c->cbk_fn(c->cbk_user_data, msg);
+    }
+    if (rc && !d->ctrl_status) {
+        d->ctrl_status = rc;
+    }
+}
+
+/**
+ * @brief Wait for all pending jsdrvb_ctrl_async() transfers.
+ *
+ * @param d The device instance.
+ * @param timeout_ms The timeout in milliseconds.
+ * @return 0 or the first error.  On timeout, the remaining transfers
+ *      complete without calling their callbacks.
+ */
+static int32_t jsdrvb_ctrl_flush(struct js110_dev_s * d, uint32_t timeout_ms) {
+    ll_await_msg(d, NULL, timeout_ms);
+    if (d->ctrl_pending) {
+        JSDRV_LOGW("ctrl_flush timed out with %u pending", (unsigned int) d->ctrl_pending);
+        d->ctrl_abandon += d->ctrl_pending;
+        d->ctrl_pending = 0;
+        d->ctrl_status = 0;
         return JSDRV_ERROR_TIMED_OUT;
     }
-    jsdrvp_msg_free(d->context, m);
-    JSDRV_LOGI("jsdrvb_ctrl_out done");
+    int32_t rc = d->ctrl_status;
+    d->ctrl_status = 0;
+    return rc;
+}
+
+static int32_t ctrl_out_done(void * user_data, struct jsdrvp_msg_s * msg) {
+    (void) user_data;
+    (void) msg;
+    return 0;
+}
+
+struct ctrl_in_s {
+    void * buffer;
+    uint32_t * size;
+};
+
+static int32_t ctrl_in_done(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct ctrl_in_s * self = (struct ctrl_in_s *) user_data;
+    memcpy(self->buffer, msg->payload.bin, msg->value.size);
+    if (self->size) {
+        *self->size = msg->value.size;
+    }
     return 0;
 }
 
+static int32_t jsdrvb_ctrl_out(struct js110_dev_s * d, usb_setup_t setup, const void * buffer) {
+    JSDRV_LOGI("jsdrvb_ctrl_out start");
+    ROE(jsdrvb_ctrl_async(d, setup, buffer, ctrl_out_done, NULL));
+    int32_t rc = jsdrvb_ctrl_flush(d, TIMEOUT_MS);
+    JSDRV_LOGI("jsdrvb_ctrl_out done");
+    return rc;
+}
+
 static int32_t jsdrvb_ctrl_in(struct js110_dev_s * d, usb_setup_t setup, void * buffer, uint32_t * size) {
-    int32_t rc = 0;
-    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
-    jsdrv_cstr_copy(m->topic, JSDRV_USBBK_MSG_CTRL_IN, sizeof(m->topic));
-    m->value.type = JSDRV_UNION_BIN;
-    m->value.value.bin = m->payload.bin;
-    m->value.app = JSDRV_PAYLOAD_TYPE_USB_CTRL;
-    m->extra.bkusb_ctrl.setup = setup;
+    struct ctrl_in_s self = {.buffer = buffer, .size = size};
+    ROE(jsdrvb_ctrl_async(d, setup, NULL, ctrl_in_done, &self));
+    return jsdrvb_ctrl_flush(d, TIMEOUT_MS);
+}
 
+static int32_t jsdrvb_usb_config(struct js110_dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, topic, value);
     msg_queue_push(d->ll.cmd_q, m);
     m = ll_await_msg(d, m, TIMEOUT_MS);
     if (!m) {
-        JSDRV_LOGW("ctrl_in timed out");
+        JSDRV_LOGW("jsdrvb_usb_config timed out");
         return JSDRV_ERROR_TIMED_OUT;
     }
-    if (m->value.size > setup.s.wLength) {
-        JSDRV_LOGW("ctrl_in returned too much data");
-        rc = JSDRV_ERROR_TOO_BIG;
-    } else {
-        memcpy(buffer, m->payload.bin, m->value.size);
-        if (size) {
-            *size = m->value.size;
-        }
-    }
+    int32_t rv = m->value.value.i32;
     jsdrvp_msg_free(d->context, m);
-    return rc;
+    return rv;
 }
 
 static int32_t jsdrvb_bulk_in_stream_open(struct js110_dev_s * d, uint8_t endpoint) {
@@ -666,6 +1087,7 @@ static struct jsdrvp_msg_s * d_status_req(struct js110_dev_s * d) {
     m->value.value.bin = m->payload.bin;
     m->value.app = JSDRV_PAYLOAD_TYPE_USB_CTRL;
     m->extra.bkusb_ctrl.setup = STATUS_SETUP;
+    m->extra.bkusb_ctrl.cbk_fn = NULL;  // completes in handle_rsp with d_status_rsp
     msg_queue_push(d->ll.cmd_q, m);
     return m;
 }
@@ -674,6 +1096,10 @@ static int32_t d_status_rsp(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
     if (msg == d->status_msg) {
         d->status_msg = NULL;
     }
+    if (msg->extra.bkusb_ctrl.status) {
+        JSDRV_LOGW("d_status_rsp: failed %d", (int) msg->extra.bkusb_ctrl.status);
+        return JSDRV_ERROR_IO;
+    }
     if (msg->value.size > STATUS_SETUP.s.wLength) {
         JSDRV_LOGW("d_status_rsp: returned too much data");
         return JSDRV_ERROR_TOO_BIG;
@@ -737,10 +1163,27 @@ static bool is_streaming(struct js110_dev_s * d) {
     return (0 != stream_en) ? true : false;
 }
 
+struct cal_chunk_s {
+    uint8_t * cal;
+    uint32_t length;
+};
+
+static int32_t cal_chunk_copy(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct cal_chunk_s * self = (struct cal_chunk_s *) user_data;
+    usb_setup_t setup = msg->extra.bkusb_ctrl.setup;
+    uint32_t offset = setup.s.wIndex;
+    if ((msg->value.size != setup.s.wLength) || ((offset + msg->value.size) > self->length)) {
+        JSDRV_LOGW("cal chunk at %u: size %u != %u",
+                   (unsigned int) offset, (unsigned int) msg->value.size, (unsigned int) setup.s.wLength);
+        return JSDRV_ERROR_TOO_SMALL;
+    }
+    memcpy(self->cal + offset, msg->payload.bin, msg->value.size);
+    return 0;
+}
+
 static int32_t calibration_get(struct js110_dev_s * d) {
     int32_t rv = 0;
-    uint8_t * cal;
-    uint8_t buf[4096];
+    int32_t rc;
     struct js110_cal_header_s hdr;
     usb_setup_t setup = { .s = {
             .bmRequestType = USB_REQUEST_TYPE(IN, VENDOR, DEVICE),
@@ -755,28 +1198,42 @@ static int32_t calibration_get(struct js110_dev_s * d) {
         JSDRV_LOGW("cal too small");
         return JSDRV_ERROR_TOO_SMALL;
     }
+    if (d->cal_valid && (0 == memcmp(&hdr, &d->cal_hdr, sizeof(hdr)))) {
+        JSDRV_LOGI("calibration unchanged, crc32=0x%08x", (unsigned int) hdr.crc32);
+        return 0;  // sample_processor retains the parsed calibration
+    }
+    d->cal_valid = false;
 
-    cal = jsdrv_alloc(hdr.length);
+    // Pipeline all chunk reads, then wait once.
+    struct cal_chunk_s chunk = {.cal = jsdrv_alloc(hdr.length), .length = hdr.length};
     uint32_t offset = 0;
     while (offset < hdr.length) {
         setup.s.wIndex = offset;
         uint32_t remaining = (uint32_t) (hdr.length - offset);
-        setup.s.wLength = sizeof(buf);
+        setup.s.wLength = 4096;
         if (remaining < setup.s.wLength) {
             setup.s.wLength = remaining;
         }
-        rv = jsdrvb_ctrl_in(d, setup, buf, &sz);
+        rv = jsdrvb_ctrl_async(d, setup, NULL, cal_chunk_copy, &chunk);
         if (rv) {
             break;
         }
-        memcpy(cal + offset, buf, sz);
-        offset += sz;
+        offset += setup.s.wLength;
+    }
+    rc = jsdrvb_ctrl_flush(d, TIMEOUT_MS);  // always, chunk is on the stack
+    if (0 == rv) {
+        rv = rc;
     }
 
     if (0 == rv) {
-        rv = js110_cal_parse(cal, d->sample_processor.cal);
+        rv = js110_cal_parse(chunk.cal, d->sample_processor.cal);
+        js110_sp_cal_update(&d->sample_processor);
     }
-    jsdrv_free(cal);
+    if (0 == rv) {
+        d->cal_hdr = hdr;
+        d->cal_valid = true;
+    }
+    jsdrv_free(chunk.cal);
     return rv;
 }
 
@@ -813,10 +1270,28 @@ static int32_t stream_settings_send(struct js110_dev_s * d) {
     return 0;
 }
 
-static int32_t stream_settings_sync(struct js110_dev_s * d) {
+static int32_t stream_settings_sync_done(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct js110_dev_s * d = (struct js110_dev_s *) user_data;
     struct js110_host_packet_s pkt;
+    uint32_t size = msg->value.size;
     memset(&pkt, 0, sizeof(pkt));
+    memcpy(&pkt, msg->payload.bin, (size < sizeof(pkt)) ? size : sizeof(pkt));
+    if ((size != 16)
+                || (pkt.header.version != JS110_HOST_API_VERSION)
+                || (pkt.header.type != JS110_HOST_PACKET_TYPE_SETTINGS)) {
+        JSDRV_LOGW("stream_settings_sync unexpected response: size=%d, ver=%d, type=%d",
+                   (int) size, (int) pkt.header.version, (int) pkt.header.type);
+        return JSDRV_ERROR_IO;
+    }
+    d->param_values[PARAM_I_RANGE_SELECT].value.u8 = pkt.payload.settings.select;
+    d->param_values[PARAM_V_RANGE_SELECT].value.u8 = (pkt.payload.settings.options >> 1) & 1;
+    send_to_frontend(d, "s/i/range/select", &d->param_values[PARAM_I_RANGE_SELECT]);
+    send_to_frontend(d, "s/v/range/select", &d->param_values[PARAM_V_RANGE_SELECT]);
+    return 0;
+}
 
+// Start the request, completes on jsdrvb_ctrl_flush().
+static int32_t stream_settings_sync(struct js110_dev_s * d) {
     usb_setup_t setup = { .s = {
             .bmRequestType = USB_REQUEST_TYPE(IN, VENDOR, DEVICE),
             .bRequest = JS110_HOST_USB_REQUEST_SETTINGS,
@@ -824,23 +1299,7 @@ static int32_t stream_settings_sync(struct js110_dev_s * d) {
             .wIndex = 0,
             .wLength = 16,
     }};
-    uint32_t size = 0;
-    if (jsdrvb_ctrl_in(d, setup, &pkt, &size)) {
-        JSDRV_LOGW("stream_settings_sync failed");
-        return JSDRV_ERROR_IO;
-    } else if ((size != 16)
-                || (pkt.header.version != JS110_HOST_API_VERSION)
-                || (pkt.header.type != JS110_HOST_PACKET_TYPE_SETTINGS)) {
-        JSDRV_LOGW("stream_settings_sync unexpected response: size=%d, ver=%d, type=%d",
-                   (int) size, (int) pkt.header.version, (int) pkt.header.type);
-        return JSDRV_ERROR_IO;
-    } else {
-        d->param_values[PARAM_I_RANGE_SELECT].value.u8 = pkt.payload.settings.select;
-        d->param_values[PARAM_V_RANGE_SELECT].value.u8 = (pkt.payload.settings.options >> 1) & 1;
-        send_to_frontend(d, "s/i/range/select", &d->param_values[PARAM_I_RANGE_SELECT]);
-        send_to_frontend(d, "s/v/range/select", &d->param_values[PARAM_V_RANGE_SELECT]);
-    }
-    return 0;
+    return jsdrvb_ctrl_async(d, setup, NULL, stream_settings_sync_done, d);
 }
 
 static int32_t extio_settings_send(struct js110_dev_s * d) {
@@ -875,22 +1334,13 @@ static int32_t extio_settings_send(struct js110_dev_s * d) {
     return 0;
 }
 
-static int32_t extio_settings_sync(struct js110_dev_s * d) {
+static int32_t extio_settings_sync_done(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct js110_dev_s * d = (struct js110_dev_s *) user_data;
     struct js110_host_packet_s pkt;
+    uint32_t size = msg->value.size;
     memset(&pkt, 0, sizeof(pkt));
-
-    usb_setup_t setup = { .s = {
-            .bmRequestType = USB_REQUEST_TYPE(IN, VENDOR, DEVICE),
-            .bRequest = JS110_HOST_USB_REQUEST_EXTIO,
-            .wValue = 0,
-            .wIndex = 0,
-            .wLength = 24,
-    }};
-    uint32_t size = 0;
-    if (jsdrvb_ctrl_in(d, setup, &pkt, &size)) {
-        JSDRV_LOGW("extio_settings_sync failed");
-        return JSDRV_ERROR_IO;
-    } else if ((size != 24)
+    memcpy(&pkt, msg->payload.bin, (size < sizeof(pkt)) ? size : sizeof(pkt));
+    if ((size != 24)
                || (pkt.header.version != JS110_HOST_API_VERSION)
                || (pkt.header.type != JS110_HOST_PACKET_TYPE_EXTIO)) {
         JSDRV_LOGW("extio_settings_sync unexpected response: size=%d, ver=%d, type=%d",
@@ -912,23 +1362,42 @@ static int32_t extio_settings_sync(struct js110_dev_s * d) {
     return 0;
 }
 
-static int32_t extio_gpi_recv(struct js110_dev_s * d, uint8_t * gpi) {
-    struct js110_host_packet_s pkt;
-    memset(&pkt, 0, sizeof(pkt));
-    uint32_t sz = 0;
+// Start the request, completes on jsdrvb_ctrl_flush().
+static int32_t extio_settings_sync(struct js110_dev_s * d) {
     usb_setup_t setup = { .s = {
             .bmRequestType = USB_REQUEST_TYPE(IN, VENDOR, DEVICE),
             .bRequest = JS110_HOST_USB_REQUEST_EXTIO,
             .wValue = 0,
             .wIndex = 0,
-            .wLength = sizeof(pkt),
+            .wLength = 24,
     }};
-    if (jsdrvb_ctrl_in(d, setup, &pkt, &sz)) {
-        JSDRV_LOGW("extio_settings_recv failed");
-        return JSDRV_ERROR_IO;
+    return jsdrvb_ctrl_async(d, setup, NULL, extio_settings_sync_done, d);
+}
+
+static void extio_gpi_req(struct js110_dev_s * d) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
+    jsdrv_cstr_copy(m->topic, JSDRV_USBBK_MSG_CTRL_IN, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_USB_CTRL;
+    m->extra.bkusb_ctrl.setup = EXTIO_GPI_SETUP;
+    m->extra.bkusb_ctrl.cbk_fn = NULL;  // completes in handle_rsp with extio_gpi_rsp
+    msg_queue_push(d->ll.cmd_q, m);
+}
+
+static void extio_gpi_rsp(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
+    int32_t rv = 0;
+    struct js110_host_packet_s * pkt = (struct js110_host_packet_s *) msg->payload.bin;
+    if (msg->extra.bkusb_ctrl.status) {
+        JSDRV_LOGW("extio_gpi_rsp failed %d", (int) msg->extra.bkusb_ctrl.status);
+        rv = JSDRV_ERROR_IO;
+    } else if (msg->value.size > EXTIO_GPI_SETUP.s.wLength) {
+        JSDRV_LOGW("extio_gpi_rsp: returned too much data");
+        rv = JSDRV_ERROR_TOO_BIG;
+    } else {
+        send_to_frontend(d, "s/gpi/+/!value", &jsdrv_union_u8(pkt->payload.extio.gpi_value));
     }
-    *gpi = pkt.payload.extio.gpi_value;
-    return 0;
+    send_to_frontend(d, "s/gpi/+/!req#", &jsdrv_union_i32(rv));
 }
 
 static void on_i_range_select(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
@@ -990,20 +1459,37 @@ static void on_i_range_post(struct js110_dev_s * d, const struct jsdrv_union_s *
     d->sample_processor._suppress_samples_post = value->value.u8;
 }
 
+static void on_i_range_lazy(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    JSDRV_LOGI("on_i_range_lazy %d", (int) value->value.u8);
+    js110_sp_suppress_lazy(&d->sample_processor, value->value.u8);
+}
+
+static void on_cal_lut(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    JSDRV_LOGI("on_cal_lut %d", (int) value->value.u8);
+    if (js110_sp_cal_lut(&d->sample_processor, value->value.u8)) {
+        JSDRV_LOGW("cal lut allocation failed");
+    }
+}
+
 static void reset_port(struct js110_dev_s * d, uint32_t port_idx) {
     if (port_idx >= JSDRV_ARRAY_SIZE(FIELDS)) {
         return;
     }
     struct port_s *p = &d->ports[port_idx];
-    if (NULL != p->downsample) {
-        jsdrv_downsample_clear(p->downsample);
-    }
     if (NULL != p->msg) {
         jsdrvp_msg_free(d->context, p->msg);
         p->msg = NULL;
     }
 }
 
+static int flat_passband_mode(struct js110_dev_s * d) {
+    switch (d->param_values[PARAM_FILTER_ARITH].value.u32) {
+        case 1: return JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32;
+        case 2: return JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64;
+        default: return JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND;
+    }
+}
+
 static void on_sampling_frequency(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
     struct jsdrv_union_s v = *value;
     uint32_t fs;
@@ -1012,16 +1498,27 @@ static void on_sampling_frequency(struct js110_dev_s * d, const struct jsdrv_uni
         return;
     }
     fs = v.value.u32;
+    if ((0 == fs) || (SAMPLING_FREQUENCY % fs)) {  // stream headers need integer decimation
+        JSDRV_LOGW("Unsupported sampling frequency %lu", fs);
+        return;
+    }
+    d->param_values[PARAM_SAMPLE_FREQUENCY] = v;
     JSDRV_LOGI("on_sampling_frequency(%lu)", fs);
     for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(FIELDS); ++idx) {
-        struct port_s *p = &d->ports[idx];
-        if (NULL != p->downsample) {
-            jsdrv_downsample_free(p->downsample);
-            p->downsample = NULL;
-        }
         reset_port(d, idx);
-        p->downsample = jsdrv_downsample_alloc(SAMPLING_FREQUENCY, fs, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND);
     }
+    jsdrv_downsample_mc_free(d->downsample);
+    d->downsample = jsdrv_downsample_mc_alloc(SAMPLING_FREQUENCY, fs, flat_passband_mode(d), 3);
+}
+
+static void on_filter_arith(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 > 2)) {
+        JSDRV_LOGW("Could not process filter arithmetic setting");
+        return;
+    }
+    d->param_values[PARAM_FILTER_ARITH] = v;
+    on_sampling_frequency(d, &d->param_values[PARAM_SAMPLE_FREQUENCY]);
 }
 
 static void on_update_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value, int32_t param) {
@@ -1033,6 +1530,7 @@ static void on_update_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s *
         if (!s1) {  // enabling streaming
             js110_sp_reset(&d->sample_processor);
             js110_stats_clear(&d->stats);
+            jsdrv_stats_windows_clear(&d->stats_windows);
             d->sample_id = 0;
             d->packet_index = 0;
         } else {    // disabling streaming
@@ -1043,8 +1541,8 @@ static void on_update_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s *
                 if (NULL != m) {
                     jsdrvp_msg_free(d->context, m);
                 }
-                jsdrv_downsample_clear(p->downsample);
             }
+            jsdrv_downsample_mc_clear(d->downsample);
             d->sample_id = 0;
         }
         stream_settings_send(d);
@@ -1092,36 +1590,231 @@ static void on_sstats_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s *
     d->param_values[PARAM_SSTATS_CTRL] = *value;
 }
 
-static int32_t d_open_ll(struct js110_dev_s * d, int32_t opt) {
-    JSDRV_LOGI("open_ll");
-    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, JSDRV_MSG_OPEN, &jsdrv_union_i32(opt & 1));
-    msg_queue_push(d->ll.cmd_q, m);
-    m = ll_await_msg(d, m, TIMEOUT_MS);
-    if (!m) {
-        JSDRV_LOGW("ll_driver open timed out");
-        return JSDRV_ERROR_TIMED_OUT;
-    }
-    int32_t rc = m->value.value.i32;
-    jsdrvp_msg_free(d->context, m);
-    if (rc) {
-        JSDRV_LOGE("open_ll failed");
-        return rc;
-    }
-    d->state = ST_OPENING;
-    return 0;
+static void on_stats_win_scnt(struct js110_dev_s * d, const struct jsdrv_union_s * value, uint8_t slot) {
+    struct jsdrv_union_s v = *value;
+    jsdrv_union_as_type(&v, JSDRV_UNION_U32);
+    jsdrv_stats_windows_scnt_set(&d->stats_windows, slot, v.value.u32);
 }
 
-static void d_reset(struct js110_dev_s * d) {
-    js110_sp_reset(&d->sample_processor);
-    js110_stats_clear(&d->stats);
-    d->sample_id = 0;
-    jsdrv_tmf_clear(d->time_map_filter);
+static void on_stats_win0_scnt(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    on_stats_win_scnt(d, value, 0);
+}
+
+static void on_stats_win1_scnt(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    on_stats_win_scnt(d, value, 1);
+}
+
+static void on_stream_flush(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || jsdrv_stream_flush_ms_set(&d->stream_flush, v.value.u32)) {
+        JSDRV_LOGW("on_stream_flush: invalid value, ignore");
+        return;
+    }
+    d->param_values[PARAM_STREAM_FLUSH_MS] = v;
+}
+
+static void on_stream_flush_bytes(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        JSDRV_LOGW("on_stream_flush_bytes: invalid value, ignore");
+        return;
+    }
+    jsdrv_stream_flush_bytes_set(&d->stream_flush, v.value.u32);
+    d->param_values[PARAM_STREAM_FLUSH_BYTES] = v;
+}
+
+static void on_stream_pipeline(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U8)) {
+        JSDRV_LOGW("on_stream_pipeline: invalid value, ignore");
+        return;
+    }
+    d->param_values[PARAM_STREAM_PIPELINE] = v;
+    if (d->state != ST_OPEN) {
+        // applied on open
+    } else if (v.value.u8) {
+        pipeline_start(d);
+    } else {
+        pipeline_stop(d);
+    }
+}
+
+static void on_stream_flush_mode(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || jsdrv_stream_flush_mode_set(&d->stream_flush, v.value.u32)) {
+        JSDRV_LOGW("on_stream_flush_mode: invalid value, ignore");
+        return;
+    }
+    d->param_values[PARAM_STREAM_FLUSH_MODE] = v;
+}
+
+static void on_stream_gate(struct js110_dev_s * d, uint64_t * sample_id, enum param_e param,
+                           const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U64)) {
+        JSDRV_LOGW("on_stream_gate: invalid value, ignore");
+        return;
+    }
+    *sample_id = v.value.u64;
+    d->param_values[param] = v;
+}
+
+static void on_stream_gate_utc(struct js110_dev_s * d, uint64_t * sample_id, enum param_e param,
+                               const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    struct jsdrv_time_map_s time_map;
+    uint64_t s = 0;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_I64)) {
+        JSDRV_LOGW("on_stream_gate_utc: invalid value, ignore");
+        return;
+    }
+    if (v.value.i64) {
+        jsdrv_tmf_get(d->time_map_filter, &time_map);
+        if (jsdrv_stream_gate_utc_to_sample_id(&time_map, v.value.i64, &s)) {
+            JSDRV_LOGW("on_stream_gate_utc: time map unavailable, ignore");
+            return;
+        }
+    }
+    *sample_id = s;
+    d->param_values[param] = v;
+}
+
+static void on_stream_gate_start(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    on_stream_gate(d, &d->stream_gate.start, PARAM_STREAM_GATE_START, value);
+}
+
+static void on_stream_gate_stop(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    on_stream_gate(d, &d->stream_gate.stop, PARAM_STREAM_GATE_STOP, value);
+}
+
+static void on_stream_gate_start_utc(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    on_stream_gate_utc(d, &d->stream_gate.start, PARAM_STREAM_GATE_START_UTC, value);
+}
+
+static void on_stream_gate_stop_utc(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    on_stream_gate_utc(d, &d->stream_gate.stop, PARAM_STREAM_GATE_STOP_UTC, value);
+}
+
+static bool derived_ctrl_update(struct js110_dev_s * d, const struct jsdrv_union_s * value, enum param_e param) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U8)) {
+        JSDRV_LOGW("derived_ctrl_update: invalid value, ignore");
+        return false;
+    }
+    bool restart = v.value.u8 && !d->param_values[param].value.u8;  // restart on enable
+    d->param_values[param] = v;
+    return restart;
+}
+
+static void on_q_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    if (derived_ctrl_update(d, value, PARAM_Q_CTRL)) {
+        jsdrv_derived_integral_clear(&d->charge);
+    }
+}
+
+static void on_e_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    if (derived_ctrl_update(d, value, PARAM_E_CTRL)) {
+        jsdrv_derived_integral_clear(&d->energy);
+    }
+}
+
+static void on_i_rms_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    if (derived_ctrl_update(d, value, PARAM_I_RMS_CTRL)) {
+        jsdrv_derived_rms_clear(&d->i_rms, d->param_values[PARAM_I_RMS_WINDOW].value.u32);
+    }
+}
+
+static void on_i_rms_window(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 < 1) || (v.value.u32 > JSDRV_DERIVED_RMS_WINDOW_MAX)) {
+        JSDRV_LOGW("on_i_rms_window: invalid value, ignore");
+        return;
+    }
+    d->param_values[PARAM_I_RMS_WINDOW] = v;
+    jsdrv_derived_rms_clear(&d->i_rms, v.value.u32);
+}
+
+static void summary_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value, uint8_t idx) {
+    if (derived_ctrl_update(d, value, PARAM_I_SUMMARY_CTRL + idx)) {
+        jsdrv_derived_summary_clear(&d->summary[idx], d->param_values[PARAM_SUMMARY_FS].value.u32);
+    }
+}
+
+static void on_i_summary_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    summary_ctrl(d, value, 0);
+}
+
+static void on_v_summary_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    summary_ctrl(d, value, 1);
+}
+
+static void on_p_summary_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    summary_ctrl(d, value, 2);
+}
+
+static void on_summary_fs(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 < 1) || (v.value.u32 > 1000000U)) {
+        JSDRV_LOGW("on_summary_fs: invalid value, ignore");
+        return;
+    }
+    d->param_values[PARAM_SUMMARY_FS] = v;
+    for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->summary); ++idx) {
+        jsdrv_derived_summary_clear(&d->summary[idx], v.value.u32);
+    }
+}
+
+static void edge_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value, uint8_t idx) {
+    // 0 off, 1 edges and samples, 2 edges only
+    if (derived_ctrl_update(d, value, PARAM_GPI_0_EDGE_CTRL + idx)) {
+        jsdrv_derived_edge_clear(&d->edge[idx]);
+    }
+}
+
+static void on_gpi_0_edge_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    edge_ctrl(d, value, 0);
+}
+
+static void on_gpi_1_edge_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    edge_ctrl(d, value, 1);
+}
+
+static void on_i_range_edge_ctrl(struct js110_dev_s * d, const struct jsdrv_union_s * value) {
+    edge_ctrl(d, value, 2);
+}
+
+static int32_t d_open_ll(struct js110_dev_s * d, int32_t opt) {
+    JSDRV_LOGI("open_ll");
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, JSDRV_MSG_OPEN, &jsdrv_union_i32(opt & 1));
+    msg_queue_push(d->ll.cmd_q, m);
+    m = ll_await_msg(d, m, TIMEOUT_MS);
+    if (!m) {
+        JSDRV_LOGW("ll_driver open timed out");
+        return JSDRV_ERROR_TIMED_OUT;
+    }
+    int32_t rc = m->value.value.i32;
+    jsdrvp_msg_free(d->context, m);
+    if (rc) {
+        JSDRV_LOGE("open_ll failed");
+        return rc;
+    }
+    d->state = ST_OPENING;
+    return 0;
+}
+
+static void d_reset(struct js110_dev_s * d) {
+    js110_sp_reset(&d->sample_processor);
+    js110_stats_clear(&d->stats);
+    jsdrv_stats_windows_clear(&d->stats_windows);
+    d->sample_id = 0;
+    jsdrv_tmf_clear(d->time_map_filter);
     jsdrv_tmf_clear(d->sstats_time_map_filter);
     d->sstats_samples_total_prev = 0;
 
     for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(FIELDS); ++idx) {
         reset_port(d, idx);
     }
+    jsdrv_downsample_mc_clear(d->downsample);
 }
 
 static int32_t d_open(struct js110_dev_s * d, int32_t opt) {
@@ -1151,19 +1844,29 @@ static int32_t d_open(struct js110_dev_s * d, int32_t opt) {
         JSDRV_LOGE("loopback failed");
     }
 
-    // Publish topic metadata
-    for (int i = 0; NULL != PARAMS[i].topic; ++i) {
-        const struct param_s * p = &PARAMS[i];
-        struct jsdrv_topic_s topic;
-        jsdrv_topic_set(&topic, p->topic);
-        jsdrv_topic_suffix_add(&topic, JSDRV_TOPIC_SUFFIX_METADATA_RSP);
-        send_to_frontend(d, topic.topic, &jsdrv_union_cjson_r(p->meta));
+    // Publish topic metadata once, pubsub retains it across open/close
+    if (!d->meta_published) {
+        for (int i = 0; NULL != PARAMS[i].topic; ++i) {
+            const struct param_s * p = &PARAMS[i];
+            struct jsdrv_topic_s topic;
+            jsdrv_topic_set(&topic, p->topic);
+            jsdrv_topic_suffix_add(&topic, JSDRV_TOPIC_SUFFIX_METADATA_RSP);
+            send_to_frontend(d, topic.topic, &jsdrv_union_cjson_r(p->meta));
+        }
+        send_to_frontend(d, "h/stream/latency$", &jsdrv_union_cjson_r(latency_meta));
+        send_to_frontend(d, "h/stream/e2e$", &jsdrv_union_cjson_r(latency_e2e_meta));
+        d->meta_published = true;
     }
 
     ROE(calibration_get(d));
     if (opt != JSDRV_DEVICE_OPEN_MODE_DEFAULTS) {
-        ROE(stream_settings_sync(d));
-        ROE(extio_settings_sync(d));
+        int32_t rc = stream_settings_sync(d);
+        if (0 == rc) {
+            rc = extio_settings_sync(d);
+        }
+        int32_t rc_flush = jsdrvb_ctrl_flush(d, TIMEOUT_MS);
+        ROE(rc);
+        ROE(rc_flush);
     }
     ROE(stream_settings_send(d));
 
@@ -1174,6 +1877,9 @@ static int32_t d_open(struct js110_dev_s * d, int32_t opt) {
         send_to_frontend(d, PARAMS[i].topic, &d->param_values[i]);
     }
 
+    if (d->param_values[PARAM_STREAM_PIPELINE].value.u8) {
+        pipeline_start(d);
+    }
     ROE(jsdrvb_bulk_in_stream_open(d, 2));
 
     JSDRV_LOGI("open complete");
@@ -1183,6 +1889,7 @@ static int32_t d_open(struct js110_dev_s * d, int32_t opt) {
 
 static int32_t d_close(struct js110_dev_s * d) {
     JSDRV_LOGI("close");
+    pipeline_stop(d);
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, JSDRV_MSG_CLOSE, &jsdrv_union_u32(0));
     msg_queue_push(d->ll.cmd_q, m);
     m = ll_await_msg(d, m, TIMEOUT_MS);
@@ -1222,19 +1929,8 @@ static void handle_cmd_publish(struct js110_dev_s * d, const struct jsdrvp_msg_s
 }
 
 static void handle_cmd_gpi_req(struct js110_dev_s * d, const struct jsdrvp_msg_s * msg) {
-    uint8_t gpi = 0;
-    int32_t rv;
-    struct jsdrv_topic_s topic;
-    const char * topic_str = prefix_match_and_strip(d->ll.prefix, msg->topic);
-    jsdrv_topic_set(&topic, topic_str);
-    jsdrv_topic_suffix_add(&topic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
-    JSDRV_LOGI("handle_cmd_gpi_req %s", topic_str);
-
-    rv = extio_gpi_recv(d, &gpi);
-    if (0 == rv) {
-        send_to_frontend(d, "s/gpi/+/!value", &jsdrv_union_u8(gpi));
-    }
-    send_to_frontend(d, topic.topic, &jsdrv_union_i32(rv));
+    JSDRV_LOGI("handle_cmd_gpi_req %s", msg->topic);
+    extio_gpi_req(d);  // responds from handle_rsp, without blocking the stream
 }
 
 static bool handle_cmd(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
@@ -1282,6 +1978,16 @@ static bool handle_cmd(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
         send_to_frontend(d, topic, &jsdrv_union_i32(JSDRV_ERROR_CLOSED));
     } else if (0 == strcmp("s/gpi/+/!req", topic)) {
         handle_cmd_gpi_req(d, msg);
+    } else if (jsdrv_cstr_starts_with(topic, "h/thread/")) {
+        struct jsdrv_topic_s rc_topic;
+        jsdrv_topic_set(&rc_topic, topic);
+        jsdrv_topic_suffix_add(&rc_topic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+        send_to_frontend(d, rc_topic.topic, &jsdrv_union_i32(jsdrvp_thread_topic(topic, &msg->value)));
+    } else if (jsdrv_cstr_starts_with(topic, JSDRV_USBBK_MSG_CONFIG_PREFIX)) {
+        struct jsdrv_topic_s rc_topic;
+        jsdrv_topic_set(&rc_topic, topic);
+        jsdrv_topic_suffix_add(&rc_topic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+        send_to_frontend(d, rc_topic.topic, &jsdrv_union_i32(jsdrvb_usb_config(d, topic, &msg->value)));
     } else {
         handle_cmd_publish(d, msg);
     }
@@ -1289,30 +1995,49 @@ static bool handle_cmd(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
     return rv;
 }
 
-static struct jsdrvp_msg_s * field_message_get(struct js110_dev_s * d, uint8_t field_idx) {
+static uint32_t element_count_max_get(struct js110_dev_s * d, uint32_t decimate_factor, uint8_t element_size_bits) {
+    return jsdrv_stream_flush_element_count_max(&d->stream_flush, SAMPLING_FREQUENCY / decimate_factor, element_size_bits);
+}
+
+static bool field_is_enabled(struct js110_dev_s * d, uint8_t field_idx) {
+    struct port_s * p = &d->ports[field_idx];
+    if (d->param_values[FIELDS[field_idx].param].value.u8) {
+        return true;
+    }
+    if (p->msg) {
+        JSDRV_LOGI("channel disabled, discard partial message");
+        jsdrvp_msg_free(d->context, p->msg);
+        p->msg = NULL;
+    }
+    return false;
+}
+
+static struct jsdrvp_msg_s * field_message_get(struct js110_dev_s * d, uint8_t field_idx, uint64_t sample_id) {
     struct jsdrv_stream_signal_s * s;
     const struct field_def_s * field_def = &FIELDS[field_idx];
     struct jsdrvp_msg_s * m;
     struct port_s * p = &d->ports[field_idx];
 
-    if (0 == d->param_values[field_def->param].value.u8) {
-        if (p->msg) {
-            JSDRV_LOGI("channel disabled, discard partial message");
-            jsdrvp_msg_free(d->context, p->msg);
-            p->msg = NULL;
-        }
-        return NULL;
-    }
-
     if (NULL == p->msg) {
-        uint32_t decimate_factor = jsdrv_downsample_decimate_factor(p->downsample);
-        if (d->sample_id % decimate_factor) {
+        uint32_t decimate_factor = jsdrv_downsample_mc_decimate_factor(d->downsample);
+        if (sample_id % decimate_factor) {
             return NULL;
         }
-        m = jsdrvp_msg_alloc_data(d->context, "");
-        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, field_def->data_topic);
+        uint32_t element_count_max = element_count_max_get(d, decimate_factor, field_def->element_size_bits);
+        uint32_t sz = JSDRV_STREAM_HEADER_SIZE + JS220_USB_FRAME_LENGTH
+                + (element_count_max * field_def->element_size_bits + 7) / 8;
+        if (!p->data_topic_id) {
+            char topic[JSDRV_TOPIC_LENGTH_MAX];
+            tfp_snprintf(topic, sizeof(topic), "%s/%s", d->ll.prefix, field_def->data_topic);
+            p->data_topic_id = jsdrvp_topic_intern(d->context, topic);
+        }
+        m = jsdrvp_msg_alloc_data_sz(d->context, "", sz);
+        m->topic_id = p->data_topic_id;
+        if (!m->topic_id) {
+            tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, field_def->data_topic);
+        }
         s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
-        s->sample_id = d->sample_id;
+        s->sample_id = sample_id;
         s->index = field_def->index;
         s->field_id = field_def->field_id;
         s->element_type = field_def->element_type;
@@ -1320,114 +2045,388 @@ static struct jsdrvp_msg_s * field_message_get(struct js110_dev_s * d, uint8_t f
         s->sample_rate = SAMPLING_FREQUENCY;
         s->decimate_factor = decimate_factor;
         s->element_count = 0;
-        m->u32_a = (uint32_t) d->sample_id;
+        s->host_time.usb = d->stream_time;
+        s->host_time.dispatch = 0;
+        s->host_time.publish = 0;
+        m->u32_a = (uint32_t) sample_id;
         m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
         m->value.size = JSDRV_STREAM_HEADER_SIZE;
         p->msg = m;
+        p->msg_time = d->stream_time;
     }
 
     return p->msg;
 }
 
-static void field_message_process_end(struct js110_dev_s * d, uint8_t idx) {
-    struct port_s * p = &d->ports[idx];
-    struct jsdrvp_msg_s * m = p->msg;
+static struct jsdrvp_msg_s * derived_msg_alloc(struct js110_dev_s * d, uint8_t idx, uint32_t size) {
+    const struct derived_def_s * def = &DERIVED_MAP[idx];
+    if (!d->derived_topic_id[idx]) {
+        char topic[JSDRV_TOPIC_LENGTH_MAX];
+        tfp_snprintf(topic, sizeof(topic), "%s/%s", d->ll.prefix, def->data_topic);
+        d->derived_topic_id[idx] = jsdrvp_topic_intern(d->context, topic);
+    }
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(d->context, "", JSDRV_STREAM_HEADER_SIZE + size);
+    m->topic_id = d->derived_topic_id[idx];
+    if (!m->topic_id) {
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, def->data_topic);
+    }
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    m->value.size = JSDRV_STREAM_HEADER_SIZE;
+    return m;
+}
+
+static void derived_msg_send(struct js110_dev_s * d, uint8_t idx, struct jsdrvp_msg_s * m) {
     struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
-    ++s->element_count;
-    if ((s->element_size_bits < 8) && (((s->element_count * s->element_size_bits) & 0x7) != 0)) {
+    if (!s->element_count) {
+        jsdrvp_msg_free(d->context, m);
         return;
     }
-    uint32_t element_count_max = SAMPLING_FREQUENCY / (20 * jsdrv_downsample_decimate_factor(p->downsample));
-    if (element_count_max < 1) {
-        element_count_max = 1;
-    }
-    if ((((s->element_count * s->element_size_bits) / 8) >= STREAM_PAYLOAD_FULL)
-            || (s->element_count >= element_count_max)) {
-        jsdrv_tmf_get(d->time_map_filter, &s->time_map);
-        p->msg->value.size = JSDRV_STREAM_HEADER_SIZE + s->element_count * s->element_size_bits / 8;
-        jsdrvp_backend_send(d->context, p->msg);
-        p->msg = NULL;
+    s->field_id = DERIVED_MAP[idx].field_id;
+    s->index = DERIVED_MAP[idx].index;
+    s->host_time.dispatch = jsdrv_time_utc();
+    m->u32_a = (uint32_t) s->sample_id;
+    m->value.size = JSDRV_STREAM_HEADER_SIZE + ((s->element_count * s->element_size_bits) / 8);
+    jsdrvp_backend_send(d->context, m);
+}
+
+static void derived_integral(struct js110_dev_s * d, uint8_t idx, struct jsdrv_derived_integral_s * integral,
+                             const struct jsdrv_stream_signal_s * src) {
+    uint32_t offset = 0;
+    while (offset < src->element_count) {
+        uint32_t length = src->element_count - offset;
+        if (length > JSDRV_DERIVED_INTEGRAL_LENGTH_MAX) {
+            length = JSDRV_DERIVED_INTEGRAL_LENGTH_MAX;
+        }
+        struct jsdrvp_msg_s * m = derived_msg_alloc(d, idx, length * sizeof(double));
+        struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+        offset += jsdrv_derived_integral(integral, src, offset, s);
+        derived_msg_send(d, idx, m);
     }
 }
 
-static void add_f32_field(struct js110_dev_s * d, uint8_t field_idx, float value) {
-    struct port_s * p = &d->ports[field_idx];
-    struct jsdrvp_msg_s * m = field_message_get(d, field_idx);
-    if (NULL == m) {
+static void derived_summary(struct js110_dev_s * d, uint8_t idx, const struct jsdrv_stream_signal_s * src) {
+    if (!d->param_values[PARAM_I_SUMMARY_CTRL + idx].value.u8) {
         return;
     }
-    if (!jsdrv_downsample_add_f32(p->downsample, d->sample_processor.sample_count - 1, value, &value)) {
+    uint32_t length = src->element_count / JSDRV_DERIVED_SUMMARY_WINDOW_MIN + 1;
+    struct jsdrvp_msg_s * m = derived_msg_alloc(d, DERIVED_I_SUMMARY + idx,
+                                                length * sizeof(struct jsdrv_summary_entry_s));
+    jsdrv_derived_summary(&d->summary[idx], src, (struct jsdrv_stream_signal_s *) m->value.value.bin);
+    derived_msg_send(d, DERIVED_I_SUMMARY + idx, m);
+}
+
+static void derived_edge(struct js110_dev_s * d, uint8_t idx, const struct jsdrv_stream_signal_s * src) {
+    if (!d->param_values[PARAM_GPI_0_EDGE_CTRL + idx].value.u8) {
         return;
     }
-    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
-    float *data = (float *) s->data;
-    data[s->element_count] = value;
-    field_message_process_end(d, field_idx);
+    uint32_t offset = 0;
+    while (offset < src->element_count) {
+        struct jsdrvp_msg_s * m = derived_msg_alloc(d, DERIVED_GPI_0_EDGE + idx,
+                                                    JSDRV_DERIVED_EDGE_LENGTH_MAX * sizeof(struct jsdrv_edge_s));
+        offset += jsdrv_derived_edge(&d->edge[idx], src, offset, (struct jsdrv_stream_signal_s *) m->value.value.bin);
+        derived_msg_send(d, DERIVED_GPI_0_EDGE + idx, m);
+    }
 }
 
-static void add_u4_field(struct js110_dev_s * d, uint8_t field_idx, uint8_t value) {
-    struct jsdrv_stream_signal_s * s;
-    struct port_s * p = &d->ports[field_idx];
-    struct jsdrvp_msg_s * m = field_message_get(d, field_idx);
-    if (NULL == m) {
+static void derived_process(struct js110_dev_s * d, uint8_t field_idx, const struct jsdrvp_msg_s * m) {
+    const struct jsdrv_stream_signal_s * src = (const struct jsdrv_stream_signal_s *) m->value.value.bin;
+    uint8_t field_id = FIELDS[field_idx].field_id;
+    if (field_id == JSDRV_FIELD_GPI) {
+        derived_edge(d, FIELDS[field_idx].index, src);
+        return;
+    } else if (field_id == JSDRV_FIELD_RANGE) {
+        derived_edge(d, 2, src);
         return;
     }
+    if ((field_id >= JSDRV_FIELD_CURRENT) && (field_id <= JSDRV_FIELD_POWER)) {
+        derived_summary(d, field_id - JSDRV_FIELD_CURRENT, src);
+    }
+    if (FIELDS[field_idx].field_id == JSDRV_FIELD_CURRENT) {
+        if (d->param_values[PARAM_Q_CTRL].value.u8) {
+            derived_integral(d, DERIVED_CHARGE, &d->charge, src);
+        }
+        if (d->param_values[PARAM_I_RMS_CTRL].value.u8) {
+            // each window contains at least one source sample
+            struct jsdrvp_msg_s * m_rms = derived_msg_alloc(d, DERIVED_I_RMS, src->element_count * sizeof(float));
+            jsdrv_derived_rms(&d->i_rms, src, (struct jsdrv_stream_signal_s *) m_rms->value.value.bin);
+            derived_msg_send(d, DERIVED_I_RMS, m_rms);
+        }
+    } else if (FIELDS[field_idx].field_id == JSDRV_FIELD_POWER) {
+        if (d->param_values[PARAM_E_CTRL].value.u8) {
+            derived_integral(d, DERIVED_ENERGY, &d->energy, src);
+        }
+    }
+}
 
-    if (!jsdrv_downsample_add_u8(p->downsample, d->sample_processor.sample_count - 1, value, &value)) {
+static uint32_t field_message_space(struct js110_dev_s * d, uint8_t idx) {
+    struct port_s * p = &d->ports[idx];
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) p->msg->value.value.bin;
+    uint32_t limit = element_count_max_get(d, jsdrv_downsample_mc_decimate_factor(d->downsample), s->element_size_bits);
+    uint32_t limit_payload = (STREAM_PAYLOAD_FULL(p->msg) * 8 + s->element_size_bits - 1) / s->element_size_bits;
+    if (limit_payload < limit) {
+        limit = limit_payload;
+    }
+    return (limit > s->element_count) ? (limit - s->element_count) : 1;
+}
+
+static void field_message_process_end(struct js110_dev_s * d, uint8_t idx, uint32_t count) {
+    struct port_s * p = &d->ports[idx];
+    struct jsdrvp_msg_s * m = p->msg;
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    s->element_count += count;
+    if ((s->element_size_bits < 8) && (((s->element_count * s->element_size_bits) & 0x7) != 0)) {
         return;
     }
-    s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
-    value = value & 0x0f;
-    if (0 == (s->element_count & 1)) {
-        s->data[s->element_count >> 1] = value;
-    } else {
-        s->data[s->element_count >> 1] |= (value << 4);
+    uint32_t element_count_max = element_count_max_get(d, jsdrv_downsample_mc_decimate_factor(d->downsample),
+                                                       s->element_size_bits);
+    if ((((s->element_count * s->element_size_bits) / 8) >= STREAM_PAYLOAD_FULL(p->msg))
+            || (s->element_count >= element_count_max)
+            || jsdrv_stream_gate_flush(&d->stream_gate, s)) {
+        jsdrv_tmf_get(d->time_map_filter, &s->time_map);
+        p->msg->value.size = JSDRV_STREAM_HEADER_SIZE + s->element_count * s->element_size_bits / 8;
+        derived_process(d, idx, p->msg);
+        if (((FIELDS[idx].field_id == JSDRV_FIELD_GPI)
+                    && (2 == d->param_values[PARAM_GPI_0_EDGE_CTRL + FIELDS[idx].index].value.u8))
+                || ((FIELDS[idx].field_id == JSDRV_FIELD_RANGE)
+                    && (2 == d->param_values[PARAM_I_RANGE_EDGE_CTRL].value.u8))) {
+            jsdrvp_msg_free(d->context, p->msg);  // edges only
+            p->msg = NULL;
+            return;
+        }
+        if (d->stream_gate.start || d->stream_gate.stop) {
+            if (!jsdrv_stream_gate_apply(&d->stream_gate, s)) {
+                jsdrvp_msg_free(d->context, p->msg);  // outside the delivery window
+                p->msg = NULL;
+                return;
+            }
+            p->msg->value.size = JSDRV_STREAM_HEADER_SIZE + (s->element_count * s->element_size_bits + 7) / 8;
+        }
+        s->host_time.dispatch = jsdrv_time_utc();
+        if (p->msg_time) {
+            jsdrv_latency_hist_add(&d->latency, s->host_time.dispatch - p->msg_time);
+        }
+        jsdrvp_backend_send(d->context, p->msg);
+        p->msg = NULL;
+        jsdrv_stream_flush_update(&d->stream_flush, jsdrvp_backend_queue_depth(d->context));
     }
-    field_message_process_end(d, field_idx);
 }
 
-static void add_u1_field(struct js110_dev_s * d, uint8_t field_idx, uint8_t value) {
-    struct jsdrv_stream_signal_s * s;
-    struct port_s * p = &d->ports[field_idx];
-    struct jsdrvp_msg_s * m = field_message_get(d, field_idx);
-    if (NULL == m) {
+/*
+ * The add_*_fields() packers each handle one field for a block of
+ * processed samples, which starts at d->sample_id.  Without host-side
+ * downsampling, the f32 packer copies each run up to the next flush.
+ * With downsampling, add_f32_fields_downsample() filters i, v, and p
+ * together with jsdrv_downsample_mc_add_f32_block() and copies each
+ * field's outputs the same way.
+ */
+
+static void add_f32_fields_copy(struct js110_dev_s * d, uint8_t field_idx, uint64_t sample_id,
+                                uint32_t decimate_factor, const float * y, uint32_t y_count) {
+    uint32_t k = 0;
+    while (k < y_count) {
+        struct jsdrvp_msg_s * m = field_message_get(d, field_idx, sample_id + (uint64_t) k * decimate_factor);
+        if (NULL == m) {
+            ++k;
+            continue;
+        }
+        struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+        uint32_t count = field_message_space(d, field_idx);
+        if (count > (y_count - k)) {
+            count = y_count - k;
+        }
+        memcpy(((float *) s->data) + s->element_count, y + k, count * sizeof(float));
+        k += count;
+        field_message_process_end(d, field_idx, count);
+    }
+}
+
+static void add_f32_fields_downsample(struct js110_dev_s * d, const float * i, const float * v, const float * p,
+                                      uint32_t n) {
+    float y[3][SAMPLES_PER_FRAME];
+    const float * x[3] = {i, v, p};
+    float * const y_ptr[3] = {y[0], y[1], y[2]};
+    bool enabled[3];
+    uint32_t y_count = 0;
+    JSDRV_ASSERT(n <= SAMPLES_PER_FRAME);
+    for (uint8_t field_idx = 0; field_idx < 3; ++field_idx) {
+        enabled[field_idx] = field_is_enabled(d, field_idx);
+    }
+    if (!enabled[0] && !enabled[1] && !enabled[2]) {
         return;
     }
+    uint64_t sample_count = d->sample_processor.sample_count - n;
+    uint32_t decimate_factor = jsdrv_downsample_mc_decimate_factor(d->downsample);
+    uint32_t idx = jsdrv_downsample_mc_add_f32_block(d->downsample, sample_count, x, n, y_ptr, &y_count);
+
+    // each output completes the decimate_factor samples starting at an aligned sample_id
+    uint64_t sample_id = d->sample_id + idx + 1 - decimate_factor;
+    for (uint8_t field_idx = 0; field_idx < 3; ++field_idx) {
+        if (enabled[field_idx]) {
+            add_f32_fields_copy(d, field_idx, sample_id, decimate_factor, y[field_idx], y_count);
+        }
+    }
+}
 
-    if (!jsdrv_downsample_add_u8(p->downsample, d->sample_processor.sample_count - 1, value, &value)) {
+static void add_f32_fields(struct js110_dev_s * d, uint8_t field_idx, const float * x, uint32_t n) {
+    if (!field_is_enabled(d, field_idx)) {
         return;
     }
-    s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
-    value = value & 1;
-    if (0 == (s->element_count & 7)) {
-        s->data[s->element_count >> 3] = value;
+    add_f32_fields_copy(d, field_idx, d->sample_id, 1, x, n);
+}
+
+static inline void packed_set(uint8_t * data, uint32_t element_size_bits, uint32_t element_idx, uint8_t value) {
+    uint32_t bit = element_idx * element_size_bits;
+    uint8_t v = (uint8_t) (value & ((1U << element_size_bits) - 1));
+    if (0 == (bit & 7)) {
+        data[bit >> 3] = v;
     } else {
-        s->data[s->element_count >> 3] |= value << (s->element_count & 7);
+        data[bit >> 3] |= (uint8_t) (v << (bit & 7));
     }
-    field_message_process_end(d, field_idx);
 }
 
-static void handle_sample(struct js110_dev_s * d, uint32_t sample, uint8_t v_range) {
-    struct js110_sample_s z = js110_sp_process(&d->sample_processor, sample, v_range);
-    add_f32_field(d, 0, z.i);
-    add_f32_field(d, 1, z.v);
-    add_f32_field(d, 2, z.p);
-    add_u4_field(d, 3, z.current_range);
-    add_u1_field(d, 4, z.gpi0);
-    add_u1_field(d, 5, z.gpi1);
-    ++d->sample_id;
+/*
+ * Pack the u4 and u1 fields.  Host-side downsampling selects every Nth
+ * value, like the JS220 on-instrument decimation of these fields,
+ * since filtering a range or GPI value is not meaningful.
+ */
+static void add_packed_fields(struct js110_dev_s * d, uint8_t field_idx, const uint8_t * x, uint32_t n) {
+    uint8_t selected[SAMPLES_PER_FRAME];
+    if (!field_is_enabled(d, field_idx)) {
+        return;
+    }
+    uint32_t decimate_factor = jsdrv_downsample_mc_decimate_factor(d->downsample);
+    uint64_t sample_id = d->sample_id;
+    if (decimate_factor > 1) {
+        uint32_t offset = (uint32_t) ((decimate_factor - (sample_id % decimate_factor)) % decimate_factor);
+        if (offset >= n) {
+            return;
+        }
+        n = jsdrv_pack_select_u8(selected, x + offset, n - offset, decimate_factor);
+        x = selected;
+        sample_id += offset;
+    }
+
+    uint32_t k = 0;
+    while (k < n) {
+        struct jsdrvp_msg_s * m = field_message_get(d, field_idx, sample_id + (uint64_t) k * decimate_factor);
+        struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+        uint32_t bits = s->element_size_bits;
+        uint32_t per_byte = 8 / bits;
+        uint32_t count = field_message_space(d, field_idx);
+        if (count > (n - k)) {
+            count = n - k;
+        }
+        uint32_t idx = 0;
+        for (; (idx < count) && ((s->element_count + idx) % per_byte); ++idx) {
+            packed_set(s->data, bits, s->element_count + idx, x[k + idx]);
+        }
+        uint8_t * data = s->data + ((s->element_count + idx) / per_byte);
+        if (4 == bits) {
+            jsdrv_pack_u4(data, x + k + idx, count - idx);
+        } else {
+            jsdrv_pack_u1(data, x + k + idx, count - idx);
+        }
+        k += count;
+        field_message_process_end(d, field_idx, count);
+    }
+}
 
-    struct jsdrv_statistics_s * s = js110_stats_compute(&d->stats, z.i, z.v, z.p);
-    if (NULL != s) {
+static void stats_windows_publish(struct js110_dev_s * d, uint32_t completed) {
+    for (uint8_t slot = 0; slot < JSDRV_STATS_WINDOWS_COUNT; ++slot) {
+        if (0 == (completed & (1U << slot))) {
+            continue;
+        }
         struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
-        tfp_snprintf(m->topic, sizeof(m->topic), "%s/s/stats/value", d->ll.prefix);
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/s/stats/win/%u/value", d->ll.prefix, (unsigned int) slot);
         struct jsdrv_statistics_s * dst = (struct jsdrv_statistics_s *) m->payload.bin;
-        *dst = *s;
-        jsdrv_tmf_get(d->time_map_filter, &dst->time_map);
+        *dst = *jsdrv_stats_windows_value(&d->stats_windows, slot);
         m->value = jsdrv_union_cbin_r((uint8_t *) dst, sizeof(*dst));
         m->value.app = JSDRV_PAYLOAD_TYPE_STATISTICS;
         jsdrvp_backend_send(d->context, m);
-        s->block_sample_id = d->sample_id;
+    }
+}
+
+static void samples_publish(struct js110_dev_s * d, const float * i, const float * v, const float * p,
+                            const uint8_t * current_range, const uint8_t * gpi0, const uint8_t * gpi1, uint32_t n) {
+    if (NULL != d->downsample) {
+        add_f32_fields_downsample(d, i, v, p, n);
+    } else {
+        add_f32_fields(d, 0, i, n);
+        add_f32_fields(d, 1, v, n);
+        add_f32_fields(d, 2, p, n);
+    }
+    add_packed_fields(d, 3, current_range, n);
+    add_packed_fields(d, 4, gpi0, n);
+    add_packed_fields(d, 5, gpi1, n);
+
+    uint32_t k = 0;
+    while (k < n) {
+        struct jsdrv_statistics_s * s = NULL;
+        uint32_t count = js110_stats_compute_block(&d->stats, i + k, v + k, p + k, n - k, &s);
+        k += count;
+        d->sample_id += count;
+        if (NULL != s) {
+            struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
+            tfp_snprintf(m->topic, sizeof(m->topic), "%s/s/stats/value", d->ll.prefix);
+            struct jsdrv_statistics_s * dst = (struct jsdrv_statistics_s *) m->payload.bin;
+            *dst = *s;
+            jsdrv_tmf_get(d->time_map_filter, &dst->time_map);
+            m->value = jsdrv_union_cbin_r((uint8_t *) dst, sizeof(*dst));
+            m->value.app = JSDRV_PAYLOAD_TYPE_STATISTICS;
+            stats_windows_publish(d, jsdrv_stats_windows_add(&d->stats_windows, dst));
+            jsdrvp_backend_send(d->context, m);
+            s->block_sample_id = d->sample_id;
+        }
+    }
+}
+
+static void handle_samples(struct js110_dev_s * d, const uint32_t * raw, uint32_t n, uint8_t v_range) {
+    float i[SAMPLES_PER_FRAME];
+    float v[SAMPLES_PER_FRAME];
+    float p[SAMPLES_PER_FRAME];
+    uint8_t current_range[SAMPLES_PER_FRAME];
+    uint8_t gpi0[SAMPLES_PER_FRAME];
+    uint8_t gpi1[SAMPLES_PER_FRAME];
+    JSDRV_ASSERT(n <= SAMPLES_PER_FRAME);
+
+    js110_sp_process_block(&d->sample_processor, raw, n, v_range, i, v, p, current_range, gpi0, gpi1);
+    samples_publish(d, i, v, p, current_range, gpi0, gpi1, n);
+}
+
+/**
+ * @brief Fill skipped frames with missing samples.
+ *
+ * @param d The device instance.
+ * @param frames The number of skipped frames.
+ * @param v_range The voltage range.
+ *
+ * The first frame flushes the sample processor delay line using
+ * missing raw samples.  The remaining frames bypass the sample processor
+ * and publish NaN / missing blocks directly, which keeps sample_id
+ * aligned with the device without per-sample processing.
+ */
+static void handle_skip(struct js110_dev_s * d, uint32_t frames, uint8_t v_range) {
+    uint32_t raw[SAMPLES_PER_FRAME];
+    float nan_f32[SAMPLES_PER_FRAME];
+    uint8_t current_range[SAMPLES_PER_FRAME];
+    uint8_t gpi[SAMPLES_PER_FRAME];
+    if (!frames) {
+        return;
+    }
+    memset(raw, 0xff, sizeof(raw));
+    handle_samples(d, raw, SAMPLES_PER_FRAME, v_range);
+    if (frames == 1) {
+        return;
+    }
+
+    for (uint32_t k = 0; k < SAMPLES_PER_FRAME; ++k) {
+        nan_f32[k] = NAN;
+    }
+    memset(current_range, JS110_I_RANGE_MISSING, sizeof(current_range));
+    memset(gpi, 0, sizeof(gpi));
+    for (uint32_t frame = 1; frame < frames; ++frame) {
+        js110_sp_skip(&d->sample_processor, SAMPLES_PER_FRAME);
+        samples_publish(d, nan_f32, nan_f32, nan_f32, current_range, gpi, gpi, SAMPLES_PER_FRAME);
     }
 }
 
@@ -1451,30 +2450,110 @@ static void handle_stream_in_frame(struct js110_dev_s * d, uint32_t * p_u32) {
         return;
     }
     if ((d->packet_index & 0xffff) != pkt_index) {
-        JSDRV_LOGW("pkt_index skip: expected %d, received %d", d->packet_index, pkt_index);
-        //while ((d->packet_index & 0xffff) != pkt_index) {
-        //    for (uint32_t i = 2; i < (FRAME_SIZE_BYTES / 4); ++i) {
-        //        handle_sample(d, 0xffffffffLU, voltage_range);
-        //    }
-        //    d->packet_index = (d->packet_index + 1) & 0xffff;
-        //}
-        // todo handle skips better.
+        uint32_t frames = (uint32_t) ((pkt_index - d->packet_index) & 0xffff);
+        if (d->sample_id && (frames <= PACKET_SKIP_FILL_MAX)) {
+            JSDRV_LOGW("pkt_index skip: expected %d, received %d, fill %d frames",
+                       (int) (d->packet_index & 0xffff), (int) pkt_index, (int) frames);
+            handle_skip(d, frames, voltage_range);
+        } else {
+            JSDRV_LOGW("pkt_index skip: expected %d, received %d, resync",
+                       (int) (d->packet_index & 0xffff), (int) pkt_index);
+        }
         d->packet_index = pkt_index;
     }
     jsdrv_tmf_add(d->time_map_filter, d->sample_id, jsdrv_time_utc());
-    for (uint32_t i = 2; i < (FRAME_SIZE_BYTES / 4); ++i) {
-        handle_sample(d, p_u32[i], voltage_range);
-    }
+    handle_samples(d, p_u32 + 2, SAMPLES_PER_FRAME, voltage_range);
     d->packet_index = (d->packet_index + 1) & 0xffff;
 }
 
 static void handle_stream_in(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
     JSDRV_ASSERT(msg->value.type == JSDRV_UNION_BIN);
     uint32_t frame_count = (msg->value.size + FRAME_SIZE_BYTES - 1) / FRAME_SIZE_BYTES;
+    JSDRV_TRACE_BEGIN("stream_in", d->ll.prefix, msg->value.size);
     for (uint32_t i = 0; i < frame_count; ++i) {
         uint32_t * p_u32 = (uint32_t *) &msg->value.value.bin[i * FRAME_SIZE_BYTES];
         handle_stream_in_frame(d, p_u32);
     }
+    JSDRV_TRACE_END("stream_in");
+}
+
+static void stream_in_process(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
+    uint32_t count = jsdrvp_usb_stream_seal(msg);
+    for (uint32_t i = 0; i < count; ++i) {
+        jsdrvp_usb_stream_select(msg, i);
+        jsdrvp_usb_capture(d->context, d->capture_id, msg);
+        d->stream_time = msg->extra.bkusb_stream.time;
+        handle_stream_in(d, msg);
+    }
+    msg_queue_push(d->ll.cmd_q, msg);  // return
+}
+
+static THREAD_RETURN_TYPE proc_thread(THREAD_ARG_TYPE lpParam) {
+    struct js110_dev_s *d = (struct js110_dev_s *) lpParam;
+    struct jsdrvp_msg_s * msg;
+    bool do_exit = false;
+    JSDRV_LOGI("JS110 processing thread started %s", d->ll.prefix);
+#if _WIN32
+    HANDLE handle = msg_queue_handle_get(d->proc_q);
+#else
+    struct pollfd fds;
+    fds.fd = msg_queue_handle_get(d->proc_q);
+    fds.events = POLLIN;
+#endif
+    jsdrvp_thread_configure(d->context, JSDRVP_THREAD_DEVICE, "jsdrv_js110_proc");
+    char stats_name[JSDRV_THREAD_STATS_NAME_SIZE];
+    tfp_snprintf(stats_name, sizeof(stats_name), "%s/proc", d->ll.prefix);
+    jsdrv_thread_stats_register(stats_name);
+    jsdrvp_msg_cache_attach(d->context);
+    while (!do_exit) {
+#if _WIN32
+        WaitForSingleObject(handle, INTERVAL_MS);
+#else
+        poll(&fds, 1, INTERVAL_MS);
+#endif
+        while (NULL != (msg = msg_queue_pop_immediate(d->proc_q))) {
+            if (0 == strcmp(JSDRV_MSG_FINALIZE, msg->topic)) {
+                jsdrvp_msg_free(d->context, msg);
+                do_exit = true;
+                break;
+            }
+            jsdrv_os_mutex_lock(d->proc_mutex);
+            stream_in_process(d, msg);
+            jsdrv_os_mutex_unlock(d->proc_mutex);
+        }
+    }
+    jsdrvp_msg_cache_detach(d->context);
+    JSDRV_LOGI("JS110 processing thread done %s", d->ll.prefix);
+    THREAD_RETURN();
+}
+
+static void pipeline_start(struct js110_dev_s * d) {
+    if (NULL != d->proc_q) {
+        return;
+    }
+    d->proc_q = msg_queue_init();
+    if (jsdrv_thread_create(&d->proc_thread, proc_thread, d, 1)) {
+        JSDRV_LOGW("processing thread create failed");
+        msg_queue_finalize(d->proc_q);
+        d->proc_q = NULL;
+    }
+}
+
+static void pipeline_stop(struct js110_dev_s * d) {
+    if (NULL == d->proc_q) {
+        return;
+    }
+    // the thread processes all queued stream data before the finalize message
+    jsdrvp_send_finalize_msg(d->context, d->proc_q, "");
+    if (d->proc_locked) {
+        jsdrv_os_mutex_unlock(d->proc_mutex);
+    }
+    jsdrv_thread_join(&d->proc_thread, 1000);
+    if (d->proc_locked) {
+        jsdrv_os_mutex_lock(d->proc_mutex);
+    }
+    msg_queue_finalize(d->proc_q);
+    d->proc_q = NULL;
 }
 
 static bool handle_rsp(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
@@ -1483,8 +2562,11 @@ static bool handle_rsp(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
         return false;
     }
     if (0 == strcmp(JSDRV_USBBK_MSG_STREAM_IN_DATA, msg->topic)) {
-        handle_stream_in(d, msg);
-        msg_queue_push(d->ll.cmd_q, msg);  // return
+        if (NULL != d->proc_q) {
+            msg_queue_push(d->proc_q, msg);
+        } else {
+            stream_in_process(d, msg);
+        }
         return true;
     } else if (msg->topic[0] == JSDRV_MSG_COMMAND_PREFIX_CHAR) {
         if (0 == strcmp(JSDRV_MSG_FINALIZE, msg->topic)) {
@@ -1493,8 +2575,17 @@ static bool handle_rsp(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
         } else {
             JSDRV_LOGE("handle_rsp unsupported command %s", msg->topic);
         }
+    } else if (msg->extra.bkusb_ctrl.cbk_fn
+            && ((0 == strcmp(JSDRV_USBBK_MSG_CTRL_IN, msg->topic))
+                || (0 == strcmp(JSDRV_USBBK_MSG_CTRL_OUT, msg->topic)))) {
+        ctrl_complete(d, msg);
+    } else if ((0 == strcmp(JSDRV_USBBK_MSG_CTRL_IN, msg->topic))
+            && (msg->extra.bkusb_ctrl.setup.s.bRequest == JS110_HOST_USB_REQUEST_EXTIO)) {
+        extio_gpi_rsp(d, msg);
     } else if (0 == strcmp(JSDRV_USBBK_MSG_CTRL_IN, msg->topic)) {
         d_status_rsp(d, msg);
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_STATS, msg->topic)) {
+        send_to_frontend(d, JSDRV_USBBK_MSG_STATS, &msg->value);
     } else {
         JSDRV_LOGE("handle_rsp unsupported %s", msg->topic);
     }
@@ -1502,6 +2593,18 @@ static bool handle_rsp(struct js110_dev_s * d, struct jsdrvp_msg_s * msg) {
     return rv;
 }
 
+static void latency_publish(struct js110_dev_s * d) {
+    char buf[256];
+    uint32_t t_now = jsdrv_time_ms_u32();
+    if ((t_now - d->latency_time_ms) < LATENCY_INTERVAL_MS) {
+        return;
+    }
+    d->latency_time_ms = t_now;
+    if (jsdrv_latency_hist_json(&d->latency, buf, sizeof(buf))) {
+        send_to_frontend(d, "h/stream/latency", &jsdrv_union_json(buf));
+    }
+}
+
 static THREAD_RETURN_TYPE driver_thread(THREAD_ARG_TYPE lpParam) {
     uint32_t time_now_ms = jsdrv_time_ms_u32();
     uint32_t time_prev_ms = time_now_ms;
@@ -1522,6 +2625,9 @@ static THREAD_RETURN_TYPE driver_thread(THREAD_ARG_TYPE lpParam) {
     fds[1].fd = msg_queue_handle_get(d->ll.rsp_q);
     fds[1].events = POLLIN;
 #endif
+    jsdrvp_thread_configure(d->context, JSDRVP_THREAD_DEVICE, "jsdrv_js110");
+    jsdrv_thread_stats_register(d->ll.prefix);  // distinguish devices in JSDRV_MSG_STATS_THREADS
+    jsdrvp_msg_cache_attach(d->context);
 
     while (!d->do_exit) {
         time_now_ms = jsdrv_time_ms_u32();
@@ -1540,6 +2646,8 @@ static THREAD_RETURN_TYPE driver_thread(THREAD_ARG_TYPE lpParam) {
 #endif
         }
         //JSDRV_LOGD3("ul thread");
+        jsdrv_os_mutex_lock(d->proc_mutex);
+        d->proc_locked = true;
         while (handle_cmd(d, msg_queue_pop_immediate(d->ul.cmd_q))) {
             ;
         }
@@ -1547,52 +2655,81 @@ static THREAD_RETURN_TYPE driver_thread(THREAD_ARG_TYPE lpParam) {
         while (handle_rsp(d, msg_queue_pop_immediate(d->ll.rsp_q))) {
             ;
         }
+        if (d->state == ST_OPEN) {
+            latency_publish(d);
+        }
+        d->proc_locked = false;
+        jsdrv_os_mutex_unlock(d->proc_mutex);
     }
+    jsdrvp_msg_cache_detach(d->context);
     JSDRV_LOGI("JS110 USB upper-level thread done %s", d->ll.prefix);
     THREAD_RETURN();
 }
 
-static void join(struct jsdrvp_ul_device_s * device) {
-    struct js110_dev_s * d = (struct js110_dev_s *) device;
-    jsdrvp_send_finalize_msg(d->context, d->ul.cmd_q, "");
-    // and wait for thread to exit.
-    jsdrv_thread_join(&d->thread, 1000);
+static void dev_free(struct js110_dev_s * d) {
+    pipeline_stop(d);
+    jsdrv_os_mutex_free(d->proc_mutex);
 
     for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->ports); ++idx) {
-        struct port_s *p = &d->ports[idx];
-        if (NULL != p->downsample) {
-            jsdrv_downsample_free(p->downsample);
-            p->downsample = NULL;
-        }
         reset_port(d, idx);
     }
+    jsdrv_downsample_mc_free(d->downsample);
+    d->downsample = NULL;
     jsdrv_tmf_free(d->time_map_filter);
     jsdrv_tmf_free(d->sstats_time_map_filter);
+    js110_sp_finalize(&d->sample_processor);
     jsdrv_free(d);
 }
 
-int32_t jsdrvp_ul_js110_usb_factory(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
-    JSDRV_DBC_NOT_NULL(device);
-    JSDRV_DBC_NOT_NULL(context);
-    JSDRV_DBC_NOT_NULL(ll);
-    *device = NULL;
+static void join(struct jsdrvp_ul_device_s * device) {
+    struct js110_dev_s * d = (struct js110_dev_s *) device;
+    jsdrvp_send_finalize_msg(d->context, d->ul.cmd_q, "");
+    // and wait for thread to exit.
+    jsdrv_thread_join(&d->thread, 1000);
+    dev_free(d);
+}
+
+static struct js110_dev_s * dev_alloc(struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
     struct js110_dev_s * d = jsdrv_alloc_clr(sizeof(struct js110_dev_s));
     d->context = context;
     d->ll = *ll;
+    d->capture_id = jsdrvp_usb_capture_device(context, ll->prefix);
     d->ul.cmd_q = msg_queue_init();
+    d->ul.rsp_q = d->ll.rsp_q;
     d->ul.join = join;
     d->state = ST_CLOSED;
     d->time_map_filter = jsdrv_tmf_new(SAMPLING_FREQUENCY, 60, JSDRV_TIME_SECOND);
     d->sstats_time_map_filter = jsdrv_tmf_new(SAMPLING_FREQUENCY, 60, JSDRV_TIME_SECOND);
+    jsdrv_tmf_rate_estimate(d->time_map_filter, true);
+    jsdrv_tmf_rate_estimate(d->sstats_time_map_filter, true);
     d->status_msg = NULL;
+    d->proc_mutex = jsdrv_os_mutex_alloc("js110_proc");
     on_sampling_frequency(d, &jsdrv_union_u32(SAMPLING_FREQUENCY));
     js110_sp_initialize(&d->sample_processor);
     js110_stats_initialize(&d->stats);
+    jsdrv_stats_windows_initialize(&d->stats_windows);
+    jsdrv_stream_flush_initialize(&d->stream_flush);
+    jsdrv_stream_gate_initialize(&d->stream_gate);
 
     for (int i = 0; NULL != PARAMS[i].topic; ++i) {
-        jsdrv_meta_default(PARAMS[i].meta, &d->param_values[i]);
+        d->param_values[i] = PARAMS[i].default_value;
+    }
+    jsdrv_derived_rms_clear(&d->i_rms, d->param_values[PARAM_I_RMS_WINDOW].value.u32);
+    for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->summary); ++idx) {
+        jsdrv_derived_summary_clear(&d->summary[idx], d->param_values[PARAM_SUMMARY_FS].value.u32);
+    }
+    for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->edge); ++idx) {
+        jsdrv_derived_edge_clear(&d->edge[idx]);
     }
+    return d;
+}
 
+int32_t jsdrvp_ul_js110_usb_factory(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
+    JSDRV_DBC_NOT_NULL(device);
+    JSDRV_DBC_NOT_NULL(context);
+    JSDRV_DBC_NOT_NULL(ll);
+    *device = NULL;
+    struct js110_dev_s * d = dev_alloc(context, ll);
     if (jsdrv_thread_create(&d->thread, driver_thread, d, 1)) {
         return JSDRV_ERROR_UNSPECIFIED;
     }
@@ -1600,3 +2737,26 @@ int32_t jsdrvp_ul_js110_usb_factory(struct jsdrvp_ul_device_s ** device, struct
     *device = &d->ul;
     return 0;
 }
+
+#if JSDRV_FUZZ
+struct jsdrvp_ul_device_s * jsdrvp_ul_js110_usb_fuzz_alloc(struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
+    struct js110_dev_s * d = dev_alloc(context, ll);
+    d->state = ST_OPEN;
+    for (size_t i = 0; i < JSDRV_ARRAY_SIZE(FIELDS); ++i) {
+        d->param_values[FIELDS[i].param] = jsdrv_union_u8(1);
+    }
+    return &d->ul;
+}
+
+void jsdrvp_ul_js110_usb_fuzz_process(struct jsdrvp_ul_device_s * device, struct jsdrvp_msg_s * msg) {
+    struct js110_dev_s * d = (struct js110_dev_s *) device;
+    d->stream_time = jsdrv_time_utc();
+    handle_stream_in(d, msg);
+}
+
+void jsdrvp_ul_js110_usb_fuzz_free(struct jsdrvp_ul_device_s * device) {
+    struct js110_dev_s * d = (struct js110_dev_s *) device;
+    msg_queue_finalize(d->ul.cmd_q);
+    dev_free(d);
+}
+#endif
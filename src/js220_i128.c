@@ -15,10 +15,6 @@
 */
 
 #include "jsdrv_prv/js220_i128.h"
-#if _WIN32
-#include <intrin.h>
-#include <immintrin.h>
-#endif
 #include <math.h>
 #include <stdbool.h>
 
@@ -27,69 +23,26 @@
 // See https://docs.microsoft.com/en-us/cpp/intrinsics/mul128
 
 
-static const uint64_t U64_SIGN_BIT = 0x8000000000000000LLU;
-
-js220_i128 js220_i128_init_i64(int64_t a) {
-    js220_i128 r;
-    r.i64[0] = a;
-    r.i64[1] = (a >= 0) ? 0 : -1;
-    return r;
-}
-
+// Count leading zeros, x != 0.
+static inline uint32_t clz_u64(uint64_t x) {
 #if defined(__clang__) || defined(__GNUC__)
-js220_i128 js220_i128_add(js220_i128 a, js220_i128 b) {
-    a.i128 = a.i128 + b.i128;
-    return a;
-}
-
-js220_i128 js220_i128_sub(js220_i128 a, js220_i128 b) {
-    a.i128 = a.i128 - b.i128;
-    return a;
-}
-
-js220_i128 js220_i128_square_i64(int64_t a) {
-    js220_i128 r;
-    r.i128 = a;
-    r.i128 = r.i128 * r.i128;
-    return r;
-}
-
+    return (uint32_t) __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanReverse64(&idx, x);
+    return 63U - (uint32_t) idx;
 #else
-
-js220_i128 js220_i128_add(js220_i128 a, js220_i128 b) {
-    js220_i128 r;
-    uint8_t c = _addcarry_u64(0, a.u64[0], b.u64[0], &r.u64[0]);
-    _addcarry_u64(c, a.u64[1], b.u64[1], &r.u64[1]);
-    return r;
-}
-
-js220_i128 js220_i128_sub(js220_i128 a, js220_i128 b) {
-    js220_i128 r;
-    uint8_t c = _subborrow_u64(0, a.u64[0], b.u64[0], &r.u64[0]);
-    _subborrow_u64(c, a.u64[1], b.u64[1], &r.u64[1]);
-    return r;
-}
-
-js220_i128 js220_i128_square_i64(int64_t a) {
-    js220_i128 r;
-    if (a < 0) {
-        a = -a;
+    uint32_t n = 0;
+    while (0 == (x & 0x8000000000000000LLU)) {
+        x <<= 1;
+        ++n;
     }
-    r.u64[0] = _umul128(a, a, &r.u64[1]);
-    return r;
-}
+    return n;
 #endif
+}
 
-js220_i128 js220_i128_neg(js220_i128 x) {
-    x.u64[1] = ~x.u64[1];
-    x.u64[0] = ~x.u64[0];
-
-    uint64_t z1 = x.u64[0] & U64_SIGN_BIT;
-    x.u64[0] += 1LLU;
-    if ((x.u64[0] & U64_SIGN_BIT) != z1) {
-        x.u64[1] += 1LLU;
-    }
-    return x;
+static inline bool lt_u128(js220_i128 a, js220_i128 b) {
+    return (a.u64[1] < b.u64[1]) || ((a.u64[1] == b.u64[1]) && (a.u64[0] < b.u64[0]));
 }
 
 js220_i128 js220_i128_udiv(js220_i128 dividend, uint64_t divisor, uint64_t * remainder) {
@@ -98,28 +51,70 @@ js220_i128 js220_i128_udiv(js220_i128 dividend, uint64_t divisor, uint64_t * rem
         remainder = &r;
     }
     js220_i128 result;
-#if defined(__clang__) || defined(__GNUC__)
-    result.i128 = dividend.i128 / divisor;
-    *remainder = dividend.i128 - (result.i128 * divisor);
-#else
+#if JS220_I128_NATIVE
+    js220_u128_native u = (js220_u128_native) dividend.i128;
+    js220_u128_native q = u / divisor;
+    result.i128 = (js220_i128_native) q;
+    *remainder = (uint64_t) (u - (q * divisor));
+#elif JS220_I128_MSVC
     result.u64[1] = dividend.u64[1] / divisor;
     dividend.u64[1] -= result.u64[1] * divisor;
     result.u64[0] = _udiv128(dividend.u64[1], dividend.u64[0], divisor, remainder);
+#else
+    if (divisor <= 0xffffffffU) {
+        // Long division by u32 digits, which is the usual sample count.
+        uint64_t rem = 0;
+        for (int32_t i = 3; i >= 0; --i) {
+            uint64_t d = (rem << 32) | dividend.u32[i];
+            result.u32[i] = (uint32_t) (d / divisor);
+            rem = d - result.u32[i] * divisor;
+        }
+        *remainder = rem;
+        return result;
+    }
+    // Binary long division, high u64 first.
+    result.u64[1] = dividend.u64[1] / divisor;
+    uint64_t rem = dividend.u64[1] - result.u64[1] * divisor;
+    uint64_t q = 0;
+    for (int32_t i = 63; i >= 0; --i) {
+        bool carry = (rem >> 63) != 0;
+        rem = (rem << 1) | ((dividend.u64[0] >> i) & 1);
+        if (carry || (rem >= divisor)) {
+            rem -= divisor;
+            q |= (1LLU << i);
+        }
+    }
+    result.u64[0] = q;
+    *remainder = rem;
 #endif
     return result;
 }
 
 js220_i128 js220_i128_lshift(js220_i128 x, int32_t shift) {
+#if JS220_I128_NATIVE
     if (shift > 0) {
+        x.i128 = (js220_i128_native) ((js220_u128_native) x.i128 << shift);
+    } else if (shift < 0) {
+        x.i128 = x.i128 >> -shift;  // arithmetic on GCC and Clang
+    }
+#else
+    if (shift >= 64) {
+        x.u64[1] = x.u64[0] << (shift - 64);
+        x.u64[0] = 0;
+    } else if (shift > 0) {
         x.u64[1] = (x.u64[1] << shift) | (x.u64[0] >> (64 - shift));
         x.u64[0] = x.u64[0] << shift;
     } else if (0 == shift) {
         // no operation
-    } else {  // right shift signed
+    } else if (shift > -64) {  // right shift signed
         shift = -shift;
         x.u64[0] = (x.u64[0] >> shift) | (x.u64[1] << (64 - shift));
         x.i64[1] = x.i64[1] >> shift;
+    } else {
+        x.u64[0] = (uint64_t) (x.i64[1] >> (-shift - 64));
+        x.i64[1] = x.i64[1] >> 63;
     }
+#endif
     return x;
 }
 
@@ -128,73 +123,46 @@ js220_i128 js220_i128_rshift(js220_i128 x, int32_t shift) {
 }
 
 double js220_i128_to_f64(js220_i128 x, uint32_t q) {
-    double f;
     int32_t exponent = 128 - q - 64;
-    bool is_neg = false;
-    if (0 != (x.u64[1] & U64_SIGN_BIT)) {
-        is_neg = true;
+    bool is_neg = js220_i128_is_neg(x);
+    if (is_neg) {
         x = js220_i128_neg(x);
     }
-
     if ((x.u64[0] == 0) && (x.u64[1] == 0)) {
         return 0.0;
     }
 
-    while (0 == (x.u64[1] & U64_SIGN_BIT)) {
-        x.u64[1] <<= 1;
-        x.u64[1] |= (x.u64[0] >> 63) & 1;
-        x.u64[0] <<= 1;
-        --exponent;
-    }
-    f = (double) x.u64[1];     // more precision than a double's mantissa
-    f *= pow(2, exponent);
-    if (is_neg) {
-        f = -f;
-    }
-    return f;
-}
-
-bool js220_i128_is_neg(js220_i128 x) {
-    return x.i64[1] < 0;
+    // Normalize so that the top 64 bits hold the most significant 1.
+    uint32_t shift = x.u64[1] ? clz_u64(x.u64[1]) : (64 + clz_u64(x.u64[0]));
+    x = js220_i128_lshift(x, (int32_t) shift);
+    exponent -= (int32_t) shift;
+    double f = ldexp((double) x.u64[1], exponent);  // more precision than a double's mantissa
+    return is_neg ? -f : f;
 }
 
 double js220_i128_compute_std(int64_t x1, js220_i128 x2, uint64_t n, uint32_t q) {
-    double f;
-    if (x1 < 0) {
-        x1 = -x1;
-    }
-    js220_i128 m = js220_i128_square_i64(x1);
-    js220_i128 d;
-
-    d = js220_i128_udiv(m, n, NULL);
-
-    if ((x2.u64[1] < d.u64[1]) ||
-        ((x2.u64[1] == d.u64[1]) && (x2.u64[0] < d.u64[0]))) {
+    js220_i128 d = js220_i128_udiv(js220_i128_square_i64(x1), n, NULL);
+    if (lt_u128(x2, d)) {
         // numerical precision error, return 0.
         return 0.0;
     }
-
-    if (d.u64[0] > x2.u64[0]) {
-        x2.u64[1] -= 1;
-    }
-    m.u64[0] = x2.u64[0] - d.u64[0];
-    m.u64[1] = x2.u64[1] - d.u64[1];
-
-    // n = n - 1;  // sample variance, not population variance
-    d = js220_i128_udiv(m, n, NULL);
+    // n - 1 would give the sample variance, not population variance
+    d = js220_i128_udiv(js220_i128_sub(x2, d), n, NULL);
     // note: integer square root would have higher precision
-    f = js220_i128_to_f64(d, q * 2);
-    f = sqrt(f);
-    return f;
+    return sqrt(js220_i128_to_f64(d, q * 2));
 }
 
 js220_i128 js220_i128_compute_integral(js220_i128 x, uint64_t n) {
-    if (x.i64[1] < 0) {
+#if JS220_I128_NATIVE
+    x.i128 = x.i128 / (js220_i128_native) n;  // truncates toward zero
+#else
+    if (js220_i128_is_neg(x)) {
         x = js220_i128_neg(x);
         x = js220_i128_udiv(x, n, NULL);
         x = js220_i128_neg(x);
     } else {
         x = js220_i128_udiv(x, n, NULL);
-    };
+    }
+#endif
     return x;
 }
@@ -33,5 +33,400 @@ const struct jsdrvp_param_s js220_params[] = {
             "\"flags\": [\"ro\", \"hide\"]"
         "}",
     },
+    {
+        .topic = "h/stream/flush",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The maximum sample duration for each data message.\","
+            "\"detail\": \"Reduce for lower latency at the cost of more messages.\","
+            "\"default\": 50,"
+            "\"range\": [1, 1000]"
+        "}",
+    },
+    {
+        .topic = "h/stream/flush/bytes",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The maximum sample payload size for each data message.\","
+            "\"detail\": \"Messages flush at the first of this size or h/stream/flush. 0 uses the message capacity.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/stream/flush/mode",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The data message flush policy.\","
+            "\"detail\": \"adaptive starts at h/stream/flush, grows the duration while the host falls behind, and shrinks it when idle.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"fixed\"],"
+                "[1, \"adaptive\"]"
+            "]"
+        "}",
+    },
+    {
+        .topic = "h/stream/auto",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable signals based upon their subscribers.\","
+            "\"detail\": \"When on, each s/.../!data topic with a subscriber enables its signal, and signals without subscribers turn off, which updates the s/.../ctrl and h/.../ctrl values. Host-side statistics and multi-rate outputs keep current, voltage, and power on. Signals needed only for host-side computation are not published.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/stream/gate/start",
+        .meta = "{"
+            "\"dtype\": \"u64\","
+            "\"brief\": \"The first sample_id to deliver.\","
+            "\"detail\": \"Stream data messages only include samples from this sample_id. 0 delivers from the stream start.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/stream/gate/stop",
+        .meta = "{"
+            "\"dtype\": \"u64\","
+            "\"brief\": \"The first sample_id to no longer deliver.\","
+            "\"detail\": \"Stream data messages end before this sample_id, and the final message flushes immediately. 0 delivers until the stream stops.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/stream/gate/start/utc",
+        .meta = "{"
+            "\"dtype\": \"i64\","
+            "\"brief\": \"Set h/stream/gate/start from a UTC time.\","
+            "\"detail\": \"Converted to sample_id using the current time map. 0 clears the start.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/stream/gate/stop/utc",
+        .meta = "{"
+            "\"dtype\": \"i64\","
+            "\"brief\": \"Set h/stream/gate/stop from a UTC time.\","
+            "\"detail\": \"Converted to sample_id using the current time map. 0 clears the stop.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/stream/latency",
+        .meta = "{"
+            "\"dtype\": \"json\","
+            "\"brief\": \"The data message latency histogram.\","
+            "\"detail\": \"Published each second while streaming.\","
+            "\"flags\": [\"ro\"]"
+        "}",
+    },
+    {
+        .topic = "h/stream/e2e",
+        .meta = "{"
+            "\"dtype\": \"json\","
+            "\"brief\": \"The end-to-end host latency histogram.\","
+            "\"detail\": \"From USB completion until the frontend publishes each data message, published each second while streaming.\","
+            "\"flags\": [\"ro\"]"
+        "}",
+    },
+    {
+        .topic = "h/stream/health",
+        .meta = "{"
+            "\"dtype\": \"json\","
+            "\"brief\": \"The stream input frame and data loss counters.\","
+            "\"detail\": \"Counts accumulate since open and publish each second while streaming.\","
+            "\"flags\": [\"ro\"]"
+        "}",
+    },
+    {
+        .topic = "h/q/ctrl",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable the host-side charge stream s/q/!data.\","
+            "\"detail\": \"The cumulative float64 charge in coulombs, computed from s/i/!data which must also be enabled. Enabling restarts at 0.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/e/ctrl",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable the host-side energy stream s/e/!data.\","
+            "\"detail\": \"The cumulative float64 energy in joules, computed from s/p/!data which must also be enabled. Enabling restarts at 0.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/i/rms/ctrl",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable the host-side RMS current stream s/i/rms/!data.\","
+            "\"detail\": \"Computed from s/i/!data which must also be enabled.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/i/rms/window",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The RMS current window in s/i/!data samples.\","
+            "\"default\": 1000,"
+            "\"range\": [1, 1000000]"
+        "}",
+    },
+    {
+        .topic = "h/i/deadband",
+        .meta = "{"
+            "\"dtype\": \"f32\","
+            "\"brief\": \"The s/i/!data constant-signal tolerance in A, 0 to disable.\","
+            "\"detail\": \"Messages whose samples stay within a band of this width, max - min, combine into hold records with the sample count, min, max, and mean.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/v/deadband",
+        .meta = "{"
+            "\"dtype\": \"f32\","
+            "\"brief\": \"The s/v/!data constant-signal tolerance in V, 0 to disable.\","
+            "\"detail\": \"See h/i/deadband.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/p/deadband",
+        .meta = "{"
+            "\"dtype\": \"f32\","
+            "\"brief\": \"The s/p/!data constant-signal tolerance in W, 0 to disable.\","
+            "\"detail\": \"See h/i/deadband.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/i/summary/ctrl",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable the host-side current summary stream s/i/summary/!data.\","
+            "\"detail\": \"Each sample holds the mean, standard deviation, min, and max over its window. Computed from s/i/!data which must also be enabled.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/v/summary/ctrl",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable the host-side voltage summary stream s/v/summary/!data.\","
+            "\"detail\": \"Each sample holds the mean, standard deviation, min, and max over its window. Computed from s/v/!data which must also be enabled.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/p/summary/ctrl",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable the host-side power summary stream s/p/summary/!data.\","
+            "\"detail\": \"Each sample holds the mean, standard deviation, min, and max over its window. Computed from s/p/!data which must also be enabled.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/summary/fs",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The summary stream output sample rate in Hz.\","
+            "\"detail\": \"Each summary window holds at least 8 source samples.\","
+            "\"default\": 100,"
+            "\"range\": [1, 1000000]"
+        "}",
+    },
+    {
+        .topic = "h/gpi/0/edge/ctrl",
+        .meta = "{"
+            "\"dtype\": \"u8\","
+            "\"brief\": \"Enable the host-side GPI 0 edge stream s/gpi/0/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new level. Computed from s/gpi/0/!data which must also be enabled. Edges only does not publish s/gpi/0/!data.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]]"
+        "}",
+    },
+    {
+        .topic = "h/gpi/1/edge/ctrl",
+        .meta = "{"
+            "\"dtype\": \"u8\","
+            "\"brief\": \"Enable the host-side GPI 1 edge stream s/gpi/1/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new level. Computed from s/gpi/1/!data which must also be enabled. Edges only does not publish s/gpi/1/!data.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]]"
+        "}",
+    },
+    {
+        .topic = "h/gpi/2/edge/ctrl",
+        .meta = "{"
+            "\"dtype\": \"u8\","
+            "\"brief\": \"Enable the host-side GPI 2 edge stream s/gpi/2/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new level. Computed from s/gpi/2/!data which must also be enabled. Edges only does not publish s/gpi/2/!data.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]]"
+        "}",
+    },
+    {
+        .topic = "h/gpi/3/edge/ctrl",
+        .meta = "{"
+            "\"dtype\": \"u8\","
+            "\"brief\": \"Enable the host-side GPI 3 edge stream s/gpi/3/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new level. Computed from s/gpi/3/!data which must also be enabled. Edges only does not publish s/gpi/3/!data.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]]"
+        "}",
+    },
+    {
+        .topic = "h/gpi/7/edge/ctrl",
+        .meta = "{"
+            "\"dtype\": \"u8\","
+            "\"brief\": \"Enable the host-side GPI 7 edge stream s/gpi/7/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new level. Computed from s/gpi/7/!data which must also be enabled. Edges only does not publish s/gpi/7/!data.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]]"
+        "}",
+    },
+    {
+        .topic = "h/i/range/edge/ctrl",
+        .meta = "{"
+            "\"dtype\": \"u8\","
+            "\"brief\": \"Enable the host-side current range change stream s/i/range/edge/!data.\","
+            "\"detail\": \"Each sample is a jsdrv_edge_s with the sample_id and new current range. Computed from s/i/range/!data which must also be enabled. Edges only does not publish s/i/range/!data.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"off\"],"
+                "[1, \"on\"],"
+                "[2, \"edges only\"]]"
+        "}",
+    },
+    {
+        .topic = "h/ds/0/fs",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The multi-rate output 0 sampling frequency.\","
+            "\"detail\": \"Downsample s/i/!data, s/v/!data, and s/p/!data to s/i/ds/0/!data, s/v/ds/0/!data, and s/p/ds/0/!data. The ratio h/fs / frequency must be a product of 2s and 5s.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[1000000, \"1 MHz\"],"
+                "[500000, \"500 kHz\"],"
+                "[200000, \"200 kHz\"],"
+                "[100000, \"100 kHz\"],"
+                "[50000, \"50 kHz\"],"
+                "[20000, \"20 kHz\"],"
+                "[10000, \"10 kHz\"],"
+                "[5000, \"5 kHz\"],"
+                "[2000, \"2 kHz\"],"
+                "[1000, \"1 kHz\"],"
+                "[500, \"500 Hz\"],"
+                "[200, \"200 Hz\"],"
+                "[100, \"100 Hz\"],"
+                "[50, \"50 Hz\"],"
+                "[20, \"20 Hz\"],"
+                "[10, \"10 Hz\"],"
+                "[5, \"5 Hz\"],"
+                "[2, \"2 Hz\"],"
+                "[1, \"1 Hz\"],"
+                "[0, \"off\"]]"
+        "}",
+    },
+    {
+        .topic = "h/ds/1/fs",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The multi-rate output 1 sampling frequency.\","
+            "\"detail\": \"Downsample s/i/!data, s/v/!data, and s/p/!data to s/i/ds/1/!data, s/v/ds/1/!data, and s/p/ds/1/!data. The ratio h/fs / frequency must be a product of 2s and 5s.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[1000000, \"1 MHz\"],"
+                "[500000, \"500 kHz\"],"
+                "[200000, \"200 kHz\"],"
+                "[100000, \"100 kHz\"],"
+                "[50000, \"50 kHz\"],"
+                "[20000, \"20 kHz\"],"
+                "[10000, \"10 kHz\"],"
+                "[5000, \"5 kHz\"],"
+                "[2000, \"2 kHz\"],"
+                "[1000, \"1 kHz\"],"
+                "[500, \"500 Hz\"],"
+                "[200, \"200 Hz\"],"
+                "[100, \"100 Hz\"],"
+                "[50, \"50 Hz\"],"
+                "[20, \"20 Hz\"],"
+                "[10, \"10 Hz\"],"
+                "[5, \"5 Hz\"],"
+                "[2, \"2 Hz\"],"
+                "[1, \"1 Hz\"],"
+                "[0, \"off\"]]"
+        "}",
+    },
+    {
+        .topic = "h/stats/win/0/scnt",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"Number of samples per statistics window 0.\","
+            "\"detail\": \"Combine s/stats/value blocks into s/stats/win/0/value. Must be a multiple of s/stats/scnt. 0 is off.\","
+            "\"default\": 0,"
+            "\"range\": [0, 4000000000]"
+        "}",
+    },
+    {
+        .topic = "h/stats/win/1/scnt",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"Number of samples per statistics window 1.\","
+            "\"detail\": \"Combine s/stats/value blocks into s/stats/win/1/value. Must be a multiple of s/stats/scnt. 0 is off.\","
+            "\"default\": 0,"
+            "\"range\": [0, 4000000000]"
+        "}",
+    },
+    {
+        .topic = "h/stats/host/scnt",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"Number of samples per host-side statistics block.\","
+            "\"detail\": \"Compute s/stats/host/value on the host from the current, voltage, and host-side power. Requires s/i/!data, s/v/!data, and s/p/!data without on-instrument downsampling. 0 is off.\","
+            "\"default\": 0,"
+            "\"range\": [0, 4000000000]"
+        "}",
+    },
+    {
+        .topic = "h/stats/host/qtl",
+        .meta = "{"
+            "\"dtype\": \"bool\","
+            "\"brief\": \"Enable host-side quantiles s/stats/host/qtl.\","
+            "\"detail\": \"Publish the 50th, 90th, 99th, and 99.9th percentiles of current, voltage, and power for each s/stats/host/value block. Requires h/stats/host/scnt.\","
+            "\"default\": 0"
+        "}",
+    },
+    {
+        .topic = "h/filter/arith",
+        .meta = "{"
+            "\"dtype\": \"u32\","
+            "\"brief\": \"The host-side downsampling filter arithmetic.\","
+            "\"detail\": \"i64q30 converts each sample to 64-bit fixed point. f32 and f64 filter the float samples directly.\","
+            "\"default\": 0,"
+            "\"options\": ["
+                "[0, \"i64q30\"],"
+                "[1, \"f32\"],"
+                "[2, \"f64\"]"
+            "]"
+        "}",
+    },
     {.topic = NULL, .meta = NULL}  // end of list
 };
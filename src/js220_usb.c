@@ -15,25 +15,42 @@
 */
 
 #define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_JS220
 #include "jsdrv.h"
 #include "js220_api.h"
 #include "jsdrv_prv/js220_stats.h"
+#include "jsdrv_prv/js110_stats.h"
 #include "jsdrv_prv/downsample.h"
 #include "jsdrv_prv/backend.h"
 #include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/derived.h"
+#include "jsdrv_prv/f32_ops.h"
 #include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/latency_hist.h"
 #include "jsdrv_prv/log.h"
 #include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/param_cache.h"
+#include "jsdrv_prv/quantile.h"
+#include "jsdrv_prv/stats_windows.h"
+#include "jsdrv_prv/stream_flush.h"
+#include "jsdrv_prv/stream_gate.h"
+#include "jsdrv_prv/stream_health.h"
 #include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/thread_stats.h"
+#include "jsdrv_prv/time_map_filter.h"
+#include "jsdrv_prv/trace.h"
+#include "jsdrv_prv/value_shared.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
 #include "jsdrv_prv/dbc.h"
-#include "jsdrv_prv/sample_buffer_f32.h"
+#include "jsdrv_prv/power_f32.h"
 #include "jsdrv/topic.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv/version.h"
 #include "tinyprintf.h"
 #include <inttypes.h>
+#include <math.h>
 
 /*
  * Streaming data handling
@@ -86,7 +103,12 @@
 #define MEM_SIZE_MAX               (512U * 1024U)
 #define SAMPLING_FREQUENCY         (2000000U)
 #define FS_MIN_ON_INSTRUMENT       (1000U)
-#define STREAM_PAYLOAD_FULL        (JSDRV_STREAM_DATA_SIZE - JSDRV_STREAM_HEADER_SIZE - JS220_USB_FRAME_LENGTH)
+#define FS_SWITCH_WARMUP           (SAMPLING_FREQUENCY / 10U)  // in sample_id units
+#define BULK_OUT_COALESCE_FRAMES   (8U)
+#define LATENCY_INTERVAL_MS        (1000U)
+#define HEALTH_INTERVAL_MS         (1000U)
+#define POWER_BLOCK_LENGTH         (JS220_USB_FRAME_LENGTH / sizeof(float))
+#define STREAM_PAYLOAD_FULL(m_)    ((m_)->payload_size - JSDRV_STREAM_HEADER_SIZE - JS220_USB_FRAME_LENGTH)
 
 extern const struct jsdrvp_param_s js220_params[];
 
@@ -219,9 +241,13 @@ struct field_def_s PORT_MAP[] = {
         FIELD("s/stats/ctrl",   "s/stats/value",   UNDEFINED,   0, UNDEFINED,   0, 0),  // 14 js220_statistics_raw_s
         FIELD(NULL, NULL, UNDEFINED,   0, UINT,   8, 0),  // 15 reserved and unavailable
 };
+#define PORT_ID_RANGE   (4 + 16)
 #define PORT_ID_CURRENT (5 + 16)
 #define PORT_ID_VOLTAGE (6 + 16)
 #define PORT_ID_POWER   (7 + 16)
+#define PORT_ID_STATS   (14 + 16)
+#define PORT_ID_GPI_0   (8 + 16)
+#define PORT_ID_GPI_7   (12 + 16)
 #define COMPUTE_POWER_MASK ((1 << PORT_ID_CURRENT) | (1 << PORT_ID_VOLTAGE) | (1 << PORT_ID_POWER))
 #define PORTS_LENGTH (16)  // but last one is reserved
 
@@ -231,14 +257,104 @@ enum break_e {
     BREAK_NONE = 0,
     BREAK_CONNECT = 1,
     BREAK_PUBSUB_TOPIC = 2,
+    BREAK_CTRL_IDLE = 3,
 };
 
+enum derived_e {
+    DERIVED_CHARGE = 0,     // from current
+    DERIVED_ENERGY = 1,     // from power
+    DERIVED_I_RMS = 2,      // from current
+    DERIVED_I_SUMMARY = 3,  // from current
+    DERIVED_V_SUMMARY = 4,  // from voltage
+    DERIVED_P_SUMMARY = 5,  // from power
+    DERIVED_GPI_0_EDGE = 6, // from gpi 0, 1, 2, 3, and 7 in PORT_MAP order
+    DERIVED_GPI_7_EDGE = 10,
+    DERIVED_I_RANGE_EDGE = 11, // from current range
+    DERIVED_COUNT,
+};
+
+struct derived_def_s {
+    const char * ctrl_topic;
+    const char * data_topic;
+    uint8_t field_id;
+    uint8_t index;
+};
+
+static const struct derived_def_s DERIVED_MAP[] = {
+        {"h/q/ctrl",         "s/q/!data",         JSDRV_FIELD_CHARGE,  0},
+        {"h/e/ctrl",         "s/e/!data",         JSDRV_FIELD_ENERGY,  0},
+        {"h/i/rms/ctrl",     "s/i/rms/!data",     JSDRV_FIELD_RMS,     0},
+        {"h/i/summary/ctrl", "s/i/summary/!data", JSDRV_FIELD_SUMMARY, 0},
+        {"h/v/summary/ctrl", "s/v/summary/!data", JSDRV_FIELD_SUMMARY, 1},
+        {"h/p/summary/ctrl", "s/p/summary/!data", JSDRV_FIELD_SUMMARY, 2},
+        {"h/gpi/0/edge/ctrl", "s/gpi/0/edge/!data", JSDRV_FIELD_EDGE, 0},
+        {"h/gpi/1/edge/ctrl", "s/gpi/1/edge/!data", JSDRV_FIELD_EDGE, 1},
+        {"h/gpi/2/edge/ctrl", "s/gpi/2/edge/!data", JSDRV_FIELD_EDGE, 2},
+        {"h/gpi/3/edge/ctrl", "s/gpi/3/edge/!data", JSDRV_FIELD_EDGE, 3},
+        {"h/gpi/7/edge/ctrl", "s/gpi/7/edge/!data", JSDRV_FIELD_EDGE, 7},
+        {"h/i/range/edge/ctrl", "s/i/range/edge/!data", JSDRV_FIELD_RANGE, 0},
+};
+
+JSDRV_STATIC_ASSERT(DERIVED_COUNT == JSDRV_ARRAY_SIZE(DERIVED_MAP), derived_length);
+
+#define STREAM_IN_BATCH_FRAMES (64U)  // 32 kB
+#define STREAM_FRAME_NONE      (0xffU)
+
+/// A received frame, classified by port.
+struct stream_frame_s {
+    uint32_t * p_u32;       // frame header
+    uint16_t length;        // payload length in bytes
+    uint8_t port_id;
+    uint8_t next;           // next frame index for this stream port or STREAM_FRAME_NONE
+    bool head;              // first frame for this stream port
+};
+
+/// Stream frame samples, after sample_id reconciliation.
+struct stream_block_s {
+    uint32_t * data;
+    uint16_t size;          // in bytes
+    uint16_t sample_count;
+};
+
+#define DS_COUNT                (2U)   // multi-rate output slots
+#define DS_ELEMENT_COUNT_MAX    (JSDRV_STREAM_DATA_SIZE / sizeof(float))
+#define DS_BLOCK_SIZE           (256U)  // ds_process() input samples per jsdrv_downsample_add_f32_block()
+
+static const char * const DS_DATA_TOPIC[3][DS_COUNT] = {
+        {"s/i/ds/0/!data", "s/i/ds/1/!data"},
+        {"s/v/ds/0/!data", "s/v/ds/1/!data"},
+        {"s/p/ds/0/!data", "s/p/ds/1/!data"},
+};
+
+/// A multi-rate output for one port.
+struct ds_port_s {
+    struct jsdrv_downsample_s * downsample;  // from the port's output rate
+    struct jsdrvp_msg_s * msg;
+    uint64_t sample_id_next;       // expected next source sample_id, 0 for none
+    uint32_t element_count_max;
+    uint32_t data_topic_id;        // 0 or interned data topic
+};
+
+/// A multi-rate output slot for current, voltage, and power.
+struct ds_s {
+    uint32_t fs;                   // output sampling frequency, 0 for off
+    struct ds_port_s ports[3];     // current, voltage, power
+};
+
+struct dev_s;
+typedef void (*stream_in_blocks_fn)(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count);
+
 struct port_s {
     struct jsdrv_downsample_s * downsample;
     uint32_t decimate_factor;      // on-instrument decimation performed, excluding host downsampling
     uint64_t sample_id_next;
     struct jsdrvp_msg_s * msg_in;  // one for each port
-    struct sbuf_f32_s * buf;
+    int64_t msg_in_time;           // USB completion time for the first msg_in sample
+    uint32_t data_topic_id;        // 0 or interned data topic
+    stream_in_blocks_fn blocks_fn; // see stream_in_handlers_select(), NULL to discard
+    struct jsdrv_downsample_s * downsample_next;  // the pending rate switch, NULL for none
+    bool downsample_pending;       // switch to downsample_next at fs_switch_sample_id
+    struct jsdrv_deadband_s deadband;  // h/{i,v,p}/deadband constant-signal suppression
 };
 
 struct dev_s {
@@ -247,6 +363,7 @@ struct dev_s {
     struct jsdrv_context_s * context;
     uint16_t out_frame_id;
     uint16_t in_frame_id;
+    uint16_t capture_id;        // JSDRV_ARG_USB_CAPTURE device_id, 0 to disable
     uint64_t in_frame_count;
     uint32_t stream_in_port_enable;
 
@@ -254,23 +371,72 @@ struct dev_s {
     uint32_t fs;  // sampling frequency
     uint32_t signal_downsample_filter;
     uint32_t gpi_downsample_filter;
+    uint32_t filter_arith;      // h/filter/arith, see flat_passband_mode()
+    uint32_t dwn_signal_n;      // the applied on-instrument signal decimation, 0 to force rebuild
+    uint32_t dwn_gpi_n;         // the applied on-instrument GPI decimation
+    bool dwn_active;            // the applied is_on_instrument_downsample_active()
+    uint32_t fs_switch_pending; // port index bitmap awaiting the glitchless rate switch
+    uint64_t fs_switch_sample_id;
+    bool fs_switch_marker;      // publish h/fs/!switch on the next port switch
 
     struct port_s ports[PORTS_LENGTH]; // one for each port
     enum break_e ll_await_break_on;
     bool ll_await_break;
     char ll_await_break_topic[JSDRV_TOPIC_LENGTH_MAX];
     struct jsdrv_union_s ll_await_break_value;
+    uint32_t ctrl_pending;      // outstanding jsdrvb_ctrl_async() transfers
+    uint32_t ctrl_abandon;      // outstanding transfers from a timed out flush
+    int32_t ctrl_status;        // first error since the last flush
+    struct jsdrvp_msg_s * bulk_out_msg;  // coalesced frames, see bulk_out_send()
+    struct jsdrv_stream_flush_s stream_flush;  // data message size policy
+    struct jsdrv_stream_gate_s stream_gate;    // scheduled sample_id delivery window
+    int64_t stream_time;        // USB completion time of the stream message in process
+    struct jsdrv_latency_hist_s latency;
+    uint32_t latency_time_ms;
+    bool meta_published;        // host-side metadata sent, once per device instance
+    struct jsdrv_param_cache_device_s * param_cache;  // instrument values, persists across reopen
+    uint32_t param_cache_deltas;  // values changed since jsdrv_param_cache_resume()
+    struct jsdrv_stream_health_s health;
+    uint32_t health_time_ms;
+    uint64_t health_frames;     // health.frames at the last publish
     volatile bool do_exit;
     jsdrv_thread_t thread;
     uint8_t state;  // state_e
 
     struct jsdrv_time_map_s time_map;
+    struct jsdrv_tmf_s * time_map_filter;  // host estimate until the instrument provides time maps
+    bool time_map_device;                  // the instrument provided a time map
 
     float i_scale;
     float v_scale;
-    struct sbuf_f32_s i_buf;
-    struct sbuf_f32_s v_buf;
-    struct sbuf_f32_s p_buf;
+    struct jsdrv_power_f32_s power;
+
+    // host-side derived signals, computed from outgoing stream messages
+    uint16_t derived_enable;    // bitmap of derived_e
+    uint16_t derived_only;      // bitmap of derived_e whose source messages are not published
+    uint16_t derived_present;   // bitmap of derived_e with subscribers, see h/stream/auto
+
+    // subscriber-driven stream enables, see h/stream/auto
+    bool stream_auto;
+    uint32_t stream_present;    // bitmap of PORT_MAP index with data subscribers
+    uint32_t stream_watch_pending;  // watch reports outstanding after enable
+    uint32_t derived_topic_id[DERIVED_COUNT];
+    struct jsdrv_derived_integral_s charge;
+    struct jsdrv_derived_integral_s energy;
+    struct jsdrv_derived_rms_s i_rms;
+    uint32_t i_rms_window;
+    struct jsdrv_derived_summary_s summary[3];  // i, v, p
+    uint32_t summary_fs;
+    struct jsdrv_derived_edge_s edge[DERIVED_I_RANGE_EDGE - DERIVED_GPI_0_EDGE + 1];
+
+    // host-side statistics, computed with host-side power
+    struct js110_stats_s host_stats;
+    uint32_t host_stats_scnt;   // samples per block, 0 for off
+    bool host_stats_sync;       // set accum_sample_id on the next sample
+    struct jsdrv_quantile_s * host_quantile;  // i, v, p sketches, NULL for off
+
+    struct ds_s ds[DS_COUNT];   // multi-rate outputs, see ds_update()
+    struct jsdrv_stats_windows_s stats_windows;
 
     // memory operations
     struct js220_port3_header_s mem_hdr;
@@ -308,6 +474,7 @@ const uint8_t MEM_S_U8[] = {
 JSDRV_STATIC_ASSERT(JSDRV_ARRAY_SIZE(MEM_S) == JSDRV_ARRAY_SIZE(MEM_S_U8), mem_s_arrays);
 
 static bool handle_rsp(struct dev_s * d, struct jsdrvp_msg_s * msg);
+static void stream_in_handlers_select(struct dev_s * d);
 
 static const char * prefix_match_and_strip(const char * prefix, const char * topic) {
     while (*prefix) {
@@ -336,10 +503,25 @@ static bool msg_filter_by_topic(void * user_data, struct dev_s * d, struct jsdrv
     return (0 == strcmp(msg->topic, topic));
 }
 
+static void bulk_out_flush(struct dev_s * d) {
+    if (d->bulk_out_msg) {
+        JSDRV_LOGD2("bulk_out_flush %u bytes", (unsigned int) d->bulk_out_msg->value.size);
+        msg_queue_push(d->ll.cmd_q, d->bulk_out_msg);
+        d->bulk_out_msg = NULL;
+    }
+}
+
+// Send a command to the lower-level, after any coalesced bulk-out frames.
+static void ll_send(struct dev_s * d, struct jsdrvp_msg_s * msg) {
+    bulk_out_flush(d);
+    msg_queue_push(d->ll.cmd_q, msg);
+}
+
 static struct jsdrvp_msg_s * ll_await(struct dev_s * d, msg_filter_fn filter_fn, void * filter_user_data, uint32_t timeout_ms) {
     uint32_t t_now = jsdrv_time_ms_u32();
     uint32_t t_end = t_now + timeout_ms;
     d->ll_await_break = false;
+    bulk_out_flush(d);  // the device cannot respond to frames it has not received
 
     while (!d->ll_await_break && !d->do_exit) {
 #if _WIN32
@@ -403,32 +585,116 @@ static int32_t jsdrvb_ctrl_out(struct dev_s * d, usb_setup_t setup, const void *
 }
 #endif
 
-static int32_t jsdrvb_ctrl_in(struct dev_s * d, usb_setup_t setup, void * buffer, uint32_t * size) {
-    int32_t rv = 0;
+/**
+ * @brief Start a control transfer without waiting for completion.
+ *
+ * @param d The device instance.
+ * @param setup The USB setup packet, which also selects IN or OUT.
+ * @param buffer The OUT data with setup.s.wLength bytes, ignored for IN.
+ * @param cbk_fn The function called from handle_rsp() on success.
+ * @param cbk_user_data The arbitrary data for cbk_fn.
+ * @return 0 or error code.
+ *
+ * Control transfers complete in order.  Use jsdrvb_ctrl_flush() to
+ * wait for all pending transfers and get the first error.
+ */
+static int32_t jsdrvb_ctrl_async(struct dev_s * d, usb_setup_t setup, const void * buffer,
+                                 jsdrvp_usb_ctrl_fn cbk_fn, void * cbk_user_data) {
+    bool is_in = (setup.s.bmRequestType & 0x80) ? true : false;
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
-    jsdrv_cstr_copy(m->topic, JSDRV_USBBK_MSG_CTRL_IN, sizeof(m->topic));
+    jsdrv_cstr_copy(m->topic, is_in ? JSDRV_USBBK_MSG_CTRL_IN : JSDRV_USBBK_MSG_CTRL_OUT, sizeof(m->topic));
     m->value.type = JSDRV_UNION_BIN;
     m->value.value.bin = m->payload.bin;
     m->value.app = JSDRV_PAYLOAD_TYPE_USB_CTRL;
     m->extra.bkusb_ctrl.setup = setup;
+    m->extra.bkusb_ctrl.cbk_fn = cbk_fn;
+    m->extra.bkusb_ctrl.cbk_user_data = cbk_user_data;
+    if (!is_in) {
+        if (setup.s.wLength > sizeof(m->payload.bin)) {
+            JSDRV_LOGE("ctrl_out too big: %d", (int) setup.s.wLength);
+            jsdrvp_msg_free(d->context, m);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        memcpy(m->payload.bin, buffer, setup.s.wLength);
+        m->value.size = setup.s.wLength;
+    }
+    ++d->ctrl_pending;
+    ll_send(d, m);
+    return 0;
+}
 
-    msg_queue_push(d->ll.cmd_q, m);
-    m = ll_await_topic(d, JSDRV_USBBK_MSG_CTRL_IN, TIMEOUT_MS);
-    if (!m) {
-        JSDRV_LOGW("ctrl_in timed out");
-        return JSDRV_ERROR_TIMED_OUT;
+static void ctrl_complete(struct dev_s * d, struct jsdrvp_msg_s * msg) {
+    struct jsdrvp_msg_extra_backend_usb_control_s * c = &msg->extra.bkusb_ctrl;
+    int32_t rc = 0;
+    if (d->ctrl_abandon) {
+        --d->ctrl_abandon;  // caller no longer waiting, skip callback
+        return;
+    }
+    if (d->ctrl_pending) {
+        --d->ctrl_pending;
     }
-    if (m->value.size > setup.s.wLength) {
+    if (c->status) {
+        JSDRV_LOGW("ctrl request %d failed %" PRId32, (int) c->setup.s.bRequest, c->status);
+        rc = JSDRV_ERROR_IO;
+    } else if ((c->setup.s.bmRequestType & 0x80) && (msg->value.size > c->setup.s.wLength)) {
         JSDRV_LOGW("ctrl_in returned too much data");
-        rv = JSDRV_ERROR_TOO_BIG;
+        rc = JSDRV_ERROR_TOO_BIG;
     } else {
-        memcpy(buffer, m->payload.bin, m->value.size);
-        if (size) {
-            *size = m->value.size;
-        }
+        rc = c->cbk_fn(c->cbk_user_data, msg);
     }
-    jsdrvp_msg_free(d->context, m);
-    return rv;
+    if (rc && !d->ctrl_status) {
+        d->ctrl_status = rc;
+    }
+    if ((0 == d->ctrl_pending) && (d->ll_await_break_on == BREAK_CTRL_IDLE)) {
+        d->ll_await_break_on = BREAK_NONE;
+        d->ll_await_break = true;
+    }
+}
+
+/**
+ * @brief Wait for all pending jsdrvb_ctrl_async() transfers.
+ *
+ * @param d The device instance.
+ * @param timeout_ms The timeout in milliseconds.
+ * @return 0 or the first error.  On timeout, the remaining transfers
+ *      complete without calling their callbacks.
+ */
+static int32_t jsdrvb_ctrl_flush(struct dev_s * d, uint32_t timeout_ms) {
+    if (d->ctrl_pending) {
+        d->ll_await_break_on = BREAK_CTRL_IDLE;
+        ll_await(d, msg_filter_none, NULL, timeout_ms);
+        d->ll_await_break_on = BREAK_NONE;
+    }
+    if (d->ctrl_pending) {
+        JSDRV_LOGW("ctrl_flush timed out with %u pending", (unsigned int) d->ctrl_pending);
+        d->ctrl_abandon += d->ctrl_pending;
+        d->ctrl_pending = 0;
+        d->ctrl_status = 0;
+        return JSDRV_ERROR_TIMED_OUT;
+    }
+    int32_t rc = d->ctrl_status;
+    d->ctrl_status = 0;
+    return rc;
+}
+
+struct ctrl_in_s {
+    void * buffer;
+    uint32_t * size;
+};
+
+static int32_t ctrl_in_done(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct ctrl_in_s * self = (struct ctrl_in_s *) user_data;
+    memcpy(self->buffer, msg->payload.bin, msg->value.size);
+    if (self->size) {
+        *self->size = msg->value.size;
+    }
+    return 0;
+}
+
+static int32_t jsdrvb_ctrl_in(struct dev_s * d, usb_setup_t setup, void * buffer, uint32_t * size) {
+    struct ctrl_in_s self = {.buffer = buffer, .size = size};
+    JSDRV_RETURN_ON_ERROR(jsdrvb_ctrl_async(d, setup, NULL, ctrl_in_done, &self));
+    return jsdrvb_ctrl_flush(d, TIMEOUT_MS);
 }
 
 static int32_t jsdrvb_bulk_in_stream_open(struct dev_s * d) {
@@ -436,7 +702,7 @@ static int32_t jsdrvb_bulk_in_stream_open(struct dev_s * d) {
     struct jsdrvp_msg_s * m;
     m = jsdrvp_msg_alloc_value(d->context, JSDRV_USBBK_MSG_BULK_IN_STREAM_OPEN, &jsdrv_union_i32(0));
     m->extra.bkusb_stream.endpoint = JS220_USB_EP_BULK_IN;
-    msg_queue_push(d->ll.cmd_q, m);
+    ll_send(d, m);
     m = ll_await_topic(d, JSDRV_USBBK_MSG_BULK_IN_STREAM_OPEN, TIMEOUT_MS);
     if (!m) {
         JSDRV_LOGW("jsdrvb_bulk_in_stream_open timed out");
@@ -449,6 +715,20 @@ static int32_t jsdrvb_bulk_in_stream_open(struct dev_s * d) {
     return rv;
 }
 
+static int32_t jsdrvb_usb_config(struct dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
+    int32_t rv;
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, topic, value);
+    ll_send(d, m);
+    m = ll_await_topic(d, topic, TIMEOUT_MS);
+    if (!m) {
+        JSDRV_LOGW("jsdrvb_usb_config timed out");
+        return JSDRV_ERROR_TIMED_OUT;
+    }
+    rv = m->value.value.i32;
+    jsdrvp_msg_free(d->context, m);
+    return rv;
+}
+
 static struct jsdrvp_msg_s * bulk_out_factory(struct dev_s * d, uint8_t port_id, uint32_t payload_size) {
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, JSDRV_USBBK_MSG_BULK_OUT_DATA, &jsdrv_union_i32(0));
     m->value.type = JSDRV_UNION_BIN;
@@ -460,6 +740,42 @@ static struct jsdrvp_msg_s * bulk_out_factory(struct dev_s * d, uint8_t port_id,
     return m;
 }
 
+/**
+ * @brief Send a bulk-out frame from bulk_out_factory().
+ *
+ * @param d The device instance.
+ * @param m The frame message, which this function takes.
+ *
+ * Frames coalesce into a single bulk-out transfer of up to
+ * BULK_OUT_COALESCE_FRAMES.  Each frame starts on a USB packet boundary,
+ * so the device still receives one frame per packet.  The coalesced
+ * transfer is sent by bulk_out_flush(), which happens before any other
+ * lower-level command, before awaiting a response, and once per
+ * driver thread iteration.
+ */
+static void bulk_out_send(struct dev_s * d, struct jsdrvp_msg_s * m) {
+    struct jsdrvp_msg_s * c = d->bulk_out_msg;
+    uint32_t offset = 0;
+    if (c) {
+        offset = (c->value.size + JS220_USB_FRAME_LENGTH - 1) & ~(JS220_USB_FRAME_LENGTH - 1);
+        if ((offset + m->value.size) > c->payload_size) {
+            bulk_out_flush(d);
+            c = NULL;
+            offset = 0;
+        }
+    }
+    if (!c) {
+        c = jsdrvp_msg_alloc_data_sz(d->context, JSDRV_USBBK_MSG_BULK_OUT_DATA,
+                                     BULK_OUT_COALESCE_FRAMES * JS220_USB_FRAME_LENGTH);
+        c->extra.bkusb_stream.endpoint = JS220_USB_EP_BULK_OUT;
+        d->bulk_out_msg = c;
+    }
+    memset(c->payload.bin + c->value.size, 0, offset - c->value.size);
+    memcpy(c->payload.bin + offset, m->payload.bin, m->value.size);
+    c->value.size = offset + m->value.size;
+    jsdrvp_msg_free(d->context, m);
+}
+
 static int32_t bulk_out_publish(struct dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
     uint16_t length = sizeof(struct js220_publish_s);
     struct jsdrvp_msg_s * m = bulk_out_factory(d, 1, 0);
@@ -493,7 +809,7 @@ static int32_t bulk_out_publish(struct dev_s * d, const char * topic, const stru
     m->value.size += length;
     struct js220_frame_hdr_s * hdr = (struct js220_frame_hdr_s *) &m->payload.bin[0];
     hdr->length += length;
-    msg_queue_push(d->ll.cmd_q, m);
+    bulk_out_send(d, m);
     return 0;
 }
 
@@ -594,7 +910,7 @@ static int32_t d_open_ll(struct dev_s * d, int32_t opt) {
         JSDRV_LOGE("open_ll but already open");
         return JSDRV_ERROR_IN_USE;
     }
-    msg_queue_push(d->ll.cmd_q, m);
+    ll_send(d, m);
     m = ll_await_topic(d, JSDRV_MSG_OPEN, TIMEOUT_MS);
     if (!m) {
         JSDRV_LOGE("open_ll timed out");
@@ -611,6 +927,129 @@ static int32_t d_open_ll(struct dev_s * d, int32_t opt) {
     return 0;
 }
 
+static int ds_port_index(uint8_t port_id) {
+    switch (port_id) {
+        case PORT_ID_CURRENT: return 0;
+        case PORT_ID_VOLTAGE: return 1;
+        case PORT_ID_POWER: return 2;
+        default: return -1;
+    }
+}
+
+static struct ds_port_s * ds_port(struct dev_s * d, uint8_t slot, uint8_t port_id) {
+    int idx = ds_port_index(port_id);
+    return (idx < 0) ? NULL : &d->ds[slot].ports[idx];
+}
+
+static void ds_reset(struct dev_s * d, uint8_t port_id) {
+    for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+        struct ds_port_s * p = ds_port(d, slot, port_id);
+        if (NULL == p) {
+            return;
+        }
+        if (NULL != p->msg) {
+            jsdrvp_msg_free(d->context, p->msg);
+            p->msg = NULL;
+        }
+        jsdrv_downsample_clear(p->downsample);
+        p->sample_id_next = 0;
+    }
+}
+
+static int flat_passband_mode(struct dev_s * d) {
+    switch (d->filter_arith) {
+        case 1: return JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32;
+        case 2: return JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64;
+        default: return JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND;
+    }
+}
+
+// Allocate one port's downsampler for a slot from the port's current output rate.
+static int32_t ds_port_update(struct dev_s * d, uint8_t slot, uint8_t port_id) {
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    struct ds_port_s * p = ds_port(d, slot, port_id);
+    if (NULL != p->msg) {
+        jsdrvp_msg_free(d->context, p->msg);
+        p->msg = NULL;
+    }
+    jsdrv_downsample_free(p->downsample);
+    p->downsample = NULL;
+    p->sample_id_next = 0;
+    if (0 == d->ds[slot].fs) {
+        return 0;
+    }
+    uint32_t decimate_factor = port->decimate_factor * jsdrv_downsample_decimate_factor(port->downsample);
+    uint32_t fs_in = SAMPLING_FREQUENCY / (decimate_factor ? decimate_factor : 1);
+    if ((d->ds[slot].fs <= fs_in) && (0 == (fs_in % d->ds[slot].fs))) {  // stream headers need integer decimation
+        p->downsample = jsdrv_downsample_alloc(fs_in, d->ds[slot].fs, flat_passband_mode(d));
+    }
+    if (NULL == p->downsample) {
+        JSDRV_LOGW("ds %u: cannot produce %" PRIu32 " from %" PRIu32 " Hz",
+                   (unsigned int) slot, d->ds[slot].fs, fs_in);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return 0;
+}
+
+/**
+ * @brief Allocate the downsamplers for one multi-rate output slot.
+ *
+ * @param d The device.
+ * @param slot The slot index.
+ * @return 0 or JSDRV_ERROR_PARAMETER_INVALID when the slot's rate is
+ *      not available from the current sampling frequency.
+ *
+ * Each slot consumes the full-rate output of its port, so it shares
+ * the port's on-instrument decimation and host-side downsampling.
+ */
+static int32_t ds_update(struct dev_s * d, uint8_t slot) {
+    int32_t rv = 0;
+    for (uint8_t port_id = PORT_ID_CURRENT; port_id <= PORT_ID_POWER; ++port_id) {
+        if (ds_port_update(d, slot, port_id)) {
+            rv = JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    }
+    return rv;
+}
+
+static void ds_update_all(struct dev_s * d) {
+    for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+        ds_update(d, slot);
+    }
+}
+
+static void ds_free(struct dev_s * d) {
+    for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+        for (uint8_t port_id = PORT_ID_CURRENT; port_id <= PORT_ID_POWER; ++port_id) {
+            struct ds_port_s * p = ds_port(d, slot, port_id);
+            if (NULL != p->msg) {
+                jsdrvp_msg_free(d->context, p->msg);
+                p->msg = NULL;
+            }
+            jsdrv_downsample_free(p->downsample);
+            p->downsample = NULL;
+        }
+    }
+}
+
+static void host_stats_restart(struct dev_s * d) {
+    if (d->host_stats_scnt) {
+        js110_stats_sample_count_set(&d->host_stats, d->host_stats_scnt);
+        d->host_stats.statistics.decimate_factor = d->power.sample_id_decimate;
+    }
+    d->host_stats_sync = true;
+    if (d->host_quantile) {
+        for (uint32_t idx = 0; idx < 3; ++idx) {
+            jsdrv_quantile_clear(&d->host_quantile[idx]);
+        }
+    }
+}
+
+static void power_clear(struct dev_s * d, uint32_t decimate_factor) {
+    jsdrv_power_f32_clear(&d->power, decimate_factor);
+    host_stats_restart(d);
+}
+
 static void d_reset(struct dev_s * d) {
     d->out_frame_id = 0;
     d->in_frame_id = 0;
@@ -619,28 +1058,36 @@ static void d_reset(struct dev_s * d) {
 
     d->ll_await_break_on = BREAK_NONE;
     d->ll_await_break = false;
-    sbuf_f32_clear(&d->i_buf);
-    sbuf_f32_clear(&d->v_buf);
-    sbuf_f32_clear(&d->p_buf);
-    d->ports[0x0f & PORT_ID_CURRENT].buf = &d->i_buf;
-    d->ports[0x0f & PORT_ID_VOLTAGE].buf = &d->v_buf;
-    d->ports[0x0f & PORT_ID_POWER].buf = &d->p_buf;
+    jsdrv_stream_health_clear(&d->health);
+    d->health_frames = 0;
+    power_clear(d, PORT_MAP[0x0f & PORT_ID_CURRENT].decimate_min);
 
+    d->dwn_signal_n = 0;
+    d->fs_switch_pending = 0;
+    d->fs_switch_marker = false;
     for (uint32_t idx = 0; idx < (PORTS_LENGTH - 2); ++idx) {
         struct port_s *p = &d->ports[idx];
         if (p->downsample) {
             jsdrv_downsample_free(p->downsample);
             p->downsample = NULL;
         }
+        jsdrv_downsample_free(p->downsample_next);
+        p->downsample_next = NULL;
+        p->downsample_pending = false;
         p->sample_id_next = 0;
         if (p->msg_in) {
             jsdrvp_msg_free(d->context, p->msg_in);
             p->msg_in = NULL;
         }
+        jsdrv_deadband_initialize(&p->deadband, p->deadband.tolerance);
         p->decimate_factor = PORT_MAP[idx].decimate_min;
     }
+    ds_update_all(d);
+    stream_in_handlers_select(d);
 
     d->time_map.offset_time = 0;
+    d->time_map_device = false;
+    jsdrv_tmf_clear(d->time_map_filter);
     memset(&d->mem_hdr, 0, sizeof(d->mem_hdr));
 }
 
@@ -667,9 +1114,16 @@ static int32_t d_open(struct dev_s * d, int32_t opt) {
 
     if (JSDRV_DEVICE_OPEN_MODE_RAW != opt) {  // normal operation
         JSDRV_RETURN_ON_ERROR(wait_for_connect(d));
-        JSDRV_LOGD1("query metadata");
-        JSDRV_RETURN_ON_ERROR(bulk_out_publish(d, "$", &jsdrv_union_null()));
-        JSDRV_RETURN_ON_ERROR(ping_wait(d, 1));
+        uint64_t version = (((uint64_t) d->port0_connect.fw_version) << 32) | d->port0_connect.fpga_version;
+        uint64_t hash = jsdrv_param_cache_hash(d->param_cache);
+        d->param_cache_deltas = 0;
+        if (jsdrv_param_cache_resume(d->param_cache, version)) {
+            JSDRV_LOGI("metadata unchanged since last open, skip query");
+        } else {
+            JSDRV_LOGD1("query metadata");
+            JSDRV_RETURN_ON_ERROR(bulk_out_publish(d, "$", &jsdrv_union_null()));
+            JSDRV_RETURN_ON_ERROR(ping_wait(d, 1));
+        }
         if (JSDRV_DEVICE_OPEN_MODE_RESUME == opt) {
             struct jsdrv_topic_s topic;
             jsdrv_topic_set(&topic, d->ll.prefix);
@@ -678,6 +1132,9 @@ static int32_t d_open(struct dev_s * d, int32_t opt) {
             JSDRV_LOGD1("query values from instrument");
             JSDRV_RETURN_ON_ERROR(bulk_out_publish(d, "?", &jsdrv_union_null()));
             JSDRV_RETURN_ON_ERROR(ping_wait(d, 2));
+            JSDRV_LOGI("query values: %" PRIu32 " of %" PRIu32 " changed, hash %s",
+                       d->param_cache_deltas, jsdrv_param_cache_size(d->param_cache),
+                       (hash == jsdrv_param_cache_hash(d->param_cache)) ? "match" : "mismatch");
 
             JSDRV_LOGD1("query host-side values from pubsub");
             jsdrvp_device_subscribe(d->context, d->ll.prefix, topic.topic, JSDRV_SFLAG_RETAIN | JSDRV_SFLAG_PUB);
@@ -695,6 +1152,10 @@ static int32_t d_open(struct dev_s * d, int32_t opt) {
         send_to_frontend(d, "h/!reset$", &jsdrv_union_cjson_r(reset_meta));
     }
 
+    stream_in_handlers_select(d);  // after connect for the firmware version
+    if (JSDRV_DEVICE_OPEN_MODE_RAW != opt) {
+        jsdrv_param_cache_commit(d->param_cache);
+    }
     JSDRV_LOGI("open complete");
     update_state(d, ST_OPEN);
     return 0;
@@ -707,7 +1168,7 @@ static int32_t d_close(struct dev_s * d) {
         d->stream_in_port_enable = 0;  // disable all ports
         d_ctrl_req(d, JS220_CTRL_OP_DISCONNECT);  // ignore errors
         struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, JSDRV_MSG_CLOSE, &jsdrv_union_i32(0));
-        msg_queue_push(d->ll.cmd_q, m);
+        ll_send(d, m);
         m = ll_await_topic(d, JSDRV_MSG_CLOSE, 1000);
         if (!m) {
             rv = JSDRV_ERROR_TIMED_OUT;
@@ -738,23 +1199,81 @@ static bool has_on_instrument_downsample(struct dev_s * d) {
     );
 }
 
-static bool is_on_instrument_downsample_active(struct dev_s * d) {
+static bool is_on_instrument_downsample_active_fs(struct dev_s * d, uint32_t fs) {
     return (has_on_instrument_downsample(d)
-        && (d->fs < (SAMPLING_FREQUENCY / 2))
+        && (fs < (SAMPLING_FREQUENCY / 2))
         && (DOWNSAMPLE_SINC1 == d->signal_downsample_filter));
 }
 
+static bool is_on_instrument_downsample_active(struct dev_s * d) {
+    return is_on_instrument_downsample_active_fs(d, d->fs);
+}
+
 static bool is_ivp_enabled(struct dev_s * d) {
     return (COMPUTE_POWER_MASK == (COMPUTE_POWER_MASK & d->stream_in_port_enable));
 }
 
+/**
+ * @brief Complete a port's pending glitchless sampling frequency switch.
+ *
+ * @param d The device.
+ * @param port_id The port id with a pending switch.
+ *
+ * The caller must first send or free the port's message at the old rate.
+ */
+static void fs_switch_apply(struct dev_s * d, uint8_t port_id) {
+    uint8_t idx = port_id & 0x0f;
+    struct port_s * p = &d->ports[idx];
+    jsdrv_downsample_free(p->downsample);
+    p->downsample = p->downsample_next;
+    p->downsample_next = NULL;
+    p->downsample_pending = false;
+    if (ds_port_index(port_id) >= 0) {
+        for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+            ds_port_update(d, slot, port_id);
+        }
+    }
+    d->fs_switch_pending &= ~(1U << idx);
+    if (0 == d->fs_switch_pending) {
+        d->fs_switch_marker = false;
+        stream_in_handlers_select(d);  // drop the downsample handlers from full-rate ports
+    }
+}
+
+// Send the port's completed deadband hold record on its data topic.
+static void deadband_send(struct dev_s * d, struct port_s * port) {
+    struct field_def_s * field_def = &PORT_MAP[port - d->ports];
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(d->context, "",
+            JSDRV_STREAM_HEADER_SIZE + sizeof(struct jsdrv_stream_hold_s));
+    m->topic_id = port->data_topic_id;
+    if (!m->topic_id) {
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, field_def->data_topic);
+    }
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    m->value.size = jsdrv_deadband_emit(&port->deadband, s);
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    s->host_time.dispatch = jsdrv_time_utc();
+    jsdrvp_backend_send(d->context, m);
+}
+
 static void stream_reset_host_side(struct dev_s * d, size_t port_id) {
     struct port_s * p = &d->ports[port_id & 0x0f];
     if (NULL != p->msg_in) {
         jsdrvp_msg_free(d->context, p->msg_in);
         p->msg_in = NULL;
     }
-    sbuf_f32_clear(p->buf);
+    if (jsdrv_deadband_flush(&p->deadband)) {
+        deadband_send(d, p);  // the held samples were already received
+    }
+    if (p->downsample_pending) {
+        fs_switch_apply(d, (uint8_t) port_id);
+    }
+    if ((port_id == PORT_ID_CURRENT) || (port_id == PORT_ID_VOLTAGE) || (port_id == PORT_ID_POWER)) {
+        power_clear(d, p->decimate_factor);
+        ds_reset(d, (uint8_t) port_id);
+    } else if (port_id == PORT_ID_STATS) {
+        jsdrv_stats_windows_clear(&d->stats_windows);
+    }
     jsdrv_downsample_clear(p->downsample);
     p->sample_id_next = 0;
 }
@@ -805,6 +1324,7 @@ static bool stream_in_port_enable(struct dev_s * d, const char * topic, bool ena
             }
             JSDRV_LOGD1("stream_in_port_enable port %s %s => 0x%08lx",
                         topic, (enable ? "on" : "off"), d->stream_in_port_enable);
+            stream_in_handlers_select(d);
 
             if ((PORT_MAP[i].field_id == JSDRV_FIELD_CURRENT)
                     || (PORT_MAP[i].field_id == JSDRV_FIELD_VOLTAGE)
@@ -865,7 +1385,9 @@ static int32_t mem_complete(struct dev_s * d, int32_t status) {
         jsdrv_topic_remove(&topic);
         jsdrv_topic_append(&topic, "!rdata");
         JSDRV_LOGD1("%s with %d bytes", topic.topic, d->mem_hdr.length);
-        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, topic.topic, &jsdrv_union_bin(d->mem_data, d->mem_hdr.length));
+        struct jsdrv_union_s rdata = jsdrv_union_bin(d->mem_data, d->mem_hdr.length);
+        rdata.flags = JSDRV_UNION_FLAG_SHARED_MEMORY;  // reference, not a copy
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(d->context, topic.topic, &rdata);
         jsdrvp_backend_send(d->context, m);
     }
 
@@ -876,13 +1398,11 @@ static int32_t mem_complete(struct dev_s * d, int32_t status) {
     jsdrvp_backend_send(d->context, m);
 
     jsdrv_topic_clear(&d->mem_topic);
-    memset(&d->mem_hdr, 0, sizeof(d->mem_topic));
+    memset(&d->mem_hdr, 0, sizeof(d->mem_hdr));
     d->mem_offset_valid = 0;
     d->mem_offset_sent = 0;
-    if (NULL != d->mem_data) {
-        jsdrv_free(d->mem_data);
-        d->mem_data = NULL;
-    }
+    jsdrv_value_shared_release(d->mem_data);
+    d->mem_data = NULL;
     return status;
 }
 
@@ -945,15 +1465,20 @@ static int32_t handle_cmd_mem(struct dev_s * d, struct jsdrvp_msg_s * msg) {
         }
         m->hdr.op = JS220_PORT3_OP_WRITE_START;
         m->hdr.length = msg->value.size;
-        d->mem_data = jsdrv_alloc(msg->value.size);
-        memcpy(d->mem_data, msg->value.value.bin, msg->value.size);
+        if (msg->value.flags & JSDRV_UNION_FLAG_SHARED_MEMORY) {
+            jsdrv_value_shared_retain(msg->value.value.bin);  // firmware image, no copy
+            d->mem_data = (uint8_t *) msg->value.value.bin;
+        } else {
+            d->mem_data = jsdrv_value_shared_alloc(msg->value.size);
+            memcpy(d->mem_data, msg->value.value.bin, msg->value.size);
+        }
     } else if (0 == strcmp("!read", mem_cmd_str)) {
         int32_t sz = MEM_SIZE_MAX;
         jsdrv_union_as_type(&msg->value, JSDRV_UNION_U32);
         if (msg->value.value.u32) {
             sz = msg->value.value.u32;
         }
-        d->mem_data = jsdrv_alloc(sz);
+        d->mem_data = jsdrv_value_shared_alloc(sz);
         m->hdr.op = JS220_PORT3_OP_READ_REQ;
         m->hdr.length = sz;
     } else {
@@ -965,7 +1490,7 @@ static int32_t handle_cmd_mem(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     }
     d->mem_hdr = m->hdr;
     JSDRV_LOGD1("mem cmd: region=%s, op=%s, length=%d", region_str, mem_cmd_str, (int) d->mem_hdr.length);
-    msg_queue_push(d->ll.cmd_q, msg_bk);
+    bulk_out_send(d, msg_bk);
 
     return 0;
 }
@@ -982,65 +1507,209 @@ static int32_t handle_reset(struct dev_s * d, int32_t target) {
     memset(&m->hdr, 0, sizeof(m->hdr));
     m->hdr.op = JS220_PORT3_OP_BOOT;
     m->hdr.arg = target;
-    msg_queue_push(d->ll.cmd_q, msg_bk);
+    bulk_out_send(d, msg_bk);
     return 0;
 }
 
+/// The port rate configuration for a sampling frequency.
+struct port_rate_s {
+    uint32_t decimate_factor;   // on-instrument decimation
+    uint32_t fs_in;             // host-side downsample input rate, 0 for none
+    int mode;                   // host-side jsdrv_downsample_mode_e
+};
+
+static uint32_t gpi_decimate_factor(uint32_t fs) {
+    if (fs < FS_MIN_ON_INSTRUMENT) {
+        fs = FS_MIN_ON_INSTRUMENT;
+    }
+    return SAMPLING_FREQUENCY / fs;
+}
+
+static uint32_t signal_decimate_factor(struct dev_s * d, uint32_t fs) {
+    return (DOWNSAMPLE_WIDEBAND == d->signal_downsample_filter) ? 1 : (gpi_decimate_factor(fs) / 2);
+}
+
+static void port_rate(struct dev_s * d, uint32_t idx, uint32_t fs, struct port_rate_s * r) {
+    r->decimate_factor = PORT_MAP[idx].decimate_min;
+    r->fs_in = 0;
+    r->mode = flat_passband_mode(d);
+    uint32_t fs_in = SAMPLING_FREQUENCY / r->decimate_factor;
+    if (
+            (PORT_MAP[idx].element_type == JSDRV_DATA_TYPE_UINT)
+            && (PORT_MAP[idx].element_size_bits == 1)
+            && (d->gpi_downsample_filter)) {
+        r->decimate_factor = gpi_decimate_factor(fs);
+        return;
+    }
+    if ((PORT_MAP[idx].element_type != JSDRV_DATA_TYPE_FLOAT) || (fs >= fs_in)) {
+        return;
+    }
+    if (DOWNSAMPLE_WIDEBAND == d->signal_downsample_filter) {
+        r->fs_in = fs_in;
+    } else {
+        r->decimate_factor = gpi_decimate_factor(fs);  // GPI is from full rate
+        if (fs < FS_MIN_ON_INSTRUMENT) {
+            r->fs_in = FS_MIN_ON_INSTRUMENT;
+            r->mode = JSDRV_DOWNSAMPLE_MODE_AVERAGE;
+        }
+    }
+}
+
+static struct jsdrv_downsample_s * port_rate_downsample_alloc(const struct port_rate_s * r, uint32_t fs) {
+    if (0 == r->fs_in) {
+        return NULL;
+    }
+    struct jsdrv_downsample_s * downsample = NULL;
+    if (fs && (0 == (r->fs_in % fs))) {  // stream headers need integer decimation
+        downsample = jsdrv_downsample_alloc(r->fs_in, fs, r->mode);
+    }
+    if (NULL == downsample) {
+        JSDRV_LOGW("jsdrv_downsample_alloc failed");
+    }
+    return downsample;
+}
+
+static uint64_t lcm_u64(uint64_t a, uint64_t b) {
+    uint64_t x = a;
+    uint64_t y = b;
+    while (y) {
+        uint64_t t = x % y;
+        x = y;
+        y = t;
+    }
+    return (a / x) * b;
+}
+
+/**
+ * @brief Start a glitchless sampling frequency switch.
+ *
+ * @param d The device.
+ * @param fs The new sampling frequency.
+ * @return true when the switch is pending, false when the change requires
+ *      the full stream_suspend() and stream_resume().
+ *
+ * The switch is only possible when the on-instrument decimation is unchanged
+ * for all enabled ports, so that only the host-side downsampling changes.
+ * Pre-build the new downsamplers now, then switch each enabled port at the
+ * same sample_id boundary, aligned to both the old and new output rates.
+ */
+static bool fs_switch_start(struct dev_s * d, uint32_t fs) {
+    struct port_rate_s rate[PORTS_LENGTH - 2];
+    struct jsdrv_downsample_s * next[PORTS_LENGTH - 2];
+    uint32_t pending = 0;
+    bool gpi_enabled = false;
+    uint64_t align = 1;
+    uint64_t sample_id = 0;
+    uint32_t gpi_n = gpi_decimate_factor(fs);
+
+    if ((d->state != ST_OPEN) || d->fs_switch_pending || (0 == d->dwn_signal_n)
+            || (signal_decimate_factor(d, fs) != d->dwn_signal_n)
+            || (is_on_instrument_downsample_active_fs(d, fs) != d->dwn_active)) {
+        return false;
+    }
+    for (uint32_t idx = 0; idx < (PORTS_LENGTH - 2); ++idx) {
+        port_rate(d, idx, fs, &rate[idx]);
+        next[idx] = NULL;
+        if (0 == (d->stream_in_port_enable & (1U << (idx + 16)))) {
+            continue;
+        }
+        if (rate[idx].decimate_factor != d->ports[idx].decimate_factor) {
+            return false;
+        }
+        if (PORT_MAP[idx].element_type == JSDRV_DATA_TYPE_FLOAT) {
+            pending |= (1U << idx);
+        } else if ((PORT_MAP[idx].element_type == JSDRV_DATA_TYPE_UINT) && (PORT_MAP[idx].element_size_bits == 1)) {
+            gpi_enabled = true;
+        }
+    }
+    if (!pending || (gpi_enabled && (gpi_n != d->dwn_gpi_n))) {
+        return false;
+    }
+
+    for (uint32_t idx = 0; idx < (PORTS_LENGTH - 2); ++idx) {
+        struct port_s * p = &d->ports[idx];
+        if (0 == (pending & (1U << idx))) {
+            continue;
+        }
+        next[idx] = port_rate_downsample_alloc(&rate[idx], fs);
+        if (rate[idx].fs_in && (NULL == next[idx])) {
+            for (uint32_t k = 0; k < idx; ++k) {
+                jsdrv_downsample_free(next[k]);
+            }
+            return false;
+        }
+        uint64_t decimate_factor = p->decimate_factor;
+        align = lcm_u64(align, lcm_u64(decimate_factor * jsdrv_downsample_decimate_factor(p->downsample),
+                                       decimate_factor * jsdrv_downsample_decimate_factor(next[idx])));
+        if (p->sample_id_next > sample_id) {
+            sample_id = p->sample_id_next;
+        }
+    }
+    sample_id += FS_SWITCH_WARMUP;
+    sample_id = ((sample_id + align - 1) / align) * align;
+
+    d->fs = fs;
+    for (uint32_t idx = 0; idx < (PORTS_LENGTH - 2); ++idx) {
+        struct port_s * p = &d->ports[idx];
+        uint8_t port_id = (uint8_t) (idx + 16);
+        if (pending & (1U << idx)) {
+            p->downsample_next = next[idx];
+            p->downsample_pending = true;
+            continue;
+        }
+        // disabled ports have no stream continuity to preserve
+        jsdrv_downsample_free(p->downsample);
+        p->downsample = port_rate_downsample_alloc(&rate[idx], fs);
+        p->decimate_factor = rate[idx].decimate_factor;
+        if (ds_port_index(port_id) >= 0) {
+            for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+                ds_port_update(d, slot, port_id);
+            }
+        }
+    }
+    d->fs_switch_pending = pending;
+    d->fs_switch_sample_id = sample_id;
+    d->fs_switch_marker = true;
+
+    if ((gpi_n != d->dwn_gpi_n) && has_on_instrument_downsample(d) && (NULL != d->ll.cmd_q)) {
+        bulk_out_publish(d, "s/gpi/+/dwnN/N", &jsdrv_union_u32_r(gpi_n));
+    }
+    d->dwn_gpi_n = gpi_n;
+    stream_in_handlers_select(d);
+    JSDRV_LOGI("on_sampling_frequency(%lu) switch at sample_id %" PRIu64, d->fs, sample_id);
+    return true;
+}
+
 static int32_t on_sampling_frequency(struct dev_s * d,  const struct jsdrv_union_s * value) {
     struct jsdrv_union_s v = *value;
-    uint32_t fs_in;
     if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
         JSDRV_LOGW("Could not process sampling frequency");
         return JSDRV_ERROR_PARAMETER_INVALID;
     }
+    if (fs_switch_start(d, v.value.u32)) {
+        return 0;
+    }
 
     stream_suspend(d);
     d->fs = v.value.u32;
     JSDRV_LOGI("on_sampling_frequency(%lu)", d->fs);
-    uint32_t gpi_n = SAMPLING_FREQUENCY / d->fs;
-    if (d->fs < FS_MIN_ON_INSTRUMENT) {
-        gpi_n = SAMPLING_FREQUENCY / FS_MIN_ON_INSTRUMENT;
-    }
-    uint32_t signal_n = (DOWNSAMPLE_WIDEBAND == d->signal_downsample_filter) ? 1 : (gpi_n / 2);
+    uint32_t gpi_n = gpi_decimate_factor(d->fs);
+    uint32_t signal_n = signal_decimate_factor(d, d->fs);
 
     for (uint32_t idx = 0; idx < (PORTS_LENGTH - 2); ++idx) {
         struct port_s *p = &d->ports[idx];
+        struct port_rate_s rate;
         if (p->downsample) {
             jsdrv_downsample_free(p->downsample);
             p->downsample = NULL;
         }
-        p->decimate_factor = PORT_MAP[idx].decimate_min;
-        fs_in = SAMPLING_FREQUENCY / p->decimate_factor;
-        if (
-                (PORT_MAP[idx].element_type == JSDRV_DATA_TYPE_UINT)
-                && (PORT_MAP[idx].element_size_bits == 1)
-                && (d->gpi_downsample_filter)) {
-            p->decimate_factor = gpi_n;
-            continue;
-        }
-        if (PORT_MAP[idx].element_type != JSDRV_DATA_TYPE_FLOAT) {
-            continue;
-        }
-        if (d->fs >= fs_in) {
-            continue;
-        }
-
-        if (DOWNSAMPLE_WIDEBAND == d->signal_downsample_filter) {
-            p->downsample = jsdrv_downsample_alloc(fs_in, d->fs, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND);
-            if (NULL == p->downsample) {
-                JSDRV_LOGW("jsdrv_downsample_alloc failed");
-            }
-        } else {
-            p->decimate_factor = gpi_n;  // GPI is from full rate
-            if (d->fs < FS_MIN_ON_INSTRUMENT) {
-                p->downsample = jsdrv_downsample_alloc(FS_MIN_ON_INSTRUMENT, d->fs, JSDRV_DOWNSAMPLE_MODE_AVERAGE);
-                if (NULL == p->downsample) {
-                    JSDRV_LOGW("jsdrv_downsample_alloc failed");
-                }
-            }
+        port_rate(d, idx, d->fs, &rate);
+        p->decimate_factor = rate.decimate_factor;
+        p->downsample = port_rate_downsample_alloc(&rate, d->fs);
+        if (rate.fs_in) {
+            JSDRV_LOGI("jsdrv_downsample_alloc idx=%lu, decimate_factor=%lu",
+                       idx, p->decimate_factor);
         }
-        JSDRV_LOGI("jsdrv_downsample_alloc idx=%lu, decimate_factor=%lu",
-                   idx, p->decimate_factor);
     }
 
     if (has_on_instrument_downsample(d) && (NULL != d->ll.cmd_q)) {
@@ -1048,35 +1717,389 @@ static int32_t on_sampling_frequency(struct dev_s * d,  const struct jsdrv_union
         bulk_out_publish(d, "s/dwnN/N", &jsdrv_union_u32_r(signal_n));
         bulk_out_publish(d, "s/gpi/+/dwnN/N", &jsdrv_union_u32_r(gpi_n));
     }
+    d->dwn_signal_n = signal_n;
+    d->dwn_gpi_n = gpi_n;
+    d->dwn_active = is_on_instrument_downsample_active(d);
+    ds_update_all(d);
+    stream_in_handlers_select(d);
     stream_resume(d);
 
     return 0;
 }
 
-static int32_t on_filter(struct dev_s * d,  const struct jsdrv_union_s * value) {
+static int32_t on_stream_flush(struct dev_s * d, const struct jsdrv_union_s * value) {
     struct jsdrv_union_s v = *value;
     if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
-        JSDRV_LOGW("Could not process signal downsampling filter setting");
         return JSDRV_ERROR_PARAMETER_INVALID;
     }
-    d->signal_downsample_filter = v.value.u32;
-    return on_sampling_frequency(d, &jsdrv_union_u32_r(d->fs));
+    return jsdrv_stream_flush_ms_set(&d->stream_flush, v.value.u32);
 }
 
-static int32_t on_gpi_downsample_filter(struct dev_s * d,  const struct jsdrv_union_s * value) {
+static int32_t on_stream_flush_bytes(struct dev_s * d, const struct jsdrv_union_s * value) {
     struct jsdrv_union_s v = *value;
     if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
-        JSDRV_LOGW("Could not process GPI downsampling filter setting");
         return JSDRV_ERROR_PARAMETER_INVALID;
     }
-    d->gpi_downsample_filter = v.value.u32;
-    return on_sampling_frequency(d, &jsdrv_union_u32_r(d->fs));
+    jsdrv_stream_flush_bytes_set(&d->stream_flush, v.value.u32);
+    return 0;
 }
 
-static bool handle_cmd(struct dev_s * d, struct jsdrvp_msg_s * msg) {
-    int32_t rc = 0;
-    bool rv = true;
-    if (!msg) {
+static int32_t on_stream_flush_mode(struct dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return jsdrv_stream_flush_mode_set(&d->stream_flush, v.value.u32);
+}
+
+static int32_t on_stream_gate(struct dev_s * d, uint64_t * sample_id, const struct jsdrv_union_s * value, bool utc) {
+    struct jsdrv_union_s v = *value;
+    if (utc) {
+        if (jsdrv_union_as_type(&v, JSDRV_UNION_I64)) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        if (0 == v.value.i64) {
+            *sample_id = 0;
+            return 0;
+        }
+        return jsdrv_stream_gate_utc_to_sample_id(&d->time_map, v.value.i64, sample_id);
+    }
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U64)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    *sample_id = v.value.u64;
+    return 0;
+}
+
+static int32_t on_derived_ctrl(struct dev_s * d, uint8_t idx, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint16_t mask = (uint16_t) (1U << idx);
+    d->derived_only &= ~mask;
+    if (!v.value.u32) {
+        d->derived_enable &= ~mask;
+        return 0;
+    }
+    if (!(d->derived_enable & mask)) {
+        switch (idx) {  // restart on enable
+            case DERIVED_CHARGE: jsdrv_derived_integral_clear(&d->charge); break;
+            case DERIVED_ENERGY: jsdrv_derived_integral_clear(&d->energy); break;
+            case DERIVED_I_RMS: jsdrv_derived_rms_clear(&d->i_rms, d->i_rms_window); break;
+            case DERIVED_I_SUMMARY:  // intentional fall-through
+            case DERIVED_V_SUMMARY:  // intentional fall-through
+            case DERIVED_P_SUMMARY:
+                jsdrv_derived_summary_clear(&d->summary[idx - DERIVED_I_SUMMARY], d->summary_fs);
+                break;
+            default:
+                if ((idx >= DERIVED_GPI_0_EDGE) && (idx <= DERIVED_I_RANGE_EDGE)) {
+                    jsdrv_derived_edge_clear(&d->edge[idx - DERIVED_GPI_0_EDGE]);
+                }
+                break;
+        }
+    }
+    d->derived_enable |= mask;
+    return 0;
+}
+
+static int32_t on_edge_ctrl(struct dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
+    // h/gpi/{N}/edge/ctrl, h/i/range/edge/ctrl: 0 off, 1 edges and samples, 2 edges only
+    for (uint8_t idx = DERIVED_GPI_0_EDGE; idx <= DERIVED_I_RANGE_EDGE; ++idx) {
+        if (0 == strcmp(DERIVED_MAP[idx].ctrl_topic, topic)) {
+            struct jsdrv_union_s v = *value;
+            if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 > 2)) {
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            int32_t rc = on_derived_ctrl(d, idx, &v);
+            if (!rc && (2 == v.value.u32)) {
+                d->derived_only |= (uint16_t) (1U << idx);
+            }
+            return rc;
+        }
+    }
+    return JSDRV_ERROR_PARAMETER_INVALID;
+}
+
+static uint8_t derived_source_port(uint8_t idx) {
+    switch (idx) {
+        case DERIVED_CHARGE:     // intentional fall-through
+        case DERIVED_I_RMS:      // intentional fall-through
+        case DERIVED_I_SUMMARY: return PORT_ID_CURRENT;
+        case DERIVED_V_SUMMARY: return PORT_ID_VOLTAGE;
+        case DERIVED_ENERGY:     // intentional fall-through
+        case DERIVED_P_SUMMARY: return PORT_ID_POWER;
+        case DERIVED_I_RANGE_EDGE: return PORT_ID_RANGE;
+        default: return (uint8_t) (PORT_ID_GPI_0 + (idx - DERIVED_GPI_0_EDGE));
+    }
+}
+
+static bool is_ds_active(struct dev_s * d) {
+    for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+        if (d->ds[slot].fs) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Check if anything uses a port's outgoing stream messages.
+ *
+ * @param d The device.
+ * @param port_id The port id.
+ * @return True unless h/stream/auto is on and the port's data topic has no
+ *      subscribers, no enabled derived signal uses the port, and no
+ *      multi-rate output uses the port.
+ */
+static bool stream_is_consumed(struct dev_s * d, uint8_t port_id) {
+    if (!d->stream_auto || (d->stream_present & (1U << (port_id & 0x0f)))) {
+        return true;
+    }
+    for (uint8_t idx = 0; idx < DERIVED_COUNT; ++idx) {
+        if ((d->derived_enable & (1U << idx)) && (derived_source_port(idx) == port_id)) {
+            return true;
+        }
+    }
+    for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+        struct ds_port_s * p = ds_port(d, slot, port_id);
+        if ((NULL != p) && (NULL != p->downsample)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Enable the streams and derived signals that have subscribers.
+ *
+ * @param d The device.
+ *
+ * With h/stream/auto, each s/.../!data subscriber enables its signal.
+ * Derived signals also enable their source port, and host-side statistics
+ * and multi-rate outputs enable current, voltage, and power.  Changes
+ * publish the corresponding ctrl topic so that the retained values
+ * reflect the device state.
+ */
+static void stream_auto_apply(struct dev_s * d) {
+    if (!d->stream_auto || d->stream_watch_pending || (d->state != ST_OPEN)) {
+        return;
+    }
+    for (uint8_t idx = 0; idx < DERIVED_COUNT; ++idx) {
+        uint16_t mask = (uint16_t) (1U << idx);
+        bool want = (0 != (d->derived_present & mask));
+        if (want != (0 != (d->derived_enable & mask))) {
+            on_derived_ctrl(d, idx, &jsdrv_union_u32(want ? 1 : 0));
+            send_to_frontend(d, DERIVED_MAP[idx].ctrl_topic, &jsdrv_union_u32_r(want ? 1 : 0));
+        }
+    }
+
+    uint32_t want = d->stream_present;  // bitmap of PORT_MAP index
+    for (uint8_t idx = 0; idx < DERIVED_COUNT; ++idx) {
+        if (d->derived_enable & (1U << idx)) {
+            want |= 1U << (derived_source_port(idx) & 0x0f);
+        }
+    }
+    if (d->host_stats_scnt || is_ds_active(d)) {
+        want |= COMPUTE_POWER_MASK >> 16;
+    }
+    for (uint32_t i = 0; i < PORTS_LENGTH; ++i) {
+        if (!PORT_MAP[i].ctrl_topic || ((i + 16) == PORT_ID_STATS)) {
+            continue;
+        }
+        bool enable = (0 != (want & (1U << i)));
+        if (enable == (0 != (d->stream_in_port_enable & (0x00010000 << i)))) {
+            continue;
+        }
+        JSDRV_LOGI("stream auto %s %s", PORT_MAP[i].ctrl_topic, enable ? "on" : "off");
+        if (stream_in_port_enable(d, PORT_MAP[i].ctrl_topic, enable)) {
+            bulk_out_publish(d, PORT_MAP[i].ctrl_topic, &jsdrv_union_u32_r(enable ? 1 : 0));
+        }
+        send_to_frontend(d, PORT_MAP[i].ctrl_topic, &jsdrv_union_u32_r(enable ? 1 : 0));
+    }
+    stream_in_handlers_select(d);
+}
+
+static void stream_watch(struct dev_s * d, const char * subtopic, bool enable) {
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    tfp_snprintf(topic, sizeof(topic), "%s/%s", d->ll.prefix, subtopic);
+    jsdrvp_device_watch(d->context, d->ll.prefix, topic, enable);
+}
+
+static int32_t on_stream_auto(struct dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    bool enable = (0 != v.value.u32);
+    d->stream_present = 0;
+    d->derived_present = 0;
+    d->stream_watch_pending = 0;
+    for (uint32_t i = 0; i < PORTS_LENGTH; ++i) {
+        if (PORT_MAP[i].data_topic && jsdrv_cstr_ends_with(PORT_MAP[i].data_topic, "!data")) {
+            stream_watch(d, PORT_MAP[i].data_topic, enable);
+            d->stream_watch_pending += enable ? 1 : 0;
+        }
+    }
+    for (uint32_t idx = 0; idx < DERIVED_COUNT; ++idx) {
+        stream_watch(d, DERIVED_MAP[idx].data_topic, enable);
+        d->stream_watch_pending += enable ? 1 : 0;
+    }
+    d->stream_auto = enable;
+    stream_in_handlers_select(d);  // publish everything again when off
+    return 0;
+}
+
+static void on_stream_watch(struct dev_s * d, const char * topic, uint32_t count) {
+    for (uint32_t i = 0; i < PORTS_LENGTH; ++i) {
+        if (PORT_MAP[i].data_topic && (0 == strcmp(PORT_MAP[i].data_topic, topic))) {
+            if (count) {
+                d->stream_present |= 1U << i;
+            } else {
+                d->stream_present &= ~(1U << i);
+            }
+        }
+    }
+    for (uint32_t idx = 0; idx < DERIVED_COUNT; ++idx) {
+        if (0 == strcmp(DERIVED_MAP[idx].data_topic, topic)) {
+            if (count) {
+                d->derived_present |= (uint16_t) (1U << idx);
+            } else {
+                d->derived_present &= (uint16_t) ~(1U << idx);
+            }
+        }
+    }
+    JSDRV_LOGD1("stream watch %s %" PRIu32 " => 0x%04" PRIx32, topic, count, d->stream_present);
+    if (d->stream_watch_pending) {
+        --d->stream_watch_pending;
+    }
+    stream_auto_apply(d);
+}
+
+static int32_t on_i_rms_window(struct dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 < 1) || (v.value.u32 > JSDRV_DERIVED_RMS_WINDOW_MAX)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    d->i_rms_window = v.value.u32;
+    jsdrv_derived_rms_clear(&d->i_rms, d->i_rms_window);
+    return 0;
+}
+
+static int32_t on_deadband(struct dev_s * d, uint8_t port_id, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_F32) || !(v.value.f32 >= 0.0f) || isinf(v.value.f32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    if (jsdrv_deadband_flush(&port->deadband)) {
+        deadband_send(d, port);
+    }
+    jsdrv_deadband_initialize(&port->deadband, v.value.f32);
+    return 0;
+}
+
+static int32_t on_host_stats_scnt(struct dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    d->host_stats_scnt = v.value.u32;
+    host_stats_restart(d);
+    stream_auto_apply(d);
+    return 0;
+}
+
+static int32_t on_host_stats_quantile(struct dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (v.value.u32 && (NULL == d->host_quantile)) {
+        d->host_quantile = jsdrv_alloc_clr(3 * sizeof(struct jsdrv_quantile_s));
+    } else if (!v.value.u32 && (NULL != d->host_quantile)) {
+        jsdrv_free(d->host_quantile);
+        d->host_quantile = NULL;
+    }
+    host_stats_restart(d);
+    return 0;
+}
+
+static int32_t on_summary_fs(struct dev_s * d, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 < 1) || (v.value.u32 > 1000000U)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    d->summary_fs = v.value.u32;
+    for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->summary); ++idx) {
+        jsdrv_derived_summary_clear(&d->summary[idx], d->summary_fs);
+    }
+    return 0;
+}
+
+static int32_t on_ds(struct dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
+    // h/ds/{slot}/fs
+    struct jsdrv_union_s v = *value;
+    uint8_t slot = (uint8_t) (topic[5] - '0');
+    if ((slot >= DS_COUNT) || (0 != strcmp("/fs", topic + 6))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 > (SAMPLING_FREQUENCY / 2))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    d->ds[slot].fs = v.value.u32;
+    int32_t rc = ds_update(d, slot);
+    stream_auto_apply(d);
+    return rc;
+}
+
+static int32_t on_stats_win(struct dev_s * d, const char * topic, const struct jsdrv_union_s * value) {
+    // h/stats/win/{slot}/scnt
+    struct jsdrv_union_s v = *value;
+    uint8_t slot = (uint8_t) (topic[12] - '0');
+    if ((slot >= JSDRV_STATS_WINDOWS_COUNT) || (0 != strcmp("/scnt", topic + 13))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return jsdrv_stats_windows_scnt_set(&d->stats_windows, slot, v.value.u32);
+}
+
+static int32_t on_filter(struct dev_s * d,  const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        JSDRV_LOGW("Could not process signal downsampling filter setting");
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    d->signal_downsample_filter = v.value.u32;
+    return on_sampling_frequency(d, &jsdrv_union_u32_r(d->fs));
+}
+
+static int32_t on_gpi_downsample_filter(struct dev_s * d,  const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+        JSDRV_LOGW("Could not process GPI downsampling filter setting");
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    d->gpi_downsample_filter = v.value.u32;
+    return on_sampling_frequency(d, &jsdrv_union_u32_r(d->fs));
+}
+
+static int32_t on_filter_arith(struct dev_s * d,  const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || (v.value.u32 > 2)) {
+        JSDRV_LOGW("Could not process filter arithmetic setting");
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    d->filter_arith = v.value.u32;
+    return on_sampling_frequency(d, &jsdrv_union_u32_r(d->fs));
+}
+
+static bool handle_cmd(struct dev_s * d, struct jsdrvp_msg_s * msg) {
+    int32_t rc = 0;
+    bool rv = true;
+    if (!msg) {
         return false;
     }
     const char * topic = prefix_match_and_strip(d->ll.prefix, msg->topic);
@@ -1090,6 +2113,8 @@ static bool handle_cmd(struct dev_s * d, struct jsdrvp_msg_s * msg) {
         }
     } else if (!topic) {
         JSDRV_LOGE("handle_cmd mismatch %s, %s", msg->topic, d->ll.prefix);
+    } else if (msg->value.app == JSDRV_PAYLOAD_TYPE_WATCH) {
+        on_stream_watch(d, topic, msg->value.value.u32);
     } else if (topic[0] == JSDRV_MSG_COMMAND_PREFIX_CHAR) {
         if (0 == strcmp(JSDRV_MSG_OPEN, topic)) {
             int32_t opt = 0;
@@ -1122,6 +2147,7 @@ static bool handle_cmd(struct dev_s * d, struct jsdrvp_msg_s * msg) {
         if (jsdrv_cstr_starts_with(topic, "h/mem/")) {
             handle_cmd_mem(d, msg);
         } else if (0 == strcmp("h/!reset", topic)) {   // value=target
+            jsdrv_param_cache_invalidate(d->param_cache);  // target may run other firmware
             rc = handle_reset(d, msg->value.value.i32);
             send_return_code_to_frontend(d, topic, rc);
         } else if (0 == strcmp("h/timeout", topic)) {
@@ -1131,9 +2157,84 @@ static bool handle_cmd(struct dev_s * d, struct jsdrvp_msg_s * msg) {
         } else if (0 == strcmp("h/fs", topic)) {
             rc = on_sampling_frequency(d, &msg->value);
             send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/flush", topic)) {
+            rc = on_stream_flush(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/flush/bytes", topic)) {
+            rc = on_stream_flush_bytes(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/flush/mode", topic)) {
+            rc = on_stream_flush_mode(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/auto", topic)) {
+            rc = on_stream_auto(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/gate/start", topic)) {
+            rc = on_stream_gate(d, &d->stream_gate.start, &msg->value, false);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/gate/stop", topic)) {
+            rc = on_stream_gate(d, &d->stream_gate.stop, &msg->value, false);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/gate/start/utc", topic)) {
+            rc = on_stream_gate(d, &d->stream_gate.start, &msg->value, true);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stream/gate/stop/utc", topic)) {
+            rc = on_stream_gate(d, &d->stream_gate.stop, &msg->value, true);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/q/ctrl", topic)) {
+            rc = on_derived_ctrl(d, DERIVED_CHARGE, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/e/ctrl", topic)) {
+            rc = on_derived_ctrl(d, DERIVED_ENERGY, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/i/rms/ctrl", topic)) {
+            rc = on_derived_ctrl(d, DERIVED_I_RMS, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/i/rms/window", topic)) {
+            rc = on_i_rms_window(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/i/deadband", topic)) {
+            rc = on_deadband(d, PORT_ID_CURRENT, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/v/deadband", topic)) {
+            rc = on_deadband(d, PORT_ID_VOLTAGE, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/p/deadband", topic)) {
+            rc = on_deadband(d, PORT_ID_POWER, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/i/summary/ctrl", topic)) {
+            rc = on_derived_ctrl(d, DERIVED_I_SUMMARY, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/v/summary/ctrl", topic)) {
+            rc = on_derived_ctrl(d, DERIVED_V_SUMMARY, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/p/summary/ctrl", topic)) {
+            rc = on_derived_ctrl(d, DERIVED_P_SUMMARY, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/summary/fs", topic)) {
+            rc = on_summary_fs(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (jsdrv_cstr_starts_with(topic, "h/gpi/") || (0 == strcmp("h/i/range/edge/ctrl", topic))) {
+            rc = on_edge_ctrl(d, topic, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (jsdrv_cstr_starts_with(topic, "h/ds/")) {
+            rc = on_ds(d, topic, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (jsdrv_cstr_starts_with(topic, "h/stats/win/")) {
+            rc = on_stats_win(d, topic, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stats/host/scnt", topic)) {
+            rc = on_host_stats_scnt(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/stats/host/qtl", topic)) {
+            rc = on_host_stats_quantile(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
         } else if (0 == strcmp("h/filter", topic)) {
             rc = on_filter(d, &msg->value);
             send_return_code_to_frontend(d, topic, rc);
+        } else if (0 == strcmp("h/filter/arith", topic)) {
+            rc = on_filter_arith(d, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
         } else if (0 == strcmp("h/i_scale", topic)) {
             struct jsdrv_union_s value = msg->value;
             rc = jsdrv_union_as_type(&value, JSDRV_UNION_F64);
@@ -1150,6 +2251,12 @@ static bool handle_cmd(struct dev_s * d, struct jsdrvp_msg_s * msg) {
             send_return_code_to_frontend(d, topic, rc);
         } else if (0 == strcmp("h/state", topic)) {
             // ignore
+        } else if (jsdrv_cstr_starts_with(topic, "h/thread/")) {
+            rc = jsdrvp_thread_topic(topic, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
+        } else if (jsdrv_cstr_starts_with(topic, JSDRV_USBBK_MSG_CONFIG_PREFIX)) {
+            rc = jsdrvb_usb_config(d, topic, &msg->value);
+            send_return_code_to_frontend(d, topic, rc);
         } else {
             JSDRV_LOGE("topic invalid: %s", msg->topic);
             send_return_code_to_frontend(d, topic, JSDRV_ERROR_PARAMETER_INVALID);
@@ -1166,51 +2273,497 @@ static bool handle_cmd(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     return rv;
 }
 
-static void time_map_update(struct dev_s * d, uint64_t sample_id, double counter_rate, bool force) {
-    if (force || (0 == d->time_map.offset_time)) {
-        int64_t t_now = jsdrv_time_utc();
-        JSDRV_LOGI("time_map_update: now=%" PRIi64 " counter=%" PRIi64, t_now, sample_id);
-        d->time_map.offset_time = t_now;
-        d->time_map.counter_rate = counter_rate;
-        d->time_map.offset_counter = sample_id;
-    }
+static void time_map_update(struct dev_s * d, uint64_t sample_id, double counter_rate, bool force) {
+    if (force || (0 == d->time_map.offset_time)) {
+        int64_t t_now = jsdrv_time_utc();
+        JSDRV_LOGI("time_map_update: now=%" PRIi64 " counter=%" PRIi64, t_now, sample_id);
+        d->time_map.offset_time = t_now;
+        d->time_map.counter_rate = counter_rate;
+        d->time_map.offset_counter = sample_id;
+    }
+}
+
+// Track the counter rate and offset from the host clock.
+static void time_map_host_update(struct dev_s * d, uint64_t sample_id) {
+    if (d->time_map_device) {
+        return;  // the instrument time map is synchronized and more accurate
+    }
+    jsdrv_tmf_add(d->time_map_filter, sample_id, jsdrv_time_utc());
+    jsdrv_tmf_get(d->time_map_filter, &d->time_map);
+}
+
+static struct jsdrvp_msg_s * derived_msg_alloc(struct dev_s * d, uint8_t idx, uint32_t size) {
+    const struct derived_def_s * def = &DERIVED_MAP[idx];
+    if (!d->derived_topic_id[idx]) {
+        char topic[JSDRV_TOPIC_LENGTH_MAX];
+        tfp_snprintf(topic, sizeof(topic), "%s/%s", d->ll.prefix, def->data_topic);
+        d->derived_topic_id[idx] = jsdrvp_topic_intern(d->context, topic);
+    }
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(d->context, "", JSDRV_STREAM_HEADER_SIZE + size);
+    m->topic_id = d->derived_topic_id[idx];
+    if (!m->topic_id) {
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, def->data_topic);
+    }
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    m->value.size = JSDRV_STREAM_HEADER_SIZE;
+    return m;
+}
+
+static void derived_msg_send(struct dev_s * d, uint8_t idx, struct jsdrvp_msg_s * m) {
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    if (!s->element_count) {
+        jsdrvp_msg_free(d->context, m);
+        return;
+    }
+    s->field_id = DERIVED_MAP[idx].field_id;
+    s->index = DERIVED_MAP[idx].index;
+    s->host_time.dispatch = jsdrv_time_utc();
+    m->value.size = JSDRV_STREAM_HEADER_SIZE + ((s->element_count * s->element_size_bits) / 8);
+    jsdrvp_backend_send(d->context, m);
+}
+
+static void derived_integral(struct dev_s * d, uint8_t idx, struct jsdrv_derived_integral_s * integral,
+                             const struct jsdrv_stream_signal_s * src) {
+    uint32_t offset = 0;
+    while (offset < src->element_count) {
+        uint32_t length = src->element_count - offset;
+        if (length > JSDRV_DERIVED_INTEGRAL_LENGTH_MAX) {
+            length = JSDRV_DERIVED_INTEGRAL_LENGTH_MAX;
+        }
+        struct jsdrvp_msg_s * m = derived_msg_alloc(d, idx, length * sizeof(double));
+        struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+        offset += jsdrv_derived_integral(integral, src, offset, s);
+        derived_msg_send(d, idx, m);
+    }
+}
+
+static void ds_send(struct dev_s * d, struct ds_port_s * p) {
+    struct jsdrvp_msg_s * m = p->msg;
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    p->msg = NULL;
+    s->host_time.dispatch = jsdrv_time_utc();
+    m->value.size = JSDRV_STREAM_HEADER_SIZE + s->element_count * sizeof(float);
+    jsdrvp_backend_send(d->context, m);
+}
+
+static struct jsdrvp_msg_s * ds_msg(struct dev_s * d, uint8_t slot, uint8_t port_id,
+                                    const struct jsdrv_stream_signal_s * src, uint64_t sample_id) {
+    struct ds_port_s * p = ds_port(d, slot, port_id);
+    const char * data_topic = DS_DATA_TOPIC[ds_port_index(port_id)][slot];
+    if (p->msg) {
+        return p->msg;
+    }
+    if (!p->data_topic_id) {
+        char topic[JSDRV_TOPIC_LENGTH_MAX];
+        tfp_snprintf(topic, sizeof(topic), "%s/%s", d->ll.prefix, data_topic);
+        p->data_topic_id = jsdrvp_topic_intern(d->context, topic);
+    }
+    uint32_t element_count_max = jsdrv_stream_flush_element_count_max(&d->stream_flush, d->ds[slot].fs, 32);
+    if (element_count_max > DS_ELEMENT_COUNT_MAX) {
+        element_count_max = DS_ELEMENT_COUNT_MAX;
+    }
+    p->element_count_max = element_count_max;
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(d->context, "",
+            JSDRV_STREAM_HEADER_SIZE + p->element_count_max * sizeof(float));
+    m->topic_id = p->data_topic_id;
+    if (!m->topic_id) {
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, data_topic);
+    }
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    memcpy(s, src, JSDRV_STREAM_HEADER_SIZE);
+    s->sample_id = sample_id;
+    s->decimate_factor = src->decimate_factor * jsdrv_downsample_decimate_factor(p->downsample);
+    s->element_count = 0;
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    m->value.size = JSDRV_STREAM_HEADER_SIZE;
+    p->msg = m;
+    return m;
+}
+
+/**
+ * @brief Downsample an outgoing float32 stream message into each multi-rate output.
+ *
+ * @param d The device.
+ * @param port_id The source port id.
+ * @param m The source message.
+ */
+static void ds_process(struct dev_s * d, uint8_t port_id, const struct jsdrvp_msg_s * m) {
+    const struct jsdrv_stream_signal_s * src = (const struct jsdrv_stream_signal_s *) m->value.value.bin;
+    if ((src->element_type != JSDRV_DATA_TYPE_FLOAT) || !src->element_count || !src->decimate_factor) {
+        return;
+    }
+    for (uint8_t slot = 0; slot < DS_COUNT; ++slot) {
+        struct ds_port_s * p = ds_port(d, slot, port_id);
+        if ((NULL == p) || (NULL == p->downsample)) {
+            continue;
+        }
+        if (p->sample_id_next && (src->sample_id != p->sample_id_next)) {
+            if (p->msg) {
+                ds_send(d, p);  // partial message on gap
+            }
+            jsdrv_downsample_clear(p->downsample);
+        }
+        const float * x = (const float *) src->data;
+        uint64_t sample_id = src->sample_id;
+        uint64_t y_step = (uint64_t) src->decimate_factor * jsdrv_downsample_decimate_factor(p->downsample);
+        uint32_t k = 0;
+        while (k < src->element_count) {
+            float y[DS_BLOCK_SIZE];
+            uint32_t y_count = 0;
+            uint32_t n = src->element_count - k;
+            if (n > DS_BLOCK_SIZE) {
+                n = DS_BLOCK_SIZE;
+            }
+            uint32_t idx = jsdrv_downsample_add_f32_block(p->downsample, sample_id / src->decimate_factor,
+                                                          x + k, n, y, &y_count);
+            uint64_t y_sample_id = sample_id + (uint64_t) idx * src->decimate_factor;
+            for (uint32_t j = 0; j < y_count; ++j) {
+                struct jsdrvp_msg_s * m_ds = ds_msg(d, slot, port_id, src, y_sample_id + j * y_step);
+                struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m_ds->value.value.bin;
+                ((float *) s->data)[s->element_count++] = y[j];
+                if (s->element_count >= p->element_count_max) {
+                    ds_send(d, p);
+                }
+            }
+            sample_id += (uint64_t) n * src->decimate_factor;
+            k += n;
+        }
+        p->sample_id_next = sample_id;
+    }
+}
+
+static void derived_summary(struct dev_s * d, uint8_t idx, const struct jsdrv_stream_signal_s * src) {
+    if (!(d->derived_enable & (1U << (DERIVED_I_SUMMARY + idx)))) {
+        return;
+    }
+    uint32_t length = src->element_count / JSDRV_DERIVED_SUMMARY_WINDOW_MIN + 1;
+    struct jsdrvp_msg_s * m = derived_msg_alloc(d, DERIVED_I_SUMMARY + idx,
+                                                length * sizeof(struct jsdrv_summary_entry_s));
+    jsdrv_derived_summary(&d->summary[idx], src, (struct jsdrv_stream_signal_s *) m->value.value.bin);
+    derived_msg_send(d, DERIVED_I_SUMMARY + idx, m);
+}
+
+static void derived_edge(struct dev_s * d, uint8_t idx, const struct jsdrv_stream_signal_s * src) {
+    if (!(d->derived_enable & (1U << idx))) {
+        return;
+    }
+    struct jsdrv_derived_edge_s * edge = &d->edge[idx - DERIVED_GPI_0_EDGE];
+    uint32_t offset = 0;
+    while (offset < src->element_count) {
+        struct jsdrvp_msg_s * m = derived_msg_alloc(d, idx, JSDRV_DERIVED_EDGE_LENGTH_MAX * sizeof(struct jsdrv_edge_s));
+        offset += jsdrv_derived_edge(edge, src, offset, (struct jsdrv_stream_signal_s *) m->value.value.bin);
+        derived_msg_send(d, idx, m);
+    }
+}
+
+static void derived_process(struct dev_s * d, uint8_t port_id, const struct jsdrvp_msg_s * m) {
+    const struct jsdrv_stream_signal_s * src = (const struct jsdrv_stream_signal_s *) m->value.value.bin;
+    if (!d->derived_enable || !src->element_count) {
+        return;
+    }
+    if ((port_id >= PORT_ID_GPI_0) && (port_id <= PORT_ID_GPI_7)) {
+        derived_edge(d, DERIVED_GPI_0_EDGE + (port_id - PORT_ID_GPI_0), src);
+        return;
+    } else if (port_id == PORT_ID_RANGE) {
+        derived_edge(d, DERIVED_I_RANGE_EDGE, src);
+        return;
+    }
+    if (port_id == PORT_ID_CURRENT) {
+        derived_summary(d, 0, src);
+    } else if (port_id == PORT_ID_VOLTAGE) {
+        derived_summary(d, 1, src);
+    } else if (port_id == PORT_ID_POWER) {
+        derived_summary(d, 2, src);
+    }
+    if (port_id == PORT_ID_CURRENT) {
+        if (d->derived_enable & (1U << DERIVED_CHARGE)) {
+            derived_integral(d, DERIVED_CHARGE, &d->charge, src);
+        }
+        if (d->derived_enable & (1U << DERIVED_I_RMS)) {
+            // each window contains at least one source sample
+            struct jsdrvp_msg_s * m_rms = derived_msg_alloc(d, DERIVED_I_RMS, src->element_count * sizeof(float));
+            jsdrv_derived_rms(&d->i_rms, src, (struct jsdrv_stream_signal_s *) m_rms->value.value.bin);
+            derived_msg_send(d, DERIVED_I_RMS, m_rms);
+        }
+    } else if (port_id == PORT_ID_POWER) {
+        if (d->derived_enable & (1U << DERIVED_ENERGY)) {
+            derived_integral(d, DERIVED_ENERGY, &d->energy, src);
+        }
+    }
+}
+
+static void stream_in_port_send(struct dev_s * d, struct port_s * port) {
+    struct jsdrvp_msg_s * m = port->msg_in;
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    port->msg_in = NULL;
+    uint8_t port_id = (uint8_t) ((port - d->ports) + 16);
+    derived_process(d, port_id, m);
+    if (((port_id >= PORT_ID_GPI_0) && (port_id <= PORT_ID_GPI_7)
+            && (d->derived_only & (1U << (DERIVED_GPI_0_EDGE + (port_id - PORT_ID_GPI_0)))))
+            || ((port_id == PORT_ID_RANGE) && (d->derived_only & (1U << DERIVED_I_RANGE_EDGE)))) {
+        jsdrvp_msg_free(d->context, m);  // edges only
+        return;
+    }
+    ds_process(d, port_id, m);
+    if (d->stream_auto && !(d->stream_present & (1U << (port_id & 0x0f)))) {
+        jsdrvp_msg_free(d->context, m);  // used only on the host, no subscribers
+        return;
+    }
+    if (d->stream_gate.start || d->stream_gate.stop) {
+        if (!jsdrv_stream_gate_apply(&d->stream_gate, s)) {
+            jsdrvp_msg_free(d->context, m);  // outside the delivery window
+            return;
+        }
+        m->value.size = JSDRV_STREAM_HEADER_SIZE + (s->element_count * s->element_size_bits + 7) / 8;
+    }
+    if (port->deadband.tolerance > 0.0f) {
+        uint32_t flags = jsdrv_deadband_process(&port->deadband, s);
+        if (flags & JSDRV_DEADBAND_EMIT) {
+            deadband_send(d, port);
+        }
+        if (flags & JSDRV_DEADBAND_ABSORB) {
+            jsdrvp_msg_free(d->context, m);  // within the band, covered by the hold
+            return;
+        }
+    }
+    s->host_time.dispatch = jsdrv_time_utc();
+    if (port->msg_in_time) {
+        jsdrv_latency_hist_add(&d->latency, s->host_time.dispatch - port->msg_in_time);
+    }
+    jsdrvp_backend_send(d->context, m);
+    jsdrv_stream_flush_update(&d->stream_flush, jsdrvp_backend_queue_depth(d->context));
+}
+
+static void latency_publish(struct dev_s * d) {
+    char buf[256];
+    uint32_t t_now = jsdrv_time_ms_u32();
+    if ((t_now - d->latency_time_ms) < LATENCY_INTERVAL_MS) {
+        return;
+    }
+    d->latency_time_ms = t_now;
+    if (jsdrv_latency_hist_json(&d->latency, buf, sizeof(buf))) {
+        send_to_frontend(d, "h/stream/latency", &jsdrv_union_json(buf));
+    }
+}
+
+static void health_publish(struct dev_s * d) {
+    char buf[4096];
+    uint32_t t_now = jsdrv_time_ms_u32();
+    if (((t_now - d->health_time_ms) < HEALTH_INTERVAL_MS) || (d->health.frames == d->health_frames)) {
+        return;
+    }
+    d->health_time_ms = t_now;
+    d->health_frames = d->health.frames;
+    if (jsdrv_stream_health_json(&d->health, buf, sizeof(buf))) {
+        send_to_frontend(d, "h/stream/health", &jsdrv_union_json(buf));
+    }
+}
+
+static uint32_t stream_in_port_downsample_factor(struct port_s * port) {
+    // downsample_factor is the total rate reduction which combines:
+    // - instrument decimation (port->decimate_factor)
+    // - host-side downsampling including anti-alias filtering.
+    return port->decimate_factor * jsdrv_downsample_decimate_factor(port->downsample);
+}
+
+static uint32_t stream_in_port_element_count_max(struct dev_s * d, struct port_s * port) {
+    struct field_def_s * field_def = &PORT_MAP[port - d->ports];
+    uint32_t count = jsdrv_stream_flush_element_count_max(&d->stream_flush,
+            SAMPLING_FREQUENCY / stream_in_port_downsample_factor(port), field_def->element_size_bits);
+    uint32_t count_max = ((JSDRV_STREAM_DATA_SIZE - JS220_USB_FRAME_LENGTH) * 8U) / field_def->element_size_bits;
+    return (count > count_max) ? count_max : count;
 }
 
-static void handle_stream_in_port(struct dev_s * d, uint8_t port_id, uint32_t * p_u32, uint16_t size) {
+/**
+ * @brief Get the port's outgoing message with space for size more payload bytes.
+ *
+ * @param d The device.
+ * @param port_id The port id.
+ * @param size The payload size in bytes to append.
+ * @return The message, which is allocated and starts at
+ *      port->sample_id_next when needed.
+ */
+static struct jsdrvp_msg_s * stream_in_port_msg(struct dev_s * d, uint8_t port_id, uint32_t size) {
     struct field_def_s * field_def = &PORT_MAP[port_id & 0x0f];
     struct port_s * port = &d->ports[port_id & 0x0f];
-    struct jsdrv_stream_signal_s * s = NULL;
     struct jsdrvp_msg_s * m = port->msg_in;
-    if (!field_def->data_topic || !field_def->data_topic[0]) {
-        return;
+
+    if (m && ((m->value.size + size) >= m->payload_size)) {
+        // should never happen (see jsdrvp_backend_send towards end), but just in case
+        JSDRV_LOGD1("stream_in_port: port_id=%d send complete message", (int) port_id);
+        stream_in_port_send(d, port);
+        m = NULL;
+    }
+    if (m) {
+        return m;
     }
 
-    if (0 == field_def->element_size_bits) {
-        JSDRV_LOGW("stream_in_port %d element_size_bits is 0", port_id);
-        return;
+    uint32_t element_count_max = stream_in_port_element_count_max(d, port);
+    uint32_t sz = JSDRV_STREAM_HEADER_SIZE + JS220_USB_FRAME_LENGTH
+            + (element_count_max * field_def->element_size_bits + 7) / 8;
+    if (!port->data_topic_id) {
+        char topic[JSDRV_TOPIC_LENGTH_MAX];
+        tfp_snprintf(topic, sizeof(topic), "%s/%s", d->ll.prefix, field_def->data_topic);
+        port->data_topic_id = jsdrvp_topic_intern(d->context, topic);
     }
-    if (0 == port->decimate_factor) {
-        JSDRV_LOGW("stream_in_port %d port->decimate_factor is 0", port_id);
-        return;
+    m = jsdrvp_msg_alloc_data_sz(d->context, "", sz);
+    m->topic_id = port->data_topic_id;
+    if (!m->topic_id) {
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, field_def->data_topic);
+    }
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    s->sample_id = port->sample_id_next;
+    s->sample_rate = SAMPLING_FREQUENCY;
+    s->decimate_factor = stream_in_port_downsample_factor(port);
+    s->index = field_def->index;
+    s->field_id = field_def->field_id;
+    s->element_type = field_def->element_type;
+    s->element_size_bits = field_def->element_size_bits;
+    s->element_count = 0;
+    time_map_update(d, port->sample_id_next, (double) s->sample_rate, false);
+    time_map_host_update(d, port->sample_id_next);
+    s->time_map = d->time_map;
+    s->host_time.usb = d->stream_time;
+    s->host_time.dispatch = 0;
+    s->host_time.publish = 0;
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    m->value.size = JSDRV_STREAM_HEADER_SIZE;
+    port->msg_in = m;
+    port->msg_in_time = d->stream_time;
+    return m;
+}
+
+/**
+ * @brief Switch a port to its new sampling frequency at the aligned boundary.
+ *
+ * @param d The device.
+ * @param port_id The port id with a pending switch.
+ * @param sample_id The boundary sample_id for the port's next sample.
+ * @param size The minimum payload size for the new message.
+ * @return The port's new message.
+ *
+ * Send the message at the old rate, publish the single h/fs/!switch
+ * marker for the first port, and then swap in the pre-built downsampler.
+ */
+static struct jsdrvp_msg_s * fs_switch_port(struct dev_s * d, uint8_t port_id, uint64_t sample_id, uint32_t size) {
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    uint64_t sample_id_next = port->sample_id_next;
+    if (NULL != port->msg_in) {
+        struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) port->msg_in->value.value.bin;
+        if (s->element_count) {
+            stream_in_port_send(d, port);
+        } else {
+            jsdrvp_msg_free(d->context, port->msg_in);
+            port->msg_in = NULL;
+        }
+    }
+    if (d->fs_switch_marker) {
+        char buf[96];
+        d->fs_switch_marker = false;
+        tfp_snprintf(buf, sizeof(buf), "{\"sample_id\": %" PRIu64 ", \"fs\": %" PRIu32 "}",
+                     d->fs_switch_sample_id, d->fs);
+        send_to_frontend(d, "h/fs/!switch", &jsdrv_union_json(buf));
+    }
+    fs_switch_apply(d, port_id);
+    port->sample_id_next = sample_id;  // for the new message time map
+    struct jsdrvp_msg_s * m = stream_in_port_msg(d, port_id, size);
+    port->sample_id_next = sample_id_next;
+    return m;
+}
+
+/**
+ * @brief Downsample samples into a port's message.
+ *
+ * @param d The device.
+ * @param port_id The port id.
+ * @param m The port's message.
+ * @param x The samples starting at port->sample_id_next.
+ * @param sample_count The number of samples in x.
+ * @return The port's message, which changes at a sampling frequency switch.
+ *
+ * A pending switch runs the new downsampler in parallel to fill its
+ * filter history, then switches at fs_switch_sample_id.
+ */
+static struct jsdrvp_msg_s * stream_in_port_downsample(struct dev_s * d, uint8_t port_id, struct jsdrvp_msg_s * m,
+        const float * x, uint32_t sample_count) {
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    float * y = (float *) &m->value.value.bin[m->value.size];
+    uint64_t sample_id_u64 = port->sample_id_next;
+    if (!port->downsample_pending) {
+        uint32_t y_count = 0;
+        uint32_t idx = jsdrv_downsample_add_f32_block(port->downsample, sample_id_u64 / port->decimate_factor,
+                                                      x, sample_count, y, &y_count);
+        if (y_count) {
+            if (s->element_count == 0) {
+                s->sample_id = sample_id_u64 + (uint64_t) idx * port->decimate_factor;
+            }
+            s->element_count += y_count;
+            m->value.size += y_count * sizeof(float);
+        }
+        return m;
+    }
+    for (uint32_t idx = 0; idx < sample_count; ++idx) {
+        if (port->downsample_pending) {
+            if (sample_id_u64 >= d->fs_switch_sample_id) {
+                m = fs_switch_port(d, port_id, sample_id_u64, (sample_count - idx) * sizeof(float));
+                s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+                y = (float *) &m->value.value.bin[m->value.size];
+            } else if (NULL != port->downsample_next) {
+                float discard;
+                jsdrv_downsample_add_f32(port->downsample_next, sample_id_u64 / port->decimate_factor, x[idx], &discard);
+            }
+        }
+        if (jsdrv_downsample_add_f32(port->downsample, sample_id_u64 / port->decimate_factor, x[idx], y)) {
+            ++y;
+            if (s->element_count == 0) {
+                s->sample_id = sample_id_u64;
+            }
+            ++s->element_count;
+            m->value.size += sizeof(float);
+        }
+        sample_id_u64 += port->decimate_factor;
     }
+    return m;
+}
 
-    // sample_count is number of _decimated_ samples in message (port->decimate_factor)
-    size -= sizeof(uint32_t);
-    uint32_t sample_count = (size << 3) / field_def->element_size_bits;
-    if (sample_count == 0) {
-        JSDRV_LOGI("stream_in_port %d empty message", port_id);
+static void stream_in_port_send_check(struct dev_s * d, uint8_t port_id) {
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    struct jsdrvp_msg_s * m = port->msg_in;
+    if (NULL == m) {
         return;
     }
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+    uint64_t sample_id_delta = port->sample_id_next - s->sample_id;
+    if ((((s->element_count * s->element_size_bits) / 8) >= STREAM_PAYLOAD_FULL(m))
+            || (s->element_count >= stream_in_port_element_count_max(d, port))
+            || jsdrv_stream_gate_flush(&d->stream_gate, s)) {
+        JSDRV_LOGD3("stream_in_port: port_id=%d, sampled_id=%" PRIu32 ", sample_id_delta=%" PRIu32 ", size=%" PRIu32,
+                    (int) port_id, s->sample_id, sample_id_delta, m->value.size);
+        stream_in_port_send(d, port);
+    }
+}
 
-    // downsample_factor is the total rate reduction which combines:
-    // - instrument decimation (port->decimate_factor)
-    // - host-side downsampling including anti-alias filtering.
-    uint32_t downsample_factor = port->decimate_factor * jsdrv_downsample_decimate_factor(port->downsample);
+/**
+ * @brief Reconcile a stream frame's sample_id with port->sample_id_next.
+ *
+ * @param d The device.
+ * @param port_id The port id.
+ * @param sample_id_u32 The frame's 32-bit sample_id.
+ * @param[inout] p_u32 The frame samples, advanced past duplicates.
+ * @param[inout] size The frame sample size in bytes, reduced by duplicates.
+ * @param[inout] sample_count The frame sample count, reduced by duplicates.
+ * @return true to process the remaining samples at port->sample_id_next,
+ *      false to drop the frame.
+ */
+static bool stream_in_port_sync(struct dev_s * d, uint8_t port_id, uint32_t sample_id_u32,
+                                uint32_t ** p_u32, uint16_t * size, uint32_t * sample_count) {
+    struct field_def_s * field_def = &PORT_MAP[port_id & 0x0f];
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    struct jsdrv_stream_health_port_s * health = &d->health.port[port_id & 0x0f];
 
-    // header is u32 sample_id, consume and skip to payload
     // sample_id is always for 2 Msps, regardless of this port's sample rate
     // Use 32-bit sample_id (not unwrapped 64-bit) to determine skips & duplicates
-    uint32_t sample_id_u32 = *p_u32++;
     uint32_t sample_id_expect_u32 = (uint32_t) (port->sample_id_next & 0xffffffffLLU);
     uint32_t skip = sample_id_u32 - sample_id_expect_u32;
     uint32_t dup = sample_id_expect_u32 - sample_id_u32;
@@ -1222,7 +2775,8 @@ static void handle_stream_in_port(struct dev_s * d, uint8_t port_id, uint32_t *
                     port_id, sample_id_u32, d->time_map.offset_counter);
         resync = true;
     } else if ((skip >= quarter_range_u32) && (dup >= quarter_range_u32)) {
-        JSDRV_LOGW("stream_in_port %d lost sync", port_id);
+        JSDRV_LOGW_RATE("stream_in_port %d lost sync", port_id);
+        ++health->resyncs;
         resync = true;
     } else if (skip >= quarter_range_u32) {
         skip = 0;  // is duplicate
@@ -1233,7 +2787,8 @@ static void handle_stream_in_port(struct dev_s * d, uint8_t port_id, uint32_t *
     if (resync) {
         if (d->time_map.offset_time <= 0) {
             JSDRV_LOGD1("stream_in_port %d timemap not yet available, drop", port_id);
-            return;
+            ++health->drops;
+            return false;
         }
         // caution: assumes d->time_map.offset_counter was updated in last 8.9 minutes.
         uint32_t lower = (uint32_t) (d->time_map.offset_counter & 0xffffffffLLU);
@@ -1244,8 +2799,9 @@ static void handle_stream_in_port(struct dev_s * d, uint8_t port_id, uint32_t *
         } else if (bwd < quarter_range_u32) {
             port->sample_id_next = d->time_map.offset_counter - bwd;
         } else {
-            JSDRV_LOGW("stream_in_port %d sync failed, drop", port_id);
-            return;
+            JSDRV_LOGW_RATE("stream_in_port %d sync failed, drop", port_id);
+            ++health->drops;
+            return false;
         }
         skip = 0;
         dup = 0;
@@ -1253,132 +2809,456 @@ static void handle_stream_in_port(struct dev_s * d, uint8_t port_id, uint32_t *
 
     if ((dup == 0) && (skip == 0)) {
         // normal operation, ready to process sample_id_next.
-    } else if ((sample_count * port->decimate_factor) < dup) {
-        JSDRV_LOGI("stream_in_port %d dup %" PRIu32 " : received=0x%" PRIx32 " expected=0x%" PRIx32,
-                   port_id, dup, sample_id_u32, sample_id_expect_u32);
-        return;  // no new data present, still awaiting sample_id_next.
+    } else if ((*sample_count * port->decimate_factor) < dup) {
+        JSDRV_LOGD1_RATE("stream_in_port %d dup %" PRIu32 " : received=0x%" PRIx32 " expected=0x%" PRIx32,
+                         port_id, dup, sample_id_u32, sample_id_expect_u32);
+        ++health->dups;
+        health->dup_samples += dup;
+        ++health->drops;
+        return false;  // no new data present, still awaiting sample_id_next.
     } else if (dup) {
-        JSDRV_LOGI("stream_in_port %d overlap %" PRIu32 " : received=0x%" PRIx32 " expected=0x%" PRIx32,
-                   port_id, dup, sample_id_u32, sample_id_expect_u32);
+        JSDRV_LOGD1_RATE("stream_in_port %d overlap %" PRIu32 " : received=0x%" PRIx32 " expected=0x%" PRIx32,
+                         port_id, dup, sample_id_u32, sample_id_expect_u32);
+        ++health->dups;
+        health->dup_samples += dup;
         uint32_t overlap = dup / port->decimate_factor;
         uint16_t overlap_size = (uint16_t) ((overlap * field_def->element_size_bits) / 8);
         if (overlap_size < port->decimate_factor) {
             port->sample_id_next -= dup;
         }
-        size -= overlap_size;
-        sample_count -= overlap;
-        p_u32 += overlap_size / sizeof(uint32_t);
+        *size -= overlap_size;
+        *sample_count -= overlap;
+        *p_u32 += overlap_size / sizeof(uint32_t);
         // ready to process starting from sample_id_next.
     } else if (skip) {
-        JSDRV_LOGI("stream_in_port %d skip %" PRIu32 " : received=0x%" PRIx32 " expected=0x%" PRIx32,
-                   port_id, skip, sample_id_u32, sample_id_expect_u32);
-        if (m) {
+        JSDRV_LOGD1_RATE("stream_in_port %d skip %" PRIu32 " : received=0x%" PRIx32 " expected=0x%" PRIx32,
+                         port_id, skip, sample_id_u32, sample_id_expect_u32);
+        ++health->skips;
+        health->skip_samples += skip;
+        if (port->msg_in) {
             JSDRV_LOGD1("stream_in_port: port_id=%d send partial message", (int) port_id);
-            port->msg_in = NULL;
-            jsdrvp_backend_send(d->context, m);
-            m = NULL;
-            s = NULL;
+            stream_in_port_send(d, port);
         }
         // sample_id_next not available, update based upon skip
         port->sample_id_next += skip;
     }
+    return true;
+}
 
-    float scale = 1.0;
-    switch (port_id) {
-        case PORT_ID_CURRENT: scale = d->i_scale; break;
-        case PORT_ID_VOLTAGE: scale = d->v_scale; break;
-        default: break;
+/**
+ * @brief Add contiguous stream blocks starting at port->sample_id_next.
+ *
+ * @param d The device.
+ * @param port_id The port id.
+ * @param blocks The blocks with consecutive sample_ids.
+ * @param count The number of blocks.
+ * @param is_scale Scale float32 samples by the port's i_scale or v_scale.
+ * @param power_side The jsdrv_power_f32_s side to stage, or UINT8_MAX for none.
+ * @param is_downsample Downsample float32 samples on the host.
+ *
+ * Each stream_in_blocks_*() handler expands this body with constant
+ * options, so the compiler removes the unused branches and vectorizes
+ * each variant.  Make the message flush decision once per outgoing
+ * message rather than once per frame.
+ */
+static inline void stream_in_blocks_impl(struct dev_s * d, uint8_t port_id,
+                                         const struct stream_block_s * blocks, uint32_t count,
+                                         const bool is_scale, const uint8_t power_side, const bool is_downsample) {
+    struct field_def_s * field_def = &PORT_MAP[port_id & 0x0f];
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    uint32_t element_count_max = stream_in_port_element_count_max(d, port);
+    float scale = 1.0f;
+    if (is_scale) {
+        scale = (port_id == PORT_ID_CURRENT) ? d->i_scale : d->v_scale;
+        if (scale == 0.0f) {
+            scale = 1.0f;
+        }
     }
 
-    // apply scale
-    if ((scale != 1.0) && (scale != 0.0)) {
-        float * samples_f32 = (float *) p_u32;
-        for (size_t i = 0; i < sample_count; ++i) {
-            *samples_f32++ *= scale;
+    while (count) {
+        struct jsdrvp_msg_s * m = stream_in_port_msg(d, port_id, blocks[0].size);
+        struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s * ) m->value.value.bin;
+        uint32_t limit = (uint32_t) ((STREAM_PAYLOAD_FULL(m) * 8U) / field_def->element_size_bits);
+        if (limit > element_count_max) {
+            limit = element_count_max;
+        }
+
+        // take blocks until the message is full, which the frame slack accommodates
+        uint32_t n = 0;
+        uint32_t sample_count = 0;
+        while (n < count) {
+            if ((power_side != UINT8_MAX) && ((sample_count + blocks[n].sample_count) > JSDRV_POWER_F32_LENGTH)) {
+                break;
+            }
+            sample_count += blocks[n].sample_count;
+            ++n;
+            if ((s->element_count + sample_count) >= limit) {
+                break;
+            }
+        }
+
+        float * power_p = NULL;
+        if (power_side != UINT8_MAX) {
+            power_p = jsdrv_power_f32_reserve(&d->power, power_side, port->sample_id_next, sample_count);
+        }
+
+        // Single pass over the frame samples: scale, stage for power, and copy.
+        // Host downsampling scales and stages in place, then downsamples.
+        uint8_t * p = (uint8_t *) &m->value.value.bin[m->value.size];
+        for (uint32_t k = 0; k < n; ++k) {
+            const struct stream_block_s * b = &blocks[k];
+            float * x = (float *) b->data;
+            if (is_downsample) {
+                if (NULL != power_p) {
+                    jsdrv_f32_scale_copy2(x, power_p, x, scale, b->sample_count);
+                } else if (is_scale) {
+                    jsdrv_f32_scale(x, scale, b->sample_count);
+                }
+                m = stream_in_port_downsample(d, port_id, m, x, b->sample_count);
+                port->sample_id_next += b->sample_count * port->decimate_factor;
+            } else {
+                JSDRV_ASSERT((m->value.size + b->size) <= m->payload_size);
+                if (NULL != power_p) {
+                    jsdrv_f32_scale_copy2((float *) p, power_p, x, scale, b->sample_count);
+                } else if (is_scale) {
+                    jsdrv_f32_scale_copy((float *) p, x, scale, b->sample_count);
+                } else {
+                    memcpy(p, b->data, b->size);
+                }
+                p += b->size;
+                m->value.size += b->size;
+                s->element_count += b->sample_count;
+            }
+            if (NULL != power_p) {
+                power_p += b->sample_count;
+            }
+        }
+        if (power_side != UINT8_MAX) {
+            jsdrv_power_f32_commit(&d->power, power_side, sample_count);
         }
+        if (!is_downsample) {
+            port->sample_id_next += sample_count * port->decimate_factor;
+        }
+        stream_in_port_send_check(d, port_id);
+        blocks += n;
+        count -= n;
     }
+}
 
-    sbuf_f32_add(port->buf, port->sample_id_next, (float *) p_u32, sample_count);
+// Integer samples and float32 samples without scale: u4 range, u1 GPI, u8 UART, i16 ADC, f32 power
+static void stream_in_blocks_raw(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, false, UINT8_MAX, false);
+}
 
-    if (m && ((m->value.size + size) >= sizeof(struct jsdrv_stream_signal_s))) {
-        // should never happen (see jsdrvp_backend_send towards end), but just in case
-        JSDRV_LOGD1("stream_in_port: port_id=%d send complete message", (int) port_id);
-        port->msg_in = NULL;
-        jsdrvp_backend_send(d->context, m);
-        m = NULL;
-        s = NULL;
+// f32 current or voltage
+static void stream_in_blocks_f32_scale(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, true, UINT8_MAX, false);
+}
+
+// f32 current staged for host-side power
+static void stream_in_blocks_f32_i_power(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, true, JSDRV_POWER_F32_CURRENT, false);
+}
+
+// f32 voltage staged for host-side power
+static void stream_in_blocks_f32_v_power(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, true, JSDRV_POWER_F32_VOLTAGE, false);
+}
+
+/**
+ * @brief Stage f32 current or voltage for host-side power only.
+ *
+ * @param d The device.
+ * @param port_id The current or voltage port id.
+ * @param blocks The blocks with consecutive sample_ids.
+ * @param count The number of blocks.
+ *
+ * Used with h/stream/auto when host-side power needs the port but nothing
+ * uses the port's own messages, so skip building them.
+ */
+static void stream_in_blocks_f32_power_only(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    uint8_t power_side = (port_id == PORT_ID_CURRENT) ? JSDRV_POWER_F32_CURRENT : JSDRV_POWER_F32_VOLTAGE;
+    float scale = (port_id == PORT_ID_CURRENT) ? d->i_scale : d->v_scale;
+    if (scale == 0.0f) {
+        scale = 1.0f;
+    }
+    while (count) {
+        uint32_t n = 0;
+        uint32_t sample_count = 0;
+        while ((n < count) && ((sample_count + blocks[n].sample_count) <= JSDRV_POWER_F32_LENGTH)) {
+            sample_count += blocks[n].sample_count;
+            ++n;
+        }
+        if (0 == n) {
+            break;  // frames never exceed the power buffer
+        }
+        float * power_p = jsdrv_power_f32_reserve(&d->power, power_side, port->sample_id_next, sample_count);
+        for (uint32_t k = 0; k < n; ++k) {
+            jsdrv_f32_scale_copy(power_p, (const float *) blocks[k].data, scale, blocks[k].sample_count);
+            power_p += blocks[k].sample_count;
+        }
+        jsdrv_power_f32_commit(&d->power, power_side, sample_count);
+        port->sample_id_next += sample_count * port->decimate_factor;
+        blocks += n;
+        count -= n;
     }
+}
 
-    if (m) {
-        s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
-    } else {
-        m = jsdrvp_msg_alloc_data(d->context, "");
-        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, field_def->data_topic);
-        s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
-        s->sample_id = port->sample_id_next;
-        s->sample_rate = SAMPLING_FREQUENCY;
-        s->decimate_factor = downsample_factor;
-        s->index = field_def->index;
-        s->field_id = field_def->field_id;
-        s->element_type = field_def->element_type;
-        s->element_size_bits = field_def->element_size_bits;
-        s->element_count = 0;
-        time_map_update(d, port->sample_id_next, (double) s->sample_rate, false);
-        s->time_map = d->time_map;
-        m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
-        m->value.size = JSDRV_STREAM_HEADER_SIZE;
-        port->msg_in = m;
-    }
-
-    // Add decompression here as needed - compression not yet implemented on sensor
-
-    uint8_t * p = (uint8_t *) &m->value.value.bin[m->value.size];
-    JSDRV_ASSERT((m->value.size + size) <= sizeof(struct jsdrv_stream_signal_s));
-
-    if ((port->downsample != NULL) && (s->element_type == JSDRV_DATA_TYPE_FLOAT)) {
-        float * x = (float *) p_u32;
-        float * y = (float *) p;
-        uint64_t sample_id_u64 = port->sample_id_next;
-        for (uint32_t idx = 0; idx < sample_count; ++idx) {
-            if (jsdrv_downsample_add_f32(port->downsample, sample_id_u64 / port->decimate_factor, x[idx], y)) {
-                ++y;
-                if (s->element_count == 0) {
-                    s->sample_id = sample_id_u64;
-                }
-                ++s->element_count;
-                m->value.size += sizeof(float);
+// f32 power with host-side downsampling
+static void stream_in_blocks_f32_downsample(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, false, UINT8_MAX, true);
+}
+
+// f32 current or voltage with host-side downsampling
+static void stream_in_blocks_f32_scale_downsample(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, true, UINT8_MAX, true);
+}
+
+// f32 current with host-side downsampling, staged for host-side power
+static void stream_in_blocks_f32_i_power_downsample(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, true, JSDRV_POWER_F32_CURRENT, true);
+}
+
+// f32 voltage with host-side downsampling, staged for host-side power
+static void stream_in_blocks_f32_v_power_downsample(struct dev_s * d, uint8_t port_id, const struct stream_block_s * blocks, uint32_t count) {
+    stream_in_blocks_impl(d, port_id, blocks, count, true, JSDRV_POWER_F32_VOLTAGE, true);
+}
+
+/**
+ * @brief Select each port's stream_in_blocks_*() handler.
+ *
+ * @param d The device.
+ *
+ * Call whenever the port enables, decimation, or host-side downsampling
+ * change, so that the stream input path does not need to check the
+ * port configuration for each frame.
+ */
+static void stream_in_handlers_select(struct dev_s * d) {
+    bool is_power = is_ivp_enabled(d) && !is_on_instrument_downsample_active(d);
+    for (uint32_t idx = 0; idx < PORTS_LENGTH; ++idx) {
+        struct field_def_s * field_def = &PORT_MAP[idx];
+        struct port_s * port = &d->ports[idx];
+        uint8_t port_id = (uint8_t) (idx + 16);
+        bool is_iv = (port_id == PORT_ID_CURRENT) || (port_id == PORT_ID_VOLTAGE);
+        bool is_i = (port_id == PORT_ID_CURRENT);
+        bool is_downsample = (NULL != port->downsample) || port->downsample_pending;
+        stream_in_blocks_fn fn;
+        if (!field_def->data_topic || !field_def->data_topic[0]
+                || (0 == field_def->element_size_bits) || (0 == port->decimate_factor)) {
+            fn = NULL;  // discard
+        } else if (field_def->element_type != JSDRV_DATA_TYPE_FLOAT) {
+            fn = stream_in_blocks_raw;
+        } else if (is_iv && is_power) {
+            if (!stream_is_consumed(d, port_id)) {
+                fn = stream_in_blocks_f32_power_only;
+            } else if (is_downsample) {
+                fn = is_i ? stream_in_blocks_f32_i_power_downsample : stream_in_blocks_f32_v_power_downsample;
+            } else {
+                fn = is_i ? stream_in_blocks_f32_i_power : stream_in_blocks_f32_v_power;
             }
-            sample_id_u64 += port->decimate_factor;
+        } else if (is_iv) {
+            fn = is_downsample ? stream_in_blocks_f32_scale_downsample : stream_in_blocks_f32_scale;
+        } else {
+            fn = is_downsample ? stream_in_blocks_f32_downsample : stream_in_blocks_raw;
+        }
+        port->blocks_fn = fn;
+    }
+    if (is_power) {
+        uint32_t decimate_factor = d->ports[PORT_ID_CURRENT & 0x0f].decimate_factor;
+        if (d->power.sample_id_decimate != decimate_factor) {
+            power_clear(d, decimate_factor);
         }
-    } else {
-        m->value.size += size;
-        memcpy(p, p_u32, size);
-        s->element_count += sample_count;
     }
-    port->sample_id_next += sample_count * port->decimate_factor;
+}
 
-    // determine if need to send
-    uint64_t sample_id_delta = port->sample_id_next - s->sample_id;
-    uint32_t element_count_max = SAMPLING_FREQUENCY / (20 * downsample_factor);
-    if (element_count_max < 1) {
-        element_count_max = 1;
+/**
+ * @brief Process all frames for one stream port within a batch.
+ *
+ * @param d The device.
+ * @param frames The classified frames.
+ * @param idx The index of the port's first frame in frames.  The remaining
+ *      frames for this port follow the frames[].next chain.
+ *
+ * Frames with consecutive sample_ids form a run which is reconciled once
+ * and then processed by the port's stream_in_blocks_*() handler.
+ */
+static void handle_stream_in_port_run(struct dev_s * d, struct stream_frame_s * frames, uint8_t idx) {
+    uint8_t port_id = frames[idx].port_id;
+    struct field_def_s * field_def = &PORT_MAP[port_id & 0x0f];
+    struct port_s * port = &d->ports[port_id & 0x0f];
+    struct stream_block_s blocks[STREAM_IN_BATCH_FRAMES];
+    struct jsdrv_stream_health_port_s * health = &d->health.port[port_id & 0x0f];
+    stream_in_blocks_fn blocks_fn = port->blocks_fn;
+    if (NULL == blocks_fn) {
+        return;
     }
-    if ((((s->element_count * s->element_size_bits) / 8) >= STREAM_PAYLOAD_FULL)
-            || (s->element_count >= element_count_max)) {
-        JSDRV_LOGD3("stream_in_port: port_id=%d, sampled_id=%" PRIu32 ", sample_id_delta=%" PRIu32 ", size=%" PRIu32,
-                    (int) port_id, s->sample_id, sample_id_delta, m->value.size);
-        port->msg_in = NULL;
-        jsdrvp_backend_send(d->context, m);
+
+    uint32_t count = 0;
+    uint64_t sample_id_next = 0;
+    while (idx != STREAM_FRAME_NONE) {
+        struct stream_frame_s * f = &frames[idx];
+        idx = f->next;
+        // header is u32 sample_id, consume and skip to payload
+        // sample_count is number of _decimated_ samples in message (port->decimate_factor)
+        uint32_t * p_u32 = f->p_u32 + 1;
+        uint16_t size = (f->length > sizeof(uint32_t)) ? (uint16_t) (f->length - sizeof(uint32_t)) : 0;
+        uint32_t sample_count = (size << 3) / field_def->element_size_bits;
+        ++health->frames;
+        health->samples += sample_count;
+        if (sample_count == 0) {
+            JSDRV_LOGI("stream_in_port %d empty message", port_id);
+            continue;
+        }
+        uint32_t sample_id_u32 = *p_u32++;
+        if (count && (sample_id_u32 != (uint32_t) (sample_id_next & 0xffffffffLLU))) {
+            blocks_fn(d, port_id, blocks, count);  // end of run
+            count = 0;
+        }
+        if ((0 == count) && !stream_in_port_sync(d, port_id, sample_id_u32, &p_u32, &size, &sample_count)) {
+            continue;
+        }
+        if (0 == count) {
+            sample_id_next = port->sample_id_next;
+        }
+        blocks[count].data = p_u32;
+        blocks[count].size = size;
+        blocks[count].sample_count = (uint16_t) sample_count;
+        ++count;
+        sample_id_next += sample_count * port->decimate_factor;
+    }
+    if (count) {
+        blocks_fn(d, port_id, blocks, count);
+    }
+}
+
+/**
+ * @brief Compute the host-side statistics.
+ *
+ * @param d The device.
+ * @param sample_id The sample_id for the first sample.
+ * @param i The current samples.
+ * @param v The voltage samples.
+ * @param p The power samples.
+ * @param n The number of samples in i, v, and p.
+ */
+static void host_quantile_send(struct dev_s * d, const struct jsdrv_statistics_s * s) {
+    static const double q[JSDRV_QUANTILES_COUNT] = {0.5, 0.9, 0.99, 0.999};
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
+    tfp_snprintf(m->topic, sizeof(m->topic), "%s/s/stats/host/qtl", d->ll.prefix);
+    struct jsdrv_quantiles_s * dst = (struct jsdrv_quantiles_s *) m->payload.bin;
+    memset(dst, 0, sizeof(*dst));
+    dst->block_sample_id = s->block_sample_id;
+    dst->block_sample_count = s->block_sample_count;
+    dst->sample_freq = s->sample_freq;
+    dst->decimate_factor = s->decimate_factor;
+    for (uint32_t idx = 0; idx < JSDRV_QUANTILES_COUNT; ++idx) {
+        dst->i[idx] = jsdrv_quantile_value(&d->host_quantile[0], q[idx]);
+        dst->v[idx] = jsdrv_quantile_value(&d->host_quantile[1], q[idx]);
+        dst->p[idx] = jsdrv_quantile_value(&d->host_quantile[2], q[idx]);
+    }
+    dst->time_map = d->time_map;
+    m->value = jsdrv_union_cbin_r((uint8_t *) dst, sizeof(*dst));
+    m->value.app = JSDRV_PAYLOAD_TYPE_QUANTILES;
+    jsdrvp_backend_send(d->context, m);
+    for (uint32_t idx = 0; idx < 3; ++idx) {
+        jsdrv_quantile_clear(&d->host_quantile[idx]);
+    }
+}
+
+static void host_stats_add(struct dev_s * d, uint64_t sample_id, const float * i, const float * v, const float * p, uint32_t n) {
+    struct js110_stats_s * hs = &d->host_stats;
+    struct jsdrv_statistics_s * stats = &hs->statistics;
+    if (d->host_stats_sync) {
+        stats->accum_sample_id = sample_id;
+        stats->block_sample_id = sample_id;
+        d->host_stats_sync = false;
+    }
+    uint32_t k = 0;
+    while (k < n) {
+        struct jsdrv_statistics_s * s = NULL;
+        uint32_t k_next = k + js110_stats_compute_block(hs, i + k, v + k, p + k, n - k, &s);
+        if (d->host_quantile) {
+            jsdrv_quantile_add_f32(&d->host_quantile[0], i + k, k_next - k);
+            jsdrv_quantile_add_f32(&d->host_quantile[1], v + k, k_next - k);
+            jsdrv_quantile_add_f32(&d->host_quantile[2], p + k, k_next - k);
+        }
+        k = k_next;
+        if (NULL != s) {
+            if (d->host_quantile) {
+                host_quantile_send(d, s);
+            }
+            struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
+            tfp_snprintf(m->topic, sizeof(m->topic), "%s/s/stats/host/value", d->ll.prefix);
+            struct jsdrv_statistics_s * dst = (struct jsdrv_statistics_s *) m->payload.bin;
+            *dst = *s;
+            dst->time_map = d->time_map;
+            m->value = jsdrv_union_cbin_r((uint8_t *) dst, sizeof(*dst));
+            m->value.app = JSDRV_PAYLOAD_TYPE_STATISTICS;
+            jsdrvp_backend_send(d->context, m);
+            stats->block_sample_id = sample_id + k * (uint64_t) stats->decimate_factor;
+        }
     }
 }
 
 static void compute_power(struct dev_s * d) {
     // for full-rate data, must compute power on the host
     // insufficient sensor-controller and USB bandwidth to stream everything.
-    sbuf_f32_mult(&d->p_buf, &d->i_buf, &d->v_buf);
-    uint32_t sz = sbuf_f32_length(&d->p_buf);
-    if (sz) {
-        handle_stream_in_port(d, PORT_ID_POWER, &d->p_buf.msg_sample_id, (1 + sz) * 4);
+    struct port_s * port = &d->ports[PORT_ID_POWER & 0x0f];
+    if (0 == port->decimate_factor) {
+        return;
+    }
+    uint64_t sample_id = 0;
+    uint32_t length = jsdrv_power_f32_available(&d->power, &sample_id);
+    bool is_consumed = stream_is_consumed(d, PORT_ID_POWER);
+    while (length) {
+        if (port->sample_id_next != sample_id) {
+            if (port->msg_in) {
+                JSDRV_LOGD1("compute_power: send partial message");
+                stream_in_port_send(d, port);
+            }
+            port->sample_id_next = sample_id;
+        }
+        uint32_t n = (length < POWER_BLOCK_LENGTH) ? length : POWER_BLOCK_LENGTH;
+        if (!is_consumed) {
+            // only host-side statistics use power, skip the message
+            float p[POWER_BLOCK_LENGTH];
+            const float * i = jsdrv_power_f32_peek(&d->power, JSDRV_POWER_F32_CURRENT);
+            const float * v = jsdrv_power_f32_peek(&d->power, JSDRV_POWER_F32_VOLTAGE);
+            n = jsdrv_power_f32_mult(&d->power, p, n);
+            if (d->host_stats_scnt) {
+                host_stats_add(d, sample_id, i, v, p, n);
+            }
+            port->sample_id_next += n * port->decimate_factor;
+            sample_id = port->sample_id_next;
+            length -= n;
+            continue;
+        }
+        struct jsdrvp_msg_s * m = stream_in_port_msg(d, PORT_ID_POWER, n * sizeof(float));
+        struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->value.value.bin;
+        const float * i = jsdrv_power_f32_peek(&d->power, JSDRV_POWER_F32_CURRENT);
+        const float * v = jsdrv_power_f32_peek(&d->power, JSDRV_POWER_F32_VOLTAGE);
+        if ((port->downsample != NULL) || port->downsample_pending) {
+            float p[POWER_BLOCK_LENGTH];
+            n = jsdrv_power_f32_mult(&d->power, p, n);
+            if (d->host_stats_scnt) {
+                host_stats_add(d, sample_id, i, v, p, n);
+            }
+            stream_in_port_downsample(d, PORT_ID_POWER, m, p, n);
+        } else {
+            // compute directly into the outgoing message
+            float * p = (float *) &m->value.value.bin[m->value.size];
+            n = jsdrv_power_f32_mult(&d->power, p, n);
+            if (d->host_stats_scnt) {
+                host_stats_add(d, sample_id, i, v, p, n);
+            }
+            m->value.size += n * sizeof(float);
+            s->element_count += n;
+        }
+        port->sample_id_next += n * port->decimate_factor;
+        sample_id = port->sample_id_next;
+        length -= n;
+        stream_in_port_send_check(d, PORT_ID_POWER);
     }
 }
 
@@ -1390,6 +3270,21 @@ static void handle_uart_in(struct dev_s * d, uint32_t * p_u32, uint16_t size) {
     // When available, add UART message parsing support here.
 }
 
+static void stats_windows_publish(struct dev_s * d, uint32_t completed) {
+    for (uint8_t slot = 0; slot < JSDRV_STATS_WINDOWS_COUNT; ++slot) {
+        if (0 == (completed & (1U << slot))) {
+            continue;
+        }
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/s/stats/win/%u/value", d->ll.prefix, (unsigned int) slot);
+        struct jsdrv_statistics_s * dst = (struct jsdrv_statistics_s *) m->payload.bin;
+        *dst = *jsdrv_stats_windows_value(&d->stats_windows, slot);
+        m->value = jsdrv_union_cbin_r((uint8_t *) dst, sizeof(*dst));
+        m->value.app = JSDRV_PAYLOAD_TYPE_STATISTICS;
+        jsdrvp_backend_send(d->context, m);
+    }
+}
+
 static void handle_statistics_in(struct dev_s * d, uint32_t * p_u32, uint16_t size) {
     if (size != sizeof(struct js220_statistics_raw_s)) {
         JSDRV_LOGW("statistics size mismatch");
@@ -1424,6 +3319,7 @@ static void handle_statistics_in(struct dev_s * d, uint32_t * p_u32, uint16_t si
                         (double) dst->sample_freq,
                         false);
         dst->time_map = d->time_map;
+        stats_windows_publish(d, jsdrv_stats_windows_add(&d->stats_windows, dst));
         jsdrvp_backend_send(d->context, m);
     } else {
         jsdrvp_msg_free(d->context, m);
@@ -1465,15 +3361,18 @@ static void handle_stream_in_port0(struct dev_s * d, uint32_t * p_u32, uint16_t
             jsdrv_version_u32_to_str(c->fpga_version, fpga_ver_str, sizeof(fpga_ver_str));
             JSDRV_LOGI("JS220 app_id=%d, FW=%s, HW=%s, FPGA=%s, protocol=%s",
                      c->app_id, fw_ver_str, hw_ver_str, fpga_ver_str, prot_ver_str);
-            send_to_frontend(d, "c/fw/version$", &jsdrv_union_cjson_r(fw_ver_meta));
-            send_to_frontend(d, "c/hw/version$", &jsdrv_union_cjson_r(hw_ver_meta));
-            send_to_frontend(d, "h/fs$", &jsdrv_union_cjson_r(sampling_frequency_meta));
-            if (has_on_instrument_downsample(d)) {
-                send_to_frontend(d, "h/filter$", &jsdrv_union_cjson_r(signal_downsample_filter));
+            if (!d->meta_published) {  // retained by pubsub across open/close
+                send_to_frontend(d, "c/fw/version$", &jsdrv_union_cjson_r(fw_ver_meta));
+                send_to_frontend(d, "c/hw/version$", &jsdrv_union_cjson_r(hw_ver_meta));
+                send_to_frontend(d, "h/fs$", &jsdrv_union_cjson_r(sampling_frequency_meta));
+                if (has_on_instrument_downsample(d)) {
+                    send_to_frontend(d, "h/filter$", &jsdrv_union_cjson_r(signal_downsample_filter));
+                }
+                send_to_frontend(d, "h/!reset$", &jsdrv_union_cjson_r(reset_meta));
+                d->meta_published = true;
             }
             send_to_frontend(d, "h/i_scale", &jsdrv_union_cjson_r(i_scale_factor));
             send_to_frontend(d, "h/v_scale", &jsdrv_union_cjson_r(v_scale_factor));
-            send_to_frontend(d, "h/!reset$", &jsdrv_union_cjson_r(reset_meta));
             send_to_frontend(d, "c/fw/version", &jsdrv_union_u32_r(c->fw_version));
             send_to_frontend(d, "c/hw/version", &jsdrv_union_u32_r(c->hw_version));
             send_to_frontend(d, "s/fpga/version", &jsdrv_union_u32_r(c->fpga_version));
@@ -1503,7 +3402,8 @@ static void handle_stream_in_port0(struct dev_s * d, uint32_t * p_u32, uint16_t
             p0->payload.timesync.utc_recv = t_utc;
             p0->payload.timesync.utc_send = jsdrv_time_utc();
             p0->payload.timesync.end_count = 0;
-            msg_queue_push(d->ll.cmd_q, m);
+            bulk_out_send(d, m);
+            bulk_out_flush(d);  // send timesync without delay
             JSDRV_LOGD2("port 0 timesync utc==%" PRIi64 " counter=%" PRIi64,
                         t_utc, p->timesync.start_count);
             break;
@@ -1515,6 +3415,7 @@ static void handle_stream_in_port0(struct dev_s * d, uint32_t * p_u32, uint16_t
             d->time_map.offset_time = p->timemap.utc;
             d->time_map.offset_counter = p->timemap.counter;
             d->time_map.counter_rate = p->timemap.counter_rate / ((double) (1ULL << 32));
+            d->time_map_device = true;
             break;
         }
 
@@ -1526,6 +3427,11 @@ static void handle_stream_in_port0(struct dev_s * d, uint32_t * p_u32, uint16_t
 
 static void handle_stream_in_pubsub(struct dev_s * d, uint32_t * p_u32, uint16_t size) {
     struct js220_publish_s * p = (struct js220_publish_s *) p_u32;
+    if (size < sizeof(*p)) {
+        JSDRV_LOGW("pubsub from js220 too short: %u", (unsigned int) size);
+        return;
+    }
+    p->topic[sizeof(p->topic) - 1] = 0;  // force null term
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(d->context);
     tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->ll.prefix, p->topic);
     size_t sz = strlen(m->topic);
@@ -1533,14 +3439,15 @@ static void handle_stream_in_pubsub(struct dev_s * d, uint32_t * p_u32, uint16_t
         m->topic[sz - 1] = 0;  // we asked for it, treat as normal.
     }
     m->value.type = p->type;
-    m->value.flags = p->flags;
+    // memory ownership flags are host-only, never trust them from the wire
+    m->value.flags = p->flags & ~(JSDRV_UNION_FLAG_SHARED_MEMORY | JSDRV_UNION_FLAG_HEAP_MEMORY);
     m->value.op = p->op;
     m->value.app = p->app;
     m->value.size = size - sizeof(*p);
 
     if ((p->type == JSDRV_UNION_STR) || (p->type == JSDRV_UNION_JSON)) {
-        if (m->value.size > sizeof(m->payload.bin)) {
-            JSDRV_LOGE("pubsub from js220 %s STR, but size too big %u", m->topic, m->value.size);
+        if ((0 == m->value.size) || (m->value.size > sizeof(m->payload.bin))) {
+            JSDRV_LOGE("pubsub from js220 %s STR, but size invalid %u", m->topic, m->value.size);
             jsdrvp_msg_free(d->context, m);
             return;
         } else {
@@ -1570,6 +3477,12 @@ static void handle_stream_in_pubsub(struct dev_s * d, uint32_t * p_u32, uint16_t
         d->ll_await_break_value = m->value;
     }
 
+    if ((m->value.flags & JSDRV_UNION_FLAG_RETAIN) && (m->topic[strlen(m->topic) - 1] != '$')) {
+        if (jsdrv_param_cache_update(d->param_cache, m->topic + strlen(d->ll.prefix) + 1, &m->value)) {
+            ++d->param_cache_deltas;
+        }
+    }
+
     handle_rsp_ctrl(d, p->topic, &m->value);  // reconnect in streaming, may not be desirable
     jsdrvp_backend_send(d->context, m);
 }
@@ -1586,7 +3499,7 @@ static void mem_write_end(struct dev_s * d) {
     memset(&m->hdr, 0, sizeof(m->hdr));
     m->hdr = d->mem_hdr;
     m->hdr.op = JS220_PORT3_OP_NONE;
-    msg_queue_push(d->ll.cmd_q, msg_bk);
+    bulk_out_send(d, msg_bk);
 }
 
 static void mem_write_next(struct dev_s * d) {
@@ -1611,7 +3524,7 @@ static void mem_write_next(struct dev_s * d) {
         memcpy(m->data, d->mem_data + m->hdr.offset, m->hdr.length);
         JSDRV_LOGD1("mem_write_data offset=%d, length=%d", (int) d->mem_offset_sent, (int) m->hdr.length);
         d->mem_offset_sent += m->hdr.length;
-        msg_queue_push(d->ll.cmd_q, msg_bk);
+        bulk_out_send(d, msg_bk);
     }
 }
 
@@ -1621,7 +3534,7 @@ static void mem_write_finalize(struct dev_s * d) {
     struct js220_port3_msg_s * m = (struct js220_port3_msg_s *) msg_bk->value.value.bin;
     d->mem_hdr.op = JS220_PORT3_OP_WRITE_FINALIZE;
     m->hdr = d->mem_hdr;
-    msg_queue_push(d->ll.cmd_q, msg_bk);
+    bulk_out_send(d, msg_bk);
 }
 
 static void mem_status(struct dev_s * d, uint8_t status) {
@@ -1720,31 +3633,10 @@ static void handle_stream_in_mem(struct dev_s * d, uint32_t * p_u32, uint16_t si
 static void handle_stream_in_frame(struct dev_s * d, uint32_t * p_u32) {
     union js220_frame_hdr_u hdr;
     hdr.u32 = p_u32[0];
-    if (d->in_frame_id != (uint16_t) hdr.h.frame_id) {
-        if (0 != d->in_frame_count) {
-            JSDRV_LOGW("in frame_id mismatch %d != %d", (int) d->in_frame_id, (int) hdr.h.frame_id);
-            // todo keep statistics
-        }
-        d->in_frame_id = hdr.h.frame_id;
-    }
-    if ((d->stream_in_port_enable & (1U << hdr.h.port_id)) == 0U) {
-        // JSDRV_LOGW("stream in ignore on inactive port %d", hdr.h.port_id);
-        // todo keep statistics
-    } else if (hdr.h.port_id >= 16U) {
-        if (d->state != ST_OPEN) {
-            JSDRV_LOGI("rcv port %d but discard, device not open", (int) hdr.h.port_id);
-        } else if (hdr.h.port_id == (16U + 13U)) {
-            handle_uart_in(d, p_u32 + 1, hdr.h.length);
-        } else if (hdr.h.port_id == (16U + 14U)) {
-            handle_statistics_in(d, p_u32 + 1, hdr.h.length);
-        } else {
-            handle_stream_in_port(d, hdr.h.port_id, p_u32 + 1, hdr.h.length);
-            if ((hdr.h.port_id == PORT_ID_VOLTAGE)
-                    && is_ivp_enabled(d)
-                    && !is_on_instrument_downsample_active(d)) {
-                compute_power(d);
-            }
-        }
+    if (hdr.h.port_id == (16U + 13U)) {
+        handle_uart_in(d, p_u32 + 1, hdr.h.length);
+    } else if (hdr.h.port_id == (16U + 14U)) {
+        handle_statistics_in(d, p_u32 + 1, hdr.h.length);
     } else {
         JSDRV_LOGD1("stream in: port=%d, length=%d", hdr.h.port_id, hdr.h.length);
         switch ((uint8_t) hdr.h.port_id) {
@@ -1755,17 +3647,100 @@ static void handle_stream_in_frame(struct dev_s * d, uint32_t * p_u32) {
             default: break; // unsupported, discard
         }
     }
-    ++d->in_frame_id;
-    ++d->in_frame_count;
+}
+
+static bool is_stream_port(uint8_t port_id) {
+    return (port_id >= 16U) && (port_id != (16U + 13U)) && (port_id != (16U + 14U));
+}
+
+/**
+ * @brief Classify the frames by port.
+ *
+ * @param d The device.
+ * @param frames The output frames.
+ * @param p_u32 The first frame.
+ * @param frame_count The number of frames, up to STREAM_IN_BATCH_FRAMES.
+ * @return The number of frames written to frames.
+ *
+ * Each stream port's frames are linked through frames[].next in order.
+ * Frames that are not stream data have next set to STREAM_FRAME_NONE.
+ */
+static uint32_t stream_in_classify(struct dev_s * d, struct stream_frame_s * frames, uint32_t * p_u32, uint32_t frame_count) {
+    uint8_t tail[32];
+    uint32_t count = 0;
+    memset(tail, STREAM_FRAME_NONE, sizeof(tail));
+    for (uint32_t i = 0; i < frame_count; ++i, p_u32 += FRAME_SIZE_U32) {
+        union js220_frame_hdr_u hdr;
+        hdr.u32 = p_u32[0];
+        if (d->in_frame_id != (uint16_t) hdr.h.frame_id) {
+            if (0 != d->in_frame_count) {
+                JSDRV_LOGW("in frame_id mismatch %d != %d", (int) d->in_frame_id, (int) hdr.h.frame_id);
+                ++d->health.frame_id_mismatch;
+                d->health.frames_lost += (uint16_t) (hdr.h.frame_id - d->in_frame_id);
+            }
+            d->in_frame_id = hdr.h.frame_id;
+        }
+        ++d->in_frame_id;
+        ++d->in_frame_count;
+        ++d->health.frames;
+        d->health.bytes += hdr.h.length;
+        uint8_t port_id = (uint8_t) hdr.h.port_id;
+        if ((d->stream_in_port_enable & (1U << port_id)) == 0U) {
+            // JSDRV_LOGW("stream in ignore on inactive port %d", port_id);
+            ++d->health.inactive;
+            continue;
+        } else if ((port_id >= 16U) && (d->state != ST_OPEN)) {
+            JSDRV_LOGI("rcv port %d but discard, device not open", (int) port_id);
+            ++d->health.discard;
+            continue;
+        }
+        struct stream_frame_s * f = &frames[count];
+        f->p_u32 = p_u32;
+        f->length = (uint16_t) hdr.h.length;
+        f->port_id = port_id;
+        f->next = STREAM_FRAME_NONE;
+        f->head = true;
+        if (is_stream_port(port_id)) {
+            if (tail[port_id] != STREAM_FRAME_NONE) {
+                frames[tail[port_id]].next = (uint8_t) count;
+                f->head = false;
+            }
+            tail[port_id] = (uint8_t) count;
+        }
+        ++count;
+    }
+    return count;
 }
 
 static void handle_stream_in(struct dev_s * d, struct jsdrvp_msg_s * msg) {
     JSDRV_ASSERT(msg->value.type == JSDRV_UNION_BIN);
+    struct stream_frame_s frames[STREAM_IN_BATCH_FRAMES];
     uint32_t frame_count = (msg->value.size + FRAME_SIZE_BYTES - 1) / FRAME_SIZE_BYTES;
-    for (uint32_t i = 0; i < frame_count; ++i) {
-        uint32_t * p_u32 = (uint32_t *) &msg->value.value.bin[i * FRAME_SIZE_BYTES];
-        handle_stream_in_frame(d, p_u32);
+    uint32_t * p_u32 = (uint32_t *) msg->value.value.bin;
+    JSDRV_TRACE_BEGIN("stream_in", d->ll.prefix, msg->value.size);
+
+    // Two stages for each batch: classify frames by port, then process
+    // each port's frames together in order of each port's first frame.
+    while (frame_count) {
+        uint32_t batch = (frame_count > STREAM_IN_BATCH_FRAMES) ? STREAM_IN_BATCH_FRAMES : frame_count;
+        uint32_t count = stream_in_classify(d, frames, p_u32, batch);
+        for (uint32_t i = 0; i < count; ++i) {
+            struct stream_frame_s * f = &frames[i];
+            if (!is_stream_port(f->port_id)) {
+                handle_stream_in_frame(d, f->p_u32);
+            } else if (f->head) {
+                handle_stream_in_port_run(d, frames, (uint8_t) i);
+                if (((f->port_id == PORT_ID_CURRENT) || (f->port_id == PORT_ID_VOLTAGE))
+                        && is_ivp_enabled(d)
+                        && !is_on_instrument_downsample_active(d)) {
+                    compute_power(d);
+                }
+            }
+        }
+        p_u32 += batch * FRAME_SIZE_U32;
+        frame_count -= batch;
     }
+    JSDRV_TRACE_END("stream_in");
 }
 
 static bool handle_rsp(struct dev_s * d, struct jsdrvp_msg_s * msg) {
@@ -1774,13 +3749,26 @@ static bool handle_rsp(struct dev_s * d, struct jsdrvp_msg_s * msg) {
         return false;
     }
     if (0 == strcmp(JSDRV_USBBK_MSG_STREAM_IN_DATA, msg->topic)) {
-        JSDRV_LOGD3("stream_in_data sz=%d", (int) msg->value.size);
-        handle_stream_in(d, msg);
+        uint32_t count = jsdrvp_usb_stream_seal(msg);
+        JSDRV_LOGD3("stream_in_data sz=%d, count=%d", (int) msg->value.size, (int) count);
+        for (uint32_t i = 0; i < count; ++i) {
+            jsdrvp_usb_stream_select(msg, i);
+            jsdrvp_usb_capture(d->context, d->capture_id, msg);
+            d->stream_time = msg->extra.bkusb_stream.time;
+            handle_stream_in(d, msg);
+        }
         msg_queue_push(d->ll.cmd_q, msg);  // return
         return true;
     } else if (0 == strcmp(JSDRV_USBBK_MSG_BULK_OUT_DATA, msg->topic)) {
         JSDRV_LOGD2("stream_out_data done");
         // no action necessary
+    } else if (0 == strcmp(JSDRV_USBBK_MSG_STATS, msg->topic)) {
+        send_to_frontend(d, JSDRV_USBBK_MSG_STATS, &msg->value);
+    } else if ((0 == strcmp(JSDRV_USBBK_MSG_CTRL_IN, msg->topic))
+            || (0 == strcmp(JSDRV_USBBK_MSG_CTRL_OUT, msg->topic))) {
+        if (msg->extra.bkusb_ctrl.cbk_fn) {
+            ctrl_complete(d, msg);
+        }
     } else if (msg->topic[0] == JSDRV_MSG_COMMAND_PREFIX_CHAR) {
         if (0 == strcmp(JSDRV_MSG_FINALIZE, msg->topic)) {
             d->do_exit = true;
@@ -1823,6 +3811,9 @@ static THREAD_RETURN_TYPE driver_thread(THREAD_ARG_TYPE lpParam) {
     }
 
     update_state(d, ST_CLOSED);
+    jsdrvp_thread_configure(d->context, JSDRVP_THREAD_DEVICE, "jsdrv_js220");
+    jsdrv_thread_stats_register(d->ll.prefix);  // distinguish devices in JSDRV_MSG_STATS_THREADS
+    jsdrvp_msg_cache_attach(d->context);
 
     while (!d->do_exit) {
 #if _WIN32
@@ -1838,17 +3829,23 @@ static THREAD_RETURN_TYPE driver_thread(THREAD_ARG_TYPE lpParam) {
         while (handle_rsp(d, msg_queue_pop_immediate(d->ll.rsp_q))) {
             ;
         }
+        bulk_out_flush(d);
+        if (d->state == ST_OPEN) {
+            latency_publish(d);
+            health_publish(d);
+        }
     }
 
+    jsdrvp_msg_cache_detach(d->context);
     JSDRV_LOGI("JS220 USB upper-level thread done %s", d->ll.prefix);
     THREAD_RETURN();
 }
 
-static void join(struct jsdrvp_ul_device_s * device) {
-    struct dev_s * d = (struct dev_s *) device;
-    jsdrvp_send_finalize_msg(d->context, d->ul.cmd_q, "");
-    // and wait for thread to exit.
-    jsdrv_thread_join(&d->thread, 1000);
+static void dev_free(struct dev_s * d) {
+    if (d->bulk_out_msg) {
+        jsdrvp_msg_free(d->context, d->bulk_out_msg);
+        d->bulk_out_msg = NULL;
+    }
 
     for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->ports); ++idx) {
         struct port_s *p = &d->ports[idx];
@@ -1860,27 +3857,89 @@ static void join(struct jsdrvp_ul_device_s * device) {
             jsdrv_downsample_free(p->downsample);
             p->downsample = NULL;
         }
+        jsdrv_downsample_free(p->downsample_next);
+        p->downsample_next = NULL;
     }
+    ds_free(d);
+    jsdrv_free(d->host_quantile);
+    jsdrv_tmf_free(d->time_map_filter);
     jsdrv_free(d);
 }
 
-int32_t jsdrvp_ul_js220_usb_factory(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
-    JSDRV_DBC_NOT_NULL(device);
-    JSDRV_DBC_NOT_NULL(context);
-    JSDRV_DBC_NOT_NULL(ll);
-    *device = NULL;
+static void join(struct jsdrvp_ul_device_s * device) {
+    struct dev_s * d = (struct dev_s *) device;
+    jsdrvp_send_finalize_msg(d->context, d->ul.cmd_q, "");
+    // and wait for thread to exit.
+    jsdrv_thread_join(&d->thread, 1000);
+    dev_free(d);
+}
+
+static struct dev_s * dev_alloc(struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
     struct dev_s * d = jsdrv_alloc_clr(sizeof(struct dev_s));
     JSDRV_LOGD3("jsdrvp_ul_js220_usb_factory %p", d);
     d->i_scale = 1.0f;
+    jsdrv_stream_flush_initialize(&d->stream_flush);
+    jsdrv_stream_gate_initialize(&d->stream_gate);
+    jsdrv_stats_windows_initialize(&d->stats_windows);
+    js110_stats_initialize(&d->host_stats);
+    d->i_rms_window = JSDRV_DERIVED_RMS_WINDOW_DEFAULT;
+    d->summary_fs = JSDRV_DERIVED_SUMMARY_FS_DEFAULT;
+    for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->summary); ++idx) {
+        jsdrv_derived_summary_clear(&d->summary[idx], d->summary_fs);
+    }
+    jsdrv_derived_rms_clear(&d->i_rms, d->i_rms_window);
+    for (uint32_t idx = 0; idx < JSDRV_ARRAY_SIZE(d->edge); ++idx) {
+        jsdrv_derived_edge_clear(&d->edge[idx]);
+    }
     d->v_scale = 1.0f;
     on_sampling_frequency(d, &jsdrv_union_u32_r(SAMPLING_FREQUENCY));
+    d->time_map_filter = jsdrv_tmf_new(SAMPLING_FREQUENCY, 60, JSDRV_TIME_SECOND);
+    jsdrv_tmf_rate_estimate(d->time_map_filter, true);
     d->context = context;
     d->ll = *ll;
+    d->capture_id = jsdrvp_usb_capture_device(context, ll->prefix);
+    d->param_cache = jsdrvp_param_cache(context, ll->prefix);
     d->ul.cmd_q = msg_queue_init();
+    d->ul.rsp_q = d->ll.rsp_q;
     d->ul.join = join;
+    return d;
+}
+
+int32_t jsdrvp_ul_js220_usb_factory(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
+    JSDRV_DBC_NOT_NULL(device);
+    JSDRV_DBC_NOT_NULL(context);
+    JSDRV_DBC_NOT_NULL(ll);
+    *device = NULL;
+    struct dev_s * d = dev_alloc(context, ll);
     if (jsdrv_thread_create(&d->thread, driver_thread, d, 1)) {
         return JSDRV_ERROR_UNSPECIFIED;
     }
     *device = &d->ul;
     return 0;
 }
+
+#if JSDRV_FUZZ
+struct jsdrvp_ul_device_s * jsdrvp_ul_js220_usb_fuzz_alloc(struct jsdrv_context_s * context, struct jsdrvp_ll_device_s * ll) {
+    struct dev_s * d = dev_alloc(context, ll);
+    d->state = ST_OPEN;
+    d->stream_in_port_enable = 0x000f;
+    for (size_t i = 0; i < JSDRV_ARRAY_SIZE(PORT_MAP); ++i) {
+        if (PORT_MAP[i].ctrl_topic) {
+            stream_in_port_enable(d, PORT_MAP[i].ctrl_topic, true);
+        }
+    }
+    return &d->ul;
+}
+
+void jsdrvp_ul_js220_usb_fuzz_process(struct jsdrvp_ul_device_s * device, struct jsdrvp_msg_s * msg) {
+    struct dev_s * d = (struct dev_s *) device;
+    d->stream_time = jsdrv_time_utc();
+    handle_stream_in(d, msg);
+}
+
+void jsdrvp_ul_js220_usb_fuzz_free(struct jsdrvp_ul_device_s * device) {
+    struct dev_s * d = (struct dev_s *) device;
+    msg_queue_finalize(d->ul.cmd_q);
+    dev_free(d);
+}
+#endif
@@ -21,22 +21,41 @@
  */
 
 #define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_FRONTEND
 #include "jsdrv.h"
+#include "jsdrv/recorder.h"
 #include "jsdrv/version.h"
 #include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv_prv/assert.h"
 #include "jsdrv_prv/log.h"
 #include "jsdrv_prv/backend.h"
+#include "jsdrv_prv/align.h"
 #include "jsdrv_prv/buffer.h"
 #include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/dispatch.h"
+#include "jsdrv_prv/f32_ops.h"
 #include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/interval.h"
+#include "jsdrv_prv/json.h"
+#include "jsdrv_prv/latency_hist.h"
+#include "jsdrv_prv/param_cache.h"
 #include "jsdrv_prv/pubsub.h"
+#include "jsdrv_prv/spectrum.h"
+#include "jsdrv_prv/stage.h"
+#include "jsdrv_prv/stats_group.h"
 #include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/thread_stats.h"
+#include "jsdrv_prv/timeouts.h"
+#include "jsdrv_prv/trace.h"
+#include "jsdrv_prv/value_shared.h"
 #include "jsdrv_prv/msg_queue.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/time.h"
 #include "jsdrv/error_code.h"
 #include "jsdrv/topic.h"
+#include "tinyprintf.h"
+#include <stdarg.h>
 
 
 #define DEVICE_COUNT_MAX    (256U)  // 255 Joulescopes attached to 1 host should be enough
@@ -44,6 +63,10 @@
 #define DEVICE_LOOKUP_MAX   (BACKEND_COUNT_MAX * DEVICE_COUNT_MAX)
 #define API_TIMEOUT_MS      (3000)
 #define FRONTEND_THREAD_POLL_MS  (1000)
+#define MSG_CACHE_SIZE_MAX       (32U)   // per-thread cached messages for each class
+#define LATENCY_INTERVAL_MS      (1000U)
+#define STREAM_LATENCY_E2E       "h/stream/e2e"  // device topic
+#define GROUP_STATS_SUBTOPIC_DEFAULT  "s/stats/value"
 
 #ifndef UNITTEST
 #define UNITTEST 0
@@ -51,17 +74,116 @@
 
 
 JSDRV_STATIC_ASSERT(DEVICE_LOOKUP_MAX < UINT16_MAX, too_many_devices);
+JSDRV_STATIC_ASSERT(JSDRV_GROUP_MEMBER_MAX <= JSDRV_STATS_GROUP_MEMBER_MAX, group_stats_member_max);
 JSDRV_STATIC_ASSERT(JSDRV_STREAM_HEADER_SIZE == offsetof(struct jsdrv_stream_signal_s, data), jsdrv_stream_signal_s_header_size);
 JSDRV_STATIC_ASSERT(JSDRV_STREAM_DATA_SIZE == (sizeof(struct jsdrv_stream_signal_s) - JSDRV_STREAM_HEADER_SIZE), sizeof_jsdrv_stream_signal_s);
-static const size_t STREAM_MSG_SZ = sizeof(struct jsdrvp_msg_s) - sizeof(union jsdrvp_payload_u) + sizeof(struct jsdrv_stream_signal_s);
+
+typedef int32_t (*device_factory_fn)(struct jsdrvp_ul_device_s ** device, struct jsdrv_context_s * context,
+                                     struct jsdrvp_ll_device_s * ll);
 
 struct frontend_dev_s {
     char prefix[JSDRV_TOPIC_LENGTH_MAX];
+    uint32_t prefix_hash;                   // see device_prefix_hash()
+    uint32_t prefix_length;
     struct jsdrv_context_s * context;
-    struct jsdrvp_ul_device_s * device;
+    struct jsdrvp_ul_device_s * device;     // NULL until device_instantiate()
+    device_factory_fn factory;
+    struct jsdrvp_ll_device_s ll;           // the factory argument
+    struct jsdrv_latency_hist_s latency;    // USB completion to frontend publish
+    uint32_t latency_time_ms;
     struct jsdrv_list_s item;
 };
 
+/**
+ * @brief A device group member, see JSDRV_MSG_GROUP_PREFIX.
+ */
+struct group_member_s {
+    char prefix[JSDRV_TOPIC_LENGTH_MAX];
+    bool start_pending;                     // awaiting the first data after a stream enable
+    uint64_t sample_id;                     // the first sample_id after the stream enable
+    struct jsdrv_time_map_s time_map;       // from the first data after the stream enable
+};
+
+struct group_s {
+    char topic[JSDRV_TOPIC_LENGTH_MAX];     // "@/group/{name}"
+    uint32_t member_count;
+    struct group_member_s members[JSDRV_GROUP_MEMBER_MAX];
+    char start_subtopic[JSDRV_TOPIC_LENGTH_MAX];  // the awaited data, such as "s/i/!data"
+    uint32_t start_pending;                 // members still awaiting start data
+    char stats_subtopic[JSDRV_TOPIC_LENGTH_MAX];  // the member statistics, "" for off
+    struct jsdrv_stats_group_s stats;
+    struct jsdrv_list_s item;
+};
+
+/**
+ * @brief The jsdrv_publish_batch() state shared with the frontend thread.
+ *
+ * The caller and the frontend thread each hold one reference, and the
+ * last one to release frees the batch.  When the caller's wait fails,
+ * the frontend thread may still complete the timeouts, so the count
+ * and event must outlive the caller's stack frame.
+ */
+struct jsdrvp_api_batch_s {
+    volatile uint32_t refs;                 // caller + frontend thread
+    volatile uint32_t remaining;            // timeouts not yet completed
+    jsdrv_os_event_t ev;                    // signaled when remaining reaches 0
+    struct jsdrvp_api_timeout_s timeouts[]; // one per published message
+};
+
+/// A group command awaiting the member return codes.
+struct group_op_s {
+    struct jsdrv_context_s * context;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];     // the group command topic with the return code suffix
+    uint32_t remaining;
+    int32_t return_code;                    // the first member error
+};
+
+
+/**
+ * @brief The message size classes.
+ *
+ * Data messages come in several payload sizes so that low-rate channels
+ * and small responses do not occupy a full jsdrv_stream_signal_s.
+ */
+enum msg_class_e {
+    MSG_CLASS_NORMAL = 0,
+    MSG_CLASS_DATA_4K,
+    MSG_CLASS_DATA_16K,
+    MSG_CLASS_DATA,         // full jsdrv_stream_signal_s
+    MSG_CLASS_COUNT,
+};
+
+static const uint32_t MSG_CLASS_PAYLOAD_SIZE[MSG_CLASS_COUNT] = {
+    sizeof(union jsdrvp_payload_u),
+    4096U,
+    16384U,
+    sizeof(struct jsdrv_stream_signal_s),
+};
+
+static const char * const MSG_CLASS_NAME[MSG_CLASS_COUNT] = {"normal", "data_4k", "data_16k", "data"};
+
+// per-thread cached messages for each class
+static const uint32_t MSG_CLASS_CACHE_SIZE[MSG_CLASS_COUNT] = {32U, 16U, 16U, 16U};
+
+JSDRV_STATIC_ASSERT(JSDRV_PAYLOAD_LENGTH_MAX <= 4096U, msg_class_data_4k_size);
+
+/**
+ * @brief The message pool accounting.
+ *
+ * Counters are updated from any thread using atomic operations.
+ */
+struct msg_pool_s {
+    uint32_t max;                   // maximum pooled messages, 0 for no limit
+    volatile uint32_t allocated;    // messages owned by the pool
+    volatile uint32_t in_use;       // messages currently allocated to callers
+    volatile uint32_t peak;         // maximum in_use
+    volatile uint32_t fallback;     // heap allocations beyond max
+};
+
+struct msg_class_s {
+    struct msg_queue_s * free;      // shared free messages
+    struct msg_pool_s pool;
+};
 
 enum state_e {
     ST_INIT_AWAITING_FRONTEND,
@@ -70,54 +192,362 @@ enum state_e {
     ST_SHUTDOWN,
 };
 
+struct thread_cfg_s {
+    uint64_t affinity;      // 0 for no change
+    int32_t priority;
+    bool priority_set;
+};
+
+static const char * const THREAD_ROLE_NAME[JSDRVP_THREAD_COUNT] = {
+    "frontend", "backend", "device", "buffer", "dispatch",
+};
+
 struct jsdrv_context_s {
-    struct msg_queue_s * msg_free;
-    struct msg_queue_s * msg_free_data;
     struct msg_queue_s * msg_cmd;       // from API (any thread) to jsdrv thread
-    struct msg_queue_s * msg_backend;   // backend thread(s) to jsdrv thread
+    struct msg_queue_s * msg_backend;   // backend thread(s) to jsdrv thread, bulk data
+    struct msg_queue_s * msg_backend_ctrl;  // backend thread(s) to jsdrv thread, everything else first
 
     const struct jsdrv_arg_s * args;
     enum state_e state;
     int32_t init_status;  // 0 or first reported backend error code.
     struct jsdrvbk_s * backends[BACKEND_COUNT_MAX];
     struct jsdrv_pubsub_s * pubsub;
+    struct jsdrv_dispatch_s * dispatch;   // NULL or data callback workers
+    uint32_t dispatch_threads;            // 0 to invoke data callbacks on the frontend thread
     struct jsdrv_list_s devices;          // frontend_dev_s
-    struct jsdrv_list_s cmd_timeouts;
+    bool init_lazy;                       // JSDRV_ARG_INIT_LAZY
+    struct jsdrv_list_s cmd_deferred;     // jsdrvp_msg_s awaiting the device scan, see cmd_defer()
+    bool device_list_dirty;               // publish JSDRV_MSG_DEVICE_LIST before the next device message
+    struct jsdrv_list_s groups;           // group_s
+    uint32_t group_start_pending;         // members awaiting start data across all groups
+    struct jsdrv_timeouts_s * cmd_timeouts;
     jsdrv_thread_t thread;
 
+    uint32_t id;  // unique, nonzero, identifies this context to msg_cache_s
+    struct msg_class_s msg_classes[MSG_CLASS_COUNT];
+    uint32_t stats_mem_interval_ms;  // 0 to disable
+    uint32_t stats_mem_time_ms;
+    uint32_t stats_mem_prev[MSG_CLASS_COUNT * 4];
+    uint32_t stats_queue_hash;       // of the previous JSDRV_MSG_STATS_QUEUE
+    bool stats_topic_enable;         // JSDRV_MSG_STATS_TOPIC_REQ
+    uint32_t stats_threads_interval_ms;  // 0 to disable
+    uint32_t stats_threads_time_ms;
+    uint32_t stats_threads_count;
+    struct jsdrv_thread_stats_s stats_threads_prev[JSDRV_THREAD_STATS_MAX];
+    struct thread_cfg_s thread_cfg[JSDRVP_THREAD_COUNT];
+    struct jsdrv_recorder_s * usb_capture;  // NULL or JSDRV_ARG_USB_CAPTURE
+    uint16_t usb_capture_device_id;         // the most recent capture device_id
+    struct jsdrv_param_cache_s * param_cache;  // device parameters, persists across reopen
+    struct jsdrv_stage_registry_s * stages;    // native stages, see jsdrv_stage_register()
+    volatile uint32_t api_submit;   // API messages pushed to msg_cmd, see api_push()
+    uint32_t api_popped;            // API messages popped from msg_cmd, frontend thread only
+    volatile uint32_t api_done;     // api_popped once pubsub processed them, see jsdrv_query()
+
     volatile bool do_exit;
 };
 
-struct jsdrvp_msg_s * jsdrvp_msg_alloc(struct jsdrv_context_s * context) {
-    struct jsdrvp_msg_s * m = msg_queue_pop_immediate(context->msg_free);
+/**
+ * @brief A per-thread magazine of free messages.
+ *
+ * Threads that allocate and free messages at high rates attach
+ * a cache so that most operations avoid the shared free queues.
+ * The cache only moves messages to and from the shared queues
+ * in batches of half its capacity.
+ */
+struct msg_cache_s {
+    uint32_t context_id;
+    uint32_t count[MSG_CLASS_COUNT];
+    struct jsdrvp_msg_s * msgs[MSG_CLASS_COUNT][MSG_CACHE_SIZE_MAX];
+};
+
+static volatile uint32_t context_id_next_ = 0;
+static JSDRV_THREAD_LOCAL struct msg_cache_s * msg_cache_ = NULL;
+
+static struct msg_cache_s * msg_cache_get(struct jsdrv_context_s * context) {
+    struct msg_cache_s * cache = msg_cache_;
+    if (cache && (cache->context_id == context->id)) {
+        return cache;
+    }
+    return NULL;
+}
+
+static struct jsdrvp_msg_s * msg_cache_pop(struct msg_cache_s * cache, struct msg_queue_s * pool, uint32_t msg_class) {
+    struct jsdrvp_msg_s ** magazine = cache->msgs[msg_class];
+    uint32_t * count = &cache->count[msg_class];
+    uint32_t size = MSG_CLASS_CACHE_SIZE[msg_class];
+    if (0 == *count) {
+        while (*count < (size / 2)) {  // refill half from the shared pool
+            struct jsdrvp_msg_s * m = msg_queue_pop_immediate(pool);
+            if (!m) {
+                break;
+            }
+            magazine[(*count)++] = m;
+        }
+        if (0 == *count) {
+            return NULL;
+        }
+    }
+    return magazine[--(*count)];
+}
+
+static void msg_cache_push(struct msg_cache_s * cache, struct msg_queue_s * pool, struct jsdrvp_msg_s * msg) {
+    struct jsdrvp_msg_s ** magazine = cache->msgs[msg->msg_class];
+    uint32_t * count = &cache->count[msg->msg_class];
+    uint32_t size = MSG_CLASS_CACHE_SIZE[msg->msg_class];
+    if (*count >= size) {
+        // flush the oldest half to the shared pool, keep the most recent
+        uint32_t half = size / 2;
+        for (uint32_t i = 0; i < half; ++i) {
+            msg_queue_push(pool, magazine[i]);
+        }
+        memmove(&magazine[0], &magazine[half], (*count - half) * sizeof(magazine[0]));
+        *count -= half;
+    }
+    magazine[(*count)++] = msg;
+}
+
+static bool msg_pool_reserve(struct msg_pool_s * pool) {
+    while (1) {
+        uint32_t v = jsdrv_atomic_load_u32(&pool->allocated);
+        if (pool->max && (v >= pool->max)) {
+            return false;
+        }
+        if (jsdrv_atomic_cas_u32(&pool->allocated, v, v + 1)) {
+            return true;
+        }
+    }
+}
+
+static struct jsdrvp_msg_s * msg_pool_new(struct msg_pool_s * pool, uint32_t msg_class) {
+    uint32_t payload_size = MSG_CLASS_PAYLOAD_SIZE[msg_class];
+    size_t sz = sizeof(struct jsdrvp_msg_s) - sizeof(union jsdrvp_payload_u) + payload_size;
+    // align the header to a cache line so that routing touches one line.
+    // On 64-bit platforms, offsetof(payload) is 192 which also aligns the sample data.
+    struct jsdrvp_msg_s * m = jsdrv_alloc_aligned(sz, JSDRV_ALLOC_ALIGNMENT);
+    memset(m, 0, sz);
+    JSDRV_LOGD3("msg_pool_new %p class=%s sz=%zu", m, MSG_CLASS_NAME[msg_class], sz);
+    jsdrv_list_initialize(&m->item);
+    m->inner_msg_type = (MSG_CLASS_NORMAL == msg_class) ? JSDRV_MSG_TYPE_NORMAL : JSDRV_MSG_TYPE_DATA;
+    m->msg_class = msg_class;
+    m->payload_size = payload_size;
+    if (msg_pool_reserve(pool)) {
+        m->pool = 1;
+    } else {
+        m->pool = 0;
+        jsdrv_atomic_add_u32(&pool->fallback, 1);
+    }
+    return m;
+}
+
+static void msg_pool_acquire(struct msg_pool_s * pool) {
+    uint32_t in_use = jsdrv_atomic_add_u32(&pool->in_use, 1);
+    uint32_t peak = jsdrv_atomic_load_u32(&pool->peak);
+    while ((in_use > peak) && !jsdrv_atomic_cas_u32(&pool->peak, peak, in_use)) {
+        peak = jsdrv_atomic_load_u32(&pool->peak);
+    }
+}
+
+static void msg_pool_release(struct msg_pool_s * pool) {
+    jsdrv_atomic_add_u32(&pool->in_use, (uint32_t) -1);
+}
+
+static void msg_pool_preallocate(struct jsdrv_context_s * context, uint32_t msg_class, uint32_t count) {
+    struct msg_class_s * c = &context->msg_classes[msg_class];
+    for (uint32_t i = 0; i < count; ++i) {
+        struct jsdrvp_msg_s * m = msg_pool_new(&c->pool, msg_class);
+        if (!m->pool) {
+            jsdrv_free(m);
+            jsdrv_atomic_add_u32(&c->pool.fallback, (uint32_t) -1);
+            break;
+        }
+        msg_queue_push(c->free, m);
+    }
+}
+
+static struct jsdrvp_msg_s * msg_class_alloc(struct jsdrv_context_s * context, uint32_t msg_class) {
+    struct jsdrvp_msg_s * m;
+    struct msg_class_s * c = &context->msg_classes[msg_class];
+    struct msg_cache_s * cache = msg_cache_get(context);
+    if (cache) {
+        m = msg_cache_pop(cache, c->free, msg_class);
+    } else {
+        m = msg_queue_pop_immediate(c->free);
+    }
     if (!m) {
-        m = jsdrv_alloc_clr(sizeof(struct jsdrvp_msg_s));
-        JSDRV_LOGD3("jsdrvp_msg_alloc %p", m);
-        jsdrv_list_initialize(&m->item);
+        m = msg_pool_new(&c->pool, msg_class);
+    }
+    msg_pool_acquire(&c->pool);
+    return m;
+}
+
+void jsdrvp_thread_configure(struct jsdrv_context_s * context, enum jsdrvp_thread_e thread, const char * name) {
+    if (name) {
+        jsdrv_thread_name_set(name);
+    }
+    if (!context || (thread >= JSDRVP_THREAD_COUNT)) {
+        return;
+    }
+    struct thread_cfg_s * cfg = &context->thread_cfg[thread];
+    if (cfg->affinity) {
+        jsdrv_thread_affinity_set(cfg->affinity);
+    }
+    if (cfg->priority_set) {
+        jsdrv_thread_priority_set(cfg->priority);
+    }
+}
+
+uint32_t jsdrvp_usb_stream_seal(struct jsdrvp_msg_s * msg) {
+    if (!msg->extra.bkusb_stream.batch) {
+        return 1;
+    }
+    volatile uint32_t * state = &msg->payload.usb_stream.state;
+    while (1) {
+        uint32_t v = jsdrv_atomic_load_u32(state);
+        if ((v & JSDRVP_USB_STREAM_BATCH_SEALED)
+                || jsdrv_atomic_cas_u32(state, v, v | JSDRVP_USB_STREAM_BATCH_SEALED)) {
+            jsdrv_atomic_fence();  // entries written before the count
+            return v & ~JSDRVP_USB_STREAM_BATCH_SEALED;
+        }
+    }
+}
+
+void jsdrvp_usb_stream_select(struct jsdrvp_msg_s * msg, uint32_t index) {
+    if (msg->extra.bkusb_stream.batch && (index < JSDRVP_USB_STREAM_BATCH_MAX)) {
+        struct jsdrvp_usb_stream_entry_s * e = &msg->payload.usb_stream.entries[index];
+        msg->value = jsdrv_union_bin(e->buffer, e->size);
+        msg->extra.bkusb_stream.time = e->time;
+    }
+}
+
+int32_t jsdrvp_arg_get(struct jsdrv_context_s * context, const char * topic, struct jsdrv_union_s * value) {
+    const struct jsdrv_arg_s * args = context->args;
+    if (NULL != args) {
+        for (; args->topic && args->topic[0]; ++args) {
+            if (0 == strcmp(topic, args->topic)) {
+                *value = args->value;
+                return 0;
+            }
+        }
+    }
+    return JSDRV_ERROR_NOT_FOUND;
+}
+
+uint16_t jsdrvp_usb_capture_device(struct jsdrv_context_s * context, const char * prefix) {
+    if (!context->usb_capture || (UINT16_MAX == context->usb_capture_device_id)) {
+        return 0;
+    }
+    uint16_t device_id = ++context->usb_capture_device_id;
+    if (jsdrv_recorder_usb_device(context->usb_capture, device_id, prefix)) {
+        JSDRV_LOGW("usb capture: could not add %s", prefix);
+        return 0;
+    }
+    JSDRV_LOGI("usb capture: device %u is %s", (unsigned int) device_id, prefix);
+    return device_id;
+}
+
+struct jsdrv_param_cache_device_s * jsdrvp_param_cache(struct jsdrv_context_s * context, const char * prefix) {
+    return jsdrv_param_cache_device(context->param_cache, prefix);
+}
+
+void jsdrvp_usb_capture(struct jsdrv_context_s * context, uint16_t device_id, const struct jsdrvp_msg_s * msg) {
+    if (device_id && context->usb_capture) {
+        jsdrv_recorder_usb_bulk_in(context->usb_capture, device_id, msg->extra.bkusb_stream.endpoint,
+                                   msg->extra.bkusb_stream.time, msg->value.value.bin, msg->value.size);
+    }
+}
+
+static void usb_capture_close(struct jsdrv_context_s * c) {
+    if (c->usb_capture) {
+        struct jsdrv_recorder_status_s status;
+        jsdrv_recorder_status(c->usb_capture, &status);
+        JSDRV_LOGI("usb capture: %llu transfers, %u drops",
+                   (unsigned long long) status.messages, (unsigned int) status.drops);
+        jsdrv_recorder_close(c->usb_capture);
+        c->usb_capture = NULL;
+    }
+}
+
+int32_t jsdrvp_thread_topic(const char * topic, const struct jsdrv_union_s * value) {
+    struct jsdrv_union_s v = *value;
+    if (0 == strcmp("h/thread/affinity", topic)) {
+        if (jsdrv_union_as_type(&v, JSDRV_UNION_U64)) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        return jsdrv_thread_affinity_set(v.value.u64);
+    } else if (0 == strcmp("h/thread/priority", topic)) {
+        if (jsdrv_union_as_type(&v, JSDRV_UNION_I32)) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        return jsdrv_thread_priority_set(v.value.i32);
+    }
+    return JSDRV_ERROR_NOT_FOUND;
+}
+
+void jsdrvp_msg_cache_attach(struct jsdrv_context_s * context) {
+    if (msg_cache_get(context)) {
+        return;  // already attached
+    }
+    if (msg_cache_) {
+        JSDRV_LOGW("jsdrvp_msg_cache_attach: discard stale cache");
+        for (uint32_t idx = 0; idx < MSG_CLASS_COUNT; ++idx) {
+            while (msg_cache_->count[idx]) {
+                jsdrv_free(msg_cache_->msgs[idx][--msg_cache_->count[idx]]);
+            }
+        }
+        jsdrv_free(msg_cache_);
+    }
+    struct msg_cache_s * cache = jsdrv_alloc_clr(sizeof(struct msg_cache_s));
+    cache->context_id = context->id;
+    msg_cache_ = cache;
+}
+
+void jsdrvp_msg_cache_detach(struct jsdrv_context_s * context) {
+    struct msg_cache_s * cache = msg_cache_get(context);
+    if (!cache) {
+        return;
     }
-    m->inner_msg_type = JSDRV_MSG_TYPE_NORMAL;
+    msg_cache_ = NULL;
+    for (uint32_t idx = 0; idx < MSG_CLASS_COUNT; ++idx) {
+        while (cache->count[idx]) {
+            struct jsdrvp_msg_s * m = cache->msgs[idx][--cache->count[idx]];
+            if (context->do_exit) {
+                jsdrv_free(m);
+            } else {
+                msg_queue_push(context->msg_classes[idx].free, m);
+            }
+        }
+    }
+    jsdrv_free(cache);
+}
+
+struct jsdrvp_msg_s * jsdrvp_msg_alloc(struct jsdrv_context_s * context) {
+    struct jsdrvp_msg_s * m = msg_class_alloc(context, MSG_CLASS_NORMAL);
+    // clear in address order: header line, topic line, then cold fields
+    m->topic_id = 0;
+    memset(&m->value, 0, sizeof(m->value));
     m->source = 0;
     m->u32_a = 0;
-    m->u32_b = 0;
     m->topic[0] = 0;
-    memset(&m->value, 0, sizeof(m->value));
-    m->payload.str[0] = 0;
-    memset(&m->extra, 0, sizeof(m->extra));
+    m->u32_b = 0;
     m->timeout = NULL;
+    memset(&m->extra, 0, sizeof(m->extra));
+    m->payload.str[0] = 0;
     return m;
 }
 
-struct jsdrvp_msg_s * jsdrvp_msg_alloc_data(struct jsdrv_context_s * context, const char * topic) {
-    struct jsdrvp_msg_s * m = msg_queue_pop_immediate(context->msg_free_data);
-    if (!m) {
-        m = jsdrv_alloc_clr(STREAM_MSG_SZ);
-        JSDRV_LOGD3("jsdrvp_msg_alloc_data %p sz=%zu", m, STREAM_MSG_SZ);
-        jsdrv_list_initialize(&m->item);
+struct jsdrvp_msg_s * jsdrvp_msg_alloc_data_sz(struct jsdrv_context_s * context, const char * topic, uint32_t size) {
+    uint32_t msg_class = MSG_CLASS_DATA_4K;
+    while ((msg_class < MSG_CLASS_DATA) && (size > MSG_CLASS_PAYLOAD_SIZE[msg_class])) {
+        ++msg_class;
     }
-    m->inner_msg_type = JSDRV_MSG_TYPE_DATA;
+    if (size > MSG_CLASS_PAYLOAD_SIZE[msg_class]) {
+        JSDRV_LOGW("jsdrvp_msg_alloc_data_sz %s: size %u too large", topic, (unsigned int) size);
+    }
+    struct jsdrvp_msg_s * m = msg_class_alloc(context, msg_class);
     m->source = 0;
     m->u32_a = 0;
     m->u32_b = 0;
+    m->topic_id = 0;
     jsdrv_cstr_copy(m->topic, topic, sizeof(m->topic));
     m->value = jsdrv_union_bin(&m->payload.bin[0], 0);
     memset(&m->extra, 0, sizeof(m->extra));
@@ -125,29 +555,36 @@ struct jsdrvp_msg_s * jsdrvp_msg_alloc_data(struct jsdrv_context_s * context, co
     return m;
 }
 
+struct jsdrvp_msg_s * jsdrvp_msg_alloc_data(struct jsdrv_context_s * context, const char * topic) {
+    return jsdrvp_msg_alloc_data_sz(context, topic, sizeof(struct jsdrv_stream_signal_s));
+}
+
 struct jsdrvp_msg_s * jsdrvp_msg_clone(struct jsdrv_context_s * context, const struct jsdrvp_msg_s * msg_src) {
     struct jsdrvp_msg_s * m;
     if (msg_src->inner_msg_type == JSDRV_MSG_TYPE_DATA) {
-        m = jsdrvp_msg_alloc_data(context, msg_src->topic);
+        m = jsdrvp_msg_alloc_data_sz(context, msg_src->topic, msg_src->value.size);
         m->value = msg_src->value;
         m->value.value.bin = &m->payload.bin[0];
         memcpy(m->payload.bin, msg_src->payload.bin, msg_src->value.size);
     } else {
         m = jsdrvp_msg_alloc(context);
+        uint32_t pool = m->pool;
         *m = *msg_src;
+        m->pool = pool;  // msg_class and payload_size match for normal messages
+        m->refcnt = 0;
         switch (m->value.type) {
             case JSDRV_UNION_JSON:  // intentional fall-through
-            case JSDRV_UNION_STR:
-                m->value.value.str = m->payload.str;
-                break;
+            case JSDRV_UNION_STR:   // intentional fall-through
             case JSDRV_UNION_BIN:
-                if (m->value.flags & JSDRV_UNION_FLAG_HEAP_MEMORY) {
+                if (m->value.flags & JSDRV_UNION_FLAG_SHARED_MEMORY) {
+                    jsdrv_value_shared_retain(m->value.value.bin);  // share, no copy
+                } else if (m->value.flags & JSDRV_UNION_FLAG_HEAP_MEMORY) {
                     uint8_t *ptr = jsdrv_alloc(m->value.size);
                     memcpy(ptr, m->value.value.bin, m->value.size);
                     m->value.value.bin = ptr;
-                } else {
+                } else if (m->value.value.bin == msg_src->payload.bin) {
                     m->value.value.bin = m->payload.bin;
-                }
+                }  // else static
                 break;
             default:
                 break;
@@ -161,7 +598,7 @@ struct jsdrvp_msg_s * jsdrvp_msg_alloc_value(struct jsdrv_context_s * context, c
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
     jsdrv_cstr_copy(m->topic, topic, sizeof(m->topic));
     m->value = *value;
-    m->value.flags &= ~JSDRV_UNION_FLAG_HEAP_MEMORY;
+    m->value.flags &= ~(JSDRV_UNION_FLAG_HEAP_MEMORY | JSDRV_UNION_FLAG_SHARED_MEMORY);
 
     switch (value->type) {
         case JSDRV_UNION_JSON:  /* intentional fall-through */
@@ -171,12 +608,17 @@ struct jsdrvp_msg_s * jsdrvp_msg_alloc_value(struct jsdrv_context_s * context, c
             }
             /* intentional fall-through */
         case JSDRV_UNION_BIN:
-            if (value->size > sizeof(m->payload.bin)) {
-                JSDRV_LOGD2("publish %s size %d using heap", topic, (int) value->size);
-                uint8_t * ptr = jsdrv_alloc(value->size);
-                memcpy(ptr, value->value.bin, value->size);
+            if (value->flags & JSDRV_UNION_FLAG_STATIC) {
+                break;  // borrow, no copy
+            } else if (value->flags & JSDRV_UNION_FLAG_SHARED_MEMORY) {
+                jsdrv_value_shared_retain(value->value.bin);
+                m->value.flags |= JSDRV_UNION_FLAG_SHARED_MEMORY;
+            } else if (m->value.size > sizeof(m->payload.bin)) {
+                JSDRV_LOGD2("publish %s size %d using heap", topic, (int) m->value.size);
+                uint8_t * ptr = jsdrv_value_shared_alloc(m->value.size);
+                memcpy(ptr, value->value.bin, m->value.size);
                 m->value.value.bin = ptr;
-                m->value.flags |= JSDRV_UNION_FLAG_HEAP_MEMORY;
+                m->value.flags |= JSDRV_UNION_FLAG_SHARED_MEMORY;
             } else {
                 m->value.value.bin = m->payload.bin;
                 memcpy(m->payload.bin, value->value.bin, m->value.size);
@@ -210,126 +652,683 @@ struct jsdrvp_msg_s * jsdrvp_msg_alloc_u32(struct jsdrv_context_s * context, con
     return m;
 }
 
+struct jsdrvp_msg_s * jsdrvp_msg_dispatch_ref(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg, uint32_t u32_a) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, "", sizeof(m->topic));
+    m->u32_a = u32_a;
+    jsdrv_atomic_add_u32(&msg->refcnt, 1);
+    m->payload.dispatch = msg;
+    return m;
+}
+
 static int32_t timeout_next_ms(struct jsdrv_context_s * c) {
-    struct jsdrv_list_s * item;
-    struct jsdrvp_api_timeout_s * timeout;
-    int64_t t = jsdrv_time_utc();
-    item = jsdrv_list_peek_head(&c->cmd_timeouts);
-    if (!item) {
-        return FRONTEND_THREAD_POLL_MS;  // maximum polling delay
+    int32_t rv = FRONTEND_THREAD_POLL_MS;  // maximum polling delay
+    uint32_t coalesce_ms = jsdrv_pubsub_timeout_ms(c->pubsub);
+    if (coalesce_ms < (uint32_t) rv) {
+        rv = (int32_t) coalesce_ms;
+    }
+    struct jsdrvp_api_timeout_s * timeout = jsdrv_timeouts_peek(c->cmd_timeouts);
+    if (!timeout) {
+        return rv;
     }
-    timeout = JSDRV_CONTAINER_OF(item, struct jsdrvp_api_timeout_s, item);
-    int64_t t_delta = timeout->timeout - t;
+    int64_t t_delta = timeout->timeout - jsdrv_time_utc();
     if (t_delta <= 0) {
         return 0;
     }
-    if (t_delta > (FRONTEND_THREAD_POLL_MS * JSDRV_TIME_MILLISECOND)) {
-        t_delta = FRONTEND_THREAD_POLL_MS * JSDRV_TIME_MILLISECOND;
+    if (t_delta > (rv * JSDRV_TIME_MILLISECOND)) {
+        return rv;
+    }
+    return (int32_t) JSDRV_TIME_TO_COUNTER(t_delta, 1000LL);
+}
+
+static void api_batch_release(struct jsdrvp_api_batch_s * batch) {
+    if (0 == jsdrv_atomic_add_u32(&batch->refs, (uint32_t) -1)) {
+        jsdrv_os_event_free(batch->ev);
+        jsdrv_free(batch);
+    }
+}
+
+static void api_timeout_init(struct jsdrvp_api_timeout_s * timeout, const char * topic, int64_t t_end) {
+    jsdrv_list_initialize(&timeout->item);
+    jsdrv_cstr_join(timeout->topic, topic, "#", sizeof(timeout->topic));
+    timeout->timeout = t_end;
+    timeout->ev = NULL;
+    timeout->return_code = 0;
+    timeout->batch = NULL;
+    timeout->completion_fn = NULL;
+    timeout->completion_user_data = NULL;
+}
+
+static void timeout_add(struct jsdrv_context_s * c, struct jsdrvp_api_timeout_s * timeout) {
+    jsdrv_timeouts_add(c->cmd_timeouts, timeout);
+}
+
+static void timeout_signal(struct jsdrvp_api_timeout_s * t, int32_t rc) {
+    t->return_code = rc;
+    if (t->completion_fn) {
+        char topic[JSDRV_TOPIC_LENGTH_MAX];
+        jsdrv_cstr_copy(topic, t->topic, sizeof(topic));
+        size_t sz = strlen(topic);
+        if (sz && (topic[sz - 1] == '#')) {
+            topic[sz - 1] = 0;
+        }
+        t->completion_fn(t->completion_user_data, topic, rc);
+        jsdrv_free(t);
+    } else if (NULL == t->batch) {
+        jsdrv_os_event_signal(t->ev);
+    } else if (0 == jsdrv_atomic_add_u32(&t->batch->remaining, (uint32_t) -1)) {
+        struct jsdrvp_api_batch_s * batch = t->batch;  // t is invalid once signaled
+        jsdrv_os_event_signal(batch->ev);
+        api_batch_release(batch);
+    }
+}
+
+static void timeout_process(struct jsdrv_context_s * c) {
+    struct jsdrvp_api_timeout_s * t;
+    int64_t t_now = jsdrv_time_utc();
+    while (NULL != (t = jsdrv_timeouts_pop_expired(c->cmd_timeouts, t_now))) {
+        timeout_signal(t, JSDRV_ERROR_TIMED_OUT);
+    }
+}
+
+static int32_t timeout_complete(struct jsdrv_context_s * c, const char * topic, int32_t rc) {
+    JSDRV_LOGD2("timeout_complete %s %d", topic, rc);
+    struct jsdrvp_api_timeout_s * t = jsdrv_timeouts_remove_topic(c->cmd_timeouts, topic);
+    if (t) {
+        timeout_signal(t, rc);
+        return 0;
+    }
+    JSDRV_LOGD1("timeout_complete not found: %s", topic);
+    return JSDRV_ERROR_NOT_FOUND;
+}
+
+static uint8_t on_return_code(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct jsdrv_context_s * c = (struct jsdrv_context_s *) user_data;
+    char value_str[128];
+    jsdrv_union_value_to_str(&msg->value, value_str, sizeof(value_str), 1);
+    JSDRV_LOGD1("on_return_code(%s) %s", msg->topic, value_str);
+    if (msg->value.type != JSDRV_UNION_I32) {
+        JSDRV_LOGW("on_return_code %s unsupported type %d", msg->topic, msg->value.type);
+        return 0;
+    }
+
+    timeout_complete(c, msg->topic,msg->value.value.i32);
+    return 0;
+}
+
+static void subscribe_return_code(struct jsdrv_context_s * c) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(c);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_SUBSCRIBE, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, "", sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = on_return_code;
+    m->payload.sub.subscriber.user_data = c;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = JSDRV_SFLAG_RETURN_CODE;
+    jsdrv_pubsub_publish(c->pubsub, m);
+}
+
+/**
+ * @brief Hash the device prefix of a topic in place.
+ *
+ * @param topic The topic, which starts with the 3-level device prefix.
+ * @param[out] length The prefix length in bytes.
+ * @return The FNV-1a hash of the prefix.
+ *
+ * Stream messages look up their device on every publish, so
+ * find the prefix in one pass without copying the topic.
+ */
+static uint32_t device_prefix_hash(const char * topic, uint32_t * length) {
+    uint32_t h = 2166136261U;  // FNV-1a
+    uint32_t count = 0;
+    uint32_t i = 0;
+    for (; topic[i] && (i < JSDRV_TOPIC_LENGTH_MAX); ++i) {
+        if ((topic[i] == '/') && (++count == 3)) {
+            break;
+        }
+        h ^= (uint8_t) topic[i];
+        h *= 16777619U;
+    }
+    *length = i;
+    return h;
+}
+
+static struct frontend_dev_s * device_find(struct jsdrv_context_s * c, const char * topic) {
+    struct frontend_dev_s * d = NULL;
+    struct jsdrv_list_s * item;
+    uint32_t length;
+    uint32_t h = device_prefix_hash(topic, &length);
+
+    jsdrv_list_foreach(&c->devices, item) {
+        d = JSDRV_CONTAINER_OF(item, struct frontend_dev_s, item);
+        if ((d->prefix_hash == h) && (d->prefix_length == length) && (0 == memcmp(d->prefix, topic, length))) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+static struct frontend_dev_s * device_lookup(struct jsdrv_context_s * c, const char * topic) {
+    struct frontend_dev_s * d = device_find(c, topic);
+    if (!d) {
+        uint32_t length;
+        device_prefix_hash(topic, &length);
+        JSDRV_LOGW("device_lookup(%s) => %.*s failed", topic, (int) length, topic);
+    }
+    return d;
+}
+
+static bool cmd_is_deferred(struct jsdrv_context_s * c, const char * topic) {
+    uint8_t prefix = (uint8_t) topic[0];
+    return c->init_lazy && (c->state == ST_INIT_AWAITING_BACKEND)
+            && (prefix < BACKEND_COUNT_MAX) && c->backends[prefix]
+            && (c->backends[prefix]->status == JSDRVBK_STATUS_INITIALIZING)
+            && (topic[1] == '/') && !device_find(c, topic);
+}
+
+/**
+ * @brief Hold a device command until its backend finishes the device scan.
+ *
+ * @param c The frontend context.
+ * @param msg The command message.
+ * @return True if deferred, which takes msg ownership.
+ *
+ * With JSDRV_ARG_INIT_LAZY, jsdrv_initialize() returns before the backends
+ * finish their initial scan.  Commands for devices that are not yet known
+ * would otherwise fail, so hold them until either the device appears or
+ * the backend completes its scan.
+ */
+static bool cmd_defer(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
+    if (!cmd_is_deferred(c, msg->topic)) {
+        return false;
+    }
+    JSDRV_LOGI("defer %s until the device scan completes", msg->topic);
+    jsdrv_list_add_tail(&c->cmd_deferred, &msg->item);
+    return true;
+}
+
+/**
+ * @brief Publish the deferred commands.
+ *
+ * @param c The frontend context.
+ * @param prefix The device prefix to release, or NULL to release all.
+ */
+static void cmd_deferred_release(struct jsdrv_context_s * c, const char * prefix) {
+    struct jsdrv_list_s * item;
+    uint32_t length = prefix ? (uint32_t) strlen(prefix) : 0;
+    jsdrv_list_foreach(&c->cmd_deferred, item) {
+        struct jsdrvp_msg_s * m = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+        if (prefix && ((0 != strncmp(m->topic, prefix, length)) || (m->topic[length] != '/'))) {
+            continue;
+        }
+        jsdrv_list_remove(item);
+        jsdrv_pubsub_publish(c->pubsub, m);  // device_removed_responder_fn() handles missing devices
+    }
+}
+
+static void cmd_deferred_free(struct jsdrv_context_s * c) {
+    while (!jsdrv_list_is_empty(&c->cmd_deferred)) {
+        struct jsdrv_list_s * item = jsdrv_list_remove_head(&c->cmd_deferred);
+        jsdrvp_msg_free(c, JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item));
+    }
+}
+
+static bool is_backend_initialization_complete(struct jsdrv_context_s * c) {
+    for (uint32_t i = 0; i < BACKEND_COUNT_MAX; ++i) {
+        if (c->backends[i] && (c->backends[i]->status == JSDRVBK_STATUS_INITIALIZING)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void init_complete(struct jsdrv_context_s * c) {
+    JSDRV_ASSERT(c->state == ST_INIT_AWAITING_BACKEND);
+    if (is_backend_initialization_complete(c)) {
+        c->args = NULL;  // only valid for the duration of INITIALIZE
+        c->state = ST_ACTIVE;
+        JSDRV_LOGI("init_complete");
+        if (c->init_lazy) {
+            // jsdrv_initialize() already returned
+            if (c->init_status) {
+                JSDRV_LOGW("lazy initialization failed with %d", (int) c->init_status);
+            }
+            cmd_deferred_release(c, NULL);
+        } else {
+            timeout_complete(c, JSDRV_MSG_INITIALIZE "#", c->init_status);
+        }
+    }
+}
+
+static void stats_topic_request(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
+    struct jsdrv_union_s v = msg->value;
+    bool enable = (0 == jsdrv_union_as_type(&v, JSDRV_UNION_U32)) && v.value.u32;
+    jsdrvp_msg_free(c, msg);
+    if (c->stats_topic_enable) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(c);
+        jsdrv_cstr_copy(m->topic, JSDRV_MSG_STATS_TOPIC, sizeof(m->topic));
+        jsdrv_pubsub_stats(c->pubsub, m->payload.str, sizeof(m->payload.str));
+        m->value = jsdrv_union_cjson_r(m->payload.str);
+        m->value.size = (uint32_t) (strlen(m->payload.str) + 1);
+        jsdrv_pubsub_publish(c->pubsub, m);
+    }
+    c->stats_topic_enable = enable;
+    jsdrv_pubsub_stats_enable(c->pubsub, enable);
+}
+
+static void log_level_request(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
+    struct jsdrv_topic_s topic;
+    struct jsdrv_union_s v = msg->value;
+    int32_t rc = jsdrv_union_as_type(&v, JSDRV_UNION_I32);
+    if (0 == rc) {
+        rc = jsdrv_log_module_level_set(msg->topic + strlen(JSDRV_MSG_LOG_LEVEL_PREFIX), (int8_t) v.value.i32);
+    }
+    if (rc) {
+        JSDRV_LOGW("%s: invalid, %d", msg->topic, (int) rc);
+    }
+    jsdrv_topic_set(&topic, msg->topic);
+    jsdrv_topic_suffix_add(&topic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+    jsdrvp_msg_free(c, msg);
+    timeout_complete(c, topic.topic, rc);
+}
+
+static int32_t trace_enable_request(struct jsdrvp_msg_s * msg) {
+    struct jsdrv_union_s v = msg->value;
+    int32_t rc = jsdrv_union_as_type(&v, JSDRV_UNION_U32);
+    if (0 == rc) {
+        if (v.value.u32) {
+            jsdrv_trace_clear();
+        }
+        jsdrv_trace_enable(0 != v.value.u32);
+    }
+    return rc;
+}
+
+static int32_t trace_export_request(struct jsdrvp_msg_s * msg) {
+    if ((msg->value.type != JSDRV_UNION_STR) || !msg->value.value.str || !msg->value.value.str[0]) {
+        JSDRV_LOGW("%s: invalid path", msg->topic);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    int32_t rc = jsdrv_trace_export(msg->value.value.str);
+    if (rc) {
+        JSDRV_LOGW("%s: export to %s failed %d", msg->topic, msg->value.value.str, (int) rc);
+    }
+    return rc;
+}
+
+struct stats_json_s {
+    char * p;
+    char * p_end;
+    uint32_t count;
+};
+
+static void stats_json_append(struct stats_json_s * j, const char * fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int sz = tfp_vsnprintf(j->p, j->p_end - j->p, fmt, args);
+    va_end(args);
+    // on truncation, keep the terminator and discard the remainder
+    j->p = ((j->p + sz) < j->p_end) ? (j->p + sz) : (j->p_end - 1);
+}
+
+static struct group_s * group_find(struct jsdrv_context_s * c, const char * topic, uint32_t length) {
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&c->groups, item) {
+        struct group_s * g = JSDRV_CONTAINER_OF(item, struct group_s, item);
+        if ((0 == strncmp(g->topic, topic, length)) && !g->topic[length]) {
+            return g;
+        }
+    }
+    return NULL;
+}
+
+static void group_list_publish(struct jsdrv_context_s * c, struct group_s * g) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(c, "", JSDRV_GROUP_MEMBER_MAX * JSDRV_TOPIC_LENGTH_MAX);
+    char * str = (char *) m->payload.bin;
+    struct stats_json_s j = {.p = str, .p_end = str + m->payload_size, .count = 0};
+    *str = 0;
+    for (uint32_t i = 0; i < g->member_count; ++i) {
+        stats_json_append(&j, "%s%s", i ? "," : "", g->members[i].prefix);
+    }
+    tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", g->topic, JSDRV_GROUP_LIST);
+    m->value = jsdrv_union_cstr_r(str);
+    m->value.size = (uint32_t) (strlen(str) + 1);
+    jsdrv_pubsub_publish(c->pubsub, m);
+}
+
+static void group_start_disarm(struct jsdrv_context_s * c, struct group_s * g) {
+    for (uint32_t i = 0; i < g->member_count; ++i) {
+        g->members[i].start_pending = false;
+    }
+    c->group_start_pending -= g->start_pending;
+    g->start_pending = 0;
+}
+
+/**
+ * @brief Arm the start window report for a stream enable.
+ *
+ * @param c The frontend context.
+ * @param g The device group.
+ * @param subtopic The published device subtopic.
+ * @param value The published value.
+ * @return True when subtopic enables a stream, such as "s/i/ctrl" = 1.
+ */
+static bool group_start_arm(struct jsdrv_context_s * c, struct group_s * g,
+                            const char * subtopic, const struct jsdrv_union_s * value) {
+    if (!jsdrv_cstr_starts_with(subtopic, "s/") || !jsdrv_cstr_ends_with(subtopic, "/ctrl")) {
+        return false;
+    }
+    group_start_disarm(c, g);
+    struct jsdrv_union_s v = *value;
+    if (jsdrv_union_as_type(&v, JSDRV_UNION_U32) || !v.value.u32) {
+        return false;
+    }
+    size_t sz = strlen(subtopic) - 4;  // keep the trailing '/'
+    memcpy(g->start_subtopic, subtopic, sz);
+    jsdrv_cstr_copy(g->start_subtopic + sz, "!data", sizeof(g->start_subtopic) - sz);
+    return true;
+}
+
+static void group_start_publish(struct jsdrv_context_s * c, struct group_s * g) {
+    int64_t utc_min = INT64_MAX;
+    int64_t utc_max = INT64_MIN;
+    if (!g->member_count) {
+        return;
+    }
+    for (uint32_t i = 0; i < g->member_count; ++i) {
+        struct group_member_s * member = &g->members[i];
+        int64_t utc = jsdrv_time_from_counter(&member->time_map, member->sample_id);
+        utc_min = (utc < utc_min) ? utc : utc_min;
+        utc_max = (utc > utc_max) ? utc : utc_max;
+    }
+
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(c, "", JSDRV_GROUP_MEMBER_MAX * 2 * JSDRV_TOPIC_LENGTH_MAX);
+    char * str = (char *) m->payload.bin;
+    struct stats_json_s j = {.p = str, .p_end = str + m->payload_size, .count = 0};
+    stats_json_append(&j, "{\"utc\": %lld, \"skew\": %lld, \"devices\": [",
+                      (long long) utc_max, (long long) (utc_max - utc_min));
+    for (uint32_t i = 0; i < g->member_count; ++i) {
+        struct group_member_s * member = &g->members[i];
+        stats_json_append(&j, "%s{\"device\": \"%s\", \"sample_id\": %llu, \"sample_id_start\": %llu}",
+                          i ? ", " : "", member->prefix, (unsigned long long) member->sample_id,
+                          (unsigned long long) jsdrv_time_to_counter(&member->time_map, utc_max));
+    }
+    stats_json_append(&j, "]}");
+    tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", g->topic, JSDRV_GROUP_START);
+    m->value = jsdrv_union_cjson_r(str);
+    m->value.size = (uint32_t) (strlen(str) + 1);
+    jsdrv_pubsub_publish(c->pubsub, m);
+}
+
+static bool group_member_topic(const struct group_member_s * member, const char * topic, const char * subtopic) {
+    size_t sz = strlen(member->prefix);
+    return (0 == strncmp(topic, member->prefix, sz)) && (topic[sz] == '/') && (0 == strcmp(topic + sz + 1, subtopic));
+}
+
+/**
+ * @brief Record the first stream data for armed group members.
+ *
+ * @param c The frontend context.
+ * @param msg The device data message.
+ */
+static void group_start_check(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
+    if ((msg->inner_msg_type != JSDRV_MSG_TYPE_DATA) || (msg->value.app != JSDRV_PAYLOAD_TYPE_STREAM)
+            || (msg->value.size < JSDRV_STREAM_HEADER_SIZE)) {
+        return;
+    }
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) msg->value.value.bin;
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&c->groups, item) {
+        struct group_s * g = JSDRV_CONTAINER_OF(item, struct group_s, item);
+        for (uint32_t i = 0; g->start_pending && (i < g->member_count); ++i) {
+            struct group_member_s * member = &g->members[i];
+            if (!member->start_pending || !group_member_topic(member, msg->topic, g->start_subtopic)) {
+                continue;
+            }
+            member->start_pending = false;
+            member->sample_id = s->sample_id;
+            member->time_map = s->time_map;
+            --c->group_start_pending;
+            if (0 == --g->start_pending) {
+                group_start_publish(c, g);
+            }
+        }
     }
-    return (int32_t) JSDRV_TIME_TO_COUNTER(t_delta, 1000LL);
 }
 
-static void timeout_add(struct jsdrv_context_s * c, struct jsdrvp_api_timeout_s * timeout) {
+/**
+ * @brief Combine the member statistics into the group statistics.
+ *
+ * @param c The frontend context.
+ * @param msg The device statistics message.
+ */
+static void group_stats_check(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
+    if ((msg->value.type != JSDRV_UNION_BIN) || (msg->value.size < sizeof(struct jsdrv_statistics_s))) {
+        return;
+    }
+    const struct jsdrv_statistics_s * block = (const struct jsdrv_statistics_s *) msg->value.value.bin;
     struct jsdrv_list_s * item;
-    struct jsdrvp_api_timeout_s * t;
-    jsdrv_list_add_tail(&c->cmd_timeouts, &timeout->item);
-    jsdrv_list_foreach(&c->cmd_timeouts, item) {
-        t = JSDRV_CONTAINER_OF(item, struct jsdrvp_api_timeout_s, item);
-        if (timeout->timeout < t->timeout) {
-            jsdrv_list_remove(&timeout->item);
-            jsdrv_list_insert_before(item, &timeout->item);
+    jsdrv_list_foreach(&c->groups, item) {
+        struct group_s * g = JSDRV_CONTAINER_OF(item, struct group_s, item);
+        for (uint32_t i = 0; g->stats_subtopic[0] && (i < g->member_count); ++i) {
+            if (!group_member_topic(&g->members[i], msg->topic, g->stats_subtopic)) {
+                continue;
+            }
+            const struct jsdrv_statistics_s * v = jsdrv_stats_group_add(&g->stats, i, block);
+            if (v) {
+                struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(c);
+                tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", g->topic, JSDRV_GROUP_STATS);
+                struct jsdrv_statistics_s * dst = (struct jsdrv_statistics_s *) m->payload.bin;
+                *dst = *v;
+                m->value = jsdrv_union_cbin_r((uint8_t *) dst, sizeof(*dst));
+                m->value.app = JSDRV_PAYLOAD_TYPE_STATISTICS;
+                jsdrv_pubsub_publish(c->pubsub, m);
+            }
             break;
         }
     }
 }
 
-static void timeout_process(struct jsdrv_context_s * c) {
-    struct jsdrv_list_s * item;
-    struct jsdrvp_api_timeout_s * t;
-    int64_t t_now = jsdrv_time_utc();
-    jsdrv_list_foreach(&c->cmd_timeouts, item) {
-        t = JSDRV_CONTAINER_OF(item, struct jsdrvp_api_timeout_s, item);
-        if (t->timeout <= t_now) {
-            jsdrv_list_remove(item);
-            t->return_code = JSDRV_ERROR_TIMED_OUT;
-            jsdrv_os_event_signal(t->ev);
-        } else {
-            break;
+static int32_t group_add(struct jsdrv_context_s * c, const char * topic, uint32_t length, const char * prefix) {
+    struct group_s * g = group_find(c, topic, length);
+    if (!g) {
+        g = jsdrv_alloc_clr(sizeof(struct group_s));
+        memcpy(g->topic, topic, length);
+        jsdrv_cstr_copy(g->stats_subtopic, GROUP_STATS_SUBTOPIC_DEFAULT, sizeof(g->stats_subtopic));
+        jsdrv_list_initialize(&g->item);
+        jsdrv_list_add_tail(&c->groups, &g->item);
+    }
+    for (uint32_t i = 0; i < g->member_count; ++i) {
+        if (0 == strcmp(g->members[i].prefix, prefix)) {
+            return 0;  // already a member
         }
     }
+    if (g->member_count >= JSDRV_GROUP_MEMBER_MAX) {
+        return JSDRV_ERROR_FULL;
+    }
+    struct group_member_s * member = &g->members[g->member_count++];
+    memset(member, 0, sizeof(*member));
+    jsdrv_cstr_copy(member->prefix, prefix, sizeof(member->prefix));
+    jsdrv_stats_group_initialize(&g->stats, g->member_count);
+    group_list_publish(c, g);
+    return 0;
 }
 
-static int32_t timeout_complete(struct jsdrv_context_s * c, const char * topic, int32_t rc) {
-    struct jsdrv_list_s * item;
-    struct jsdrvp_api_timeout_s * t;
-    JSDRV_LOGD2("timeout_complete %s %d", topic, rc);
+static void group_free(struct jsdrv_context_s * c, struct group_s * g) {
+    group_start_disarm(c, g);
+    jsdrv_list_remove(&g->item);
+    jsdrv_free(g);
+}
 
-    jsdrv_list_foreach(&c->cmd_timeouts, item) {
-        t = JSDRV_CONTAINER_OF(item, struct jsdrvp_api_timeout_s, item);
-        if (0 == strcmp(t->topic, topic)) {
-            jsdrv_list_remove(item);
-            t->return_code = rc;
-            jsdrv_os_event_signal(t->ev);
-            return 0;
-        }
+static void group_free_all(struct jsdrv_context_s * c) {
+    while (!jsdrv_list_is_empty(&c->groups)) {
+        group_free(c, JSDRV_CONTAINER_OF(c->groups.next, struct group_s, item));
     }
-    JSDRV_LOGD1("timeout_complete not found: %s", topic);
-    return JSDRV_ERROR_NOT_FOUND;
 }
 
-static uint8_t on_return_code(void * user_data, struct jsdrvp_msg_s * msg) {
-    struct jsdrv_context_s * c = (struct jsdrv_context_s *) user_data;
-    char value_str[128];
-    jsdrv_union_value_to_str(&msg->value, value_str, sizeof(value_str), 1);
-    JSDRV_LOGD1("on_return_code(%s) %s", msg->topic, value_str);
-    if (msg->value.type != JSDRV_UNION_I32) {
-        JSDRV_LOGW("on_return_code %s unsupported type %d", msg->topic, msg->value.type);
+static int32_t group_remove(struct jsdrv_context_s * c, const char * topic, uint32_t length, const char * prefix) {
+    struct group_s * g = group_find(c, topic, length);
+    if (!g) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    if (!prefix[0]) {
+        g->member_count = 0;
+        group_list_publish(c, g);
+        group_free(c, g);
         return 0;
     }
-
-    timeout_complete(c, msg->topic,msg->value.value.i32);
-    return 0;
+    for (uint32_t i = 0; i < g->member_count; ++i) {
+        if (0 == strcmp(g->members[i].prefix, prefix)) {
+            group_start_disarm(c, g);  // the pending start window no longer covers the group
+            --g->member_count;
+            memmove(&g->members[i], &g->members[i + 1], (g->member_count - i) * sizeof(g->members[0]));
+            jsdrv_stats_group_initialize(&g->stats, g->member_count);
+            group_list_publish(c, g);
+            return 0;
+        }
+    }
+    return JSDRV_ERROR_NOT_FOUND;
 }
 
-static void subscribe_return_code(struct jsdrv_context_s * c) {
-    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(c);
-    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_SUBSCRIBE, sizeof(m->topic));
-    m->value.type = JSDRV_UNION_BIN;
-    m->value.value.bin = m->payload.bin;
-    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
-    jsdrv_cstr_copy(m->payload.sub.topic, "", sizeof(m->payload.sub.topic));
-    m->payload.sub.subscriber.internal_fn = on_return_code;
-    m->payload.sub.subscriber.user_data = c;
-    m->payload.sub.subscriber.is_internal = 1;
-    m->payload.sub.subscriber.flags = JSDRV_SFLAG_RETURN_CODE;
-    jsdrv_pubsub_publish(c->pubsub, m);
+static void group_op_complete(void * user_data, const char * topic, int32_t return_code) {
+    (void) topic;
+    struct group_op_s * op = (struct group_op_s *) user_data;
+    if (return_code && !op->return_code) {
+        op->return_code = return_code;
+    }
+    if (0 == --op->remaining) {
+        timeout_complete(op->context, op->topic, op->return_code);
+        jsdrv_free(op);
+    }
 }
 
-static bool is_backend_initialization_complete(struct jsdrv_context_s * c) {
-    for (uint32_t i = 0; i < BACKEND_COUNT_MAX; ++i) {
-        if (c->backends[i] && (c->backends[i]->status == JSDRVBK_STATUS_INITIALIZING)) {
-            return false;
+/**
+ * @brief Publish a device command to every group member.
+ *
+ * @param c The frontend context.
+ * @param g The device group.
+ * @param msg The group command message, which the caller still owns.
+ * @param subtopic The device subtopic.
+ * @param t_end The group command timeout or 0 when the caller does not wait.
+ *
+ * All member messages publish in this frontend operation, so the
+ * device threads receive their commands back to back.
+ */
+static void group_publish(struct jsdrv_context_s * c, struct group_s * g, struct jsdrvp_msg_s * msg,
+                          const char * subtopic, int64_t t_end) {
+    struct group_op_s * op = NULL;
+    if (t_end) {
+        op = jsdrv_alloc_clr(sizeof(struct group_op_s));
+        op->context = c;
+        jsdrv_cstr_join(op->topic, msg->topic, "#", sizeof(op->topic));
+        op->remaining = 1;  // hold until all members publish
+    }
+    bool start = group_start_arm(c, g, subtopic, &msg->value);
+
+    for (uint32_t i = 0; i < g->member_count; ++i) {
+        struct group_member_s * member = &g->members[i];
+        struct jsdrvp_msg_s * m = jsdrvp_msg_clone(c, msg);
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", member->prefix, subtopic);
+        m->topic_id = 0;
+        if (!device_find(c, m->topic) && !cmd_is_deferred(c, m->topic)) {
+            JSDRV_LOGW("group %s member %s not found", g->topic, member->prefix);
+            jsdrvp_msg_free(c, m);
+            if (op && !op->return_code) {
+                op->return_code = JSDRV_ERROR_NOT_FOUND;
+            }
+            continue;
+        }
+        if (op) {
+            struct jsdrvp_api_timeout_s * t = jsdrv_alloc(sizeof(struct jsdrvp_api_timeout_s));
+            api_timeout_init(t, m->topic, t_end);
+            t->completion_fn = group_op_complete;
+            t->completion_user_data = op;
+            timeout_add(c, t);
+            ++op->remaining;
+        }
+        if (start) {
+            member->start_pending = true;
+            ++g->start_pending;
+            ++c->group_start_pending;
+        }
+        if (!cmd_defer(c, m)) {
+            jsdrv_pubsub_publish(c->pubsub, m);  // msg ownership relinquished
         }
     }
-    return true;
+    if (op) {
+        group_op_complete(op, NULL, 0);
+    }
 }
 
-static void init_complete(struct jsdrv_context_s * c) {
-    JSDRV_ASSERT(c->state == ST_INIT_AWAITING_BACKEND);
-    if (is_backend_initialization_complete(c)) {
-        c->args = NULL;  // only valid for the duration of INITIALIZE
-        c->state = ST_ACTIVE;
-        JSDRV_LOGI("init_complete");
-        timeout_complete(c, JSDRV_MSG_INITIALIZE "#", c->init_status);
+/**
+ * @brief Handle a JSDRV_MSG_GROUP_PREFIX command.
+ *
+ * @param c The frontend context.
+ * @param msg The command message, which this function frees.
+ * @param t_end The command timeout or 0 when the caller does not wait.
+ */
+static void group_request(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg, int64_t t_end) {
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    int32_t rc = 0;
+    const char * name = msg->topic + strlen(JSDRV_MSG_GROUP_PREFIX);
+    const char * subtopic = strchr(name, '/');
+    jsdrv_cstr_join(topic, msg->topic, "#", sizeof(topic));
+    if (!subtopic || (subtopic == name) || !subtopic[1]) {
+        rc = JSDRV_ERROR_PARAMETER_INVALID;
+    } else {
+        uint32_t length = (uint32_t) (subtopic - msg->topic);
+        ++subtopic;
+        bool add = (0 == strcmp(JSDRV_GROUP_ADD, subtopic));
+        if (add || (0 == strcmp(JSDRV_GROUP_REMOVE, subtopic))) {
+            const char * prefix = msg->value.value.str;
+            // leave room in the member topics for the device subtopic
+            if ((msg->value.type != JSDRV_UNION_STR) || (strlen(prefix) >= (JSDRV_TOPIC_LENGTH_MAX / 2))) {
+                rc = JSDRV_ERROR_PARAMETER_INVALID;
+            } else if (!add) {
+                rc = group_remove(c, msg->topic, length, prefix);
+            } else if (prefix[0]) {
+                rc = group_add(c, msg->topic, length, prefix);
+            } else {
+                rc = JSDRV_ERROR_PARAMETER_INVALID;
+            }
+        } else if (0 == strcmp(JSDRV_GROUP_STATS_TOPIC, subtopic)) {
+            struct group_s * g = group_find(c, msg->topic, length);
+            if (!g) {
+                rc = JSDRV_ERROR_NOT_FOUND;
+            } else if (msg->value.type != JSDRV_UNION_STR) {
+                rc = JSDRV_ERROR_PARAMETER_INVALID;
+            } else {
+                jsdrv_cstr_copy(g->stats_subtopic, msg->value.value.str, sizeof(g->stats_subtopic));
+                jsdrv_stats_group_initialize(&g->stats, g->member_count);
+            }
+        } else {
+            struct group_s * g = group_find(c, msg->topic, length);
+            if (g) {
+                group_publish(c, g, msg, subtopic, t_end);
+                jsdrvp_msg_free(c, msg);
+                return;  // group_op_complete() provides the return code
+            }
+            rc = JSDRV_ERROR_NOT_FOUND;
+        }
+    }
+    if (rc) {
+        JSDRV_LOGW("%s failed with %d", msg->topic, (int) rc);
     }
+    jsdrvp_msg_free(c, msg);
+    timeout_complete(c, topic, rc);
 }
 
 static bool handle_cmd_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
+    int64_t t_end = 0;
     if (!msg) {
         return false;
     }
     JSDRV_LOGD1("handle_cmd_msg %s", msg->topic);
+    ++c->api_popped;
     if (msg->timeout) {
+        t_end = msg->timeout->timeout;
         timeout_add(c, msg->timeout);
         msg->timeout = NULL;
     }
@@ -338,6 +1337,11 @@ static bool handle_cmd_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg
         if (0 == strcmp(JSDRV_MSG_INITIALIZE, msg->topic)) {
             if (c->state == ST_INIT_AWAITING_FRONTEND) {
                 c->state = ST_INIT_AWAITING_BACKEND;
+                if (c->init_lazy) {
+                    // The backend factories already ran, so return now and scan in the background.
+                    c->args = NULL;
+                    timeout_complete(c, JSDRV_MSG_INITIALIZE "#", 0);
+                }
                 init_complete(c);
             }
             jsdrvp_msg_free(c, msg);
@@ -353,40 +1357,35 @@ static bool handle_cmd_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg
             jsdrvp_msg_free(c, msg);
             JSDRV_LOGI("%s request", JSDRV_MSG_TIMEOUT);
             return true;
+        } else if (0 == strcmp(JSDRV_MSG_STATS_TOPIC_REQ, msg->topic)) {
+            stats_topic_request(c, msg);
+            timeout_complete(c, JSDRV_MSG_STATS_TOPIC_REQ "#", 0);
+            return true;
+        } else if (jsdrv_cstr_starts_with(msg->topic, JSDRV_MSG_LOG_LEVEL_PREFIX)) {
+            log_level_request(c, msg);
+            return true;
+        } else if (0 == strcmp(JSDRV_MSG_TRACE_ENABLE, msg->topic)) {
+            int32_t rc = trace_enable_request(msg);
+            jsdrvp_msg_free(c, msg);
+            timeout_complete(c, JSDRV_MSG_TRACE_ENABLE "#", rc);
+            return true;
+        } else if (0 == strcmp(JSDRV_MSG_TRACE_EXPORT, msg->topic)) {
+            int32_t rc = trace_export_request(msg);
+            jsdrvp_msg_free(c, msg);
+            timeout_complete(c, JSDRV_MSG_TRACE_EXPORT "#", rc);
+            return true;
+        } else if (jsdrv_cstr_starts_with(msg->topic, JSDRV_MSG_GROUP_PREFIX)) {
+            group_request(c, msg, t_end);
+            return true;
         }
     }
+    if (cmd_defer(c, msg)) {
+        return true;
+    }
     jsdrv_pubsub_publish(c->pubsub, msg);  // msg ownership relinquished
     return true;
 }
 
-static struct frontend_dev_s * device_lookup(struct jsdrv_context_s * c, const char * topic) {
-    struct jsdrv_topic_s t;
-    struct frontend_dev_s * d = NULL;
-    struct jsdrv_list_s * item;
-
-    jsdrv_topic_set(&t, topic);
-    int count = 0;
-    int i = 0;
-    for (i = 0; t.topic[i]; ++i) {
-        if (t.topic[i] == '/') {
-            ++count;
-            if (count == 3) {
-                break;
-            }
-        }
-    }
-    t.topic[i] = 0;
-
-    jsdrv_list_foreach(&c->devices, item) {
-        d = JSDRV_CONTAINER_OF(item, struct frontend_dev_s, item);
-        if (0 == strcmp(d->prefix, t.topic)) {
-            return d;
-        }
-    }
-    JSDRV_LOGW("device_lookup(%s) => %s failed", topic, t.topic);
-    return NULL;
-}
-
 static uint8_t device_removed_responder_fn(void * user_data, struct jsdrvp_msg_s * msg) {
     int32_t rc;
     struct jsdrv_context_s * c = (struct jsdrv_context_s *) user_data;
@@ -419,9 +1418,28 @@ static void device_removed_responder(struct jsdrv_context_s * c, const char * pr
     jsdrv_pubsub_publish(c->pubsub, sub_msg);
 }
 
+static int32_t device_instantiate(struct frontend_dev_s * d) {
+    if (d->device) {
+        return 0;
+    }
+    int32_t rv = d->factory(&d->device, d->context, &d->ll);
+    if (rv) {
+        JSDRV_LOGE("device_instantiate(%s) failed with %d", d->prefix, (int) rv);
+        d->device = NULL;
+    }
+    return rv;
+}
+
 static uint8_t device_subscriber(void * user_data, struct jsdrvp_msg_s * msg) {
     JSDRV_LOGD2("device_subscriber %s", msg->topic);
     struct frontend_dev_s * d = (struct frontend_dev_s *) user_data;
+    int32_t rv = device_instantiate(d);  // on first use with JSDRV_ARG_INIT_LAZY
+    if (rv) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_i32(d->context, "", rv);
+        jsdrv_cstr_join(m->topic, msg->topic, "#", sizeof(m->topic));
+        jsdrv_pubsub_publish(d->context->pubsub, m);
+        return 0;
+    }
     struct jsdrvp_msg_s * m = jsdrvp_msg_clone(d->context, msg);
     msg_queue_push(d->device->cmd_q, m);
     return 0;
@@ -467,6 +1485,27 @@ void jsdrvp_device_unsubscribe(struct jsdrv_context_s * context, const char * de
     jsdrvp_backend_send(context, m);
 }
 
+void jsdrvp_device_watch(struct jsdrv_context_s * context, const char * dev_topic,
+                         const char * topic, bool enable) {
+    struct frontend_dev_s * dev = device_lookup(context, dev_topic);
+    if (NULL == dev) {
+        JSDRV_LOGE("jsdrvp_device_watch but device not found: %s", dev_topic);
+        return;
+    }
+    JSDRV_LOGD1("jsdrvp_device_watch %s : %s %d", dev_topic, topic, (int) enable);
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, enable ? JSDRV_PUBSUB_WATCH : JSDRV_PUBSUB_UNWATCH, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, topic, sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = device_subscriber;
+    m->payload.sub.subscriber.user_data = dev;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = JSDRV_SFLAG_PUB;
+    jsdrvp_backend_send(context, m);
+}
+
 static void device_sub(struct frontend_dev_s * d, const char * op) {
     struct jsdrvp_msg_s * sub_msg = jsdrvp_msg_alloc(d->context);
     jsdrv_cstr_copy(sub_msg->topic, op, sizeof(sub_msg->topic));
@@ -491,6 +1530,17 @@ static void device_prefix_to_model(const char * prefix, char * model) {
     *model = 0;
 }
 
+static device_factory_fn device_factory(const char * model) {
+    if (0 == strcmp("js220", model)) {
+        return jsdrvp_ul_js220_usb_factory;
+    } else if (0 == strcmp("js110", model)) {
+        return jsdrvp_ul_js110_usb_factory;
+    } else if (0 == strcmp("&js220", model))  {
+        return jsdrvp_ul_js220_usb_factory;
+    }
+    return NULL;
+}
+
 static void device_add_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
     JSDRV_ASSERT(c && msg);
     JSDRV_ASSERT(msg->value.type == JSDRV_UNION_BIN);
@@ -503,23 +1553,20 @@ static void device_add_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg
     d->context = c;
     jsdrv_list_initialize(&d->item);
     jsdrv_cstr_copy(d->prefix, msg->payload.device.prefix, sizeof(d->prefix));
+    d->prefix_hash = device_prefix_hash(d->prefix, &d->prefix_length);
+    d->factory = device_factory(model);
+    d->ll = msg->payload.device;
     jsdrv_list_add_tail(&c->devices, &d->item);
 
-    int rv = 1;
-    if (0 == strcmp("js220", model)) {
-        rv = jsdrvp_ul_js220_usb_factory(&d->device, c, &msg->payload.device);
-    } else if (0 == strcmp("js110", model)) {
-        rv = jsdrvp_ul_js110_usb_factory(&d->device, c, &msg->payload.device);
-    } else if (0 == strcmp("&js220", model))  {
-        rv = jsdrvp_ul_js220_usb_factory(&d->device, c, &msg->payload.device);
-#if UNITTEST == 0
-    //} else if (0 == strcmp("emu", model)) {
-    //    rv = jsdrvp_ul_emu_factory(&d->device, c, &msg->payload.device);
-#endif
+    int32_t rv = 1;
+    if (d->factory) {
+        // With JSDRV_ARG_INIT_LAZY, start the driver thread on first use.
+        rv = c->init_lazy ? 0 : device_instantiate(d);
     }
     if (rv) {
-        JSDRV_LOGE("device_add(%s) failed with %d", model, rv);
+        JSDRV_LOGE("device_add(%s) failed with %d", model, (int) rv);
         jsdrvp_msg_free(c, msg);
+        jsdrv_list_remove(&d->item);
         jsdrv_free(d);
         // todo indicate device failure?
         return;
@@ -529,6 +1576,7 @@ static void device_add_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg
     jsdrv_pubsub_publish(c->pubsub, msg);  // transfers msg ownership
     device_removed_responder(c, d->prefix, JSDRV_PUBSUB_UNSUBSCRIBE);
     device_sub(d, JSDRV_PUBSUB_SUBSCRIBE);
+    cmd_deferred_release(c, d->prefix);
 }
 
 static void device_remove(struct jsdrv_context_s * c, struct frontend_dev_s * d) {
@@ -536,7 +1584,9 @@ static void device_remove(struct jsdrv_context_s * c, struct frontend_dev_s * d)
     if (!d) {
         return;
     }
-    d->device->join(d->device);
+    if (d->device) {
+        d->device->join(d->device);
+    }
     device_removed_responder(c, d->prefix, JSDRV_PUBSUB_SUBSCRIBE);
     device_sub(d, JSDRV_PUBSUB_UNSUBSCRIBE);
     // todo update state
@@ -617,18 +1667,71 @@ static void device_list_publish(struct jsdrv_context_s * c) {
     jsdrv_pubsub_publish(c->pubsub, m);  // transfers msg ownership
 }
 
+static void device_list_flush(struct jsdrv_context_s * c) {
+    if (c->device_list_dirty) {
+        // one list for a burst of hotplug changes, @/!add and @/!remove carry the deltas
+        c->device_list_dirty = false;
+        device_list_publish(c);
+    }
+}
+
+static void device_latency_publish(struct jsdrv_context_s * c, struct frontend_dev_s * d) {
+    uint32_t t_now = jsdrv_time_ms_u32();
+    if ((t_now - d->latency_time_ms) < LATENCY_INTERVAL_MS) {
+        return;
+    }
+    d->latency_time_ms = t_now;
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(c);
+    if (!jsdrv_latency_hist_json(&d->latency, m->payload.str, sizeof(m->payload.str))) {
+        jsdrvp_msg_free(c, m);
+        return;
+    }
+    tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", d->prefix, STREAM_LATENCY_E2E);
+    m->value = jsdrv_union_cjson_r(m->payload.str);
+    m->value.size = (uint32_t) (strlen(m->payload.str) + 1);
+    m->extra.frontend.subscriber.internal_fn = device_subscriber;  // not a device command
+    m->extra.frontend.subscriber.user_data = d;
+    m->extra.frontend.subscriber.is_internal = 1;
+    jsdrv_pubsub_publish(c->pubsub, m);
+}
+
+static void device_stream_stamp(struct jsdrv_context_s * c, struct frontend_dev_s * d, struct jsdrvp_msg_s * msg) {
+    if ((msg->inner_msg_type != JSDRV_MSG_TYPE_DATA) || (msg->value.app != JSDRV_PAYLOAD_TYPE_STREAM)
+            || (msg->value.size < JSDRV_STREAM_HEADER_SIZE)) {
+        return;
+    }
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) msg->value.value.bin;
+    s->host_time.publish = jsdrv_time_utc();
+    if (s->host_time.usb) {
+        jsdrv_latency_hist_add(&d->latency, s->host_time.publish - s->host_time.usb);
+        device_latency_publish(c, d);
+    }
+}
+
 static bool handle_backend_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s * msg) {
     if (!msg) {
         return false;
     }
+    if (msg->topic_id && !msg->topic[0]) {
+        const char * topic = jsdrv_pubsub_topic_name(c->pubsub, msg->topic_id);
+        if (!topic) {
+            JSDRV_LOGW("handle_backend_msg invalid topic_id %u", (unsigned int) msg->topic_id);
+            jsdrvp_msg_free(c, msg);
+            return true;
+        }
+        jsdrv_cstr_copy(msg->topic, topic, sizeof(msg->topic));
+    }
     JSDRV_LOGD3("handle_backend_msg %s", msg->topic);
+    if (msg->topic[0] != JSDRV_MSG_COMMAND_PREFIX_CHAR) {
+        device_list_flush(c);  // list new devices before forwarding their messages
+    }
     if (msg->topic[0] == JSDRV_MSG_COMMAND_PREFIX_CHAR) {
         if (0 == strcmp(JSDRV_MSG_DEVICE_ADD, msg->topic)) {
             device_add_msg(c, msg);
-            device_list_publish(c);
+            c->device_list_dirty = true;
         } else if (0 == strcmp(JSDRV_MSG_DEVICE_REMOVE, msg->topic)) {
             device_remove_msg(c, msg);
-            device_list_publish(c);
+            c->device_list_dirty = true;
         } else if (0 == strcmp(JSDRV_MSG_INITIALIZE, msg->topic)) {
             handle_backend_init_msg(c, msg);
         } else {
@@ -652,6 +1755,13 @@ static bool handle_backend_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s *
             msg->extra.frontend.subscriber.internal_fn = device_subscriber;
             msg->extra.frontend.subscriber.user_data = d;
             msg->extra.frontend.subscriber.is_internal = 1;
+            device_stream_stamp(c, d, msg);
+            if (c->group_start_pending) {
+                group_start_check(c, msg);
+            }
+            if ((msg->value.app == JSDRV_PAYLOAD_TYPE_STATISTICS) && !jsdrv_list_is_empty(&c->groups)) {
+                group_stats_check(c, msg);
+            }
         } else {
             JSDRV_LOGW("no device match for %s", msg->topic);
         }
@@ -660,6 +1770,61 @@ static bool handle_backend_msg(struct jsdrv_context_s * c, struct jsdrvp_msg_s *
     return true;
 }
 
+// Bulk data that may be delayed behind control traffic.
+static bool backend_msg_is_bulk(const struct jsdrvp_msg_s * msg) {
+    switch (msg->value.app) {
+        case JSDRV_PAYLOAD_TYPE_STREAM:             // fall through
+        case JSDRV_PAYLOAD_TYPE_STATISTICS:         // fall through
+        case JSDRV_PAYLOAD_TYPE_BUFFER_RSP:         // fall through
+        case JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI:   // fall through
+        case JSDRV_PAYLOAD_TYPE_ALIGN:              // fall through
+        case JSDRV_PAYLOAD_TYPE_SPECTRUM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Control messages that must not overtake the bulk data sent before them.
+static bool backend_msg_is_barrier(const struct jsdrvp_msg_s * msg) {
+    return (0 == strcmp(JSDRV_MSG_DEVICE_REMOVE, msg->topic))
+        || jsdrv_cstr_ends_with(msg->topic, JSDRV_MSG_CLOSE "#");
+}
+
+static void backend_bulk_drain(struct jsdrv_context_s * c) {
+    struct jsdrvp_msg_s * batch[MSG_QUEUE_BATCH_SIZE];
+    uint32_t count;
+    // note: ResetEvent handled automatically by msg_queue_pop_n
+    while ((count = msg_queue_pop_n(c->msg_backend, batch, MSG_QUEUE_BATCH_SIZE))) {
+        for (uint32_t i = 0; i < count; ++i) {
+            handle_backend_msg(c, batch[i]);
+        }
+    }
+}
+
+static void backend_ctrl_process(struct jsdrv_context_s * c) {
+    struct jsdrvp_msg_s * msg;
+    while (NULL != (msg = msg_queue_pop_immediate(c->msg_backend_ctrl))) {
+        if (backend_msg_is_barrier(msg)) {
+            backend_bulk_drain(c);
+        }
+        handle_backend_msg(c, msg);
+    }
+}
+
+// Process the control lane first, and recheck it between bulk batches.
+static void backend_msgs_process(struct jsdrv_context_s * c) {
+    struct jsdrvp_msg_s * batch[MSG_QUEUE_BATCH_SIZE];
+    uint32_t count;
+    backend_ctrl_process(c);
+    while ((count = msg_queue_pop_n(c->msg_backend, batch, MSG_QUEUE_BATCH_SIZE))) {
+        for (uint32_t i = 0; i < count; ++i) {
+            handle_backend_msg(c, batch[i]);
+        }
+        backend_ctrl_process(c);
+    }
+}
+
 static void backends_finalize(struct jsdrv_context_s * c) {
     for (uint32_t i = 0; i < BACKEND_COUNT_MAX; ++i) {
         if (c->backends[i]) {
@@ -670,17 +1835,145 @@ static void backends_finalize(struct jsdrv_context_s * c) {
 }
 
 static void timeouts_finalize(struct jsdrv_context_s * c) {
-    struct jsdrv_list_s * item;
     struct jsdrvp_api_timeout_s * timeout;
-    while (1) {
-        item = jsdrv_list_remove_head(&c->cmd_timeouts);
-        if (!item) {
-            break;
+    while (NULL != (timeout = jsdrv_timeouts_pop(c->cmd_timeouts))) {
+        timeout_signal(timeout, JSDRV_ERROR_ABORTED);
+    }
+}
+
+static void stats_queue_publish(struct jsdrv_context_s * c) {
+    if (!c->dispatch) {
+        return;
+    }
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(c);
+    jsdrv_cstr_copy(m->topic, JSDRV_MSG_STATS_QUEUE, sizeof(m->topic));
+    uint32_t count = jsdrv_dispatch_queue_stats(c->dispatch, m->payload.str, sizeof(m->payload.str));
+    uint32_t h = 2166136261U;  // FNV-1a
+    for (const char * p = m->payload.str; *p; ++p) {
+        h ^= (uint8_t) *p;
+        h *= 16777619U;
+    }
+    if ((h == c->stats_queue_hash) || (!count && !c->stats_queue_hash)) {
+        jsdrvp_msg_free(c, m);  // no change
+        return;
+    }
+    c->stats_queue_hash = h;
+    m->value = jsdrv_union_cjson_r(m->payload.str);
+    m->value.size = (uint32_t) (strlen(m->payload.str) + 1);
+    jsdrv_pubsub_publish(c->pubsub, m);
+}
+
+static void stats_mem_publish(struct jsdrv_context_s * c) {
+    if (!c->stats_mem_interval_ms) {
+        return;
+    }
+    uint32_t t = jsdrv_time_ms_u32();
+    if ((t - c->stats_mem_time_ms) < c->stats_mem_interval_ms) {
+        return;
+    }
+    c->stats_mem_time_ms = t;
+    stats_queue_publish(c);
+    uint32_t v[MSG_CLASS_COUNT * 4];
+    for (uint32_t i = 0; i < MSG_CLASS_COUNT; ++i) {
+        struct msg_pool_s * pool = &c->msg_classes[i].pool;
+        v[i * 4 + 0] = jsdrv_atomic_load_u32(&pool->allocated);
+        v[i * 4 + 1] = jsdrv_atomic_load_u32(&pool->in_use);
+        v[i * 4 + 2] = jsdrv_atomic_load_u32(&pool->peak);
+        v[i * 4 + 3] = jsdrv_atomic_load_u32(&pool->fallback);
+    }
+    if (0 == memcmp(v, c->stats_mem_prev, sizeof(v))) {
+        return;  // no change
+    }
+    memcpy(c->stats_mem_prev, v, sizeof(v));
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(c);
+    jsdrv_cstr_copy(m->topic, JSDRV_MSG_STATS_MEM, sizeof(m->topic));
+    char * p = m->payload.str;
+    char * p_end = m->payload.str + sizeof(m->payload.str);
+    *p++ = '{';
+    for (uint32_t i = 0; i < MSG_CLASS_COUNT; ++i) {
+        p += tfp_snprintf(p, p_end - p,
+                          "%s\"%s\": {\"allocated\": %u, \"in_use\": %u, \"peak\": %u, \"fallback\": %u}",
+                          i ? ", " : "", MSG_CLASS_NAME[i],
+                          (unsigned int) v[i * 4 + 0], (unsigned int) v[i * 4 + 1],
+                          (unsigned int) v[i * 4 + 2], (unsigned int) v[i * 4 + 3]);
+    }
+    tfp_snprintf(p, p_end - p, "}");
+    m->value = jsdrv_union_cjson_r(m->payload.str);
+    m->value.size = (uint32_t) (strlen(m->payload.str) + 1);
+    jsdrv_pubsub_publish(c->pubsub, m);
+}
+
+#define STATS_THREADS_PAYLOAD_SIZE (8192U)
+
+static void stats_threads_queue(void * user_data, const char * name, uint32_t depth) {
+    struct stats_json_s * j = (struct stats_json_s *) user_data;
+    stats_json_append(j, "%s\"%s\": %u", j->count++ ? ", " : "", name, (unsigned int) depth);
+}
+
+static void stats_threads_publish(struct jsdrv_context_s * c) {
+    struct jsdrv_thread_stats_s threads[JSDRV_THREAD_STATS_MAX];
+    char name[JSDRV_TOPIC_LENGTH_MAX + 8];
+    struct jsdrv_list_s * item;
+    if (!c->stats_threads_interval_ms) {
+        return;
+    }
+    uint32_t t = jsdrv_time_ms_u32();
+    uint32_t dt_ms = t - c->stats_threads_time_ms;
+    if (dt_ms < c->stats_threads_interval_ms) {
+        return;
+    }
+    c->stats_threads_time_ms = t;
+    uint32_t count = jsdrv_thread_stats_sample(threads, JSDRV_THREAD_STATS_MAX);
+
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(c, JSDRV_MSG_STATS_THREADS, STATS_THREADS_PAYLOAD_SIZE);
+    char * str = (char *) m->payload.bin;
+    struct stats_json_s j = {.p = str, .p_end = str + m->payload_size, .count = 0};
+    stats_json_append(&j, "{\"threads\": [");
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t cpu_ns_prev = threads[i].cpu_ns;  // new thread, no utilization yet
+        for (uint32_t k = 0; k < c->stats_threads_count; ++k) {
+            if (c->stats_threads_prev[k].id == threads[i].id) {
+                cpu_ns_prev = c->stats_threads_prev[k].cpu_ns;
+                break;
+            }
+        }
+        // utilization in 0.1% units, relative to one CPU
+        uint64_t pct = (threads[i].cpu_ns - cpu_ns_prev) / ((uint64_t) dt_ms * 1000ULL);
+        stats_json_append(&j, "%s{\"name\": \"%s\", \"cpu_ms\": %u, \"cpu_pct\": %u.%u}",
+                          i ? ", " : "", threads[i].name,
+                          (unsigned int) (threads[i].cpu_ns / 1000000ULL),
+                          (unsigned int) (pct / 10), (unsigned int) (pct % 10));
+    }
+    memcpy(c->stats_threads_prev, threads, count * sizeof(threads[0]));
+    c->stats_threads_count = count;
+
+    stats_json_append(&j, "], \"queues\": {");
+    stats_threads_queue(&j, "msg_cmd", msg_queue_depth(c->msg_cmd));
+    stats_threads_queue(&j, "msg_backend", msg_queue_depth(c->msg_backend));
+    stats_threads_queue(&j, "msg_backend_ctrl", msg_queue_depth(c->msg_backend_ctrl));
+    for (uint32_t i = 0; i < BACKEND_COUNT_MAX; ++i) {
+        if (c->backends[i] && c->backends[i]->cmd_q) {
+            tfp_snprintf(name, sizeof(name), "backend/%c/cmd_q", c->backends[i]->prefix);
+            stats_threads_queue(&j, name, msg_queue_depth(c->backends[i]->cmd_q));
+        }
+    }
+    jsdrv_list_foreach(&c->devices, item) {
+        struct frontend_dev_s * d = JSDRV_CONTAINER_OF(item, struct frontend_dev_s, item);
+        if (d->device && d->device->cmd_q) {
+            tfp_snprintf(name, sizeof(name), "%s/cmd_q", d->prefix);
+            stats_threads_queue(&j, name, msg_queue_depth(d->device->cmd_q));
+        }
+        if (d->device && d->device->rsp_q) {
+            tfp_snprintf(name, sizeof(name), "%s/rsp_q", d->prefix);
+            stats_threads_queue(&j, name, msg_queue_depth(d->device->rsp_q));
         }
-        timeout = JSDRV_CONTAINER_OF(item, struct jsdrvp_api_timeout_s, item);
-        timeout->return_code = JSDRV_ERROR_ABORTED;
-        jsdrv_os_event_signal(timeout->ev);
     }
+    jsdrv_buffer_queue_depths(stats_threads_queue, &j);
+    stats_json_append(&j, "}}");
+
+    m->value = jsdrv_union_cjson_r(str);
+    m->value.size = (uint32_t) (strlen(str) + 1);
+    jsdrv_pubsub_publish(c->pubsub, m);
 }
 
 static int32_t backend_init(struct jsdrv_context_s * c, jsdrv_backend_factory factory) {
@@ -713,51 +2006,67 @@ static THREAD_RETURN_TYPE frontend_thread(THREAD_ARG_TYPE lpParam) {
     struct jsdrv_context_s * c = (struct jsdrv_context_s *) lpParam;
     int32_t timeout_ms;
     JSDRV_LOGI("USB frontend thread started");
+    jsdrvp_thread_configure(c, JSDRVP_THREAD_FRONTEND, "jsdrv_frontend");
     subscribe_return_code(c);
 
 #if _WIN32
     HANDLE handles[MAXIMUM_WAIT_OBJECTS];
     DWORD handle_count = 0;
+    handles[handle_count++] = msg_queue_handle_get(c->msg_backend_ctrl);
     handles[handle_count++] = msg_queue_handle_get(c->msg_backend);
     handles[handle_count++] = msg_queue_handle_get(c->msg_cmd);
 #else
-    struct pollfd fds[2];
-    fds[0].fd = msg_queue_handle_get(c->msg_backend);
+    struct pollfd fds[3];
+    fds[0].fd = msg_queue_handle_get(c->msg_backend_ctrl);
     fds[0].events = POLLIN;
-    fds[1].fd = msg_queue_handle_get(c->msg_cmd);
+    fds[1].fd = msg_queue_handle_get(c->msg_backend);
     fds[1].events = POLLIN;
+    fds[2].fd = msg_queue_handle_get(c->msg_cmd);
+    fds[2].events = POLLIN;
 #endif
 
 #if UNITTEST
     BACKEND_INIT(c, jsdrv_unittest_backend_factory);
 #else
     BACKEND_INIT(c, jsdrv_usb_backend_factory);
-    // todo BACKEND_INIT(c, jsdrv_emulation_backend_factory);
+    struct jsdrv_union_s emulation_devices;
+    if ((0 == jsdrvp_arg_get(c, JSDRV_ARG_EMULATION_DEVICES, &emulation_devices))
+            && (0 == jsdrv_union_as_type(&emulation_devices, JSDRV_UNION_U32))
+            && emulation_devices.value.u32) {
+        BACKEND_INIT(c, jsdrv_emulation_backend_factory);
+    }
 #endif
+    jsdrvp_msg_cache_attach(c);
 
     while (!c->do_exit) {
         timeout_ms = timeout_next_ms(c);
 #if _WIN32
         WaitForMultipleObjects(handle_count, handles, false, timeout_ms);
 #else
-        poll(fds, 2, timeout_ms);
+        poll(fds, 3, timeout_ms);
 #endif
         //JSDRV_LOGD3("frontend_thread");
-        // note: ResetEvent handled automatically by msg_queue_pop_immediate
-        while (handle_backend_msg(c, msg_queue_pop_immediate(c->msg_backend))) {
-            ; //
-        }
+        backend_msgs_process(c);
+        device_list_flush(c);
         // note: ResetEvent handled automatically by msg_queue_pop_immediate
         while (handle_cmd_msg(c, msg_queue_pop_immediate(c->msg_cmd))) {
             ; //
         }
+        stats_mem_publish(c);
+        stats_threads_publish(c);
         jsdrv_pubsub_process(c->pubsub);
+        if (jsdrv_list_is_empty(&c->cmd_deferred)) {
+            jsdrv_atomic_store_u32(&c->api_done, c->api_popped);
+        }
         timeout_process(c);
     }
 
+    cmd_deferred_free(c);
     device_remove_all(c);
     backends_finalize(c);
     timeouts_finalize(c);
+    group_free_all(c);
+    jsdrvp_msg_cache_detach(c);
     THREAD_RETURN();
 }
 
@@ -765,10 +2074,23 @@ void jsdrvp_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg
     if (!msg) {
         return;  // NULL pointer, do nothing.
     }
+    while (1) {
+        uint32_t refcnt = jsdrv_atomic_load_u32(&msg->refcnt);
+        if (!refcnt) {
+            break;
+        }
+        if (jsdrv_atomic_cas_u32(&msg->refcnt, refcnt, refcnt - 1)) {
+            return;  // another owner still holds this message
+        }
+    }
     if (!jsdrv_list_is_empty(&msg->item)) {
         JSDRV_LOGW("jsdrvp_msg_free but still in list");
     }
-    if (msg->value.flags & JSDRV_UNION_FLAG_HEAP_MEMORY) {
+    if (msg->value.flags & JSDRV_UNION_FLAG_SHARED_MEMORY) {
+        msg->value.flags &= ~JSDRV_UNION_FLAG_SHARED_MEMORY;
+        jsdrv_value_shared_release(msg->value.value.bin);
+        msg->value.value.bin = NULL;
+    } else if (msg->value.flags & JSDRV_UNION_FLAG_HEAP_MEMORY) {
         msg->value.flags &= ~JSDRV_UNION_FLAG_HEAP_MEMORY;
         switch (msg->value.type) {
             case JSDRV_UNION_STR:   /* intentional fall-through */
@@ -784,16 +2106,69 @@ void jsdrvp_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg
                 break;
         }
     }
+    if (((msg->inner_msg_type != JSDRV_MSG_TYPE_NORMAL) && (msg->inner_msg_type != JSDRV_MSG_TYPE_DATA))
+            || (msg->msg_class >= MSG_CLASS_COUNT)) {
+        JSDRV_LOGE("corrupted message with invalid inner_msg_type");
+        jsdrv_free(msg);
+        return;
+    }
+    struct msg_class_s * c = &context->msg_classes[msg->msg_class];
+    msg_pool_release(&c->pool);
+    struct msg_cache_s * cache = msg_cache_get(context);
     if (context->do_exit) {
         jsdrv_free(msg);
-    } else if (msg->inner_msg_type == JSDRV_MSG_TYPE_DATA) {
-        msg_queue_push(context->msg_free_data, msg);
-    } else if (msg->inner_msg_type == JSDRV_MSG_TYPE_NORMAL) {
-        msg_queue_push(context->msg_free, msg);
+    } else if (!msg->pool) {
+        jsdrv_free(msg);  // heap fallback beyond the pool limit
+    } else if (cache) {
+        jsdrv_list_remove(&msg->item);
+        msg_cache_push(cache, c->free, msg);
     } else {
-        JSDRV_LOGE("corrupted message with invalid inner_msg_type");
-        jsdrv_free(msg);
+        msg_queue_push(c->free, msg);
+    }
+}
+
+#if UNITTEST
+int32_t jsdrv_unittest_api_wait_error = 0;  // when nonzero, the next api_wait() fails immediately
+#endif
+
+static int32_t api_wait(jsdrv_os_event_t ev) {
+    int32_t rc;
+#if UNITTEST
+    if (jsdrv_unittest_api_wait_error) {
+        rc = jsdrv_unittest_api_wait_error;
+        jsdrv_unittest_api_wait_error = 0;
+        return rc;
+    }
+#endif
+#if _WIN32
+    switch (WaitForSingleObject(ev, INFINITE)) {  // timeout performed in main jsdrv thread
+        case WAIT_ABANDONED: rc = JSDRV_ERROR_ABORTED; break;
+        case WAIT_OBJECT_0: rc = 0; break;
+        case WAIT_TIMEOUT: rc = JSDRV_ERROR_TIMED_OUT; break;
+        case WAIT_FAILED: rc = JSDRV_ERROR_UNSPECIFIED; break;
+        default: rc = JSDRV_ERROR_UNSPECIFIED; break;
+    }
+#else
+    struct pollfd fds = {
+            .fd = ev->fd_poll,
+            .events = ev->events,
+            .revents = 0,
+    };
+    int prv = poll(&fds, 1, 1000000);  // timeout > main jsdrv thread timeout
+    if (prv < 0) {
+        rc = JSDRV_ERROR_UNSPECIFIED;
+    } else if (prv == 0) {
+        rc = JSDRV_ERROR_TIMED_OUT;
+    } else {
+        rc = 0;
     }
+#endif
+    return rc;
+}
+
+static void api_push(struct jsdrv_context_s * context, struct jsdrvp_msg_s * m) {
+    jsdrv_atomic_add_u32(&context->api_submit, 1);
+    msg_queue_push(context->msg_cmd, m);
 }
 
 static int32_t api_cmd(struct jsdrv_context_s * context, struct jsdrvp_msg_s * m, uint32_t timeout_ms) {
@@ -804,49 +2179,61 @@ static int32_t api_cmd(struct jsdrv_context_s * context, struct jsdrvp_msg_s * m
             JSDRV_LOGW("API command %s invoked on jsdrv thread with timeout.  Forcing timeout=0.", m->topic);
             timeout_ms = 0;
         } else {
-            jsdrv_list_initialize(&timeout.item);
-            jsdrv_cstr_join(timeout.topic, m->topic, "#", sizeof(timeout.topic));
-            timeout.timeout = jsdrv_time_utc() + timeout_ms * JSDRV_TIME_MILLISECOND;
+            api_timeout_init(&timeout, m->topic, jsdrv_time_utc() + timeout_ms * JSDRV_TIME_MILLISECOND);
             timeout.ev = jsdrv_os_event_alloc();
-            timeout.return_code = 0;
             // use a stack variable, but block on timeout to ensure stays in scopre
             m->timeout = &timeout;  // cppcheck-suppress autoVariables
             m->source = 1;
         }
     }
     JSDRV_LOGD1("api_cmd(%s) start", m->topic);
-    msg_queue_push(context->msg_cmd, m);
+    api_push(context, m);
     m = NULL;  // we relinquished ownership of m, ensure we don't use it.
     if (timeout_ms) {
-#if _WIN32
-        switch (WaitForSingleObject(timeout.ev, INFINITE)) {  // timeout performed in main jsdrv thread
-            case WAIT_ABANDONED: rc = JSDRV_ERROR_ABORTED; break;
-            case WAIT_OBJECT_0: rc = timeout.return_code; break;
-            case WAIT_TIMEOUT: rc = JSDRV_ERROR_TIMED_OUT; break;
-            case WAIT_FAILED: rc = JSDRV_ERROR_UNSPECIFIED; break;
-            default: rc = JSDRV_ERROR_UNSPECIFIED; break;
-        }
-#else
-        struct pollfd fds = {
-                .fd = timeout.ev->fd_poll,
-                .events = timeout.ev->events,
-                .revents = 0,
-        };
-        int prv = poll(&fds, 1, 1000000);  // timeout > main jsdrv thread timeout
-        if (prv < 0) {
-            rc = JSDRV_ERROR_UNSPECIFIED;
-        } else if (prv == 0) {
-            rc = JSDRV_ERROR_TIMED_OUT;
-        } else {
+        rc = api_wait(timeout.ev);
+        if (!rc) {
             rc = timeout.return_code;
         }
-#endif
         jsdrv_os_event_free(timeout.ev);
     }
     JSDRV_LOGD1("api_cmd done %lu", rc);
     return rc;
 }
 
+static struct jsdrvp_msg_s * value_to_msg(const struct jsdrv_union_s * value) {
+    if ((NULL == value) || !jsdrv_union_is_type_ptr(value)) {
+        return NULL;
+    }
+    struct jsdrvp_msg_s * m = JSDRV_CONTAINER_OF(value, struct jsdrvp_msg_s, value);
+    if ((m->inner_msg_type != JSDRV_MSG_TYPE_NORMAL) && (m->inner_msg_type != JSDRV_MSG_TYPE_DATA)) {
+        return NULL;
+    }
+    if ((m->value.value.bin != m->payload.bin)
+            && !(m->value.flags & (JSDRV_UNION_FLAG_HEAP_MEMORY | JSDRV_UNION_FLAG_SHARED_MEMORY | JSDRV_UNION_FLAG_STATIC))) {
+        return NULL;
+    }
+    return m;
+}
+
+int32_t jsdrv_retain(struct jsdrv_context_s * context, const struct jsdrv_union_s * value) {
+    (void) context;
+    struct jsdrvp_msg_s * m = value_to_msg(value);
+    if (NULL == m) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrv_atomic_add_u32(&m->refcnt, 1);
+    return 0;
+}
+
+int32_t jsdrv_release(struct jsdrv_context_s * context, const struct jsdrv_union_s * value) {
+    struct jsdrvp_msg_s * m = value_to_msg(value);
+    if ((NULL == context) || (NULL == m)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrvp_msg_free(context, m);
+    return 0;
+}
+
 int32_t jsdrv_publish(struct jsdrv_context_s * context,
         const char * name, const struct jsdrv_union_s * value,
         uint32_t timeout_ms) {
@@ -854,12 +2241,125 @@ int32_t jsdrv_publish(struct jsdrv_context_s * context,
     return api_cmd(context, m, timeout_ms);
 }
 
+int32_t jsdrv_publish_async(struct jsdrv_context_s * context,
+        const char * topic, const struct jsdrv_union_s * value,
+        uint32_t timeout_ms, jsdrv_completion_fn cbk_fn, void * cbk_user_data) {
+    if (!context || !topic || !value) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(context, topic, value);
+    if (cbk_fn) {
+        if (!timeout_ms) {
+            timeout_ms = JSDRV_TIMEOUT_MS_DEFAULT;
+        }
+        struct jsdrvp_api_timeout_s * t = jsdrv_alloc(sizeof(struct jsdrvp_api_timeout_s));
+        api_timeout_init(t, m->topic, jsdrv_time_utc() + timeout_ms * JSDRV_TIME_MILLISECOND);
+        t->completion_fn = cbk_fn;
+        t->completion_user_data = cbk_user_data;
+        m->timeout = t;
+        m->source = 1;
+    }
+    api_push(context, m);
+    return 0;
+}
+
+int32_t jsdrv_publish_batch(struct jsdrv_context_s * context,
+        const struct jsdrv_arg_s * args, uint32_t count,
+        int32_t * return_codes, uint32_t timeout_ms) {
+    if (!context || (!args && count)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (timeout_ms && jsdrv_thread_is_current(&context->thread)) {
+        JSDRV_LOGW("jsdrv_publish_batch invoked on jsdrv thread with timeout.  Forcing timeout=0.");
+        timeout_ms = 0;
+    }
+    if (!timeout_ms) {
+        for (uint32_t i = 0; i < count; ++i) {
+            api_push(context, jsdrvp_msg_alloc_value(context, args[i].topic, &args[i].value));
+            if (return_codes) {
+                return_codes[i] = 0;
+            }
+        }
+        return 0;
+    }
+    if (!count) {
+        return 0;
+    }
+
+    // Submit all messages, then wait once for all return codes.
+    struct jsdrvp_api_batch_s * batch = jsdrv_alloc_clr(sizeof(struct jsdrvp_api_batch_s)
+                                                        + count * sizeof(struct jsdrvp_api_timeout_s));
+    batch->refs = 2;
+    batch->remaining = count;
+    batch->ev = jsdrv_os_event_alloc();
+    int64_t t_end = jsdrv_time_utc() + timeout_ms * JSDRV_TIME_MILLISECOND;
+    JSDRV_LOGD1("jsdrv_publish_batch(%u) start", (unsigned int) count);
+    for (uint32_t i = 0; i < count; ++i) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(context, args[i].topic, &args[i].value);
+        api_timeout_init(&batch->timeouts[i], m->topic, t_end);
+        batch->timeouts[i].ev = batch->ev;
+        batch->timeouts[i].batch = batch;
+        m->timeout = &batch->timeouts[i];
+        m->source = 1;
+        api_push(context, m);
+    }
+
+    int32_t rv = api_wait(batch->ev);
+    if (rv) {
+        // the frontend thread frees the batch once it completes the remaining timeouts.
+        JSDRV_LOGE("jsdrv_publish_batch wait failed: %d", (int) rv);
+        api_batch_release(batch);
+        return rv;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        int32_t rc = batch->timeouts[i].return_code;
+        if (return_codes) {
+            return_codes[i] = rc;
+        }
+        if (rc && !rv) {
+            rv = rc;
+        }
+    }
+    api_batch_release(batch);
+    JSDRV_LOGD1("jsdrv_publish_batch done %d", (int) rv);
+    return rv;
+}
+
+/**
+ * @brief Check if jsdrv_query() may read the retained value snapshot.
+ *
+ * @param context The context.
+ * @param topic The query topic.
+ * @return True when the snapshot is consistent with the calling thread.
+ *
+ * The snapshot reflects everything the frontend processed, which includes
+ * all prior commands from this thread once api_done catches up with
+ * api_submit.  Otherwise, the round trip preserves command ordering.
+ */
+static bool query_is_snapshot(struct jsdrv_context_s * context, const char * topic) {
+    if (!context->pubsub || jsdrv_thread_is_current(&context->thread)) {
+        return false;
+    }
+    char ch = topic[strlen(topic) - 1];
+    if ((ch == JSDRV_TOPIC_SUFFIX_METADATA_REQ) || (ch == JSDRV_TOPIC_SUFFIX_QUERY_REQ) || (ch == '/')) {
+        return false;
+    }
+    uint32_t submit = jsdrv_atomic_load_u32(&context->api_submit);
+    return jsdrv_atomic_load_u32(&context->api_done) == submit;
+}
+
 int32_t jsdrv_query(struct jsdrv_context_s * context,
                     const char * topic, struct jsdrv_union_s * value,
                     uint32_t timeout_ms) {
     if (!topic || !topic[0] || !value) {
         return JSDRV_ERROR_PARAMETER_INVALID;
     }
+    if (query_is_snapshot(context, topic)) {
+        int32_t rc = jsdrv_pubsub_query_snapshot(context->pubsub, topic, value);
+        if ((rc != JSDRV_ERROR_NOT_FOUND) && (rc != JSDRV_ERROR_BUSY)) {
+            return rc;
+        }
+    }
     if (!timeout_ms) {
         timeout_ms = JSDRV_TIMEOUT_MS_DEFAULT;
     }
@@ -870,10 +2370,220 @@ int32_t jsdrv_query(struct jsdrv_context_s * context,
     return api_cmd(context, m, timeout_ms);
 }
 
+/*
+ * Ensure that the retained value snapshot includes all prior commands from
+ * this thread.  When commands are still pending, one query round trip
+ * follows them through pubsub in order.  Commands deferred until the
+ * device scan completes target devices without retained values, so the
+ * snapshot cannot hold stale values for them.
+ */
+static bool profile_snapshot_sync(struct jsdrv_context_s * context, const char * topic, uint32_t timeout_ms) {
+    if (!context->pubsub || jsdrv_thread_is_current(&context->thread)) {
+        return false;
+    }
+    if (query_is_snapshot(context, topic)) {
+        return true;
+    }
+    char buf[JSDRV_PAYLOAD_LENGTH_MAX];
+    struct jsdrv_union_s v = jsdrv_union_str(buf);
+    v.size = sizeof(buf) - 1;
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_QUERY, sizeof(m->topic));
+    jsdrv_cstr_copy(m->payload.query.topic, topic, sizeof(m->payload.str));
+    m->payload.query.value = &v;
+    int32_t rc = api_cmd(context, m, timeout_ms ? timeout_ms : JSDRV_TIMEOUT_MS_DEFAULT);
+    return (0 == rc) || (JSDRV_ERROR_NOT_FOUND == rc);
+}
+
+// Check if the retained value already matches a profile entry.
+static bool profile_is_current(struct jsdrv_context_s * context, const char * topic,
+        const struct jsdrv_union_s * value) {
+    char buf[JSDRV_PAYLOAD_LENGTH_MAX];
+    memset(buf, 0, sizeof(buf));
+    struct jsdrv_union_s v = jsdrv_union_str(buf);
+    v.size = sizeof(buf) - 1;  // keep the null terminator
+    if (jsdrv_pubsub_query_snapshot(context->pubsub, topic, &v)) {
+        return false;  // not retained, too large, or busy
+    }
+    return jsdrv_union_equiv(&v, value);
+}
+
+int32_t jsdrv_profile_apply(struct jsdrv_context_s * context, const char * device_prefix,
+        const struct jsdrv_arg_s * args, uint32_t count,
+        uint32_t * changed, uint32_t timeout_ms) {
+    if (changed) {
+        *changed = 0;
+    }
+    if (!context || (!args && count)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    device_prefix = device_prefix ? device_prefix : "";
+    size_t prefix_len = strlen(device_prefix);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!args[i].topic || !args[i].topic[0]
+                || ((prefix_len + strlen(args[i].topic) + 2) > JSDRV_TOPIC_LENGTH_MAX)) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    }
+    if (!count) {
+        return 0;
+    }
+
+    struct jsdrv_topic_s * topics = jsdrv_alloc(count * sizeof(struct jsdrv_topic_s));
+    struct jsdrv_arg_s * diff = jsdrv_alloc(count * sizeof(struct jsdrv_arg_s));
+    uint32_t n = 0;
+    bool diff_en = false;
+    for (uint32_t i = 0; i < count; ++i) {
+        struct jsdrv_topic_s * t = &topics[n];
+        jsdrv_topic_set(t, device_prefix);
+        jsdrv_topic_append(t, args[i].topic);
+        if (!i) {
+            diff_en = profile_snapshot_sync(context, t->topic, timeout_ms);
+        }
+        if (diff_en && profile_is_current(context, t->topic, &args[i].value)) {
+            continue;
+        }
+        diff[n].topic = t->topic;
+        diff[n].value = args[i].value;
+        ++n;
+    }
+    JSDRV_LOGI("profile apply %s: %u of %u changed", device_prefix, (unsigned int) n, (unsigned int) count);
+    if (changed) {
+        *changed = n;
+    }
+    int32_t rv = 0;
+    if (n) {
+        timeout_ms = timeout_ms ? timeout_ms : JSDRV_TIMEOUT_MS_DEFAULT;
+        rv = jsdrv_publish_batch(context, diff, n, NULL, timeout_ms);
+    }
+    jsdrv_free(diff);
+    jsdrv_free(topics);
+    return rv;
+}
+
+#define PROFILE_DEPTH_MAX (8)
+
+struct profile_entry_s {
+    struct jsdrv_topic_s topic;
+    struct jsdrv_union_s value;  // strings are heap copies
+};
+
+struct profile_parse_s {
+    struct jsdrv_topic_s topic;
+    uint8_t lengths[PROFILE_DEPTH_MAX];  // topic length for each object depth
+    uint32_t depth;
+    bool key;                            // topic ends with a key awaiting its value
+    struct profile_entry_s * entries;
+    uint32_t count;
+    uint32_t alloc;
+};
+
+static int32_t profile_entry_add(struct profile_parse_s * self, const struct jsdrv_union_s * token) {
+    if (self->count >= self->alloc) {
+        uint32_t alloc = self->alloc ? (self->alloc * 2) : 16;
+        struct profile_entry_s * entries = jsdrv_alloc(alloc * sizeof(struct profile_entry_s));
+        if (self->count) {
+            memcpy(entries, self->entries, self->count * sizeof(struct profile_entry_s));
+        }
+        jsdrv_free(self->entries);
+        self->entries = entries;
+        self->alloc = alloc;
+    }
+    struct profile_entry_s * e = &self->entries[self->count];
+    e->topic = self->topic;
+    e->value = *token;
+    e->value.op = 0;
+    e->value.flags = 0;
+    if (token->type == JSDRV_UNION_STR) {
+        uint32_t length = token->size - 1;  // size counts the terminator, which the token lacks
+        char * str = jsdrv_alloc(token->size);
+        memcpy(str, token->value.str, length);
+        str[length] = 0;
+        e->value = jsdrv_union_str(str);
+    } else if ((token->type != JSDRV_UNION_I32) && (token->type != JSDRV_UNION_I64) && (token->type != JSDRV_UNION_F64)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;  // null
+    }
+    ++self->count;
+    return 0;
+}
+
+static int32_t profile_parse_cbk(void * user_data, const struct jsdrv_union_s * token) {
+    struct profile_parse_s * self = (struct profile_parse_s *) user_data;
+    switch (token->op) {
+        case JSDRV_JSON_OBJ_START:
+            if ((self->depth >= PROFILE_DEPTH_MAX) || (self->depth && !self->key)) {
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            self->lengths[self->depth++] = self->topic.length;
+            self->key = false;
+            return 0;
+        case JSDRV_JSON_OBJ_END:
+            --self->depth;
+            jsdrv_topic_truncate(&self->topic, self->depth ? self->lengths[self->depth - 1] : 0);
+            self->key = false;
+            return 0;
+        case JSDRV_JSON_KEY: {
+            uint8_t length = self->lengths[self->depth - 1];
+            uint32_t key_length = token->size - 1;
+            if (!key_length || ((length + key_length + 2) > JSDRV_TOPIC_LENGTH_MAX)) {
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            char key[JSDRV_TOPIC_LENGTH_MAX];
+            memcpy(key, token->value.str, key_length);
+            key[key_length] = 0;
+            jsdrv_topic_truncate(&self->topic, length);
+            jsdrv_topic_append(&self->topic, key);
+            self->key = true;
+            return 0;
+        }
+        case JSDRV_JSON_VALUE: {
+            if (!self->key) {
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            self->key = false;
+            return profile_entry_add(self, token);
+        }
+        default:
+            return JSDRV_ERROR_PARAMETER_INVALID;  // arrays
+    }
+}
+
+int32_t jsdrv_profile_apply_json(struct jsdrv_context_s * context, const char * device_prefix,
+        const char * profile, uint32_t * changed, uint32_t timeout_ms) {
+    if (changed) {
+        *changed = 0;
+    }
+    if (!context || !profile) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct profile_parse_s parse;
+    memset(&parse, 0, sizeof(parse));
+    int32_t rv = jsdrv_json_parse(profile, profile_parse_cbk, &parse);
+    if (rv) {
+        JSDRV_LOGW("profile parse failed: %d", (int) rv);
+        rv = JSDRV_ERROR_PARAMETER_INVALID;
+    } else {
+        struct jsdrv_arg_s * args = jsdrv_alloc((parse.count + 1) * sizeof(struct jsdrv_arg_s));
+        for (uint32_t i = 0; i < parse.count; ++i) {
+            args[i].topic = parse.entries[i].topic.topic;
+            args[i].value = parse.entries[i].value;
+        }
+        rv = jsdrv_profile_apply(context, device_prefix, args, parse.count, changed, timeout_ms);
+        jsdrv_free(args);
+    }
+    for (uint32_t i = 0; i < parse.count; ++i) {
+        if (parse.entries[i].value.type == JSDRV_UNION_STR) {
+            jsdrv_free((void *) parse.entries[i].value.value.str);
+        }
+    }
+    jsdrv_free(parse.entries);
+    return rv;
+}
+
 static int32_t subscribe_common(struct jsdrv_context_s * p,
         const char * topic, uint8_t flags,
         const char * op, jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
-                                uint32_t timeout_ms) {
+        uint32_t queue_depth, uint8_t queue_policy, uint32_t coalesce_ms, uint32_t timeout_ms) {
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(p);
     jsdrv_cstr_copy(m->topic, op, sizeof(m->topic));
     m->value.type = JSDRV_UNION_BIN;
@@ -884,6 +2594,11 @@ static int32_t subscribe_common(struct jsdrv_context_s * p,
     m->payload.sub.subscriber.user_data = cbk_user_data;
     m->payload.sub.subscriber.is_internal = 0;
     m->payload.sub.subscriber.flags = flags;
+    m->payload.sub.subscriber.queue_policy = queue_policy;
+    m->payload.sub.subscriber.queue_depth = queue_depth;
+    m->payload.sub.subscriber.queue = NULL;
+    m->payload.sub.subscriber.coalesce_ms = coalesce_ms;
+    m->payload.sub.subscriber.coalesce = NULL;
     JSDRV_LOGD1("subscribe_common(%s, %s)", topic, op);
     return api_cmd(p, m, timeout_ms);
 }
@@ -891,19 +2606,51 @@ static int32_t subscribe_common(struct jsdrv_context_s * p,
 int32_t jsdrv_subscribe(struct jsdrv_context_s * context, const char * name, uint8_t flags,
                         jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
                         uint32_t timeout_ms) {
-    return subscribe_common(context, name, flags, JSDRV_PUBSUB_SUBSCRIBE, cbk_fn, cbk_user_data, timeout_ms);
+    return subscribe_common(context, name, flags, JSDRV_PUBSUB_SUBSCRIBE, cbk_fn, cbk_user_data,
+                            0, JSDRV_QUEUE_POLICY_NONE, 0, timeout_ms);
+}
+
+int32_t jsdrv_subscribe_queue(struct jsdrv_context_s * context, const char * name, uint8_t flags,
+                              jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
+                              uint32_t depth, uint8_t policy, uint32_t timeout_ms) {
+    if (!context || !name || !cbk_fn) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (policy > JSDRV_QUEUE_POLICY_COALESCE) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (!depth && (policy != JSDRV_QUEUE_POLICY_NONE) && (policy != JSDRV_QUEUE_POLICY_COALESCE)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if ((policy != JSDRV_QUEUE_POLICY_NONE) && !context->dispatch) {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    return subscribe_common(context, name, flags, JSDRV_PUBSUB_SUBSCRIBE, cbk_fn, cbk_user_data,
+                            depth, policy, 0, timeout_ms);
+}
+
+int32_t jsdrv_subscribe_coalesce(struct jsdrv_context_s * context, const char * name, uint8_t flags,
+                                 jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
+                                 uint32_t interval_ms, uint32_t timeout_ms) {
+    if (!context || !name || !cbk_fn) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return subscribe_common(context, name, flags, JSDRV_PUBSUB_SUBSCRIBE, cbk_fn, cbk_user_data,
+                            0, JSDRV_QUEUE_POLICY_NONE, interval_ms, timeout_ms);
 }
 
 int32_t jsdrv_unsubscribe(struct jsdrv_context_s * context, const char * name,
                           jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
                           uint32_t timeout_ms) {
-    return subscribe_common(context, name, 0, JSDRV_PUBSUB_UNSUBSCRIBE, cbk_fn, cbk_user_data, timeout_ms);
+    return subscribe_common(context, name, 0, JSDRV_PUBSUB_UNSUBSCRIBE, cbk_fn, cbk_user_data,
+                            0, JSDRV_QUEUE_POLICY_NONE, 0, timeout_ms);
 }
 
 int32_t jsdrv_unsubscribe_all(struct jsdrv_context_s * context,
                               jsdrv_subscribe_fn cbk_fn, void * cbk_user_data,
                               uint32_t timeout_ms) {
-    return subscribe_common(context, "", 0, JSDRV_PUBSUB_UNSUBSCRIBE_ALL, cbk_fn, cbk_user_data, timeout_ms);
+    return subscribe_common(context, "", 0, JSDRV_PUBSUB_UNSUBSCRIBE_ALL, cbk_fn, cbk_user_data,
+                            0, JSDRV_QUEUE_POLICY_NONE, 0, timeout_ms);
 }
 
 #define MSG_QUEUE_ALLOC(context_, ptr_)         \
@@ -919,37 +2666,170 @@ int32_t jsdrv_unsubscribe_all(struct jsdrv_context_s * context,
         ptr_ = NULL;                            \
     }
 
+static int32_t thread_arg_parse(struct jsdrv_context_s * c, const struct jsdrv_arg_s * arg) {
+    struct jsdrv_union_s v = arg->value;
+    const char * s = arg->topic + strlen(JSDRV_ARG_THREAD_PREFIX);
+    for (uint32_t idx = 0; idx < JSDRVP_THREAD_COUNT; ++idx) {
+        size_t sz = strlen(THREAD_ROLE_NAME[idx]);
+        if ((0 != strncmp(s, THREAD_ROLE_NAME[idx], sz)) || (s[sz] != '/')) {
+            continue;
+        }
+        struct thread_cfg_s * cfg = &c->thread_cfg[idx];
+        s += sz + 1;
+        if (0 == strcmp(s, "affinity")) {
+            if (jsdrv_union_as_type(&v, JSDRV_UNION_U64)) {
+                JSDRV_LOGE("jsdrv_initialize arg %s: invalid value type", arg->topic);
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            cfg->affinity = v.value.u64;
+            return 0;
+        } else if (0 == strcmp(s, "priority")) {
+            if (jsdrv_union_as_type(&v, JSDRV_UNION_I32)) {
+                JSDRV_LOGE("jsdrv_initialize arg %s: invalid value type", arg->topic);
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            cfg->priority = v.value.i32;
+            cfg->priority_set = true;
+            return 0;
+        }
+        break;
+    }
+    JSDRV_LOGW("jsdrv_initialize arg %s: unsupported, ignore", arg->topic);
+    return 0;
+}
+
+static int32_t args_parse(struct jsdrv_context_s * c, const struct jsdrv_arg_s * args, uint32_t * normal_init, uint32_t * data_init) {
+    struct jsdrv_union_s v;
+    if (NULL == args) {
+        return 0;
+    }
+    for (; args->topic && args->topic[0]; ++args) {
+        if (jsdrv_cstr_starts_with(args->topic, JSDRV_ARG_THREAD_PREFIX)) {
+            JSDRV_RETURN_ON_ERROR(thread_arg_parse(c, args));
+            continue;
+        } else if (0 == strcmp(JSDRV_ARG_USB_CAPTURE, args->topic)) {
+            if ((args->value.type != JSDRV_UNION_STR) || c->usb_capture) {
+                JSDRV_LOGE("jsdrv_initialize arg %s: invalid value", args->topic);
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            JSDRV_RETURN_ON_ERROR(jsdrv_recorder_open(NULL, args->value.value.str, 0, &c->usb_capture));
+            continue;
+        } else if ((0 == strcmp(JSDRV_ARG_EMULATION_REPLAY, args->topic))
+                || (0 == strcmp(JSDRV_ARG_DEVICE_HINT, args->topic))) {
+            continue;  // str backend argument, see jsdrvp_arg_get()
+        } else if (0 == strcmp(JSDRV_ARG_CPU_ISA, args->topic)) {
+            int32_t isa = -1;
+            if (args->value.type == JSDRV_UNION_STR) {
+                isa = jsdrv_f32_ops_isa_from_str(args->value.value.str);
+            }
+            if ((isa < 0) || jsdrv_f32_ops_isa_set(isa)) {
+                JSDRV_LOGE("jsdrv_initialize arg %s: unsupported value", args->topic);
+                return JSDRV_ERROR_NOT_SUPPORTED;
+            }
+            continue;
+        }
+        v = args->value;
+        if (jsdrv_union_as_type(&v, JSDRV_UNION_U32)) {
+            JSDRV_LOGE("jsdrv_initialize arg %s: invalid value type", args->topic);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        if (0 == strcmp(JSDRV_ARG_POOL_NORMAL_INIT, args->topic)) {
+            *normal_init = v.value.u32;
+        } else if (0 == strcmp(JSDRV_ARG_POOL_NORMAL_MAX, args->topic)) {
+            c->msg_classes[MSG_CLASS_NORMAL].pool.max = v.value.u32;
+        } else if (0 == strcmp(JSDRV_ARG_POOL_DATA_INIT, args->topic)) {
+            *data_init = v.value.u32;
+        } else if (0 == strcmp(JSDRV_ARG_POOL_DATA_MAX, args->topic)) {
+            for (uint32_t idx = MSG_CLASS_DATA_4K; idx < MSG_CLASS_COUNT; ++idx) {
+                c->msg_classes[idx].pool.max = v.value.u32;
+            }
+        } else if (0 == strcmp(JSDRV_ARG_STATS_MEM_INTERVAL, args->topic)) {
+            c->stats_mem_interval_ms = v.value.u32;
+        } else if (0 == strcmp(JSDRV_ARG_STATS_THREADS_INTERVAL, args->topic)) {
+            c->stats_threads_interval_ms = v.value.u32;
+        } else if (0 == strcmp(JSDRV_ARG_DISPATCH_THREADS, args->topic)) {
+            c->dispatch_threads = v.value.u32;
+        } else if (0 == strcmp(JSDRV_ARG_INIT_LAZY, args->topic)) {
+            c->init_lazy = (0 != v.value.u32);
+        } else if ((0 == strcmp(JSDRV_ARG_USB_DEVICE_THREADS, args->topic))
+                || (0 == strcmp(JSDRV_ARG_USB_IOCP_WORKERS, args->topic))
+                || jsdrv_cstr_starts_with(args->topic, "@/emulation/")) {
+            // backend argument, see jsdrvp_arg_get()
+        } else {
+            JSDRV_LOGW("jsdrv_initialize arg %s: unsupported, ignore", args->topic);
+        }
+    }
+    return 0;
+}
+
+static void msg_pools_initialize(struct jsdrv_context_s * c, uint32_t normal_init, uint32_t data_init) {
+    msg_pool_preallocate(c, MSG_CLASS_NORMAL, normal_init);
+    msg_pool_preallocate(c, MSG_CLASS_DATA, data_init);
+    for (uint32_t idx = 0; idx < MSG_CLASS_COUNT; ++idx) {
+        struct msg_pool_s * pool = &c->msg_classes[idx].pool;
+        JSDRV_LOGI("message pool %s: %u/%u", MSG_CLASS_NAME[idx],
+                   (unsigned int) pool->allocated, (unsigned int) pool->max);
+    }
+}
+
 int32_t jsdrv_initialize(struct jsdrv_context_s ** context, const struct jsdrv_arg_s * args, uint32_t timeout_ms) {
     JSDRV_LOGI("jsdrv_initialize: start");
     JSDRV_RETURN_ON_ERROR(jsdrv_platform_initialize());
     struct jsdrv_context_s * c = jsdrv_alloc_clr(sizeof(struct jsdrv_context_s));
+    uint32_t normal_init = 0;
+    uint32_t data_init = 0;
+    int32_t rv = args_parse(c, args, &normal_init, &data_init);
+    if (rv) {
+        usb_capture_close(c);
+        jsdrv_free(c);
+        jsdrv_platform_finalize();
+        return rv;
+    }
     c->args = args;
+    c->id = jsdrv_atomic_add_u32(&context_id_next_, 1);
     c->state = ST_INIT_AWAITING_FRONTEND;
     c->init_status = 0;
     jsdrv_list_initialize(&c->devices);
-    jsdrv_list_initialize(&c->cmd_timeouts);
-
-    MSG_QUEUE_ALLOC(c, c->msg_free);
-    MSG_QUEUE_ALLOC(c, c->msg_free_data);
+    jsdrv_list_initialize(&c->cmd_deferred);
+    jsdrv_list_initialize(&c->groups);
+    c->cmd_timeouts = jsdrv_timeouts_alloc();
+    c->param_cache = jsdrv_param_cache_new();
+    c->stages = jsdrv_stage_registry_alloc();
+
+    for (uint32_t idx = 0; idx < MSG_CLASS_COUNT; ++idx) {
+        MSG_QUEUE_ALLOC(c, c->msg_classes[idx].free);
+    }
     MSG_QUEUE_ALLOC(c, c->msg_cmd);
     MSG_QUEUE_ALLOC(c, c->msg_backend);
+    MSG_QUEUE_ALLOC(c, c->msg_backend_ctrl);
+    msg_pools_initialize(c, normal_init, data_init);
     c->pubsub = jsdrv_pubsub_initialize(c);
+    c->dispatch = jsdrv_dispatch_initialize(c, c->dispatch_threads);
+    jsdrv_pubsub_dispatch_set(c->pubsub, c->dispatch);
     struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_u32(c, JSDRV_MSG_VERSION, JSDRV_VERSION_U32);
     jsdrv_pubsub_publish(c->pubsub, msg);
     msg = jsdrvp_msg_alloc_str(c, JSDRV_MSG_DEVICE_LIST, "");  // start with empty device list
     jsdrv_pubsub_publish(c->pubsub, msg);
+    const char * isa = jsdrv_f32_ops_isa_to_str(jsdrv_f32_ops_isa());  // detect now, not on the first sample
+    JSDRV_LOGI("jsdrv_initialize: instruction set %s", isa);
+    msg = jsdrvp_msg_alloc_str(c, JSDRV_MSG_CPU_ISA, isa);
+    jsdrv_pubsub_publish(c->pubsub, msg);
     jsdrv_pubsub_process(c->pubsub);
     JSDRV_RETURN_ON_ERROR(jsdrv_buffer_initialize(c));
+    JSDRV_RETURN_ON_ERROR(jsdrv_align_initialize(c));
+    JSDRV_RETURN_ON_ERROR(jsdrv_spectrum_initialize(c));
+    JSDRV_RETURN_ON_ERROR(jsdrv_interval_initialize(c));
 
-    int32_t rv = jsdrv_thread_create(&c->thread, frontend_thread, c, 1);
+    *context = c;  // before the frontend thread starts the backends
+    rv = jsdrv_thread_create(&c->thread, frontend_thread, c, 1);
     if (rv) {
+        *context = NULL;
         jsdrv_finalize(c, 0);
         return rv;
     }
 
     msg = jsdrvp_msg_alloc_u32(c, JSDRV_MSG_INITIALIZE, 0);
     timeout_ms = timeout_ms ? timeout_ms : JSDRV_TIMEOUT_MS_INIT;
-    *context = c;
     rv = api_cmd(c, msg, timeout_ms);
     JSDRV_LOGI("jsdrv_initialize: return %ld", rv);
     return rv;
@@ -966,32 +2846,113 @@ void jsdrv_finalize(struct jsdrv_context_s * context, uint32_t timeout_ms) {
         jsdrv_cstr_copy(msg->topic, JSDRV_MSG_FINALIZE, sizeof(msg->topic));
         msg_queue_push(context->msg_cmd, msg);
         jsdrv_thread_join(&context->thread, timeout_ms);
+        usb_capture_close(c);
+        jsdrv_interval_finalize();
+        jsdrv_spectrum_finalize();
+        jsdrv_align_finalize();
         jsdrv_buffer_finalize();
+        jsdrv_dispatch_finalize(c->dispatch);
+        c->dispatch = NULL;
         jsdrv_pubsub_finalize(c->pubsub);
         c->pubsub = NULL;
 
         MSG_QUEUE_FREE(c->msg_cmd);
         MSG_QUEUE_FREE(c->msg_backend);
-        MSG_QUEUE_FREE(c->msg_free);
-        MSG_QUEUE_FREE(c->msg_free_data);
+        MSG_QUEUE_FREE(c->msg_backend_ctrl);
+        for (uint32_t idx = 0; idx < MSG_CLASS_COUNT; ++idx) {
+            MSG_QUEUE_FREE(c->msg_classes[idx].free);
+        }
+        jsdrv_timeouts_free(c->cmd_timeouts);
+        c->cmd_timeouts = NULL;
+        jsdrv_param_cache_free(c->param_cache);
+        c->param_cache = NULL;
+        jsdrv_stage_registry_free(c->stages);
+        c->stages = NULL;
 
         jsdrv_free(c);
         jsdrv_platform_finalize();
     }
 }
 
-void jsdrvp_backend_send(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
-    char buf[32];
-    jsdrv_union_value_to_str(&msg->value, buf, (uint32_t) sizeof(buf), 1);
+uint32_t jsdrvp_topic_intern(struct jsdrv_context_s * context, const char * topic) {
+    return jsdrv_pubsub_topic_intern(context->pubsub, topic);
+}
+
+static void stage_process(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
+    if ((msg->inner_msg_type != JSDRV_MSG_TYPE_DATA) || (msg->value.app != JSDRV_PAYLOAD_TYPE_STREAM)
+            || (msg->value.size < JSDRV_STREAM_HEADER_SIZE)) {
+        return;
+    }
+    const char * topic = msg->topic;
+    if (msg->topic_id && !msg->topic[0]) {
+        topic = jsdrv_pubsub_topic_name(context->pubsub, msg->topic_id);
+        if (!topic) {
+            return;  // handle_backend_msg() reports the invalid topic_id
+        }
+    }
+    jsdrv_stage_registry_process(context->stages, topic, (const struct jsdrv_stream_signal_s *) msg->value.value.bin);
+}
+
+static void backend_push(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
     if (context->msg_backend) {
-        JSDRV_LOGD2("jsdrvp_backend_send %s %s", msg->topic, buf);
-        msg_queue_push(context->msg_backend, msg);
+        if (msg->topic_id) {
+            JSDRV_LOGD3("jsdrvp_backend_send topic_id=%u", (unsigned int) msg->topic_id);
+        } else {
+            char buf[32];
+            jsdrv_union_value_to_str(&msg->value, buf, (uint32_t) sizeof(buf), 1);
+            JSDRV_LOGD2("jsdrvp_backend_send %s %s", msg->topic, buf);
+        }
+        msg_queue_push(backend_msg_is_bulk(msg) ? context->msg_backend : context->msg_backend_ctrl, msg);
     } else {  // should never happen
         JSDRV_LOGW("jsdrvp_backend_send but no backend queue!");
         // memory leak
     }
 }
 
+void jsdrvp_backend_send(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
+    JSDRV_TRACE_INSTANT("backend_send", msg->topic, msg->topic_id);
+    stage_process(context, msg);
+    backend_push(context, msg);
+}
+
+int32_t jsdrv_stage_register(struct jsdrv_context_s * context,
+        const char * topic, jsdrv_stage_fn fn, void * user_data) {
+    if (NULL == context) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return jsdrv_stage_registry_add(context->stages, topic, fn, user_data);
+}
+
+int32_t jsdrv_stage_unregister(struct jsdrv_context_s * context,
+        const char * topic, jsdrv_stage_fn fn, void * user_data) {
+    if (NULL == context) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return jsdrv_stage_registry_remove(context->stages, topic, fn, user_data);
+}
+
+int32_t jsdrv_stage_publish(struct jsdrv_context_s * context,
+        const char * topic, const struct jsdrv_stream_signal_s * block) {
+    if ((NULL == context) || (NULL == topic) || !topic[0] || (NULL == block)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint64_t data_size = ((uint64_t) block->element_count * block->element_size_bits + 7) / 8;
+    if (data_size > sizeof(block->data)) {
+        return JSDRV_ERROR_TOO_BIG;
+    }
+    uint32_t size = JSDRV_STREAM_HEADER_SIZE + (uint32_t) data_size;
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(context, topic, size);
+    memcpy(m->payload.bin, block, size);
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    m->value.size = size;
+    backend_push(context, m);  // bypass the stages
+    return 0;
+}
+
+uint32_t jsdrvp_backend_queue_depth(struct jsdrv_context_s * context) {
+    return context->msg_backend ? msg_queue_depth(context->msg_backend) : 0;
+}
+
 void jsdrvp_send_finalize_msg(struct jsdrv_context_s * context, struct msg_queue_s * q, const char * topic) {
     struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc(context);
     jsdrv_cstr_copy(msg->topic, JSDRV_MSG_FINALIZE, sizeof(msg->topic));
@@ -1008,9 +2969,51 @@ int32_t jsdrv_open(struct jsdrv_context_s * context, const char * device_prefix,
     return jsdrv_publish(context, t.topic, &jsdrv_union_i32(mode), JSDRV_TIMEOUT_MS_DEFAULT);
 }
 
+int32_t jsdrv_open_async(struct jsdrv_context_s * context, const char * device_prefix, int32_t mode,
+        jsdrv_completion_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrv_topic_s t;
+    jsdrv_topic_set(&t, device_prefix);
+    jsdrv_topic_append(&t, JSDRV_MSG_OPEN);
+    return jsdrv_publish_async(context, t.topic, &jsdrv_union_i32(mode), JSDRV_TIMEOUT_MS_DEFAULT,
+                               cbk_fn, cbk_user_data);
+}
+
+int32_t jsdrv_open_many(struct jsdrv_context_s * context,
+        const char * const * device_prefixes, uint32_t count, int32_t mode,
+        int32_t * return_codes, uint32_t timeout_ms) {
+    if (!context || (!device_prefixes && count)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (!count) {
+        return 0;
+    }
+    struct jsdrv_topic_s * topics = jsdrv_alloc(count * sizeof(struct jsdrv_topic_s));
+    struct jsdrv_arg_s * args = jsdrv_alloc(count * sizeof(struct jsdrv_arg_s));
+    for (uint32_t i = 0; i < count; ++i) {
+        jsdrv_topic_set(&topics[i], device_prefixes[i]);
+        jsdrv_topic_append(&topics[i], JSDRV_MSG_OPEN);
+        args[i].topic = topics[i].topic;
+        args[i].value = jsdrv_union_i32(mode);
+    }
+    timeout_ms = timeout_ms ? timeout_ms : JSDRV_TIMEOUT_MS_DEFAULT;
+    int32_t rv = jsdrv_publish_batch(context, args, count, return_codes, timeout_ms);
+    jsdrv_free(args);
+    jsdrv_free(topics);
+    return rv;
+}
+
 int32_t jsdrv_close(struct jsdrv_context_s * context, const char * device_prefix) {
     struct jsdrv_topic_s t;
     jsdrv_topic_set(&t, device_prefix);
     jsdrv_topic_append(&t, JSDRV_MSG_CLOSE);
     return jsdrv_publish(context, t.topic, &jsdrv_union_i32(0), JSDRV_TIMEOUT_MS_DEFAULT);
 }
+
+int32_t jsdrv_close_async(struct jsdrv_context_s * context, const char * device_prefix,
+        jsdrv_completion_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrv_topic_s t;
+    jsdrv_topic_set(&t, device_prefix);
+    jsdrv_topic_append(&t, JSDRV_MSG_CLOSE);
+    return jsdrv_publish_async(context, t.topic, &jsdrv_union_i32(0), JSDRV_TIMEOUT_MS_DEFAULT,
+                               cbk_fn, cbk_user_data);
+}
@@ -18,10 +18,35 @@
 #include "jsdrv_prv/log.h"
 #include "jsdrv/error_code.h"
 #include <math.h>
+#include <stdint.h>
 
 #define delim(op__) ((struct jsdrv_union_s){.type=JSDRV_UNION_NULL, .op=op__, .flags=0, .app=0, .value={.u64=0}, .size=0})
-const char * WHITESPACE = " \n\t\r";
-const char * ESCAPE = "\"\\/bfnrtu";
+
+// Character classes for the table-driven tokenizer.
+#define CH_WS           (0x01U)  // whitespace
+#define CH_ESC          (0x02U)  // valid character after '\\' in a string
+#define CH_HEX          (0x04U)  // hexadecimal digit
+#define CH_DIGIT        (0x08U)  // decimal digit
+#define CH_STR_STOP     (0x10U)  // ends a run of plain string characters
+#define CH_FRACT        (0x20U)  // starts the f64 fraction or exponent
+
+#define CH_HEX_LETTER   (CH_HEX | CH_ESC)  // 'b' and 'f' are also escapes
+
+static const uint8_t CHAR_CLASS[256] = {
+    [0] = CH_STR_STOP,
+    [' '] = CH_WS, ['\n'] = CH_WS, ['\t'] = CH_WS, ['\r'] = CH_WS,
+    ['"'] = CH_ESC | CH_STR_STOP, ['\\'] = CH_ESC | CH_STR_STOP, ['/'] = CH_ESC,
+    ['n'] = CH_ESC, ['r'] = CH_ESC, ['t'] = CH_ESC, ['u'] = CH_ESC,
+    ['0'] = CH_HEX | CH_DIGIT, ['1'] = CH_HEX | CH_DIGIT, ['2'] = CH_HEX | CH_DIGIT,
+    ['3'] = CH_HEX | CH_DIGIT, ['4'] = CH_HEX | CH_DIGIT, ['5'] = CH_HEX | CH_DIGIT,
+    ['6'] = CH_HEX | CH_DIGIT, ['7'] = CH_HEX | CH_DIGIT, ['8'] = CH_HEX | CH_DIGIT,
+    ['9'] = CH_HEX | CH_DIGIT,
+    ['a'] = CH_HEX, ['b'] = CH_HEX_LETTER, ['c'] = CH_HEX, ['d'] = CH_HEX, ['e'] = CH_HEX | CH_FRACT, ['f'] = CH_HEX_LETTER,
+    ['A'] = CH_HEX, ['B'] = CH_HEX, ['C'] = CH_HEX, ['D'] = CH_HEX, ['E'] = CH_HEX | CH_FRACT, ['F'] = CH_HEX,
+    ['.'] = CH_FRACT,
+};
+
+#define CH_IS(ch__, class__)  (CHAR_CLASS[(uint8_t) (ch__)] & (class__))
 
 #define NEXT(s__)       (s__)->json[(s__)->offset]
 #define ADVANCE(s__)    (s__)->offset++
@@ -43,32 +68,8 @@ static int32_t on_token_ignore(void * user_data, const struct jsdrv_union_s * to
     return 0;
 }
 
-static int32_t is_in(char ch, const char * list) {
-    for (const char * w = list; *w; ++w) {
-        if (ch == *w) {
-            return 1;
-        }
-    }
-    return 0;
-}
-
-static int32_t is_whitespace(char ch) { return is_in(ch, WHITESPACE); }
-static int32_t is_escape(char ch) { return is_in(ch, ESCAPE); }
-
-static int32_t to_hex(char v) {
-    if ((v >= '0') && (v <= '9')) {
-        return v - '0';
-    } else if ((v >= 'a') && (v <= 'f')) {
-        return v - 'a' + 10;
-    } else if ((v >= 'A') && (v <= 'F')) {
-        return v - 'A' + 10;
-    } else {
-        return -1;
-    }
-}
-
 static void skip_whitespace(struct parse_s * s) {
-    while (is_whitespace(NEXT(s))) {
+    while (CH_IS(NEXT(s), CH_WS)) {
         ADVANCE(s);
     }
 }
@@ -88,7 +89,13 @@ static int32_t parse_string(struct parse_s * s, uint8_t op) {
     ADVANCE(s);
     uint32_t offset_start = s->offset;
     char ch;
+    const char * json = s->json;
     while (1) {
+        uint32_t offset = s->offset;
+        while (!CH_IS(json[offset], CH_STR_STOP)) {
+            ++offset;  // plain characters
+        }
+        s->offset = offset;
         ch = NEXT(s);
         if (!ch) {
             JSDRV_LOGW("unterminated string starting at %u", offset_start - 1);
@@ -99,7 +106,7 @@ static int32_t parse_string(struct parse_s * s, uint8_t op) {
         } else if (ch == '\\') {
             ADVANCE(s);
             ch = NEXT(s);
-            if (!is_escape(ch)) {
+            if (!CH_IS(ch, CH_ESC)) {
                 JSDRV_LOGW("invalid string escape %c at %u", ch, s->offset);
                 return JSDRV_ERROR_SYNTAX_ERROR;
             }
@@ -107,7 +114,7 @@ static int32_t parse_string(struct parse_s * s, uint8_t op) {
                 for (int i = 0; i < 4; i++) {
                     ADVANCE(s);
                     ch = NEXT(s);
-                    if (to_hex(ch) < 0) {
+                    if (!CH_IS(ch, CH_HEX)) {
                         JSDRV_LOGW("invalid string escape hex %c at %u", ch, s->offset);
                         return JSDRV_ERROR_SYNTAX_ERROR;
                     }
@@ -198,7 +205,8 @@ static int32_t parse_literal(struct parse_s * s, const char * literal, struct js
 
 static int32_t parse_number(struct parse_s * s) {
     bool is_neg = false;
-    int32_t whole = 0;
+    int64_t whole = 0;
+    double whole_f64 = -1.0;  // the whole part once it exceeds int64, otherwise negative
     uint32_t offset = s->offset;
     char ch = NEXT(s);
     if (ch == '-') {
@@ -214,10 +222,14 @@ static int32_t parse_number(struct parse_s * s) {
     } else if ((ch >= '1') && (ch <= '9')) {
         while (1) {
             ch = NEXT(s);
-            if ((ch >= '0') && (ch <= '9')) {
-                whole = whole * 10 + (ch - '0');
-            } else {
+            if (!CH_IS(ch, CH_DIGIT)) {
                 break;
+            } else if (whole_f64 >= 0.0) {
+                whole_f64 = whole_f64 * 10 + (ch - '0');
+            } else if ((whole > (INT64_MAX / 10)) || ((whole == (INT64_MAX / 10)) && ((ch - '0') > (INT64_MAX % 10)))) {
+                whole_f64 = (double) whole * 10 + (ch - '0');
+            } else {
+                whole = whole * 10 + (ch - '0');
             }
             ADVANCE(s);
         }
@@ -226,20 +238,24 @@ static int32_t parse_number(struct parse_s * s) {
         return JSDRV_ERROR_SYNTAX_ERROR;
     }
 
-    if (!is_in(NEXT(s), ".eE")) {  // i32
+    if (!CH_IS(NEXT(s), CH_FRACT) && (whole_f64 < 0.0)) {  // i32, or i64 when too large
         if (is_neg) {
             whole = -whole;
         }
-        emit(s, &jsdrv_union_i32(whole));
+        if ((whole >= INT32_MIN) && (whole <= INT32_MAX)) {
+            emit(s, &jsdrv_union_i32((int32_t) whole));
+        } else {
+            emit(s, &jsdrv_union_i64(whole));
+        }
     } else { // f64 support
-        double f64 = whole;
+        double f64 = (whole_f64 >= 0.0) ? whole_f64 : (double) whole;
         if (NEXT(s) == '.') {
             ADVANCE(s);
             int32_t pow10 = 0;
             double fract = 0;
             while (1) {
                 ch = NEXT(s);
-                if ((ch >= '0') && (ch <= '9')) {
+                if (CH_IS(ch, CH_DIGIT)) {
                     fract = fract * 10 + (ch - '0');
                     --pow10;
                 } else {
@@ -258,7 +274,6 @@ static int32_t parse_number(struct parse_s * s) {
             ch = NEXT(s);
             is_neg = false;
             double e = 0.0;
-            whole = 0;
 
             if (ch == '+') {
                 ADVANCE(s);
@@ -269,29 +284,28 @@ static int32_t parse_number(struct parse_s * s) {
                 ch = NEXT(s);
             }
 
-            if (!((ch >= '0') && (ch <= '9'))) {
+            if (!CH_IS(ch, CH_DIGIT)) {
                 JSDRV_LOGE("f64 invalid exponent", offset);
                 return JSDRV_ERROR_SYNTAX_ERROR;
             }
 
             while (1) {
-                if ((ch >= '0') && (ch <= '9')) {
-                    whole = whole * 10 + (ch - '0');
+                if (CH_IS(ch, CH_DIGIT)) {
+                    e = e * 10 + (ch - '0');
                 } else {
                     break;
                 }
                 ADVANCE(s);
                 ch = NEXT(s);
             }
-            e = whole;
 
             if (NEXT(s) == '.') {
                 ADVANCE(s);
-                int32_t pow10 = 1;
+                double pow10 = 1.0;
                 double fract = 0;
                 while (1) {
                     ch = NEXT(s);
-                    if ((ch >= '0') && (ch <= '9')) {
+                    if (CH_IS(ch, CH_DIGIT)) {
                         fract = fract * 10 + (ch - '0');
                         pow10 *= 10;
                     } else {
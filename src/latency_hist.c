@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/latency_hist.h"
+#include "jsdrv/time.h"
+#include "tinyprintf.h"
+#include <string.h>
+
+
+void jsdrv_latency_hist_clear(struct jsdrv_latency_hist_s * self) {
+    memset(self, 0, sizeof(*self));
+}
+
+void jsdrv_latency_hist_add(struct jsdrv_latency_hist_s * self, int64_t latency) {
+    uint32_t us = (latency > 0) ? (uint32_t) JSDRV_TIME_TO_MICROSECONDS(latency) : 0;
+    uint32_t edge = JSDRV_LATENCY_HIST_BIN0_US;
+    uint32_t idx = 0;
+    while ((idx < (JSDRV_LATENCY_HIST_BINS - 1)) && (us >= edge)) {
+        ++idx;
+        edge <<= 1;
+    }
+    ++self->bins[idx];
+    ++self->count;
+    self->sum_us += us;
+    if (us > self->max_us) {
+        self->max_us = us;
+    }
+}
+
+uint32_t jsdrv_latency_hist_json(struct jsdrv_latency_hist_s * self, char * buf, uint32_t size) {
+    uint32_t count = self->count;
+    char * p = buf;
+    char * p_end = buf + size;
+    int n;
+    if (!count || !buf) {
+        return 0;
+    }
+    n = tfp_snprintf(p, p_end - p, "{\"count\": %u, \"avg_us\": %u, \"max_us\": %u, \"edges_us\": [",
+                     (unsigned int) count, (unsigned int) (self->sum_us / count), (unsigned int) self->max_us);
+    if ((n < 0) || (n >= (p_end - p))) {
+        return 0;
+    }
+    p += n;
+    uint32_t edge = JSDRV_LATENCY_HIST_BIN0_US;
+    for (uint32_t i = 0; i < (JSDRV_LATENCY_HIST_BINS - 1); ++i) {
+        n = tfp_snprintf(p, p_end - p, "%s%u", i ? ", " : "", (unsigned int) edge);
+        if ((n < 0) || (n >= (p_end - p))) {
+            return 0;
+        }
+        p += n;
+        edge <<= 1;
+    }
+    for (uint32_t i = 0; i < JSDRV_LATENCY_HIST_BINS; ++i) {
+        n = tfp_snprintf(p, p_end - p, "%s%u", i ? ", " : "], \"counts\": [", (unsigned int) self->bins[i]);
+        if ((n < 0) || (n >= (p_end - p))) {
+            return 0;
+        }
+        p += n;
+    }
+    if ((p_end - p) < 3) {
+        return 0;
+    }
+    *p++ = ']';
+    *p++ = '}';
+    *p = 0;
+    jsdrv_latency_hist_clear(self);
+    return count;
+}
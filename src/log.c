@@ -26,9 +26,14 @@
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv_prv/list.h"
+#include "jsdrv_prv/log_binary.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/mpmc_ring.h"
 #include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/thread_stats.h"
 #include "tinyprintf.h"
 #include <stdio.h>
+#include <string.h>
 
 #if _WIN32
 #include <windows.h>
@@ -40,10 +45,7 @@
 #endif
 
 #define LOG_DPRINTF       (0)
-#define MSG_COUNT_INIT    (1024U)
-#define MSG_PEND_COUNT_MAX (1024U)
-#define LOCK_MSG()        jsdrv_os_mutex_lock(log_instance_.msg_mutex)
-#define UNLOCK_MSG()      jsdrv_os_mutex_unlock(log_instance_.msg_mutex)
+#define MSG_COUNT        (1024U)  // power of 2
 #define LOCK_DISPATCH()   jsdrv_os_mutex_lock(log_instance_.dispatch_mutex)
 #define UNLOCK_DISPATCH() jsdrv_os_mutex_unlock(log_instance_.dispatch_mutex)
 
@@ -80,6 +82,28 @@ char const jsdrv_log_level_char[JSDRV_LOG_LEVEL_ALL + 1] = {
         '!', 'A', 'C', 'E', 'W', 'N', 'I', 'D', 'D', 'D', '.'
 };
 
+static const char * const module_names_[JSDRV_LOG_MODULE_COUNT] = {
+        "default", "frontend", "pubsub", "usb", "js110", "js220", "buffer",
+};
+
+static int8_t module_levels_[JSDRV_LOG_MODULE_COUNT] = {
+        JSDRV_LOG_LEVEL_ALL, JSDRV_LOG_LEVEL_ALL, JSDRV_LOG_LEVEL_ALL, JSDRV_LOG_LEVEL_ALL,
+        JSDRV_LOG_LEVEL_ALL, JSDRV_LOG_LEVEL_ALL, JSDRV_LOG_LEVEL_ALL,
+};
+
+// min(module level, global level), which starts OFF
+volatile int8_t jsdrv_log_module_threshold[JSDRV_LOG_MODULE_COUNT] = {
+        JSDRV_LOG_LEVEL_OFF, JSDRV_LOG_LEVEL_OFF, JSDRV_LOG_LEVEL_OFF, JSDRV_LOG_LEVEL_OFF,
+        JSDRV_LOG_LEVEL_OFF, JSDRV_LOG_LEVEL_OFF, JSDRV_LOG_LEVEL_OFF,
+};
+
+#define RATE_REGISTERING    (1U)
+#define RATE_READY          (2U)
+#define RATE_SUMMARY_FORMAT "suppressed %u identical messages"
+
+static struct jsdrv_log_rate_s * volatile rate_sites_[JSDRV_LOG_RATE_SITES_MAX];
+static volatile uint32_t rate_site_count_ = 0;
+
 // platform-specific functions
 static void thread_notify();
 static int32_t thread_start();
@@ -87,7 +111,6 @@ static void thread_stop();
 
 
 struct msg_s {
-    struct jsdrv_list_s item;  // must be first
     struct jsdrv_log_header_s header;
     char filename[JSDRV_LOG_FILENAME_SIZE_MAX];
     char message[JSDRV_LOG_MESSAGE_SIZE_MAX];
@@ -104,14 +127,14 @@ struct log_s {
     volatile uint32_t active_count;
     volatile int8_t quit;
     volatile int8_t level;
-    volatile uint8_t dropping;
-    volatile uint32_t msg_pend_count;
+    volatile uint32_t dropped;   // messages lost since the last drop notice
+    volatile uint32_t notified;  // 1 when the log thread has a pending wake
 
     struct jsdrv_list_s dispatch_list;
-    struct jsdrv_list_s msg_free;
-    struct jsdrv_list_s msg_pend;
+    struct jsdrv_log_binary_s * binary;   // optional binary ring file
+    struct jsdrv_mpmc_ring_s * msg_free;  // preallocated msg_s instances
+    struct jsdrv_mpmc_ring_s * msg_pend;  // msg_s instances waiting for dispatch
     jsdrv_os_mutex_t dispatch_mutex;
-    jsdrv_os_mutex_t msg_mutex;
 
 #if _WIN32
     // Windows
@@ -130,13 +153,13 @@ static struct log_s log_instance_ = {
         .active_count=0,
         .quit=0,
         .level=JSDRV_LOG_LEVEL_OFF,
-        .dropping=0,
-        .msg_pend_count=0,
+        .dropped=0,
+        .notified=0,
         .dispatch_list={NULL, NULL},
-        .msg_free={NULL, NULL},
-        .msg_pend={NULL, NULL},
+        .binary=NULL,
+        .msg_free=NULL,
+        .msg_pend=NULL,
         .dispatch_mutex=NULL,
-        .msg_mutex=NULL,
 #if _WIN32
         .event=NULL,
         .thread=NULL,
@@ -148,77 +171,103 @@ static struct log_s log_instance_ = {
 #endif
 };
 
-static struct msg_s * msg_alloc() {
-    struct jsdrv_list_s * item;
-    struct msg_s * msg;
-    if (NULL == log_instance_.msg_free.next) {
-        jsdrv_list_initialize(&log_instance_.msg_free);
-    }
-    if (NULL == log_instance_.msg_pend.next) {
-        jsdrv_list_initialize(&log_instance_.msg_pend);
-    }
-    item = jsdrv_list_remove_head(&log_instance_.msg_free);
-    if (NULL == item) {
-        msg = jsdrv_alloc(sizeof(struct msg_s));
-        jsdrv_list_initialize(&msg->item);
-    } else {
-        msg = JSDRV_CONTAINER_OF(item, struct msg_s, item);
-    }
-    return msg;
+static void msg_header(struct msg_s * msg, uint8_t level, const char * filename, uint32_t line) {
+    msg->header.version = JSDRV_LOG_VERSION;
+    msg->header.level = level;
+    msg->header.line = line;
+    msg->header.rsvu8_1 = 0;
+    msg->header.rsvu8_2 = 0;
+    msg->header.timestamp = jsdrv_time_utc();
+    jsdrv_cstr_copy(msg->filename, filename, sizeof(msg->filename));
 }
 
-void jsdrv_log_publish(uint8_t level, const char * filename, uint32_t line, const char * format, ...) {
-    va_list args;
+static bool publish_check(uint8_t level) {
     if (0 == log_instance_.active_count) {
         dprintf("jsdrv_log_publish but not active");
-        return;
+        return false;
     } else if (log_instance_.quit) {
         dprintf("jsdrv_log_publish but quit");
-        return;
+        return false;
     } else if (level > log_instance_.level) {
         // dprintf("jsdrv_log_publish but ignore");
+        return false;
+    }
+    return true;
+}
+
+static void publish_v(uint8_t level, const char * filename, uint32_t line, const char * format, va_list args) {
+    // lock-free: any thread may publish while the log thread dispatches
+    struct msg_s * msg = jsdrv_mpmc_ring_pop(log_instance_.msg_free);
+    if (NULL == msg) {
+        jsdrv_atomic_add_u32(&log_instance_.dropped, 1);
         return;
-    } else if (log_instance_.dropping != 0) {
-        // dprintf("jsdrv_log_publish dropping");
-        return;
-    } else {
-        // dprintf("jsdrv_log_publish");
     }
+    msg_header(msg, level, filename, line);
+    vsnprintf(msg->message, sizeof(msg->message), format, args);
+    jsdrv_mpmc_ring_push(log_instance_.msg_pend, msg);  // never full: same capacity as msg_free
+    if (0 == jsdrv_atomic_exchange_u32(&log_instance_.notified, 1)) {
+        thread_notify();  // only the first message since the last wake
+    }
+}
 
+static void publish(uint8_t level, const char * filename, uint32_t line, const char * format, ...) {
+    va_list args;
     va_start(args, format);
-    LOCK_MSG();
-    if (0 == log_instance_.dropping) {
-        struct msg_s *msg = msg_alloc();
-        if (NULL == msg) {
-            // do nothing
-        } else if (log_instance_.msg_pend_count >= MSG_PEND_COUNT_MAX) {
-            log_instance_.dropping = 1;
-            ++log_instance_.msg_pend_count;
-            msg->header.version = JSDRV_LOG_VERSION;
-            msg->header.level = JSDRV_LOG_LEVEL_ERROR;
-            msg->header.line = __LINE__;
-            msg->header.rsvu8_1 = 0;
-            msg->header.rsvu8_2 = 0;
-            msg->header.timestamp = jsdrv_time_utc();
-            jsdrv_cstr_copy(msg->filename, __FILENAME__, sizeof(msg->filename));
-            jsdrv_cstr_copy(msg->message, "log drop due to overflow\n   ... missing messages ...", sizeof(msg->message));
-            jsdrv_list_add_tail(&log_instance_.msg_pend, &msg->item);
-            thread_notify();
-        } else {
-            ++log_instance_.msg_pend_count;
-            msg->header.version = JSDRV_LOG_VERSION;
-            msg->header.level = level;
-            msg->header.line = line;
-            msg->header.rsvu8_1 = 0;
-            msg->header.rsvu8_2 = 0;
-            msg->header.timestamp = jsdrv_time_utc();
-            jsdrv_cstr_copy(msg->filename, filename, sizeof(msg->filename));
-            vsnprintf(msg->message, sizeof(msg->message), format, args);
-            jsdrv_list_add_tail(&log_instance_.msg_pend, &msg->item);
-            thread_notify();
+    publish_v(level, filename, line, format, args);
+    va_end(args);
+}
+
+void jsdrv_log_publish(uint8_t level, const char * filename, uint32_t line, const char * format, ...) {
+    va_list args;
+    if (!publish_check(level)) {
+        return;
+    }
+    va_start(args, format);
+    publish_v(level, filename, line, format, args);
+    va_end(args);
+}
+
+static void rate_register(struct jsdrv_log_rate_s * rate, uint8_t level, const char * filename, uint32_t line) {
+    rate->level = level;
+    rate->line = line;
+    rate->filename = filename;
+    rate->suppressed = 0;
+    rate->t_next_ms = jsdrv_time_ms_u32() + JSDRV_LOG_RATE_INTERVAL_MS;
+    uint32_t idx = jsdrv_atomic_add_u32(&rate_site_count_, 1) - 1;
+    jsdrv_atomic_fence();
+    if (idx < JSDRV_LOG_RATE_SITES_MAX) {
+        rate_sites_[idx] = rate;  // for deferred summaries
+    }
+    jsdrv_atomic_store_u32(&rate->registered, RATE_READY);
+}
+
+void jsdrv_log_publish_rate(struct jsdrv_log_rate_s * rate, uint8_t level, const char * filename, uint32_t line,
+                            const char * format, ...) {
+    va_list args;
+    if (!publish_check(level)) {
+        return;
+    }
+    uint32_t state = jsdrv_atomic_load_u32(&rate->registered);
+    if (RATE_READY == state) {
+        uint32_t now = jsdrv_time_ms_u32();
+        uint32_t t_next = jsdrv_atomic_load_u32(&rate->t_next_ms);
+        if (((int32_t) (now - t_next) < 0)
+                || !jsdrv_atomic_cas_u32(&rate->t_next_ms, t_next, now + JSDRV_LOG_RATE_INTERVAL_MS)) {
+            jsdrv_atomic_add_u32(&rate->suppressed, 1);
+            return;
+        }
+        uint32_t suppressed = jsdrv_atomic_exchange_u32(&rate->suppressed, 0);
+        if (suppressed) {
+            publish(level, filename, line, RATE_SUMMARY_FORMAT, (unsigned int) suppressed);
         }
+    } else if ((0 != state) || !jsdrv_atomic_cas_u32(&rate->registered, 0, RATE_REGISTERING)) {
+        jsdrv_atomic_add_u32(&rate->suppressed, 1);  // another thread is registering
+        return;
+    } else {
+        rate_register(rate, level, filename, line);
     }
-    UNLOCK_MSG();
+    va_start(args, format);
+    publish_v(level, filename, line, format, args);
     va_end(args);
 }
 
@@ -254,40 +303,68 @@ int32_t jsdrv_log_unregister(jsdrv_log_recv fn, void * user_data) {
     return 0;
 }
 
-static void process(struct log_s * self) {
-    struct jsdrv_list_s * item = NULL;
-    struct msg_s * msg = NULL;
-    struct dispatch_s * dispatch = NULL;
+static void dispatch(struct log_s * self, struct msg_s * msg) {
+    struct jsdrv_list_s * item;
+    struct dispatch_s * d;
+    if (msg->header.level > self->level) {
+        return;
+    }
+    LOCK_DISPATCH();
+    if (self->binary) {
+        jsdrv_log_binary_file_write(self->binary, &msg->header, msg->filename, msg->message);
+    }
+    jsdrv_list_foreach(&self->dispatch_list, item) {
+        d = JSDRV_CONTAINER_OF(item, struct dispatch_s, item);
+        d->fn(d->user_data, &msg->header, msg->filename, msg->message);
+    }
+    UNLOCK_DISPATCH();
+}
 
-    while (1) {
-        LOCK_MSG();
-        if (NULL != msg) {
-            jsdrv_list_add_tail(&self->msg_free, &msg->item);
-        }
-        item = jsdrv_list_remove_head(&self->msg_pend);
-        UNLOCK_MSG();
-        if (!item) {
-            break;
-        }
-        if (log_instance_.msg_pend_count > 0) {
-            --log_instance_.msg_pend_count;
-        }
-        if (log_instance_.msg_pend_count == 0) {
-            log_instance_.dropping = 0;
-        }
-        msg = JSDRV_CONTAINER_OF(item, struct msg_s, item);
-        if (msg->header.level > self->level) {
+// Publish summaries for call sites that went quiet while suppressed, or all on quit.
+static void rate_flush(struct log_s * self) {
+    uint32_t count = jsdrv_atomic_load_u32(&rate_site_count_);
+    uint32_t now = jsdrv_time_ms_u32();
+    if (count > JSDRV_LOG_RATE_SITES_MAX) {
+        count = JSDRV_LOG_RATE_SITES_MAX;
+    }
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        struct jsdrv_log_rate_s * rate = rate_sites_[idx];
+        if ((NULL == rate) || (0 == rate->suppressed) || (!self->quit && ((int32_t) (now - rate->t_next_ms) < 0))) {
             continue;
         }
-        LOCK_DISPATCH();
-        jsdrv_list_foreach(&self->dispatch_list, item) {
-            dispatch = JSDRV_CONTAINER_OF(item, struct dispatch_s, item);
-            dispatch->fn(dispatch->user_data, &msg->header, msg->filename, msg->message);
+        uint32_t suppressed = jsdrv_atomic_exchange_u32(&rate->suppressed, 0);
+        if (suppressed) {
+            struct msg_s msg;
+            msg_header(&msg, rate->level, rate->filename, rate->line);
+            snprintf(msg.message, sizeof(msg.message), RATE_SUMMARY_FORMAT, (unsigned int) suppressed);
+            dispatch(self, &msg);
         }
-        UNLOCK_DISPATCH();
     }
 }
 
+static void process(struct log_s * self) {
+    struct msg_s * msg;
+    jsdrv_atomic_store_u32(&self->notified, 0);  // before draining, so no wake is lost
+    while (1) {
+        msg = jsdrv_mpmc_ring_pop(self->msg_pend);
+        if (NULL == msg) {
+            break;
+        }
+        dispatch(self, msg);
+        jsdrv_mpmc_ring_push(self->msg_free, msg);
+    }
+
+    uint32_t dropped = jsdrv_atomic_exchange_u32(&self->dropped, 0);
+    if (dropped) {
+        struct msg_s drop_msg;
+        msg_header(&drop_msg, JSDRV_LOG_LEVEL_ERROR, __FILENAME__, __LINE__);
+        snprintf(drop_msg.message, sizeof(drop_msg.message),
+                 "log drop due to overflow\n   ... %u missing messages ...", (unsigned int) dropped);
+        dispatch(self, &drop_msg);
+    }
+    rate_flush(self);
+}
+
 static void list_free(struct jsdrv_list_s * list) {
     struct jsdrv_list_s * item;
     while (1) {
@@ -302,6 +379,7 @@ static void list_free(struct jsdrv_list_s * list) {
 #if _WIN32
 static DWORD WINAPI log_thread(LPVOID lpParam) {
     (void) lpParam;
+    jsdrv_thread_stats_register("jsdrv_log");  // not jsdrv_thread_name_set(), which may log
     while (!log_instance_.quit) {
         WaitForSingleObject(log_instance_.event, 100);
         ResetEvent(log_instance_.event);
@@ -360,6 +438,7 @@ static void thread_stop() {
 #else
 static void * log_thread(void * arg) {
     (void) arg;
+    jsdrv_thread_stats_register("jsdrv_log");  // not jsdrv_thread_name_set(), which may log
     uint8_t rd_buf[1024];
     struct pollfd fds;
     fds.fd = log_instance_.fd_read;
@@ -420,46 +499,31 @@ void jsdrv_log_initialize() {
     dprintf("jsdrv_log_initialize");
 
     if (0 == log_instance_.initialized) {
-        log_instance_.msg_mutex = jsdrv_os_mutex_alloc("jsdrv_log_msg");
-        LOCK_MSG();
         log_instance_.dispatch_mutex = jsdrv_os_mutex_alloc("jsdrv_log_dispatch");
         LOCK_DISPATCH();
+        log_instance_.msg_free = jsdrv_mpmc_ring_alloc(MSG_COUNT);
+        log_instance_.msg_pend = jsdrv_mpmc_ring_alloc(MSG_COUNT);
+        for (size_t i = 0; i < MSG_COUNT; ++i) {
+            jsdrv_mpmc_ring_push(log_instance_.msg_free, jsdrv_alloc(sizeof(struct msg_s)));
+        }
         log_instance_.initialized = 1;
         UNLOCK_DISPATCH();
-        UNLOCK_MSG();
     }
 
     LOCK_DISPATCH();
     if (0 == log_instance_.active_count) {
-        log_instance_.dropping = 0;
-        log_instance_.msg_pend_count = 0;
-        log_instance_.active_count = 1;
-        log_instance_.quit = 0;
+        log_instance_.dropped = 0;
+        log_instance_.notified = 0;
         if (NULL == log_instance_.dispatch_list.next) {
             jsdrv_list_initialize(&log_instance_.dispatch_list);
         }
-        LOCK_MSG();
-
-        if (NULL == log_instance_.msg_free.next) {
-            jsdrv_list_initialize(&log_instance_.msg_free);
-        } else {
-            list_free(&log_instance_.msg_free);
+        void * msg;
+        while (NULL != (msg = jsdrv_mpmc_ring_pop(log_instance_.msg_pend))) {
+            jsdrv_mpmc_ring_push(log_instance_.msg_free, msg);
         }
-
-        if (NULL == log_instance_.msg_pend.next) {
-            jsdrv_list_initialize(&log_instance_.msg_pend);
-        } else {
-            list_free(&log_instance_.msg_pend);
-        }
-
-        for (size_t i = 0; i < MSG_COUNT_INIT; ++i) {
-            struct msg_s *msg = jsdrv_alloc(sizeof(struct msg_s));
-            jsdrv_list_initialize(&msg->item);
-            jsdrv_list_add_tail(&log_instance_.msg_free, &msg->item);
-        }
-
+        log_instance_.quit = 0;
+        log_instance_.active_count = 1;
         thread_start();
-        UNLOCK_MSG();
     } else {
         ++log_instance_.active_count;
     }
@@ -490,25 +554,83 @@ void jsdrv_log_finalize() {
         thread_stop();
         LOCK_DISPATCH();
         list_free(&log_instance_.dispatch_list);
-        LOCK_MSG();
-        list_free(&log_instance_.msg_pend);
-        list_free(&log_instance_.msg_free);
-        UNLOCK_MSG();
+        jsdrv_log_binary_file_close(log_instance_.binary);
+        log_instance_.binary = NULL;
         UNLOCK_DISPATCH();
-        // do not free the mutexes, for thread safety on exit
-        // jsdrv_os_mutex_free(log_instance_.msg_mutex);
+        // do not free the mutex, rings or messages, for thread safety on exit
         // jsdrv_os_mutex_free(log_instance_.dispatch_mutex);
     }
 }
 
+static void thresholds_update() {
+    int8_t level = log_instance_.level;
+    for (uint32_t idx = 0; idx < JSDRV_LOG_MODULE_COUNT; ++idx) {
+        jsdrv_log_module_threshold[idx] = (module_levels_[idx] < level) ? module_levels_[idx] : level;
+    }
+}
+
+int32_t jsdrv_log_binary_open(const char * path, uint64_t size) {
+    struct jsdrv_log_binary_s * binary = NULL;
+    if (0 == log_instance_.active_count) {
+        return JSDRV_ERROR_UNAVAILABLE;
+    }
+    int32_t rc = jsdrv_log_binary_file_open(path, size, &binary);
+    if (rc) {
+        return rc;
+    }
+    LOCK_DISPATCH();
+    jsdrv_log_binary_file_close(log_instance_.binary);
+    log_instance_.binary = binary;
+    UNLOCK_DISPATCH();
+    return 0;
+}
+
+void jsdrv_log_binary_close() {
+    if (0 == log_instance_.initialized) {
+        return;
+    }
+    LOCK_DISPATCH();
+    jsdrv_log_binary_file_close(log_instance_.binary);
+    log_instance_.binary = NULL;
+    UNLOCK_DISPATCH();
+}
+
 void jsdrv_log_level_set(int8_t level) {
     log_instance_.level = level;
+    thresholds_update();
 }
 
 int8_t jsdrv_log_level_get() {
     return log_instance_.level;
 }
 
+static int32_t module_lookup(const char * module) {
+    if (NULL == module) {
+        return -1;
+    }
+    for (int32_t idx = 0; idx < JSDRV_LOG_MODULE_COUNT; ++idx) {
+        if (0 == strcmp(module_names_[idx], module)) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+int32_t jsdrv_log_module_level_set(const char * module, int8_t level) {
+    int32_t idx = module_lookup(module);
+    if (idx < 0) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    module_levels_[idx] = level;
+    thresholds_update();
+    return 0;
+}
+
+int8_t jsdrv_log_module_level_get(const char * module) {
+    int32_t idx = module_lookup(module);
+    return (idx < 0) ? JSDRV_LOG_LEVEL_OFF : module_levels_[idx];
+}
+
 JSDRV_API const char * jsdrv_log_level_to_str(int8_t level) {
     if (level < 0) {
         return "OFF";
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/log_binary.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/log.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/file_map.h"
+#include "jsdrv_prv/platform.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+
+#define RECORD_HEADER_SIZE (sizeof(struct jsdrv_log_binary_record_s))
+#define FILE_SIZE_MIN      (4096U)
+#define ALIGN8(x)          (((x) + 7U) & ~((uint64_t) 7U))
+
+JSDRV_STATIC_ASSERT(64 == sizeof(struct jsdrv_log_binary_header_s), log_binary_header_size);
+JSDRV_STATIC_ASSERT(24 == sizeof(struct jsdrv_log_binary_record_s), log_binary_record_size);
+
+struct jsdrv_log_binary_s {
+    struct jsdrv_file_map_s * map;
+    struct jsdrv_log_binary_header_s * hdr;
+    uint8_t * data;
+};
+
+int32_t jsdrv_log_binary_file_open(const char * path, uint64_t size, struct jsdrv_log_binary_s ** self) {
+    void * ptr = NULL;
+    bool existed = false;
+    *self = NULL;
+    if ((NULL == path) || (size < FILE_SIZE_MIN)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    size &= ~((uint64_t) 7U);
+    struct jsdrv_log_binary_s * s = jsdrv_alloc_clr(sizeof(struct jsdrv_log_binary_s));
+    int32_t rc = jsdrv_file_map_open(path, size, &s->map, &ptr, &existed);
+    if (rc) {
+        jsdrv_free(s);
+        return rc;
+    }
+    s->hdr = (struct jsdrv_log_binary_header_s *) ptr;
+    s->data = ((uint8_t *) ptr) + sizeof(struct jsdrv_log_binary_header_s);
+    memset(s->hdr, 0, sizeof(*s->hdr));
+    memcpy(s->hdr->magic, JSDRV_LOG_BINARY_MAGIC, sizeof(s->hdr->magic));
+    s->hdr->version = JSDRV_LOG_BINARY_VERSION;
+    s->hdr->header_size = sizeof(struct jsdrv_log_binary_header_s);
+    s->hdr->data_size = size - sizeof(struct jsdrv_log_binary_header_s);
+    *self = s;
+    return 0;
+}
+
+void jsdrv_log_binary_file_close(struct jsdrv_log_binary_s * self) {
+    if (NULL != self) {
+        jsdrv_file_map_close(self->map);
+        jsdrv_free(self);
+    }
+}
+
+static inline struct jsdrv_log_binary_record_s * record_at(struct jsdrv_log_binary_s * self, uint64_t offset) {
+    return (struct jsdrv_log_binary_record_s *) (self->data + (offset % self->hdr->data_size));
+}
+
+// Discard the oldest records until sz bytes are free after head.
+static void reserve(struct jsdrv_log_binary_s * self, uint64_t sz) {
+    struct jsdrv_log_binary_header_s * hdr = self->hdr;
+    while ((hdr->head + sz - hdr->tail) > hdr->data_size) {
+        hdr->tail += record_at(self, hdr->tail)->size;
+    }
+}
+
+void jsdrv_log_binary_file_write(struct jsdrv_log_binary_s * self, struct jsdrv_log_header_s const * header,
+                                 const char * filename, const char * message) {
+    struct jsdrv_log_binary_header_s * hdr = self->hdr;
+    size_t filename_size = strlen(filename);
+    size_t message_size = strlen(message);
+    size_t str_max = (size_t) (hdr->data_size / 4) - RECORD_HEADER_SIZE;
+    if (filename_size > 0xffffU) {
+        filename_size = 0xffffU;
+    }
+    if (filename_size > str_max) {
+        filename_size = str_max;
+    }
+    if (message_size > (str_max - filename_size)) {
+        message_size = str_max - filename_size;
+    }
+    if (message_size > 0xffffU) {
+        message_size = 0xffffU;
+    }
+    uint32_t sz = (uint32_t) ALIGN8(RECORD_HEADER_SIZE + filename_size + message_size);
+
+    uint64_t remaining = hdr->data_size - (hdr->head % hdr->data_size);
+    if (remaining < sz) {
+        reserve(self, remaining);
+        struct jsdrv_log_binary_record_s * pad = record_at(self, hdr->head);
+        pad->size = (uint32_t) remaining;
+        pad->flags = JSDRV_LOG_BINARY_FLAG_PAD;
+        hdr->head += remaining;
+    }
+    reserve(self, sz);
+    struct jsdrv_log_binary_record_s * r = record_at(self, hdr->head);
+    r->size = sz;
+    r->level = header->level;
+    r->flags = 0;
+    r->filename_size = (uint16_t) filename_size;
+    r->line = header->line;
+    r->message_size = (uint16_t) message_size;
+    r->rsv = 0;
+    r->timestamp = header->timestamp;
+    uint8_t * p = (uint8_t *) (r + 1);
+    memcpy(p, filename, filename_size);
+    memcpy(p + filename_size, message, message_size);
+    hdr->head += sz;  // publish the record last
+}
@@ -15,11 +15,13 @@
  */
 
 #include "jsdrv/meta.h"
+#include "jsdrv_prv/meta.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
 #include "jsdrv_prv/json.h"
 #include "jsdrv_prv/log.h"
 #include "jsdrv_prv/platform.h"
+#include <string.h>
 
 
 struct dtype_map_s {
@@ -37,6 +39,11 @@ const struct dtype_map_s dtype_map[] = {
         {"i16", JSDRV_UNION_I16},
         {"i32", JSDRV_UNION_I32},
         {"i64", JSDRV_UNION_I64},
+        {"f32", JSDRV_UNION_F32},
+        {"f64", JSDRV_UNION_F64},
+        {"str", JSDRV_UNION_STR},
+        {"json", JSDRV_UNION_JSON},
+        {"bin", JSDRV_UNION_BIN},
         {"bool", JSDRV_UNION_U8},
         {NULL, 0},
 };
@@ -199,27 +206,27 @@ struct value_s {
     union jsdrv_union_inner_u range[3];
 };
 
-static void maybe_convert_str_to_type(struct value_s * s) {
+static void maybe_convert_str_to_type(uint8_t type, struct jsdrv_union_s * value) {
     int32_t i32 = 0;
     uint32_t u32 = 0;
-    if (s->value->type != JSDRV_UNION_STR) {
+    if (value->type != JSDRV_UNION_STR) {
         return;
     }
-    switch (s->type) {
+    switch (type) {
         case JSDRV_UNION_U8:   // intentional fall-through
         case JSDRV_UNION_U16:  // intentional fall-through
         case JSDRV_UNION_U32:  // intentional fall-through
-            if (!jsdrv_cstr_to_u32(s->value->value.str, &u32)) {
-                s->value->type = s->type;
-                s->value->value.u32 = u32;
+            if (!jsdrv_cstr_to_u32(value->value.str, &u32)) {
+                value->type = type;
+                value->value.u32 = u32;
             }
             break;
         case JSDRV_UNION_I8:   // intentional fall-through
         case JSDRV_UNION_I16:  // intentional fall-through
         case JSDRV_UNION_I32:  // intentional fall-through
-            if (!jsdrv_cstr_to_i32(s->value->value.str, &i32)) {
-                s->value->type = s->type;
-                s->value->value.i32 = i32;
+            if (!jsdrv_cstr_to_i32(value->value.str, &i32)) {
+                value->type = type;
+                value->value.i32 = i32;
             }
             break;
         default:
@@ -244,7 +251,7 @@ static int32_t on_value(void * user_data, const struct jsdrv_union_s * token) {
                     }
                 } else {
                     rc = dtype_lookup(token, &s->type);
-                    maybe_convert_str_to_type(s);
+                    maybe_convert_str_to_type(s->type, s->value);
                     s->state = VALUE_ST_SEARCH;
                 }
             } else if (s->state == VALUE_ST_RANGE_VAL) {
@@ -317,3 +324,197 @@ int32_t jsdrv_meta_value(const char * meta, struct jsdrv_union_s * value) {
     };
     return jsdrv_json_parse(meta, on_value, &self);
 }
+
+struct meta_option_s {
+    union jsdrv_union_inner_u value;    // the option value as dtype
+    uint32_t token_start;               // index into tokens
+    uint32_t token_count;               // the value, names, and aliases
+};
+
+struct jsdrv_meta_validator_s {
+    int32_t status;                     // the compile error code, rejects all values
+    uint8_t dtype;                      // JSDRV_UNION_NULL when the metadata has no dtype
+    uint8_t is_bool;
+    uint8_t has_options;
+    uint32_t option_count;
+    struct meta_option_s * options;
+    struct jsdrv_union_s * tokens;      // strings point into this allocation
+};
+
+struct compile_s {
+    uint8_t state;  // value_state_e
+    uint8_t depth;
+    uint8_t array_idx;
+    uint8_t dtype;
+    uint8_t is_bool;
+    uint8_t has_options;
+    uint32_t option_count;
+    uint32_t token_count;
+    uint32_t str_size;
+    struct jsdrv_meta_validator_s * v;  // NULL while counting
+    char * str;
+};
+
+static int32_t option_token_add(struct compile_s * s, const struct jsdrv_union_s * token) {
+    struct jsdrv_meta_validator_s * v = s->v;
+    if (v) {
+        struct meta_option_s * option = &v->options[s->option_count - 1];
+        struct jsdrv_union_s * t = &v->tokens[s->token_count];
+        *t = *token;
+        if (token->type == JSDRV_UNION_STR) {
+            t->value.str = s->str + s->str_size;
+            jsdrv_memcpy(s->str + s->str_size, token->value.str, token->size - 1);
+            s->str[s->str_size + token->size - 1] = 0;
+        }
+        if (0 == s->array_idx) {
+            struct jsdrv_union_s x = *t;
+            if (jsdrv_union_as_type(&x, s->dtype)) {
+                return JSDRV_ERROR_PARAMETER_INVALID;
+            }
+            option->value.u64 = x.value.u64;
+            option->token_start = s->token_count;
+        }
+        ++option->token_count;
+    }
+    if (token->type == JSDRV_UNION_STR) {
+        s->str_size += token->size;
+    }
+    ++s->array_idx;
+    ++s->token_count;
+    return 0;
+}
+
+// Follows on_value() so that the compiled validator accepts the same values.
+static int32_t on_compile(void * user_data, const struct jsdrv_union_s * token) {
+    int32_t rc = 0;
+    struct compile_s * s = (struct compile_s *) user_data;
+    switch (token->op) {
+        case JSDRV_JSON_VALUE:
+            if (s->state == VALUE_ST_DTYPE_KEY) {
+                if (jsdrv_cstr_starts_with(token->value.str, "bool")) {
+                    s->is_bool = 1;
+                    rc = JSDRV_ERROR_ABORTED;
+                } else {
+                    rc = dtype_lookup(token, &s->dtype);
+                    s->state = VALUE_ST_SEARCH;
+                }
+            } else if (s->state == VALUE_ST_OPTIONS_VAL) {
+                rc = option_token_add(s, token);
+            }
+            break;
+        case JSDRV_JSON_KEY:
+            if ((s->state == VALUE_ST_DTYPE_SEARCH) && (s->depth == 1) && (0 == jsdrv_json_strcmp("dtype", token))) {
+                s->state = VALUE_ST_DTYPE_KEY;
+            } else if ((s->state == VALUE_ST_SEARCH) && (s->depth == 1) && (0 == jsdrv_json_strcmp("range", token))) {
+                s->state = VALUE_ST_RANGE_KEY;
+            } else if ((s->state == VALUE_ST_SEARCH) && (s->depth == 1) && (0 == jsdrv_json_strcmp("options", token))) {
+                s->state = VALUE_ST_OPTIONS;
+            }
+            break;
+        case JSDRV_JSON_OBJ_START: s->depth++; break;
+        case JSDRV_JSON_OBJ_END: s->depth--; break;
+        case JSDRV_JSON_ARRAY_START:
+            s->depth++;
+            if ((s->state == VALUE_ST_OPTIONS) && (s->depth == 3)) {
+                s->array_idx = 0;
+                s->state = VALUE_ST_OPTIONS_VAL;
+                ++s->option_count;
+            }
+            if (s->state == VALUE_ST_RANGE_KEY) {
+                s->state = VALUE_ST_RANGE_VAL;
+            }
+            break;
+        case JSDRV_JSON_ARRAY_END:
+            if ((s->state == VALUE_ST_OPTIONS_VAL) && (s->depth == 3)) {
+                s->state = VALUE_ST_OPTIONS;
+            } else if ((s->state == VALUE_ST_OPTIONS) && (s->depth == 2)) {
+                s->has_options = 1;
+                rc = JSDRV_ERROR_ABORTED;  // validation ends with the options
+            } else if ((s->state == VALUE_ST_RANGE_VAL) && (s->depth == 2)) {
+                s->state = VALUE_ST_SEARCH;
+            }
+            s->depth--;
+            break;
+        default: break;
+    }
+    return rc;
+}
+
+static void compile_init(struct compile_s * s, struct jsdrv_meta_validator_s * v) {
+    memset(s, 0, sizeof(*s));
+    s->state = VALUE_ST_DTYPE_SEARCH;
+    s->dtype = JSDRV_UNION_NULL;
+    s->v = v;
+}
+
+struct jsdrv_meta_validator_s * jsdrv_meta_validator_compile(const char * meta) {
+    struct compile_s s;
+    if (!meta) {
+        return NULL;
+    }
+    compile_init(&s, NULL);
+    int32_t rc = jsdrv_json_parse(meta, on_compile, &s);
+    if (rc) {
+        struct jsdrv_meta_validator_s * v = jsdrv_alloc_clr(sizeof(struct jsdrv_meta_validator_s));
+        v->status = rc;
+        return v;
+    }
+
+    size_t sz_tokens = s.token_count * sizeof(struct jsdrv_union_s);
+    size_t sz_options = s.option_count * sizeof(struct meta_option_s);
+    uint8_t * p = jsdrv_alloc_clr(sizeof(struct jsdrv_meta_validator_s) + sz_tokens + sz_options + s.str_size);
+    struct jsdrv_meta_validator_s * v = (struct jsdrv_meta_validator_s *) p;
+    p += sizeof(struct jsdrv_meta_validator_s);
+    v->tokens = (struct jsdrv_union_s *) p;
+    p += sz_tokens;
+    v->options = (struct meta_option_s *) p;
+    p += sz_options;
+
+    compile_init(&s, v);
+    s.str = (char *) p;
+    v->status = jsdrv_json_parse(meta, on_compile, &s);
+    v->dtype = s.dtype;
+    v->is_bool = s.is_bool;
+    v->has_options = s.has_options;
+    v->option_count = s.option_count;
+    return v;
+}
+
+void jsdrv_meta_validator_free(struct jsdrv_meta_validator_s * self) {
+    if (self) {
+        jsdrv_free(self);
+    }
+}
+
+int32_t jsdrv_meta_validator_value(const struct jsdrv_meta_validator_s * self, struct jsdrv_union_s * value) {
+    if (!self || !value) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    } else if (self->status) {
+        return self->status;
+    } else if (self->is_bool) {
+        bool val_bool = false;
+        int32_t rc = jsdrv_union_to_bool(value, &val_bool);
+        if (!rc) {
+            value->type = JSDRV_UNION_U8;
+            value->value.u8 = val_bool ? 1 : 0;
+        }
+        return rc;
+    } else if (JSDRV_UNION_NULL == self->dtype) {
+        return 0;
+    }
+    maybe_convert_str_to_type(self->dtype, value);
+    if (!self->has_options) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < self->option_count; ++i) {
+        const struct meta_option_s * option = &self->options[i];
+        for (uint32_t k = 0; k < option->token_count; ++k) {
+            if (jsdrv_union_equiv(value, &self->tokens[option->token_start + k])) {
+                value->value.u64 = option->value.u64;
+                value->type = self->dtype;
+                return 0;
+            }
+        }
+    }
+    return JSDRV_ERROR_PARAMETER_INVALID;
+}
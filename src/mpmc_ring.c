@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/mpmc_ring.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/log.h"
+
+
+#define CACHE_LINE_SIZE (64U)
+
+struct cell_s {
+    volatile uint32_t sequence;
+    void * ptr;
+};
+
+struct jsdrv_mpmc_ring_s {
+    volatile uint32_t head;   // next position to pop
+    uint8_t rsv1[CACHE_LINE_SIZE - sizeof(uint32_t)];
+    volatile uint32_t tail;   // next position to push
+    uint8_t rsv2[CACHE_LINE_SIZE - sizeof(uint32_t)];
+    uint32_t mask;
+    struct cell_s cells[];
+};
+
+struct jsdrv_mpmc_ring_s * jsdrv_mpmc_ring_alloc(uint32_t capacity) {
+    if ((capacity < 2) || (capacity & (capacity - 1))) {
+        JSDRV_LOGE("mpmc_ring capacity must be a power of 2: %u", (unsigned int) capacity);
+        return NULL;
+    }
+    struct jsdrv_mpmc_ring_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_mpmc_ring_s) + capacity * sizeof(struct cell_s));
+    self->mask = capacity - 1;
+    for (uint32_t i = 0; i < capacity; ++i) {
+        self->cells[i].sequence = i;
+    }
+    return self;
+}
+
+void jsdrv_mpmc_ring_free(struct jsdrv_mpmc_ring_s * self) {
+    if (self) {
+        jsdrv_free(self);
+    }
+}
+
+bool jsdrv_mpmc_ring_push(struct jsdrv_mpmc_ring_s * self, void * ptr) {
+    struct cell_s * cell;
+    uint32_t pos = jsdrv_atomic_load_u32(&self->tail);
+    while (1) {
+        cell = &self->cells[pos & self->mask];
+        uint32_t seq = jsdrv_atomic_load_u32(&cell->sequence);
+        int32_t dif = (int32_t) (seq - pos);
+        if (0 == dif) {
+            if (jsdrv_atomic_cas_u32(&self->tail, pos, pos + 1)) {
+                break;
+            }
+            pos = jsdrv_atomic_load_u32(&self->tail);
+        } else if (dif < 0) {
+            return false;  // full
+        } else {
+            pos = jsdrv_atomic_load_u32(&self->tail);  // another producer won, retry
+        }
+    }
+    cell->ptr = ptr;
+    jsdrv_atomic_store_u32(&cell->sequence, pos + 1);  // publish to consumers
+    return true;
+}
+
+void * jsdrv_mpmc_ring_pop(struct jsdrv_mpmc_ring_s * self) {
+    struct cell_s * cell;
+    uint32_t pos = jsdrv_atomic_load_u32(&self->head);
+    while (1) {
+        cell = &self->cells[pos & self->mask];
+        uint32_t seq = jsdrv_atomic_load_u32(&cell->sequence);
+        int32_t dif = (int32_t) (seq - (pos + 1));
+        if (0 == dif) {
+            if (jsdrv_atomic_cas_u32(&self->head, pos, pos + 1)) {
+                break;
+            }
+            pos = jsdrv_atomic_load_u32(&self->head);
+        } else if (dif < 0) {
+            return NULL;  // empty
+        } else {
+            pos = jsdrv_atomic_load_u32(&self->head);  // another consumer won, retry
+        }
+    }
+    void * ptr = cell->ptr;
+    cell->ptr = NULL;
+    jsdrv_atomic_store_u32(&cell->sequence, pos + self->mask + 1);  // release to producers
+    return ptr;
+}
+
+bool jsdrv_mpmc_ring_is_empty(struct jsdrv_mpmc_ring_s * self) {
+    uint32_t pos = jsdrv_atomic_load_u32(&self->head);
+    struct cell_s * cell = &self->cells[pos & self->mask];
+    uint32_t seq = jsdrv_atomic_load_u32(&cell->sequence);
+    return ((int32_t) (seq - (pos + 1))) < 0;
+}
+
+uint32_t jsdrv_mpmc_ring_count(struct jsdrv_mpmc_ring_s * self) {
+    uint32_t head = jsdrv_atomic_load_u32(&self->head);
+    uint32_t tail = jsdrv_atomic_load_u32(&self->tail);
+    int32_t count = (int32_t) (tail - head);
+    if (count < 0) {
+        return 0;  // head read before a racing pop and push
+    }
+    return ((uint32_t) count > (self->mask + 1)) ? (self->mask + 1) : (uint32_t) count;
+}
@@ -0,0 +1,486 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+
+#if _WIN32
+#include <winsock2.h>   // must precede windows.h
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "jsdrv/net.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/stream_codec.h"
+#include "jsdrv_prv/f32_codec.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include <string.h>
+
+
+#if _WIN32
+typedef SOCKET sock_t;
+#define SOCK_INVALID INVALID_SOCKET
+#define sock_close closesocket
+#define sock_poll WSAPoll
+#define sock_would_block() (WSAGetLastError() == WSAEWOULDBLOCK)
+typedef int sock_len_t;
+#else
+typedef int sock_t;
+#define SOCK_INVALID (-1)
+#define sock_close close
+#define sock_poll poll
+#define sock_would_block() ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+typedef socklen_t sock_len_t;
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0      // SO_NOSIGPIPE on macOS
+#endif
+
+#define BUFFER_SIZE_DEFAULT (4U * 1024U * 1024U)
+#define POLL_TIMEOUT_MS     (100)
+#define ALIGN8(x)           (((x) + 7U) & ~7U)
+#define CODEC_SIZE          (JSDRV_STREAM_HEADER_SIZE + JSDRV_F32_CODEC_SIZE_MAX(JSDRV_STREAM_DATA_SIZE / 4U))
+
+struct client_s {
+    struct jsdrv_net_server_s * server;
+    sock_t sock;
+    uint8_t active;                             // accept frames, protected by server mutex
+    char rx[JSDRV_TOPIC_LENGTH_MAX + 2];        // partial request line
+    uint32_t rx_length;
+    uint8_t * tx;                               // frames awaiting send
+    uint32_t tx_head;
+    uint32_t tx_tail;
+    uint32_t drops;
+    volatile uint8_t codec;                     // jsdrv_stream_codec_e for stream data
+    uint8_t * z;                                // encoded stream data, frontend thread
+};
+
+struct jsdrv_net_server_s {
+    struct jsdrv_context_s * context;
+    sock_t listen;
+    sock_t wake;                                // self-connected UDP socket
+    uint16_t port;
+    uint32_t buffer_size;
+    volatile uint32_t quit;
+    jsdrv_os_mutex_t mutex;                     // client tx buffers and active
+    jsdrv_thread_t thread;
+    struct client_s clients[JSDRV_NET_CLIENTS_MAX];
+};
+
+static int sock_nonblocking(sock_t s) {
+#if _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode);
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return fcntl(s, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+static void wake(struct jsdrv_net_server_s * self) {
+    char c = 'w';
+    send(self->wake, &c, 1, 0);  // nonblocking, a full socket already wakes
+}
+
+static void on_pub(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    struct client_s * c = (struct client_s *) user_data;
+    struct jsdrv_net_server_s * self = c->server;
+    struct jsdrv_net_frame_header_s hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    const void * payload = NULL;
+    uint32_t topic_length = (uint32_t) strlen(topic) + 1;
+    switch (value->type) {
+        case JSDRV_UNION_STR:   // intentional fall-through
+        case JSDRV_UNION_JSON:
+            payload = value->value.str;
+            hdr.size = value->size ? value->size : (uint32_t) (strlen(value->value.str) + 1);
+            break;
+        case JSDRV_UNION_BIN:
+            payload = value->value.bin;
+            hdr.size = value->size;
+            if (c->codec && (value->app == JSDRV_PAYLOAD_TYPE_STREAM) && (value->size >= JSDRV_STREAM_HEADER_SIZE)) {
+                uint8_t codec = c->codec;
+                uint32_t sz = jsdrv_stream_codec_encode(codec, c->z, CODEC_SIZE,
+                                                        (const struct jsdrv_stream_signal_s *) value->value.bin);
+                if (sz) {
+                    payload = c->z;
+                    hdr.size = sz;
+                    hdr.codec = codec;
+                }
+            }
+            break;
+        default:
+            hdr.value = value->value.u64;
+            break;
+    }
+    hdr.length = (uint32_t) (sizeof(hdr) + ALIGN8(topic_length) + ALIGN8(hdr.size));
+    hdr.type = value->type;
+    hdr.flags = value->flags & ~(JSDRV_UNION_FLAG_HEAP_MEMORY | JSDRV_UNION_FLAG_SHARED_MEMORY
+            | JSDRV_UNION_FLAG_STATIC | JSDRV_UNION_FLAG_CONST);
+    hdr.op = value->op;
+    hdr.app = value->app;
+    hdr.topic_length = (uint8_t) topic_length;
+
+    bool do_wake = false;
+    jsdrv_os_mutex_lock(self->mutex);
+    if (!c->active) {
+        jsdrv_os_mutex_unlock(self->mutex);
+        return;
+    }
+    if ((self->buffer_size - c->tx_tail) < hdr.length) {  // compact
+        memmove(c->tx, c->tx + c->tx_head, c->tx_tail - c->tx_head);
+        c->tx_tail -= c->tx_head;
+        c->tx_head = 0;
+    }
+    if ((self->buffer_size - c->tx_tail) < hdr.length) {
+        ++c->drops;
+        if (1 == c->drops) {
+            JSDRV_LOGW("net client %d: send buffer full, dropping frames", (int) (c - self->clients));
+        }
+    } else {
+        do_wake = (c->tx_head == c->tx_tail);
+        uint8_t * p = c->tx + c->tx_tail;
+        memcpy(p, &hdr, sizeof(hdr));
+        p += sizeof(hdr);
+        memset(p, 0, ALIGN8(topic_length));
+        memcpy(p, topic, topic_length);
+        p += ALIGN8(topic_length);
+        if (hdr.size) {
+            memcpy(p, payload, hdr.size);
+            memset(p + hdr.size, 0, ALIGN8(hdr.size) - hdr.size);
+        }
+        c->tx_tail += hdr.length;
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    if (do_wake) {
+        wake(self);
+    }
+}
+
+static void client_close(struct jsdrv_net_server_s * self, struct client_s * c) {
+    jsdrv_os_mutex_lock(self->mutex);
+    c->active = 0;
+    c->tx_head = 0;
+    c->tx_tail = 0;
+    jsdrv_os_mutex_unlock(self->mutex);
+    jsdrv_unsubscribe_all(self->context, on_pub, c, JSDRV_TIMEOUT_MS_DEFAULT);
+    sock_close(c->sock);
+    c->sock = SOCK_INVALID;
+    JSDRV_LOGI("net client %d: closed, %u drops", (int) (c - self->clients), (unsigned int) c->drops);
+}
+
+static void client_accept(struct jsdrv_net_server_s * self) {
+    sock_t s = accept(self->listen, NULL, NULL);
+    if (s == SOCK_INVALID) {
+        return;
+    }
+    struct client_s * c = NULL;
+    for (uint32_t i = 0; i < JSDRV_NET_CLIENTS_MAX; ++i) {
+        if (self->clients[i].sock == SOCK_INVALID) {
+            c = &self->clients[i];
+            break;
+        }
+    }
+    if (!c) {
+        JSDRV_LOGW("net: too many clients, reject");
+        sock_close(s);
+        return;
+    }
+    int one = 1;
+    sock_nonblocking(s);
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *) &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+    setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    if (!c->tx) {
+        c->tx = jsdrv_alloc(self->buffer_size);
+        c->z = jsdrv_alloc(CODEC_SIZE);
+    }
+    c->sock = s;
+    c->rx_length = 0;
+    c->drops = 0;
+    c->codec = JSDRV_STREAM_CODEC_NONE;
+    jsdrv_os_mutex_lock(self->mutex);
+    c->active = 1;
+    jsdrv_os_mutex_unlock(self->mutex);
+    JSDRV_LOGI("net client %d: open", (int) (c - self->clients));
+}
+
+static void client_request(struct jsdrv_net_server_s * self, struct client_s * c, char * line) {
+    int32_t rc;
+    size_t sz = strlen(line);
+    if (sz && (line[sz - 1] == '\r')) {
+        line[sz - 1] = 0;
+    }
+    if (line[0] == '+') {
+        rc = jsdrv_subscribe(self->context, line + 1, JSDRV_SFLAG_PUB | JSDRV_SFLAG_RETAIN,
+                             on_pub, c, JSDRV_TIMEOUT_MS_DEFAULT);
+    } else if (line[0] == '-') {
+        rc = jsdrv_unsubscribe(self->context, line + 1, on_pub, c, JSDRV_TIMEOUT_MS_DEFAULT);
+    } else if (line[0] == '*') {
+        uint32_t codec = 0;
+        rc = jsdrv_cstr_to_u32(line + 1, &codec);
+        if (!rc && (codec > JSDRV_STREAM_CODEC_F32)) {
+            rc = JSDRV_ERROR_NOT_SUPPORTED;
+        } else if (!rc) {
+            c->codec = (uint8_t) codec;
+        }
+    } else {
+        rc = JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (rc) {
+        JSDRV_LOGW("net client %d: request %s failed %d", (int) (c - self->clients), line, (int) rc);
+    }
+}
+
+static bool client_recv(struct jsdrv_net_server_s * self, struct client_s * c) {
+    char buf[256];
+    int n = (int) recv(c->sock, buf, sizeof(buf), 0);
+    if (n == 0) {
+        return false;  // closed by client
+    } else if (n < 0) {
+        return sock_would_block();
+    }
+    for (int i = 0; i < n; ++i) {
+        if (buf[i] == '\n') {
+            c->rx[c->rx_length] = 0;
+            if (c->rx_length) {
+                client_request(self, c, c->rx);
+            }
+            c->rx_length = 0;
+        } else if (c->rx_length < (sizeof(c->rx) - 1)) {
+            c->rx[c->rx_length++] = buf[i];
+        }
+    }
+    return true;
+}
+
+static bool client_send(struct jsdrv_net_server_s * self, struct client_s * c) {
+    bool rv = true;
+    jsdrv_os_mutex_lock(self->mutex);
+    uint32_t sz = c->tx_tail - c->tx_head;
+    if (sz) {
+        int n = (int) send(c->sock, (const char *) (c->tx + c->tx_head), (int) sz, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->tx_head += (uint32_t) n;
+            if (c->tx_head == c->tx_tail) {
+                c->tx_head = 0;
+                c->tx_tail = 0;
+            }
+        } else if (!sock_would_block()) {
+            rv = false;
+        }
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    return rv;
+}
+
+static THREAD_RETURN_TYPE server_thread(THREAD_ARG_TYPE arg) {
+    struct jsdrv_net_server_s * self = (struct jsdrv_net_server_s *) arg;
+    struct pollfd fds[2 + JSDRV_NET_CLIENTS_MAX];
+    struct client_s * fd_clients[2 + JSDRV_NET_CLIENTS_MAX];
+    char buf[64];
+    jsdrv_thread_name_set("jsdrv_net");
+    JSDRV_LOGI("net server thread start, port %u", (unsigned int) self->port);
+
+    while (!self->quit) {
+        uint32_t count = 0;
+        fds[count].fd = self->listen;
+        fds[count++].events = POLLIN;
+        fds[count].fd = self->wake;
+        fds[count++].events = POLLIN;
+        jsdrv_os_mutex_lock(self->mutex);
+        for (uint32_t i = 0; i < JSDRV_NET_CLIENTS_MAX; ++i) {
+            struct client_s * c = &self->clients[i];
+            if (c->sock != SOCK_INVALID) {
+                fds[count].fd = c->sock;
+                fds[count].events = POLLIN | ((c->tx_head != c->tx_tail) ? POLLOUT : 0);
+                fd_clients[count++] = c;
+            }
+        }
+        jsdrv_os_mutex_unlock(self->mutex);
+
+        if (sock_poll(fds, count, POLL_TIMEOUT_MS) <= 0) {
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            while (recv(self->wake, buf, sizeof(buf), 0) > 0) {
+                ;  // drain
+            }
+        }
+        for (uint32_t i = 2; i < count; ++i) {
+            struct client_s * c = fd_clients[i];
+            short revents = fds[i].revents;
+            bool ok = true;
+            if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                ok = false;
+            }
+            if (ok && (revents & POLLIN)) {
+                ok = client_recv(self, c);
+            }
+            if (ok && (revents & POLLOUT)) {
+                ok = client_send(self, c);
+            }
+            if (!ok) {
+                client_close(self, c);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            client_accept(self);
+        }
+    }
+    JSDRV_LOGI("net server thread done");
+    THREAD_RETURN();
+}
+
+static int32_t wake_open(struct jsdrv_net_server_s * self) {
+    struct sockaddr_in addr;
+    sock_len_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    self->wake = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((self->wake == SOCK_INVALID)
+            || bind(self->wake, (struct sockaddr *) &addr, sizeof(addr))
+            || getsockname(self->wake, (struct sockaddr *) &addr, &addr_len)
+            || connect(self->wake, (struct sockaddr *) &addr, sizeof(addr))
+            || sock_nonblocking(self->wake)) {
+        return JSDRV_ERROR_IO;
+    }
+    return 0;
+}
+
+static int32_t listen_open(struct jsdrv_net_server_s * self, const char * address, uint16_t port) {
+    struct sockaddr_in addr;
+    sock_len_t addr_len = sizeof(addr);
+    int one = 1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (!address) {
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    } else if (1 != inet_pton(AF_INET, address, &addr.sin_addr)) {
+        JSDRV_LOGE("net: invalid address %s", address);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    self->listen = socket(AF_INET, SOCK_STREAM, 0);
+    if (self->listen == SOCK_INVALID) {
+        return JSDRV_ERROR_IO;
+    }
+    setsockopt(self->listen, SOL_SOCKET, SO_REUSEADDR, (const char *) &one, sizeof(one));
+    if (bind(self->listen, (struct sockaddr *) &addr, sizeof(addr))) {
+        JSDRV_LOGE("net: bind port %u failed", (unsigned int) port);
+        return JSDRV_ERROR_IN_USE;
+    }
+    if (listen(self->listen, JSDRV_NET_CLIENTS_MAX)
+            || getsockname(self->listen, (struct sockaddr *) &addr, &addr_len)
+            || sock_nonblocking(self->listen)) {
+        return JSDRV_ERROR_IO;
+    }
+    self->port = ntohs(addr.sin_port);
+    return 0;
+}
+
+static void server_free(struct jsdrv_net_server_s * self) {
+    for (uint32_t i = 0; i < JSDRV_NET_CLIENTS_MAX; ++i) {
+        struct client_s * c = &self->clients[i];
+        if (c->sock != SOCK_INVALID) {
+            client_close(self, c);
+        }
+        if (c->tx) {
+            jsdrv_free(c->tx);
+            jsdrv_free(c->z);
+        }
+    }
+    if (self->listen != SOCK_INVALID) {
+        sock_close(self->listen);
+    }
+    if (self->wake != SOCK_INVALID) {
+        sock_close(self->wake);
+    }
+    if (self->mutex) {
+        jsdrv_os_mutex_free(self->mutex);
+    }
+    jsdrv_free(self);
+#if _WIN32
+    WSACleanup();
+#endif
+}
+
+int32_t jsdrv_net_server_open(struct jsdrv_context_s * context, const char * address, uint16_t port,
+                              uint32_t buffer_size, struct jsdrv_net_server_s ** server) {
+    if (!context || !server) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    *server = NULL;
+#if _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data)) {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+#endif
+    struct jsdrv_net_server_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_net_server_s));
+    self->context = context;
+    self->listen = SOCK_INVALID;
+    self->wake = SOCK_INVALID;
+    self->buffer_size = buffer_size ? buffer_size : BUFFER_SIZE_DEFAULT;
+    for (uint32_t i = 0; i < JSDRV_NET_CLIENTS_MAX; ++i) {
+        self->clients[i].server = self;
+        self->clients[i].sock = SOCK_INVALID;
+    }
+    self->mutex = jsdrv_os_mutex_alloc("net_server");
+    int32_t rc = wake_open(self);
+    if (!rc) {
+        rc = listen_open(self, address, port);
+    }
+    if (!rc && jsdrv_thread_create(&self->thread, server_thread, self, 0)) {
+        rc = JSDRV_ERROR_UNSPECIFIED;
+    }
+    if (rc) {
+        server_free(self);
+        return rc;
+    }
+    *server = self;
+    return 0;
+}
+
+uint16_t jsdrv_net_server_port(struct jsdrv_net_server_s * self) {
+    return self ? self->port : 0;
+}
+
+void jsdrv_net_server_close(struct jsdrv_net_server_s * self) {
+    if (!self) {
+        return;
+    }
+    self->quit = 1;
+    wake(self);
+    jsdrv_thread_join(&self->thread, 1000);
+    server_free(self);
+}
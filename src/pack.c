@@ -0,0 +1,148 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/pack.h"
+#include "jsdrv_prv/f32_ops.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PACK_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define PACK_TARGET(isa_)
+#else
+#define PACK_TARGET(isa_) __attribute__((target(isa_)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PACK_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+static void pack_u4_scalar(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    uint32_t k = 0;
+    for (; (k + 2) <= n; k += 2) {
+        *dst++ = (uint8_t) ((src[k] & 0x0f) | ((src[k + 1] & 0x0f) << 4));
+    }
+    if (k < n) {
+        *dst = src[k] & 0x0f;
+    }
+}
+
+static void pack_u1_scalar(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    uint32_t k = 0;
+    while (k < n) {
+        uint8_t v = 0;
+        for (uint32_t j = 0; (j < 8) && (k < n); ++j, ++k) {
+            v |= (uint8_t) ((src[k] & 1) << j);
+        }
+        *dst++ = v;
+    }
+}
+
+#if PACK_X86
+
+PACK_TARGET("sse2")
+static void pack_u4_sse2(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i low = _mm_set1_epi16(0x00ff);
+    uint32_t k = 0;
+    for (; (k + 32) <= n; k += 32) {
+        // each u16 holds two values: (lo | (hi << 8)) -> lo | (hi << 4)
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *) (src + k)), nibble);
+        __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *) (src + k + 16)), nibble);
+        a = _mm_and_si128(_mm_or_si128(a, _mm_srli_epi16(a, 4)), low);
+        b = _mm_and_si128(_mm_or_si128(b, _mm_srli_epi16(b, 4)), low);
+        _mm_storeu_si128((__m128i *) dst, _mm_packus_epi16(a, b));
+        dst += 16;
+    }
+    pack_u4_scalar(dst, src + k, n - k);
+}
+
+PACK_TARGET("sse2")
+static void pack_u1_sse2(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    const __m128i one = _mm_set1_epi8(1);
+    uint32_t k = 0;
+    for (; (k + 16) <= n; k += 16) {
+        // move each bit 0 to bit 7, then gather the byte sign bits
+        __m128i x = _mm_and_si128(_mm_loadu_si128((const __m128i *) (src + k)), one);
+        int mask = _mm_movemask_epi8(_mm_slli_epi16(x, 7));
+        dst[0] = (uint8_t) mask;
+        dst[1] = (uint8_t) (mask >> 8);
+        dst += 2;
+    }
+    pack_u1_scalar(dst, src + k, n - k);
+}
+
+#elif PACK_NEON
+
+static void pack_u4_neon(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    const uint8x16_t nibble = vdupq_n_u8(0x0f);
+    uint32_t k = 0;
+    for (; (k + 16) <= n; k += 16) {
+        uint16x8_t x = vreinterpretq_u16_u8(vandq_u8(vld1q_u8(src + k), nibble));
+        vst1_u8(dst, vmovn_u16(vorrq_u16(x, vshrq_n_u16(x, 4))));
+        dst += 8;
+    }
+    pack_u4_scalar(dst, src + k, n - k);
+}
+
+static void pack_u1_neon(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(weights);
+    const uint8x16_t one = vdupq_n_u8(1);
+    uint32_t k = 0;
+    for (; (k + 16) <= n; k += 16) {
+        uint8x16_t x = vmulq_u8(vandq_u8(vld1q_u8(src + k), one), w);
+        dst[0] = vaddv_u8(vget_low_u8(x));
+        dst[1] = vaddv_u8(vget_high_u8(x));
+        dst += 2;
+    }
+    pack_u1_scalar(dst, src + k, n - k);
+}
+
+#endif
+
+void jsdrv_pack_u4(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    switch (jsdrv_f32_ops_isa()) {
+#if PACK_X86
+        case JSDRV_F32_OPS_ISA_SSE2:  /* intentional fall-through */
+        case JSDRV_F32_OPS_ISA_AVX2: pack_u4_sse2(dst, src, n); break;
+#elif PACK_NEON
+        case JSDRV_F32_OPS_ISA_NEON: pack_u4_neon(dst, src, n); break;
+#endif
+        default: pack_u4_scalar(dst, src, n); break;
+    }
+}
+
+void jsdrv_pack_u1(uint8_t * dst, const uint8_t * src, uint32_t n) {
+    switch (jsdrv_f32_ops_isa()) {
+#if PACK_X86
+        case JSDRV_F32_OPS_ISA_SSE2:  /* intentional fall-through */
+        case JSDRV_F32_OPS_ISA_AVX2: pack_u1_sse2(dst, src, n); break;
+#elif PACK_NEON
+        case JSDRV_F32_OPS_ISA_NEON: pack_u1_neon(dst, src, n); break;
+#endif
+        default: pack_u1_scalar(dst, src, n); break;
+    }
+}
+
+uint32_t jsdrv_pack_select_u8(uint8_t * dst, const uint8_t * src, uint32_t n, uint32_t stride) {
+    uint32_t count = 0;
+    for (uint32_t k = 0; k < n; k += stride) {
+        dst[count++] = src[k];
+    }
+    return count;
+}
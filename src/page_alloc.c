@@ -0,0 +1,175 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/page_alloc.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/platform.h"
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+
+#define HEADER_SIZE (64U)
+#define HUGE_PAGE_SIZE (2U * 1024U * 1024U)
+#define NUMA_NODES_MAX (1024U)
+
+enum kind_e {
+    KIND_HEAP = 0,
+    KIND_MAP = 1,
+};
+
+// Stored in the HEADER_SIZE bytes before each allocation.
+struct header_s {
+    void * base;
+    uint64_t size;  // mapped bytes, including the header
+    uint8_t kind;
+};
+
+static inline uint64_t round_up(uint64_t x, uint64_t page) {
+    return ((x + page - 1) / page) * page;
+}
+
+#if _WIN32
+
+static void * map(uint64_t size, DWORD flags, int32_t numa_node) {
+    flags |= MEM_RESERVE | MEM_COMMIT;
+    if (numa_node >= 0) {
+        return VirtualAllocExNuma(GetCurrentProcess(), NULL, (SIZE_T) size, flags, PAGE_READWRITE, (DWORD) numa_node);
+    }
+    return VirtualAlloc(NULL, (SIZE_T) size, flags, PAGE_READWRITE);
+}
+
+static void * map_alloc(uint64_t * size, uint8_t mode, int32_t numa_node) {
+    void * ptr = NULL;
+    SIZE_T large = GetLargePageMinimum();
+    if ((JSDRV_PAGE_MODE_LARGE == mode) && large) {
+        uint64_t sz = round_up(*size, large);
+        ptr = map(sz, MEM_LARGE_PAGES, numa_node);  // requires SeLockMemoryPrivilege
+        if (ptr) {
+            *size = sz;
+            return ptr;
+        }
+        JSDRV_LOGW("page_alloc: large pages failed %lu, use small pages", (unsigned long) GetLastError());
+    }
+    return map(*size, 0, numa_node);
+}
+
+static void map_free(void * base, uint64_t size) {
+    (void) size;
+    VirtualFree(base, 0, MEM_RELEASE);
+}
+
+#else
+
+static void numa_bind(void * ptr, uint64_t size, int32_t numa_node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    const int mpol_preferred = 1;
+    unsigned long mask[NUMA_NODES_MAX / (8 * sizeof(unsigned long))] = {0};
+    if ((numa_node < 0) || ((uint32_t) numa_node >= NUMA_NODES_MAX)) {
+        return;
+    }
+    mask[numa_node / (8 * sizeof(unsigned long))] = 1UL << (numa_node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_mbind, ptr, (unsigned long) size, mpol_preferred, mask, (unsigned long) NUMA_NODES_MAX + 1, 0)) {
+        JSDRV_LOGW("page_alloc: NUMA node %d binding failed", (int) numa_node);
+    }
+#else
+    (void) ptr;
+    (void) size;
+    (void) numa_node;
+#endif
+}
+
+static void * map(uint64_t size, int flags) {
+    void * ptr = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+static void * map_alloc(uint64_t * size, uint8_t mode, int32_t numa_node) {
+    void * ptr = NULL;
+#if defined(MAP_HUGETLB)
+    if (JSDRV_PAGE_MODE_LARGE == mode) {
+        uint64_t sz = round_up(*size, HUGE_PAGE_SIZE);
+        ptr = map(sz, MAP_HUGETLB);  // requires reserved vm.nr_hugepages
+        if (ptr) {
+            *size = sz;
+            numa_bind(ptr, sz, numa_node);
+            return ptr;
+        }
+        JSDRV_LOGW("page_alloc: MAP_HUGETLB failed, use transparent huge pages");
+    }
+#endif
+    ptr = map(*size, 0);
+    if (ptr) {
+#if defined(MADV_HUGEPAGE)
+        if (JSDRV_PAGE_MODE_DEFAULT != mode) {
+            madvise(ptr, (size_t) *size, MADV_HUGEPAGE);
+        }
+#endif
+        numa_bind(ptr, *size, numa_node);  // before the first touch
+    }
+    return ptr;
+}
+
+static void map_free(void * base, uint64_t size) {
+    munmap(base, (size_t) size);
+}
+
+#endif
+
+void * jsdrv_page_alloc(uint64_t size_bytes, uint8_t mode, int32_t numa_node) {
+    uint64_t size = size_bytes + HEADER_SIZE;
+    uint8_t * base = NULL;
+    uint8_t kind = KIND_HEAP;
+    if ((size > SIZE_MAX) || (size < size_bytes)) {
+        JSDRV_FATAL("out of memory");
+    }
+    if ((JSDRV_PAGE_MODE_DEFAULT != mode) || (numa_node >= 0)) {
+        base = map_alloc(&size, mode, numa_node);
+        if (base) {
+            kind = KIND_MAP;
+        } else {
+            JSDRV_LOGW("page_alloc: map failed, use heap");
+            size = size_bytes + HEADER_SIZE;
+        }
+    }
+    if (NULL == base) {
+        base = jsdrv_alloc_aligned((size_t) size, JSDRV_ALLOC_ALIGNMENT);
+    }
+    struct header_s * hdr = (struct header_s *) base;
+    hdr->base = base;
+    hdr->size = size;
+    hdr->kind = kind;
+    return base + HEADER_SIZE;
+}
+
+void jsdrv_page_free(void * ptr) {
+    if (NULL == ptr) {
+        return;
+    }
+    struct header_s * hdr = (struct header_s *) (((uint8_t *) ptr) - HEADER_SIZE);
+    if (KIND_MAP == hdr->kind) {
+        map_free(hdr->base, hdr->size);
+    } else {
+        jsdrv_free(hdr->base);
+    }
+}
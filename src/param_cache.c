@@ -0,0 +1,227 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "jsdrv_prv/param_cache.h"
+#include "jsdrv.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/list.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv/cstr.h"
+#include <string.h>
+
+
+#define BUCKET_COUNT (128U)   // power of 2
+#define FNV64_OFFSET (0xcbf29ce484222325ULL)
+#define FNV64_PRIME  (0x00000100000001b3ULL)
+
+struct entry_s {
+    struct jsdrv_list_s item;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    struct jsdrv_union_s value;     // ptr types reference data
+    uint8_t * data;                 // NULL or owned copy for ptr types
+    uint64_t hash;                  // of topic and value
+};
+
+struct jsdrv_param_cache_device_s {
+    struct jsdrv_list_s item;       // in jsdrv_param_cache_s.devices
+    char prefix[JSDRV_TOPIC_LENGTH_MAX];
+    uint64_t version;
+    bool valid;
+    uint32_t size;
+    uint64_t hash;                  // sum of entry hashes
+    struct jsdrv_list_s buckets[BUCKET_COUNT];
+};
+
+struct jsdrv_param_cache_s {
+    jsdrv_os_mutex_t mutex;
+    struct jsdrv_list_s devices;
+};
+
+static uint64_t fnv64(uint64_t h, const void * data, size_t size) {
+    const uint8_t * p = (const uint8_t *) data;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= FNV64_PRIME;
+    }
+    return h;
+}
+
+static uint32_t value_size(const struct jsdrv_union_s * value) {
+    if ((value->type == JSDRV_UNION_STR) || (value->type == JSDRV_UNION_JSON)) {
+        return value->value.str ? (uint32_t) (strlen(value->value.str) + 1) : 0;
+    }
+    return value->size;
+}
+
+static uint32_t scalar_size(uint8_t type) {
+    switch (type) {
+        case JSDRV_UNION_U8:  /* intentional fall-through */
+        case JSDRV_UNION_I8: return 1;
+        case JSDRV_UNION_U16: /* intentional fall-through */
+        case JSDRV_UNION_I16: return 2;
+        case JSDRV_UNION_U32: /* intentional fall-through */
+        case JSDRV_UNION_I32: /* intentional fall-through */
+        case JSDRV_UNION_F32: return 4;
+        case JSDRV_UNION_NULL: return 0;
+        default: return 8;
+    }
+}
+
+static uint64_t entry_hash(const char * topic, const struct jsdrv_union_s * value) {
+    uint64_t h = fnv64(FNV64_OFFSET, topic, strlen(topic) + 1);
+    h = fnv64(h, &value->type, sizeof(value->type));
+    if (jsdrv_union_is_type_ptr(value)) {
+        h = fnv64(h, value->value.bin, value_size(value));
+    } else {
+        h = fnv64(h, &value->value.u64, scalar_size(value->type));  // little-endian
+    }
+    return h;
+}
+
+static void entry_value_set(struct entry_s * e, const struct jsdrv_union_s * value) {
+    if (e->data) {
+        jsdrv_free(e->data);
+        e->data = NULL;
+    }
+    e->value = *value;
+    e->value.flags &= ~(JSDRV_UNION_FLAG_SHARED_MEMORY | JSDRV_UNION_FLAG_HEAP_MEMORY);
+    if (jsdrv_union_is_type_ptr(value)) {
+        uint32_t sz = value_size(value);
+        if (sz) {
+            e->data = jsdrv_alloc(sz);
+            memcpy(e->data, value->value.bin, sz);
+        }
+        e->value.value.bin = e->data;
+        e->value.size = sz;
+    }
+}
+
+static void device_clear(struct jsdrv_param_cache_device_s * self) {
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+        while (!jsdrv_list_is_empty(&self->buckets[i])) {
+            struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->buckets[i]);
+            struct entry_s * e = JSDRV_CONTAINER_OF(item, struct entry_s, item);
+            if (e->data) {
+                jsdrv_free(e->data);
+            }
+            jsdrv_free(e);
+        }
+    }
+    self->size = 0;
+    self->hash = 0;
+    self->valid = false;
+}
+
+struct jsdrv_param_cache_s * jsdrv_param_cache_new(void) {
+    struct jsdrv_param_cache_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_param_cache_s));
+    self->mutex = jsdrv_os_mutex_alloc("param_cache");
+    jsdrv_list_initialize(&self->devices);
+    return self;
+}
+
+void jsdrv_param_cache_free(struct jsdrv_param_cache_s * self) {
+    if (!self) {
+        return;
+    }
+    while (!jsdrv_list_is_empty(&self->devices)) {
+        struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->devices);
+        struct jsdrv_param_cache_device_s * d = JSDRV_CONTAINER_OF(item, struct jsdrv_param_cache_device_s, item);
+        device_clear(d);
+        jsdrv_free(d);
+    }
+    jsdrv_os_mutex_free(self->mutex);
+    jsdrv_free(self);
+}
+
+struct jsdrv_param_cache_device_s * jsdrv_param_cache_device(struct jsdrv_param_cache_s * self, const char * prefix) {
+    struct jsdrv_list_s * item;
+    struct jsdrv_param_cache_device_s * d = NULL;
+    jsdrv_os_mutex_lock(self->mutex);
+    jsdrv_list_foreach(&self->devices, item) {
+        struct jsdrv_param_cache_device_s * x = JSDRV_CONTAINER_OF(item, struct jsdrv_param_cache_device_s, item);
+        if (0 == strcmp(x->prefix, prefix)) {
+            d = x;
+            break;
+        }
+    }
+    if (!d) {
+        d = jsdrv_alloc_clr(sizeof(struct jsdrv_param_cache_device_s));
+        jsdrv_list_initialize(&d->item);
+        jsdrv_cstr_copy(d->prefix, prefix, sizeof(d->prefix));
+        for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+            jsdrv_list_initialize(&d->buckets[i]);
+        }
+        jsdrv_list_add_tail(&self->devices, &d->item);
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    return d;
+}
+
+bool jsdrv_param_cache_resume(struct jsdrv_param_cache_device_s * self, uint64_t version) {
+    if (self->valid && (self->version == version)) {
+        return true;
+    }
+    device_clear(self);
+    self->version = version;
+    return false;
+}
+
+void jsdrv_param_cache_commit(struct jsdrv_param_cache_device_s * self) {
+    self->valid = true;
+}
+
+void jsdrv_param_cache_invalidate(struct jsdrv_param_cache_device_s * self) {
+    device_clear(self);
+}
+
+bool jsdrv_param_cache_update(struct jsdrv_param_cache_device_s * self, const char * topic,
+                              const struct jsdrv_union_s * value) {
+    struct jsdrv_list_s * item;
+    uint64_t h = entry_hash(topic, value);
+    struct jsdrv_list_s * bucket = &self->buckets[fnv64(FNV64_OFFSET, topic, strlen(topic)) & (BUCKET_COUNT - 1)];
+    jsdrv_list_foreach(bucket, item) {
+        struct entry_s * e = JSDRV_CONTAINER_OF(item, struct entry_s, item);
+        if (0 == strcmp(e->topic, topic)) {
+            if ((e->hash == h) && jsdrv_union_eq(&e->value, value)) {
+                return false;
+            }
+            self->hash -= e->hash;
+            entry_value_set(e, value);
+            e->hash = h;
+            self->hash += h;
+            return true;
+        }
+    }
+    struct entry_s * e = jsdrv_alloc_clr(sizeof(struct entry_s));
+    jsdrv_list_initialize(&e->item);
+    jsdrv_cstr_copy(e->topic, topic, sizeof(e->topic));
+    entry_value_set(e, value);
+    e->hash = h;
+    self->hash += h;
+    ++self->size;
+    jsdrv_list_add_tail(bucket, &e->item);
+    return true;
+}
+
+uint64_t jsdrv_param_cache_hash(const struct jsdrv_param_cache_device_s * self) {
+    return self->hash;
+}
+
+uint32_t jsdrv_param_cache_size(const struct jsdrv_param_cache_device_s * self) {
+    return self->size;
+}
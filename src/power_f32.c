@@ -0,0 +1,145 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/power_f32.h"
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv_prv/platform.h"
+#include <math.h>
+#include <string.h>
+
+
+static void side_reset(struct jsdrv_power_f32_side_s * side, uint64_t sample_id) {
+    side->sample_id = sample_id;
+    side->offset = 0;
+    side->length = 0;
+}
+
+static void side_consume(struct jsdrv_power_f32_side_s * side, uint32_t length, uint32_t decimate) {
+    if (length >= side->length) {
+        length = side->length;
+    }
+    side->sample_id += length * (uint64_t) decimate;
+    side->length -= length;
+    side->offset = side->length ? (side->offset + length) : 0;
+}
+
+void jsdrv_power_f32_clear(struct jsdrv_power_f32_s * self, uint32_t sample_id_decimate) {
+    self->sample_id_decimate = sample_id_decimate ? sample_id_decimate : 1;
+    for (uint32_t i = 0; i < 2; ++i) {
+        side_reset(&self->side[i], UINT64_MAX);
+    }
+}
+
+float * jsdrv_power_f32_reserve(struct jsdrv_power_f32_s * self, uint8_t side_idx, uint64_t sample_id, uint32_t length) {
+    struct jsdrv_power_f32_side_s * side = &self->side[side_idx & 1];
+    uint64_t decimate = self->sample_id_decimate;
+    if (length > JSDRV_POWER_F32_LENGTH) {
+        return NULL;
+    }
+    if (sample_id < side->sample_id) {
+        side_reset(side, sample_id);  // initial or restart
+    }
+    uint64_t sample_id_end = side->sample_id + side->length * decimate;
+    uint32_t gap = 0;
+    if (sample_id < sample_id_end) {
+        side->length = (uint32_t) ((sample_id - side->sample_id) / decimate);  // overwrite overlap
+    } else if (sample_id > sample_id_end) {
+        uint64_t gap_u64 = (sample_id - sample_id_end) / decimate;
+        if ((gap_u64 + length) > JSDRV_POWER_F32_LENGTH) {
+            side_reset(side, sample_id);
+        } else {
+            gap = (uint32_t) gap_u64;
+        }
+    }
+
+    uint32_t total = side->length + gap + length;
+    if (total > JSDRV_POWER_F32_LENGTH) {  // discard oldest
+        side_consume(side, total - JSDRV_POWER_F32_LENGTH, self->sample_id_decimate);
+    }
+    if ((side->offset + side->length + gap + length) > JSDRV_POWER_F32_LENGTH) {
+        memmove(side->data, side->data + side->offset, side->length * sizeof(float));
+        side->offset = 0;
+    }
+    float * p = side->data + side->offset + side->length;
+    for (uint32_t i = 0; i < gap; ++i) {
+        *p++ = NAN;
+    }
+    if (side->length == 0) {
+        side->sample_id = sample_id - gap * decimate;
+    }
+    side->length += gap;
+    return p;
+}
+
+void jsdrv_power_f32_commit(struct jsdrv_power_f32_s * self, uint8_t side_idx, uint32_t length) {
+    struct jsdrv_power_f32_side_s * side = &self->side[side_idx & 1];
+    side->length += length;
+}
+
+void jsdrv_power_f32_add(struct jsdrv_power_f32_s * self, uint8_t side, uint64_t sample_id,
+                         const float * data, uint32_t length) {
+    if (length > JSDRV_POWER_F32_LENGTH) {
+        uint32_t skip = length - JSDRV_POWER_F32_LENGTH;
+        data += skip;
+        sample_id += skip * (uint64_t) self->sample_id_decimate;
+        length = JSDRV_POWER_F32_LENGTH;
+    }
+    float * p = jsdrv_power_f32_reserve(self, side, sample_id, length);
+    jsdrv_memcpy(p, data, length * sizeof(float));
+    jsdrv_power_f32_commit(self, side, length);
+}
+
+uint32_t jsdrv_power_f32_available(struct jsdrv_power_f32_s * self, uint64_t * sample_id) {
+    struct jsdrv_power_f32_side_s * i = &self->side[JSDRV_POWER_F32_CURRENT];
+    struct jsdrv_power_f32_side_s * v = &self->side[JSDRV_POWER_F32_VOLTAGE];
+    uint64_t decimate = self->sample_id_decimate;
+    if (!i->length || !v->length) {
+        return 0;
+    }
+    // discard samples that precede the other side, which can never pair
+    if (i->sample_id < v->sample_id) {
+        side_consume(i, (uint32_t) ((v->sample_id - i->sample_id) / decimate), self->sample_id_decimate);
+    } else if (v->sample_id < i->sample_id) {
+        side_consume(v, (uint32_t) ((i->sample_id - v->sample_id) / decimate), self->sample_id_decimate);
+    }
+    if (!i->length || !v->length || (i->sample_id != v->sample_id)) {
+        return 0;
+    }
+    if (sample_id) {
+        *sample_id = i->sample_id;
+    }
+    return (i->length < v->length) ? i->length : v->length;
+}
+
+const float * jsdrv_power_f32_peek(struct jsdrv_power_f32_s * self, uint8_t side_idx) {
+    struct jsdrv_power_f32_side_s * side = &self->side[side_idx & 1];
+    return side->data + side->offset;
+}
+
+uint32_t jsdrv_power_f32_mult(struct jsdrv_power_f32_s * self, float * p, uint32_t length) {
+    struct jsdrv_power_f32_side_s * i = &self->side[JSDRV_POWER_F32_CURRENT];
+    struct jsdrv_power_f32_side_s * v = &self->side[JSDRV_POWER_F32_VOLTAGE];
+    uint32_t n = jsdrv_power_f32_available(self, NULL);
+    if (n > length) {
+        n = length;
+    }
+    if (n) {
+        jsdrv_f32_mult(p, i->data + i->offset, v->data + v->offset, n);
+        side_consume(i, n, self->sample_id_decimate);
+        side_consume(v, n, self->sample_id_decimate);
+    }
+    return n;
+}
@@ -15,31 +15,112 @@
  */
 
 #define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#define JSDRV_LOG_MODULE JSDRV_LOG_MODULE_PUBSUB
 
 #include "jsdrv_prv/pubsub.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/assert.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/backend.h"
+#include "jsdrv_prv/dispatch.h"
 #include "jsdrv_prv/frontend.h"
 #include "jsdrv_prv/log.h"
-#include "jsdrv/meta.h"
+#include "jsdrv_prv/meta.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/snapshot.h"
+#include "jsdrv_prv/trace.h"
+#include "jsdrv_prv/value_shared.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+#include "tinyprintf.h"
 
 struct subscriber_s {
     struct jsdrv_pubsub_subscriber_s sub;
     struct jsdrv_list_s item;
+    struct jsdrv_list_s index;  // in jsdrv_pubsub_s.subscriber_index, topic subscribers only
+};
+
+#define TOPIC_HASH_SIZE_INIT (256U)   // power of 2
+#define TOPIC_INTERN_MAX (1024U)
+#define TOPIC_STATS_MAX (16U)         // topics reported by jsdrv_pubsub_stats
+#define META_SHARED_BUCKETS (256U)    // power of 2
+#define META_SHARED_MAX (4096U)       // unique metadata strings before falling back to per-topic
+#define SNAPSHOT_CAPACITY (4096U)     // retained values readable without the frontend
+#define SUBSCRIBER_INDEX_BUCKETS (256U)  // power of 2
+
+/**
+ * @brief Immutable metadata shared by all topics that publish the same JSON.
+ *
+ * Devices of the same model publish identical metadata under each device
+ * prefix.  The first publication stores the string and its compiled
+ * validator here, and later topics reference them.  Entries live until
+ * jsdrv_pubsub_finalize(), like topics, since retained messages may still
+ * point to the string.
+ */
+struct meta_shared_s {
+    struct meta_shared_s * next;      // bucket chain
+    uint32_t hash;
+    uint32_t size;                    // including the terminator
+    struct jsdrv_meta_validator_s * validator;
+    char str[];
+};
+
+struct topic_stats_s {
+    uint32_t messages;
+    uint32_t calls;                   // synchronous subscriber deliveries
+    uint64_t bytes;
+    int64_t time_total;               // in subscriber delivery, 34Q30 time
+    int64_t time_max;
 };
 
 struct topic_s {
     char name[JSDRV_TOPIC_LENGTH_PER_LEVEL];
+    char full[JSDRV_TOPIC_LENGTH_MAX];  // full topic name for the hash index
+    uint32_t hash;
+    struct topic_s * hash_next;         // topic_hash bucket chain
     struct jsdrvp_msg_s * value;
     struct jsdrvp_msg_s * meta;
+    struct jsdrv_meta_validator_s * validator;    // compiled from meta
+    uint8_t validator_shared;                     // validator owned by meta_shared_s
     struct topic_s * parent;
     struct jsdrv_list_s item;  // used by parent->children list
     struct jsdrv_list_s children;
     struct jsdrv_list_s subscribers;
+    struct jsdrv_pubsub_subscriber_s * dispatch;  // flattened subscribers, this topic then parents
+    uint32_t dispatch_count;
+    uint32_t dispatch_alloc;
+    uint32_t dispatch_gen;                        // matches subscriber_gen when valid
+    uint8_t stream;                               // JSDRV_SFLAG_STREAM fast path
+    struct topic_stats_s stats;                   // when jsdrv_pubsub_s.stats_enable
+};
+
+struct wildcard_s {
+    struct subscriber_s s;                  // s.item in jsdrv_pubsub_s.wildcards
+    char pattern[JSDRV_TOPIC_LENGTH_MAX];   // with '+' and '#' levels
+};
+
+struct jsdrv_pubsub_coalesce_s {
+    struct jsdrv_list_s item;               // in jsdrv_pubsub_s.coalesce
+    struct jsdrv_pubsub_subscriber_s sub;   // delivery target, with coalesce NULL
+    uint32_t interval_ms;
+    uint32_t t_last_ms;                     // last delivery time
+    struct jsdrvp_msg_s * pending;          // newest undelivered value, retained
+};
+
+struct watch_s {
+    struct jsdrv_list_s item;               // in jsdrv_pubsub_s.watches
+    struct topic_s * topic;
+    struct jsdrv_pubsub_subscriber_s sub;   // the watcher, excluded from the count
+    uint32_t count;                         // last reported, UINT32_MAX to force
+};
+
+struct topic_intern_s {
+    char name[JSDRV_TOPIC_LENGTH_MAX];
+    uint32_t length;
+    uint32_t hash;           // FNV-1a over the exact name
+    struct topic_s * topic;  // resolved lazily, pubsub thread only
 };
 
 struct jsdrv_pubsub_s {
@@ -47,9 +128,26 @@ struct jsdrv_pubsub_s {
     struct topic_s * root_topic;
     struct jsdrv_list_s subscriber_free;      // of subscriber_s
     struct jsdrv_list_s msg_pend;             // of jsdrvp_msg_s
+    struct jsdrv_list_s wildcards;            // of wildcard_s
+    struct jsdrv_list_s coalesce;             // of jsdrv_pubsub_coalesce_s
+    struct jsdrv_list_s watches;              // of watch_s
+    uint32_t watch_gen;                       // subscriber_gen when watches last evaluated
+    struct jsdrv_dispatch_s * dispatch;       // NULL or data dispatch workers
+    struct topic_s ** topic_hash;             // full topic name to topic_s
+    struct jsdrv_list_s subscriber_index[SUBSCRIBER_INDEX_BUCKETS];  // subscriber_s.index by subscriber_hash()
+    uint32_t topic_hash_size;                 // bucket count, power of 2
+    uint32_t topic_hash_count;
+    uint32_t subscriber_gen;                  // incremented on any subscriber change
+    uint8_t stats_enable;                     // collect topic_s.stats
+    jsdrv_os_mutex_t intern_mutex;            // protects intern additions
+    struct topic_intern_s * intern[TOPIC_INTERN_MAX];  // topic_id - 1 to entry, never moved
+    volatile uint32_t intern_count;
+    struct meta_shared_s * meta_shared[META_SHARED_BUCKETS];
+    uint32_t meta_shared_count;
+    struct jsdrv_snapshot_s * snapshot;       // retained values for lock-free reads
 };
 
-static uint8_t publish(struct topic_s * topic, struct jsdrvp_msg_s * msg, uint8_t flags);
+static uint8_t publish(struct jsdrv_pubsub_s * self, struct topic_s * topic, struct jsdrvp_msg_s * msg, uint8_t flags);
 
 static void topic_str_append(char * topic_str, const char * topic_sub_str) {
     // WARNING: topic_str must be >= TOPIC_LENGTH_MAX
@@ -80,27 +178,6 @@ static void topic_str_append(char * topic_str, const char * topic_sub_str) {
     *t = 0;  // null terminate
 }
 
-#if 0
-static void topic_str_pop(char * topic_str) {
-    char * end = topic_str;
-    if (!topic_str || !topic_str[0]) {
-        return;  // nothing to pop
-    }
-    for (uint32_t i = 1; i < JSDRV_TOPIC_LENGTH_MAX; ++i) {
-        if (!topic_str[i]) {
-            *end = topic_str[i - 1];
-        }
-    }
-    while (end >= topic_str) {
-        if (*end == '/') {
-            *end-- = 0;
-            return;
-        }
-        *end-- = 0;
-    }
-}
-#endif
-
 static struct subscriber_s * subscriber_alloc(struct jsdrv_pubsub_s * self) {
     struct subscriber_s * sub;
     if (!jsdrv_list_is_empty(&self->subscriber_free)) {
@@ -113,13 +190,105 @@ static struct subscriber_s * subscriber_alloc(struct jsdrv_pubsub_s * self) {
     }
     jsdrv_memset(sub, 0, sizeof(*sub));
     jsdrv_list_initialize(&sub->item);
+    jsdrv_list_initialize(&sub->index);
     return sub;
 }
 
+// The subscriber_index bucket for a subscriber, which matches is_same_subscriber().
+static struct jsdrv_list_s * subscriber_bucket(struct jsdrv_pubsub_s * self, const struct jsdrv_pubsub_subscriber_s * s) {
+    uint64_t h = (uint64_t) (uintptr_t) s->void_fn;
+    h ^= ((uint64_t) (uintptr_t) s->user_data) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+    return &self->subscriber_index[h & (SUBSCRIBER_INDEX_BUCKETS - 1)];
+}
+
+static void coalesce_free(struct jsdrv_pubsub_s * self, struct jsdrv_pubsub_coalesce_s * c) {
+    jsdrv_list_remove(&c->item);
+    if (c->pending) {
+        jsdrvp_msg_free(self->context, c->pending);
+    }
+    jsdrv_free(c);
+}
+
 static void subscriber_free(struct jsdrv_pubsub_s * self, struct subscriber_s * sub) {
+    jsdrv_list_remove(&sub->index);
+    if (sub->sub.queue) {
+        jsdrv_dispatch_queue_close(sub->sub.queue);
+        sub->sub.queue = NULL;
+    }
+    if (sub->sub.coalesce) {
+        coalesce_free(self, sub->sub.coalesce);
+        sub->sub.coalesce = NULL;
+    }
     jsdrv_list_add_tail(&self->subscriber_free, &sub->item);
 }
 
+static void wildcard_free(struct jsdrv_pubsub_s * self, struct wildcard_s * w) {
+    if (w->s.sub.queue) {
+        jsdrv_dispatch_queue_close(w->s.sub.queue);
+        w->s.sub.queue = NULL;
+    }
+    if (w->s.sub.coalesce) {
+        coalesce_free(self, w->s.sub.coalesce);
+        w->s.sub.coalesce = NULL;
+    }
+    jsdrv_free(w);
+}
+
+/**
+ * @brief Check for a wildcard subscription topic.
+ *
+ * @param topic The subscription topic.
+ * @return true if any level is "+", which matches exactly one level,
+ *      or "#", which matches all remaining levels.
+ */
+static bool topic_is_wildcard(const char * topic) {
+    const char * level = topic;
+    for (const char * p = topic; ; ++p) {
+        if ((*p == '/') || (*p == 0)) {
+            if (((p - level) == 1) && ((level[0] == '+') || (level[0] == '#'))) {
+                return true;
+            }
+            if (*p == 0) {
+                return false;
+            }
+            level = p + 1;
+        }
+    }
+}
+
+static bool wildcard_match(const char * pattern, const char * topic) {
+    while (1) {
+        if ((pattern[0] == '#') && ((pattern[1] == 0) || (pattern[1] == '/'))) {
+            return true;  // matches all remaining levels, including none
+        }
+        if (!*topic) {
+            return false;
+        }
+        if ((pattern[0] == '+') && ((pattern[1] == 0) || (pattern[1] == '/'))) {
+            ++pattern;
+            while (*topic && (*topic != '/')) {
+                ++topic;
+            }
+        } else {
+            while (*pattern && (*pattern != '/') && (*pattern == *topic)) {
+                ++pattern;
+                ++topic;
+            }
+            if ((*pattern && (*pattern != '/')) || (*topic && (*topic != '/'))) {
+                return false;
+            }
+        }
+        if (!*topic) {
+            return !*pattern || (0 == strcmp(pattern, "/#"));
+        } else if (!*pattern) {
+            return false;
+        }
+        ++pattern;  // skip '/'
+        ++topic;
+    }
+}
+
 static struct topic_s * topic_alloc(struct jsdrv_pubsub_s * self, const char * name) {
     (void) self;
     struct topic_s * topic = jsdrv_alloc_clr(sizeof(struct topic_s));
@@ -146,6 +315,10 @@ static void topic_free(struct jsdrv_pubsub_s * self, struct topic_s * topic) {
         jsdrvp_msg_free(self->context, topic->meta);
         topic->meta = NULL;
     }
+    if (!topic->validator_shared) {
+        jsdrv_meta_validator_free(topic->validator);
+    }
+    topic->validator = NULL;
     jsdrv_list_foreach(&topic->subscribers, item) {
         subscriber = JSDRV_CONTAINER_OF(item, struct subscriber_s, item);
         jsdrv_list_remove(item);
@@ -157,6 +330,10 @@ static void topic_free(struct jsdrv_pubsub_s * self, struct topic_s * topic) {
         jsdrv_list_remove(item);
         topic_free(self, subtopic);
     }
+    if (topic->dispatch) {
+        jsdrv_free(topic->dispatch);
+        topic->dispatch = NULL;
+    }
     //JSDRV_LOGD3("topic free: %p", (void *)topic);
     jsdrv_free(topic);
 }
@@ -200,11 +377,74 @@ static struct topic_s * subtopic_find(struct topic_s * parent, const char * subt
     return NULL;
 }
 
+static uint32_t topic_hash_compute(const char * topic, size_t * length) {
+    uint32_t h = 2166136261U;  // FNV-1a
+    size_t sz = 0;
+    uint32_t sep = 0;
+    for (size_t i = 0; topic[i]; ++i) {
+        uint8_t ch = (uint8_t) topic[i];
+        if (ch == '/') {
+            ++sep;  // defer: trailing separators do not create topics
+            continue;
+        }
+        for (; sep; --sep) {
+            h ^= (uint8_t) '/';
+            h *= 16777619U;
+        }
+        h ^= ch;
+        h *= 16777619U;
+        sz = i + 1;
+    }
+    *length = sz;
+    return h;
+}
+
+static struct topic_s * topic_hash_lookup(struct jsdrv_pubsub_s * self, const char * topic) {
+    size_t sz;
+    uint32_t h = topic_hash_compute(topic, &sz);
+    struct topic_s * t = self->topic_hash[h & (self->topic_hash_size - 1)];
+    for (; t; t = t->hash_next) {
+        if ((t->hash == h) && (0 == strncmp(t->full, topic, sz)) && (0 == t->full[sz])) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static void topic_hash_insert(struct jsdrv_pubsub_s * self, struct topic_s * topic) {
+    size_t sz;
+    if (self->topic_hash_count >= self->topic_hash_size) {
+        uint32_t size = self->topic_hash_size * 2;
+        struct topic_s ** buckets = jsdrv_alloc_clr(size * sizeof(struct topic_s *));
+        for (uint32_t i = 0; i < self->topic_hash_size; ++i) {
+            struct topic_s * t = self->topic_hash[i];
+            while (t) {
+                struct topic_s * t_next = t->hash_next;
+                t->hash_next = buckets[t->hash & (size - 1)];
+                buckets[t->hash & (size - 1)] = t;
+                t = t_next;
+            }
+        }
+        jsdrv_free(self->topic_hash);
+        self->topic_hash = buckets;
+        self->topic_hash_size = size;
+    }
+    topic->hash = topic_hash_compute(topic->full, &sz);
+    struct topic_s ** bucket = &self->topic_hash[topic->hash & (self->topic_hash_size - 1)];
+    topic->hash_next = *bucket;
+    *bucket = topic;
+    ++self->topic_hash_count;
+}
+
 static struct topic_s * topic_find(struct jsdrv_pubsub_s * self, const char * topic, bool create) {
     char subtopic_str[JSDRV_TOPIC_LENGTH_PER_LEVEL];
     const char * c = topic;
 
-    struct topic_s * t = self->root_topic;
+    struct topic_s * t = topic_hash_lookup(self, topic);
+    if (t) {
+        return t;
+    }
+    t = self->root_topic;
     struct topic_s * subtopic;
     while (*c != 0) {
         if (!subtopic_get_str(&c, subtopic_str)) {
@@ -218,6 +458,9 @@ static struct topic_s * topic_find(struct jsdrv_pubsub_s * self, const char * to
             subtopic = topic_alloc(self, subtopic_str);
             subtopic->parent = t;
             jsdrv_list_add_tail(&t->children, &subtopic->item);
+            jsdrv_cstr_copy(subtopic->full, t->full, sizeof(subtopic->full));
+            topic_str_append(subtopic->full, subtopic_str);
+            topic_hash_insert(self, subtopic);
         }
         t = subtopic;
     }
@@ -229,6 +472,17 @@ struct jsdrv_pubsub_s * jsdrv_pubsub_initialize(struct jsdrv_context_s * context
     s->context = context;
     jsdrv_list_initialize(&s->subscriber_free);
     jsdrv_list_initialize(&s->msg_pend);
+    jsdrv_list_initialize(&s->wildcards);
+    jsdrv_list_initialize(&s->coalesce);
+    jsdrv_list_initialize(&s->watches);
+    for (uint32_t i = 0; i < SUBSCRIBER_INDEX_BUCKETS; ++i) {
+        jsdrv_list_initialize(&s->subscriber_index[i]);
+    }
+    s->topic_hash_size = TOPIC_HASH_SIZE_INIT;
+    s->topic_hash = jsdrv_alloc_clr(TOPIC_HASH_SIZE_INIT * sizeof(struct topic_s *));
+    s->subscriber_gen = 1;
+    s->intern_mutex = jsdrv_os_mutex_alloc("pubsub_intern");
+    s->snapshot = jsdrv_snapshot_alloc(SNAPSHOT_CAPACITY);
     s->root_topic = topic_alloc(s, "");
     return s;
 }
@@ -240,7 +494,29 @@ void jsdrv_pubsub_finalize(struct jsdrv_pubsub_s * self) {
             struct jsdrvp_msg_s * m = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
             jsdrvp_msg_free(self->context, m);
         }
+        while (!jsdrv_list_is_empty(&self->wildcards)) {
+            struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->wildcards);
+            wildcard_free(self, JSDRV_CONTAINER_OF(item, struct wildcard_s, s.item));
+        }
+        while (!jsdrv_list_is_empty(&self->watches)) {
+            struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->watches);
+            jsdrv_free(JSDRV_CONTAINER_OF(item, struct watch_s, item));
+        }
         topic_free(self, self->root_topic);
+        jsdrv_free(self->topic_hash);
+        for (uint32_t i = 0; i < META_SHARED_BUCKETS; ++i) {
+            while (self->meta_shared[i]) {
+                struct meta_shared_s * m = self->meta_shared[i];
+                self->meta_shared[i] = m->next;
+                jsdrv_meta_validator_free(m->validator);
+                jsdrv_free(m);
+            }
+        }
+        for (uint32_t i = 0; i < self->intern_count; ++i) {
+            jsdrv_free(self->intern[i]);
+        }
+        jsdrv_os_mutex_free(self->intern_mutex);
+        jsdrv_snapshot_free(self->snapshot);
         while (!jsdrv_list_is_empty(&self->subscriber_free)) {
             struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->subscriber_free);
             struct subscriber_s * sub = JSDRV_CONTAINER_OF(item, struct subscriber_s, item);
@@ -251,6 +527,65 @@ void jsdrv_pubsub_finalize(struct jsdrv_pubsub_s * self) {
     }
 }
 
+void jsdrv_pubsub_dispatch_set(struct jsdrv_pubsub_s * self, struct jsdrv_dispatch_s * dispatch) {
+    self->dispatch = dispatch;
+}
+
+uint32_t jsdrv_pubsub_topic_intern(struct jsdrv_pubsub_s * self, const char * topic) {
+    uint32_t topic_id = 0;
+    if (!self || !topic || !topic[0]) {
+        return 0;
+    }
+    uint32_t h = 2166136261U;  // FNV-1a
+    uint32_t length = 0;
+    for (; topic[length]; ++length) {
+        h ^= (uint8_t) topic[length];
+        h *= 16777619U;
+    }
+    jsdrv_os_mutex_lock(self->intern_mutex);
+    uint32_t count = self->intern_count;
+    for (uint32_t i = 0; i < count; ++i) {
+        struct topic_intern_s * e = self->intern[i];
+        if ((e->hash == h) && (e->length == length) && (0 == memcmp(e->name, topic, length))) {
+            topic_id = i + 1;
+            break;
+        }
+    }
+    if (!topic_id) {
+        if (count >= TOPIC_INTERN_MAX) {
+            JSDRV_LOGW("topic intern full: %s", topic);
+        } else {
+            struct topic_intern_s * e = jsdrv_alloc_clr(sizeof(struct topic_intern_s));
+            jsdrv_cstr_copy(e->name, topic, sizeof(e->name));
+            e->length = (uint32_t) strlen(e->name);
+            e->hash = h;
+            self->intern[count] = e;
+            self->intern_count = count + 1;
+            topic_id = count + 1;
+        }
+    }
+    jsdrv_os_mutex_unlock(self->intern_mutex);
+    return topic_id;
+}
+
+static struct topic_intern_s * intern_get(struct jsdrv_pubsub_s * self, uint32_t topic_id) {
+    // Entries are never moved or freed, and the topic_id was received after
+    // creation, so reading without the mutex is safe.
+    if ((topic_id == 0) || (topic_id > TOPIC_INTERN_MAX)) {
+        return NULL;
+    }
+    return self->intern[topic_id - 1];
+}
+
+const char * jsdrv_pubsub_topic_name(struct jsdrv_pubsub_s * self, uint32_t topic_id) {
+    struct topic_intern_s * e = intern_get(self, topic_id);
+    return e ? e->name : NULL;
+}
+
+int32_t jsdrv_pubsub_query_snapshot(struct jsdrv_pubsub_s * self, const char * topic, struct jsdrv_union_s * value) {
+    return jsdrv_snapshot_get(self->snapshot, topic, value);
+}
+
 int32_t jsdrv_pubsub_publish(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
     jsdrv_list_add_tail(&self->msg_pend, &msg->item);
     return 0;
@@ -258,6 +593,7 @@ int32_t jsdrv_pubsub_publish(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s *
 
 static int8_t subscriber_call(struct jsdrv_pubsub_subscriber_s * s, struct jsdrvp_msg_s * msg) {
     uint8_t rc = 0;
+    JSDRV_TRACE_BEGIN("subscriber", msg->topic, msg->value.size);
     if (!s->void_fn) {
         JSDRV_LOGW("skip null subscriber");
     } else if (s->is_internal) {
@@ -268,7 +604,13 @@ static int8_t subscriber_call(struct jsdrv_pubsub_subscriber_s * s, struct jsdrv
                 || (msg->value.app == JSDRV_PAYLOAD_TYPE_STATISTICS)
                 || (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_INFO)
                 || (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_REQ)
-                || (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_RSP)) {
+                || (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_RSP)
+                || (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_REQ_MULTI)
+                || (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI)
+                || (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_SEARCH)
+                || (msg->value.app == JSDRV_PAYLOAD_TYPE_ALIGN)
+                || (msg->value.app == JSDRV_PAYLOAD_TYPE_SPECTRUM)
+                || (msg->value.app == JSDRV_PAYLOAD_TYPE_INTERVAL)) {
             s->external_fn(s->user_data, msg->topic, &msg->value);
         } else if ((msg->value.type == JSDRV_UNION_BIN) && (msg->value.app == JSDRV_PAYLOAD_TYPE_DEVICE)) {
             s->external_fn(s->user_data, msg->topic, &jsdrv_union_str(msg->payload.device.prefix));
@@ -276,6 +618,7 @@ static int8_t subscriber_call(struct jsdrv_pubsub_subscriber_s * s, struct jsdrv
             JSDRV_LOGW("unsupported value.app type: %d", (int) msg->value.app);
         }
     }
+    JSDRV_TRACE_END("subscriber");
 
     if (rc) {
         JSDRV_LOGW("subscriber returned %d", (int) rc);
@@ -380,7 +723,7 @@ static void publish_return_code(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_
     if (t) {
         msg->topic[sz] = JSDRV_TOPIC_SUFFIX_RETURN_CODE;
         msg->topic[sz + 1] = 0;
-        publish(t, msg, JSDRV_SFLAG_RETURN_CODE);
+        publish(self, t, msg, JSDRV_SFLAG_RETURN_CODE);
     }
     jsdrvp_msg_free(self->context, msg);
 }
@@ -419,9 +762,94 @@ static int32_t query(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
     return msg->value.value.i32;
 }
 
+static int32_t subscriber_queue_alloc(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg,
+                                      struct jsdrv_dispatch_queue_s ** queue) {
+    struct jsdrv_pubsub_subscriber_s * s = &msg->payload.sub.subscriber;
+    *queue = NULL;
+    if (!s->is_internal && s->queue_policy) {
+        if (!self->dispatch) {
+            JSDRV_LOGW("subscribe %s: queue requires dispatch threads", msg->payload.sub.topic);
+            return JSDRV_ERROR_NOT_SUPPORTED;
+        }
+        *queue = jsdrv_dispatch_queue_alloc(self->dispatch, msg->payload.sub.topic, s->external_fn, s->user_data,
+                                            s->queue_depth, s->queue_policy);
+        if (!*queue) {
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    }
+    return 0;
+}
+
+static struct jsdrv_pubsub_coalesce_s * coalesce_alloc(struct jsdrv_pubsub_s * self,
+                                                       const struct jsdrv_pubsub_subscriber_s * s) {
+    if (!s->coalesce_ms) {
+        return NULL;
+    }
+    struct jsdrv_pubsub_coalesce_s * c = jsdrv_alloc_clr(sizeof(struct jsdrv_pubsub_coalesce_s));
+    jsdrv_list_initialize(&c->item);
+    c->sub = *s;
+    c->sub.coalesce = NULL;
+    c->interval_ms = s->coalesce_ms;
+    c->t_last_ms = jsdrv_time_ms_u32() - c->interval_ms;  // first value delivers immediately
+    jsdrv_list_add_tail(&self->coalesce, &c->item);
+    return c;
+}
+
+static void wildcard_retain_traverse(struct topic_s * topic, struct wildcard_s * w) {
+    if (wildcard_match(w->pattern, topic->full)) {
+        if ((w->s.sub.flags & JSDRV_SFLAG_METADATA_RSP) && topic->meta) {
+            subscriber_call(&w->s.sub, topic->meta);
+        }
+        if ((w->s.sub.flags & JSDRV_SFLAG_PUB) && topic->value && (topic->value->value.flags & JSDRV_UNION_FLAG_RETAIN)) {
+            subscriber_call(&w->s.sub, topic->value);
+        }
+    }
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&topic->children, item) {
+        wildcard_retain_traverse(JSDRV_CONTAINER_OF(item, struct topic_s, item), w);
+    }
+}
+
+static int32_t subscribe_wildcard(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
+    const char * pattern = msg->payload.sub.topic;
+    const char * hash = strchr(pattern, '#');
+    while (hash) {  // '#' must be the final level
+        if (((hash != pattern) && (hash[-1] != '/')) || ((hash[1] != 0))) {
+            JSDRV_LOGW("subscribe %s: '#' only allowed as final level", pattern);
+            return JSDRV_ERROR_PARAMETER_INVALID;
+        }
+        hash = strchr(hash + 1, '#');
+    }
+    struct jsdrv_dispatch_queue_s * queue;
+    int32_t rc = subscriber_queue_alloc(self, msg, &queue);
+    if (rc) {
+        return rc;
+    }
+    JSDRV_LOGD2("subscribe wildcard %s", pattern);
+    struct wildcard_s * w = jsdrv_alloc_clr(sizeof(struct wildcard_s));
+    jsdrv_list_initialize(&w->s.item);
+    w->s.sub = msg->payload.sub.subscriber;
+    w->s.sub.queue = queue;
+    w->s.sub.coalesce = NULL;
+    if (queue) {
+        w->s.sub.coalesce_ms = 0;  // queue already decouples the subscriber
+    }
+    w->s.sub.coalesce = coalesce_alloc(self, &w->s.sub);
+    jsdrv_cstr_copy(w->pattern, pattern, sizeof(w->pattern));
+    jsdrv_list_add_tail(&self->wildcards, &w->s.item);
+    ++self->subscriber_gen;
+    if (w->s.sub.flags & JSDRV_SFLAG_RETAIN) {
+        wildcard_retain_traverse(self->root_topic, w);
+    }
+    return 0;
+}
+
 static int32_t subscribe(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
     JSDRV_ASSERT(msg->value.type == JSDRV_UNION_BIN);
     JSDRV_ASSERT(msg->value.value.bin == msg->payload.bin);
+    if (topic_is_wildcard(msg->payload.sub.topic)) {
+        return subscribe_wildcard(self, msg);
+    }
     struct topic_s * t = topic_find(self, msg->payload.sub.topic, true);
     if (!t) {
         JSDRV_LOGE("could not find/create subscribe topic %s", msg->payload.sub.topic);
@@ -430,9 +858,26 @@ static int32_t subscribe(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg
         JSDRV_LOGD2("subscribe %s", msg->payload.sub.topic);
     }
 
+    struct jsdrv_dispatch_queue_s * queue;
+    int32_t rc = subscriber_queue_alloc(self, msg, &queue);
+    if (rc) {
+        return rc;
+    }
+
     struct subscriber_s * sub = subscriber_alloc(self);
     sub->sub = msg->payload.sub.subscriber;
+    sub->sub.queue = queue;
+    sub->sub.coalesce = NULL;
+    if (queue) {
+        sub->sub.coalesce_ms = 0;  // queue already decouples the subscriber
+    }
+    sub->sub.coalesce = coalesce_alloc(self, &sub->sub);
     jsdrv_list_add_tail(&t->subscribers, &sub->item);
+    jsdrv_list_add_tail(subscriber_bucket(self, &sub->sub), &sub->index);
+    ++self->subscriber_gen;
+    if ((sub->sub.flags & JSDRV_SFLAG_STREAM) && (t->name[0] == '!')) {
+        t->stream = 1;
+    }
 
     if (sub->sub.flags & JSDRV_SFLAG_RETAIN) {
         devices_on_sub(self, msg);
@@ -448,9 +893,89 @@ static bool is_same_subscriber(const struct jsdrv_pubsub_subscriber_s * a, const
             (a->user_data == b->user_data));
 }
 
+static int wildcard_unsubscribe(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg, const char * pattern) {
+    struct jsdrv_list_s * item;
+    int count = 0;
+    jsdrv_list_foreach(&self->wildcards, item) {
+        struct wildcard_s * w = JSDRV_CONTAINER_OF(item, struct wildcard_s, s.item);
+        if (is_same_subscriber(&w->s.sub, &msg->payload.sub.subscriber)
+                && (!pattern || (0 == strcmp(pattern, w->pattern)))) {
+            jsdrv_list_remove(item);
+            wildcard_free(self, w);
+            ++count;
+        }
+    }
+    if (count) {
+        ++self->subscriber_gen;
+    }
+    return count;
+}
+
+/**
+ * @brief Remove watches.
+ *
+ * @param self The pubsub instance.
+ * @param topic The watched topic.
+ * @param sub The watcher.
+ * @param descendants Also remove watches for all topics below topic.
+ * @return The number of watches removed.
+ */
+static int watch_remove(struct jsdrv_pubsub_s * self, const char * topic,
+                        const struct jsdrv_pubsub_subscriber_s * sub, bool descendants) {
+    struct jsdrv_list_s * item;
+    size_t sz = strlen(topic);
+    int count = 0;
+    jsdrv_list_foreach(&self->watches, item) {
+        struct watch_s * w = JSDRV_CONTAINER_OF(item, struct watch_s, item);
+        const char * full = w->topic->full;
+        bool match;
+        if (descendants) {
+            match = (0 == sz) || ((0 == strncmp(full, topic, sz)) && ((full[sz] == 0) || (full[sz] == '/')));
+        } else {
+            match = (0 == strcmp(full, topic));
+        }
+        if (match && is_same_subscriber(&w->sub, sub)) {
+            jsdrv_list_remove(item);
+            jsdrv_free(w);
+            ++count;
+        }
+    }
+    return count;
+}
+
+static int32_t watch(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
+    const char * topic = msg->payload.sub.topic;
+    if (topic_is_wildcard(topic) || !msg->payload.sub.subscriber.is_internal) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct topic_s * t = topic_find(self, topic, true);
+    if (!t) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    JSDRV_LOGD2("watch %s", topic);
+    watch_remove(self, t->full, &msg->payload.sub.subscriber, false);
+    struct watch_s * w = jsdrv_alloc_clr(sizeof(struct watch_s));
+    jsdrv_list_initialize(&w->item);
+    w->topic = t;
+    w->sub = msg->payload.sub.subscriber;
+    w->count = UINT32_MAX;
+    jsdrv_list_add_tail(&self->watches, &w->item);
+    self->watch_gen = 0;  // report on the next process
+    return 0;
+}
+
+static int32_t unwatch(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
+    JSDRV_LOGD2("unwatch %s", msg->payload.sub.topic);
+    return watch_remove(self, msg->payload.sub.topic, &msg->payload.sub.subscriber, false) ? 0 : JSDRV_ERROR_NOT_FOUND;
+}
+
 static int32_t unsubscribe(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
     struct jsdrv_list_s * item;
     struct subscriber_s * s;
+    if (topic_is_wildcard(msg->payload.sub.topic)) {
+        JSDRV_LOGD2("unsubscribe wildcard %s", msg->payload.sub.topic);
+        return wildcard_unsubscribe(self, msg, msg->payload.sub.topic) ? 0 : JSDRV_ERROR_NOT_FOUND;
+    }
     struct topic_s * t = topic_find(self, msg->payload.sub.topic, true);
     int count = 0;
     if (!t) {
@@ -467,68 +992,350 @@ static int32_t unsubscribe(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * m
             ++count;
         }
     }
+    if (count) {
+        ++self->subscriber_gen;
+        watch_remove(self, msg->payload.sub.topic, &msg->payload.sub.subscriber, true);
+    }
     return count ? 0 : JSDRV_ERROR_NOT_FOUND;
 }
 
-static void unsubscribe_traverse(struct jsdrv_pubsub_s * self, struct topic_s * topic, struct jsdrvp_msg_s * msg) {
+/*
+ * Remove all topic subscriptions for a subscriber.
+ *
+ * The subscriber index holds each subscription in the bucket for its
+ * subscriber, so the cost follows this subscriber's subscriptions
+ * rather than the size of the topic tree.
+ */
+static void unsubscribe_index(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
     struct jsdrv_list_s * item;
-    struct topic_s * subtopic;
     struct subscriber_s * s;
-    jsdrv_list_foreach(&topic->subscribers, item) {
-        s = JSDRV_CONTAINER_OF(item, struct subscriber_s, item);
+    jsdrv_list_foreach(subscriber_bucket(self, &msg->payload.sub.subscriber), item) {
+        s = JSDRV_CONTAINER_OF(item, struct subscriber_s, index);
         if (is_same_subscriber(&s->sub, &msg->payload.sub.subscriber)) {
-            jsdrv_list_remove(item);
+            jsdrv_list_remove(&s->item);
             subscriber_free(self, s);
         }
     }
-
-    jsdrv_list_foreach(&topic->children, item) {
-        subtopic = JSDRV_CONTAINER_OF(item, struct topic_s, item);
-        unsubscribe_traverse(self, subtopic, msg);
-    }
 }
 
 static void unsubscribe_from_all(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
-    unsubscribe_traverse(self, self->root_topic, msg);
+    unsubscribe_index(self, msg);
+    wildcard_unsubscribe(self, msg, NULL);
+    watch_remove(self, "", &msg->payload.sub.subscriber, true);
+    ++self->subscriber_gen;
 }
 
-static uint8_t publish(struct topic_s * topic, struct jsdrvp_msg_s * msg, uint8_t flags) {
-    uint8_t status = 0;
+/**
+ * @brief Rebuild the flattened subscriber list for a topic.
+ *
+ * @param self The pubsub instance.
+ * @param topic The topic.
+ *
+ * Publish delivers to the topic subscribers, then the subscribers
+ * of each parent, then the matching wildcard subscribers.  Walking these lists for every message dominates the
+ * cost of high-rate data topics, so publish uses this contiguous copy
+ * instead.  Any subscribe or unsubscribe increments subscriber_gen,
+ * which invalidates every cached list.  Subscriber changes are only
+ * processed between publishes, never from within a publish.
+ */
+static void dispatch_rebuild(struct jsdrv_pubsub_s * self, struct topic_s * topic) {
     struct jsdrv_list_s * item;
     struct subscriber_s * s;
-    while (topic) {
-        jsdrv_list_foreach(&topic->subscribers, item) {
+    uint32_t count = 0;
+    for (struct topic_s * t = topic; t; t = t->parent) {
+        count += (uint32_t) jsdrv_list_length(&t->subscribers);
+    }
+    count += (uint32_t) jsdrv_list_length(&self->wildcards);  // upper bound
+    if (count > topic->dispatch_alloc) {
+        if (topic->dispatch) {
+            jsdrv_free(topic->dispatch);
+        }
+        topic->dispatch_alloc = (count < 4) ? 4 : count;
+        topic->dispatch = jsdrv_alloc(topic->dispatch_alloc * sizeof(struct jsdrv_pubsub_subscriber_s));
+    }
+    count = 0;
+    for (struct topic_s * t = topic; t; t = t->parent) {
+        jsdrv_list_foreach(&t->subscribers, item) {
             s = JSDRV_CONTAINER_OF(item, struct subscriber_s, item);
-            if (is_same_subscriber(&s->sub, &msg->extra.frontend.subscriber)) {
-                continue;
+            topic->dispatch[count++] = s->sub;
+        }
+    }
+    jsdrv_list_foreach(&self->wildcards, item) {
+        struct wildcard_s * w = JSDRV_CONTAINER_OF(item, struct wildcard_s, s.item);
+        if (wildcard_match(w->pattern, topic->full)) {
+            topic->dispatch[count++] = w->s.sub;
+            if ((w->s.sub.flags & JSDRV_SFLAG_STREAM) && (topic->name[0] == '!')) {
+                topic->stream = 1;
             }
-            switch (flags) {
-                case JSDRV_SFLAG_RETURN_CODE:
-                    if (!(s->sub.flags & JSDRV_SFLAG_RETURN_CODE)) {
-                        continue;
-                    }
-                    break;
-                case JSDRV_SFLAG_METADATA_RSP:
-                    if (!(s->sub.flags & JSDRV_SFLAG_METADATA_RSP)) {
-                        continue;
-                    }
-                    break;
-                default:
-                    if (!(s->sub.flags & JSDRV_SFLAG_PUB)) {
-                        continue;
-                    }
-                    break;
+        }
+    }
+    topic->dispatch_count = count;
+    topic->dispatch_gen = self->subscriber_gen;
+}
+
+/**
+ * @brief Report subscriber count changes to the watchers.
+ *
+ * @param self The pubsub instance.
+ *
+ * The count for a watched topic is the number of subscribers, other than
+ * the watcher, that receive its published values.  This includes the
+ * subscribers to parent topics and matching wildcards, which is exactly
+ * the flattened dispatch list.
+ */
+static void watch_process(struct jsdrv_pubsub_s * self) {
+    struct jsdrv_list_s * item;
+    if (self->watch_gen == self->subscriber_gen) {
+        return;
+    }
+    self->watch_gen = self->subscriber_gen;
+    jsdrv_list_foreach(&self->watches, item) {
+        struct watch_s * w = JSDRV_CONTAINER_OF(item, struct watch_s, item);
+        struct topic_s * t = w->topic;
+        if (t->dispatch_gen != self->subscriber_gen) {
+            dispatch_rebuild(self, t);
+        }
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < t->dispatch_count; ++i) {
+            if ((t->dispatch[i].flags & JSDRV_SFLAG_PUB) && !is_same_subscriber(&t->dispatch[i], &w->sub)) {
+                ++count;
+            }
+        }
+        if (count != w->count) {
+            w->count = count;
+            struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, t->full, &jsdrv_union_u32(count));
+            m->value.app = JSDRV_PAYLOAD_TYPE_WATCH;
+            subscriber_call(&w->sub, m);
+            jsdrvp_msg_free(self->context, m);
+        }
+    }
+}
+
+static uint8_t subscriber_deliver(struct jsdrv_pubsub_s * self, struct jsdrv_pubsub_subscriber_s * sub,
+                                  struct jsdrvp_msg_s * msg) {
+    if (sub->queue) {
+        jsdrv_dispatch_queue_submit(sub->queue, msg);
+        return 0;
+    }
+    if (self->dispatch && !sub->is_internal && sub->void_fn
+            && (msg->inner_msg_type == JSDRV_MSG_TYPE_DATA)) {
+        jsdrv_dispatch_submit(self->dispatch, sub->external_fn, sub->user_data, msg);
+        return 0;
+    }
+    return subscriber_call(sub, msg);
+}
+
+static void coalesce_publish(struct jsdrv_pubsub_s * self, struct jsdrv_pubsub_coalesce_s * c,
+                             struct jsdrvp_msg_s * msg) {
+    uint32_t t_now = jsdrv_time_ms_u32();
+    if (!c->pending && ((t_now - c->t_last_ms) >= c->interval_ms)) {
+        c->t_last_ms = t_now;
+        subscriber_deliver(self, &c->sub, msg);
+        return;
+    }
+    jsdrv_atomic_add_u32(&msg->refcnt, 1);
+    if (c->pending) {
+        jsdrvp_msg_free(self->context, c->pending);  // superseded
+    }
+    c->pending = msg;
+}
+
+static void coalesce_process(struct jsdrv_pubsub_s * self) {
+    uint32_t t_now = jsdrv_time_ms_u32();
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&self->coalesce, item) {
+        struct jsdrv_pubsub_coalesce_s * c = JSDRV_CONTAINER_OF(item, struct jsdrv_pubsub_coalesce_s, item);
+        if (c->pending && ((t_now - c->t_last_ms) >= c->interval_ms)) {
+            struct jsdrvp_msg_s * msg = c->pending;
+            c->pending = NULL;
+            c->t_last_ms = t_now;
+            subscriber_deliver(self, &c->sub, msg);
+            jsdrvp_msg_free(self->context, msg);
+        }
+    }
+}
+
+static void stats_reset_traverse(struct topic_s * topic) {
+    jsdrv_memset(&topic->stats, 0, sizeof(topic->stats));
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&topic->children, item) {
+        stats_reset_traverse(JSDRV_CONTAINER_OF(item, struct topic_s, item));
+    }
+}
+
+static void stats_top_traverse(struct topic_s * topic, struct topic_s ** top, uint32_t * count) {
+    if (topic->stats.messages) {
+        uint32_t idx = *count;
+        if (idx < TOPIC_STATS_MAX) {
+            ++*count;
+        } else if (topic->stats.time_total <= top[TOPIC_STATS_MAX - 1]->stats.time_total) {
+            idx = TOPIC_STATS_MAX;  // not in the top
+        } else {
+            idx = TOPIC_STATS_MAX - 1;
+        }
+        // insertion sort, most time first
+        for (; (idx > 0) && (idx < TOPIC_STATS_MAX)
+                && (top[idx - 1]->stats.time_total < topic->stats.time_total); --idx) {
+            top[idx] = top[idx - 1];
+        }
+        if (idx < TOPIC_STATS_MAX) {
+            top[idx] = topic;
+        }
+    }
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&topic->children, item) {
+        stats_top_traverse(JSDRV_CONTAINER_OF(item, struct topic_s, item), top, count);
+    }
+}
+
+void jsdrv_pubsub_stats_enable(struct jsdrv_pubsub_s * self, bool enable) {
+    if (enable && !self->stats_enable) {
+        stats_reset_traverse(self->root_topic);
+    }
+    self->stats_enable = enable ? 1 : 0;
+}
+
+uint32_t jsdrv_pubsub_stats(struct jsdrv_pubsub_s * self, char * buf, uint32_t size) {
+    struct topic_s * top[TOPIC_STATS_MAX];
+    uint32_t top_count = 0;
+    uint32_t count = 0;
+    char * p = buf;
+    char * p_end = buf + size;
+    if (!buf || (size < 3)) {
+        return 0;
+    }
+    stats_top_traverse(self->root_topic, top, &top_count);
+    *p++ = '[';
+    for (uint32_t i = 0; i < top_count; ++i) {
+        struct topic_stats_s * st = &top[i]->stats;
+        int64_t time_avg = st->calls ? (st->time_total / st->calls) : 0;
+        int n = tfp_snprintf(p, p_end - p - 1,
+                             "%s{\"topic\": \"%s\", \"messages\": %u, \"bytes\": %llu, \"calls\": %u, "
+                             "\"total_us\": %llu, \"avg_us\": %u, \"max_us\": %u}",
+                             count ? ", " : "", top[i]->full,
+                             (unsigned int) st->messages, (unsigned long long) st->bytes, (unsigned int) st->calls,
+                             (unsigned long long) (st->time_total / JSDRV_TIME_MICROSECOND),
+                             (unsigned int) (time_avg / JSDRV_TIME_MICROSECOND),
+                             (unsigned int) (st->time_max / JSDRV_TIME_MICROSECOND));
+        if ((n < 0) || (n >= (p_end - p - 1))) {
+            *p = 0;
+            break;  // truncate
+        }
+        p += n;
+        ++count;
+    }
+    *p++ = ']';
+    *p = 0;
+    stats_reset_traverse(self->root_topic);
+    return count;
+}
+
+uint32_t jsdrv_pubsub_timeout_ms(struct jsdrv_pubsub_s * self) {
+    uint32_t rv = UINT32_MAX;
+    uint32_t t_now = jsdrv_time_ms_u32();
+    struct jsdrv_list_s * item;
+    jsdrv_list_foreach(&self->coalesce, item) {
+        struct jsdrv_pubsub_coalesce_s * c = JSDRV_CONTAINER_OF(item, struct jsdrv_pubsub_coalesce_s, item);
+        if (c->pending) {
+            uint32_t elapsed = t_now - c->t_last_ms;
+            if (elapsed >= c->interval_ms) {
+                return 0;
+            }
+            uint32_t remaining = c->interval_ms - elapsed;
+            if (remaining < rv) {
+                rv = remaining;
             }
-            uint8_t rv = subscriber_call(&s->sub, msg);
-            if (!status && rv) {
-                status = rv;
+        }
+    }
+    return rv;
+}
+
+static uint8_t publish(struct jsdrv_pubsub_s * self, struct topic_s * topic, struct jsdrvp_msg_s * msg, uint8_t flags) {
+    uint8_t status = 0;
+    struct jsdrv_pubsub_subscriber_s * sub;
+    if (topic->dispatch_gen != self->subscriber_gen) {
+        dispatch_rebuild(self, topic);
+    }
+    uint32_t count = topic->dispatch_count;
+    if (self->stats_enable) {
+        ++topic->stats.messages;
+        topic->stats.bytes += msg->value.size;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        sub = &topic->dispatch[i];
+        if (is_same_subscriber(sub, &msg->extra.frontend.subscriber)) {
+            continue;
+        }
+        switch (flags) {
+            case JSDRV_SFLAG_RETURN_CODE:
+                if (!(sub->flags & JSDRV_SFLAG_RETURN_CODE)) {
+                    continue;
+                }
+                break;
+            case JSDRV_SFLAG_METADATA_RSP:
+                if (!(sub->flags & JSDRV_SFLAG_METADATA_RSP)) {
+                    continue;
+                }
+                break;
+            default:
+                if (!(sub->flags & JSDRV_SFLAG_PUB)) {
+                    continue;
+                }
+                break;
+        }
+        if (sub->coalesce && !flags) {
+            coalesce_publish(self, sub->coalesce, msg);
+            continue;
+        }
+        uint8_t rv;
+        if (self->stats_enable) {
+            int64_t t_start = jsdrv_time_utc();
+            rv = subscriber_deliver(self, sub, msg);
+            int64_t t_delta = jsdrv_time_utc() - t_start;
+            if (t_delta > 0) {  // realtime clock, ignore adjustments
+                topic->stats.time_total += t_delta;
+                if (t_delta > topic->stats.time_max) {
+                    topic->stats.time_max = t_delta;
+                }
             }
+            ++topic->stats.calls;
+        } else {
+            rv = subscriber_deliver(self, sub, msg);
+        }
+        if (!status && rv) {
+            status = rv;
         }
-        topic = topic->parent;
     }
     return status;
 }
 
+static struct meta_shared_s * meta_shared_get(struct jsdrv_pubsub_s * self, const char * str, uint32_t size) {
+    uint32_t h = 2166136261U;  // FNV-1a
+    for (uint32_t i = 0; i < size; ++i) {
+        h ^= (uint8_t) str[i];
+        h *= 16777619U;
+    }
+    struct meta_shared_s ** bucket = &self->meta_shared[h & (META_SHARED_BUCKETS - 1)];
+    for (struct meta_shared_s * m = *bucket; m; m = m->next) {
+        if ((m->hash == h) && (m->size == size) && (0 == memcmp(m->str, str, size))) {
+            return m;
+        }
+    }
+    if (self->meta_shared_count >= META_SHARED_MAX) {
+        return NULL;
+    }
+    struct meta_shared_s * m = jsdrv_alloc(sizeof(struct meta_shared_s) + size);
+    m->hash = h;
+    m->size = size;
+    memcpy(m->str, str, size);
+    m->str[size - 1] = 0;
+    m->validator = jsdrv_meta_validator_compile(m->str);
+    m->next = *bucket;
+    *bucket = m;
+    ++self->meta_shared_count;
+    return m;
+}
+
 static void publish_meta(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg) {
     char topic[JSDRV_TOPIC_LENGTH_MAX];
     jsdrv_cstr_copy(topic, msg->topic, sizeof(topic));
@@ -541,8 +1348,27 @@ static void publish_meta(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg
         if (!msg->value.size) {
             msg->value.size = (uint32_t) (strlen(msg->value.value.str) + 1);
         }
+        if (!t->validator_shared) {
+            jsdrv_meta_validator_free(t->validator);
+        }
+        struct meta_shared_s * m = meta_shared_get(self, msg->value.value.str, msg->value.size);
+        if (m) {
+            if (msg->value.flags & JSDRV_UNION_FLAG_SHARED_MEMORY) {
+                jsdrv_value_shared_release(msg->value.value.str);
+            } else if (msg->value.flags & JSDRV_UNION_FLAG_HEAP_MEMORY) {
+                jsdrv_free((void *) msg->value.value.str);
+            }
+            msg->value.flags &= ~(JSDRV_UNION_FLAG_HEAP_MEMORY | JSDRV_UNION_FLAG_SHARED_MEMORY);
+            msg->value.value.str = m->str;
+            msg->value.flags |= JSDRV_UNION_FLAG_CONST;
+            t->validator = m->validator;
+            t->validator_shared = 1;
+        } else {
+            t->validator = jsdrv_meta_validator_compile(msg->value.value.str);
+            t->validator_shared = 0;
+        }
         t->meta = msg;
-        publish(t, msg, JSDRV_SFLAG_METADATA_RSP);
+        publish(self, t, msg, JSDRV_SFLAG_METADATA_RSP);
     } else {
         jsdrvp_msg_free(self->context, msg);
     }
@@ -553,7 +1379,7 @@ static void local_return_code(struct jsdrv_pubsub_s * self, const char * topic,
     if (t) {
         struct jsdrvp_msg_s * rsp = jsdrvp_msg_alloc_value(self->context, "", &jsdrv_union_i32(return_code));
         jsdrv_cstr_join(rsp->topic, topic, "#", sizeof(rsp->topic));
-        publish(t, rsp, JSDRV_SFLAG_RETURN_CODE);
+        publish(self, t, rsp, JSDRV_SFLAG_RETURN_CODE);
         jsdrvp_msg_free(self->context, rsp);
     } else {
         JSDRV_LOGW("local_return_code failed on %s", topic);
@@ -564,8 +1390,8 @@ static void publish_normal(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * m
     uint8_t status = 0;
     struct topic_s * t = topic_find(self, msg->topic, true);
     if (t) {
-        if (t->meta) {
-            status = jsdrv_meta_value(t->meta->value.value.str, &msg->value);
+        if (t->validator) {
+            status = jsdrv_meta_validator_value(t->validator, &msg->value);
             if (status) {
                 char buf[32];
                 jsdrv_union_value_to_str(&msg->value, buf, (uint32_t) sizeof(buf), 1);
@@ -590,7 +1416,8 @@ static void publish_normal(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * m
         } else {
             t->value = NULL;
         }
-        status = publish(t, msg, 0);
+        jsdrv_snapshot_set(self->snapshot, t->full, t->value ? &t->value->value : NULL);
+        status = publish(self, t, msg, 0);
         if (status) {
             local_return_code(self, msg->topic, status);
         }
@@ -613,6 +1440,10 @@ static void process_msg(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg)
             rc = unsubscribe(self, msg);
         } else if (0 == strcmp(JSDRV_PUBSUB_UNSUBSCRIBE_ALL, msg->topic)) {
             unsubscribe_from_all(self, msg);
+        } else if (0 == strcmp(JSDRV_PUBSUB_WATCH, msg->topic)) {
+            rc = watch(self, msg);
+        } else if (0 == strcmp(JSDRV_PUBSUB_UNWATCH, msg->topic)) {
+            rc = unwatch(self, msg);
         } else {
             JSDRV_LOGW("unsupported command %s", msg->topic);
             rc = JSDRV_ERROR_NOT_SUPPORTED;
@@ -640,10 +1471,41 @@ static void process_msg(struct jsdrv_pubsub_s * self, struct jsdrvp_msg_s * msg)
     }
 }
 
+static struct topic_s * stream_topic_find(struct jsdrv_pubsub_s * self, const char * topic) {
+    const char * leaf = strrchr(topic, '/');
+    leaf = leaf ? (leaf + 1) : topic;
+    if (leaf[0] != '!') {
+        return NULL;
+    }
+    struct topic_s * t = topic_find(self, topic, false);
+    return (t && t->stream) ? t : NULL;
+}
+
 void jsdrv_pubsub_process(struct jsdrv_pubsub_s * self) {
     while (!jsdrv_list_is_empty(&self->msg_pend)) {
         struct jsdrv_list_s * item = jsdrv_list_remove_head(&self->msg_pend);
         struct jsdrvp_msg_s * msg = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+        struct topic_s * t = NULL;
+        struct topic_intern_s * e = intern_get(self, msg->topic_id);
+        if (e) {
+            if (!e->topic) {
+                e->topic = topic_find(self, e->name, true);
+            }
+            if (!msg->topic[0]) {
+                memcpy(msg->topic, e->name, e->length + 1);
+            }
+            if (e->topic && e->topic->stream) {
+                t = e->topic;
+            }
+        } else {
+            t = stream_topic_find(self, msg->topic);
+        }
+        if (t) {
+            // streaming data: never retained, validated, or acknowledged
+            publish(self, t, msg, 0);
+            jsdrvp_msg_free(self->context, msg);
+            continue;
+        }
         if (jsdrv_cstr_ends_with(msg->topic, "!data")) {
             JSDRV_LOGD3("jsdrv_pubsub_process %s", msg->topic);
         } else {
@@ -653,4 +1515,6 @@ void jsdrv_pubsub_process(struct jsdrv_pubsub_s * self) {
         }
         process_msg(self, msg);
     }
+    watch_process(self);
+    coalesce_process(self);
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "jsdrv_prv/quantile.h"
+#include <math.h>
+#include <string.h>
+
+
+#define MANTISSA_SHIFT (23 - JSDRV_QUANTILE_MANTISSA_BITS)
+#define KEY_OFFSET ((uint32_t) (127 + JSDRV_QUANTILE_EXP_MIN) << JSDRV_QUANTILE_MANTISSA_BITS)
+#define ZERO_BIN (JSDRV_QUANTILE_BINS_PER_SIGN)
+
+static inline uint32_t f32_bits(float x) {
+    uint32_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+static inline float f32_from_bits(uint32_t u) {
+    float x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+// The bin for a sample that is not NaN.
+static inline uint32_t bin_index(float x) {
+    uint32_t u = f32_bits(x);
+    uint32_t key = (u & 0x7fffffffU) >> MANTISSA_SHIFT;  // exponent and leading mantissa bits
+    if (key < KEY_OFFSET) {
+        return ZERO_BIN;
+    }
+    key -= KEY_OFFSET;
+    if (key >= JSDRV_QUANTILE_BINS_PER_SIGN) {
+        key = JSDRV_QUANTILE_BINS_PER_SIGN - 1;
+    }
+    return (u & 0x80000000U) ? (ZERO_BIN - 1 - key) : (ZERO_BIN + 1 + key);
+}
+
+// The value at the center of a bin.
+static float bin_value(uint32_t bin) {
+    if (bin == ZERO_BIN) {
+        return 0.0f;
+    }
+    uint32_t sign = (bin < ZERO_BIN) ? 0x80000000U : 0;
+    uint32_t key = sign ? (ZERO_BIN - 1 - bin) : (bin - ZERO_BIN - 1);
+    uint32_t u = ((key + KEY_OFFSET) << MANTISSA_SHIFT) | (1U << (MANTISSA_SHIFT - 1));
+    return f32_from_bits(sign | u);
+}
+
+void jsdrv_quantile_clear(struct jsdrv_quantile_s * self) {
+    memset(self, 0, sizeof(*self));
+    self->min = INFINITY;
+    self->max = -INFINITY;
+}
+
+void jsdrv_quantile_add_f32(struct jsdrv_quantile_s * self, const float * x, uint32_t n) {
+    float v_min = self->min;
+    float v_max = self->max;
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        float v = x[i];
+        if (isnan(v)) {
+            continue;
+        }
+        ++self->bins[bin_index(v)];
+        ++count;
+        v_min = (v < v_min) ? v : v_min;
+        v_max = (v > v_max) ? v : v_max;
+    }
+    self->count += count;
+    self->min = v_min;
+    self->max = v_max;
+}
+
+void jsdrv_quantile_merge(struct jsdrv_quantile_s * self, const struct jsdrv_quantile_s * other) {
+    for (uint32_t i = 0; i < JSDRV_QUANTILE_BINS; ++i) {
+        self->bins[i] += other->bins[i];
+    }
+    self->count += other->count;
+    self->min = (other->min < self->min) ? other->min : self->min;
+    self->max = (other->max > self->max) ? other->max : self->max;
+}
+
+float jsdrv_quantile_value(const struct jsdrv_quantile_s * self, double q) {
+    if (0 == self->count) {
+        return NAN;
+    }
+    if (q <= 0.0) {
+        return self->min;
+    } else if (q >= 1.0) {
+        return self->max;
+    }
+    uint64_t rank = (uint64_t) ceil(q * (double) self->count);  // 1-based
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t total = 0;
+    uint32_t bin = 0;
+    for (; bin < JSDRV_QUANTILE_BINS; ++bin) {
+        total += self->bins[bin];
+        if (total >= rank) {
+            break;
+        }
+    }
+    float v = bin_value(bin);
+    if (v < self->min) {
+        v = self->min;
+    } else if (v > self->max) {
+        v = self->max;
+    }
+    return v;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv/raw_cal.h"
+#include "jsdrv/unpack.h"
+#include "jsdrv_prv/f32_ops.h"
+#include <math.h>
+#include <stddef.h>
+
+#define RANGE_CHUNK (256U)
+
+
+static void run_apply(const struct jsdrv_raw_cal_s * cal, float * y, const int16_t * adc,
+        uint8_t range, uint32_t length) {
+    float gain = cal->gain[range];
+    if (gain == 0.0f) {
+        for (uint32_t i = 0; i < length; ++i) {
+            y[i] = NAN;
+        }
+    } else {
+        jsdrv_f32_from_i16(y, adc, cal->offset[range], gain, length);
+    }
+}
+
+void jsdrv_raw_cal_apply(const struct jsdrv_raw_cal_s * cal, float * y, const int16_t * adc,
+        const uint8_t * range, uint32_t range_offset, uint32_t length) {
+    uint8_t r[RANGE_CHUNK];
+    if (NULL == range) {
+        run_apply(cal, y, adc, 0, length);
+        return;
+    }
+    while (length) {
+        uint32_t n = (length > RANGE_CHUNK) ? RANGE_CHUNK : length;
+        jsdrv_u4_unpack(r, range, range_offset, n);
+        uint32_t k0 = 0;
+        for (uint32_t k = 1; k <= n; ++k) {
+            if ((k == n) || (r[k] != r[k0])) {  // end of run
+                run_apply(cal, y + k0, adc + k0, r[k0], k - k0);
+                k0 = k;
+            }
+        }
+        y += n;
+        adc += n;
+        range_offset += n;
+        length -= n;
+    }
+}
@@ -0,0 +1,744 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#include "jsdrv/recorder.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/mpmc_ring.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/statistics.h"
+#include "jsdrv_prv/thread.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#define MAGIC               "jsdrvrec"
+#define VERSION             (1U)
+#define HEADER_SIZE         (64U)
+#define BLOCK_SIZE          (4U * 1024U * 1024U)
+#define BUFFER_SIZE_DEFAULT (64U * 1024U * 1024U)
+#define TOPICS_MAX          (64U)
+#define WRITER_POLL_MS      (10U)
+#define ALIGN8(x)           (((x) + 7U) & ~7U)
+#define INDEX_SIGNALS_MAX   (TOPICS_MAX)
+#define INDEX_ENTRIES       (1024U)      // per index record
+#define SUMMARY_ENTRIES     (256U)       // per summary record
+#define SIDE_SIZE_INIT      (64U * 1024U)
+
+JSDRV_STATIC_ASSERT(16 == sizeof(struct jsdrv_recorder_record_header_s), record_header_size);
+JSDRV_STATIC_ASSERT(16 == sizeof(struct jsdrv_recorder_usb_s), usb_header_size);
+JSDRV_STATIC_ASSERT(16 == sizeof(struct jsdrv_recorder_index_s), index_size);
+JSDRV_STATIC_ASSERT(16 == sizeof(struct jsdrv_recorder_summary_s), summary_size);
+
+struct block_s {
+    uint32_t length;
+    uint32_t rsv_u32;                       // keeps data 8-byte aligned for the records
+    uint8_t data[BLOCK_SIZE];
+};
+
+JSDRV_STATIC_ASSERT(0 == (offsetof(struct block_s, data) & 7), block_data_align);
+
+struct topic_s {
+    struct jsdrv_recorder_s * recorder;
+    uint16_t signal_id;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+};
+
+// A summary level in progress, owned by the writer thread.
+struct summary_level_s {
+    struct jsdrv_statistics_accum_s accum;  // the partial entry
+    uint32_t accum_count;                   // samples (level 1) or lower entries
+    uint64_t sample_id;                     // the first sample_id for entries[0]
+    uint32_t count;
+    struct jsdrv_summary_entry_s entries[SUMMARY_ENTRIES];
+};
+
+// The index and summary state for a signal, owned by the writer thread.
+struct index_signal_s {
+    uint16_t signal_id;
+    uint8_t summary;                        // 1 for float32 signals
+    uint32_t decimate_factor;
+    uint64_t sample_id0;                    // the first sample_id
+    uint64_t next;                          // the next sample index for the summary
+    uint32_t index_count;
+    struct jsdrv_recorder_index_s index[INDEX_ENTRIES];
+    struct summary_level_s levels[JSDRV_RECORDER_SUMMARY_LEVELS];  // levels[0] is level 1
+};
+
+struct jsdrv_recorder_s {
+    struct jsdrv_context_s * context;
+    FILE * f;
+    jsdrv_os_mutex_t mutex;                 // block and counters
+    struct block_s * block;                 // the block being filled
+    struct jsdrv_mpmc_ring_s * free;        // empty blocks
+    struct jsdrv_mpmc_ring_s * full;        // blocks ready to write
+    uint32_t block_count;
+    struct block_s ** blocks;
+    uint64_t messages;
+    uint32_t drops;
+    volatile uint8_t codec;                 // jsdrv_stream_codec_e for data records
+    volatile uint64_t bytes;                // writer thread
+    volatile int32_t error;                 // writer thread
+    volatile uint32_t quit;
+    jsdrv_thread_t thread;
+    uint32_t topic_count;
+    struct topic_s topics[TOPICS_MAX];
+
+    // writer thread only
+    struct block_s * zblock;                // the encoded block for codec
+    uint32_t index_signal_count;
+    struct index_signal_s * index_signals[INDEX_SIGNALS_MAX];
+    uint8_t * side;                         // index and summary records for the next write
+    uint32_t side_length;
+    uint32_t side_size;
+    uint64_t * toc;                         // file offsets for the TOC record
+    uint32_t toc_count;
+    uint32_t toc_size;
+};
+
+
+static void block_write(struct jsdrv_recorder_s * self, struct block_s * b) {
+    if (b->length && !self->error) {
+        if (fwrite(b->data, 1, b->length, self->f) != b->length) {
+            JSDRV_LOGE("recorder: write failed");
+            self->error = JSDRV_ERROR_IO;
+        } else {
+            self->bytes += b->length;
+        }
+    }
+    b->length = 0;
+}
+
+static void toc_add(struct jsdrv_recorder_s * self, uint64_t offset) {
+    if (self->toc_count >= self->toc_size) {
+        uint32_t size = self->toc_size ? (self->toc_size * 2) : 1024;
+        uint64_t * toc = jsdrv_alloc(size * sizeof(uint64_t));
+        if (self->toc) {
+            memcpy(toc, self->toc, self->toc_count * sizeof(uint64_t));
+            jsdrv_free(self->toc);
+        }
+        self->toc = toc;
+        self->toc_size = size;
+    }
+    self->toc[self->toc_count++] = offset;
+}
+
+// Append an index or summary record for the next side_write().
+static void side_append(struct jsdrv_recorder_s * self, uint8_t type, uint16_t id,
+                        const void * prefix, uint32_t prefix_size,
+                        const void * payload, uint32_t size) {
+    struct jsdrv_recorder_record_header_s hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.length = ALIGN8(sizeof(hdr) + prefix_size + size);
+    hdr.type = type;
+    hdr.id = id;
+    hdr.size = prefix_size + size;
+    if ((self->side_length + hdr.length) > self->side_size) {
+        uint32_t side_size = self->side_size ? self->side_size : SIDE_SIZE_INIT;
+        while ((self->side_length + hdr.length) > side_size) {
+            side_size *= 2;
+        }
+        uint8_t * side = jsdrv_alloc(side_size);
+        if (self->side) {
+            memcpy(side, self->side, self->side_length);
+            jsdrv_free(self->side);
+        }
+        self->side = side;
+        self->side_size = side_size;
+    }
+    uint8_t * p = self->side + self->side_length;
+    memcpy(p, &hdr, sizeof(hdr));
+    if (prefix_size) {
+        memcpy(p + sizeof(hdr), prefix, prefix_size);
+    }
+    if (size) {
+        memcpy(p + sizeof(hdr) + prefix_size, payload, size);
+    }
+    memset(p + sizeof(hdr) + hdr.size, 0, hdr.length - sizeof(hdr) - hdr.size);
+    self->side_length += hdr.length;
+}
+
+static void side_write(struct jsdrv_recorder_s * self) {
+    uint32_t offset = 0;
+    while (offset < self->side_length) {
+        struct jsdrv_recorder_record_header_s * hdr = (struct jsdrv_recorder_record_header_s *) (self->side + offset);
+        toc_add(self, self->bytes + offset);
+        offset += hdr->length;
+    }
+    if (self->side_length && !self->error) {
+        if (fwrite(self->side, 1, self->side_length, self->f) != self->side_length) {
+            JSDRV_LOGE("recorder: index write failed");
+            self->error = JSDRV_ERROR_IO;
+        } else {
+            self->bytes += self->side_length;
+        }
+    }
+    self->side_length = 0;
+}
+
+static struct index_signal_s * index_signal_get(struct jsdrv_recorder_s * self, uint16_t signal_id,
+                                                const struct jsdrv_stream_signal_s * s) {
+    for (uint32_t i = 0; i < self->index_signal_count; ++i) {
+        if (self->index_signals[i]->signal_id == signal_id) {
+            return self->index_signals[i];
+        }
+    }
+    if (self->index_signal_count >= INDEX_SIGNALS_MAX) {
+        return NULL;
+    }
+    struct index_signal_s * sig = jsdrv_alloc_clr(sizeof(struct index_signal_s));
+    sig->signal_id = signal_id;
+    sig->summary = ((s->element_type == JSDRV_DATA_TYPE_FLOAT) && (s->element_size_bits == 32))
+        || (NULL != jsdrv_deadband_hold(s));
+    sig->decimate_factor = s->decimate_factor ? s->decimate_factor : 1;
+    sig->sample_id0 = s->sample_id;
+    for (uint32_t k = 0; k < JSDRV_RECORDER_SUMMARY_LEVELS; ++k) {
+        jsdrv_statistics_reset(&sig->levels[k].accum);
+        sig->levels[k].sample_id = sig->sample_id0;
+    }
+    self->index_signals[self->index_signal_count++] = sig;
+    return sig;
+}
+
+static void index_flush(struct jsdrv_recorder_s * self, struct index_signal_s * sig) {
+    if (sig->index_count) {
+        side_append(self, JSDRV_RECORDER_TYPE_INDEX, sig->signal_id, NULL, 0,
+                    sig->index, sig->index_count * sizeof(struct jsdrv_recorder_index_s));
+        sig->index_count = 0;
+    }
+}
+
+static uint64_t samples_per_entry(uint32_t level_idx) {
+    uint64_t k = JSDRV_RECORDER_SUMMARY_R0;
+    for (uint32_t i = 0; i < level_idx; ++i) {
+        k *= JSDRV_RECORDER_SUMMARY_R;
+    }
+    return k;
+}
+
+static void summary_flush(struct jsdrv_recorder_s * self, struct index_signal_s * sig, uint32_t level_idx) {
+    struct summary_level_s * lvl = &sig->levels[level_idx];
+    if (!lvl->count) {
+        return;
+    }
+    struct jsdrv_recorder_summary_s hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.sample_id = lvl->sample_id;
+    hdr.samples_per_entry = (uint32_t) samples_per_entry(level_idx);
+    hdr.level = (uint8_t) (level_idx + 1);
+    side_append(self, JSDRV_RECORDER_TYPE_SUMMARY, sig->signal_id, &hdr, sizeof(hdr),
+                lvl->entries, lvl->count * sizeof(struct jsdrv_summary_entry_s));
+    lvl->sample_id += lvl->count * hdr.samples_per_entry * sig->decimate_factor;
+    lvl->count = 0;
+}
+
+// Complete the partial entry at level_idx and propagate it up the pyramid.
+static void summary_entry_complete(struct jsdrv_recorder_s * self, struct index_signal_s * sig, uint32_t level_idx) {
+    while (level_idx < JSDRV_RECORDER_SUMMARY_LEVELS) {
+        struct summary_level_s * lvl = &sig->levels[level_idx];
+        struct jsdrv_summary_entry_s * e = &lvl->entries[lvl->count++];
+        if (lvl->accum.k) {
+            jsdrv_statistics_to_entry(&lvl->accum, e);
+        } else {
+            e->avg = NAN;
+            e->std = NAN;
+            e->min = NAN;
+            e->max = NAN;
+        }
+        if (lvl->count >= SUMMARY_ENTRIES) {
+            summary_flush(self, sig, level_idx);
+        }
+        ++level_idx;
+        if (level_idx < JSDRV_RECORDER_SUMMARY_LEVELS) {
+            struct summary_level_s * up = &sig->levels[level_idx];
+            jsdrv_statistics_combine(&up->accum, &up->accum, &lvl->accum);
+            jsdrv_statistics_reset(&lvl->accum);
+            lvl->accum_count = 0;
+            if (++up->accum_count < JSDRV_RECORDER_SUMMARY_R) {
+                return;
+            }
+        } else {
+            jsdrv_statistics_reset(&lvl->accum);
+            lvl->accum_count = 0;
+        }
+    }
+}
+
+static void summary_add(struct jsdrv_recorder_s * self, struct index_signal_s * sig,
+                        const struct jsdrv_stream_signal_s * s) {
+    struct jsdrv_statistics_accum_s accum;
+    struct summary_level_s * lvl1 = &sig->levels[0];
+    if (s->sample_id < sig->sample_id0) {
+        return;
+    }
+    uint64_t idx = (s->sample_id - sig->sample_id0) / sig->decimate_factor;
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(s);
+    const float * x = hold ? NULL : (const float *) s->data;
+    uint64_t length = jsdrv_deadband_sample_count(s);
+    if (idx < sig->next) {  // duplicate samples
+        uint64_t skip = sig->next - idx;
+        if (skip >= length) {
+            return;
+        }
+        x = hold ? NULL : (x + skip);
+        length -= skip;
+        idx = sig->next;
+    }
+    while (idx > sig->next) {  // missing samples do not contribute
+        uint64_t k = JSDRV_RECORDER_SUMMARY_R0 - lvl1->accum_count;
+        if ((sig->next + k) > idx) {
+            k = idx - sig->next;
+        }
+        sig->next += k;
+        lvl1->accum_count += (uint32_t) k;
+        if (lvl1->accum_count >= JSDRV_RECORDER_SUMMARY_R0) {
+            summary_entry_complete(self, sig, 0);
+        }
+    }
+    while (length) {
+        uint64_t k = JSDRV_RECORDER_SUMMARY_R0 - lvl1->accum_count;
+        if (k > length) {
+            k = length;
+        }
+        if (hold) {  // constant run
+            accum.k = k;
+            accum.mean = hold->mean;
+            accum.s = 0.0;
+            accum.min = hold->min;
+            accum.max = hold->max;
+        } else {
+            jsdrv_statistics_compute_f32_skip_nan(&accum, x, k);
+            x += k;
+        }
+        jsdrv_statistics_combine(&lvl1->accum, &lvl1->accum, &accum);
+        length -= k;
+        sig->next += k;
+        lvl1->accum_count += (uint32_t) k;
+        if (lvl1->accum_count >= JSDRV_RECORDER_SUMMARY_R0) {
+            summary_entry_complete(self, sig, 0);
+        }
+    }
+}
+
+// Index a data record at offset in the file.
+static void index_add(struct jsdrv_recorder_s * self, uint16_t signal_id, uint64_t offset,
+                      const uint8_t * payload, uint32_t size) {
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) payload;
+    if (size < JSDRV_STREAM_HEADER_SIZE) {
+        return;
+    }
+    struct index_signal_s * sig = index_signal_get(self, signal_id, s);
+    if (!sig) {
+        return;
+    }
+    struct jsdrv_recorder_index_s * e = &sig->index[sig->index_count++];
+    e->sample_id = s->sample_id;
+    e->offset = offset;
+    if (sig->index_count >= INDEX_ENTRIES) {
+        index_flush(self, sig);
+    }
+    uint64_t data_size = ((uint64_t) s->element_count * s->element_size_bits) / 8;
+    if (sig->summary && ((JSDRV_STREAM_HEADER_SIZE + data_size) <= size)) {
+        summary_add(self, sig, s);
+    }
+}
+
+// Append a record to dst, encoding data records when smaller.  Return the record offset in dst.
+static uint32_t record_encode(struct block_s * dst, const struct jsdrv_recorder_record_header_s * hdr, uint8_t codec) {
+    uint32_t offset = dst->length;
+    struct jsdrv_recorder_record_header_s * z = (struct jsdrv_recorder_record_header_s *) (dst->data + offset);
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) (hdr + 1);
+    uint32_t sz = 0;
+    if ((hdr->type == JSDRV_RECORDER_TYPE_DATA) && (hdr->size >= JSDRV_STREAM_HEADER_SIZE)
+            && (s->element_count <= (JSDRV_STREAM_DATA_SIZE / sizeof(float)))
+            && ((JSDRV_STREAM_HEADER_SIZE + s->element_count * sizeof(float)) <= hdr->size)) {
+        sz = jsdrv_stream_codec_encode(codec, z + 1, BLOCK_SIZE - offset - sizeof(*z), s);
+    }
+    if (sz) {
+        *z = *hdr;
+        z->codec = codec;
+        z->size = sz;
+        z->length = ALIGN8(sizeof(*z) + sz);
+        memset((uint8_t *) (z + 1) + sz, 0, z->length - sizeof(*z) - sz);
+        dst->length += z->length;
+    } else {
+        memcpy(z, hdr, hdr->length);
+        dst->length += hdr->length;
+    }
+    return offset;
+}
+
+/*
+ * Write a block followed by its index and summary records.
+ * The writer thread scans the block, so the frontend thread only copies.
+ * With a codec, the writer thread also encodes the data records into
+ * zblock, which is never larger than the original block.
+ */
+static void block_process(struct jsdrv_recorder_s * self, struct block_s * b) {
+    uint64_t base = self->bytes;
+    uint8_t codec = self->codec;
+    struct block_s * out = b;
+    if (codec) {
+        if (!self->zblock) {
+            self->zblock = jsdrv_alloc(sizeof(struct block_s));
+        }
+        out = self->zblock;
+        out->length = 0;
+    }
+    uint32_t offset = 0;
+    while (offset < b->length) {
+        struct jsdrv_recorder_record_header_s * hdr = (struct jsdrv_recorder_record_header_s *) (b->data + offset);
+        uint32_t out_offset = (out == b) ? offset : record_encode(out, hdr, codec);
+        if (hdr->type == JSDRV_RECORDER_TYPE_SIGNAL) {
+            toc_add(self, base + out_offset);
+        } else if (hdr->type == JSDRV_RECORDER_TYPE_DATA) {
+            index_add(self, hdr->id, base + out_offset, (const uint8_t *) (hdr + 1), hdr->size);
+        }
+        offset += hdr->length;
+    }
+    block_write(self, out);
+    b->length = 0;
+    for (uint32_t i = 0; i < self->index_signal_count; ++i) {
+        index_flush(self, self->index_signals[i]);
+    }
+    side_write(self);
+}
+
+// Write the remaining summaries, the TOC, and the END record.
+static void index_finalize(struct jsdrv_recorder_s * self) {
+    for (uint32_t i = 0; i < self->index_signal_count; ++i) {
+        struct index_signal_s * sig = self->index_signals[i];
+        index_flush(self, sig);
+        for (uint32_t k = 0; k < JSDRV_RECORDER_SUMMARY_LEVELS; ++k) {
+            summary_flush(self, sig, k);  // complete entries only
+        }
+    }
+    side_write(self);
+    uint64_t toc_offset = self->bytes;
+    side_append(self, JSDRV_RECORDER_TYPE_TOC, 0, NULL, 0, self->toc, self->toc_count * sizeof(uint64_t));
+    side_append(self, JSDRV_RECORDER_TYPE_END, 0, NULL, 0, &toc_offset, sizeof(toc_offset));
+    if (!self->error && (fwrite(self->side, 1, self->side_length, self->f) != self->side_length)) {
+        self->error = JSDRV_ERROR_IO;
+    } else {
+        self->bytes += self->side_length;
+    }
+    self->side_length = 0;
+}
+
+static THREAD_RETURN_TYPE writer_thread(THREAD_ARG_TYPE arg) {
+    struct jsdrv_recorder_s * self = (struct jsdrv_recorder_s *) arg;
+    jsdrv_thread_name_set("jsdrv_recorder");
+    while (1) {
+        struct block_s * b = jsdrv_mpmc_ring_pop(self->full);
+        if (b) {
+            block_process(self, b);
+            jsdrv_mpmc_ring_push(self->free, b);
+        } else if (self->quit) {
+            break;
+        } else {
+            jsdrv_thread_sleep_ms(WRITER_POLL_MS);
+        }
+    }
+    index_finalize(self);
+    THREAD_RETURN();
+}
+
+// Call with the mutex held.  The record payload is prefix followed by payload.
+static int32_t append2(struct jsdrv_recorder_s * self, uint8_t type, uint16_t id,
+                       const void * prefix, uint32_t prefix_size,
+                       const void * payload, uint32_t size) {
+    struct jsdrv_recorder_record_header_s hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    size += prefix_size;
+    hdr.length = ALIGN8(sizeof(hdr) + size);
+    hdr.type = type;
+    hdr.id = id;
+    hdr.size = size;
+    if (hdr.length > BLOCK_SIZE) {
+        return JSDRV_ERROR_TOO_BIG;
+    }
+    if (self->block && ((self->block->length + hdr.length) > BLOCK_SIZE)) {
+        jsdrv_mpmc_ring_push(self->full, self->block);  // always fits, one slot per block
+        self->block = NULL;
+    }
+    if (!self->block) {
+        self->block = jsdrv_mpmc_ring_pop(self->free);
+        if (!self->block) {
+            return JSDRV_ERROR_FULL;
+        }
+    }
+    uint8_t * p = self->block->data + self->block->length;
+    memcpy(p, &hdr, sizeof(hdr));
+    if (prefix_size) {
+        memcpy(p + sizeof(hdr), prefix, prefix_size);
+    }
+    memcpy(p + sizeof(hdr) + prefix_size, payload, size - prefix_size);
+    memset(p + sizeof(hdr) + size, 0, hdr.length - sizeof(hdr) - size);
+    self->block->length += hdr.length;
+    return 0;
+}
+
+// Call with the mutex held.
+static int32_t append(struct jsdrv_recorder_s * self, uint8_t type, uint16_t id,
+                      const void * payload, uint32_t size) {
+    return append2(self, type, id, NULL, 0, payload, size);
+}
+
+static int32_t stream_append(struct jsdrv_recorder_s * self, uint16_t signal_id, const void * data, uint32_t size) {
+    jsdrv_os_mutex_lock(self->mutex);
+    int32_t rc = append(self, JSDRV_RECORDER_TYPE_DATA, signal_id, data, size);
+    if (rc) {
+        if (0 == self->drops++) {
+            JSDRV_LOGW("recorder: buffer full, dropping data");
+        }
+    } else {
+        ++self->messages;
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    return rc;
+}
+
+static void on_data(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) topic;
+    struct topic_s * t = (struct topic_s *) user_data;
+    if ((value->type != JSDRV_UNION_BIN) || (value->app != JSDRV_PAYLOAD_TYPE_STREAM)
+            || (value->size < JSDRV_STREAM_HEADER_SIZE)) {
+        return;
+    }
+    stream_append(t->recorder, t->signal_id, value->value.bin, value->size);
+}
+
+static void recorder_free(struct jsdrv_recorder_s * self) {
+    if (self->f) {
+        fclose(self->f);
+    }
+    if (self->blocks) {
+        for (uint32_t i = 0; i < self->block_count; ++i) {
+            jsdrv_free(self->blocks[i]);
+        }
+        jsdrv_free(self->blocks);
+    }
+    while (self->free && jsdrv_mpmc_ring_pop(self->free)) {}
+    while (self->full && jsdrv_mpmc_ring_pop(self->full)) {}
+    for (uint32_t i = 0; i < self->index_signal_count; ++i) {
+        jsdrv_free(self->index_signals[i]);
+    }
+    if (self->side) {
+        jsdrv_free(self->side);
+    }
+    if (self->toc) {
+        jsdrv_free(self->toc);
+    }
+    if (self->zblock) {
+        jsdrv_free(self->zblock);
+    }
+    jsdrv_mpmc_ring_free(self->free);
+    jsdrv_mpmc_ring_free(self->full);
+    if (self->mutex) {
+        jsdrv_os_mutex_free(self->mutex);
+    }
+    jsdrv_free(self);
+}
+
+int32_t jsdrv_recorder_open(struct jsdrv_context_s * context, const char * path,
+                            uint32_t buffer_size, struct jsdrv_recorder_s ** recorder) {
+    if (!path || !recorder) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    *recorder = NULL;
+    buffer_size = buffer_size ? buffer_size : BUFFER_SIZE_DEFAULT;
+    uint32_t block_count = (buffer_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (block_count < 2) {
+        block_count = 2;
+    }
+    uint32_t capacity = 2;
+    while (capacity < block_count) {
+        capacity <<= 1;
+    }
+
+    struct jsdrv_recorder_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_recorder_s));
+    self->context = context;
+    self->mutex = jsdrv_os_mutex_alloc("recorder");
+    self->free = jsdrv_mpmc_ring_alloc(capacity);
+    self->full = jsdrv_mpmc_ring_alloc(capacity);
+    self->blocks = jsdrv_alloc_clr(block_count * sizeof(struct block_s *));
+    self->block_count = block_count;
+    for (uint32_t i = 0; i < block_count; ++i) {
+        self->blocks[i] = jsdrv_alloc(sizeof(struct block_s));
+        self->blocks[i]->length = 0;
+        jsdrv_mpmc_ring_push(self->free, self->blocks[i]);
+    }
+
+    self->f = fopen(path, "wb");
+    if (!self->f) {
+        JSDRV_LOGE("recorder: could not open %s", path);
+        recorder_free(self);
+        return JSDRV_ERROR_IO;
+    }
+    setvbuf(self->f, NULL, _IONBF, 0);  // blocks are already large
+    uint8_t hdr[HEADER_SIZE];
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, MAGIC, 8);
+    uint32_t u32 = VERSION;
+    memcpy(hdr + 8, &u32, sizeof(u32));
+    u32 = HEADER_SIZE;
+    memcpy(hdr + 12, &u32, sizeof(u32));
+    if (fwrite(hdr, 1, sizeof(hdr), self->f) != sizeof(hdr)) {
+        recorder_free(self);
+        return JSDRV_ERROR_IO;
+    }
+    self->bytes = sizeof(hdr);
+    if (jsdrv_thread_create(&self->thread, writer_thread, self, 0)) {
+        recorder_free(self);
+        return JSDRV_ERROR_UNSPECIFIED;
+    }
+    *recorder = self;
+    return 0;
+}
+
+int32_t jsdrv_recorder_add(struct jsdrv_recorder_s * self, uint16_t signal_id, const char * topic) {
+    if (!self || !self->context || !signal_id || !topic) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (self->topic_count >= TOPICS_MAX) {
+        return JSDRV_ERROR_FULL;
+    }
+    struct topic_s * t = &self->topics[self->topic_count];
+    t->recorder = self;
+    t->signal_id = signal_id;
+    if (jsdrv_cstr_copy(t->topic, topic, sizeof(t->topic))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrv_os_mutex_lock(self->mutex);
+    int32_t rc = append(self, JSDRV_RECORDER_TYPE_SIGNAL, signal_id, t->topic, (uint32_t) strlen(t->topic) + 1);
+    jsdrv_os_mutex_unlock(self->mutex);
+    if (rc) {
+        return rc;
+    }
+    rc = jsdrv_subscribe(self->context, t->topic, JSDRV_SFLAG_PUB, on_data, t, JSDRV_TIMEOUT_MS_DEFAULT);
+    if (!rc) {
+        ++self->topic_count;
+    }
+    return rc;
+}
+
+int32_t jsdrv_recorder_user_data(struct jsdrv_recorder_s * self, uint16_t chunk_meta,
+                                 const void * data, uint32_t size) {
+    if (!self || (!data && size)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrv_os_mutex_lock(self->mutex);
+    int32_t rc = append(self, JSDRV_RECORDER_TYPE_USER_DATA, chunk_meta, data, size);
+    jsdrv_os_mutex_unlock(self->mutex);
+    return rc;
+}
+
+int32_t jsdrv_recorder_usb_device(struct jsdrv_recorder_s * self, uint16_t device_id, const char * prefix) {
+    if (!self || !device_id || !prefix) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrv_os_mutex_lock(self->mutex);
+    int32_t rc = append(self, JSDRV_RECORDER_TYPE_USB_DEVICE, device_id, prefix, (uint32_t) strlen(prefix) + 1);
+    jsdrv_os_mutex_unlock(self->mutex);
+    return rc;
+}
+
+int32_t jsdrv_recorder_usb_bulk_in(struct jsdrv_recorder_s * self, uint16_t device_id, uint8_t endpoint,
+                                   int64_t time, const void * data, uint32_t size) {
+    if (!self || !device_id || (!data && size)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct jsdrv_recorder_usb_s usb;
+    memset(&usb, 0, sizeof(usb));
+    usb.time = time;
+    usb.endpoint = endpoint;
+    jsdrv_os_mutex_lock(self->mutex);
+    int32_t rc = append2(self, JSDRV_RECORDER_TYPE_USB_BULK_IN, device_id, &usb, sizeof(usb), data, size);
+    if (rc) {
+        if (0 == self->drops++) {
+            JSDRV_LOGW("recorder: buffer full, dropping data");
+        }
+    } else {
+        ++self->messages;
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    return rc;
+}
+
+int32_t jsdrv_recorder_stream(struct jsdrv_recorder_s * self, uint16_t signal_id, const void * data, uint32_t size) {
+    if (!self || !signal_id || !data || (size < JSDRV_STREAM_HEADER_SIZE)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return stream_append(self, signal_id, data, size);
+}
+
+int32_t jsdrv_recorder_codec(struct jsdrv_recorder_s * self, uint8_t codec) {
+    if (!self) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (codec > JSDRV_STREAM_CODEC_F32) {
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    self->codec = codec;
+    return 0;
+}
+
+void jsdrv_recorder_status(struct jsdrv_recorder_s * self, struct jsdrv_recorder_status_s * status) {
+    memset(status, 0, sizeof(*status));
+    if (!self) {
+        return;
+    }
+    jsdrv_os_mutex_lock(self->mutex);
+    status->messages = self->messages;
+    status->drops = self->drops;
+    jsdrv_os_mutex_unlock(self->mutex);
+    status->bytes = self->bytes;
+    status->error = self->error;
+}
+
+int32_t jsdrv_recorder_close(struct jsdrv_recorder_s * self) {
+    if (!self) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    for (uint32_t i = 0; i < self->topic_count; ++i) {
+        struct topic_s * t = &self->topics[i];
+        jsdrv_unsubscribe(self->context, t->topic, on_data, t, JSDRV_TIMEOUT_MS_DEFAULT);
+    }
+    jsdrv_os_mutex_lock(self->mutex);
+    if (self->block) {
+        jsdrv_mpmc_ring_push(self->full, self->block);
+        self->block = NULL;
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    self->quit = 1;
+    jsdrv_thread_join(&self->thread, 60000);
+    int32_t rc = self->error;
+    if (fclose(self->f) && !rc) {
+        rc = JSDRV_ERROR_IO;
+    }
+    self->f = NULL;
+    JSDRV_LOGI("recorder: closed, %llu messages, %u drops",
+               (unsigned long long) self->messages, (unsigned int) self->drops);
+    recorder_free(self);
+    return rc;
+}
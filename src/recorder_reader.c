@@ -0,0 +1,604 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#include "jsdrv/recorder.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/file_map.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/statistics.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define MAGIC               "jsdrvrec"
+#define VERSION             (1U)
+#define HEADER_SIZE         (64U)
+#define SIGNALS_MAX         (64U)
+#define END_SIZE            (24U)
+#define RAW_CHUNK           (4096U)
+
+struct summary_record_s {
+    uint64_t sample_id;
+    uint64_t entry;         // the level entry index for entries[0]
+    uint32_t count;
+    const struct jsdrv_summary_entry_s * entries;
+};
+
+struct summary_level_s {
+    uint64_t samples_per_entry;
+    uint64_t entries;       // the number of contiguous entries from entry 0
+    uint32_t record_count;
+    uint32_t record_size;
+    struct summary_record_s * records;
+};
+
+struct signal_s {
+    struct jsdrv_recorder_signal_info_s info;
+    uint32_t index_count;
+    uint32_t index_size;
+    struct jsdrv_recorder_index_s * index;
+    struct summary_level_s levels[JSDRV_RECORDER_SUMMARY_LEVELS];
+};
+
+struct jsdrv_recorder_reader_s {
+    struct jsdrv_file_map_s * map;
+    const uint8_t * ptr;
+    uint64_t size;
+    uint32_t signal_count;
+    struct signal_s * signals[SIGNALS_MAX];
+    struct jsdrv_stream_signal_s * decoded;  // the last decoded data record
+};
+
+
+static void * grow(void * ptr, uint32_t count, uint32_t * size, uint32_t element_size) {
+    if (count < *size) {
+        return ptr;
+    }
+    uint32_t sz = *size ? (*size * 2) : 256;
+    void * p = jsdrv_alloc(sz * (size_t) element_size);
+    if (ptr) {
+        memcpy(p, ptr, count * (size_t) element_size);
+        jsdrv_free(ptr);
+    }
+    *size = sz;
+    return p;
+}
+
+static const struct jsdrv_recorder_record_header_s * record_at(struct jsdrv_recorder_reader_s * self, uint64_t offset) {
+    if (((offset + sizeof(struct jsdrv_recorder_record_header_s)) > self->size) || (offset & 7)) {
+        return NULL;
+    }
+    const struct jsdrv_recorder_record_header_s * hdr = (const struct jsdrv_recorder_record_header_s *) (self->ptr + offset);
+    if ((hdr->length < (sizeof(*hdr) + hdr->size)) || (hdr->length & 7) || ((offset + hdr->length) > self->size)) {
+        return NULL;
+    }
+    return hdr;
+}
+
+static struct signal_s * signal_get(struct jsdrv_recorder_reader_s * self, uint16_t signal_id, bool create) {
+    for (uint32_t i = 0; i < self->signal_count; ++i) {
+        if (self->signals[i]->info.signal_id == signal_id) {
+            return self->signals[i];
+        }
+    }
+    if (!create || (self->signal_count >= SIGNALS_MAX)) {
+        return NULL;
+    }
+    struct signal_s * s = jsdrv_alloc_clr(sizeof(struct signal_s));
+    s->info.signal_id = signal_id;
+    self->signals[self->signal_count++] = s;
+    return s;
+}
+
+static void index_add(struct signal_s * s, uint64_t sample_id, uint64_t offset) {
+    s->index = grow(s->index, s->index_count, &s->index_size, sizeof(struct jsdrv_recorder_index_s));
+    s->index[s->index_count].sample_id = sample_id;
+    s->index[s->index_count].offset = offset;
+    ++s->index_count;
+}
+
+static void on_record(struct jsdrv_recorder_reader_s * self, const struct jsdrv_recorder_record_header_s * hdr,
+                      uint64_t offset, bool scan) {
+    const uint8_t * payload = (const uint8_t *) (hdr + 1);
+    struct signal_s * s;
+    switch (hdr->type) {
+        case JSDRV_RECORDER_TYPE_SIGNAL:
+            s = signal_get(self, hdr->id, true);
+            if (s && hdr->size) {
+                size_t sz = (hdr->size < sizeof(s->info.topic)) ? hdr->size : sizeof(s->info.topic);
+                jsdrv_cstr_copy(s->info.topic, (const char *) payload, sz);
+            }
+            break;
+        case JSDRV_RECORDER_TYPE_DATA:
+            if (scan && (hdr->size >= JSDRV_STREAM_HEADER_SIZE)) {
+                s = signal_get(self, hdr->id, true);
+                if (s) {
+                    index_add(s, ((const struct jsdrv_stream_signal_s *) payload)->sample_id, offset);
+                }
+            }
+            break;
+        case JSDRV_RECORDER_TYPE_INDEX:
+            if (!scan) {  // the scan indexes the data records directly
+                s = signal_get(self, hdr->id, true);
+                const struct jsdrv_recorder_index_s * e = (const struct jsdrv_recorder_index_s *) payload;
+                for (uint32_t i = 0; s && (i < (hdr->size / sizeof(*e))); ++i) {
+                    index_add(s, e[i].sample_id, e[i].offset);
+                }
+            }
+            break;
+        case JSDRV_RECORDER_TYPE_SUMMARY: {
+            const struct jsdrv_recorder_summary_s * h = (const struct jsdrv_recorder_summary_s *) payload;
+            s = signal_get(self, hdr->id, true);
+            if (!s || (hdr->size < sizeof(*h)) || (h->level < 1) || (h->level > JSDRV_RECORDER_SUMMARY_LEVELS)
+                    || !h->samples_per_entry) {
+                break;
+            }
+            struct summary_level_s * lvl = &s->levels[h->level - 1];
+            if (lvl->samples_per_entry && (lvl->samples_per_entry != h->samples_per_entry)) {
+                break;
+            }
+            lvl->samples_per_entry = h->samples_per_entry;
+            lvl->records = grow(lvl->records, lvl->record_count, &lvl->record_size, sizeof(struct summary_record_s));
+            struct summary_record_s * r = &lvl->records[lvl->record_count++];
+            r->sample_id = h->sample_id;
+            r->entry = 0;
+            r->count = (hdr->size - sizeof(*h)) / sizeof(struct jsdrv_summary_entry_s);
+            r->entries = (const struct jsdrv_summary_entry_s *) (h + 1);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static bool toc_load(struct jsdrv_recorder_reader_s * self) {
+    if (self->size < (HEADER_SIZE + END_SIZE)) {
+        return false;
+    }
+    const struct jsdrv_recorder_record_header_s * hdr = record_at(self, self->size - END_SIZE);
+    if (!hdr || (hdr->type != JSDRV_RECORDER_TYPE_END) || (hdr->size != sizeof(uint64_t))) {
+        return false;
+    }
+    uint64_t toc_offset;
+    memcpy(&toc_offset, hdr + 1, sizeof(toc_offset));
+    hdr = record_at(self, toc_offset);
+    if (!hdr || (hdr->type != JSDRV_RECORDER_TYPE_TOC)) {
+        return false;
+    }
+    const uint64_t * toc = (const uint64_t *) (hdr + 1);
+    uint32_t toc_count = hdr->size / sizeof(uint64_t);
+    for (uint32_t i = 0; i < toc_count; ++i) {
+        const struct jsdrv_recorder_record_header_s * r = record_at(self, toc[i]);
+        if (r) {
+            on_record(self, r, toc[i], false);
+        }
+    }
+    return true;
+}
+
+static void scan(struct jsdrv_recorder_reader_s * self) {
+    JSDRV_LOGI("recorder_reader: no table of contents, scanning records");
+    uint64_t offset = HEADER_SIZE;
+    const struct jsdrv_recorder_record_header_s * hdr;
+    while (NULL != (hdr = record_at(self, offset))) {
+        on_record(self, hdr, offset, true);
+        offset += hdr->length;
+    }
+}
+
+/*
+ * Get the data record at offset.  With decode, the data is valid and
+ * encoded records decode into self->decoded until the next call.
+ * Without decode, only the header is valid.
+ */
+static const struct jsdrv_stream_signal_s * data_at(struct jsdrv_recorder_reader_s * self, uint64_t offset,
+                                                    bool decode) {
+    const struct jsdrv_recorder_record_header_s * hdr = record_at(self, offset);
+    if (!hdr || (hdr->type != JSDRV_RECORDER_TYPE_DATA) || (hdr->size < JSDRV_STREAM_HEADER_SIZE)) {
+        return NULL;
+    }
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) (hdr + 1);
+    if (hdr->codec) {
+        if (!decode) {
+            return s;
+        }
+        if (!self->decoded) {
+            self->decoded = jsdrv_alloc(sizeof(struct jsdrv_stream_signal_s));
+        }
+        if (jsdrv_stream_codec_decode(hdr->codec, self->decoded, sizeof(struct jsdrv_stream_signal_s),
+                                      s, hdr->size)) {
+            return NULL;
+        }
+        return self->decoded;
+    }
+    if ((JSDRV_STREAM_HEADER_SIZE + ((uint64_t) s->element_count * s->element_size_bits + 7) / 8) > hdr->size) {
+        return NULL;
+    }
+    return s;
+}
+
+static int summary_record_compare(const void * a, const void * b) {
+    const struct summary_record_s * ra = (const struct summary_record_s *) a;
+    const struct summary_record_s * rb = (const struct summary_record_s *) b;
+    return (ra->entry < rb->entry) ? -1 : ((ra->entry > rb->entry) ? 1 : 0);
+}
+
+static bool signal_finalize(struct jsdrv_recorder_reader_s * self, struct signal_s * s) {
+    struct jsdrv_recorder_signal_info_s * info = &s->info;
+    if (!s->index_count) {
+        return false;
+    }
+    const struct jsdrv_stream_signal_s * first = data_at(self, s->index[0].offset, false);
+    const struct jsdrv_stream_signal_s * last = data_at(self, s->index[s->index_count - 1].offset, false);
+    if (!first || !last) {
+        return false;
+    }
+    if (jsdrv_deadband_hold(first)) {  // hold records expand to float32 samples
+        info->element_type = JSDRV_DATA_TYPE_FLOAT;
+        info->element_size_bits = 32;
+    } else {
+        info->element_type = first->element_type;
+        info->element_size_bits = first->element_size_bits;
+    }
+    info->sample_rate = first->sample_rate;
+    info->decimate_factor = first->decimate_factor ? first->decimate_factor : 1;
+    info->sample_id_start = first->sample_id;
+    info->sample_id_end = last->sample_id + jsdrv_deadband_sample_count(last) * info->decimate_factor;
+    info->time_map = first->time_map;
+    info->summary_levels = 0;
+
+    for (uint32_t k = 0; k < JSDRV_RECORDER_SUMMARY_LEVELS; ++k) {
+        struct summary_level_s * lvl = &s->levels[k];
+        for (uint32_t i = 0; i < lvl->record_count; ++i) {
+            struct summary_record_s * r = &lvl->records[i];
+            uint64_t idx = (r->sample_id - info->sample_id_start) / info->decimate_factor;
+            r->entry = idx / lvl->samples_per_entry;
+        }
+        qsort(lvl->records, lvl->record_count, sizeof(struct summary_record_s), summary_record_compare);
+        lvl->entries = 0;
+        for (uint32_t i = 0; (i < lvl->record_count) && (lvl->records[i].entry == lvl->entries); ++i) {
+            lvl->entries += lvl->records[i].count;
+        }
+        if (lvl->entries && (info->summary_levels == k)) {
+            info->summary_levels = (uint8_t) (k + 1);
+        }
+    }
+    return true;
+}
+
+static void signal_free(struct signal_s * s) {
+    for (uint32_t k = 0; k < JSDRV_RECORDER_SUMMARY_LEVELS; ++k) {
+        if (s->levels[k].records) {
+            jsdrv_free(s->levels[k].records);
+        }
+    }
+    if (s->index) {
+        jsdrv_free(s->index);
+    }
+    jsdrv_free(s);
+}
+
+int32_t jsdrv_recorder_reader_open(const char * path, struct jsdrv_recorder_reader_s ** reader) {
+    void * ptr = NULL;
+    if (!path || !reader) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    *reader = NULL;
+    struct jsdrv_recorder_reader_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_recorder_reader_s));
+    int32_t rc = jsdrv_file_map_open_existing(path, &self->map, &ptr, &self->size);
+    if (rc) {
+        jsdrv_free(self);
+        return rc;
+    }
+    self->ptr = (const uint8_t *) ptr;
+    uint32_t version = 0;
+    uint32_t header_size = 0;
+    if (self->size >= HEADER_SIZE) {
+        memcpy(&version, self->ptr + 8, sizeof(version));
+        memcpy(&header_size, self->ptr + 12, sizeof(header_size));
+    }
+    if ((self->size < HEADER_SIZE) || memcmp(self->ptr, MAGIC, 8) || (version != VERSION)
+            || (header_size != HEADER_SIZE)) {
+        JSDRV_LOGW("recorder_reader: invalid file %s", path);
+        jsdrv_recorder_reader_close(self);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (!toc_load(self)) {
+        scan(self);
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < self->signal_count; ++i) {
+        struct signal_s * s = self->signals[i];
+        if (signal_finalize(self, s)) {
+            self->signals[count++] = s;
+        } else {
+            signal_free(s);
+        }
+    }
+    self->signal_count = count;
+    *reader = self;
+    return 0;
+}
+
+void jsdrv_recorder_reader_close(struct jsdrv_recorder_reader_s * self) {
+    if (!self) {
+        return;
+    }
+    for (uint32_t i = 0; i < self->signal_count; ++i) {
+        signal_free(self->signals[i]);
+    }
+    if (self->decoded) {
+        jsdrv_free(self->decoded);
+    }
+    jsdrv_file_map_close(self->map);
+    jsdrv_free(self);
+}
+
+uint32_t jsdrv_recorder_reader_signals(struct jsdrv_recorder_reader_s * self, uint16_t * signal_ids, uint32_t length) {
+    if (!self) {
+        return 0;
+    }
+    for (uint32_t i = 0; signal_ids && (i < length) && (i < self->signal_count); ++i) {
+        signal_ids[i] = self->signals[i]->info.signal_id;
+    }
+    return self->signal_count;
+}
+
+int32_t jsdrv_recorder_reader_info(struct jsdrv_recorder_reader_s * self, uint16_t signal_id,
+                                   struct jsdrv_recorder_signal_info_s * info) {
+    struct signal_s * s = self ? signal_get(self, signal_id, false) : NULL;
+    if (!s || !info) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    *info = s->info;
+    return 0;
+}
+
+static inline uint64_t sample_idx(struct signal_s * s, uint64_t sample_id) {
+    return (sample_id - s->info.sample_id_start) / s->info.decimate_factor;
+}
+
+static uint64_t sample_count(struct signal_s * s) {
+    return sample_idx(s, s->info.sample_id_end);
+}
+
+// Find the last data record that starts at or before sample idx.
+static uint32_t index_find(struct signal_s * s, uint64_t idx) {
+    uint32_t lo = 0;
+    uint32_t hi = s->index_count;
+    while ((hi - lo) > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if ((s->index[mid].sample_id < s->info.sample_id_start) || (sample_idx(s, s->index[mid].sample_id) <= idx)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void bits_copy(uint8_t * dst, uint64_t dst_bit, const uint8_t * src, uint64_t src_bit, uint64_t bits) {
+    if (((dst_bit | src_bit | bits) & 7) == 0) {
+        memcpy(dst + dst_bit / 8, src + src_bit / 8, bits / 8);
+        return;
+    }
+    for (uint64_t i = 0; i < bits; ++i) {
+        uint64_t s = src_bit + i;
+        uint64_t d = dst_bit + i;
+        uint8_t v = (src[s >> 3] >> (s & 7)) & 1;
+        dst[d >> 3] = (uint8_t) ((dst[d >> 3] & ~(1U << (d & 7))) | (v << (d & 7)));
+    }
+}
+
+// Read samples [idx, idx + length) in element indices.
+static void samples_read(struct jsdrv_recorder_reader_s * self, struct signal_s * s,
+                         uint64_t idx, uint64_t length, uint8_t * dst) {
+    uint64_t bits = s->info.element_size_bits;
+    bool is_f32 = (s->info.element_type == JSDRV_DATA_TYPE_FLOAT) && (bits == 32);
+    if (is_f32) {
+        float * f = (float *) dst;
+        for (uint64_t i = 0; i < length; ++i) {
+            f[i] = NAN;
+        }
+    } else {
+        memset(dst, 0, (length * bits + 7) / 8);
+    }
+    uint64_t idx_end = idx + length;
+    for (uint32_t i = index_find(s, idx); i < s->index_count; ++i) {
+        const struct jsdrv_stream_signal_s * d = data_at(self, s->index[i].offset, true);
+        if (!d || (d->sample_id < s->info.sample_id_start)) {
+            continue;
+        }
+        const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(d);
+        if (hold ? !is_f32 : (d->element_size_bits != bits)) {
+            continue;
+        }
+        uint64_t r0 = sample_idx(s, d->sample_id);
+        uint64_t r1 = r0 + jsdrv_deadband_sample_count(d);
+        if (r0 >= idx_end) {
+            break;
+        }
+        uint64_t k0 = (r0 > idx) ? r0 : idx;
+        uint64_t k1 = (r1 < idx_end) ? r1 : idx_end;
+        if (hold) {
+            float * f = (float *) dst;
+            for (uint64_t k = k0; k < k1; ++k) {
+                f[k - idx] = hold->mean;
+            }
+        } else if (k0 < k1) {
+            bits_copy(dst, (k0 - idx) * bits, d->data, (k0 - r0) * bits, (k1 - k0) * bits);
+        }
+    }
+}
+
+int32_t jsdrv_recorder_reader_samples(struct jsdrv_recorder_reader_s * self, uint16_t signal_id,
+                                      uint64_t sample_id, uint32_t length, void * data) {
+    struct signal_s * s = self ? signal_get(self, signal_id, false) : NULL;
+    if (!s) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    if (!data || (sample_id < s->info.sample_id_start)
+            || ((sample_idx(s, sample_id) + length) > sample_count(s))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    samples_read(self, s, sample_idx(s, sample_id), length, (uint8_t *) data);
+    return 0;
+}
+
+int32_t jsdrv_recorder_reader_raw_cal(struct jsdrv_recorder_reader_s * self,
+        uint16_t adc_signal_id, uint16_t range_signal_id, const struct jsdrv_raw_cal_s * cal,
+        uint64_t sample_id, uint32_t length, float * data) {
+    int16_t x[RAW_CHUNK];
+    uint8_t u4[RAW_CHUNK / 2];
+    struct signal_s * a = self ? signal_get(self, adc_signal_id, false) : NULL;
+    struct signal_s * r = (self && range_signal_id) ? signal_get(self, range_signal_id, false) : NULL;
+    if (!a || (range_signal_id && !r)) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    if (!cal || !data || (a->info.element_type != JSDRV_DATA_TYPE_INT) || (a->info.element_size_bits != 16)
+            || (sample_id < a->info.sample_id_start)
+            || ((sample_idx(a, sample_id) + length) > sample_count(a))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (r && ((r->info.element_size_bits != 4) || (r->info.decimate_factor != a->info.decimate_factor)
+            || (sample_id < r->info.sample_id_start)
+            || ((sample_idx(r, sample_id) + length) > sample_count(r)))) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint64_t idx = sample_idx(a, sample_id);
+    uint64_t r_idx = r ? sample_idx(r, sample_id) : 0;
+    while (length) {
+        uint32_t k = (length > RAW_CHUNK) ? RAW_CHUNK : length;
+        samples_read(self, a, idx, k, (uint8_t *) x);
+        if (r) {
+            samples_read(self, r, r_idx, k, u4);
+        }
+        jsdrv_raw_cal_apply(cal, data, x, r ? u4 : NULL, 0, k);
+        idx += k;
+        r_idx += k;
+        data += k;
+        length -= k;
+    }
+    return 0;
+}
+
+static const struct jsdrv_summary_entry_s * summary_entry(struct summary_level_s * lvl, uint64_t entry) {
+    uint32_t lo = 0;
+    uint32_t hi = lvl->record_count;
+    while ((hi - lo) > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (lvl->records[mid].entry <= entry) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    struct summary_record_s * r = &lvl->records[lo];
+    return &r->entries[entry - r->entry];
+}
+
+/*
+ * Accumulate the statistics over samples [a, b) using summary level
+ * "level" for the aligned middle and the lower levels for the edges.
+ */
+static void accumulate(struct jsdrv_recorder_reader_s * self, struct signal_s * s, uint32_t level,
+                       uint64_t a, uint64_t b, struct jsdrv_statistics_accum_s * accum) {
+    struct jsdrv_statistics_accum_s tmp;
+    if (a >= b) {
+        return;
+    }
+    if (0 == level) {
+        float x[RAW_CHUNK];
+        while (a < b) {
+            uint64_t k = b - a;
+            k = (k > RAW_CHUNK) ? RAW_CHUNK : k;
+            samples_read(self, s, a, k, (uint8_t *) x);
+            jsdrv_statistics_compute_f32_skip_nan(&tmp, x, k);
+            jsdrv_statistics_combine(accum, accum, &tmp);
+            a += k;
+        }
+        return;
+    }
+    struct summary_level_s * lvl = &s->levels[level - 1];
+    uint64_t span = lvl->samples_per_entry;
+    uint64_t e0 = (a + span - 1) / span;
+    uint64_t e1 = b / span;
+    if (e1 > lvl->entries) {
+        e1 = lvl->entries;
+    }
+    if (e0 >= e1) {
+        accumulate(self, s, level - 1, a, b, accum);
+        return;
+    }
+    accumulate(self, s, level - 1, a, e0 * span, accum);
+    for (uint64_t e = e0; e < e1; ++e) {
+        const struct jsdrv_summary_entry_s * entry = summary_entry(lvl, e);
+        if (!isnan(entry->avg)) {
+            jsdrv_statistics_from_entry(&tmp, entry, span);
+            jsdrv_statistics_combine(accum, accum, &tmp);
+        }
+    }
+    accumulate(self, s, level - 1, e1 * span, b, accum);
+}
+
+int32_t jsdrv_recorder_reader_summary(struct jsdrv_recorder_reader_s * self, uint16_t signal_id,
+                                      uint64_t sample_id, uint64_t increment,
+                                      struct jsdrv_summary_entry_s * entries, uint32_t length) {
+    struct jsdrv_statistics_accum_s accum;
+    struct signal_s * s = self ? signal_get(self, signal_id, false) : NULL;
+    if (!s) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    if (!entries || !increment || (s->info.element_type != JSDRV_DATA_TYPE_FLOAT)
+            || (s->info.element_size_bits != 32)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint64_t n = sample_count(s);
+    uint64_t window = increment / s->info.decimate_factor;
+    window = window ? window : 1;
+    uint32_t level = s->info.summary_levels;
+    while (level && (s->levels[level - 1].samples_per_entry > window)) {
+        --level;
+    }
+    for (uint32_t i = 0; i < length; ++i) {
+        int64_t t0 = (int64_t) (sample_id + i * increment - s->info.sample_id_start);
+        int64_t a = (t0 < 0) ? -((-t0 + s->info.decimate_factor - 1) / s->info.decimate_factor)
+                              : (t0 / s->info.decimate_factor);
+        int64_t b = a + (int64_t) window;
+        a = (a < 0) ? 0 : a;
+        b = (b > (int64_t) n) ? (int64_t) n : b;
+        jsdrv_statistics_reset(&accum);
+        if (a < b) {
+            accumulate(self, s, level, (uint64_t) a, (uint64_t) b, &accum);
+        }
+        if (accum.k) {
+            jsdrv_statistics_to_entry(&accum, &entries[i]);
+        } else {
+            entries[i].avg = NAN;
+            entries[i].std = NAN;
+            entries[i].min = NAN;
+            entries[i].max = NAN;
+        }
+    }
+    return 0;
+}
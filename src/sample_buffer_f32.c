@@ -15,6 +15,7 @@
  */
 
 #include "jsdrv_prv/sample_buffer_f32.h"
+#include "jsdrv_prv/f32_ops.h"
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/cdef.h"
 #include <math.h>
@@ -42,26 +43,68 @@ uint64_t sbuf_tail_sample_id(struct sbuf_f32_s * self) {
     return self->head_sample_id - sbuf_f32_length(self) * self->sample_id_decimate;
 }
 
-void sbuf_f32_add(struct sbuf_f32_s * self, uint64_t sample_id, float * data, uint32_t length) {
-    if (NULL == self) {
-        return;
+/// Get the contiguous space at head, up to length.
+static uint32_t head_segment(struct sbuf_f32_s * self, uint32_t length) {
+    uint32_t n = SAMPLE_BUFFER_LENGTH - self->head;
+    return (n < length) ? n : length;
+}
+
+/// Commit length samples written at head, discarding the oldest samples as needed.
+static void head_commit(struct sbuf_f32_s * self, uint32_t length, uint32_t length_prev) {
+    uint32_t length_next = length_prev + length;
+    if (length_next > SAMPLE_BUFFER_MASK) {
+        length_next = SAMPLE_BUFFER_MASK;
     }
+    self->tail = (self->head - length_next) & SAMPLE_BUFFER_MASK;
+}
+
+/// Write length copies of value at head, at most SAMPLE_BUFFER_MASK.
+static void head_fill(struct sbuf_f32_s * self, float value, uint32_t length) {
+    uint32_t length_prev = sbuf_f32_length(self);
+    uint32_t total = length;
+    while (length) {
+        uint32_t n = head_segment(self, length);
+        float * y = &self->buffer[self->head];
+        for (uint32_t i = 0; i < n; ++i) {
+            y[i] = value;
+        }
+        self->head = (self->head + n) & SAMPLE_BUFFER_MASK;
+        length -= n;
+    }
+    head_commit(self, total, length_prev);
+}
+
+/**
+ * @brief Prepare to add new data.
+ *
+ * @param self The buffer instance.
+ * @param sample_id The starting sample id for data.
+ * @param[inout] length The number of data samples, which is reduced to
+ *      the number of new samples to write at head.
+ * @return The number of leading data samples that the buffer skips.
+ *
+ * Fills any gap with NaN and updates head_sample_id for the new samples.
+ */
+static uint32_t add_prepare(struct sbuf_f32_s * self, uint64_t sample_id, uint32_t * length) {
+    uint32_t offset = 0;
     if (self->head_sample_id > sample_id) {
         // common case, some overlap with previous data, only need new data.
         uint64_t dup = (self->head_sample_id - sample_id) / self->sample_id_decimate;
-        if (dup >= length) {
-            return;
+        if (dup >= *length) {
+            offset = *length;
+            *length = 0;
+            return offset;
         }
-        data += dup;
-        length -= (uint32_t) dup;
+        offset = (uint32_t) dup;
+        *length -= (uint32_t) dup;
         sample_id += dup * self->sample_id_decimate;
     }
-    if (length >= SAMPLE_BUFFER_LENGTH) {
+    if (*length >= SAMPLE_BUFFER_LENGTH) {
         // uncommon case, incoming data is larger than our buffer
-        uint32_t skip = length - (SAMPLE_BUFFER_LENGTH - 1);
-        data += skip;
-        length = SAMPLE_BUFFER_LENGTH - 1;
-        self->head_sample_id = sample_id - length * self->sample_id_decimate;
+        uint32_t skip = *length - (SAMPLE_BUFFER_LENGTH - 1);
+        offset += skip;
+        *length = SAMPLE_BUFFER_LENGTH - 1;
+        self->head_sample_id = sample_id - *length * self->sample_id_decimate;
     } else if (self->head_sample_id < sample_id) {
         // uncommon case, missing samples, fill with NaN
         uint64_t skips = (sample_id - self->head_sample_id) / self->sample_id_decimate;
@@ -70,26 +113,84 @@ void sbuf_f32_add(struct sbuf_f32_s * self, uint64_t sample_id, float * data, ui
             self->head_sample_id = sample_id - skips * self->sample_id_decimate;
             self->tail = self->head;
         }
-        while (self->head_sample_id < sample_id) {
-            self->buffer[self->head] = NAN;
-            self->head = (self->head + 1) & SAMPLE_BUFFER_MASK;
-            if (self->tail == self->head) {
-                self->tail = (self->tail + 1) & SAMPLE_BUFFER_MASK;
-            }
-            self->head_sample_id += self->sample_id_decimate;
-        }
+        uint32_t count = (uint32_t) ((sample_id - self->head_sample_id + self->sample_id_decimate - 1)
+                                     / self->sample_id_decimate);
+        head_fill(self, NAN, count);
+        self->head_sample_id += count * self->sample_id_decimate;
     }
+    self->head_sample_id += *length * self->sample_id_decimate;
+    return offset;
+}
 
-    // Copy new data to buffer
-    self->head_sample_id += length * self->sample_id_decimate;
+void sbuf_f32_add(struct sbuf_f32_s * self, uint64_t sample_id, float * data, uint32_t length) {
+    if (NULL == self) {
+        return;
+    }
+    data += add_prepare(self, sample_id, &length);
+    uint32_t length_prev = sbuf_f32_length(self);
+    uint32_t total = length;
     while (length) {
-        self->buffer[self->head] = *data++;
-        self->head = (self->head + 1) & SAMPLE_BUFFER_MASK;
-        if (self->tail == self->head) {
-            self->tail = (self->tail + 1) & SAMPLE_BUFFER_MASK;
+        uint32_t n = head_segment(self, length);
+        jsdrv_memcpy(&self->buffer[self->head], data, n * sizeof(float));
+        self->head = (self->head + n) & SAMPLE_BUFFER_MASK;
+        data += n;
+        length -= n;
+    }
+    head_commit(self, total, length_prev);
+}
+
+void sbuf_f32_add_scale_copy(struct sbuf_f32_s * self, uint64_t sample_id,
+                             float * dst, const float * data, float scale, uint32_t length) {
+    if (NULL == self) {
+        if (dst != data) {
+            jsdrv_f32_scale_copy(dst, data, scale, length);
+        } else {
+            jsdrv_f32_scale(dst, scale, length);
         }
-        --length;
+        return;
+    }
+    uint32_t offset = add_prepare(self, sample_id, &length);
+    if (offset) {
+        if (dst != data) {
+            jsdrv_f32_scale_copy(dst, data, scale, offset);
+        } else {
+            jsdrv_f32_scale(dst, scale, offset);
+        }
+        dst += offset;
+        data += offset;
+    }
+    uint32_t length_prev = sbuf_f32_length(self);
+    uint32_t total = length;
+    while (length) {
+        uint32_t n = head_segment(self, length);
+        jsdrv_f32_scale_copy2(dst, &self->buffer[self->head], data, scale, n);
+        self->head = (self->head + n) & SAMPLE_BUFFER_MASK;
+        dst += n;
+        data += n;
+        length -= n;
     }
+    head_commit(self, total, length_prev);
+}
+
+uint32_t sbuf_f32_span(struct sbuf_f32_s * self, struct sbuf_f32_span_s * span) {
+    uint32_t length = sbuf_f32_length(self);
+    uint32_t n = SAMPLE_BUFFER_LENGTH - self->tail;
+    if (n > length) {
+        n = length;
+    }
+    span->data[0] = &self->buffer[self->tail];
+    span->length[0] = n;
+    span->data[1] = self->buffer;
+    span->length[1] = length - n;
+    return length;
+}
+
+uint32_t sbuf_f32_copy(struct sbuf_f32_s * self, float * dst) {
+    struct sbuf_f32_span_s span;
+    uint32_t length = sbuf_f32_span(self, &span);
+    jsdrv_memcpy(dst, span.data[0], span.length[0] * sizeof(float));
+    jsdrv_memcpy(dst + span.length[0], span.data[1], span.length[1] * sizeof(float));
+    return length;
 }
 
 void sbuf_f32_advance(struct sbuf_f32_s * self, uint64_t sample_id) {
@@ -123,10 +224,25 @@ void sbuf_f32_mult(struct sbuf_f32_s * r, struct sbuf_f32_s * s1, struct sbuf_f3
 
     r->msg_sample_id = (uint32_t) (r_sample_id & 0xffffffff);
     r->head_sample_id = r_sample_id;
-    while ((s1->tail != s1->head) && (s2->tail != s2->head)) {
-        r->buffer[r->head++] = s1->buffer[s1->tail] * s2->buffer[s2->tail];
-        s1->tail = (s1->tail + 1) & SAMPLE_BUFFER_MASK;
-        s2->tail = (s2->tail + 1) & SAMPLE_BUFFER_MASK;
-        r->head_sample_id += r->sample_id_decimate;
+    uint32_t length = sbuf_f32_length(s1);
+    uint32_t s2_length = sbuf_f32_length(s2);
+    if (s2_length < length) {
+        length = s2_length;
+    }
+    // r is clear, so only the s1 and s2 ring wraps split the segments
+    while (length) {
+        uint32_t n = length;
+        if (n > (SAMPLE_BUFFER_LENGTH - s1->tail)) {
+            n = SAMPLE_BUFFER_LENGTH - s1->tail;
+        }
+        if (n > (SAMPLE_BUFFER_LENGTH - s2->tail)) {
+            n = SAMPLE_BUFFER_LENGTH - s2->tail;
+        }
+        jsdrv_f32_mult(&r->buffer[r->head], &s1->buffer[s1->tail], &s2->buffer[s2->tail], n);
+        r->head += n;
+        s1->tail = (s1->tail + n) & SAMPLE_BUFFER_MASK;
+        s2->tail = (s2->tail + n) & SAMPLE_BUFFER_MASK;
+        r->head_sample_id += n * r->sample_id_decimate;
+        length -= n;
     }
 }
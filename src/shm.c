@@ -0,0 +1,441 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#include "jsdrv/shm.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include "tinyprintf.h"
+#include <string.h>
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#define SHM_MAGIC           (0x4d48534aU)   // "JSHM"
+#define SHM_VERSION         (1U)
+#define SHM_SIZE_MIN        (1U << 16)
+#define SHM_SIZE_MAX        (1U << 30)
+#define SHM_NAME_LENGTH_MAX (128U)
+#define SHM_TYPE_PAD        (0xffU)         // record type to skip to the ring start
+#define CACHE_LINE_SIZE     (64U)
+
+struct shm_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                  // ring size in bytes, power of 2
+    volatile uint32_t closed;       // set when the writer closes
+    uint8_t rsv1[CACHE_LINE_SIZE - 4 * sizeof(uint32_t)];
+    volatile uint32_t reserve;      // end of the record being written
+    uint8_t rsv2[CACHE_LINE_SIZE - sizeof(uint32_t)];
+    volatile uint32_t commit;       // end of the last complete record
+    uint8_t rsv3[CACHE_LINE_SIZE - sizeof(uint32_t)];
+};
+
+struct shm_record_s {
+    uint32_t length;                // total bytes including this header, multiple of 8
+    uint8_t type;                   // jsdrv_union_s fields or SHM_TYPE_PAD
+    uint8_t flags;
+    uint8_t op;
+    uint8_t app;
+    uint32_t size;                  // payload size in bytes
+    uint32_t rsv;
+    union jsdrv_union_inner_u value;  // for non-pointer types
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    uint8_t payload[];              // for pointer types
+};
+
+struct shm_map_s {
+#if _WIN32
+    HANDLE handle;
+#else
+    int fd;
+    char name[SHM_NAME_LENGTH_MAX];
+#endif
+    size_t length;
+    struct shm_header_s * hdr;
+    uint8_t * data;
+};
+
+struct jsdrv_shm_bridge_s {
+    struct jsdrv_context_s * context;
+    struct shm_map_s map;
+    jsdrv_os_mutex_t mutex;         // concurrent dispatch workers
+    uint32_t pos;                   // write position, modulo 2^32
+};
+
+struct jsdrv_shm_reader_s {
+    struct shm_map_s map;
+    uint32_t size;
+    uint32_t pos;                   // read position, modulo 2^32
+    uint32_t length;                // of the current record
+    uint32_t drops;
+};
+
+static int32_t map_name(char * buf, const char * name) {
+    if (!name || !name[0] || strchr(name, '/') || strchr(name, '\\')) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+#if _WIN32
+    int n = tfp_snprintf(buf, SHM_NAME_LENGTH_MAX, "Local\\jsdrv_%s", name);
+#else
+    int n = tfp_snprintf(buf, SHM_NAME_LENGTH_MAX, "/jsdrv_%s", name);
+#endif
+    return ((n < 0) || (n >= (int) SHM_NAME_LENGTH_MAX)) ? JSDRV_ERROR_PARAMETER_INVALID : 0;
+}
+
+static void map_close(struct shm_map_s * map, bool unlink) {
+#if _WIN32
+    (void) unlink;
+    if (map->hdr) {
+        UnmapViewOfFile(map->hdr);
+    }
+    if (map->handle) {
+        CloseHandle(map->handle);
+    }
+#else
+    if (map->hdr) {
+        munmap(map->hdr, map->length);
+    }
+    if (map->fd >= 0) {
+        close(map->fd);
+        if (unlink) {
+            shm_unlink(map->name);
+        }
+    }
+#endif
+    map->hdr = NULL;
+    map->data = NULL;
+}
+
+static int32_t map_open(struct shm_map_s * map, const char * name, size_t length, bool create) {
+    char shm_name[SHM_NAME_LENGTH_MAX];
+    int32_t rc = map_name(shm_name, name);
+    if (rc) {
+        return rc;
+    }
+#if _WIN32
+    if (create) {
+        map->handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                         (DWORD) (((uint64_t) length) >> 32), (DWORD) length, shm_name);
+        if (map->handle && (GetLastError() == ERROR_ALREADY_EXISTS)) {
+            CloseHandle(map->handle);
+            map->handle = NULL;
+            return JSDRV_ERROR_ALREADY_EXISTS;
+        }
+    } else {
+        map->handle = OpenFileMappingA(FILE_MAP_READ, FALSE, shm_name);
+    }
+    if (!map->handle) {
+        JSDRV_LOGW("shm %s: open failed %lu", shm_name, (unsigned long) GetLastError());
+        return create ? JSDRV_ERROR_IO : JSDRV_ERROR_NOT_FOUND;
+    }
+    map->hdr = MapViewOfFile(map->handle, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, length);
+    if (!map->hdr) {
+        map_close(map, false);
+        return JSDRV_ERROR_IO;
+    }
+    if (!length) {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(map->hdr, &info, sizeof(info));
+        length = info.RegionSize;
+    }
+#else
+    jsdrv_cstr_copy(map->name, shm_name, sizeof(map->name));
+    map->fd = shm_open(shm_name, create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDONLY, 0644);
+    if ((map->fd < 0) && create && (errno == EEXIST)) {
+        JSDRV_LOGW("shm %s: remove stale instance", shm_name);  // from a process that did not close
+        shm_unlink(shm_name);
+        map->fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if (map->fd < 0) {
+        if (create) {
+            JSDRV_LOGW("shm %s: create failed", shm_name);
+            return (errno == EEXIST) ? JSDRV_ERROR_ALREADY_EXISTS : JSDRV_ERROR_IO;
+        }
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    if (create) {
+        if (ftruncate(map->fd, (off_t) length)) {
+            map_close(map, true);
+            return JSDRV_ERROR_NOT_ENOUGH_MEMORY;
+        }
+    } else {
+        struct stat st;
+        if (fstat(map->fd, &st) || (st.st_size < (off_t) sizeof(struct shm_header_s))) {
+            map_close(map, false);
+            return JSDRV_ERROR_NOT_FOUND;
+        }
+        length = (size_t) st.st_size;
+    }
+    void * p = mmap(NULL, length, create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, map->fd, 0);
+    if (p == MAP_FAILED) {
+        map_close(map, create);
+        return JSDRV_ERROR_IO;
+    }
+    map->hdr = (struct shm_header_s *) p;
+#endif
+    map->length = length;
+    map->data = ((uint8_t *) map->hdr) + sizeof(struct shm_header_s);
+    return 0;
+}
+
+static void map_init(struct shm_map_s * map) {
+    memset(map, 0, sizeof(*map));
+#if !_WIN32
+    map->fd = -1;
+#endif
+}
+
+static void on_pub(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    struct jsdrv_shm_bridge_s * self = (struct jsdrv_shm_bridge_s *) user_data;
+    int32_t rc = jsdrv_shm_bridge_write(self, topic, value);
+    if (rc) {
+        JSDRV_LOGD1("shm write %s failed %d", topic, (int) rc);
+    }
+}
+
+int32_t jsdrv_shm_bridge_open(struct jsdrv_context_s * context, const char * name, uint32_t size,
+                              struct jsdrv_shm_bridge_s ** bridge) {
+    if (!bridge) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    *bridge = NULL;
+    if ((size < SHM_SIZE_MIN) || (size > SHM_SIZE_MAX) || (size & (size - 1))) {
+        JSDRV_LOGE("shm %s: size must be a power of 2: %u", name, (unsigned int) size);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct jsdrv_shm_bridge_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_shm_bridge_s));
+    map_init(&self->map);
+    int32_t rc = map_open(&self->map, name, sizeof(struct shm_header_s) + size, true);
+    if (rc) {
+        jsdrv_free(self);
+        return rc;
+    }
+    self->context = context;
+    self->mutex = jsdrv_os_mutex_alloc("shm_bridge");
+    struct shm_header_s * hdr = self->map.hdr;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->version = SHM_VERSION;
+    hdr->size = size;
+    jsdrv_atomic_store_u32(&hdr->magic, SHM_MAGIC);  // readers may now attach
+    JSDRV_LOGI("shm %s: open %u bytes", name, (unsigned int) size);
+    *bridge = self;
+    return 0;
+}
+
+int32_t jsdrv_shm_bridge_add(struct jsdrv_shm_bridge_s * self, const char * topic) {
+    if (!self || !self->context || !topic) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return jsdrv_subscribe(self->context, topic, JSDRV_SFLAG_PUB, on_pub, self, JSDRV_TIMEOUT_MS_DEFAULT);
+}
+
+int32_t jsdrv_shm_bridge_remove(struct jsdrv_shm_bridge_s * self, const char * topic) {
+    if (!self || !self->context || !topic) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return jsdrv_unsubscribe(self->context, topic, on_pub, self, JSDRV_TIMEOUT_MS_DEFAULT);
+}
+
+int32_t jsdrv_shm_bridge_write(struct jsdrv_shm_bridge_s * self,
+                               const char * topic, const struct jsdrv_union_s * value) {
+    if (!self || !topic || !value) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct shm_header_s * hdr = self->map.hdr;
+    uint32_t size = 0;
+    bool is_ptr = false;
+    switch (value->type) {
+        case JSDRV_UNION_STR:   // intentional fall-through
+        case JSDRV_UNION_JSON:
+            is_ptr = true;
+            size = value->size ? value->size : (uint32_t) (strlen(value->value.str) + 1);
+            break;
+        case JSDRV_UNION_BIN:
+            is_ptr = true;
+            size = value->size;
+            break;
+        default:
+            break;
+    }
+    uint32_t length = (uint32_t) ((sizeof(struct shm_record_s) + size + 7) & ~7U);
+    if (length > (hdr->size >> 2)) {
+        return JSDRV_ERROR_TOO_BIG;
+    }
+
+    jsdrv_os_mutex_lock(self->mutex);
+    uint32_t mask = hdr->size - 1;
+    uint32_t pos = self->pos;
+    uint32_t offset = pos & mask;
+    uint32_t pad = ((offset + length) > hdr->size) ? (hdr->size - offset) : 0;
+    uint32_t end = pos + pad + length;
+    jsdrv_atomic_exchange_u32(&hdr->reserve, end);  // full barrier before overwriting
+    if (pad) {
+        struct shm_record_s * r = (struct shm_record_s *) (self->map.data + offset);
+        r->length = pad;
+        r->type = SHM_TYPE_PAD;
+        offset = 0;
+    }
+    struct shm_record_s * r = (struct shm_record_s *) (self->map.data + offset);
+    r->length = length;
+    r->type = value->type;
+    r->flags = value->flags & ~(JSDRV_UNION_FLAG_HEAP_MEMORY | JSDRV_UNION_FLAG_SHARED_MEMORY | JSDRV_UNION_FLAG_STATIC);
+    r->op = value->op;
+    r->app = value->app;
+    r->size = size;
+    r->rsv = 0;
+    r->value.u64 = is_ptr ? 0 : value->value.u64;
+    jsdrv_cstr_copy(r->topic, topic, sizeof(r->topic));
+    if (is_ptr && size) {
+        memcpy(r->payload, value->value.bin, size);
+    }
+    jsdrv_atomic_store_u32(&hdr->commit, end);
+    self->pos = end;
+    jsdrv_os_mutex_unlock(self->mutex);
+    return 0;
+}
+
+void jsdrv_shm_bridge_close(struct jsdrv_shm_bridge_s * self) {
+    if (!self) {
+        return;
+    }
+    if (self->context) {
+        jsdrv_unsubscribe_all(self->context, on_pub, self, JSDRV_TIMEOUT_MS_DEFAULT);
+    }
+    jsdrv_atomic_store_u32(&self->map.hdr->closed, 1);
+    map_close(&self->map, true);
+    jsdrv_os_mutex_free(self->mutex);
+    jsdrv_free(self);
+}
+
+int32_t jsdrv_shm_reader_open(const char * name, struct jsdrv_shm_reader_s ** reader) {
+    if (!reader) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    *reader = NULL;
+    struct jsdrv_shm_reader_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_shm_reader_s));
+    map_init(&self->map);
+    int32_t rc = map_open(&self->map, name, 0, false);
+    if (rc) {
+        jsdrv_free(self);
+        return rc;
+    }
+    struct shm_header_s * hdr = self->map.hdr;
+    if ((jsdrv_atomic_load_u32(&hdr->magic) != SHM_MAGIC) || (hdr->version != SHM_VERSION)
+            || (self->map.length < (sizeof(struct shm_header_s) + hdr->size))) {
+        JSDRV_LOGW("shm %s: invalid header", name);
+        map_close(&self->map, false);
+        jsdrv_free(self);
+        return JSDRV_ERROR_NOT_SUPPORTED;
+    }
+    self->size = hdr->size;
+    self->pos = jsdrv_atomic_load_u32(&hdr->commit);
+    *reader = self;
+    return 0;
+}
+
+static bool reader_is_lapped(struct jsdrv_shm_reader_s * self) {
+    jsdrv_atomic_fence();  // complete prior record reads before checking
+    return (jsdrv_atomic_load_u32(&self->map.hdr->reserve) - self->pos) > self->size;
+}
+
+static void reader_skip(struct jsdrv_shm_reader_s * self, uint32_t commit) {
+    ++self->drops;
+    self->pos = commit;
+}
+
+int32_t jsdrv_shm_reader_next(struct jsdrv_shm_reader_s * self,
+                              const char ** topic, struct jsdrv_union_s * value, uint32_t timeout_ms) {
+    if (!self || !topic || !value) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct shm_header_s * hdr = self->map.hdr;
+    uint32_t t_start = jsdrv_time_ms_u32();
+    self->pos += self->length;
+    self->length = 0;
+    while (1) {
+        uint32_t commit = jsdrv_atomic_load_u32(&hdr->commit);
+        if (commit == self->pos) {
+            if (jsdrv_atomic_load_u32(&hdr->closed)) {
+                return JSDRV_ERROR_CLOSED;
+            }
+            if ((jsdrv_time_ms_u32() - t_start) >= timeout_ms) {
+                return JSDRV_ERROR_TIMED_OUT;
+            }
+            jsdrv_thread_sleep_ms(1);
+            continue;
+        }
+        if ((commit - self->pos) > self->size) {
+            reader_skip(self, commit);
+            continue;
+        }
+        const struct shm_record_s * r = (const struct shm_record_s *) (self->map.data + (self->pos & (self->size - 1)));
+        struct shm_record_s rec = *r;  // header only, payload stays in place
+        if (reader_is_lapped(self) || (rec.length < sizeof(uint64_t)) || (rec.length > self->size)
+                || (rec.length & 7U)) {
+            reader_skip(self, commit);
+            continue;
+        }
+        if (rec.type == SHM_TYPE_PAD) {
+            self->pos += rec.length;
+            continue;
+        }
+        value->type = rec.type;
+        value->flags = rec.flags | JSDRV_UNION_FLAG_CONST;
+        value->op = rec.op;
+        value->app = rec.app;
+        value->size = rec.size;
+        if ((rec.type == JSDRV_UNION_STR) || (rec.type == JSDRV_UNION_JSON) || (rec.type == JSDRV_UNION_BIN)) {
+            value->value.bin = r->payload;
+        } else {
+            value->value = rec.value;
+        }
+        *topic = r->topic;
+        self->length = rec.length;
+        return 0;
+    }
+}
+
+int32_t jsdrv_shm_reader_check(struct jsdrv_shm_reader_s * self) {
+    if (!self) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    return (self->length && reader_is_lapped(self)) ? JSDRV_ERROR_ABORTED : 0;
+}
+
+uint32_t jsdrv_shm_reader_drops(struct jsdrv_shm_reader_s * self) {
+    return self ? self->drops : 0;
+}
+
+void jsdrv_shm_reader_close(struct jsdrv_shm_reader_s * self) {
+    if (self) {
+        map_close(&self->map, false);
+        jsdrv_free(self);
+    }
+}
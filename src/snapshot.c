@@ -0,0 +1,170 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "jsdrv_prv/snapshot.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv.h"
+#include <string.h>
+
+#define READ_RETRIES (64U)
+
+
+struct entry_s {
+    volatile uint32_t hash;                 // 0 when unused, published once the topic is set
+    volatile uint32_t seq;                  // odd while the writer updates the value
+    char topic[JSDRV_TOPIC_LENGTH_MAX];     // immutable once hash is published
+    uint8_t present;
+    struct jsdrv_union_s value;             // pointer values use data, value.bin is NULL
+    uint8_t data[JSDRV_SNAPSHOT_DATA_SIZE];
+};
+
+struct jsdrv_snapshot_s {
+    uint32_t mask;
+    uint32_t count;
+    uint32_t count_max;
+    struct entry_s entries[];
+};
+
+static uint32_t hash_compute(const char * topic) {
+    uint32_t h = 2166136261U;  // FNV-1a
+    for (; *topic; ++topic) {
+        h ^= (uint8_t) *topic;
+        h *= 16777619U;
+    }
+    return h ? h : 1;  // 0 marks an unused entry
+}
+
+struct jsdrv_snapshot_s * jsdrv_snapshot_alloc(uint32_t capacity) {
+    uint32_t sz = 16;
+    while (sz < capacity) {
+        sz <<= 1;
+    }
+    struct jsdrv_snapshot_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_snapshot_s) + sz * sizeof(struct entry_s));
+    self->mask = sz - 1;
+    self->count_max = sz - (sz >> 2);  // keep probe sequences short
+    return self;
+}
+
+void jsdrv_snapshot_free(struct jsdrv_snapshot_s * self) {
+    if (self) {
+        jsdrv_free(self);
+    }
+}
+
+static struct entry_s * entry_find(struct jsdrv_snapshot_s * self, const char * topic, bool insert) {
+    uint32_t h = hash_compute(topic);
+    uint32_t idx = h & self->mask;
+    for (uint32_t i = 0; i <= self->mask; ++i) {
+        struct entry_s * e = &self->entries[idx];
+        uint32_t e_hash = jsdrv_atomic_load_u32(&e->hash);
+        if (!e_hash) {
+            if (!insert || (self->count >= self->count_max)) {
+                return NULL;
+            }
+            if (jsdrv_cstr_copy(e->topic, topic, sizeof(e->topic))) {
+                return NULL;  // truncated
+            }
+            ++self->count;
+            jsdrv_atomic_store_u32(&e->hash, h);
+            return e;
+        }
+        if ((e_hash == h) && (0 == strcmp(e->topic, topic))) {
+            return e;
+        }
+        idx = (idx + 1) & self->mask;
+    }
+    return NULL;
+}
+
+void jsdrv_snapshot_set(struct jsdrv_snapshot_s * self, const char * topic, const struct jsdrv_union_s * value) {
+    struct entry_s * e = entry_find(self, topic, NULL != value);
+    if (!e) {
+        return;
+    }
+    uint32_t seq = e->seq;  // single writer
+    jsdrv_atomic_store_u32(&e->seq, seq + 1);
+    jsdrv_atomic_fence();   // readers must see the odd sequence before any data change
+    e->present = 0;
+    if (value) {
+        e->value = *value;
+        if (!jsdrv_union_is_type_ptr(value)) {
+            e->present = 1;
+        } else if (value->value.bin) {
+            uint32_t sz = value->size;
+            if (!sz) {
+                sz = (uint32_t) strlen(value->value.str) + 1;
+            }
+            if (sz <= sizeof(e->data)) {
+                memcpy(e->data, value->value.bin, sz);
+                e->value.value.bin = NULL;
+                e->value.size = sz;
+                e->present = 1;
+            }
+        }
+    }
+    jsdrv_atomic_store_u32(&e->seq, seq + 2);
+}
+
+int32_t jsdrv_snapshot_get(struct jsdrv_snapshot_s * self, const char * topic, struct jsdrv_union_s * value) {
+    if (!self || !topic || !value) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    struct entry_s * e = entry_find(self, topic, false);
+    if (!e) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    for (uint32_t retry = 0; retry < READ_RETRIES; ++retry) {
+        uint32_t seq = jsdrv_atomic_load_u32(&e->seq);
+        if (seq & 1) {
+            continue;
+        }
+        int32_t rc = 0;
+        uint8_t present = e->present;
+        struct jsdrv_union_s v = e->value;
+        bool is_ptr = jsdrv_union_is_type_ptr(&v);
+        if (!present) {
+            rc = JSDRV_ERROR_NOT_FOUND;
+        } else if (is_ptr) {
+            if (!jsdrv_union_is_type_ptr(value) || !value->value.bin) {
+                rc = JSDRV_ERROR_SYNTAX_ERROR;
+            } else if (v.size > sizeof(e->data)) {
+                continue;  // torn read, the sequence check would fail
+            } else if (v.size > value->size) {
+                rc = JSDRV_ERROR_TOO_SMALL;
+            } else {
+                memcpy((void *) value->value.bin, e->data, v.size);
+            }
+        }
+        jsdrv_atomic_fence();  // complete the copy before checking the sequence
+        if (jsdrv_atomic_load_u32(&e->seq) != seq) {
+            continue;
+        }
+        if (!rc) {
+            if (is_ptr) {
+                value->type = v.type;
+                value->size = v.size;
+            } else {
+                *value = v;
+            }
+        }
+        return rc;
+    }
+    return JSDRV_ERROR_BUSY;
+}
@@ -0,0 +1,457 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/spectrum.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/dbc.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/topic.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/welch.h"
+#include "jsdrv.h"
+#include "tinyprintf.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+
+JSDRV_STATIC_ASSERT((JSDRV_SPECTRUM_HEADER_SIZE + (JSDRV_WELCH_LENGTH_MAX / 2 + 1) * sizeof(float))
+                    <= sizeof(struct jsdrv_stream_signal_s), spectrum_size);
+
+static const char * action_add_meta = "{"
+    "\"dtype\": \"u32\","
+    "\"brief\": \"Add a spectrum analyzer.\""
+"}";
+
+static const char * action_remove_meta = "{"
+    "\"dtype\": \"u32\","
+    "\"brief\": \"Remove a spectrum analyzer.\""
+"}";
+
+static const char * action_list_meta = "{"
+    "\"brief\": \"The list of available spectrum analyzers, 0 terminated.\""
+"}";
+
+struct analyzer_s {
+    uint8_t idx;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    struct jsdrv_context_s * context;
+    struct jsdrv_welch_config_s config;  // sample_rate from the most recent data
+    uint32_t decimate_factor;
+    struct jsdrv_welch_s * welch;
+    char source_topic[JSDRV_TOPIC_LENGTH_MAX];
+    struct msg_queue_s * cmd_q;
+    jsdrv_thread_t thread;
+    volatile uint8_t do_exit;
+};
+
+struct spectrum_mgr_s {
+    struct jsdrv_context_s * context;
+    struct analyzer_s analyzers[JSDRV_SPECTRUM_COUNT_MAX];
+};
+
+
+static struct spectrum_mgr_s instance_ = {.context = NULL};
+
+static uint8_t _spectrum_recv(void * user_data, struct jsdrvp_msg_s * msg);
+static uint8_t _spectrum_recv_data(void * user_data, struct jsdrvp_msg_s * msg);
+
+static bool is_analyzer_idx_valid(uint64_t analyzer_idx) {
+    return ((analyzer_idx >= 1) && (analyzer_idx <= JSDRV_SPECTRUM_COUNT_MAX));
+}
+
+static void send_to_frontend(struct spectrum_mgr_s * self, const char * topic, const struct jsdrv_union_s * value) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, topic, value);
+    jsdrvp_backend_send(self->context, m);
+}
+
+static int32_t subscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+                         jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_SUBSCRIBE, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, topic, sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = cbk_fn;
+    m->payload.sub.subscriber.user_data = cbk_user_data;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = flags;
+    jsdrvp_backend_send(context, m);
+    return 0;
+}
+
+static int32_t unsubscribe(struct jsdrv_context_s * context, const char * topic, uint8_t flags,
+                           jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    jsdrv_cstr_copy(m->topic, JSDRV_PUBSUB_UNSUBSCRIBE, sizeof(m->topic));
+    m->value.type = JSDRV_UNION_BIN;
+    m->value.value.bin = m->payload.bin;
+    m->value.app = JSDRV_PAYLOAD_TYPE_SUB;
+    jsdrv_cstr_copy(m->payload.sub.topic, topic, sizeof(m->payload.sub.topic));
+    m->payload.sub.subscriber.internal_fn = cbk_fn;
+    m->payload.sub.subscriber.user_data = cbk_user_data;
+    m->payload.sub.subscriber.is_internal = 1;
+    m->payload.sub.subscriber.flags = flags;
+    jsdrvp_backend_send(context, m);
+    return 0;
+}
+
+static int32_t send_return_code_to_frontend(struct jsdrv_context_s * context, const char * topic, int32_t rc,
+        jsdrv_pubsub_subscribe_fn cbk_fn, void * cbk_user_data) {
+    struct jsdrvp_msg_s * m;
+    m = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_i32(rc));
+    tfp_snprintf(m->topic, sizeof(m->topic), "%s%c", topic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+    m->extra.frontend.subscriber.internal_fn = cbk_fn;
+    m->extra.frontend.subscriber.user_data = cbk_user_data;
+    m->extra.frontend.subscriber.is_internal = 1;
+    jsdrvp_backend_send(context, m);
+    return rc;
+}
+
+static int32_t analyzer_recv_complete(struct analyzer_s * self, const char * subtopic, int32_t rc) {
+    if (rc >= 0) {
+        struct jsdrvp_msg_s * m;
+        m = jsdrvp_msg_alloc_value(self->context, "", &jsdrv_union_i32(rc));
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s%c", self->topic,
+                     subtopic, JSDRV_TOPIC_SUFFIX_RETURN_CODE);
+        m->extra.frontend.subscriber.internal_fn = _spectrum_recv;
+        m->extra.frontend.subscriber.user_data = NULL;
+        m->extra.frontend.subscriber.is_internal = 1;
+        jsdrvp_backend_send(self->context, m);
+    }
+    return rc;
+}
+
+static void source_unsub(struct analyzer_s * self) {
+    if (self->source_topic[0]) {
+        unsubscribe(self->context, self->source_topic, JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM,
+                    _spectrum_recv_data, (void *) (intptr_t) self->idx);
+        self->source_topic[0] = 0;
+    }
+}
+
+static void source_sub(struct analyzer_s * self, const char * topic) {
+    source_unsub(self);
+    jsdrv_cstr_copy(self->source_topic, topic, sizeof(self->source_topic));
+    subscribe(self->context, topic, JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM,
+              _spectrum_recv_data, (void *) (intptr_t) self->idx);
+}
+
+// Apply a configuration change, which restarts the average.
+static int32_t analyzer_configure(struct analyzer_s * self, const struct jsdrv_welch_config_s * config) {
+    struct jsdrv_welch_config_s c = *config;
+    if (0 == c.sample_rate) {
+        c.sample_rate = 1;  // validate until the first data provides the rate
+    }
+    int32_t rc = jsdrv_welch_configure(self->welch, &c);
+    if (0 == rc) {
+        self->config = *config;
+    } else {
+        jsdrv_welch_configure(self->welch, &self->config);  // restore
+    }
+    return rc;
+}
+
+static void spectra_publish(struct analyzer_s * self, const struct jsdrv_stream_signal_s * signal) {
+    uint32_t size;
+    while (0 != (size = jsdrv_welch_ready(self->welch))) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(self->context, "", size);
+        tfp_snprintf(m->topic, sizeof(m->topic), "%s/%s", self->topic, JSDRV_SPECTRUM_MSG_DATA);
+        struct jsdrv_spectrum_s * spectrum = (struct jsdrv_spectrum_s *) m->value.value.bin;
+        jsdrv_welch_next(self->welch, spectrum);
+        spectrum->sample_id *= self->decimate_factor;
+        spectrum->decimate_factor = self->decimate_factor;
+        spectrum->time_map = signal->time_map;
+        m->value.size = size;
+        m->value.app = JSDRV_PAYLOAD_TYPE_SPECTRUM;
+        m->extra.frontend.subscriber.internal_fn = _spectrum_recv;  // skip our own subscription
+        m->extra.frontend.subscriber.user_data = self;
+        m->extra.frontend.subscriber.is_internal = 1;
+        jsdrvp_backend_send(self->context, m);
+    }
+}
+
+static void handle_data(struct analyzer_s * self, const struct jsdrv_stream_signal_s * signal);
+
+// Expand a deadband hold record into its mean value so that the Welch frames stay contiguous.
+static void handle_hold(struct analyzer_s * self, const struct jsdrv_stream_signal_s * signal) {
+    struct jsdrv_stream_signal_s * x = jsdrv_alloc(sizeof(struct jsdrv_stream_signal_s));
+    uint32_t count;
+    for (uint64_t offset = 0; (count = jsdrv_deadband_expand(signal, offset, x)) != 0; offset += count) {
+        handle_data(self, x);
+    }
+    jsdrv_free(x);
+}
+
+static void handle_data(struct analyzer_s * self, const struct jsdrv_stream_signal_s * signal) {
+    if (jsdrv_deadband_hold(signal)) {
+        handle_hold(self, signal);
+        return;
+    }
+    if ((signal->element_type != JSDRV_DATA_TYPE_FLOAT) || (signal->element_size_bits != 32)) {
+        return;
+    }
+    uint32_t decimate_factor = signal->decimate_factor ? signal->decimate_factor : 1;
+    uint32_t sample_rate = signal->sample_rate / decimate_factor;
+    if ((sample_rate != self->config.sample_rate) || (decimate_factor != self->decimate_factor)) {
+        struct jsdrv_welch_config_s config = self->config;
+        config.sample_rate = sample_rate;
+        if (analyzer_configure(self, &config)) {
+            JSDRV_LOGW("spectrum %u: invalid sample rate %u", (unsigned int) self->idx, (unsigned int) sample_rate);
+            return;
+        }
+        self->decimate_factor = decimate_factor;
+    }
+    jsdrv_welch_add(self->welch, signal->sample_id / decimate_factor,
+                    (const float *) signal->data, signal->element_count);
+    spectra_publish(self, signal);
+}
+
+static void cmd_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
+    if (msg->u32_a) {
+        jsdrvp_msg_free(context, msg->payload.dispatch);  // release reference
+    }
+    jsdrvp_msg_free(context, msg);
+}
+
+static void handle_cmd(struct analyzer_s * self, struct jsdrvp_msg_s * msg) {
+    int32_t rc = -1;  // ignored
+    const char * s = msg->topic;
+    if (msg->u32_a) {
+        handle_data(self, (struct jsdrv_stream_signal_s *) msg->payload.dispatch->value.value.bin);
+    } else if ((s[0] == 'g') && (s[1] == '/')) {
+        s += 2;
+        struct jsdrv_welch_config_s config = self->config;
+        struct jsdrv_union_s v = msg->value;
+        jsdrv_union_widen(&v);
+        if (0 == strcmp(s, "topic")) {
+            const char * topic = (msg->value.type == JSDRV_UNION_STR) ? msg->value.value.str : "";
+            JSDRV_LOGI("spectrum %u topic %s", (unsigned int) self->idx, topic);
+            if (topic[0]) {
+                source_sub(self, topic);
+            } else {
+                source_unsub(self);
+            }
+            jsdrv_welch_clear(self->welch);
+            rc = 0;
+        } else if (0 == strcmp(s, "length")) {
+            config.fft_length = v.value.u32;
+            rc = analyzer_configure(self, &config);
+        } else if (0 == strcmp(s, "overlap")) {
+            config.overlap = v.value.u32;
+            rc = analyzer_configure(self, &config);
+        } else if (0 == strcmp(s, "period")) {
+            config.period_ms = v.value.u32;
+            rc = analyzer_configure(self, &config);
+        } else if (0 == strcmp(s, "scale")) {
+            config.scale = (v.value.u32 > 0xff) ? 0xff : (uint8_t) v.value.u32;
+            rc = analyzer_configure(self, &config);
+        } else if (0 == strcmp(s, "!clear")) {
+            jsdrv_welch_clear(self->welch);
+            rc = 0;
+        } else {
+            JSDRV_LOGW("spectrum global unsupported: %s", s);
+            rc = JSDRV_ERROR_PARAMETER_INVALID;
+        }
+    } else if (0 == strcmp(s, JSDRV_MSG_FINALIZE)) {
+        self->do_exit = 1;
+        rc = 0;
+    } else {
+        JSDRV_LOGW("ignore %s", msg->topic);
+        rc = JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    analyzer_recv_complete(self, msg->topic, rc);
+    cmd_msg_free(self->context, msg);
+}
+
+static THREAD_RETURN_TYPE analyzer_thread(THREAD_ARG_TYPE lpParam) {
+    struct analyzer_s * self = (struct analyzer_s *) lpParam;
+    JSDRV_LOGI("spectrum thread started: %s", self->topic);
+    jsdrvp_thread_configure(self->context, JSDRVP_THREAD_BUFFER, "jsdrv_spectrum");
+    jsdrvp_msg_cache_attach(self->context);
+
+    while (!self->do_exit) {
+        struct jsdrvp_msg_s * msg;
+        if (0 == msg_queue_pop(self->cmd_q, &msg, MSG_QUEUE_TIMEOUT_FOREVER)) {
+            handle_cmd(self, msg);
+        }
+    }
+
+    source_unsub(self);
+    jsdrvp_msg_cache_detach(self->context);
+    JSDRV_LOGI("spectrum thread done: %s", self->topic);
+    THREAD_RETURN();
+}
+
+static void _send_analyzer_list(struct spectrum_mgr_s * self) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_LIST, &jsdrv_union_cbin_r(NULL, 0));
+    for (uint8_t analyzer_idx = 1; analyzer_idx <= JSDRV_SPECTRUM_COUNT_MAX; ++analyzer_idx) {
+        if (NULL != self->analyzers[analyzer_idx - 1].cmd_q) {
+            m->payload.bin[m->value.size++] = analyzer_idx;
+        }
+    }
+    m->payload.bin[m->value.size++] = 0;
+    jsdrvp_backend_send(self->context, m);
+}
+
+static uint8_t _spectrum_recv(void * user_data, struct jsdrvp_msg_s * msg) {
+    struct analyzer_s * a = (struct analyzer_s *) user_data;
+    if (jsdrv_cstr_ends_with(msg->topic, JSDRV_SPECTRUM_MSG_DATA)) {
+        return 0;  // our own output
+    }
+    size_t prefix_len = strlen(a->topic);
+    if (!jsdrv_cstr_starts_with(msg->topic, a->topic) || (msg->topic[prefix_len] != '/')) {
+        JSDRV_LOGE("unexpected topic %s to %s", msg->topic, a->topic);
+        return 1;
+    }
+    if (NULL != a->cmd_q) {
+        struct jsdrvp_msg_s * m = jsdrvp_msg_clone(a->context, msg);
+        jsdrv_cstr_copy(m->topic, msg->topic + prefix_len + 1, sizeof(m->topic));
+        m->u32_a = 0;  // command
+        msg_queue_push(a->cmd_q, m);
+    }
+    return 0;
+}
+
+static uint8_t _spectrum_recv_data(void * user_data, struct jsdrvp_msg_s * msg) {
+    uint32_t analyzer_idx = (uint32_t) (intptr_t) user_data;
+    if (!is_analyzer_idx_valid(analyzer_idx)) {
+        JSDRV_LOGE("spectrum data invalid: %s", msg->topic);
+        return 1;
+    }
+    struct analyzer_s * a = &instance_.analyzers[analyzer_idx - 1];
+    struct jsdrv_stream_signal_s * signal = (struct jsdrv_stream_signal_s *) msg->value.value.bin;
+    if ((NULL != a->cmd_q) && (msg->value.app == JSDRV_PAYLOAD_TYPE_STREAM) && signal->element_count) {
+        msg_queue_push(a->cmd_q, jsdrvp_msg_dispatch_ref(a->context, msg, 1));
+    }
+    return 0;
+}
+
+static uint8_t _spectrum_add(void * user_data, struct jsdrvp_msg_s * msg) {
+    (void) user_data;
+    struct spectrum_mgr_s * self = &instance_;
+    struct jsdrv_union_s v = msg->value;
+    jsdrv_union_widen(&v);
+    uint64_t analyzer_id_u64 = v.value.u64;
+    if (!is_analyzer_idx_valid(analyzer_id_u64)) {
+        JSDRV_LOGE("spectrum analyzer %llu invalid", analyzer_id_u64);
+        return send_return_code_to_frontend(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD, JSDRV_ERROR_PARAMETER_INVALID, _spectrum_add, NULL);
+    }
+    uint8_t analyzer_id = (uint8_t) analyzer_id_u64;
+    struct analyzer_s * a = &self->analyzers[analyzer_id - 1];
+    if (NULL != a->cmd_q) {
+        JSDRV_LOGE("spectrum analyzer %u already exists", analyzer_id);
+        return send_return_code_to_frontend(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD, JSDRV_ERROR_ALREADY_EXISTS, _spectrum_add, NULL);
+    }
+    JSDRV_LOGI("spectrum analyzer %u add", analyzer_id);
+    memset(a, 0, sizeof(*a));
+    a->idx = analyzer_id;
+    tfp_snprintf(a->topic, sizeof(a->topic), "f/%03u", analyzer_id);
+    a->context = self->context;
+    a->decimate_factor = 1;
+    a->welch = jsdrv_welch_new();
+    struct jsdrv_welch_config_s config = {
+        .sample_rate = 0,
+        .fft_length = JSDRV_WELCH_LENGTH_DEFAULT,
+        .overlap = 50,
+        .period_ms = 100,
+        .scale = JSDRV_SPECTRUM_SCALE_DENSITY,
+    };
+    analyzer_configure(a, &config);
+    a->cmd_q = msg_queue_init();
+    subscribe(a->context, a->topic, JSDRV_SFLAG_PUB, _spectrum_recv, a);
+    if (jsdrv_thread_create(&a->thread, analyzer_thread, a, -1)) {
+        JSDRV_LOGE("spectrum analyzer %u thread create failed", analyzer_id);
+        return send_return_code_to_frontend(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD, JSDRV_ERROR_UNSPECIFIED, _spectrum_add, NULL);
+    }
+    _send_analyzer_list(self);
+    return send_return_code_to_frontend(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD, 0, _spectrum_add, NULL);
+}
+
+static void _spectrum_remove_inner(struct spectrum_mgr_s * self, uint8_t analyzer_id) {
+    struct analyzer_s * a = &self->analyzers[analyzer_id - 1];
+    if (NULL == a->cmd_q) {
+        JSDRV_LOGE("spectrum analyzer %u does not exist", analyzer_id);
+        return;
+    }
+    JSDRV_LOGI("spectrum analyzer %u remove", analyzer_id);
+    unsubscribe(a->context, a->topic, JSDRV_SFLAG_PUB, _spectrum_recv, a);
+    msg_queue_push(a->cmd_q, jsdrvp_msg_alloc_value(self->context, JSDRV_MSG_FINALIZE, &jsdrv_union_u8(0)));
+    jsdrv_thread_join(&a->thread, 1000);
+    struct jsdrvp_msg_s * m;
+    while (NULL != (m = msg_queue_pop_immediate(a->cmd_q))) {
+        cmd_msg_free(self->context, m);
+    }
+    msg_queue_finalize(a->cmd_q);
+    a->cmd_q = NULL;
+    jsdrv_welch_free(a->welch);
+    a->welch = NULL;
+    _send_analyzer_list(self);
+}
+
+static uint8_t _spectrum_remove(void * user_data, struct jsdrvp_msg_s * msg) {
+    (void) user_data;
+    struct spectrum_mgr_s * self = &instance_;
+    struct jsdrv_union_s v = msg->value;
+    jsdrv_union_widen(&v);
+    uint64_t analyzer_id_u64 = v.value.u64;
+    if (!is_analyzer_idx_valid(analyzer_id_u64)) {
+        JSDRV_LOGE("invalid spectrum analyzer: %llu", analyzer_id_u64);
+        return send_return_code_to_frontend(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_REMOVE, JSDRV_ERROR_NOT_FOUND, _spectrum_remove, NULL);
+    }
+    _spectrum_remove_inner(self, (uint8_t) analyzer_id_u64);
+    return send_return_code_to_frontend(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_REMOVE, 0, _spectrum_remove, NULL);
+}
+
+int32_t jsdrv_spectrum_initialize(struct jsdrv_context_s * context) {
+    JSDRV_DBC_NOT_NULL(context);
+    struct spectrum_mgr_s * self = &instance_;
+    if (NULL != self->context) {
+        JSDRV_LOGE("jsdrv_spectrum_initialize but context not NULL");
+        return JSDRV_ERROR_IN_USE;
+    }
+    memset(self, 0, sizeof(*self));
+    self->context = context;
+
+    send_to_frontend(self, JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD "$", &jsdrv_union_cjson_r(action_add_meta));
+    send_to_frontend(self, JSDRV_SPECTRUM_MGR_MSG_ACTION_REMOVE "$", &jsdrv_union_cjson_r(action_remove_meta));
+    send_to_frontend(self, JSDRV_SPECTRUM_MGR_MSG_ACTION_LIST "$", &jsdrv_union_cjson_r(action_list_meta));
+
+    subscribe(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD, JSDRV_SFLAG_PUB, _spectrum_add, NULL);
+    subscribe(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_REMOVE, JSDRV_SFLAG_PUB, _spectrum_remove, NULL);
+    _send_analyzer_list(self);
+    return 0;
+}
+
+void jsdrv_spectrum_finalize(void) {
+    struct spectrum_mgr_s * self = &instance_;
+    if (self->context) {
+        unsubscribe(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_ADD, JSDRV_SFLAG_PUB, _spectrum_add, NULL);
+        unsubscribe(self->context, JSDRV_SPECTRUM_MGR_MSG_ACTION_REMOVE, JSDRV_SFLAG_PUB, _spectrum_remove, NULL);
+        for (uint32_t analyzer_idx = 1; analyzer_idx <= JSDRV_SPECTRUM_COUNT_MAX; ++analyzer_idx) {
+            if (NULL != self->analyzers[analyzer_idx - 1].cmd_q) {
+                _spectrum_remove_inner(self, (uint8_t) analyzer_idx);
+            }
+        }
+        self->context = NULL;
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include "jsdrv_prv/stage.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/mutex.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include <stdbool.h>
+#include <string.h>
+
+
+struct entry_s {
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    size_t topic_len;
+    jsdrv_stage_fn fn;
+    void * user_data;
+    uint8_t active;
+    volatile uint32_t busy;   // calls in progress, incremented with the mutex held
+};
+
+struct jsdrv_stage_registry_s {
+    jsdrv_os_mutex_t mutex;
+    volatile uint32_t count;  // active entries, for the lock-free fast path
+    struct entry_s entries[JSDRV_STAGE_COUNT_MAX];
+};
+
+struct jsdrv_stage_registry_s * jsdrv_stage_registry_alloc(void) {
+    struct jsdrv_stage_registry_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_stage_registry_s));
+    self->mutex = jsdrv_os_mutex_alloc("stage_registry");
+    return self;
+}
+
+void jsdrv_stage_registry_free(struct jsdrv_stage_registry_s * self) {
+    if (NULL == self) {
+        return;
+    }
+    if (self->mutex) {
+        jsdrv_os_mutex_free(self->mutex);
+        self->mutex = NULL;
+    }
+    jsdrv_free(self);
+}
+
+static struct entry_s * entry_find(struct jsdrv_stage_registry_s * self,
+        const char * topic, jsdrv_stage_fn fn, void * user_data) {
+    for (uint32_t idx = 0; idx < JSDRV_STAGE_COUNT_MAX; ++idx) {
+        struct entry_s * e = &self->entries[idx];
+        if (e->active && (e->fn == fn) && (e->user_data == user_data) && (0 == strcmp(e->topic, topic))) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+int32_t jsdrv_stage_registry_add(struct jsdrv_stage_registry_s * self,
+        const char * topic, jsdrv_stage_fn fn, void * user_data) {
+    if ((NULL == self) || (NULL == topic) || (NULL == fn)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    size_t topic_len = strlen(topic);
+    if (topic_len >= JSDRV_TOPIC_LENGTH_MAX) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    int32_t rc = JSDRV_ERROR_FULL;
+    jsdrv_os_mutex_lock(self->mutex);
+    if (entry_find(self, topic, fn, user_data)) {
+        rc = JSDRV_ERROR_ALREADY_EXISTS;
+    } else {
+        for (uint32_t idx = 0; idx < JSDRV_STAGE_COUNT_MAX; ++idx) {
+            struct entry_s * e = &self->entries[idx];
+            // skip entries still draining from jsdrv_stage_registry_remove()
+            if (!e->active && (0 == jsdrv_atomic_load_u32(&e->busy))) {
+                jsdrv_cstr_copy(e->topic, topic, sizeof(e->topic));
+                e->topic_len = topic_len;
+                e->fn = fn;
+                e->user_data = user_data;
+                e->active = 1;
+                jsdrv_atomic_add_u32(&self->count, 1);
+                rc = 0;
+                break;
+            }
+        }
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    return rc;
+}
+
+int32_t jsdrv_stage_registry_remove(struct jsdrv_stage_registry_s * self,
+        const char * topic, jsdrv_stage_fn fn, void * user_data) {
+    if ((NULL == self) || (NULL == topic)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    jsdrv_os_mutex_lock(self->mutex);
+    struct entry_s * e = entry_find(self, topic, fn, user_data);
+    if (e) {
+        e->active = 0;
+        jsdrv_atomic_add_u32(&self->count, (uint32_t) -1);
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    if (NULL == e) {
+        return JSDRV_ERROR_NOT_FOUND;
+    }
+    while (jsdrv_atomic_load_u32(&e->busy)) {
+        jsdrv_thread_sleep_ms(1);
+    }
+    return 0;
+}
+
+static bool topic_match(const struct entry_s * e, const char * topic) {
+    if (0 == e->topic_len) {
+        return true;
+    }
+    if (0 != strncmp(e->topic, topic, e->topic_len)) {
+        return false;
+    }
+    char c = topic[e->topic_len];
+    return (0 == c) || ('/' == c) || ('/' == e->topic[e->topic_len - 1]);
+}
+
+uint32_t jsdrv_stage_registry_process(struct jsdrv_stage_registry_s * self,
+        const char * topic, const struct jsdrv_stream_signal_s * block) {
+    struct entry_s * matches[JSDRV_STAGE_COUNT_MAX];
+    uint32_t count = 0;
+    if ((NULL == self) || (0 == jsdrv_atomic_load_u32(&self->count))) {
+        return 0;
+    }
+    jsdrv_os_mutex_lock(self->mutex);
+    for (uint32_t idx = 0; idx < JSDRV_STAGE_COUNT_MAX; ++idx) {
+        struct entry_s * e = &self->entries[idx];
+        if (e->active && topic_match(e, topic)) {
+            jsdrv_atomic_add_u32(&e->busy, 1);
+            matches[count++] = e;
+        }
+    }
+    jsdrv_os_mutex_unlock(self->mutex);
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        struct entry_s * e = matches[idx];
+        e->fn(e->user_data, topic, block);
+        jsdrv_atomic_add_u32(&e->busy, (uint32_t) -1);
+    }
+    return count;
+}
@@ -15,6 +15,7 @@
  */
 
 #include "jsdrv_prv/statistics.h"
+#include "jsdrv_prv/f32_ops.h"
 #include "jsdrv.h"  // for struct jsdrv_summary_entry_s, otherwise independent
 #include <float.h>
 #include <math.h>
@@ -42,35 +43,67 @@ void jsdrv_statistics_invalid(struct jsdrv_statistics_accum_s *s) {
     s->max = NAN;
 }
 
+// Process in uint32_t chunks for the jsdrv_f32_ops kernels.
+static double sum_min_max_f32(const float * x, uint64_t length, uint64_t * valid, float * v_min, float * v_max) {
+    double sum = 0.0;
+    *valid = 0;
+    while (length) {
+        uint32_t k = (length > UINT32_MAX) ? UINT32_MAX : (uint32_t) length;
+        uint32_t k_valid = 0;
+        sum += jsdrv_f32_sum_min_max(x, k, &k_valid, v_min, v_max);
+        *valid += k_valid;
+        x += k;
+        length -= k;
+    }
+    return sum;
+}
+
+static double sum_sq_dev_f32(const float * x, uint64_t length, double mean) {
+    double sum = 0.0;
+    while (length) {
+        uint32_t k = (length > UINT32_MAX) ? UINT32_MAX : (uint32_t) length;
+        sum += jsdrv_f32_sum_sq_dev(x, k, mean);
+        x += k;
+        length -= k;
+    }
+    return sum;
+}
+
 void jsdrv_statistics_compute_f32(struct jsdrv_statistics_accum_s * s, const float * x, uint64_t length) {
     if (length <= 0) {
         jsdrv_statistics_reset(s);
         return;
     }
-    float v;
-    double v_mean = 0.0;
+    uint64_t valid = 0;
     float v_min = FLT_MAX;
     float v_max = -FLT_MAX;
-    double v_var = 0.0;
-    for (uint64_t i = 0; i < length; ++i) {
-        v = x[i];
-        v_mean += v;
-        if (v < v_min) {
-            v_min = v;
-        }
-        if (v > v_max) {
-            v_max = v;
-        }
+    double v_mean = sum_min_max_f32(x, length, &valid, &v_min, &v_max);
+    s->k = length;
+    if (valid == length) {
+        v_mean /= length;
+        s->mean = v_mean;
+        s->s = sum_sq_dev_f32(x, length, v_mean);
+    } else {
+        s->mean = NAN;  // NaN samples propagate to mean and variance
+        s->s = NAN;
     }
-    v_mean /= length;
-    double m;
-    for (uint64_t i = 0; i < length; ++i) {
-        m = x[i] - v_mean;
-        v_var += (m * m);
+    s->min = v_min;
+    s->max = v_max;
+}
+
+void jsdrv_statistics_compute_f32_skip_nan(struct jsdrv_statistics_accum_s * s, const float * x, uint64_t length) {
+    uint64_t valid = 0;
+    float v_min = FLT_MAX;
+    float v_max = -FLT_MAX;
+    double v_mean = sum_min_max_f32(x, length, &valid, &v_min, &v_max);
+    if (!valid) {
+        jsdrv_statistics_reset(s);
+        return;
     }
-    s->k = length;
+    v_mean /= valid;
+    s->k = valid;
     s->mean = v_mean;
-    s->s = v_var;
+    s->s = sum_sq_dev_f32(x, length, v_mean);
     s->min = v_min;
     s->max = v_max;
 }
@@ -80,32 +113,48 @@ void jsdrv_statistics_compute_f64(struct jsdrv_statistics_accum_s * s, const dou
         jsdrv_statistics_reset(s);
         return;
     }
-    double v;
-    double v_mean = 0.0;
-    double v_min = DBL_MAX;
-    double v_max = -DBL_MAX;
-    double v_var = 0.0;
-    for (uint64_t i = 0; i < length; ++i) {
-        v = x[i];
-        v_mean += v;
-        if (v < v_min) {
-            v_min = v;
+    // Four independent accumulators break the add dependency chain,
+    // and the select form compiles to branchless min and max.
+    double v_sum[4] = {0.0, 0.0, 0.0, 0.0};
+    double v_min[4] = {DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX};
+    double v_max[4] = {-DBL_MAX, -DBL_MAX, -DBL_MAX, -DBL_MAX};
+    uint64_t i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            double v = x[i + k];
+            v_sum[k] += v;
+            v_min[k] = (v < v_min[k]) ? v : v_min[k];
+            v_max[k] = (v > v_max[k]) ? v : v_max[k];
         }
-        if (v > v_max) {
-            v_max = v;
+    }
+    for (; i < length; ++i) {
+        double v = x[i];
+        v_sum[0] += v;
+        v_min[0] = (v < v_min[0]) ? v : v_min[0];
+        v_max[0] = (v > v_max[0]) ? v : v_max[0];
+    }
+    for (int k = 1; k < 4; ++k) {
+        v_min[0] = (v_min[k] < v_min[0]) ? v_min[k] : v_min[0];
+        v_max[0] = (v_max[k] > v_max[0]) ? v_max[k] : v_max[0];
+    }
+    double v_mean = ((v_sum[0] + v_sum[1]) + (v_sum[2] + v_sum[3])) / length;
+    double v_var[4] = {0.0, 0.0, 0.0, 0.0};
+    i = 0;
+    for (; (i + 4) <= length; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            double m = x[i + k] - v_mean;
+            v_var[k] += m * m;
         }
     }
-    v_mean /= length;
-    double m;
-    for (uint64_t i = 0; i < length; ++i) {
-        m = x[i] - v_mean;
-        v_var += (m * m);
+    for (; i < length; ++i) {
+        double m = x[i] - v_mean;
+        v_var[0] += m * m;
     }
     s->k = length;
     s->mean = v_mean;
-    s->s = v_var;
-    s->min = v_min;
-    s->max = v_max;
+    s->s = (v_var[0] + v_var[1]) + (v_var[2] + v_var[3]);
+    s->min = v_min[0];
+    s->max = v_max[0];
 }
 
 void jsdrv_statistics_add(struct jsdrv_statistics_accum_s *s, double x) {
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/stats_group.h"
+#include "jsdrv_prv/js220_i128.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/statistics.h"
+#include "jsdrv/time.h"
+#include <math.h>
+
+
+void jsdrv_stats_group_initialize(struct jsdrv_stats_group_s * self, uint32_t member_count) {
+    jsdrv_memset(self, 0, sizeof(*self));
+    self->member_count = (member_count < JSDRV_STATS_GROUP_MEMBER_MAX) ? member_count : JSDRV_STATS_GROUP_MEMBER_MAX;
+}
+
+static int64_t block_duration(const struct jsdrv_statistics_s * b) {
+    if (!b->sample_freq) {
+        return 0;
+    }
+    double samples = (double) b->block_sample_count * (double) (b->decimate_factor ? b->decimate_factor : 1);
+    return (int64_t) (samples / (double) b->sample_freq * (double) JSDRV_TIME_SECOND);
+}
+
+static void accum_from_block(struct jsdrv_statistics_accum_s * a, uint64_t k,
+                             double avg, double std, double v_min, double v_max) {
+    a->k = k;
+    a->mean = avg;
+    a->s = std * std * (double) k;
+    a->min = v_min;
+    a->max = v_max;
+}
+
+static js220_i128 i128_from_u64(const uint64_t * x) {
+    js220_i128 r;
+    r.u64[0] = x[0];
+    r.u64[1] = x[1];
+    return r;
+}
+
+static void aggregate(struct jsdrv_stats_group_s * self) {
+    struct jsdrv_statistics_s * v = &self->value;
+    struct jsdrv_statistics_accum_s v_accum;
+    struct jsdrv_statistics_accum_s a;
+    double i_var = 0.0;
+    double p_var = 0.0;
+    js220_i128 charge = js220_i128_init_i64(0);
+    js220_i128 energy = js220_i128_init_i64(0);
+
+    *v = self->blocks[0];
+    v->i_avg = 0.0;
+    v->i_min = 0.0;
+    v->i_max = 0.0;
+    v->p_avg = 0.0;
+    v->p_min = 0.0;
+    v->p_max = 0.0;
+    v->charge_f64 = 0.0;
+    v->energy_f64 = 0.0;
+    jsdrv_statistics_reset(&v_accum);
+    for (uint32_t idx = 0; idx < self->member_count; ++idx) {
+        const struct jsdrv_statistics_s * b = &self->blocks[idx];
+        v->i_avg += b->i_avg;
+        v->i_min += b->i_min;
+        v->i_max += b->i_max;
+        i_var += b->i_std * b->i_std;
+        v->p_avg += b->p_avg;
+        v->p_min += b->p_min;
+        v->p_max += b->p_max;
+        p_var += b->p_std * b->p_std;
+        accum_from_block(&a, b->block_sample_count, b->v_avg, b->v_std, b->v_min, b->v_max);
+        jsdrv_statistics_combine(&v_accum, &v_accum, &a);
+        v->charge_f64 += b->charge_f64;
+        v->energy_f64 += b->energy_f64;
+        charge = js220_i128_add(charge, i128_from_u64(b->charge_i128));
+        energy = js220_i128_add(energy, i128_from_u64(b->energy_i128));
+    }
+    v->i_std = sqrt(i_var);
+    v->p_std = sqrt(p_var);
+    v->v_avg = v_accum.mean;
+    v->v_std = v_accum.k ? sqrt(v_accum.s / (double) v_accum.k) : 0.0;  // population, like the device
+    v->v_min = v_accum.min;
+    v->v_max = v_accum.max;
+    v->charge_i128[0] = charge.u64[0];
+    v->charge_i128[1] = charge.u64[1];
+    v->energy_i128[0] = energy.u64[0];
+    v->energy_i128[1] = energy.u64[1];
+}
+
+const struct jsdrv_statistics_s * jsdrv_stats_group_add(struct jsdrv_stats_group_s * self, uint32_t member,
+                                                        const struct jsdrv_statistics_s * block) {
+    if (member >= self->member_count) {
+        return NULL;
+    }
+    int64_t utc = 0;  // no time map, so pair the blocks in arrival order
+    if (block->time_map.counter_rate > 0.0) {
+        utc = jsdrv_time_from_counter(&block->time_map, block->block_sample_id);
+    }
+    int64_t half = block_duration(block) / 2;
+    for (uint32_t idx = 0; idx < self->member_count; ++idx) {
+        if ((idx == member) || (0 == (self->pending & (1U << idx)))) {
+            continue;
+        }
+        if (self->utc[idx] < (utc - half)) {
+            self->pending &= ~(1U << idx);  // the period ended without this member
+        } else if (self->utc[idx] > (utc + half)) {
+            return NULL;  // the other members already moved to a later period
+        }
+    }
+    self->blocks[member] = *block;
+    self->utc[member] = utc;
+    self->pending |= (1U << member);
+    if (self->pending != ((1U << self->member_count) - 1)) {
+        return NULL;
+    }
+    self->pending = 0;
+    aggregate(self);
+    return &self->value;
+}
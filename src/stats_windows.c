@@ -0,0 +1,169 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/stats_windows.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/platform.h"
+#include <math.h>
+
+
+void jsdrv_stats_windows_initialize(struct jsdrv_stats_windows_s * self) {
+    jsdrv_memset(self, 0, sizeof(*self));
+    for (uint32_t idx = 0; idx < JSDRV_STATS_WINDOWS_COUNT; ++idx) {
+        self->order[idx] = (uint8_t) idx;
+        self->windows[idx].source = -1;
+    }
+}
+
+void jsdrv_stats_windows_clear(struct jsdrv_stats_windows_s * self) {
+    for (uint32_t idx = 0; idx < JSDRV_STATS_WINDOWS_COUNT; ++idx) {
+        self->windows[idx].count = 0;
+    }
+}
+
+static void plan(struct jsdrv_stats_windows_s * self, uint32_t block_sample_count) {
+    self->block_sample_count = block_sample_count;
+    for (uint32_t idx = 0; idx < JSDRV_STATS_WINDOWS_COUNT; ++idx) {
+        struct jsdrv_stats_window_s * w = &self->windows[idx];
+        w->ratio = 0;
+        if (w->scnt && block_sample_count && (0 == (w->scnt % block_sample_count))) {
+            w->ratio = w->scnt / block_sample_count;
+        }
+    }
+
+    // insertion sort the slots by ratio, then slot index
+    for (uint32_t idx = 0; idx < JSDRV_STATS_WINDOWS_COUNT; ++idx) {
+        self->order[idx] = (uint8_t) idx;
+    }
+    for (uint32_t i = 1; i < JSDRV_STATS_WINDOWS_COUNT; ++i) {
+        uint8_t slot = self->order[i];
+        uint32_t j = i;
+        while ((j > 0) && (self->windows[self->order[j - 1]].ratio > self->windows[slot].ratio)) {
+            self->order[j] = self->order[j - 1];
+            --j;
+        }
+        self->order[j] = slot;
+    }
+
+    // combine from the longest earlier window that evenly divides this one
+    for (uint32_t i = 0; i < JSDRV_STATS_WINDOWS_COUNT; ++i) {
+        struct jsdrv_stats_window_s * w = &self->windows[self->order[i]];
+        w->source = -1;
+        w->step = w->ratio;
+        w->count = 0;
+        if (!w->ratio) {
+            continue;
+        }
+        for (uint32_t j = 0; j < i; ++j) {
+            struct jsdrv_stats_window_s * s = &self->windows[self->order[j]];
+            if (s->ratio && (0 == (w->ratio % s->ratio))) {
+                w->source = self->order[j];
+                w->step = w->ratio / s->ratio;
+            }
+        }
+    }
+}
+
+int32_t jsdrv_stats_windows_scnt_set(struct jsdrv_stats_windows_s * self, uint8_t slot, uint32_t scnt) {
+    if (slot >= JSDRV_STATS_WINDOWS_COUNT) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    self->windows[slot].scnt = scnt;
+    plan(self, self->block_sample_count);
+    return 0;
+}
+
+static void accum_from_block(struct jsdrv_statistics_accum_s * a, uint64_t k,
+                             double avg, double std, double v_min, double v_max) {
+    a->k = k;
+    a->mean = avg;
+    a->s = std * std * (double) k;
+    a->min = v_min;
+    a->max = v_max;
+}
+
+static void accum_to_block(const struct jsdrv_statistics_accum_s * a,
+                           double * avg, double * std, double * v_min, double * v_max) {
+    *avg = a->mean;
+    *std = a->k ? sqrt(a->s / (double) a->k) : 0.0;  // population, like the device
+    *v_min = a->min;
+    *v_max = a->max;
+}
+
+static void window_add(struct jsdrv_stats_window_s * w, const struct jsdrv_statistics_s * src) {
+    struct jsdrv_statistics_accum_s a[3];
+    uint64_t k = src->block_sample_count;
+    accum_from_block(&a[0], k, src->i_avg, src->i_std, src->i_min, src->i_max);
+    accum_from_block(&a[1], k, src->v_avg, src->v_std, src->v_min, src->v_max);
+    accum_from_block(&a[2], k, src->p_avg, src->p_std, src->p_min, src->p_max);
+    struct jsdrv_statistics_s * v = &w->value;
+    if (0 == w->count) {
+        *v = *src;
+        v->block_sample_count = 0;
+        for (int idx = 0; idx < 3; ++idx) {
+            jsdrv_statistics_reset(&w->accum[idx]);
+        }
+    }
+    for (int idx = 0; idx < 3; ++idx) {
+        jsdrv_statistics_combine(&w->accum[idx], &w->accum[idx], &a[idx]);
+    }
+
+    // the integrals and time map are cumulative, so keep the latest
+    v->block_sample_count += src->block_sample_count;
+    v->accum_sample_id = src->accum_sample_id;
+    v->charge_f64 = src->charge_f64;
+    v->energy_f64 = src->energy_f64;
+    v->charge_i128[0] = src->charge_i128[0];
+    v->charge_i128[1] = src->charge_i128[1];
+    v->energy_i128[0] = src->energy_i128[0];
+    v->energy_i128[1] = src->energy_i128[1];
+    v->time_map = src->time_map;
+}
+
+uint32_t jsdrv_stats_windows_add(struct jsdrv_stats_windows_s * self, const struct jsdrv_statistics_s * block) {
+    uint32_t completed = 0;
+    if (block->block_sample_count != self->block_sample_count) {
+        plan(self, block->block_sample_count);
+    }
+    for (uint32_t i = 0; i < JSDRV_STATS_WINDOWS_COUNT; ++i) {
+        uint8_t slot = self->order[i];
+        struct jsdrv_stats_window_s * w = &self->windows[slot];
+        if (!w->ratio) {
+            continue;
+        }
+        const struct jsdrv_statistics_s * src = block;
+        if (w->source >= 0) {
+            if (0 == (completed & (1U << w->source))) {
+                continue;
+            }
+            src = &self->windows[w->source].value;
+        }
+        window_add(w, src);
+        if (++w->count >= w->step) {
+            struct jsdrv_statistics_s * v = &w->value;
+            accum_to_block(&w->accum[0], &v->i_avg, &v->i_std, &v->i_min, &v->i_max);
+            accum_to_block(&w->accum[1], &v->v_avg, &v->v_std, &v->v_min, &v->v_max);
+            accum_to_block(&w->accum[2], &v->p_avg, &v->p_std, &v->p_min, &v->p_max);
+            w->count = 0;
+            completed |= (1U << slot);
+        }
+    }
+    return completed;
+}
+
+const struct jsdrv_statistics_s * jsdrv_stats_windows_value(struct jsdrv_stats_windows_s * self, uint8_t slot) {
+    return &self->windows[slot].value;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv/stream_codec.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/f32_codec.h"
+#include <string.h>
+
+
+static bool is_f32(const struct jsdrv_stream_signal_s * s) {
+    return (s->element_type == JSDRV_DATA_TYPE_FLOAT) && (s->element_size_bits == 32);
+}
+
+uint32_t jsdrv_stream_codec_encode(uint8_t codec, void * dst, uint32_t dst_size,
+                                   const struct jsdrv_stream_signal_s * src) {
+    if ((JSDRV_STREAM_CODEC_F32 != codec) || !is_f32(src) || !src->element_count) {
+        return 0;
+    }
+    uint32_t n = src->element_count;
+    uint32_t size_raw = JSDRV_STREAM_HEADER_SIZE + n * (uint32_t) sizeof(float);
+    if (dst_size < (JSDRV_STREAM_HEADER_SIZE + JSDRV_F32_CODEC_SIZE_MAX(n))) {
+        return 0;
+    }
+    uint8_t * p = (uint8_t *) dst;
+    memcpy(p, src, JSDRV_STREAM_HEADER_SIZE);
+    uint32_t size = JSDRV_STREAM_HEADER_SIZE + jsdrv_f32_codec_encode(p + JSDRV_STREAM_HEADER_SIZE,
+                                                                      (const float *) src->data, n);
+    return (size < size_raw) ? size : 0;
+}
+
+int32_t jsdrv_stream_codec_decode(uint8_t codec, struct jsdrv_stream_signal_s * dst, uint32_t dst_size,
+                                  const void * src, uint32_t src_size) {
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) src;
+    if ((JSDRV_STREAM_CODEC_F32 != codec) || (src_size < JSDRV_STREAM_HEADER_SIZE) || !is_f32(s)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    uint32_t n = s->element_count;
+    const uint8_t * z = (const uint8_t *) src + JSDRV_STREAM_HEADER_SIZE;
+    if ((dst_size < JSDRV_STREAM_HEADER_SIZE)
+            || (((uint64_t) n * sizeof(float)) > (dst_size - JSDRV_STREAM_HEADER_SIZE))
+            || !jsdrv_f32_codec_check(z, src_size - JSDRV_STREAM_HEADER_SIZE, n)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    memcpy(dst, src, JSDRV_STREAM_HEADER_SIZE);
+    jsdrv_f32_codec_decode((float *) dst->data, z, n);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/stream_flush.h"
+#include "jsdrv/error_code.h"
+
+
+void jsdrv_stream_flush_initialize(struct jsdrv_stream_flush_s * self) {
+    self->mode = JSDRV_STREAM_FLUSH_MODE_FIXED;
+    self->ms = JSDRV_STREAM_FLUSH_MS_DEFAULT;
+    self->bytes = 0;
+    self->ms_now = JSDRV_STREAM_FLUSH_MS_DEFAULT;
+}
+
+int32_t jsdrv_stream_flush_mode_set(struct jsdrv_stream_flush_s * self, uint32_t mode) {
+    if (mode > JSDRV_STREAM_FLUSH_MODE_ADAPTIVE) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    self->mode = mode;
+    self->ms_now = self->ms;
+    return 0;
+}
+
+int32_t jsdrv_stream_flush_ms_set(struct jsdrv_stream_flush_s * self, uint32_t ms) {
+    if ((ms < 1) || (ms > JSDRV_STREAM_FLUSH_MS_MAX)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    self->ms = ms;
+    self->ms_now = ms;
+    return 0;
+}
+
+void jsdrv_stream_flush_bytes_set(struct jsdrv_stream_flush_s * self, uint32_t bytes) {
+    self->bytes = bytes;
+}
+
+void jsdrv_stream_flush_update(struct jsdrv_stream_flush_s * self, uint32_t queue_depth) {
+    if (self->mode != JSDRV_STREAM_FLUSH_MODE_ADAPTIVE) {
+        return;
+    }
+    if (queue_depth >= JSDRV_STREAM_FLUSH_DEPTH_HIGH) {
+        self->ms_now *= 2;
+        if (self->ms_now > JSDRV_STREAM_FLUSH_MS_MAX) {
+            self->ms_now = JSDRV_STREAM_FLUSH_MS_MAX;
+        }
+    } else if (queue_depth <= JSDRV_STREAM_FLUSH_DEPTH_LOW) {
+        self->ms_now /= 2;
+        if (self->ms_now < self->ms) {
+            self->ms_now = self->ms;
+        }
+    }
+}
+
+uint32_t jsdrv_stream_flush_element_count_max(const struct jsdrv_stream_flush_s * self,
+                                              uint32_t sample_rate, uint32_t element_size_bits) {
+    uint64_t count = ((uint64_t) sample_rate * self->ms_now) / 1000U;
+    if (self->bytes && element_size_bits) {
+        uint64_t count_bytes = ((uint64_t) self->bytes * 8U) / element_size_bits;
+        if (count_bytes < count) {
+            count = count_bytes;
+        }
+    }
+    if (count < 1) {
+        count = 1;
+    } else if (count > UINT32_MAX) {
+        count = UINT32_MAX;
+    }
+    return (uint32_t) count;
+}
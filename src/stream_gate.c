@@ -0,0 +1,93 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "jsdrv_prv/stream_gate.h"
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+#include <string.h>
+
+
+void jsdrv_stream_gate_initialize(struct jsdrv_stream_gate_s * self) {
+    self->start = 0;
+    self->stop = 0;
+}
+
+int32_t jsdrv_stream_gate_utc_to_sample_id(const struct jsdrv_time_map_s * time_map, int64_t utc,
+                                           uint64_t * sample_id) {
+    if ((time_map->offset_time <= 0) || (time_map->counter_rate <= 0.0)) {
+        return JSDRV_ERROR_UNAVAILABLE;
+    }
+    int64_t counter = (int64_t) jsdrv_time_to_counter(time_map, utc);
+    *sample_id = (counter < 1) ? 1 : (uint64_t) counter;
+    return 0;
+}
+
+static inline uint64_t decimate_factor(const struct jsdrv_stream_signal_s * s) {
+    return s->decimate_factor ? s->decimate_factor : 1;
+}
+
+bool jsdrv_stream_gate_flush(const struct jsdrv_stream_gate_s * self, const struct jsdrv_stream_signal_s * s) {
+    if (!self->stop || !s->element_count || (s->sample_id >= self->stop)) {
+        return false;
+    }
+    return (s->sample_id + s->element_count * decimate_factor(s)) >= self->stop;
+}
+
+// Move elements [skip, count) to the start of data, with LSB-first packing for sub-byte elements.
+static void data_shift(uint8_t * data, uint32_t element_size_bits, uint32_t skip, uint32_t count) {
+    uint64_t bit_offset = (uint64_t) skip * element_size_bits;
+    uint32_t offset = (uint32_t) (bit_offset >> 3);
+    uint32_t shift = (uint32_t) (bit_offset & 7);
+    uint32_t src_size = (uint32_t) (((uint64_t) count * element_size_bits + 7) / 8);
+    uint32_t dst_size = src_size - offset;
+    if (0 == shift) {
+        memmove(data, data + offset, dst_size);
+        return;
+    }
+    for (uint32_t i = 0; i < dst_size; ++i) {
+        uint32_t k = offset + i;
+        uint8_t hi = ((k + 1) < src_size) ? data[k + 1] : 0;
+        data[i] = (uint8_t) ((data[k] >> shift) | (hi << (8 - shift)));
+    }
+}
+
+uint32_t jsdrv_stream_gate_apply(const struct jsdrv_stream_gate_s * self, struct jsdrv_stream_signal_s * s) {
+    uint64_t df = decimate_factor(s);
+    uint32_t count = s->element_count;
+    if (self->stop) {
+        if (s->sample_id >= self->stop) {
+            count = 0;
+        } else {
+            uint64_t n = (self->stop - s->sample_id + df - 1) / df;
+            if (n < count) {
+                count = (uint32_t) n;
+            }
+        }
+    }
+    uint32_t skip = 0;
+    if (self->start > s->sample_id) {
+        uint64_t n = (self->start - s->sample_id + df - 1) / df;
+        skip = (n > count) ? count : (uint32_t) n;
+    }
+    if (skip && (skip < count)) {
+        data_shift(s->data, s->element_size_bits, skip, count);
+    }
+    s->sample_id += skip * df;
+    s->element_count = count - skip;
+    return s->element_count;
+}
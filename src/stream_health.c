@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/stream_health.h"
+#include "tinyprintf.h"
+#include <string.h>
+
+
+void jsdrv_stream_health_clear(struct jsdrv_stream_health_s * self) {
+    memset(self, 0, sizeof(*self));
+}
+
+uint32_t jsdrv_stream_health_json(const struct jsdrv_stream_health_s * self, char * buf, uint32_t size) {
+    char * p = buf;
+    char * p_end = buf + size;
+    uint32_t written = 0;
+    int n;
+    if (!buf || (size < 3)) {
+        return 0;
+    }
+    n = tfp_snprintf(p, p_end - p,
+                     "{\"frames\": %llu, \"bytes\": %llu, \"frame_id_mismatch\": %u, \"frames_lost\": %llu, "
+                     "\"inactive\": %llu, \"discard\": %llu, \"ports\": [",
+                     (unsigned long long) self->frames, (unsigned long long) self->bytes,
+                     (unsigned int) self->frame_id_mismatch, (unsigned long long) self->frames_lost,
+                     (unsigned long long) self->inactive, (unsigned long long) self->discard);
+    if ((n < 0) || (n >= (p_end - p))) {
+        return 0;
+    }
+    p += n;
+    for (uint32_t i = 0; i < JSDRV_STREAM_HEALTH_PORTS; ++i) {
+        const struct jsdrv_stream_health_port_s * s = &self->port[i];
+        if (!s->frames) {
+            continue;
+        }
+        n = tfp_snprintf(p, p_end - p,
+                         "%s{\"port\": %u, \"frames\": %llu, \"samples\": %llu, \"skips\": %u, \"skip_samples\": %llu, "
+                         "\"dups\": %u, \"dup_samples\": %llu, \"resyncs\": %u, \"drops\": %u}",
+                         written ? ", " : "", (unsigned int) i,
+                         (unsigned long long) s->frames, (unsigned long long) s->samples,
+                         (unsigned int) s->skips, (unsigned long long) s->skip_samples,
+                         (unsigned int) s->dups, (unsigned long long) s->dup_samples,
+                         (unsigned int) s->resyncs, (unsigned int) s->drops);
+        if ((n < 0) || (n >= (p_end - p))) {
+            return 0;
+        }
+        p += n;
+        ++written;
+    }
+    if ((p_end - p) < 3) {
+        return 0;
+    }
+    *p++ = ']';
+    *p++ = '}';
+    *p = 0;
+    return (uint32_t) (p - buf);
+}
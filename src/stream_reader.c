@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#include "jsdrv/stream_reader.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/platform.h"
+
+
+#define CAPACITY_MIN        (1U << 18)
+#define CAPACITY_MAX        (1U << 30)
+
+struct jsdrv_stream_reader_s {
+    struct jsdrv_context_s * context;
+    struct jsdrv_stream_ring_s * ring;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+};
+
+static uint32_t capacity_round(uint32_t capacity) {
+    if (0 == capacity) {
+        return JSDRV_STREAM_READER_CAPACITY_DEFAULT;
+    }
+    uint32_t size = CAPACITY_MIN;
+    while ((size < capacity) && (size < CAPACITY_MAX)) {
+        size <<= 1;
+    }
+    return size;
+}
+
+int32_t jsdrv_stream_reader_open(struct jsdrv_context_s * context, const char * topic,
+                                 uint32_t capacity, struct jsdrv_stream_reader_s ** reader) {
+    if (!context || !topic || !topic[0] || !reader) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    *reader = NULL;
+    struct jsdrv_stream_reader_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_stream_reader_s));
+    self->context = context;
+    if (jsdrv_cstr_copy(self->topic, topic, sizeof(self->topic))) {
+        jsdrv_free(self);
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    self->ring = jsdrv_stream_ring_alloc(capacity_round(capacity));
+    if (!self->ring) {
+        jsdrv_free(self);
+        return JSDRV_ERROR_NOT_ENOUGH_MEMORY;
+    }
+    int32_t rc = jsdrv_subscribe(context, self->topic, JSDRV_SFLAG_PUB, jsdrv_stream_ring_on_publish, self->ring,
+                                 JSDRV_TIMEOUT_MS_DEFAULT);
+    if (rc) {
+        JSDRV_LOGW("stream_reader subscribe %s failed: %d", self->topic, (int) rc);
+        jsdrv_stream_ring_free(self->ring);
+        jsdrv_free(self);
+        return rc;
+    }
+    *reader = self;
+    return 0;
+}
+
+int32_t jsdrv_stream_reader_close(struct jsdrv_stream_reader_s * self) {
+    if (!self) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    int32_t rc = jsdrv_unsubscribe(self->context, self->topic, jsdrv_stream_ring_on_publish, self->ring,
+                                   JSDRV_TIMEOUT_MS_DEFAULT);
+    if (rc) {
+        // the frontend may still write to the ring, so leak it rather than risk corruption
+        JSDRV_LOGW("stream_reader unsubscribe %s failed: %d", self->topic, (int) rc);
+    } else {
+        jsdrv_stream_ring_free(self->ring);
+    }
+    jsdrv_free(self);
+    return rc;
+}
+
+int32_t jsdrv_stream_read(struct jsdrv_stream_reader_s * self, void * buffer, uint32_t max_samples,
+                          struct jsdrv_stream_ring_info_s * info, uint32_t timeout_ms) {
+    if (!self || !buffer || !max_samples || !info) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    // The element size is only known from the next message.
+    int32_t rc = jsdrv_stream_ring_peek(self->ring, info, timeout_ms);
+    if (rc) {
+        return rc;
+    }
+    uint32_t element_size = info->element_size_bits / 8;
+    if (max_samples > (UINT32_MAX / element_size)) {
+        max_samples = UINT32_MAX / element_size;
+    }
+    return jsdrv_stream_ring_read(self->ring, buffer, max_samples * element_size, info, 0);
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define JSDRV_LOG_LEVEL JSDRV_LOG_LEVEL_ALL
+#include "jsdrv/stream_ring.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/unpack.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/log.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include <stddef.h>
+#include <string.h>
+
+
+#define RING_SIZE_MIN       (1U << 18)
+#define RING_SIZE_MAX       (1U << 30)
+#define RECORD_TYPE_DATA    (1U)
+#define RECORD_TYPE_PAD     (2U)            // skip to the ring start
+#define CACHE_LINE_SIZE     (64U)
+
+JSDRV_STATIC_ASSERT(JSDRV_STREAM_HEADER_SIZE == offsetof(struct jsdrv_stream_signal_s, data), stream_header_size);
+
+struct record_s {
+    uint32_t length;                        // total record length in bytes, multiple of 8
+    uint32_t type;
+    uint8_t signal[JSDRV_STREAM_HEADER_SIZE];  // jsdrv_stream_signal_s, followed by the data
+};
+
+struct jsdrv_stream_ring_s {
+    volatile uint32_t head;                 // producer: end of the last complete record
+    volatile uint32_t drops;                // producer: total dropped messages
+    uint8_t rsv1[CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+    volatile uint32_t tail;                 // consumer: start of the next record
+    uint32_t element_offset;                // consumer: elements already read from the tail record
+    uint32_t drops_read;                    // consumer: drops at the previous read
+    uint8_t rsv2[CACHE_LINE_SIZE - 3 * sizeof(uint32_t)];
+    uint32_t size;
+    uint8_t * data;
+};
+
+
+struct jsdrv_stream_ring_s * jsdrv_stream_ring_alloc(uint32_t size) {
+    if ((size < RING_SIZE_MIN) || (size > RING_SIZE_MAX) || (size & (size - 1))) {
+        JSDRV_LOGE("stream_ring size must be a power of 2 from 256 kB to 1 GB: %u", (unsigned int) size);
+        return NULL;
+    }
+    struct jsdrv_stream_ring_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_stream_ring_s));
+    self->size = size;
+    self->data = jsdrv_alloc_aligned(size, JSDRV_ALLOC_ALIGNMENT);
+    return self;
+}
+
+void jsdrv_stream_ring_free(struct jsdrv_stream_ring_s * self) {
+    if (self) {
+        jsdrv_free(self->data);
+        jsdrv_free(self);
+    }
+}
+
+static inline uint32_t payload_size(const struct jsdrv_stream_signal_s * s) {
+    return (uint32_t) ((((uint64_t) s->element_count) * s->element_size_bits + 7) / 8);
+}
+
+void jsdrv_stream_ring_on_publish(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) topic;
+    struct jsdrv_stream_ring_s * self = (struct jsdrv_stream_ring_s *) user_data;
+    if ((value->type != JSDRV_UNION_BIN) || (value->app != JSDRV_PAYLOAD_TYPE_STREAM)
+            || (value->size < JSDRV_STREAM_HEADER_SIZE)) {
+        return;
+    }
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) value->value.bin;
+    uint32_t payload = payload_size(s);
+    if (payload > (value->size - JSDRV_STREAM_HEADER_SIZE)) {
+        JSDRV_LOGW("stream_ring: truncated message");
+        return;
+    }
+    uint32_t length = (uint32_t) ((sizeof(struct record_s) + payload + 7) & ~7U);
+    uint32_t head = self->head;
+    uint32_t tail = jsdrv_atomic_load_u32(&self->tail);
+    uint32_t offset = head & (self->size - 1);
+    uint32_t contiguous = self->size - offset;
+    uint32_t pad = (contiguous < length) ? contiguous : 0;
+    if ((self->size - (head - tail)) < (pad + length)) {
+        jsdrv_atomic_add_u32(&self->drops, 1);
+        return;
+    }
+    if (pad) {
+        struct record_s * r = (struct record_s *) (self->data + offset);
+        r->length = pad;
+        r->type = RECORD_TYPE_PAD;
+        head += pad;
+        offset = 0;
+    }
+    struct record_s * r = (struct record_s *) (self->data + offset);
+    r->length = length;
+    r->type = RECORD_TYPE_DATA;
+    memcpy(r->signal, s, JSDRV_STREAM_HEADER_SIZE + payload);
+    jsdrv_atomic_store_u32(&self->head, head + length);
+}
+
+// Readers see deadband hold records as float32 samples of the hold mean.
+static inline uint32_t record_count(const struct jsdrv_stream_signal_s * s) {
+    return (uint32_t) jsdrv_deadband_sample_count(s);  // holds are limited by JSDRV_DEADBAND_DURATION_MAX
+}
+
+static inline uint8_t record_type(const struct jsdrv_stream_signal_s * s) {
+    return jsdrv_deadband_hold(s) ? JSDRV_DATA_TYPE_FLOAT : s->element_type;
+}
+
+static inline uint8_t record_bits(const struct jsdrv_stream_signal_s * s) {
+    if (jsdrv_deadband_hold(s)) {
+        return 32;
+    }
+    return (s->element_size_bits < 8) ? 8 : s->element_size_bits;
+}
+
+static bool is_contiguous(const struct jsdrv_stream_ring_info_s * info, const struct jsdrv_stream_signal_s * s) {
+    uint64_t sample_id = info->sample_id + ((uint64_t) info->element_count) * info->decimate_factor;
+    return (s->sample_id == sample_id)
+        && (s->field_id == info->field_id)
+        && (s->index == info->index)
+        && (record_type(s) == info->element_type)
+        && (record_bits(s) == info->element_size_bits)
+        && (s->sample_rate == info->sample_rate)
+        && ((s->decimate_factor ? s->decimate_factor : 1) == info->decimate_factor);
+}
+
+static void copy_elements(uint8_t * dst, const struct jsdrv_stream_signal_s * s, uint32_t offset, uint32_t count) {
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(s);
+    uint32_t bits = s->element_size_bits;
+    if (hold) {
+        float * f = (float *) dst;
+        for (uint32_t i = 0; i < count; ++i) {
+            f[i] = hold->mean;
+        }
+    } else if (4 == bits) {
+        jsdrv_u4_unpack(dst, s->data, offset, count);
+    } else if (1 == bits) {
+        jsdrv_u1_unpack(dst, s->data, offset, count);
+    } else {
+        memcpy(dst, s->data + offset * (bits / 8), count * (bits / 8));
+    }
+}
+
+// Get the next data record, skipping pad records.
+static const struct record_s * record_next(struct jsdrv_stream_ring_s * self, uint32_t timeout_ms) {
+    uint32_t t_start = jsdrv_time_ms_u32();
+    while (1) {
+        uint32_t tail = self->tail;
+        if (tail == jsdrv_atomic_load_u32(&self->head)) {
+            if ((jsdrv_time_ms_u32() - t_start) >= timeout_ms) {
+                return NULL;
+            }
+            jsdrv_thread_sleep_ms(1);
+            continue;
+        }
+        const struct record_s * r = (const struct record_s *) (self->data + (tail & (self->size - 1)));
+        if (r->type != RECORD_TYPE_PAD) {
+            return r;
+        }
+        jsdrv_atomic_store_u32(&self->tail, tail + r->length);
+    }
+}
+
+static void info_start(struct jsdrv_stream_ring_s * self, struct jsdrv_stream_ring_info_s * info,
+                       const struct jsdrv_stream_signal_s * s) {
+    info->field_id = s->field_id;
+    info->index = s->index;
+    info->element_type = record_type(s);
+    info->element_size_bits = record_bits(s);
+    info->sample_rate = s->sample_rate;
+    info->decimate_factor = s->decimate_factor ? s->decimate_factor : 1;
+    info->sample_id = s->sample_id + ((uint64_t) self->element_offset) * info->decimate_factor;
+    info->time_map = s->time_map;
+}
+
+int32_t jsdrv_stream_ring_peek(struct jsdrv_stream_ring_s * self,
+                               struct jsdrv_stream_ring_info_s * info, uint32_t timeout_ms) {
+    if (!self || !info) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    memset(info, 0, sizeof(*info));
+    const struct record_s * r = record_next(self, timeout_ms);
+    if (NULL == r) {
+        return JSDRV_ERROR_TIMED_OUT;
+    }
+    const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) r->signal;
+    info_start(self, info, s);
+    info->element_count = record_count(s) - self->element_offset;
+    info->message_count = 1;
+    return 0;
+}
+
+int32_t jsdrv_stream_ring_read(struct jsdrv_stream_ring_s * self, void * buffer, uint32_t buffer_size,
+                               struct jsdrv_stream_ring_info_s * info, uint32_t timeout_ms) {
+    if (!self || !buffer || !buffer_size || !info) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    memset(info, 0, sizeof(*info));
+    uint8_t * dst = (uint8_t *) buffer;
+
+    while (1) {
+        const struct record_s * r = record_next(self, info->message_count ? 0 : timeout_ms);
+        if (NULL == r) {
+            if (0 == info->message_count) {
+                return JSDRV_ERROR_TIMED_OUT;
+            }
+            break;
+        }
+        const struct jsdrv_stream_signal_s * s = (const struct jsdrv_stream_signal_s *) r->signal;
+        if (0 == info->message_count) {
+            info_start(self, info, s);
+        } else if (!is_contiguous(info, s)) {
+            break;
+        }
+        uint32_t element_size = info->element_size_bits / 8;
+        uint32_t count = record_count(s) - self->element_offset;
+        uint32_t count_max = (buffer_size / element_size) - info->element_count;
+        if (count > count_max) {
+            count = count_max;
+        }
+        if (count) {
+            copy_elements(dst + info->element_count * element_size, s, self->element_offset, count);
+        }
+        info->element_count += count;
+        info->time_map = s->time_map;
+        ++info->message_count;
+        self->element_offset += count;
+        if (self->element_offset < record_count(s)) {
+            break;  // buffer full, continue this message on the next read
+        }
+        self->element_offset = 0;
+        jsdrv_atomic_store_u32(&self->tail, self->tail + r->length);
+    }
+
+    uint32_t drops = jsdrv_atomic_load_u32(&self->drops);
+    info->drops = drops - self->drops_read;
+    self->drops_read = drops;
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "jsdrv_prv/thread_stats.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/thread.h"
+#include <string.h>
+
+
+struct entry_s {
+    uint32_t id;  // 0 when unused
+    char name[JSDRV_THREAD_STATS_NAME_SIZE];
+    jsdrv_thread_cpu_t cpu;
+};
+
+// Threads register rarely, so a spin lock keeps this usable before
+// and after any jsdrv_context_s exists.
+static volatile uint32_t lock_ = 0;
+static uint32_t id_next_ = 1;
+static struct entry_s entries_[JSDRV_THREAD_STATS_MAX];
+static JSDRV_THREAD_LOCAL uint32_t id_ = 0;
+
+static void lock(void) {
+    while (!jsdrv_atomic_cas_u32(&lock_, 0, 1)) {
+        ;  // spin
+    }
+}
+
+static void unlock(void) {
+    jsdrv_atomic_store_u32(&lock_, 0);
+}
+
+static struct entry_s * entry_find(uint32_t id) {
+    for (uint32_t idx = 0; idx < JSDRV_THREAD_STATS_MAX; ++idx) {
+        if (id && (entries_[idx].id == id)) {
+            return &entries_[idx];
+        }
+    }
+    return NULL;
+}
+
+int32_t jsdrv_thread_stats_register(const char * name) {
+    if (!name) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    int32_t rc = 0;
+    lock();
+    struct entry_s * e = entry_find(id_);
+    if (e) {
+        jsdrv_cstr_copy(e->name, name, sizeof(e->name));
+        unlock();
+        return 0;
+    }
+    for (uint32_t idx = 0; idx < JSDRV_THREAD_STATS_MAX; ++idx) {
+        if (!entries_[idx].id) {
+            e = &entries_[idx];
+            break;
+        }
+    }
+    if (!e) {
+        rc = JSDRV_ERROR_FULL;
+    } else {
+        rc = jsdrv_thread_cpu_open(&e->cpu);
+        if (!rc) {
+            e->id = id_next_++;
+            jsdrv_cstr_copy(e->name, name, sizeof(e->name));
+            id_ = e->id;
+        }
+    }
+    unlock();
+    return rc;
+}
+
+uint32_t jsdrv_thread_stats_sample(struct jsdrv_thread_stats_s * stats, uint32_t count) {
+    struct entry_s * order[JSDRV_THREAD_STATS_MAX];
+    uint32_t order_count = 0;
+    uint32_t rv = 0;
+    lock();
+    for (uint32_t idx = 0; idx < JSDRV_THREAD_STATS_MAX; ++idx) {
+        if (entries_[idx].id) {
+            // insertion sort by id, which is the registration order
+            uint32_t k = order_count++;
+            for (; k && (order[k - 1]->id > entries_[idx].id); --k) {
+                order[k] = order[k - 1];
+            }
+            order[k] = &entries_[idx];
+        }
+    }
+    for (uint32_t idx = 0; idx < order_count; ++idx) {
+        struct entry_s * e = order[idx];
+        uint64_t cpu_ns = 0;
+        if (jsdrv_thread_cpu_time(e->cpu, &cpu_ns)) {
+            jsdrv_thread_cpu_close(e->cpu);  // thread exited
+            e->id = 0;
+        } else if (rv < count) {
+            stats[rv].id = e->id;
+            jsdrv_cstr_copy(stats[rv].name, e->name, sizeof(stats[rv].name));
+            stats[rv].cpu_ns = cpu_ns;
+            ++rv;
+        }
+    }
+    unlock();
+    return rv;
+}
@@ -69,3 +69,31 @@ uint64_t jsdrv_time_to_counter(const struct jsdrv_time_map_s * self, int64_t tim
     counter += self->offset_counter;
     return counter;
 }
+
+void jsdrv_time_from_counter_array(const struct jsdrv_time_map_s * self,
+        const uint64_t * counter, int64_t * time64, size_t length) {
+    double scale = (double) JSDRV_TIME_SECOND / self->counter_rate;
+    for (size_t i = 0; i < length; ++i) {
+        int64_t delta = (int64_t) (counter[i] - self->offset_counter);
+        time64[i] = ((int64_t) round(scale * (double) delta)) + self->offset_time;
+    }
+}
+
+void jsdrv_time_to_counter_array(const struct jsdrv_time_map_s * self,
+        const int64_t * time64, uint64_t * counter, size_t length) {
+    double scale = self->counter_rate / (double) JSDRV_TIME_SECOND;
+    for (size_t i = 0; i < length; ++i) {
+        int64_t delta = time64[i] - self->offset_time;
+        counter[i] = ((int64_t) round(scale * (double) delta)) + self->offset_counter;
+    }
+}
+
+void jsdrv_time_from_counter_range(const struct jsdrv_time_map_s * self,
+        uint64_t counter_start, uint64_t counter_step, int64_t * time64, size_t length) {
+    double scale = (double) JSDRV_TIME_SECOND / self->counter_rate;
+    int64_t delta = (int64_t) (counter_start - self->offset_counter);
+    for (size_t i = 0; i < length; ++i) {
+        time64[i] = ((int64_t) round(scale * (double) delta)) + self->offset_time;
+        delta += (int64_t) counter_step;
+    }
+}
@@ -17,6 +17,7 @@
 #include "jsdrv_prv/time_map_filter.h"
 #include "jsdrv_prv/platform.h"
 #include <inttypes.h>
+#include <stdbool.h>
 
 
 struct tmf_point_s {
@@ -24,32 +25,54 @@ struct tmf_point_s {
     int64_t utc;
 };
 
+// A sliding window minimum candidate.
+struct tmf_min_s {
+    int64_t key;     // utc - time(counter - counter_ref)
+    uint64_t seq;    // the point sequence number
+};
+
 
 struct jsdrv_tmf_s {
     struct jsdrv_time_map_s time_map;
     int64_t interval;
+    uint32_t counter_rate;   // the nominal counter rate
+    bool rate_estimate;
+    double rate_error;       // the relative counter rate error estimate
+    double rate_variance;    // the rate_error variance, 0 before the first fit
     uint32_t points_max;
     uint32_t points_valid;
     uint32_t head;
     int64_t utc_prev;
+    uint64_t seq;            // the points added since clear
+    uint64_t seq_rebuild;    // seq at the last rebuild of mins
+    uint64_t counter_ref;    // the counter for tmf_min_s.key
+    struct tmf_min_s * mins; // points_max entries, monotonic deque with the minimum key first
+    uint32_t mins_head;
+    uint32_t mins_size;
     struct tmf_point_s points[];
 };
 
+#define RATE_ERROR_MAX (0.01)         // reject rate fits farther from nominal
+#define RATE_DRIFT (0.1e-6)           // the relative rate change between fits, 1 sigma
+#define RATE_VARIANCE_MIN (1e-18)
+
 
 struct jsdrv_tmf_s * jsdrv_tmf_new(uint32_t counter_rate, uint32_t points, int64_t interval) {
     if ((counter_rate == 0) || (points == 0) || (interval < JSDRV_TIME_MICROSECOND)) {
         return NULL;
     }
 
-    size_t sz = sizeof(struct jsdrv_tmf_s) + sizeof(struct tmf_point_s) * points;
+    size_t sz = sizeof(struct jsdrv_tmf_s) + (sizeof(struct tmf_point_s) + sizeof(struct tmf_min_s)) * points;
     struct jsdrv_tmf_s * self = jsdrv_alloc(sz);
     if (NULL == self) {
         return NULL;
     }
     memset(self, 0, sz);
     self->time_map.counter_rate = counter_rate;
+    self->counter_rate = counter_rate;
     self->interval = interval;
     self->points_max = points;
+    self->mins = (struct tmf_min_s *) &self->points[points];
     return self;
 }
 
@@ -65,8 +88,133 @@ void jsdrv_tmf_clear(struct jsdrv_tmf_s * self) {
         self->points_valid = 0;
         self->time_map.offset_time = 0;
         self->time_map.offset_counter = 0;
+        self->time_map.counter_rate = self->counter_rate;
         self->utc_prev = 0;
+        self->seq = 0;
+        self->seq_rebuild = 0;
+        self->rate_error = 0.0;
+        self->rate_variance = 0.0;
+        self->mins_head = 0;
+        self->mins_size = 0;
+    }
+}
+
+void jsdrv_tmf_rate_estimate(struct jsdrv_tmf_s * self, bool enable) {
+    if (NULL != self) {
+        self->rate_estimate = enable;
+        jsdrv_tmf_clear(self);
+    }
+}
+
+static int64_t counter_to_time(struct jsdrv_tmf_s * self, uint64_t counter_delta) {
+    if (self->time_map.counter_rate == (double) self->counter_rate) {
+        return JSDRV_COUNTER_TO_TIME(counter_delta, self->counter_rate);
     }
+    return (int64_t) (((double) counter_delta) * ((double) JSDRV_TIME_SECOND / self->time_map.counter_rate));
+}
+
+static uint32_t point_tail(struct jsdrv_tmf_s * self) {
+    uint32_t tail = self->points_max + self->head - self->points_valid;
+    if (tail >= self->points_max) {
+        tail -= self->points_max;
+    }
+    return tail;
+}
+
+static void mins_push(struct jsdrv_tmf_s * self, const struct tmf_point_s * p, uint64_t seq) {
+    int64_t key = p->utc - counter_to_time(self, p->counter - self->counter_ref);
+    while (self->mins_size) {
+        uint32_t back = (self->mins_head + self->mins_size - 1) % self->points_max;
+        if (self->mins[back].key < key) {
+            break;
+        }
+        --self->mins_size;  // never the minimum again
+    }
+    struct tmf_min_s * m = &self->mins[(self->mins_head + self->mins_size) % self->points_max];
+    m->key = key;
+    m->seq = seq;
+    ++self->mins_size;
+}
+
+// Fit counter_rate to the points with least squares, then fuse the fit
+// into the rate estimate with a scalar Kalman filter.
+static void rate_update(struct jsdrv_tmf_s * self) {
+    uint32_t tail = point_tail(self);
+    const struct tmf_point_s * p0 = &self->points[tail];
+    double n = self->points_valid;
+    if (n < 3) {
+        return;
+    }
+    double x_mean = 0.0;
+    double y_mean = 0.0;
+    uint32_t idx = tail;
+    for (uint32_t i = 0; i < self->points_valid; ++i) {
+        const struct tmf_point_s * p = &self->points[idx];
+        x_mean += (double) (p->counter - p0->counter);
+        y_mean += (double) (p->utc - p0->utc);
+        if (++idx >= self->points_max) {
+            idx = 0;
+        }
+    }
+    x_mean /= n;
+    y_mean /= n;
+    double sxx = 0.0;
+    double sxy = 0.0;
+    double syy = 0.0;
+    idx = tail;
+    for (uint32_t i = 0; i < self->points_valid; ++i) {
+        const struct tmf_point_s * p = &self->points[idx];
+        double x = (double) (p->counter - p0->counter) - x_mean;
+        double y = (double) (p->utc - p0->utc) - y_mean;
+        sxx += x * x;
+        sxy += x * y;
+        syy += y * y;
+        if (++idx >= self->points_max) {
+            idx = 0;
+        }
+    }
+    if ((sxx <= 0.0) || (sxy <= 0.0)) {
+        return;
+    }
+    double slope = sxy / sxx;  // time per count
+    double sse = syy - slope * sxy;
+    if (sse < 0.0) {
+        sse = 0.0;
+    }
+    double error = ((double) JSDRV_TIME_SECOND / slope) / self->counter_rate - 1.0;
+    if ((error > RATE_ERROR_MAX) || (error < -RATE_ERROR_MAX)) {
+        return;  // reject
+    }
+    // relative variance of the fit, from the residuals
+    double r = (sse / (n - 2.0)) / (sxx * slope * slope);
+    if (r < RATE_VARIANCE_MIN) {
+        r = RATE_VARIANCE_MIN;
+    }
+    if (self->rate_variance <= 0.0) {
+        self->rate_error = error;
+        self->rate_variance = r;
+    } else {
+        self->rate_variance += RATE_DRIFT * RATE_DRIFT;
+        double k = self->rate_variance / (self->rate_variance + r);
+        self->rate_error += k * (error - self->rate_error);
+        self->rate_variance *= (1.0 - k);
+    }
+    self->time_map.counter_rate = self->counter_rate * (1.0 + self->rate_error);
+}
+
+// Recompute the window minimum candidates, O(points).
+static void mins_rebuild(struct jsdrv_tmf_s * self) {
+    uint32_t idx = point_tail(self);
+    self->counter_ref = self->points[idx].counter;
+    self->mins_head = 0;
+    self->mins_size = 0;
+    for (uint64_t seq = self->seq - self->points_valid; seq < self->seq; ++seq) {
+        mins_push(self, &self->points[idx], seq);
+        if (++idx >= self->points_max) {
+            idx = 0;
+        }
+    }
+    self->seq_rebuild = self->seq;
 }
 
 void jsdrv_tmf_add(struct jsdrv_tmf_s * self, uint64_t counter, int64_t utc) {
@@ -78,8 +226,9 @@ void jsdrv_tmf_add(struct jsdrv_tmf_s * self, uint64_t counter, int64_t utc) {
     }
 
     // add new point
-    self->points[self->head].counter = counter;
-    self->points[self->head].utc = utc;
+    struct tmf_point_s * p = &self->points[self->head];
+    p->counter = counter;
+    p->utc = utc;
     self->utc_prev = utc;
     ++self->head;
     if (self->head >= self->points_max) {
@@ -88,28 +237,32 @@ void jsdrv_tmf_add(struct jsdrv_tmf_s * self, uint64_t counter, int64_t utc) {
     if (self->points_valid < self->points_max) {
         ++self->points_valid;
     }
+    ++self->seq;
 
-    // update time map
-    uint32_t tail = self->points_max + self->head - self->points_valid;
-    if (tail >= self->points_max) {
-        tail -= self->points_max;
+    // update the window minimum, O(1) amortized
+    if (1 == self->seq) {
+        self->counter_ref = counter;
+        self->seq_rebuild = self->seq;
     }
-    uint64_t counter_offset = self->points[tail].counter;
-    int64_t utc_est = self->points[tail].utc;
-    while (tail != self->head) {
-        uint64_t counter_delta = self->points[tail].counter - counter_offset;
-        int64_t utc_delta = JSDRV_COUNTER_TO_TIME(counter_delta, (uint64_t) self->time_map.counter_rate);
-        int64_t utc_est1 = self->points[tail].utc - utc_delta;
-        if (utc_est1 < utc_est) {
-            utc_est = utc_est1;
-        }
-        ++tail;
-        if (tail >= self->points_max) {
-            tail = 0;
+    if (self->rate_estimate && ((self->seq - self->seq_rebuild) >= self->points_max)) {
+        rate_update(self);
+        mins_rebuild(self);  // the keys depend upon counter_rate
+    } else {
+        mins_push(self, p, self->seq - 1);
+        uint64_t seq_tail = self->seq - self->points_valid;
+        while (self->mins[self->mins_head].seq < seq_tail) {
+            if (++self->mins_head >= self->points_max) {
+                self->mins_head = 0;
+            }
+            --self->mins_size;
         }
     }
+
+    // update time map
+    uint64_t counter_offset = self->points[point_tail(self)].counter;
     self->time_map.offset_counter = counter_offset;
-    self->time_map.offset_time = utc_est;
+    self->time_map.offset_time = self->mins[self->mins_head].key
+        + counter_to_time(self, counter_offset - self->counter_ref);
 }
 
 void jsdrv_tmf_get(struct jsdrv_tmf_s * self, struct jsdrv_time_map_s * time_map) {
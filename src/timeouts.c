@@ -0,0 +1,201 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/timeouts.h"
+#include "jsdrv_prv/list.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/cdef.h"
+#include <string.h>
+
+
+#define CAPACITY_INIT (16U)                 // power of 2
+#define HASH_FNV_OFFSET (2166136261U)
+#define HASH_FNV_PRIME (16777619U)
+
+struct jsdrv_timeouts_s {
+    uint32_t size;
+    uint32_t capacity;                      // heap entries and hash buckets, power of 2
+    uint32_t seq;
+    struct jsdrvp_api_timeout_s ** heap;
+    struct jsdrv_list_s * buckets;
+};
+
+static uint32_t topic_hash(const char * topic) {
+    uint32_t h = HASH_FNV_OFFSET;
+    while (*topic) {
+        h ^= (uint8_t) *topic++;
+        h *= HASH_FNV_PRIME;
+    }
+    return h;
+}
+
+static inline bool is_before(struct jsdrvp_api_timeout_s * a, struct jsdrvp_api_timeout_s * b) {
+    if (a->timeout != b->timeout) {
+        return a->timeout < b->timeout;
+    }
+    return ((int32_t) (a->seq - b->seq)) < 0;
+}
+
+static inline void heap_set(struct jsdrv_timeouts_s * self, uint32_t idx, struct jsdrvp_api_timeout_s * t) {
+    self->heap[idx] = t;
+    t->heap_index = idx;
+}
+
+static void heap_sift_up(struct jsdrv_timeouts_s * self, uint32_t idx) {
+    struct jsdrvp_api_timeout_s * t = self->heap[idx];
+    while (idx) {
+        uint32_t parent = (idx - 1) >> 1;
+        if (!is_before(t, self->heap[parent])) {
+            break;
+        }
+        heap_set(self, idx, self->heap[parent]);
+        idx = parent;
+    }
+    heap_set(self, idx, t);
+}
+
+static void heap_sift_down(struct jsdrv_timeouts_s * self, uint32_t idx) {
+    struct jsdrvp_api_timeout_s * t = self->heap[idx];
+    while (1) {
+        uint32_t child = (idx << 1) + 1;
+        if (child >= self->size) {
+            break;
+        }
+        if (((child + 1) < self->size) && is_before(self->heap[child + 1], self->heap[child])) {
+            ++child;
+        }
+        if (!is_before(self->heap[child], t)) {
+            break;
+        }
+        heap_set(self, idx, self->heap[child]);
+        idx = child;
+    }
+    heap_set(self, idx, t);
+}
+
+static void buckets_init(struct jsdrv_list_s * buckets, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        jsdrv_list_initialize(&buckets[i]);
+    }
+}
+
+static void grow(struct jsdrv_timeouts_s * self) {
+    uint32_t capacity = self->capacity * 2;
+    struct jsdrvp_api_timeout_s ** heap = jsdrv_alloc(capacity * sizeof(*heap));
+    memcpy(heap, self->heap, self->size * sizeof(*heap));
+    jsdrv_free(self->heap);
+    self->heap = heap;
+
+    // rehash each bucket in order, which preserves insertion order within each topic
+    struct jsdrv_list_s * buckets = jsdrv_alloc(capacity * sizeof(*buckets));
+    buckets_init(buckets, capacity);
+    struct jsdrv_list_s * prev = self->buckets;
+    for (uint32_t i = 0; i < self->capacity; ++i) {
+        struct jsdrv_list_s * item;
+        while (NULL != (item = jsdrv_list_remove_head(&prev[i]))) {
+            struct jsdrvp_api_timeout_s * t = JSDRV_CONTAINER_OF(item, struct jsdrvp_api_timeout_s, item);
+            struct jsdrv_list_s * bucket = &buckets[t->hash & (capacity - 1)];
+            jsdrv_list_add_tail(bucket, item);
+        }
+    }
+    jsdrv_free(prev);
+    self->buckets = buckets;
+    self->capacity = capacity;
+}
+
+struct jsdrv_timeouts_s * jsdrv_timeouts_alloc(void) {
+    struct jsdrv_timeouts_s * self = jsdrv_alloc_clr(sizeof(struct jsdrv_timeouts_s));
+    self->capacity = CAPACITY_INIT;
+    self->heap = jsdrv_alloc_clr(CAPACITY_INIT * sizeof(*self->heap));
+    self->buckets = jsdrv_alloc(CAPACITY_INIT * sizeof(*self->buckets));
+    buckets_init(self->buckets, CAPACITY_INIT);
+    return self;
+}
+
+void jsdrv_timeouts_free(struct jsdrv_timeouts_s * self) {
+    if (self) {
+        jsdrv_free(self->heap);
+        jsdrv_free(self->buckets);
+        jsdrv_free(self);
+    }
+}
+
+uint32_t jsdrv_timeouts_size(struct jsdrv_timeouts_s * self) {
+    return self->size;
+}
+
+void jsdrv_timeouts_add(struct jsdrv_timeouts_s * self, struct jsdrvp_api_timeout_s * timeout) {
+    if (self->size >= self->capacity) {
+        grow(self);
+    }
+    timeout->hash = topic_hash(timeout->topic);
+    timeout->seq = self->seq++;
+    jsdrv_list_initialize(&timeout->item);
+    jsdrv_list_add_tail(&self->buckets[timeout->hash & (self->capacity - 1)], &timeout->item);
+    uint32_t idx = self->size++;
+    heap_set(self, idx, timeout);
+    heap_sift_up(self, idx);
+}
+
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_peek(struct jsdrv_timeouts_s * self) {
+    return self->size ? self->heap[0] : NULL;
+}
+
+static void remove_entry(struct jsdrv_timeouts_s * self, struct jsdrvp_api_timeout_s * t) {
+    uint32_t idx = t->heap_index;
+    jsdrv_list_remove(&t->item);
+    --self->size;
+    if (idx != self->size) {
+        heap_set(self, idx, self->heap[self->size]);
+        if (idx && is_before(self->heap[idx], self->heap[(idx - 1) >> 1])) {
+            heap_sift_up(self, idx);
+        } else {
+            heap_sift_down(self, idx);
+        }
+    }
+    self->heap[self->size] = NULL;
+}
+
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_pop_expired(struct jsdrv_timeouts_s * self, int64_t t_now) {
+    struct jsdrvp_api_timeout_s * t = jsdrv_timeouts_peek(self);
+    if (!t || (t->timeout > t_now)) {
+        return NULL;
+    }
+    remove_entry(self, t);
+    return t;
+}
+
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_remove_topic(struct jsdrv_timeouts_s * self, const char * topic) {
+    struct jsdrv_list_s * item;
+    uint32_t hash = topic_hash(topic);
+    struct jsdrv_list_s * bucket = &self->buckets[hash & (self->capacity - 1)];
+    jsdrv_list_foreach(bucket, item) {
+        struct jsdrvp_api_timeout_s * t = JSDRV_CONTAINER_OF(item, struct jsdrvp_api_timeout_s, item);
+        if ((t->hash == hash) && (0 == strcmp(t->topic, topic))) {
+            remove_entry(self, t);
+            return t;
+        }
+    }
+    return NULL;
+}
+
+struct jsdrvp_api_timeout_s * jsdrv_timeouts_pop(struct jsdrv_timeouts_s * self) {
+    struct jsdrvp_api_timeout_s * t = jsdrv_timeouts_peek(self);
+    if (t) {
+        remove_entry(self, t);
+    }
+    return t;
+}
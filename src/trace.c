@@ -0,0 +1,175 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/trace.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include <stdio.h>
+#include <string.h>
+
+
+struct event_s {
+    int64_t timestamp;
+    const char * name;
+    uint32_t id;
+    uint8_t phase;
+    char detail[JSDRV_TRACE_DETAIL_SIZE];
+};
+
+struct ring_s {
+    volatile uint32_t head;   // total events recorded, written only by the owner thread
+    uint32_t tid;             // the trace thread id, starting at 1
+    struct event_s events[JSDRV_TRACE_RING_SIZE];
+};
+
+volatile uint32_t jsdrv_trace_active = 0;
+static struct ring_s * volatile rings_[JSDRV_TRACE_THREADS_MAX];
+static volatile uint32_t ring_count_ = 0;
+static JSDRV_THREAD_LOCAL struct ring_s * ring_ = NULL;
+static JSDRV_THREAD_LOCAL bool ring_full_ = false;
+
+void jsdrv_trace_enable(bool enable) {
+    jsdrv_atomic_store_u32(&jsdrv_trace_active, enable ? 1 : 0);
+}
+
+void jsdrv_trace_clear(void) {
+    uint32_t active = jsdrv_atomic_exchange_u32(&jsdrv_trace_active, 0);
+    uint32_t count = jsdrv_atomic_load_u32(&ring_count_);
+    for (uint32_t idx = 0; (idx < count) && (idx < JSDRV_TRACE_THREADS_MAX); ++idx) {
+        if (rings_[idx]) {
+            jsdrv_atomic_store_u32(&rings_[idx]->head, 0);
+        }
+    }
+    jsdrv_atomic_store_u32(&jsdrv_trace_active, active);
+}
+
+static struct ring_s * ring_alloc(void) {
+    if (ring_full_) {
+        return NULL;
+    }
+    uint32_t idx = jsdrv_atomic_add_u32(&ring_count_, 1) - 1;
+    if (idx >= JSDRV_TRACE_THREADS_MAX) {
+        ring_full_ = true;  // too many threads, do not trace this one
+        return NULL;
+    }
+    struct ring_s * r = jsdrv_alloc_clr(sizeof(struct ring_s));
+    r->tid = idx + 1;
+    jsdrv_atomic_fence();
+    rings_[idx] = r;
+    return r;
+}
+
+void jsdrv_trace_record(uint8_t phase, const char * name, const char * detail, uint32_t id) {
+    struct ring_s * r = ring_;
+    if (NULL == r) {
+        r = ring_alloc();
+        if (NULL == r) {
+            return;
+        }
+        ring_ = r;
+    }
+    uint32_t head = r->head;
+    struct event_s * e = &r->events[head & (JSDRV_TRACE_RING_SIZE - 1)];
+    e->timestamp = jsdrv_time_utc();
+    e->name = name;
+    e->id = id;
+    e->phase = phase;
+    if (detail) {
+        size_t i = 0;
+        for (; detail[i] && (i < (JSDRV_TRACE_DETAIL_SIZE - 1)); ++i) {
+            e->detail[i] = detail[i];
+        }
+        e->detail[i] = 0;
+    } else {
+        e->detail[0] = 0;
+    }
+    jsdrv_atomic_store_u32(&r->head, head + 1);
+}
+
+static void json_str(FILE * f, const char * s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        if ((*s == '"') || (*s == '\\')) {
+            fputc('\\', f);
+            fputc(*s, f);
+        } else if ((uint8_t) *s >= 0x20) {
+            fputc(*s, f);
+        }
+    }
+    fputc('"', f);
+}
+
+int32_t jsdrv_trace_export(const char * path) {
+    FILE * f = fopen(path, "w");
+    if (NULL == f) {
+        return JSDRV_ERROR_IO;
+    }
+    uint32_t active = jsdrv_atomic_exchange_u32(&jsdrv_trace_active, 0);
+    uint32_t count = jsdrv_atomic_load_u32(&ring_count_);
+    if (count > JSDRV_TRACE_THREADS_MAX) {
+        count = JSDRV_TRACE_THREADS_MAX;
+    }
+
+    // the earliest event is the time origin
+    int64_t t0 = INT64_MAX;
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        struct ring_s * r = rings_[idx];
+        uint32_t head = r ? jsdrv_atomic_load_u32(&r->head) : 0;
+        if (head) {
+            uint32_t tail = (head > JSDRV_TRACE_RING_SIZE) ? (head - JSDRV_TRACE_RING_SIZE) : 0;
+            int64_t t = r->events[tail & (JSDRV_TRACE_RING_SIZE - 1)].timestamp;
+            t0 = (t < t0) ? t : t0;
+        }
+    }
+
+    const char * sep = "\n";
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        struct ring_s * r = rings_[idx];
+        if (NULL == r) {
+            continue;
+        }
+        uint32_t head = jsdrv_atomic_load_u32(&r->head);
+        uint32_t tail = (head > JSDRV_TRACE_RING_SIZE) ? (head - JSDRV_TRACE_RING_SIZE) : 0;
+        fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"jsdrv %u\"}}",
+                sep, (unsigned int) r->tid, (unsigned int) r->tid);
+        sep = ",\n";
+        for (uint32_t k = tail; k != head; ++k) {
+            const struct event_s * e = &r->events[k & (JSDRV_TRACE_RING_SIZE - 1)];
+            double ts = JSDRV_TIME_TO_F64(e->timestamp - t0) * 1e6;
+            fprintf(f, "%s{\"name\": ", sep);
+            json_str(f, e->name);
+            fprintf(f, ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u", (char) e->phase, ts, (unsigned int) r->tid);
+            if (e->phase == JSDRV_TRACE_PHASE_INSTANT) {
+                fprintf(f, ", \"s\": \"t\"");
+            }
+            if (e->phase != JSDRV_TRACE_PHASE_END) {
+                fprintf(f, ", \"args\": {\"id\": %u, \"detail\": ", (unsigned int) e->id);
+                json_str(f, e->detail);
+                fprintf(f, "}");
+            }
+            fprintf(f, "}");
+        }
+    }
+    fprintf(f, "\n]}\n");
+    jsdrv_atomic_store_u32(&jsdrv_trace_active, active);
+    int rc = ferror(f);
+    fclose(f);
+    return rc ? JSDRV_ERROR_IO : 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "jsdrv_prv/trigger.h"
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv/unpack.h"
+
+
+#define CHUNK_LENGTH (256U)  // unpacked integer samples per scan
+
+
+void jsdrv_trigger_clear(struct jsdrv_trigger_s * self, uint8_t op, float threshold, uint64_t duration) {
+    self->op = op;
+    self->side = -1;
+    self->threshold = threshold;
+    self->duration = duration ? duration : 1;
+    self->held = 0;
+    self->edge = 0;
+    self->sample_id_next = 0;
+}
+
+static bool edge_match(const struct jsdrv_trigger_s * self) {
+    switch (self->op) {
+        case JSDRV_BUFFER_SEARCH_RISE: return self->side == 1;
+        case JSDRV_BUFFER_SEARCH_FALL: return self->side == 0;
+        case JSDRV_BUFFER_SEARCH_CROSS: return true;
+        default: return false;
+    }
+}
+
+static bool fire_check(struct jsdrv_trigger_s * self, uint64_t * fire) {
+    if (!self->held || (self->held < self->duration)) {
+        return false;
+    }
+    *fire = self->edge;
+    self->side = -1;
+    self->held = 0;
+    self->sample_id_next = 0;
+    return true;
+}
+
+// Scan samples x, where x[i] has sample_id + i * step.
+static bool scan(struct jsdrv_trigger_s * self, const float * x, uint32_t length,
+                 uint64_t sample_id, uint32_t step, uint64_t * fire) {
+    float t = self->threshold;
+    uint32_t i = 0;
+    while (i < length) {
+        if (self->side < 0) {
+            if (x[i] == x[i]) {
+                self->side = (x[i] > t) ? 1 : 0;
+            }
+            ++i;
+            continue;
+        }
+        // Find the next sample on the other side, but only as far as the
+        // candidate needs to hold.
+        uint32_t span = length - i;
+        if (self->held && ((self->duration - self->held) < span)) {
+            span = (uint32_t) (self->duration - self->held);
+        }
+        uint32_t k = self->side ? jsdrv_f32_find_le(x + i, span, t) : jsdrv_f32_find_gt(x + i, span, t);
+        if (k >= span) {
+            if (self->held) {
+                self->held += span;
+            }
+            i += span;
+        } else {
+            i += k;
+            self->side = self->side ? 0 : 1;
+            self->held = 0;
+            if (edge_match(self)) {
+                self->edge = sample_id + i * (uint64_t) step;
+                self->held = 1;
+            }
+            ++i;
+        }
+        if (fire_check(self, fire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool jsdrv_trigger_process(struct jsdrv_trigger_s * self, const struct jsdrv_stream_signal_s * src, uint64_t * fire) {
+    uint32_t step = src->decimate_factor ? src->decimate_factor : 1;
+    if (self->sample_id_next && (src->sample_id != self->sample_id_next)) {
+        self->side = -1;  // gap
+        self->held = 0;
+    }
+    self->sample_id_next = src->sample_id + jsdrv_deadband_sample_count(src) * step;
+    bool rv = false;
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(src);
+
+    if (hold) {
+        // Constant samples cannot cross, so only the first one can start an edge.
+        rv = scan(self, &hold->mean, 1, src->sample_id, step, fire);
+        if (!rv && self->held && (hold->sample_count > 1)) {
+            self->held += hold->sample_count - 1;
+            rv = fire_check(self, fire);
+        }
+    } else if ((src->element_type == JSDRV_DATA_TYPE_FLOAT) && (src->element_size_bits == 32)) {
+        rv = scan(self, (const float *) src->data, src->element_count, src->sample_id, step, fire);
+    } else if ((src->element_type == JSDRV_DATA_TYPE_UINT) && ((src->element_size_bits == 1)
+            || (src->element_size_bits == 4) || (src->element_size_bits == 8))) {
+        uint8_t u8[CHUNK_LENGTH];
+        float f32[CHUNK_LENGTH];
+        for (uint32_t offset = 0; !rv && (offset < src->element_count); offset += CHUNK_LENGTH) {
+            uint32_t n = src->element_count - offset;
+            n = (n > CHUNK_LENGTH) ? CHUNK_LENGTH : n;
+            const uint8_t * x = u8;
+            if (src->element_size_bits == 1) {
+                jsdrv_u1_unpack(u8, src->data, offset, n);
+            } else if (src->element_size_bits == 4) {
+                jsdrv_u4_unpack(u8, src->data, offset, n);
+            } else {
+                x = src->data + offset;
+            }
+            for (uint32_t i = 0; i < n; ++i) {
+                f32[i] = (float) x[i];
+            }
+            rv = scan(self, f32, n, src->sample_id + offset * (uint64_t) step, step, fire);
+        }
+    }
+    return rv;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv/unpack.h"
+#include "jsdrv_prv/f32_ops.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define UNPACK_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define UNPACK_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+static void u4_unpack_scalar(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length) {
+    for (uint32_t i = offset; i < (offset + length); ++i) {
+        *y++ = (x[i >> 1] >> ((i & 1) * 4)) & 0x0f;
+    }
+}
+
+static void u1_unpack_scalar(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length) {
+    for (uint32_t i = offset; i < (offset + length); ++i) {
+        *y++ = (x[i >> 3] >> (i & 7)) & 0x01;
+    }
+}
+
+void jsdrv_u4_unpack(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length) {
+    if (offset & 1) {  // align to a byte
+        uint32_t n = (length < 1) ? length : 1;
+        u4_unpack_scalar(y, x, offset, n);
+        y += n;
+        offset += n;
+        length -= n;
+    }
+    x += offset >> 1;
+    uint32_t i = 0;  // output samples
+#if UNPACK_SSE2
+    uint32_t n_simd = (JSDRV_F32_OPS_ISA_SCALAR == jsdrv_f32_ops_isa()) ? 0 : length;  // forced scalar
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    for (; (i + 32) <= n_simd; i += 32) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (x + (i >> 1)));
+        __m128i lo = _mm_and_si128(v, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        _mm_storeu_si128((__m128i *) (y + i), _mm_unpacklo_epi8(lo, hi));
+        _mm_storeu_si128((__m128i *) (y + i + 16), _mm_unpackhi_epi8(lo, hi));
+    }
+#elif UNPACK_NEON
+    uint32_t n_simd = (JSDRV_F32_OPS_ISA_SCALAR == jsdrv_f32_ops_isa()) ? 0 : length;  // forced scalar
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    for (; (i + 32) <= n_simd; i += 32) {
+        uint8x16_t v = vld1q_u8(x + (i >> 1));
+        uint8x16x2_t r = {{vandq_u8(v, mask), vshrq_n_u8(v, 4)}};
+        vst2q_u8(y + i, r);
+    }
+#endif
+    u4_unpack_scalar(y + i, x, i, length - i);
+}
+
+void jsdrv_u1_unpack(uint8_t * y, const uint8_t * x, uint32_t offset, uint32_t length) {
+    if (offset & 7) {  // align to a byte
+        uint32_t n = 8 - (offset & 7);
+        n = (length < n) ? length : n;
+        u1_unpack_scalar(y, x, offset, n);
+        y += n;
+        offset += n;
+        length -= n;
+    }
+    x += offset >> 3;
+    uint32_t i = 0;  // output samples
+#if UNPACK_SSE2
+    uint32_t n_simd = (JSDRV_F32_OPS_ISA_SCALAR == jsdrv_f32_ops_isa()) ? 0 : length;  // forced scalar
+    const __m128i bits = _mm_set_epi8(
+            (char) 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            (char) 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    const __m128i one = _mm_set1_epi8(1);
+    for (; (i + 16) <= n_simd; i += 16) {
+        uint16_t b = (uint16_t) (x[i >> 3] | (x[(i >> 3) + 1] << 8));
+        __m128i v = _mm_cvtsi32_si128(b);
+        v = _mm_unpacklo_epi8(v, v);    // b0 b0 b1 b1
+        v = _mm_unpacklo_epi16(v, v);   // b0 x4, b1 x4
+        v = _mm_unpacklo_epi32(v, v);   // b0 x8, b1 x8
+        v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+        _mm_storeu_si128((__m128i *) (y + i), _mm_and_si128(v, one));
+    }
+#elif UNPACK_NEON
+    uint32_t n_simd = (JSDRV_F32_OPS_ISA_SCALAR == jsdrv_f32_ops_isa()) ? 0 : length;  // forced scalar
+    const uint8_t bits_u8[8] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+    const uint8x8_t bits = vld1_u8(bits_u8);
+    const uint8x8_t one = vdup_n_u8(1);
+    for (; (i + 8) <= n_simd; i += 8) {
+        uint8x8_t v = vtst_u8(vdup_n_u8(x[i >> 3]), bits);
+        vst1_u8(y + i, vand_u8(v, one));
+    }
+#endif
+    u1_unpack_scalar(y + i, x, i, length - i);
+}
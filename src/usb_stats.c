@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/usb_stats.h"
+#include "jsdrv/time.h"
+#include "tinyprintf.h"
+#include <string.h>
+
+
+static void report_reset(struct jsdrv_usb_stats_s * self) {
+    self->interval_count = 0;
+    self->interval_min_us = UINT32_MAX;
+    self->interval_max_us = 0;
+    self->interval_sum_us = 0;
+    self->interval_bytes = 0;
+    self->residence_count = 0;
+    self->residence_max_us = 0;
+    self->residence_sum_us = 0;
+}
+
+void jsdrv_usb_stats_open(struct jsdrv_usb_stats_s * self, uint8_t endpoint) {
+    memset(self, 0, sizeof(*self));
+    self->endpoint = endpoint;
+    report_reset(self);
+}
+
+void jsdrv_usb_stats_complete(struct jsdrv_usb_stats_s * self, int64_t t_now, uint32_t size) {
+    ++self->completions;
+    self->bytes += size;
+    if (self->t_prev) {
+        int64_t dt = t_now - self->t_prev;
+        uint32_t dt_us = (dt > 0) ? (uint32_t) (dt / JSDRV_TIME_MICROSECOND) : 0;
+        ++self->interval_count;
+        self->interval_sum_us += dt_us;
+        self->interval_bytes += size;
+        if (dt_us < self->interval_min_us) {
+            self->interval_min_us = dt_us;
+        }
+        if (dt_us > self->interval_max_us) {
+            self->interval_max_us = dt_us;
+        }
+    }
+    self->t_prev = t_now;
+}
+
+void jsdrv_usb_stats_residence(struct jsdrv_usb_stats_s * self, int64_t t_complete, int64_t t_now) {
+    int64_t dt = t_now - t_complete;
+    uint32_t dt_us = (dt > 0) ? (uint32_t) (dt / JSDRV_TIME_MICROSECOND) : 0;
+    ++self->residence_count;
+    self->residence_sum_us += dt_us;
+    if (dt_us > self->residence_max_us) {
+        self->residence_max_us = dt_us;
+    }
+}
+
+uint32_t jsdrv_usb_stats_json(struct jsdrv_usb_stats_s * stats, uint32_t count, char * buf, uint32_t size) {
+    uint32_t written = 0;
+    char * p = buf;
+    char * p_end = buf + size;
+    static const char header[] = "{\"endpoints\": [";
+    if (!buf || (size < (sizeof(header) + 3))) {
+        return 0;
+    }
+    memcpy(p, header, sizeof(header) - 1);
+    p += sizeof(header) - 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        struct jsdrv_usb_stats_s * s = &stats[i];
+        if (!s->endpoint) {
+            continue;
+        }
+        uint32_t i_avg = s->interval_count ? (uint32_t) (s->interval_sum_us / s->interval_count) : 0;
+        uint32_t r_avg = s->residence_count ? (uint32_t) (s->residence_sum_us / s->residence_count) : 0;
+        uint64_t bytes_per_s = s->interval_sum_us ? ((s->interval_bytes * 1000000ULL) / s->interval_sum_us) : 0;
+        int n = tfp_snprintf(p, p_end - p - 2,
+                             "%s{\"endpoint\": %u, \"completions\": %llu, \"bytes\": %llu, \"bytes_per_s\": %llu, "
+                             "\"timeouts\": %u, \"errors\": %u, \"in_flight\": %u, \"loaned\": %u, "
+                             "\"interval_us\": {\"min\": %u, \"avg\": %u, \"max\": %u}, "
+                             "\"residence_us\": {\"avg\": %u, \"max\": %u}}",
+                             written ? ", " : "", (unsigned int) s->endpoint,
+                             (unsigned long long) s->completions, (unsigned long long) s->bytes,
+                             (unsigned long long) bytes_per_s,
+                             (unsigned int) s->timeouts, (unsigned int) s->errors,
+                             (unsigned int) s->in_flight, (unsigned int) s->loaned,
+                             (unsigned int) (s->interval_count ? s->interval_min_us : 0),
+                             (unsigned int) i_avg, (unsigned int) s->interval_max_us,
+                             (unsigned int) r_avg, (unsigned int) s->residence_max_us);
+        if ((n < 0) || (n >= (p_end - p - 2))) {
+            break;  // truncate
+        }
+        p += n;
+        ++written;
+        report_reset(s);
+    }
+    *p++ = ']';
+    *p++ = '}';
+    *p = 0;
+    return written;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/value_shared.h"
+#include "jsdrv_prv/atomic.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/platform.h"
+
+
+struct value_shared_s {
+    volatile uint32_t refcnt;
+    uint32_t size;
+    uint64_t rsv;       // keep the value 16-byte aligned
+    uint8_t data[];
+};
+
+void * jsdrv_value_shared_alloc(uint32_t size) {
+    struct value_shared_s * v = jsdrv_alloc(sizeof(struct value_shared_s) + size);
+    v->refcnt = 1;
+    v->size = size;
+    v->rsv = 0;
+    return v->data;
+}
+
+void jsdrv_value_shared_retain(const void * ptr) {
+    struct value_shared_s * v = JSDRV_CONTAINER_OF(ptr, struct value_shared_s, data);
+    jsdrv_atomic_add_u32(&v->refcnt, 1);
+}
+
+void jsdrv_value_shared_release(const void * ptr) {
+    if (NULL == ptr) {
+        return;
+    }
+    struct value_shared_s * v = JSDRV_CONTAINER_OF(ptr, struct value_shared_s, data);
+    if (0 == jsdrv_atomic_add_u32(&v->refcnt, (uint32_t) -1)) {
+        jsdrv_free(v);
+    }
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jsdrv_prv/welch.h"
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv_prv/platform.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+
+JSDRV_STATIC_ASSERT(JSDRV_SPECTRUM_HEADER_SIZE == offsetof(struct jsdrv_spectrum_s, data), spectrum_header_size);
+
+#define PI (3.14159265358979323846)
+
+struct jsdrv_welch_s {
+    struct jsdrv_welch_config_s config;
+    uint32_t n;                 // fft_length, 0 when not configured
+    uint32_t m;                 // n / 2, the complex FFT length
+    uint32_t hop;               // samples between segment starts
+    uint64_t period;            // samples for each spectrum
+    double window_sum;          // sum(w)
+    double window_sum_sq;       // sum(w * w)
+
+    float * window;             // n
+    float * segment;            // n, the current segment samples
+    float * windowed;           // n
+    float * re;                 // m
+    float * im;                 // m
+    float * tw_re;              // m, cos(2 pi k / n)
+    float * tw_im;              // m, -sin(2 pi k / n)
+    uint32_t * bitrev;          // m
+    double * accum;             // m + 1
+
+    uint32_t fill;              // samples in segment
+    uint64_t sample_id_next;    // the expected sample_id for the next add
+    uint64_t segment_start;     // the sample_id for segment[0]
+    uint64_t average_start;     // the sample_id of the first averaged segment
+    uint64_t average_end;       // the sample_id after the last averaged segment
+    uint32_t segment_count;     // averaged segments
+};
+
+
+static void buffers_free(struct jsdrv_welch_s * self) {
+    float ** f[] = {&self->window, &self->segment, &self->windowed, &self->re, &self->im, &self->tw_re, &self->tw_im};
+    for (size_t idx = 0; idx < JSDRV_ARRAY_SIZE(f); ++idx) {
+        if (NULL != *f[idx]) {
+            jsdrv_free(*f[idx]);
+            *f[idx] = NULL;
+        }
+    }
+    if (NULL != self->bitrev) {
+        jsdrv_free(self->bitrev);
+        self->bitrev = NULL;
+    }
+    if (NULL != self->accum) {
+        jsdrv_free(self->accum);
+        self->accum = NULL;
+    }
+    self->n = 0;
+    self->m = 0;
+}
+
+static float * f32_alloc(uint32_t length) {
+    return jsdrv_alloc_aligned(length * sizeof(float), JSDRV_ALLOC_ALIGNMENT);
+}
+
+struct jsdrv_welch_s * jsdrv_welch_new(void) {
+    return jsdrv_alloc_clr(sizeof(struct jsdrv_welch_s));
+}
+
+void jsdrv_welch_free(struct jsdrv_welch_s * self) {
+    if (NULL == self) {
+        return;
+    }
+    buffers_free(self);
+    jsdrv_free(self);
+}
+
+void jsdrv_welch_clear(struct jsdrv_welch_s * self) {
+    self->fill = 0;
+    self->sample_id_next = 0;
+    self->segment_start = 0;
+    self->average_start = 0;
+    self->average_end = 0;
+    self->segment_count = 0;
+    if (NULL != self->accum) {
+        memset(self->accum, 0, (self->m + 1) * sizeof(double));
+    }
+}
+
+int32_t jsdrv_welch_configure(struct jsdrv_welch_s * self, const struct jsdrv_welch_config_s * config) {
+    uint32_t n = config->fft_length;
+    if ((n < JSDRV_WELCH_LENGTH_MIN) || (n > JSDRV_WELCH_LENGTH_MAX) || (n & (n - 1))
+            || (config->overlap >= 100) || (0 == config->sample_rate)
+            || (config->scale > JSDRV_SPECTRUM_SCALE_POWER)) {
+        return JSDRV_ERROR_PARAMETER_INVALID;
+    }
+    if (n != self->n) {
+        buffers_free(self);
+        uint32_t m = n / 2;
+        self->window = f32_alloc(n);
+        self->segment = f32_alloc(n);
+        self->windowed = f32_alloc(n);
+        self->re = f32_alloc(m);
+        self->im = f32_alloc(m);
+        self->tw_re = f32_alloc(m);
+        self->tw_im = f32_alloc(m);
+        self->bitrev = jsdrv_alloc(m * sizeof(uint32_t));
+        self->accum = jsdrv_alloc((m + 1) * sizeof(double));
+
+        double window_sum = 0.0;
+        double window_sum_sq = 0.0;
+        for (uint32_t i = 0; i < n; ++i) {
+            double w = 0.5 - 0.5 * cos(2.0 * PI * i / n);  // periodic Hann
+            self->window[i] = (float) w;
+            window_sum += w;
+            window_sum_sq += w * w;
+        }
+        self->window_sum = window_sum;
+        self->window_sum_sq = window_sum_sq;
+        for (uint32_t k = 0; k < m; ++k) {
+            self->tw_re[k] = (float) cos(2.0 * PI * k / n);
+            self->tw_im[k] = (float) -sin(2.0 * PI * k / n);
+        }
+        uint32_t bits = 0;
+        while ((1U << bits) < m) {
+            ++bits;
+        }
+        for (uint32_t i = 0; i < m; ++i) {
+            uint32_t r = 0;
+            for (uint32_t b = 0; b < bits; ++b) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            self->bitrev[i] = r;
+        }
+        self->n = n;
+        self->m = m;
+    }
+    self->config = *config;
+    self->hop = n - (uint32_t) (((uint64_t) n * config->overlap) / 100);
+    self->period = ((uint64_t) config->period_ms * config->sample_rate) / 1000;
+    jsdrv_welch_clear(self);
+    return 0;
+}
+
+// Accumulate the power of one segment, which starts at segment_start.
+static void segment_process(struct jsdrv_welch_s * self) {
+    const uint32_t n = self->n;
+    const uint32_t m = self->m;
+    float * re = self->re;
+    float * im = self->im;
+    const float * tw_re = self->tw_re;
+    const float * tw_im = self->tw_im;
+
+    jsdrv_f32_mult(self->windowed, self->segment, self->window, n);
+
+    // Pack the real samples as m complex samples in bit-reversed order.
+    for (uint32_t i = 0; i < m; ++i) {
+        uint32_t j = self->bitrev[i];
+        re[j] = self->windowed[2 * i];
+        im[j] = self->windowed[2 * i + 1];
+    }
+
+    // Radix-2 decimation-in-time butterflies on the split arrays.
+    for (uint32_t size = 2; size <= m; size <<= 1) {
+        uint32_t half = size >> 1;
+        uint32_t stride = n / size;
+        for (uint32_t start = 0; start < m; start += size) {
+            for (uint32_t k = 0; k < half; ++k) {
+                uint32_t a = start + k;
+                uint32_t b = a + half;
+                float wr = tw_re[k * stride];
+                float wi = tw_im[k * stride];
+                float tr = wr * re[b] - wi * im[b];
+                float ti = wr * im[b] + wi * re[b];
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    // NaN in any sample reaches every bin, including DC.
+    double dc = (double) re[0] + (double) im[0];
+    if (isnan(dc)) {
+        return;
+    }
+
+    // Separate the even and odd sample spectra to form the real FFT.
+    double * accum = self->accum;
+    double nyquist = (double) re[0] - (double) im[0];
+    accum[0] += dc * dc;
+    accum[m] += nyquist * nyquist;
+    for (uint32_t k = 1; k < m; ++k) {
+        double zr = re[k];
+        double zi = im[k];
+        double cr = re[m - k];
+        double ci = -im[m - k];
+        double er = 0.5 * (zr + cr);
+        double ei = 0.5 * (zi + ci);
+        double odd_r = 0.5 * (zi - ci);
+        double odd_i = -0.5 * (zr - cr);
+        double xr = er + tw_re[k] * odd_r - tw_im[k] * odd_i;
+        double xi = ei + tw_re[k] * odd_i + tw_im[k] * odd_r;
+        accum[k] += xr * xr + xi * xi;
+    }
+
+    if (0 == self->segment_count) {
+        self->average_start = self->segment_start;
+    }
+    self->average_end = self->segment_start + n;
+    ++self->segment_count;
+}
+
+int32_t jsdrv_welch_add(struct jsdrv_welch_s * self, uint64_t sample_id, const float * x, uint32_t count) {
+    if (0 == self->n) {
+        return JSDRV_ERROR_UNAVAILABLE;
+    }
+    if (sample_id != self->sample_id_next) {
+        self->fill = 0;  // gap: discard the partial segment
+    }
+    if (0 == self->fill) {
+        self->segment_start = sample_id;
+    }
+    self->sample_id_next = sample_id + count;
+    while (count) {
+        uint32_t sz = self->n - self->fill;
+        if (sz > count) {
+            sz = count;
+        }
+        memcpy(self->segment + self->fill, x, sz * sizeof(float));
+        self->fill += sz;
+        x += sz;
+        count -= sz;
+        if (self->fill == self->n) {
+            segment_process(self);
+            self->fill = self->n - self->hop;
+            memmove(self->segment, self->segment + self->hop, self->fill * sizeof(float));
+            self->segment_start += self->hop;
+        }
+    }
+    return 0;
+}
+
+uint32_t jsdrv_welch_ready(struct jsdrv_welch_s * self) {
+    if ((0 == self->segment_count) || ((self->average_end - self->average_start) < self->period)) {
+        return 0;
+    }
+    return JSDRV_SPECTRUM_HEADER_SIZE + (self->m + 1) * sizeof(float);
+}
+
+int32_t jsdrv_welch_next(struct jsdrv_welch_s * self, struct jsdrv_spectrum_s * spectrum) {
+    if (0 == jsdrv_welch_ready(self)) {
+        return JSDRV_ERROR_UNAVAILABLE;
+    }
+    const uint32_t m = self->m;
+    double scale;
+    if (JSDRV_SPECTRUM_SCALE_POWER == self->config.scale) {
+        scale = 1.0 / (self->window_sum * self->window_sum);
+    } else {
+        scale = 1.0 / (self->config.sample_rate * self->window_sum_sq);
+    }
+    scale /= self->segment_count;
+
+    memset(spectrum, 0, JSDRV_SPECTRUM_HEADER_SIZE);
+    spectrum->sample_id = self->average_start;
+    spectrum->sample_rate = self->config.sample_rate;
+    spectrum->decimate_factor = 1;
+    spectrum->fft_length = self->n;
+    spectrum->bin_count = m + 1;
+    spectrum->segment_count = self->segment_count;
+    spectrum->scale = self->config.scale;
+    spectrum->data[0] = (float) (self->accum[0] * scale);
+    spectrum->data[m] = (float) (self->accum[m] * scale);
+    for (uint32_t k = 1; k < m; ++k) {
+        spectrum->data[k] = (float) (2.0 * self->accum[k] * scale);  // one-sided
+    }
+
+    memset(self->accum, 0, (m + 1) * sizeof(double));
+    self->segment_count = 0;
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <math.h>
+#include <stdlib.h>
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/aligner.h"
+
+
+#define T0 (JSDRV_TIME_HOUR)
+#define BLOCK (16U)
+
+
+static struct jsdrv_stream_signal_s * signal_;
+static uint8_t block_mem_[JSDRV_ALIGN_HEADER_SIZE + JSDRV_ALIGN_CHANNEL_COUNT_MAX * BLOCK * sizeof(float)];
+
+static int setup(void ** state) {
+    (void) state;
+    signal_ = calloc(1, sizeof(*signal_));
+    return 0;
+}
+
+static int teardown(void ** state) {
+    (void) state;
+    free(signal_);
+    return 0;
+}
+
+// Add samples whose values are their UTC time in milliseconds since T0.
+static void add(struct jsdrv_aligner_s * a, uint32_t channel, uint64_t sample_id, uint32_t count,
+                uint32_t sample_rate, uint32_t decimate_factor, const struct jsdrv_time_map_s * tm) {
+    signal_->sample_id = sample_id;
+    signal_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    signal_->element_size_bits = 32;
+    signal_->element_count = count;
+    signal_->sample_rate = sample_rate;
+    signal_->decimate_factor = decimate_factor;
+    signal_->time_map = *tm;
+    float * data = (float *) signal_->data;
+    for (uint32_t i = 0; i < count; ++i) {
+        double counter = (double) (sample_id + i * decimate_factor) - (double) tm->offset_counter;
+        double t = ((double) (tm->offset_time - T0)) / JSDRV_TIME_SECOND + counter / tm->counter_rate;
+        data[i] = (float) (t * 1000.0);
+    }
+    assert_int_equal(0, jsdrv_aligner_add(a, channel, signal_));
+}
+
+static struct jsdrv_align_block_s * next(struct jsdrv_aligner_s * a) {
+    struct jsdrv_align_block_s * block = (struct jsdrv_align_block_s *) block_mem_;
+    uint32_t size = jsdrv_aligner_ready(a);
+    assert_true(size > 0);
+    assert_true(size <= sizeof(block_mem_));
+    assert_int_equal(0, jsdrv_aligner_next(a, block));
+    return block;
+}
+
+// Check that each channel's values match the grid time.
+static void check_block(const struct jsdrv_align_block_s * block, uint32_t channel_count) {
+    assert_int_equal(channel_count, block->channel_count);
+    assert_int_equal(BLOCK, block->sample_count);
+    for (uint32_t i = 0; i < BLOCK; ++i) {
+        double t = ((double) (block->time_map.offset_time - T0)) / JSDRV_TIME_SECOND
+                + ((double) (block->sample_id + i)) / block->sample_rate;
+        for (uint32_t ch = 0; ch < channel_count; ++ch) {
+            assert_float_equal(t * 1000.0, block->data[ch * BLOCK + i], 1e-3);
+        }
+    }
+}
+
+static void test_offset(void ** state) {
+    (void) state;
+    struct jsdrv_time_map_s tm0 = {.offset_time = T0, .offset_counter = 0, .counter_rate = 1000.0};
+    struct jsdrv_time_map_s tm1 = {.offset_time = T0 + JSDRV_TIME_MILLISECOND / 2, .offset_counter = 5000, .counter_rate = 1000.0};
+    struct jsdrv_aligner_s * a = jsdrv_aligner_new(1024);
+    assert_non_null(a);
+    assert_int_equal(0, jsdrv_aligner_channel(a, 0, true));
+    assert_int_equal(0, jsdrv_aligner_channel(a, 2, true));
+    jsdrv_aligner_configure(a, 0, BLOCK);
+    assert_int_equal(0, jsdrv_aligner_ready(a));
+    add(a, 0, 0, 100, 1000, 1, &tm0);
+    assert_int_equal(0, jsdrv_aligner_ready(a));  // waits for all channels
+    add(a, 2, 5000, 100, 1000, 1, &tm1);
+
+    struct jsdrv_align_block_s * block = next(a);
+    assert_int_equal(0, block->sample_id);
+    assert_int_equal(1000, block->sample_rate);
+    assert_int_equal(0x5, block->channel_mask);
+    assert_int_equal(tm1.offset_time, block->time_map.offset_time);  // the latest first sample
+    check_block(block, 2);
+    for (uint32_t k = 1; k < 6; ++k) {
+        block = next(a);
+        assert_int_equal(k * BLOCK, block->sample_id);
+        check_block(block, 2);
+    }
+    assert_int_equal(0, jsdrv_aligner_ready(a));  // needs more samples
+    add(a, 0, 100, 100, 1000, 1, &tm0);
+    assert_int_equal(0, jsdrv_aligner_ready(a));
+    add(a, 2, 5100, 100, 1000, 1, &tm1);
+    check_block(next(a), 2);
+    jsdrv_aligner_free(a);
+}
+
+static void test_rate_and_decimate(void ** state) {
+    (void) state;
+    struct jsdrv_time_map_s tm0 = {.offset_time = T0, .offset_counter = 1000000, .counter_rate = 1000.0 * (1.0 - 50e-6)};
+    struct jsdrv_time_map_s tm1 = {.offset_time = T0 - JSDRV_TIME_MILLISECOND / 3, .offset_counter = 0, .counter_rate = 4000.0 * (1.0 + 100e-6)};
+    struct jsdrv_aligner_s * a = jsdrv_aligner_new(4096);
+    assert_int_equal(0, jsdrv_aligner_channel(a, 0, true));
+    assert_int_equal(0, jsdrv_aligner_channel(a, 1, true));
+    jsdrv_aligner_configure(a, 0, BLOCK);
+    for (uint32_t k = 0; k < 10; ++k) {
+        add(a, 0, 1000000 + k * 100, 100, 1000, 1, &tm0);
+        add(a, 1, k * 400, 100, 4000, 4, &tm1);
+    }
+    uint32_t blocks = 0;
+    while (jsdrv_aligner_ready(a)) {
+        struct jsdrv_align_block_s * block = next(a);
+        assert_int_equal(1000, block->sample_rate);  // the slowest channel
+        check_block(block, 2);
+        ++blocks;
+    }
+    assert_true(blocks >= 60);
+    jsdrv_aligner_free(a);
+}
+
+static void test_stall_and_gap(void ** state) {
+    (void) state;
+    struct jsdrv_time_map_s tm = {.offset_time = T0, .offset_counter = 0, .counter_rate = 1000.0};
+    struct jsdrv_aligner_s * a = jsdrv_aligner_new(256);
+    assert_int_equal(0, jsdrv_aligner_channel(a, 0, true));
+    assert_int_equal(0, jsdrv_aligner_channel(a, 1, true));
+    jsdrv_aligner_configure(a, 0, BLOCK);
+    add(a, 0, 0, BLOCK + 1, 1000, 1, &tm);
+    add(a, 1, 0, BLOCK + 1, 1000, 1, &tm);
+    check_block(next(a), 2);
+
+    // channel 1 stalls, so channel 0 eventually proceeds without it
+    add(a, 0, BLOCK + 10, 200, 1000, 1, &tm);  // skip 9 samples
+    struct jsdrv_align_block_s * block = next(a);
+    assert_int_equal(BLOCK, block->sample_id);
+    for (uint32_t i = 0; i < BLOCK; ++i) {
+        if ((i > 0) && (i < 10)) {
+            assert_true(isnan(block->data[i]));  // gap
+        } else {
+            assert_float_equal(BLOCK + i, block->data[i], 1e-3);
+        }
+        if (i > 0) {
+            assert_true(isnan(block->data[BLOCK + i]));  // stalled
+        }
+    }
+    while (jsdrv_aligner_ready(a)) {
+        next(a);
+    }
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_aligner_next(a, (struct jsdrv_align_block_s *) block_mem_));
+    jsdrv_aligner_free(a);
+}
+
+static void test_hold(void ** state) {
+    (void) state;
+    struct jsdrv_time_map_s tm = {.offset_time = T0, .offset_counter = 0, .counter_rate = 1000.0};
+    struct jsdrv_aligner_s * a = jsdrv_aligner_new(32);
+    assert_int_equal(0, jsdrv_aligner_channel(a, 0, true));
+    assert_int_equal(0, jsdrv_aligner_channel(a, 1, true));
+    jsdrv_aligner_configure(a, 0, BLOCK);
+    uint32_t blocks = 0;
+    for (uint32_t j = 0; j < 6; ++j) {  // wraps the ring
+        add(a, 0, j * BLOCK, BLOCK, 1000, 1, &tm);
+        uint64_t sample_id = j ? (j * BLOCK - 4) : 0;  // overlap the previous hold
+        signal_->sample_id = sample_id;
+        signal_->element_type = JSDRV_DATA_TYPE_HOLD;
+        signal_->element_size_bits = sizeof(struct jsdrv_stream_hold_s) * 8;
+        signal_->element_count = 1;
+        struct jsdrv_stream_hold_s * hold = (struct jsdrv_stream_hold_s *) signal_->data;
+        hold->sample_count = (j + 1) * BLOCK - sample_id;
+        hold->min = 4.0f;
+        hold->max = 6.0f;
+        hold->mean = 5.0f;
+        assert_int_equal(0, jsdrv_aligner_add(a, 1, signal_));
+        while (jsdrv_aligner_ready(a)) {
+            struct jsdrv_align_block_s * block = next(a);
+            assert_int_equal(0x3, block->channel_mask);
+            for (uint32_t i = 0; i < BLOCK; ++i) {
+                assert_float_equal(block->sample_id + i, block->data[i], 1e-3);
+                assert_float_equal(5.0, block->data[BLOCK + i], 0.0);
+            }
+            ++blocks;
+        }
+    }
+    assert_int_equal(5, blocks);
+    jsdrv_aligner_free(a);
+}
+
+static void test_invalid(void ** state) {
+    (void) state;
+    struct jsdrv_time_map_s tm = {.offset_time = T0, .offset_counter = 0, .counter_rate = 1000.0};
+    struct jsdrv_aligner_s * a = jsdrv_aligner_new(256);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_aligner_channel(a, JSDRV_ALIGN_CHANNEL_COUNT_MAX, true));
+    signal_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    signal_->element_size_bits = 32;
+    signal_->element_count = 1;
+    signal_->time_map = tm;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_aligner_add(a, 0, signal_));  // not enabled
+    assert_int_equal(0, jsdrv_aligner_channel(a, 0, true));
+    signal_->element_type = JSDRV_DATA_TYPE_UINT;
+    signal_->element_size_bits = 4;
+    assert_int_equal(JSDRV_ERROR_NOT_SUPPORTED, jsdrv_aligner_add(a, 0, signal_));
+    signal_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    signal_->element_size_bits = 32;
+    signal_->time_map.counter_rate = 0.0;
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_aligner_add(a, 0, signal_));
+    jsdrv_aligner_free(a);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_offset),
+            cmocka_unit_test(test_rate_and_decimate),
+            cmocka_unit_test(test_stall_and_gap),
+            cmocka_unit_test(test_hold),
+            cmocka_unit_test(test_invalid),
+    };
+
+    return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -23,7 +23,10 @@
 #include <stdlib.h>
 #include <math.h>
 #include "jsdrv_prv/buffer_signal.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/statistics.h"
 #include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
 #include "tinyprintf.h"
 
 const char SRC_TOPIC[] = "src/topic/!data";
@@ -214,6 +217,50 @@ static void test_samples_wrap(void **state) {
     jsdrv_bufsig_free(&b);
 }
 
+static void test_hold(void **state) {
+    initialize();
+    insert_samples(&b, 1000, 1000);
+    struct jsdrv_stream_signal_s s;
+    memset(&s, 0, sizeof(s));
+    s.sample_id = 2000;
+    s.field_id = JSDRV_FIELD_CURRENT;
+    s.index = 7;
+    s.element_type = JSDRV_DATA_TYPE_HOLD;
+    s.element_size_bits = sizeof(struct jsdrv_stream_hold_s) * 8;
+    s.element_count = 1;
+    s.sample_rate = 1000000;
+    s.decimate_factor = 1;
+    struct jsdrv_stream_hold_s * hold = (struct jsdrv_stream_hold_s *) s.data;
+    hold->sample_count = 20000;  // spans multiple expanded messages
+    hold->min = 0.25f;
+    hold->max = 0.75f;
+    hold->mean = 0.5f;
+    jsdrv_bufsig_recv_data(&b, &s);
+    insert_samples(&b, 22000, 1000);
+
+    struct jsdrv_buffer_info_s info;
+    jsdrv_bufsig_info(&b, &info);
+    assert_int_equal(1000, info.time_range_samples.start);
+    assert_int_equal(22999, info.time_range_samples.end);
+
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 21990;
+    req.time.samples.length = 20;
+    uint64_t rsp_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    jsdrv_bufsig_process_request(&b, &req, rsp);
+    assert_int_equal(20, rsp->info.time_range_samples.length);
+    float * data = (float *) rsp->data;
+    for (uint32_t i = 0; i < 20; ++i) {
+        float expect = (i < 10) ? 0.5f : ((22000 + i - 10) / 1000000.0f);
+        assert_float_equal(expect, data[i], 1e-12);
+    }
+    jsdrv_bufsig_free(&b);
+}
+
 static void test_summary_simple(void **state) {
     initialize();
     insert_samples(&b, 1000, 1000);
@@ -315,6 +362,1216 @@ static void test_summary_wrap(void **state) {
     jsdrv_bufsig_free(&b);
 }
 
+static void check_pyramid(struct bufsig_s * b) {
+    struct jsdrv_statistics_accum_s s_accum;
+    struct jsdrv_statistics_accum_s s_tmp;
+    struct jsdrv_summary_entry_s expect;
+    for (int level = 1; (level < JSDRV_BUFSIG_LEVELS_MAX) && b->levels[level].data; ++level) {
+        struct bufsig_level_s * lvl_dn = &b->levels[level - 1];
+        struct bufsig_level_s * lvl_up = &b->levels[level];
+        for (uint64_t j = 0; j < lvl_up->k; ++j) {
+            uint64_t start = j * lvl_up->samples_per_entry;
+            uint64_t end = start + lvl_up->samples_per_entry;
+            if ((start < b->level0_head) && (end > b->level0_head)) {
+                continue;  // partially updated
+            }
+            jsdrv_statistics_reset(&s_accum);
+            for (uint64_t i = 0; i < lvl_up->r; ++i) {
+                jsdrv_statistics_from_entry(&s_tmp, &lvl_dn->data[j * lvl_up->r + i], lvl_dn->samples_per_entry);
+                jsdrv_statistics_combine(&s_accum, &s_accum, &s_tmp);
+            }
+            jsdrv_statistics_to_entry(&s_accum, &expect);
+            struct jsdrv_summary_entry_s * y = &lvl_up->data[j];
+            assert_float_equal(expect.avg, y->avg, 1e-9);
+            assert_float_equal(expect.std, y->std, 1e-9);
+            assert_float_equal(expect.min, y->min, 1e-9);
+            assert_float_equal(expect.max, y->max, 1e-9);
+        }
+    }
+}
+
+static void test_summary_pyramid(void **state) {
+    initialize();
+    uint32_t length = 873;
+    uint64_t sample_id = 0;
+    for (; sample_id < 1100000; sample_id += length) {
+        insert_samples(&b, sample_id, length);
+    }
+    check_pyramid(&b);
+    insert_samples(&b, sample_id + 12345, length);  // skip, filled with NaN
+    check_pyramid(&b);
+    jsdrv_bufsig_free(&b);
+}
+
+static void test_bulk(void **state) {
+    initialize();
+    struct bufsig_s b2;
+    memset(&b2, 0, sizeof(b2));
+    jsdrv_cstr_copy(b2.topic, SRC_TOPIC, sizeof(b2.topic));
+    b2.hdr = b.hdr;
+    b2.time_map.counter_rate = (double) b2.hdr.sample_rate;
+    b2.active = true;
+    jsdrv_bufsig_alloc(&b2, 1000000, 10, 10);
+
+    uint64_t length = 1100000;  // wraps
+    float * x = malloc(length * sizeof(float));
+    for (uint64_t i = 0; i < length; ++i) {
+        x[i] = i / 1000000.0f;
+    }
+    uint64_t sample_id = 0;
+    for (; sample_id < length; sample_id += 1000) {
+        insert_samples(&b, sample_id, 1000);
+    }
+    struct jsdrv_stream_signal_s s;
+    memset(&s, 0, sizeof(s));
+    s.field_id = JSDRV_FIELD_CURRENT;
+    s.index = 7;
+    s.element_type = JSDRV_DATA_TYPE_FLOAT;
+    s.element_size_bits = 32;
+    s.sample_rate = 1000000;
+    s.decimate_factor = 1;
+    s.time_map.offset_time = JSDRV_TIME_HOUR;
+    s.time_map.counter_rate = s.sample_rate;
+    jsdrv_bufsig_recv_bulk(&b2, &s, (const uint8_t *) x, length, 4);
+
+    assert_int_equal(b.level0_head, b2.level0_head);
+    assert_int_equal(b.level0_size, b2.level0_size);
+    assert_int_equal(b.sample_id_head, b2.sample_id_head);
+    assert_memory_equal(b.level0_data, b2.level0_data, b.N * sizeof(float));
+    for (int level = 0; (level < JSDRV_BUFSIG_LEVELS_MAX) && b.levels[level].data; ++level) {
+        struct bufsig_level_s * lvl = &b.levels[level];
+        for (uint64_t j = 0; j < lvl->k; ++j) {
+            uint64_t start = j * lvl->samples_per_entry;
+            uint64_t end = start + lvl->samples_per_entry;
+            if ((start < b.level0_head) && (end > b.level0_head)) {
+                continue;  // partially updated
+            }
+            assert_memory_equal(&lvl->data[j], &b2.levels[level].data[j], sizeof(lvl->data[j]));
+        }
+    }
+    check_pyramid(&b2);
+
+    // continue unaligned, then with stream messages
+    s.sample_id = length;
+    jsdrv_bufsig_recv_bulk(&b2, &s, (const uint8_t *) x, 12345, 4);
+    assert_int_equal(length + 12345, b2.sample_id_head);
+    insert_samples(&b2, length + 12345, 873);
+    check_pyramid(&b2);
+
+    free(x);
+    jsdrv_bufsig_free(&b2);
+    jsdrv_bufsig_free(&b);
+}
+
+static uint8_t uint_sample(uint64_t sample_id, uint8_t bits) {
+    uint32_t x = (uint32_t) (sample_id * 2654435761U);
+    return (uint8_t) ((x >> 13) & ((1U << bits) - 1));
+}
+
+// Fill a 1-bit or 4-bit signal past its ring end, and return the next sample_id.
+static uint64_t uint_fill(struct bufsig_s * b, uint8_t bits) {
+    memset(b, 0, sizeof(*b));
+    jsdrv_cstr_copy(b->topic, SRC_TOPIC, sizeof(b->topic));
+    b->hdr.element_type = JSDRV_DATA_TYPE_UINT;
+    b->hdr.element_size_bits = bits;
+    b->hdr.decimate_factor = 1;
+    b->hdr.sample_rate = 1000000;
+    b->active = true;
+    jsdrv_bufsig_alloc(b, 1024 * 100, 1024, 10);
+
+    struct jsdrv_stream_signal_s s;
+    memset(&s, 0, sizeof(s));
+    s.field_id = JSDRV_FIELD_GPI;
+    s.element_type = JSDRV_DATA_TYPE_UINT;
+    s.element_size_bits = bits;
+    s.sample_rate = 1000000;
+    s.decimate_factor = 1;
+    s.time_map.counter_rate = s.sample_rate;
+    uint64_t sample_id = 0;
+    for (; sample_id < 1024 * 120; sample_id += 4000) {  // wrap
+        memset(s.data, 0, (4000 * bits) / 8);
+        for (uint32_t i = 0; i < 4000; ++i) {
+            uint32_t bit = i * bits;
+            s.data[bit >> 3] |= (uint8_t) (uint_sample(sample_id + i, bits) << (bit & 7));
+        }
+        s.sample_id = sample_id;
+        s.element_count = 4000;
+        jsdrv_bufsig_recv_data(b, &s);
+    }
+    return sample_id;
+}
+
+static void check_uint_summary(uint8_t bits) {
+    struct bufsig_s b;
+    uint64_t sample_id = uint_fill(&b, bits);
+
+    // compare the level 1 entries to a direct reduction
+    uint64_t level0_start = sample_id - b.N;  // sample_id at level0_head
+    for (uint64_t j = 0; j < b.levels[0].k; ++j) {
+        uint64_t idx = j * 1024;
+        uint64_t dist = (idx >= b.level0_head) ? (idx - b.level0_head) : (idx + b.N - b.level0_head);
+        if ((dist + 1024) > b.N) {
+            continue;  // straddles the head
+        }
+        uint64_t x1 = 0;
+        uint64_t x2 = 0;
+        uint8_t v_min = 0xff;
+        uint8_t v_max = 0;
+        for (uint64_t i = 0; i < 1024; ++i) {
+            uint8_t v = uint_sample(level0_start + dist + i, bits);
+            x1 += v;
+            x2 += v * v;
+            v_min = (v < v_min) ? v : v_min;
+            v_max = (v > v_max) ? v : v_max;
+        }
+        double mean = x1 / 1024.0;
+        struct jsdrv_summary_entry_s * y = &b.levels[0].data[j];
+        assert_float_equal(mean, y->avg, 1e-6);
+        assert_float_equal(sqrt(x2 / 1024.0 - mean * mean), y->std, 1e-4);
+        assert_float_equal(v_min, y->min, 0.0);
+        assert_float_equal(v_max, y->max, 0.0);
+    }
+    jsdrv_bufsig_free(&b);
+}
+
+static void test_summary_u1(void **state) {
+    (void) state;
+    check_uint_summary(1);
+}
+
+static void test_summary_u4(void **state) {
+    (void) state;
+    check_uint_summary(4);
+}
+
+#define LEVEL0_PATH "buffer_signal_test_level0.bin"
+
+static void file_alloc(struct bufsig_s * b) {
+    memset(b, 0, sizeof(*b));
+    jsdrv_cstr_copy(b->topic, SRC_TOPIC, sizeof(b->topic));
+    jsdrv_cstr_copy(b->level0_path, LEVEL0_PATH, sizeof(b->level0_path));
+    b->hdr.field_id = JSDRV_FIELD_CURRENT;
+    b->hdr.index = 7;
+    b->hdr.element_type = JSDRV_DATA_TYPE_FLOAT;
+    b->hdr.element_size_bits = 32;
+    b->hdr.decimate_factor = 1;
+    b->hdr.sample_rate = 1000000;
+    jsdrv_bufsig_alloc(b, 1000000, 10, 10);
+}
+
+static void test_file_restore(void **state) {
+    (void) state;
+    struct bufsig_s b;
+    remove(LEVEL0_PATH);
+    file_alloc(&b);
+    assert_non_null(b.level0_map);
+    assert_false(b.level0_restored);
+    insert_samples(&b, 1000, 5000);
+    struct jsdrv_summary_entry_s entry = b.levels[1].data[3];
+    jsdrv_bufsig_free(&b);
+
+    file_alloc(&b);  // restore
+    assert_true(b.level0_restored);
+    assert_int_equal(5000, b.level0_size);
+    assert_int_equal(6000, b.sample_id_head);
+    assert_float_equal(entry.avg, b.levels[1].data[3].avg, 1e-9);
+    assert_float_equal(entry.max, b.levels[1].data[3].max, 1e-9);
+    assert_float_equal(1010 / 1000000.0f, ((float *) b.level0_data)[10], 1e-12);
+    insert_samples(&b, 6000, 1000);  // contiguous, append
+    assert_false(b.level0_restored);
+    assert_int_equal(6000, b.level0_size);
+    jsdrv_bufsig_free(&b);
+
+    file_alloc(&b);
+    assert_int_equal(6000, b.level0_size);
+    insert_samples(&b, 100, 1000);  // older, device restarted
+    assert_int_equal(1000, b.level0_size);
+    assert_int_equal(1100, b.sample_id_head);
+    jsdrv_bufsig_free(&b);
+
+    b.hdr.sample_rate = 2000000;  // format change discards the file contents
+    jsdrv_cstr_copy(b.level0_path, LEVEL0_PATH, sizeof(b.level0_path));
+    b.hdr.element_type = JSDRV_DATA_TYPE_FLOAT;
+    b.hdr.element_size_bits = 32;
+    b.hdr.decimate_factor = 1;
+    jsdrv_bufsig_alloc(&b, 1000000, 10, 10);
+    assert_false(b.level0_restored);
+    assert_int_equal(0, b.level0_size);
+    jsdrv_bufsig_free(&b);
+    remove(LEVEL0_PATH);
+}
+
+#define SAVE_PATH "buffer_signal_test_save.bin"
+
+static void check_request_equal(struct bufsig_s * expect, struct bufsig_s * actual, struct jsdrv_buffer_request_s * req) {
+    uint64_t rsp1_u64[1 << 12];
+    uint64_t rsp2_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp1 = (struct jsdrv_buffer_response_s *) rsp1_u64;
+    struct jsdrv_buffer_response_s * rsp2 = (struct jsdrv_buffer_response_s *) rsp2_u64;
+    memset(rsp1_u64, 0, sizeof(rsp1_u64));
+    memset(rsp2_u64, 0, sizeof(rsp2_u64));
+    assert_int_equal(0, jsdrv_bufsig_process_request(expect, req, rsp1));
+    assert_int_equal(0, jsdrv_bufsig_process_request(actual, req, rsp2));
+    assert_int_equal(rsp1->response_type, rsp2->response_type);
+    assert_memory_equal(&rsp1->info.time_range_samples, &rsp2->info.time_range_samples, sizeof(rsp1->info.time_range_samples));
+    assert_memory_equal(rsp1->data, rsp2->data, 1000 * sizeof(float));
+}
+
+static void test_save_load(void **state) {
+    initialize();
+    struct bufsig_s * loaded = malloc(sizeof(struct bufsig_s));
+    memset(loaded, 0, sizeof(*loaded));
+    loaded->active = true;
+    for (uint64_t sample_id = 0; sample_id < 1500000; sample_id += 1000) {
+        insert_samples(&b, sample_id, 1000);  // wrap
+    }
+    remove(SAVE_PATH);
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_bufsig_load(loaded, SAVE_PATH));
+    assert_int_equal(0, jsdrv_bufsig_save(&b, SAVE_PATH));
+    assert_int_equal(0, jsdrv_bufsig_load(loaded, SAVE_PATH));
+    assert_true(loaded->level0_loaded);
+
+    struct jsdrv_buffer_info_s info1;
+    struct jsdrv_buffer_info_s info2;
+    assert_true(jsdrv_bufsig_info(&b, &info1));
+    assert_true(jsdrv_bufsig_info(loaded, &info2));
+    assert_memory_equal(&info1.time_range_samples, &info2.time_range_samples, sizeof(info1.time_range_samples));
+    assert_int_equal(info1.size_in_samples, info2.size_in_samples);
+
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 999500;  // across the ring end
+    req.time.samples.length = 1000;
+    check_request_equal(&b, loaded, &req);
+    req.time.samples.start = 500000;
+    req.time.samples.end = 1499999;
+    req.time.samples.length = 100;  // summaries
+    check_request_equal(&b, loaded, &req);
+
+    insert_samples(loaded, 1500000, 1000);  // read only
+    assert_int_equal(b.sample_id_head, loaded->sample_id_head);
+    jsdrv_bufsig_free(loaded);
+    assert_false(loaded->level0_loaded);
+    assert_null(loaded->level0_data);
+
+    FILE * f = fopen(SAVE_PATH, "r+b");  // corrupt the magic
+    assert_non_null(f);
+    fputc('X', f);
+    fclose(f);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_bufsig_load(loaded, SAVE_PATH));
+    assert_null(loaded->level0_data);
+
+    remove(SAVE_PATH);
+    free(loaded);
+    jsdrv_bufsig_free(&b);
+}
+
+static void test_snapshot(void **state) {
+    initialize();
+    struct bufsig_s * copy = malloc(sizeof(struct bufsig_s));
+    uint64_t sample_id = 0;
+    for (; sample_id < 1000000; sample_id += 1000) {
+        insert_samples(&b, sample_id, 1000);
+    }
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 500;  // near the oldest sample
+    req.time.samples.length = 100;
+    uint64_t rsp_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+
+    jsdrv_bufsig_snapshot(&b, copy);
+    insert_samples(&b, sample_id, 1000);  // ingestion after the snapshot, not visible
+    sample_id += 1000;
+    assert_int_equal(0, jsdrv_bufsig_process_request(copy, &req, rsp));
+    assert_int_equal(500, rsp->info.time_range_samples.start);  // but the samples are now overwritten
+    assert_false(jsdrv_bufsig_snapshot_valid(&b, copy, rsp));  // overwritten
+
+    req.time.samples.start = 999000;
+    req.time.samples.length = 100;
+    jsdrv_bufsig_snapshot(&b, copy);
+    insert_samples(&b, sample_id, 1000);
+    assert_int_equal(0, jsdrv_bufsig_process_request(copy, &req, rsp));
+    check_samples(rsp, 999000, 100);
+    assert_true(jsdrv_bufsig_snapshot_valid(&b, copy, rsp));
+
+    jsdrv_bufsig_snapshot(&b, copy);
+    insert_samples(&b, sample_id - 5000, 1000);  // duplicate restarts level 0
+    assert_false(jsdrv_bufsig_snapshot_valid(&b, copy, rsp));
+
+    free(copy);
+    jsdrv_bufsig_free(&b);
+}
+
+static void test_move(void **state) {
+    initialize();
+    struct bufsig_s * frozen = malloc(sizeof(struct bufsig_s));
+    memset(frozen, 0, sizeof(*frozen));
+    frozen->idx = 3;
+    frozen->active = true;
+    jsdrv_cstr_copy(frozen->topic, SRC_TOPIC, sizeof(frozen->topic));
+    insert_samples(&b, 1000, 1000);
+    void * level0_data = b.level0_data;
+
+    jsdrv_bufsig_move(frozen, &b);
+    assert_ptr_equal(level0_data, frozen->level0_data);  // no copy
+    assert_null(b.level0_data);
+    assert_null(b.levels[0].data);
+    assert_null(b.summary_cache);
+    assert_int_equal(3, frozen->idx);
+
+    struct jsdrv_buffer_info_s info;
+    assert_false(jsdrv_bufsig_info(&b, &info));
+    assert_true(jsdrv_bufsig_info(frozen, &info));
+    assert_int_equal(1000, info.time_range_samples.start);
+    assert_int_equal(1000, info.time_range_samples.length);
+
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 1000;
+    req.time.samples.length = 1000;
+    uint64_t rsp_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    assert_int_equal(0, jsdrv_bufsig_process_request(frozen, &req, rsp));
+    check_samples(rsp, 1000, 1000);
+
+    jsdrv_bufsig_free(&b);  // nothing to free
+    jsdrv_bufsig_free(frozen);
+    free(frozen);
+}
+
+static void summary_request(struct bufsig_s * b, uint64_t start, struct jsdrv_buffer_response_s * rsp, bool cached) {
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = start;
+    req.time.samples.end = start + 102399;
+    req.time.samples.length = 100;
+    struct bufsig_summary_cache_s * cache = b->summary_cache;
+    if (!cached) {
+        b->summary_cache = NULL;
+    }
+    assert_int_equal(0, jsdrv_bufsig_process_request(b, &req, rsp));
+    b->summary_cache = cache;
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_SUMMARY, rsp->response_type);
+    assert_int_equal(100, rsp->info.time_range_samples.length);
+}
+
+static void check_summary_equal(struct jsdrv_buffer_response_s * expect, struct jsdrv_buffer_response_s * actual,
+                                double tolerance) {
+    struct jsdrv_summary_entry_s * e = (struct jsdrv_summary_entry_s *) expect->data;
+    struct jsdrv_summary_entry_s * a = (struct jsdrv_summary_entry_s *) actual->data;
+    for (uint32_t i = 0; i < 100; ++i) {
+        if (isnan(e[i].avg)) {
+            assert_true(isnan(a[i].avg));
+            continue;
+        }
+        assert_false(isnan(a[i].avg));
+        assert_float_equal(e[i].avg, a[i].avg, tolerance);
+        assert_float_equal(e[i].std, a[i].std, tolerance);
+        assert_float_equal(e[i].min, a[i].min, tolerance);
+        assert_float_equal(e[i].max, a[i].max, tolerance);
+    }
+}
+
+static void test_summary_cache(void **state) {
+    initialize();
+    uint64_t sample_id = 0;
+    for (; sample_id < 450000; sample_id += 1000) {
+        insert_samples(&b, sample_id, 1000);
+    }
+    uint64_t rsp1_u64[1 << 12];
+    uint64_t rsp2_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp1 = (struct jsdrv_buffer_response_s *) rsp1_u64;
+    struct jsdrv_buffer_response_s * rsp2 = (struct jsdrv_buffer_response_s *) rsp2_u64;
+
+    summary_request(&b, 400000, rsp1, false);
+    struct jsdrv_summary_entry_s * e = (struct jsdrv_summary_entry_s *) rsp1->data;
+    for (uint32_t i = 1; i < 48; ++i) {  // level 1 entries are consumed exactly once
+        assert_float_equal(1024 / 1000000.0, e[i].avg - e[i - 1].avg, 2e-5);
+    }
+    summary_request(&b, 400000, rsp2, true);   // miss, populates the cache
+    check_summary_equal(rsp1, rsp2, 1e-9);
+    summary_request(&b, 400000, rsp2, true);   // repeat, the partial entry at the head is recomputed exactly
+    check_summary_equal(rsp1, rsp2, 2e-4);
+
+    // trailing window: entries past the previous head are recomputed
+    for (; sample_id < 470000; sample_id += 1000) {
+        insert_samples(&b, sample_id, 1000);
+    }
+    summary_request(&b, 405120, rsp1, false);
+    summary_request(&b, 405120, rsp2, true);
+    check_summary_equal(rsp1, rsp2, 2e-4);
+
+    // clear invalidates the cache
+    jsdrv_bufsig_clear(&b);
+    for (sample_id = 0; sample_id < 450000; sample_id += 1000) {
+        insert_samples(&b, sample_id + 7, 1000);
+    }
+    summary_request(&b, 405120, rsp1, false);
+    summary_request(&b, 405120, rsp2, true);
+    check_summary_equal(rsp1, rsp2, 1e-9);
+
+    jsdrv_bufsig_free(&b);
+}
+
+static void tile_request(struct bufsig_s * b, uint64_t start, uint64_t end, struct jsdrv_buffer_response_s * rsp,
+                         bool cached) {
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.flags = JSDRV_BUFFER_REQUEST_FLAG_TILE;
+    req.time.samples.start = start;
+    req.time.samples.end = end;
+    req.time.samples.length = 99;
+    struct bufsig_summary_cache_s * cache = b->summary_cache;
+    if (!cached) {
+        b->summary_cache = NULL;
+    }
+    assert_int_equal(0, jsdrv_bufsig_process_request(b, &req, rsp));
+    b->summary_cache = cache;
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_SUMMARY, rsp->response_type);
+}
+
+static void check_entries_equal(const struct jsdrv_summary_entry_s * e, const struct jsdrv_summary_entry_s * a,
+                                uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        assert_float_equal(e[i].avg, a[i].avg, 1e-9);
+        assert_float_equal(e[i].std, a[i].std, 1e-9);
+        assert_float_equal(e[i].min, a[i].min, 1e-9);
+        assert_float_equal(e[i].max, a[i].max, 1e-9);
+    }
+}
+
+static void test_summary_tile(void **state) {
+    initialize();
+    for (uint64_t sample_id = 0; sample_id < 450000; sample_id += 1000) {
+        insert_samples(&b, sample_id, 1000);
+    }
+    uint64_t rsp1_u64[1 << 12];
+    uint64_t rsp2_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp1 = (struct jsdrv_buffer_response_s *) rsp1_u64;
+    struct jsdrv_buffer_response_s * rsp2 = (struct jsdrv_buffer_response_s *) rsp2_u64;
+
+    // snap to a power-of-two increment, aligned
+    tile_request(&b, 300001, 400000, rsp1, true);
+    struct jsdrv_time_range_samples_s r = rsp1->info.time_range_samples;
+    assert_int_equal(299008, r.start);
+    assert_int_equal(99, r.length);
+    assert_int_equal(299008 + 99 * 1024, r.end);  // responses end after the last entry
+
+    struct jsdrv_time_range_samples_s n[JSDRV_BUFSIG_TILE_NEIGHBORS];
+    for (uint32_t idx = 0; idx < JSDRV_BUFSIG_TILE_NEIGHBORS; ++idx) {
+        assert_true(jsdrv_bufsig_tile_neighbor(&r, idx, &n[idx]));
+        assert_int_equal(99, n[idx].length);
+    }
+    assert_false(jsdrv_bufsig_tile_neighbor(&r, JSDRV_BUFSIG_TILE_NEIGHBORS, &n[0]));
+    assert_int_equal(r.start + 99 * 1024, n[0].start);
+    assert_int_equal(r.start - 99 * 1024, n[1].start);
+    assert_int_equal(0, n[2].start % 2048);
+    assert_int_equal(n[2].start + 99 * 2048 - 1, n[2].end);
+    assert_int_equal(0, n[3].start % 512);
+    assert_int_equal(n[3].start + 99 * 512 - 1, n[3].end);
+
+    struct bufsig_s copy;
+    for (uint32_t idx = 0; idx < JSDRV_BUFSIG_TILE_NEIGHBORS; ++idx) {
+        jsdrv_bufsig_summary_prefetch(&b, &copy, &n[idx]);
+    }
+
+    // pan left by half a tile, stitched from the previous tile and the response
+    uint64_t rsp3_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp3 = (struct jsdrv_buffer_response_s *) rsp3_u64;
+    struct jsdrv_summary_entry_s * e1 = (struct jsdrv_summary_entry_s *) rsp1->data;
+    struct jsdrv_summary_entry_s * e2 = (struct jsdrv_summary_entry_s *) rsp2->data;
+    struct jsdrv_summary_entry_s * e3 = (struct jsdrv_summary_entry_s *) rsp3->data;
+    tile_request(&b, n[1].start, n[1].end, rsp1, false);
+    tile_request(&b, r.start, r.end - 1, rsp2, false);
+    uint64_t start = r.start - 50 * 1024;
+    tile_request(&b, start, start + 99 * 1024 - 1, rsp3, true);
+    assert_int_equal(start, rsp3->info.time_range_samples.start);
+    assert_int_equal(99, rsp3->info.time_range_samples.length);
+    check_entries_equal(e1 + 49, e3, 50);
+    check_entries_equal(e2, e3 + 50, 49);
+
+    // zoom in to the child tile
+    tile_request(&b, n[3].start, n[3].end, rsp1, false);
+    tile_request(&b, n[3].start, n[3].end, rsp2, true);
+    assert_int_equal(n[3].start, rsp2->info.time_range_samples.start);
+    check_entries_equal(e1, e2, 99);
+    jsdrv_bufsig_free(&b);
+}
+
+static void test_chunked(void **state) {
+    initialize();
+    for (uint64_t sample_id = 0; sample_id < 500000; sample_id += 1000) {
+        insert_samples(&b, sample_id, 1000);
+    }
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.flags = JSDRV_BUFFER_REQUEST_FLAG_CHUNKED;
+    req.time.samples.start = 100000;
+    req.time.samples.length = 300000;
+    uint64_t rsp_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+
+    uint64_t sample_id = 100000;
+    uint32_t count = 0;
+    do {
+        assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+        uint64_t length = rsp->info.time_range_samples.length;
+        assert_true(length > 0);
+        check_samples(rsp, sample_id, length);
+        sample_id += length;
+        ++count;
+    } while (0 == (rsp->flags & JSDRV_BUFFER_RESPONSE_FLAG_END));
+    assert_int_equal(400000, sample_id);
+    assert_true(count > 1);
+
+    // samples past the newest sample end the sequence
+    memset(&req.time, 0, sizeof(req.time));
+    req.time.samples.start = 450000;
+    req.time.samples.end = 600000;
+    sample_id = 450000;
+    do {
+        assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+        sample_id += rsp->info.time_range_samples.length;
+    } while (0 == (rsp->flags & JSDRV_BUFFER_RESPONSE_FLAG_END));
+    assert_int_equal(500000, sample_id);
+
+    // summaries longer than one response
+    memset(&req.time, 0, sizeof(req.time));
+    req.time.samples.start = 100000;
+    req.time.samples.end = 499999;
+    req.time.samples.length = 10000;
+    uint64_t entry_idx = 0;
+    count = 0;
+    do {
+        assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+        assert_int_equal(JSDRV_BUFFER_RESPONSE_SUMMARY, rsp->response_type);
+        assert_int_equal(100000 + entry_idx * 40, rsp->info.time_range_samples.start);
+        struct jsdrv_summary_entry_s * entries = (struct jsdrv_summary_entry_s *) rsp->data;
+        for (uint64_t i = 0; i < rsp->info.time_range_samples.length; ++i, ++entry_idx) {
+            assert_float_equal((100000 + entry_idx * 40 + 19.5) / 1000000.0, entries[i].avg, 1e-6);
+        }
+        ++count;
+    } while (0 == (rsp->flags & JSDRV_BUFFER_RESPONSE_FLAG_END));
+    assert_int_equal(10000, entry_idx);
+    assert_true(count > 1);
+
+    // without the flag, a single response
+    req.flags = 0;
+    assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+    assert_true(0 != (rsp->flags & JSDRV_BUFFER_RESPONSE_FLAG_END));
+
+    jsdrv_bufsig_free(&b);
+}
+
+static void check_uint_samples(uint8_t bits, bool unpack) {
+    struct bufsig_s b;
+    uint64_t sample_id_head = uint_fill(&b, bits);
+    uint64_t rsp_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.flags = unpack ? JSDRV_BUFFER_REQUEST_FLAG_UNPACK : 0;
+    const uint64_t starts[] = {
+        sample_id_head - 50000, sample_id_head - 50003, sample_id_head - 1777,
+        1024 * 100 - 5, 1024 * 100 - 100, 1024 * 100 - 64,    // across the ring end
+    };
+    const uint64_t lengths[] = {1, 7, 64, 65, 129, 1000};
+    for (size_t i = 0; i < (sizeof(starts) / sizeof(starts[0])); ++i) {
+        for (size_t j = 0; j < (sizeof(lengths) / sizeof(lengths[0])); ++j) {
+            req.time.samples.start = starts[i];
+            req.time.samples.length = lengths[j];
+            assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+            assert_int_equal(JSDRV_BUFFER_RESPONSE_SAMPLES, rsp->response_type);
+            assert_int_equal(starts[i], rsp->info.time_range_samples.start);
+            assert_int_equal(lengths[j], rsp->info.time_range_samples.length);
+            assert_int_equal(unpack ? 8 : bits, rsp->info.element_size_bits);
+            const uint8_t * data = (const uint8_t *) rsp->data;
+            for (uint64_t k = 0; k < lengths[j]; ++k) {
+                uint8_t v;
+                if (unpack) {
+                    v = data[k];
+                } else {
+                    uint64_t bit = k * bits;
+                    v = (data[bit >> 3] >> (bit & 7)) & ((1U << bits) - 1);
+                }
+                assert_int_equal(uint_sample(starts[i] + k, bits), v);
+            }
+        }
+    }
+    jsdrv_bufsig_free(&b);
+}
+
+static void test_samples_uint(void **state) {
+    (void) state;
+    check_uint_samples(1, false);
+    check_uint_samples(4, false);
+    check_uint_samples(1, true);
+    check_uint_samples(4, true);
+}
+
+static float packed_sample(uint64_t sample_id, bool noise) {
+    uint32_t h = (uint32_t) (sample_id * 2654435761U);
+    if (noise) {
+        float x;
+        memcpy(&x, &h, sizeof(x));  // every bit pattern
+        return x;
+    }
+    return 0.01f + 0.001f * sinf(sample_id * 1e-3f) + (float) (h >> 24) * 1e-9f;
+}
+
+static void packed_insert(struct bufsig_s * b, uint64_t sample_id_start, uint32_t length, bool noise) {
+    struct jsdrv_stream_signal_s s;
+    memset(&s, 0, sizeof(s));
+    s.sample_id = sample_id_start;
+    s.field_id = JSDRV_FIELD_CURRENT;
+    s.index = 7;
+    s.element_type = JSDRV_DATA_TYPE_FLOAT;
+    s.element_size_bits = 32;
+    s.element_count = length;
+    s.sample_rate = 1000000;
+    s.decimate_factor = 1;
+    s.time_map.counter_rate = s.sample_rate;
+    float * f32 = (float *) s.data;
+    for (uint32_t i = 0; i < s.element_count; ++i) {
+        f32[i] = packed_sample(sample_id_start + i, noise);
+    }
+    jsdrv_bufsig_recv_data(b, &s);
+}
+
+static void check_packed_samples(struct bufsig_s * expect, struct bufsig_s * actual, uint64_t start) {
+    struct jsdrv_buffer_request_s req;
+    uint64_t rsp1_u64[1 << 14];
+    uint64_t rsp2_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp1 = (struct jsdrv_buffer_response_s *) rsp1_u64;
+    struct jsdrv_buffer_response_s * rsp2 = (struct jsdrv_buffer_response_s *) rsp2_u64;
+    uint64_t sample_id = start;
+    while (sample_id < actual->sample_id_head) {
+        memset(&req, 0, sizeof(req));
+        req.version = 1;
+        req.time_type = JSDRV_TIME_SAMPLES;
+        req.time.samples.start = sample_id;
+        req.time.samples.length = 5003;  // not block aligned
+        assert_int_equal(0, jsdrv_bufsig_process_request(expect, &req, rsp1));
+        assert_int_equal(0, jsdrv_bufsig_process_request(actual, &req, rsp2));
+        uint64_t length = rsp2->info.time_range_samples.length;
+        assert_true(length > 0);
+        assert_int_equal(sample_id, rsp2->info.time_range_samples.start);
+        assert_int_equal(length, rsp1->info.time_range_samples.length);
+        assert_memory_equal(rsp1->data, rsp2->data, length * sizeof(float));  // lossless, including NaN
+        sample_id += length;
+    }
+}
+
+static void f32_alloc(struct bufsig_s * b, uint8_t ratio, uint64_t horizon) {
+    memset(b, 0, sizeof(*b));
+    jsdrv_cstr_copy(b->topic, SRC_TOPIC, sizeof(b->topic));
+    b->hdr.field_id = JSDRV_FIELD_CURRENT;
+    b->hdr.index = 7;
+    b->hdr.element_type = JSDRV_DATA_TYPE_FLOAT;
+    b->hdr.element_size_bits = 32;
+    b->hdr.decimate_factor = 1;
+    b->hdr.sample_rate = 1000000;
+    b->active = true;
+    b->level0_ratio = ratio;
+    b->level0_horizon = horizon;
+    jsdrv_bufsig_alloc(b, 1000000, 64, 8);
+}
+
+static void test_packed(void **state) {
+    (void) state;
+    struct bufsig_s b;
+    struct bufsig_s p;
+    f32_alloc(&b, 0, 0);
+    f32_alloc(&p, 2, 0);
+    assert_null(b.level0_pack);
+    assert_non_null(p.level0_pack);
+    assert_true(jsdrv_bufsig_level0_bytes(&p) < (jsdrv_bufsig_level0_bytes(&b) * 2 / 3));
+
+    // compressible, with a skip filled with NaN
+    uint64_t sample_id = 0;
+    for (; sample_id < 2500000; sample_id += 1000) {
+        uint64_t offset = (sample_id == 2300000) ? 500 : 0;
+        packed_insert(&b, sample_id + offset, 1000 - (uint32_t) offset, false);
+        packed_insert(&p, sample_id + offset, 1000 - (uint32_t) offset, false);
+    }
+    assert_int_equal(b.sample_id_head, p.sample_id_head);
+    assert_int_equal(1000000 - 64 + (p.level0_head % 64), p.level0_size);  // all but the replaced head block
+    check_packed_samples(&b, &p, p.sample_id_head - p.level0_size);
+
+    uint64_t rsp1_u64[1 << 12];
+    uint64_t rsp2_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp1 = (struct jsdrv_buffer_response_s *) rsp1_u64;
+    struct jsdrv_buffer_response_s * rsp2 = (struct jsdrv_buffer_response_s *) rsp2_u64;
+    const uint64_t starts[] = {1600003, 2250000, 2397000};
+    for (uint32_t i = 0; i < (sizeof(starts) / sizeof(starts[0])); ++i) {
+        summary_request(&b, starts[i], rsp1, false);
+        summary_request(&p, starts[i], rsp2, false);
+        check_summary_equal(rsp1, rsp2, 0.0);
+    }
+
+    // incompressible: drop the oldest blocks to stay within the memory
+    for (; sample_id < 4000000; sample_id += 1000) {
+        packed_insert(&b, sample_id, 1000, true);
+        packed_insert(&p, sample_id, 1000, true);
+    }
+    assert_int_equal(1000000, b.level0_size);
+    assert_true(p.level0_size > 400000);
+    assert_true(p.level0_size < 520000);
+    check_packed_samples(&b, &p, p.sample_id_head - p.level0_size);
+
+    jsdrv_bufsig_free(&p);
+    jsdrv_bufsig_free(&b);
+}
+
+static void summary_request_n(struct bufsig_s * b, uint64_t start, uint64_t incr,
+                              struct jsdrv_buffer_response_s * rsp) {
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = start;
+    req.time.samples.end = start + incr * 100 - 1;
+    req.time.samples.length = 100;
+    struct bufsig_summary_cache_s * cache = b->summary_cache;
+    b->summary_cache = NULL;
+    assert_int_equal(0, jsdrv_bufsig_process_request(b, &req, rsp));
+    b->summary_cache = cache;
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_SUMMARY, rsp->response_type);
+    assert_int_equal(100, rsp->info.time_range_samples.length);
+}
+
+static void test_horizon(void **state) {
+    (void) state;
+    struct bufsig_s b;
+    struct bufsig_s h;
+    f32_alloc(&b, 0, 0);
+    f32_alloc(&h, 0, 100000);
+    assert_int_equal(1000000, b.level0_N);
+    assert_int_equal(200000, h.level0_N);  // 3125 blocks of 64 divides 15625 blocks
+    assert_int_equal(jsdrv_bufsig_level0_bytes(&b) / 5, jsdrv_bufsig_level0_bytes(&h));
+
+    uint64_t sample_id = 0;
+    for (; sample_id < 2500000; sample_id += 1000) {
+        uint64_t offset = (sample_id == 2450000) ? 500 : 0;
+        packed_insert(&b, sample_id + offset, 1000 - (uint32_t) offset, false);
+        packed_insert(&h, sample_id + offset, 1000 - (uint32_t) offset, false);
+    }
+    struct jsdrv_buffer_info_s info;
+    jsdrv_bufsig_info(&h, &info);
+    assert_int_equal(1000000, info.time_range_samples.length);  // summaries for all
+
+    // samples only for the horizon
+    check_packed_samples(&b, &h, 2300000);
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 2000000;
+    req.time.samples.length = 1000;
+    uint64_t rsp1_u64[1 << 12];
+    uint64_t rsp2_u64[1 << 12];
+    struct jsdrv_buffer_response_s * rsp1 = (struct jsdrv_buffer_response_s *) rsp1_u64;
+    struct jsdrv_buffer_response_s * rsp2 = (struct jsdrv_buffer_response_s *) rsp2_u64;
+    assert_int_equal(0, jsdrv_bufsig_process_request(&h, &req, rsp2));
+    assert_int_equal(0, rsp2->info.time_range_samples.length);
+
+    // summaries before the horizon: exact for whole level 1 entries, estimated for partial entries
+    summary_request_n(&b, 1600000, 1024, rsp1);
+    summary_request_n(&h, 1600000, 1024, rsp2);
+    check_summary_equal(rsp1, rsp2, 0.0);
+    summary_request_n(&b, 1600003, 1000, rsp1);
+    summary_request_n(&h, 1600003, 1000, rsp2);
+    check_summary_equal(rsp1, rsp2, 1e-4);
+    summary_request_n(&b, 1600003, 10, rsp1);
+    summary_request_n(&h, 1600003, 10, rsp2);
+    check_summary_equal(rsp1, rsp2, 1e-4);
+    summary_request_n(&b, 2400003, 1000, rsp1);  // within the horizon
+    summary_request_n(&h, 2400003, 1000, rsp2);
+    check_summary_equal(rsp1, rsp2, 0.0);
+
+    jsdrv_bufsig_free(&h);
+    jsdrv_bufsig_free(&b);
+}
+
+static void align_request(struct bufsig_s * const * signals, uint64_t start, uint64_t end, uint64_t length,
+                          uint64_t size_max, struct jsdrv_buffer_request_s * req) {
+    memset(req, 0, sizeof(*req));
+    req->version = 1;
+    req->time_type = JSDRV_TIME_SAMPLES;
+    req->time.samples.start = start;
+    req->time.samples.end = end;
+    req->time.samples.length = length;
+    assert_int_equal(0, jsdrv_bufsig_request_align(signals, 2, req, size_max));
+}
+
+static void test_request_align(void **state) {
+    (void) state;
+    struct bufsig_s b;
+    struct bufsig_s h;
+    struct bufsig_s * signals[] = {&b, &h};
+    f32_alloc(&b, 0, 0);
+    f32_alloc(&h, 0, 0);
+    for (uint64_t sample_id = 0; sample_id < 500000; sample_id += 1000) {
+        packed_insert(&b, sample_id, 1000, false);
+        packed_insert(&h, sample_id + 100000, 1000, false);
+    }
+    struct jsdrv_buffer_request_s req;
+    struct jsdrv_buffer_request_s req_copy;
+    uint64_t rsp_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+
+    // samples clip to the range that both signals hold
+    align_request(signals, 95000, 0, 10000, 1 << 16, &req);
+    assert_int_equal(100000, req.time.samples.start);
+    assert_int_equal(104999, req.time.samples.end);
+    for (uint32_t k = 0; k < 2; ++k) {
+        req_copy = req;
+        assert_int_equal(0, jsdrv_bufsig_process_request(signals[k], &req_copy, rsp));
+        assert_int_equal(JSDRV_BUFFER_RESPONSE_SAMPLES, rsp->response_type);
+        assert_int_equal(100000, rsp->info.time_range_samples.start);
+        assert_int_equal(5000, rsp->info.time_range_samples.length);
+        assert_float_equal(packed_sample(100000, false), ((float *) rsp->data)[0], 0.0);
+    }
+    align_request(signals, 495000, 505000, 0, 1 << 16, &req);
+    assert_int_equal(495000, req.time.samples.start);
+    assert_int_equal(499999, req.time.samples.end);
+
+    // samples truncate to fit both signals
+    align_request(signals, 200000, 0, 10000, 4000, &req);
+    assert_int_equal(200000, req.time.samples.start);
+    assert_int_equal(500, req.time.samples.length);
+
+    // no common samples
+    align_request(signals, 10000, 0, 1000, 1 << 16, &req);
+    for (uint32_t k = 0; k < 2; ++k) {
+        req_copy = req;
+        assert_int_equal(0, jsdrv_bufsig_process_request(signals[k], &req_copy, rsp));
+        assert_int_equal(0, rsp->info.time_range_samples.length);
+    }
+
+    // summaries keep the requested grid, with NaN before the data
+    align_request(signals, 0, 199999, 100, 1 << 16, &req);
+    assert_int_equal(0, req.time.samples.start);
+    assert_int_equal(199999, req.time.samples.end);
+    req_copy = req;
+    assert_int_equal(0, jsdrv_bufsig_process_request(&h, &req_copy, rsp));
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_SUMMARY, rsp->response_type);
+    assert_int_equal(0, rsp->info.time_range_samples.start);
+    assert_int_equal(100, rsp->info.time_range_samples.length);
+    struct jsdrv_summary_entry_s * e = (struct jsdrv_summary_entry_s *) rsp->data;
+    assert_true(isnan(e[0].avg));
+    assert_false(isnan(e[99].avg));
+    req.time.samples.length = 100;
+    assert_int_equal(JSDRV_ERROR_TOO_BIG, jsdrv_bufsig_request_align(signals, 2, &req, 3000));
+
+    // signals must share the sample rate
+    h.hdr.decimate_factor = 2;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_bufsig_request_align(signals, 2, &req, 1 << 16));
+    h.hdr.decimate_factor = 1;
+
+    jsdrv_bufsig_free(&h);
+    jsdrv_bufsig_free(&b);
+}
+
+static void test_resample(void **state) {
+    (void) state;
+    struct bufsig_s b;
+    f32_alloc(&b, 0, 0);
+    for (uint64_t sample_id = 0; sample_id < 1000000; sample_id += 1000) {
+        packed_insert(&b, sample_id, 1000, false);
+    }
+    struct jsdrv_buffer_request_s req;
+    uint64_t rsp_u64[1 << 14];
+    uint64_t ref_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    struct jsdrv_buffer_response_s * ref = (struct jsdrv_buffer_response_s *) ref_u64;
+
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.sample_rate = 10000;
+    req.time.samples.start = 100000;
+    req.time.samples.length = 200000;
+    assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, ref));
+    req.time.samples.start = 200000;
+    req.time.samples.length = 100000;
+    assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_RESAMPLED, rsp->response_type);
+    struct jsdrv_time_range_samples_s * r = &rsp->info.time_range_samples;
+    assert_int_equal(1000, r->length);
+    assert_true(r->start >= 200000);
+    assert_true(r->end <= 299999);
+    assert_int_equal(r->end - r->start, (r->length - 1) * 100);
+    assert_int_equal(0, (r->start - ref->info.time_range_samples.start) % 100);
+    float * y = (float *) rsp->data;
+    float * y_ref = ((float *) ref->data) + (r->start - ref->info.time_range_samples.start) / 100;
+    for (uint64_t i = 0; i < r->length; ++i) {
+        assert_float_equal(y_ref[i], y[i], 1e-6);  // settled before the range
+    }
+
+    // chunked responses continue on the same grid
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.flags = JSDRV_BUFFER_REQUEST_FLAG_CHUNKED;
+    req.sample_rate = 100000;
+    req.time.samples.start = 0;
+    req.time.samples.end = 999999;
+    uint64_t total = 0;
+    uint64_t next = 0;
+    uint32_t count = 0;
+    do {
+        assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+        assert_int_equal(JSDRV_BUFFER_RESPONSE_RESAMPLED, rsp->response_type);
+        if (count) {
+            assert_int_equal(next, r->start);
+        }
+        total += r->length;
+        next = r->end + 10;
+        ++count;
+    } while (!(rsp->flags & JSDRV_BUFFER_RESPONSE_FLAG_END));
+    assert_true(count > 1);
+    assert_true(total >= 99990);
+    assert_true(total <= 100000);
+
+    // the buffer rate returns samples
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.sample_rate = 1000000;
+    req.time.samples.start = 200000;
+    req.time.samples.length = 1000;
+    assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, rsp));
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_SAMPLES, rsp->response_type);
+    assert_int_equal(1000, r->length);
+
+    jsdrv_bufsig_free(&b);
+}
+
+static uint64_t search_brute(struct bufsig_s * b, uint64_t start, uint64_t end, uint8_t op, float threshold,
+                             uint64_t * hits, uint64_t hits_max) {
+    struct jsdrv_buffer_request_s req;
+    uint64_t rsp_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    uint64_t count = 0;
+    int8_t side = -1;
+    for (uint64_t sample_id = start; (sample_id < end) && (count < hits_max); ) {
+        memset(&req, 0, sizeof(req));
+        req.version = 1;
+        req.time_type = JSDRV_TIME_SAMPLES;
+        req.time.samples.start = sample_id;
+        req.time.samples.end = end - 1;
+        assert_int_equal(0, jsdrv_bufsig_process_request(b, &req, rsp));
+        float * x = (float *) rsp->data;
+        for (uint64_t i = 0; (i < rsp->info.time_range_samples.length) && (count < hits_max); ++i) {
+            int8_t v = (x[i] > threshold) ? 1 : 0;
+            if ((side >= 0) && (v != side) && (op & (v ? JSDRV_BUFFER_SEARCH_RISE : JSDRV_BUFFER_SEARCH_FALL))) {
+                hits[count++] = sample_id + i;
+            }
+            side = v;
+        }
+        sample_id += rsp->info.time_range_samples.length;
+    }
+    return count;
+}
+
+static void search(struct bufsig_s * b, uint64_t start, uint64_t end, uint8_t op, float threshold, uint32_t hits_max,
+                   struct jsdrv_buffer_response_s * rsp) {
+    struct jsdrv_buffer_search_s s;
+    memset(&s, 0, sizeof(s));
+    s.req.version = 1;
+    s.req.time_type = JSDRV_TIME_SAMPLES;
+    s.req.time.samples.start = start;
+    s.req.time.samples.end = end - 1;
+    s.op = op;
+    s.threshold = threshold;
+    s.hits_max = hits_max;
+    assert_int_equal(0, jsdrv_bufsig_search(b, &s, rsp));
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_SEARCH, rsp->response_type);
+    assert_int_equal(JSDRV_DATA_TYPE_UINT, rsp->info.element_type);
+    assert_int_equal(64, rsp->info.element_size_bits);
+}
+
+static void test_search(void **state) {
+    (void) state;
+    struct bufsig_s b;
+    f32_alloc(&b, 0, 0);
+    for (uint64_t sample_id = 0; sample_id < 1500000; sample_id += 1000) {
+        packed_insert(&b, sample_id, 1000, false);  // wraps the buffer
+    }
+    uint64_t rsp_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    struct jsdrv_time_range_samples_s * r = &rsp->info.time_range_samples;
+    uint64_t * hits = (uint64_t *) rsp->data;
+    uint64_t expect[1024];
+    const uint8_t ops[] = {JSDRV_BUFFER_SEARCH_RISE, JSDRV_BUFFER_SEARCH_FALL, JSDRV_BUFFER_SEARCH_CROSS};
+    const float thresholds[] = {0.0105f, 0.01f, 0.0f, 0.0115f};
+
+    for (uint32_t i = 0; i < JSDRV_ARRAY_SIZE(ops); ++i) {
+        for (uint32_t j = 0; j < JSDRV_ARRAY_SIZE(thresholds); ++j) {
+            uint64_t n = search_brute(&b, 600001, 1499990, ops[i], thresholds[j], expect, JSDRV_ARRAY_SIZE(expect));
+            assert_true(n < JSDRV_ARRAY_SIZE(expect));
+            search(&b, 600001, 1499990, ops[i], thresholds[j], 0, rsp);
+            assert_int_equal(600001, r->start);
+            assert_int_equal(1499989, r->end);
+            assert_int_equal(n, r->length);
+            assert_memory_equal(expect, hits, n * sizeof(uint64_t));
+        }
+    }
+
+    // hits_max stops at the last hit, and the next search continues
+    uint64_t n = search_brute(&b, 500000, 1500000, JSDRV_BUFFER_SEARCH_CROSS, 0.01f, expect, JSDRV_ARRAY_SIZE(expect));
+    assert_true(n > 10);
+    search(&b, 500000, 1500000, JSDRV_BUFFER_SEARCH_CROSS, 0.01f, 5, rsp);
+    assert_int_equal(5, r->length);
+    assert_int_equal(expect[4], r->end);
+    assert_memory_equal(expect, hits, 5 * sizeof(uint64_t));
+    search(&b, expect[4] - 1, 1500000, JSDRV_BUFFER_SEARCH_CROSS, 0.01f, 5, rsp);
+    assert_int_equal(5, r->length);
+    assert_memory_equal(expect + 4, hits, 5 * sizeof(uint64_t));
+
+    // maximum and minimum
+    struct jsdrv_buffer_request_s req;
+    uint64_t data_u64[1 << 14];
+    struct jsdrv_buffer_response_s * data = (struct jsdrv_buffer_response_s *) data_u64;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 1200003;
+    req.time.samples.length = 10000;
+    assert_int_equal(0, jsdrv_bufsig_process_request(&b, &req, data));
+    float * x = (float *) data->data;
+    uint64_t idx_max = 0;
+    uint64_t idx_min = 0;
+    for (uint64_t i = 0; i < data->info.time_range_samples.length; ++i) {
+        idx_max = (x[i] > x[idx_max]) ? i : idx_max;
+        idx_min = (x[i] < x[idx_min]) ? i : idx_min;
+    }
+    search(&b, 1200003, 1210003, JSDRV_BUFFER_SEARCH_MAX, 0.0f, 0, rsp);
+    assert_int_equal(1, r->length);
+    assert_int_equal(1200003 + idx_max, hits[0]);
+    search(&b, 1200003, 1210003, JSDRV_BUFFER_SEARCH_MIN, 0.0f, 0, rsp);
+    assert_int_equal(1, r->length);
+    assert_int_equal(1200003 + idx_min, hits[0]);
+
+    // outside the buffer
+    search(&b, 0, 400000, JSDRV_BUFFER_SEARCH_CROSS, 0.01f, 0, rsp);
+    assert_int_equal(0, r->length);
+    search(&b, 0, 400000, JSDRV_BUFFER_SEARCH_MAX, 0.01f, 0, rsp);
+    assert_int_equal(0, r->length);
+
+    jsdrv_bufsig_free(&b);
+}
+
+static void stats_brute(struct bufsig_s * b, uint64_t start, uint64_t end, struct jsdrv_statistics_accum_s * a) {
+    struct jsdrv_buffer_request_s req;
+    uint64_t rsp_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    struct jsdrv_statistics_accum_s s;
+    jsdrv_statistics_reset(a);
+    for (uint64_t sample_id = start; sample_id < end; ) {
+        memset(&req, 0, sizeof(req));
+        req.version = 1;
+        req.time_type = JSDRV_TIME_SAMPLES;
+        req.time.samples.start = sample_id;
+        req.time.samples.end = end - 1;
+        assert_int_equal(0, jsdrv_bufsig_process_request(b, &req, rsp));
+        jsdrv_statistics_compute_f32(&s, (float *) rsp->data, rsp->info.time_range_samples.length);
+        jsdrv_statistics_combine(a, a, &s);
+        sample_id += rsp->info.time_range_samples.length;
+    }
+}
+
+static void stats_request(struct bufsig_s * const * signals, uint32_t count, uint64_t start, uint64_t end,
+                          struct jsdrv_buffer_response_s * rsp) {
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = start;
+    req.time.samples.end = end - 1;
+    req.rsp_id = 7;
+    assert_int_equal(0, jsdrv_bufsig_statistics(signals, count, &req, rsp));
+    assert_int_equal(JSDRV_BUFFER_RESPONSE_STATISTICS, rsp->response_type);
+    assert_int_equal(7, rsp->rsp_id);
+}
+
+static void check_stats(struct jsdrv_statistics_accum_s * a, double avg, double std, double v_min, double v_max) {
+    assert_float_equal(a->mean, avg, 1e-6 * fabs(a->mean));
+    assert_float_equal(sqrt(a->s / (double) a->k), std, 1e-3 * std);
+    assert_float_equal(a->min, v_min, 0.0);
+    assert_float_equal(a->max, v_max, 0.0);
+}
+
+static void test_statistics(void **state) {
+    (void) state;
+    struct bufsig_s i;
+    struct bufsig_s p;
+    f32_alloc(&i, 0, 0);
+    f32_alloc(&p, 0, 0);
+    for (uint64_t sample_id = 0; sample_id < 1500000; sample_id += 1000) {
+        packed_insert(&i, sample_id, 1000, false);  // wraps the buffer
+        packed_insert(&p, sample_id + 3, 1000, false);
+    }
+    p.hdr.field_id = JSDRV_FIELD_POWER;
+    struct bufsig_s * signals[] = {&i, &p};
+    uint64_t rsp_u64[1 << 14];
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64;
+    struct jsdrv_time_range_samples_s * r = &rsp->info.time_range_samples;
+    struct jsdrv_statistics_s * y = (struct jsdrv_statistics_s *) rsp->data;
+    struct jsdrv_statistics_accum_s a;
+    const uint64_t ranges[][2] = {{500003, 1500003}, {600001, 1499990}, {1200017, 1200529}, {999999, 1000001}};
+
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ranges); ++k) {
+        uint64_t start = ranges[k][0];
+        uint64_t end = (ranges[k][1] < 1500000) ? ranges[k][1] : 1500000;  // clipped to the signals' head
+        stats_request(signals, 2, ranges[k][0], ranges[k][1], rsp);
+        assert_int_equal(start, r->start);
+        assert_int_equal(end - 1, r->end);
+        assert_int_equal(sizeof(struct jsdrv_statistics_s), r->length);
+        assert_int_equal(end - start, y->block_sample_count);
+        assert_int_equal(start, y->block_sample_id);
+        stats_brute(&i, start, end, &a);
+        check_stats(&a, y->i_avg, y->i_std, y->i_min, y->i_max);
+        assert_float_equal(a.mean * (end - start) / 1000000.0, y->charge_f64, 1e-6 * fabs(y->charge_f64));
+        int64_t charge_q31 = (int64_t) y->charge_i128[0];
+        assert_float_equal(y->charge_f64, ldexp((double) charge_q31, -31), 1e-9);
+        stats_brute(&p, start, end, &a);
+        check_stats(&a, y->p_avg, y->p_std, y->p_min, y->p_max);
+        assert_true(isnan(y->v_avg));
+    }
+
+    // outside the buffer
+    stats_request(signals, 2, 0, 400000, rsp);
+    assert_int_equal(0, r->length);
+
+    // at most one signal for each field
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 600000;
+    struct bufsig_s * signals_dup[] = {&i, &i};
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_bufsig_statistics(signals_dup, 2, &req, rsp));
+
+    jsdrv_bufsig_free(&i);
+    jsdrv_bufsig_free(&p);
+}
 
 int main(void) {
     const struct CMUnitTest tests[] = {
@@ -323,10 +1580,29 @@ int main(void) {
             cmocka_unit_test(test_samples_start_end),
             cmocka_unit_test(test_samples_all),
             cmocka_unit_test(test_samples_wrap),
+            cmocka_unit_test(test_hold),
             cmocka_unit_test(test_summary_simple),
             cmocka_unit_test(test_summary_level1),
             cmocka_unit_test(test_summary_nan_on_out_of_range),
             cmocka_unit_test(test_summary_wrap),
+            cmocka_unit_test(test_summary_pyramid),
+            cmocka_unit_test(test_bulk),
+            cmocka_unit_test(test_summary_u1),
+            cmocka_unit_test(test_summary_u4),
+            cmocka_unit_test(test_file_restore),
+            cmocka_unit_test(test_save_load),
+            cmocka_unit_test(test_snapshot),
+            cmocka_unit_test(test_move),
+            cmocka_unit_test(test_summary_cache),
+            cmocka_unit_test(test_summary_tile),
+            cmocka_unit_test(test_chunked),
+            cmocka_unit_test(test_samples_uint),
+            cmocka_unit_test(test_packed),
+            cmocka_unit_test(test_horizon),
+            cmocka_unit_test(test_request_align),
+            cmocka_unit_test(test_resample),
+            cmocka_unit_test(test_search),
+            cmocka_unit_test(test_statistics),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "jsdrv.h"
+#include "jsdrv_prv/atomic.h"
 #include "jsdrv_prv/buffer.h"
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv/cstr.h"
@@ -129,6 +130,14 @@ struct jsdrvp_msg_s * jsdrvp_msg_clone(struct jsdrv_context_s * context, const s
     return m;
 }
 
+struct jsdrvp_msg_s * jsdrvp_msg_dispatch_ref(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg, uint32_t u32_a) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(context);
+    m->u32_a = u32_a;
+    jsdrv_atomic_add_u32(&msg->refcnt, 1);
+    m->payload.dispatch = msg;
+    return m;
+}
+
 void jsdrvp_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
     (void) context;
     if (msg->value.flags & JSDRV_UNION_FLAG_HEAP_MEMORY) {
@@ -137,6 +146,20 @@ void jsdrvp_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg
     free(msg);
 }
 
+void jsdrvp_msg_cache_attach(struct jsdrv_context_s * context) {
+    (void) context;
+}
+
+void jsdrvp_msg_cache_detach(struct jsdrv_context_s * context) {
+    (void) context;
+}
+
+void jsdrvp_thread_configure(struct jsdrv_context_s * context, enum jsdrvp_thread_e thread, const char * name) {
+    (void) context;
+    (void) thread;
+    (void) name;
+}
+
 static void subscribe(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
     struct sub_s * s = calloc(1, sizeof(struct sub_s));
     jsdrv_cstr_copy(s->topic, msg->payload.sub.topic, sizeof(s->topic));
@@ -217,6 +240,12 @@ static void msg_send_process_next(struct jsdrv_context_s * context, uint32_t tim
             ch += 4;
             if (0 == strcmp("info", ch)) {
                 check_expected_ptr(topic);
+            } else if (0 == strcmp("levels", ch)) {
+                const uint64_t * levels = (const uint64_t *) msg->value.value.bin;
+                assert_true(msg->value.size >= 2 * sizeof(uint64_t));
+                const uint64_t levels_ratio = levels[0] / levels[1];  // sample bytes / level 1 bytes
+                check_expected_ptr(topic);
+                check_expected(levels_ratio);
             } else {
                 // unknown topic, not supported
                 assert_true(0);
@@ -237,6 +266,22 @@ static void msg_send_process_next(struct jsdrv_context_s * context, uint32_t tim
         }
     } else if (jsdrv_cstr_ends_with(msg->topic, "!rsp")) {
         check_expected_ptr(topic);
+        if (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_RSP_MULTI) {
+            const struct jsdrv_buffer_response_multi_s * rsp = (const struct jsdrv_buffer_response_multi_s *) msg->value.value.bin;
+            const uint8_t rsp_signal_count = rsp->signal_count;
+            check_expected(rsp_signal_count);
+        } else if (msg->value.app == JSDRV_PAYLOAD_TYPE_BUFFER_RSP) {
+            const struct jsdrv_buffer_response_s * rsp = (const struct jsdrv_buffer_response_s *) msg->value.value.bin;
+            if (rsp->response_type == JSDRV_BUFFER_RESPONSE_SEARCH) {
+                assert_int_equal(1, rsp->info.time_range_samples.length);
+                const uint64_t rsp_search_hit = rsp->data[0];
+                check_expected(rsp_search_hit);
+            } else if (rsp->response_type == JSDRV_BUFFER_RESPONSE_STATISTICS) {
+                const struct jsdrv_statistics_s * stats = (const struct jsdrv_statistics_s *) rsp->data;
+                const uint32_t rsp_stats_count = stats->block_sample_count;
+                check_expected(rsp_stats_count);
+            }
+        }
     } else {
         // ???
         assert_true(0);
@@ -263,9 +308,25 @@ static void msg_send_process_next(struct jsdrv_context_s * context, uint32_t tim
 #define expect_info_any(topic_) \
     expect_string(msg_send_process_next, topic, topic_)
 
+#define expect_levels(topic_, ratio_) \
+    expect_string(msg_send_process_next, topic, topic_); \
+    expect_value(msg_send_process_next, levels_ratio, ratio_)
+
 #define expect_rsp_any(topic_) \
     expect_string(msg_send_process_next, topic, topic_)
 
+#define expect_rsp_multi(topic_, signal_count_) \
+    expect_string(msg_send_process_next, topic, topic_); \
+    expect_value(msg_send_process_next, rsp_signal_count, signal_count_)
+
+#define expect_rsp_search(topic_, hit_) \
+    expect_string(msg_send_process_next, topic, topic_); \
+    expect_value(msg_send_process_next, rsp_search_hit, hit_)
+
+#define expect_rsp_stats(topic_, count_) \
+    expect_string(msg_send_process_next, topic, topic_); \
+    expect_value(msg_send_process_next, rsp_stats_count, count_)
+
 
 struct jsdrv_context_s * initialize() {
     uint8_t ex_list_buffer[] = {0};
@@ -361,12 +422,13 @@ static void test_add_remove(void **state) {
     finalize(context);
 }
 
-static struct jsdrvp_msg_s * generate_msg_data_i(struct jsdrv_context_s * context, uint64_t sample_id, uint32_t length) {
-    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_data(context, "u/js220/0123456/s/i/!data");
+static struct jsdrvp_msg_s * generate_msg_data(struct jsdrv_context_s * context, const char * topic, uint8_t field_id,
+                                               uint64_t sample_id, uint32_t length) {
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_data(context, topic);
     struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) msg->value.value.bin;
     uint32_t decimate_factor = 2;
     s->sample_id = sample_id * decimate_factor;
-    s->field_id = JSDRV_FIELD_CURRENT;
+    s->field_id = field_id;
     s->index = 0;
     s->element_type = JSDRV_DATA_TYPE_FLOAT;
     s->element_size_bits = 32;
@@ -380,6 +442,25 @@ static struct jsdrvp_msg_s * generate_msg_data_i(struct jsdrv_context_s * contex
     return msg;
 }
 
+static struct jsdrvp_msg_s * generate_msg_data_i(struct jsdrv_context_s * context, uint64_t sample_id, uint32_t length) {
+    return generate_msg_data(context, "u/js220/0123456/s/i/!data", JSDRV_FIELD_CURRENT, sample_id, length);
+}
+
+static void signal_add(struct jsdrv_context_s * context, uint8_t buffer_id, uint8_t signal_id, const char * topic) {
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_u8(signal_id));
+    tfp_snprintf(msg->topic, sizeof(msg->topic), "m/%03u/%s", buffer_id, JSDRV_BUFFER_MSG_ACTION_SIGNAL_ADD);
+    publish(context, msg);
+    msg = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_str(topic));
+    tfp_snprintf(msg->topic, sizeof(msg->topic), "m/%03u/s/%03u/topic", buffer_id, signal_id);
+    publish(context, msg);
+}
+
+static void signal_remove(struct jsdrv_context_s * context, uint8_t buffer_id, uint8_t signal_id) {
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_u8(signal_id));
+    tfp_snprintf(msg->topic, sizeof(msg->topic), "m/%03u/%s", buffer_id, JSDRV_BUFFER_MSG_ACTION_SIGNAL_REMOVE);
+    publish(context, msg);
+}
+
 static void test_one_signal(void **state) {
     (void) state;
     struct jsdrvp_msg_s * msg;
@@ -411,6 +492,11 @@ static void test_one_signal(void **state) {
     expect_subscribe("u/js220/0123456/s/i/!data");
     msg_send_process_next(context, TIMEOUT_MS);
 
+    // and set the first reduction, rounded up to a power of 2
+    msg = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_u32(200));
+    tfp_snprintf(msg->topic, sizeof(msg->topic), "m/%03u/s/%03u/r0", buffer_id, signal_id);
+    publish(context, msg);
+
     // set buffer size
     msg = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_u64(1000000LLU));
     tfp_snprintf(msg->topic, sizeof(msg->topic), "m/%03u/%s", buffer_id, JSDRV_BUFFER_MSG_SIZE);
@@ -421,6 +507,8 @@ static void test_one_signal(void **state) {
     publish(context, msg);
     expect_info_any("m/003/s/005/info");
     msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/003/s/005/levels", (256 * sizeof(float)) / sizeof(struct jsdrv_summary_entry_s));
+    msg_send_process_next(context, TIMEOUT_MS);
 
     // Send second data frame
     msg = generate_msg_data_i(context, 10100LLU, 100);
@@ -456,6 +544,73 @@ static void test_one_signal(void **state) {
     expect_rsp_any("t/!rsp");
     msg_send_process_next(context, TIMEOUT_MS);
 
+    // request summary data for multiple signals, expect one response
+    struct jsdrv_buffer_request_multi_s req_multi;
+    memset(&req_multi, 0, sizeof(req_multi));
+    req_multi.req = req;
+    req_multi.req.rsp_id = 44;
+    req_multi.signal_count = 2;
+    req_multi.signal_ids[0] = signal_id;
+    req_multi.signal_ids[1] = signal_id;
+    msg = jsdrvp_msg_alloc_value(context, "m/003/g/!req", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_multi("t/!rsp", 2);
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // search for the rising threshold crossing, expect response
+    struct jsdrv_buffer_search_s search;
+    memset(&search, 0, sizeof(search));
+    search.req = req;
+    search.req.rsp_id = 45;
+    search.op = JSDRV_BUFFER_SEARCH_RISE;
+    search.threshold = 10.1005f;
+    msg = jsdrvp_msg_alloc_value(context, "m/003/s/005/!search", &jsdrv_union_bin((uint8_t *) &search, sizeof(search)));
+    publish(context, msg);
+    expect_rsp_search("t/!rsp", 10101);
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // request range statistics, expect response
+    req_multi.req.rsp_id = 46;
+    req_multi.signal_count = 1;
+    msg = jsdrvp_msg_alloc_value(context, "m/003/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 100);  // clipped to the buffer contents
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // superseding background request, expect response
+    req_multi.req.rsp_id = 47;
+    req_multi.req.flags = JSDRV_BUFFER_REQUEST_FLAG_SUPERSEDE | JSDRV_BUFFER_REQUEST_FLAG_BACKGROUND;
+    msg = jsdrvp_msg_alloc_value(context, "m/003/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 100);
+    msg_send_process_next(context, TIMEOUT_MS);
+    req_multi.req.flags = 0;
+    publish(context, jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_CANCEL, &jsdrv_union_str("t/!rsp")));
+    publish(context, jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_CANCEL, &jsdrv_union_str("")));
+
+    // trigger on the rising edge, expect the window after the post samples
+    struct jsdrv_buffer_trigger_s trigger;
+    memset(&trigger, 0, sizeof(trigger));
+    trigger.window = req_multi;
+    trigger.window.req.rsp_id = 0;
+    trigger.mode = JSDRV_BUFFER_TRIGGER_MODE_SINGLE;
+    trigger.signal_id = signal_id;
+    trigger.op = JSDRV_BUFFER_SEARCH_RISE;
+    trigger.threshold = 10.2505f;
+    trigger.duration = 4;
+    trigger.pre = 50;
+    trigger.post = 60;
+    msg = jsdrvp_msg_alloc_value(context, "m/003/g/trigger", &jsdrv_union_bin((uint8_t *) &trigger, sizeof(trigger)));
+    publish(context, msg);
+    publish(context, generate_msg_data_i(context, 10200LLU, 100));
+    expect_info_any("m/003/s/005/info");  // edge at 10251, but waiting for post samples
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, generate_msg_data_i(context, 10300LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_rsp_multi("t/!rsp", 1);
+    msg_send_process_next(context, TIMEOUT_MS);
+
     // tear down
     msg = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_u8(signal_id));
     tfp_snprintf(msg->topic, sizeof(msg->topic), "m/%03u/%s", buffer_id, JSDRV_BUFFER_MSG_ACTION_SIGNAL_REMOVE);
@@ -476,12 +631,400 @@ static void test_one_signal(void **state) {
     finalize(context);
 }
 
+static void test_signal_add_remove_incremental(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * msg;
+    const uint8_t buffer_id = 3;
+    uint8_t ex_list_buffer0[] = {0};
+    uint8_t ex_list_buffer1[] = {buffer_id, 0};
+    uint8_t ex_list_sig0[] = {0};
+    uint8_t ex_list_sig5[] = {5, 0};
+    uint8_t ex_list_sig56[] = {5, 6, 0};
+
+    struct jsdrv_context_s * context = initialize();
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, &jsdrv_union_u8(buffer_id)));
+    expect_subscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer1, sizeof(ex_list_buffer1));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    signal_add(context, buffer_id, 5, "u/js220/0123456/s/i/!data");
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_subscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    msg = jsdrvp_msg_alloc_value(context, "", &jsdrv_union_u64(1000000LLU));
+    tfp_snprintf(msg->topic, sizeof(msg->topic), "m/%03u/%s", buffer_id, JSDRV_BUFFER_MSG_SIZE);
+    publish(context, msg);
+
+    publish(context, generate_msg_data_i(context, 10000LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/003/s/005/levels", (128 * sizeof(float)) / sizeof(struct jsdrv_summary_entry_s));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, generate_msg_data_i(context, 10100LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // add a signal: signal 5 keeps its allocation, so no info for signal 5
+    signal_add(context, buffer_id, 6, "u/js220/0123456/s/v/!data");
+    expect_sig_list(ex_list_sig56, sizeof(ex_list_sig56));
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_subscribe("u/js220/0123456/s/v/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // the added signal allocates on its first data
+    publish(context, generate_msg_data(context, "u/js220/0123456/s/v/!data", JSDRV_FIELD_VOLTAGE, 10100LLU, 100));
+    expect_info_any("m/003/s/006/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/003/s/006/levels", (128 * sizeof(float)) / sizeof(struct jsdrv_summary_entry_s));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // signal 5 continues
+    publish(context, generate_msg_data_i(context, 10200LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    struct jsdrv_buffer_request_s req;
+    memset(&req, 0, sizeof(req));
+    req.version = 1;
+    req.time_type = JSDRV_TIME_SAMPLES;
+    req.time.samples.start = 10000LLU;
+    req.time.samples.end = 10299LLU;
+    jsdrv_cstr_copy(req.rsp_topic, "t/!rsp", sizeof(req.rsp_topic));
+    req.rsp_id = 1;
+    struct jsdrv_buffer_request_multi_s req_multi;
+    memset(&req_multi, 0, sizeof(req_multi));
+    req_multi.req = req;
+    req_multi.signal_count = 1;
+    req_multi.signal_ids[0] = 5;
+    msg = jsdrvp_msg_alloc_value(context, "m/003/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 200);  // includes the samples from before the add
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // remove a signal: only the removed signal clears
+    signal_remove(context, buffer_id, 6);
+    expect_unsubscribe("u/js220/0123456/s/v/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_info_any("m/003/s/006/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    signal_remove(context, buffer_id, 5);
+    expect_unsubscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_sig_list(ex_list_sig0, sizeof(ex_list_sig0));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_REMOVE, &jsdrv_union_u8(buffer_id)));
+    expect_unsubscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer0, sizeof(ex_list_buffer0));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    finalize(context);
+}
+
+static void test_snapshot(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * msg;
+    uint8_t ex_list_buffer0[] = {0};
+    uint8_t ex_list_buffer3[] = {3, 0};
+    uint8_t ex_list_buffer34[] = {3, 4, 0};
+    uint8_t ex_list_sig0[] = {0};
+    uint8_t ex_list_sig5[] = {5, 0};
+    const uint64_t levels_ratio = (128 * sizeof(float)) / sizeof(struct jsdrv_summary_entry_s);
+
+    struct jsdrv_context_s * context = initialize();
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, &jsdrv_union_u8(3)));
+    expect_subscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer3, sizeof(ex_list_buffer3));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, &jsdrv_union_u8(4)));
+    expect_subscribe("m/004");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer34, sizeof(ex_list_buffer34));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    signal_add(context, 3, 5, "u/js220/0123456/s/i/!data");
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_subscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    msg = jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_SIZE, &jsdrv_union_u64(1000000LLU));
+    publish(context, msg);
+
+    publish(context, generate_msg_data_i(context, 10000LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/003/s/005/levels", levels_ratio);
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, generate_msg_data_i(context, 10100LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // freeze into buffer 4
+    publish(context, jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_SNAPSHOT, &jsdrv_union_u8(4)));
+    expect_info_any("m/004/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/004/s/005/levels", levels_ratio);
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // ingestion continues into buffer 3, which reallocates on its next data
+    publish(context, generate_msg_data_i(context, 10200LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/003/s/005/levels", levels_ratio);
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, generate_msg_data_i(context, 10300LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    struct jsdrv_buffer_request_multi_s req_multi;
+    memset(&req_multi, 0, sizeof(req_multi));
+    req_multi.req.version = 1;
+    req_multi.req.time_type = JSDRV_TIME_SAMPLES;
+    req_multi.req.time.samples.start = 10000LLU;
+    req_multi.req.time.samples.end = 10399LLU;
+    jsdrv_cstr_copy(req_multi.req.rsp_topic, "t/!rsp", sizeof(req_multi.req.rsp_topic));
+    req_multi.signal_count = 1;
+    req_multi.signal_ids[0] = 5;
+    msg = jsdrvp_msg_alloc_value(context, "m/004/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 100);  // the frozen samples 10100 to 10199
+    msg_send_process_next(context, TIMEOUT_MS);
+    msg = jsdrvp_msg_alloc_value(context, "m/003/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 100);  // the live samples 10300 to 10399
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // invalid targets
+    publish(context, jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_SNAPSHOT, &jsdrv_union_u8(3)));
+    publish(context, jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_SNAPSHOT, &jsdrv_union_u8(9)));
+
+    // tear down, which frees the frozen samples
+    signal_remove(context, 3, 5);
+    expect_unsubscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_sig_list(ex_list_sig0, sizeof(ex_list_sig0));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_REMOVE, &jsdrv_union_u8(4)));
+    expect_unsubscribe("m/004");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer3, sizeof(ex_list_buffer3));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_REMOVE, &jsdrv_union_u8(3)));
+    expect_unsubscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer0, sizeof(ex_list_buffer0));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    finalize(context);
+}
+
+
+static void test_view(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * msg;
+    uint8_t ex_list_buffer0[] = {0};
+    uint8_t ex_list_buffer3[] = {3, 0};
+    uint8_t ex_list_buffer34[] = {3, 4, 0};
+    uint8_t ex_list_sig0[] = {0};
+    uint8_t ex_list_sig5[] = {5, 0};
+    const uint64_t levels_ratio = (128 * sizeof(float)) / sizeof(struct jsdrv_summary_entry_s);
+
+    struct jsdrv_context_s * context = initialize();
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, &jsdrv_union_u8(3)));
+    expect_subscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer3, sizeof(ex_list_buffer3));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, &jsdrv_union_u8(4)));
+    expect_subscribe("m/004");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer34, sizeof(ex_list_buffer34));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    signal_add(context, 3, 5, "u/js220/0123456/s/i/!data");
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_subscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    msg = jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_SIZE, &jsdrv_union_u64(1000000LLU));
+    publish(context, msg);
+
+    // buffer 4 views the newest 1 ms of buffer 3 without subscribing
+    publish(context, jsdrvp_msg_alloc_value(context, "m/004/" JSDRV_BUFFER_MSG_SOURCE, &jsdrv_union_u8(3)));
+    publish(context, jsdrvp_msg_alloc_value(context, "m/004/" JSDRV_BUFFER_MSG_VIEW, &jsdrv_union_u32(1)));
+    signal_add(context, 4, 5, "u/js220/0123456/s/i/!data");
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    for (uint64_t sample_id = 10000LLU; sample_id < 12000LLU; sample_id += 500) {
+        publish(context, generate_msg_data_i(context, sample_id, 500));
+        expect_info_any("m/003/s/005/info");
+        msg_send_process_next(context, TIMEOUT_MS);
+        if (10000LLU == sample_id) {
+            expect_levels("m/003/s/005/levels", levels_ratio);
+            msg_send_process_next(context, TIMEOUT_MS);
+        }
+    }
+
+    struct jsdrv_buffer_request_multi_s req_multi;
+    memset(&req_multi, 0, sizeof(req_multi));
+    req_multi.req.version = 1;
+    req_multi.req.time_type = JSDRV_TIME_SAMPLES;
+    req_multi.req.time.samples.start = 10000LLU;
+    req_multi.req.time.samples.end = 11999LLU;
+    jsdrv_cstr_copy(req_multi.req.rsp_topic, "t/!rsp", sizeof(req_multi.req.rsp_topic));
+    req_multi.signal_count = 1;
+    req_multi.signal_ids[0] = 5;
+    msg = jsdrvp_msg_alloc_value(context, "m/004/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 1000);  // the newest 1 ms
+    msg_send_process_next(context, TIMEOUT_MS);
+    msg = jsdrvp_msg_alloc_value(context, "m/003/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 1500);  // allocated on the first data
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // invalid sources
+    publish(context, jsdrvp_msg_alloc_value(context, "m/004/" JSDRV_BUFFER_MSG_SOURCE, &jsdrv_union_u8(4)));
+    publish(context, jsdrvp_msg_alloc_value(context, "m/004/" JSDRV_BUFFER_MSG_SOURCE, &jsdrv_union_u8(99)));
+
+    // tear down the view first, which never subscribed
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_REMOVE, &jsdrv_union_u8(4)));
+    expect_unsubscribe("m/004");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer3, sizeof(ex_list_buffer3));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    signal_remove(context, 3, 5);
+    expect_unsubscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_sig_list(ex_list_sig0, sizeof(ex_list_sig0));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_REMOVE, &jsdrv_union_u8(3)));
+    expect_unsubscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer0, sizeof(ex_list_buffer0));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    finalize(context);
+}
+
+
+static void test_save_load(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * msg;
+    uint8_t ex_list_buffer0[] = {0};
+    uint8_t ex_list_buffer3[] = {3, 0};
+    uint8_t ex_list_buffer34[] = {3, 4, 0};
+    uint8_t ex_list_sig0[] = {0};
+    uint8_t ex_list_sig5[] = {5, 0};
+    const uint64_t levels_ratio = (128 * sizeof(float)) / sizeof(struct jsdrv_summary_entry_s);
+
+    struct jsdrv_context_s * context = initialize();
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, &jsdrv_union_u8(3)));
+    expect_subscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer3, sizeof(ex_list_buffer3));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_ADD, &jsdrv_union_u8(4)));
+    expect_subscribe("m/004");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer34, sizeof(ex_list_buffer34));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    signal_add(context, 3, 5, "u/js220/0123456/s/i/!data");
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_subscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_SIZE, &jsdrv_union_u64(1000000LLU)));
+    publish(context, generate_msg_data_i(context, 10000LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/003/s/005/levels", levels_ratio);
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, generate_msg_data_i(context, 10100LLU, 100));
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // save buffer 3, then load into buffer 4
+    remove("./jsdrv_signal_005.bin");
+    publish(context, jsdrvp_msg_alloc_value(context, "m/003/" JSDRV_BUFFER_MSG_SAVE, &jsdrv_union_str(".")));
+    publish(context, generate_msg_data_i(context, 10200LLU, 100));  // after the save completes
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, "m/004/" JSDRV_BUFFER_MSG_LOAD, &jsdrv_union_str(".")));
+    expect_info_any("m/004/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_levels("m/004/s/005/levels", levels_ratio);
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_sig_list(ex_list_sig5, sizeof(ex_list_sig5));
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    struct jsdrv_buffer_request_multi_s req_multi;
+    memset(&req_multi, 0, sizeof(req_multi));
+    req_multi.req.version = 1;
+    req_multi.req.time_type = JSDRV_TIME_SAMPLES;
+    req_multi.req.time.samples.start = 10000LLU;
+    req_multi.req.time.samples.end = 10299LLU;
+    jsdrv_cstr_copy(req_multi.req.rsp_topic, "t/!rsp", sizeof(req_multi.req.rsp_topic));
+    req_multi.signal_count = 1;
+    req_multi.signal_ids[0] = 5;
+    msg = jsdrvp_msg_alloc_value(context, "m/004/g/!stats", &jsdrv_union_bin((uint8_t *) &req_multi, sizeof(req_multi)));
+    publish(context, msg);
+    expect_rsp_stats("t/!rsp", 100);  // the saved samples 10100 to 10199
+    msg_send_process_next(context, TIMEOUT_MS);
+
+    // tear down
+    signal_remove(context, 3, 5);
+    expect_unsubscribe("u/js220/0123456/s/i/!data");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_info_any("m/003/s/005/info");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_sig_list(ex_list_sig0, sizeof(ex_list_sig0));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_REMOVE, &jsdrv_union_u8(4)));
+    expect_unsubscribe("m/004");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer3, sizeof(ex_list_buffer3));
+    msg_send_process_next(context, TIMEOUT_MS);
+    publish(context, jsdrvp_msg_alloc_value(context, JSDRV_BUFFER_MGR_MSG_ACTION_REMOVE, &jsdrv_union_u8(3)));
+    expect_unsubscribe("m/003");
+    msg_send_process_next(context, TIMEOUT_MS);
+    expect_buf_list(ex_list_buffer0, sizeof(ex_list_buffer0));
+    msg_send_process_next(context, TIMEOUT_MS);
+    remove("./jsdrv_signal_005.bin");
+
+    finalize(context);
+}
+
+
 
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_initialize_finalize),
             cmocka_unit_test(test_add_remove),
             cmocka_unit_test(test_one_signal),
+            cmocka_unit_test(test_signal_add_remove_incremental),
+            cmocka_unit_test(test_snapshot),
+            cmocka_unit_test(test_view),
+            cmocka_unit_test(test_save_load),
             // test hold
             // test buffer wrap
             // test mode: fill
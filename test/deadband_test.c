@@ -0,0 +1,172 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/deadband.h"
+#include "jsdrv.h"
+#include <math.h>
+
+
+static struct jsdrv_stream_signal_s s_;
+static struct jsdrv_stream_signal_s hold_;
+
+
+static struct jsdrv_stream_signal_s * f32_signal(uint64_t sample_id, uint32_t count, float value, float step) {
+    struct jsdrv_stream_signal_s * s = &s_;
+    s->sample_id = sample_id;
+    s->field_id = JSDRV_FIELD_CURRENT;
+    s->index = 0;
+    s->element_type = JSDRV_DATA_TYPE_FLOAT;
+    s->element_size_bits = 32;
+    s->element_count = count;
+    s->sample_rate = 1000000;
+    s->decimate_factor = 2;
+    float * data = (float *) s->data;
+    for (uint32_t i = 0; i < count; ++i) {
+        data[i] = value + step * (float) i;
+    }
+    return s;
+}
+
+static const struct jsdrv_stream_hold_s * emit(struct jsdrv_deadband_s * d) {
+    uint32_t sz = jsdrv_deadband_emit(d, &hold_);
+    assert_int_equal(JSDRV_STREAM_HEADER_SIZE + sizeof(struct jsdrv_stream_hold_s), sz);
+    assert_int_equal(JSDRV_DATA_TYPE_HOLD, hold_.element_type);
+    assert_int_equal(1, hold_.element_count);
+    const struct jsdrv_stream_hold_s * hold = jsdrv_deadband_hold(&hold_);
+    assert_non_null(hold);
+    return hold;
+}
+
+static void test_disabled(void **state) {
+    (void) state;
+    struct jsdrv_deadband_s d;
+    jsdrv_deadband_initialize(&d, 0.0f);
+    assert_int_equal(0, jsdrv_deadband_process(&d, f32_signal(1000, 100, 1.0f, 0.0f)));
+    assert_int_equal(0, jsdrv_deadband_process(&d, f32_signal(1200, 100, 1.0f, 0.0f)));
+    assert_false(jsdrv_deadband_flush(&d));
+    assert_null(jsdrv_deadband_hold(&s_));
+    assert_int_equal(100, jsdrv_deadband_sample_count(&s_));
+}
+
+static void test_hold(void **state) {
+    (void) state;
+    struct jsdrv_deadband_s d;
+    jsdrv_deadband_initialize(&d, 0.01f);
+    assert_int_equal(JSDRV_DEADBAND_ABSORB, jsdrv_deadband_process(&d, f32_signal(1000, 100, 1.0f, 0.0f)));
+    assert_int_equal(JSDRV_DEADBAND_ABSORB, jsdrv_deadband_process(&d, f32_signal(1200, 100, 1.005f, 0.0f)));
+    assert_int_equal(JSDRV_DEADBAND_EMIT, jsdrv_deadband_process(&d, f32_signal(1400, 100, 0.0f, 1.0f)));
+    const struct jsdrv_stream_hold_s * hold = emit(&d);
+    assert_int_equal(1000, hold_.sample_id);
+    assert_int_equal(2, hold_.decimate_factor);
+    assert_int_equal(JSDRV_FIELD_CURRENT, hold_.field_id);
+    assert_int_equal(200, hold->sample_count);
+    assert_int_equal(200, jsdrv_deadband_sample_count(&hold_));
+    assert_float_equal(1.0f, hold->min, 1e-6);
+    assert_float_equal(1.005f, hold->max, 1e-6);
+    assert_float_equal(1.0025f, hold->mean, 1e-6);
+    assert_false(jsdrv_deadband_flush(&d));
+}
+
+static void test_restart_after_band(void **state) {
+    (void) state;
+    struct jsdrv_deadband_s d;
+    jsdrv_deadband_initialize(&d, 0.01f);
+    assert_int_equal(JSDRV_DEADBAND_ABSORB, jsdrv_deadband_process(&d, f32_signal(1000, 100, 1.0f, 0.0f)));
+    assert_int_equal(JSDRV_DEADBAND_EMIT | JSDRV_DEADBAND_ABSORB,
+                     jsdrv_deadband_process(&d, f32_signal(1200, 100, 2.0f, 0.0f)));
+    const struct jsdrv_stream_hold_s * hold = emit(&d);
+    assert_int_equal(1000, hold_.sample_id);
+    assert_int_equal(100, hold->sample_count);
+    assert_true(jsdrv_deadband_flush(&d));
+    hold = emit(&d);
+    assert_int_equal(1200, hold_.sample_id);
+    assert_float_equal(2.0f, hold->mean, 1e-6);
+}
+
+static void test_gap(void **state) {
+    (void) state;
+    struct jsdrv_deadband_s d;
+    jsdrv_deadband_initialize(&d, 0.01f);
+    assert_int_equal(JSDRV_DEADBAND_ABSORB, jsdrv_deadband_process(&d, f32_signal(1000, 100, 1.0f, 0.0f)));
+    assert_int_equal(JSDRV_DEADBAND_EMIT | JSDRV_DEADBAND_ABSORB,
+                     jsdrv_deadband_process(&d, f32_signal(1202, 100, 1.0f, 0.0f)));
+    emit(&d);
+    assert_int_equal(1000, hold_.sample_id);
+}
+
+static void test_nan_and_type(void **state) {
+    (void) state;
+    struct jsdrv_deadband_s d;
+    jsdrv_deadband_initialize(&d, 0.01f);
+    assert_int_equal(JSDRV_DEADBAND_ABSORB, jsdrv_deadband_process(&d, f32_signal(1000, 100, 1.0f, 0.0f)));
+    struct jsdrv_stream_signal_s * s = f32_signal(1200, 100, 1.0f, 0.0f);
+    ((float *) s->data)[50] = NAN;
+    assert_int_equal(JSDRV_DEADBAND_EMIT, jsdrv_deadband_process(&d, s));
+    emit(&d);
+
+    assert_int_equal(JSDRV_DEADBAND_ABSORB, jsdrv_deadband_process(&d, f32_signal(1400, 100, 1.0f, 0.0f)));
+    s = f32_signal(1600, 100, 1.0f, 0.0f);
+    s->element_type = JSDRV_DATA_TYPE_UINT;
+    s->element_size_bits = 4;
+    assert_int_equal(JSDRV_DEADBAND_EMIT, jsdrv_deadband_process(&d, s));
+    emit(&d);
+    assert_int_equal(1400, hold_.sample_id);
+}
+
+static void test_duration_max(void **state) {
+    (void) state;
+    struct jsdrv_deadband_s d;
+    jsdrv_deadband_initialize(&d, 0.01f);
+    uint64_t sample_id = 0;
+    uint32_t count = 10000;  // 20000 sample_id per message at decimate_factor 2
+    for (int i = 0; i < 50; ++i) {
+        assert_int_equal(JSDRV_DEADBAND_ABSORB, jsdrv_deadband_process(&d, f32_signal(sample_id, count, 1.0f, 0.0f)));
+        sample_id += count * 2;
+    }
+    assert_int_equal(JSDRV_DEADBAND_EMIT | JSDRV_DEADBAND_ABSORB,
+                     jsdrv_deadband_process(&d, f32_signal(sample_id, count, 1.0f, 0.0f)));
+    const struct jsdrv_stream_hold_s * hold = emit(&d);
+    assert_int_equal(0, hold_.sample_id);
+    assert_int_equal(500000, hold->sample_count);
+}
+
+static void test_hold_invalid(void **state) {
+    (void) state;
+    struct jsdrv_stream_signal_s * s = f32_signal(0, 2, 1.0f, 0.0f);
+    s->element_type = JSDRV_DATA_TYPE_HOLD;
+    assert_null(jsdrv_deadband_hold(s));
+    assert_int_equal(2, jsdrv_deadband_sample_count(s));
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_disabled),
+            cmocka_unit_test(test_hold),
+            cmocka_unit_test(test_restart_after_band),
+            cmocka_unit_test(test_gap),
+            cmocka_unit_test(test_nan_and_type),
+            cmocka_unit_test(test_duration_max),
+            cmocka_unit_test(test_hold_invalid),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/derived.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define SAMPLE_RATE (1000000U)
+
+static uint8_t src_buf_[JSDRV_STREAM_HEADER_SIZE + JSDRV_STREAM_DATA_SIZE];
+static uint8_t dst_buf_[JSDRV_STREAM_HEADER_SIZE + JSDRV_STREAM_DATA_SIZE];
+static struct jsdrv_stream_signal_s * src_ = (struct jsdrv_stream_signal_s *) src_buf_;
+static struct jsdrv_stream_signal_s * dst_ = (struct jsdrv_stream_signal_s *) dst_buf_;
+
+static void src_fill(uint64_t sample_id, uint32_t decimate_factor, uint32_t length, float value) {
+    memset(src_buf_, 0, sizeof(src_buf_));
+    src_->sample_id = sample_id;
+    src_->field_id = JSDRV_FIELD_CURRENT;
+    src_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    src_->element_size_bits = 32;
+    src_->element_count = length;
+    src_->sample_rate = SAMPLE_RATE;
+    src_->decimate_factor = decimate_factor;
+    src_->time_map.offset_counter = 42;
+    src_->host_time.usb = 7;
+    float * x = (float *) src_->data;
+    for (uint32_t i = 0; i < length; ++i) {
+        x[i] = value;
+    }
+}
+
+static void assert_f64_close(double expect, double actual, double epsilon) {
+    assert_true(fabs(expect - actual) <= epsilon);
+}
+
+static void test_integral(void **state) {
+    (void) state;
+    struct jsdrv_derived_integral_s q;
+    jsdrv_derived_integral_clear(&q);
+    src_fill(1000, 2, 100, 2.0f);
+    ((float *) src_->data)[10] = NAN;
+    assert_int_equal(100, jsdrv_derived_integral(&q, src_, 0, dst_));
+    assert_int_equal(1000, dst_->sample_id);
+    assert_int_equal(2, dst_->decimate_factor);
+    assert_int_equal(SAMPLE_RATE, dst_->sample_rate);
+    assert_int_equal(64, dst_->element_size_bits);
+    assert_int_equal(JSDRV_DATA_TYPE_FLOAT, dst_->element_type);
+    assert_int_equal(42, dst_->time_map.offset_counter);
+    assert_int_equal(7, dst_->host_time.usb);
+    const double dt = 2.0 / SAMPLE_RATE;
+    double * y = (double *) dst_->data;
+    assert_f64_close(2.0 * dt, y[0], 1e-15);
+    assert_f64_close(10.0 * 2.0 * dt, y[9], 1e-15);
+    assert_f64_close(10.0 * 2.0 * dt, y[10], 1e-15);  // NaN does not contribute
+    assert_f64_close(99.0 * 2.0 * dt, y[99], 1e-15);
+
+    // continues across blocks
+    src_fill(1200, 2, 10, -1.0f);
+    assert_int_equal(10, jsdrv_derived_integral(&q, src_, 0, dst_));
+    assert_f64_close((99.0 * 2.0 - 10.0) * dt, y[9], 1e-15);
+    assert_int_equal(0, jsdrv_derived_integral(&q, src_, 10, dst_));
+}
+
+static void test_integral_chunk(void **state) {
+    (void) state;
+    struct jsdrv_derived_integral_s e;
+    jsdrv_derived_integral_clear(&e);
+    uint32_t length = JSDRV_STREAM_DATA_SIZE / sizeof(float);
+    src_fill(0, 1, length, 1.0f);
+    assert_int_equal(JSDRV_DERIVED_INTEGRAL_LENGTH_MAX, jsdrv_derived_integral(&e, src_, 0, dst_));
+    assert_int_equal(0, dst_->sample_id);
+    uint32_t offset = JSDRV_DERIVED_INTEGRAL_LENGTH_MAX;
+    assert_int_equal(length - offset, jsdrv_derived_integral(&e, src_, offset, dst_));
+    assert_int_equal(offset, dst_->sample_id);
+    double * y = (double *) dst_->data;
+    assert_f64_close((double) length / SAMPLE_RATE, y[length - offset - 1], 1e-12);
+}
+
+static void test_rms(void **state) {
+    (void) state;
+    struct jsdrv_derived_rms_s r;
+    jsdrv_derived_rms_clear(&r, 100);
+    src_fill(1000, 2, 150, 3.0f);
+    float * x = (float *) src_->data;
+    x[1] = -3.0f;
+    x[2] = NAN;
+    assert_int_equal(1, jsdrv_derived_rms(&r, src_, dst_));
+    assert_int_equal(1000, dst_->sample_id);
+    assert_int_equal(200, dst_->decimate_factor);
+    assert_int_equal(32, dst_->element_size_bits);
+    float * y = (float *) dst_->data;
+    assert_float_equal(3.0f, y[0], 1e-6f);
+
+    // window spans blocks
+    src_fill(1300, 2, 100, 4.0f);
+    assert_int_equal(1, jsdrv_derived_rms(&r, src_, dst_));
+    assert_int_equal(1200, dst_->sample_id);
+    assert_float_equal(sqrtf((50 * 9.0f + 50 * 16.0f) / 100.0f), y[0], 1e-6f);
+
+    // gap restarts the window
+    src_fill(2000, 2, 99, 1.0f);
+    assert_int_equal(0, jsdrv_derived_rms(&r, src_, dst_));
+    src_fill(3000, 2, 100, 5.0f);
+    assert_int_equal(1, jsdrv_derived_rms(&r, src_, dst_));
+    assert_int_equal(3000, dst_->sample_id);
+    assert_float_equal(5.0f, y[0], 1e-6f);
+}
+
+static void test_rms_all_nan(void **state) {
+    (void) state;
+    struct jsdrv_derived_rms_s r;
+    jsdrv_derived_rms_clear(&r, 0);  // clamps to 1
+    assert_int_equal(1, r.window);
+    src_fill(0, 1, 4, NAN);
+    assert_int_equal(4, jsdrv_derived_rms(&r, src_, dst_));
+    assert_true(isnan(((float *) dst_->data)[3]));
+    jsdrv_derived_rms_clear(&r, JSDRV_DERIVED_RMS_WINDOW_MAX + 1);
+    assert_int_equal(JSDRV_DERIVED_RMS_WINDOW_MAX, r.window);
+}
+
+static void test_summary(void **state) {
+    (void) state;
+    struct jsdrv_derived_summary_s m;
+    jsdrv_derived_summary_clear(&m, 5000);  // 500 kHz source, window 100
+    src_fill(1000, 2, 150, 1.0f);
+    assert_int_equal(100, jsdrv_derived_summary_window(&m, src_));
+    float * x = (float *) src_->data;
+    x[1] = 9.0f;    // transient
+    x[2] = NAN;
+    x[3] = -2.0f;
+    assert_int_equal(1, jsdrv_derived_summary(&m, src_, dst_));
+    assert_int_equal(1000, dst_->sample_id);
+    assert_int_equal(200, dst_->decimate_factor);
+    assert_int_equal(JSDRV_DATA_TYPE_UNDEFINED, dst_->element_type);
+    assert_int_equal(128, dst_->element_size_bits);
+    struct jsdrv_summary_entry_s * y = (struct jsdrv_summary_entry_s *) dst_->data;
+    assert_float_equal((97.0f + 9.0f - 2.0f) / 99.0f, y[0].avg, 1e-6f);
+    assert_float_equal(-2.0f, y[0].min, 0.0f);
+    assert_float_equal(9.0f, y[0].max, 0.0f);
+    assert_true(y[0].std > 0.0f);
+
+    // window spans blocks
+    src_fill(1300, 2, 50, 3.0f);
+    assert_int_equal(1, jsdrv_derived_summary(&m, src_, dst_));
+    assert_int_equal(1200, dst_->sample_id);
+    assert_float_equal(2.0f, y[0].avg, 1e-6f);
+    assert_float_equal(1.0f, y[0].min, 0.0f);
+    assert_float_equal(3.0f, y[0].max, 0.0f);
+    assert_float_equal(sqrtf(100.0f / 99.0f), y[0].std, 1e-6f);
+
+    // gap restarts the window, all NaN produces NaN
+    src_fill(5000, 2, 100, NAN);
+    assert_int_equal(1, jsdrv_derived_summary(&m, src_, dst_));
+    assert_int_equal(5000, dst_->sample_id);
+    assert_true(isnan(y[0].avg));
+    assert_true(isnan(y[0].max));
+}
+
+static void test_summary_window(void **state) {
+    (void) state;
+    struct jsdrv_derived_summary_s m;
+    jsdrv_derived_summary_clear(&m, 0);  // clamps to 1 Hz
+    assert_int_equal(1, m.fs);
+    src_fill(0, 1, 16, 1.0f);
+    assert_int_equal(SAMPLE_RATE, jsdrv_derived_summary_window(&m, src_));
+    jsdrv_derived_summary_clear(&m, SAMPLE_RATE);
+    assert_int_equal(JSDRV_DERIVED_SUMMARY_WINDOW_MIN, jsdrv_derived_summary_window(&m, src_));
+    assert_int_equal(16 / JSDRV_DERIVED_SUMMARY_WINDOW_MIN, jsdrv_derived_summary(&m, src_, dst_));
+}
+
+
+static void src_u1(uint64_t sample_id, uint32_t length) {
+    memset(src_buf_, 0, sizeof(src_buf_));
+    src_->sample_id = sample_id;
+    src_->field_id = JSDRV_FIELD_GPI;
+    src_->element_type = JSDRV_DATA_TYPE_UINT;
+    src_->element_size_bits = 1;
+    src_->element_count = length;
+    src_->sample_rate = SAMPLE_RATE;
+    src_->decimate_factor = 1;
+}
+
+static void u1_set(uint32_t idx) {
+    src_->data[idx >> 3] |= (uint8_t) (1U << (idx & 7));
+}
+
+static void src_u4(uint64_t sample_id, uint32_t length) {
+    src_u1(sample_id, length);
+    src_->field_id = JSDRV_FIELD_RANGE;
+    src_->element_size_bits = 4;
+}
+
+static void u4_set(uint32_t idx, uint8_t value) {
+    uint8_t shift = (uint8_t) ((idx & 1) * 4);
+    src_->data[idx >> 1] = (uint8_t) ((src_->data[idx >> 1] & ~(0x0f << shift)) | ((value & 0x0f) << shift));
+}
+
+static void assert_edge(const struct jsdrv_edge_s * e, uint64_t sample_id, uint8_t level) {
+    assert_int_equal(sample_id, e->sample_id);
+    assert_int_equal(level, e->level);
+}
+
+static void test_edge(void **state) {
+    (void) state;
+    struct jsdrv_derived_edge_s q;
+    const struct jsdrv_edge_s * e = (const struct jsdrv_edge_s *) dst_->data;
+    jsdrv_derived_edge_clear(&q);
+    src_u1(1000, 1000);
+    for (uint32_t i = 10; i < 20; ++i) {
+        u1_set(i);
+    }
+    u1_set(500);
+    for (uint32_t i = 900; i < 1000; ++i) {
+        u1_set(i);
+    }
+    assert_int_equal(1000, jsdrv_derived_edge(&q, src_, 0, dst_));
+    assert_int_equal(JSDRV_DATA_TYPE_UNDEFINED, dst_->element_type);
+    assert_int_equal(sizeof(struct jsdrv_edge_s) * 8, dst_->element_size_bits);
+    assert_int_equal(6, dst_->element_count);
+    assert_edge(&e[0], 1000, 0);  // starting level
+    assert_edge(&e[1], 1010, 1);
+    assert_edge(&e[2], 1020, 0);
+    assert_edge(&e[3], 1500, 1);
+    assert_edge(&e[4], 1501, 0);
+    assert_edge(&e[5], 1900, 1);
+
+    // contiguous: the level carries over
+    src_u1(2000, 100);
+    for (uint32_t i = 0; i < 5; ++i) {
+        u1_set(i);
+    }
+    assert_int_equal(100, jsdrv_derived_edge(&q, src_, 0, dst_));
+    assert_int_equal(1, dst_->element_count);
+    assert_edge(&e[0], 2005, 0);
+
+    // gap: report the starting level again
+    src_u1(3000, 100);
+    assert_int_equal(100, jsdrv_derived_edge(&q, src_, 0, dst_));
+    assert_int_equal(1, dst_->element_count);
+    assert_edge(&e[0], 3000, 0);
+}
+
+static void test_edge_chunk(void **state) {
+    (void) state;
+    struct jsdrv_derived_edge_s q;
+    const struct jsdrv_edge_s * e = (const struct jsdrv_edge_s *) dst_->data;
+    jsdrv_derived_edge_clear(&q);
+    src_u1(0, 1001);
+    memset(src_->data, 0x55, 126);  // toggles every sample
+    uint32_t offset = 0;
+    uint64_t expect = 0;
+    while (offset < src_->element_count) {
+        uint32_t n = jsdrv_derived_edge(&q, src_, offset, dst_);
+        assert_true(n > 0);
+        assert_true(dst_->element_count <= JSDRV_DERIVED_EDGE_LENGTH_MAX);
+        for (uint32_t i = 0; i < dst_->element_count; ++i) {
+            assert_edge(&e[i], expect, (uint8_t) ((expect & 1) ^ 1));
+            ++expect;
+        }
+        offset += n;
+    }
+    assert_int_equal(1001, offset);
+    assert_int_equal(1001, expect);
+}
+
+static void test_edge_u4(void **state) {
+    (void) state;
+    struct jsdrv_derived_edge_s q;
+    const struct jsdrv_edge_s * e = (const struct jsdrv_edge_s *) dst_->data;
+    jsdrv_derived_edge_clear(&q);
+    src_u4(1000, 1000);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        u4_set(i, 7);
+    }
+    for (uint32_t i = 15; i < 17; ++i) {
+        u4_set(i, 1);  // spans the 64-bit word boundary
+    }
+    u4_set(500, 8);
+    u4_set(999, 2);
+    assert_int_equal(1000, jsdrv_derived_edge(&q, src_, 0, dst_));
+    assert_int_equal(6, dst_->element_count);
+    assert_edge(&e[0], 1000, 7);  // starting level
+    assert_edge(&e[1], 1015, 1);
+    assert_edge(&e[2], 1017, 7);
+    assert_edge(&e[3], 1500, 8);
+    assert_edge(&e[4], 1501, 7);
+    assert_edge(&e[5], 1999, 2);
+
+    // contiguous: the level carries over
+    src_u4(2000, 3);
+    u4_set(0, 2);
+    u4_set(1, 2);
+    u4_set(2, 3);
+    assert_int_equal(3, jsdrv_derived_edge(&q, src_, 0, dst_));
+    assert_int_equal(1, dst_->element_count);
+    assert_edge(&e[0], 2002, 3);
+}
+
+static void test_edge_u4_chunk(void **state) {
+    (void) state;
+    struct jsdrv_derived_edge_s q;
+    const struct jsdrv_edge_s * e = (const struct jsdrv_edge_s *) dst_->data;
+    jsdrv_derived_edge_clear(&q);
+    src_u4(0, 601);
+    for (uint32_t i = 0; i < 601; ++i) {
+        u4_set(i, (uint8_t) (i % 6));  // changes every sample
+    }
+    uint32_t offset = 0;
+    uint64_t expect = 0;
+    while (offset < src_->element_count) {
+        uint32_t n = jsdrv_derived_edge(&q, src_, offset, dst_);
+        assert_true(n > 0);
+        assert_true(dst_->element_count <= JSDRV_DERIVED_EDGE_LENGTH_MAX);
+        for (uint32_t i = 0; i < dst_->element_count; ++i) {
+            assert_edge(&e[i], expect, (uint8_t) (expect % 6));
+            ++expect;
+        }
+        offset += n;
+    }
+    assert_int_equal(601, offset);
+    assert_int_equal(601, expect);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_integral),
+            cmocka_unit_test(test_integral_chunk),
+            cmocka_unit_test(test_rms),
+            cmocka_unit_test(test_rms_all_nan),
+            cmocka_unit_test(test_summary),
+            cmocka_unit_test(test_summary_window),
+            cmocka_unit_test(test_edge),
+            cmocka_unit_test(test_edge_chunk),
+            cmocka_unit_test(test_edge_u4),
+            cmocka_unit_test(test_edge_u4_chunk),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Compare the downsample filter throughput.
+ *
+ * Usage: downsample_bench [samples]
+ */
+
+#include "jsdrv_prv/downsample.h"
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv/time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+#define SAMPLE_RATE_IN (2000000U)
+#define SAMPLES_DEFAULT (10000000U)
+#define BLOCK (1000U)
+
+
+static void run(const char * name, uint32_t rate_out, int mode, int block, const float * x, uint32_t n, float * y) {
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(SAMPLE_RATE_IN, rate_out, mode);
+    uint32_t n_out = 0;
+    int64_t t_start = jsdrv_time_utc();
+    if (block) {
+        for (uint32_t k = 0; k < n; k += BLOCK) {
+            uint32_t count = 0;
+            jsdrv_downsample_add_f32_block(d, k, x + k, BLOCK, y + n_out, &count);
+            n_out += count;
+        }
+    } else {
+        for (uint32_t k = 0; k < n; ++k) {
+            if (jsdrv_downsample_add_f32(d, k, x[k], y + n_out)) {
+                ++n_out;
+            }
+        }
+    }
+    double duration = JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start);
+    printf("%8u Hz  %-16s %8.1f Msamples/s  (%u outputs, last %g)\n", rate_out, name,
+           n / duration * 1e-6, n_out, n_out ? (double) y[n_out - 1] : 0.0);
+    jsdrv_downsample_free(d);
+}
+
+// Filter x as 3 channels in lockstep, which the JS110 does for i, v, and p.
+static void run_mc(const char * name, uint32_t rate_out, int mode, const float * x, uint32_t n, float * y) {
+    struct jsdrv_downsample_mc_s * d = jsdrv_downsample_mc_alloc(SAMPLE_RATE_IN, rate_out, mode, 3);
+    uint32_t n_out = 0;
+    int64_t t_start = jsdrv_time_utc();
+    for (uint32_t k = 0; k < n; k += BLOCK) {
+        uint32_t count = 0;
+        const float * xk[3] = {x + k, x + k, x + k};
+        float * yk[3] = {y + n_out, y + n_out, y + n_out};
+        jsdrv_downsample_mc_add_f32_block(d, k, xk, BLOCK, yk, &count);
+        n_out += count;
+    }
+    double duration = JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start);
+    printf("%8u Hz  %-16s %8.1f Msamples/s  (%u outputs per channel, 3 channels)\n", rate_out, name,
+           n / duration * 1e-6, n_out);
+    jsdrv_downsample_mc_free(d);
+}
+
+int main(int argc, char * argv[]) {
+    uint32_t n = SAMPLES_DEFAULT;
+    if (argc > 1) {
+        n = (uint32_t) strtoul(argv[1], NULL, 0);
+    }
+    n -= n % BLOCK;
+    float * x = jsdrv_alloc(n * sizeof(float));
+    float * y = jsdrv_alloc(n * sizeof(float));
+    for (uint32_t k = 0; k < n; ++k) {
+        x[k] = sinf(k * 0.001f) * 0.01f + 0.001f * (float) (k % 13);
+    }
+
+    const uint32_t rates[] = {1000000, 100000, 1000};
+    const int32_t isas[] = {JSDRV_F32_OPS_ISA_SCALAR, JSDRV_F32_OPS_ISA_AVX2, JSDRV_F32_OPS_ISA_NEON};
+    const char * isa_names[] = {"f32 block scalar", "f32 block avx2", "f32 block neon"};
+    const char * mc_names[] = {"f32 mc scalar", "f32 mc avx2", "f32 mc neon"};
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    for (size_t r = 0; r < (sizeof(rates) / sizeof(rates[0])); ++r) {
+        run("i64q30", rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, 0, x, n, y);
+        run("i64q30 block", rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, 1, x, n, y);
+        for (size_t idx = 0; idx < (sizeof(isas) / sizeof(isas[0])); ++idx) {
+            if (0 == jsdrv_f32_ops_isa_set(isas[idx])) {
+                run(isa_names[idx], rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, 1, x, n, y);
+                run_mc(mc_names[idx], rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, x, n, y);
+            }
+        }
+        jsdrv_f32_ops_isa_set(isa_default);
+        run("f64 block", rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64, 1, x, n, y);
+    }
+    run("f32 rational", 48000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, 1, x, n, y);
+    run("f32 rational", 44100, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, 1, x, n, y);
+
+    jsdrv_free(x);
+    jsdrv_free(y);
+    return 0;
+}
@@ -20,6 +20,7 @@
 #include <cmocka.h>
 #include <math.h>
 #include "jsdrv_prv/downsample.h"
+#include "jsdrv_prv/f32_ops.h"
 
 
 static void test_float_const(void **state) {
@@ -151,11 +152,362 @@ static void test_filt1_u8(void **state) {
     jsdrv_downsample_free(d);
 }
 
+#define BLOCK_N (5000U)
+
+static void block_compare(uint32_t rate_out, int mode, uint64_t sample_id, uint32_t chunk) {
+    static float x[BLOCK_N];
+    static float y_expect[BLOCK_N];
+    static float y[BLOCK_N];
+    uint32_t first_expect = BLOCK_N;
+    uint32_t n_expect = 0;
+    uint32_t n_out = 0;
+    for (uint32_t k = 0; k < BLOCK_N; ++k) {
+        x[k] = (k == 2500) ? NAN : sinf(k * 0.01f) + 0.001f * (float) (k % 7);
+    }
+    struct jsdrv_downsample_s * a = jsdrv_downsample_alloc(1000000, rate_out, mode);
+    struct jsdrv_downsample_s * b = jsdrv_downsample_alloc(1000000, rate_out, mode);
+    for (uint32_t k = 0; k < BLOCK_N; ++k) {
+        if (jsdrv_downsample_add_f32(a, sample_id + k, x[k], y_expect + n_expect)) {
+            if (0 == n_expect) {
+                first_expect = k;
+            }
+            ++n_expect;
+        }
+    }
+    uint32_t first = BLOCK_N;
+    for (uint32_t k = 0; k < BLOCK_N; k += chunk) {
+        uint32_t m = ((BLOCK_N - k) < chunk) ? (BLOCK_N - k) : chunk;
+        uint32_t count = 0;
+        uint32_t idx = jsdrv_downsample_add_f32_block(b, sample_id + k, x + k, m, y + n_out, &count);
+        if (count && (0 == n_out)) {
+            first = k + idx;
+        }
+        if (0 == count) {
+            assert_int_equal(m, idx);
+        }
+        n_out += count;
+    }
+    assert_int_equal(n_expect, n_out);
+    assert_int_equal(first_expect, first);
+    for (uint32_t k = 0; k < n_out; ++k) {
+        if (isnan(y_expect[k])) {
+            assert_true(isnan(y[k]));
+        } else {
+            assert_memory_equal(&y_expect[k], &y[k], sizeof(float));
+        }
+    }
+    jsdrv_downsample_free(a);
+    jsdrv_downsample_free(b);
+}
+
+static void test_block_f32(void **state) {
+    (void) state;
+    const uint32_t rates[] = {1000000, 500000, 200000, 10000, 1000};
+    const uint32_t chunks[] = {1, 126, 1000, BLOCK_N};
+    for (size_t r = 0; r < (sizeof(rates) / sizeof(rates[0])); ++r) {
+        for (size_t c = 0; c < (sizeof(chunks) / sizeof(chunks[0])); ++c) {
+            for (int mode = JSDRV_DOWNSAMPLE_MODE_AVERAGE; mode <= JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND; ++mode) {
+                block_compare(rates[r], mode, 1000, chunks[c]);
+                block_compare(rates[r], mode, 1003, chunks[c]);  // unaligned start
+            }
+        }
+    }
+}
+
+static uint32_t run_block(uint32_t rate_out, int mode, const float * x, uint32_t n, float * y) {
+    uint32_t n_out = 0;
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(1000000, rate_out, mode);
+    assert_non_null(d);
+    for (uint32_t k = 0; k < n; k += 126) {
+        uint32_t count = 0;
+        uint32_t m = ((n - k) < 126) ? (n - k) : 126;
+        jsdrv_downsample_add_f32_block(d, 1000 + k, x + k, m, y + n_out, &count);
+        n_out += count;
+    }
+    jsdrv_downsample_free(d);
+    return n_out;
+}
+
+static void test_f32_mode(void **state) {
+    (void) state;
+    static float x[BLOCK_N];
+    static float y_expect[BLOCK_N];
+    static float y[BLOCK_N];
+    static float y_scalar[BLOCK_N];
+    const uint32_t rates[] = {1000000, 500000, 200000, 10000, 1000};
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < BLOCK_N; ++k) {
+        x[k] = (k == 2500) ? NAN : sinf(k * 0.01f) + 0.001f * (float) (k % 7);
+    }
+    for (size_t r = 0; r < (sizeof(rates) / sizeof(rates[0])); ++r) {
+        uint32_t n_expect = run_block(rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, x, BLOCK_N, y_expect);
+        assert_int_equal(0, jsdrv_f32_ops_isa_set(JSDRV_F32_OPS_ISA_SCALAR));
+        assert_int_equal(n_expect, run_block(rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, x, BLOCK_N, y_scalar));
+        assert_int_equal(0, jsdrv_f32_ops_isa_set(isa_default));
+        assert_int_equal(n_expect, run_block(rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, x, BLOCK_N, y));
+        for (uint32_t k = 0; k < n_expect; ++k) {
+            if (isnan(y_expect[k])) {  // same NaN windows
+                assert_true(isnan(y[k]));
+                assert_true(isnan(y_scalar[k]));
+            } else {
+                assert_float_equal(y_expect[k], y[k], 1e-5);
+                assert_float_equal(y_expect[k], y_scalar[k], 1e-5);
+            }
+        }
+    }
+}
+
+static void test_f32_mode_per_sample(void **state) {
+    (void) state;
+    float y_block[BLOCK_N / 10 + 1];
+    float y;
+    float x[BLOCK_N];
+    uint32_t n_out = 0;
+    for (uint32_t k = 0; k < BLOCK_N; ++k) {
+        x[k] = cosf(k * 0.003f);
+    }
+    assert_int_equal(BLOCK_N / 10, run_block(100000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, x, BLOCK_N, y_block));
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(1000000, 100000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32);
+    for (uint32_t k = 0; k < BLOCK_N; ++k) {
+        if (jsdrv_downsample_add_f32(d, 1000 + k, x[k], &y)) {
+            assert_memory_equal(&y_block[n_out], &y, sizeof(float));
+            ++n_out;
+        }
+    }
+    assert_int_equal(BLOCK_N / 10, n_out);
+    jsdrv_downsample_free(d);
+}
+
+static void test_f64_mode(void **state) {
+    (void) state;
+    static float x[BLOCK_N];
+    static float y_expect[BLOCK_N];
+    static float y[BLOCK_N];
+    const uint32_t rates[] = {1000000, 200000, 1000};
+    for (uint32_t k = 0; k < BLOCK_N; ++k) {
+        x[k] = (k == 2500) ? NAN : sinf(k * 0.01f) + 0.001f * (float) (k % 7);
+    }
+    for (size_t r = 0; r < (sizeof(rates) / sizeof(rates[0])); ++r) {
+        uint32_t n_expect = run_block(rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, x, BLOCK_N, y_expect);
+        assert_int_equal(n_expect, run_block(rates[r], JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64, x, BLOCK_N, y));
+        for (uint32_t k = 0; k < n_expect; ++k) {
+            if (isnan(y_expect[k])) {
+                assert_true(isnan(y[k]));
+            } else {
+                assert_float_equal(y_expect[k], y[k], 1e-6);
+            }
+        }
+    }
+
+    float y1;
+    uint32_t n_out = 0;
+    uint32_t n_expect = run_block(100000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64, x, 2000, y);
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(1000000, 100000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64);
+    for (uint32_t k = 0; k < 2000; ++k) {
+        if (jsdrv_downsample_add_f32(d, 1000 + k, x[k], &y1)) {
+            assert_memory_equal(&y[n_out], &y1, sizeof(float));
+            ++n_out;
+        }
+    }
+    assert_int_equal(n_expect, n_out);
+    jsdrv_downsample_free(d);
+}
+
+static uint32_t run_mc(uint32_t rate_out, int mode, float * const * x, uint32_t channels, uint32_t n, float * const * y) {
+    uint32_t n_out = 0;
+    struct jsdrv_downsample_mc_s * d = jsdrv_downsample_mc_alloc(1000000, rate_out, mode, channels);
+    assert_non_null(d);
+    for (uint32_t k = 0; k < n; k += 126) {
+        uint32_t count = 0;
+        uint32_t m = ((n - k) < 126) ? (n - k) : 126;
+        const float * xk[JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX];
+        float * yk[JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX];
+        for (uint32_t c = 0; c < channels; ++c) {
+            xk[c] = x[c] + k;
+            yk[c] = y[c] + n_out;
+        }
+        jsdrv_downsample_mc_add_f32_block(d, 1003 + k, xk, m, yk, &count);
+        n_out += count;
+    }
+    jsdrv_downsample_mc_free(d);
+    return n_out;
+}
+
+static void test_mc(void **state) {
+    (void) state;
+    static float x[3][2000];
+    static float y[3][2000];
+    static float y_expect[2000];
+    float * const xp[3] = {x[0], x[1], x[2]};
+    float * const yp[3] = {y[0], y[1], y[2]};
+    const int modes[] = {JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32};
+    const int32_t isas[] = {JSDRV_F32_OPS_ISA_SCALAR, JSDRV_F32_OPS_ISA_SSE2, JSDRV_F32_OPS_ISA_AVX2, JSDRV_F32_OPS_ISA_NEON};
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < 2000; ++k) {
+        x[0][k] = (k == 1500) ? NAN : sinf(k * 0.01f);
+        x[1][k] = 3.3f + 0.01f * cosf(k * 0.02f);
+        x[2][k] = x[0][k] * x[1][k];
+    }
+    assert_null(jsdrv_downsample_mc_alloc(1000000, 1000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, 0));
+    assert_null(jsdrv_downsample_mc_alloc(1000000, 1000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND,
+                                          JSDRV_DOWNSAMPLE_MC_CHANNELS_MAX + 1));
+    for (size_t m = 0; m < (sizeof(modes) / sizeof(modes[0])); ++m) {
+        for (size_t idx = 0; idx < (sizeof(isas) / sizeof(isas[0])); ++idx) {
+            if (jsdrv_f32_ops_isa_set(isas[idx])) {
+                continue;  // unsupported
+            }
+            uint32_t n_out = run_mc(100000, modes[m], xp, 3, 2000, yp);
+            assert_int_equal(199, n_out);  // aligned start at 1010
+            for (uint32_t c = 0; c < 3; ++c) {
+                uint32_t n_expect = 0;
+                struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(1000000, 100000, modes[m]);
+                for (uint32_t k = 0; k < 2000; ++k) {
+                    if (jsdrv_downsample_add_f32(d, 1003 + k, x[c][k], &y_expect[n_expect])) {
+                        ++n_expect;
+                    }
+                }
+                jsdrv_downsample_free(d);
+                assert_int_equal(n_expect, n_out);
+                for (uint32_t k = 0; k < n_out; ++k) {
+                    if (isnan(y_expect[k])) {
+                        assert_true(isnan(y[c][k]));
+                    } else {
+                        assert_float_equal(y_expect[k], y[c][k], 1e-5);
+                    }
+                }
+            }
+        }
+    }
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa_default));
+}
+
+static uint32_t run_rational(uint32_t rate_out, int mode, float freq, float * x, uint32_t n, float * y) {
+    for (uint32_t k = 0; k < n; ++k) {
+        x[k] = 0.5f + 0.25f * sinf(2.0f * 3.14159265f * freq * (float) k * 1e-6f);
+    }
+    uint32_t n_out = 0;
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(1000000, rate_out, mode);
+    assert_non_null(d);
+    assert_true(jsdrv_downsample_decimate_factor(d) <= (1000000 / rate_out));
+    for (uint32_t k = 0; k < n; k += 126) {
+        uint32_t count = 0;
+        uint32_t block = ((n - k) < 126) ? (n - k) : 126;
+        jsdrv_downsample_add_f32_block(d, k, x + k, block, y + n_out, &count);
+        n_out += count;
+    }
+    jsdrv_downsample_free(d);
+    uint32_t n_expect = (uint32_t) (((uint64_t) n * rate_out) / 1000000);
+    assert_in_range(n_out, n_expect - 1, n_expect + 1);
+    return n_out;
+}
+
+static void test_rational(void **state) {
+    (void) state;
+    static float x[100000];
+    static float y[100000];
+    const uint32_t rates[] = {48000, 44100, 3000};
+    const int modes[] = {JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32,
+                         JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64};
+    for (size_t r = 0; r < (sizeof(rates) / sizeof(rates[0])); ++r) {
+        for (size_t m = 0; m < (sizeof(modes) / sizeof(modes[0])); ++m) {
+            // passband tone keeps its amplitude after settling
+            uint32_t n_out = run_rational(rates[r], modes[m], 0.05f * rates[r], x, 100000, y);
+            float y_min = 1.0f;
+            float y_max = 0.0f;
+            for (uint32_t k = n_out / 2; k < n_out; ++k) {
+                y_min = (y[k] < y_min) ? y[k] : y_min;
+                y_max = (y[k] > y_max) ? y[k] : y_max;
+            }
+            assert_float_equal(0.25f, y_min, 0.01f);
+            assert_float_equal(0.75f, y_max, 0.01f);
+
+            // stopband tone that would alias is removed
+            n_out = run_rational(rates[r], modes[m], 0.7f * rates[r], x, 100000, y);
+            for (uint32_t k = n_out / 2; k < n_out; ++k) {
+                assert_float_equal(0.5f, y[k], 0.005f);
+            }
+        }
+    }
+}
+
+static void test_rational_per_sample(void **state) {
+    (void) state;
+    float x[20000];
+    float y_block[20000];
+    float y;
+    uint32_t n_out = 0;
+    uint32_t n_block = 0;
+    for (uint32_t k = 0; k < 20000; ++k) {
+        x[k] = cosf(k * 0.001f);
+    }
+    const int modes[] = {JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32,
+                         JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F64};
+    for (size_t m = 0; m < (sizeof(modes) / sizeof(modes[0])); ++m) {
+        struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(1000000, 48000, modes[m]);
+        jsdrv_downsample_add_f32_block(d, 1000, x, 20000, y_block, &n_block);
+        jsdrv_downsample_free(d);
+        d = jsdrv_downsample_alloc(1000000, 48000, modes[m]);
+        n_out = 0;
+        for (uint32_t k = 0; k < 20000; ++k) {
+            if (jsdrv_downsample_add_f32(d, 1000 + k, x[k], &y)) {
+                assert_float_equal(y_block[n_out], y, 1e-6);
+                ++n_out;
+            }
+        }
+        assert_int_equal(n_block, n_out);
+        jsdrv_downsample_free(d);
+    }
+}
+
+static void test_rational_mc(void **state) {
+    (void) state;
+    static float x[2][5000];
+    static float y[2][5000];
+    float y_expect[5000];
+    float * const xp[2] = {x[0], x[1]};
+    float * const yp[2] = {y[0], y[1]};
+    for (uint32_t k = 0; k < 5000; ++k) {
+        x[0][k] = sinf(k * 0.003f);
+        x[1][k] = 1.0f + cosf(k * 0.002f);
+    }
+    uint32_t n_out = run_mc(44100, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32, xp, 2, 5000, yp);
+    for (uint32_t c = 0; c < 2; ++c) {
+        uint32_t n_expect = 0;
+        struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(1000000, 44100, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32);
+        for (uint32_t k = 0; k < 5000; ++k) {
+            if (jsdrv_downsample_add_f32(d, 1003 + k, x[c][k], &y_expect[n_expect])) {
+                ++n_expect;
+            }
+        }
+        jsdrv_downsample_free(d);
+        assert_int_equal(n_expect, n_out);
+        for (uint32_t k = 0; k < n_out; ++k) {
+            assert_float_equal(y_expect[k], y[c][k], 1e-5);
+        }
+    }
+}
+
+static void test_block_passthrough(void **state) {
+    (void) state;
+    const float x[3] = {1.0f, 2.0f, 3.0f};
+    float y[3];
+    uint32_t n_out = 0;
+    assert_int_equal(0, jsdrv_downsample_add_f32_block(NULL, 0, x, 3, y, &n_out));
+    assert_int_equal(3, n_out);
+    assert_memory_equal(x, y, sizeof(x));
+}
+
 static void test_invalid_args(void **state) {
     (void) state;
     assert_null(jsdrv_downsample_alloc(1000000, 2000000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND));
-    assert_null(jsdrv_downsample_alloc(1000000, 800000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND));
-    assert_null(jsdrv_downsample_alloc(12000, 1000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND));  // only factors of 2 & 5 allowed
+    assert_null(jsdrv_downsample_alloc(1000000, 0, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND));
+    assert_null(jsdrv_downsample_alloc(12000, 5000, JSDRV_DOWNSAMPLE_MODE_AVERAGE));  // average needs an integer ratio
+    assert_null(jsdrv_downsample_alloc(1000000, 999999, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND));  // L too large
+    assert_null(jsdrv_downsample_alloc(1000003, 1000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND));  // M / L too large
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(12000, 1000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND);
+    assert_non_null(d);  // 10x cascade then 5 / 6 rational
+    assert_int_equal(10, jsdrv_downsample_decimate_factor(d));
+    jsdrv_downsample_free(d);
 }
 
 int main(void) {
@@ -168,6 +520,15 @@ int main(void) {
             cmocka_unit_test(test_filt1_f32),
             cmocka_unit_test(test_filt1_f32_nan),
             cmocka_unit_test(test_filt1_u8),
+            cmocka_unit_test(test_block_f32),
+            cmocka_unit_test(test_block_passthrough),
+            cmocka_unit_test(test_f32_mode),
+            cmocka_unit_test(test_f32_mode_per_sample),
+            cmocka_unit_test(test_f64_mode),
+            cmocka_unit_test(test_mc),
+            cmocka_unit_test(test_rational),
+            cmocka_unit_test(test_rational_per_sample),
+            cmocka_unit_test(test_rational_mc),
             cmocka_unit_test(test_invalid_args),
     };
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <math.h>
+#include "jsdrv_prv/f32_codec.h"
+
+
+#define N (133U)
+
+
+static void round_trip(const float * x, uint32_t n, uint32_t size_expect) {
+    uint8_t encoded[JSDRV_F32_CODEC_SIZE_MAX(N) + 1];
+    float y[N];
+    memset(encoded, 0xa5, sizeof(encoded));
+    uint32_t size = jsdrv_f32_codec_encode(encoded, x, n);
+    assert_true(size <= JSDRV_F32_CODEC_SIZE_MAX(n));
+    assert_int_equal(0xa5, encoded[size]);
+    if (size_expect) {
+        assert_int_equal(size_expect, size);
+    }
+    assert_true(jsdrv_f32_codec_check(encoded, size, n));
+    if (size) {
+        assert_false(jsdrv_f32_codec_check(encoded, size - 1, n));
+    }
+    assert_int_equal(size, jsdrv_f32_codec_decode(y, encoded, n));
+    assert_memory_equal(x, y, n * sizeof(float));  // bit exact, including NaN
+}
+
+static void test_constant(void ** state) {
+    (void) state;
+    float x[N];
+    for (uint32_t k = 0; k < N; ++k) {
+        x[k] = 0.0f;
+    }
+    round_trip(x, N, 9);  // the first sample, then one zero width byte for each group
+    for (uint32_t k = 0; k < N; ++k) {
+        x[k] = NAN;
+    }
+    round_trip(x, 0, 0);
+    round_trip(x, 1, 0);
+    round_trip(x, N, 0);
+}
+
+static void test_slow(void ** state) {
+    (void) state;
+    float x[N];
+    for (uint32_t k = 0; k < N; ++k) {
+        x[k] = 0.001f + 1e-6f * sinf(k * 0.01f);
+    }
+    uint8_t encoded[JSDRV_F32_CODEC_SIZE_MAX(N)];
+    uint32_t size = jsdrv_f32_codec_encode(encoded, x, N);
+    assert_true(size < (N * sizeof(float) / 2));
+    for (uint32_t n = 0; n <= N; ++n) {
+        round_trip(x, n, 0);
+    }
+}
+
+static void test_random(void ** state) {
+    (void) state;
+    float x[N];
+    uint32_t lfsr = 1;
+    for (uint32_t k = 0; k < N; ++k) {
+        lfsr = (lfsr * 1664525U) + 1013904223U;
+        memcpy(&x[k], &lfsr, sizeof(lfsr));  // every bit pattern, including NaN and infinity
+    }
+    x[7] = INFINITY;
+    x[8] = -INFINITY;
+    x[9] = -0.0f;
+    for (uint32_t n = 0; n <= N; ++n) {
+        round_trip(x, n, 0);
+    }
+}
+
+static void test_check_invalid(void ** state) {
+    (void) state;
+    uint8_t encoded[9] = {0, 0, 0, 0, 33, 0, 0, 0, 0};  // width > 32
+    assert_false(jsdrv_f32_codec_check(encoded, sizeof(encoded), 1));
+    encoded[4] = 32;
+    assert_true(jsdrv_f32_codec_check(encoded, 9, 1));
+    assert_false(jsdrv_f32_codec_check(encoded, 8, 1));
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_constant),
+            cmocka_unit_test(test_slow),
+            cmocka_unit_test(test_random),
+            cmocka_unit_test(test_check_invalid),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
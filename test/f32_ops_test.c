@@ -0,0 +1,328 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv/error_code.h"
+#include <math.h>
+#include <string.h>
+
+
+#define LENGTH (67)  // odd length exercises each tail path
+
+static const int32_t ISA_LIST[] = {
+    JSDRV_F32_OPS_ISA_SCALAR,
+    JSDRV_F32_OPS_ISA_SSE2,
+    JSDRV_F32_OPS_ISA_AVX2,
+    JSDRV_F32_OPS_ISA_NEON,
+};
+
+static float a_[LENGTH + 1];
+static float b_[LENGTH + 1];
+
+static int setup(void **state) {
+    (void) state;
+    for (uint32_t i = 0; i <= LENGTH; ++i) {
+        a_[i] = 0.25f * (float) i - 3.0f;
+        b_[i] = 1.0f / (float) (i + 1);
+    }
+    a_[5] = NAN;
+    return 0;
+}
+
+static void assert_f32_equal(float expect, float actual) {
+    if (isnan(expect)) {
+        assert_true(isnan(actual));
+    } else {
+        assert_true(expect == actual);
+    }
+}
+
+static void test_default_isa(void **state) {
+    (void) state;
+    int32_t isa = jsdrv_f32_ops_isa();
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa));
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(JSDRV_F32_OPS_ISA_SCALAR));
+    assert_int_equal(JSDRV_F32_OPS_ISA_SCALAR, jsdrv_f32_ops_isa());
+    assert_int_equal(JSDRV_ERROR_NOT_SUPPORTED, jsdrv_f32_ops_isa_set(99));
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa));
+}
+
+static void test_isa_str(void **state) {
+    (void) state;
+    assert_string_equal("scalar", jsdrv_f32_ops_isa_to_str(JSDRV_F32_OPS_ISA_SCALAR));
+    assert_string_equal("avx2", jsdrv_f32_ops_isa_to_str(JSDRV_F32_OPS_ISA_AVX2));
+    assert_null(jsdrv_f32_ops_isa_to_str(99));
+    assert_null(jsdrv_f32_ops_isa_to_str(-1));
+    assert_int_equal(JSDRV_F32_OPS_ISA_NEON, jsdrv_f32_ops_isa_from_str("neon"));
+    assert_int_equal(JSDRV_F32_OPS_ISA_SSE2, jsdrv_f32_ops_isa_from_str("SSE2"));
+    assert_int_equal(-1, jsdrv_f32_ops_isa_from_str("avx512"));
+    assert_int_equal(-1, jsdrv_f32_ops_isa_from_str(NULL));
+}
+
+static void test_scale(void **state) {
+    (void) state;
+    float x[LENGTH + 1];
+    float y[LENGTH + 1];
+    float z[LENGTH + 1];
+    float w[LENGTH + 1];
+    int32_t isa = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t offset = 0; offset < 2; ++offset) {  // unaligned
+            uint32_t length = LENGTH - offset;
+            memcpy(x, a_, sizeof(x));
+            memset(y, 0, sizeof(y));
+            jsdrv_f32_scale(x + offset, 1.5f, length);
+            jsdrv_f32_scale_copy(y + offset, a_ + offset, 1.5f, length);
+            memcpy(z, a_, sizeof(z));
+            memset(w, 0, sizeof(w));
+            jsdrv_f32_scale_copy2(z + offset, w + offset, z + offset, 1.5f, length);
+            for (uint32_t i = 0; i < offset; ++i) {
+                assert_f32_equal(a_[i], x[i]);
+                assert_f32_equal(0.0f, y[i]);
+            }
+            for (uint32_t i = offset; i < LENGTH; ++i) {
+                assert_f32_equal(a_[i] * 1.5f, x[i]);
+                assert_f32_equal(a_[i] * 1.5f, y[i]);
+                assert_f32_equal(a_[i] * 1.5f, z[i]);
+                assert_f32_equal(a_[i] * 1.5f, w[i]);
+            }
+            assert_f32_equal(a_[LENGTH], z[LENGTH]);
+            assert_f32_equal(0.0f, w[LENGTH]);
+            assert_f32_equal(a_[LENGTH], x[LENGTH]);
+            assert_f32_equal(0.0f, y[LENGTH]);
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+static void test_mult(void **state) {
+    (void) state;
+    float y[LENGTH + 1];
+    int32_t isa = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t length = 0; length <= LENGTH; ++length) {
+            memset(y, 0, sizeof(y));
+            jsdrv_f32_mult(y, a_, b_ + 1, length);
+            for (uint32_t i = 0; i < length; ++i) {
+                assert_f32_equal(a_[i] * b_[i + 1], y[i]);
+            }
+            assert_f32_equal(0.0f, y[length]);
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+static void test_from_i16(void **state) {
+    (void) state;
+    int16_t x[LENGTH + 1];
+    float y[LENGTH + 1];
+    for (uint32_t i = 0; i <= LENGTH; ++i) {
+        x[i] = (int16_t) ((i & 1) ? (-32768 + (int32_t) i * 97) : (32767 - (int32_t) i * 131));
+    }
+    int32_t isa = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t length = 0; length <= LENGTH; ++length) {
+            memset(y, 0, sizeof(y));
+            jsdrv_f32_from_i16(y, x + 1, -12.5f, 0.001f, length);
+            for (uint32_t i = 0; i < length; ++i) {
+                assert_f32_equal(((float) x[i + 1] - 12.5f) * 0.001f, y[i]);
+            }
+            assert_f32_equal(0.0f, y[length]);
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+static void test_scale_f64(void **state) {
+    (void) state;
+    double y[LENGTH + 1];
+    int32_t isa = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t length = 0; length <= LENGTH; ++length) {
+            memset(y, 0, sizeof(y));
+            jsdrv_f32_scale_f64(y, a_ + 1, 0.125, length);
+            for (uint32_t i = 0; i < length; ++i) {
+                double expect = isnan(a_[i + 1]) ? 0.0 : ((double) a_[i + 1] * 0.125);
+                assert_true(expect == y[i]);
+            }
+            assert_true(0.0 == y[length]);
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+static void test_sum_sq(void **state) {
+    (void) state;
+    int32_t isa = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t length = 0; length <= LENGTH; ++length) {
+            double expect = 0.0;
+            uint32_t expect_valid = 0;
+            for (uint32_t i = 0; i < length; ++i) {
+                if (!isnan(a_[i])) {
+                    expect += (double) a_[i] * (double) a_[i];
+                    ++expect_valid;
+                }
+            }
+            uint32_t valid = 0;
+            double actual = jsdrv_f32_sum_sq(a_, length, &valid);
+            assert_int_equal(expect_valid, valid);
+            assert_true(fabs(expect - actual) <= (1e-6 * expect));
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+static void test_sum_min_max(void **state) {
+    (void) state;
+    float nan_[LENGTH];
+    for (uint32_t i = 0; i < LENGTH; ++i) {
+        nan_[i] = NAN;
+    }
+    int32_t isa = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t length = 0; length <= LENGTH; ++length) {
+            double expect = 0.0;
+            uint32_t expect_valid = 0;
+            float expect_min = INFINITY;
+            float expect_max = -INFINITY;
+            float expect_b_min = INFINITY;
+            for (uint32_t i = 0; i < length; ++i) {
+                expect_b_min = fminf(expect_b_min, b_[i]);  // descending, so min in the last lane
+                if (!isnan(a_[i])) {
+                    expect += (double) a_[i];
+                    expect_min = fminf(expect_min, a_[i]);
+                    expect_max = fmaxf(expect_max, a_[i]);
+                    ++expect_valid;
+                }
+            }
+            uint32_t valid = 0;
+            float v_min = INFINITY;
+            float v_max = -INFINITY;
+            double actual = jsdrv_f32_sum_min_max(a_, length, &valid, &v_min, &v_max);
+            assert_int_equal(expect_valid, valid);
+            assert_true(fabs(expect - actual) <= 1e-9);
+            assert_f32_equal(expect_min, v_min);
+            assert_f32_equal(expect_max, v_max);
+            v_min = INFINITY;
+            v_max = -INFINITY;
+            jsdrv_f32_sum_min_max(b_, length, &valid, &v_min, &v_max);
+            assert_f32_equal(expect_b_min, v_min);
+
+            v_min = INFINITY;
+            v_max = -INFINITY;
+            assert_true(0.0 == jsdrv_f32_sum_min_max(nan_, length, &valid, &v_min, &v_max));
+            assert_int_equal(0, valid);
+            assert_f32_equal(INFINITY, v_min);
+            assert_f32_equal(-INFINITY, v_max);
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+static void test_sum_sq_dev(void **state) {
+    (void) state;
+    int32_t isa = jsdrv_f32_ops_isa();
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t length = 0; length <= LENGTH; ++length) {
+            double expect = 0.0;
+            for (uint32_t i = 0; i < length; ++i) {
+                if (!isnan(a_[i])) {
+                    double m = (double) a_[i] - 1.5;
+                    expect += m * m;
+                }
+            }
+            double actual = jsdrv_f32_sum_sq_dev(a_, length, 1.5);
+            assert_true(fabs(expect - actual) <= (1e-12 * expect));
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+static void test_find(void **state) {
+    (void) state;
+    int32_t isa = jsdrv_f32_ops_isa();
+    const float thresholds[] = {-10.0f, -2.9f, 0.0f, 7.1f, 20.0f};
+    for (uint32_t k = 0; k < JSDRV_ARRAY_SIZE(ISA_LIST); ++k) {
+        if (jsdrv_f32_ops_isa_set(ISA_LIST[k])) {
+            continue;
+        }
+        for (uint32_t j = 0; j < JSDRV_ARRAY_SIZE(thresholds); ++j) {
+            float t = thresholds[j];
+            for (uint32_t offset = 0; offset < 9; ++offset) {
+                uint32_t length = LENGTH - offset;
+                uint32_t gt = 0;
+                uint32_t le = 0;
+                for (; (gt < length) && !(a_[offset + gt] > t); ++gt) {}
+                for (; (le < length) && !(-a_[offset + le] <= -t); ++le) {}
+                assert_int_equal(gt, jsdrv_f32_find_gt(a_ + offset, length, t));
+                for (uint32_t i = 0; i < length; ++i) {
+                    b_[i] = -a_[offset + i];
+                }
+                assert_int_equal(le, jsdrv_f32_find_le(b_, length, -t));
+            }
+        }
+        b_[0] = NAN;
+        assert_int_equal(1, jsdrv_f32_find_le(b_, 2, INFINITY));
+        assert_int_equal(1, jsdrv_f32_find_gt(b_, 1, -INFINITY));
+    }
+    jsdrv_f32_ops_isa_set(isa);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_default_isa),
+            cmocka_unit_test(test_isa_str),
+            cmocka_unit_test_setup(test_scale, setup),
+            cmocka_unit_test_setup(test_mult, setup),
+            cmocka_unit_test_setup(test_from_i16, setup),
+            cmocka_unit_test_setup(test_scale_f64, setup),
+            cmocka_unit_test_setup(test_sum_sq, setup),
+            cmocka_unit_test_setup(test_sum_min_max, setup),
+            cmocka_unit_test_setup(test_sum_sq_dev, setup),
+            cmocka_unit_test_setup(test_find, setup),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
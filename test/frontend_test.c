@@ -14,10 +14,21 @@
  * limitations under the License.
  */
 
+#if _WIN32
+#include <winsock2.h>   // must precede windows.h
+#include <ws2tcpip.h>
+#define close closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 #include <stdarg.h>
 #include <stddef.h>
 #include <setjmp.h>
 #include <cmocka.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include "jsdrv.h"
@@ -28,8 +39,11 @@
 #include "jsdrv_prv/frontend.h"
 #include "jsdrv_prv/msg_queue.h"
 #include "jsdrv_prv/thread.h"
+#include "jsdrv_prv/f32_ops.h"
 #include "jsdrv/cstr.h"
 #include "jsdrv/error_code.h"
+#include "jsdrv/net.h"
+#include "jsdrv/stream_reader.h"
 #include <stdio.h>
 
 #define DEVICE_PREFIX "t/js220/123456"
@@ -43,6 +57,8 @@ struct test_s {
     struct jsdrvp_ll_device_s ll_dev1;
     jsdrv_thread_t thread;
     volatile uint32_t thread_quit;
+    struct jsdrv_union_s backend_arg;  // JSDRV_ARG_USB_DEVICE_THREADS seen by the backend factory
+    bool backend_init_hold;            // the test calls backend_init_send()
 };
 
 struct test_s self_;
@@ -234,6 +250,12 @@ static void dev_expect_bulk_out(struct jsdrvp_ll_device_s * d, uint16_t frame_id
 }
 #endif
 
+static void backend_init_send(struct test_s * self, struct jsdrv_context_s * context) {
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(context, JSDRV_MSG_INITIALIZE, &jsdrv_union_i32(0));
+    msg->payload.str[0] = self->backend.prefix;
+    jsdrvp_backend_send(context, msg);
+}
+
 int32_t jsdrv_unittest_backend_factory(struct jsdrv_context_s * context, struct jsdrvbk_s ** backend) {
     struct test_s * self = &self_;
     assert_ptr_equal(self->context, context);
@@ -241,10 +263,10 @@ int32_t jsdrv_unittest_backend_factory(struct jsdrv_context_s * context, struct
     self->backend.finalize = bk_finalize;
     self->backend.cmd_q = msg_queue_init();
     *backend = &self->backend;
-
-    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(context, JSDRV_MSG_INITIALIZE, &jsdrv_union_i32(0));
-    msg->payload.str[0] = self->backend.prefix;
-    jsdrvp_backend_send(context, msg);
+    jsdrvp_arg_get(context, JSDRV_ARG_USB_DEVICE_THREADS, &self->backend_arg);
+    if (!self->backend_init_hold) {
+        backend_init_send(self, context);
+    }
     return 0;
 }
 
@@ -303,6 +325,38 @@ static void device1_add(struct test_s * self) {
     expect_subscribe_cmd_str(self, JSDRV_MSG_DEVICE_LIST, DEVICE_PREFIX);
 
     expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/state$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/flush$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/flush/bytes$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/flush/mode$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/auto$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/gate/start$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/gate/stop$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/gate/start/utc$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/gate/stop/utc$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/latency$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/e2e$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stream/health$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/q/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/e/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/i/rms/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/i/rms/window$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/i/summary/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/v/summary/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/p/summary/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/summary/fs$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/gpi/0/edge/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/gpi/1/edge/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/gpi/2/edge/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/gpi/3/edge/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/gpi/7/edge/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/i/range/edge/ctrl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/ds/0/fs$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/ds/1/fs$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stats/win/0/scnt$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stats/win/1/scnt$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stats/host/scnt$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/stats/host/qtl$", NULL);
+    expect_subscribe_cmd_json(self, DEVICE_PREFIX "/h/filter/arith$", NULL);
     expect_subscribe_cmd(self, DEVICE_PREFIX "/h/state", &jsdrv_union_u32_r(1));  // closed
 }
 
@@ -406,6 +460,827 @@ static void test_discovery(void ** state) {
     }
 }
 
+static void test_msg_alloc_data_sz(void ** state) {
+    SETUP();
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(self->context, "a", 100);
+    assert_int_equal(4096, m->payload_size);
+    jsdrvp_msg_free(self->context, m);
+    m = jsdrvp_msg_alloc_data_sz(self->context, "b", 5000);
+    assert_int_equal(16384, m->payload_size);
+    jsdrvp_msg_free(self->context, m);
+    m = jsdrvp_msg_alloc_data_sz(self->context, "c", 20000);
+    assert_int_equal(sizeof(struct jsdrv_stream_signal_s), m->payload_size);
+    m->value.size = 200;
+    struct jsdrvp_msg_s * c = jsdrvp_msg_clone(self->context, m);
+    assert_int_equal(4096, c->payload_size);
+    assert_int_equal(200, c->value.size);
+    jsdrvp_msg_free(self->context, c);
+    jsdrvp_msg_free(self->context, m);
+    m = jsdrvp_msg_alloc_data(self->context, "d");
+    assert_int_equal(sizeof(struct jsdrv_stream_signal_s), m->payload_size);
+    jsdrvp_msg_free(self->context, m);
+    TEARDOWN();
+}
+
+static void test_retain_release(void ** state) {
+    SETUP();
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data_sz(self->context, "a", 16);
+    m->value.size = 16;
+    memset(m->payload.bin, 0x5a, 16);
+    assert_int_equal(0, jsdrv_retain(self->context, &m->value));
+    assert_int_equal(0, jsdrv_retain(self->context, &m->value));
+    assert_int_equal(2, m->refcnt);
+    jsdrvp_msg_free(self->context, m);  // the original owner
+    assert_int_equal(1, m->refcnt);
+    assert_int_equal(0, jsdrv_release(self->context, &m->value));
+    assert_int_equal(0, m->refcnt);
+    assert_int_equal(0x5a, m->payload.bin[15]);
+    assert_int_equal(0, jsdrv_release(self->context, &m->value));  // frees
+
+    struct jsdrv_union_s v = jsdrv_union_u32(1);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_retain(self->context, &v));
+    TEARDOWN();
+}
+
+static void test_msg_value_shared(void ** state) {
+    SETUP();
+    static const char big_static[] = "static metadata";
+    uint32_t sz = 100000;
+    uint8_t * image = malloc(sz);
+    for (uint32_t i = 0; i < sz; ++i) {
+        image[i] = (uint8_t) i;
+    }
+
+    // large values copy once into shared memory, then clones share it
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(self->context, "a", &jsdrv_union_bin(image, sz));
+    free(image);
+    assert_true(m->value.flags & JSDRV_UNION_FLAG_SHARED_MEMORY);
+    struct jsdrvp_msg_s * c = jsdrvp_msg_clone(self->context, m);
+    assert_ptr_equal(m->value.value.bin, c->value.value.bin);
+    struct jsdrvp_msg_s * r = jsdrvp_msg_alloc_value(self->context, "b", &m->value);
+    assert_ptr_equal(m->value.value.bin, r->value.value.bin);
+    jsdrvp_msg_free(self->context, m);
+    jsdrvp_msg_free(self->context, c);
+    assert_int_equal(99, r->value.value.bin[99]);
+    assert_int_equal(0, jsdrv_retain(self->context, &r->value));
+    jsdrvp_msg_free(self->context, r);
+    assert_int_equal(0, jsdrv_release(self->context, &r->value));  // frees
+
+    // static values are borrowed
+    struct jsdrv_union_s v = jsdrv_union_cstr_r(big_static);
+    v.flags |= JSDRV_UNION_FLAG_STATIC;
+    m = jsdrvp_msg_alloc_value(self->context, "c", &v);
+    assert_ptr_equal(big_static, m->value.value.str);
+    assert_int_equal(sizeof(big_static), m->value.size);
+    c = jsdrvp_msg_clone(self->context, m);
+    assert_ptr_equal(big_static, c->value.value.str);
+    jsdrvp_msg_free(self->context, c);
+    jsdrvp_msg_free(self->context, m);
+
+    // small values stay inline
+    m = jsdrvp_msg_alloc_value(self->context, "d", &jsdrv_union_cstr("hello"));
+    c = jsdrvp_msg_clone(self->context, m);
+    assert_ptr_equal(c->payload.str, c->value.value.str);
+    assert_string_equal("hello", c->value.value.str);
+    jsdrvp_msg_free(self->context, c);
+    jsdrvp_msg_free(self->context, m);
+    TEARDOWN();
+}
+
+static void test_pool_stats(void ** state) {
+    struct jsdrvp_msg_s * msg;
+    struct jsdrv_arg_s args[] = {
+            {.topic=JSDRV_ARG_POOL_NORMAL_INIT, .value=jsdrv_union_u32(8)},
+            {.topic=JSDRV_ARG_POOL_NORMAL_MAX, .value=jsdrv_union_u32(64)},
+            {.topic=JSDRV_ARG_POOL_DATA_INIT, .value=jsdrv_union_u32(2)},
+            {.topic=JSDRV_ARG_POOL_DATA_MAX, .value=jsdrv_union_u32(4)},
+            {.topic=JSDRV_ARG_STATS_MEM_INTERVAL, .value=jsdrv_union_u32(100)},
+            {.topic=""},
+    };
+    memset(&self_, 0, sizeof(self_));
+    struct test_s * self = &self_;
+    *state = self;
+    self->sub_msgs = msg_queue_init();
+    assert_int_equal(0, jsdrv_initialize(&self->context, args, 1000));
+    assert_int_equal(0, jsdrv_subscribe(self->context, JSDRV_MSG_STATS_MEM, JSDRV_SFLAG_PUB | JSDRV_SFLAG_RETAIN,
+                                        subscribe_cmd_fn, self, 1000));
+    assert_int_equal(0, msg_queue_pop(self->sub_msgs, &msg, SUB_TIMEOUT_MS));
+    assert_string_equal(JSDRV_MSG_STATS_MEM, msg->topic);
+    assert_int_equal(JSDRV_UNION_JSON, msg->value.type);
+    assert_non_null(strstr(msg->value.value.str, "\"normal\": {\"allocated\": "));
+    assert_non_null(strstr(msg->value.value.str, "\"data\": {\"allocated\": 2, \"in_use\": 0,"));
+    jsdrvp_msg_free(self->context, msg);
+    assert_int_equal(0, jsdrv_unsubscribe(self->context, JSDRV_MSG_STATS_MEM, subscribe_cmd_fn, self, 1000));
+    jsdrv_finalize(self->context, 1000);
+    msg_queue_finalize(self->sub_msgs);
+    memset(&self_, 0, sizeof(self_));
+}
+
+static void test_stats_threads(void ** state) {
+    struct jsdrvp_msg_s * msg;
+    struct jsdrv_arg_s args[] = {
+            {.topic=JSDRV_ARG_STATS_THREADS_INTERVAL, .value=jsdrv_union_u32(10)},
+            {.topic=""},
+    };
+    memset(&self_, 0, sizeof(self_));
+    struct test_s * self = &self_;
+    *state = self;
+    self->sub_msgs = msg_queue_init();
+    assert_int_equal(0, jsdrv_initialize(&self->context, args, 1000));
+    assert_int_equal(0, jsdrv_subscribe(self->context, JSDRV_MSG_STATS_THREADS, JSDRV_SFLAG_PUB | JSDRV_SFLAG_RETAIN,
+                                        subscribe_cmd_fn, self, 1000));
+    assert_int_equal(0, msg_queue_pop(self->sub_msgs, &msg, SUB_TIMEOUT_MS));
+    assert_string_equal(JSDRV_MSG_STATS_THREADS, msg->topic);
+    assert_int_equal(JSDRV_UNION_JSON, msg->value.type);
+    assert_non_null(strstr(msg->value.value.str, "{\"threads\": [{\"name\": "));
+    assert_non_null(strstr(msg->value.value.str, "\"name\": \"jsdrv_frontend\", \"cpu_ms\": "));
+    assert_non_null(strstr(msg->value.value.str, "\"queues\": {\"msg_cmd\": "));
+    assert_non_null(strstr(msg->value.value.str, "\"msg_backend\": "));
+    jsdrvp_msg_free(self->context, msg);
+    assert_int_equal(0, jsdrv_unsubscribe(self->context, JSDRV_MSG_STATS_THREADS, subscribe_cmd_fn, self, 1000));
+    jsdrv_finalize(self->context, 1000);
+    msg_queue_finalize(self->sub_msgs);
+    memset(&self_, 0, sizeof(self_));
+}
+
+static void test_cpu_isa(void ** state) {
+    struct jsdrvp_msg_s * msg;
+    struct jsdrv_arg_s args[] = {
+            {.topic=JSDRV_ARG_CPU_ISA, .value=jsdrv_union_str("scalar")},
+            {.topic=""},
+    };
+    struct jsdrv_arg_s args_invalid[] = {
+            {.topic=JSDRV_ARG_CPU_ISA, .value=jsdrv_union_str("mmx")},
+            {.topic=""},
+    };
+    memset(&self_, 0, sizeof(self_));
+    struct test_s * self = &self_;
+    *state = self;
+    int32_t isa = jsdrv_f32_ops_isa();
+    self->sub_msgs = msg_queue_init();
+    assert_int_equal(0, jsdrv_initialize(&self->context, args, 1000));
+    assert_int_equal(0, jsdrv_subscribe(self->context, JSDRV_MSG_CPU_ISA, JSDRV_SFLAG_PUB | JSDRV_SFLAG_RETAIN,
+                                        subscribe_cmd_fn, self, 1000));
+    assert_int_equal(0, msg_queue_pop(self->sub_msgs, &msg, SUB_TIMEOUT_MS));
+    assert_string_equal(JSDRV_MSG_CPU_ISA, msg->topic);
+    assert_string_equal("scalar", msg->value.value.str);
+    jsdrvp_msg_free(self->context, msg);
+    assert_int_equal(0, jsdrv_unsubscribe(self->context, JSDRV_MSG_CPU_ISA, subscribe_cmd_fn, self, 1000));
+    jsdrv_finalize(self->context, 1000);
+    self->context = NULL;
+    assert_int_equal(JSDRV_ERROR_NOT_SUPPORTED, jsdrv_initialize(&self->context, args_invalid, 1000));
+    assert_null(self->context);
+    msg_queue_finalize(self->sub_msgs);
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa));
+    memset(&self_, 0, sizeof(self_));
+}
+
+static void test_publish_batch(void ** state) {
+    SETUP();
+    int32_t rc[3];
+    struct jsdrv_arg_s args[] = {
+            {.topic="t/a", .value=jsdrv_union_u32_r(1)},
+            {.topic="t/b", .value=jsdrv_union_u32_r(2)},
+            {.topic="t/c", .value=jsdrv_union_u32_r(3)},
+    };
+    assert_int_equal(0, jsdrv_publish_batch(self->context, args, 2, NULL, 0));
+    // retained duplicates complete immediately
+    assert_int_equal(0, jsdrv_publish_batch(self->context, args, 2, rc, 1000));
+    assert_int_equal(0, rc[0]);
+    assert_int_equal(0, rc[1]);
+    // new value has no responder
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_publish_batch(self->context, args, 3, rc, 50));
+    assert_int_equal(0, rc[0]);
+    assert_int_equal(0, rc[1]);
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, rc[2]);
+    assert_int_equal(0, jsdrv_publish_batch(self->context, args, 0, rc, 1000));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_publish_batch(self->context, NULL, 1, rc, 1000));
+    TEARDOWN();
+}
+
+extern int32_t jsdrv_unittest_api_wait_error;
+
+static void test_publish_batch_wait_error(void ** state) {
+    SETUP();
+    int32_t rc[2] = {1, 1};
+    struct jsdrv_arg_s args[] = {
+            {.topic="t/w/a", .value=jsdrv_union_u32_r(1)},
+            {.topic="t/w/b", .value=jsdrv_union_u32_r(2)},
+    };
+    assert_int_equal(0, jsdrv_publish_batch(self->context, args, 1, NULL, 0));
+    // the wait fails while the retained duplicate and the unanswered publish are still pending
+    jsdrv_unittest_api_wait_error = JSDRV_ERROR_ABORTED;
+    assert_int_equal(JSDRV_ERROR_ABORTED, jsdrv_publish_batch(self->context, args, 2, rc, 50));
+    assert_int_equal(1, rc[0]);
+    assert_int_equal(1, rc[1]);
+    // the frontend thread completes both, including the timeout, and frees the batch
+    jsdrv_thread_sleep_ms(150);
+    assert_int_equal(0, jsdrv_publish_batch(self->context, args, 2, rc, 1000));
+    assert_int_equal(0, rc[0]);
+    assert_int_equal(0, rc[1]);
+    TEARDOWN();
+}
+
+static void test_open_many(void ** state) {
+    SETUP();
+    int32_t rc[2] = {1, 1};
+    const char * prefixes[] = {"u/js220/000001", "u/js220/000002"};
+    // no device responds, so both time out within one shared timeout
+    uint32_t t_start = jsdrv_time_ms_u32();
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_open_many(self->context, prefixes, 2, 0, rc, 200));
+    assert_true((jsdrv_time_ms_u32() - t_start) < 390);
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, rc[0]);
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, rc[1]);
+    assert_int_equal(0, jsdrv_open_many(self->context, prefixes, 0, 0, rc, 50));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_open_many(self->context, NULL, 1, 0, rc, 50));
+    TEARDOWN();
+}
+
+static void test_profile_apply(void ** state) {
+    SETUP();
+    uint32_t changed = 99;
+    struct jsdrv_union_s v = jsdrv_union_null();
+    struct jsdrv_arg_s args[] = {
+            {.topic="p/a", .value=jsdrv_union_u32_r(1)},
+            {.topic="p/b", .value=jsdrv_union_cstr_r("hello")},
+            {.topic="p/c", .value=jsdrv_union_u32_r(3)},
+    };
+    assert_int_equal(0, jsdrv_publish(self->context, "t/p/a", &args[0].value, 0));
+    assert_int_equal(0, jsdrv_publish(self->context, "t/p/b", &args[1].value, 0));
+    assert_int_equal(0, jsdrv_query(self->context, "t/p/a", &v, 0));  // wait for the retained values
+
+    assert_int_equal(0, jsdrv_profile_apply(self->context, "t", args, 2, &changed, 1000));
+    assert_int_equal(0, changed);
+    assert_int_equal(0, jsdrv_profile_apply_json(self->context, "t",
+            "{\"p\": {\"a\": 1, \"b\": \"hello\"}}", &changed, 1000));
+    assert_int_equal(0, changed);
+    assert_int_equal(0, jsdrv_profile_apply_json(self->context, "", "{\"t/p/a\": 1}", &changed, 1000));
+    assert_int_equal(0, changed);
+
+    // changed values have no responder
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_profile_apply(self->context, "t", args, 3, &changed, 50));
+    assert_int_equal(1, changed);
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_profile_apply_json(self->context, "t",
+            "{\"p\": {\"a\": 2, \"b\": \"hello\"}}", &changed, 50));
+    assert_int_equal(1, changed);
+
+    // pending publishes are compared after one ordered round trip
+    struct jsdrv_union_s a5 = jsdrv_union_u32_r(5);
+    assert_int_equal(0, jsdrv_publish(self->context, "t/p/a", &args[0].value, 0));
+    assert_int_equal(0, jsdrv_profile_apply(self->context, "t", args, 2, &changed, 1000));
+    assert_int_equal(0, changed);
+    assert_int_equal(0, jsdrv_publish(self->context, "t/p/a", &a5, 0));
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_profile_apply(self->context, "t", args, 2, &changed, 50));
+    assert_int_equal(1, changed);
+
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_profile_apply_json(self->context, "t", "[1]", &changed, 50));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_profile_apply_json(self->context, "t", "{\"a\": null}", &changed, 50));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_profile_apply(self->context, "t", NULL, 1, &changed, 50));
+    assert_int_equal(0, changed);
+    TEARDOWN();
+}
+
+static void completion_fn(void * user_data, const char * topic, int32_t return_code) {
+    struct test_s * self = (struct test_s *) user_data;
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(self->context, topic, &jsdrv_union_i32(return_code));
+    msg_queue_push(self->sub_msgs, msg);
+}
+
+static void expect_completion(struct test_s * self, const char * topic, int32_t return_code) {
+    struct jsdrvp_msg_s * msg;
+    assert_int_equal(0, msg_queue_pop(self->sub_msgs, &msg, SUB_TIMEOUT_MS));
+    assert_string_equal(topic, msg->topic);
+    assert_int_equal(return_code, msg->value.value.i32);
+    jsdrvp_msg_free(self->context, msg);
+}
+
+static void test_publish_async(void ** state) {
+    SETUP();
+    assert_int_equal(0, jsdrv_publish(self->context, "t/a", &jsdrv_union_u32_r(1), 0));
+    assert_int_equal(0, jsdrv_publish_async(self->context, "t/a", &jsdrv_union_u32_r(1), 1000, completion_fn, self));
+    expect_completion(self, "t/a", 0);
+    assert_int_equal(0, jsdrv_publish_async(self->context, "t/b", &jsdrv_union_u32_r(2), 50, completion_fn, self));
+    expect_completion(self, "t/b", JSDRV_ERROR_TIMED_OUT);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_publish_async(self->context, NULL, &jsdrv_union_u32_r(2), 50, completion_fn, self));
+    ASSERT_QUEUES_EMPTY(self);
+    TEARDOWN();
+}
+
+static void test_query(void ** state) {
+    SETUP();
+    char buf[16];
+    struct jsdrv_union_s v = jsdrv_union_null();
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_query(self->context, "q/a", &v, 0));
+    for (uint32_t i = 1; i <= 4; ++i) {
+        // no wait: the query must still observe this thread's publish
+        assert_int_equal(0, jsdrv_publish(self->context, "q/a", &jsdrv_union_u32_r(i), 0));
+        assert_int_equal(0, jsdrv_query(self->context, "q/a", &v, 0));
+        assert_int_equal(i, v.value.u32);
+        v = jsdrv_union_null();
+        assert_int_equal(0, jsdrv_query(self->context, "q/a", &v, 0));
+        assert_int_equal(i, v.value.u32);
+    }
+    assert_int_equal(0, jsdrv_publish(self->context, "q/s", &jsdrv_union_cstr_r("hello"), 0));
+    v = jsdrv_union_str(buf);
+    v.size = sizeof(buf);
+    assert_int_equal(0, jsdrv_query(self->context, "q/s", &v, 0));
+    assert_string_equal("hello", buf);
+    v.size = 2;
+    assert_int_equal(JSDRV_ERROR_TOO_SMALL, jsdrv_query(self->context, "q/s", &v, 0));
+    ASSERT_QUEUES_EMPTY(self);
+    TEARDOWN();
+}
+
+static void test_group(void ** state) {
+    SETUP();
+    device1_add(self);
+    struct jsdrv_context_s * c = self->context;
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_publish(c, "@/group/lab/s/i/ctrl", &jsdrv_union_u32_r(1), 1000));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_publish(c, "@/group/lab/!add", &jsdrv_union_u32_r(1), 1000));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_publish(c, "@/group/lab", &jsdrv_union_cstr_r(DEVICE_PREFIX), 1000));
+    assert_int_equal(0, jsdrv_publish(c, "@/group/lab/!add", &jsdrv_union_cstr_r(DEVICE_PREFIX), 1000));
+    expect_subscribe_cmd_str(self, "@/group/lab/list", DEVICE_PREFIX);
+
+    // fan out, return code once the member responds
+    assert_int_equal(JSDRV_ERROR_CLOSED, jsdrv_publish(c, "@/group/lab/s/i/ctrl", &jsdrv_union_u32_r(1), 1000));
+    expect_subscribe_cmd(self, DEVICE_PREFIX "/s/i/ctrl", &jsdrv_union_u32_r(1));
+    expect_subscribe_cmd(self, DEVICE_PREFIX "/s/i/ctrl#", &jsdrv_union_i32(JSDRV_ERROR_CLOSED));
+
+    // the first member data after the stream enable reports the start window
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data(c, DEVICE_PREFIX "/s/i/!data");
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->payload.bin;
+    memset(s, 0, JSDRV_STREAM_HEADER_SIZE);
+    s->sample_id = 2000;
+    s->time_map.offset_time = JSDRV_TIME_SECOND;
+    s->time_map.offset_counter = 1000;
+    s->time_map.counter_rate = 1000.0;
+    m->value = jsdrv_union_bin(m->payload.bin, JSDRV_STREAM_HEADER_SIZE);
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    jsdrvp_backend_send(c, m);
+    expect_subscribe_cmd_json(self, "@/group/lab/start",
+        "{\"utc\": 2147483648, \"skew\": 0, \"devices\": [{\"device\": \"" DEVICE_PREFIX "\", "
+        "\"sample_id\": 2000, \"sample_id_start\": 2000}]}");
+
+    // each member statistics block completes the single member group period
+    m = jsdrvp_msg_alloc(c);
+    jsdrv_cstr_copy(m->topic, DEVICE_PREFIX "/s/stats/value", sizeof(m->topic));
+    struct jsdrv_statistics_s * stats = (struct jsdrv_statistics_s *) m->payload.bin;
+    memset(stats, 0, sizeof(*stats));
+    stats->i_avg = 0.25;
+    m->value = jsdrv_union_cbin_r(m->payload.bin, sizeof(*stats));
+    m->value.app = JSDRV_PAYLOAD_TYPE_STATISTICS;
+    jsdrvp_backend_send(c, m);
+    assert_int_equal(0, msg_queue_pop(self->sub_msgs, &m, SUB_TIMEOUT_MS));
+    assert_string_equal("@/group/lab/stats/value", m->topic);
+    assert_int_equal(sizeof(*stats), m->value.size);
+    assert_float_equal(0.25, ((struct jsdrv_statistics_s *) m->value.value.bin)->i_avg, 0.0);
+    jsdrvp_msg_free(c, m);
+    expect_subscribe_cmd(self, DEVICE_PREFIX "/s/stats/value", NULL);
+    assert_int_equal(0, jsdrv_publish(c, "@/group/lab/stats/topic", &jsdrv_union_cstr_r(""), 1000));
+
+    // missing members fail without a device response
+    assert_int_equal(0, jsdrv_publish(c, "@/group/lab/!add", &jsdrv_union_cstr_r("t/js220/999999"), 1000));
+    expect_subscribe_cmd_str(self, "@/group/lab/list", DEVICE_PREFIX ",t/js220/999999");
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_publish(c, "@/group/lab/s/i/ctrl", &jsdrv_union_u32_r(0), 1000));
+    expect_subscribe_cmd(self, DEVICE_PREFIX "/s/i/ctrl", &jsdrv_union_u32_r(0));
+    expect_subscribe_cmd(self, DEVICE_PREFIX "/s/i/ctrl#", &jsdrv_union_i32(JSDRV_ERROR_CLOSED));
+
+    assert_int_equal(0, jsdrv_publish(c, "@/group/lab/!remove", &jsdrv_union_cstr_r(DEVICE_PREFIX), 1000));
+    expect_subscribe_cmd_str(self, "@/group/lab/list", "t/js220/999999");
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_publish(c, "@/group/lab/!remove", &jsdrv_union_cstr_r(DEVICE_PREFIX), 1000));
+    assert_int_equal(0, jsdrv_publish(c, "@/group/lab/!remove", &jsdrv_union_cstr_r(""), 1000));
+    expect_subscribe_cmd_str(self, "@/group/lab/list", "");
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_publish(c, "@/group/lab/s/i/ctrl", &jsdrv_union_u32_r(1), 1000));
+
+    device1_remove(self);
+    ASSERT_QUEUES_EMPTY(self);
+    TEARDOWN();
+}
+
+static volatile uint32_t interval_count_;
+static struct jsdrv_interval_s interval_;
+
+static void interval_fn(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) user_data;
+    (void) topic;
+    if (value->app == JSDRV_PAYLOAD_TYPE_INTERVAL) {
+        memcpy(&interval_, value->value.bin, sizeof(interval_));
+        ++interval_count_;
+    }
+}
+
+static void stream_send(struct jsdrv_context_s * c, const char * subtopic, uint64_t sample_id,
+                        uint32_t count, uint8_t bits, const void * data) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_data(c, "");
+    snprintf(m->topic, sizeof(m->topic), "%s/s/%s/!data", DEVICE_PREFIX, subtopic);
+    struct jsdrv_stream_signal_s * s = (struct jsdrv_stream_signal_s *) m->payload.bin;
+    memset(s, 0, JSDRV_STREAM_HEADER_SIZE);
+    s->sample_id = sample_id;
+    s->element_type = (bits == 32) ? JSDRV_DATA_TYPE_FLOAT : JSDRV_DATA_TYPE_UINT;
+    s->element_size_bits = bits;
+    s->element_count = count;
+    s->sample_rate = 2000000;
+    s->decimate_factor = 2;
+    uint32_t sz = (count * bits + 7) / 8;
+    memcpy(s->data, data, sz);
+    m->value = jsdrv_union_bin(m->payload.bin, JSDRV_STREAM_HEADER_SIZE + sz);
+    m->value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    jsdrvp_backend_send(c, m);
+}
+
+static void stream_send_f32(struct jsdrv_context_s * c, const char * subtopic, uint64_t sample_id, float value) {
+    float data[1000];
+    for (uint32_t i = 0; i < 1000; ++i) {
+        data[i] = value;
+    }
+    stream_send(c, subtopic, sample_id, 1000, 32, data);
+}
+
+static void interval_wait(uint32_t count) {
+    for (int i = 0; (i < 200) && (interval_count_ < count); ++i) {
+        jsdrv_thread_sleep_ms(5);
+    }
+    assert_int_equal(count, interval_count_);
+}
+
+static void test_interval(void ** state) {
+    SETUP();
+    struct jsdrv_context_s * c = self->context;
+    interval_count_ = 0;
+    assert_int_equal(0, jsdrv_publish(c, "e/@/!add", &jsdrv_union_u8_r(1), 1000));
+    assert_int_equal(0, jsdrv_subscribe(c, "e/001/g/!data", JSDRV_SFLAG_PUB, interval_fn, NULL, 1000));
+    assert_int_equal(0, jsdrv_publish(c, "e/001/g/marker", &jsdrv_union_cstr_r("gpi/0"), 1000));
+    assert_int_equal(0, jsdrv_publish(c, "e/001/g/device", &jsdrv_union_cstr_r(DEVICE_PREFIX), 1000));
+
+    // samples wait for the marker signal, which is high from sample 100 to 600
+    stream_send_f32(c, "i", 0, 1.0f);
+    stream_send_f32(c, "p", 0, 2.0f);
+    uint8_t gpi[125];
+    memset(gpi, 0, sizeof(gpi));
+    for (uint32_t i = 100; i < 600; ++i) {
+        gpi[i / 8] |= (uint8_t) (1 << (i & 7));
+    }
+    stream_send(c, "gpi/0", 0, 1000, 1, gpi);
+    interval_wait(1);
+    assert_int_equal(200, interval_.sample_id);
+    assert_int_equal(1200, interval_.sample_id_end);
+    assert_int_equal(0, interval_.flags);
+    assert_int_equal(500, interval_.i_count);
+    assert_float_equal(500e-6, interval_.charge_f64, 1e-12);
+    assert_float_equal(1000e-6, interval_.energy_f64, 1e-12);
+
+    // software markers
+    assert_int_equal(0, jsdrv_publish(c, "e/001/g/marker", &jsdrv_union_cstr_r(""), 1000));
+    stream_send_f32(c, "i", 2000, 0.5f);
+    stream_send_f32(c, "p", 2000, 0.5f);
+    assert_int_equal(0, jsdrv_publish(c, "e/001/g/!start", &jsdrv_union_u64_r(4000), 1000));
+    stream_send_f32(c, "i", 4000, 0.5f);
+    stream_send_f32(c, "p", 4000, 0.5f);
+    assert_int_equal(0, jsdrv_publish(c, "e/001/g/!stop", &jsdrv_union_u64_r(5000), 1000));
+    interval_wait(2);
+    assert_int_equal(1, interval_.interval_id);
+    assert_int_equal(4000, interval_.sample_id);
+    assert_int_equal(500, interval_.p_count);
+    assert_float_equal(0.5, interval_.p_max, 0.0);
+
+    assert_int_equal(0, jsdrv_unsubscribe(c, "e/001/g/!data", interval_fn, NULL, 1000));
+    assert_int_equal(0, jsdrv_publish(c, "e/@/!remove", &jsdrv_union_u8_r(1), 1000));
+    ASSERT_QUEUES_EMPTY(self);
+    TEARDOWN();
+}
+
+static void test_stream_reader(void ** state) {
+    SETUP();
+    struct jsdrv_context_s * c = self->context;
+    struct jsdrv_stream_reader_s * reader = NULL;
+    struct jsdrv_stream_ring_info_s info;
+    float buffer[1500];
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_stream_reader_open(c, "", 0, &reader));
+    assert_int_equal(0, jsdrv_stream_reader_open(c, DEVICE_PREFIX "/s/i/!data", 1, &reader));
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_stream_read(reader, buffer, 1500, &info, 0));
+
+    stream_send_f32(c, "i", 0, 1.0f);
+    stream_send_f32(c, "i", 2000, 2.0f);
+    assert_int_equal(0, jsdrv_stream_read(reader, buffer, 1500, &info, 1000));
+    if (info.element_count < 1500) {  // the second message may not have arrived yet
+        assert_int_equal(1000, info.element_count);
+        assert_int_equal(0, jsdrv_stream_read(reader, buffer + 1000, 500, &info, 1000));
+        assert_int_equal(2000, info.sample_id);
+        assert_int_equal(500, info.element_count);
+    } else {
+        assert_int_equal(0, info.sample_id);
+    }
+    assert_true(1.0f == buffer[999]);
+    assert_true(2.0f == buffer[1000]);
+    assert_true(2.0f == buffer[1499]);
+    assert_int_equal(0, jsdrv_stream_read(reader, buffer, 1500, &info, 1000));
+    assert_int_equal(3000, info.sample_id);
+    assert_int_equal(500, info.element_count);
+    assert_int_equal(2, info.decimate_factor);
+    assert_int_equal(0, info.drops);
+
+    assert_int_equal(0, jsdrv_stream_reader_close(reader));
+    ASSERT_QUEUES_EMPTY(self);
+    TEARDOWN();
+}
+
+static volatile uint32_t lane_data_count_;
+static volatile uint32_t lane_close_data_count_;
+
+static void lane_fn(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) user_data;
+    if (value->app == JSDRV_PAYLOAD_TYPE_STREAM) {
+        ++lane_data_count_;
+    } else if (jsdrv_cstr_ends_with(topic, JSDRV_MSG_CLOSE "#")) {
+        lane_close_data_count_ = lane_data_count_;
+    }
+}
+
+static void test_backend_lanes(void ** state) {
+    SETUP();
+    struct jsdrv_context_s * c = self->context;
+    lane_data_count_ = 0;
+    lane_close_data_count_ = 0;
+    assert_int_equal(0, jsdrv_subscribe(c, DEVICE_PREFIX, JSDRV_SFLAG_PUB | JSDRV_SFLAG_RETURN_CODE,
+                                        lane_fn, NULL, 1000));
+    for (uint32_t i = 0; i < 100; ++i) {
+        stream_send_f32(c, "i", i * 2000, 1.0f);
+    }
+    // the close return code uses the control lane but must not overtake the data
+    jsdrvp_backend_send(c, jsdrvp_msg_alloc_value(c, DEVICE_PREFIX "/" JSDRV_MSG_CLOSE "#", &jsdrv_union_i32(0)));
+    for (int i = 0; (i < 200) && !lane_close_data_count_; ++i) {
+        jsdrv_thread_sleep_ms(5);
+    }
+    assert_int_equal(100, lane_close_data_count_);
+    assert_int_equal(0, jsdrv_unsubscribe(c, DEVICE_PREFIX, lane_fn, NULL, 1000));
+    ASSERT_QUEUES_EMPTY(self);
+    TEARDOWN();
+}
+
+static void test_init_lazy(void ** state) {
+    struct jsdrvp_msg_s * msg;
+    struct jsdrv_arg_s args[] = {
+            {.topic=JSDRV_ARG_INIT_LAZY, .value=jsdrv_union_u32(1)},
+            {.topic=JSDRV_ARG_DEVICE_HINT, .value=jsdrv_union_cstr(DEVICE_PREFIX)},
+            {.topic=""},
+    };
+    memset(&self_, 0, sizeof(self_));
+    struct test_s * self = &self_;
+    *state = self;
+    self->sub_msgs = msg_queue_init();
+    jsdrv_cstr_copy(self->ll_dev1.prefix, DEVICE_PREFIX, sizeof(self->ll_dev1.prefix));
+    self->ll_dev1.cmd_q = msg_queue_init();
+    self->ll_dev1.rsp_q = msg_queue_init();
+    self->backend_init_hold = true;  // the device scan does not complete
+    assert_int_equal(0, jsdrv_initialize(&self->context, args, 1000));
+    assert_int_equal(0, jsdrv_subscribe(self->context, "@", JSDRV_SFLAG_PUB, subscribe_cmd_fn, self, 1000));
+
+    // held until the backend adds the device
+    assert_int_equal(0, jsdrv_publish_async(self->context, DEVICE_PREFIX "/" JSDRV_MSG_CLOSE, &jsdrv_union_i32(0),
+                                            1000, completion_fn, self));
+    msg = jsdrvp_msg_alloc(self->context);
+    jsdrv_cstr_copy(msg->topic, JSDRV_MSG_DEVICE_ADD, sizeof(msg->topic));
+    msg->value = jsdrv_union_bin((const uint8_t *) &msg->payload.device, sizeof(msg->payload.device));
+    msg->value.app = JSDRV_PAYLOAD_TYPE_DEVICE;
+    msg->payload.device = self->ll_dev1;
+    jsdrvp_backend_send(self->context, msg);
+    expect_subscribe_cmd_str(self, JSDRV_MSG_DEVICE_ADD, DEVICE_PREFIX);
+    expect_subscribe_cmd_str(self, JSDRV_MSG_DEVICE_LIST, DEVICE_PREFIX);
+    expect_completion(self, DEVICE_PREFIX "/" JSDRV_MSG_CLOSE, 0);  // the driver started on first use
+
+    backend_init_send(self, self->context);
+    msg = jsdrvp_msg_alloc(self->context);
+    jsdrv_cstr_copy(msg->topic, JSDRV_MSG_DEVICE_REMOVE, sizeof(msg->topic));
+    msg->value = jsdrv_union_str(DEVICE_PREFIX);
+    jsdrvp_backend_send(self->context, msg);
+    expect_subscribe_cmd_str(self, JSDRV_MSG_DEVICE_REMOVE, DEVICE_PREFIX);
+    expect_subscribe_cmd_str(self, JSDRV_MSG_DEVICE_LIST, "");
+    ASSERT_QUEUES_EMPTY(self);
+    TEARDOWN();
+}
+
+static void dispatch_data_fn(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    struct test_s * self = (struct test_s *) user_data;
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(self->context, topic, &jsdrv_union_u32(value->value.bin[0]));
+    msg_queue_push(self->sub_msgs, msg);
+}
+
+static void test_dispatch_threads(void ** state) {
+    struct jsdrvp_msg_s * msg;
+    struct jsdrv_arg_s args[] = {
+            {.topic=JSDRV_ARG_DISPATCH_THREADS, .value=jsdrv_union_u32(2)},
+            {.topic=""},
+    };
+    memset(&self_, 0, sizeof(self_));
+    struct test_s * self = &self_;
+    *state = self;
+    self->sub_msgs = msg_queue_init();
+    assert_int_equal(0, jsdrv_initialize(&self->context, args, 1000));
+    assert_int_equal(0, jsdrv_subscribe(self->context, DEVICE_PREFIX "/s/i/!data", JSDRV_SFLAG_PUB,
+                                        dispatch_data_fn, self, 1000));
+    for (uint8_t i = 0; i < 20; ++i) {
+        msg = jsdrvp_msg_alloc_data_sz(self->context, DEVICE_PREFIX "/s/i/!data", 16);
+        msg->payload.bin[0] = i;
+        msg->value = jsdrv_union_bin(msg->payload.bin, 16);
+        jsdrvp_backend_send(self->context, msg);
+    }
+    for (uint32_t i = 0; i < 20; ++i) {  // in order for each device
+        assert_int_equal(0, msg_queue_pop(self->sub_msgs, &msg, SUB_TIMEOUT_MS));
+        assert_string_equal(DEVICE_PREFIX "/s/i/!data", msg->topic);
+        assert_int_equal(i, msg->value.value.u32);
+        jsdrvp_msg_free(self->context, msg);
+    }
+    assert_int_equal(0, jsdrv_unsubscribe(self->context, DEVICE_PREFIX "/s/i/!data", dispatch_data_fn, self, 1000));
+    jsdrv_finalize(self->context, 1000);
+    assert_true(msg_queue_is_empty(self->sub_msgs));
+    msg_queue_finalize(self->sub_msgs);
+    memset(&self_, 0, sizeof(self_));
+}
+
+static volatile uint32_t queue_gate_;
+static volatile uint32_t queue_entered_;
+
+static void queue_data_fn(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    queue_entered_ = 1;
+    for (uint32_t i = 0; !queue_gate_ && (i < 2000); ++i) {
+        jsdrv_thread_sleep_ms(1);
+    }
+    dispatch_data_fn(user_data, topic, value);
+}
+
+static void queue_data_send(struct test_s * self, uint8_t value) {
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_data_sz(self->context, DEVICE_PREFIX "/s/i/!data", 16);
+    msg->payload.bin[0] = value;
+    msg->value = jsdrv_union_bin(msg->payload.bin, 16);
+    jsdrvp_backend_send(self->context, msg);
+}
+
+static void queue_policy_check(struct test_s * self, uint8_t policy, uint32_t depth,
+                               const uint8_t * expect, uint32_t expect_count) {
+    struct jsdrvp_msg_s * msg;
+    queue_gate_ = 0;
+    queue_entered_ = 0;
+    assert_int_equal(0, jsdrv_subscribe_queue(self->context, DEVICE_PREFIX "/s/i/!data", JSDRV_SFLAG_PUB,
+                                              queue_data_fn, self, depth, policy, 1000));
+    queue_data_send(self, 0);
+    for (uint32_t i = 0; !queue_entered_ && (i < 1000); ++i) {
+        jsdrv_thread_sleep_ms(1);
+    }
+    assert_true(queue_entered_);
+    for (uint8_t i = 1; i < 6; ++i) {
+        queue_data_send(self, i);
+    }
+    // round trip through the frontend thread after it submits all data
+    assert_int_equal(0, jsdrv_subscribe(self->context, "t/sync", JSDRV_SFLAG_PUB, dispatch_data_fn, self, 1000));
+    assert_int_equal(0, jsdrv_unsubscribe(self->context, "t/sync", dispatch_data_fn, self, 1000));
+    queue_gate_ = 1;
+    for (uint32_t i = 0; i < expect_count; ++i) {
+        assert_int_equal(0, msg_queue_pop(self->sub_msgs, &msg, SUB_TIMEOUT_MS));
+        assert_int_equal(expect[i], msg->value.value.u32);
+        jsdrvp_msg_free(self->context, msg);
+    }
+    assert_int_equal(0, jsdrv_unsubscribe(self->context, DEVICE_PREFIX "/s/i/!data", queue_data_fn, self, 1000));
+    jsdrv_thread_sleep_ms(10);
+    assert_true(msg_queue_is_empty(self->sub_msgs));
+}
+
+static void test_subscribe_queue(void ** state) {
+    struct jsdrv_arg_s args[] = {
+            {.topic=JSDRV_ARG_DISPATCH_THREADS, .value=jsdrv_union_u32(1)},
+            {.topic=""},
+    };
+    memset(&self_, 0, sizeof(self_));
+    struct test_s * self = &self_;
+    *state = self;
+    self->sub_msgs = msg_queue_init();
+
+    assert_int_equal(0, jsdrv_initialize(&self->context, NULL, 1000));
+    assert_int_equal(JSDRV_ERROR_NOT_SUPPORTED, jsdrv_subscribe_queue(self->context, "t/a", JSDRV_SFLAG_PUB,
+            queue_data_fn, self, 2, JSDRV_QUEUE_POLICY_DROP_OLDEST, 1000));
+    jsdrv_finalize(self->context, 1000);
+
+    assert_int_equal(0, jsdrv_initialize(&self->context, args, 1000));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_subscribe_queue(self->context, "t/a", JSDRV_SFLAG_PUB,
+            queue_data_fn, self, 0, JSDRV_QUEUE_POLICY_DROP_OLDEST, 1000));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_subscribe_queue(self->context, "t/a", JSDRV_SFLAG_PUB,
+            queue_data_fn, self, 2, 99, 1000));
+
+    const uint8_t drop_oldest[] = {0, 4, 5};
+    queue_policy_check(self, JSDRV_QUEUE_POLICY_DROP_OLDEST, 2, drop_oldest, sizeof(drop_oldest));
+    const uint8_t drop_newest[] = {0, 1, 2};
+    queue_policy_check(self, JSDRV_QUEUE_POLICY_DROP_NEWEST, 2, drop_newest, sizeof(drop_newest));
+    const uint8_t coalesce[] = {0, 5};
+    queue_policy_check(self, JSDRV_QUEUE_POLICY_COALESCE, 0, coalesce, sizeof(coalesce));
+
+    jsdrv_finalize(self->context, 1000);
+    msg_queue_finalize(self->sub_msgs);
+    memset(&self_, 0, sizeof(self_));
+}
+
+static void test_usb_stream_batch(void ** state) {
+    SETUP();
+    uint8_t buf[3][4] = {{1}, {2}, {3}};
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(self->context);
+    jsdrv_cstr_copy(m->topic, JSDRV_USBBK_MSG_STREAM_IN_DATA, sizeof(m->topic));
+    m->value = jsdrv_union_bin(buf[0], sizeof(buf[0]));
+    assert_int_equal(1, jsdrvp_usb_stream_seal(m));  // not batched
+    jsdrvp_usb_stream_select(m, 0);
+    assert_ptr_equal(buf[0], m->value.value.bin);
+
+    m->extra.bkusb_stream.batch = 1;
+    for (uint32_t i = 0; i < 3; ++i) {
+        m->payload.usb_stream.entries[i].buffer = buf[i];
+        m->payload.usb_stream.entries[i].size = sizeof(buf[i]);
+    }
+    m->payload.usb_stream.state = 3;
+    assert_int_equal(3, jsdrvp_usb_stream_seal(m));
+    assert_int_equal(3 | JSDRVP_USB_STREAM_BATCH_SEALED, m->payload.usb_stream.state);
+    assert_int_equal(3, jsdrvp_usb_stream_seal(m));  // idempotent
+    for (uint32_t i = 0; i < 3; ++i) {
+        jsdrvp_usb_stream_select(m, i);
+        assert_ptr_equal(buf[i], m->value.value.bin);
+        assert_int_equal(sizeof(buf[i]), m->value.size);
+    }
+    jsdrvp_msg_free(self->context, m);
+    TEARDOWN();
+}
+
+static void net_recv(int sock, void * buf, size_t size) {
+    uint8_t * p = (uint8_t *) buf;
+    while (size) {
+        int n = (int) recv(sock, (char *) p, (int) size, 0);
+        assert_true(n > 0);
+        p += n;
+        size -= n;
+    }
+}
+
+static void test_net_server(void ** state) {
+    SETUP();
+    struct jsdrv_net_server_s * server = NULL;
+    struct jsdrv_net_frame_header_s hdr;
+    char topic[64];
+    assert_int_equal(0, jsdrv_publish(self->context, "t/net", &jsdrv_union_u32_r(42), 0));
+    assert_int_equal(0, jsdrv_net_server_open(self->context, "127.0.0.1", 0, 0, &server));
+    assert_int_not_equal(0, jsdrv_net_server_port(server));
+
+    int sock = (int) socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(jsdrv_net_server_port(server));
+    assert_int_equal(0, connect(sock, (struct sockaddr *) &addr, sizeof(addr)));
+    assert_int_equal(7, send(sock, "+t/net\n", 7, 0));
+
+    net_recv(sock, &hdr, sizeof(hdr));
+    assert_int_equal(sizeof(hdr) + 8, hdr.length);
+    assert_int_equal(JSDRV_UNION_U32, hdr.type);
+    assert_int_equal(0, hdr.size);
+    assert_int_equal(6, hdr.topic_length);
+    assert_int_equal(42, hdr.value);
+    net_recv(sock, topic, 8);
+    assert_string_equal("t/net", topic);
+
+    assert_int_equal(0, jsdrv_publish(self->context, "t/net", &jsdrv_union_str("hello"), 0));
+    net_recv(sock, &hdr, sizeof(hdr));
+    assert_int_equal(sizeof(hdr) + 16, hdr.length);
+    assert_int_equal(JSDRV_UNION_STR, hdr.type);
+    assert_int_equal(6, hdr.size);
+    net_recv(sock, topic, 16);
+    assert_string_equal("t/net", topic);
+    assert_string_equal("hello", topic + 8);
+
+    close(sock);
+    jsdrv_net_server_close(server);
+    TEARDOWN();
+}
+
+static void test_thread_args(void ** state) {
+    struct jsdrv_arg_s args[] = {
+            {.topic="@/thread/frontend/affinity", .value=jsdrv_union_u64(1)},
+            {.topic="@/thread/buffer/priority", .value=jsdrv_union_i32(0)},
+            {.topic="@/thread/unknown/priority", .value=jsdrv_union_i32(0)},
+            {.topic=JSDRV_ARG_USB_DEVICE_THREADS, .value=jsdrv_union_u32(1)},
+            {.topic=""},
+    };
+    struct jsdrv_arg_s args_invalid[] = {
+            {.topic="@/thread/device/priority", .value=jsdrv_union_str("high")},
+            {.topic=""},
+    };
+    memset(&self_, 0, sizeof(self_));
+    struct test_s * self = &self_;
+    *state = self;
+    assert_int_equal(0, jsdrv_initialize(&self->context, args, 1000));
+    assert_int_equal(JSDRV_UNION_U32, self->backend_arg.type);
+    assert_int_equal(1, self->backend_arg.value.u32);
+    jsdrv_finalize(self->context, 1000);
+    self->context = NULL;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_initialize(&self->context, args_invalid, 1000));
+    assert_null(self->context);
+    memset(&self_, 0, sizeof(self_));
+}
+
 #if 0
 static void test_device_open(void ** state) {
     SETUP();
@@ -562,6 +1437,28 @@ int main(void) {
     //setvbuf(stdout, NULL, _IONBF, 0);
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_discovery),
+            cmocka_unit_test(test_msg_alloc_data_sz),
+            cmocka_unit_test(test_retain_release),
+            cmocka_unit_test(test_msg_value_shared),
+            cmocka_unit_test(test_pool_stats),
+            cmocka_unit_test(test_stats_threads),
+            cmocka_unit_test(test_cpu_isa),
+            cmocka_unit_test(test_publish_batch),
+            cmocka_unit_test(test_publish_batch_wait_error),
+            cmocka_unit_test(test_open_many),
+            cmocka_unit_test(test_profile_apply),
+            cmocka_unit_test(test_publish_async),
+            cmocka_unit_test(test_query),
+            cmocka_unit_test(test_group),
+            cmocka_unit_test(test_interval),
+            cmocka_unit_test(test_stream_reader),
+            cmocka_unit_test(test_backend_lanes),
+            cmocka_unit_test(test_init_lazy),
+            cmocka_unit_test(test_dispatch_threads),
+            cmocka_unit_test(test_subscribe_queue),
+            cmocka_unit_test(test_usb_stream_batch),
+            cmocka_unit_test(test_net_server),
+            cmocka_unit_test(test_thread_args),
             //cmocka_unit_test(test_device_open),
             //cmocka_unit_test(test_stream_raw_0),
             //cmocka_unit_test(test_timeout),
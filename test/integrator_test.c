@@ -0,0 +1,282 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <math.h>
+#include <stdlib.h>
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/integrator.h"
+
+
+#define FS (2000000U)
+#define DECIMATE (2U)
+
+
+static struct jsdrv_stream_signal_s * signal_;
+
+static int setup(void ** state) {
+    (void) state;
+    signal_ = calloc(1, sizeof(*signal_));
+    return 0;
+}
+
+static int teardown(void ** state) {
+    (void) state;
+    free(signal_);
+    return 0;
+}
+
+// Add count samples of value, sample_id increments by DECIMATE.
+static void add(struct jsdrv_integrator_s * g, uint8_t signal, uint64_t sample_id, uint32_t count, float value) {
+    signal_->sample_id = sample_id;
+    signal_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    signal_->element_size_bits = 32;
+    signal_->element_count = count;
+    signal_->sample_rate = FS;
+    signal_->decimate_factor = DECIMATE;
+    signal_->time_map.counter_rate = FS;
+    float * data = (float *) signal_->data;
+    for (uint32_t i = 0; i < count; ++i) {
+        data[i] = value;
+    }
+    assert_int_equal(0, jsdrv_integrator_add(g, signal, signal_));
+}
+
+static void add_both(struct jsdrv_integrator_s * g, uint64_t sample_id, uint32_t count, float i, float p) {
+    add(g, JSDRV_INTEGRATOR_CURRENT, sample_id, count, i);
+    add(g, JSDRV_INTEGRATOR_POWER, sample_id, count, p);
+}
+
+static int64_t i128_to_i64(const uint64_t * x) {
+    assert_true(((int64_t) x[1] == 0) || ((int64_t) x[1] == -1));
+    return (int64_t) x[0];
+}
+
+static void test_basic(void ** state) {
+    (void) state;
+    struct jsdrv_interval_s r;
+    struct jsdrv_integrator_s * g = jsdrv_integrator_new();
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_integrator_next(g, &r));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 1000, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 1100, true));   // ignored, already open
+    add_both(g, 0, 1000, 0.5f, 1.5f);                              // 0 to 2000
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_integrator_next(g, &r));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 3000, false));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 3100, false));  // ignored, not open
+    add(g, JSDRV_INTEGRATOR_CURRENT, 2000, 1000, 0.25f);           // 2000 to 4000
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_integrator_next(g, &r));  // power pending
+    add(g, JSDRV_INTEGRATOR_POWER, 2000, 1000, 2.0f);
+    assert_int_equal(0, jsdrv_integrator_next(g, &r));
+
+    assert_int_equal(0, r.interval_id);
+    assert_int_equal(1000, r.sample_id);
+    assert_int_equal(3000, r.sample_id_end);
+    assert_int_equal(FS, r.sample_rate);
+    assert_int_equal(DECIMATE, r.decimate_factor);
+    assert_int_equal(0, r.flags);
+    assert_int_equal(1000, r.i_count);
+    assert_int_equal(1000, r.p_count);
+    assert_float_equal(0.375, r.i_avg, 1e-12);
+    assert_float_equal(0.25, r.i_min, 0.0);
+    assert_float_equal(0.5, r.i_max, 0.0);
+    assert_float_equal(1.75, r.p_avg, 1e-12);
+    assert_float_equal(2.0, r.p_max, 0.0);
+    // 500 samples at 0.5 A and 500 at 0.25 A, 1 MHz
+    assert_float_equal(375e-6, r.charge_f64, 1e-15);
+    assert_float_equal(1750e-6, r.energy_f64, 1e-15);
+    assert_int_equal((int64_t) (375e-6 * 2147483648.0), i128_to_i64(r.charge_i128));
+    assert_int_equal((int64_t) (1750e-6 * 2147483648.0), i128_to_i64(r.energy_i128));
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_integrator_next(g, &r));
+    jsdrv_integrator_free(g);
+}
+
+static void test_exact(void ** state) {
+    (void) state;
+    // The i128 result does not depend on the block boundaries.
+    struct jsdrv_interval_s r1;
+    struct jsdrv_interval_s r2;
+    struct jsdrv_integrator_s * g1 = jsdrv_integrator_new();
+    struct jsdrv_integrator_s * g2 = jsdrv_integrator_new();
+    assert_int_equal(0, jsdrv_integrator_marker(g1, 0, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g1, 32000, false));
+    assert_int_equal(0, jsdrv_integrator_marker(g2, 0, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g2, 32000, false));
+    add_both(g1, 0, 16000, 0.1f, -0.3f);
+    for (uint32_t k = 0; k < 16000; k += 777) {
+        uint32_t n = ((16000 - k) < 777) ? (16000 - k) : 777;
+        add_both(g2, k * DECIMATE, n, 0.1f, -0.3f);
+    }
+    assert_int_equal(0, jsdrv_integrator_next(g1, &r1));
+    assert_int_equal(0, jsdrv_integrator_next(g2, &r2));
+    assert_memory_equal(r1.charge_i128, r2.charge_i128, sizeof(r1.charge_i128));
+    assert_memory_equal(r1.energy_i128, r2.energy_i128, sizeof(r1.energy_i128));
+    assert_true(i128_to_i64(r1.energy_i128) < 0);
+    assert_float_equal(0.0016, r1.charge_f64, 1e-9);
+    jsdrv_integrator_free(g1);
+    jsdrv_integrator_free(g2);
+}
+
+static void test_partial(void ** state) {
+    (void) state;
+    struct jsdrv_interval_s r;
+    struct jsdrv_integrator_s * g = jsdrv_integrator_new();
+    add_both(g, 0, 100, 1.0f, 1.0f);
+    assert_int_equal(200, jsdrv_integrator_position(g));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 100, true));     // late
+    assert_int_equal(0, jsdrv_integrator_marker(g, 300, false));
+    add_both(g, 200, 100, 1.0f, 1.0f);
+    assert_int_equal(0, jsdrv_integrator_next(g, &r));
+    assert_int_equal(JSDRV_INTERVAL_FLAG_PARTIAL, r.flags);
+    assert_int_equal(50, r.i_count);
+
+    // NaN samples do not contribute
+    assert_int_equal(0, jsdrv_integrator_marker(g, 400, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 500, false));
+    add_both(g, 400, 50, NAN, 2.0f);
+    assert_int_equal(0, jsdrv_integrator_next(g, &r));
+    assert_int_equal(1, r.interval_id);
+    assert_int_equal(JSDRV_INTERVAL_FLAG_PARTIAL, r.flags);
+    assert_int_equal(0, r.i_count);
+    assert_true(isnan(r.i_avg));
+    assert_int_equal(50, r.p_count);
+    jsdrv_integrator_free(g);
+}
+
+static void test_multiple_and_sequence(void ** state) {
+    (void) state;
+    struct jsdrv_interval_s r;
+    struct jsdrv_integrator_s * g = jsdrv_integrator_new();
+    for (uint32_t k = 0; k < 4; ++k) {
+        assert_int_equal(0, jsdrv_integrator_marker(g, k * 100, true));
+        assert_int_equal(0, jsdrv_integrator_marker(g, k * 100 + 10 * (k + 1), false));
+    }
+    assert_int_equal(0, jsdrv_integrator_marker(g, 500, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 500, false));    // empty, dropped
+    assert_int_equal(JSDRV_ERROR_SEQUENCE, jsdrv_integrator_marker(g, 400, true));
+    add_both(g, 0, 300, 1.0f, 3.0f);
+    for (uint32_t k = 0; k < 4; ++k) {
+        assert_int_equal(0, jsdrv_integrator_next(g, &r));
+        assert_int_equal(k, r.interval_id);
+        assert_int_equal(5 * (k + 1), r.i_count);
+        assert_float_equal(3.0, r.p_avg, 0.0);
+    }
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_integrator_next(g, &r));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 600, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 610, false));
+    add_both(g, 600, 5, 1.0f, 3.0f);
+    assert_int_equal(0, jsdrv_integrator_next(g, &r));
+    assert_int_equal(4, r.interval_id);
+
+    for (uint32_t k = 0; k < JSDRV_INTEGRATOR_PENDING_MAX; ++k) {
+        assert_int_equal(0, jsdrv_integrator_marker(g, 1000 + k * 10, true));
+        assert_int_equal(0, jsdrv_integrator_marker(g, 1005 + k * 10, false));
+    }
+    assert_int_equal(JSDRV_ERROR_FULL, jsdrv_integrator_marker(g, 2000, true));
+    jsdrv_integrator_clear(g);
+    assert_int_equal(0, jsdrv_integrator_position(g));
+    assert_int_equal(0, jsdrv_integrator_marker(g, 0, true));
+    jsdrv_integrator_free(g);
+}
+
+// Add a deadband hold record of count samples, sample_id increments by DECIMATE.
+static void add_hold(struct jsdrv_integrator_s * g, uint8_t signal, uint64_t sample_id, uint64_t count,
+                     float mean, float v_min, float v_max) {
+    signal_->sample_id = sample_id;
+    signal_->element_type = JSDRV_DATA_TYPE_HOLD;
+    signal_->element_size_bits = sizeof(struct jsdrv_stream_hold_s) * 8;
+    signal_->element_count = 1;
+    signal_->sample_rate = FS;
+    signal_->decimate_factor = DECIMATE;
+    signal_->time_map.counter_rate = FS;
+    struct jsdrv_stream_hold_s * hold = (struct jsdrv_stream_hold_s *) signal_->data;
+    hold->sample_count = count;
+    hold->min = v_min;
+    hold->max = v_max;
+    hold->mean = mean;
+    assert_int_equal(0, jsdrv_integrator_add(g, signal, signal_));
+}
+
+static void test_hold(void ** state) {
+    (void) state;
+    // A hold contributes exactly the same as its expanded mean samples.
+    struct jsdrv_interval_s r1;
+    struct jsdrv_interval_s r2;
+    struct jsdrv_integrator_s * g1 = jsdrv_integrator_new();
+    struct jsdrv_integrator_s * g2 = jsdrv_integrator_new();
+    assert_int_equal(0, jsdrv_integrator_marker(g1, 1001, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g1, 9001, false));
+    assert_int_equal(0, jsdrv_integrator_marker(g2, 1001, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g2, 9001, false));
+    add_both(g1, 0, 3000, 0.1f, -0.3f);
+    add_both(g1, 6000, 3000, 0.2f, 0.6f);
+    add_hold(g2, JSDRV_INTEGRATOR_CURRENT, 0, 3000, 0.1f, 0.1f, 0.1f);
+    add_hold(g2, JSDRV_INTEGRATOR_POWER, 0, 3000, -0.3f, -0.3f, -0.3f);
+    add_hold(g2, JSDRV_INTEGRATOR_CURRENT, 6000, 3000, 0.2f, 0.2f, 0.2f);
+    add_hold(g2, JSDRV_INTEGRATOR_POWER, 6000, 3000, 0.6f, 0.6f, 0.6f);
+    assert_int_equal(12000, jsdrv_integrator_position(g2));
+    assert_int_equal(0, jsdrv_integrator_next(g1, &r1));
+    assert_int_equal(0, jsdrv_integrator_next(g2, &r2));
+    assert_int_equal(4000, r2.i_count);
+    assert_int_equal(r1.i_count, r2.i_count);
+    assert_int_equal(r1.p_count, r2.p_count);
+    assert_memory_equal(r1.charge_i128, r2.charge_i128, sizeof(r1.charge_i128));
+    assert_memory_equal(r1.energy_i128, r2.energy_i128, sizeof(r1.energy_i128));
+    assert_float_equal(r1.i_avg, r2.i_avg, 0.0);
+    assert_float_equal(r1.p_min, r2.p_min, 0.0);
+    assert_float_equal(r1.p_max, r2.p_max, 0.0);
+
+    // min and max come from the hold, not its mean
+    assert_int_equal(0, jsdrv_integrator_marker(g2, 20000, true));
+    assert_int_equal(0, jsdrv_integrator_marker(g2, 22000, false));
+    add_hold(g2, JSDRV_INTEGRATOR_CURRENT, 20000, 1000, 1.0f, 0.9f, 1.1f);
+    add_hold(g2, JSDRV_INTEGRATOR_POWER, 20000, 1000, NAN, NAN, NAN);
+    assert_int_equal(0, jsdrv_integrator_next(g2, &r2));
+    assert_int_equal(1000, r2.i_count);
+    assert_float_equal(1.0, r2.i_avg, 1e-12);
+    assert_float_equal(0.9, r2.i_min, 1e-6);
+    assert_float_equal(1.1, r2.i_max, 1e-6);
+    assert_int_equal(0, r2.p_count);
+    jsdrv_integrator_free(g1);
+    jsdrv_integrator_free(g2);
+}
+
+static void test_invalid(void ** state) {
+    (void) state;
+    struct jsdrv_integrator_s * g = jsdrv_integrator_new();
+    signal_->element_type = JSDRV_DATA_TYPE_UINT;
+    signal_->element_size_bits = 1;
+    assert_int_equal(JSDRV_ERROR_NOT_SUPPORTED, jsdrv_integrator_add(g, JSDRV_INTEGRATOR_CURRENT, signal_));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_integrator_add(g, 2, signal_));
+    jsdrv_integrator_free(g);
+    jsdrv_integrator_free(NULL);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_basic),
+            cmocka_unit_test(test_exact),
+            cmocka_unit_test(test_partial),
+            cmocka_unit_test(test_multiple_and_sequence),
+            cmocka_unit_test(test_hold),
+            cmocka_unit_test(test_invalid),
+    };
+
+    return cmocka_run_group_tests(tests, setup, teardown);
+}
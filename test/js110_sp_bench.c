@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Compare the JS110 sample processor calibration throughput.
+ *
+ * Usage: js110_sp_bench [frames]
+ */
+
+#include "jsdrv_prv/js110_sample_processor.h"
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv/time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+#define SAMPLES_PER_FRAME (126U)
+#define FRAMES_DEFAULT (100000U)
+
+
+static uint32_t raw_sample(uint32_t k, uint32_t * lfsr) {
+    *lfsr = (*lfsr * 1664525U) + 1013904223U;
+    uint32_t i_range = (k / 10000U) % 7U;  // occasional range switches
+    uint32_t current = (*lfsr >> 8) & 0x3fff;
+    uint32_t voltage = 8000U + ((*lfsr >> 24) & 0x3f);
+    return (current << 2) | (voltage << 18) | (i_range & 3) | ((i_range & 4) << (16 - 2)) | ((k & 1) ? 0x20000 : 0);
+}
+
+static void run(const char * name, struct js110_sp_s * s, const uint32_t * raw, uint32_t frames) {
+    float i[SAMPLES_PER_FRAME];
+    float v[SAMPLES_PER_FRAME];
+    float p[SAMPLES_PER_FRAME];
+    uint8_t current_range[SAMPLES_PER_FRAME];
+    uint8_t gpi0[SAMPLES_PER_FRAME];
+    uint8_t gpi1[SAMPLES_PER_FRAME];
+    float sum = 0.0f;
+
+    js110_sp_reset(s);
+    int64_t t_start = jsdrv_time_utc();
+    for (uint32_t frame = 0; frame < frames; ++frame) {
+        js110_sp_process_block(s, raw + frame * SAMPLES_PER_FRAME, SAMPLES_PER_FRAME, 0,
+                               i, v, p, current_range, gpi0, gpi1);
+        if (!isnan(i[0])) {
+            sum += i[0];
+        }
+    }
+    double duration = JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start);
+    double samples = (double) frames * SAMPLES_PER_FRAME;
+    printf("%-8s %8.1f Msamples/s  (%.3f s, %g)\n", name, samples / duration * 1e-6, duration, (double) sum);
+}
+
+int main(int argc, char * argv[]) {
+    uint32_t frames = FRAMES_DEFAULT;
+    if (argc > 1) {
+        frames = (uint32_t) strtoul(argv[1], NULL, 0);
+    }
+    uint32_t * raw = jsdrv_alloc(frames * SAMPLES_PER_FRAME * sizeof(uint32_t));
+    uint32_t lfsr = 1;
+    for (uint32_t k = 0; k < frames * SAMPLES_PER_FRAME; ++k) {
+        raw[k] = raw_sample(k, &lfsr);
+    }
+
+    struct js110_sp_s * s = jsdrv_alloc_clr(sizeof(struct js110_sp_s));
+    js110_sp_initialize(s);
+    for (int r = 0; r < 9; ++r) {
+        s->cal[0][0][r] = -100.0 + r;
+        s->cal[0][1][r] = 1e-3 / (1 << r);
+    }
+    for (int r = 0; r < 2; ++r) {
+        s->cal[1][0][r] = -50.0;
+        s->cal[1][1][r] = 1e-3 * (r + 1);
+    }
+    js110_sp_cal_update(s);
+    js110_sp_suppress_lazy(s, 1);  // pass through between range switches to isolate calibration
+
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    const int32_t isas[] = {JSDRV_F32_OPS_ISA_SCALAR, JSDRV_F32_OPS_ISA_AVX2, JSDRV_F32_OPS_ISA_NEON};
+    const char * isa_names[] = {"scalar", "avx2", "neon"};
+    for (size_t idx = 0; idx < (sizeof(isas) / sizeof(isas[0])); ++idx) {
+        if (0 == jsdrv_f32_ops_isa_set(isas[idx])) {
+            run(isa_names[idx], s, raw, frames);
+        }
+    }
+    jsdrv_f32_ops_isa_set(isa_default);
+    if (0 == js110_sp_cal_lut(s, 1)) {
+        run("lut", s, raw, frames);
+    }
+
+    js110_sp_finalize(s);
+    jsdrv_free(s);
+    jsdrv_free(raw);
+    return 0;
+}
@@ -22,6 +22,7 @@
 #include <math.h>
 #include "jsdrv_prv/cdef.h"
 #include "jsdrv_prv/js110_sample_processor.h"
+#include "jsdrv_prv/f32_ops.h"
 #include <stdio.h>
 
 
@@ -36,7 +37,8 @@
     for (int i = 0; i < 2; ++i) {           \
         s.cal[1][0][i] = (i + 1) * -100.0;  \
         s.cal[1][1][i] = pow(10, -4 - i);   \
-    }
+    }                                       \
+    js110_sp_cal_update(&s);
 
 
 typedef void (*generate_cbk)(void * user_data, size_t i, struct js110_sample_s sample);
@@ -201,6 +203,277 @@ static void test_interp_1_3_1(void ** state) {
     generate(&s, 0, 3, expect_interp, &m);
 }
 
+static uint32_t raw_sample(size_t k) {
+    if (k == 300) {
+        return 0xffffffffLU;  // missing
+    }
+    uint8_t i_range = (uint8_t) ((k / 100) % 7);
+    uint32_t current = (uint32_t) (2000 + (k * 7) % 5000);
+    uint32_t voltage = (uint32_t) (3000 + (k * 13) % 4000);
+    return ((current & 0x3fff) << 2)
+            | ((voltage & 0x3fff) << 18)
+            | (i_range & 3)
+            | ((i_range & 4) << (16 - 2))
+            | ((k & 1) ? 0x20000 : 0);
+}
+
+static void assert_sample_f32_equal(float expect, float actual) {
+    if (isnan(expect)) {
+        assert_true(isnan(actual));
+    } else {
+        assert_float_equal(expect, actual, fabs(expect) * 1e-6);  // block uses single precision
+    }
+}
+
+static void test_block_matches_scalar(void ** state) {
+    uint32_t raw[126];
+    float i[126];
+    float v[126];
+    float p[126];
+    uint8_t current_range[126];
+    uint8_t gpi0[126];
+    uint8_t gpi1[126];
+    SETUP()
+    for (uint8_t mode = JS110_SUPPRESS_MODE_OFF; mode <= JS110_SUPPRESS_MODE_NAN; ++mode) {
+        struct js110_sp_s b = s;
+        js110_sp_reset(&s);
+        js110_sp_reset(&b);
+        s._suppress_mode = mode;
+        b._suppress_mode = mode;
+        for (size_t block = 0; block < 8; ++block) {
+            for (size_t k = 0; k < 126; ++k) {
+                raw[k] = raw_sample(block * 126 + k);
+            }
+            js110_sp_process_block(&b, raw, 126, 1, i, v, p, current_range, gpi0, gpi1);
+            for (size_t k = 0; k < 126; ++k) {
+                struct js110_sample_s z = js110_sp_process(&s, raw[k], 1);
+                assert_sample_f32_equal(z.i, i[k]);
+                assert_sample_f32_equal(z.v, v[k]);
+                assert_sample_f32_equal(z.p, p[k]);
+                assert_int_equal(z.current_range, current_range[k]);
+                assert_int_equal(z.gpi0, gpi0[k]);
+                assert_int_equal(z.gpi1, gpi1[k]);
+            }
+        }
+        assert_int_equal(s.sample_count, b.sample_count);
+        assert_int_equal(s.sample_missing_count, b.sample_missing_count);
+        assert_int_equal(s.skip_count, b.skip_count);
+        assert_int_equal(s.contiguous_count, b.contiguous_count);
+    }
+}
+
+static void test_block_lut(void ** state) {
+    uint32_t raw[126];
+    float i[126];
+    float v[126];
+    float p[126];
+    uint8_t current_range[126];
+    uint8_t gpi0[126];
+    uint8_t gpi1[126];
+    SETUP()
+    s._suppress_mode = JS110_SUPPRESS_MODE_OFF;
+    struct js110_sp_s b = s;
+    assert_int_equal(0, js110_sp_cal_lut(&b, 1));
+    s.cal[0][0][2] += 10.0;  // cal_update refreshes the table
+    b.cal[0][0][2] += 10.0;
+    js110_sp_cal_update(&s);
+    js110_sp_cal_update(&b);
+    for (uint8_t v_range = 0; v_range < 2; ++v_range) {
+        for (size_t block = 0; block < 8; ++block) {
+            for (size_t k = 0; k < 126; ++k) {
+                raw[k] = raw_sample(block * 126 + k);
+            }
+            js110_sp_process_block(&b, raw, 126, v_range, i, v, p, current_range, gpi0, gpi1);
+            for (size_t k = 0; k < 126; ++k) {
+                struct js110_sample_s z = js110_sp_process(&s, raw[k], v_range);
+                if (isnan(z.i)) {
+                    assert_true(isnan(i[k]));
+                    continue;
+                }
+                assert_memory_equal(&z.i, &i[k], sizeof(float));  // both calibrate in double precision
+                assert_memory_equal(&z.v, &v[k], sizeof(float));
+                assert_sample_f32_equal(z.p, p[k]);
+                assert_int_equal(z.current_range, current_range[k]);
+            }
+        }
+    }
+    js110_sp_finalize(&b);
+    assert_null(b._lut);
+}
+
+static void process_blocks(const struct js110_sp_s * s_init, int32_t isa, float * i, float * v, float * p) {
+    struct js110_sp_s s = *s_init;
+    uint32_t raw[126];
+    uint8_t current_range[126];
+    uint8_t gpi0[126];
+    uint8_t gpi1[126];
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa));
+    for (size_t block = 0; block < 8; ++block) {
+        for (size_t k = 0; k < 126; ++k) {
+            raw[k] = raw_sample(block * 126 + k);
+        }
+        js110_sp_process_block(&s, raw, 126, 0, i + block * 126, v + block * 126, p + block * 126,
+                               current_range, gpi0, gpi1);
+    }
+}
+
+static void test_block_isa(void ** state) {
+    float i_expect[8 * 126];
+    float v_expect[8 * 126];
+    float p_expect[8 * 126];
+    float i[8 * 126];
+    float v[8 * 126];
+    float p[8 * 126];
+    SETUP()
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    process_blocks(&s, JSDRV_F32_OPS_ISA_SCALAR, i_expect, v_expect, p_expect);
+    const int32_t isas[] = {JSDRV_F32_OPS_ISA_SSE2, JSDRV_F32_OPS_ISA_AVX2, JSDRV_F32_OPS_ISA_NEON};
+    for (size_t idx = 0; idx < (sizeof(isas) / sizeof(isas[0])); ++idx) {
+        if (jsdrv_f32_ops_isa_set(isas[idx])) {
+            continue;  // not supported by this CPU
+        }
+        process_blocks(&s, isas[idx], i, v, p);
+        assert_memory_equal(i_expect, i, sizeof(i));
+        assert_memory_equal(v_expect, v, sizeof(v));
+        assert_memory_equal(p_expect, p, sizeof(p));
+    }
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa_default));
+}
+
+#define LAZY_N (1000U)
+#define LAZY_BLOCK (200U)
+
+struct lazy_out_s {
+    float i[LAZY_N];
+    float v[LAZY_N];
+    float p[LAZY_N];
+    uint8_t current_range[LAZY_N];
+};
+
+static void lazy_run(const struct js110_sp_s * s_init, uint8_t lazy, uint8_t mode, struct lazy_out_s * out) {
+    struct js110_sp_s s = *s_init;
+    uint32_t raw[LAZY_BLOCK];
+    uint8_t gpi0[LAZY_BLOCK];
+    uint8_t gpi1[LAZY_BLOCK];
+    s._suppress_mode = mode;
+    js110_sp_suppress_lazy(&s, lazy);
+    for (size_t block = 0; block < (LAZY_N / LAZY_BLOCK); ++block) {
+        size_t offset = block * LAZY_BLOCK;
+        for (size_t k = 0; k < LAZY_BLOCK; ++k) {
+            raw[k] = raw_sample(offset + k);
+        }
+        js110_sp_process_block(&s, raw, LAZY_BLOCK, 0, out->i + offset, out->v + offset, out->p + offset,
+                               out->current_range + offset, gpi0, gpi1);
+    }
+}
+
+static void test_lazy_off(void ** state) {
+    static struct lazy_out_s ring;
+    static struct lazy_out_s lazy;
+    const size_t shift = JS110_SUPPRESS_SAMPLES_MAX - 1 - JS110_SP_LAZY_DELAY;
+    SETUP()
+    lazy_run(&s, 0, JS110_SUPPRESS_MODE_OFF, &ring);
+    lazy_run(&s, 1, JS110_SUPPRESS_MODE_OFF, &lazy);
+    for (size_t k = 0; k < JS110_SP_LAZY_DELAY; ++k) {
+        assert_true(isnan(lazy.i[k]));
+        assert_int_equal(JS110_I_RANGE_MISSING, lazy.current_range[k]);
+    }
+    for (size_t k = JS110_SP_LAZY_DELAY; k < (LAZY_N - shift); ++k) {
+        assert_sample_f32_equal(ring.i[k + shift], lazy.i[k]);
+        assert_sample_f32_equal(ring.v[k + shift], lazy.v[k]);
+        assert_sample_f32_equal(ring.p[k + shift], lazy.p[k]);
+        assert_int_equal(ring.current_range[k + shift], lazy.current_range[k]);
+    }
+}
+
+static void test_lazy_nan(void ** state) {
+    static struct lazy_out_s ref;
+    static struct lazy_out_s lazy;
+    SETUP()
+    s._suppress_samples_window = 3;
+    s._suppress_matrix = NULL;
+    lazy_run(&s, 1, JS110_SUPPRESS_MODE_OFF, &ref);
+    lazy_run(&s, 1, JS110_SUPPRESS_MODE_NAN, &lazy);
+    for (size_t k = JS110_SP_LAZY_DELAY + 1; k < LAZY_N; ++k) {
+        size_t x = k - JS110_SP_LAZY_DELAY;  // the input sample index
+        // range switches every 100 samples, and sample 300 is missing
+        bool suppress = ((x % 100) < 3) || ((x >= 300) && (x < 304));
+        if (suppress) {
+            assert_true(isnan(lazy.i[k]));
+            assert_true(isnan(lazy.v[k]));
+            assert_true(isnan(lazy.p[k]));
+        } else {
+            assert_memory_equal(&ref.i[k], &lazy.i[k], sizeof(float));
+            assert_memory_equal(&ref.v[k], &lazy.v[k], sizeof(float));
+            assert_memory_equal(&ref.p[k], &lazy.p[k], sizeof(float));
+        }
+        assert_int_equal(ref.current_range[k], lazy.current_range[k]);
+    }
+}
+
+static void test_lazy_mean_interp(void ** state) {
+    static struct lazy_out_s ref;
+    static struct lazy_out_s lazy;
+    SETUP()
+    s._suppress_samples_pre = 2;
+    s._suppress_samples_window = 3;
+    s._suppress_samples_post = 2;
+    s._suppress_matrix = NULL;
+    lazy_run(&s, 1, JS110_SUPPRESS_MODE_OFF, &ref);
+    const size_t starts[] = {100, 200, 600, 700};  // straddle the 128 sample chunks
+    for (size_t idx = 0; idx < (sizeof(starts) / sizeof(starts[0])); ++idx) {
+        size_t t = starts[idx] + JS110_SP_LAZY_DELAY;
+        double pre = (ref.i[t - 1] + ref.i[t - 2]) / 2.0;
+        double post = (ref.i[t + 3] + ref.i[t + 4]) / 2.0;
+
+        lazy_run(&s, 1, JS110_SUPPRESS_MODE_MEAN, &lazy);
+        for (size_t k = t - 2; k < t + 5; ++k) {
+            float i_expect = ((k >= t) && (k < t + 3)) ? (float) ((pre + post) / 2.0) : ref.i[k];
+            assert_sample_f32_equal(i_expect, lazy.i[k]);
+            assert_memory_equal(&ref.v[k], &lazy.v[k], sizeof(float));
+            assert_float_equal(lazy.i[k] * lazy.v[k], lazy.p[k], fabs(lazy.p[k]) * 1e-6);
+        }
+
+        lazy_run(&s, 1, JS110_SUPPRESS_MODE_INTERP, &lazy);
+        for (size_t k = t - 2; k < t + 5; ++k) {
+            float i_expect = ref.i[k];
+            if ((k >= t) && (k < t + 3)) {
+                i_expect = (float) (pre + (post - pre) * (k - t + 1) / 4.0);
+            }
+            assert_sample_f32_equal(i_expect, lazy.i[k]);
+        }
+    }
+}
+
+static void test_skip_matches_missing(void ** state) {
+    SETUP()
+    struct js110_sp_s ref = s;
+    const uint32_t valid = (2000U << 2) | (3000U << 18) | 1U;
+    for (uint32_t k = 0; k < 100; ++k) {
+        js110_sp_process(&s, valid, 0);
+        js110_sp_process(&ref, valid, 0);
+    }
+    for (uint32_t k = 0; k < JS110_SUPPRESS_SAMPLES_MAX; ++k) {
+        js110_sp_process(&s, 0xffffffffLU, 0);
+    }
+    for (uint32_t k = 0; k < (JS110_SUPPRESS_SAMPLES_MAX + 1000); ++k) {
+        js110_sp_process(&ref, 0xffffffffLU, 0);
+    }
+    js110_sp_skip(&s, 1000);
+    assert_int_equal(ref.sample_count, s.sample_count);
+    assert_int_equal(ref.sample_missing_count, s.sample_missing_count);
+    assert_int_equal(ref.skip_count, s.skip_count);
+    assert_int_equal(1, s.skip_count);
+    assert_int_equal(0, s.contiguous_count);
+    for (uint32_t k = 0; k < 200; ++k) {
+        struct js110_sample_s x = js110_sp_process(&s, valid, 0);
+        struct js110_sample_s y = js110_sp_process(&ref, valid, 0);
+        assert_memory_equal(&y, &x, sizeof(x));
+    }
+    assert_int_equal(ref.contiguous_count, s.contiguous_count);
+}
+
+
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_off),
@@ -211,6 +484,13 @@ int main(void) {
             cmocka_unit_test(test_mean_2_3_1),
             cmocka_unit_test(test_mean_1_3_2),
             cmocka_unit_test(test_interp_1_3_1),
+            cmocka_unit_test(test_block_matches_scalar),
+            cmocka_unit_test(test_block_isa),
+            cmocka_unit_test(test_block_lut),
+            cmocka_unit_test(test_lazy_off),
+            cmocka_unit_test(test_lazy_nan),
+            cmocka_unit_test(test_lazy_mean_interp),
+            cmocka_unit_test(test_skip_matches_missing),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <math.h>
+#include "jsdrv_prv/js110_stats.h"
+#include "jsdrv_prv/f32_ops.h"
+
+
+#define N (6000U)
+#define BLOCK_SAMPLE_COUNT (1000U)
+#define FRAME (126U)
+
+static float i_[N];
+static float v_[N];
+static float p_[N];
+
+
+static void generate(float large) {
+    uint32_t lfsr = 0x12345678;
+    for (uint32_t k = 0; k < N; ++k) {
+        lfsr = lfsr * 1664525U + 1013904223U;
+        float r = ((float) (lfsr >> 8) / (float) (1U << 24)) - 0.5f;
+        i_[k] = r * 0.01f;
+        v_[k] = 3.3f + r * 0.1f;
+        p_[k] = i_[k] * v_[k];
+    }
+    i_[10] = NAN;
+    v_[1011] = NAN;
+    p_[2013] = NAN;
+    for (uint32_t k = 3000; k < 4000; ++k) {
+        i_[k] = fabsf(i_[k]);
+    }
+    i_[3002] = 0.0f;    // zero minimum, the later negative zero is in an earlier SIMD lane
+    i_[3009] = -0.0f;
+    i_[4100] = large;
+    i_[4101] = -large;
+}
+
+static void compare(int32_t isa) {
+    struct js110_stats_s expect;
+    struct js110_stats_s actual;
+    struct jsdrv_statistics_s expect_s[N / BLOCK_SAMPLE_COUNT];
+    uint32_t expect_count = 0;
+    uint32_t actual_count = 0;
+
+    js110_stats_initialize(&expect);
+    js110_stats_sample_count_set(&expect, BLOCK_SAMPLE_COUNT);
+    for (uint32_t k = 0; k < N; ++k) {
+        struct jsdrv_statistics_s * s = js110_stats_compute(&expect, i_[k], v_[k], p_[k]);
+        if (NULL != s) {
+            expect_s[expect_count++] = *s;
+        }
+    }
+    assert_int_equal(N / BLOCK_SAMPLE_COUNT, expect_count);
+
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa));
+    js110_stats_initialize(&actual);
+    js110_stats_sample_count_set(&actual, BLOCK_SAMPLE_COUNT);
+    for (uint32_t offset = 0; offset < N; offset += FRAME) {
+        uint32_t n = ((N - offset) < FRAME) ? (N - offset) : FRAME;
+        uint32_t k = 0;
+        while (k < n) {
+            struct jsdrv_statistics_s * s = NULL;
+            k += js110_stats_compute_block(&actual, i_ + offset + k, v_ + offset + k, p_ + offset + k, n - k, &s);
+            if (NULL != s) {
+                assert_memory_equal(&expect_s[actual_count++], s, sizeof(*s));
+            }
+        }
+    }
+    assert_int_equal(expect_count, actual_count);
+}
+
+static void compare_isas(float large) {
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    const int32_t isas[] = {JSDRV_F32_OPS_ISA_SCALAR, JSDRV_F32_OPS_ISA_SSE2,
+                            JSDRV_F32_OPS_ISA_AVX2, JSDRV_F32_OPS_ISA_NEON};
+    generate(large);
+    for (size_t idx = 0; idx < (sizeof(isas) / sizeof(isas[0])); ++idx) {
+        if (jsdrv_f32_ops_isa_set(isas[idx])) {
+            continue;  // not supported by this CPU
+        }
+        compare(isas[idx]);
+    }
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa_default));
+}
+
+static void test_block_matches_scalar(void ** state) {
+    (void) state;
+    compare_isas(0.5f);
+}
+
+static void test_block_large_values(void ** state) {
+    (void) state;
+    compare_isas(1e8f);  // beyond the SIMD limb range
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_block_matches_scalar),
+            cmocka_unit_test(test_block_large_values),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Measure the i128 accumulator throughput.
+ *
+ * Usage: js220_i128_bench [samples]
+ *
+ * The js220_i128_portable_bench target builds the same benchmark
+ * with JS220_I128_PORTABLE for comparison.
+ */
+
+#include "jsdrv_prv/js220_i128.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv/time.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define SAMPLES_DEFAULT (100000000U)
+#define BLOCK (1000U)
+
+
+#if defined(JS220_I128_PORTABLE)
+static const char IMPL[] = "portable";
+#elif JS220_I128_NATIVE
+static const char IMPL[] = "__int128";
+#elif JS220_I128_MSVC
+static const char IMPL[] = "msvc";
+#else
+static const char IMPL[] = "portable";
+#endif
+
+
+int main(int argc, char * argv[]) {
+    uint32_t n = SAMPLES_DEFAULT;
+    if (argc > 1) {
+        n = (uint32_t) strtoul(argv[1], NULL, 0);
+    }
+
+    // Accumulate like js110_stats update_accum() with a Q31 current.
+    int64_t x1 = 0;
+    js220_i128 x2 = js220_i128_init_i64(0);
+    uint32_t lfsr = 1;
+    int64_t t_start = jsdrv_time_utc();
+    for (uint32_t k = 0; k < n; ++k) {
+        lfsr = (lfsr * 1664525U) + 1013904223U;
+        int64_t x = (int64_t) (int32_t) lfsr;
+        x1 += x;
+        x2 = js220_i128_add(x2, js220_i128_square_i64(x));
+    }
+    double duration = JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start);
+    printf("%-8s accum    %8.1f Msamples/s  (%.3f s)\n", IMPL, n / duration * 1e-6, duration);
+
+    // Reduce like the statistics blocks.
+    uint32_t blocks = n / BLOCK;
+    double sum = 0.0;
+    t_start = jsdrv_time_utc();
+    for (uint32_t k = 0; k < blocks; ++k) {
+        sum += js220_i128_compute_std(x1 >> 8, x2, BLOCK + k, 31);
+        sum += js220_i128_to_f64(js220_i128_compute_integral(x2, BLOCK + k), 31);
+    }
+    duration = JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start);
+    printf("%-8s reduce   %8.1f Mblocks/s   (%.3f s, %g)\n", IMPL, blocks / duration * 1e-6, duration, sum);
+    return 0;
+}
@@ -59,6 +59,8 @@ static void test_square_i64(void ** state) {
     assert_i128_equal(((js220_i128) {.u64 = {1LLU<<62, 0}}), js220_i128_square_i64(1LLU<<31));
     assert_i128_equal(((js220_i128) {.i64 = {0, 1}}), js220_i128_square_i64(1LLU<<32));
     assert_i128_equal(((js220_i128) {.i64 = {0, 1}}), js220_i128_square_i64((int64_t) 0xffffffff00000000LLU));
+    assert_i128_equal(((js220_i128) {.u64 = {0, 1LLU << 62}}), js220_i128_square_i64(INT64_MIN));
+    assert_i128_equal(((js220_i128) {.u64 = {1, 0x3fffffffffffffffLLU}}), js220_i128_square_i64(INT64_MAX));
 }
 
 static void test_neg(void ** state) {
@@ -66,6 +68,8 @@ static void test_neg(void ** state) {
     assert_i128_equal(((js220_i128) {.i64 = {0, 0}}), js220_i128_neg((js220_i128) {.i64 = {0, 0}}));
     assert_i128_equal(((js220_i128) {.i64 = {1, 0}}), js220_i128_neg((js220_i128) {.i64 = {-1, -1}}));
     assert_i128_equal(((js220_i128) {.i64 = {-1, -1}}), js220_i128_neg((js220_i128) {.i64 = {1, 0}}));
+    assert_i128_equal(((js220_i128) {.u64 = {1LLU << 63, -1}}), js220_i128_neg((js220_i128) {.u64 = {1LLU << 63, 0}}));
+    assert_i128_equal(((js220_i128) {.u64 = {0, -1}}), js220_i128_neg((js220_i128) {.u64 = {0, 1}}));
 }
 
 static void test_udiv(void ** state) {
@@ -85,6 +89,16 @@ static void test_udiv(void ** state) {
     assert_i128_equal(((js220_i128) {.i64 = {1LL << 48, 0}}),
                       js220_i128_udiv((js220_i128) {.i64 = {3, 1}}, 1 << 16, &r));
     assert_int_equal(3, r);
+
+    assert_i128_equal(((js220_i128) {.u64 = {0xaaaaaaaaaaaaaaaaLLU, 1}}),
+                      js220_i128_udiv((js220_i128) {.u64 = {-1, 4}}, 3, &r));
+    assert_int_equal(1, r);
+    assert_i128_equal(((js220_i128) {.u64 = {0, 1}}),
+                      js220_i128_udiv((js220_i128) {.u64 = {5, 0xffffffffffffffffLLU}}, 0xffffffffffffffffLLU, &r));
+    assert_int_equal(5, r);
+    assert_i128_equal(((js220_i128) {.u64 = {0xffffffffffffffffLLU, 0}}),
+                      js220_i128_udiv((js220_i128) {.u64 = {3, 0xfffffffffffffffeLLU}}, 0xffffffffffffffffLLU, &r));
+    assert_int_equal(2, r);
 }
 
 
@@ -101,6 +115,11 @@ static void test_lshift(void ** state) {
     assert_i128_equal(((js220_i128) {.i64 = {0, -2}}), js220_i128_lshift((js220_i128) {.u64 = {0, -1}}, 1));
     assert_i128_equal(((js220_i128) {.i64 = {0, -1}}), js220_i128_lshift((js220_i128) {.u64 = {1LLU<<63, -1}}, 1));
     assert_i128_equal(((js220_i128) {.i64 = {-1, -1}}), js220_i128_lshift((js220_i128) {.u64 = {-1, -1}}, -1));
+
+    assert_i128_equal(((js220_i128) {.u64 = {0, 3}}), js220_i128_lshift((js220_i128) {.u64 = {3, 0}}, 64));
+    assert_i128_equal(((js220_i128) {.u64 = {0, 12}}), js220_i128_lshift((js220_i128) {.u64 = {3, 0}}, 66));
+    assert_i128_equal(((js220_i128) {.u64 = {3, 0}}), js220_i128_lshift((js220_i128) {.u64 = {0, 3}}, -64));
+    assert_i128_equal(((js220_i128) {.i64 = {-2, -1}}), js220_i128_lshift((js220_i128) {.i64 = {0, -8}}, -66));
 }
 
 static void test_rshift(void ** state) {
@@ -132,6 +151,8 @@ static void test_to_f64(void ** state) {
 
     assert_float_equal((double) (1LLU<<33), js220_i128_to_f64((js220_i128) {.u64 = {0, 1}}, 31), 0.0);
     assert_float_equal((double) (1LLU<<32), js220_i128_to_f64((js220_i128) {.u64 = {1LLU<<63, 0}}, 31), 0.0);
+    assert_float_equal(-1.5, js220_i128_to_f64((js220_i128) {.i64 = {-3, -1}}, 1), 0.0);
+    assert_float_equal(-(double) (1LLU<<33), js220_i128_to_f64((js220_i128) {.i64 = {0, -1}}, 31), 0.0);
 }
 
 static void test_is_neg(void ** state) {
@@ -0,0 +1,516 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Measure the throughput of the driver's hot-path kernels.
+ *
+ * Usage: jsdrv_bench [--json] [--repeat N] [--isa scalar|sse2|avx2|neon] [filter]
+ *
+ * Each benchmark runs once to warm up and then N times (default 5)
+ * over the same deterministic input.  The report contains the median
+ * and minimum ns per item along with the median Mitems/s, where items
+ * are samples except for the JSON parser (bytes) and pubsub (messages).
+ * The optional filter runs only the benchmarks whose name contains it.
+ * --json prints a single JSON object for CI regression tracking.
+ */
+
+#include "jsdrv.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+#include "jsdrv_prv/buffer_signal.h"
+#include "jsdrv_prv/downsample.h"
+#include "jsdrv_prv/f32_ops.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/js110_sample_processor.h"
+#include "jsdrv_prv/js110_stats.h"
+#include "jsdrv_prv/json.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/sample_buffer_f32.h"
+#include "jsdrv_prv/statistics.h"
+#include "jsdrv_prv/thread.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define SAMPLES (1U << 20)
+#define REPEAT_DEFAULT (5U)
+#define REPEAT_MAX (101U)
+#define JS110_BLOCK (126U)
+#define SBUF_BLOCK (500U)
+#define PUBSUB_MESSAGES (100000U)
+
+extern const struct jsdrvp_param_s js220_params[];
+
+struct bench_s {
+    const char * name;
+    const char * unit;
+    int32_t (*setup)(void);             // optional, 0 or skip
+    uint64_t (*run)(void);              // return the item count
+    void (*teardown)(void);             // optional
+};
+
+static float * x_ = NULL;
+static float * y_ = NULL;
+static float * v_ = NULL;
+static float * p_ = NULL;
+static uint32_t * raw_ = NULL;
+static volatile double sink_ = 0.0;     // prevent the compiler from removing work
+
+static struct js110_sp_s * sp_ = NULL;
+static struct js110_stats_s stats_;
+static struct sbuf_f32_s sbuf_[3];
+static struct bufsig_s bufsig_;
+static struct jsdrv_stream_signal_s * stream_ = NULL;
+static uint64_t * rsp_u64_ = NULL;
+static struct jsdrv_context_s * context_ = NULL;
+static volatile uint32_t pubsub_count_ = 0;
+
+
+static void data_initialize(void) {
+    uint32_t lfsr = 1;
+    x_ = jsdrv_alloc(SAMPLES * sizeof(float));
+    y_ = jsdrv_alloc(SAMPLES * sizeof(float));
+    v_ = jsdrv_alloc(SAMPLES * sizeof(float));
+    p_ = jsdrv_alloc(SAMPLES * sizeof(float));
+    raw_ = jsdrv_alloc(SAMPLES * sizeof(uint32_t));
+    for (uint32_t k = 0; k < SAMPLES; ++k) {
+        lfsr = (lfsr * 1664525U) + 1013904223U;
+        x_[k] = sinf(k * 0.001f) * 0.01f + 0.001f * (float) (k % 13);
+        v_[k] = 3.3f + 0.001f * (float) ((lfsr >> 16) & 0xff);
+        p_[k] = x_[k] * v_[k];
+        uint32_t i_range = (k / 10000U) % 7U;  // occasional range switches
+        uint32_t current = (lfsr >> 8) & 0x3fff;
+        uint32_t voltage = 8000U + ((lfsr >> 24) & 0x3f);
+        raw_[k] = (current << 2) | (voltage << 18) | (i_range & 3) | ((i_range & 4) << (16 - 2))
+                | ((k & 1) ? 0x20000 : 0);
+    }
+}
+
+static void data_finalize(void) {
+    jsdrv_free(x_);
+    jsdrv_free(y_);
+    jsdrv_free(v_);
+    jsdrv_free(p_);
+    jsdrv_free(raw_);
+}
+
+// --- downsample
+
+static uint64_t run_downsample_add_f32(void) {
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(2000000, 100000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32);
+    uint32_t n_out = 0;
+    for (uint32_t k = 0; k < SAMPLES; ++k) {
+        if (jsdrv_downsample_add_f32(d, k, x_[k], y_ + n_out)) {
+            ++n_out;
+        }
+    }
+    sink_ += n_out ? y_[n_out - 1] : 0.0;
+    jsdrv_downsample_free(d);
+    return SAMPLES;
+}
+
+static uint64_t run_downsample_add_f32_block(void) {
+    struct jsdrv_downsample_s * d = jsdrv_downsample_alloc(2000000, 100000, JSDRV_DOWNSAMPLE_MODE_FLAT_PASSBAND_F32);
+    uint32_t n_out = 0;
+    for (uint32_t k = 0; k < SAMPLES; k += 1000) {
+        uint32_t n = ((SAMPLES - k) < 1000) ? (SAMPLES - k) : 1000;
+        uint32_t count = 0;
+        jsdrv_downsample_add_f32_block(d, k, x_ + k, n, y_ + n_out, &count);
+        n_out += count;
+    }
+    sink_ += n_out ? y_[n_out - 1] : 0.0;
+    jsdrv_downsample_free(d);
+    return SAMPLES;
+}
+
+// --- JS110 sample processor
+
+static int32_t setup_js110_sp(void) {
+    sp_ = jsdrv_alloc_clr(sizeof(struct js110_sp_s));
+    js110_sp_initialize(sp_);
+    for (int r = 0; r < 9; ++r) {
+        sp_->cal[0][0][r] = -100.0 + r;
+        sp_->cal[0][1][r] = 1e-3 / (1 << r);
+    }
+    for (int r = 0; r < 2; ++r) {
+        sp_->cal[1][0][r] = -50.0;
+        sp_->cal[1][1][r] = 1e-3 * (r + 1);
+    }
+    js110_sp_cal_update(sp_);
+    return 0;
+}
+
+static void teardown_js110_sp(void) {
+    js110_sp_finalize(sp_);
+    jsdrv_free(sp_);
+    sp_ = NULL;
+}
+
+static uint64_t run_js110_sp_process(void) {
+    float sum = 0.0f;
+    js110_sp_reset(sp_);
+    for (uint32_t k = 0; k < SAMPLES; ++k) {
+        struct js110_sample_s s = js110_sp_process(sp_, raw_[k], 0);
+        if (!isnan(s.i)) {
+            sum += s.i;
+        }
+    }
+    sink_ += sum;
+    return SAMPLES;
+}
+
+static uint64_t run_js110_sp_process_block(void) {
+    float i[JS110_BLOCK];
+    float v[JS110_BLOCK];
+    float p[JS110_BLOCK];
+    uint8_t current_range[JS110_BLOCK];
+    uint8_t gpi0[JS110_BLOCK];
+    uint8_t gpi1[JS110_BLOCK];
+    uint64_t n = SAMPLES - (SAMPLES % JS110_BLOCK);
+    js110_sp_reset(sp_);
+    for (uint32_t k = 0; k < n; k += JS110_BLOCK) {
+        js110_sp_process_block(sp_, raw_ + k, JS110_BLOCK, 0,
+                               i, v, p, current_range, gpi0, gpi1);
+        sink_ += i[0];
+    }
+    return n;
+}
+
+// --- JS110 statistics
+
+static int32_t setup_js110_stats(void) {
+    js110_stats_initialize(&stats_);
+    js110_stats_sample_count_set(&stats_, 100000);
+    return 0;
+}
+
+static uint64_t run_js110_stats_compute(void) {
+    js110_stats_clear(&stats_);
+    for (uint32_t k = 0; k < SAMPLES; ++k) {
+        struct jsdrv_statistics_s * s = js110_stats_compute(&stats_, x_[k], v_[k], p_[k]);
+        if (s) {
+            sink_ += s->i_avg;
+        }
+    }
+    return SAMPLES;
+}
+
+static uint64_t run_js110_stats_compute_block(void) {
+    js110_stats_clear(&stats_);
+    uint32_t k = 0;
+    while (k < SAMPLES) {
+        struct jsdrv_statistics_s * s = NULL;
+        k += js110_stats_compute_block(&stats_, x_ + k, v_ + k, p_ + k, SAMPLES - k, &s);
+        if (s) {
+            sink_ += s->i_avg;
+        }
+    }
+    return SAMPLES;
+}
+
+// --- sample buffer
+
+static int32_t setup_sbuf(void) {
+    for (int i = 0; i < 3; ++i) {
+        sbuf_f32_clear(&sbuf_[i]);
+    }
+    return 0;
+}
+
+static uint64_t run_sbuf_f32_mult(void) {
+    uint64_t n = SAMPLES - (SAMPLES % SBUF_BLOCK);
+    for (uint32_t k = 0; k < n; k += SBUF_BLOCK) {
+        uint64_t sample_id = 2 * (uint64_t) k;  // default sample_id_decimate
+        sbuf_f32_add(&sbuf_[0], sample_id, x_ + k, SBUF_BLOCK);
+        sbuf_f32_add(&sbuf_[1], sample_id, v_ + k, SBUF_BLOCK);
+        sbuf_f32_mult(&sbuf_[2], &sbuf_[0], &sbuf_[1]);
+    }
+    sink_ += sbuf_[2].buffer[0];
+    setup_sbuf();
+    return n;
+}
+
+// --- statistics
+
+static uint64_t run_statistics_compute_f32(void) {
+    struct jsdrv_statistics_accum_s s;
+    jsdrv_statistics_reset(&s);
+    jsdrv_statistics_compute_f32(&s, x_, SAMPLES);
+    sink_ += s.mean;
+    return SAMPLES;
+}
+
+// --- buffer signal
+
+static int32_t setup_bufsig(void) {
+    memset(&bufsig_, 0, sizeof(bufsig_));
+    jsdrv_cstr_copy(bufsig_.topic, "u/js220/000000/s/i/!data", sizeof(bufsig_.topic));
+    bufsig_.hdr.field_id = JSDRV_FIELD_CURRENT;
+    bufsig_.hdr.element_type = JSDRV_DATA_TYPE_FLOAT;
+    bufsig_.hdr.element_size_bits = 32;
+    bufsig_.hdr.decimate_factor = 1;
+    bufsig_.hdr.sample_rate = 1000000;
+    bufsig_.time_map.counter_rate = (double) bufsig_.hdr.sample_rate;
+    bufsig_.active = true;
+    jsdrv_bufsig_alloc(&bufsig_, SAMPLES, 10, 10);
+    stream_ = jsdrv_alloc_clr(sizeof(struct jsdrv_stream_signal_s));
+    stream_->field_id = JSDRV_FIELD_CURRENT;
+    stream_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    stream_->element_size_bits = 32;
+    stream_->sample_rate = 1000000;
+    stream_->decimate_factor = 1;
+    stream_->time_map.offset_time = JSDRV_TIME_HOUR;
+    stream_->time_map.counter_rate = stream_->sample_rate;
+    rsp_u64_ = jsdrv_alloc(sizeof(struct jsdrv_buffer_response_s) + 1000 * sizeof(struct jsdrv_summary_entry_s));
+    return 0;
+}
+
+static void teardown_bufsig(void) {
+    jsdrv_bufsig_free(&bufsig_);
+    jsdrv_free(stream_);
+    jsdrv_free(rsp_u64_);
+    stream_ = NULL;
+    rsp_u64_ = NULL;
+}
+
+static uint64_t bufsig_fill(void) {
+    const uint32_t n = JSDRV_STREAM_DATA_SIZE / sizeof(float);
+    uint64_t sample_id = bufsig_.hdr.sample_id + bufsig_.hdr.element_count;  // continue from the last fill
+    for (uint32_t k = 0; k < SAMPLES; k += n) {
+        stream_->sample_id = sample_id + k;
+        stream_->element_count = n;
+        memcpy(stream_->data, x_ + k, n * sizeof(float));
+        jsdrv_bufsig_recv_data(&bufsig_, stream_);
+    }
+    return SAMPLES;
+}
+
+static uint64_t run_bufsig_recv_data(void) {
+    return bufsig_fill();
+}
+
+static int32_t setup_bufsig_summary(void) {
+    setup_bufsig();
+    bufsig_fill();
+    return 0;
+}
+
+static uint64_t run_bufsig_summary(void) {
+    struct jsdrv_buffer_info_s info;
+    struct jsdrv_buffer_request_s req;
+    struct jsdrv_buffer_response_s * rsp = (struct jsdrv_buffer_response_s *) rsp_u64_;
+    jsdrv_bufsig_info(&bufsig_, &info);
+    uint64_t samples = 0;
+    for (int i = 0; i < 10; ++i) {
+        memset(&req, 0, sizeof(req));
+        req.version = 1;
+        req.time_type = JSDRV_TIME_SAMPLES;
+        req.time.samples.start = info.time_range_samples.start + i;  // defeat any caching
+        req.time.samples.end = info.time_range_samples.end;
+        req.time.samples.length = 1000;
+        jsdrv_bufsig_process_request(&bufsig_, &req, rsp);
+        samples += info.time_range_samples.length - i;
+    }
+    sink_ += (double) rsp->info.time_range_samples.length;
+    return samples;
+}
+
+// --- JSON
+
+static int32_t on_json_token(void * user_data, const struct jsdrv_union_s * token) {
+    (void) token;
+    ++*((uint32_t *) user_data);
+    return 0;
+}
+
+static uint64_t run_json_parse(void) {
+    uint64_t bytes = 0;
+    uint32_t tokens = 0;
+    for (int i = 0; i < 100; ++i) {
+        for (const struct jsdrvp_param_s * p = js220_params; p->topic; ++p) {
+            jsdrv_json_parse(p->meta, on_json_token, &tokens);
+            bytes += strlen(p->meta);
+        }
+    }
+    sink_ += tokens;
+    return bytes;
+}
+
+// --- pubsub
+
+static void on_pubsub(void * user_data, const char * topic, const struct jsdrv_union_s * value) {
+    (void) user_data;
+    (void) topic;
+    (void) value;
+    ++pubsub_count_;
+}
+
+static int32_t setup_pubsub(void) {
+    int32_t rc = jsdrv_initialize(&context_, NULL, JSDRV_TIMEOUT_MS_INIT);
+    if (rc) {
+        return rc;
+    }
+    rc = jsdrv_subscribe(context_, "bench/value", JSDRV_SFLAG_PUB, on_pubsub, NULL, JSDRV_TIMEOUT_MS_DEFAULT);
+    if (rc) {
+        jsdrv_finalize(context_, JSDRV_TIMEOUT_MS_INIT);
+        context_ = NULL;
+    }
+    return rc;
+}
+
+static void teardown_pubsub(void) {
+    jsdrv_unsubscribe(context_, "bench/value", on_pubsub, NULL, JSDRV_TIMEOUT_MS_DEFAULT);
+    jsdrv_finalize(context_, JSDRV_TIMEOUT_MS_INIT);
+    context_ = NULL;
+}
+
+static uint64_t run_pubsub_publish(void) {
+    pubsub_count_ = 0;
+    for (uint32_t k = 0; k < PUBSUB_MESSAGES; ++k) {
+        struct jsdrv_union_s v = jsdrv_union_u32(k);
+        while (jsdrv_publish(context_, "bench/value", &v, 0)) {
+            jsdrv_thread_sleep_ms(1);  // message pool exhausted, let the frontend catch up
+        }
+    }
+    int64_t t_end = jsdrv_time_utc() + 10 * JSDRV_TIME_SECOND;
+    while ((pubsub_count_ < PUBSUB_MESSAGES) && (jsdrv_time_utc() < t_end)) {
+        jsdrv_thread_sleep_ms(1);
+    }
+    return pubsub_count_;
+}
+
+// ---
+
+static const struct bench_s benches[] = {
+    {"downsample_add_f32",          "sample",   NULL, run_downsample_add_f32, NULL},
+    {"downsample_add_f32_block",    "sample",   NULL, run_downsample_add_f32_block, NULL},
+    {"js110_sp_process",            "sample",   setup_js110_sp, run_js110_sp_process, teardown_js110_sp},
+    {"js110_sp_process_block",      "sample",   setup_js110_sp, run_js110_sp_process_block, teardown_js110_sp},
+    {"js110_stats_compute",         "sample",   setup_js110_stats, run_js110_stats_compute, NULL},
+    {"js110_stats_compute_block",   "sample",   setup_js110_stats, run_js110_stats_compute_block, NULL},
+    {"sbuf_f32_mult",               "sample",   setup_sbuf, run_sbuf_f32_mult, NULL},
+    {"statistics_compute_f32",      "sample",   NULL, run_statistics_compute_f32, NULL},
+    {"bufsig_recv_data",            "sample",   setup_bufsig, run_bufsig_recv_data, teardown_bufsig},
+    {"bufsig_summary",              "sample",   setup_bufsig_summary, run_bufsig_summary, teardown_bufsig},
+    {"json_parse",                  "byte",     NULL, run_json_parse, NULL},
+    {"pubsub_publish",              "message",  setup_pubsub, run_pubsub_publish, teardown_pubsub},
+    {NULL, NULL, NULL, NULL, NULL},
+};
+
+static int compare_f64(const void * a, const void * b) {
+    double x = *((const double *) a);
+    double y = *((const double *) b);
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+static const char * isa_name(int32_t isa) {
+    switch (isa) {
+        case JSDRV_F32_OPS_ISA_SCALAR: return "scalar";
+        case JSDRV_F32_OPS_ISA_SSE2: return "sse2";
+        case JSDRV_F32_OPS_ISA_AVX2: return "avx2";
+        case JSDRV_F32_OPS_ISA_NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+static int usage(void) {
+    printf("usage: jsdrv_bench [--json] [--repeat N] [--isa scalar|sse2|avx2|neon] [filter]\n");
+    return 1;
+}
+
+int main(int argc, char * argv[]) {
+    int json = 0;
+    uint32_t repeat = REPEAT_DEFAULT;
+    const char * filter = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp(argv[i], "--json")) {
+            json = 1;
+        } else if ((0 == strcmp(argv[i], "--repeat")) && ((i + 1) < argc)) {
+            repeat = (uint32_t) strtoul(argv[++i], NULL, 0);
+            if ((repeat < 1) || (repeat > REPEAT_MAX)) {
+                return usage();
+            }
+        } else if ((0 == strcmp(argv[i], "--isa")) && ((i + 1) < argc)) {
+            const char * name = argv[++i];
+            int32_t isa = -1;
+            for (int32_t k = JSDRV_F32_OPS_ISA_SCALAR; k <= JSDRV_F32_OPS_ISA_NEON; ++k) {
+                if (0 == strcmp(name, isa_name(k))) {
+                    isa = k;
+                }
+            }
+            if ((isa < 0) || jsdrv_f32_ops_isa_set(isa)) {
+                printf("unsupported isa: %s\n", name);
+                return 1;
+            }
+        } else if (argv[i][0] == '-') {
+            return usage();
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    data_initialize();
+    if (json) {
+        printf("{\n  \"isa\": \"%s\",\n  \"repeat\": %u,\n  \"benchmarks\": [", isa_name(jsdrv_f32_ops_isa()), repeat);
+    } else {
+        printf("isa=%s, repeat=%u\n", isa_name(jsdrv_f32_ops_isa()), repeat);
+        printf("%-28s %12s %12s %12s\n", "name", "ns/item", "min ns/item", "Mitems/s");
+    }
+    int count = 0;
+    for (const struct bench_s * b = benches; b->name; ++b) {
+        if (filter && !strstr(b->name, filter)) {
+            continue;
+        }
+        if (b->setup && b->setup()) {
+            if (!json) {
+                printf("%-28s skipped\n", b->name);
+            }
+            continue;
+        }
+        double ns[REPEAT_MAX];
+        uint64_t items = b->run();  // warm up
+        for (uint32_t r = 0; r < repeat; ++r) {
+            int64_t t_start = jsdrv_time_utc();
+            items = b->run();
+            double duration = JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start);
+            ns[r] = items ? (duration * 1e9 / (double) items) : 0.0;
+        }
+        if (b->teardown) {
+            b->teardown();
+        }
+        qsort(ns, repeat, sizeof(ns[0]), compare_f64);
+        double median = ns[repeat / 2];
+        double rate = (median > 0.0) ? (1e3 / median) : 0.0;
+        if (json) {
+            printf("%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"items\": %llu, "
+                   "\"ns_per_item\": %.4f, \"min_ns_per_item\": %.4f, \"mitems_per_s\": %.3f}",
+                   count ? "," : "", b->name, b->unit, (unsigned long long) items, median, ns[0], rate);
+        } else {
+            printf("%-28s %12.3f %12.3f %12.2f  (%s)\n", b->name, median, ns[0], rate, b->unit);
+        }
+        ++count;
+    }
+    if (json) {
+        printf("\n  ]\n}\n");
+    }
+    data_finalize();
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+extern "C" {
+#include <cmocka.h>
+}
+#include <string.h>
+#include "jsdrv.hpp"
+#include <vector>
+
+
+static jsdrv_stream_signal_s stream_s;
+
+static void stream_init(uint8_t element_type, uint8_t element_size_bits, uint32_t element_count) {
+    memset(&stream_s, 0, sizeof(stream_s));
+    stream_s.element_type = element_type;
+    stream_s.element_size_bits = element_size_bits;
+    stream_s.element_count = element_count;
+}
+
+static void test_f32(void ** state) {
+    (void) state;
+    stream_init(JSDRV_DATA_TYPE_FLOAT, 32, 4);
+    float * x = reinterpret_cast<float *>(stream_s.data);
+    for (int i = 0; i < 4; ++i) {
+        x[i] = (float) i + 0.5f;
+    }
+    assert_true(jsdrv::is<float>(stream_s));
+    assert_false(jsdrv::is<jsdrv::u1>(stream_s));
+    assert_false(jsdrv::is<uint32_t>(stream_s));
+    jsdrv::Span<float> v = jsdrv::view<float>(stream_s);
+    assert_int_equal(4, v.size());
+    assert_ptr_equal(x, v.data());
+    float sum = 0.0f;
+    for (float f : v) {
+        sum += f;
+    }
+    assert_true(8.0f == sum);
+    assert_true(jsdrv::view<double>(stream_s).empty());
+    assert_true(jsdrv::view<jsdrv::u4>(stream_s).empty());
+}
+
+static void test_packed(void ** state) {
+    (void) state;
+    stream_init(JSDRV_DATA_TYPE_UINT, 1, 12);
+    stream_s.data[0] = 0xA5;
+    stream_s.data[1] = 0x03;
+    assert_true(jsdrv::is<jsdrv::u1>(stream_s));
+    jsdrv::PackedSpan<1> b = jsdrv::view<jsdrv::u1>(stream_s);
+    assert_int_equal(12, b.size());
+    const uint8_t expect_u1[] = {1, 0, 1, 0, 0, 1, 0, 1, 1, 1, 0, 0};
+    for (size_t i = 0; i < b.size(); ++i) {
+        assert_int_equal(expect_u1[i], b[i]);
+    }
+
+    stream_init(JSDRV_DATA_TYPE_UINT, 4, 3);
+    stream_s.data[0] = 0x21;
+    stream_s.data[1] = 0x0F;
+    jsdrv::PackedSpan<4> n = jsdrv::view<jsdrv::u4>(stream_s);
+    assert_int_equal(3, n.size());
+    assert_int_equal(1, n[0]);
+    assert_int_equal(2, n[1]);
+    assert_int_equal(15, n[2]);
+    assert_true(jsdrv::view<uint8_t>(stream_s).empty());
+}
+
+static void test_stream_value(void ** state) {
+    (void) state;
+    stream_init(JSDRV_DATA_TYPE_FLOAT, 32, 1);
+    jsdrv_union_s value{};
+    value.type = JSDRV_UNION_BIN;
+    value.value.bin = reinterpret_cast<const uint8_t *>(&stream_s);
+    assert_null(jsdrv::stream(value));
+    value.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    assert_ptr_equal(&stream_s, jsdrv::stream(value));
+    value.type = JSDRV_UNION_U32;
+    assert_null(jsdrv::stream(value));
+}
+
+static void test_union(void ** state) {
+    (void) state;
+    assert_int_equal(JSDRV_UNION_U8, jsdrv::to_union(true).type);
+    assert_int_equal(JSDRV_UNION_I32, jsdrv::to_union(-3).type);
+    assert_int_equal(JSDRV_UNION_U32, jsdrv::to_union(3U).type);
+    assert_int_equal(JSDRV_UNION_F64, jsdrv::to_union(1.5).type);
+    jsdrv_union_s u = jsdrv::to_union("hello");
+    assert_int_equal(JSDRV_UNION_STR, u.type);
+    assert_string_equal("hello", u.value.str);
+}
+
+static void test_error(void ** state) {
+    (void) state;
+    try {
+        jsdrv::check(JSDRV_ERROR_TIMED_OUT);
+        fail();
+    } catch (const jsdrv::Error & e) {
+        assert_int_equal(JSDRV_ERROR_TIMED_OUT, e.code());
+        assert_string_equal(jsdrv_error_code_name(JSDRV_ERROR_TIMED_OUT), e.what());
+    }
+    jsdrv::check(0);
+}
+
+static void test_empty_handles(void ** state) {
+    (void) state;
+    jsdrv::Subscription s;
+    assert_false(static_cast<bool>(s));
+    assert_int_equal(0, s.unsubscribe());
+    jsdrv::Subscription s2(std::move(s));
+    jsdrv::Message m;
+    assert_false(static_cast<bool>(m));
+    assert_null(m.stream());
+    jsdrv::Message m2 = std::move(m);
+    m2.reset();
+}
+
+// Instantiate the driver templates to check that they compile.
+void jsdrv_hpp_usage(jsdrv::Driver & d);
+
+void jsdrv_hpp_usage(jsdrv::Driver & d) {
+    std::vector<jsdrv::Message> held;
+    jsdrv::Subscription s1 = d.subscribe_stream<float>("u/js220/000415/s/i/!data",
+        [](const jsdrv_stream_signal_s & s, jsdrv::Span<float> x) { (void) s; (void) x; });
+    jsdrv::Subscription s2 = d.subscribe_stream<jsdrv::u4>("u/js220/000415/s/i/range/!data",
+        [](const jsdrv_stream_signal_s & s, jsdrv::PackedSpan<4> x) { (void) s; (void) x; });
+    jsdrv::Subscription s3 = d.subscribe("u/js220/000415/s/i/!data", JSDRV_SFLAG_PUB,
+        [&d, &held](const char * topic, const jsdrv_union_s & value) {
+            (void) topic;
+            held.push_back(d.retain(value));
+        });
+    d.publish("u/js220/000415/s/i/ctrl", 1);
+    d.publish("u/js220/000415/h/fs", 1000000U);
+    d.publish("@/!scan", jsdrv::to_union(0U));
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_f32),
+            cmocka_unit_test(test_packed),
+            cmocka_unit_test(test_stream_value),
+            cmocka_unit_test(test_union),
+            cmocka_unit_test(test_error),
+            cmocka_unit_test(test_empty_handles),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
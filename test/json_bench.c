@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Measure the JSON tokenizer and metadata validator compile throughput.
+ *
+ * Usage: json_bench [iterations]
+ *
+ * The input is the JS220 host-side parameter metadata, which the driver
+ * publishes for every device.
+ */
+
+#include "jsdrv_prv/json.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/meta.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv/time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ITERATIONS_DEFAULT (10000U)
+
+extern const struct jsdrvp_param_s js220_params[];
+
+
+static int32_t on_token(void * user_data, const struct jsdrv_union_s * token) {
+    (void) token;
+    ++*((uint32_t *) user_data);
+    return 0;
+}
+
+static void report(const char * name, double bytes, double duration, uint32_t count) {
+    printf("%-10s %8.1f MB/s  (%.3f s, %u)\n", name, bytes / duration * 1e-6, duration, count);
+}
+
+int main(int argc, char * argv[]) {
+    uint32_t iterations = ITERATIONS_DEFAULT;
+    if (argc > 1) {
+        iterations = (uint32_t) strtoul(argv[1], NULL, 0);
+    }
+    double bytes = 0.0;
+    uint32_t params = 0;
+    for (const struct jsdrvp_param_s * p = js220_params; p->topic; ++p) {
+        bytes += (double) strlen(p->meta);
+        ++params;
+    }
+    bytes *= iterations;
+    printf("%u parameters, %u iterations\n", params, iterations);
+
+    uint32_t tokens = 0;
+    int64_t t_start = jsdrv_time_utc();
+    for (uint32_t k = 0; k < iterations; ++k) {
+        for (const struct jsdrvp_param_s * p = js220_params; p->topic; ++p) {
+            if (jsdrv_json_parse(p->meta, on_token, &tokens)) {
+                printf("parse failed: %s\n", p->topic);
+                return 1;
+            }
+        }
+    }
+    report("tokenize", bytes, JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start), tokens);
+
+    uint32_t count = 0;
+    t_start = jsdrv_time_utc();
+    for (uint32_t k = 0; k < iterations; ++k) {
+        for (const struct jsdrvp_param_s * p = js220_params; p->topic; ++p) {
+            struct jsdrv_meta_validator_s * v = jsdrv_meta_validator_compile(p->meta);
+            count += (NULL != v) ? 1 : 0;
+            jsdrv_meta_validator_free(v);
+        }
+    }
+    report("validator", bytes, JSDRV_TIME_TO_F64(jsdrv_time_utc() - t_start), count);
+    return 0;
+}
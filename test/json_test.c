@@ -50,6 +50,7 @@ static int32_t on_token(void * user_data, const struct jsdrv_union_s * token) {
             break;
         }
         case JSDRV_UNION_I32: check_expected_value(token->value.i32); break;
+        case JSDRV_UNION_I64: check_expected_value(token->value.i64); break;
         case JSDRV_UNION_F64: check_expected_value(token->value.u64); break;  // check binary representation
         default:
             assert_true(false);
@@ -70,6 +71,7 @@ static int32_t on_token(void * user_data, const struct jsdrv_union_s * token) {
             break;                                                                                  \
         }                                                                                           \
         case JSDRV_UNION_I32:  expect_value(on_token, value, token_->value.i32); break;             \
+        case JSDRV_UNION_I64:  expect_value(on_token, value, token_->value.i64); break;             \
         case JSDRV_UNION_F64:  expect_value(on_token, value, token_->value.u64); break;             \
         default: assert_true(false); break;                                                         \
     }                                                                                               \
@@ -96,6 +98,14 @@ static void test_value_string(void **state) {
     assert_int_equal(0, jsdrv_json_parse("   \"hello\\n\"   ", on_token, *state));
 }
 
+static void test_value_string_escape(void **state) {
+    expect_tk(&jsdrv_union_cstr("a\\\"b\\/\\u00aF\\bc"));
+    assert_int_equal(0, jsdrv_json_parse("\"a\\\"b\\/\\u00aF\\bc\"", on_token, *state));
+    assert_int_equal(JSDRV_ERROR_SYNTAX_ERROR, jsdrv_json_parse("\"a\\x\"", on_token, *state));
+    assert_int_equal(JSDRV_ERROR_SYNTAX_ERROR, jsdrv_json_parse("\"a\\u00g0\"", on_token, *state));
+    assert_int_equal(JSDRV_ERROR_SYNTAX_ERROR, jsdrv_json_parse("\"unterminated", on_token, *state));
+}
+
 static void test_value_i32(void **state) {
     expect_tk(&jsdrv_union_i32(0));
     assert_int_equal(0, jsdrv_json_parse("   0   ", on_token, *state));
@@ -105,6 +115,18 @@ static void test_value_i32(void **state) {
     assert_int_equal(0, jsdrv_json_parse("  \n-42\t   ", on_token, *state));
 }
 
+static void test_value_i64(void **state) {
+    expect_array_start();
+    expect_tk(&jsdrv_union_i64(4000000000LL));
+    expect_tk(&jsdrv_union_i32(INT32_MIN));
+    expect_tk(&jsdrv_union_i64(-2147483649LL));
+    expect_tk(&jsdrv_union_i64(INT64_MAX));
+    expect_tk(&jsdrv_union_f64(1e20));
+    expect_array_end();
+    assert_int_equal(0, jsdrv_json_parse("[4000000000, -2147483648, -2147483649, 9223372036854775807, 100000000000000000000]",
+                                         on_token, *state));
+}
+
 static void test_value_literals(void **state) {
     expect_tk(&jsdrv_union_null());
     assert_int_equal(0, jsdrv_json_parse("null", on_token, *state));
@@ -219,7 +241,9 @@ int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_empty),
             cmocka_unit_test(test_value_string),
+            cmocka_unit_test(test_value_string_escape),
             cmocka_unit_test(test_value_i32),
+            cmocka_unit_test(test_value_i64),
             cmocka_unit_test(test_value_literals),
             cmocka_unit_test(test_obj_empty),
             cmocka_unit_test(test_obj_1),
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/latency_hist.h"
+#include "jsdrv/time.h"
+#include <string.h>
+
+
+#define US JSDRV_TIME_MICROSECOND
+
+
+static void test_bins(void **state) {
+    (void) state;
+    struct jsdrv_latency_hist_s h;
+    jsdrv_latency_hist_clear(&h);
+    jsdrv_latency_hist_add(&h, 0);
+    jsdrv_latency_hist_add(&h, -10 * US);  // clock step
+    jsdrv_latency_hist_add(&h, 124 * US);
+    jsdrv_latency_hist_add(&h, 125 * US);
+    jsdrv_latency_hist_add(&h, 4999 * US);
+    jsdrv_latency_hist_add(&h, 10 * JSDRV_TIME_SECOND);
+    assert_int_equal(6, h.count);
+    assert_int_equal(3, h.bins[0]);
+    assert_int_equal(1, h.bins[1]);
+    assert_int_equal(1, h.bins[6]);   // [4000, 8000) us
+    assert_int_equal(1, h.bins[JSDRV_LATENCY_HIST_BINS - 1]);
+    assert_int_equal(10000000, h.max_us);
+}
+
+static void test_json(void **state) {
+    (void) state;
+    char buf[512];
+    struct jsdrv_latency_hist_s h;
+    jsdrv_latency_hist_clear(&h);
+    assert_int_equal(0, jsdrv_latency_hist_json(&h, buf, sizeof(buf)));
+    jsdrv_latency_hist_add(&h, 100 * US);
+    jsdrv_latency_hist_add(&h, 200 * US);
+    jsdrv_latency_hist_add(&h, 300 * US);
+    assert_int_equal(3, jsdrv_latency_hist_json(&h, buf, sizeof(buf)));
+    assert_string_equal("{\"count\": 3, \"avg_us\": 200, \"max_us\": 300, "
+                        "\"edges_us\": [125, 250, 500, 1000, 2000, 4000, 8000, 16000, "
+                        "32000, 64000, 128000, 256000, 512000], "
+                        "\"counts\": [1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]}", buf);
+    assert_int_equal(0, h.count);  // cleared
+    assert_int_equal(0, jsdrv_latency_hist_json(&h, buf, sizeof(buf)));
+}
+
+static void test_json_truncate(void **state) {
+    (void) state;
+    char buf[64];
+    struct jsdrv_latency_hist_s h;
+    jsdrv_latency_hist_clear(&h);
+    jsdrv_latency_hist_add(&h, 100 * US);
+    assert_int_equal(0, jsdrv_latency_hist_json(&h, buf, sizeof(buf)));
+    assert_int_equal(1, h.count);  // not cleared
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_bins),
+            cmocka_unit_test(test_json),
+            cmocka_unit_test(test_json_truncate),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -20,11 +20,14 @@
 #include <cmocka.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include "jsdrv/error_code.h"
 #include "jsdrv/log.h"
 #include "jsdrv_prv/log.h"
+#include "jsdrv_prv/thread.h"
 
 
-#define ENTRY_MAX  (1024)
+#define ENTRY_MAX  (2048)
 
 
 struct state_s {
@@ -32,6 +35,9 @@ struct state_s {
     uint32_t entries_tail;
     uint8_t level[ENTRY_MAX];
     uint32_t line[ENTRY_MAX];
+    volatile uint32_t hold;  // block the log thread while nonzero
+    uint32_t drop_notice_count;
+    uint32_t suppressed;
 };
 
 
@@ -46,8 +52,18 @@ static void log_cbk(void * user_data, struct jsdrv_log_header_s const * header,
     state->level[state->entries_head] = header->level;
     state->line[state->entries_head] = header->line;
     ++state->entries_head;
+    if (strstr(message, "missing messages")) {
+        ++state->drop_notice_count;
+        assert_non_null(strstr(message, " 77 "));
+    }
+    unsigned int suppressed = 0;
+    if (1 == sscanf(message, "suppressed %u identical messages", &suppressed)) {
+        state->suppressed += suppressed;
+    }
+    while (state->hold) {
+        ;  // spin
+    }
     (void) filename;
-    (void) message;
 }
 
 #define CHECK(state, level_, line_) \
@@ -92,10 +108,205 @@ static void test_basic(void **state) {
     CHECK(&s, JSDRV_LOG_LEVEL_WARNING, 42);
 }
 
+static void test_order(void **state) {
+    (void) state;
+    struct state_s s;
+    memset(&s, 0, sizeof(s));
+    jsdrv_log_initialize();
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_INFO);
+    jsdrv_log_register(log_cbk, &s);
+    for (uint32_t i = 0; i < 500; ++i) {
+        jsdrv_log_publish(JSDRV_LOG_LEVEL_INFO, "filename", i, "message %u", (unsigned int) i);
+        jsdrv_log_publish(JSDRV_LOG_LEVEL_DEBUG, "filename", i, "ignored");
+    }
+    jsdrv_log_finalize();
+    for (uint32_t i = 0; i < 500; ++i) {
+        CHECK(&s, JSDRV_LOG_LEVEL_INFO, i);
+    }
+    assert_int_equal(500, s.entries_head);
+}
+
+static void test_overflow(void **state) {
+    (void) state;
+    struct state_s s;
+    memset(&s, 0, sizeof(s));
+    s.hold = 1;
+    jsdrv_log_initialize();
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_INFO);
+    jsdrv_log_register(log_cbk, &s);
+    // the first message holds the log thread, so the rest fill the 1024 message pool
+    for (uint32_t i = 0; i < 1101; ++i) {
+        jsdrv_log_publish(JSDRV_LOG_LEVEL_INFO, "filename", i, "message %u", (unsigned int) i);
+    }
+    s.hold = 0;
+    jsdrv_log_finalize();
+    for (uint32_t i = 0; i < 1024; ++i) {
+        CHECK(&s, JSDRV_LOG_LEVEL_INFO, i);
+    }
+    CHECK(&s, JSDRV_LOG_LEVEL_ERROR, s.line[1024]);
+    assert_int_equal(1, s.drop_notice_count);
+    assert_int_equal(1025, s.entries_head);
+}
+
+static void test_module_level(void **state) {
+    (void) state;
+    struct state_s s;
+    memset(&s, 0, sizeof(s));
+    jsdrv_log_initialize();
+    jsdrv_log_register(log_cbk, &s);
+    assert_int_equal(JSDRV_LOG_LEVEL_ALL, jsdrv_log_module_level_get("js220"));
+    assert_int_equal(JSDRV_LOG_LEVEL_OFF, jsdrv_log_module_level_get("invalid"));
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_log_module_level_set("invalid", JSDRV_LOG_LEVEL_INFO));
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_INFO);
+    assert_int_equal(JSDRV_LOG_LEVEL_INFO, jsdrv_log_module_threshold[JSDRV_LOG_MODULE_JS220]);
+    assert_int_equal(0, jsdrv_log_module_level_set("js220", JSDRV_LOG_LEVEL_ERROR));
+    assert_int_equal(JSDRV_LOG_LEVEL_ERROR, jsdrv_log_module_level_get("js220"));
+    assert_int_equal(JSDRV_LOG_LEVEL_ERROR, jsdrv_log_module_threshold[JSDRV_LOG_MODULE_JS220]);
+    assert_int_equal(JSDRV_LOG_LEVEL_INFO, jsdrv_log_module_threshold[JSDRV_LOG_MODULE_DEFAULT]);
+
+    assert_int_equal(0, jsdrv_log_module_level_set("default", JSDRV_LOG_LEVEL_WARNING));
+    JSDRV_LOGI("filtered");
+    JSDRV_LOGW("passed"); uint32_t line = __LINE__;
+    jsdrv_log_finalize();
+    CHECK(&s, JSDRV_LOG_LEVEL_WARNING, line);
+    assert_int_equal(1, s.entries_head);
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_ERROR);
+    assert_int_equal(JSDRV_LOG_LEVEL_ERROR, jsdrv_log_module_threshold[JSDRV_LOG_MODULE_DEFAULT]);
+    assert_int_equal(0, jsdrv_log_module_level_set("default", JSDRV_LOG_LEVEL_ALL));
+    assert_int_equal(0, jsdrv_log_module_level_set("js220", JSDRV_LOG_LEVEL_ALL));
+}
+
+static uint32_t rate_line_;
+
+static void rate_publish(uint32_t value) {
+    JSDRV_LOGW_RATE("rate %u", (unsigned int) value); rate_line_ = __LINE__;
+}
+
+static void test_rate_limit(void **state) {
+    (void) state;
+    struct state_s s;
+    memset(&s, 0, sizeof(s));
+    jsdrv_log_initialize();
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_INFO);
+    jsdrv_log_register(log_cbk, &s);
+    for (uint32_t i = 0; i < 100; ++i) {
+        rate_publish(i);
+    }
+    jsdrv_thread_sleep_ms(JSDRV_LOG_RATE_INTERVAL_MS + 300);  // log thread summarizes the quiet call site
+    assert_int_equal(2, s.entries_head);
+    assert_int_equal(99, s.suppressed);
+    rate_publish(100);
+    for (uint32_t i = 0; i < 10; ++i) {
+        rate_publish(101 + i);
+    }
+    jsdrv_log_finalize();
+    CHECK(&s, JSDRV_LOG_LEVEL_WARNING, rate_line_);
+    CHECK(&s, JSDRV_LOG_LEVEL_WARNING, rate_line_);  // summary
+    CHECK(&s, JSDRV_LOG_LEVEL_WARNING, rate_line_);
+    CHECK(&s, JSDRV_LOG_LEVEL_WARNING, rate_line_);  // summary on finalize
+    assert_int_equal(4, s.entries_head);
+    assert_int_equal(109, s.suppressed);
+}
+
+#define BINARY_PATH "log_test_binary.bin"
+
+static uint8_t * binary_read(uint64_t * size) {
+    FILE * f = fopen(BINARY_PATH, "rb");
+    assert_non_null(f);
+    fseek(f, 0, SEEK_END);
+    *size = (uint64_t) ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t * b = malloc(*size);
+    assert_int_equal(*size, fread(b, 1, *size, f));
+    fclose(f);
+    return b;
+}
+
+// Decode all records and check that their lines increment, return the record count.
+static uint32_t binary_check(const uint8_t * b, uint32_t line_last) {
+    const struct jsdrv_log_binary_header_s * hdr = (const struct jsdrv_log_binary_header_s *) b;
+    const uint8_t * data = b + hdr->header_size;
+    assert_memory_equal(JSDRV_LOG_BINARY_MAGIC, hdr->magic, 8);
+    assert_int_equal(JSDRV_LOG_BINARY_VERSION, hdr->version);
+    assert_true((hdr->head - hdr->tail) <= hdr->data_size);
+    uint32_t count = 0;
+    uint32_t line = 0;
+    char message[64];
+    for (uint64_t offset = hdr->tail; offset < hdr->head; ) {
+        const struct jsdrv_log_binary_record_s * r = (const struct jsdrv_log_binary_record_s *) (data + (offset % hdr->data_size));
+        assert_true(r->size >= 8);
+        offset += r->size;
+        if (r->flags & JSDRV_LOG_BINARY_FLAG_PAD) {
+            continue;
+        }
+        const char * strs = (const char *) (r + 1);
+        assert_int_equal(8, r->filename_size);
+        assert_memory_equal("filename", strs, 8);
+        snprintf(message, sizeof(message), "message %u", (unsigned int) r->line);
+        assert_int_equal(strlen(message), r->message_size);
+        assert_memory_equal(message, strs + r->filename_size, r->message_size);
+        assert_int_equal(JSDRV_LOG_LEVEL_INFO, r->level);
+        if (count) {
+            assert_int_equal(line + 1, r->line);
+        }
+        line = r->line;
+        ++count;
+    }
+    assert_int_equal(line_last, line);
+    return count;
+}
+
+static void test_binary(void **state) {
+    (void) state;
+    uint64_t size = 0;
+    jsdrv_log_initialize();
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_INFO);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_log_binary_open(BINARY_PATH, 1024));
+    assert_int_equal(0, jsdrv_log_binary_open(BINARY_PATH, 1 << 16));
+    for (uint32_t i = 0; i < 10; ++i) {
+        jsdrv_log_publish(JSDRV_LOG_LEVEL_INFO, "filename", i, "message %u", (unsigned int) i);
+    }
+    jsdrv_log_finalize();
+    uint8_t * b = binary_read(&size);
+    assert_int_equal(1 << 16, size);
+    assert_int_equal(0, ((struct jsdrv_log_binary_header_s *) b)->tail);
+    assert_int_equal(10, binary_check(b, 9));
+    free(b);
+    remove(BINARY_PATH);
+}
+
+static void test_binary_wrap(void **state) {
+    (void) state;
+    uint64_t size = 0;
+    jsdrv_log_initialize();
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_INFO);
+    assert_int_equal(0, jsdrv_log_binary_open(BINARY_PATH, 4096));
+    for (uint32_t i = 0; i < 1000; ++i) {
+        jsdrv_log_publish(JSDRV_LOG_LEVEL_INFO, "filename", i, "message %u", (unsigned int) i);
+        if (0 == (i % 100)) {
+            jsdrv_thread_sleep_ms(10);  // avoid log ring overflow
+        }
+    }
+    jsdrv_log_finalize();
+    uint8_t * b = binary_read(&size);
+    assert_true(((struct jsdrv_log_binary_header_s *) b)->tail > 0);
+    uint32_t count = binary_check(b, 999);
+    assert_true(count > 50);
+    assert_true(count < 1000);
+    free(b);
+    remove(BINARY_PATH);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_register_before_init),
             cmocka_unit_test(test_basic),
+            cmocka_unit_test(test_order),
+            cmocka_unit_test(test_overflow),
+            cmocka_unit_test(test_module_level),
+            cmocka_unit_test(test_rate_limit),
+            cmocka_unit_test(test_binary),
+            cmocka_unit_test(test_binary_wrap),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -21,6 +21,7 @@
 #include <string.h>
 #include "jsdrv/meta.h"
 #include "jsdrv/error_code.h"
+#include "jsdrv_prv/meta.h"
 
 #define cstr(_value) ((struct jsdrv_union_s){.type=JSDRV_UNION_STR, .op=0, .flags=JSDRV_UNION_FLAG_CONST, .app=0, .value={.str=_value}, .size=(uint32_t) (strlen(_value) + 1)})
 
@@ -94,11 +95,121 @@ static void test_no_default(void **state) {
     assert_false(value.flags & JSDRV_UNION_FLAG_RETAIN);
 }
 
+const char * META_BOOL = "{"
+    "\"dtype\": \"bool\","
+    "\"brief\": \"Enable.\""
+"}";
+
+const char * META_I32 = "{"
+    "\"brief\": \"Signed selection.\","
+    "\"dtype\": \"i32\","
+    "\"range\": [-10, 10],"
+    "\"options\": ["
+        "[-1, \"minus one\"],"
+        "[0, \"zero\", \"off\"],"
+        "[1, \"\"]"
+    "]"
+"}";
+
+const char * META_JSON = "{"
+    "\"dtype\": \"json\","
+    "\"brief\": \"A histogram.\","
+    "\"flags\": [\"ro\"]"
+"}";
+
+// Check that the compiled validator matches jsdrv_meta_value.
+static void validator_check(const struct jsdrv_meta_validator_s * v, const char * meta, struct jsdrv_union_s value) {
+    struct jsdrv_union_s expect = value;
+    int32_t rc = jsdrv_meta_value(meta, &expect);
+    assert_int_equal(rc, jsdrv_meta_validator_value(v, &value));
+    if (!rc) {
+        assert_int_equal(expect.type, value.type);
+        assert_true(jsdrv_union_eq(&expect, &value));
+    }
+}
+
+static void test_validator(void **state) {
+    (void) state;
+    const char * metas[] = {META1, META_NO_DEFAULT, META_BOOL, META_I32, META_JSON};
+    const char * strs[] = {"three", "_3_", "2", "ten", "__invalid__", "minus one", "off", "", "true", "0", "-1"};
+    for (uint32_t i = 0; i < sizeof(metas) / sizeof(metas[0]); ++i) {
+        struct jsdrv_meta_validator_s * v = jsdrv_meta_validator_compile(metas[i]);
+        assert_non_null(v);
+        for (int32_t k = -2; k < 12; ++k) {
+            validator_check(v, metas[i], jsdrv_union_u8((uint8_t) k));
+            validator_check(v, metas[i], jsdrv_union_u32((uint32_t) k));
+            validator_check(v, metas[i], jsdrv_union_i32(k));
+        }
+        for (uint32_t k = 0; k < sizeof(strs) / sizeof(strs[0]); ++k) {
+            validator_check(v, metas[i], cstr(strs[k]));
+        }
+        jsdrv_meta_validator_free(v);
+    }
+}
+
+static void test_validator_value(void **state) {
+    (void) state;
+    struct jsdrv_union_s value;
+    struct jsdrv_meta_validator_s * v = jsdrv_meta_validator_compile(META1);
+    value = cstr("_3_");
+    assert_int_equal(0, jsdrv_meta_validator_value(v, &value));
+    assert_true(jsdrv_union_eq(&jsdrv_union_u8(3), &value));
+    value = jsdrv_union_u32(11);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_meta_validator_value(v, &value));
+    jsdrv_meta_validator_free(v);
+
+    v = jsdrv_meta_validator_compile(META_JSON);
+    value = jsdrv_union_cjson_r("{\"count\": 1}");
+    assert_int_equal(0, jsdrv_meta_validator_value(v, &value));
+    assert_int_equal(JSDRV_UNION_JSON, value.type);
+    jsdrv_meta_validator_free(v);
+
+    v = jsdrv_meta_validator_compile("{\"dtype\": \"u8\"");  // syntax error
+    value = jsdrv_union_u8(1);
+    assert_int_not_equal(0, jsdrv_meta_validator_value(v, &value));
+    jsdrv_meta_validator_free(v);
+    assert_null(jsdrv_meta_validator_compile(NULL));
+}
+
+struct static_param_s {
+    const char * meta;
+    struct jsdrv_union_s default_value;
+};
+
+static const struct static_param_s STATIC_PARAMS[] = {
+    {JSDRV_META(u8, 3,
+        "\"brief\": \"Number selection.\", "
+        "\"options\": [[0, \"zero\"], [3, \"three\"]]")},
+    {JSDRV_META(bool, 1, "\"brief\": \"Enable.\"")},
+    {JSDRV_META(i16, -7, "\"brief\": \"Offset.\"")},
+    {JSDRV_META(u32, 100000, "\"brief\": \"Rate.\", \"range\": [1, 1000000]")},
+};
+
+static void test_static_meta(void **state) {
+    (void) state;
+    for (size_t i = 0; i < sizeof(STATIC_PARAMS) / sizeof(STATIC_PARAMS[0]); ++i) {
+        const struct static_param_s * p = &STATIC_PARAMS[i];
+        uint8_t dtype = 0;
+        struct jsdrv_union_s value;
+        assert_int_equal(0, jsdrv_meta_dtype(p->meta, &dtype));
+        assert_int_equal(p->default_value.type, dtype);
+        assert_int_equal(0, jsdrv_meta_default(p->meta, &value));
+        assert_true(jsdrv_union_eq(&p->default_value, &value));
+        struct jsdrv_meta_validator_s * v = jsdrv_meta_validator_compile(p->meta);
+        value = p->default_value;
+        assert_int_equal(0, jsdrv_meta_validator_value(v, &value));
+        jsdrv_meta_validator_free(v);
+    }
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_basic),
             cmocka_unit_test(test_value),
             cmocka_unit_test(test_no_default),
+            cmocka_unit_test(test_validator),
+            cmocka_unit_test(test_validator_value),
+            cmocka_unit_test(test_static_meta),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
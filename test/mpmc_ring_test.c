@@ -0,0 +1,83 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/mpmc_ring.h"
+#include <stdint.h>
+
+
+#define PTR(x) ((void *) (uintptr_t) (x))
+
+
+static void test_invalid_capacity(void **state) {
+    (void) state;
+    assert_null(jsdrv_mpmc_ring_alloc(0));
+    assert_null(jsdrv_mpmc_ring_alloc(3));
+}
+
+static void test_empty(void **state) {
+    (void) state;
+    struct jsdrv_mpmc_ring_s * r = jsdrv_mpmc_ring_alloc(4);
+    assert_non_null(r);
+    assert_true(jsdrv_mpmc_ring_is_empty(r));
+    assert_null(jsdrv_mpmc_ring_pop(r));
+    jsdrv_mpmc_ring_free(r);
+}
+
+static void test_push_pop_fifo(void **state) {
+    (void) state;
+    struct jsdrv_mpmc_ring_s * r = jsdrv_mpmc_ring_alloc(4);
+    assert_true(jsdrv_mpmc_ring_push(r, PTR(1)));
+    assert_true(jsdrv_mpmc_ring_push(r, PTR(2)));
+    assert_false(jsdrv_mpmc_ring_is_empty(r));
+    assert_int_equal(2, jsdrv_mpmc_ring_count(r));
+    assert_ptr_equal(PTR(1), jsdrv_mpmc_ring_pop(r));
+    assert_int_equal(1, jsdrv_mpmc_ring_count(r));
+    assert_ptr_equal(PTR(2), jsdrv_mpmc_ring_pop(r));
+    assert_true(jsdrv_mpmc_ring_is_empty(r));
+    assert_int_equal(0, jsdrv_mpmc_ring_count(r));
+    jsdrv_mpmc_ring_free(r);
+}
+
+static void test_full_and_wrap(void **state) {
+    (void) state;
+    struct jsdrv_mpmc_ring_s * r = jsdrv_mpmc_ring_alloc(4);
+    for (uintptr_t k = 0; k < 10; ++k) {
+        for (uintptr_t i = 1; i <= 4; ++i) {
+            assert_true(jsdrv_mpmc_ring_push(r, PTR(k * 4 + i)));
+        }
+        assert_false(jsdrv_mpmc_ring_push(r, PTR(100)));
+        for (uintptr_t i = 1; i <= 4; ++i) {
+            assert_ptr_equal(PTR(k * 4 + i), jsdrv_mpmc_ring_pop(r));
+        }
+        assert_null(jsdrv_mpmc_ring_pop(r));
+    }
+    jsdrv_mpmc_ring_free(r);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_invalid_capacity),
+            cmocka_unit_test(test_empty),
+            cmocka_unit_test(test_push_pop_fifo),
+            cmocka_unit_test(test_full_and_wrap),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
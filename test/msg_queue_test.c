@@ -0,0 +1,208 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/list.h"
+#include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv_prv/thread.h"
+#include "jsdrv/error_code.h"
+
+
+#define PRODUCER_COUNT      (4U)
+#define PRODUCER_MSG_COUNT  (2000U)
+
+struct producer_s {
+    struct msg_queue_s * q;
+    uint32_t id;
+    jsdrv_thread_t thread;
+};
+
+static struct jsdrvp_msg_s * msg_alloc(uint32_t a, uint32_t b) {
+    struct jsdrvp_msg_s * m = jsdrv_alloc_clr(sizeof(struct jsdrvp_msg_s));
+    jsdrv_list_initialize(&m->item);
+    m->u32_a = a;
+    m->u32_b = b;
+    return m;
+}
+
+static void test_empty(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * m = NULL;
+    struct msg_queue_s * q = msg_queue_init();
+    assert_non_null(q);
+    assert_true(msg_queue_is_empty(q));
+    assert_null(msg_queue_pop_immediate(q));
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, msg_queue_pop(q, &m, 0));
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, msg_queue_pop(q, &m, 1));
+    msg_queue_finalize(q);
+}
+
+static void test_push_pop(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * m = NULL;
+    struct msg_queue_s * q = msg_queue_init();
+    msg_queue_push(q, msg_alloc(1, 0));
+    msg_queue_push(q, msg_alloc(2, 0));
+    assert_false(msg_queue_is_empty(q));
+    assert_int_equal(0, msg_queue_pop(q, &m, 10));
+    assert_int_equal(1, m->u32_a);
+    jsdrv_free(m);
+    m = msg_queue_pop_immediate(q);
+    assert_non_null(m);
+    assert_int_equal(2, m->u32_a);
+    jsdrv_free(m);
+    assert_true(msg_queue_is_empty(q));
+    msg_queue_finalize(q);
+}
+
+static void test_overflow_fifo(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * m = NULL;
+    struct msg_queue_s * q = msg_queue_init();
+    for (uint32_t i = 0; i < 1000; ++i) {
+        msg_queue_push(q, msg_alloc(i, 0));
+    }
+    assert_int_equal(1000, msg_queue_depth(q));
+    for (uint32_t i = 0; i < 500; ++i) {
+        m = msg_queue_pop_immediate(q);
+        assert_non_null(m);
+        assert_int_equal(i, m->u32_a);
+        jsdrv_free(m);
+    }
+    for (uint32_t i = 1000; i < 1500; ++i) {
+        msg_queue_push(q, msg_alloc(i, 0));
+    }
+    for (uint32_t i = 500; i < 1500; ++i) {
+        m = msg_queue_pop_immediate(q);
+        assert_non_null(m);
+        assert_int_equal(i, m->u32_a);
+        jsdrv_free(m);
+    }
+    assert_int_equal(0, msg_queue_depth(q));
+    assert_null(msg_queue_pop_immediate(q));
+    msg_queue_finalize(q);
+}
+
+static void test_pop_n(void **state) {
+    (void) state;
+    struct jsdrvp_msg_s * msgs[MSG_QUEUE_BATCH_SIZE];
+    struct msg_queue_s * q = msg_queue_init();
+    assert_int_equal(0, msg_queue_pop_n(q, msgs, MSG_QUEUE_BATCH_SIZE));
+    for (uint32_t i = 0; i < 1000; ++i) {  // overflows the ring
+        msg_queue_push(q, msg_alloc(i, 0));
+    }
+    uint32_t expect = 0;
+    uint32_t count;
+    while ((count = msg_queue_pop_n(q, msgs, MSG_QUEUE_BATCH_SIZE))) {
+        assert_true(count <= MSG_QUEUE_BATCH_SIZE);
+        for (uint32_t i = 0; i < count; ++i) {
+            assert_int_equal(expect++, msgs[i]->u32_a);
+            jsdrv_free(msgs[i]);
+        }
+    }
+    assert_int_equal(1000, expect);
+    assert_true(msg_queue_is_empty(q));
+    msg_queue_finalize(q);
+}
+
+static void test_pop_all(void **state) {
+    (void) state;
+    struct jsdrv_list_s list;
+    struct jsdrv_list_s * item;
+    jsdrv_list_initialize(&list);
+    struct msg_queue_s * q = msg_queue_init();
+    assert_int_equal(0, msg_queue_pop_all(q, &list));
+    for (uint32_t i = 0; i < 1000; ++i) {
+        msg_queue_push(q, msg_alloc(i, 0));
+    }
+    assert_int_equal(1000, msg_queue_pop_all(q, &list));
+    assert_true(msg_queue_is_empty(q));
+    assert_int_equal(1000, jsdrv_list_length(&list));
+    uint32_t expect = 0;
+    while (NULL != (item = jsdrv_list_remove_head(&list))) {
+        struct jsdrvp_msg_s * m = JSDRV_CONTAINER_OF(item, struct jsdrvp_msg_s, item);
+        assert_int_equal(expect++, m->u32_a);
+        jsdrv_free(m);
+    }
+    msg_queue_push(q, msg_alloc(5, 0));
+    assert_int_equal(1, msg_queue_pop_all(q, &list));
+    jsdrv_free(JSDRV_CONTAINER_OF(jsdrv_list_remove_head(&list), struct jsdrvp_msg_s, item));
+    msg_queue_finalize(q);
+}
+
+static void test_finalize_nonempty(void **state) {
+    (void) state;
+    struct msg_queue_s * q = msg_queue_init();
+    for (uint32_t i = 0; i < 300; ++i) {
+        msg_queue_push(q, msg_alloc(i, 0));
+    }
+    msg_queue_finalize(q);  // frees remaining messages
+}
+
+static THREAD_RETURN_TYPE producer_thread(THREAD_ARG_TYPE lpParam) {
+    struct producer_s * p = (struct producer_s *) lpParam;
+    for (uint32_t i = 0; i < PRODUCER_MSG_COUNT; ++i) {
+        msg_queue_push(p->q, msg_alloc(p->id, i));
+    }
+    THREAD_RETURN();
+}
+
+static void test_multiple_producers(void **state) {
+    (void) state;
+    struct producer_s producers[PRODUCER_COUNT];
+    uint32_t next[PRODUCER_COUNT];
+    struct jsdrvp_msg_s * m = NULL;
+    struct msg_queue_s * q = msg_queue_init();
+    for (uint32_t i = 0; i < PRODUCER_COUNT; ++i) {
+        producers[i].q = q;
+        producers[i].id = i;
+        next[i] = 0;
+        assert_int_equal(0, jsdrv_thread_create(&producers[i].thread, producer_thread, &producers[i], 0));
+    }
+    for (uint32_t count = 0; count < PRODUCER_COUNT * PRODUCER_MSG_COUNT; ++count) {
+        assert_int_equal(0, msg_queue_pop(q, &m, 1000));
+        assert_true(m->u32_a < PRODUCER_COUNT);
+        assert_int_equal(next[m->u32_a], m->u32_b);  // per-producer FIFO
+        ++next[m->u32_a];
+        jsdrv_free(m);
+    }
+    for (uint32_t i = 0; i < PRODUCER_COUNT; ++i) {
+        jsdrv_thread_join(&producers[i].thread, 1000);
+    }
+    assert_true(msg_queue_is_empty(q));
+    msg_queue_finalize(q);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_empty),
+            cmocka_unit_test(test_push_pop),
+            cmocka_unit_test(test_overflow_fifo),
+            cmocka_unit_test(test_pop_n),
+            cmocka_unit_test(test_pop_all),
+            cmocka_unit_test(test_finalize_nonempty),
+            cmocka_unit_test(test_multiple_producers),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include "jsdrv_prv/pack.h"
+#include "jsdrv_prv/f32_ops.h"
+
+
+#define N (133U)
+
+static const int32_t ISAS[] = {JSDRV_F32_OPS_ISA_SCALAR, JSDRV_F32_OPS_ISA_SSE2,
+                               JSDRV_F32_OPS_ISA_AVX2, JSDRV_F32_OPS_ISA_NEON};
+
+
+static void values(uint8_t * x) {
+    for (uint32_t k = 0; k < N; ++k) {
+        x[k] = (uint8_t) (((k * 37) ^ (k >> 3)) & 0xff);  // upper bits must be ignored
+    }
+}
+
+static void test_u4(void ** state) {
+    (void) state;
+    uint8_t x[N];
+    uint8_t expect[N];
+    uint8_t actual[N];
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    values(x);
+    for (size_t idx = 0; idx < (sizeof(ISAS) / sizeof(ISAS[0])); ++idx) {
+        if (jsdrv_f32_ops_isa_set(ISAS[idx])) {
+            continue;  // not supported by this CPU
+        }
+        for (uint32_t n = 0; n <= N; ++n) {
+            memset(expect, 0xa5, sizeof(expect));
+            memset(actual, 0xa5, sizeof(actual));
+            for (uint32_t k = 0; k < n; ++k) {
+                if (k & 1) {
+                    expect[k >> 1] |= (uint8_t) ((x[k] & 0x0f) << 4);
+                } else {
+                    expect[k >> 1] = x[k] & 0x0f;
+                }
+            }
+            jsdrv_pack_u4(actual, x, n);
+            assert_memory_equal(expect, actual, sizeof(actual));
+        }
+    }
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa_default));
+}
+
+static void test_u1(void ** state) {
+    (void) state;
+    uint8_t x[N];
+    uint8_t expect[N];
+    uint8_t actual[N];
+    int32_t isa_default = jsdrv_f32_ops_isa();
+    values(x);
+    for (size_t idx = 0; idx < (sizeof(ISAS) / sizeof(ISAS[0])); ++idx) {
+        if (jsdrv_f32_ops_isa_set(ISAS[idx])) {
+            continue;  // not supported by this CPU
+        }
+        for (uint32_t n = 0; n <= N; ++n) {
+            memset(expect, 0xa5, sizeof(expect));
+            memset(actual, 0xa5, sizeof(actual));
+            for (uint32_t k = 0; k < n; ++k) {
+                if (k & 7) {
+                    expect[k >> 3] |= (uint8_t) ((x[k] & 1) << (k & 7));
+                } else {
+                    expect[k >> 3] = x[k] & 1;
+                }
+            }
+            jsdrv_pack_u1(actual, x, n);
+            assert_memory_equal(expect, actual, sizeof(actual));
+        }
+    }
+    assert_int_equal(0, jsdrv_f32_ops_isa_set(isa_default));
+}
+
+static void test_select(void ** state) {
+    (void) state;
+    uint8_t x[N];
+    uint8_t y[N];
+    values(x);
+    assert_int_equal(N, jsdrv_pack_select_u8(y, x, N, 1));
+    assert_memory_equal(x, y, N);
+    assert_int_equal(27, jsdrv_pack_select_u8(y, x, N, 5));
+    for (uint32_t k = 0; k < 27; ++k) {
+        assert_int_equal(x[k * 5], y[k]);
+    }
+    assert_int_equal(0, jsdrv_pack_select_u8(y, x, 0, 5));
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_u4),
+            cmocka_unit_test(test_u1),
+            cmocka_unit_test(test_select),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
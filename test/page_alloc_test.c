@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include "jsdrv_prv/page_alloc.h"
+#include "jsdrv_prv/platform.h"
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include <stdlib.h>
+
+
+#define SIZE (3U * 1024U * 1024U + 5U)  // not a multiple of any page size
+
+
+static void alloc_fill_free(uint8_t mode, int32_t numa_node) {
+    uint8_t * p = jsdrv_page_alloc(SIZE, mode, numa_node);
+    assert_non_null(p);
+    assert_int_equal(0, ((uintptr_t) p) % JSDRV_ALLOC_ALIGNMENT);
+    memset(p, 0x5a, SIZE);
+    assert_int_equal(0x5a, p[0]);
+    assert_int_equal(0x5a, p[SIZE - 1]);
+    jsdrv_page_free(p);
+}
+
+static void test_default(void ** state) {
+    (void) state;
+    alloc_fill_free(JSDRV_PAGE_MODE_DEFAULT, JSDRV_PAGE_NUMA_NODE_ANY);
+    jsdrv_page_free(NULL);
+}
+
+static void test_huge(void ** state) {
+    (void) state;
+    alloc_fill_free(JSDRV_PAGE_MODE_HUGE, JSDRV_PAGE_NUMA_NODE_ANY);
+}
+
+static void test_large(void ** state) {
+    (void) state;
+    alloc_fill_free(JSDRV_PAGE_MODE_LARGE, JSDRV_PAGE_NUMA_NODE_ANY);  // falls back without reserved pages
+}
+
+static void test_numa_node(void ** state) {
+    (void) state;
+    alloc_fill_free(JSDRV_PAGE_MODE_DEFAULT, 0);
+    alloc_fill_free(JSDRV_PAGE_MODE_HUGE, 0);
+}
+
+struct counter_s {
+    int alloc;
+    int free;
+    int alloc_aligned;
+    int free_aligned;
+};
+
+static void * counter_alloc(void * user_data, size_t size_bytes) {
+    ++((struct counter_s *) user_data)->alloc;
+    return malloc(size_bytes);
+}
+
+static void counter_free(void * user_data, void * ptr) {
+    ++((struct counter_s *) user_data)->free;
+    free(ptr);
+}
+
+static void * counter_alloc_aligned(void * user_data, size_t size_bytes, size_t alignment) {
+    ++((struct counter_s *) user_data)->alloc_aligned;
+    uint8_t * p = malloc(size_bytes + alignment + sizeof(void *));
+    uint8_t * a = (uint8_t *) ((((uintptr_t) p) + sizeof(void *) + alignment - 1) & ~(uintptr_t) (alignment - 1));
+    ((void **) a)[-1] = p;
+    return a;
+}
+
+static void counter_free_aligned(void * user_data, void * ptr) {
+    ++((struct counter_s *) user_data)->free_aligned;
+    free(((void **) ptr)[-1]);
+}
+
+static void test_allocator(void ** state) {
+    (void) state;
+    struct counter_s counter = {0, 0, 0, 0};
+    struct jsdrv_allocator_s allocator = {
+        .alloc = counter_alloc,
+        .free = counter_free,
+        .alloc_aligned = counter_alloc_aligned,
+        .free_aligned = counter_free_aligned,
+        .user_data = &counter,
+    };
+    assert_int_equal(0, jsdrv_allocator_set(&allocator));
+    uint8_t * p1 = jsdrv_alloc(100);
+    uint8_t * p2 = jsdrv_alloc_aligned(100, 256);
+    assert_int_equal(0, ((uintptr_t) p2) % 256);
+    assert_int_equal(JSDRV_ERROR_BUSY, jsdrv_allocator_set(NULL));
+    jsdrv_free(p1);
+    jsdrv_free(p2);
+    assert_int_equal(1, counter.alloc);
+    assert_int_equal(1, counter.free);
+    assert_int_equal(1, counter.alloc_aligned);
+    assert_int_equal(1, counter.free_aligned);
+
+    // without alloc_aligned, over-allocate from alloc
+    allocator.alloc_aligned = NULL;
+    allocator.free_aligned = NULL;
+    assert_int_equal(0, jsdrv_allocator_set(&allocator));
+    alloc_fill_free(JSDRV_PAGE_MODE_DEFAULT, JSDRV_PAGE_NUMA_NODE_ANY);
+    assert_int_equal(2, counter.alloc);
+    assert_int_equal(2, counter.free);
+    assert_int_equal(1, counter.alloc_aligned);
+
+    allocator.free = NULL;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_allocator_set(&allocator));
+    assert_int_equal(0, jsdrv_allocator_set(NULL));
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_default),
+            cmocka_unit_test(test_huge),
+            cmocka_unit_test(test_large),
+            cmocka_unit_test(test_numa_node),
+            cmocka_unit_test(test_allocator),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/param_cache.h"
+#include "jsdrv.h"
+
+
+static void test_resume(void **state) {
+    (void) state;
+    struct jsdrv_param_cache_s * c = jsdrv_param_cache_new();
+    struct jsdrv_param_cache_device_s * d = jsdrv_param_cache_device(c, "u/js220/000001");
+    assert_ptr_equal(d, jsdrv_param_cache_device(c, "u/js220/000001"));
+    assert_ptr_not_equal(d, jsdrv_param_cache_device(c, "u/js220/000002"));
+    assert_false(jsdrv_param_cache_resume(d, 1));
+    assert_true(jsdrv_param_cache_update(d, "s/i/ctrl", &jsdrv_union_u8(1)));
+    jsdrv_param_cache_commit(d);
+    assert_true(jsdrv_param_cache_resume(d, 1));
+    assert_int_equal(1, jsdrv_param_cache_size(d));
+    assert_false(jsdrv_param_cache_resume(d, 2));  // firmware changed
+    assert_int_equal(0, jsdrv_param_cache_size(d));
+    assert_int_equal(0, jsdrv_param_cache_hash(d));
+    jsdrv_param_cache_commit(d);
+    jsdrv_param_cache_invalidate(d);
+    assert_false(jsdrv_param_cache_resume(d, 2));
+    jsdrv_param_cache_free(c);
+}
+
+static void test_update(void **state) {
+    (void) state;
+    struct jsdrv_param_cache_s * c = jsdrv_param_cache_new();
+    struct jsdrv_param_cache_device_s * d = jsdrv_param_cache_device(c, "u/js220/000001");
+    assert_false(jsdrv_param_cache_resume(d, 1));
+    assert_true(jsdrv_param_cache_update(d, "s/i/ctrl", &jsdrv_union_u8(1)));
+    uint64_t h1 = jsdrv_param_cache_hash(d);
+    assert_false(jsdrv_param_cache_update(d, "s/i/ctrl", &jsdrv_union_u8(1)));
+    assert_true(jsdrv_param_cache_update(d, "s/i/ctrl", &jsdrv_union_u32(1)));  // type change
+    assert_true(jsdrv_param_cache_update(d, "s/i/ctrl", &jsdrv_union_u8(1)));
+    assert_int_equal(h1, jsdrv_param_cache_hash(d));
+
+    char str[16] = "hello";
+    assert_true(jsdrv_param_cache_update(d, "c/name", &jsdrv_union_str(str)));
+    str[0] = 'j';  // cache must hold its own copy
+    assert_true(jsdrv_param_cache_update(d, "c/name", &jsdrv_union_str(str)));
+    assert_false(jsdrv_param_cache_update(d, "c/name", &jsdrv_union_cstr("jello")));
+    uint8_t bin[] = {1, 2, 3};
+    assert_true(jsdrv_param_cache_update(d, "c/bin", &jsdrv_union_bin(bin, sizeof(bin))));
+    assert_false(jsdrv_param_cache_update(d, "c/bin", &jsdrv_union_bin(bin, sizeof(bin))));
+    assert_int_equal(3, jsdrv_param_cache_size(d));
+
+    // hash is independent of update order
+    struct jsdrv_param_cache_device_s * d2 = jsdrv_param_cache_device(c, "u/js220/000002");
+    jsdrv_param_cache_update(d2, "c/bin", &jsdrv_union_bin(bin, sizeof(bin)));
+    jsdrv_param_cache_update(d2, "c/name", &jsdrv_union_cstr("jello"));
+    jsdrv_param_cache_update(d2, "s/i/ctrl", &jsdrv_union_u8(1));
+    assert_int_equal(jsdrv_param_cache_hash(d), jsdrv_param_cache_hash(d2));
+    jsdrv_param_cache_update(d2, "s/i/ctrl", &jsdrv_union_u8(0));
+    assert_true(jsdrv_param_cache_hash(d) != jsdrv_param_cache_hash(d2));
+    jsdrv_param_cache_free(c);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_resume),
+            cmocka_unit_test(test_update),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,687 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * @brief Coverage-guided fuzz harness for the stream and JSON parsers.
+ *
+ * Usage: parser_fuzz [--target js220|js110|json] [--iterations N]
+ *                    [--seed N] [--budget NS_PER_BYTE] [--out DIR] [file ...]
+ *
+ * Each input runs through the JS220 or JS110 stream-in frame parser on a
+ * fresh device, or through jsdrv_json_parse().  Inputs that reach new
+ * edges join the corpus.  Any input whose minimum duration over several
+ * runs exceeds a fixed allowance plus the per-byte budget is saved to
+ * DIR/slow-{target}-{n}.bin, and the exit code is nonzero.  This catches
+ * worst-case paths, such as log storms and resync loops on malformed
+ * frames, that never crash.  With file arguments, the harness runs each
+ * file once and reports its duration against the budget.
+ *
+ * GCC and clang builds collect edge coverage with -fsanitize-coverage=trace-pc
+ * on the device sources.  The JSON target uses the token sequence as
+ * its coverage.  Without coverage, the harness mutates the seeds only.
+ */
+
+#include "jsdrv.h"
+#include "jsdrv/cstr.h"
+#include "jsdrv/log.h"
+#include "jsdrv/time.h"
+#include "jsdrv_prv/backend.h"
+#include "jsdrv_prv/cdef.h"
+#include "jsdrv_prv/frontend.h"
+#include "jsdrv_prv/json.h"
+#include "jsdrv_prv/msg_queue.h"
+#include "jsdrv_prv/platform.h"
+#include "js220_api.h"
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define FRAME_SIZE                  (512U)
+#define INPUT_SIZE_MAX              (32U * FRAME_SIZE)
+#define COV_MAP_SIZE                (1U << 16)
+#define CORPUS_MAX                  (4096U)
+#define ITERATIONS_DEFAULT          (20000U)
+#define BUDGET_NS_PER_BYTE_DEFAULT  (200U)
+#define BUDGET_NS_FIXED             (50000)   // per input, covers device setup noise
+#define SLOW_REPEAT                 (3)
+#define SLOW_SAVE_MAX               (100U)
+#define JS110_PKT_SIZE              (512U)
+
+#ifndef JSDRV_FUZZ_COVERAGE
+#define JSDRV_FUZZ_COVERAGE 0
+#endif
+
+struct input_s {
+    uint8_t * data;
+    uint32_t size;
+};
+
+struct fuzz_s;
+
+struct target_s {
+    const char * name;
+    void (*seed)(struct fuzz_s * self);
+    void (*run)(struct fuzz_s * self, const uint8_t * data, uint32_t size);
+    void (*mutate)(struct fuzz_s * self, uint8_t * data, uint32_t * size);
+};
+
+struct fuzz_s {
+    struct jsdrv_context_s * context;
+    struct jsdrvbk_s backend;
+    const struct target_s * target;
+    uint64_t rng;
+    const char * out_dir;
+    uint32_t budget_ns_per_byte;
+    struct input_s corpus[CORPUS_MAX];
+    uint32_t corpus_size;
+    uint32_t edges;
+    uint32_t flagged;
+    uint64_t execs;
+    uint64_t log_messages;
+    double worst_ns_per_byte;
+    uint32_t json_depth;
+    uint32_t json_prev;
+    uint32_t frame_buf[INPUT_SIZE_MAX / sizeof(uint32_t)];
+    char json_buf[INPUT_SIZE_MAX + 1];
+};
+
+static struct fuzz_s self_;
+
+static uint8_t cov_map_[COV_MAP_SIZE];   // hit counts for the current input
+static uint8_t cov_seen_[COV_MAP_SIZE];  // hit count buckets seen by any input
+static const uint8_t * crash_data_ = NULL;
+static uint32_t crash_size_ = 0;
+
+#if JSDRV_FUZZ_COVERAGE
+static __thread uint32_t cov_active_ = 0;
+static __thread uintptr_t cov_prev_ = 0;
+
+/*
+ * Called by -fsanitize-coverage=trace-pc at every edge in the device
+ * sources.  This file is not instrumented.  Only the fuzz thread records
+ * so the frontend and log threads do not add noise.
+ */
+void __sanitizer_cov_trace_pc(void) {
+    if (!cov_active_) {
+        return;
+    }
+    uintptr_t pc = (uintptr_t) __builtin_return_address(0);
+    uint32_t idx = (uint32_t) ((pc ^ cov_prev_) * 0x9E3779B1U) >> 16;
+    cov_prev_ = pc >> 1;
+    if (cov_map_[idx] < 255) {
+        ++cov_map_[idx];
+    }
+}
+
+static void cov_start(void) {
+    cov_prev_ = 0;
+    cov_active_ = 1;
+}
+
+static void cov_stop(void) {
+    cov_active_ = 0;
+}
+#else
+static void cov_start(void) {}
+static void cov_stop(void) {}
+#endif
+
+static uint64_t rand_u64(struct fuzz_s * self) {
+    // xorshift64*
+    self->rng ^= self->rng >> 12;
+    self->rng ^= self->rng << 25;
+    self->rng ^= self->rng >> 27;
+    return self->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static uint32_t rand_below(struct fuzz_s * self, uint32_t n) {
+    return n ? (uint32_t) (rand_u64(self) % n) : 0;
+}
+
+static uint8_t cov_bucket(uint8_t count) {
+    if (count <= 3) {
+        return (uint8_t) (1U << (count - 1));
+    } else if (count <= 7) {
+        return 0x08;
+    } else if (count <= 15) {
+        return 0x10;
+    } else if (count <= 31) {
+        return 0x20;
+    } else if (count <= 127) {
+        return 0x40;
+    }
+    return 0x80;
+}
+
+static bool cov_merge(struct fuzz_s * self) {
+    bool novel = false;
+    for (uint32_t i = 0; i < COV_MAP_SIZE; ++i) {
+        if (cov_map_[i]) {
+            uint8_t b = cov_bucket(cov_map_[i]);
+            if (b & ~cov_seen_[i]) {
+                if (!cov_seen_[i]) {
+                    ++self->edges;
+                }
+                cov_seen_[i] |= b;
+                novel = true;
+            }
+            cov_map_[i] = 0;
+        }
+    }
+    return novel;
+}
+
+static void corpus_add(struct fuzz_s * self, const uint8_t * data, uint32_t size) {
+    if (self->corpus_size >= CORPUS_MAX) {
+        return;
+    }
+    struct input_s * input = &self->corpus[self->corpus_size++];
+    input->data = malloc(size ? size : 1);
+    memcpy(input->data, data, size);
+    input->size = size;
+}
+
+static void queue_drain(struct fuzz_s * self, struct msg_queue_s * q) {
+    struct jsdrvp_msg_s * msg;
+    while (NULL != (msg = msg_queue_pop_immediate(q))) {
+        jsdrvp_msg_free(self->context, msg);
+    }
+}
+
+static void device_run(struct fuzz_s * self, const uint8_t * data, uint32_t size,
+                       struct jsdrvp_ul_device_s * (*alloc_fn)(struct jsdrv_context_s *, struct jsdrvp_ll_device_s *),
+                       void (*process_fn)(struct jsdrvp_ul_device_s *, struct jsdrvp_msg_s *),
+                       void (*free_fn)(struct jsdrvp_ul_device_s *)) {
+    // The parsers consume whole frames, so zero pad the final frame.
+    uint32_t padded = (size + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+    uint8_t * buf = (uint8_t *) self->frame_buf;
+    memcpy(buf, data, size);
+    memset(buf + size, 0, padded - size);
+
+    struct jsdrvp_ll_device_s ll;
+    memset(&ll, 0, sizeof(ll));
+    jsdrv_cstr_copy(ll.prefix, "u/fuzz/000001", sizeof(ll.prefix));
+    ll.cmd_q = msg_queue_init();
+    ll.rsp_q = msg_queue_init();
+    struct jsdrvp_ul_device_s * device = alloc_fn(self->context, &ll);
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc(self->context);
+    jsdrv_cstr_copy(msg->topic, JSDRV_USBBK_MSG_STREAM_IN_DATA, sizeof(msg->topic));
+    msg->value = jsdrv_union_bin(buf, size);
+
+    cov_start();
+    process_fn(device, msg);
+    cov_stop();
+
+    jsdrvp_msg_free(self->context, msg);
+    free_fn(device);
+    queue_drain(self, ll.cmd_q);
+    queue_drain(self, ll.rsp_q);
+    msg_queue_finalize(ll.cmd_q);
+    msg_queue_finalize(ll.rsp_q);
+}
+
+static void frame_header_mutate(struct fuzz_s * self, uint8_t * data, uint32_t * size, uint32_t hdr) {
+    if (*size < sizeof(uint32_t)) {
+        return;
+    }
+    uint32_t frames = (*size + FRAME_SIZE - 1) / FRAME_SIZE;
+    uint32_t offset = rand_below(self, frames) * FRAME_SIZE;
+    if ((offset + sizeof(uint32_t)) <= *size) {
+        memcpy(data + offset, &hdr, sizeof(hdr));
+    }
+}
+
+static void js220_seed_frame(uint8_t * p, uint16_t frame_id, uint16_t length, uint8_t port_id, uint8_t fill) {
+    uint32_t hdr = js220_frame_hdr_pack(frame_id, length, port_id);
+    memcpy(p, &hdr, sizeof(hdr));
+    memset(p + sizeof(hdr), fill, FRAME_SIZE - sizeof(hdr));
+}
+
+static void js220_seed(struct fuzz_s * self) {
+    static const uint8_t ports[] = {0, 1, 4, 5 + 16, 6 + 16, 7 + 16, 4 + 16, 8 + 16, 13 + 16, 14 + 16};
+    uint8_t buf[4 * FRAME_SIZE];
+    for (uint32_t i = 0; i < sizeof(ports); ++i) {
+        for (uint32_t k = 0; k < 4; ++k) {
+            js220_seed_frame(buf + k * FRAME_SIZE, (uint16_t) k, JS220_PAYLOAD_SIZE_MAX, ports[i], (uint8_t) (0x11 * (k + 1)));
+        }
+        corpus_add(self, buf, sizeof(buf));
+    }
+
+    // current and voltage interleaved with a frame_id skip
+    js220_seed_frame(buf + 0 * FRAME_SIZE, 0, JS220_PAYLOAD_SIZE_MAX, 5 + 16, 0x3f);
+    js220_seed_frame(buf + 1 * FRAME_SIZE, 0, JS220_PAYLOAD_SIZE_MAX, 6 + 16, 0x40);
+    js220_seed_frame(buf + 2 * FRAME_SIZE, 7, JS220_PAYLOAD_SIZE_MAX, 5 + 16, 0x3f);
+    js220_seed_frame(buf + 3 * FRAME_SIZE, 1, 16, 6 + 16, 0x40);
+    corpus_add(self, buf, sizeof(buf));
+}
+
+static void js220_run(struct fuzz_s * self, const uint8_t * data, uint32_t size) {
+    device_run(self, data, size, jsdrvp_ul_js220_usb_fuzz_alloc,
+               jsdrvp_ul_js220_usb_fuzz_process, jsdrvp_ul_js220_usb_fuzz_free);
+}
+
+static void js220_mutate(struct fuzz_s * self, uint8_t * data, uint32_t * size) {
+    uint64_t r = rand_u64(self);
+    uint32_t hdr = js220_frame_hdr_pack((uint16_t) r, (uint16_t) (r >> 16), (uint8_t) (r >> 32));
+    frame_header_mutate(self, data, size, hdr);
+}
+
+static void js110_seed_frame(uint8_t * p, uint16_t pkt_index, uint16_t length, uint8_t fill) {
+    memset(p, fill, FRAME_SIZE);
+    p[0] = 1;  // buffer_type
+    p[1] = 0;  // status
+    p[2] = (uint8_t) (length & 0xff);
+    p[3] = (uint8_t) ((length >> 8) & 0x7f);
+    p[4] = (uint8_t) (pkt_index & 0xff);
+    p[5] = (uint8_t) ((pkt_index >> 8) & 0xff);
+}
+
+static void js110_seed(struct fuzz_s * self) {
+    uint8_t buf[4 * FRAME_SIZE];
+    for (uint32_t k = 0; k < 4; ++k) {
+        js110_seed_frame(buf + k * FRAME_SIZE, (uint16_t) k, JS110_PKT_SIZE, (uint8_t) (0x21 * (k + 1)));
+    }
+    corpus_add(self, buf, sizeof(buf));
+
+    // pkt_index skip within the fill range
+    js110_seed_frame(buf + 2 * FRAME_SIZE, 40, JS110_PKT_SIZE, 0x55);
+    corpus_add(self, buf, sizeof(buf));
+
+    // invalid status and length
+    buf[FRAME_SIZE + 1] = 3;
+    buf[3 * FRAME_SIZE + 2] = 0x10;
+    corpus_add(self, buf, sizeof(buf));
+}
+
+static void js110_run(struct fuzz_s * self, const uint8_t * data, uint32_t size) {
+    device_run(self, data, size, jsdrvp_ul_js110_usb_fuzz_alloc,
+               jsdrvp_ul_js110_usb_fuzz_process, jsdrvp_ul_js110_usb_fuzz_free);
+}
+
+static void js110_mutate(struct fuzz_s * self, uint8_t * data, uint32_t * size) {
+    uint64_t r = rand_u64(self);
+    uint16_t length = (r & 1) ? JS110_PKT_SIZE : (uint16_t) (r >> 1);
+    uint32_t hdr = 1U | ((uint32_t) (length & 0x7fff) << 16);
+    frame_header_mutate(self, data, size, hdr);
+    uint32_t frames = (*size + FRAME_SIZE - 1) / FRAME_SIZE;
+    uint32_t offset = rand_below(self, frames) * FRAME_SIZE + 4;
+    if ((offset + 2) <= *size) {
+        data[offset] = (uint8_t) (r >> 24);
+        data[offset + 1] = (uint8_t) (r >> 32);
+    }
+}
+
+static int32_t json_token(void * user_data, const struct jsdrv_union_s * token) {
+    struct fuzz_s * self = (struct fuzz_s *) user_data;
+    switch (token->op) {
+        case JSDRV_JSON_OBJ_START:  /* intentional fall-through */
+        case JSDRV_JSON_ARRAY_START: ++self->json_depth; break;
+        case JSDRV_JSON_OBJ_END:    /* intentional fall-through */
+        case JSDRV_JSON_ARRAY_END: if (self->json_depth) { --self->json_depth; } break;
+        default: break;
+    }
+    uint32_t depth = (self->json_depth < 8) ? self->json_depth : 8;
+    uint32_t feature = (((uint32_t) token->op) << 8) | (((uint32_t) token->type) << 4) | depth;
+    uint32_t idx = ((feature ^ (self->json_prev << 7)) * 0x9E3779B1U) >> 16;
+    self->json_prev = feature;
+    if (cov_map_[idx] < 255) {
+        ++cov_map_[idx];
+    }
+    return 0;
+}
+
+static void json_seed(struct fuzz_s * self) {
+    static const char * seeds[] = {
+        "{}",
+        "[1, 2, 3]",
+        "{\"a\": 1, \"b\": [true, false, null], \"c\": {\"d\": \"e\"}}",
+        "{\"f\": -1.25e-3, \"g\": NaN, \"h\": \"\\\"\\\\\\n\"}",
+        "[[[[[[[[[[]]]]]]]]]]",
+        "{\"cal\": {\"current\": {\"offset\": [0.0, 1.5, -2], \"gain\": [NaN, 1e9]}}}",
+    };
+    for (uint32_t i = 0; i < JSDRV_ARRAY_SIZE(seeds); ++i) {
+        corpus_add(self, (const uint8_t *) seeds[i], (uint32_t) strlen(seeds[i]));
+    }
+}
+
+static void json_run(struct fuzz_s * self, const uint8_t * data, uint32_t size) {
+    memcpy(self->json_buf, data, size);
+    self->json_buf[size] = 0;
+    self->json_depth = 0;
+    self->json_prev = 0;
+    jsdrv_json_parse(self->json_buf, json_token, self);
+}
+
+static void json_mutate(struct fuzz_s * self, uint8_t * data, uint32_t * size) {
+    static const char * tokens[] = {
+        "{", "}", "[", "]", ",", ":", "\"", "\\", "\\u00", "true", "false", "null", "NaN",
+        "-", "0", "1e", "1.", "\"k\":", "[[[[[[[[", "{\"a\":{\"a\":{\"a\":",
+    };
+    const char * t = tokens[rand_below(self, JSDRV_ARRAY_SIZE(tokens))];
+    uint32_t sz = (uint32_t) strlen(t);
+    if ((*size + sz) > INPUT_SIZE_MAX) {
+        return;
+    }
+    uint32_t offset = rand_below(self, *size + 1);
+    memmove(data + offset + sz, data + offset, *size - offset);
+    memcpy(data + offset, t, sz);
+    *size += sz;
+}
+
+static const struct target_s targets_[] = {
+    {"js220", js220_seed, js220_run, js220_mutate},
+    {"js110", js110_seed, js110_run, js110_mutate},
+    {"json",  json_seed,  json_run,  json_mutate},
+};
+
+static uint32_t mutate(struct fuzz_s * self, uint8_t * data, uint32_t size) {
+    static const uint32_t interesting[] = {0, 1, 0x7f, 0x80, 0xff, 0x100, 0x1ff, 0x200, 0x7fff, 0x8000, 0xffff,
+                                           0x10000, 0x7fffffff, 0x80000000, 0xffffffff};
+    uint32_t stack = 1 + rand_below(self, 4);
+    for (uint32_t n = 0; n < stack; ++n) {
+        uint32_t offset = rand_below(self, size);
+        switch (rand_below(self, 8)) {
+            case 0:
+                if (size) {
+                    data[offset] ^= (uint8_t) (1U << rand_below(self, 8));
+                }
+                break;
+            case 1:
+                if (size) {
+                    data[offset] = (uint8_t) rand_u64(self);
+                }
+                break;
+            case 2: {
+                uint32_t v = interesting[rand_below(self, JSDRV_ARRAY_SIZE(interesting))];
+                uint32_t width = 1U << rand_below(self, 3);
+                if ((offset + width) <= size) {
+                    memcpy(data + offset, &v, width);  // little-endian host
+                }
+                break;
+            }
+            case 3:
+                if (size) {
+                    data[offset] = (uint8_t) (data[offset] + 1 + rand_below(self, 16) - 8);
+                }
+                break;
+            case 4: {
+                uint32_t sz = 1 + rand_below(self, 64);
+                if ((offset + sz) < size) {
+                    memmove(data + offset, data + offset + sz, size - offset - sz);
+                    size -= sz;
+                }
+                break;
+            }
+            case 5: {
+                uint32_t sz = 1 + rand_below(self, 64);
+                if ((size + sz) <= INPUT_SIZE_MAX) {
+                    memmove(data + offset + sz, data + offset, size - offset);
+                    for (uint32_t i = 0; i < sz; ++i) {
+                        data[offset + i] = (uint8_t) rand_u64(self);
+                    }
+                    size += sz;
+                }
+                break;
+            }
+            case 6: {
+                const struct input_s * other = &self->corpus[rand_below(self, self->corpus_size)];
+                uint32_t src = rand_below(self, other->size);
+                uint32_t sz = rand_below(self, other->size - src + 1);
+                if ((offset + sz) > INPUT_SIZE_MAX) {
+                    sz = INPUT_SIZE_MAX - offset;
+                }
+                memcpy(data + offset, other->data + src, sz);
+                if ((offset + sz) > size) {
+                    size = offset + sz;
+                }
+                break;
+            }
+            default:
+                self->target->mutate(self, data, &size);
+                break;
+        }
+    }
+    return size;
+}
+
+static int64_t run_timed(struct fuzz_s * self, const uint8_t * data, uint32_t size) {
+    crash_data_ = data;
+    crash_size_ = size;
+    int64_t t_start = jsdrv_time_utc();
+    self->target->run(self, data, size);
+    int64_t t_end = jsdrv_time_utc();
+    crash_data_ = NULL;
+    ++self->execs;
+    return JSDRV_TIME_TO_NANOSECONDS(t_end - t_start);
+}
+
+static int64_t budget_ns(struct fuzz_s * self, uint32_t size) {
+    return BUDGET_NS_FIXED + (int64_t) self->budget_ns_per_byte * size;
+}
+
+static void save(struct fuzz_s * self, const char * kind, uint32_t index, const uint8_t * data, uint32_t size) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s-%s-%" PRIu32 ".bin", self->out_dir, kind, self->target->name, index);
+    FILE * f = fopen(path, "wb");
+    if (NULL == f) {
+        printf("could not open %s\n", path);
+        return;
+    }
+    fwrite(data, 1, size, f);
+    fclose(f);
+    printf("saved %s\n", path);
+}
+
+static void on_crash(int sig) {
+    // best effort: keep the input that triggered the fault
+    if (crash_data_) {
+        save(&self_, "crash", 0, crash_data_, crash_size_);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/**
+ * @brief Run one input and check its duration against the budget.
+ *
+ * @return The minimum duration in nanoseconds.  A slow first run repeats
+ *      with a fresh device so that scheduler noise does not flag an input.
+ */
+static int64_t run_checked(struct fuzz_s * self, const uint8_t * data, uint32_t size, bool * slow) {
+    int64_t budget = budget_ns(self, size);
+    int64_t duration = run_timed(self, data, size);
+    for (int i = 0; (i < SLOW_REPEAT) && (duration > budget); ++i) {
+        memset(cov_map_, 0, sizeof(cov_map_));
+        int64_t d = run_timed(self, data, size);
+        if (d < duration) {
+            duration = d;
+        }
+    }
+    *slow = duration > budget;
+    double ns_per_byte = (double) duration / (size ? size : 1);
+    if (ns_per_byte > self->worst_ns_per_byte) {
+        self->worst_ns_per_byte = ns_per_byte;
+    }
+    return duration;
+}
+
+static void on_log(void * user_data, struct jsdrv_log_header_s const * header,
+                   const char * filename, const char * message) {
+    (void) header;
+    (void) filename;
+    (void) message;
+    ++((struct fuzz_s *) user_data)->log_messages;
+}
+
+static void bk_finalize(struct jsdrvbk_s * backend) {
+    msg_queue_finalize(backend->cmd_q);
+}
+
+int32_t jsdrv_unittest_backend_factory(struct jsdrv_context_s * context, struct jsdrvbk_s ** backend) {
+    struct fuzz_s * self = &self_;
+    self->backend.prefix = 't';
+    self->backend.finalize = bk_finalize;
+    self->backend.cmd_q = msg_queue_init();
+    *backend = &self->backend;
+    struct jsdrvp_msg_s * msg = jsdrvp_msg_alloc_value(context, JSDRV_MSG_INITIALIZE, &jsdrv_union_i32(0));
+    msg->payload.str[0] = self->backend.prefix;
+    jsdrvp_backend_send(context, msg);
+    return 0;
+}
+
+static int usage(void) {
+    printf("usage: parser_fuzz [--target js220|js110|json] [--iterations N] [--seed N]\n"
+           "                   [--budget NS_PER_BYTE] [--out DIR] [file ...]\n");
+    return 1;
+}
+
+static int replay(struct fuzz_s * self, int argc, char * argv[]) {
+    static uint8_t data[INPUT_SIZE_MAX];
+    int rv = 0;
+    for (int i = 0; i < argc; ++i) {
+        FILE * f = fopen(argv[i], "rb");
+        if (NULL == f) {
+            printf("could not open %s\n", argv[i]);
+            return 1;
+        }
+        uint32_t size = (uint32_t) fread(data, 1, sizeof(data), f);
+        fclose(f);
+        bool slow = false;
+        int64_t duration = run_checked(self, data, size, &slow);
+        printf("%s: %" PRIu32 " bytes, %" PRId64 " ns, budget %" PRId64 " ns%s\n",
+               argv[i], size, duration, budget_ns(self, size), slow ? ", SLOW" : "");
+        rv |= slow ? 1 : 0;
+    }
+    return rv;
+}
+
+static void fuzz(struct fuzz_s * self, uint32_t iterations) {
+    static uint8_t data[INPUT_SIZE_MAX];
+    bool slow = false;
+    uint32_t seeds = self->corpus_size;
+    for (uint32_t i = 0; i < seeds; ++i) {
+        run_checked(self, self->corpus[i].data, self->corpus[i].size, &slow);
+        cov_merge(self);
+        if (slow) {
+            save(self, "slow", self->flagged++, self->corpus[i].data, self->corpus[i].size);
+        }
+    }
+
+    int64_t t_report = jsdrv_time_utc() + JSDRV_TIME_SECOND;
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+        const struct input_s * parent = &self->corpus[rand_below(self, self->corpus_size)];
+        memcpy(data, parent->data, parent->size);
+        uint32_t size = mutate(self, data, parent->size);
+        int64_t duration = run_checked(self, data, size, &slow);
+        if (cov_merge(self)) {
+            corpus_add(self, data, size);
+        }
+        if (slow) {
+            printf("slow input: %" PRIu32 " bytes, %" PRId64 " ns, budget %" PRId64 " ns\n",
+                   size, duration, budget_ns(self, size));
+            if (self->flagged < SLOW_SAVE_MAX) {
+                save(self, "slow", self->flagged, data, size);
+            }
+            ++self->flagged;
+        }
+        int64_t t_now = jsdrv_time_utc();
+        if (t_now >= t_report) {
+            printf("execs %" PRIu64 ", corpus %" PRIu32 ", edges %" PRIu32 ", slow %" PRIu32
+                   ", worst %.1f ns/byte, logs %" PRIu64 "\n",
+                   self->execs, self->corpus_size, self->edges, self->flagged,
+                   self->worst_ns_per_byte, self->log_messages);
+            t_report = t_now + JSDRV_TIME_SECOND;
+        }
+    }
+}
+
+int main(int argc, char * argv[]) {
+    struct fuzz_s * self = &self_;
+    uint32_t iterations = ITERATIONS_DEFAULT;
+    self->target = &targets_[0];
+    self->rng = 1;
+    self->out_dir = ".";
+    self->budget_ns_per_byte = BUDGET_NS_PER_BYTE_DEFAULT;
+
+    --argc; ++argv;
+    while (argc && (argv[0][0] == '-')) {
+        if (argc < 2) {
+            return usage();
+        } else if (0 == strcmp(argv[0], "--target")) {
+            self->target = NULL;
+            for (uint32_t i = 0; i < JSDRV_ARRAY_SIZE(targets_); ++i) {
+                if (0 == strcmp(argv[1], targets_[i].name)) {
+                    self->target = &targets_[i];
+                }
+            }
+            if (NULL == self->target) {
+                return usage();
+            }
+        } else if (0 == strcmp(argv[0], "--iterations")) {
+            iterations = (uint32_t) strtoul(argv[1], NULL, 0);
+        } else if (0 == strcmp(argv[0], "--seed")) {
+            self->rng = strtoull(argv[1], NULL, 0) | 1;
+        } else if (0 == strcmp(argv[0], "--budget")) {
+            self->budget_ns_per_byte = (uint32_t) strtoul(argv[1], NULL, 0);
+        } else if (0 == strcmp(argv[0], "--out")) {
+            self->out_dir = argv[1];
+        } else {
+            return usage();
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    signal(SIGSEGV, on_crash);
+    signal(SIGABRT, on_crash);
+    signal(SIGFPE, on_crash);
+    jsdrv_log_initialize();
+    jsdrv_log_level_set(JSDRV_LOG_LEVEL_WARNING);
+    jsdrv_log_register(on_log, self);
+    if (jsdrv_initialize(&self->context, NULL, 1000)) {
+        printf("jsdrv_initialize failed\n");
+        return 1;
+    }
+
+    int rv;
+    if (argc) {
+        rv = replay(self, argc, argv);
+    } else {
+        printf("parser_fuzz target=%s, iterations=%" PRIu32 ", budget=%" PRIu32 " ns/byte + %d ns, coverage=%s\n",
+               self->target->name, iterations, self->budget_ns_per_byte, BUDGET_NS_FIXED,
+               (self->target->run == json_run) ? "tokens" : (JSDRV_FUZZ_COVERAGE ? "trace-pc" : "none"));
+        self->target->seed(self);
+        fuzz(self, iterations);
+        printf("done: execs %" PRIu64 ", corpus %" PRIu32 ", edges %" PRIu32 ", slow %" PRIu32
+               ", worst %.1f ns/byte, logs %" PRIu64 "\n",
+               self->execs, self->corpus_size, self->edges, self->flagged,
+               self->worst_ns_per_byte, self->log_messages);
+        rv = self->flagged ? 1 : 0;
+    }
+
+    jsdrv_finalize(self->context, 1000);
+    jsdrv_log_unregister(on_log, self);
+    jsdrv_log_finalize();
+    for (uint32_t i = 0; i < self->corpus_size; ++i) {
+        free(self->corpus[i].data);
+    }
+    return rv;
+}
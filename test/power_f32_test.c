@@ -0,0 +1,173 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/power_f32.h"
+#include <math.h>
+#include <string.h>
+
+
+#define I JSDRV_POWER_F32_CURRENT
+#define V JSDRV_POWER_F32_VOLTAGE
+
+static struct jsdrv_power_f32_s p_;
+
+static int setup(void **state) {
+    (void) state;
+    jsdrv_power_f32_clear(&p_, 2);
+    return 0;
+}
+
+static void add_ramp(uint8_t side, uint64_t sample_id, uint32_t length, float k) {
+    float data[256];
+    for (uint32_t i = 0; i < length; ++i) {
+        data[i] = k * (float) ((sample_id / 2) + i);
+    }
+    jsdrv_power_f32_add(&p_, side, sample_id, data, length);
+}
+
+static void test_empty(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    float p[4];
+    assert_int_equal(0, jsdrv_power_f32_available(&p_, &sample_id));
+    add_ramp(I, 1000, 100, 1.0f);
+    assert_int_equal(0, jsdrv_power_f32_available(&p_, &sample_id));
+    assert_int_equal(0, jsdrv_power_f32_mult(&p_, p, 4));
+}
+
+static void test_interleaved(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    float p[256];
+    for (uint32_t k = 0; k < 100; ++k) {
+        uint64_t id = 1000 + k * 200;
+        add_ramp(I, id, 100, 1.0f);
+        assert_int_equal(0, jsdrv_power_f32_available(&p_, &sample_id));
+        add_ramp(V, id, 100, 2.0f);
+        assert_int_equal(100, jsdrv_power_f32_available(&p_, &sample_id));
+        assert_int_equal(id, sample_id);
+        assert_int_equal(100, jsdrv_power_f32_mult(&p_, p, 256));
+        for (uint32_t i = 0; i < 100; ++i) {
+            float x = (float) (id / 2 + i);
+            assert_true((x * 2.0f * x) == p[i]);
+        }
+    }
+}
+
+static void test_partial_and_lag(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    float p[256];
+    add_ramp(I, 1000, 100, 1.0f);
+    add_ramp(I, 1200, 100, 1.0f);
+    add_ramp(V, 1000, 50, 1.0f);
+    assert_int_equal(50, jsdrv_power_f32_available(&p_, &sample_id));
+    assert_int_equal(20, jsdrv_power_f32_mult(&p_, p, 20));  // limited by output
+    assert_int_equal(30, jsdrv_power_f32_mult(&p_, p, 256));
+    assert_true((549.0f * 549.0f) == p[29]);
+    add_ramp(V, 1100, 150, 1.0f);
+    assert_int_equal(150, jsdrv_power_f32_available(&p_, &sample_id));
+    assert_int_equal(1100, sample_id);
+}
+
+static void test_peek(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    float p[256];
+    add_ramp(I, 1000, 100, 1.0f);
+    add_ramp(V, 1040, 100, 2.0f);
+    assert_int_equal(80, jsdrv_power_f32_available(&p_, &sample_id));
+    assert_int_equal(1040, sample_id);
+    const float * i = jsdrv_power_f32_peek(&p_, I);
+    const float * v = jsdrv_power_f32_peek(&p_, V);
+    assert_int_equal(80, jsdrv_power_f32_mult(&p_, p, 256));
+    for (uint32_t k = 0; k < 80; ++k) {  // still valid after mult
+        assert_true((float) (520 + k) == i[k]);
+        assert_true((2.0f * (float) (520 + k)) == v[k]);
+        assert_true((i[k] * v[k]) == p[k]);
+    }
+}
+
+static void test_gap_nan_fill(void **state) {
+    (void) state;
+    float p[256];
+    add_ramp(I, 1000, 10, 1.0f);
+    add_ramp(I, 1040, 10, 1.0f);  // 10 sample gap
+    add_ramp(V, 1000, 30, 1.0f);
+    assert_int_equal(30, jsdrv_power_f32_mult(&p_, p, 256));
+    assert_false(isnan(p[9]));
+    for (uint32_t i = 10; i < 20; ++i) {
+        assert_true(isnan(p[i]));
+    }
+    assert_false(isnan(p[20]));
+    assert_true((520.0f * 520.0f) == p[20]);
+}
+
+static void test_orphans_discarded(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    add_ramp(I, 1000, 100, 1.0f);
+    add_ramp(V, 1100, 100, 1.0f);
+    assert_int_equal(50, jsdrv_power_f32_available(&p_, &sample_id));
+    assert_int_equal(1100, sample_id);
+}
+
+static void test_large_gap_resync(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    add_ramp(I, 1000, 100, 1.0f);
+    add_ramp(I, 1000000, 100, 1.0f);  // gap longer than the buffer
+    assert_int_equal(100, p_.side[I].length);
+    add_ramp(V, 1000000, 100, 1.0f);
+    assert_int_equal(100, jsdrv_power_f32_available(&p_, &sample_id));
+    assert_int_equal(1000000, sample_id);
+}
+
+static void test_overflow_discards_oldest(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    const uint32_t count = JSDRV_POWER_F32_LENGTH / 100 + 10;
+    for (uint32_t k = 0; k < count; ++k) {
+        add_ramp(I, 1000 + k * 200, 100, 1.0f);
+    }
+    assert_true(p_.side[I].length <= JSDRV_POWER_F32_LENGTH);
+    uint64_t end = 1000 + count * 200;
+    assert_int_equal(end, p_.side[I].sample_id + 2 * p_.side[I].length);
+    add_ramp(V, end - 200, 100, 1.0f);
+    assert_int_equal(100, jsdrv_power_f32_available(&p_, &sample_id));
+    assert_int_equal(end - 200, sample_id);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test_setup(test_empty, setup),
+            cmocka_unit_test_setup(test_interleaved, setup),
+            cmocka_unit_test_setup(test_partial_and_lag, setup),
+            cmocka_unit_test_setup(test_peek, setup),
+            cmocka_unit_test_setup(test_gap_nan_fill, setup),
+            cmocka_unit_test_setup(test_orphans_discarded, setup),
+            cmocka_unit_test_setup(test_large_gap_resync, setup),
+            cmocka_unit_test_setup(test_overflow_discards_oldest, setup),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -24,7 +24,9 @@
 #include "jsdrv_prv/platform.h"
 #include "jsdrv_prv/frontend.h"
 #include "jsdrv_prv/backend.h"
+#include "jsdrv_prv/thread.h"
 #include "jsdrv/cstr.h"
+#include "jsdrv/error_code.h"
 #include <stdarg.h>
 #include <stdio.h>
 
@@ -40,6 +42,13 @@ static const char * META2 = "{"
     "\"default\": 0"
 "}";
 
+static const char * META_OPT = "{"
+    "\"dtype\": \"u8\","
+    "\"brief\": \"Select something.\","
+    "\"default\": 0,"
+    "\"options\": [[0, \"off\"], [1, \"on\"]]"
+"}";
+
 
 #define SETUP() \
     (void) state;                                              \
@@ -134,10 +143,28 @@ struct jsdrvp_msg_s * jsdrvp_msg_alloc_value(struct jsdrv_context_s * context, c
 void jsdrvp_msg_free(struct jsdrv_context_s * context, struct jsdrvp_msg_s * msg) {
     (void) context;
     if (msg) {
+        if (msg->refcnt) {
+            --msg->refcnt;
+            return;
+        }
         jsdrv_free(msg);
     }
 }
 
+void jsdrvp_msg_cache_attach(struct jsdrv_context_s * context) {
+    (void) context;
+}
+
+void jsdrvp_msg_cache_detach(struct jsdrv_context_s * context) {
+    (void) context;
+}
+
+void jsdrvp_thread_configure(struct jsdrv_context_s * context, enum jsdrvp_thread_e thread, const char * name) {
+    (void) context;
+    (void) thread;
+    (void) name;
+}
+
 static struct jsdrvp_msg_s * subscribe_msg(struct jsdrv_pubsub_s * p, const char * topic, uint8_t flags, const char * op) {
     (void) p;
     struct jsdrvp_msg_s * m = jsdrvp_msg_alloc(NULL);
@@ -263,9 +290,14 @@ static void test_unsubscribe(void ** state) {
 static void test_unsubscribe_all(void ** state) {
     SETUP();
     subscribe_internal(p, "u/js110/123456/hello", JSDRV_SFLAG_PUB);
+    subscribe_internal(p, "u/js110/123456/other", JSDRV_SFLAG_PUB);
+    subscribe_internal(p, "u/js110", JSDRV_SFLAG_PUB);
+    subscribe_external(p, "u/js110/123456/hello", JSDRV_SFLAG_PUB);
     unsubscribe_all_internal(p, "");
     jsdrv_pubsub_process(p);
     publish_str(p, "u/js110/123456/hello", "world");
+    publish_str(p, "u/js110/123456/other", "world");
+    expect_publish_external("u/js110/123456/hello", &jsdrv_union_str("world"));  // other subscribers remain
     jsdrv_pubsub_process(p);
     TEARDOWN();
 }
@@ -334,6 +366,34 @@ static void test_meta(void ** state) {
     TEARDOWN();
 }
 
+static void test_meta_shared(void ** state) {
+    SETUP();
+    publish(p, "u/js220/1/h/led$", &jsdrv_union_json(META_OPT));
+    publish(p, "u/js220/2/h/led$", &jsdrv_union_json(META_OPT));
+    subscribe_internal(p, "u/js220", JSDRV_SFLAG_PUB | JSDRV_SFLAG_RETURN_CODE);
+    jsdrv_pubsub_process(p);
+
+    // both devices validate with the shared metadata
+    publish(p, "u/js220/1/h/led", &jsdrv_union_u32_r(7));
+    expect_publish_internal("u/js220/1/h/led#", &jsdrv_union_i32(JSDRV_ERROR_PARAMETER_INVALID));
+    publish(p, "u/js220/2/h/led", &jsdrv_union_u32_r(7));
+    expect_publish_internal("u/js220/2/h/led#", &jsdrv_union_i32(JSDRV_ERROR_PARAMETER_INVALID));
+    jsdrv_pubsub_process(p);
+
+    // replacing one device's metadata does not affect the other
+    publish(p, "u/js220/1/h/led$", &jsdrv_union_json(META2));
+    publish(p, "u/js220/1/h/led", &jsdrv_union_u32_r(7));
+    expect_publish_internal("u/js220/1/h/led", &jsdrv_union_u32_r(7));
+    publish(p, "u/js220/2/h/led", &jsdrv_union_u32_r(7));
+    expect_publish_internal("u/js220/2/h/led#", &jsdrv_union_i32(JSDRV_ERROR_PARAMETER_INVALID));
+    jsdrv_pubsub_process(p);
+
+    subscribe_external(p, "u/js220/2", JSDRV_SFLAG_METADATA_RSP | JSDRV_SFLAG_RETAIN);
+    expect_publish_external("u/js220/2/h/led$", &jsdrv_union_json(META_OPT));
+    jsdrv_pubsub_process(p);
+    TEARDOWN();
+}
+
 #define query(topic__, buf__)                                                           \
     m = jsdrvp_msg_alloc_value(NULL, JSDRV_PUBSUB_QUERY, &jsdrv_union_i32(0));            \
     jsdrv_cstr_copy(m->payload.query.topic, topic__, sizeof(m->payload.query.topic));     \
@@ -358,6 +418,11 @@ static void test_query(void ** state) {
     jsdrv_pubsub_process(p);
     assert_string_equal(str1, buf);
 
+    buf[0] = 0;
+    query("u/hello//", buf);  // trailing separators
+    jsdrv_pubsub_process(p);
+    assert_string_equal(str1, buf);
+
     query("u/there", buf);
     jsdrv_pubsub_process(p);
     assert_int_equal(42, v.value.u32);
@@ -365,6 +430,231 @@ static void test_query(void ** state) {
     TEARDOWN();
 }
 
+static void test_subscriber_cache_invalidate(void ** state) {
+    SETUP();
+    subscribe_internal(p, "u/js110/123456/hello", JSDRV_SFLAG_PUB);
+    jsdrv_pubsub_process(p);
+    publish_str(p, "u/js110/123456/hello", "a");
+    expect_publish_internal("u/js110/123456/hello", &jsdrv_union_str("a"));
+    jsdrv_pubsub_process(p);
+
+    subscribe_external(p, "u/js110", JSDRV_SFLAG_PUB);  // parent change invalidates child
+    publish_str(p, "u/js110/123456/hello", "b");
+    expect_publish_internal("u/js110/123456/hello", &jsdrv_union_str("b"));
+    expect_publish_external("u/js110/123456/hello", &jsdrv_union_str("b"));
+    jsdrv_pubsub_process(p);
+
+    unsubscribe_internal(p, "u/js110/123456/hello");
+    publish_str(p, "u/js110/123456/hello", "c");
+    expect_publish_external("u/js110/123456/hello", &jsdrv_union_str("c"));
+    jsdrv_pubsub_process(p);
+
+    unsubscribe_external_all(p, "");
+    publish_str(p, "u/js110/123456/hello", "d");
+    jsdrv_pubsub_process(p);
+    TEARDOWN();
+}
+
+static void test_stream(void ** state) {
+    SETUP();
+    publish_str(p, "u/js110/123456/s/i/!data$", META1);  // bool metadata, would reject u32 7
+    subscribe_internal(p, "u/js110/123456/s/i/!data", JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM);
+    subscribe_internal(p, "u/js110/123456/s/i/ctrl", JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM);
+    jsdrv_pubsub_process(p);
+
+    publish(p, "u/js110/123456/s/i/!data", &jsdrv_union_u32_r(7));  // not validated against META1
+    expect_publish_internal("u/js110/123456/s/i/!data", &jsdrv_union_u32_r(7));
+    publish(p, "u/js110/123456/s/i/!data", &jsdrv_union_u32_r(7));  // no dedup
+    expect_publish_internal("u/js110/123456/s/i/!data", &jsdrv_union_u32_r(7));
+    publish(p, "u/js110/123456/s/i/ctrl", &jsdrv_union_u32_r(1));  // not a stream topic, retained
+    expect_publish_internal("u/js110/123456/s/i/ctrl", &jsdrv_union_u32_r(1));
+    publish(p, "u/js110/123456/s/i/ctrl", &jsdrv_union_u32_r(1));  // dedup
+    jsdrv_pubsub_process(p);
+    TEARDOWN();
+}
+
+static void publish_id(struct jsdrv_pubsub_s * p, uint32_t topic_id, struct jsdrv_union_s * value) {
+    struct jsdrvp_msg_s * m = jsdrvp_msg_alloc_value(NULL, "", value);
+    m->topic_id = topic_id;
+    jsdrv_pubsub_publish(p, m);
+}
+
+static void test_topic_intern(void ** state) {
+    SETUP();
+    assert_int_equal(0, jsdrv_pubsub_topic_intern(p, ""));
+    uint32_t id1 = jsdrv_pubsub_topic_intern(p, "u/js110/123456/s/i/!data");
+    uint32_t id2 = jsdrv_pubsub_topic_intern(p, "u/js110/123456/s/v/!data");
+    assert_int_not_equal(0, id1);
+    assert_int_not_equal(0, id2);
+    assert_int_not_equal(id1, id2);
+    assert_int_equal(id1, jsdrv_pubsub_topic_intern(p, "u/js110/123456/s/i/!data"));
+    assert_string_equal("u/js110/123456/s/v/!data", jsdrv_pubsub_topic_name(p, id2));
+    assert_null(jsdrv_pubsub_topic_name(p, 0));
+    assert_null(jsdrv_pubsub_topic_name(p, id2 + 1));
+
+    subscribe_internal(p, "u/js110/123456/s/i/!data", JSDRV_SFLAG_PUB | JSDRV_SFLAG_STREAM);
+    subscribe_internal(p, "u/js110/123456/s/v/!data", JSDRV_SFLAG_PUB);
+    jsdrv_pubsub_process(p);
+    publish_id(p, id1, &jsdrv_union_u32(1));
+    expect_publish_internal("u/js110/123456/s/i/!data", &jsdrv_union_u32(1));
+    publish_id(p, id2, &jsdrv_union_u32(2));
+    expect_publish_internal("u/js110/123456/s/v/!data", &jsdrv_union_u32(2));
+    jsdrv_pubsub_process(p);
+    TEARDOWN();
+}
+
+static void test_wildcard(void ** state) {
+    SETUP();
+    publish(p, "u/js110/123456/s/i/ctrl", &jsdrv_union_u32_r(1));
+    subscribe_internal(p, "u/+/+/s/+/!data", JSDRV_SFLAG_PUB);
+    subscribe_internal(p, "u/#/s", JSDRV_SFLAG_PUB);  // invalid, ignored
+    subscribe_external(p, "u/js110/#", JSDRV_SFLAG_PUB | JSDRV_SFLAG_RETAIN);
+    expect_publish_external("u/js110/123456/s/i/ctrl", &jsdrv_union_u32_r(1));
+    jsdrv_pubsub_process(p);
+
+    publish(p, "u/js110/123456/s/i/!data", &jsdrv_union_u32(2));
+    expect_publish_internal("u/js110/123456/s/i/!data", &jsdrv_union_u32(2));
+    expect_publish_external("u/js110/123456/s/i/!data", &jsdrv_union_u32(2));
+    publish(p, "u/js110/123456/s/i/ctrl", &jsdrv_union_u32_r(3));
+    expect_publish_external("u/js110/123456/s/i/ctrl", &jsdrv_union_u32_r(3));
+    publish(p, "u/js220/123456/s/v/!data", &jsdrv_union_u32(4));
+    expect_publish_internal("u/js220/123456/s/v/!data", &jsdrv_union_u32(4));
+    publish(p, "u/js220/123456/s/v/!data/x", &jsdrv_union_u32(5));
+    jsdrv_pubsub_process(p);
+
+    unsubscribe_internal(p, "u/+/+/s/+/!data");
+    unsubscribe_external_all(p, "");
+    publish(p, "u/js110/123456/s/i/!data", &jsdrv_union_u32(6));
+    jsdrv_pubsub_process(p);
+    TEARDOWN();
+}
+
+static void watcher(struct jsdrv_pubsub_s * p, const char * topic, const char * op) {
+    struct jsdrvp_msg_s * m = subscribe_msg(p, topic, JSDRV_SFLAG_PUB, op);
+    m->payload.sub.subscriber.user_data = (void *) 1;
+    jsdrv_pubsub_publish(p, m);
+}
+
+static void test_watch(void ** state) {
+    SETUP();
+    watcher(p, "u/js220/123456", JSDRV_PUBSUB_SUBSCRIBE);  // the watcher's own subscription does not count
+    watcher(p, "u/js220/123456/s/i/!data", JSDRV_PUBSUB_WATCH);
+    expect_publish_internal("u/js220/123456/s/i/!data", &jsdrv_union_u32(0));
+    jsdrv_pubsub_process(p);
+
+    subscribe_internal(p, "u/js220/123456/s/i/!data", JSDRV_SFLAG_PUB);
+    expect_publish_internal("u/js220/123456/s/i/!data", &jsdrv_union_u32(1));
+    jsdrv_pubsub_process(p);
+    subscribe_external(p, "u/+/+/s/+/!data", JSDRV_SFLAG_PUB);
+    expect_publish_internal("u/js220/123456/s/i/!data", &jsdrv_union_u32(2));
+    jsdrv_pubsub_process(p);
+    subscribe_internal(p, "u/js220/123456/s/v/!data", JSDRV_SFLAG_PUB);  // other topic, no change
+    subscribe_internal(p, "u/js220", 0);                                 // no JSDRV_SFLAG_PUB, no change
+    jsdrv_pubsub_process(p);
+
+    unsubscribe_internal(p, "u/js220/123456/s/i/!data");
+    expect_publish_internal("u/js220/123456/s/i/!data", &jsdrv_union_u32(1));
+    jsdrv_pubsub_process(p);
+    unsubscribe_external_all(p, "");
+    expect_publish_internal("u/js220/123456/s/i/!data", &jsdrv_union_u32(0));
+    jsdrv_pubsub_process(p);
+
+    watcher(p, "u/js220/123456/s/i/!data", JSDRV_PUBSUB_UNWATCH);
+    subscribe_internal(p, "u/js220/123456/s/i/!data", JSDRV_SFLAG_PUB);
+    jsdrv_pubsub_process(p);
+
+    watcher(p, "u/js220/123456/s/i/!data", JSDRV_PUBSUB_WATCH);
+    expect_publish_internal("u/js220/123456/s/i/!data", &jsdrv_union_u32(1));
+    jsdrv_pubsub_process(p);
+    watcher(p, "u/js220/123456", JSDRV_PUBSUB_UNSUBSCRIBE);  // also removes the watch
+    unsubscribe_internal(p, "u/js220/123456/s/i/!data");
+    jsdrv_pubsub_process(p);
+    TEARDOWN();
+}
+
+static void test_coalesce(void ** state) {
+    SETUP();
+    struct jsdrvp_msg_s * m = subscribe_msg(p, "u/js220/123456/s/i/avg", JSDRV_SFLAG_PUB, JSDRV_PUBSUB_SUBSCRIBE);
+    m->payload.sub.subscriber.coalesce_ms = 50;
+    jsdrv_pubsub_publish(p, m);
+    jsdrv_pubsub_process(p);
+    assert_int_equal(UINT32_MAX, jsdrv_pubsub_timeout_ms(p));
+
+    publish(p, "u/js220/123456/s/i/avg", &jsdrv_union_u32_r(1));
+    expect_publish_internal("u/js220/123456/s/i/avg", &jsdrv_union_u32_r(1));
+    jsdrv_pubsub_process(p);
+    publish(p, "u/js220/123456/s/i/avg", &jsdrv_union_u32_r(2));
+    publish(p, "u/js220/123456/s/i/avg", &jsdrv_union_u32_r(3));
+    jsdrv_pubsub_process(p);  // within interval, hold newest only
+    uint32_t timeout_ms = jsdrv_pubsub_timeout_ms(p);
+    assert_true(timeout_ms <= 50);
+
+    jsdrv_thread_sleep_ms(timeout_ms + 10);
+    assert_int_equal(0, jsdrv_pubsub_timeout_ms(p));
+    expect_publish_internal("u/js220/123456/s/i/avg", &jsdrv_union_u32_r(3));
+    jsdrv_pubsub_process(p);
+    assert_int_equal(UINT32_MAX, jsdrv_pubsub_timeout_ms(p));
+
+    publish(p, "u/js220/123456/s/i/avg", &jsdrv_union_u32_r(4));
+    unsubscribe_internal(p, "u/js220/123456/s/i/avg");  // discards pending
+    jsdrv_pubsub_process(p);
+    assert_int_equal(UINT32_MAX, jsdrv_pubsub_timeout_ms(p));
+    TEARDOWN();
+}
+
+static void test_stats(void ** state) {
+    SETUP();
+    char buf[512];
+    subscribe_internal(p, "u/js220/123456/s/i/avg", JSDRV_SFLAG_PUB);
+    jsdrv_pubsub_process(p);
+    publish(p, "u/js220/123456/s/v/avg", &jsdrv_union_u32_r(1));  // not counted
+    jsdrv_pubsub_process(p);
+
+    jsdrv_pubsub_stats_enable(p, true);
+    publish(p, "u/js220/123456/s/v/avg", &jsdrv_union_u32_r(2));
+    publish(p, "u/js220/123456/s/i/avg", &jsdrv_union_u32_r(3));
+    expect_publish_internal("u/js220/123456/s/i/avg", &jsdrv_union_u32_r(3));
+    publish(p, "u/js220/123456/s/i/avg", &jsdrv_union_u32_r(4));
+    expect_publish_internal("u/js220/123456/s/i/avg", &jsdrv_union_u32_r(4));
+    jsdrv_pubsub_process(p);
+    assert_int_equal(2, jsdrv_pubsub_stats(p, buf, sizeof(buf)));
+    assert_non_null(strstr(buf, "{\"topic\": \"u/js220/123456/s/i/avg\", \"messages\": 2, \"bytes\": 0, \"calls\": 2, "));
+    assert_non_null(strstr(buf, "{\"topic\": \"u/js220/123456/s/v/avg\", \"messages\": 1, \"bytes\": 0, \"calls\": 0, "));
+
+    assert_int_equal(0, jsdrv_pubsub_stats(p, buf, sizeof(buf)));  // reset
+    assert_string_equal("[]", buf);
+    jsdrv_pubsub_stats_enable(p, false);
+    TEARDOWN();
+}
+
+static void test_many_topics(void ** state) {
+    SETUP();
+    struct jsdrvp_msg_s * m;
+    struct jsdrv_union_s v;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+    char buf[32];
+
+    for (uint32_t i = 0; i < 600; ++i) {  // grow hash index
+        snprintf(topic, sizeof(topic), "u/js220/%u/s/p%u", (unsigned int) (i % 12), (unsigned int) i);
+        publish(p, topic, &jsdrv_union_u32_r(i));
+    }
+    jsdrv_pubsub_process(p);
+    for (uint32_t i = 0; i < 600; i += 7) {
+        snprintf(topic, sizeof(topic), "u/js220/%u/s/p%u", (unsigned int) (i % 12), (unsigned int) i);
+        query(topic, buf);
+        jsdrv_pubsub_process(p);
+        assert_int_equal(i, v.value.u32);
+    }
+
+    // trailing separator and parent subscriptions resolve to the same topics
+    subscribe_internal(p, "u/js220/3/", JSDRV_SFLAG_PUB);
+    jsdrv_pubsub_process(p);
+    publish_str(p, "u/js220/3/s/p3", "x");
+    expect_publish_internal("u/js220/3/s/p3", &jsdrv_union_str("x"));
+    jsdrv_pubsub_process(p);
+    TEARDOWN();
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_subscribe_then_publish),
@@ -379,7 +669,16 @@ int main(void) {
             cmocka_unit_test(test_external_retain),
             cmocka_unit_test(test_return_code),
             cmocka_unit_test(test_meta),
+            cmocka_unit_test(test_meta_shared),
             cmocka_unit_test(test_query),
+            cmocka_unit_test(test_subscriber_cache_invalidate),
+            cmocka_unit_test(test_stream),
+            cmocka_unit_test(test_topic_intern),
+            cmocka_unit_test(test_wildcard),
+            cmocka_unit_test(test_watch),
+            cmocka_unit_test(test_coalesce),
+            cmocka_unit_test(test_stats),
+            cmocka_unit_test(test_many_topics),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
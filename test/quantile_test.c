@@ -0,0 +1,143 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/quantile.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define REL_ERR (1.0 / (1 << JSDRV_QUANTILE_MANTISSA_BITS))
+
+
+static struct jsdrv_quantile_s * quantile_new(void) {
+    struct jsdrv_quantile_s * q = malloc(sizeof(*q));
+    jsdrv_quantile_clear(q);
+    return q;
+}
+
+static void assert_close(double expect, double actual) {
+    double tol = fabs(expect) * REL_ERR + 1e-12;
+    if (fabs(expect - actual) > tol) {
+        fail_msg("expect %g, actual %g", expect, actual);
+    }
+}
+
+static void test_empty(void **state) {
+    (void) state;
+    struct jsdrv_quantile_s * q = quantile_new();
+    assert_true(isnan(jsdrv_quantile_value(q, 0.5)));
+    float x[] = {NAN, NAN};
+    jsdrv_quantile_add_f32(q, x, 2);
+    assert_int_equal(0, q->count);
+    assert_true(isnan(jsdrv_quantile_value(q, 0.5)));
+    free(q);
+}
+
+static void test_single(void **state) {
+    (void) state;
+    struct jsdrv_quantile_s * q = quantile_new();
+    float x = 0.001234f;
+    jsdrv_quantile_add_f32(q, &x, 1);
+    assert_float_equal(x, jsdrv_quantile_value(q, 0.0), 0.0);
+    assert_float_equal(x, jsdrv_quantile_value(q, 0.5), 0.0);   // clamped to min/max
+    assert_float_equal(x, jsdrv_quantile_value(q, 1.0), 0.0);
+    free(q);
+}
+
+static void test_ramp(void **state) {
+    (void) state;
+    struct jsdrv_quantile_s * q = quantile_new();
+    float x[1000];
+    for (int i = 0; i < 1000; ++i) {
+        x[i] = (float) (i + 1) * 1e-3f;  // 1 mA to 1 A
+    }
+    jsdrv_quantile_add_f32(q, x, 1000);
+    assert_int_equal(1000, q->count);
+    assert_close(0.500, jsdrv_quantile_value(q, 0.5));
+    assert_close(0.900, jsdrv_quantile_value(q, 0.9));
+    assert_close(0.990, jsdrv_quantile_value(q, 0.99));
+    assert_close(0.999, jsdrv_quantile_value(q, 0.999));
+    assert_float_equal(1e-3f, jsdrv_quantile_value(q, 0.0), 0.0);
+    assert_float_equal(1.0f, jsdrv_quantile_value(q, 1.0), 0.0);
+    free(q);
+}
+
+static void test_signed(void **state) {
+    (void) state;
+    struct jsdrv_quantile_s * q = quantile_new();
+    float x[] = {-4.0f, -2.0f, -1.0f, 0.0f, 1e-20f, 1.0f, 2.0f, 4.0f};
+    jsdrv_quantile_add_f32(q, x, 8);
+    assert_close(-4.0, jsdrv_quantile_value(q, 0.125));
+    assert_close(-2.0, jsdrv_quantile_value(q, 0.25));
+    assert_close(-1.0, jsdrv_quantile_value(q, 0.375));
+    assert_float_equal(0.0f, jsdrv_quantile_value(q, 0.5), 0.0);
+    assert_float_equal(0.0f, jsdrv_quantile_value(q, 0.625), 0.0);  // below EXP_MIN
+    assert_close(1.0, jsdrv_quantile_value(q, 0.75));
+    assert_close(4.0, jsdrv_quantile_value(q, 1.0));
+    free(q);
+}
+
+static void test_out_of_range(void **state) {
+    (void) state;
+    struct jsdrv_quantile_s * q = quantile_new();
+    float x[] = {1e9f, INFINITY, -1e9f};
+    jsdrv_quantile_add_f32(q, x, 3);
+    assert_int_equal(3, q->count);
+    assert_float_equal(-1e9f, jsdrv_quantile_value(q, 0.0), 0.0);
+    assert_true(jsdrv_quantile_value(q, 0.5) > 32768.0f);  // outermost bin
+    assert_true(isinf(jsdrv_quantile_value(q, 1.0)));
+    free(q);
+}
+
+static void test_merge(void **state) {
+    (void) state;
+    struct jsdrv_quantile_s * a = quantile_new();
+    struct jsdrv_quantile_s * b = quantile_new();
+    struct jsdrv_quantile_s * all = quantile_new();
+    float x[2000];
+    for (int i = 0; i < 2000; ++i) {
+        x[i] = (float) ((i * 7919) % 2000) * 0.01f - 5.0f;
+    }
+    jsdrv_quantile_add_f32(a, x, 700);
+    jsdrv_quantile_add_f32(b, x + 700, 1300);
+    jsdrv_quantile_add_f32(all, x, 2000);
+    jsdrv_quantile_merge(a, b);
+    assert_int_equal(all->count, a->count);
+    assert_float_equal(all->min, a->min, 0.0);
+    assert_float_equal(all->max, a->max, 0.0);
+    assert_memory_equal(all->bins, a->bins, sizeof(all->bins));
+    free(a);
+    free(b);
+    free(all);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_empty),
+            cmocka_unit_test(test_single),
+            cmocka_unit_test(test_ramp),
+            cmocka_unit_test(test_signed),
+            cmocka_unit_test(test_out_of_range),
+            cmocka_unit_test(test_merge),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,439 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv/recorder.h"
+#include "jsdrv/error_code.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define PATH "recorder_test.bin"
+#define COUNT (3000U)
+#define DATA_SIZE (5000U)  // 3000 records span multiple 4 MB blocks
+
+
+static uint8_t * file_read(size_t * size) {
+    FILE * f = fopen(PATH, "rb");
+    assert_non_null(f);
+    fseek(f, 0, SEEK_END);
+    *size = (size_t) ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t * b = malloc(*size);
+    assert_int_equal(*size, fread(b, 1, *size, f));
+    fclose(f);
+    return b;
+}
+
+// Check the END record and return the TOC record offset, which follows the data.
+static size_t toc_offset(const uint8_t * b, size_t size) {
+    const struct jsdrv_recorder_record_header_s * hdr = (const struct jsdrv_recorder_record_header_s *) (b + size - 24);
+    assert_int_equal(JSDRV_RECORDER_TYPE_END, hdr->type);
+    assert_int_equal(24, hdr->length);
+    uint64_t offset = *((const uint64_t *) (hdr + 1));
+    hdr = (const struct jsdrv_recorder_record_header_s *) (b + offset);
+    assert_int_equal(JSDRV_RECORDER_TYPE_TOC, hdr->type);
+    assert_int_equal(size - 24, offset + hdr->length);
+    return (size_t) offset;
+}
+
+static void test_invalid(void ** state) {
+    (void) state;
+    struct jsdrv_recorder_s * r = NULL;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_open(NULL, NULL, 0, &r));
+    assert_int_equal(JSDRV_ERROR_IO, jsdrv_recorder_open(NULL, "no/such/dir/file.bin", 0, &r));
+    assert_int_equal(0, jsdrv_recorder_open(NULL, PATH, 0, &r));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_add(r, 1, "u/js220/0123/s/i/!data"));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_user_data(r, 1, NULL, 10));
+    assert_int_equal(0, jsdrv_recorder_close(r));
+}
+
+static void test_user_data(void ** state) {
+    (void) state;
+    struct jsdrv_recorder_s * r = NULL;
+    struct jsdrv_recorder_status_s status;
+    uint8_t * data = malloc(DATA_SIZE);
+    assert_int_equal(0, jsdrv_recorder_open(NULL, PATH, 0, &r));
+    for (uint32_t i = 0; i < COUNT; ++i) {
+        uint32_t sz = DATA_SIZE - (i % 8);
+        memset(data, (int) (i & 0xff), sz);
+        assert_int_equal(0, jsdrv_recorder_user_data(r, (uint16_t) i, data, sz));
+    }
+    jsdrv_recorder_status(r, &status);
+    assert_int_equal(0, status.drops);
+    assert_int_equal(0, status.error);
+    assert_int_equal(0, jsdrv_recorder_close(r));
+    free(data);
+
+    size_t size = 0;
+    uint8_t * b = file_read(&size);
+    assert_memory_equal("jsdrvrec", b, 8);
+    assert_int_equal(1, *((uint32_t *) (b + 8)));
+    assert_int_equal(64, *((uint32_t *) (b + 12)));
+    size_t offset = 64;
+    for (uint32_t i = 0; i < COUNT; ++i) {
+        assert_true((offset + sizeof(struct jsdrv_recorder_record_header_s)) <= size);
+        struct jsdrv_recorder_record_header_s * hdr = (struct jsdrv_recorder_record_header_s *) (b + offset);
+        uint32_t sz = DATA_SIZE - (i % 8);
+        assert_int_equal(JSDRV_RECORDER_TYPE_USER_DATA, hdr->type);
+        assert_int_equal((uint16_t) i, hdr->id);
+        assert_int_equal(sz, hdr->size);
+        assert_int_equal(0, hdr->length & 7);
+        uint8_t * p = (uint8_t *) (hdr + 1);
+        assert_int_equal(i & 0xff, p[0]);
+        assert_int_equal(i & 0xff, p[sz - 1]);
+        offset += hdr->length;
+    }
+    assert_int_equal(toc_offset(b, size), offset);
+    free(b);
+    remove(PATH);
+}
+
+static void test_usb(void ** state) {
+    (void) state;
+    struct jsdrv_recorder_s * r = NULL;
+    uint8_t data[1024];
+    for (uint32_t i = 0; i < sizeof(data); ++i) {
+        data[i] = (uint8_t) i;
+    }
+    assert_int_equal(0, jsdrv_recorder_open(NULL, PATH, 0, &r));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_usb_device(r, 0, "u/js220/0123"));
+    assert_int_equal(0, jsdrv_recorder_usb_device(r, 1, "u/js220/0123"));
+    assert_int_equal(0, jsdrv_recorder_usb_bulk_in(r, 1, 0x82, 12345, data, sizeof(data) - 3));
+    assert_int_equal(0, jsdrv_recorder_close(r));
+
+    size_t size = 0;
+    uint8_t * b = file_read(&size);
+    struct jsdrv_recorder_record_header_s * hdr = (struct jsdrv_recorder_record_header_s *) (b + 64);
+    assert_int_equal(JSDRV_RECORDER_TYPE_USB_DEVICE, hdr->type);
+    assert_int_equal(1, hdr->id);
+    assert_string_equal("u/js220/0123", (char *) (hdr + 1));
+    hdr = (struct jsdrv_recorder_record_header_s *) (((uint8_t *) hdr) + hdr->length);
+    assert_int_equal(JSDRV_RECORDER_TYPE_USB_BULK_IN, hdr->type);
+    assert_int_equal(1, hdr->id);
+    assert_int_equal(sizeof(struct jsdrv_recorder_usb_s) + sizeof(data) - 3, hdr->size);
+    struct jsdrv_recorder_usb_s * usb = (struct jsdrv_recorder_usb_s *) (hdr + 1);
+    assert_int_equal(12345, usb->time);
+    assert_int_equal(0x82, usb->endpoint);
+    assert_memory_equal(data, usb + 1, sizeof(data) - 3);
+    assert_int_equal(toc_offset(b, size), ((uint8_t *) hdr) + hdr->length - b);
+    free(b);
+    remove(PATH);
+}
+
+#define STREAM_COUNT (1000U)   // 1000 messages * 1000 samples spans multiple blocks and summary levels
+#define STREAM_SAMPLES (1000U)
+#define STREAM_GAP (500U)       // message index with missing data
+#define STREAM_DECIMATE (2U)
+
+static float stream_value(uint64_t idx) {
+    return (float) (idx % 4096);
+}
+
+static uint64_t stream_write(uint8_t codec) {
+    struct jsdrv_recorder_s * r = NULL;
+    struct jsdrv_recorder_status_s status;
+    struct jsdrv_stream_signal_s * s = malloc(sizeof(struct jsdrv_stream_signal_s));
+    uint8_t u4[STREAM_SAMPLES / 2];
+    assert_int_equal(0, jsdrv_recorder_open(NULL, PATH, 0, &r));
+    assert_int_equal(JSDRV_ERROR_NOT_SUPPORTED, jsdrv_recorder_codec(r, 200));
+    assert_int_equal(0, jsdrv_recorder_codec(r, codec));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_stream(r, 0, s, JSDRV_STREAM_HEADER_SIZE));
+    for (uint32_t i = 0; i < STREAM_COUNT; ++i) {
+        memset(s, 0, JSDRV_STREAM_HEADER_SIZE);
+        s->sample_id = 1000 + (uint64_t) i * STREAM_SAMPLES * STREAM_DECIMATE;
+        s->element_type = JSDRV_DATA_TYPE_FLOAT;
+        s->element_size_bits = 32;
+        s->element_count = STREAM_SAMPLES;
+        s->sample_rate = 2000000;
+        s->decimate_factor = STREAM_DECIMATE;
+        float * f = (float *) s->data;
+        for (uint32_t k = 0; k < STREAM_SAMPLES; ++k) {
+            f[k] = stream_value((uint64_t) i * STREAM_SAMPLES + k);
+        }
+        if (i != STREAM_GAP) {
+            assert_int_equal(0, jsdrv_recorder_stream(r, 1, s, JSDRV_STREAM_HEADER_SIZE + STREAM_SAMPLES * 4));
+        }
+        s->element_type = JSDRV_DATA_TYPE_UINT;
+        s->element_size_bits = 4;
+        for (uint32_t k = 0; k < sizeof(u4); ++k) {
+            uint64_t idx = (uint64_t) i * STREAM_SAMPLES + 2 * k;
+            u4[k] = (uint8_t) ((idx & 0xf) | (((idx + 1) & 0xf) << 4));
+        }
+        memcpy(s->data, u4, sizeof(u4));
+        assert_int_equal(0, jsdrv_recorder_stream(r, 2, s, JSDRV_STREAM_HEADER_SIZE + sizeof(u4)));
+    }
+    jsdrv_recorder_status(r, &status);
+    assert_int_equal(0, status.drops);
+    assert_int_equal(0, jsdrv_recorder_close(r));
+    free(s);
+    FILE * f = fopen(PATH, "rb");
+    fseek(f, 0, SEEK_END);
+    uint64_t size = (uint64_t) ftell(f);
+    fclose(f);
+    return size;
+}
+
+static void stream_check(void) {
+    struct jsdrv_recorder_reader_s * r = NULL;
+    struct jsdrv_recorder_signal_info_s info;
+    uint16_t ids[4];
+    float f[3000];
+    uint8_t u4[8];
+    struct jsdrv_summary_entry_s e[4];
+    assert_int_equal(0, jsdrv_recorder_reader_open(PATH, &r));
+    assert_int_equal(2, jsdrv_recorder_reader_signals(r, ids, 4));
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_recorder_reader_info(r, 3, &info));
+    assert_int_equal(0, jsdrv_recorder_reader_info(r, 1, &info));
+    assert_int_equal(JSDRV_DATA_TYPE_FLOAT, info.element_type);
+    assert_int_equal(STREAM_DECIMATE, info.decimate_factor);
+    assert_int_equal(1000, info.sample_id_start);
+    assert_int_equal(1000 + STREAM_COUNT * STREAM_SAMPLES * STREAM_DECIMATE, info.sample_id_end);
+    assert_int_equal(3, info.summary_levels);
+
+    // samples spanning the missing message
+    uint64_t idx0 = (STREAM_GAP - 1) * STREAM_SAMPLES;
+    assert_int_equal(0, jsdrv_recorder_reader_samples(r, 1, 1000 + idx0 * STREAM_DECIMATE, 3000, f));
+    for (uint32_t k = 0; k < 3000; ++k) {
+        if ((k >= STREAM_SAMPLES) && (k < (2 * STREAM_SAMPLES))) {
+            assert_true(isnan(f[k]));
+        } else {
+            assert_float_equal(stream_value(idx0 + k), f[k], 0.0f);
+        }
+    }
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_reader_samples(r, 1, info.sample_id_end, 1, f));
+
+    // packed u4 samples at an odd offset
+    assert_int_equal(0, jsdrv_recorder_reader_samples(r, 2, 1000 + 12345 * STREAM_DECIMATE, 16, u4));
+    for (uint32_t k = 0; k < 16; ++k) {
+        assert_int_equal((12345 + k) & 0xf, (u4[k / 2] >> (4 * (k & 1))) & 0xf);
+    }
+
+    // summaries: one window per 4096 sample period, so each avg is 2047.5
+    assert_int_equal(0, jsdrv_recorder_reader_summary(r, 1, 1000, 4096 * STREAM_DECIMATE, e, 4));
+    for (uint32_t k = 0; k < 4; ++k) {
+        assert_float_equal(2047.5f, e[k].avg, 1e-3f);
+        assert_float_equal(0.0f, e[k].min, 0.0f);
+        assert_float_equal(4095.0f, e[k].max, 0.0f);
+    }
+    // a large unaligned window uses the upper levels and matches the samples
+    assert_int_equal(0, jsdrv_recorder_reader_summary(r, 1, 1000 + 777 * STREAM_DECIMATE,
+                                                       300000 * STREAM_DECIMATE, e, 1));
+    double sum = 0.0;
+    for (uint64_t k = 777; k < 300777; ++k) {
+        sum += stream_value(k);
+    }
+    assert_float_equal((float) (sum / 300000.0), e[0].avg, 1e-2f);
+    // past the end
+    assert_int_equal(0, jsdrv_recorder_reader_summary(r, 1, info.sample_id_end, 100, e, 1));
+    assert_true(isnan(e[0].avg));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_reader_summary(r, 2, 1000, 100, e, 1));
+    jsdrv_recorder_reader_close(r);
+}
+
+static void test_index(void ** state) {
+    (void) state;
+    stream_write(JSDRV_STREAM_CODEC_NONE);
+    stream_check();
+    remove(PATH);
+}
+
+static void test_index_scan(void ** state) {
+    (void) state;
+    size_t size = 0;
+    stream_write(JSDRV_STREAM_CODEC_NONE);
+    uint8_t * b = file_read(&size);
+    FILE * f = fopen(PATH, "wb");  // remove the END record, like an interrupted recording
+    assert_int_equal(size - 24, fwrite(b, 1, size - 24, f));
+    fclose(f);
+    free(b);
+    stream_check();
+    remove(PATH);
+}
+
+static void test_codec(void ** state) {
+    (void) state;
+    size_t size = 0;
+    uint64_t size_raw = stream_write(JSDRV_STREAM_CODEC_NONE);
+    uint64_t size_f32 = stream_write(JSDRV_STREAM_CODEC_F32);
+    assert_true((size_f32 * 4) < (size_raw * 3));  // about 2 of 4 bytes per float32 sample
+    stream_check();
+
+    uint8_t * b = file_read(&size);
+    FILE * f = fopen(PATH, "wb");  // also decode while scanning
+    assert_int_equal(size - 24, fwrite(b, 1, size - 24, f));
+    fclose(f);
+    free(b);
+    stream_check();
+    remove(PATH);
+}
+
+static void hold_stream(struct jsdrv_recorder_s * r, struct jsdrv_stream_signal_s * s, uint64_t sample_id,
+                        uint64_t sample_count, float mean) {
+    memset(s, 0, JSDRV_STREAM_HEADER_SIZE);
+    s->sample_id = sample_id;
+    s->element_type = JSDRV_DATA_TYPE_HOLD;
+    s->element_size_bits = sizeof(struct jsdrv_stream_hold_s) * 8;
+    s->element_count = 1;
+    s->sample_rate = 1000000;
+    s->decimate_factor = 1;
+    struct jsdrv_stream_hold_s * hold = (struct jsdrv_stream_hold_s *) s->data;
+    hold->sample_count = sample_count;
+    hold->min = mean - 0.5f;
+    hold->max = mean + 0.5f;
+    hold->mean = mean;
+    hold->rsv_u32 = 0;
+    assert_int_equal(0, jsdrv_recorder_stream(r, 1, s, JSDRV_STREAM_HEADER_SIZE + sizeof(*hold)));
+}
+
+static void test_hold(void ** state) {
+    (void) state;
+    struct jsdrv_recorder_s * w = NULL;
+    struct jsdrv_recorder_reader_s * r = NULL;
+    struct jsdrv_recorder_signal_info_s info;
+    struct jsdrv_summary_entry_s e[2];
+    float f[20];
+    struct jsdrv_stream_signal_s * s = malloc(sizeof(struct jsdrv_stream_signal_s));
+    assert_int_equal(0, jsdrv_recorder_open(NULL, PATH, 0, &w));
+    assert_int_equal(0, jsdrv_recorder_codec(w, JSDRV_STREAM_CODEC_F32));
+    hold_stream(w, s, 0, 5000, 2.0f);
+    s->sample_id = 5000;
+    s->element_type = JSDRV_DATA_TYPE_FLOAT;
+    s->element_size_bits = 32;
+    s->element_count = 1000;
+    for (uint32_t k = 0; k < 1000; ++k) {
+        ((float *) s->data)[k] = 7.0f;
+    }
+    assert_int_equal(0, jsdrv_recorder_stream(w, 1, s, JSDRV_STREAM_HEADER_SIZE + 1000 * 4));
+    hold_stream(w, s, 6000, 10000, 3.0f);
+    assert_int_equal(0, jsdrv_recorder_close(w));
+    free(s);
+
+    assert_int_equal(0, jsdrv_recorder_reader_open(PATH, &r));
+    assert_int_equal(0, jsdrv_recorder_reader_info(r, 1, &info));
+    assert_int_equal(JSDRV_DATA_TYPE_FLOAT, info.element_type);
+    assert_int_equal(32, info.element_size_bits);
+    assert_int_equal(0, info.sample_id_start);
+    assert_int_equal(16000, info.sample_id_end);
+    assert_int_equal(0, jsdrv_recorder_reader_samples(r, 1, 4990, 20, f));
+    for (uint32_t k = 0; k < 20; ++k) {
+        assert_float_equal((k < 10) ? 2.0f : 7.0f, f[k], 0.0f);
+    }
+    assert_int_equal(0, jsdrv_recorder_reader_samples(r, 1, 15980, 20, f));
+    assert_float_equal(3.0f, f[19], 0.0f);
+
+    assert_int_equal(0, jsdrv_recorder_reader_summary(r, 1, 0, 4096, e, 1));
+    assert_float_equal(2.0f, e[0].avg, 1e-6f);
+    assert_float_equal(1.5f, e[0].min, 0.0f);
+    assert_float_equal(2.5f, e[0].max, 0.0f);
+    jsdrv_recorder_reader_close(r);
+    remove(PATH);
+}
+
+#define RAW_COUNT (10U)
+#define RAW_SAMPLES (1000U)
+
+static int16_t raw_adc(uint64_t idx) {
+    return (int16_t) ((idx * 37) % 65536 - 32768);
+}
+
+static uint8_t raw_range(uint64_t idx) {
+    return (uint8_t) ((idx / 700) % 3);
+}
+
+static void test_raw_cal(void ** state) {
+    (void) state;
+    struct jsdrv_recorder_s * w = NULL;
+    struct jsdrv_recorder_reader_s * r = NULL;
+    struct jsdrv_raw_cal_s cal;
+    struct jsdrv_stream_signal_s * s = malloc(sizeof(struct jsdrv_stream_signal_s));
+    float * y = malloc(RAW_COUNT * RAW_SAMPLES * sizeof(float));
+    memset(&cal, 0, sizeof(cal));
+    cal.offset[0] = 10.0f;
+    cal.gain[0] = 0.5f;
+    cal.offset[1] = -20.0f;
+    cal.gain[1] = 0.001f;   // range 2 has no gain and produces NaN
+
+    assert_int_equal(0, jsdrv_recorder_open(NULL, PATH, 0, &w));
+    for (uint32_t i = 0; i < RAW_COUNT; ++i) {
+        memset(s, 0, JSDRV_STREAM_HEADER_SIZE);
+        s->sample_id = 1000 + (uint64_t) i * RAW_SAMPLES;
+        s->element_type = JSDRV_DATA_TYPE_INT;
+        s->element_size_bits = 16;
+        s->element_count = RAW_SAMPLES;
+        s->sample_rate = 2000000;
+        s->decimate_factor = 1;
+        int16_t * x = (int16_t *) s->data;
+        for (uint32_t k = 0; k < RAW_SAMPLES; ++k) {
+            x[k] = raw_adc((uint64_t) i * RAW_SAMPLES + k);
+        }
+        assert_int_equal(0, jsdrv_recorder_stream(w, 1, s, JSDRV_STREAM_HEADER_SIZE + RAW_SAMPLES * 2));
+        s->element_type = JSDRV_DATA_TYPE_UINT;
+        s->element_size_bits = 4;
+        for (uint32_t k = 0; k < (RAW_SAMPLES / 2); ++k) {
+            uint64_t idx = (uint64_t) i * RAW_SAMPLES + 2 * k;
+            s->data[k] = (uint8_t) (raw_range(idx) | (raw_range(idx + 1) << 4));
+        }
+        assert_int_equal(0, jsdrv_recorder_stream(w, 2, s, JSDRV_STREAM_HEADER_SIZE + RAW_SAMPLES / 2));
+    }
+    assert_int_equal(0, jsdrv_recorder_close(w));
+
+    assert_int_equal(0, jsdrv_recorder_reader_open(PATH, &r));
+    uint32_t length = RAW_COUNT * RAW_SAMPLES - 123;
+    assert_int_equal(0, jsdrv_recorder_reader_raw_cal(r, 1, 2, &cal, 1123, length, y));
+    for (uint32_t k = 0; k < length; ++k) {
+        uint64_t idx = 123 + k;
+        uint8_t range = raw_range(idx);
+        if (range == 2) {
+            assert_true(isnan(y[k]));
+        } else {
+            float expect = ((float) raw_adc(idx) + cal.offset[range]) * cal.gain[range];
+            assert_float_equal(expect, y[k], 0.0f);
+        }
+    }
+    assert_int_equal(0, jsdrv_recorder_reader_raw_cal(r, 1, 0, &cal, 1000, 16, y));
+    for (uint32_t k = 0; k < 16; ++k) {
+        assert_float_equal(((float) raw_adc(k) + 10.0f) * 0.5f, y[k], 0.0f);
+    }
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_recorder_reader_raw_cal(r, 1, 3, &cal, 1000, 16, y));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_reader_raw_cal(r, 2, 0, &cal, 1000, 16, y));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_recorder_reader_raw_cal(r, 1, 2, &cal, 1000, length + 124, y));
+    jsdrv_recorder_reader_close(r);
+    free(y);
+    free(s);
+    remove(PATH);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_invalid),
+            cmocka_unit_test(test_user_data),
+            cmocka_unit_test(test_usb),
+            cmocka_unit_test(test_index),
+            cmocka_unit_test(test_index_scan),
+            cmocka_unit_test(test_codec),
+            cmocka_unit_test(test_hold),
+            cmocka_unit_test(test_raw_cal),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -87,6 +87,36 @@ static void test_add_wrap(void **state) {
     }
 }
 
+static void test_add_scale_copy(void **state) {
+    (void) state;
+    struct sbuf_f32_s a;
+    struct sbuf_f32_s b;
+    sbuf_f32_clear(&a);
+    sbuf_f32_clear(&b);
+    float data[SAMPLE_BUFFER_LENGTH / 2];
+    float dst[SAMPLE_BUFFER_LENGTH / 2];
+    float expect[SAMPLE_BUFFER_LENGTH / 2];
+    size_t k = 0;
+    for (int j = 0; j < 3; ++j) {
+        size_t sample_id = k * 2 - ((j == 2) ? 20 : 0);  // overlap on last
+        for (size_t i = 0; i < JSDRV_ARRAY_SIZE(data); ++i) {
+            data[i] = (float) k++;
+            expect[i] = data[i] * 0.5f;
+        }
+        sbuf_f32_add_scale_copy(&a, sample_id, dst, data, 0.5f, JSDRV_ARRAY_SIZE(data));
+        sbuf_f32_add(&b, sample_id, expect, JSDRV_ARRAY_SIZE(expect));
+        assert_memory_equal(expect, dst, sizeof(dst));
+    }
+    assert_int_equal(sbuf_f32_length(&b), sbuf_f32_length(&a));
+    assert_int_equal(b.head, a.head);
+    assert_int_equal(b.head_sample_id, a.head_sample_id);
+    assert_memory_equal(b.buffer, a.buffer, sizeof(a.buffer));
+
+    // in place without a buffer
+    sbuf_f32_add_scale_copy(NULL, 0, data, data, 2.0f, JSDRV_ARRAY_SIZE(data));
+    assert_float_equal(2.0f * (k - 1), data[JSDRV_ARRAY_SIZE(data) - 1], 1e-7);
+}
+
 static void test_mult(void **state) {
     (void) state;
     struct sbuf_f32_s r;
@@ -113,6 +143,35 @@ static void test_mult(void **state) {
     assert_int_equal(0, r.msg_sample_id);
 }
 
+static void test_mult_wrap(void **state) {
+    (void) state;
+    struct sbuf_f32_s r;
+    struct sbuf_f32_s s1;
+    struct sbuf_f32_s s2;
+    sbuf_f32_clear(&s1);
+    sbuf_f32_clear(&s2);
+    sbuf_f32_clear(&r);
+    float f1[SAMPLE_BUFFER_LENGTH / 2];
+    float f2[SAMPLE_BUFFER_LENGTH / 2];
+    for (size_t i = 0; i < JSDRV_ARRAY_SIZE(f1); ++i) {
+        f1[i] = (float) i;
+        f2[i] = (float) (2 * i + 1);
+    }
+    // offset the rings so that s1 and s2 wrap at different samples
+    s1.head = s1.tail = SAMPLE_BUFFER_LENGTH - 100;
+    s2.head = s2.tail = SAMPLE_BUFFER_LENGTH - 300;
+    sbuf_f32_add(&s1, 0, f1, JSDRV_ARRAY_SIZE(f1));
+    sbuf_f32_add(&s2, 0, f2, JSDRV_ARRAY_SIZE(f2) - 10);
+    sbuf_f32_mult(&r, &s1, &s2);
+    assert_int_equal(JSDRV_ARRAY_SIZE(f1) - 10, sbuf_f32_length(&r));
+    assert_int_equal(10, sbuf_f32_length(&s1));
+    assert_int_equal(0, sbuf_f32_length(&s2));
+    for (size_t i = 0; i < JSDRV_ARRAY_SIZE(f1) - 10; i++) {
+        assert_float_equal(i + 2 * i * i, r.buffer[i], 1e-7);
+    }
+    assert_int_equal((JSDRV_ARRAY_SIZE(f1) - 10) * 2, r.head_sample_id);
+}
+
 static void test_mult_no_overlap(void **state) {
     (void) state;
     struct sbuf_f32_s r;
@@ -174,16 +233,71 @@ static void test_advance_one(void **state) {
 
 }
 
+static void test_add_gap_wrap(void **state) {
+    (void) state;
+    struct sbuf_f32_s b;
+    float f[] = {1.0f, 2.0f};
+    sbuf_f32_clear(&b);
+    sbuf_f32_add(&b, 2 * (SAMPLE_BUFFER_LENGTH - 4), f, JSDRV_ARRAY_SIZE(f));
+    assert_int_equal(SAMPLE_BUFFER_LENGTH - 2, sbuf_f32_length(&b));
+    sbuf_f32_add(&b, 2 * (SAMPLE_BUFFER_LENGTH + 4), f, JSDRV_ARRAY_SIZE(f));  // 6 sample gap across the end
+    assert_int_equal(SAMPLE_BUFFER_LENGTH - 1, sbuf_f32_length(&b));
+    assert_int_equal(2 * (SAMPLE_BUFFER_LENGTH + 6), sbuf_head_sample_id(&b));
+    uint32_t p = (b.head - 1) & SAMPLE_BUFFER_MASK;
+    assert_float_equal(2.0f, b.buffer[p], 1e-7);
+    p = (p - 1) & SAMPLE_BUFFER_MASK;
+    assert_float_equal(1.0f, b.buffer[p], 1e-7);
+    for (int i = 0; i < 6; ++i) {
+        p = (p - 1) & SAMPLE_BUFFER_MASK;
+        assert_true(isnan(b.buffer[p]));
+    }
+    p = (p - 1) & SAMPLE_BUFFER_MASK;
+    assert_float_equal(2.0f, b.buffer[p], 1e-7);
+}
+
+static void test_span(void **state) {
+    (void) state;
+    struct sbuf_f32_s b;
+    struct sbuf_f32_span_s span;
+    float data[SAMPLE_BUFFER_LENGTH / 2];
+    float out[SAMPLE_BUFFER_LENGTH];
+    sbuf_f32_clear(&b);
+    assert_int_equal(0, sbuf_f32_span(&b, &span));
+    assert_int_equal(0, span.length[0] + span.length[1]);
+
+    size_t k = 0;
+    for (int j = 0; j < 3; ++j) {
+        size_t sample_id = k * 2;
+        for (size_t i = 0; i < JSDRV_ARRAY_SIZE(data); ++i) {
+            data[i] = (float) k++;
+        }
+        sbuf_f32_add(&b, sample_id, data, JSDRV_ARRAY_SIZE(data));
+    }
+    assert_int_equal(SAMPLE_BUFFER_LENGTH - 1, sbuf_f32_span(&b, &span));
+    assert_int_equal(SAMPLE_BUFFER_LENGTH - b.tail, span.length[0]);
+    assert_int_equal(b.head, span.length[1]);
+    assert_ptr_equal(&b.buffer[b.tail], span.data[0]);
+    assert_ptr_equal(b.buffer, span.data[1]);
+    assert_int_equal(SAMPLE_BUFFER_LENGTH - 1, sbuf_f32_copy(&b, out));
+    for (size_t i = 0; i < (SAMPLE_BUFFER_LENGTH - 1); ++i) {
+        assert_float_equal((float) (k - (SAMPLE_BUFFER_LENGTH - 1) + i), out[i], 1e-7);
+    }
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_add_one),
             cmocka_unit_test(test_add_one_skip),
             cmocka_unit_test(test_add_one_duplicate),
             cmocka_unit_test(test_add_wrap),
+            cmocka_unit_test(test_add_scale_copy),
             cmocka_unit_test(test_mult),
+            cmocka_unit_test(test_mult_wrap),
             cmocka_unit_test(test_mult_no_overlap),
             cmocka_unit_test(test_mult_some_overlap),
             cmocka_unit_test(test_advance_one),
+            cmocka_unit_test(test_add_gap_wrap),
+            cmocka_unit_test(test_span),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv/shm.h"
+#include "jsdrv/error_code.h"
+#include <stdint.h>
+#include <string.h>
+
+
+#define NAME "shm_test"
+#define SIZE (1U << 16)
+
+
+static void test_invalid(void **state) {
+    (void) state;
+    struct jsdrv_shm_bridge_s * b = NULL;
+    struct jsdrv_shm_reader_s * r = NULL;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_shm_bridge_open(NULL, NAME, SIZE + 1, &b));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_shm_bridge_open(NULL, "a/b", SIZE, &b));
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_shm_reader_open(NAME, &r));
+    assert_int_equal(0, jsdrv_shm_bridge_open(NULL, NAME, SIZE, &b));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_shm_bridge_add(b, "u/js220/+/s/i/!data"));
+    jsdrv_shm_bridge_close(b);
+}
+
+static void test_write_read(void **state) {
+    (void) state;
+    struct jsdrv_shm_bridge_s * b = NULL;
+    struct jsdrv_shm_reader_s * r1 = NULL;
+    struct jsdrv_shm_reader_s * r2 = NULL;
+    const char * topic = NULL;
+    struct jsdrv_union_s v;
+    uint8_t bin[1000];
+    for (uint32_t i = 0; i < sizeof(bin); ++i) {
+        bin[i] = (uint8_t) i;
+    }
+    struct jsdrv_union_s bin_value = jsdrv_union_bin(bin, sizeof(bin));
+    bin_value.app = 7;
+
+    assert_int_equal(0, jsdrv_shm_bridge_open(NULL, NAME, SIZE, &b));
+    assert_int_equal(0, jsdrv_shm_bridge_write(b, "a/before", &jsdrv_union_u32(1)));
+    assert_int_equal(0, jsdrv_shm_reader_open(NAME, &r1));
+    assert_int_equal(0, jsdrv_shm_reader_open(NAME, &r2));
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_shm_reader_next(r1, &topic, &v, 0));
+
+    assert_int_equal(0, jsdrv_shm_bridge_write(b, "a/u32", &jsdrv_union_u32_r(42)));
+    assert_int_equal(0, jsdrv_shm_bridge_write(b, "a/str", &jsdrv_union_str("hello")));
+    assert_int_equal(0, jsdrv_shm_bridge_write(b, "a/!data", &bin_value));
+
+    for (int i = 0; i < 2; ++i) {  // each reader receives all messages
+        struct jsdrv_shm_reader_s * r = i ? r2 : r1;
+        assert_int_equal(0, jsdrv_shm_reader_next(r, &topic, &v, 10));
+        assert_string_equal("a/u32", topic);
+        assert_int_equal(JSDRV_UNION_U32, v.type);
+        assert_true(v.flags & JSDRV_UNION_FLAG_RETAIN);
+        assert_int_equal(42, v.value.u32);
+        assert_int_equal(0, jsdrv_shm_reader_next(r, &topic, &v, 10));
+        assert_string_equal("a/str", topic);
+        assert_int_equal(JSDRV_UNION_STR, v.type);
+        assert_string_equal("hello", v.value.str);
+        assert_int_equal(6, v.size);
+        assert_int_equal(0, jsdrv_shm_reader_next(r, &topic, &v, 10));
+        assert_string_equal("a/!data", topic);
+        assert_int_equal(JSDRV_UNION_BIN, v.type);
+        assert_int_equal(7, v.app);
+        assert_int_equal(sizeof(bin), v.size);
+        assert_memory_equal(bin, v.value.bin, sizeof(bin));
+        assert_int_equal(0, jsdrv_shm_reader_check(r));
+        assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_shm_reader_next(r, &topic, &v, 1));
+        assert_int_equal(0, jsdrv_shm_reader_drops(r));
+    }
+
+    jsdrv_shm_bridge_close(b);
+    assert_int_equal(JSDRV_ERROR_CLOSED, jsdrv_shm_reader_next(r1, &topic, &v, 10));
+    jsdrv_shm_reader_close(r1);
+    jsdrv_shm_reader_close(r2);
+}
+
+static void test_wrap_and_overrun(void **state) {
+    (void) state;
+    struct jsdrv_shm_bridge_s * b = NULL;
+    struct jsdrv_shm_reader_s * r = NULL;
+    const char * topic = NULL;
+    struct jsdrv_union_s v;
+    uint8_t bin[4000];
+    memset(bin, 0x5a, sizeof(bin));
+    assert_int_equal(0, jsdrv_shm_bridge_open(NULL, NAME, SIZE, &b));
+    assert_int_equal(0, jsdrv_shm_reader_open(NAME, &r));
+    assert_int_equal(JSDRV_ERROR_TOO_BIG, jsdrv_shm_bridge_write(b, "a/big", &jsdrv_union_bin(bin, SIZE / 2)));
+
+    // keep up across several ring wraps
+    for (uint32_t i = 0; i < 100; ++i) {
+        bin[0] = (uint8_t) i;
+        assert_int_equal(0, jsdrv_shm_bridge_write(b, "a/!data", &jsdrv_union_bin(bin, sizeof(bin))));
+        assert_int_equal(0, jsdrv_shm_reader_next(r, &topic, &v, 10));
+        assert_int_equal(i, v.value.bin[0]);
+    }
+    assert_int_equal(0, jsdrv_shm_reader_drops(r));
+
+    // current message overwritten while in use
+    for (uint32_t i = 0; i < 20; ++i) {
+        assert_int_equal(0, jsdrv_shm_bridge_write(b, "a/!data", &jsdrv_union_bin(bin, sizeof(bin))));
+    }
+    assert_int_equal(JSDRV_ERROR_ABORTED, jsdrv_shm_reader_check(r));
+
+    // fall behind, skip to the newest
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_shm_reader_next(r, &topic, &v, 1));
+    assert_int_equal(1, jsdrv_shm_reader_drops(r));
+    assert_int_equal(0, jsdrv_shm_bridge_write(b, "a/u32", &jsdrv_union_u32(3)));
+    assert_int_equal(0, jsdrv_shm_reader_next(r, &topic, &v, 10));
+    assert_string_equal("a/u32", topic);
+    assert_int_equal(3, v.value.u32);
+
+    jsdrv_shm_reader_close(r);
+    jsdrv_shm_bridge_close(b);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_invalid),
+            cmocka_unit_test(test_write_read),
+            cmocka_unit_test(test_wrap_and_overrun),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/snapshot.h"
+#include "jsdrv/error_code.h"
+#include <stdio.h>
+#include <string.h>
+
+
+static void test_not_found(void ** state) {
+    (void) state;
+    struct jsdrv_snapshot_s * s = jsdrv_snapshot_alloc(16);
+    struct jsdrv_union_s v = jsdrv_union_null();
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_snapshot_get(s, "a/b", &v));
+    jsdrv_snapshot_set(s, "a/b", NULL);
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_snapshot_get(s, "a/b", &v));
+    jsdrv_snapshot_free(s);
+}
+
+static void test_scalar(void ** state) {
+    (void) state;
+    struct jsdrv_snapshot_s * s = jsdrv_snapshot_alloc(16);
+    struct jsdrv_union_s v = jsdrv_union_null();
+    jsdrv_snapshot_set(s, "a/b", &jsdrv_union_u32_r(42));
+    assert_int_equal(0, jsdrv_snapshot_get(s, "a/b", &v));
+    assert_int_equal(JSDRV_UNION_U32, v.type);
+    assert_int_equal(42, v.value.u32);
+    jsdrv_snapshot_set(s, "a/b", &jsdrv_union_f32(2.5f));
+    assert_int_equal(0, jsdrv_snapshot_get(s, "a/b", &v));
+    assert_int_equal(JSDRV_UNION_F32, v.type);
+    assert_float_equal(2.5f, v.value.f32, 0.0);
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_snapshot_get(s, "a/c", &v));
+    jsdrv_snapshot_set(s, "a/b", NULL);
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_snapshot_get(s, "a/b", &v));
+    jsdrv_snapshot_free(s);
+}
+
+static void test_str(void ** state) {
+    (void) state;
+    struct jsdrv_snapshot_s * s = jsdrv_snapshot_alloc(16);
+    char buf[32];
+    struct jsdrv_union_s v = jsdrv_union_str(buf);
+    v.size = sizeof(buf);
+    jsdrv_snapshot_set(s, "a/b", &jsdrv_union_cstr("hello"));
+    assert_int_equal(0, jsdrv_snapshot_get(s, "a/b", &v));
+    assert_int_equal(JSDRV_UNION_STR, v.type);
+    assert_int_equal(6, v.size);
+    assert_string_equal("hello", buf);
+
+    v.size = 4;
+    assert_int_equal(JSDRV_ERROR_TOO_SMALL, jsdrv_snapshot_get(s, "a/b", &v));
+    v = jsdrv_union_u32(0);
+    assert_int_equal(JSDRV_ERROR_SYNTAX_ERROR, jsdrv_snapshot_get(s, "a/b", &v));
+    jsdrv_snapshot_free(s);
+}
+
+static void test_large_value_absent(void ** state) {
+    (void) state;
+    struct jsdrv_snapshot_s * s = jsdrv_snapshot_alloc(16);
+    uint8_t data[JSDRV_SNAPSHOT_DATA_SIZE + 1];
+    memset(data, 0x55, sizeof(data));
+    uint8_t buf[sizeof(data)];
+    struct jsdrv_union_s v = jsdrv_union_bin(buf, sizeof(buf));
+    jsdrv_snapshot_set(s, "a/b", &jsdrv_union_bin(data, JSDRV_SNAPSHOT_DATA_SIZE));
+    assert_int_equal(0, jsdrv_snapshot_get(s, "a/b", &v));
+    assert_int_equal(JSDRV_SNAPSHOT_DATA_SIZE, v.size);
+    assert_memory_equal(data, buf, JSDRV_SNAPSHOT_DATA_SIZE);
+    v.size = sizeof(buf);
+    jsdrv_snapshot_set(s, "a/b", &jsdrv_union_bin(data, sizeof(data)));
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_snapshot_get(s, "a/b", &v));
+    jsdrv_snapshot_free(s);
+}
+
+static void test_full(void ** state) {
+    (void) state;
+    char topic[32];
+    struct jsdrv_snapshot_s * s = jsdrv_snapshot_alloc(16);
+    struct jsdrv_union_s v = jsdrv_union_null();
+    for (uint32_t i = 0; i < 32; ++i) {
+        snprintf(topic, sizeof(topic), "t/%u", (unsigned int) i);
+        jsdrv_snapshot_set(s, topic, &jsdrv_union_u32_r(i));
+    }
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < 32; ++i) {
+        snprintf(topic, sizeof(topic), "t/%u", (unsigned int) i);
+        int32_t rc = jsdrv_snapshot_get(s, topic, &v);
+        if (0 == rc) {
+            assert_int_equal(i, v.value.u32);
+            ++found;
+        } else {
+            assert_int_equal(JSDRV_ERROR_NOT_FOUND, rc);
+        }
+    }
+    assert_int_equal(12, found);
+    jsdrv_snapshot_free(s);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_not_found),
+            cmocka_unit_test(test_scalar),
+            cmocka_unit_test(test_str),
+            cmocka_unit_test(test_large_value_absent),
+            cmocka_unit_test(test_full),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/stage.h"
+#include "jsdrv/error_code.h"
+#include <string.h>
+
+
+struct capture_s {
+    uint32_t count;
+    uint64_t sample_id;
+    char topic[JSDRV_TOPIC_LENGTH_MAX];
+};
+
+static void on_stage(void * user_data, const char * topic, const struct jsdrv_stream_signal_s * block) {
+    struct capture_s * c = (struct capture_s *) user_data;
+    ++c->count;
+    c->sample_id = block->sample_id;
+    strcpy(c->topic, topic);
+}
+
+static void test_empty(void ** state) {
+    (void) state;
+    struct jsdrv_stage_registry_s * r = jsdrv_stage_registry_alloc();
+    struct jsdrv_stream_signal_s block = {.sample_id = 10};
+    assert_int_equal(0, jsdrv_stage_registry_process(r, "u/js220/0/s/i/!data", &block));
+    assert_int_equal(JSDRV_ERROR_NOT_FOUND, jsdrv_stage_registry_remove(r, "u/js220/0", on_stage, NULL));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_stage_registry_add(r, "u", NULL, NULL));
+    jsdrv_stage_registry_free(r);
+}
+
+static void test_prefix(void ** state) {
+    (void) state;
+    struct capture_s c1 = {0};
+    struct capture_s c2 = {0};
+    struct jsdrv_stage_registry_s * r = jsdrv_stage_registry_alloc();
+    struct jsdrv_stream_signal_s block = {.sample_id = 10};
+    assert_int_equal(0, jsdrv_stage_registry_add(r, "u/js220/0", on_stage, &c1));
+    assert_int_equal(JSDRV_ERROR_ALREADY_EXISTS, jsdrv_stage_registry_add(r, "u/js220/0", on_stage, &c1));
+    assert_int_equal(0, jsdrv_stage_registry_add(r, "u/js220/0/s/i/!data", on_stage, &c2));
+
+    assert_int_equal(2, jsdrv_stage_registry_process(r, "u/js220/0/s/i/!data", &block));
+    assert_int_equal(1, c1.count);
+    assert_int_equal(1, c2.count);
+    assert_int_equal(10, c2.sample_id);
+    assert_string_equal("u/js220/0/s/i/!data", c2.topic);
+
+    block.sample_id = 20;
+    assert_int_equal(1, jsdrv_stage_registry_process(r, "u/js220/0/s/v/!data", &block));
+    assert_int_equal(2, c1.count);
+    assert_int_equal(20, c1.sample_id);
+    assert_int_equal(0, jsdrv_stage_registry_process(r, "u/js220/01/s/v/!data", &block));
+    assert_int_equal(0, jsdrv_stage_registry_process(r, "u/js110/0/s/v/!data", &block));
+
+    assert_int_equal(0, jsdrv_stage_registry_remove(r, "u/js220/0", on_stage, &c1));
+    assert_int_equal(1, jsdrv_stage_registry_process(r, "u/js220/0/s/i/!data", &block));
+    assert_int_equal(2, c1.count);
+    assert_int_equal(2, c2.count);
+    assert_int_equal(0, jsdrv_stage_registry_remove(r, "u/js220/0/s/i/!data", on_stage, &c2));
+    assert_int_equal(0, jsdrv_stage_registry_process(r, "u/js220/0/s/i/!data", &block));
+    jsdrv_stage_registry_free(r);
+}
+
+static void test_all(void ** state) {
+    (void) state;
+    struct capture_s c = {0};
+    struct jsdrv_stage_registry_s * r = jsdrv_stage_registry_alloc();
+    struct jsdrv_stream_signal_s block = {.sample_id = 10};
+    assert_int_equal(0, jsdrv_stage_registry_add(r, "", on_stage, &c));
+    assert_int_equal(1, jsdrv_stage_registry_process(r, "u/js110/0/s/i/!data", &block));
+    assert_int_equal(1, jsdrv_stage_registry_process(r, "m/001/s/001/!data", &block));
+    assert_int_equal(2, c.count);
+    jsdrv_stage_registry_free(r);
+}
+
+static void test_full(void ** state) {
+    (void) state;
+    struct capture_s c[JSDRV_STAGE_COUNT_MAX + 1];
+    struct jsdrv_stage_registry_s * r = jsdrv_stage_registry_alloc();
+    for (uint32_t i = 0; i < JSDRV_STAGE_COUNT_MAX; ++i) {
+        assert_int_equal(0, jsdrv_stage_registry_add(r, "u", on_stage, &c[i]));
+    }
+    assert_int_equal(JSDRV_ERROR_FULL, jsdrv_stage_registry_add(r, "u", on_stage, &c[JSDRV_STAGE_COUNT_MAX]));
+    assert_int_equal(0, jsdrv_stage_registry_remove(r, "u", on_stage, &c[3]));
+    assert_int_equal(0, jsdrv_stage_registry_add(r, "u", on_stage, &c[JSDRV_STAGE_COUNT_MAX]));
+    jsdrv_stage_registry_free(r);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_empty),
+            cmocka_unit_test(test_prefix),
+            cmocka_unit_test(test_all),
+            cmocka_unit_test(test_full),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -19,6 +19,7 @@
 #include <setjmp.h>
 #include <cmocka.h>
 #include "jsdrv_prv/statistics.h"
+#include <math.h>
 
 
 const float F32_0[] = {0.0f, 1.0f, 2.0f, 7.7f, -2.0f, 3.1f, -3.1f, 4.2f, -4.2f, -1.0f, 5.4f, -5.4f, 6.3f, -6.3f, -7.7f};
@@ -217,6 +218,43 @@ static void test_combine_in_place(void **state) {
     assert_stats_equal(ref, t2);
 }
 
+static void test_compute_f32_nan(void **state) {
+    (void) state;
+    float x[67];
+    for (size_t i = 0; i < 67; ++i) {
+        x[i] = F32_0[i % 15];
+    }
+    x[3] = NAN;
+    x[40] = NAN;
+    struct jsdrv_statistics_accum_s s;
+    jsdrv_statistics_compute_f32(&s, x, 67);
+    assert_int_equal(67, s.k);
+    assert_true(isnan(s.mean));
+    assert_true(isnan(s.s));
+    assert_float_equal(-7.7f, s.min, 0.0);
+    assert_float_equal(7.7f, s.max, 0.0);
+
+    struct jsdrv_statistics_accum_s ref;
+    jsdrv_statistics_reset(&ref);
+    for (size_t i = 0; i < 67; ++i) {
+        if (!isnan(x[i])) {
+            jsdrv_statistics_add(&ref, x[i]);
+        }
+    }
+    jsdrv_statistics_compute_f32_skip_nan(&s, x, 67);
+    assert_int_equal(65, s.k);
+    assert_float_equal(ref.mean, s.mean, 1e-12);
+    assert_float_equal(ref.min, s.min, 0.0);
+    assert_float_equal(ref.max, s.max, 0.0);
+    assert_float_equal(ref.s, s.s, 1e-9);
+
+    for (size_t i = 0; i < 67; ++i) {
+        x[i] = NAN;
+    }
+    jsdrv_statistics_compute_f32_skip_nan(&s, x, 67);
+    assert_int_equal(0, s.k);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_initialize),
@@ -230,6 +268,7 @@ int main(void) {
             cmocka_unit_test(test_combine_f32_in_two_parts),
             cmocka_unit_test(test_combine_f64_in_two_parts),
             cmocka_unit_test(test_combine_in_place),
+            cmocka_unit_test(test_compute_f32_nan),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <math.h>
+#include "jsdrv_prv/stats_group.h"
+#include "jsdrv/time.h"
+
+
+#define SCNT (1000U)
+#define FS   (1000U)
+
+
+// member blocks for the same period have different sample ids, but the same UTC
+static void block_make(struct jsdrv_statistics_s * b, uint32_t member, uint32_t period, double scale) {
+    memset(b, 0, sizeof(*b));
+    b->version = 1;
+    b->decimate_factor = 1;
+    b->block_sample_count = SCNT;
+    b->sample_freq = FS;
+    b->time_map.offset_time = JSDRV_TIME_SECOND * 100;
+    b->time_map.offset_counter = 5000U * member;
+    b->time_map.counter_rate = FS;
+    b->block_sample_id = b->time_map.offset_counter + period * SCNT + member * 10;  // small skew
+    b->accum_sample_id = b->time_map.offset_counter;
+    b->i_avg = 1.0 * scale;
+    b->i_std = 0.3 * scale;
+    b->i_min = 0.5 * scale;
+    b->i_max = 2.0 * scale;
+    b->v_avg = 3.0 + member;
+    b->v_std = 0.0;
+    b->v_min = 3.0 + member;
+    b->v_max = 3.0 + member;
+    b->p_avg = b->i_avg * b->v_avg;
+    b->p_std = b->i_std * b->v_avg;
+    b->p_min = b->i_min * b->v_avg;
+    b->p_max = b->i_max * b->v_avg;
+    b->charge_f64 = (period + 1) * scale;
+    b->energy_f64 = (period + 1) * scale * b->v_avg;
+}
+
+static void test_sum(void ** state) {
+    (void) state;
+    struct jsdrv_stats_group_s g;
+    struct jsdrv_statistics_s b[2];
+    jsdrv_stats_group_initialize(&g, 2);
+    block_make(&b[0], 0, 0, 1.0);
+    block_make(&b[1], 1, 0, 2.0);
+    b[0].charge_i128[0] = 0xffffffffffffffffULL;
+    b[1].charge_i128[0] = 1;
+    b[0].energy_i128[0] = 5;
+    b[1].energy_i128[0] = (uint64_t) -2;
+    b[1].energy_i128[1] = (uint64_t) -1;
+    assert_null(jsdrv_stats_group_add(&g, 0, &b[0]));
+    const struct jsdrv_statistics_s * v = jsdrv_stats_group_add(&g, 1, &b[1]);
+    assert_non_null(v);
+    assert_int_equal(b[0].block_sample_id, v->block_sample_id);
+    assert_int_equal(SCNT, v->block_sample_count);
+    assert_memory_equal(&b[0].time_map, &v->time_map, sizeof(v->time_map));
+    assert_float_equal(3.0, v->i_avg, 1e-12);
+    assert_float_equal(sqrt(0.09 + 0.36), v->i_std, 1e-12);
+    assert_float_equal(1.5, v->i_min, 1e-12);
+    assert_float_equal(6.0, v->i_max, 1e-12);
+    assert_float_equal(3.0 + 8.0, v->p_avg, 1e-12);
+    assert_float_equal(3.5, v->v_avg, 1e-12);
+    assert_float_equal(0.5, v->v_std, 1e-12);
+    assert_float_equal(3.0, v->v_min, 1e-12);
+    assert_float_equal(4.0, v->v_max, 1e-12);
+    assert_float_equal(3.0, v->charge_f64, 1e-12);
+    assert_float_equal(11.0, v->energy_f64, 1e-12);
+    assert_int_equal(0, v->charge_i128[0]);
+    assert_int_equal(1, v->charge_i128[1]);
+    assert_int_equal(3, v->energy_i128[0]);
+    assert_int_equal(0, v->energy_i128[1]);
+}
+
+static void test_align(void ** state) {
+    (void) state;
+    struct jsdrv_stats_group_s g;
+    struct jsdrv_statistics_s b;
+    const struct jsdrv_statistics_s * v;
+    jsdrv_stats_group_initialize(&g, 3);
+
+    block_make(&b, 0, 0, 1.0);
+    assert_null(jsdrv_stats_group_add(&g, 0, &b));
+    block_make(&b, 1, 0, 1.0);
+    assert_null(jsdrv_stats_group_add(&g, 1, &b));
+    block_make(&b, 2, 1, 1.0);  // member 2 missed period 0, which is discarded
+    assert_null(jsdrv_stats_group_add(&g, 2, &b));
+    block_make(&b, 1, 0, 1.0);  // late, before the pending period
+    assert_null(jsdrv_stats_group_add(&g, 1, &b));
+    block_make(&b, 0, 1, 1.0);
+    assert_null(jsdrv_stats_group_add(&g, 0, &b));
+    block_make(&b, 1, 1, 1.0);
+    v = jsdrv_stats_group_add(&g, 1, &b);
+    assert_non_null(v);
+    assert_float_equal(3.0, v->i_avg, 1e-12);
+    assert_float_equal(6.0, v->charge_f64, 1e-12);
+
+    // the next period starts empty
+    block_make(&b, 2, 2, 1.0);
+    assert_null(jsdrv_stats_group_add(&g, 2, &b));
+    assert_null(jsdrv_stats_group_add(&g, 3, &b));
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_sum),
+            cmocka_unit_test(test_align),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
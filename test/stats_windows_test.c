@@ -0,0 +1,176 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <math.h>
+#include "jsdrv_prv/stats_windows.h"
+#include "jsdrv/error_code.h"
+
+
+#define SCNT (100U)
+#define BLOCKS (60U)
+
+static double x_[BLOCKS * SCNT];
+
+
+static double sample(uint32_t k) {
+    return sin(k * 0.01) + 0.001 * (k % 7);
+}
+
+static void expect_stats(uint32_t start, uint32_t n, double * avg, double * std, double * x_min, double * x_max) {
+    double sum = 0.0;
+    *x_min = x_[start];
+    *x_max = x_[start];
+    for (uint32_t k = start; k < start + n; ++k) {
+        sum += x_[k];
+        *x_min = (x_[k] < *x_min) ? x_[k] : *x_min;
+        *x_max = (x_[k] > *x_max) ? x_[k] : *x_max;
+    }
+    *avg = sum / n;
+    double var = 0.0;
+    for (uint32_t k = start; k < start + n; ++k) {
+        var += (x_[k] - *avg) * (x_[k] - *avg);
+    }
+    *std = sqrt(var / n);
+}
+
+static void block_make(uint32_t idx, struct jsdrv_statistics_s * b) {
+    memset(b, 0, sizeof(*b));
+    b->version = 1;
+    b->decimate_factor = 1;
+    b->block_sample_count = SCNT;
+    b->sample_freq = 1000;
+    b->block_sample_id = idx * SCNT;
+    b->charge_f64 = (double) idx;
+    expect_stats(idx * SCNT, SCNT, &b->i_avg, &b->i_std, &b->i_min, &b->i_max);
+    b->v_avg = 2.0 * b->i_avg;
+    b->v_std = 2.0 * b->i_std;
+    b->v_min = 2.0 * b->i_min;
+    b->v_max = 2.0 * b->i_max;
+    b->p_avg = b->i_avg;
+    b->p_std = b->i_std;
+    b->p_min = b->i_min;
+    b->p_max = b->i_max;
+}
+
+static void check_window(const struct jsdrv_statistics_s * w, uint32_t block_end, uint32_t blocks) {
+    double avg;
+    double std;
+    double x_min;
+    double x_max;
+    uint32_t start = (block_end + 1 - blocks) * SCNT;
+    expect_stats(start, blocks * SCNT, &avg, &std, &x_min, &x_max);
+    assert_int_equal(blocks * SCNT, w->block_sample_count);
+    assert_int_equal(start, w->block_sample_id);
+    assert_float_equal((double) block_end, w->charge_f64, 0.0);
+    assert_float_equal(avg, w->i_avg, 1e-12);
+    assert_float_equal(std, w->i_std, 1e-12);
+    assert_float_equal(x_min, w->i_min, 0.0);
+    assert_float_equal(x_max, w->i_max, 0.0);
+    assert_float_equal(2.0 * avg, w->v_avg, 1e-12);
+    assert_float_equal(2.0 * std, w->v_std, 1e-12);
+}
+
+static void setup_samples(void) {
+    for (uint32_t k = 0; k < BLOCKS * SCNT; ++k) {
+        x_[k] = sample(k);
+    }
+}
+
+static void test_off(void ** state) {
+    (void) state;
+    struct jsdrv_stats_windows_s s;
+    struct jsdrv_statistics_s b;
+    setup_samples();
+    jsdrv_stats_windows_initialize(&s);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_stats_windows_scnt_set(&s, JSDRV_STATS_WINDOWS_COUNT, SCNT));
+    assert_int_equal(0, jsdrv_stats_windows_scnt_set(&s, 0, SCNT * 5 / 2));  // not a multiple
+    for (uint32_t idx = 0; idx < BLOCKS; ++idx) {
+        block_make(idx, &b);
+        assert_int_equal(0, jsdrv_stats_windows_add(&s, &b));
+    }
+}
+
+static void test_hierarchy(void ** state) {
+    (void) state;
+    struct jsdrv_stats_windows_s s;
+    struct jsdrv_statistics_s b;
+    setup_samples();
+    jsdrv_stats_windows_initialize(&s);
+    assert_int_equal(0, jsdrv_stats_windows_scnt_set(&s, 0, SCNT * 30));
+    assert_int_equal(0, jsdrv_stats_windows_scnt_set(&s, 1, SCNT * 10));
+    for (uint32_t idx = 0; idx < BLOCKS; ++idx) {
+        block_make(idx, &b);
+        uint32_t expect = 0;
+        expect |= ((idx % 30) == 29) ? 1 : 0;
+        expect |= ((idx % 10) == 9) ? 2 : 0;
+        assert_int_equal(expect, jsdrv_stats_windows_add(&s, &b));
+        if (idx == 0) {
+            assert_int_equal(1, s.windows[0].source);  // combines window 1
+            assert_int_equal(3, s.windows[0].step);
+            assert_int_equal(-1, s.windows[1].source);
+        }
+        if (expect & 1) {
+            check_window(jsdrv_stats_windows_value(&s, 0), idx, 30);
+        }
+        if (expect & 2) {
+            check_window(jsdrv_stats_windows_value(&s, 1), idx, 10);
+        }
+    }
+}
+
+static void test_independent(void ** state) {
+    (void) state;
+    struct jsdrv_stats_windows_s s;
+    struct jsdrv_statistics_s b;
+    setup_samples();
+    jsdrv_stats_windows_initialize(&s);
+    assert_int_equal(0, jsdrv_stats_windows_scnt_set(&s, 0, SCNT * 4));
+    assert_int_equal(0, jsdrv_stats_windows_scnt_set(&s, 1, SCNT * 6));
+    for (uint32_t idx = 0; idx < 12; ++idx) {
+        block_make(idx, &b);
+        uint32_t completed = jsdrv_stats_windows_add(&s, &b);
+        assert_int_equal(((idx % 4) == 3) ? 1 : 0, completed & 1);
+        assert_int_equal(((idx % 6) == 5) ? 2 : 0, completed & 2);
+        if (completed & 2) {
+            check_window(jsdrv_stats_windows_value(&s, 1), idx, 6);
+        }
+    }
+    assert_int_equal(-1, s.windows[1].source);
+
+    // a new device block size discards the partial windows
+    jsdrv_stats_windows_clear(&s);
+    block_make(0, &b);
+    b.block_sample_count = SCNT * 2;
+    assert_int_equal(0, jsdrv_stats_windows_add(&s, &b));
+    assert_int_equal(2, s.windows[0].ratio);
+    assert_int_equal(3, s.windows[1].ratio);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_off),
+            cmocka_unit_test(test_hierarchy),
+            cmocka_unit_test(test_independent),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
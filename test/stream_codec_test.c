@@ -0,0 +1,102 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <math.h>
+#include "jsdrv/stream_codec.h"
+#include "jsdrv/error_code.h"
+
+
+static struct jsdrv_stream_signal_s src_;
+static struct jsdrv_stream_signal_s dst_;
+static uint8_t encoded_[sizeof(struct jsdrv_stream_signal_s) + 4096];
+
+static void src_f32(uint32_t n) {
+    memset(&src_, 0, sizeof(src_));
+    src_.sample_id = 1000;
+    src_.field_id = JSDRV_FIELD_CURRENT;
+    src_.element_type = JSDRV_DATA_TYPE_FLOAT;
+    src_.element_size_bits = 32;
+    src_.element_count = n;
+    src_.sample_rate = 1000000;
+    src_.decimate_factor = 2;
+    float * x = (float *) src_.data;
+    for (uint32_t k = 0; k < n; ++k) {
+        x[k] = 0.001f + 1e-6f * sinf(k * 0.01f);
+    }
+}
+
+static void test_round_trip(void ** state) {
+    (void) state;
+    src_f32(10000);
+    uint32_t size = jsdrv_stream_codec_encode(JSDRV_STREAM_CODEC_F32, encoded_, sizeof(encoded_), &src_);
+    assert_true(size > JSDRV_STREAM_HEADER_SIZE);
+    assert_true(size < (JSDRV_STREAM_HEADER_SIZE + 10000 * sizeof(float) / 2));
+    memset(&dst_, 0, sizeof(dst_));
+    assert_int_equal(0, jsdrv_stream_codec_decode(JSDRV_STREAM_CODEC_F32, &dst_, sizeof(dst_), encoded_, size));
+    assert_memory_equal(&src_, &dst_, JSDRV_STREAM_HEADER_SIZE + 10000 * sizeof(float));
+}
+
+static void test_not_applicable(void ** state) {
+    (void) state;
+    src_f32(100);
+    assert_int_equal(0, jsdrv_stream_codec_encode(JSDRV_STREAM_CODEC_NONE, encoded_, sizeof(encoded_), &src_));
+    assert_int_equal(0, jsdrv_stream_codec_encode(JSDRV_STREAM_CODEC_F32, encoded_, 64, &src_));
+    src_.element_type = JSDRV_DATA_TYPE_UINT;
+    src_.element_size_bits = 4;
+    assert_int_equal(0, jsdrv_stream_codec_encode(JSDRV_STREAM_CODEC_F32, encoded_, sizeof(encoded_), &src_));
+
+    // random bits do not compress
+    src_f32(100);
+    uint32_t lfsr = 1;
+    for (uint32_t k = 0; k < 100; ++k) {
+        lfsr = (lfsr * 1664525U) + 1013904223U;
+        memcpy(src_.data + k * 4, &lfsr, sizeof(lfsr));
+    }
+    assert_int_equal(0, jsdrv_stream_codec_encode(JSDRV_STREAM_CODEC_F32, encoded_, sizeof(encoded_), &src_));
+}
+
+static void test_decode_invalid(void ** state) {
+    (void) state;
+    src_f32(100);
+    uint32_t size = jsdrv_stream_codec_encode(JSDRV_STREAM_CODEC_F32, encoded_, sizeof(encoded_), &src_);
+    assert_true(size > 0);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID,
+                     jsdrv_stream_codec_decode(JSDRV_STREAM_CODEC_NONE, &dst_, sizeof(dst_), encoded_, size));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID,
+                     jsdrv_stream_codec_decode(JSDRV_STREAM_CODEC_F32, &dst_, sizeof(dst_), encoded_, size - 1));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID,
+                     jsdrv_stream_codec_decode(JSDRV_STREAM_CODEC_F32, &dst_, JSDRV_STREAM_HEADER_SIZE + 396,
+                                               encoded_, size));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID,
+                     jsdrv_stream_codec_decode(JSDRV_STREAM_CODEC_F32, &dst_, sizeof(dst_), encoded_, 16));
+    assert_int_equal(0, jsdrv_stream_codec_decode(JSDRV_STREAM_CODEC_F32, &dst_, JSDRV_STREAM_HEADER_SIZE + 400,
+                                                  encoded_, size));
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_round_trip),
+            cmocka_unit_test(test_not_applicable),
+            cmocka_unit_test(test_decode_invalid),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/stream_flush.h"
+#include "jsdrv/error_code.h"
+
+
+#define FS (2000000U)
+
+
+static void test_fixed(void **state) {
+    (void) state;
+    struct jsdrv_stream_flush_s f;
+    jsdrv_stream_flush_initialize(&f);
+    assert_int_equal(100000, jsdrv_stream_flush_element_count_max(&f, FS, 32));
+    assert_int_equal(1, jsdrv_stream_flush_element_count_max(&f, 1, 32));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_stream_flush_ms_set(&f, 0));
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_stream_flush_ms_set(&f, JSDRV_STREAM_FLUSH_MS_MAX + 1));
+    assert_int_equal(0, jsdrv_stream_flush_ms_set(&f, 1));
+    assert_int_equal(2000, jsdrv_stream_flush_element_count_max(&f, FS, 32));
+    jsdrv_stream_flush_update(&f, 1000);  // fixed ignores queue depth
+    assert_int_equal(2000, jsdrv_stream_flush_element_count_max(&f, FS, 32));
+}
+
+static void test_bytes(void **state) {
+    (void) state;
+    struct jsdrv_stream_flush_s f;
+    jsdrv_stream_flush_initialize(&f);
+    jsdrv_stream_flush_bytes_set(&f, 4096);
+    assert_int_equal(1024, jsdrv_stream_flush_element_count_max(&f, FS, 32));
+    assert_int_equal(8192, jsdrv_stream_flush_element_count_max(&f, FS, 4));
+    assert_int_equal(500, jsdrv_stream_flush_element_count_max(&f, 10000, 32));  // duration limits
+    jsdrv_stream_flush_bytes_set(&f, 1);
+    assert_int_equal(1, jsdrv_stream_flush_element_count_max(&f, FS, 32));
+}
+
+static void test_adaptive(void **state) {
+    (void) state;
+    struct jsdrv_stream_flush_s f;
+    jsdrv_stream_flush_initialize(&f);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_stream_flush_mode_set(&f, 2));
+    assert_int_equal(0, jsdrv_stream_flush_ms_set(&f, 10));
+    assert_int_equal(0, jsdrv_stream_flush_mode_set(&f, JSDRV_STREAM_FLUSH_MODE_ADAPTIVE));
+    jsdrv_stream_flush_update(&f, JSDRV_STREAM_FLUSH_DEPTH_LOW + 1);  // hold
+    assert_int_equal(10, f.ms_now);
+    jsdrv_stream_flush_update(&f, JSDRV_STREAM_FLUSH_DEPTH_HIGH);
+    assert_int_equal(20, f.ms_now);
+    assert_int_equal(40000, jsdrv_stream_flush_element_count_max(&f, FS, 32));
+    for (int i = 0; i < 10; ++i) {
+        jsdrv_stream_flush_update(&f, JSDRV_STREAM_FLUSH_DEPTH_HIGH);
+    }
+    assert_int_equal(JSDRV_STREAM_FLUSH_MS_MAX, f.ms_now);
+    jsdrv_stream_flush_update(&f, JSDRV_STREAM_FLUSH_DEPTH_HIGH - 1);  // hold
+    assert_int_equal(JSDRV_STREAM_FLUSH_MS_MAX, f.ms_now);
+    jsdrv_stream_flush_update(&f, 0);
+    assert_int_equal(JSDRV_STREAM_FLUSH_MS_MAX / 2, f.ms_now);
+    for (int i = 0; i < 10; ++i) {
+        jsdrv_stream_flush_update(&f, 0);
+    }
+    assert_int_equal(10, f.ms_now);
+    jsdrv_stream_flush_update(&f, JSDRV_STREAM_FLUSH_DEPTH_HIGH);
+    assert_int_equal(0, jsdrv_stream_flush_mode_set(&f, JSDRV_STREAM_FLUSH_MODE_FIXED));
+    assert_int_equal(10, f.ms_now);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_fixed),
+            cmocka_unit_test(test_bytes),
+            cmocka_unit_test(test_adaptive),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
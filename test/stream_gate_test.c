@@ -0,0 +1,147 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/stream_gate.h"
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv/time.h"
+
+
+static struct jsdrv_stream_signal_s s_;
+
+
+static struct jsdrv_stream_signal_s * f32_signal(uint64_t sample_id, uint32_t decimate_factor, uint32_t count) {
+    struct jsdrv_stream_signal_s * s = &s_;
+    s->sample_id = sample_id;
+    s->decimate_factor = decimate_factor;
+    s->element_type = JSDRV_DATA_TYPE_FLOAT;
+    s->element_size_bits = 32;
+    s->element_count = count;
+    float * data = (float *) s->data;
+    for (uint32_t i = 0; i < count; ++i) {
+        data[i] = (float) i;
+    }
+    return s;
+}
+
+static void test_passthrough(void **state) {
+    (void) state;
+    struct jsdrv_stream_gate_s g;
+    jsdrv_stream_gate_initialize(&g);
+    struct jsdrv_stream_signal_s * s = f32_signal(1000, 2, 100);
+    assert_false(jsdrv_stream_gate_flush(&g, s));
+    assert_int_equal(100, jsdrv_stream_gate_apply(&g, s));
+    assert_int_equal(1000, s->sample_id);
+}
+
+static void test_window_f32(void **state) {
+    (void) state;
+    struct jsdrv_stream_gate_s g = {.start = 1010, .stop = 1101};
+    struct jsdrv_stream_signal_s * s = f32_signal(0, 2, 100);
+    assert_int_equal(0, jsdrv_stream_gate_apply(&g, s));  // before start
+
+    s = f32_signal(1000, 2, 100);   // samples 1000 to 1198
+    assert_true(jsdrv_stream_gate_flush(&g, s));
+    assert_int_equal(46, jsdrv_stream_gate_apply(&g, s));  // 1010 to 1100
+    assert_int_equal(1010, s->sample_id);
+    float * data = (float *) s->data;
+    assert_true(5.0f == data[0]);
+    assert_true(50.0f == data[45]);
+
+    s = f32_signal(1005, 2, 100);   // start between samples rounds up
+    assert_int_equal(45, jsdrv_stream_gate_apply(&g, s));
+    assert_int_equal(1011, s->sample_id);
+
+    s = f32_signal(1101, 2, 100);
+    assert_false(jsdrv_stream_gate_flush(&g, s));
+    assert_int_equal(0, jsdrv_stream_gate_apply(&g, s));  // after stop
+}
+
+static void test_flush(void **state) {
+    (void) state;
+    struct jsdrv_stream_gate_s g = {.start = 0, .stop = 2000};
+    assert_false(jsdrv_stream_gate_flush(&g, f32_signal(1000, 1, 999)));
+    assert_true(jsdrv_stream_gate_flush(&g, f32_signal(1000, 1, 1000)));
+    assert_false(jsdrv_stream_gate_flush(&g, f32_signal(1000, 1, 0)));
+}
+
+static void test_packed_u1(void **state) {
+    (void) state;
+    struct jsdrv_stream_gate_s g = {.start = 3, .stop = 20};
+    struct jsdrv_stream_signal_s * s = &s_;
+    s->sample_id = 0;
+    s->decimate_factor = 1;
+    s->element_type = JSDRV_DATA_TYPE_UINT;
+    s->element_size_bits = 1;
+    s->element_count = 32;
+    s->data[0] = 0xa5;  // 1010 0101
+    s->data[1] = 0x3c;  // 0011 1100
+    s->data[2] = 0xff;
+    s->data[3] = 0x00;
+    assert_int_equal(17, jsdrv_stream_gate_apply(&g, s));
+    assert_int_equal(3, s->sample_id);
+    assert_int_equal(0x94, s->data[0]);          // bits 3..10
+    assert_int_equal(0xe7, s->data[1]);          // bits 11..18
+    assert_int_equal(0x01, s->data[2] & 0x01);   // bit 19
+}
+
+static void test_packed_u4(void **state) {
+    (void) state;
+    struct jsdrv_stream_gate_s g = {.start = 1, .stop = 0};
+    struct jsdrv_stream_signal_s * s = &s_;
+    s->sample_id = 0;
+    s->decimate_factor = 1;
+    s->element_type = JSDRV_DATA_TYPE_UINT;
+    s->element_size_bits = 4;
+    s->element_count = 4;
+    s->data[0] = 0x21;
+    s->data[1] = 0x43;
+    assert_int_equal(3, jsdrv_stream_gate_apply(&g, s));
+    assert_int_equal(0x32, s->data[0]);
+    assert_int_equal(0x04, s->data[1] & 0x0f);
+}
+
+static void test_utc(void **state) {
+    (void) state;
+    uint64_t sample_id = 0;
+    struct jsdrv_time_map_s map = {.offset_time = 0, .offset_counter = 0, .counter_rate = 2000000.0};
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_stream_gate_utc_to_sample_id(&map, JSDRV_TIME_SECOND, &sample_id));
+    map.offset_time = JSDRV_TIME_SECOND * 10;
+    map.offset_counter = 1000;
+    assert_int_equal(0, jsdrv_stream_gate_utc_to_sample_id(&map, JSDRV_TIME_SECOND * 11, &sample_id));
+    assert_int_equal(2001000, sample_id);
+    assert_int_equal(0, jsdrv_stream_gate_utc_to_sample_id(&map, JSDRV_TIME_SECOND, &sample_id));
+    assert_int_equal(1, sample_id);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_passthrough),
+            cmocka_unit_test(test_window_f32),
+            cmocka_unit_test(test_flush),
+            cmocka_unit_test(test_packed_u1),
+            cmocka_unit_test(test_packed_u4),
+            cmocka_unit_test(test_utc),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/stream_health.h"
+#include <string.h>
+
+
+static void test_json_empty(void **state) {
+    (void) state;
+    char buf[512];
+    struct jsdrv_stream_health_s h;
+    jsdrv_stream_health_clear(&h);
+    uint32_t sz = jsdrv_stream_health_json(&h, buf, sizeof(buf));
+    const char * expect = "{\"frames\": 0, \"bytes\": 0, \"frame_id_mismatch\": 0, \"frames_lost\": 0, "
+                          "\"inactive\": 0, \"discard\": 0, \"ports\": []}";
+    assert_string_equal(expect, buf);
+    assert_int_equal(strlen(expect), sz);
+}
+
+static void test_json_ports(void **state) {
+    (void) state;
+    char buf[512];
+    struct jsdrv_stream_health_s h;
+    jsdrv_stream_health_clear(&h);
+    h.frames = 5000000000LLU;
+    h.bytes = 2;
+    h.frame_id_mismatch = 3;
+    h.frames_lost = 4;
+    h.inactive = 5;
+    h.discard = 6;
+    h.port[5].frames = 10;
+    h.port[5].samples = 1260;
+    h.port[5].skips = 1;
+    h.port[5].skip_samples = 252;
+    h.port[6].frames = 11;
+    h.port[6].dups = 2;
+    h.port[6].dup_samples = 8;
+    h.port[6].resyncs = 3;
+    h.port[6].drops = 4;
+    assert_true(jsdrv_stream_health_json(&h, buf, sizeof(buf)) > 0);
+    assert_string_equal("{\"frames\": 5000000000, \"bytes\": 2, \"frame_id_mismatch\": 3, \"frames_lost\": 4, "
+                        "\"inactive\": 5, \"discard\": 6, \"ports\": ["
+                        "{\"port\": 5, \"frames\": 10, \"samples\": 1260, \"skips\": 1, \"skip_samples\": 252, "
+                        "\"dups\": 0, \"dup_samples\": 0, \"resyncs\": 0, \"drops\": 0}, "
+                        "{\"port\": 6, \"frames\": 11, \"samples\": 0, \"skips\": 0, \"skip_samples\": 0, "
+                        "\"dups\": 2, \"dup_samples\": 8, \"resyncs\": 3, \"drops\": 4}]}", buf);
+}
+
+static void test_json_truncate(void **state) {
+    (void) state;
+    char buf[64];
+    struct jsdrv_stream_health_s h;
+    jsdrv_stream_health_clear(&h);
+    assert_int_equal(0, jsdrv_stream_health_json(&h, buf, sizeof(buf)));
+    assert_int_equal(0, jsdrv_stream_health_json(&h, NULL, 0));
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_json_empty),
+            cmocka_unit_test(test_json_ports),
+            cmocka_unit_test(test_json_truncate),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv/stream_ring.h"
+#include "jsdrv/error_code.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+#define SIZE (1U << 18)
+#define COUNT (1000U)
+
+static struct jsdrv_stream_signal_s * signal_;
+static float buffer_[SIZE / sizeof(float)];
+
+static int setup(void ** state) {
+    (void) state;
+    signal_ = calloc(1, sizeof(*signal_));
+    return 0;
+}
+
+static int teardown(void ** state) {
+    (void) state;
+    free(signal_);
+    return 0;
+}
+
+// Publish float32 samples whose values are their sample_id.
+static void publish_f32(struct jsdrv_stream_ring_s * r, uint64_t sample_id, uint32_t count) {
+    signal_->sample_id = sample_id;
+    signal_->field_id = JSDRV_FIELD_CURRENT;
+    signal_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    signal_->element_size_bits = 32;
+    signal_->element_count = count;
+    signal_->sample_rate = 1000000;
+    signal_->decimate_factor = 1;
+    float * data = (float *) signal_->data;
+    for (uint32_t i = 0; i < count; ++i) {
+        data[i] = (float) (sample_id + i);
+    }
+    struct jsdrv_union_s v = jsdrv_union_bin((const uint8_t *) signal_, JSDRV_STREAM_HEADER_SIZE + count * sizeof(float));
+    v.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    jsdrv_stream_ring_on_publish(r, "u/js220/0123/s/i/!data", &v);
+}
+
+static void check_f32(const struct jsdrv_stream_ring_info_s * info, uint64_t sample_id, uint32_t count) {
+    assert_int_equal(sample_id, info->sample_id);
+    assert_int_equal(count, info->element_count);
+    assert_int_equal(32, info->element_size_bits);
+    for (uint32_t i = 0; i < count; ++i) {
+        assert_float_equal((float) (sample_id + i), buffer_[i], 0.0f);
+    }
+}
+
+static void test_invalid(void ** state) {
+    (void) state;
+    struct jsdrv_stream_ring_info_s info;
+    assert_null(jsdrv_stream_ring_alloc(SIZE / 2));
+    assert_null(jsdrv_stream_ring_alloc(SIZE + 1));
+    struct jsdrv_stream_ring_s * r = jsdrv_stream_ring_alloc(SIZE);
+    assert_non_null(r);
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_stream_ring_read(r, buffer_, 0, &info, 0));
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    struct jsdrv_union_s v = jsdrv_union_u32(1);
+    jsdrv_stream_ring_on_publish(r, "u/js220/0123/s/i/ctrl", &v);  // ignored
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    jsdrv_stream_ring_free(r);
+}
+
+static void test_read_many(void ** state) {
+    (void) state;
+    struct jsdrv_stream_ring_info_s info;
+    struct jsdrv_stream_ring_s * r = jsdrv_stream_ring_alloc(SIZE);
+    for (uint32_t k = 0; k < 10; ++k) {
+        publish_f32(r, 5000 + k * COUNT, COUNT);
+    }
+    assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    assert_int_equal(10, info.message_count);
+    assert_int_equal(0, info.drops);
+    assert_int_equal(JSDRV_FIELD_CURRENT, info.field_id);
+    assert_int_equal(1000000, info.sample_rate);
+    check_f32(&info, 5000, 10 * COUNT);
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_stream_ring_peek(r, &info, 0));
+    jsdrv_stream_ring_free(r);
+}
+
+static void test_partial_and_gap(void ** state) {
+    (void) state;
+    struct jsdrv_stream_ring_info_s info;
+    struct jsdrv_stream_ring_s * r = jsdrv_stream_ring_alloc(SIZE);
+    publish_f32(r, 0, COUNT);
+    publish_f32(r, COUNT, COUNT);
+    publish_f32(r, 3 * COUNT, COUNT);  // skip
+
+    assert_int_equal(0, jsdrv_stream_ring_peek(r, &info, 0));
+    assert_int_equal(0, info.sample_id);
+    assert_int_equal(COUNT, info.element_count);
+    assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, 1500 * sizeof(float), &info, 0));
+    check_f32(&info, 0, 1500);
+    assert_int_equal(0, jsdrv_stream_ring_peek(r, &info, 0));
+    assert_int_equal(1500, info.sample_id);
+    assert_int_equal(500, info.element_count);
+    assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    check_f32(&info, 1500, 500);  // stops at the skip
+    assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    check_f32(&info, 3 * COUNT, COUNT);
+    jsdrv_stream_ring_free(r);
+}
+
+static void test_overflow_and_wrap(void ** state) {
+    (void) state;
+    struct jsdrv_stream_ring_info_s info;
+    struct jsdrv_stream_ring_s * r = jsdrv_stream_ring_alloc(SIZE);
+    const uint32_t count = 4000;  // 16 kB messages
+    uint64_t sample_id = 0;
+    for (uint32_t k = 0; k < 20; ++k, sample_id += count) {
+        publish_f32(r, sample_id, count);
+    }
+    assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    assert_int_equal(16, info.message_count);  // ring full
+    assert_int_equal(4, info.drops);
+    check_f32(&info, 0, 16 * count);
+
+    sample_id = 1000000;
+    for (uint32_t k = 0; k < 100; ++k, sample_id += count) {
+        publish_f32(r, sample_id, count);
+        if (k & 1) {
+            uint64_t expect = sample_id - count;
+            assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+            assert_int_equal(0, info.drops);
+            check_f32(&info, expect, 2 * count);
+        }
+    }
+    jsdrv_stream_ring_free(r);
+}
+
+static void test_unpack_u4(void ** state) {
+    (void) state;
+    struct jsdrv_stream_ring_info_s info;
+    struct jsdrv_stream_ring_s * r = jsdrv_stream_ring_alloc(SIZE);
+    signal_->sample_id = 10;
+    signal_->element_type = JSDRV_DATA_TYPE_UINT;
+    signal_->element_size_bits = 4;
+    signal_->element_count = 5;
+    signal_->decimate_factor = 2;
+    signal_->data[0] = 0x21;
+    signal_->data[1] = 0x43;
+    signal_->data[2] = 0x05;
+    struct jsdrv_union_s v = jsdrv_union_bin((const uint8_t *) signal_, JSDRV_STREAM_HEADER_SIZE + 3);
+    v.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    jsdrv_stream_ring_on_publish(r, "u/js220/0123/s/i/range/!data", &v);
+    signal_->sample_id = 20;
+    jsdrv_stream_ring_on_publish(r, "u/js220/0123/s/i/range/!data", &v);
+
+    uint8_t * u8 = (uint8_t *) buffer_;
+    assert_int_equal(0, jsdrv_stream_ring_read(r, u8, sizeof(buffer_), &info, 0));
+    assert_int_equal(8, info.element_size_bits);
+    assert_int_equal(10, info.sample_id);
+    assert_int_equal(10, info.element_count);
+    for (uint32_t i = 0; i < 10; ++i) {
+        assert_int_equal(1 + (i % 5), u8[i]);
+    }
+    jsdrv_stream_ring_free(r);
+}
+
+static void test_hold(void ** state) {
+    (void) state;
+    struct jsdrv_stream_ring_info_s info;
+    struct jsdrv_stream_ring_s * r = jsdrv_stream_ring_alloc(SIZE);
+    publish_f32(r, 0, COUNT);
+    signal_->sample_id = COUNT;
+    signal_->element_type = JSDRV_DATA_TYPE_HOLD;
+    signal_->element_size_bits = sizeof(struct jsdrv_stream_hold_s) * 8;
+    signal_->element_count = 1;
+    struct jsdrv_stream_hold_s * hold = (struct jsdrv_stream_hold_s *) signal_->data;
+    hold->sample_count = 3 * COUNT;
+    hold->min = 7.0f;
+    hold->max = 8.0f;
+    hold->mean = 7.5f;
+    struct jsdrv_union_s v = jsdrv_union_bin((const uint8_t *) signal_, JSDRV_STREAM_HEADER_SIZE + sizeof(*hold));
+    v.app = JSDRV_PAYLOAD_TYPE_STREAM;
+    jsdrv_stream_ring_on_publish(r, "u/js220/0123/s/i/!data", &v);
+    publish_f32(r, 4 * COUNT, COUNT);
+
+    // holds expand to their mean and join the neighbouring float32 messages
+    assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, 2 * COUNT * sizeof(float), &info, 0));
+    assert_int_equal(2, info.message_count);
+    assert_int_equal(JSDRV_DATA_TYPE_FLOAT, info.element_type);
+    assert_int_equal(0, info.sample_id);
+    assert_int_equal(2 * COUNT, info.element_count);
+    for (uint32_t i = 0; i < 2 * COUNT; ++i) {
+        float expect = (i < COUNT) ? (float) i : 7.5f;
+        assert_float_equal(expect, buffer_[i], 0.0f);
+    }
+    assert_int_equal(0, jsdrv_stream_ring_peek(r, &info, 0));
+    assert_int_equal(2 * COUNT, info.sample_id);
+    assert_int_equal(2 * COUNT, info.element_count);
+    assert_int_equal(32, info.element_size_bits);
+    assert_int_equal(0, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    assert_int_equal(2 * COUNT, info.sample_id);
+    assert_int_equal(3 * COUNT, info.element_count);
+    for (uint32_t i = 0; i < 3 * COUNT; ++i) {
+        float expect = (i < 2 * COUNT) ? 7.5f : (float) (2 * COUNT + i);
+        assert_float_equal(expect, buffer_[i], 0.0f);
+    }
+    assert_int_equal(JSDRV_ERROR_TIMED_OUT, jsdrv_stream_ring_read(r, buffer_, sizeof(buffer_), &info, 0));
+    jsdrv_stream_ring_free(r);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_invalid),
+            cmocka_unit_test(test_read_many),
+            cmocka_unit_test(test_partial_and_gap),
+            cmocka_unit_test(test_overflow_and_wrap),
+            cmocka_unit_test(test_unpack_u4),
+            cmocka_unit_test(test_hold),
+    };
+
+    return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -19,6 +19,7 @@
 #include <setjmp.h>
 #include <cmocka.h>
 #include "jsdrv_prv/time_map_filter.h"
+#include <math.h>
 
 
 #define FREQ (2000000LLU)
@@ -64,12 +65,94 @@ static void test_add_multiple(void **state) {
     jsdrv_tmf_free(t);
 }
 
+static uint32_t lfsr_next(uint32_t * lfsr) {
+    *lfsr = (*lfsr * 1664525U) + 1013904223U;
+    return *lfsr;
+}
+
+static void test_add_many_matches_window_min(void **state) {
+    (void) state;
+    enum { POINTS = 16, COUNT = 200 };
+    uint64_t counters[COUNT];
+    int64_t utcs[COUNT];
+    uint32_t lfsr = 1;
+    struct jsdrv_time_map_s tm;
+    struct jsdrv_tmf_s * t = jsdrv_tmf_new(FREQ, POINTS, JSDRV_TIME_SECOND / 2);  // accept the jitter
+    assert_non_null(t);
+    for (uint32_t i = 0; i < COUNT; ++i) {
+        counters[i] = (i + 1) * FREQ;
+        utcs[i] = (i + 1) * JSDRV_TIME_SECOND + (lfsr_next(&lfsr) >> 8) % JSDRV_TIME_MILLISECOND;
+        jsdrv_tmf_add(t, counters[i], utcs[i]);
+        uint32_t tail = (i >= POINTS) ? (i + 1 - POINTS) : 0;
+        int64_t expect = INT64_MAX;
+        for (uint32_t k = tail; k <= i; ++k) {
+            int64_t v = utcs[k] - JSDRV_COUNTER_TO_TIME(counters[k] - counters[tail], FREQ);
+            if (v < expect) {
+                expect = v;
+            }
+        }
+        jsdrv_tmf_get(t, &tm);
+        assert_int_equal(counters[tail], tm.offset_counter);
+        assert_in_range(tm.offset_time, expect - 1, expect + 1);
+        assert_int_equal(FREQ, tm.counter_rate);
+    }
+    jsdrv_tmf_free(t);
+}
+
+static void test_rate_estimate(void **state) {
+    (void) state;
+    uint32_t lfsr = 1;
+    double rate = FREQ * (1.0 + 50e-6);
+    struct jsdrv_time_map_s tm;
+    struct jsdrv_tmf_s * t = jsdrv_tmf_new(FREQ, 60, JSDRV_TIME_SECOND);
+    assert_non_null(t);
+    jsdrv_tmf_rate_estimate(t, true);
+    for (uint32_t i = 1; i <= 200; ++i) {
+        uint64_t counter = (uint64_t) (i * rate);
+        int64_t utc = i * JSDRV_TIME_SECOND + (lfsr_next(&lfsr) >> 8) % JSDRV_TIME_MILLISECOND;
+        jsdrv_tmf_add(t, counter, utc);
+    }
+    jsdrv_tmf_get(t, &tm);
+    assert_true(fabs(tm.counter_rate / rate - 1.0) < 5e-6);
+    int64_t utc = jsdrv_time_from_counter(&tm, (uint64_t) (200 * rate));
+    assert_in_range(utc, 200 * JSDRV_TIME_SECOND - JSDRV_TIME_MILLISECOND, 200 * JSDRV_TIME_SECOND + JSDRV_TIME_MILLISECOND);
+
+    jsdrv_tmf_rate_estimate(t, false);
+    jsdrv_tmf_add(t, 60 * FREQ, JSDRV_TIME_MINUTE);
+    jsdrv_tmf_get(t, &tm);
+    assert_int_equal(FREQ, tm.counter_rate);
+    assert_int_equal(JSDRV_TIME_MINUTE, tm.offset_time);
+    jsdrv_tmf_free(t);
+}
+
+static void test_rate_estimate_long(void **state) {
+    (void) state;
+    uint32_t lfsr = 3;
+    double rate = FREQ * (1.0 - 20e-6);
+    struct jsdrv_time_map_s tm;
+    struct jsdrv_tmf_s * t = jsdrv_tmf_new(FREQ, 60, JSDRV_TIME_SECOND / 2);
+    assert_non_null(t);
+    jsdrv_tmf_rate_estimate(t, true);
+    for (uint32_t i = 1; i <= 4 * 3600; ++i) {  // 4 hours
+        uint64_t counter = (uint64_t) (i * rate);
+        int64_t utc = i * JSDRV_TIME_SECOND + (lfsr_next(&lfsr) >> 8) % JSDRV_TIME_MILLISECOND;
+        jsdrv_tmf_add(t, counter, utc);
+    }
+    jsdrv_tmf_get(t, &tm);
+    assert_true(fabs(tm.counter_rate / rate - 1.0) < 0.5e-6);
+    int64_t utc = jsdrv_time_from_counter(&tm, (uint64_t) (4 * 3600 * rate));
+    assert_in_range(utc, 4 * 3600 * JSDRV_TIME_SECOND - JSDRV_TIME_MILLISECOND, 4 * 3600 * JSDRV_TIME_SECOND + JSDRV_TIME_MILLISECOND);
+    jsdrv_tmf_free(t);
+}
 
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_new_free),
             cmocka_unit_test(test_add_one),
             cmocka_unit_test(test_add_multiple),
+            cmocka_unit_test(test_add_many_matches_window_min),
+            cmocka_unit_test(test_rate_estimate),
+            cmocka_unit_test(test_rate_estimate_long),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
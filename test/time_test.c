@@ -183,6 +183,34 @@ static void test_counter(void **state) {
     assert_int_equal(OFFSET1 - FS1, jsdrv_time_to_counter(&tmap, JSDRV_TIME_HOUR - JSDRV_TIME_SECOND));
 }
 
+static void test_counter_array(void **state) {
+    (void) state;
+    struct jsdrv_time_map_s tmap = {
+            .offset_time = JSDRV_TIME_HOUR,
+            .offset_counter = OFFSET1,
+            .counter_rate = FS1 * (1.0 + 37e-6),
+    };
+    uint64_t counter[16];
+    int64_t time64[16];
+    uint64_t counter2[16];
+    for (uint32_t i = 0; i < 16; ++i) {
+        counter[i] = OFFSET1 - 5 * FS1 + i * 7919;  // before and after offset
+    }
+    jsdrv_time_from_counter_array(&tmap, counter, time64, 16);
+    jsdrv_time_to_counter_array(&tmap, time64, counter2, 16);
+    for (uint32_t i = 0; i < 16; ++i) {
+        assert_int_equal(jsdrv_time_from_counter(&tmap, counter[i]), time64[i]);
+        assert_int_equal(jsdrv_time_to_counter(&tmap, time64[i]), counter2[i]);
+        assert_int_equal(counter[i], counter2[i]);
+    }
+
+    jsdrv_time_from_counter_range(&tmap, OFFSET1 - 3, 2, time64, 16);
+    for (uint32_t i = 0; i < 16; ++i) {
+        assert_int_equal(jsdrv_time_from_counter(&tmap, OFFSET1 - 3 + 2 * i), time64[i]);
+    }
+    jsdrv_time_from_counter_range(&tmap, 0, 1, time64, 0);  // empty
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_constants),
@@ -199,6 +227,7 @@ int main(void) {
             cmocka_unit_test(test_str),
             cmocka_unit_test(test_counter_trivial),
             cmocka_unit_test(test_counter),
+            cmocka_unit_test(test_counter_array),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
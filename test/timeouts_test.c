@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/timeouts.h"
+#include "jsdrv/cstr.h"
+#include <stdio.h>
+#include <string.h>
+
+
+#define COUNT (100)
+
+static struct jsdrvp_api_timeout_s entries_[COUNT];
+
+static struct jsdrvp_api_timeout_s * entry(uint32_t idx, const char * topic, int64_t timeout) {
+    struct jsdrvp_api_timeout_s * t = &entries_[idx];
+    memset(t, 0, sizeof(*t));
+    jsdrv_cstr_copy(t->topic, topic, sizeof(t->topic));
+    t->timeout = timeout;
+    return t;
+}
+
+static void test_empty(void **state) {
+    (void) state;
+    struct jsdrv_timeouts_s * s = jsdrv_timeouts_alloc();
+    assert_int_equal(0, jsdrv_timeouts_size(s));
+    assert_null(jsdrv_timeouts_peek(s));
+    assert_null(jsdrv_timeouts_pop(s));
+    assert_null(jsdrv_timeouts_pop_expired(s, 1000));
+    assert_null(jsdrv_timeouts_remove_topic(s, "a#"));
+    jsdrv_timeouts_free(s);
+}
+
+static void test_deadline_order(void **state) {
+    (void) state;
+    struct jsdrv_timeouts_s * s = jsdrv_timeouts_alloc();
+    char topic[32];
+    for (uint32_t i = 0; i < COUNT; ++i) {
+        snprintf(topic, sizeof(topic), "t/%u#", (unsigned int) i);
+        jsdrv_timeouts_add(s, entry(i, topic, (int64_t) ((i * 37) % COUNT)));
+    }
+    assert_int_equal(COUNT, jsdrv_timeouts_size(s));
+    assert_null(jsdrv_timeouts_pop_expired(s, -1));
+    for (int64_t i = 0; i < COUNT; ++i) {
+        struct jsdrvp_api_timeout_s * t = jsdrv_timeouts_pop_expired(s, i);
+        assert_non_null(t);
+        assert_int_equal(i, t->timeout);
+        assert_null(jsdrv_timeouts_pop_expired(s, i));
+    }
+    assert_int_equal(0, jsdrv_timeouts_size(s));
+    jsdrv_timeouts_free(s);
+}
+
+static void test_equal_deadline_fifo(void **state) {
+    (void) state;
+    struct jsdrv_timeouts_s * s = jsdrv_timeouts_alloc();
+    for (uint32_t i = 0; i < COUNT; ++i) {
+        jsdrv_timeouts_add(s, entry(i, "a#", 10));
+    }
+    for (uint32_t i = 0; i < COUNT; ++i) {
+        assert_ptr_equal(&entries_[i], jsdrv_timeouts_pop(s));
+    }
+    jsdrv_timeouts_free(s);
+}
+
+static void test_remove_topic(void **state) {
+    (void) state;
+    struct jsdrv_timeouts_s * s = jsdrv_timeouts_alloc();
+    char topic[32];
+    for (uint32_t i = 0; i < COUNT; ++i) {
+        snprintf(topic, sizeof(topic), "t/%u#", (unsigned int) (i % 10));
+        jsdrv_timeouts_add(s, entry(i, topic, (int64_t) (COUNT - i)));
+    }
+    // oldest matching topic first, regardless of deadline
+    assert_ptr_equal(&entries_[3], jsdrv_timeouts_remove_topic(s, "t/3#"));
+    assert_ptr_equal(&entries_[13], jsdrv_timeouts_remove_topic(s, "t/3#"));
+    assert_null(jsdrv_timeouts_remove_topic(s, "t/x#"));
+    assert_int_equal(COUNT - 2, jsdrv_timeouts_size(s));
+
+    // heap remains ordered after arbitrary removal
+    int64_t prev = -1;
+    struct jsdrvp_api_timeout_s * t;
+    uint32_t count = 0;
+    while (NULL != (t = jsdrv_timeouts_pop(s))) {
+        assert_true(t->timeout > prev);
+        assert_ptr_not_equal(&entries_[3], t);
+        assert_ptr_not_equal(&entries_[13], t);
+        prev = t->timeout;
+        ++count;
+    }
+    assert_int_equal(COUNT - 2, count);
+    jsdrv_timeouts_free(s);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_empty),
+            cmocka_unit_test(test_deadline_order),
+            cmocka_unit_test(test_equal_deadline_fifo),
+            cmocka_unit_test(test_remove_topic),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
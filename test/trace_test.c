@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jsdrv_prv/trace.h"
+#include "jsdrv_prv/thread.h"
+
+
+#define PATH "trace_test.json"
+#define WORKER_EVENTS (100U)
+
+
+static char * read_file(const char * path) {
+    FILE * f = fopen(path, "rb");
+    assert_non_null(f);
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char * s = malloc(sz + 1);
+    assert_int_equal(sz, (long) fread(s, 1, sz, f));
+    s[sz] = 0;
+    fclose(f);
+    return s;
+}
+
+static uint32_t count(const char * s, const char * pattern) {
+    uint32_t n = 0;
+    while (NULL != (s = strstr(s, pattern))) {
+        ++n;
+        s += strlen(pattern);
+    }
+    return n;
+}
+
+static THREAD_RETURN_TYPE worker_thread(THREAD_ARG_TYPE arg) {
+    (void) arg;
+    for (uint32_t i = 0; i < WORKER_EVENTS; ++i) {
+        JSDRV_TRACE_BEGIN("worker", "u/js220/0123", i);
+        JSDRV_TRACE_END("worker");
+    }
+    THREAD_RETURN();
+}
+
+static void test_disabled(void ** state) {
+    (void) state;
+    jsdrv_trace_clear();
+    JSDRV_TRACE_INSTANT("ignored", NULL, 0);
+    assert_int_equal(0, jsdrv_trace_export(PATH));
+    char * s = read_file(PATH);
+    assert_non_null(strstr(s, "\"traceEvents\""));
+    assert_int_equal(0, count(s, "ignored"));
+    free(s);
+}
+
+static void test_threads(void ** state) {
+    (void) state;
+    jsdrv_thread_t thread;
+    jsdrv_trace_clear();
+    jsdrv_trace_enable(true);
+    JSDRV_TRACE_BEGIN("main", "a\"b", 42);
+    assert_int_equal(0, jsdrv_thread_create(&thread, worker_thread, NULL, 0));
+    assert_int_equal(0, jsdrv_thread_join(&thread, 1000));
+    JSDRV_TRACE_END("main");
+    JSDRV_TRACE_INSTANT("mark", "ab", 7);
+    jsdrv_trace_enable(false);
+    JSDRV_TRACE_INSTANT("ignored", NULL, 0);
+    assert_int_equal(0, jsdrv_trace_export(PATH));
+
+    char * s = read_file(PATH);
+    assert_int_equal(1, count(s, "{\"name\": \"main\", \"ph\": \"B\""));
+    assert_int_equal(1, count(s, "{\"name\": \"main\", \"ph\": \"E\""));
+    assert_int_equal(1, count(s, "\"args\": {\"id\": 42, \"detail\": \"a\\\"b\"}"));
+    assert_int_equal(1, count(s, "{\"name\": \"mark\", \"ph\": \"i\""));
+    assert_int_equal(WORKER_EVENTS, count(s, "{\"name\": \"worker\", \"ph\": \"B\""));
+    assert_int_equal(WORKER_EVENTS, count(s, "{\"name\": \"worker\", \"ph\": \"E\""));
+    assert_int_equal(WORKER_EVENTS, count(s, "\"detail\": \"u/js220/0123\""));
+    assert_true(count(s, "\"name\": \"thread_name\"") >= 2);
+    assert_int_equal(0, count(s, "ignored"));
+    free(s);
+}
+
+static void test_wrap(void ** state) {
+    (void) state;
+    jsdrv_trace_clear();
+    jsdrv_trace_enable(true);
+    for (uint32_t i = 0; i < JSDRV_TRACE_RING_SIZE + 10; ++i) {
+        JSDRV_TRACE_INSTANT("wrap", NULL, i);
+    }
+    jsdrv_trace_enable(false);
+    assert_int_equal(0, jsdrv_trace_export(PATH));
+    char * s = read_file(PATH);
+    assert_int_equal(JSDRV_TRACE_RING_SIZE, count(s, "{\"name\": \"wrap\""));
+    assert_int_equal(0, count(s, "\"id\": 9,"));  // oldest overwritten
+    assert_int_equal(1, count(s, "\"id\": 10,"));
+    free(s);
+    remove(PATH);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_disabled),
+            cmocka_unit_test(test_threads),
+            cmocka_unit_test(test_wrap),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/trigger.h"
+#include <math.h>
+#include <string.h>
+
+
+static uint8_t src_buf_[JSDRV_STREAM_HEADER_SIZE + JSDRV_STREAM_DATA_SIZE];
+static struct jsdrv_stream_signal_s * src_ = (struct jsdrv_stream_signal_s *) src_buf_;
+
+static float * src_f32(uint64_t sample_id, uint32_t decimate_factor, uint32_t length, float value) {
+    memset(src_buf_, 0, sizeof(src_buf_));
+    src_->sample_id = sample_id;
+    src_->field_id = JSDRV_FIELD_CURRENT;
+    src_->element_type = JSDRV_DATA_TYPE_FLOAT;
+    src_->element_size_bits = 32;
+    src_->element_count = length;
+    src_->sample_rate = 1000000;
+    src_->decimate_factor = decimate_factor;
+    float * x = (float *) src_->data;
+    for (uint32_t i = 0; i < length; ++i) {
+        x[i] = value;
+    }
+    return x;
+}
+
+static void test_rise(void **state) {
+    (void) state;
+    struct jsdrv_trigger_s t;
+    uint64_t fire = 0;
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_RISE, 0.2f, 1);
+    float * x = src_f32(1000, 2, 1000, 0.0f);
+    x[0] = 1.0f;  // starting level is not an edge
+    x[1] = 0.2f;  // at threshold is below
+    assert_false(jsdrv_trigger_process(&t, src_, &fire));
+    x = src_f32(3000, 2, 1000, 0.0f);
+    x[333] = 0.3f;
+    x[600] = 0.4f;
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(3000 + 2 * 333, fire);
+
+    // fire forgets the level, so the next edge needs a new baseline
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_RISE, 0.2f, 1);
+    x = src_f32(5000, 2, 1000, 0.0f);
+    x[0] = 0.3f;
+    x[700] = 0.3f;
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(5000 + 2 * 700, fire);
+}
+
+static void test_duration(void **state) {
+    (void) state;
+    struct jsdrv_trigger_s t;
+    uint64_t fire = 0;
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_RISE, 0.2f, 10);
+    float * x = src_f32(0, 1, 1000, 0.0f);
+    for (uint32_t i = 100; i < 109; ++i) {
+        x[i] = 0.5f;  // 9 samples is too short
+    }
+    x[500] = NAN;
+    for (uint32_t i = 995; i < 1000; ++i) {
+        x[i] = 0.5f;  // continues into the next block
+    }
+    assert_false(jsdrv_trigger_process(&t, src_, &fire));
+    x = src_f32(1000, 1, 1000, 0.0f);
+    x[0] = 0.5f;
+    x[1] = NAN;  // ignored
+    for (uint32_t i = 2; i < 5; ++i) {
+        x[i] = 0.5f;
+    }
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(995, fire);
+}
+
+static void test_fall_and_cross(void **state) {
+    (void) state;
+    struct jsdrv_trigger_s t;
+    uint64_t fire = 0;
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_FALL, 1.0f, 3);
+    float * x = src_f32(0, 1, 100, 2.0f);
+    x[10] = 0.0f;
+    x[11] = 0.0f;
+    x[50] = 1.0f;
+    x[51] = 0.5f;
+    x[52] = -1.0f;
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(50, fire);
+
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_CROSS, 1.0f, 1);
+    x = src_f32(0, 1, 100, 2.0f);
+    x[40] = 0.0f;
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(40, fire);
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_CROSS, 1.0f, 1);
+    x = src_f32(0, 1, 100, 0.0f);
+    x[60] = 2.0f;
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(60, fire);
+}
+
+static void test_gap(void **state) {
+    (void) state;
+    struct jsdrv_trigger_s t;
+    uint64_t fire = 0;
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_RISE, 0.5f, 1);
+    src_f32(0, 1, 100, 0.0f);
+    assert_false(jsdrv_trigger_process(&t, src_, &fire));
+    float * x = src_f32(200, 1, 100, 1.0f);  // gap: the level is unknown
+    x[50] = 0.0f;
+    x[51] = 1.0f;
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(251, fire);
+}
+
+static void src_hold(uint64_t sample_id, uint64_t sample_count, float mean) {
+    memset(src_buf_, 0, sizeof(src_buf_));
+    src_->sample_id = sample_id;
+    src_->field_id = JSDRV_FIELD_CURRENT;
+    src_->element_type = JSDRV_DATA_TYPE_HOLD;
+    src_->element_size_bits = sizeof(struct jsdrv_stream_hold_s) * 8;
+    src_->element_count = 1;
+    src_->sample_rate = 1000000;
+    src_->decimate_factor = 1;
+    struct jsdrv_stream_hold_s * hold = (struct jsdrv_stream_hold_s *) src_->data;
+    hold->sample_count = sample_count;
+    hold->min = mean;
+    hold->max = mean;
+    hold->mean = mean;
+}
+
+static void test_hold(void **state) {
+    (void) state;
+    struct jsdrv_trigger_s t;
+    uint64_t fire = 0;
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_RISE, 0.2f, 5000);
+    src_f32(0, 1, 1000, 0.0f);
+    assert_false(jsdrv_trigger_process(&t, src_, &fire));
+    src_hold(1000, 3000, 0.5f);  // rises, but too short so far
+    assert_false(jsdrv_trigger_process(&t, src_, &fire));
+    src_hold(4000, 3000, 0.6f);  // contiguous, still above
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(1000, fire);
+
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_RISE, 0.2f, 1);
+    src_hold(0, 3000, 0.0f);
+    assert_false(jsdrv_trigger_process(&t, src_, &fire));
+    float * x = src_f32(3000, 1, 1000, 0.0f);
+    x[10] = 0.3f;
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(3010, fire);
+}
+
+static void test_gpi(void **state) {
+    (void) state;
+    struct jsdrv_trigger_s t;
+    uint64_t fire = 0;
+    jsdrv_trigger_clear(&t, JSDRV_BUFFER_SEARCH_RISE, 0.5f, 2);
+    src_f32(0, 1, 0, 0.0f);
+    src_->field_id = JSDRV_FIELD_GPI;
+    src_->element_type = JSDRV_DATA_TYPE_UINT;
+    src_->element_size_bits = 1;
+    src_->element_count = 1000;
+    src_->data[40] = 0x10;  // sample 324 is a single-sample pulse
+    src_->data[90] = 0xC0;  // samples 726 and 727
+    assert_true(jsdrv_trigger_process(&t, src_, &fire));
+    assert_int_equal(726, fire);
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_rise),
+            cmocka_unit_test(test_duration),
+            cmocka_unit_test(test_fall_and_cross),
+            cmocka_unit_test(test_gap),
+            cmocka_unit_test(test_hold),
+            cmocka_unit_test(test_gpi),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
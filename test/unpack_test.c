@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv/unpack.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+#define LENGTH (300U)
+
+static uint8_t x_[LENGTH];
+static uint8_t y_[LENGTH * 8 + 1];
+
+static int setup(void ** state) {
+    (void) state;
+    srand(1);
+    for (uint32_t i = 0; i < LENGTH; ++i) {
+        x_[i] = (uint8_t) rand();
+    }
+    return 0;
+}
+
+static void test_u4(void ** state) {
+    (void) state;
+    for (uint32_t offset = 0; offset < 5; ++offset) {
+        for (uint32_t length = 0; length < (2 * LENGTH - 8); length += 7) {
+            memset(y_, 0xff, sizeof(y_));
+            jsdrv_u4_unpack(y_, x_, offset, length);
+            for (uint32_t i = 0; i < length; ++i) {
+                uint32_t k = offset + i;
+                assert_int_equal((x_[k >> 1] >> ((k & 1) * 4)) & 0x0f, y_[i]);
+            }
+            assert_int_equal(0xff, y_[length]);
+        }
+    }
+}
+
+static void test_u1(void ** state) {
+    (void) state;
+    for (uint32_t offset = 0; offset < 19; offset += 3) {
+        for (uint32_t length = 0; length < (8 * LENGTH - 24); length += 13) {
+            memset(y_, 0xff, sizeof(y_));
+            jsdrv_u1_unpack(y_, x_, offset, length);
+            for (uint32_t i = 0; i < length; ++i) {
+                uint32_t k = offset + i;
+                assert_int_equal((x_[k >> 3] >> (k & 7)) & 1, y_[i]);
+            }
+            assert_int_equal(0xff, y_[length]);
+        }
+    }
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_u4),
+            cmocka_unit_test(test_u1),
+    };
+
+    return cmocka_run_group_tests(tests, setup, NULL);
+}
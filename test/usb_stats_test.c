@@ -0,0 +1,114 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "jsdrv_prv/usb_stats.h"
+#include "jsdrv/time.h"
+#include <string.h>
+
+
+#define T0 (JSDRV_TIME_SECOND * 1000)
+#define US JSDRV_TIME_MICROSECOND
+
+
+static void test_complete(void **state) {
+    (void) state;
+    struct jsdrv_usb_stats_s s;
+    jsdrv_usb_stats_open(&s, 0x82);
+    assert_int_equal(0x82, s.endpoint);
+    jsdrv_usb_stats_complete(&s, T0, 100);
+    assert_int_equal(1, s.completions);
+    assert_int_equal(100, s.bytes);
+    assert_int_equal(0, s.interval_count);
+    jsdrv_usb_stats_complete(&s, T0 + 1000 * US, 200);
+    jsdrv_usb_stats_complete(&s, T0 + 4000 * US, 300);
+    assert_int_equal(3, s.completions);
+    assert_int_equal(600, s.bytes);
+    assert_int_equal(2, s.interval_count);
+    assert_int_equal(1000, s.interval_min_us);
+    assert_int_equal(3000, s.interval_max_us);
+    assert_int_equal(4000, s.interval_sum_us);
+    assert_int_equal(500, s.interval_bytes);
+}
+
+static void test_residence(void **state) {
+    (void) state;
+    struct jsdrv_usb_stats_s s;
+    jsdrv_usb_stats_open(&s, 0x82);
+    jsdrv_usb_stats_residence(&s, T0, T0 + 10 * US);
+    jsdrv_usb_stats_residence(&s, T0, T0 + 30 * US);
+    jsdrv_usb_stats_residence(&s, T0, T0 - 30 * US);  // clock step
+    assert_int_equal(3, s.residence_count);
+    assert_int_equal(30, s.residence_max_us);
+    assert_int_equal(40, s.residence_sum_us);
+}
+
+static void test_json(void **state) {
+    (void) state;
+    char buf[1024];
+    struct jsdrv_usb_stats_s s[4];
+    memset(s, 0, sizeof(s));
+    assert_int_equal(0, jsdrv_usb_stats_json(s, 4, buf, sizeof(buf)));
+    assert_string_equal("{\"endpoints\": []}", buf);
+
+    jsdrv_usb_stats_open(&s[2], 0x82);
+    s[2].in_flight = 4;
+    s[2].loaned = 1;
+    s[2].timeouts = 2;
+    jsdrv_usb_stats_complete(&s[2], T0, 512);
+    jsdrv_usb_stats_complete(&s[2], T0 + 100 * US, 512);
+    jsdrv_usb_stats_complete(&s[2], T0 + 400 * US, 512);
+    jsdrv_usb_stats_residence(&s[2], T0, T0 + 20 * US);
+    assert_int_equal(1, jsdrv_usb_stats_json(s, 4, buf, sizeof(buf)));
+    assert_string_equal("{\"endpoints\": [{\"endpoint\": 130, \"completions\": 3, \"bytes\": 1536, "
+                        "\"bytes_per_s\": 2560000, "
+                        "\"timeouts\": 2, \"errors\": 0, \"in_flight\": 4, \"loaned\": 1, "
+                        "\"interval_us\": {\"min\": 100, \"avg\": 200, \"max\": 300}, "
+                        "\"residence_us\": {\"avg\": 20, \"max\": 20}}]}", buf);
+
+    // report window resets, totals continue
+    assert_int_equal(1, jsdrv_usb_stats_json(s, 4, buf, sizeof(buf)));
+    assert_string_equal("{\"endpoints\": [{\"endpoint\": 130, \"completions\": 3, \"bytes\": 1536, "
+                        "\"bytes_per_s\": 0, "
+                        "\"timeouts\": 2, \"errors\": 0, \"in_flight\": 4, \"loaned\": 1, "
+                        "\"interval_us\": {\"min\": 0, \"avg\": 0, \"max\": 0}, "
+                        "\"residence_us\": {\"avg\": 0, \"max\": 0}}]}", buf);
+}
+
+static void test_json_truncate(void **state) {
+    (void) state;
+    char buf[64];
+    struct jsdrv_usb_stats_s s;
+    jsdrv_usb_stats_open(&s, 0x82);
+    assert_int_equal(0, jsdrv_usb_stats_json(&s, 1, buf, sizeof(buf)));
+    assert_string_equal("{\"endpoints\": []}", buf);
+    assert_int_equal(0, jsdrv_usb_stats_json(&s, 1, buf, 4));
+}
+
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_complete),
+            cmocka_unit_test(test_residence),
+            cmocka_unit_test(test_json),
+            cmocka_unit_test(test_json_truncate),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2024 Jetperch LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <math.h>
+#include <stdlib.h>
+#include "jsdrv.h"
+#include "jsdrv/error_code.h"
+#include "jsdrv_prv/welch.h"
+
+
+#define N (64U)
+#define FS (1000U)
+#define PI (3.14159265358979323846)
+
+
+static float x_[16 * N];
+static uint8_t spectrum_mem_[JSDRV_SPECTRUM_HEADER_SIZE + (N / 2 + 1) * sizeof(float)];
+
+static struct jsdrv_welch_s * welch_new(uint32_t overlap, uint32_t period_ms, uint8_t scale) {
+    struct jsdrv_welch_config_s config = {
+        .sample_rate = FS,
+        .fft_length = N,
+        .overlap = overlap,
+        .period_ms = period_ms,
+        .scale = scale,
+    };
+    struct jsdrv_welch_s * w = jsdrv_welch_new();
+    assert_non_null(w);
+    assert_int_equal(0, jsdrv_welch_configure(w, &config));
+    return w;
+}
+
+static struct jsdrv_spectrum_s * next(struct jsdrv_welch_s * w) {
+    struct jsdrv_spectrum_s * s = (struct jsdrv_spectrum_s *) spectrum_mem_;
+    uint32_t size = jsdrv_welch_ready(w);
+    assert_int_equal(sizeof(spectrum_mem_), size);
+    assert_int_equal(0, jsdrv_welch_next(w, s));
+    assert_int_equal(N, s->fft_length);
+    assert_int_equal(N / 2 + 1, s->bin_count);
+    assert_int_equal(FS, s->sample_rate);
+    return s;
+}
+
+static void tone(float * x, uint32_t count, double amplitude, uint32_t bin) {
+    for (uint32_t i = 0; i < count; ++i) {
+        x[i] = (float) (amplitude * cos(2.0 * PI * bin * i / N));
+    }
+}
+
+static void test_dft(void ** state) {
+    (void) state;
+    struct jsdrv_welch_s * w = welch_new(0, 0, JSDRV_SPECTRUM_SCALE_POWER);
+    srand(1);
+    for (uint32_t i = 0; i < N; ++i) {
+        x_[i] = (float) rand() / RAND_MAX - 0.5f;
+    }
+    assert_int_equal(0, jsdrv_welch_add(w, 0, x_, N));
+    struct jsdrv_spectrum_s * s = next(w);
+    assert_int_equal(1, s->segment_count);
+    assert_int_equal(0, s->sample_id);
+
+    double s1 = 0.0;
+    for (uint32_t i = 0; i < N; ++i) {
+        s1 += 0.5 - 0.5 * cos(2.0 * PI * i / N);
+    }
+    for (uint32_t k = 0; k <= N / 2; ++k) {
+        double xr = 0.0;
+        double xi = 0.0;
+        for (uint32_t i = 0; i < N; ++i) {
+            double v = x_[i] * (0.5 - 0.5 * cos(2.0 * PI * i / N));
+            xr += v * cos(2.0 * PI * k * i / N);
+            xi -= v * sin(2.0 * PI * k * i / N);
+        }
+        double p = (xr * xr + xi * xi) / (s1 * s1);
+        if ((k > 0) && (k < N / 2)) {
+            p *= 2.0;
+        }
+        assert_float_equal(p, s->data[k], 1e-6);
+    }
+    jsdrv_welch_free(w);
+}
+
+static void test_tone_power(void ** state) {
+    (void) state;
+    struct jsdrv_welch_s * w = welch_new(0, 0, JSDRV_SPECTRUM_SCALE_POWER);
+    tone(x_, N, 2.0, 8);
+    for (uint32_t i = 0; i < N; ++i) {
+        x_[i] += 0.5f;
+    }
+    assert_int_equal(0, jsdrv_welch_add(w, 0, x_, N));
+    struct jsdrv_spectrum_s * s = next(w);
+    assert_float_equal(0.25, s->data[0], 1e-5);       // DC^2
+    assert_float_equal(2.0, s->data[8], 1e-5);        // A^2 / 2
+    assert_float_equal(0.5, s->data[7], 1e-5);        // Hann leakage
+    assert_float_equal(0.5, s->data[9], 1e-5);
+    assert_float_equal(0.0, s->data[20], 1e-5);
+    jsdrv_welch_free(w);
+}
+
+static void test_tone_density(void ** state) {
+    (void) state;
+    struct jsdrv_welch_s * w = welch_new(0, 0, JSDRV_SPECTRUM_SCALE_DENSITY);
+    tone(x_, N, 2.0, 5);
+    assert_int_equal(0, jsdrv_welch_add(w, 0, x_, N));
+    struct jsdrv_spectrum_s * s = next(w);
+    assert_int_equal(JSDRV_SPECTRUM_SCALE_DENSITY, s->scale);
+    double total = 0.0;
+    for (uint32_t k = 0; k < s->bin_count; ++k) {
+        total += s->data[k];
+    }
+    assert_float_equal(2.0, total * FS / N, 1e-4);   // the signal power
+    jsdrv_welch_free(w);
+}
+
+static void test_overlap_and_period(void ** state) {
+    (void) state;
+    // 50% overlap, 4 * N samples = 7 segments, 256 ms period
+    struct jsdrv_welch_s * w = welch_new(50, 256, JSDRV_SPECTRUM_SCALE_POWER);
+    tone(x_, 8 * N, 1.0, 4);
+    for (uint32_t i = 0; i < 4 * N; i += 16) {
+        assert_int_equal(0, jsdrv_welch_add(w, 1000 + i, x_ + i, 16));
+        if (i < (4 * N - 16)) {
+            assert_int_equal(0, jsdrv_welch_ready(w));
+        }
+    }
+    struct jsdrv_spectrum_s * s = next(w);
+    assert_int_equal(7, s->segment_count);
+    assert_int_equal(1000, s->sample_id);
+    assert_float_equal(0.5, s->data[4], 1e-5);
+    assert_int_equal(0, jsdrv_welch_ready(w));
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_welch_next(w, s));
+
+    // the next average continues from the retained overlap
+    assert_int_equal(0, jsdrv_welch_add(w, 1000 + 4 * N, x_ + 4 * N, 4 * N));
+    s = next(w);
+    assert_int_equal(8, s->segment_count);
+    assert_int_equal(1000 + 7 * N / 2, s->sample_id);
+    jsdrv_welch_free(w);
+}
+
+static void test_gap_and_nan(void ** state) {
+    (void) state;
+    struct jsdrv_welch_s * w = welch_new(0, 0, JSDRV_SPECTRUM_SCALE_POWER);
+    tone(x_, 2 * N, 1.0, 4);
+    assert_int_equal(0, jsdrv_welch_add(w, 0, x_, N / 2));
+    assert_int_equal(0, jsdrv_welch_add(w, N, x_, N));     // gap discards the first half segment
+    struct jsdrv_spectrum_s * s = next(w);
+    assert_int_equal(1, s->segment_count);
+    assert_int_equal(N, s->sample_id);
+
+    x_[3] = NAN;
+    assert_int_equal(0, jsdrv_welch_add(w, 2 * N, x_, N));
+    assert_int_equal(0, jsdrv_welch_ready(w));
+    assert_int_equal(0, jsdrv_welch_add(w, 3 * N, x_ + N, N));
+    s = next(w);
+    assert_int_equal(1, s->segment_count);
+    assert_int_equal(3 * N, s->sample_id);
+    assert_false(isnan(s->data[0]));
+    jsdrv_welch_free(w);
+}
+
+static void test_invalid(void ** state) {
+    (void) state;
+    struct jsdrv_welch_config_s config = {.sample_rate = FS, .fft_length = N, .overlap = 50};
+    struct jsdrv_welch_s * w = jsdrv_welch_new();
+    assert_int_equal(JSDRV_ERROR_UNAVAILABLE, jsdrv_welch_add(w, 0, x_, 1));
+    assert_int_equal(0, jsdrv_welch_ready(w));
+    config.fft_length = 100;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_welch_configure(w, &config));
+    config.fft_length = JSDRV_WELCH_LENGTH_MAX * 2;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_welch_configure(w, &config));
+    config.fft_length = N;
+    config.overlap = 100;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_welch_configure(w, &config));
+    config.overlap = 0;
+    config.sample_rate = 0;
+    assert_int_equal(JSDRV_ERROR_PARAMETER_INVALID, jsdrv_welch_configure(w, &config));
+    jsdrv_welch_free(w);
+    jsdrv_welch_free(NULL);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_dft),
+            cmocka_unit_test(test_tone_power),
+            cmocka_unit_test(test_tone_density),
+            cmocka_unit_test(test_overlap_and_period),
+            cmocka_unit_test(test_gap_and_nan),
+            cmocka_unit_test(test_invalid),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}